@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <sstream>
+#include <string>
+#include <client_int.h>
+#include <bind_upload.h>
+#include "FileTransferAgent.hpp"
+#include "StatementPutGet.hpp"
+#include "snowflake/SnowflakeTransferException.hpp"
+#include "util/CompressionUtil.hpp"
+#include "logger/SFLogger.hpp"
+
+using namespace Snowflake::Client;
+
+namespace
+{
+/**
+ * Runs the PUT of the compressed binds on a statement of its own, so that the
+ * result of the bound statement is left alone.
+ */
+bool putBindFile(SF_STMT *stmt, const std::string &compressed,
+                 const char *fileName, const char *stagePath)
+{
+  StatementPutGet putget(stmt);
+  FileTransferAgent agent(&putget);
+  std::stringstream uploadStream(compressed);
+  agent.setUploadStream(&uploadStream, compressed.size());
+
+  std::string command = std::string("PUT 'file://") + fileName + "' '" +
+    stagePath + "' overwrite=true auto_compress=false source_compression=gzip";
+  ITransferResult *result = agent.execute(&command);
+
+  std::string status;
+  int statusIndex = result->findColumnByName("status", 6);
+  if (statusIndex < 0 || !result->next())
+  {
+    return false;
+  }
+  result->getColumnAsString((unsigned int)statusIndex, status);
+  if (status != "UPLOADED")
+  {
+    CXX_LOG_ERROR("Bind file upload status %s", status.c_str());
+    return false;
+  }
+  return true;
+}
+}
+
+extern "C" {
+
+SF_STATUS STDCALL bind_upload_put(SF_STMT *sfstmt, const char *data, size_t len,
+                                  char *stage_path)
+{
+  SF_CONNECT *sf = sfstmt->connection;
+  SF_STMT *stmt = NULL;
+  char uuid[SF_UUID4_LEN];
+  SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+
+  std::string compressed;
+  if (Util::CompressionUtil::compressWithGzip(data, len, compressed) != 0)
+  {
+    CXX_LOG_ERROR("Failed to compress the binds for upload");
+    return SF_STATUS_ERROR_GENERAL;
+  }
+
+  stmt = snowflake_stmt(sf);
+  if (!stmt)
+  {
+    return SF_STATUS_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (!sf->bind_stage_created)
+  {
+    if (snowflake_query(stmt, SF_BIND_STAGE_CREATE_SQL, 0) != SF_STATUS_SUCCESS)
+    {
+      CXX_LOG_ERROR("Failed to create the bind stage: %s", stmt->error.msg);
+      goto cleanup;
+    }
+    sf->bind_stage_created = SF_BOOLEAN_TRUE;
+  }
+
+  uuid4_generate(uuid);
+  sb_sprintf(stage_path, SF_BIND_STAGE_PATH_LEN, "@%s/%s", SF_BIND_STAGE_NAME, uuid);
+
+  try
+  {
+    std::string fileName = std::string(uuid) + ".csv.gz";
+    if (putBindFile(stmt, compressed, fileName.c_str(), stage_path))
+    {
+      ret = SF_STATUS_SUCCESS;
+    }
+  }
+  catch (SnowflakeTransferException &e)
+  {
+    CXX_LOG_ERROR("Failed to upload the binds: %s", e.what());
+  }
+  catch (...)
+  {
+    CXX_LOG_ERROR("Failed to upload the binds");
+  }
+
+cleanup:
+  snowflake_stmt_term(stmt);
+  return ret;
+}
+
+}
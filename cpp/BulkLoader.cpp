@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <client_int.h>
+#include "error.h"
+#include "FileTransferAgent.hpp"
+#include "StatementPutGet.hpp"
+#include "snowflake/SnowflakeTransferException.hpp"
+#include "util/StageSql.hpp"
+#include "logger/SFLogger.hpp"
+
+using namespace Snowflake::Client;
+using Snowflake::Client::Util::StageSql;
+
+namespace
+{
+/**
+ * Collects the files uploaded by the PUT of a bulk load, for the COPY INTO
+ * statements to take them in groups.
+ */
+class BulkLoadListener : public ITransferListener
+{
+public:
+  BulkLoadListener() : m_failedFiles(0)
+  {
+  }
+
+  void onFileCompleted(const std::string &srcFileName,
+                       const std::string &destFileName,
+                       const std::string &status,
+                       size_t completedFiles, size_t totalFiles) override
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (status == "UPLOADED")
+    {
+      m_uploaded.push_back(destFileName);
+      m_uploadedCond.notify_one();
+    }
+    // the files skipped are the ones cancelled, a fresh stage directory has
+    // no file of the same name
+    else if (status != "SKIPPED")
+    {
+      CXX_LOG_ERROR("Bulk load failed to upload %s, status %s",
+                    srcFileName.c_str(), status.c_str());
+      m_failedFiles++;
+    }
+  }
+
+  /**
+   * Wait for the next group of uploaded files to load, at most maxFiles of
+   * them, and at least that many unless the upload is over if waitForAll.
+   * @return false once the upload is over and all its files taken
+   */
+  bool nextGroup(ITransferHandle *handle, size_t maxFiles, bool waitForAll,
+                 std::vector<std::string> &group)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+      // the files are all listed when the command is done, see onFileCompleted
+      bool uploadDone = handle->isDone();
+      if (m_uploaded.empty() && uploadDone)
+      {
+        return false;
+      }
+      if (!m_uploaded.empty() &&
+          (!waitForAll || m_uploaded.size() >= maxFiles || uploadDone))
+      {
+        break;
+      }
+      // the end of the command isn't notified
+      m_uploadedCond.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    size_t count = std::min(maxFiles, m_uploaded.size());
+    group.assign(m_uploaded.begin(), m_uploaded.begin() + count);
+    m_uploaded.erase(m_uploaded.begin(), m_uploaded.begin() + count);
+    return true;
+  }
+
+  size_t getFailedFiles()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failedFiles;
+  }
+
+private:
+  std::mutex m_mutex;
+
+  std::condition_variable m_uploadedCond;
+
+  /// files uploaded and not loaded yet
+  std::vector<std::string> m_uploaded;
+
+  size_t m_failedFiles;
+};
+
+std::string buildCopyCommand(const char *table, const std::string &stagePath,
+                             const std::vector<std::string> &files,
+                             const SF_BULK_LOAD_OPTIONS *options)
+{
+  std::string command = std::string("COPY INTO ") + table + " FROM " +
+    StageSql::quote(stagePath) + " FILES = (";
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    command += (i == 0 ? "" : ", ") + StageSql::quote(files[i]);
+  }
+  command += ")";
+  if (options && options->file_format)
+  {
+    command += std::string(" FILE_FORMAT = ") + options->file_format;
+  }
+  if (options && options->purge)
+  {
+    command += " PURGE = TRUE";
+  }
+  return command;
+}
+
+/**
+ * Adds up the rows_loaded column of the result of a COPY INTO, which has a
+ * status column only when there was no file to load
+ */
+int64 countRowsLoaded(SF_STMT *sfstmt)
+{
+  int64 rowsIndex = -1;
+  for (int64 i = 0; i < sfstmt->total_fieldcount; i++)
+  {
+    if (sf_strncasecmp(sfstmt->desc[i].name, "rows_loaded", 12) == 0)
+    {
+      rowsIndex = i;
+    }
+  }
+  if (rowsIndex < 0)
+  {
+    return 0;
+  }
+
+  int64 rows = 0;
+  while (snowflake_fetch(sfstmt) == SF_STATUS_SUCCESS)
+  {
+    int64 fileRows = 0;
+    if (snowflake_column_as_int64(sfstmt, (int)rowsIndex + 1, &fileRows) ==
+        SF_STATUS_SUCCESS)
+    {
+      rows += fileRows;
+    }
+  }
+  return rows;
+}
+
+SF_STATUS bulkLoadFailed(SF_STMT *sfstmt, const std::string &message)
+{
+  CXX_LOG_ERROR("Bulk load failed: %s", message.c_str());
+  SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_GENERAL, message.c_str(),
+                           SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+  return SF_STATUS_ERROR_GENERAL;
+}
+
+/**
+ * Runs the PUT of the files in the background on putStmt and COPY INTO
+ * statements on sfstmt for the files uploaded as they are uploaded
+ */
+SF_STATUS runBulkLoad(SF_STMT *sfstmt, SF_STMT *putStmt, const char *files,
+                      const char *table, const SF_BULK_LOAD_OPTIONS *options,
+                      int64 *rowsLoaded)
+{
+  char uuid[SF_UUID4_LEN];
+  uuid4_generate(uuid);
+  std::string stage = options && options->stage ? options->stage :
+    StageSql::getTableStage(table);
+  std::string stagePath = stage + "/" + uuid + "/";
+
+  int64 fileSize = options ? options->file_size : 0;
+  int64 groupFiles = options ? options->group_files : 0;
+  size_t maxGroupFiles = groupFiles > 0 ?
+    (size_t)std::min<int64>(groupFiles, SF_BULK_LOAD_MAX_GROUP_FILES) :
+    SF_BULK_LOAD_MAX_GROUP_FILES;
+
+  TransferConfig transferConfig;
+  transferConfig.coalesceTargetSize = fileSize < 0 ? 0 :
+    fileSize == 0 ? SF_BULK_LOAD_FILE_SIZE_DEFAULT : (size_t)fileSize;
+
+  StatementPutGet putget(putStmt);
+  FileTransferAgent agent(&putget, &transferConfig);
+  BulkLoadListener listener;
+  std::string command = "PUT " + StageSql::quote(std::string("file://") + files) +
+    " " + StageSql::quote(stagePath) + " auto_compress=true";
+  // deleted before the agent and the listener, waiting for the upload
+  std::unique_ptr<ITransferHandle> handle(agent.executeAsync(&command, &listener));
+
+  SF_STATUS ret = SF_STATUS_SUCCESS;
+  std::vector<std::string> group;
+  while (listener.nextGroup(handle.get(), maxGroupFiles, groupFiles > 0, group))
+  {
+    CXX_LOG_DEBUG("Bulk load copying %zu files of %s into %s", group.size(),
+                  stagePath.c_str(), table);
+    std::string copyCommand = buildCopyCommand(table, stagePath, group, options);
+    ret = snowflake_query(sfstmt, copyCommand.c_str(), copyCommand.size());
+    if (ret != SF_STATUS_SUCCESS)
+    {
+      CXX_LOG_ERROR("Bulk load COPY INTO %s failed: %s", table, sfstmt->error.msg);
+      handle->cancel();
+      break;
+    }
+    *rowsLoaded += countRowsLoaded(sfstmt);
+  }
+
+  try
+  {
+    handle->wait();
+  }
+  catch (SnowflakeTransferException &e)
+  {
+    // the error of the COPY INTO is kept then
+    return ret != SF_STATUS_SUCCESS ? ret : bulkLoadFailed(sfstmt, e.what());
+  }
+  if (ret != SF_STATUS_SUCCESS)
+  {
+    return ret;
+  }
+
+  size_t failedFiles = listener.getFailedFiles();
+  if (failedFiles > 0)
+  {
+    return bulkLoadFailed(sfstmt, std::to_string(failedFiles) +
+                          " files failed to upload, the others are loaded");
+  }
+  return SF_STATUS_SUCCESS;
+}
+}
+
+extern "C" {
+
+SF_STATUS STDCALL snowflake_bulk_load(SF_STMT *sfstmt, const char *files, const char *table,
+                                      const SF_BULK_LOAD_OPTIONS *options,
+                                      int64 *rows_loaded)
+{
+  if (!sfstmt)
+  {
+    return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+  }
+  int64 rows = 0;
+  if (!rows_loaded)
+  {
+    rows_loaded = &rows;
+  }
+  *rows_loaded = 0;
+  clear_snowflake_error(&sfstmt->error);
+  if (!files || !table)
+  {
+    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                             "The files and the table to load into are required",
+                             SF_SQLSTATE_GENERAL_ERROR, NULL);
+    return SF_STATUS_ERROR_NULL_POINTER;
+  }
+
+  SF_STMT *putStmt = snowflake_stmt(sfstmt->connection);
+  if (!putStmt)
+  {
+    return SF_STATUS_ERROR_OUT_OF_MEMORY;
+  }
+
+  SF_STATUS ret;
+  try
+  {
+    ret = runBulkLoad(sfstmt, putStmt, files, table, options, rows_loaded);
+  }
+  catch (...)
+  {
+    ret = bulkLoadFailed(sfstmt, "Unexpected error");
+  }
+
+  snowflake_stmt_term(putStmt);
+  return ret;
+}
+
+}
@@ -6,7 +6,9 @@
 #define SNOWFLAKECLIENT_FILEMETADATA_HPP
 
 #include <string>
+#include <vector>
 #include "snowflake/PutGetParseResponse.hpp"
+#include "snowflake/ITransferResult.hpp"
 #include "crypto/CryptoTypes.hpp"
 #include "FileCompressionType.hpp"
 #include <chrono>
@@ -61,9 +63,16 @@ struct FileMetadata
   /// Absolute path to the destination (including the filename. /tmp/small_test_file.csv.gz)
   std::string destPath;
 
+  /// true if the storage client may write the download straight to destPath,
+  /// each part at its offset, instead of in order to the data stream
+  bool writeToDestPath;
+
   /// true if require gzip compression
   bool requireCompress;
 
+  /// level of the compression, negative for the default of the type
+  int compressLevel;
+
   /// Upload and overwrite if file exists
   bool overWrite;
 
@@ -73,6 +82,10 @@ struct FileMetadata
   /// file message digest (after compression if required)
   std::string sha256Digest;
 
+  /// version of the remote file downloaded, its ETag, empty if the storage
+  /// doesn't give one
+  std::string remoteVersion;
+
   /// source compression 
   const FileCompressionType * sourceCompression;
   
@@ -82,6 +95,16 @@ struct FileMetadata
   /// pre-signed url
   std::string presignedUrl;
 
+  /// source files packed into this one, in order, empty if not coalesced.
+  /// srcFileName is the first of them
+  std::vector<std::string> coalescedFiles;
+
+  /// in memory data to upload instead of the source file (NOT OWN)
+  std::basic_iostream<char> *srcStream;
+
+  /// sizes, timings and retries of the transfer, see ITransferResult::getMetrics
+  TransferMetrics metrics;
+
   /// To estimate put/get performance.
   std::chrono::steady_clock::time_point tstamps[10] ;
 
@@ -93,7 +116,7 @@ struct FileMetadata
     tstamps[ts] = std::chrono::steady_clock::now();
   }
 
-  FileMetadata() {
+  FileMetadata() : writeToDestPath(false), compressLevel(-1), srcStream(nullptr) {
     recordPutGetTimestamp();
   }
 
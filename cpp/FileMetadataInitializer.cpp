@@ -7,12 +7,20 @@
 #include "logger/SFLogger.hpp"
 #include "snowflake/platform.h"
 #include "snowflake/SnowflakeTransferException.hpp"
+#include "util/Base64.hpp"
+#include "util/ThreadPool.hpp"
+#include <algorithm>
 #include <cerrno>
+#include <exception>
+#include <sstream>
 
 #define COMPRESSION_AUTO "AUTO"
 #define COMPRESSION_AUTO_DETECT "AUTO_DETECT"
 #define COMPRESSION_NONE "NONE"
 
+// files a thread takes at least when initializing upload metadata
+#define MIN_FILES_PER_JOB 64
+
 #ifdef _WIN32
 #include "Shlwapi.h"
 #else
@@ -27,28 +35,103 @@ Snowflake::Client::FileMetadataInitializer::FileMetadataInitializer(
   std::vector<FileMetadata> &largeFileMetadata) :
   m_smallFileMetadata(smallFileMetadata),
   m_largeFileMetadata(largeFileMetadata),
-  m_autoCompress(true)
+  m_autoCompress(true),
+  m_autoCompressType(&FileCompressionType::GZIP),
+  m_parallel(1)
 {
 }
 
 void
-Snowflake::Client::FileMetadataInitializer::initUploadFileMetadata(const std::string &fileDir, const char *fileName,
-                                                                   long fileSize, size_t threshold)
+Snowflake::Client::FileMetadataInitializer::initUploadFilesMetadata(
+  const std::string &fileDir,
+  const std::vector<std::string> &fileNames,
+  std::vector<long> &fileSizes,
+  size_t threshold,
+  const std::string &sourceLocation)
 {
-  std::string fileNameFull = fileDir;
-  fileNameFull += fileName;
+  std::vector<FileMetadata> filesMetadata(fileNames.size());
+  std::vector<char> isFile(fileNames.size(), 1);
 
-  FileMetadata fileMetadata;
-  fileMetadata.srcFileName = fileNameFull;
-  fileMetadata.srcFileSize = fileSize;
-  fileMetadata.destFileName = std::string(fileName);
-  // process compression type
-  initCompressionMetadata(fileMetadata);
+  // each job takes every jobs-th file, so that the lists below keep the
+  // order the files were found in
+  unsigned int jobs = (unsigned int)std::min((size_t)std::max(m_parallel, 1u),
+    (fileNames.size() + MIN_FILES_PER_JOB - 1) / MIN_FILES_PER_JOB);
+  std::vector<std::exception_ptr> errors(std::max(jobs, 1u));
+  auto initFiles = [&](unsigned int job, unsigned int stride)
+  {
+    try
+    {
+      for (size_t i = job; i < fileNames.size(); i += stride)
+      {
+        std::string fileNameFull = fileDir + fileNames[i];
+#ifndef _WIN32
+        if (fileSizes[i] < 0)
+        {
+          struct stat fileStatus;
+          int ret = stat(fileNameFull.c_str(), &fileStatus);
+          if (ret)
+          {
+            CXX_LOG_ERROR("Cannot read path struct");
+            throw SnowflakeTransferException(TransferError::DIR_OPEN_ERROR,
+                                             sourceLocation.c_str(), ret);
+          }
+          if (!S_ISREG(fileStatus.st_mode))
+          {
+            isFile[i] = 0;
+            continue;
+          }
+          fileSizes[i] = (long)fileStatus.st_size;
+        }
+#endif
+        FileMetadata &fileMetadata = filesMetadata[i];
+        fileMetadata.srcFileName = fileNameFull;
+        fileMetadata.srcFileSize = fileSizes[i];
+        fileMetadata.destFileName = fileNames[i];
+        // process compression type
+        initCompressionMetadata(fileMetadata);
+      }
+    }
+    catch (...)
+    {
+      errors[job] = std::current_exception();
+    }
+  };
+
+  if (jobs > 1)
+  {
+    CXX_LOG_DEBUG("Init metadata of %zu files with %u threads",
+                  fileNames.size(), jobs);
+    Util::ThreadPool tp(jobs);
+    for (unsigned int job = 0; job < jobs; job++)
+    {
+      tp.AddJob([&initFiles, job, jobs]()->void {
+        initFiles(job, jobs);
+      });
+    }
+    tp.WaitAll();
+  }
+  else
+  {
+    initFiles(0, 1);
+  }
 
-  std::vector<FileMetadata> &metaListToPush = fileSize > threshold ?
-    m_largeFileMetadata : m_smallFileMetadata;
+  for (size_t i = 0; i < errors.size(); i++)
+  {
+    if (errors[i])
+    {
+      std::rethrow_exception(errors[i]);
+    }
+  }
 
-  metaListToPush.push_back(fileMetadata);
+  for (size_t i = 0; i < filesMetadata.size(); i++)
+  {
+    if (isFile[i])
+    {
+      std::vector<FileMetadata> &metaListToPush =
+        (size_t)fileSizes[i] > threshold ? m_largeFileMetadata : m_smallFileMetadata;
+      metaListToPush.push_back(filesMetadata[i]);
+    }
+  }
 }
 
 void Snowflake::Client::FileMetadataInitializer::populateSrcLocUploadMetadata(std::string &sourceLocation,
@@ -76,23 +159,24 @@ void Snowflake::Client::FileMetadataInitializer::populateSrcLocUploadMetadata(st
     }
   }
 
+  size_t dirSep = sourceLocation.find_last_of(PATH_SEP);
+  if (dirSep == std::string::npos)
+  {
+    dirSep = sourceLocation.find_last_of(ALTER_PATH_SEP);
+  }
+  std::string dirPath = dirSep != std::string::npos ?
+    sourceLocation.substr(0, dirSep + 1) : "";
+  std::vector<std::string> fileNames;
+  std::vector<long> fileSizes;
   do {
-    if (!(fdd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) )
+    if (!(fdd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+        dirSep != std::string::npos)
     {
-      std::string fileFullPath = std::string(fdd.cFileName);
-      size_t dirSep = sourceLocation.find_last_of(PATH_SEP);
-      if (dirSep == std::string::npos) 
-      {
-        dirSep = sourceLocation.find_last_of(ALTER_PATH_SEP);
-      }
-      if (dirSep != std::string::npos) 
-      {
-        std::string dirPath = sourceLocation.substr(0, dirSep + 1);
-        LARGE_INTEGER fileSize;
-        fileSize.LowPart = fdd.nFileSizeLow;
-        fileSize.HighPart = fdd.nFileSizeHigh;
-        initUploadFileMetadata(dirPath, (char *)fdd.cFileName, (long)fileSize.QuadPart, putThreshold);
-      }
+      LARGE_INTEGER fileSize;
+      fileSize.LowPart = fdd.nFileSizeLow;
+      fileSize.HighPart = fdd.nFileSizeHigh;
+      fileNames.push_back(std::string(fdd.cFileName));
+      fileSizes.push_back((long)fileSize.QuadPart);
     }
   } while (FindNextFile(hFind, &fdd) != 0);
 
@@ -105,6 +189,8 @@ void Snowflake::Client::FileMetadataInitializer::populateSrcLocUploadMetadata(st
   }
   FindClose(hFind);
 
+  initUploadFilesMetadata(dirPath, fileNames, fileSizes, putThreshold,
+                          sourceLocation);
 #else
   unsigned long dirSep = sourceLocation.find_last_of(PATH_SEP);
   std::string dirPath = sourceLocation.substr(0, dirSep + 1);
@@ -112,31 +198,22 @@ void Snowflake::Client::FileMetadataInitializer::populateSrcLocUploadMetadata(st
 
   DIR * dir = nullptr;
   struct dirent * dir_entry;
+  std::vector<std::string> fileNames;
   if ((dir = opendir(dirPath.c_str())) != NULL)
   {
     while((dir_entry = readdir(dir)) != NULL)
     {
       if (!fnmatch(filePattern.c_str(), dir_entry->d_name, 0))
       {
-        std::string srcFileName = dirPath + dir_entry->d_name;
-        struct stat fileStatus;
-        int ret = stat(srcFileName.c_str(), &fileStatus);
-        if (!ret)
-        {
-          if (S_ISREG(fileStatus.st_mode)) {
-            initUploadFileMetadata(dirPath, dir_entry->d_name,
-                                   (long) fileStatus.st_size, putThreshold);
-          }
-        }
-        else
-        {
-          CXX_LOG_ERROR("Cannot read path struct");
-          throw SnowflakeTransferException(TransferError::DIR_OPEN_ERROR,
-                                           sourceLocation.c_str(), ret);
-        }
+        fileNames.push_back(dir_entry->d_name);
       }
     }
     closedir(dir);
+
+    // the files are stat-ed along with detecting their compression type
+    std::vector<long> fileSizes(fileNames.size(), -1);
+    initUploadFilesMetadata(dirPath, fileNames, fileSizes, putThreshold,
+                            sourceLocation);
   }
   else
   {
@@ -190,7 +267,7 @@ void Snowflake::Client::FileMetadataInitializer::initCompressionMetadata(
   if (fileMetadata.sourceCompression == &FileCompressionType::NONE)
   {
     fileMetadata.targetCompression = m_autoCompress ?
-      &FileCompressionType::GZIP : &FileCompressionType::NONE;
+      m_autoCompressType : &FileCompressionType::NONE;
     fileMetadata.requireCompress = m_autoCompress;
     fileMetadata.destFileName = m_autoCompress ?
       fileMetadata.destFileName + fileMetadata.targetCompression->
@@ -228,6 +305,29 @@ void Snowflake::Client::FileMetadataInitializer::initEncryptionMetadata(
   fileMetadata->destFileSize = (long)(fileMetadata->encryptionMetadata.cipherStreamSize);
 }
 
+bool Snowflake::Client::FileMetadataInitializer::restoreEncryptionMetadata(
+  FileMetadata *fileMetadata, const std::string &enKekEncoded,
+  const std::string &ivEncoded, const std::string &matDesc)
+{
+  // the file key must have been encrypted by the same query stage master key
+  std::stringstream smkId;
+  smkId << "\"smkId\":\"" << m_encMat->at(0).smkId << "\"";
+  size_t ivSize = Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES);
+  if (matDesc.find(smkId.str()) == std::string::npos ||
+      ivEncoded.size() != Util::Base64::encodedLength(ivSize) ||
+      Util::Base64::decodedLength(ivEncoded.c_str(), ivEncoded.size()) != ivSize)
+  {
+    return false;
+  }
+
+  fileMetadata->encryptionMetadata.enKekEncoded = enKekEncoded;
+  fileMetadata->encryptionMetadata.matDesc = matDesc;
+  Util::Base64::decode(ivEncoded.c_str(), ivEncoded.size(),
+                       fileMetadata->encryptionMetadata.iv.data);
+  EncryptionProvider::decryptFileKey(fileMetadata, &(m_encMat->at(0)), getRandomDev());
+  return true;
+}
+
 Snowflake::Client::RemoteStorageRequestOutcome
 Snowflake::Client::FileMetadataInitializer::
 populateSrcLocDownloadMetadata(std::string &sourceLocation,
@@ -236,26 +336,44 @@ populateSrcLocDownloadMetadata(std::string &sourceLocation,
                                EncryptionMaterial *encMat,
                                std::string const& presignedUrl)
 {
-  std::string fullPath = *remoteLocation + sourceLocation;
-  size_t dirSep = fullPath.find_last_of('/');
-  std::string dstFileName = fullPath.substr(dirSep + 1);
-
   FileMetadata fileMetadata;
-  fileMetadata.presignedUrl = presignedUrl;
-  RemoteStorageRequestOutcome outcome = storageClient->GetRemoteFileMetadata(
-    &fullPath, &fileMetadata);
+  RemoteStorageRequestOutcome outcome = initDownloadMetadata(
+    sourceLocation, *remoteLocation, storageClient, encMat, presignedUrl, fileMetadata);
 
   if (outcome == RemoteStorageRequestOutcome::SUCCESS)
   {
-    CXX_LOG_DEBUG("Success on getting remote file metadata");
     std::vector<FileMetadata> &metaListToPush =
       fileMetadata.srcFileSize > DOWNLOAD_DATA_SIZE_THRESHOLD ?
       m_largeFileMetadata : m_smallFileMetadata;
 
     metaListToPush.push_back(fileMetadata);
-    metaListToPush.back().srcFileName = fullPath;
-    metaListToPush.back().destFileName = dstFileName;
-    EncryptionProvider::decryptFileKey(&(metaListToPush.back()), encMat, getRandomDev());
+  }
+
+  return outcome;
+}
+
+Snowflake::Client::RemoteStorageRequestOutcome
+Snowflake::Client::FileMetadataInitializer::
+initDownloadMetadata(std::string const& sourceLocation,
+                     std::string const& remoteLocation,
+                     IStorageClient *storageClient,
+                     EncryptionMaterial *encMat,
+                     std::string const& presignedUrl,
+                     FileMetadata &fileMetadata)
+{
+  std::string fullPath = remoteLocation + sourceLocation;
+  size_t dirSep = fullPath.find_last_of('/');
+
+  fileMetadata.presignedUrl = presignedUrl;
+  RemoteStorageRequestOutcome outcome = storageClient->GetRemoteFileMetadata(
+    &fullPath, &fileMetadata);
+
+  if (outcome == RemoteStorageRequestOutcome::SUCCESS)
+  {
+    CXX_LOG_DEBUG("Success on getting remote file metadata");
+    fileMetadata.srcFileName = fullPath;
+    fileMetadata.destFileName = fullPath.substr(dirSep + 1);
+    EncryptionProvider::decryptFileKey(&fileMetadata, encMat, getRandomDev());
   }
 
   return outcome;
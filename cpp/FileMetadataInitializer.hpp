@@ -42,16 +42,46 @@ public:
     IStorageClient *storageClient, EncryptionMaterial *encMat,
     std::string const& presignedUrl);
 
+  /**
+   * Look up the metadata of a file to download, like
+   * populateSrcLocDownloadMetadata, into the given file metadata instead of
+   * dividing it into the vectors. Safe to call from several threads at once.
+   * @param(OUT) fileMetadata metadata of the file, set on success
+   */
+  RemoteStorageRequestOutcome initDownloadMetadata(
+    std::string const& sourceLocation, std::string const& remoteLocation,
+    IStorageClient *storageClient, EncryptionMaterial *encMat,
+    std::string const& presignedUrl, FileMetadata &fileMetadata);
+
   /**
    * Init encryption metadata in file metadata
    */
   void initEncryptionMetadata(FileMetadata *fileMetadata);
 
+  /**
+   * Take the file key and iv of an upload started before, after
+   * initEncryptionMetadata, so that the parts already uploaded stay valid.
+   * @param enKekEncoded file key encrypted by the query stage master key
+   * @param ivEncoded base64 encoded iv
+   * @param matDesc material descriptor the file key was encrypted with
+   * @return false if the file key wasn't encrypted by the current query
+   * stage master key, the new file key is kept then
+   */
+  bool restoreEncryptionMetadata(FileMetadata *fileMetadata,
+                                 const std::string &enKekEncoded,
+                                 const std::string &ivEncoded,
+                                 const std::string &matDesc);
+
   inline void setAutoCompress(bool autoCompress)
   {
     m_autoCompress = autoCompress;
   }
 
+  inline void setAutoCompressType(const FileCompressionType *autoCompressType)
+  {
+    m_autoCompressType = autoCompressType;
+  }
+
   inline void setSourceCompression(char *sourceCompression)
   {
     m_sourceCompression = sourceCompression;
@@ -62,6 +92,15 @@ public:
     m_encMat = encMat;
   }
 
+  /**
+   * Set the number of threads used to stat the files matching a source
+   * location and detect their compression type
+   */
+  inline void setParallel(unsigned int parallel)
+  {
+    m_parallel = parallel;
+  }
+
   inline void setRandomDev(bool useUrand)
   {
     m_randDevice = (useUrand) ? Crypto::CryptoRandomDevice::DEV_URANDOM : Crypto::CryptoRandomDevice::DEV_RANDOM ;
@@ -74,10 +113,15 @@ public:
 
 private:
   /**
-   * Given file name, populate metadata
-   * @param fileName
+   * Populate metadata of the files found in a directory, in parallel when
+   * there are enough of them. A negative size is read with stat, and a file
+   * that turns out not to be a regular file is left out.
    */
-  void initUploadFileMetadata(const std::string &fileDir, const char *fileName, long fileSize, size_t threshold);
+  void initUploadFilesMetadata(const std::string &fileDir,
+                               const std::vector<std::string> &fileNames,
+                               std::vector<long> &fileSizes,
+                               size_t threshold,
+                               const std::string &sourceLocation);
 
   /**
    * init compression metadata
@@ -93,12 +137,18 @@ private:
   /// auto compress
   bool m_autoCompress;
 
+  /// compression type of auto compress
+  const FileCompressionType *m_autoCompressType;
+
   /// source compression
   char *m_sourceCompression;
 
   /// encryption material
   std::vector<EncryptionMaterial> * m_encMat;
 
+  /// threads used to init upload metadata
+  unsigned int m_parallel;
+
   /// Random device for crytpo random num generator.
   Crypto::CryptoRandomDevice m_randDevice;
 };
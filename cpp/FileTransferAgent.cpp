@@ -6,6 +6,10 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
 #include "FileTransferAgent.hpp"
 #include "snowflake/SnowflakeTransferException.hpp"
 #include "snowflake/IStatementPutGet.hpp"
@@ -19,6 +23,7 @@
 #include "EncryptionProvider.hpp"
 #include "logger/SFLogger.hpp"
 #include "snowflake/platform.h"
+#include <tracing.h>
 #include <chrono>
 #ifdef _WIN32
 #include <windows.h>
@@ -33,6 +38,237 @@ namespace
 {
   const std::string FILE_PROTOCOL = "file://";
 
+  /**
+   * Span of a phase of a transfer, ended with an error unless the phase
+   * succeeded, also when it throws
+   */
+  class TransferSpan
+  {
+  public:
+    TransferSpan(const char *name, const SF_TRACE_CONTEXT *parent) :
+      m_status(SF_STATUS_ERROR_GENERAL)
+    {
+      sf_span_start_child(&m_span, name, parent, 0);
+    }
+
+    ~TransferSpan()
+    {
+      sf_span_end(&m_span, m_status);
+    }
+
+    void succeed(int64 bytes)
+    {
+      m_span.bytes = bytes;
+      m_status = SF_STATUS_SUCCESS;
+    }
+
+  private:
+    SF_TRACE_SPAN m_span;
+    SF_STATUS m_status;
+  };
+
+  /**
+   * Holds a mutex for a scope, released also when the scope throws
+   */
+  class MutexGuard
+  {
+  public:
+    explicit MutexGuard(SF_MUTEX_HANDLE *mutex) : m_mutex(mutex)
+    {
+      _mutex_lock(m_mutex);
+    }
+
+    ~MutexGuard()
+    {
+      _mutex_unlock(m_mutex);
+    }
+
+  private:
+    SF_MUTEX_HANDLE *m_mutex;
+  };
+
+  /**
+   * Fetches the presigned URLs of the files in order on a thread of its own,
+   * so that the first files upload while the URLs of the others are fetched
+   * rather than after the round trips of all of them
+   */
+  class PresignedUrlPrefetcher
+  {
+  public:
+    PresignedUrlPrefetcher(size_t count, std::function<void(size_t)> fetch) :
+      m_fetched(0), m_stopped(false)
+    {
+      m_thread = std::thread([this, count, fetch]() {
+        for (size_t i = 0; i < count; i++)
+        {
+          try
+          {
+            fetch(i);
+          }
+          catch (...)
+          {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_error = std::current_exception();
+            m_ready.notify_all();
+            return;
+          }
+          std::lock_guard<std::mutex> guard(m_mutex);
+          m_fetched = i + 1;
+          m_ready.notify_all();
+          if (m_stopped)
+          {
+            return;
+          }
+        }
+      });
+    }
+
+    ~PresignedUrlPrefetcher()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+      }
+      m_thread.join();
+    }
+
+    /**
+     * Waits for the URL of a file, rethrows the error of the fetch that
+     * failed if it wasn't fetched
+     */
+    void wait(size_t index)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_ready.wait(lock, [this, index]() { return m_fetched > index || m_error; });
+      if (m_fetched <= index)
+      {
+        std::rethrow_exception(m_error);
+      }
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    size_t m_fetched;
+    bool m_stopped;
+    std::exception_ptr m_error;
+    std::thread m_thread;
+  };
+
+  /**
+   * Renews the credentials of the stage on a thread of its own every
+   * interval while the files transfer, so that the transfers don't find them
+   * expired, until a renewal can't be taken by the storage client in place.
+   * The renewal must not throw.
+   */
+  class CredentialRefresher
+  {
+  public:
+    CredentialRefresher(unsigned int intervalSec, std::function<bool()> refresh) :
+      m_stopped(false)
+    {
+      m_thread = std::thread([this, intervalSec, refresh]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wakeup.wait_for(lock, std::chrono::seconds(intervalSec),
+                                  [this]() { return m_stopped; }))
+        {
+          lock.unlock();
+          bool renewed = refresh();
+          lock.lock();
+          if (!renewed)
+          {
+            return;
+          }
+        }
+      });
+    }
+
+    ~CredentialRefresher()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+      }
+      m_wakeup.notify_all();
+      m_thread.join();
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stopped;
+    std::thread m_thread;
+  };
+
+  /**
+   * Runs a command of a transfer agent on a thread of its own
+   */
+  class TransferHandle : public Snowflake::Client::ITransferHandle
+  {
+  public:
+    TransferHandle(Snowflake::Client::FileTransferAgent *agent, std::string *command) :
+      m_agent(agent),
+      m_result(nullptr),
+      m_done(false)
+    {
+      m_thread = std::thread([this, command]() {
+        try
+        {
+          m_result = m_agent->execute(command);
+        }
+        catch (...)
+        {
+          m_exception = std::current_exception();
+        }
+        m_agent->endAsync();
+        m_done = true;
+      });
+    }
+
+    ~TransferHandle()
+    {
+      if (m_thread.joinable())
+      {
+        m_thread.join();
+      }
+    }
+
+    virtual Snowflake::Client::ITransferResult *wait()
+    {
+      if (m_thread.joinable())
+      {
+        m_thread.join();
+      }
+      if (m_exception)
+      {
+        std::rethrow_exception(m_exception);
+      }
+      return m_result;
+    }
+
+    virtual bool isDone()
+    {
+      return m_done;
+    }
+
+    virtual void getProgress(size_t &completedFiles, size_t &totalFiles)
+    {
+      m_agent->getProgress(completedFiles, totalFiles);
+    }
+
+    virtual void cancel()
+    {
+      m_agent->cancel();
+    }
+
+  private:
+    Snowflake::Client::FileTransferAgent *m_agent;
+    Snowflake::Client::ITransferResult *m_result;
+    std::exception_ptr m_exception;
+    std::atomic<bool> m_done;
+    std::thread m_thread;
+  };
+
   void replaceStrAll(std::string& stringToReplace,
                   std::string const& oldValue,
                   std::string const& newValue)
@@ -57,6 +293,51 @@ namespace
       index += newValueLen;
     }
   }
+
+  /**
+   * Write the source files one after another into a file, with a line
+   * break after a file that doesn't end with one
+   */
+  void concatenateFiles(const std::vector<std::string> &srcFiles,
+                        const std::string &destFileName)
+  {
+    FILE *destFile = fopen(destFileName.c_str(), "wb");
+    if (!destFile)
+    {
+      throw Snowflake::Client::SnowflakeTransferException(
+        Snowflake::Client::TransferError::FILE_OPEN_ERROR, destFileName.c_str(), -1);
+    }
+
+    std::vector<char> buf(64 * 1024);
+    for (size_t i = 0; i < srcFiles.size(); i++)
+    {
+      FILE *srcFile = fopen(srcFiles[i].c_str(), "rb");
+      if (!srcFile)
+      {
+        fclose(destFile);
+        throw Snowflake::Client::SnowflakeTransferException(
+          Snowflake::Client::TransferError::FILE_OPEN_ERROR, srcFiles[i].c_str(), -1);
+      }
+      char last = '\n';
+      size_t len;
+      while ((len = fread(buf.data(), 1, buf.size(), srcFile)) > 0)
+      {
+        fwrite(buf.data(), 1, len, destFile);
+        last = buf[len - 1];
+      }
+      fclose(srcFile);
+      if (last != '\n')
+      {
+        fputc('\n', destFile);
+      }
+    }
+
+    if (fclose(destFile))
+    {
+      throw Snowflake::Client::SnowflakeTransferException(
+        Snowflake::Client::TransferError::FILE_OPEN_ERROR, destFileName.c_str(), -1);
+    }
+  }
 }
 
 Snowflake::Client::FileTransferAgent::FileTransferAgent(
@@ -70,17 +351,26 @@ Snowflake::Client::FileTransferAgent::FileTransferAgent(
   m_transferConfig(transferConfig),
   m_uploadStream(nullptr),
   m_uploadStreamSize(0),
+  m_downloadStream(nullptr),
   m_useDevUrand(false),
   m_maxPutRetries(5),
-  m_fastFail(false)
+  m_fastFail(false),
+  m_listener(nullptr),
+  m_cancelled(false),
+  m_completedFiles(0),
+  m_totalFiles(0),
+  m_tunedConcurrency(0),
+  m_tunedCompressionType(nullptr)
 {
   _mutex_init(&m_parallelTokRenewMutex);
+  _mutex_init(&m_parallelFailedMsgMutex);
 }
 
 Snowflake::Client::FileTransferAgent::~FileTransferAgent()
 {
   reset();
   _mutex_term(&m_parallelTokRenewMutex);
+  _mutex_term(&m_parallelFailedMsgMutex);
 }
 
 void Snowflake::Client::FileTransferAgent::reset()
@@ -93,18 +383,86 @@ void Snowflake::Client::FileTransferAgent::reset()
 
   if (m_storageClient != nullptr)
   {
-    delete m_storageClient;
+    // kept for the next command on the same stage
+    m_storageClient->setCheckpoint(nullptr);
+    StorageClientFactory::releaseClient(m_storageClient);
     m_storageClient = nullptr;
   }
 
   m_largeFilesMeta.clear();
   m_smallFilesMeta.clear();
+
+  if (m_digestCache)
+  {
+    m_digestCache->save();
+    m_digestCache.reset();
+  }
+  m_downloadCache.reset();
+
+  m_checkpoint.reset();
+}
+
+Snowflake::Client::ITransferHandle *
+Snowflake::Client::FileTransferAgent::executeAsync(string *command,
+                                                   ITransferListener *listener)
+{
+  m_listener = listener;
+  m_cancelled = false;
+  return new TransferHandle(this, command);
+}
+
+void Snowflake::Client::FileTransferAgent::completeFile(FileMetadata *fileMetadata,
+                                                        size_t resultIndex,
+                                                        bool failed)
+{
+  if (failed)
+  {
+    m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::FAILED,
+                                           resultIndex);
+  }
+  else if (m_executionResults->GetTransferOutCome(resultIndex) ==
+           RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+  {
+    // downloaded again once the token is renewed
+    return;
+  }
+
+  size_t completedFiles = ++m_completedFiles;
+  if (m_listener)
+  {
+    try
+    {
+      m_listener->onFileCompleted(fileMetadata->srcFileName, fileMetadata->destFileName,
+                                  m_executionResults->getStatus(resultIndex),
+                                  completedFiles, m_totalFiles);
+    }
+    catch (...)
+    {
+      CXX_LOG_ERROR("Transfer listener threw on file %s", fileMetadata->srcFileName.c_str());
+    }
+  }
+}
+
+bool Snowflake::Client::FileTransferAgent::skipCancelledFile(FileMetadata *fileMetadata,
+                                                             size_t resultIndex)
+{
+  if (!m_cancelled)
+  {
+    return false;
+  }
+  CXX_LOG_DEBUG("Command cancelled, skipping file %s", fileMetadata->srcFileName.c_str());
+  m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE,
+                                         resultIndex);
+  return true;
 }
 
 Snowflake::Client::ITransferResult *
 Snowflake::Client::FileTransferAgent::execute(string *command)
 {
+  auto commandStart = std::chrono::steady_clock::now();
   reset();
+  m_completedFiles = 0;
+  m_totalFiles = 0;
 
   // first parse command
   if (!m_stmtPutGet->parsePutGetCommand(command, &response))
@@ -113,9 +471,12 @@ Snowflake::Client::FileTransferAgent::execute(string *command)
       "Failed to parse response.");
   }
   CXX_LOG_INFO("Parse response succeed");
+  const SF_TRACE_CONTEXT *trace = m_stmtPutGet->traceContext();
+  std::unique_ptr<TransferSpan> prepareSpan(
+    new TransferSpan("put_get.prepare", trace));
 
   // init storage client
-  m_storageClient = StorageClientFactory::getClient(&response.stageInfo,
+  m_storageClient = StorageClientFactory::acquireClient(&response.stageInfo,
                                                     (unsigned int) response.parallel,
                                                     response.threshold,
                                                     m_transferConfig,
@@ -124,57 +485,164 @@ Snowflake::Client::FileTransferAgent::execute(string *command)
   // init file metadata
   initFileMetadata(command);
   m_storageClient->setMaxRetries(m_maxPutRetries);
+  long long enumerateMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - commandStart).count();
+  int64 totalBytes = 0;
+  for (const FileMetadata &metadata : m_smallFilesMeta)
+  {
+    totalBytes += metadata.srcFileSize;
+  }
+  for (const FileMetadata &metadata : m_largeFilesMeta)
+  {
+    totalBytes += metadata.srcFileSize;
+  }
+  prepareSpan->succeed(totalBytes);
+  prepareSpan.reset();
+
+  // the credentials are renewed while the files transfer, so that transfers
+  // of hours don't stop for them to be renewed once they expire
+  std::unique_ptr<CredentialRefresher> credentialRefresher;
+  unsigned int refreshSec = m_transferConfig ?
+    m_transferConfig->credentialRefreshSec : DEFAULT_CREDENTIAL_REFRESH_SEC;
+  if (refreshSec > 0 && response.stageInfo.stageType != StageType::LOCAL_FS)
+  {
+    credentialRefresher.reset(new CredentialRefresher(refreshSec, [this, command]() {
+      return this->refreshCredentials(command);
+    }));
+  }
 
   switch (response.command)
   {
     case CommandType::UPLOAD: {
+      TransferSpan span("put_get.upload", trace);
       auto putStart = std::chrono::steady_clock::now();
       upload(command);
       auto putEnd = std::chrono::steady_clock::now();
       auto totalTime = std::chrono::duration_cast<std::chrono::milliseconds>(putEnd - putStart).count();
       CXX_LOG_DEBUG("Time took to upload %s: %ld milli seconds.", command->c_str(), totalTime);
+      span.succeed(totalBytes);
       break;
     }
-    case CommandType::DOWNLOAD:
+    case CommandType::DOWNLOAD: {
+      TransferSpan span("put_get.download", trace);
       download(command);
+      // the metadata of the files may only be known once they are downloaded
+      totalBytes = 0;
+      for (const FileMetadata &metadata : m_smallFilesMeta)
+      {
+        totalBytes += metadata.srcFileSize;
+      }
+      for (const FileMetadata &metadata : m_largeFilesMeta)
+      {
+        totalBytes += metadata.srcFileSize;
+      }
+      span.succeed(totalBytes);
       break;
+    }
 
     default:
       throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
         "Invalid command type.");
   }
 
+  m_executionResults->setCommandTimes(enumerateMs,
+    std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - commandStart).count());
   return m_executionResults;
 }
 
 void Snowflake::Client::FileTransferAgent::initFileMetadata(std::string *command)
 {
   m_FileMetadataInitializer.setAutoCompress(response.autoCompress);
+  m_FileMetadataInitializer.setAutoCompressType(getAutoCompressType());
   m_FileMetadataInitializer.setSourceCompression(response.sourceCompression);
   m_FileMetadataInitializer.setEncryptionMaterials(&response.encryptionMaterials);
   m_FileMetadataInitializer.setRandomDev(m_useDevUrand);
+  m_FileMetadataInitializer.setParallel((unsigned int)response.parallel);
+
+  if (m_transferConfig && m_transferConfig->digestCacheFile &&
+      CommandType::UPLOAD == response.command)
+  {
+    m_digestCache.reset(new Util::DigestCache(m_transferConfig->digestCacheFile));
+  }
 
-  // Upload data from stream in memory
-  if ((m_uploadStream) && (CommandType::UPLOAD == response.command))
+  // the level found by the commands before is kept for the same type
+  const FileCompressionType *autoCompressType = getAutoCompressType();
+  if (m_transferConfig && m_transferConfig->adaptiveCompressLevel &&
+      CommandType::UPLOAD == response.command && response.autoCompress &&
+      m_tunedCompressionType != autoCompressType)
   {
-    // Only single file uploading supported, the data must be pre-compressed with gzip
-    if ((response.srcLocations.size() != 1) || response.autoCompress ||
-        sf_strncasecmp(response.sourceCompression, "gzip", sizeof("gzip")))
+    m_compressionTuner.reset(Util::CompressionTuner::create(
+      autoCompressType == &FileCompressionType::ZSTD, m_transferConfig->compressLevel));
+    m_tunedCompressionType = autoCompressType;
+  }
+
+  if (m_transferConfig && m_transferConfig->downloadCacheDir &&
+      CommandType::DOWNLOAD == response.command)
+  {
+    m_downloadCache.reset(new Util::DownloadCache(m_transferConfig->downloadCacheDir));
+  }
+
+  if (m_transferConfig && m_transferConfig->checkpointFile &&
+      CommandType::UPLOAD == response.command)
+  {
+    m_checkpoint.reset(new Util::TransferCheckpoint(m_transferConfig->checkpointFile));
+    m_storageClient->setCheckpoint(m_checkpoint.get());
+  }
+
+  // Upload data from streams in memory
+  if ((m_uploadStream || !m_uploadStreams.empty()) &&
+      (CommandType::UPLOAD == response.command))
+  {
+    // a single stream replaces a single file
+    if (m_uploadStream && response.srcLocations.size() != 1)
     {
       CXX_LOG_FATAL(CXX_LOG_NS, "Invalid stream uploading.");
       throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
         "Invalid stream uploading.");
     }
 
-    FileMetadata fileMeta;
-    fileMeta.srcFileName = response.srcLocations.at(0);
-    fileMeta.srcFileSize = m_uploadStreamSize;
-    fileMeta.destFileName = fileMeta.srcFileName;
-    fileMeta.sourceCompression = &FileCompressionType::GZIP;
-    fileMeta.requireCompress = false;
-    fileMeta.targetCompression = &FileCompressionType::GZIP;
-    m_largeFilesMeta.push_back(fileMeta);
+    if (m_uploadStream)
+    {
+      FileMetadata fileMeta;
+      fileMeta.srcFileName = response.srcLocations.at(0);
+      fileMeta.srcFileSize = m_uploadStreamSize;
+      fileMeta.destFileName = fileMeta.srcFileName;
+      fileMeta.srcStream = m_uploadStream;
+      initStreamCompression(fileMeta);
+      m_largeFilesMeta.push_back(fileMeta);
+      return;
+    }
+
+    for (size_t i = 0; i < m_uploadStreams.size(); i++)
+    {
+      const UploadStream &uploadStream = m_uploadStreams[i];
+      if (!uploadStream.stream || uploadStream.name.empty())
+      {
+        throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
+          "Invalid stream uploading.");
+      }
+      std::vector<FileMetadata> &filesMeta =
+        uploadStream.size > response.threshold ? m_largeFilesMeta : m_smallFilesMeta;
+      filesMeta.emplace_back();
+      FileMetadata &fileMeta = filesMeta.back();
+      fileMeta.srcFileName = uploadStream.name;
+      fileMeta.srcFileSize = (long)uploadStream.size;
+      fileMeta.destFileName = uploadStream.name;
+      fileMeta.srcStream = uploadStream.stream;
+      initStreamCompression(fileMeta);
+      // the digest given is of the data before it is compressed
+      if (!fileMeta.requireCompress)
+      {
+        fileMeta.sha256Digest = uploadStream.digest;
+      }
+    }
+    return;
+  }
 
+  if (looksUpDownloadMetadataInParallel())
+  {
+    // looked up while the files download, see downloadWithMetadataLookups()
     return;
   }
 
@@ -212,16 +680,125 @@ void Snowflake::Client::FileTransferAgent::initFileMetadata(std::string *command
                                          "Invalid command type.");
     }
   }
+
+  if (CommandType::UPLOAD == response.command)
+  {
+    coalesceSmallFiles();
+  }
+}
+
+void Snowflake::Client::FileTransferAgent::initStreamCompression(FileMetadata &fileMeta)
+{
+  bool gzip = !sf_strncasecmp(response.sourceCompression, "gzip", sizeof("gzip"));
+  bool none = !sf_strncasecmp(response.sourceCompression, "none", sizeof("none"));
+  if (!gzip && !none)
+  {
+    if (sf_strncasecmp(response.sourceCompression, "auto_detect", sizeof("auto_detect")) &&
+        sf_strncasecmp(response.sourceCompression, "auto", sizeof("auto")))
+    {
+      CXX_LOG_FATAL(CXX_LOG_NS, "Invalid stream uploading.");
+      throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
+        "Invalid stream uploading.");
+    }
+    // only gzip data is told from the data in memory
+    char magic[2] = {0, 0};
+    fileMeta.srcStream->read(magic, sizeof(magic));
+    fileMeta.srcStream->clear();
+    fileMeta.srcStream->seekg(0, std::ios::beg);
+    gzip = magic[0] == '\x1f' && magic[1] == '\x8b';
+  }
+
+  if (gzip)
+  {
+    fileMeta.sourceCompression = &FileCompressionType::GZIP;
+    fileMeta.targetCompression = &FileCompressionType::GZIP;
+    fileMeta.requireCompress = false;
+    return;
+  }
+
+  // compressed as it is uploaded, see compressSourceStream()
+  fileMeta.sourceCompression = &FileCompressionType::NONE;
+  fileMeta.requireCompress = response.autoCompress;
+  fileMeta.targetCompression = response.autoCompress ?
+    getAutoCompressType() : &FileCompressionType::NONE;
+  if (response.autoCompress)
+  {
+    fileMeta.destFileName += fileMeta.targetCompression->getFileExtension();
+  }
+}
+
+void Snowflake::Client::FileTransferAgent::coalesceSmallFiles()
+{
+  size_t targetSize = m_transferConfig ? m_transferConfig->coalesceTargetSize : 0;
+  if (targetSize == 0)
+  {
+    return;
+  }
+
+  // only files compressed by the upload are text that can be packed, each
+  // taking one more byte for a line break
+  std::vector<FileMetadata> filesMeta;
+  std::vector<size_t> batch;
+  size_t batchSize = 0;
+  int batches = 0;
+  auto flushBatch = [&]()
+  {
+    if (batch.size() == 1)
+    {
+      filesMeta.push_back(m_smallFilesMeta[batch[0]]);
+    }
+    else if (batch.size() > 1)
+    {
+      filesMeta.push_back(m_smallFilesMeta[batch[0]]);
+      FileMetadata &packed = filesMeta.back();
+      packed.destFileName = "coalesced_" + std::to_string(batches++) + "_" +
+        packed.destFileName;
+      packed.srcFileSize = (long)batchSize;
+      for (size_t i = 0; i < batch.size(); i++)
+      {
+        packed.coalescedFiles.push_back(m_smallFilesMeta[batch[i]].srcFileName);
+      }
+    }
+    batch.clear();
+    batchSize = 0;
+  };
+
+  for (size_t i = 0; i < m_smallFilesMeta.size(); i++)
+  {
+    size_t fileSize = (size_t)m_smallFilesMeta[i].srcFileSize + 1;
+    if (!m_smallFilesMeta[i].requireCompress || fileSize > targetSize)
+    {
+      filesMeta.push_back(m_smallFilesMeta[i]);
+      continue;
+    }
+    if (batchSize + fileSize > targetSize)
+    {
+      flushBatch();
+    }
+    batch.push_back(i);
+    batchSize += fileSize;
+  }
+  flushBatch();
+
+  CXX_LOG_DEBUG("Coalesced %zu small files into %zu objects",
+                m_smallFilesMeta.size(), filesMeta.size());
+  m_smallFilesMeta.swap(filesMeta);
 }
 
 void Snowflake::Client::FileTransferAgent::upload(string *command)
 {
 	//If source file does not exist then we need at least one m_executionResults.m_outcomes to save the outcome.
   int numFiles = m_largeFilesMeta.size() + m_smallFilesMeta.size();
+  m_totalFiles = (size_t)numFiles;
   numFiles = (numFiles > 0) ? numFiles : 1;
   m_executionResults = new FileTransferExecutionResult(CommandType::UPLOAD, numFiles);
 
-  if (m_largeFilesMeta.size() > 0)
+  if (m_largeFilesMeta.size() > 1 && response.parallel > 1 &&
+      m_storageClient->supportsConcurrentMultiPartUpload())
+  {
+    uploadLargeFilesConcurrently(command);
+  }
+  else if (m_largeFilesMeta.size() > 0)
   {
     for (size_t i=0; i<m_largeFilesMeta.size(); i++)
     {
@@ -230,6 +807,7 @@ void Snowflake::Client::FileTransferAgent::upload(string *command)
 
       if (m_storageClient->requirePresignedUrl())
       {
+        MutexGuard guard(&m_parallelTokRenewMutex);
         getPresignedUrlForUploading(m_largeFilesMeta[i], *command);
       }
       CXX_LOG_DEBUG("Putget serial large file upload, %s file", m_largeFilesMeta[i].srcFileName.c_str());
@@ -240,7 +818,10 @@ void Snowflake::Client::FileTransferAgent::upload(string *command)
       if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
       {
         CXX_LOG_DEBUG("Putget serial large file upload, %s file renewToken", m_largeFilesMeta[i].srcFileName.c_str());
-        renewToken(command);
+        {
+          MutexGuard guard(&m_parallelTokRenewMutex);
+          renewToken(command);
+        }
         i--;
       }
       else if( outcome == RemoteStorageRequestOutcome::FAILED)
@@ -259,14 +840,6 @@ void Snowflake::Client::FileTransferAgent::upload(string *command)
 
   if (m_smallFilesMeta.size() > 0)
   {
-    if (m_storageClient->requirePresignedUrl())
-    {
-      for (size_t i = 0; i < m_smallFilesMeta.size(); i++)
-      {
-        std::string localCommand = *command;
-        getPresignedUrlForUploading(m_smallFilesMeta[i], localCommand);
-      }
-    }
     uploadFilesInParallel(command);
   }
   if( m_largeFilesMeta.size() + m_smallFilesMeta.size() == 0)
@@ -277,42 +850,160 @@ void Snowflake::Client::FileTransferAgent::upload(string *command)
   }
 }
 
-void Snowflake::Client::FileTransferAgent::uploadFilesInParallel(std::string *command)
+void Snowflake::Client::FileTransferAgent::uploadLargeFilesConcurrently(std::string *command)
 {
-  Snowflake::Client::Util::ThreadPool tp((unsigned int)response.parallel);
+  // The parts of all the files share the upload threads of the storage
+  // client, so the next file keeps them busy while the parts of one finish.
+  unsigned int concurrency = (unsigned int)std::min(m_largeFilesMeta.size(),
+                                                    (size_t)response.parallel);
+  Snowflake::Client::Util::ThreadPool tp(concurrency);
   std::string failedTransfers;
-  for (size_t i=0; i<m_smallFilesMeta.size(); i++)
+  for (size_t i=0; i<m_largeFilesMeta.size(); i++)
   {
-    size_t resultIndex = i + m_largeFilesMeta.size();
-    FileMetadata * metadata = &m_smallFilesMeta[i];
-    m_executionResults->SetFileMetadata(&m_smallFilesMeta[i], resultIndex);
+    FileMetadata * metadata = &m_largeFilesMeta[i];
     metadata->overWrite = response.overwrite;
+    m_executionResults->SetFileMetadata(metadata, i);
 
-    // workaround for incident 00212627
-    // Do not use thread pool when parallel = 1
-    if ((unsigned int)response.parallel <= 1)
-    {
-      CXX_LOG_DEBUG("Sequential upload %d th file %s start", i, metadata->srcFileName.c_str());
-      do
-      {
-        RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
-        if(isPutFastFailEnabled() && !failedTransfers.empty())
-        {
-          m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE, resultIndex);
-          CXX_LOG_DEBUG("Sequential upload, put fast fail enabled, Skipping file.");
-          break;
-        }
-        outcome = uploadSingleFile(m_storageClient, metadata, resultIndex);
-        if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
-        {
-          CXX_LOG_DEBUG("Sequential upload %d th file %s renewToken", i, metadata->srcFileName.c_str());
-          _mutex_lock(&m_parallelTokRenewMutex);
-          this->renewToken(command);
-          _mutex_unlock(&m_parallelTokRenewMutex);
-        }
-        else
+    tp.AddJob([metadata, i, command, &failedTransfers, this]()->void {
+        do
         {
-          if (outcome == RemoteStorageRequestOutcome::FAILED) {
+          RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
+          CXX_LOG_DEBUG("Putget concurrent large file upload, %s file", metadata->srcFileName.c_str());
+          try
+          {
+            outcome = uploadSingleFile(m_storageClient, metadata, i);
+          }
+          catch (...)
+          {
+            outcome = RemoteStorageRequestOutcome::FAILED;
+          }
+          m_executionResults->SetTransferOutCome(outcome, i);
+
+          if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+          {
+            CXX_LOG_DEBUG("Putget concurrent large file upload, %s file renewToken", metadata->srcFileName.c_str());
+            _mutex_lock(&m_parallelTokRenewMutex);
+            this->renewToken(command);
+            _mutex_unlock(&m_parallelTokRenewMutex);
+            continue;
+          }
+          if (outcome == RemoteStorageRequestOutcome::FAILED)
+          {
+            CXX_LOG_DEBUG("Putget concurrent large file upload, %s file upload FAILED.",
+                          metadata->srcFileName.c_str());
+            _mutex_lock(&m_parallelFailedMsgMutex);
+            failedTransfers.append(metadata->srcFileName + ", ");
+            _mutex_unlock(&m_parallelFailedMsgMutex);
+          }
+          else if (outcome == RemoteStorageRequestOutcome::SUCCESS)
+          {
+            CXX_LOG_DEBUG("Putget concurrent large file upload, %s file upload SUCCESS.",
+                          metadata->srcFileName.c_str());
+          }
+          break;
+        } while (true);
+    });
+  }
+
+  tp.WaitAll();
+  if (!failedTransfers.empty())
+  {
+    throw SnowflakeTransferException(TransferError::FAILED_TO_TRANSFER, failedTransfers.c_str());
+  }
+}
+
+bool Snowflake::Client::FileTransferAgent::shouldMapSourceFile(
+  FileMetadata *fileMetadata)
+{
+  return !fileMetadata->srcStream && m_transferConfig &&
+    m_transferConfig->mapSourceFiles &&
+    fileMetadata->srcFileToUploadSize > response.threshold;
+}
+
+size_t Snowflake::Client::FileTransferAgent::getAsyncIoBufferSize()
+{
+  return m_transferConfig ? m_transferConfig->asyncIoBufferSize : 0;
+}
+
+Snowflake::Client::Util::ConcurrencyTuner *
+Snowflake::Client::FileTransferAgent::createConcurrencyTuner()
+{
+  unsigned int parallel = (unsigned int)response.parallel;
+  if (!m_transferConfig || m_transferConfig->maxConcurrency <= parallel || parallel <= 1)
+  {
+    return nullptr;
+  }
+
+  // the next command starts where the last one ended up
+  unsigned int initial = m_tunedConcurrency > 0 ? m_tunedConcurrency : parallel;
+  CXX_LOG_DEBUG("Tuning concurrency from %u, at most %u", initial,
+                m_transferConfig->maxConcurrency);
+  return new Util::ConcurrencyTuner(initial, m_transferConfig->maxConcurrency);
+}
+
+void Snowflake::Client::FileTransferAgent::uploadFilesInParallel(std::string *command)
+{
+  // the threads beyond the tuned concurrency wait for their turn
+  std::unique_ptr<Util::ConcurrencyTuner> tuner(createConcurrencyTuner());
+  // the statement runs one command at a time, the token renewals included
+  std::unique_ptr<PresignedUrlPrefetcher> presignedUrls;
+  if (m_storageClient->requirePresignedUrl())
+  {
+    presignedUrls.reset(new PresignedUrlPrefetcher(m_smallFilesMeta.size(),
+      [command, this](size_t i) {
+        _mutex_lock(&m_parallelTokRenewMutex);
+        try
+        {
+          getPresignedUrlForUploading(m_smallFilesMeta[i], *command);
+        }
+        catch (...)
+        {
+          _mutex_unlock(&m_parallelTokRenewMutex);
+          throw;
+        }
+        _mutex_unlock(&m_parallelTokRenewMutex);
+      }));
+  }
+  Snowflake::Client::Util::ThreadPool tp(tuner ? m_transferConfig->maxConcurrency :
+                                         (unsigned int)response.parallel);
+  std::string failedTransfers;
+  for (size_t i=0; i<m_smallFilesMeta.size(); i++)
+  {
+    size_t resultIndex = i + m_largeFilesMeta.size();
+    FileMetadata * metadata = &m_smallFilesMeta[i];
+    m_executionResults->SetFileMetadata(&m_smallFilesMeta[i], resultIndex);
+    metadata->overWrite = response.overwrite;
+
+    // workaround for incident 00212627
+    // Do not use thread pool when parallel = 1
+    if ((unsigned int)response.parallel <= 1)
+    {
+      CXX_LOG_DEBUG("Sequential upload %d th file %s start", i, metadata->srcFileName.c_str());
+      if (presignedUrls)
+      {
+        presignedUrls->wait(i);
+      }
+      do
+      {
+        RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
+        if(isPutFastFailEnabled() && !failedTransfers.empty())
+        {
+          m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE, resultIndex);
+          CXX_LOG_DEBUG("Sequential upload, put fast fail enabled, Skipping file.");
+          completeFile(metadata, resultIndex, false);
+          break;
+        }
+        outcome = uploadSingleFile(m_storageClient, metadata, resultIndex);
+        if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+        {
+          CXX_LOG_DEBUG("Sequential upload %d th file %s renewToken", i, metadata->srcFileName.c_str());
+          _mutex_lock(&m_parallelTokRenewMutex);
+          this->renewToken(command);
+          _mutex_unlock(&m_parallelTokRenewMutex);
+        }
+        else
+        {
+          if (outcome == RemoteStorageRequestOutcome::FAILED) {
             CXX_LOG_DEBUG("Sequential upload %s FAILED.", metadata->srcFileName.c_str());
             failedTransfers.append(metadata->srcFileName) + ", ";
             //Fast fail, return when the first file fails to upload.
@@ -331,7 +1022,14 @@ void Snowflake::Client::FileTransferAgent::uploadFilesInParallel(std::string *co
       continue;
     }
 
-    tp.AddJob([metadata, resultIndex, command, &failedTransfers, this]()->void {
+    Util::ConcurrencyTuner *uploadTuner = tuner.get();
+    PresignedUrlPrefetcher *urls = presignedUrls.get();
+    tp.AddJob([metadata, i, resultIndex, command, &failedTransfers, uploadTuner, urls,
+               this]()->void {
+        if (uploadTuner)
+        {
+          uploadTuner->acquire();
+        }
         do
         {
           RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
@@ -341,17 +1039,22 @@ void Snowflake::Client::FileTransferAgent::uploadFilesInParallel(std::string *co
               CXX_LOG_DEBUG("Fast fail enabled, One of the threads failed to upload file, "
                             "Quit uploading rest of the files.");
               m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE, resultIndex);
+              completeFile(metadata, resultIndex, false);
               break;
           }
           // SNOW-218025: Upload and download is not exception safe, catch exception
           // and take it as transfer failure.
           try
           {
+            if (urls)
+            {
+              urls->wait(i);
+            }
             outcome = uploadSingleFile(m_storageClient, metadata,
                                                        resultIndex);
             if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
             {
-              CXX_LOG_DEBUG("Token expired, Renewing token.")
+              CXX_LOG_DEBUG("Token expired, Renewing token.");
               _mutex_lock(&m_parallelTokRenewMutex);
               this->renewToken(command);
               _mutex_unlock(&m_parallelTokRenewMutex);
@@ -377,11 +1080,20 @@ void Snowflake::Client::FileTransferAgent::uploadFilesInParallel(std::string *co
           }
           break;
         } while (true);
+        if (uploadTuner)
+        {
+          uploadTuner->release(metadata->destFileSize,
+                               m_storageClient->getThrottledRequests());
+        }
     });
   }
 
   // wait till all jobs have been finished
   tp.WaitAll();
+  if (tuner)
+  {
+    m_tunedConcurrency = tuner->getLimit();
+  }
   CXX_LOG_DEBUG("All threads exited, Parallel put done.");
   if(!failedTransfers.empty())
   {
@@ -414,50 +1126,193 @@ void Snowflake::Client::FileTransferAgent::renewToken(std::string *command)
       throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
                                        "Failed to parse response.");
     }
-    m_storageClient = StorageClientFactory::getClient(&response.stageInfo,
-                                                      (unsigned int) response.parallel,
-                                                      response.threshold,
-                                                      m_transferConfig);
+    // the connections and threads of the client are kept if it can take
+    // the new credentials in place
+    if (!m_storageClient->updateStageInfo(&response.stageInfo))
+    {
+      m_storageClient = StorageClientFactory::getClient(&response.stageInfo,
+                                                        (unsigned int) response.parallel,
+                                                        response.threshold,
+                                                        m_transferConfig);
+      m_storageClient->setCheckpoint(m_checkpoint.get());
+    }
     m_lastRefreshTokenSec = now;
   }
 }
 
+bool Snowflake::Client::FileTransferAgent::refreshCredentials(std::string *command)
+{
+  PutGetParseResponse renewed;
+  bool parsed = false;
+  bool refreshed = false;
+  try
+  {
+    MutexGuard guard(&m_parallelTokRenewMutex);
+    parsed = m_stmtPutGet->parsePutGetCommand(command, &renewed);
+    refreshed = parsed && m_storageClient->refreshCredentials(&renewed.stageInfo);
+    if (refreshed)
+    {
+      // the requests failing on the old credentials meanwhile just retry
+      m_lastRefreshTokenSec = (long)time(NULL);
+    }
+  }
+  catch (std::exception &e)
+  {
+    CXX_LOG_WARN("Failed to renew the stage credentials: %s", e.what());
+  }
+
+  if (!parsed)
+  {
+    // tried again after another interval
+    CXX_LOG_WARN("Failed to renew the stage credentials in the background");
+    return true;
+  }
+  if (refreshed)
+  {
+    CXX_LOG_INFO("Stage credentials renewed in the background");
+  }
+  else
+  {
+    CXX_LOG_DEBUG("Storage client can't take renewed credentials in place");
+  }
+  return refreshed;
+}
+
 RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::uploadSingleFile(
   IStorageClient *client,
   FileMetadata *fileMetadata,
   size_t resultIndex)
 {
+  FileCompletion completion(this, fileMetadata, resultIndex);
+  if (skipCancelledFile(fileMetadata, resultIndex))
+  {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+
   // compress if required
   CXX_LOG_DEBUG("Entrance uploadSingleFile");
+  fileMetadata->compressLevel = getCompressLevel(fileMetadata);
+  Util::DigestCache::Entry cached;
+  bool cacheHit = m_digestCache && !fileMetadata->srcStream &&
+    fileMetadata->coalescedFiles.empty() &&
+    m_digestCache->lookup(fileMetadata->srcFileName, getDigestCacheKey(fileMetadata), cached);
+
+  // an unchanged file already on the stage doesn't need to be compressed
+  if (cacheHit && fileMetadata->requireCompress && !fileMetadata->overWrite &&
+      client->checkFileExists(fileMetadata) == RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE)
+  {
+    CXX_LOG_DEBUG("File %s is unchanged and on the stage, skip compression",
+                  fileMetadata->srcFileName.c_str());
+    fileMetadata->sha256Digest = cached.digest;
+    fileMetadata->srcFileToUploadSize = cached.compressedSize;
+    fileMetadata->metrics.rawBytes = fileMetadata->srcFileSize;
+    fileMetadata->metrics.compressedBytes = fileMetadata->srcFileToUploadSize;
+    m_FileMetadataInitializer.initEncryptionMetadata(fileMetadata);
+    m_executionResults->SetTransferOutCome(RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE,
+                                           resultIndex);
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+
   if (fileMetadata->requireCompress)
   {
+    // the digest is calculated while compressing
     fileMetadata->recordPutGetTimestamp(FileMetadata::COMP_START);
-    compressSourceFile(fileMetadata);
+    if (fileMetadata->srcStream)
+    {
+      compressSourceStream(fileMetadata);
+    }
+    else
+    {
+      compressSourceFile(fileMetadata);
+    }
     fileMetadata->recordPutGetTimestamp(FileMetadata::COMP_END);
+    fileMetadata->metrics.compressMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      fileMetadata->tstamps[FileMetadata::COMP_END] -
+      fileMetadata->tstamps[FileMetadata::COMP_START]).count();
   } else
   {
     fileMetadata->srcFileToUpload = fileMetadata->srcFileName;
     fileMetadata->srcFileToUploadSize = fileMetadata->srcFileSize;
+    CXX_LOG_TRACE("Update File digest metadata start");
+
+    // calculate digest, unless given with the stream or cached
+    if (cacheHit)
+    {
+      fileMetadata->sha256Digest = cached.digest;
+    }
+    else if (!fileMetadata->srcStream || fileMetadata->sha256Digest.empty())
+    {
+      auto hashStart = std::chrono::steady_clock::now();
+      updateFileDigest(fileMetadata);
+      fileMetadata->metrics.hashMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hashStart).count();
+    }
   }
-  CXX_LOG_TRACE("Update File digest metadata start");
 
-  // calculate digest
-  updateFileDigest(fileMetadata);
+  // the status of the file is empty if it couldn't be found
+  if (m_digestCache && !fileMetadata->srcStream && !cacheHit && !cached.compression.empty())
+  {
+    cached.digest = fileMetadata->sha256Digest;
+    cached.compressedSize = fileMetadata->srcFileToUploadSize;
+    m_digestCache->update(fileMetadata->srcFileName, cached);
+  }
   CXX_LOG_TRACE("Encryption metadata init start");
   m_FileMetadataInitializer.initEncryptionMetadata(fileMetadata);
+
+  // an upload of the same data started before goes on with the same file
+  // key and iv, so that the parts already uploaded stay valid
+  Util::TransferCheckpoint::Entry checkpoint;
+  if (m_checkpoint &&
+      m_checkpoint->lookup(response.stageInfo.location + fileMetadata->destFileName,
+                           checkpoint) &&
+      checkpoint.digest == fileMetadata->sha256Digest &&
+      checkpoint.size == fileMetadata->encryptionMetadata.cipherStreamSize &&
+      m_FileMetadataInitializer.restoreEncryptionMetadata(fileMetadata,
+                                                          checkpoint.enKekEncoded,
+                                                          checkpoint.iv,
+                                                          checkpoint.matDesc))
+  {
+    CXX_LOG_INFO("Resuming upload of file %s from checkpoint",
+                 fileMetadata->srcFileName.c_str());
+  }
   CXX_LOG_TRACE("Encryption metadata init done");
 
   RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
   RetryContext putRetryCtx(fileMetadata->srcFileName, m_maxPutRetries);
+  bool firstAttempt = true;
   do
   {
     //Sleeps only when its a retry
     putRetryCtx.waitForNextRetry();
     std::basic_iostream<char> *srcFileStream;
     ::std::fstream fs;
-
-    if (m_uploadStream) {
-      srcFileStream = m_uploadStream;
+    Util::AsyncFileStreamBuf asyncBuf(getAsyncIoBufferSize(), ASYNC_IO_DEPTH);
+    std::basic_iostream<char> asyncFile(&asyncBuf);
+    Util::MappedFile mappedFile;
+    std::unique_ptr<Util::CompressStreamBuf> compressBuf;
+    std::unique_ptr<std::basic_iostream<char>> compressedStream;
+
+    if (fileMetadata->srcStream) {
+      srcFileStream = fileMetadata->srcStream;
+      // a failed attempt may have read part of the stream
+      if (!firstAttempt) {
+        srcFileStream->clear();
+        srcFileStream->seekg(0, std::ios::beg);
+      }
+      if (fileMetadata->requireCompress) {
+        compressBuf.reset(new Util::CompressStreamBuf(
+          srcFileStream->rdbuf(), fileMetadata->targetCompression == &FileCompressionType::ZSTD,
+          fileMetadata->compressLevel));
+        compressedStream.reset(new std::basic_iostream<char>(compressBuf.get()));
+        srcFileStream = compressedStream.get();
+      }
+    } else if (shouldMapSourceFile(fileMetadata) &&
+               mappedFile.open(fileMetadata->srcFileToUpload)) {
+      srcFileStream = nullptr;
+    } else if (getAsyncIoBufferSize() > 0 &&
+               asyncBuf.open(fileMetadata->srcFileToUpload,
+                             Util::AsyncFileStreamBuf::READ)) {
+      srcFileStream = &asyncFile;
     } else {
       try {
         fs = ::std::fstream(fileMetadata->srcFileToUpload.c_str(),
@@ -471,41 +1326,149 @@ RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::uploadSingleFi
       srcFileStream = &fs;
     }
 
-    Crypto::CipherIOStream inputEncryptStream(*srcFileStream,
-                                              Crypto::CryptoOperation::ENCRYPT,
-                                              fileMetadata->encryptionMetadata.fileKey,
-                                              fileMetadata->encryptionMetadata.iv,
-                                              FILE_ENCRYPTION_BLOCK_SIZE);
+    // a mapped file is encrypted straight from memory
+    std::unique_ptr<Crypto::CipherIOStream> inputEncryptStream(srcFileStream ?
+      new Crypto::CipherIOStream(*srcFileStream,
+                                 Crypto::CryptoOperation::ENCRYPT,
+                                 fileMetadata->encryptionMetadata.fileKey,
+                                 fileMetadata->encryptionMetadata.iv,
+                                 FILE_ENCRYPTION_BLOCK_SIZE) :
+      new Crypto::CipherIOStream(mappedFile.data(), mappedFile.size(),
+                                 Crypto::CryptoOperation::ENCRYPT,
+                                 fileMetadata->encryptionMetadata.fileKey,
+                                 fileMetadata->encryptionMetadata.iv,
+                                 FILE_ENCRYPTION_BLOCK_SIZE));
 
     fileMetadata->recordPutGetTimestamp(FileMetadata::PUT_START);
     // upload stream
-    outcome = client->upload(fileMetadata, &inputEncryptStream);
+    outcome = client->upload(fileMetadata, inputEncryptStream.get());
     fileMetadata->recordPutGetTimestamp(FileMetadata::PUT_END);
+    fileMetadata->metrics.transferMs += std::chrono::duration_cast<std::chrono::milliseconds>(
+      fileMetadata->tstamps[FileMetadata::PUT_END] -
+      fileMetadata->tstamps[FileMetadata::PUT_START]).count();
     CXX_LOG_DEBUG("File upload done.");
     if (fs.is_open())
     {
       fs.close();
     }
+    if (asyncBuf.is_open() && !asyncBuf.close() &&
+        outcome == RemoteStorageRequestOutcome::SUCCESS)
+    {
+      // a failed read ends the stream early, so the data uploaded is short
+      CXX_LOG_ERROR("Failed to read file %s",
+                    fileMetadata->srcFileToUpload.c_str());
+      outcome = RemoteStorageRequestOutcome::FAILED;
+    }
+    if (compressBuf && compressBuf->getError() != 0 &&
+        outcome == RemoteStorageRequestOutcome::SUCCESS)
+    {
+      CXX_LOG_ERROR("Failed to compress stream %s. Error code: %d",
+                    fileMetadata->srcFileName.c_str(), compressBuf->getError());
+      outcome = RemoteStorageRequestOutcome::FAILED;
+    }
 
     m_executionResults->SetTransferOutCome(outcome, resultIndex);
     fileMetadata->recordPutGetTimestamp(FileMetadata::PUTGET_END);
     fileMetadata->printPutGetTimestamp();
+    firstAttempt = false;
   } while (putRetryCtx.isRetryable(outcome));
+
+  // the storage client counts the parts and their retries
+  fileMetadata->metrics.retries += putRetryCtx.getRetries();
+  fileMetadata->metrics.parts = std::max(fileMetadata->metrics.parts, 1u);
+  fileMetadata->metrics.rawBytes = fileMetadata->srcFileSize;
+  fileMetadata->metrics.compressedBytes = fileMetadata->srcFileToUploadSize;
+  fileMetadata->metrics.transferredBytes =
+    outcome == RemoteStorageRequestOutcome::SUCCESS ? fileMetadata->destFileSize : 0;
+  if (m_compressionTuner && fileMetadata->requireCompress &&
+      outcome == RemoteStorageRequestOutcome::SUCCESS)
+  {
+    m_compressionTuner->record(fileMetadata->compressLevel,
+                               fileMetadata->metrics.compressMs,
+                               fileMetadata->metrics.transferMs);
+  }
   CXX_LOG_DEBUG("Exit UploadSingleFile");
   return outcome;
 }
 
+void Snowflake::Client::FileTransferAgent::recordDownloadMetrics(
+  FileMetadata *fileMetadata,
+  RemoteStorageRequestOutcome outcome,
+  std::chrono::steady_clock::time_point getStart)
+{
+  // a file downloaded again after a token renewal adds up
+  fileMetadata->metrics.transferMs += std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - getStart).count();
+  fileMetadata->metrics.parts = std::max(fileMetadata->metrics.parts, 1u);
+  if (outcome == RemoteStorageRequestOutcome::SUCCESS)
+  {
+    fileMetadata->metrics.transferredBytes = fileMetadata->srcFileSize;
+  }
+}
+
+int Snowflake::Client::FileTransferAgent::getCompressLevel(FileMetadata *fileMetadata)
+{
+  if (m_compressionTuner && m_transferConfig->adaptiveCompressLevel &&
+      fileMetadata->targetCompression == m_tunedCompressionType)
+  {
+    return m_compressionTuner->getLevel();
+  }
+  return m_transferConfig ? m_transferConfig->compressLevel : -1;
+}
+
+std::string Snowflake::Client::FileTransferAgent::getDigestCacheKey(
+  FileMetadata *fileMetadata)
+{
+  if (!fileMetadata->requireCompress)
+  {
+    return "none";
+  }
+  // the level and the threads compressing a large file change the output
+  int level = fileMetadata->compressLevel;
+  unsigned int threads = 1;
+  if (m_transferConfig && fileMetadata->srcFileSize > COMPRESS_PARALLEL_THRESHOLD)
+  {
+    threads = m_transferConfig->compressThreads;
+  }
+  return std::string(fileMetadata->targetCompression->getName()) + ":" +
+    std::to_string(level) + ":" + std::to_string(threads);
+}
+
 void Snowflake::Client::FileTransferAgent::updateFileDigest(
   FileMetadata *fileMetadata)
 {
   const int CHUNK_SIZE = 16 * 4 * 1024;
 
+  Crypto::HashContext hashContext(Crypto::Cryptor::getInstance()
+                                    .createHashContext(
+                                      Crypto::CryptoHashFunc::SHA256));
+
+  hashContext.initialize();
+
+  Util::MappedFile mappedFile;
+  if (shouldMapSourceFile(fileMetadata) &&
+      mappedFile.open(fileMetadata->srcFileToUpload))
+  {
+    // hash the page cache as it is, without copying it out first
+    hashContext.next(mappedFile.data(), mappedFile.size());
+    setFileDigest(fileMetadata, hashContext);
+    return;
+  }
+
   std::basic_iostream<char> *srcFileStream;
   ::std::fstream fs;
+  Util::AsyncFileStreamBuf asyncBuf(getAsyncIoBufferSize(), ASYNC_IO_DEPTH);
+  std::basic_iostream<char> asyncFile(&asyncBuf);
 
-  if (m_uploadStream)
+  if (fileMetadata->srcStream)
+  {
+    srcFileStream = fileMetadata->srcStream;
+  }
+  else if (getAsyncIoBufferSize() > 0 &&
+           asyncBuf.open(fileMetadata->srcFileToUpload,
+                         Util::AsyncFileStreamBuf::READ))
   {
-    srcFileStream = m_uploadStream;
+    srcFileStream = &asyncFile;
   }
   else
   {
@@ -514,33 +1477,38 @@ void Snowflake::Client::FileTransferAgent::updateFileDigest(
     srcFileStream = &fs;
   }
 
-  Crypto::HashContext hashContext(Crypto::Cryptor::getInstance()
-                                    .createHashContext(
-                                      Crypto::CryptoHashFunc::SHA256));
-
-  const size_t digestSize = Crypto::cryptoHashDigestSize(
-    Crypto::CryptoHashFunc::SHA256);
-  char digest[digestSize];
-
-  hashContext.initialize();
-
+  // the last read is short, so hash what each read returned
   char sourceFileBuffer[CHUNK_SIZE];
-  while (srcFileStream->read(sourceFileBuffer, CHUNK_SIZE))
+  do
   {
-    hashContext.next(sourceFileBuffer, CHUNK_SIZE);
-  }
+    srcFileStream->read(sourceFileBuffer, CHUNK_SIZE);
+    if (srcFileStream->gcount() > 0)
+    {
+      hashContext.next(sourceFileBuffer, (size_t)srcFileStream->gcount());
+    }
+  } while (*srcFileStream);
 
   if (fs.is_open())
   {
     fs.close();
   }
   
-  if (m_uploadStream)
+  if (fileMetadata->srcStream)
   {
-    m_uploadStream->clear();
-    m_uploadStream->seekg(0, std::ios::beg);
+    fileMetadata->srcStream->clear();
+    fileMetadata->srcStream->seekg(0, std::ios::beg);
   }
 
+  setFileDigest(fileMetadata, hashContext);
+}
+
+void Snowflake::Client::FileTransferAgent::setFileDigest(
+  FileMetadata *fileMetadata, Crypto::HashContext &hashContext)
+{
+  const size_t digestSize = Crypto::cryptoHashDigestSize(
+    Crypto::CryptoHashFunc::SHA256);
+  char digest[digestSize];
+
   hashContext.finalize(digest);
 
   const size_t digestEncodeSize = Util::Base64::encodedLength(digestSize);
@@ -550,16 +1518,57 @@ void Snowflake::Client::FileTransferAgent::updateFileDigest(
   fileMetadata->sha256Digest = string(digestEncode, digestEncodeSize);
 }
 
+void Snowflake::Client::FileTransferAgent::compressSourceStream(
+  FileMetadata *fileMetadata)
+{
+  CXX_LOG_DEBUG("Starting stream compression");
+
+  // the size and digest of the compressed data go with the start of the
+  // upload, so the stream is compressed once for them here and again as it
+  // is uploaded, instead of into a buffer of its own
+  std::basic_iostream<char> *stream = fileMetadata->srcStream;
+  stream->clear();
+  stream->seekg(0, std::ios::beg);
+  Util::CompressStreamBuf compressBuf(stream->rdbuf(),
+    fileMetadata->targetCompression == &FileCompressionType::ZSTD,
+    fileMetadata->compressLevel);
+
+  Crypto::HashContext hashContext(Crypto::Cryptor::getInstance()
+                                    .createHashContext(
+                                      Crypto::CryptoHashFunc::SHA256));
+  hashContext.initialize();
+  char buffer[16 * 4 * 1024];
+  long compressedSize = 0;
+  std::streamsize len;
+  while ((len = compressBuf.sgetn(buffer, sizeof(buffer))) > 0)
+  {
+    hashContext.next(buffer, (size_t)len);
+    compressedSize += (long)len;
+  }
+  stream->clear();
+  stream->seekg(0, std::ios::beg);
+
+  int ret = compressBuf.getError();
+  if (ret != 0)
+  {
+    CXX_LOG_ERROR("Failed to compress stream. Error code: %d", ret);
+    throw SnowflakeTransferException(TransferError::COMPRESSION_ERROR, "Failed to compress stream", ret);
+  }
+  fileMetadata->srcFileToUploadSize = compressedSize;
+  setFileDigest(fileMetadata, hashContext);
+}
+
 void Snowflake::Client::FileTransferAgent::compressSourceFile(
   FileMetadata *fileMetadata)
 {
   CXX_LOG_DEBUG("Starting file compression");
   
   char tempDir[MAX_PATH]={0};
-  int level = -1;
+  int level = fileMetadata->compressLevel;
+  unsigned int threads = 1;
   if (m_transferConfig)
   {
-    level = m_transferConfig->compressLevel;
+    threads = m_transferConfig->compressThreads;
     if (m_transferConfig->tempDir)
     {
       sb_strcat(tempDir, sizeof(tempDir), m_transferConfig->tempDir);
@@ -570,7 +1579,14 @@ void Snowflake::Client::FileTransferAgent::compressSourceFile(
   stagingFile += fileMetadata->destFileName;
 
   fileMetadata->srcFileToUpload = stagingFile;
-  FILE *sourceFile = fopen(fileMetadata->srcFileName.c_str(), "r");
+  std::string sourceFileName = fileMetadata->srcFileName;
+  if (!fileMetadata->coalescedFiles.empty())
+  {
+    // removed with the staging directory if the compression fails
+    sourceFileName = stagingFile + ".src";
+    concatenateFiles(fileMetadata->coalescedFiles, sourceFileName);
+  }
+  FILE *sourceFile = fopen(sourceFileName.c_str(), "r");
   if( !sourceFile ){
     CXX_LOG_ERROR("Failed to open srcFileName %s. Errno: %d", fileMetadata->srcFileName.c_str(), errno);
     throw SnowflakeTransferException(TransferError::FILE_OPEN_ERROR, fileMetadata->srcFileToUpload.c_str(), -1);
@@ -580,8 +1596,33 @@ void Snowflake::Client::FileTransferAgent::compressSourceFile(
     CXX_LOG_ERROR("Failed to open srcFileToUpload file %s. Errno: %d", fileMetadata->srcFileToUpload.c_str(), errno);
     throw SnowflakeTransferException(TransferError::FILE_OPEN_ERROR, fileMetadata->srcFileToUpload.c_str(), -1);
   }
-  int ret = Util::CompressionUtil::compressWithGzip(sourceFile, destFile,
-                                          fileMetadata->srcFileToUploadSize, level);
+  Crypto::HashContext hashContext(Crypto::Cryptor::getInstance()
+                                    .createHashContext(
+                                      Crypto::CryptoHashFunc::SHA256));
+  hashContext.initialize();
+
+  // the blocks of a small file aren't worth the threads
+  if (fileMetadata->srcFileSize <= COMPRESS_PARALLEL_THRESHOLD)
+  {
+    threads = 1;
+  }
+  auto onOutput = [&hashContext](const char *data, size_t len)
+  {
+    hashContext.next(data, len);
+  };
+  int ret;
+  if (fileMetadata->targetCompression == &FileCompressionType::ZSTD)
+  {
+    ret = Util::CompressionUtil::compressWithZstd(sourceFile, destFile,
+                                                  fileMetadata->srcFileToUploadSize,
+                                                  level, threads, onOutput);
+  }
+  else
+  {
+    ret = Util::CompressionUtil::compressWithGzipParallel(sourceFile, destFile,
+                                                          fileMetadata->srcFileToUploadSize,
+                                                          level, threads, onOutput);
+  }
   if (ret != 0)
   {
     CXX_LOG_ERROR("Failed to compress source file. Error code: %d", ret);
@@ -590,12 +1631,31 @@ void Snowflake::Client::FileTransferAgent::compressSourceFile(
 
   fclose(sourceFile);
   fclose(destFile);
+  if (!fileMetadata->coalescedFiles.empty())
+  {
+    remove(sourceFileName.c_str());
+  }
+
+  setFileDigest(fileMetadata, hashContext);
 }
 
 void Snowflake::Client::FileTransferAgent::download(string *command)
 {
+  if (looksUpDownloadMetadataInParallel())
+  {
+    downloadWithMetadataLookups(command);
+    return;
+  }
+
   m_executionResults = new FileTransferExecutionResult(CommandType::DOWNLOAD,
     m_largeFilesMeta.size() + m_smallFilesMeta.size());
+  m_totalFiles = m_largeFilesMeta.size() + m_smallFilesMeta.size();
+
+  if (m_downloadStream)
+  {
+    downloadToStream(command);
+    return;
+  }
 
   int ret = sf_create_directory_if_not_exists((const char *)response.localLocation);
   if (ret != 0)
@@ -615,6 +1675,7 @@ void Snowflake::Client::FileTransferAgent::download(string *command)
 
       if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
       {
+        MutexGuard guard(&m_parallelTokRenewMutex);
         renewToken(command);
         i--;
       }
@@ -629,7 +1690,10 @@ void Snowflake::Client::FileTransferAgent::download(string *command)
 
 void Snowflake::Client::FileTransferAgent::downloadFilesInParallel(std::string *command)
 {
-  Snowflake::Client::Util::ThreadPool tp((unsigned int)response.parallel);
+  // the threads beyond the tuned concurrency wait for their turn
+  std::unique_ptr<Util::ConcurrencyTuner> tuner(createConcurrencyTuner());
+  Snowflake::Client::Util::ThreadPool tp(tuner ? m_transferConfig->maxConcurrency :
+                                         (unsigned int)response.parallel);
   for (size_t i=0; i<m_smallFilesMeta.size(); i++)
   {
     size_t resultIndex = i + m_largeFilesMeta.size();
@@ -659,38 +1723,188 @@ void Snowflake::Client::FileTransferAgent::downloadFilesInParallel(std::string *
       continue;
     }
 
-    tp.AddJob([metadata, resultIndex, command, this]()->void {
+    Util::ConcurrencyTuner *downloadTuner = tuner.get();
+    tp.AddJob([metadata, resultIndex, command, downloadTuner, this]()->void {
+        downloadFileInJob(metadata, resultIndex, command, downloadTuner);
+    });
+  }
+
+  // wait till all jobs have been finished
+  tp.WaitAll();
+  if (tuner)
+  {
+    m_tunedConcurrency = tuner->getLimit();
+  }
+}
+
+void Snowflake::Client::FileTransferAgent::downloadFileInJob(FileMetadata *metadata,
+                                                             size_t resultIndex,
+                                                             std::string *command,
+                                                             Util::ConcurrencyTuner *tuner)
+{
+  if (tuner)
+  {
+    tuner->acquire();
+  }
+  do
+  {
+    // SNOW-218025: Upload and download is not exception safe, catch exception
+    // and take it as transfer failure.
+    try
+    {
+      RemoteStorageRequestOutcome outcome = downloadSingleFile(m_storageClient, metadata,
+                                                               resultIndex);
+      if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+      {
+        CXX_LOG_DEBUG("Token expired, Renewing token.");
+        _mutex_lock(&m_parallelTokRenewMutex);
+        this->renewToken(command);
+        _mutex_unlock(&m_parallelTokRenewMutex);
+
+        continue;
+      }
+    }
+    catch (...)
+    {
+      m_executionResults->SetTransferOutCome(
+        RemoteStorageRequestOutcome::FAILED, resultIndex);
+    }
+
+    break;
+  } while (true);
+  if (tuner)
+  {
+    tuner->release(metadata->srcFileSize,
+                   m_storageClient->getThrottledRequests());
+  }
+}
+
+bool Snowflake::Client::FileTransferAgent::looksUpDownloadMetadataInParallel()
+{
+  return CommandType::DOWNLOAD == response.command && !m_downloadStream &&
+         (unsigned int)response.parallel > 1 && response.srcLocations.size() > 1;
+}
+
+void Snowflake::Client::FileTransferAgent::downloadWithMetadataLookups(std::string *command)
+{
+  // a slot per source location, kept in place for the results
+  size_t numFiles = response.srcLocations.size();
+  m_smallFilesMeta.resize(numFiles);
+  m_executionResults = new FileTransferExecutionResult(CommandType::DOWNLOAD, numFiles);
+  m_totalFiles = numFiles;
+
+  std::vector<RemoteStorageRequestOutcome> lookups(numFiles,
+                                                   RemoteStorageRequestOutcome::FAILED);
+  std::unique_ptr<Util::ConcurrencyTuner> tuner(createConcurrencyTuner());
+  {
+    Snowflake::Client::Util::ThreadPool tp(tuner ? m_transferConfig->maxConcurrency :
+                                           (unsigned int)response.parallel);
+    Util::ConcurrencyTuner *downloadTuner = tuner.get();
+    for (size_t i = 0; i < numFiles; i++)
+    {
+      FileMetadata *metadata = &m_smallFilesMeta[i];
+      m_executionResults->SetFileMetadata(metadata, i);
+      tp.AddJob([metadata, i, command, downloadTuner, &lookups, this]()->void {
+        RemoteStorageRequestOutcome outcome;
         do
         {
-          // SNOW-218025: Upload and download is not exception safe, catch exception
-          // and take it as transfer failure.
-          try
+          std::string sourceLocation;
+          std::string remoteLocation;
+          std::string presignedUrl;
+          std::unique_ptr<EncryptionMaterial> encMat;
           {
-            RemoteStorageRequestOutcome outcome = downloadSingleFile(m_storageClient, metadata,
-                                                                   resultIndex);
-            if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+            // the response is parsed again when the token is renewed
+            MutexGuard guard(&m_parallelTokRenewMutex);
+            sourceLocation = response.srcLocations.at(i);
+            remoteLocation = response.stageInfo.location;
+            encMat.reset(new EncryptionMaterial(response.encryptionMaterials.at(i)));
+            if (m_storageClient->requirePresignedUrl() && response.presignedUrls.size() > i)
             {
-              CXX_LOG_DEBUG("Token expired, Renewing token.")
-              _mutex_lock(&m_parallelTokRenewMutex);
-              this->renewToken(command);
-              _mutex_unlock(&m_parallelTokRenewMutex);
-
-              continue;
+              presignedUrl = response.presignedUrls.at(i);
             }
           }
+
+          try
+          {
+            outcome = m_FileMetadataInitializer.initDownloadMetadata(
+              sourceLocation, remoteLocation, m_storageClient, encMat.get(), presignedUrl,
+              *metadata);
+          }
           catch (...)
           {
-            m_executionResults->SetTransferOutCome(
-              RemoteStorageRequestOutcome::FAILED, resultIndex);
+            outcome = RemoteStorageRequestOutcome::FAILED;
           }
+          if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+          {
+            CXX_LOG_DEBUG("Token expired when getting download metadata");
+            MutexGuard guard(&m_parallelTokRenewMutex);
+            renewToken(command);
+          }
+        } while (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED);
 
-          break;
-        } while (true);
-    });
+        lookups[i] = outcome;
+        if (outcome != RemoteStorageRequestOutcome::SUCCESS)
+        {
+          // left out of the results, as when looked up before the downloads
+          metadata->srcFileSize = 0;
+          --m_totalFiles;
+          return;
+        }
+
+        // large files are downloaded one at a time once all are known, each
+        // on the threads of the storage client
+        if (metadata->srcFileSize <= DOWNLOAD_DATA_SIZE_THRESHOLD)
+        {
+          downloadFileInJob(metadata, i, command, downloadTuner);
+        }
+      });
+    }
+    tp.WaitAll();
+  }
+  if (tuner)
+  {
+    m_tunedConcurrency = tuner->getLimit();
   }
 
-  // wait till all jobs have been finished
-  tp.WaitAll();
+  for (size_t i = 0; i < numFiles; i++)
+  {
+    if (lookups[i] != RemoteStorageRequestOutcome::SUCCESS ||
+        m_smallFilesMeta[i].srcFileSize <= DOWNLOAD_DATA_SIZE_THRESHOLD)
+    {
+      continue;
+    }
+    RemoteStorageRequestOutcome outcome = downloadSingleFile(m_storageClient,
+                                                             &m_smallFilesMeta[i], i);
+    if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+    {
+      MutexGuard guard(&m_parallelTokRenewMutex);
+      renewToken(command);
+      i--;
+    }
+  }
+
+  size_t found = 0;
+  for (size_t i = 0; i < numFiles; i++)
+  {
+    found += lookups[i] == RemoteStorageRequestOutcome::SUCCESS ? 1 : 0;
+  }
+  if (found == numFiles)
+  {
+    return;
+  }
+  FileTransferExecutionResult *results =
+    new FileTransferExecutionResult(CommandType::DOWNLOAD, found);
+  for (size_t i = 0, j = 0; i < numFiles; i++)
+  {
+    if (lookups[i] == RemoteStorageRequestOutcome::SUCCESS)
+    {
+      results->SetFileMetadata(&m_smallFilesMeta[i], j);
+      results->SetTransferOutCome(m_executionResults->GetTransferOutCome(i), j);
+      j++;
+    }
+  }
+  delete m_executionResults;
+  m_executionResults = results;
 }
 
 RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::downloadSingleFile(
@@ -698,31 +1912,348 @@ RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::downloadSingle
   FileMetadata *fileMetadata,
   size_t resultIndex)
 {
+  FileCompletion completion(this, fileMetadata, resultIndex);
+  if (skipCancelledFile(fileMetadata, resultIndex))
+  {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+
    fileMetadata->destPath = std::string(response.localLocation) + PATH_SEP +
     fileMetadata->destFileName;
 
-  std::basic_fstream<char> dstFile(fileMetadata->destPath.c_str(),
-                                std::ios_base::out | std::ios_base::binary );
-  if( ! dstFile.is_open())
+  std::string cachedPath = m_downloadCache ? m_downloadCache->getCachedPath(
+    fileMetadata->srcFileName, fileMetadata->srcFileSize, fileMetadata->remoteVersion) :
+    std::string();
+  if (m_downloadCache && m_downloadCache->fetch(cachedPath, fileMetadata->destPath))
+  {
+    CXX_LOG_DEBUG("Took %s from the download cache", fileMetadata->srcFileName.c_str());
+    RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
+    if (m_transferConfig->decompressDownloads)
+    {
+      outcome = decompressDownloadedFile(fileMetadata);
+    }
+    m_executionResults->SetTransferOutCome(outcome, resultIndex);
+    return outcome;
+  }
+
+  // the parts the storage client decrypts itself are written as they come,
+  // each at its offset, so there is no point in writing them behind
+  fileMetadata->writeToDestPath = client->decryptsDownload(fileMetadata);
+
+  // a file written in order is decompressed as it is downloaded, the parts
+  // written at their offsets, and the files cached as downloaded, once they
+  // are all there
+  const FileCompressionType *decompressType =
+    fileMetadata->writeToDestPath || !cachedPath.empty() ?
+    nullptr : getDownloadDecompressType(fileMetadata->destFileName);
+  if (decompressType)
+  {
+    fileMetadata->destPath.resize(fileMetadata->destPath.size() -
+                                  strlen(decompressType->getFileExtension()));
+  }
+
+  std::basic_fstream<char> dstFile;
+  Util::AsyncFileStreamBuf asyncBuf(getAsyncIoBufferSize(), ASYNC_IO_DEPTH);
+  std::basic_iostream<char> asyncFile(&asyncBuf);
+  bool async = getAsyncIoBufferSize() > 0 && !fileMetadata->writeToDestPath &&
+               asyncBuf.open(fileMetadata->destPath, Util::AsyncFileStreamBuf::WRITE);
+  if (!async)
+  {
+    dstFile.open(fileMetadata->destPath.c_str(),
+                 std::ios_base::out | std::ios_base::binary);
+  }
+  if (!async && ! dstFile.is_open())
   {
       CXX_LOG_DEBUG("Could not open file to downoad: %s", std::strerror(errno));
   }
 
-  Crypto::CipherIOStream decryptOutputStream(
-                               dstFile,
+  std::basic_iostream<char> &dst = async ? asyncFile : dstFile;
+  std::unique_ptr<Util::DecompressStreamBuf> decompressBuf;
+  std::basic_iostream<char> decompressStream(nullptr);
+  std::basic_iostream<char> *plainDst = &dst;
+  if (decompressType)
+  {
+    decompressBuf.reset(new Util::DecompressStreamBuf(dst.rdbuf(),
+      decompressType == &FileCompressionType::ZSTD, getDecompressThreads()));
+    decompressStream.rdbuf(decompressBuf.get());
+    plainDst = &decompressStream;
+  }
+  std::unique_ptr<Crypto::CipherIOStream> decryptOutputStream;
+  if (!fileMetadata->writeToDestPath)
+  {
+    decryptOutputStream.reset(new Crypto::CipherIOStream(
+                               *plainDst,
                                Crypto::CryptoOperation::DECRYPT,
                                fileMetadata->encryptionMetadata.fileKey,
                                fileMetadata->encryptionMetadata.iv,
-                               FILE_ENCRYPTION_BLOCK_SIZE);
+                               FILE_ENCRYPTION_BLOCK_SIZE));
+  }
 
+  auto getStart = std::chrono::steady_clock::now();
   RemoteStorageRequestOutcome outcome = client->download(fileMetadata,
-                                                         &decryptOutputStream);
-  dstFile.close();
+    decryptOutputStream ? decryptOutputStream.get() : &dst);
+  if (outcome == RemoteStorageRequestOutcome::SUCCESS && decompressBuf)
+  {
+    // finalizes the decryption unless the storage client already flushed
+    decryptOutputStream->flush();
+    int ret = decompressBuf->finish();
+    if (ret != 0)
+    {
+      CXX_LOG_ERROR("Failed to decompress downloaded file %s. Error code: %d",
+                    fileMetadata->srcFileName.c_str(), ret);
+      outcome = RemoteStorageRequestOutcome::FAILED;
+    }
+  }
+  if (async)
+  {
+    // the writes behind are only known to have made it once all are done
+    if (!asyncBuf.close() && outcome == RemoteStorageRequestOutcome::SUCCESS)
+    {
+      CXX_LOG_ERROR("Failed to write downloaded file %s",
+                    fileMetadata->destPath.c_str());
+      outcome = RemoteStorageRequestOutcome::FAILED;
+    }
+  }
+  else
+  {
+    dstFile.close();
+  }
+  recordDownloadMetrics(fileMetadata, outcome, getStart);
+
+  if (decompressBuf && outcome == RemoteStorageRequestOutcome::SUCCESS)
+  {
+    fileMetadata->destFileName.resize(fileMetadata->destFileName.size() -
+                                      strlen(decompressType->getFileExtension()));
+  }
+  else if (decompressBuf)
+  {
+    remove(fileMetadata->destPath.c_str());
+  }
+  else if (outcome == RemoteStorageRequestOutcome::SUCCESS)
+  {
+    if (!cachedPath.empty())
+    {
+      // a failure to cache the file doesn't fail its download
+      m_downloadCache->store(cachedPath, fileMetadata->destPath);
+    }
+    if (m_transferConfig && m_transferConfig->decompressDownloads)
+    {
+      outcome = decompressDownloadedFile(fileMetadata);
+    }
+  }
 
   m_executionResults->SetTransferOutCome(outcome, resultIndex);
   return outcome;
 }
 
+void Snowflake::Client::FileTransferAgent::downloadToStream(string *command)
+{
+  // the files are written in order, so they are downloaded one at a time
+  size_t numFiles = m_largeFilesMeta.size() + m_smallFilesMeta.size();
+  for (size_t i = 0; i < numFiles; i++)
+  {
+    FileMetadata *metadata = i < m_largeFilesMeta.size() ?
+      &m_largeFilesMeta[i] : &m_smallFilesMeta[i - m_largeFilesMeta.size()];
+    m_executionResults->SetFileMetadata(metadata, i);
+    RemoteStorageRequestOutcome outcome = downloadSingleFileToStream(m_storageClient,
+                                                                     metadata, i);
+    if (outcome == RemoteStorageRequestOutcome::TOKEN_EXPIRED)
+    {
+      MutexGuard guard(&m_parallelTokRenewMutex);
+      renewToken(command);
+      i--;
+    }
+  }
+}
+
+RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::downloadSingleFileToStream(
+  IStorageClient *client,
+  FileMetadata *fileMetadata,
+  size_t resultIndex)
+{
+  FileCompletion completion(this, fileMetadata, resultIndex);
+  if (skipCancelledFile(fileMetadata, resultIndex))
+  {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+
+  fileMetadata->destPath = fileMetadata->destFileName;
+
+  // decompress files named after their compression, as for the local files
+  const FileCompressionType *type = getDownloadDecompressType(fileMetadata->destFileName);
+
+  std::unique_ptr<Util::DecompressStreamBuf> decompressBuf;
+  std::basic_streambuf<char> *plainBuf = m_downloadStream->rdbuf();
+  if (type)
+  {
+    decompressBuf.reset(new Util::DecompressStreamBuf(plainBuf,
+      type == &FileCompressionType::ZSTD, getDecompressThreads()));
+    plainBuf = decompressBuf.get();
+  }
+  std::basic_iostream<char> plainStream(plainBuf);
+
+  RemoteStorageRequestOutcome outcome;
+  {
+    std::unique_ptr<Crypto::CipherIOStream> decryptOutputStream;
+    std::basic_iostream<char> *dst = &plainStream;
+    if (!client->decryptsDownload(fileMetadata))
+    {
+      decryptOutputStream.reset(new Crypto::CipherIOStream(
+                                   plainStream,
+                                   Crypto::CryptoOperation::DECRYPT,
+                                   fileMetadata->encryptionMetadata.fileKey,
+                                   fileMetadata->encryptionMetadata.iv,
+                                   FILE_ENCRYPTION_BLOCK_SIZE));
+      dst = decryptOutputStream.get();
+    }
+    auto getStart = std::chrono::steady_clock::now();
+    outcome = client->download(fileMetadata, dst);
+    // finalizes the decryption unless the storage client already flushed
+    dst->flush();
+    recordDownloadMetrics(fileMetadata, outcome, getStart);
+  }
+
+  if (outcome == RemoteStorageRequestOutcome::SUCCESS && decompressBuf)
+  {
+    int ret = decompressBuf->finish();
+    if (ret != 0)
+    {
+      CXX_LOG_ERROR("Failed to decompress downloaded file %s. Error code: %d",
+                    fileMetadata->srcFileName.c_str(), ret);
+      outcome = RemoteStorageRequestOutcome::FAILED;
+    }
+    else
+    {
+      std::string extension = type->getFileExtension();
+      fileMetadata->destFileName = fileMetadata->destFileName.substr(
+        0, fileMetadata->destFileName.size() - extension.size());
+      fileMetadata->destPath = fileMetadata->destFileName;
+    }
+  }
+
+  if (outcome == RemoteStorageRequestOutcome::SUCCESS &&
+      !m_downloadStream->flush().good())
+  {
+    CXX_LOG_ERROR("Failed to write downloaded file %s to the download stream",
+                  fileMetadata->srcFileName.c_str());
+    outcome = RemoteStorageRequestOutcome::FAILED;
+  }
+
+  m_executionResults->SetTransferOutCome(outcome, resultIndex);
+  return outcome;
+}
+
+const Snowflake::Client::FileCompressionType *
+Snowflake::Client::FileTransferAgent::getAutoCompressType()
+{
+  if (!m_transferConfig || !m_transferConfig->compressType)
+  {
+    return &FileCompressionType::GZIP;
+  }
+
+  const FileCompressionType *type =
+    FileCompressionType::lookUpByName(m_transferConfig->compressType);
+  if (type == &FileCompressionType::GZIP ||
+      (type == &FileCompressionType::ZSTD && Util::CompressionUtil::isZstdSupported()))
+  {
+    return type;
+  }
+  CXX_LOG_ERROR("Auto compression type %s not supported", m_transferConfig->compressType);
+  throw SnowflakeTransferException(TransferError::COMPRESSION_NOT_SUPPORTED,
+                                   m_transferConfig->compressType);
+}
+
+const Snowflake::Client::FileCompressionType *
+Snowflake::Client::FileTransferAgent::getDownloadDecompressType(const std::string &name)
+{
+  if (!m_transferConfig || !m_transferConfig->decompressDownloads)
+  {
+    return nullptr;
+  }
+
+  const FileCompressionType *type = nullptr;
+  const FileCompressionType *candidates[] = {
+    &FileCompressionType::GZIP, &FileCompressionType::ZSTD };
+  for (const FileCompressionType *candidate : candidates)
+  {
+    std::string extension = candidate->getFileExtension();
+    if (name.size() > extension.size() &&
+        name.compare(name.size() - extension.size(), extension.size(), extension) == 0 &&
+        (candidate != &FileCompressionType::ZSTD || Util::CompressionUtil::isZstdSupported()))
+    {
+      type = candidate;
+    }
+  }
+  return type;
+}
+
+unsigned int Snowflake::Client::FileTransferAgent::getDecompressThreads()
+{
+  return m_transferConfig && m_transferConfig->compressThreads > 1 ?
+    m_transferConfig->compressThreads : 1;
+}
+
+RemoteStorageRequestOutcome Snowflake::Client::FileTransferAgent::decompressDownloadedFile(
+  FileMetadata *fileMetadata)
+{
+  const FileCompressionType *type = FileCompressionType::guessCompressionType(
+    fileMetadata->destPath);
+  if (type != &FileCompressionType::GZIP &&
+      !(type == &FileCompressionType::ZSTD && Util::CompressionUtil::isZstdSupported()))
+  {
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+
+  std::string compressedPath = fileMetadata->destPath;
+  std::string extension = type->getFileExtension();
+  if (compressedPath.size() <= extension.size() ||
+      compressedPath.compare(compressedPath.size() - extension.size(),
+                             extension.size(), extension) != 0)
+  {
+    // keep a file that is compressed but not named after it as it is
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  std::string decompressedPath = compressedPath.substr(
+    0, compressedPath.size() - extension.size());
+
+  FILE *sourceFile = fopen(compressedPath.c_str(), "rb");
+  if (!sourceFile)
+  {
+    CXX_LOG_ERROR("Failed to open downloaded file %s. Errno: %d", compressedPath.c_str(), errno);
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+  FILE *destFile = fopen(decompressedPath.c_str(), "wb");
+  if (!destFile)
+  {
+    CXX_LOG_ERROR("Failed to open file %s. Errno: %d", decompressedPath.c_str(), errno);
+    fclose(sourceFile);
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+
+  int ret = type == &FileCompressionType::ZSTD ?
+    Util::CompressionUtil::decompressWithZstd(sourceFile, destFile) :
+    Util::CompressionUtil::decompressWithGzipParallel(sourceFile, destFile,
+                                                      getDecompressThreads());
+  fclose(sourceFile);
+  if (fclose(destFile) != 0 && ret == 0)
+  {
+    ret = -1;
+  }
+  if (ret != 0)
+  {
+    CXX_LOG_ERROR("Failed to decompress downloaded file %s. Error code: %d",
+                  compressedPath.c_str(), ret);
+    remove(decompressedPath.c_str());
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+
+  remove(compressedPath.c_str());
+  fileMetadata->destPath = decompressedPath;
+  fileMetadata->destFileName = fileMetadata->destFileName.substr(
+    0, fileMetadata->destFileName.size() - extension.size());
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
 void Snowflake::Client::FileTransferAgent::getPresignedUrlForUploading(
                                FileMetadata& fileMetadata,
                                const std::string& command)
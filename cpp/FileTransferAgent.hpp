@@ -6,6 +6,7 @@
 #define SNOWFLAKECLIENT_FILETRANSFERAGENT_HPP
 
 #include <map>
+#include <memory>
 #include <string>
 #include <snowflake/IFileTransferAgent.hpp>
 #include "snowflake/IStatementPutGet.hpp"
@@ -14,8 +15,18 @@
 #include "FileTransferExecutionResult.hpp"
 #include "FileMetadata.hpp"
 #include "FileMetadataInitializer.hpp"
+#include "crypto/HashContext.hpp"
+#include "util/DigestCache.hpp"
+#include "util/DownloadCache.hpp"
+#include "util/AsyncFileStreamBuf.hpp"
+#include "util/CompressionTuner.hpp"
+#include "util/ConcurrencyTuner.hpp"
+#include "util/MappedFile.hpp"
+#include "util/TransferCheckpoint.hpp"
 #include "snowflake/platform.h"
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -24,7 +35,15 @@
 
 #endif
 
-#define FILE_ENCRYPTION_BLOCK_SIZE 128
+// data encrypted or decrypted by a cipher stream at a time, large enough that
+// the cost of a cipher update call is lost in the data it takes
+#define FILE_ENCRYPTION_BLOCK_SIZE (256 * 1024)
+
+// files up to this size are compressed on the uploading thread alone
+#define COMPRESS_PARALLEL_THRESHOLD (16 * 1024 * 1024)
+
+// buffers reading ahead or writing behind a local file with asyncIoBufferSize
+#define ASYNC_IO_DEPTH 4
 
 namespace Snowflake
 {
@@ -91,6 +110,14 @@ class RetryContext
         ++m_retryCount;
     }
 
+    /**
+     * @return number of attempts after the first one so far
+     */
+    unsigned int getRetries()
+    {
+        return m_retryCount > 1 ? (unsigned int)(m_retryCount - 1) : 0;
+    }
+
   private:
     unsigned long m_retryCount;
     unsigned long m_maxRetryCount;
@@ -149,6 +176,37 @@ public:
    */
   virtual ITransferResult *execute(std::string *command);
 
+  virtual ITransferHandle *executeAsync(std::string *command,
+                                        ITransferListener *listener);
+
+  /**
+   * Skip the files of the command in the background not started yet
+   */
+  void cancel()
+  {
+    m_cancelled = true;
+  }
+
+  /**
+   * @param completedFiles set to the files of the command over so far
+   * @param totalFiles set to the files of the command
+   */
+  void getProgress(size_t &completedFiles, size_t &totalFiles)
+  {
+    completedFiles = m_completedFiles;
+    totalFiles = m_totalFiles;
+  }
+
+  /**
+   * Forget the listener and the cancellation of a command in the background
+   * once it is over
+   */
+  void endAsync()
+  {
+    m_listener = nullptr;
+    m_cancelled = false;
+  }
+
   /**
   * Set upload stream to enable upload file from stream in memory.
   * @param uploadStream The stream to be uploaded.
@@ -161,6 +219,25 @@ public:
     m_uploadStreamSize = dataSize;
   }
 
+  /**
+  * Set download stream to make GET write the files to it instead of the
+  * local directory.
+  * @param downloadStream The stream to write downloaded data to.
+  */
+  virtual void setDownloadStream(std::basic_ostream<char>* downloadStream)
+  {
+    m_downloadStream = downloadStream;
+  }
+
+  /**
+  * Set several streams to be uploaded in parallel instead of local files.
+  * @param uploadStreams The streams to be uploaded.
+  */
+  virtual void setUploadStreams(const std::vector<UploadStream>& uploadStreams)
+  {
+    m_uploadStreams = uploadStreams;
+  }
+
   /**
    * Set useUrand to true to use /dev/urandom device
    * Set it to false to use /dev/random device
@@ -188,6 +265,44 @@ public:
   }
 
 private:
+  /**
+   * Counts a file as over when it goes out of scope, telling the listener
+   * about it, unless the file is to be transferred again with renewed
+   * credentials
+   */
+  class FileCompletion
+  {
+  public:
+    FileCompletion(FileTransferAgent *agent, FileMetadata *fileMetadata,
+                   size_t resultIndex) :
+      m_agent(agent), m_fileMetadata(fileMetadata), m_resultIndex(resultIndex)
+    {
+    }
+
+    ~FileCompletion()
+    {
+      m_agent->completeFile(m_fileMetadata, m_resultIndex, std::uncaught_exception());
+    }
+
+  private:
+    FileTransferAgent *m_agent;
+    FileMetadata *m_fileMetadata;
+    size_t m_resultIndex;
+  };
+
+  /**
+   * Count a file as over and tell the listener about it
+   * @param failed true if the transfer of the file threw, its outcome isn't
+   *        set then
+   */
+  void completeFile(FileMetadata *fileMetadata, size_t resultIndex, bool failed);
+
+  /**
+   * @return true if the file is skipped because the command is cancelled,
+   * with its outcome set
+   */
+  bool skipCancelledFile(FileMetadata *fileMetadata, size_t resultIndex);
+
   /**
    * Populate file metadata, (Get source file name)
    * Process compression metadata
@@ -196,8 +311,22 @@ private:
   void initFileMetadata(std::string* command);
 
   /**
-   * Upload large files in sequence, upload small files in parallel in
-   * a thread pool object
+   * Set the compression of a stream to upload from the source compression
+   * of the command. Streams of gzip data are uploaded as they are, the
+   * others are compressed as they are uploaded if the command asks for it.
+   */
+  void initStreamCompression(FileMetadata &fileMeta);
+
+  /**
+   * Pack the small files to be auto compressed into objects of up to the
+   * coalesce target size of the transfer config, each replacing the files
+   * it holds in the small file metadata
+   */
+  void coalesceSmallFiles();
+
+  /**
+   * Upload large files in sequence, or at once if the storage client
+   * supports it, upload small files in parallel in a thread pool object
    */
   void upload(std::string *command);
 
@@ -215,14 +344,55 @@ private:
    */
   void updateFileDigest(FileMetadata *fileMetadata);
 
+  /**
+   * Finalize a sha256 hash operation and store the digest in the metadata
+   * @param fileMetadata
+   * @param hashContext
+   */
+  void setFileDigest(FileMetadata *fileMetadata,
+                     Crypto::HashContext &hashContext);
+
   /**
    * Renew aws expired token by re-submitting put/get command to server
    * @param client the new client object using the new token
    */
   void renewToken(std::string * command);
 
+  /**
+   * Renew the credentials of the stage before they expire, while files are
+   * transferred on other threads, taken by the storage client in place
+   * @return false if the storage client can't take them, they are renewed
+   * once they expire then
+   */
+  bool refreshCredentials(std::string *command);
+
   void uploadFilesInParallel(std::string *command);
 
+  /**
+   * Create the tuner of the number of small files transferred at once
+   * @return NULL if the transfer config doesn't ask for tuning, response.parallel
+   * files are transferred at once then
+   */
+  Util::ConcurrencyTuner *createConcurrencyTuner();
+
+  /**
+   * @return true if a file to upload is read mapped in memory, for the large
+   * files when the transfer config asks for it
+   */
+  bool shouldMapSourceFile(FileMetadata *fileMetadata);
+
+  /**
+   * @return bytes of the buffers reading ahead or writing behind the local
+   * files, 0 to read and write them with file streams
+   */
+  size_t getAsyncIoBufferSize();
+
+  /**
+   * Upload several large files at once when the storage client can share
+   * its upload threads between their parts
+   */
+  void uploadLargeFilesConcurrently(std::string *command);
+
   /**
    * Download large files in sequence, download small files in parallel in
    * a thread pool object
@@ -231,19 +401,107 @@ private:
 
   void downloadFilesInParallel(std::string *command);
 
+  /**
+   * Download a small file on a thread of a pool, renewing the token if it
+   * expires.
+   * @param tuner tuner limiting the downloads running at once, NULL for none
+   */
+  void downloadFileInJob(FileMetadata *metadata, size_t resultIndex,
+                         std::string *command, Util::ConcurrencyTuner *tuner);
+
+  /**
+   * @return true if the metadata of the files to download is looked up
+   * while they download rather than one file after the other before
+   */
+  bool looksUpDownloadMetadataInParallel();
+
+  /**
+   * Look up the metadata of the files to download on a thread pool, each
+   * small file downloaded on the same thread once its metadata is known,
+   * the large files in sequence after. Files whose metadata isn't found are
+   * left out of the results.
+   */
+  void downloadWithMetadataLookups(std::string *command);
+
   /**
    * Download single file.
    */
   RemoteStorageRequestOutcome downloadSingleFile(IStorageClient *client,
                                                  FileMetadata *fileMetadata, size_t resultIndex);
 
+  /**
+   * Download all the files of the command into the download stream, one
+   * after the other.
+   */
+  void downloadToStream(std::string *command);
+
+  /**
+   * Download single file into the download stream.
+   */
+  RemoteStorageRequestOutcome downloadSingleFileToStream(IStorageClient *client,
+                                                         FileMetadata *fileMetadata,
+                                                         size_t resultIndex);
+
   /**
    * compress source file into a temporary file if required by
-   * user.
+   * user. The digest of the compressed file is calculated as it is
+   * written, so the file isn't read again for it. Coalesced files are
+   * concatenated into a temporary file first.
    * @param fileMetadata
    */
   void compressSourceFile(FileMetadata *fileMetadata);
 
+  /**
+   * Find the size and the digest of the data of an upload stream once
+   * compressed, without keeping the compressed data. The stream is
+   * compressed again as it is uploaded.
+   * @param fileMetadata
+   */
+  void compressSourceStream(FileMetadata *fileMetadata);
+
+  /**
+   * @return compression type of auto compress from the transfer config
+   */
+  const FileCompressionType *getAutoCompressType();
+
+  /**
+   * @return compression type of a file downloaded that is decompressed as
+   * asked by the transfer config, NULL if the file is kept as it is
+   */
+  const FileCompressionType *getDownloadDecompressType(const std::string &name);
+
+  /**
+   * @return number of threads inflating the members of a gzip file downloaded
+   */
+  unsigned int getDecompressThreads();
+
+  /**
+   * decompress a downloaded .gz or .zst file next to it and remove the
+   * compressed file if the transfer config asks for it
+   * @param fileMetadata
+   * @return FAILED if the file can't be decompressed
+   */
+  RemoteStorageRequestOutcome decompressDownloadedFile(FileMetadata *fileMetadata);
+
+  /**
+   * @return level to compress a file with, as set or as tuned
+   */
+  int getCompressLevel(FileMetadata *fileMetadata);
+
+  /**
+   * @return how a file is transformed before upload, a cached digest is
+   * only valid for the same transformation
+   */
+  std::string getDigestCacheKey(FileMetadata *fileMetadata);
+
+  /**
+   * Add the time and bytes of a download to the metrics of the file
+   * @param getStart time the download started
+   */
+  void recordDownloadMetrics(FileMetadata *fileMetadata,
+                             RemoteStorageRequestOutcome outcome,
+                             std::chrono::steady_clock::time_point getStart);
+
   /**
    * Reset private members between two consecutive put/get command
    */
@@ -303,13 +561,48 @@ private:
   /// The data size of upload stream.
   size_t m_uploadStreamSize;
 
+  /// digests of the files uploaded before, if the transfer config has a cache
+  std::unique_ptr<Util::DigestCache> m_digestCache;
+
+  /// files downloaded before, if the transfer config has a cache directory
+  std::unique_ptr<Util::DownloadCache> m_downloadCache;
+
+  /// multipart uploads not completed yet, if the transfer config has a checkpoint
+  std::unique_ptr<Util::TransferCheckpoint> m_checkpoint;
+
+  /// The streams for uploading several files from memory.
+  std::vector<UploadStream> m_uploadStreams;
+
+  /// The stream for downloading data to memory. (NOT OWN)
+  std::basic_ostream<char>* m_downloadStream;
+
   /// Whether to use /dev/urandom or /dev/random;
   bool m_useDevUrand;
 
   /// fastFail, fail all the puts if one of the put fails in the wild char put upload.
   bool m_fastFail;
 
+  /// told about the files of a command in the background as they complete
+  ITransferListener *m_listener;
+
+  /// true if the command in the background is cancelled
+  std::atomic<bool> m_cancelled;
+
+  std::atomic<size_t> m_completedFiles;
+
+  std::atomic<size_t> m_totalFiles;
+
   int m_maxPutRetries;
+
+  /// concurrency the last tuned transfer ended with, 0 before any
+  unsigned int m_tunedConcurrency;
+
+  /// level of the auto compression, moved by the files uploaded when
+  /// TransferConfig::adaptiveCompressLevel is set, NULL otherwise
+  std::unique_ptr<Util::CompressionTuner> m_compressionTuner;
+
+  /// auto compression type the tuner is for
+  const FileCompressionType *m_tunedCompressionType;
 };
 }
 }
@@ -52,9 +52,11 @@ FileTransferExecutionResult::FileTransferExecutionResult(
   size_t resultEntryNum) :
   m_commandType(commandType),
   m_resultEntryNum(resultEntryNum),
-  m_currentIndex(-1)
+  m_currentIndex(-1),
+  m_enumerateMs(0),
+  m_elapsedMs(0)
 {
-  m_fileMetadatas = new FileMetadata*[resultEntryNum];
+  m_fileMetadatas = new FileMetadata*[resultEntryNum]();
   m_outcomes = new RemoteStorageRequestOutcome[resultEntryNum];
 }
 
@@ -214,6 +216,40 @@ void FileTransferExecutionResult::getColumnAsString(unsigned int columnIndex,
   }
 }
 
+TransferMetrics FileTransferExecutionResult::getMetrics()
+{
+  if (m_currentIndex < 0 || (size_t)m_currentIndex >= m_resultEntryNum ||
+      !m_fileMetadatas[m_currentIndex])
+  {
+    return TransferMetrics();
+  }
+  return m_fileMetadatas[m_currentIndex]->metrics;
+}
+
+TransferMetrics FileTransferExecutionResult::getTotalMetrics()
+{
+  TransferMetrics total;
+  for (size_t i = 0; i < m_resultEntryNum; i++)
+  {
+    if (!m_fileMetadatas[i])
+    {
+      continue;
+    }
+    const TransferMetrics &metrics = m_fileMetadatas[i]->metrics;
+    total.rawBytes += metrics.rawBytes;
+    total.compressedBytes += metrics.compressedBytes;
+    total.transferredBytes += metrics.transferredBytes;
+    total.compressMs += metrics.compressMs;
+    total.hashMs += metrics.hashMs;
+    total.transferMs += metrics.transferMs;
+    total.retries += metrics.retries;
+    total.parts += metrics.parts;
+  }
+  total.enumerateMs = m_enumerateMs;
+  total.elapsedMs = m_elapsedMs;
+  return total;
+}
+
 int FileTransferExecutionResult::findColumnByName(
   const char *columnName, int columnNameSize)
 {
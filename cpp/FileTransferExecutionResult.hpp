@@ -40,6 +40,19 @@ public:
     m_fileMetadatas[index] = fileMetadata;
   }
 
+  RemoteStorageRequestOutcome GetTransferOutCome(size_t index)
+  {
+    return m_outcomes[index];
+  }
+
+  /**
+   * @return status column of a file, e.g. UPLOADED
+   */
+  const char *getStatus(size_t index)
+  {
+    return fromOutcomeToStr(m_outcomes[index]);
+  }
+
   bool next();
 
   size_t getResultSize();
@@ -54,6 +67,21 @@ public:
 
   int findColumnByName(const char * columnName, int columnNameSize);
 
+  TransferMetrics getMetrics();
+
+  TransferMetrics getTotalMetrics();
+
+  /**
+   * Set the times only known for the whole command
+   * @param enumerateMs time taken to list the files
+   * @param elapsedMs time the whole command took
+   */
+  void setCommandTimes(long long enumerateMs, long long elapsedMs)
+  {
+    m_enumerateMs = enumerateMs;
+    m_elapsedMs = elapsedMs;
+  }
+
 private:
   /// enum to indicate command type
   CommandType m_commandType;
@@ -70,6 +98,10 @@ private:
   /// current index already consumed
   int m_currentIndex;
 
+  long long m_enumerateMs;
+
+  long long m_elapsedMs;
+
   const char * fromOutcomeToStr(RemoteStorageRequestOutcome outcome);
 };
 }
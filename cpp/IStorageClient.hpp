@@ -12,6 +12,10 @@ namespace Snowflake
 {
 namespace Client
 {
+namespace Util
+{
+class TransferCheckpoint;
+}
 
 /**
  * Virtual class used to communicate with remote storage.
@@ -50,7 +54,78 @@ public:
     return false;
   }
 
+  /**
+   * @return Whether several files can be uploaded at once with multipart
+   * uploads, sharing the upload threads of this client.
+   */
+  virtual bool supportsConcurrentMultiPartUpload()
+  {
+    return false;
+  }
+
   virtual void setMaxRetries(unsigned int maxRetries) {};
+
+  /**
+   * Check whether a file of the same name is already on the stage, before
+   * the data to upload is prepared.
+   * @return SKIP_UPLOAD_FILE if it is, SUCCESS if it isn't, FAILED if this
+   * client can't tell
+   */
+  virtual RemoteStorageRequestOutcome checkFileExists(FileMetadata *fileMetadata)
+  {
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+
+  /**
+   * Serve the command of another stage info for the same stage, taking its
+   * credentials in place, so that the connections and threads of the
+   * client are reused.
+   * @return false if this client can't take the stage info, a new client
+   * is needed then
+   */
+  virtual bool updateStageInfo(StageInfo *stageInfo)
+  {
+    return false;
+  }
+
+  /**
+   * Sign the requests from now on with the renewed credentials of the
+   * stage, while transfers are in progress on other threads. The stage info
+   * isn't kept.
+   * @return false if this client can't take the credentials in place, they
+   * are renewed when a request finds them expired then
+   */
+  virtual bool refreshCredentials(StageInfo *stageInfo)
+  {
+    return false;
+  }
+
+  /**
+   * Record the multipart uploads in a checkpoint, so that a later upload of
+   * the same data resumes from the parts already uploaded. Clients without
+   * multipart uploads ignore it.
+   * @param checkpoint checkpoint outliving the uploads, NULL to stop recording
+   */
+  virtual void setCheckpoint(Util::TransferCheckpoint *checkpoint) {}
+
+  /**
+   * @return number of requests the storage throttled so far, e.g. with a 503
+   * slow down, for the transfers to back off
+   */
+  virtual unsigned long long getThrottledRequests()
+  {
+    return 0;
+  }
+
+  /**
+   * @return true if the storage client decrypts the download of a file
+   * itself, e.g. the parts of a large file each on its own thread, so that
+   * the data stream given to download() takes the plain data
+   */
+  virtual bool decryptsDownload(FileMetadata *fileMetadata)
+  {
+    return false;
+  }
 };
 }
 }
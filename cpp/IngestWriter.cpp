@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <client_int.h>
+#include <csv_export.h>
+#include "error.h"
+#include "memory.h"
+#include "FileTransferAgent.hpp"
+#include "StatementPutGet.hpp"
+#include "snowflake/SnowflakeTransferException.hpp"
+#include "util/CompressionUtil.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/StageSql.hpp"
+#include "logger/SFLogger.hpp"
+
+using namespace Snowflake::Client;
+using Snowflake::Client::Util::StageSql;
+
+/**
+ * The rows of the file being written are kept as CSV text until the file is
+ * sealed, then handed to a job of the pool, which compresses, uploads and
+ * loads it. The bytes buffered count the text of the sealed files until they
+ * are loaded, for appending rows to wait on.
+ */
+struct SF_INGEST_WRITER
+{
+  SF_CONNECT *sf;
+  std::string table;
+  std::string stagePath;
+  size_t fileSize;
+  long long flushIntervalMs;
+  size_t maxBufferedSize;
+
+  std::mutex mutex;
+  /// notified when a sealed file is over
+  std::condition_variable loadedCond;
+  /// notified when the timer is to stop
+  std::condition_variable timerCond;
+
+  /// text of the file being written
+  RAW_JSON_BUFFER text;
+  size_t rows;
+  std::chrono::steady_clock::time_point firstRowTime;
+
+  /// text of the file being written and of the sealed files not loaded yet
+  size_t bufferedSize;
+  /// sealed files not loaded yet
+  size_t pendingFiles;
+  unsigned int fileCount;
+  int64 rowsLoaded;
+
+  /// the first error of a file, SF_STATUS_SUCCESS if none
+  SF_STATUS status;
+  SF_ERROR_STRUCT error;
+
+  bool closing;
+  std::thread timer;
+  std::unique_ptr<Util::ThreadPool> pool;
+};
+
+namespace
+{
+void setError(SF_INGEST_WRITER *writer, SF_STATUS status, const char *message,
+              const char *sqlstate, const char *sfqid)
+{
+  std::lock_guard<std::mutex> lock(writer->mutex);
+  if (writer->status == SF_STATUS_SUCCESS)
+  {
+    writer->status = status;
+    SET_SNOWFLAKE_STMT_ERROR(&writer->error, status, message, sqlstate, sfqid);
+  }
+}
+
+/**
+ * Uploads a compressed file from memory on a statement of its own, and loads
+ * it into the table.
+ * @return false once the error of the writer is set
+ */
+bool uploadAndLoad(SF_INGEST_WRITER *writer, SF_STMT *stmt,
+                   const std::string &compressed, const std::string &fileName)
+{
+  try
+  {
+    StatementPutGet putget(stmt);
+    FileTransferAgent agent(&putget);
+    std::stringstream uploadStream(compressed);
+    agent.setUploadStream(&uploadStream, compressed.size());
+
+    std::string command = "PUT " + StageSql::quote("file://" + fileName) + " " +
+      StageSql::quote(writer->stagePath) + " auto_compress=false source_compression=gzip";
+    ITransferResult *result = agent.execute(&command);
+
+    std::string status;
+    int statusIndex = result->findColumnByName("status", 6);
+    if (statusIndex < 0 || !result->next() ||
+        (result->getColumnAsString(statusIndex, status), status != "UPLOADED"))
+    {
+      setError(writer, SF_STATUS_ERROR_GENERAL, "Failed to upload a file of rows",
+               SF_SQLSTATE_GENERAL_ERROR, NULL);
+      return false;
+    }
+  }
+  catch (SnowflakeTransferException &e)
+  {
+    setError(writer, SF_STATUS_ERROR_GENERAL, e.what(), SF_SQLSTATE_GENERAL_ERROR, NULL);
+    return false;
+  }
+
+  std::string copyCommand = "COPY INTO " + writer->table + " FROM " +
+    StageSql::quote(writer->stagePath) + " FILES = (" + StageSql::quote(fileName) + ")" +
+    " FILE_FORMAT = (TYPE = CSV FIELD_OPTIONALLY_ENCLOSED_BY = '\"')" +
+    " PURGE = TRUE";
+  if (snowflake_query(stmt, copyCommand.c_str(), copyCommand.size()) != SF_STATUS_SUCCESS)
+  {
+    setError(writer, stmt->error.error_code, stmt->error.msg, stmt->error.sqlstate,
+             stmt->error.sfqid);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Job of the pool for a sealed file
+ */
+void loadFile(SF_INGEST_WRITER *writer, char *data, size_t len, size_t rows,
+              unsigned int fileNumber)
+{
+  std::string compressed;
+  int ret = Util::CompressionUtil::compressWithGzip(data, len, compressed);
+  SF_FREE(data);
+
+  bool loaded = false;
+  if (ret != 0)
+  {
+    setError(writer, SF_STATUS_ERROR_GENERAL, "Failed to compress a file of rows",
+             SF_SQLSTATE_GENERAL_ERROR, NULL);
+  }
+  else if (SF_STMT *stmt = snowflake_stmt(writer->sf))
+  {
+    std::string fileName = "rows_" + std::to_string(fileNumber) + ".csv.gz";
+    loaded = uploadAndLoad(writer, stmt, compressed, fileName);
+    snowflake_stmt_term(stmt);
+  }
+  else
+  {
+    setError(writer, SF_STATUS_ERROR_OUT_OF_MEMORY, "Out of memory",
+             SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, NULL);
+  }
+
+  if (loaded)
+  {
+    CXX_LOG_DEBUG("Ingest writer loaded %zu rows into %s", rows, writer->table.c_str());
+  }
+  std::lock_guard<std::mutex> lock(writer->mutex);
+  if (loaded)
+  {
+    writer->rowsLoaded += rows;
+  }
+  writer->bufferedSize -= len;
+  writer->pendingFiles--;
+  writer->loadedCond.notify_all();
+}
+
+/**
+ * Hands the file being written to the pool, the mutex of the writer held
+ */
+void sealFile(SF_INGEST_WRITER *writer)
+{
+  if (writer->rows == 0)
+  {
+    return;
+  }
+  char *data = writer->text.buffer;
+  size_t len = writer->text.size;
+  size_t rows = writer->rows;
+  unsigned int fileNumber = writer->fileCount++;
+  memset(&writer->text, 0, sizeof(writer->text));
+  writer->rows = 0;
+  writer->pendingFiles++;
+  writer->pool->AddJob([writer, data, len, rows, fileNumber]()
+  {
+    loadFile(writer, data, len, rows, fileNumber);
+  });
+}
+
+/**
+ * Seals the file being written once its first row is flushIntervalMs old
+ */
+void runTimer(SF_INGEST_WRITER *writer)
+{
+  std::unique_lock<std::mutex> lock(writer->mutex);
+  std::chrono::milliseconds interval(writer->flushIntervalMs);
+  while (!writer->closing)
+  {
+    if (writer->rows == 0)
+    {
+      writer->timerCond.wait_for(lock, interval);
+      continue;
+    }
+    std::chrono::steady_clock::time_point deadline = writer->firstRowTime + interval;
+    if (std::chrono::steady_clock::now() >= deadline)
+    {
+      sealFile(writer);
+    }
+    else
+    {
+      writer->timerCond.wait_until(lock, deadline);
+    }
+  }
+}
+
+void freeWriter(SF_INGEST_WRITER *writer)
+{
+  {
+    std::lock_guard<std::mutex> lock(writer->mutex);
+    writer->closing = true;
+    writer->timerCond.notify_all();
+  }
+  if (writer->timer.joinable())
+  {
+    writer->timer.join();
+  }
+  writer->pool.reset();
+  raw_json_buffer_free(&writer->text);
+  clear_snowflake_error(&writer->error);
+  delete writer;
+}
+}
+
+extern "C" {
+
+SF_INGEST_WRITER *STDCALL snowflake_ingest_writer_open(SF_CONNECT *sf, const char *table,
+                                                       const SF_INGEST_OPTIONS *options)
+{
+  if (!sf || !table)
+  {
+    return NULL;
+  }
+
+  SF_INGEST_WRITER *writer = new (std::nothrow) SF_INGEST_WRITER();
+  if (!writer)
+  {
+    return NULL;
+  }
+  char uuid[SF_UUID4_LEN];
+  uuid4_generate(uuid);
+  writer->sf = sf;
+  writer->table = table;
+  writer->stagePath = (options && options->stage ? std::string(options->stage) :
+    StageSql::getTableStage(table)) + "/" + uuid + "/";
+
+  int64 fileSize = options ? options->file_size : 0;
+  int64 flushInterval = options ? options->flush_interval_ms : 0;
+  int64 maxBuffered = options ? options->max_buffered_size : 0;
+  int threads = options && options->threads > 0 ? options->threads :
+    SF_INGEST_THREADS_DEFAULT;
+  writer->fileSize = fileSize > 0 ? (size_t)fileSize : SF_INGEST_FILE_SIZE_DEFAULT;
+  writer->flushIntervalMs = flushInterval == 0 ? SF_INGEST_FLUSH_INTERVAL_DEFAULT :
+    flushInterval;
+  writer->maxBufferedSize = maxBuffered > 0 ? (size_t)maxBuffered :
+    writer->fileSize * threads * 2;
+
+  memset(&writer->text, 0, sizeof(writer->text));
+  writer->rows = 0;
+  writer->bufferedSize = 0;
+  writer->pendingFiles = 0;
+  writer->fileCount = 0;
+  writer->rowsLoaded = 0;
+  writer->status = SF_STATUS_SUCCESS;
+  clear_snowflake_error(&writer->error);
+  writer->closing = false;
+
+  try
+  {
+    writer->pool.reset(new Util::ThreadPool(threads));
+    if (writer->flushIntervalMs > 0)
+    {
+      writer->timer = std::thread(runTimer, writer);
+    }
+  }
+  catch (...)
+  {
+    CXX_LOG_ERROR("Failed to start the threads of the ingest writer");
+    freeWriter(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+SF_STATUS STDCALL snowflake_ingest_append(SF_INGEST_WRITER *writer, const char **values,
+                                          const size_t *lengths, size_t count)
+{
+  if (!writer)
+  {
+    return SF_STATUS_ERROR_NULL_POINTER;
+  }
+
+  std::unique_lock<std::mutex> lock(writer->mutex);
+  // wait for the files being loaded, but never for the file being written
+  writer->loadedCond.wait(lock, [writer]()
+  {
+    return writer->status != SF_STATUS_SUCCESS || writer->pendingFiles == 0 ||
+      writer->bufferedSize < writer->maxBufferedSize;
+  });
+  if (writer->status != SF_STATUS_SUCCESS)
+  {
+    return writer->status;
+  }
+
+  size_t oldLen = writer->text.size;
+  if (!sf_csv_buffer_append_line(&writer->text, values, lengths, count))
+  {
+    // drop the part of the row appended
+    writer->text.size = oldLen;
+    if (writer->text.buffer)
+    {
+      writer->text.buffer[oldLen] = '\0';
+    }
+    return SF_STATUS_ERROR_OUT_OF_MEMORY;
+  }
+  writer->bufferedSize += writer->text.size - oldLen;
+  if (writer->rows++ == 0)
+  {
+    writer->firstRowTime = std::chrono::steady_clock::now();
+    writer->timerCond.notify_all();
+  }
+
+  if (writer->text.size >= writer->fileSize)
+  {
+    sealFile(writer);
+  }
+  return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL snowflake_ingest_flush(SF_INGEST_WRITER *writer)
+{
+  if (!writer)
+  {
+    return SF_STATUS_ERROR_NULL_POINTER;
+  }
+
+  std::unique_lock<std::mutex> lock(writer->mutex);
+  sealFile(writer);
+  writer->loadedCond.wait(lock, [writer]()
+  {
+    return writer->pendingFiles == 0;
+  });
+  return writer->status;
+}
+
+int64 STDCALL snowflake_ingest_rows_loaded(SF_INGEST_WRITER *writer)
+{
+  if (!writer)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(writer->mutex);
+  return writer->rowsLoaded;
+}
+
+SF_ERROR_STRUCT *STDCALL snowflake_ingest_error(SF_INGEST_WRITER *writer)
+{
+  return writer ? &writer->error : NULL;
+}
+
+SF_STATUS STDCALL snowflake_ingest_writer_close(SF_INGEST_WRITER *writer)
+{
+  if (!writer)
+  {
+    return SF_STATUS_SUCCESS;
+  }
+  SF_STATUS ret = snowflake_ingest_flush(writer);
+  if (ret != SF_STATUS_SUCCESS)
+  {
+    CXX_LOG_ERROR("Ingest writer into %s closed after an error: %s",
+                  writer->table.c_str(), writer->error.msg);
+  }
+  freeWriter(writer);
+  return ret;
+}
+
+}
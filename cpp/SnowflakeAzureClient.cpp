@@ -3,6 +3,7 @@
  */
 
 #include "SnowflakeAzureClient.hpp"
+#include "FileTransferAgent.hpp"
 #include "FileMetadataInitializer.hpp"
 #include "snowflake/client.h"
 #include "util/Base64.hpp"
@@ -22,6 +23,11 @@
 
 #define CONTENT_TYPE_OCTET_STREAM "application/octet-stream"
 
+// limits of a block blob
+#define AZURE_MAX_BLOCK_SIZE (100 * 1024 * 1024)
+#define AZURE_MAX_BLOCKS 50000
+#define BLOCK_SIZE_UNIT (1024 * 1024)
+
 namespace Snowflake
 {
 namespace Client
@@ -34,8 +40,12 @@ SnowflakeAzureClient::SnowflakeAzureClient(StageInfo *stageInfo,
                                            TransferConfig *transferConfig) :
   m_stageInfo(stageInfo),
   m_threadPool(nullptr),
+  m_blockBufferPool(nullptr),
+  m_blockBufferLimit(transferConfig != nullptr ? transferConfig->multipartBufferLimit : 0),
+  m_maxRetries(0),
   m_uploadThreshold(uploadThreshold),
-  m_parallel(std::min(parallel, std::thread::hardware_concurrency()))
+  m_parallel(std::min(parallel, std::thread::hardware_concurrency())),
+  m_throttledRequests(0)
 {
   const std::string azuresaskey("AZURE_SAS_KEY");
   char caBundleFile[MAX_PATH] = {0};
@@ -73,11 +83,13 @@ SnowflakeAzureClient::SnowflakeAzureClient(StageInfo *stageInfo,
 
   std::string account_name = m_stageInfo->storageAccount;
   std::string sas_key = m_stageInfo->credentials[azuresaskey];
+  m_sasToken = sas_key;
   std::string endpoint = account_name + "." + m_stageInfo->endPoint;
   std::shared_ptr<azure::storage_lite::storage_credential>  cred = std::make_shared<azure::storage_lite::shared_access_signature_credential>(sas_key);
   std::shared_ptr<azure::storage_lite::storage_account> account = std::make_shared<azure::storage_lite::storage_account>(account_name, cred, true, endpoint);
-  auto bc = std::make_shared<azure::storage_lite::blob_client>(account, m_parallel, caBundleFile);
-  m_blobclient= new azure::storage_lite::blob_client_wrapper(bc);
+  // one connection per upload thread, kept open across the requests
+  m_blockClient = std::make_shared<azure::storage_lite::blob_client>(account, m_parallel, caBundleFile);
+  m_blobclient= new azure::storage_lite::blob_client_wrapper(m_blockClient);
 
   //Ensure the stage location ended with /
   if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
@@ -88,6 +100,22 @@ SnowflakeAzureClient::SnowflakeAzureClient(StageInfo *stageInfo,
   CXX_LOG_TRACE("Successfully created Azure client. End of constructor.");
 }
 
+bool SnowflakeAzureClient::updateStageInfo(StageInfo *stageInfo)
+{
+  const char *sasToken = stageInfo->credentials["AZURE_SAS_KEY"];
+  if (!sasToken || m_sasToken != sasToken)
+  {
+    return false;
+  }
+
+  m_stageInfo = stageInfo;
+  if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
+  {
+    m_stageInfo->location.push_back('/');
+  }
+  return true;
+}
+
 SnowflakeAzureClient::~SnowflakeAzureClient()
 {
     delete m_blobclient;
@@ -95,6 +123,10 @@ SnowflakeAzureClient::~SnowflakeAzureClient()
     {
         delete m_threadPool;
     }
+    if (m_blockBufferPool != nullptr)
+    {
+        delete m_blockBufferPool;
+    }
 }
 
 RemoteStorageRequestOutcome SnowflakeAzureClient::upload(FileMetadata *fileMetadata,
@@ -107,6 +139,21 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::upload(FileMetadata *fileMetad
     return doMultiPartUpload(fileMetadata, dataStream);
 }
 
+RemoteStorageRequestOutcome SnowflakeAzureClient::checkFileExists(FileMetadata *fileMetadata)
+{
+  std::string containerName = m_stageInfo->location;
+
+  //Remove the trailing '/' in containerName
+  containerName.pop_back();
+
+  if (m_blobclient->blob_exists(containerName, fileMetadata->destFileName)) {
+    CXX_LOG_DEBUG("File already exists skipping the file upload %s",
+                  fileMetadata->srcFileName.c_str());
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
 RemoteStorageRequestOutcome SnowflakeAzureClient::doSingleUpload(FileMetadata *fileMetadata,
   std::basic_iostream<char> *dataStream)
 {
@@ -128,17 +175,14 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doSingleUpload(FileMetadata *f
 
   //Azure does not provide to SHA256 or MD5 or checksum check of a file to check if it already exists.
   //Do not check if file exists if overwrite is specified.
-  if(! fileMetadata->overWrite ) {
-      bool exists = m_blobclient->blob_exists(containerName, blobName);
-      if (exists) {
-        CXX_LOG_DEBUG("File already exists skipping the file upload %s",
-                      fileMetadata->srcFileToUpload.c_str());
-          return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
-      }
+  if(! fileMetadata->overWrite &&
+     checkFileExists(fileMetadata) == RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE) {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
   }
   m_blobclient->upload_block_blob_from_stream(containerName, blobName, *dataStream, userMetadata, len);
   if (errno != 0)
   {
+    countThrottledRequest();
     CXX_LOG_ERROR("%s single part upload failed, errno = %d",
                   fileMetadata->srcFileToUpload.c_str(), errno);
       return RemoteStorageRequestOutcome::FAILED;
@@ -149,9 +193,58 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doSingleUpload(FileMetadata *f
   return RemoteStorageRequestOutcome::SUCCESS;
 }
 
+MultiUploadCtx_a::MultiUploadCtx_a(const std::string &container,
+                                   const std::string &blob,
+                                   unsigned int partNumber) :
+  buf(nullptr),
+  m_partNumber(partNumber),
+  m_container(container),
+  m_blob(blob),
+  m_outcome(RemoteStorageRequestOutcome::FAILED),
+  m_empty(false),
+  m_retries(0)
+{
+  // the ids of the blocks of a blob must all be as long
+  char blockId[16];
+  sb_sprintf(blockId, sizeof(blockId), "%08u", partNumber);
+  char encoded[32] = {0};
+  Util::Base64::encode(blockId, 8, encoded);
+  m_blockId = std::string(encoded, Util::Base64::encodedLength(8));
+}
+
+size_t SnowflakeAzureClient::chooseBlockSize(long long int streamSize, size_t threshold,
+                                             unsigned int parallel)
+{
+  unsigned long long blockSize = (unsigned long long)streamSize / std::max(parallel, 1u) + 1;
+  blockSize = std::max(blockSize, (unsigned long long)threshold);
+  blockSize = std::min(blockSize, (unsigned long long)AZURE_MAX_BLOCK_SIZE);
+  // the last block may be empty, see StreamSplitter::getTotalParts()
+  blockSize = std::max(blockSize,
+                       (unsigned long long)streamSize / (AZURE_MAX_BLOCKS - 1) + 1);
+  blockSize = (blockSize + BLOCK_SIZE_UNIT - 1) / BLOCK_SIZE_UNIT * BLOCK_SIZE_UNIT;
+  return (size_t)blockSize;
+}
+
 void Snowflake::Client::SnowflakeAzureClient::uploadParts(MultiUploadCtx_a * uploadCtx)
 {
-	return;
+  auto outcome = m_blockClient->upload_block_from_buffer(
+    uploadCtx->m_container, uploadCtx->m_blob, uploadCtx->m_blockId,
+    uploadCtx->buf->getDataBuffer(), (uint64_t)uploadCtx->buf->getSize()).get();
+  if (outcome.success())
+  {
+    CXX_LOG_DEBUG("Upload block %d succeed", uploadCtx->m_partNumber);
+    uploadCtx->m_outcome = RemoteStorageRequestOutcome::SUCCESS;
+    return;
+  }
+
+  if (outcome.error().code == "503")
+  {
+    m_throttledRequests++;
+  }
+  CXX_LOG_ERROR("Upload block %d FAILED, status %s %s: %s", uploadCtx->m_partNumber,
+                outcome.error().code.c_str(), outcome.error().code_name.c_str(),
+                outcome.error().message.c_str());
+  uploadCtx->m_outcome = RemoteStorageRequestOutcome::FAILED;
 }
 
 RemoteStorageRequestOutcome SnowflakeAzureClient::doMultiPartUpload(FileMetadata *fileMetadata,
@@ -161,33 +254,114 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doMultiPartUpload(FileMetadata
                fileMetadata->srcFileToUpload.c_str());
   std::string containerName = m_stageInfo->location;
 
-    //Remove the trailing '/' in containerName
-    containerName.pop_back();
-
-    std::string blobName = fileMetadata->destFileName;
-
-    //metadata azure uses.
-    std::vector<std::pair<std::string, std::string>> userMetadata;
-    addUserMetadata(&userMetadata, fileMetadata);
-    //Calculate the length of the stream.
-    unsigned int len = (unsigned int) ((fileMetadata->encryptionMetadata.cipherStreamSize > 0) ? fileMetadata->encryptionMetadata.cipherStreamSize: fileMetadata->srcFileToUploadSize) ;
-    if(! fileMetadata->overWrite ) {
-        //Azure does not provide to SHA256 or MD5 or checksum check of a file to check if it already exists.
-        bool exists = m_blobclient->blob_exists(containerName, blobName);
-        if (exists) {
-          CXX_LOG_DEBUG("File already exists skipping the file upload %s",
-                        fileMetadata->srcFileToUpload.c_str());
-            return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
-        }
+  //Remove the trailing '/' in containerName
+  containerName.pop_back();
+
+  std::string blobName = fileMetadata->destFileName;
+
+  //metadata azure uses.
+  std::vector<std::pair<std::string, std::string>> userMetadata;
+  addUserMetadata(&userMetadata, fileMetadata);
+  long long streamSize = fileMetadata->encryptionMetadata.cipherStreamSize > 0 ?
+    fileMetadata->encryptionMetadata.cipherStreamSize : fileMetadata->srcFileToUploadSize;
+  //Azure does not provide to SHA256 or MD5 or checksum check of a file to check if it already exists.
+  if(! fileMetadata->overWrite &&
+     checkFileExists(fileMetadata) == RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE) {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+
+  if (m_threadPool == nullptr)
+  {
+    m_threadPool = new Util::ThreadPool(m_parallel);
+  }
+  if (m_blockBufferPool == nullptr)
+  {
+    m_blockBufferPool = new Util::StreamBufferPool(m_parallel, m_blockBufferLimit);
+  }
+
+  // the blocks are put by all the threads at once and only become the blob
+  // when the block list is put at the end
+  size_t blockSize = chooseBlockSize(streamSize, m_uploadThreshold, m_parallel);
+  Util::StreamSplitter splitter(dataStream, m_blockBufferPool, (unsigned int)blockSize);
+  unsigned int totalBlocks = splitter.getTotalParts(streamSize);
+  CXX_LOG_INFO("Total file size: %lld, split into %d blocks of %lu bytes.",
+               streamSize, totalBlocks, (unsigned long)blockSize);
+
+  std::vector<MultiUploadCtx_a> uploadBlocks;
+  uploadBlocks.reserve(totalBlocks);
+  for (unsigned int i = 0; i < totalBlocks; i++)
+  {
+    uploadBlocks.emplace_back(containerName, blobName, i);
+  }
+
+  Util::JobGroup blockJobs;
+  for (unsigned int i = 0; i < totalBlocks; i++)
+  {
+    blockJobs.AddJob(*m_threadPool, [&splitter, &uploadBlocks, this]()->void
+    {
+      int blockIndex;
+      Util::ByteArrayStreamBuf * buf = splitter.FillAndGetBuf(blockIndex);
+      MultiUploadCtx_a &ctx = uploadBlocks[blockIndex];
+      if (buf->getSize() == 0)
+      {
+        ctx.m_empty = true;
+        ctx.m_outcome = RemoteStorageRequestOutcome::SUCCESS;
+        splitter.ReleaseBuf(buf);
+        return;
+      }
+
+      ctx.buf = buf;
+      char retryBlockLog[100];
+      sb_sprintf(retryBlockLog, sizeof(retryBlockLog), "Retrying block %d of %s.",
+                 blockIndex, ctx.m_blob.c_str());
+      RetryContext blockRetryCtx(retryBlockLog, m_maxRetries);
+      do
+      {
+        //Sleeps only when its a retry
+        blockRetryCtx.waitForNextRetry();
+        this->uploadParts(&ctx);
+      } while (blockRetryCtx.isRetryable(ctx.m_outcome));
+      ctx.m_retries = blockRetryCtx.getRetries();
+      splitter.ReleaseBuf(buf);
+      ctx.buf = nullptr;
+    });
+  }
+  blockJobs.Wait();
+
+  std::vector<azure::storage_lite::put_block_list_request_base::block_item> blockList;
+  for (unsigned int i = 0; i < totalBlocks; i++)
+  {
+    fileMetadata->metrics.retries += uploadBlocks[i].m_retries;
+    if (uploadBlocks[i].m_outcome != RemoteStorageRequestOutcome::SUCCESS)
+    {
+      CXX_LOG_ERROR("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
+      return uploadBlocks[i].m_outcome;
     }
-    m_blobclient->multipart_upload_block_blob_from_stream(containerName, blobName, *dataStream, userMetadata, len);
-    if (errno != 0)
+    if (!uploadBlocks[i].m_empty)
     {
-      CXX_LOG_ERROR("%s file upload failed, errno = %d.", fileMetadata->srcFileToUpload.c_str(), errno);
-        return RemoteStorageRequestOutcome::FAILED;
+      azure::storage_lite::put_block_list_request_base::block_item block;
+      block.id = uploadBlocks[i].m_blockId;
+      block.type = azure::storage_lite::put_block_list_request_base::block_type::uncommitted;
+      blockList.push_back(block);
     }
-    CXX_LOG_DEBUG("%s file upload success.", fileMetadata->srcFileToUpload.c_str());
-    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  fileMetadata->metrics.parts = (unsigned int)blockList.size();
+
+  auto outcome = m_blockClient->put_block_list(containerName, blobName, blockList,
+                                               userMetadata).get();
+  if (!outcome.success())
+  {
+    if (outcome.error().code == "503")
+    {
+      m_throttledRequests++;
+    }
+    CXX_LOG_ERROR("%s file upload failed putting the block list, status %s %s: %s",
+                  fileMetadata->srcFileToUpload.c_str(), outcome.error().code.c_str(),
+                  outcome.error().code_name.c_str(), outcome.error().message.c_str());
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+  CXX_LOG_DEBUG("%s file upload success.", fileMetadata->srcFileToUpload.c_str());
+  return RemoteStorageRequestOutcome::SUCCESS;
 }
 
 std::string buildEncryptionMetadataJSON(std::string iv64, std::string enkek64)
@@ -249,6 +423,7 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doMultiPartDownload(
     unsigned int partNum = (unsigned int)(fileMetadata->srcFileSize / DOWNLOAD_DATA_SIZE_THRESHOLD) + 1;
 
     Util::StreamAppender appender(dataStream, partNum, m_parallel, DOWNLOAD_DATA_SIZE_THRESHOLD);
+    fileMetadata->metrics.parts = partNum;
     std::vector<MultiDownloadCtx_a> downloadParts;
     for (unsigned int i = 0; i < partNum; i++)
     {
@@ -290,6 +465,7 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doMultiPartDownload(
             }
             else
             {
+                countThrottledRequest();
                 CXX_LOG_DEBUG("Download part %d FAILED, download size: %d",
                               ctx.m_partNumber, partSize);
                 ctx.m_outcome = RemoteStorageRequestOutcome::FAILED;
@@ -326,9 +502,19 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::doSingleDownload(
   if(errno == 0)
     return RemoteStorageRequestOutcome::SUCCESS;
 
+  countThrottledRequest();
   return RemoteStorageRequestOutcome ::FAILED;
 }
 
+void SnowflakeAzureClient::countThrottledRequest()
+{
+  // the blob client leaves the http status of a failed request in errno
+  if (errno == 503)
+  {
+    m_throttledRequests++;
+  }
+}
+
 RemoteStorageRequestOutcome SnowflakeAzureClient::GetRemoteFileMetadata(
   std::string *filePathFull, FileMetadata *fileMetadata)
 {
@@ -353,6 +539,7 @@ RemoteStorageRequestOutcome SnowflakeAzureClient::GetRemoteFileMetadata(
 
         fileMetadata->encryptionMetadata.cipherStreamSize = blobProperty.size;
         fileMetadata->srcFileSize = (long)blobProperty.size;
+        fileMetadata->remoteVersion = blobProperty.etag;
 
         return RemoteStorageRequestOutcome::SUCCESS;
     }
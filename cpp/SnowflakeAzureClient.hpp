@@ -14,6 +14,7 @@
 #include "storage_credential.h"
 #include "storage_account.h"
 #include "blob/blob_client.h"
+#include <atomic>
 #include <sstream>
 #include <string>
 
@@ -30,18 +31,13 @@ namespace Client
 {
 
 /**
- * Context passed to upload thread
+ * Context of a block uploaded by a thread of a block blob upload
  */
-
 struct MultiUploadCtx_a
 {
-  MultiUploadCtx_a(std::string &uploadId,
-    unsigned int partNumber,
-    std::string &key,
-    std::string &bucket)
-  {
-
-  }
+  MultiUploadCtx_a(const std::string &container,
+    const std::string &blob,
+    unsigned int partNumber);
 
   /// in memory buffer used to store current part data
   Util::ByteArrayStreamBuf *buf;
@@ -49,8 +45,21 @@ struct MultiUploadCtx_a
   /// part number
   unsigned int m_partNumber;
 
+  /// base64 block id, the same length for all the blocks of the blob
+  std::string m_blockId;
+
+  std::string m_container;
+
+  std::string m_blob;
+
   /// upload outcome
   RemoteStorageRequestOutcome m_outcome;
+
+  /// the stream ended before this block, so there is nothing to put
+  bool m_empty;
+
+  /// retries the block took
+  unsigned int m_retries;
 };
 
 struct MultiDownloadCtx_a
@@ -101,6 +110,36 @@ public:
   RemoteStorageRequestOutcome GetRemoteFileMetadata(
     std::string * filePathFull, FileMetadata *fileMetadata);
 
+  RemoteStorageRequestOutcome checkFileExists(FileMetadata *fileMetadata);
+
+  /**
+   * The SAS token of the blob client can't be replaced, so only a stage
+   * info with the same token is taken.
+   */
+  bool updateStageInfo(StageInfo *stageInfo);
+
+  unsigned long long getThrottledRequests()
+  {
+    return m_throttledRequests;
+  }
+
+  void setMaxRetries(unsigned int maxRetries)
+  {
+    m_maxRetries = maxRetries;
+  }
+
+  /**
+   * Pick the block size of a block blob upload. Every thread gets a block of
+   * its own, the blocks are no smaller than the upload threshold and no
+   * larger than the 100 MB Azure takes, unless the blob needs larger blocks
+   * to fit in the 50,000 blocks allowed.
+   * @param streamSize size of the data to upload
+   * @param threshold upload threshold given by the server
+   * @param parallel number of upload threads
+   */
+  static size_t chooseBlockSize(long long int streamSize, size_t threshold,
+                                unsigned int parallel);
+
 private:
 
 
@@ -109,9 +148,32 @@ private:
   Util::ThreadPool * m_threadPool;
   azure::storage_lite::blob_client_wrapper *m_blobclient;
 
+  /// client under the wrapper, its connections are kept and reused by the
+  /// requests of all the blocks
+  std::shared_ptr<azure::storage_lite::blob_client> m_blockClient;
+
+  /// buffers of the blocks being uploaded
+  Util::StreamBufferPool * m_blockBufferPool;
+
+  /// bytes of block buffers at most, 0 for one block per thread
+  const size_t m_blockBufferLimit;
+
+  unsigned int m_maxRetries;
+
+  /// SAS token the blob client was created with
+  std::string m_sasToken;
+
   const size_t m_uploadThreshold;
   unsigned int m_parallel;
 
+  /// requests failed with 503 server busy
+  std::atomic<unsigned long long> m_throttledRequests;
+
+  /**
+   * Count the request failed just now if the storage was too busy to take it
+   */
+  void countThrottledRequest();
+
   /**
    * Add snowflake specific metadata to the put object metadata.
    * This includes encryption metadata and source file
@@ -137,6 +199,9 @@ private:
   RemoteStorageRequestOutcome doMultiPartUpload(FileMetadata * fileMetadata,
                                     std::basic_iostream<char> *dataStream);
 
+  /**
+   * Put a block of a block blob, to be committed with the others at the end
+   */
   void uploadParts(MultiUploadCtx_a * uploadCtx);
 
   //RemoteStorageRequestOutcome handleError(const Aws::Client::AWSError<Aws::S3::S3Errors> &error);
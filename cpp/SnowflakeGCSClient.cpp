@@ -4,20 +4,55 @@
 
 #include "SnowflakeGCSClient.hpp"
 #include "FileMetadataInitializer.hpp"
+#include "FileTransferAgent.hpp"
 #include "EncryptionProvider.hpp"
 #include "util/Base64.hpp"
 #include "crypto/CipherStreamBuf.hpp"
+#include "crypto/Cryptor.hpp"
 #include "logger/SFLogger.hpp"
 #include "cJSON.h"
 #include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 namespace
 {
   static const std::string GCS_ENCRYPTIONDATAPROP = "x-goog-meta-encryptiondata";
   static const std::string GCS_MATDESC = "x-goog-meta-matdesc";
   static const std::string SFC_DIGEST = "sfc-digest";
+  static const std::string GCS_ACCESS_TOKEN = "GCS_ACCESS_TOKEN";
+  static const std::string GCS_DEFAULT_ENDPOINT = "storage.googleapis.com";
+
+  // sources of a compose request at most
+  static const unsigned long long GCS_MAX_COMPONENTS = 32;
+  static const unsigned long long COMPONENT_SIZE_UNIT = 1024 * 1024;
+
+  /**
+   * Percent encode a name of an object, its slashes kept as they are in the
+   * path of the XML API and encoded in the name of the JSON API.
+   */
+  std::string encodeObjectName(const std::string &name, bool keepSlash)
+  {
+    static const char *hex = "0123456789ABCDEF";
+    std::string encoded;
+    for (unsigned char c : name)
+    {
+      if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+          (keepSlash && c == '/'))
+      {
+        encoded.push_back((char)c);
+      }
+      else
+      {
+        encoded.push_back('%');
+        encoded.push_back(hex[c >> 4]);
+        encoded.push_back(hex[c & 0xf]);
+      }
+    }
+    return encoded;
+  }
 }
 
 namespace Snowflake
@@ -26,21 +61,76 @@ namespace Client
 {
 
 SnowflakeGCSClient::SnowflakeGCSClient(StageInfo *stageInfo, unsigned int parallel,
-  TransferConfig * transferConfig, IStatementPutGet* statement) :
+  size_t uploadThreshold, TransferConfig * transferConfig,
+  IStatementPutGet* statement) :
   m_stageInfo(stageInfo),
-  m_statement(statement)
+  m_statement(statement),
+  m_threadPool(nullptr),
+  m_partBufferPool(nullptr),
+  m_parallel(std::max(1u, std::min(parallel, std::thread::hardware_concurrency()))),
+  m_uploadThreshold(uploadThreshold),
+  m_partBufferLimit(transferConfig != nullptr ? transferConfig->multipartBufferLimit : 0),
+  m_maxRetries(0),
+  m_composeUploads(transferConfig != nullptr && transferConfig->composeGcsUploads)
 {
-  // Do nothing.
+  _critical_section_init(&m_poolMutex);
+  if (stageInfo != nullptr && stageInfo->credentials.count(GCS_ACCESS_TOKEN) &&
+      stageInfo->credentials[GCS_ACCESS_TOKEN] != nullptr)
+  {
+    m_accessToken = stageInfo->credentials[GCS_ACCESS_TOKEN];
+  }
 }
 
 SnowflakeGCSClient::~SnowflakeGCSClient()
 {
-  // Do nothing;
+  if (m_threadPool != nullptr)
+  {
+    delete m_threadPool;
+  }
+  if (m_partBufferPool != nullptr)
+  {
+    delete m_partBufferPool;
+  }
+  _critical_section_term(&m_poolMutex);
+}
+
+void SnowflakeGCSClient::initThreadPool()
+{
+  _critical_section_lock(&m_poolMutex);
+  if (m_threadPool == nullptr)
+  {
+    m_threadPool = new Util::ThreadPool(m_parallel);
+  }
+  if (m_partBufferPool == nullptr)
+  {
+    // more buffers than upload threads would never be used
+    m_partBufferPool = new Util::StreamBufferPool(m_parallel, m_partBufferLimit);
+  }
+  _critical_section_unlock(&m_poolMutex);
+}
+
+size_t SnowflakeGCSClient::chooseComponentSize(long long int streamSize,
+                                               size_t threshold)
+{
+  unsigned long long componentSize = std::max((unsigned long long)threshold,
+                                              COMPONENT_SIZE_UNIT);
+  componentSize = std::max(componentSize,
+    (unsigned long long)streamSize / (GCS_MAX_COMPONENTS - 1) + 1);
+  componentSize = (componentSize + COMPONENT_SIZE_UNIT - 1) /
+    COMPONENT_SIZE_UNIT * COMPONENT_SIZE_UNIT;
+  return (size_t)componentSize;
 }
 
 RemoteStorageRequestOutcome SnowflakeGCSClient::upload(FileMetadata *fileMetadata,
                                           std::basic_iostream<char> *dataStream)
 {
+  // a presigned url only takes the whole file in one request
+  if (m_composeUploads && !m_accessToken.empty() && m_uploadThreshold > 0 &&
+      fileMetadata->encryptionMetadata.cipherStreamSize > (long long)m_uploadThreshold)
+  {
+    return doCompositeUpload(fileMetadata, dataStream);
+  }
+
   CXX_LOG_DEBUG("Start upload for file %s",
     fileMetadata->srcFileToUpload.c_str());
 
@@ -60,9 +150,206 @@ RemoteStorageRequestOutcome SnowflakeGCSClient::upload(FileMetadata *fileMetadat
   return RemoteStorageRequestOutcome::SUCCESS;
 }
 
+std::string SnowflakeGCSClient::objectUrl(const std::string &bucket,
+                                          const std::string &name)
+{
+  std::string endpoint = m_stageInfo->endPoint.empty() ?
+    GCS_DEFAULT_ENDPOINT : m_stageInfo->endPoint;
+  return "https://" + endpoint + "/" + bucket + "/" + encodeObjectName(name, true);
+}
+
+std::vector<std::string> SnowflakeGCSClient::tokenHeaders(const char *contentType)
+{
+  std::vector<std::string> headers;
+  headers.push_back("Authorization: Bearer " + m_accessToken);
+  headers.push_back(std::string("Content-Type: ") + contentType);
+  return headers;
+}
+
+void SnowflakeGCSClient::deleteComponents(const std::string &bucket,
+                                          const std::vector<std::string> &names)
+{
+  std::vector<std::string> headers;
+  headers.push_back("Authorization: Bearer " + m_accessToken);
+  for (const std::string &name : names)
+  {
+    if (!m_statement->http_delete(objectUrl(bucket, name), headers))
+    {
+      // left to the lifecycle rules of the bucket
+      CXX_LOG_WARN("Failed to delete the component %s of a composite upload",
+                   name.c_str());
+    }
+  }
+}
+
+RemoteStorageRequestOutcome SnowflakeGCSClient::doCompositeUpload(
+  FileMetadata *fileMetadata,
+  std::basic_iostream<char>* dataStream)
+{
+  CXX_LOG_DEBUG("Start composite upload for file %s",
+                fileMetadata->srcFileToUpload.c_str());
+
+  initThreadPool();
+
+  std::string path = m_stageInfo->location + fileMetadata->destFileName;
+  size_t sep = path.find('/');
+  std::string bucket = path.substr(0, sep);
+  std::string name = sep == std::string::npos ? std::string() : path.substr(sep + 1);
+
+  // components of concurrent uploads of the same file must not collide
+  Crypto::CryptoIV random;
+  Crypto::Cryptor::generateIV(random, Crypto::CryptoRandomDevice::DEV_URANDOM);
+  char suffix[17];
+  for (int i = 0; i < 8; i++)
+  {
+    snprintf(suffix + i * 2, 3, "%02x", (unsigned char)random.data[i]);
+  }
+  std::string componentPrefix = name + ".sfc_component_" + suffix + "_";
+
+  // the last part may be empty, see StreamSplitter::getTotalParts()
+  long long streamSize = fileMetadata->encryptionMetadata.cipherStreamSize;
+  size_t componentSize = chooseComponentSize(streamSize, m_uploadThreshold);
+  Util::StreamSplitter splitter(dataStream, m_partBufferPool,
+                                (unsigned int)componentSize);
+  unsigned int totalParts = splitter.getTotalParts(streamSize);
+  CXX_LOG_INFO("Total file size: %lld, split into %d components of %llu bytes.",
+               streamSize, totalParts, (unsigned long long)componentSize);
+
+  std::vector<std::string> names(totalParts);
+  std::vector<bool> uploaded(totalParts, false);
+  std::vector<RemoteStorageRequestOutcome> outcomes(totalParts,
+    RemoteStorageRequestOutcome::FAILED);
+  std::vector<unsigned int> retries(totalParts, 0);
+
+  Util::JobGroup partJobs;
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    partJobs.AddJob(*m_threadPool, [&, i]()->void
+    {
+      int partId;
+      Util::ByteArrayStreamBuf *buf = splitter.FillAndGetBuf(partId);
+      long size = buf->getSize();
+      if (size == 0 && partId > 0)
+      {
+        outcomes[partId] = RemoteStorageRequestOutcome::SUCCESS;
+        splitter.ReleaseBuf(buf);
+        return;
+      }
+      names[partId] = componentPrefix + std::to_string(partId);
+      std::string url = objectUrl(bucket, names[partId]);
+      std::vector<std::string> headers = tokenHeaders("application/octet-stream");
+
+      char retryPartBuflog[200];
+      snprintf(retryPartBuflog, sizeof(retryPartBuflog),
+               "Retrying component=%u partId=%d.", i, partId);
+      RetryContext partRetryCtx(retryPartBuflog, m_maxRetries);
+      do
+      {
+        //Sleeps only when its a retry
+        partRetryCtx.waitForNextRetry();
+        // rewind the component for each try
+        buf->updateSize(size);
+        std::basic_iostream<char> partStream(buf);
+        std::string respHeaders;
+        outcomes[partId] = m_statement->http_put(url, headers, partStream, size,
+                                                 respHeaders) ?
+          RemoteStorageRequestOutcome::SUCCESS : RemoteStorageRequestOutcome::FAILED;
+      } while (partRetryCtx.isRetryable(outcomes[partId]));
+      uploaded[partId] = outcomes[partId] == RemoteStorageRequestOutcome::SUCCESS;
+      retries[partId] = partRetryCtx.getRetries();
+      splitter.ReleaseBuf(buf);
+    });
+  }
+  partJobs.Wait();
+
+  fileMetadata->metrics.parts = totalParts;
+  std::vector<std::string> components;
+  RemoteStorageRequestOutcome outcome = RemoteStorageRequestOutcome::SUCCESS;
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    fileMetadata->metrics.retries += retries[i];
+    if (uploaded[i])
+    {
+      components.push_back(names[i]);
+    }
+    if (outcomes[i] != RemoteStorageRequestOutcome::SUCCESS)
+    {
+      outcome = outcomes[i];
+    }
+  }
+  if (outcome != RemoteStorageRequestOutcome::SUCCESS)
+  {
+    CXX_LOG_ERROR("Composite upload of file %s failed",
+                  fileMetadata->srcFileToUpload.c_str());
+    deleteComponents(bucket, components);
+    return outcome;
+  }
+
+  char ivEncoded[64];
+  Util::Base64::encode(fileMetadata->encryptionMetadata.iv.data,
+                       Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES),
+                       ivEncoded);
+  std::string ivEncodedStr(ivEncoded, Util::Base64::encodedLength(
+    Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES)));
+
+  cJSON *compose = snowflake_cJSON_CreateObject();
+  cJSON *sources = snowflake_cJSON_AddArrayToObject(compose, "sourceObjects");
+  for (const std::string &component : components)
+  {
+    cJSON *source = snowflake_cJSON_CreateObject();
+    snowflake_cJSON_AddStringToObject(source, "name", component.c_str());
+    snowflake_cJSON_AddItemToArray(sources, source);
+  }
+  cJSON *destination = snowflake_cJSON_AddObjectToObject(compose, "destination");
+  snowflake_cJSON_AddStringToObject(destination, "contentType",
+                                    "application/octet-stream");
+  cJSON *metadata = snowflake_cJSON_AddObjectToObject(destination, "metadata");
+  snowflake_cJSON_AddStringToObject(metadata, "encryptiondata",
+    buildEncryptionMetadataJSON(fileMetadata->encryptionMetadata.enKekEncoded,
+                                ivEncodedStr).c_str());
+  snowflake_cJSON_AddStringToObject(metadata, "matdesc",
+    fileMetadata->encryptionMetadata.matDesc.c_str());
+  snowflake_cJSON_AddStringToObject(metadata, SFC_DIGEST.c_str(),
+    fileMetadata->sha256Digest.c_str());
+  char *composeText = snowflake_cJSON_PrintUnformatted(compose);
+  std::string composeBody(composeText);
+  snowflake_cJSON_free(composeText);
+  snowflake_cJSON_Delete(compose);
+
+  std::string endpoint = m_stageInfo->endPoint.empty() ?
+    GCS_DEFAULT_ENDPOINT : m_stageInfo->endPoint;
+  std::string composeUrl = "https://" + endpoint + "/storage/v1/b/" + bucket +
+    "/o/" + encodeObjectName(name, false) + "/compose";
+  std::string respHeaders, respBody;
+  bool composed = m_statement->http_post(composeUrl,
+                                         tokenHeaders("application/json"),
+                                         composeBody, respHeaders, respBody);
+  deleteComponents(bucket, components);
+  if (!composed)
+  {
+    CXX_LOG_ERROR("Compose of file %s failed: %s",
+                  fileMetadata->srcFileToUpload.c_str(), respBody.c_str());
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+
+  CXX_LOG_DEBUG("Composite upload of file %s from %d components succeed",
+                fileMetadata->srcFileToUpload.c_str(), (int)components.size());
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
 RemoteStorageRequestOutcome SnowflakeGCSClient::download(
   FileMetadata *fileMetadata,
   std::basic_iostream<char>* dataStream)
+{
+  if (fileMetadata->srcFileSize > DOWNLOAD_DATA_SIZE_THRESHOLD)
+    return doMultiPartDownload(fileMetadata, dataStream);
+  else
+    return doSingleDownload(fileMetadata, dataStream);
+}
+
+RemoteStorageRequestOutcome SnowflakeGCSClient::doSingleDownload(
+  FileMetadata *fileMetadata,
+  std::basic_iostream<char>* dataStream)
 {
   CXX_LOG_DEBUG("Start download for file %s",
     fileMetadata->srcFileName.c_str());
@@ -82,6 +369,76 @@ RemoteStorageRequestOutcome SnowflakeGCSClient::download(
   return RemoteStorageRequestOutcome::SUCCESS;
 }
 
+RemoteStorageRequestOutcome SnowflakeGCSClient::doMultiPartDownload(
+  FileMetadata *fileMetadata,
+  std::basic_iostream<char>* dataStream)
+{
+  CXX_LOG_DEBUG("Start multi part download for file %s, parallel: %d",
+               fileMetadata->srcFileName.c_str(), m_parallel);
+
+  initThreadPool();
+
+  unsigned int partNum = (unsigned int)((fileMetadata->srcFileSize - 1) /
+    DOWNLOAD_DATA_SIZE_THRESHOLD) + 1;
+  Util::StreamAppender appender(dataStream, partNum, m_parallel, DOWNLOAD_DATA_SIZE_THRESHOLD);
+  fileMetadata->metrics.parts = partNum;
+  std::vector<RemoteStorageRequestOutcome> outcomes(partNum,
+    RemoteStorageRequestOutcome::FAILED);
+
+  for (unsigned int i = 0; i < partNum; i++)
+  {
+    m_threadPool->AddJob([&, i]()-> void {
+      long long start = (long long)i * DOWNLOAD_DATA_SIZE_THRESHOLD;
+      long partSize = (long)std::min((long long)DOWNLOAD_DATA_SIZE_THRESHOLD,
+                                     fileMetadata->srcFileSize - start);
+      int tid = m_threadPool->GetThreadIdx();
+      Util::ByteArrayStreamBuf * buf = appender.GetBuffer(tid);
+
+      std::stringstream rangeHeader;
+      rangeHeader << "Range: bytes=" << start << '-' << start + partSize - 1;
+      std::vector<std::string> reqHeaders;
+      reqHeaders.push_back(rangeHeader.str());
+      std::string headerString;
+
+      CXX_LOG_DEBUG("Start downloading part %d, %s", i, reqHeaders[0].c_str());
+      buf->updateSize(partSize);
+      std::basic_iostream<char> partStream(buf);
+      bool success = m_statement->http_get(fileMetadata->presignedUrl,
+                                           reqHeaders,
+                                           &partStream,
+                                           headerString,
+                                           false);
+      // a server ignoring the range sends the whole object, which overflows
+      // the buffer and fails the stream
+      if (success && partStream.good() && buf->getPutSize() == partSize)
+      {
+        outcomes[i] = RemoteStorageRequestOutcome::SUCCESS;
+      }
+      else
+      {
+        CXX_LOG_ERROR("Download part %d of file %s failed", i,
+                     fileMetadata->srcFileName.c_str());
+        // the parts after this one still wait for their turn to be written
+        partSize = 0;
+      }
+      buf->updateSize(partSize);
+      appender.WritePartToOutputStream(tid, i);
+    });
+  }
+
+  m_threadPool->WaitAll();
+
+  for (unsigned int i = 0; i < partNum; i++)
+  {
+    if (outcomes[i] != RemoteStorageRequestOutcome::SUCCESS)
+    {
+      return outcomes[i];
+    }
+  }
+
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
 RemoteStorageRequestOutcome SnowflakeGCSClient::GetRemoteFileMetadata(
   std::string *filePathFull, FileMetadata *fileMetadata)
 {
@@ -108,6 +465,13 @@ RemoteStorageRequestOutcome SnowflakeGCSClient::GetRemoteFileMetadata(
 
   fileMetadata->srcFileSize = strtol(headers["Content-Length"].c_str(), NULL, 10);
 
+  // header values keep the space after the colon and the carriage return
+  std::string etag = headers.count("ETag") ? headers["ETag"] : headers["etag"];
+  size_t start = etag.find_first_not_of(" \t");
+  size_t end = etag.find_last_not_of(" \t\r");
+  fileMetadata->remoteVersion = start == std::string::npos ? std::string() :
+    etag.substr(start, end - start + 1);
+
   return RemoteStorageRequestOutcome::SUCCESS;
 }
 
@@ -10,6 +10,7 @@
 #include "snowflake/PutGetParseResponse.hpp"
 #include "FileMetadata.hpp"
 #include "util/ByteArrayStreamBuf.hpp"
+#include "util/ThreadPool.hpp"
 #include <map>
 
 #ifdef _WIN32
@@ -31,6 +32,7 @@ class SnowflakeGCSClient : public Snowflake::Client::IStorageClient
 {
 public:
   SnowflakeGCSClient(StageInfo *stageInfo, unsigned int parallel,
+                    size_t uploadThreshold,
                     TransferConfig * transferConfig,
                     IStatementPutGet* statement);
 
@@ -57,7 +59,53 @@ public:
     return true;
   }
 
+  void setMaxRetries(unsigned int maxRetries) override
+  {
+    m_maxRetries = maxRetries;
+  }
+
+  /**
+   * Pick the component size of a composite upload. Components start at the
+   * upload threshold and grow so that the file is composed from no more
+   * than the 32 components a compose request takes.
+   * @param streamSize size of the data to upload
+   * @param threshold upload threshold given by the server
+   */
+  static size_t chooseComponentSize(long long int streamSize, size_t threshold);
+
 private:
+  /**
+   * Upload a large file in components on several threads at once with the
+   * access token of the stage, each component retried on its own, then
+   * compose them into the file and delete them.
+   */
+  RemoteStorageRequestOutcome doCompositeUpload(FileMetadata *fileMetadata,
+    std::basic_iostream<char>* dataStream);
+
+  /// delete the components of a composite upload, failures are only logged
+  void deleteComponents(const std::string &bucket,
+                        const std::vector<std::string> &names);
+
+  /// XML API url of an object of the stage
+  std::string objectUrl(const std::string &bucket, const std::string &name);
+
+  /// headers authorizing a request with the access token of the stage
+  std::vector<std::string> tokenHeaders(const char *contentType);
+
+  RemoteStorageRequestOutcome doSingleDownload(FileMetadata *fileMetadata,
+    std::basic_iostream<char>* dataStream);
+
+  /**
+   * Download the object in byte ranges on several threads, appending the
+   * ranges to the stream in order.
+   */
+  RemoteStorageRequestOutcome doMultiPartDownload(FileMetadata *fileMetadata,
+    std::basic_iostream<char>* dataStream);
+
+  /// create the thread pool on the first multipart download or composite
+  /// upload, with the component buffers
+  void initThreadPool();
+
   /**
   * Add snowflake specific metadata to the put object metadata.
   * This includes encryption metadata and source file
@@ -85,6 +133,30 @@ private:
   StageInfo * m_stageInfo;
 
   IStatementPutGet* m_statement;
+
+  Util::ThreadPool * m_threadPool;
+
+  /// component buffers shared by the composite uploads running at once
+  Util::StreamBufferPool * m_partBufferPool;
+
+  /// mutex protecting the creation of the thread pool and buffers
+  SF_CRITICAL_SECTION_HANDLE m_poolMutex;
+
+  unsigned int m_parallel;
+
+  const size_t m_uploadThreshold;
+
+  /// max bytes of the component buffers, 0 for one per upload thread
+  size_t m_partBufferLimit;
+
+  unsigned int m_maxRetries;
+
+  /// true to upload the large files in components, see
+  /// TransferConfig::composeGcsUploads
+  bool m_composeUploads;
+
+  /// access token of the stage, empty if the stage only gives presigned urls
+  std::string m_accessToken;
 };
 }
 }
@@ -10,9 +10,11 @@
 #include "util/ByteArrayStreamBuf.hpp"
 #include "util/Proxy.hpp"
 #include "crypto/CipherStreamBuf.hpp"
+#include "crypto/Cryptor.hpp"
 #include "logger/SFAwsLogger.hpp"
 #include "logger/SFLogger.hpp"
 #include <aws/core/Aws.h>
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
 #include <aws/s3/model/CreateMultipartUploadRequest.h>
 #include <aws/s3/model/CompleteMultipartUploadRequest.h>
 #include <aws/s3/model/GetObjectRequest.h>
@@ -23,6 +25,7 @@
 #include <aws/core/utils/logging/DefaultLogSystem.h>
 #include <aws/core/utils/logging/ConsoleLogSystem.h>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -39,6 +42,14 @@
 #define AWS_TOKEN "AWS_TOKEN"
 #define SFC_DIGEST "sfc-digest"
 
+#define S3_MAX_PARTS 10000
+#define PART_SIZE_UNIT (1024 * 1024)
+/* s3 parts but the last must be 5 MB or more */
+#define MIN_PART_SIZE (8 * 1024 * 1024)
+/* parts don't grow past this for throughput alone */
+#define MAX_GROWN_PART_SIZE (256 * 1024 * 1024)
+#define PART_TARGET_DURATION_MS 2000
+
 namespace
 {
   struct awsdk_init
@@ -73,9 +84,15 @@ SnowflakeS3Client::SnowflakeS3Client(StageInfo *stageInfo,
                                      TransferConfig *transferConfig) :
   m_stageInfo(stageInfo),
   m_threadPool(nullptr),
+  m_partBufferPool(nullptr),
   m_uploadThreshold(uploadThreshold),
-  m_parallel(std::min(parallel, std::thread::hardware_concurrency()))
+  m_parallel(std::min(parallel, std::thread::hardware_concurrency())),
+  m_partBufferLimit(transferConfig != nullptr ? transferConfig->multipartBufferLimit : 0),
+  m_partBytesPerSec(0),
+  m_checkpoint(nullptr)
 {
+  _critical_section_init(&m_poolMutex);
+
   Aws::String caFile;
   if ((transferConfig != nullptr) && (transferConfig->caBundleFile != nullptr))
   {
@@ -107,9 +124,20 @@ SnowflakeS3Client::SnowflakeS3Client(StageInfo *stageInfo,
   clientConfiguration.caFile = caFile;
   clientConfiguration.requestTimeoutMs = 40000;
   clientConfiguration.connectTimeoutMs = 30000;
-
-  // FIPS mode check
-  if (!(m_stageInfo->endPoint.empty())) {
+  m_retryStrategy = std::make_shared<ThrottleCountingRetryStrategy>();
+  clientConfiguration.retryStrategy = m_retryStrategy;
+
+  // An endpoint given with its scheme is a local S3 compatible storage, as
+  // used in the transfer benchmarks, which is addressed by path
+  bool virtualAddressing = true;
+  const std::string &endPoint = m_stageInfo->endPoint;
+  size_t schemeEnd = endPoint.find("://");
+  if (schemeEnd != std::string::npos) {
+    clientConfiguration.scheme = endPoint.compare(0, schemeEnd, "http") == 0 ?
+      Aws::Http::Scheme::HTTP : Aws::Http::Scheme::HTTPS;
+    clientConfiguration.endpointOverride = Aws::String(endPoint.substr(schemeEnd + 3));
+    virtualAddressing = false;
+  } else if (!(m_stageInfo->endPoint.empty())) {
     // FIPS mode is enabled, use the endpoint provided by GS directly
     clientConfiguration.endpointOverride = Aws::String(stageInfo->endPoint);
   } else if (transferConfig != nullptr && transferConfig->useS3regionalUrl) {
@@ -145,11 +173,12 @@ SnowflakeS3Client::SnowflakeS3Client(StageInfo *stageInfo,
     Aws::String(stageInfo->credentials.at(AWS_KEY_ID)),
     Aws::String(stageInfo->credentials.at(AWS_SECRET_KEY)),
     Aws::String(stageInfo->credentials.at(AWS_TOKEN)));
+  m_credentialsProvider = std::make_shared<StageCredentialsProvider>(credentials);
 
-  s3Client = new Aws::S3::S3Client(credentials,
+  s3Client = new Aws::S3::S3Client(m_credentialsProvider,
           clientConfiguration,
           Aws::Client::AWSAuthV4Signer::PayloadSigningPolicy::Never,
-          true); // explicitly set virtual addressing style to be true
+          virtualAddressing);
 
   //Ensure the stage location ended with /
   if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
@@ -160,6 +189,67 @@ SnowflakeS3Client::SnowflakeS3Client(StageInfo *stageInfo,
   CXX_LOG_TRACE("Successfully created s3 client. End of constructor.");
 }
 
+bool SnowflakeS3Client::updateStageInfo(StageInfo *stageInfo)
+{
+  m_stageInfo = stageInfo;
+  if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
+  {
+    m_stageInfo->location.push_back('/');
+  }
+  return refreshCredentials(stageInfo);
+}
+
+bool SnowflakeS3Client::refreshCredentials(StageInfo *stageInfo)
+{
+  m_credentialsProvider->setCredentials(Aws::Auth::AWSCredentials(
+    Aws::String(stageInfo->credentials.at(AWS_KEY_ID)),
+    Aws::String(stageInfo->credentials.at(AWS_SECRET_KEY)),
+    Aws::String(stageInfo->credentials.at(AWS_TOKEN))));
+  CXX_LOG_DEBUG("S3 client credentials updated in place");
+  return true;
+}
+
+StageCredentialsProvider::StageCredentialsProvider(
+  const Aws::Auth::AWSCredentials &credentials) :
+  m_credentials(credentials)
+{
+  _critical_section_init(&m_credentialsMutex);
+}
+
+StageCredentialsProvider::~StageCredentialsProvider()
+{
+  _critical_section_term(&m_credentialsMutex);
+}
+
+Aws::Auth::AWSCredentials StageCredentialsProvider::GetAWSCredentials()
+{
+  _critical_section_lock(&m_credentialsMutex);
+  Aws::Auth::AWSCredentials credentials = m_credentials;
+  _critical_section_unlock(&m_credentialsMutex);
+  return credentials;
+}
+
+void StageCredentialsProvider::setCredentials(
+  const Aws::Auth::AWSCredentials &credentials)
+{
+  _critical_section_lock(&m_credentialsMutex);
+  m_credentials = credentials;
+  _critical_section_unlock(&m_credentialsMutex);
+}
+
+bool ThrottleCountingRetryStrategy::ShouldRetry(
+  const Aws::Client::AWSError<Aws::Client::CoreErrors>& error,
+  long attemptedRetries) const
+{
+  if (error.GetErrorType() == Aws::Client::CoreErrors::SLOW_DOWN ||
+      error.GetErrorType() == Aws::Client::CoreErrors::THROTTLING ||
+      error.GetResponseCode() == Aws::Http::HttpResponseCode::SERVICE_UNAVAILABLE)
+  {
+    m_throttledRequests++;
+  }
+  return DefaultRetryStrategy::ShouldRetry(error, attemptedRetries);
+}
+
 SnowflakeS3Client::~SnowflakeS3Client()
 {
   delete s3Client;
@@ -167,6 +257,48 @@ SnowflakeS3Client::~SnowflakeS3Client()
   {
     delete m_threadPool;
   }
+  if (m_partBufferPool != nullptr)
+  {
+    delete m_partBufferPool;
+  }
+  _critical_section_term(&m_poolMutex);
+}
+
+void SnowflakeS3Client::initThreadPool()
+{
+  _critical_section_lock(&m_poolMutex);
+  if (m_threadPool == nullptr)
+  {
+    m_threadPool = new Util::ThreadPool(m_parallel);
+  }
+  if (m_partBufferPool == nullptr)
+  {
+    // more buffers than upload threads would never be used
+    m_partBufferPool = new Util::StreamBufferPool(m_parallel, m_partBufferLimit);
+  }
+  _critical_section_unlock(&m_poolMutex);
+}
+
+size_t SnowflakeS3Client::choosePartSize(long long int streamSize, size_t threshold,
+                                         unsigned int parallel,
+                                         unsigned long long bytesPerSec)
+{
+  unsigned long long partSize = threshold;
+  if (bytesPerSec > 0)
+  {
+    unsigned long long target = bytesPerSec * PART_TARGET_DURATION_MS / 1000;
+    partSize = std::max(partSize, std::min(target, (unsigned long long)MAX_GROWN_PART_SIZE));
+  }
+  if (parallel > 0)
+  {
+    unsigned long long perThread = (unsigned long long)streamSize / parallel;
+    partSize = std::min(partSize, std::max(perThread, (unsigned long long)MIN_PART_SIZE));
+  }
+  // the last part may be empty, see StreamSplitter::getTotalParts()
+  partSize = std::max(partSize,
+                      (unsigned long long)streamSize / (S3_MAX_PARTS - 1) + 1);
+  partSize = (partSize + PART_SIZE_UNIT - 1) / PART_SIZE_UNIT * PART_SIZE_UNIT;
+  return (size_t)partSize;
 }
 
 RemoteStorageRequestOutcome SnowflakeS3Client::upload(FileMetadata *fileMetadata,
@@ -175,28 +307,9 @@ RemoteStorageRequestOutcome SnowflakeS3Client::upload(FileMetadata *fileMetadata
   // first call metadata request to deduplicate files
   // If overWrite is true we do not perform file exist check.
   CXX_LOG_DEBUG("Entrance S3 upload.");
-  if(! fileMetadata->overWrite ) {
-    CXX_LOG_DEBUG("Check if File already exists");
-    Aws::S3::Model::HeadObjectRequest headObjectRequest;
-
-      std::string bucket, key;
-      std::string filePathFull = m_stageInfo->location
-                                 + fileMetadata->destFileName;
-      extractBucketAndKey(&filePathFull, bucket, key);
-      headObjectRequest.SetBucket(bucket);
-      headObjectRequest.SetKey(key);
-
-      Aws::S3::Model::HeadObjectOutcome outcome =
-              s3Client->HeadObject(headObjectRequest);
-
-      if (outcome.IsSuccess()) {
-          CXX_LOG_DEBUG("File %s already exists in the staging area. skip upload", fileMetadata->srcFileToUpload.c_str());
-          return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
-      } else {
-          CXX_LOG_WARN("Listing file metadata failed: %s",
-                       outcome.GetError().GetMessage().c_str());
-      }
-    CXX_LOG_DEBUG("End check file already exists.");
+  if(! fileMetadata->overWrite &&
+     checkFileExists(fileMetadata) == RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE) {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
   }
   if (fileMetadata->srcFileSize > m_uploadThreshold)
     return doMultiPartUpload(fileMetadata, dataStream);
@@ -204,6 +317,30 @@ RemoteStorageRequestOutcome SnowflakeS3Client::upload(FileMetadata *fileMetadata
     return doSingleUpload(fileMetadata, dataStream);
 }
 
+RemoteStorageRequestOutcome SnowflakeS3Client::checkFileExists(FileMetadata *fileMetadata)
+{
+  CXX_LOG_DEBUG("Check if File already exists");
+  Aws::S3::Model::HeadObjectRequest headObjectRequest;
+
+  std::string bucket, key;
+  std::string filePathFull = m_stageInfo->location
+                             + fileMetadata->destFileName;
+  extractBucketAndKey(&filePathFull, bucket, key);
+  headObjectRequest.SetBucket(bucket);
+  headObjectRequest.SetKey(key);
+
+  Aws::S3::Model::HeadObjectOutcome outcome =
+          s3Client->HeadObject(headObjectRequest);
+
+  if (outcome.IsSuccess()) {
+    CXX_LOG_DEBUG("File %s already exists in the staging area. skip upload", fileMetadata->srcFileName.c_str());
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+  CXX_LOG_WARN("Listing file metadata failed: %s",
+               outcome.GetError().GetMessage().c_str());
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
 RemoteStorageRequestOutcome SnowflakeS3Client::doSingleUpload(FileMetadata *fileMetadata,
   std::basic_iostream<char> *dataStream)
 {
@@ -255,10 +392,20 @@ void Snowflake::Client::SnowflakeS3Client::uploadParts(MultiUploadCtx * uploadCt
   uploadPartRequest.SetUploadId(uploadCtx->m_uploadId);
   uploadPartRequest.SetPartNumber(uploadCtx->m_partNumber);
 
+  auto start = std::chrono::steady_clock::now();
   Aws::S3::Model::UploadPartOutcome outcome = s3Client->UploadPart(uploadPartRequest);
 
   if (outcome.IsSuccess())
   {
+    long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+    if (elapsedMs > 0)
+    {
+      unsigned long long bytesPerSec =
+        (unsigned long long)uploadCtx->buf->getSize() * 1000 / elapsedMs;
+      unsigned long long average = m_partBytesPerSec;
+      m_partBytesPerSec = average == 0 ? bytesPerSec : (average * 3 + bytesPerSec) / 4;
+    }
     uploadCtx->m_outcome = RemoteStorageRequestOutcome::SUCCESS;
     uploadCtx->m_etag = outcome.GetResult().GetETag();
     CXX_LOG_INFO("Upload parts request succeed. part number %d, etag %s",
@@ -267,6 +414,25 @@ void Snowflake::Client::SnowflakeS3Client::uploadParts(MultiUploadCtx * uploadCt
   else
   {
     uploadCtx->m_outcome = handleError(outcome.GetError());
+    uploadCtx->m_uploadMissing =
+      outcome.GetError().GetErrorType() == Aws::S3::S3Errors::NO_SUCH_UPLOAD;
+  }
+}
+
+void Snowflake::Client::SnowflakeS3Client::abortMultiPartUpload(
+  const std::string &bucket, const std::string &key, const std::string &uploadId)
+{
+  Aws::S3::Model::AbortMultipartUploadRequest abortRequest;
+  abortRequest.WithBucket(bucket)
+              .WithKey(key)
+              .WithUploadId(uploadId);
+
+  Aws::S3::Model::AbortMultipartUploadOutcome outcome =
+    s3Client->AbortMultipartUpload(abortRequest);
+  if (!outcome.IsSuccess())
+  {
+    CXX_LOG_WARN("Failed to abort multi part upload %s: %s", uploadId.c_str(),
+                 outcome.GetError().GetMessage().c_str());
   }
 }
 
@@ -276,10 +442,7 @@ RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartUpload(FileMetadata *f
   CXX_LOG_DEBUG("Start multi part upload for file %s",
                fileMetadata->srcFileToUpload.c_str());
 
-  if (m_threadPool == nullptr)
-  {
-    m_threadPool = new Util::ThreadPool(m_parallel);
-  }
+  initThreadPool();
 
   std::map<std::string, std::string> userMetadata;
   addUserMetadata(&userMetadata, fileMetadata);
@@ -288,97 +451,185 @@ RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartUpload(FileMetadata *f
   std::string fileFullPath = m_stageInfo->location + fileMetadata->destFileName;
   extractBucketAndKey(&fileFullPath, bucket, key);
 
-  Aws::S3::Model::CreateMultipartUploadRequest request;
-  request.WithBucket(bucket)
-    .WithKey(key)
-    .WithContentType(CONTENT_TYPE_OCTET_STREAM)
-    .WithMetadata(userMetadata) ;
+  // The parts of the files uploaded at once share the threads and buffers
+  // of this client, queued in file and part order
+  size_t partSize = choosePartSize(fileMetadata->encryptionMetadata.cipherStreamSize,
+                                   m_uploadThreshold, m_parallel, m_partBytesPerSec);
 
-  auto createMultiPartResp = s3Client->CreateMultipartUpload(request);
-  if (createMultiPartResp.IsSuccess())
+  // an upload of the same data encrypted the same way goes on from the parts
+  // completed, any other upload to the path is given up
+  Util::TransferCheckpoint::Entry checkpoint;
+  Aws::String uploadId;
+  if (m_checkpoint && m_checkpoint->lookup(fileFullPath, checkpoint))
   {
-    Aws::String uploadId = createMultiPartResp.GetResult().GetUploadId();
+    if (checkpoint.digest == fileMetadata->sha256Digest &&
+        checkpoint.enKekEncoded == fileMetadata->encryptionMetadata.enKekEncoded &&
+        checkpoint.size == fileMetadata->encryptionMetadata.cipherStreamSize)
+    {
+      uploadId = Aws::String(checkpoint.uploadId.c_str());
+      partSize = checkpoint.partSize;
+      CXX_LOG_INFO("Resume multi part upload %s of file %s, %d parts completed.",
+                   uploadId.c_str(), fileMetadata->srcFileToUpload.c_str(),
+                   (int)checkpoint.parts.size());
+    }
+    else
+    {
+      CXX_LOG_INFO("Abort multi part upload %s of a different file to %s.",
+                   checkpoint.uploadId.c_str(), fileMetadata->destFileName.c_str());
+      abortMultiPartUpload(bucket, key, checkpoint.uploadId);
+      m_checkpoint->remove(fileFullPath);
+      checkpoint = Util::TransferCheckpoint::Entry();
+    }
+  }
+
+  if (uploadId.empty())
+  {
+    Aws::S3::Model::CreateMultipartUploadRequest request;
+    request.WithBucket(bucket)
+      .WithKey(key)
+      .WithContentType(CONTENT_TYPE_OCTET_STREAM)
+      .WithMetadata(userMetadata) ;
+
+    auto createMultiPartResp = s3Client->CreateMultipartUpload(request);
+    if (!createMultiPartResp.IsSuccess())
+    {
+      CXX_LOG_DEBUG("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
+      return handleError(createMultiPartResp.GetError());
+    }
+
+    uploadId = createMultiPartResp.GetResult().GetUploadId();
     CXX_LOG_DEBUG("Create multi part upload request succeed, uploadId: %s",
                   uploadId.c_str());
 
-    Util::StreamSplitter splitter(dataStream, m_parallel, m_uploadThreshold);
-    unsigned int totalParts = splitter.getTotalParts(
-      fileMetadata->encryptionMetadata.cipherStreamSize);
-    CXX_LOG_INFO("Total file size: %d, split into %d parts.",
-                fileMetadata->encryptionMetadata.cipherStreamSize, totalParts);
+    if (m_checkpoint)
+    {
+      checkpoint.uploadId = uploadId.c_str();
+      checkpoint.size = fileMetadata->encryptionMetadata.cipherStreamSize;
+      checkpoint.partSize = partSize;
+      checkpoint.digest = fileMetadata->sha256Digest;
+      checkpoint.enKekEncoded = fileMetadata->encryptionMetadata.enKekEncoded;
+      checkpoint.iv = userMetadata[AMZ_IV];
+      checkpoint.matDesc = fileMetadata->encryptionMetadata.matDesc;
+      m_checkpoint->start(fileFullPath, checkpoint);
+    }
+  }
+
+  Util::StreamSplitter splitter(dataStream, m_partBufferPool, (unsigned int)partSize);
+  unsigned int totalParts = splitter.getTotalParts(
+    fileMetadata->encryptionMetadata.cipherStreamSize);
+  CXX_LOG_INFO("Total file size: %lld, split into %d parts of %lu bytes.",
+              fileMetadata->encryptionMetadata.cipherStreamSize, totalParts,
+              (unsigned long)partSize);
 
-    std::vector<MultiUploadCtx> uploadParts;
-    uploadParts.reserve(totalParts);
+  std::vector<MultiUploadCtx> uploadParts;
+  uploadParts.reserve(totalParts);
 
-    for (unsigned int i = 0; i < totalParts; i++)
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    uploadParts.emplace_back(uploadId, i+1, key, bucket);
+    auto completed = checkpoint.parts.find(i+1);
+    if (completed != checkpoint.parts.end())
     {
-      uploadParts.emplace_back(uploadId, i+1, key, bucket);
+      uploadParts.back().m_etag = Aws::String(completed->second.c_str());
+      uploadParts.back().m_outcome = RemoteStorageRequestOutcome::SUCCESS;
     }
+  }
 
-    for (unsigned int i = 0; i < totalParts; i++)
-    {
-      m_threadPool->AddJob([&splitter, i, this, &uploadParts]()->void
+  Util::JobGroup partJobs;
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    partJobs.AddJob(*m_threadPool, [&splitter, i, this, &uploadParts, &fileFullPath]()->void
+                         {
+                           int tid = m_threadPool->GetThreadIdx();
+                           int partId;
+                           Util::ByteArrayStreamBuf * buf = splitter.FillAndGetBuf(partId);
+                           // the data of a part completed before is still read,
+                           // the encryption can only go through the stream in order
+                           if (!uploadParts[partId].m_etag.empty())
                            {
-                             int tid = m_threadPool->GetThreadIdx();
-                             int partId;
-                             Util::ByteArrayStreamBuf * buf = splitter.FillAndGetBuf(tid, partId);
-                             uploadParts[partId].buf = buf;
-                             char retryPartBuflog[200];
-                             sprintf(retryPartBuflog, "Retrying partNumber=%d threadID=%d partId=%d.", i, tid, partId);
-                             RetryContext partRetryCtx(retryPartBuflog, m_maxRetries);
-                             do
-                             {
-                               //Sleeps only when its a retry
-                               partRetryCtx.waitForNextRetry();
-                               this->uploadParts(&uploadParts[partId]);
-                             } while(partRetryCtx.isRetryable(uploadParts[partId].m_outcome));
-                           });
-    }
+                             splitter.ReleaseBuf(buf);
+                             return;
+                           }
+                           uploadParts[partId].buf = buf;
+                           char retryPartBuflog[200];
+                           sprintf(retryPartBuflog, "Retrying partNumber=%d threadID=%d partId=%d.", i, tid, partId);
+                           RetryContext partRetryCtx(retryPartBuflog, m_maxRetries);
+                           do
+                           {
+                             //Sleeps only when its a retry
+                             partRetryCtx.waitForNextRetry();
+                             this->uploadParts(&uploadParts[partId]);
+                           } while(partRetryCtx.isRetryable(uploadParts[partId].m_outcome));
+                           uploadParts[partId].m_retries = partRetryCtx.getRetries();
+                           splitter.ReleaseBuf(buf);
+                           uploadParts[partId].buf = nullptr;
+                           if (m_checkpoint &&
+                               uploadParts[partId].m_outcome == RemoteStorageRequestOutcome::SUCCESS)
+                           {
+                             m_checkpoint->completePart(fileFullPath,
+                                                        uploadParts[partId].m_partNumber,
+                                                        uploadParts[partId].m_etag.c_str());
+                           }
+                         });
+  }
 
-    m_threadPool->WaitAll();
+  partJobs.Wait();
 
-    Aws::S3::Model::CompletedMultipartUpload completedMultipartUpload;
-    for (unsigned int i=0; i< totalParts; i++)
+  fileMetadata->metrics.parts = totalParts;
+  Aws::S3::Model::CompletedMultipartUpload completedMultipartUpload;
+  for (unsigned int i=0; i< totalParts; i++)
+  {
+    fileMetadata->metrics.retries += uploadParts[i].m_retries;
+    if (uploadParts[i].m_outcome == RemoteStorageRequestOutcome::SUCCESS)
     {
-      if (uploadParts[i].m_outcome == RemoteStorageRequestOutcome::SUCCESS)
-      {
-        Aws::S3::Model::CompletedPart completedPart;
-        completedPart.WithETag(uploadParts[i].m_etag)
-          .WithPartNumber(uploadParts[i].m_partNumber);
+      Aws::S3::Model::CompletedPart completedPart;
+      completedPart.WithETag(uploadParts[i].m_etag)
+        .WithPartNumber(uploadParts[i].m_partNumber);
 
-        completedMultipartUpload.AddParts(completedPart);
-      }
-      else
+      completedMultipartUpload.AddParts(completedPart);
+    }
+    else
+    {
+      // the parts completed are kept for the next attempt, unless s3 dropped
+      // the upload
+      if (m_checkpoint && uploadParts[i].m_uploadMissing)
       {
-        //TODO abort existing upload
-        return uploadParts[i].m_outcome;
+        m_checkpoint->remove(fileFullPath);
       }
+      //TODO abort existing upload
+      return uploadParts[i].m_outcome;
     }
+  }
 
-    Aws::S3::Model::CompleteMultipartUploadRequest completeRequest;
-    completeRequest.WithBucket(bucket)
-                   .WithKey(key)
-                   .WithUploadId(uploadId)
-                   .WithMultipartUpload(completedMultipartUpload);
+  Aws::S3::Model::CompleteMultipartUploadRequest completeRequest;
+  completeRequest.WithBucket(bucket)
+                 .WithKey(key)
+                 .WithUploadId(uploadId)
+                 .WithMultipartUpload(completedMultipartUpload);
 
-    Aws::S3::Model::CompleteMultipartUploadOutcome outcome =
-      s3Client->CompleteMultipartUpload(completeRequest);
+  Aws::S3::Model::CompleteMultipartUploadOutcome outcome =
+    s3Client->CompleteMultipartUpload(completeRequest);
 
-    if (outcome.IsSuccess())
-    {
-      CXX_LOG_DEBUG("Complete multi part upload request succeed. %s file uploaded successfully.", fileMetadata->srcFileToUpload.c_str());
-      return RemoteStorageRequestOutcome::SUCCESS;
-    }
-    else
+  if (outcome.IsSuccess())
+  {
+    if (m_checkpoint)
     {
-      CXX_LOG_DEBUG("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
-      return handleError(outcome.GetError());
+      m_checkpoint->remove(fileFullPath);
     }
+    CXX_LOG_DEBUG("Complete multi part upload request succeed. %s file uploaded successfully.", fileMetadata->srcFileToUpload.c_str());
+    return RemoteStorageRequestOutcome::SUCCESS;
   }
   else
   {
+    // a part of a resumed upload may be gone, the next attempt starts over
+    if (m_checkpoint &&
+        (outcome.GetError().GetErrorType() == Aws::S3::S3Errors::NO_SUCH_UPLOAD ||
+         outcome.GetError().GetExceptionName() == "InvalidPart"))
+    {
+      m_checkpoint->remove(fileFullPath);
+    }
     CXX_LOG_DEBUG("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
-    return handleError(createMultiPartResp.GetError());
+    return handleError(outcome.GetError());
   }
 }
 
@@ -439,6 +690,11 @@ RemoteStorageRequestOutcome SnowflakeS3Client::download(
     return doSingleDownload(fileMetadata, dataStream);
 }
 
+bool SnowflakeS3Client::decryptsDownload(FileMetadata *fileMetadata)
+{
+  return fileMetadata->srcFileSize > DOWNLOAD_DATA_SIZE_THRESHOLD;
+}
+
 RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartDownload(
   FileMetadata *fileMetadata,
   std::basic_iostream<char> * dataStream)
@@ -446,23 +702,34 @@ RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartDownload(
   CXX_LOG_DEBUG("Start multi part download for file %s, parallel: %d",
                fileMetadata->srcFileName.c_str(), m_parallel);
 
-  if (m_threadPool == nullptr)
-  {
-    m_threadPool = new Util::ThreadPool(m_parallel);
-  }
+  initThreadPool();
 
   std::string bucket, key;
   extractBucketAndKey(&fileMetadata->srcFileName, bucket, key);
-  unsigned int partNum = (unsigned int)(fileMetadata->srcFileSize / DOWNLOAD_DATA_SIZE_THRESHOLD) + 1;
+  // the last part is the one padded, so it must not be empty
+  unsigned int partNum = (unsigned int)((fileMetadata->srcFileSize +
+    DOWNLOAD_DATA_SIZE_THRESHOLD - 1) / DOWNLOAD_DATA_SIZE_THRESHOLD);
   CXX_LOG_DEBUG("Construct get object request: bucket: %s, key: %s, ",
                bucket.c_str(), key.c_str());
 
-  Util::StreamAppender appender(dataStream, partNum, m_parallel, DOWNLOAD_DATA_SIZE_THRESHOLD);
+  // every part but the first is downloaded with the cipher block before it,
+  // the iv to decrypt the part on its own
+  const int ivSize = (int)Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES);
+  Util::StreamAppender appender(dataStream, partNum, m_parallel,
+                                DOWNLOAD_DATA_SIZE_THRESHOLD + ivSize);
+  if (fileMetadata->writeToDestPath)
+  {
+    // the padding stripped off the last part leaves the file a little
+    // shorter than the encrypted object
+    appender.WriteToFile(fileMetadata->destPath, DOWNLOAD_DATA_SIZE_THRESHOLD,
+                         fileMetadata->srcFileSize);
+  }
+  fileMetadata->metrics.parts = partNum;
   std::vector<MultiDownloadCtx> downloadParts;
   for (unsigned int i = 0; i < partNum; i++)
   {
     std::stringstream rangeStream;
-    rangeStream << "bytes=" << i * DOWNLOAD_DATA_SIZE_THRESHOLD << '-' <<
+    rangeStream << "bytes=" << i * DOWNLOAD_DATA_SIZE_THRESHOLD - (i > 0 ? ivSize : 0) << '-' <<
       ((i == partNum - 1) ? fileMetadata->srcFileSize - 1
                           : ((i+1)*DOWNLOAD_DATA_SIZE_THRESHOLD-1));
 
@@ -489,20 +756,26 @@ RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartDownload(
       CXX_LOG_DEBUG("Start downloading part %d, range: %s, part size: %d",
                    ctx.m_partNumber, ctx.getObjectRequest.GetRange().c_str(),
                    partSize);
+      // the last part decrypted in this buffer may have shrunk it
+      buf->updateSize((long)buf->getCapacity());
       ctx.getObjectRequest.SetResponseStreamFactory([&buf]()-> Aws::IOStream *
         { return Aws::New<Aws::IOStream>("SF_MULTI_PART_DOWNLOAD", buf); });
 
       Aws::S3::Model::GetObjectOutcome outcome = s3Client->GetObject(
         ctx.getObjectRequest);
 
-      buf->updateSize(partSize);
       if (outcome.IsSuccess())
       {
         CXX_LOG_DEBUG("Download part %d succeed, download size: %d",
                      ctx.m_partNumber, partSize);
-        ctx.m_outcome = RemoteStorageRequestOutcome::SUCCESS;
-        appender.WritePartToOutputStream(m_threadPool->GetThreadIdx(),
-          ctx.m_partNumber);
+        ctx.m_outcome = decryptPart(fileMetadata, buf, ctx.m_partNumber,
+                                    partSize, ctx.m_partNumber == partNum - 1);
+        if (ctx.m_outcome == RemoteStorageRequestOutcome::SUCCESS &&
+            !appender.WritePartToOutputStream(m_threadPool->GetThreadIdx(),
+                                              ctx.m_partNumber))
+        {
+          ctx.m_outcome = RemoteStorageRequestOutcome::FAILED;
+        }
       }
       else
       {
@@ -521,6 +794,41 @@ RemoteStorageRequestOutcome SnowflakeS3Client::doMultiPartDownload(
     }
   }
 
+  if (!appender.FinishFile())
+  {
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
+RemoteStorageRequestOutcome SnowflakeS3Client::decryptPart(
+  FileMetadata *fileMetadata, Util::ByteArrayStreamBuf *buf, unsigned int partNumber,
+  int partSize, bool last)
+{
+  const size_t ivSize = Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES);
+  Crypto::CryptoIV iv = fileMetadata->encryptionMetadata.iv;
+  char *data = buf->getDataBuffer();
+  if (buf->getPutSize() != partSize + (partNumber > 0 ? (long)ivSize : 0))
+  {
+    CXX_LOG_ERROR("Part %d of file %s came short, %ld bytes", partNumber,
+                  fileMetadata->srcFileName.c_str(), buf->getPutSize());
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+  if (partNumber > 0)
+  {
+    memcpy(iv.data, data, ivSize);
+    data += ivSize;
+  }
+
+  size_t plainSize = Crypto::Cryptor::getInstance().decryptPart(
+    fileMetadata->encryptionMetadata.fileKey, iv, data, (size_t)partSize, last);
+
+  // the part goes on in the output stream without the block before it
+  if (data != buf->getDataBuffer())
+  {
+    memmove(buf->getDataBuffer(), data, plainSize);
+  }
+  buf->updateSize((long)plainSize);
   return RemoteStorageRequestOutcome::SUCCESS;
 }
 
@@ -578,6 +886,7 @@ RemoteStorageRequestOutcome SnowflakeS3Client::GetRemoteFileMetadata(
     fileMetadata->srcFileSize = (long)outcome.GetResult().GetContentLength();
     CXX_LOG_INFO("Remote file %s content length: %ld.",
                   key.c_str(), fileMetadata->srcFileSize);
+    fileMetadata->remoteVersion = outcome.GetResult().GetETag().c_str();
 
     std::string iv = outcome.GetResult().GetMetadata().at(AMZ_IV);
 
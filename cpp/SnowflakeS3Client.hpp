@@ -7,14 +7,17 @@
 
 #include <aws/core/Aws.h>
 #include <aws/core/auth/AWSCredentialsProvider.h>
+#include <aws/core/client/DefaultRetryStrategy.h>
 #include <aws/s3/S3Client.h>
 #include <aws/s3/model/GetObjectRequest.h>
+#include <atomic>
 #include "snowflake/IFileTransferAgent.hpp"
 #include "IStorageClient.hpp"
 #include "snowflake/PutGetParseResponse.hpp"
 #include "FileMetadata.hpp"
 #include "util/ThreadPool.hpp"
 #include "util/ByteArrayStreamBuf.hpp"
+#include "util/TransferCheckpoint.hpp"
 
 #ifdef _WIN32
  // see https://github.com/aws/aws-sdk-cpp/issues/402
@@ -42,6 +45,8 @@ struct MultiUploadCtx
     m_partNumber = partNumber;
     m_key = key;
     m_bucket = bucket;
+    m_uploadMissing = false;
+    m_retries = 0;
   }
 
   /// in memory buffer used to store current part data
@@ -64,6 +69,12 @@ struct MultiUploadCtx
 
   /// upload outcome
   RemoteStorageRequestOutcome m_outcome;
+
+  /// true if s3 doesn't know the upload id, e.g. once it was aborted
+  bool m_uploadMissing;
+
+  /// attempts after the first one
+  unsigned int m_retries;
 };
 
 struct MultiDownloadCtx
@@ -81,6 +92,46 @@ struct MultiDownloadCtx
   RemoteStorageRequestOutcome m_outcome;
 };
 
+/**
+ * Credentials of the stage, replaced in place when the token is renewed
+ */
+class StageCredentialsProvider : public Aws::Auth::AWSCredentialsProvider
+{
+public:
+  explicit StageCredentialsProvider(const Aws::Auth::AWSCredentials &credentials);
+
+  ~StageCredentialsProvider();
+
+  Aws::Auth::AWSCredentials GetAWSCredentials() override;
+
+  void setCredentials(const Aws::Auth::AWSCredentials &credentials);
+
+private:
+  Aws::Auth::AWSCredentials m_credentials;
+
+  SF_CRITICAL_SECTION_HANDLE m_credentialsMutex;
+};
+
+/**
+ * Default retries of the s3 client, counting the requests s3 throttled
+ */
+class ThrottleCountingRetryStrategy : public Aws::Client::DefaultRetryStrategy
+{
+public:
+  ThrottleCountingRetryStrategy() : m_throttledRequests(0) {}
+
+  bool ShouldRetry(const Aws::Client::AWSError<Aws::Client::CoreErrors>& error,
+                   long attemptedRetries) const override;
+
+  unsigned long long getThrottledRequests() const
+  {
+    return m_throttledRequests;
+  }
+
+private:
+  mutable std::atomic<unsigned long long> m_throttledRequests;
+};
+
 /**
  * Wrapper over Amazon s3 client
  */
@@ -113,9 +164,59 @@ public:
   RemoteStorageRequestOutcome doMultiPartDownload(FileMetadata * fileMetadata,
     std::basic_iostream<char> *dataStream);
 
+  /**
+   * Decrypt a downloaded part in its buffer. Every part after the first starts
+   * with the cipher block before it, its iv, which is dropped from the buffer.
+   * @param last true for the last part, which is padded
+   */
+  RemoteStorageRequestOutcome decryptPart(FileMetadata *fileMetadata,
+    Util::ByteArrayStreamBuf *buf, unsigned int partNumber, int partSize,
+    bool last);
+
   RemoteStorageRequestOutcome GetRemoteFileMetadata(
     std::string * filePathFull, FileMetadata *fileMetadata);
 
+  RemoteStorageRequestOutcome checkFileExists(FileMetadata *fileMetadata) override;
+
+  bool updateStageInfo(StageInfo *stageInfo) override;
+
+  bool refreshCredentials(StageInfo *stageInfo) override;
+
+  void setCheckpoint(Util::TransferCheckpoint *checkpoint) override
+  {
+    m_checkpoint = checkpoint;
+  }
+
+  unsigned long long getThrottledRequests() override
+  {
+    return m_retryStrategy->getThrottledRequests();
+  }
+
+  /**
+   * The parts of a multi part download are decrypted by the threads
+   * downloading them
+   */
+  bool decryptsDownload(FileMetadata *fileMetadata) override;
+
+  virtual bool supportsConcurrentMultiPartUpload() override
+  {
+    return true;
+  }
+
+  /**
+   * Pick the part size of a multipart upload. Parts start at the upload
+   * threshold, grow so that a part takes a couple of seconds at the measured
+   * throughput, shrink so that a smaller file still gives every thread a
+   * part, and are never so small that the upload needs more than the
+   * 10,000 parts s3 allows.
+   * @param streamSize size of the data to upload
+   * @param threshold part size given by the server
+   * @param parallel number of upload threads
+   * @param bytesPerSec measured throughput of a part upload, 0 if unknown
+   */
+  static size_t choosePartSize(long long int streamSize, size_t threshold,
+                               unsigned int parallel, unsigned long long bytesPerSec);
+
   /*
    * This is added only to assist in unit tests.
    * SNOW-373871
@@ -129,14 +230,35 @@ private:
 
   Aws::S3::S3Client *s3Client;
 
+  /// credentials signing the requests of the s3 client
+  std::shared_ptr<StageCredentialsProvider> m_credentialsProvider;
+
+  /// retries of the s3 client, counting the throttled requests
+  std::shared_ptr<ThrottleCountingRetryStrategy> m_retryStrategy;
+
   StageInfo * m_stageInfo;
 
   Util::ThreadPool * m_threadPool;
 
+  /// part buffers shared by the multipart uploads running at once
+  Util::StreamBufferPool * m_partBufferPool;
+
+  /// mutex protecting the creation of the thread pool and part buffers
+  SF_CRITICAL_SECTION_HANDLE m_poolMutex;
+
   const size_t m_uploadThreshold;
 
   unsigned int m_parallel;
 
+  /// max bytes of the part buffers, 0 for one part per upload thread
+  size_t m_partBufferLimit;
+
+  /// moving average of the throughput of the part uploads, 0 until measured
+  std::atomic<unsigned long long> m_partBytesPerSec;
+
+  /// checkpoint of the multipart uploads, NULL if not kept
+  Util::TransferCheckpoint * m_checkpoint;
+
   /**
    * Max retries for multipart upload
    */
@@ -169,6 +291,18 @@ private:
 
   void uploadParts(MultiUploadCtx * uploadCtx);
 
+  /**
+   * Abort a multipart upload given up, so that s3 drops its parts
+   */
+  void abortMultiPartUpload(const std::string &bucket, const std::string &key,
+                            const std::string &uploadId);
+
+  /**
+   * Create the thread pool and part buffers shared by the transfers of
+   * this client, if not done yet
+   */
+  void initThreadPool();
+
   RemoteStorageRequestOutcome handleError(const Aws::Client::AWSError<Aws::S3::S3Errors> &error);
 
   void setMaxRetries(unsigned int maxRetries);
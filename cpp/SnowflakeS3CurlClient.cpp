@@ -0,0 +1,852 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "SnowflakeS3CurlClient.hpp"
+#include "FileTransferAgent.hpp"
+#include "snowflake/client.h"
+#include "snowflake/SnowflakeTransferException.hpp"
+#include "util/Base64.hpp"
+#include "crypto/Cryptor.hpp"
+#include "logger/SFLogger.hpp"
+#include "connection.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#define CONTENT_TYPE_OCTET_STREAM "application/octet-stream"
+#define AMZ_META_PREFIX "x-amz-meta-"
+#define AMZ_KEY "x-amz-key"
+#define AMZ_IV "x-amz-iv"
+#define AMZ_MATDESC "x-amz-matdesc"
+#define SFC_DIGEST "sfc-digest"
+
+#define AWS_KEY_ID "AWS_KEY_ID"
+#define AWS_SECRET_KEY "AWS_SECRET_KEY"
+#define AWS_TOKEN "AWS_TOKEN"
+#define DEFAULT_REGION "us-east-1"
+
+#define UNSIGNED_PAYLOAD "UNSIGNED-PAYLOAD"
+/* hex SHA-256 of an empty body */
+#define EMPTY_PAYLOAD_HASH \
+  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+
+#define S3_MAX_PARTS 10000
+#define PART_SIZE_UNIT (1024 * 1024)
+/* s3 parts but the last must be 5 MB or more */
+#define MIN_PART_SIZE (5 * 1024 * 1024)
+
+/* same timeouts as the sdk client, in seconds */
+#define CONNECT_TIMEOUT 30
+#define LOW_SPEED_TIME 40
+
+/* attempts of a request sent from memory, and the sleep before the second */
+#define MAX_REQUEST_ATTEMPTS 3
+#define RETRY_BASE_SLEEP_MS 200
+
+namespace
+{
+  using Snowflake::Client::S3CurlRequest;
+  using Snowflake::Client::S3CurlResponse;
+
+  /**
+   * Request and response of a transfer, for the curl callbacks
+   */
+  struct CurlTransfer
+  {
+    CURL *curl;
+    S3CurlRequest *request;
+    S3CurlResponse *response;
+  };
+
+  std::string toHex(const unsigned char *data, size_t len)
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(len * 2);
+    for (size_t i = 0; i < len; i++)
+    {
+      hex.push_back(digits[data[i] >> 4]);
+      hex.push_back(digits[data[i] & 0xf]);
+    }
+    return hex;
+  }
+
+  std::string sha256Hex(const std::string &data)
+  {
+    using namespace Snowflake::Client::Crypto;
+    unsigned char digest[cryptoHashDigestSize(CryptoHashFunc::SHA256)];
+    HashContext ctx = Cryptor::getInstance().createHashContext(CryptoHashFunc::SHA256);
+    ctx.initialize();
+    ctx.next(data.data(), data.size());
+    ctx.finalize(digest);
+    return toHex(digest, sizeof(digest));
+  }
+
+  std::string hmacSha256(const std::string &key, const std::string &data)
+  {
+    using namespace Snowflake::Client::Crypto;
+    unsigned char digest[cryptoHashDigestSize(CryptoHashFunc::SHA256)];
+    Cryptor::getInstance().hmac(CryptoHashFunc::SHA256, key.data(), key.size(),
+                                data.data(), data.size(), digest);
+    return std::string((char *)digest, sizeof(digest));
+  }
+
+  /**
+   * Header value as signed, trimmed and with the runs of spaces in it
+   * collapsed
+   */
+  std::string canonicalHeaderValue(const std::string &value)
+  {
+    std::string canonical;
+    bool space = false;
+    for (size_t i = 0; i < value.size(); i++)
+    {
+      if (isspace((unsigned char)value[i]))
+      {
+        space = !canonical.empty();
+        continue;
+      }
+      if (space)
+      {
+        canonical.push_back(' ');
+        space = false;
+      }
+      canonical.push_back(value[i]);
+    }
+    return canonical;
+  }
+
+  /**
+   * Text of the first element of a tag in a s3 xml response, empty if none
+   */
+  std::string findXmlElement(const std::string &xml, const std::string &tag)
+  {
+    std::string open = "<" + tag + ">";
+    size_t start = xml.find(open);
+    if (start == std::string::npos)
+    {
+      return "";
+    }
+    start += open.size();
+    size_t end = xml.find("</" + tag + ">", start);
+    return end == std::string::npos ? "" : xml.substr(start, end - start);
+  }
+
+  std::string credential(Snowflake::Client::StageInfo *stageInfo, const char *name)
+  {
+    auto found = stageInfo->credentials.find(name);
+    return found != stageInfo->credentials.end() && found->second ?
+           std::string(found->second) : std::string();
+  }
+
+  size_t readBody(char *buffer, size_t size, size_t nitems, void *userdata)
+  {
+    S3CurlRequest *request = static_cast<S3CurlRequest *>(userdata);
+    size_t len = size * nitems;
+    if (request->m_bodyStream)
+    {
+      std::streamsize read = request->m_bodyStream->sgetn(buffer, (std::streamsize)len);
+      return read > 0 ? (size_t)read : 0;
+    }
+    len = (size_t)std::min((long long)len, request->m_bodySize - request->m_bodyOffset);
+    if (len == 0)
+    {
+      return 0;
+    }
+    memcpy(buffer, request->m_body + request->m_bodyOffset, len);
+    request->m_bodyOffset += len;
+    return len;
+  }
+
+  int seekBody(void *userdata, curl_off_t offset, int origin)
+  {
+    S3CurlRequest *request = static_cast<S3CurlRequest *>(userdata);
+    // a streamed body is encrypted on the fly, it can't go back
+    if (request->m_bodyStream || origin != SEEK_SET || offset < 0 ||
+        offset > request->m_bodySize)
+    {
+      return CURL_SEEKFUNC_CANTSEEK;
+    }
+    request->m_bodyOffset = offset;
+    return CURL_SEEKFUNC_OK;
+  }
+
+  size_t writeBody(char *data, size_t size, size_t nmemb, void *userdata)
+  {
+    CurlTransfer *transfer = static_cast<CurlTransfer *>(userdata);
+    size_t len = size * nmemb;
+    long status = 0;
+    curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &status);
+    // an error goes to the response, not to the data downloaded
+    if (transfer->request->m_responseStream && status / 100 == 2)
+    {
+      return (size_t)transfer->request->m_responseStream->sputn(data, (std::streamsize)len);
+    }
+    transfer->response->m_body.append(data, len);
+    return len;
+  }
+
+  size_t writeHeader(char *data, size_t size, size_t nitems, void *userdata)
+  {
+    CurlTransfer *transfer = static_cast<CurlTransfer *>(userdata);
+    size_t len = size * nitems;
+    std::string line(data, len);
+    if (line.compare(0, 5, "HTTP/") == 0)
+    {
+      // the headers of a final response after a 100 continue
+      transfer->response->m_headers.clear();
+      return len;
+    }
+    size_t colon = line.find(':');
+    if (colon != std::string::npos)
+    {
+      std::string name = line.substr(0, colon);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      transfer->response->m_headers[name] = canonicalHeaderValue(line.substr(colon + 1));
+    }
+    return len;
+  }
+}
+
+namespace Snowflake
+{
+namespace Client
+{
+
+SnowflakeS3CurlClient::SnowflakeS3CurlClient(StageInfo *stageInfo,
+                                             unsigned int parallel,
+                                             size_t uploadThreshold,
+                                             TransferConfig *transferConfig) :
+  m_stageInfo(stageInfo),
+  m_threadPool(nullptr),
+  m_partBufferPool(nullptr),
+  m_curlPool(sf_curl_pool_create()),
+  m_uploadThreshold(uploadThreshold),
+  m_parallel(std::max(1u, std::min(parallel, std::thread::hardware_concurrency()))),
+  m_partBufferLimit(transferConfig != nullptr ? transferConfig->multipartBufferLimit : 0),
+  m_maxRetries(0),
+  m_throttledRequests(0),
+  m_scheme("https"),
+  m_pathStyle(false)
+{
+  if (m_curlPool == nullptr)
+  {
+    throw SnowflakeTransferException(TransferError::INTERNAL_ERROR,
+                                     "Unable to create the curl pool of the s3 client.");
+  }
+  _critical_section_init(&m_poolMutex);
+  _critical_section_init(&m_credentialsMutex);
+
+  if ((transferConfig != nullptr) && (transferConfig->caBundleFile != nullptr))
+  {
+    m_caBundleFile = transferConfig->caBundleFile;
+  }
+
+  m_region = stageInfo->region.empty() ? DEFAULT_REGION : stageInfo->region;
+
+  // same endpoints as the sdk client: a local s3 compatible storage given
+  // with its scheme and addressed by path, the FIPS endpoint given by GS, or
+  // the regional or global endpoint of the region
+  const std::string &endPoint = stageInfo->endPoint;
+  size_t schemeEnd = endPoint.find("://");
+  if (schemeEnd != std::string::npos)
+  {
+    m_scheme = endPoint.compare(0, schemeEnd, "http") == 0 ? "http" : "https";
+    m_endpoint = endPoint.substr(schemeEnd + 3);
+    m_pathStyle = true;
+  }
+  else if (!endPoint.empty())
+  {
+    m_endpoint = endPoint;
+  }
+  else if ((transferConfig != nullptr && transferConfig->useS3regionalUrl) ||
+           m_region != DEFAULT_REGION)
+  {
+    m_endpoint = "s3." + m_region + ".amazonaws.com";
+  }
+  else
+  {
+    m_endpoint = "s3.amazonaws.com";
+  }
+  if (!m_endpoint.empty() && m_endpoint.back() == '/')
+  {
+    m_endpoint.pop_back();
+  }
+
+  refreshCredentials(stageInfo);
+
+  //Ensure the stage location ended with /
+  if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
+  {
+    m_stageInfo->location.push_back('/');
+  }
+
+  CXX_LOG_TRACE("Successfully created s3 curl client, endpoint %s.", m_endpoint.c_str());
+}
+
+SnowflakeS3CurlClient::~SnowflakeS3CurlClient()
+{
+  if (m_threadPool != nullptr)
+  {
+    delete m_threadPool;
+  }
+  if (m_partBufferPool != nullptr)
+  {
+    delete m_partBufferPool;
+  }
+  sf_curl_pool_destroy(m_curlPool);
+  _critical_section_term(&m_credentialsMutex);
+  _critical_section_term(&m_poolMutex);
+}
+
+bool SnowflakeS3CurlClient::updateStageInfo(StageInfo *stageInfo)
+{
+  m_stageInfo = stageInfo;
+  if ((!m_stageInfo->location.empty()) && (m_stageInfo->location.back() != '/'))
+  {
+    m_stageInfo->location.push_back('/');
+  }
+  return refreshCredentials(stageInfo);
+}
+
+bool SnowflakeS3CurlClient::refreshCredentials(StageInfo *stageInfo)
+{
+  _critical_section_lock(&m_credentialsMutex);
+  m_keyId = credential(stageInfo, AWS_KEY_ID);
+  m_secretKey = credential(stageInfo, AWS_SECRET_KEY);
+  m_token = credential(stageInfo, AWS_TOKEN);
+  _critical_section_unlock(&m_credentialsMutex);
+  CXX_LOG_DEBUG("S3 curl client credentials updated in place");
+  return true;
+}
+
+void SnowflakeS3CurlClient::initThreadPool()
+{
+  _critical_section_lock(&m_poolMutex);
+  if (m_threadPool == nullptr)
+  {
+    m_threadPool = new Util::ThreadPool(m_parallel);
+  }
+  if (m_partBufferPool == nullptr)
+  {
+    // more buffers than upload threads would never be used
+    m_partBufferPool = new Util::StreamBufferPool(m_parallel, m_partBufferLimit);
+  }
+  _critical_section_unlock(&m_poolMutex);
+}
+
+std::string SnowflakeS3CurlClient::uriEncode(const std::string &value, bool keepSlash)
+{
+  static const char digits[] = "0123456789ABCDEF";
+  std::string encoded;
+  encoded.reserve(value.size());
+  for (size_t i = 0; i < value.size(); i++)
+  {
+    unsigned char c = (unsigned char)value[i];
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+        (keepSlash && c == '/'))
+    {
+      encoded.push_back((char)c);
+    }
+    else
+    {
+      encoded.push_back('%');
+      encoded.push_back(digits[c >> 4]);
+      encoded.push_back(digits[c & 0xf]);
+    }
+  }
+  return encoded;
+}
+
+std::string SnowflakeS3CurlClient::signRequest(const std::string &method,
+                                               const std::string &path,
+                                               const std::string &query,
+                                               const std::map<std::string, std::string> &headers,
+                                               const std::string &payloadHash,
+                                               const std::string &amzDate,
+                                               const std::string &region,
+                                               const std::string &keyId,
+                                               const std::string &secretKey)
+{
+  std::string canonicalHeaders;
+  std::string signedHeaders;
+  for (auto header = headers.begin(); header != headers.end(); header++)
+  {
+    canonicalHeaders += header->first + ":" + header->second + "\n";
+    if (!signedHeaders.empty())
+    {
+      signedHeaders.push_back(';');
+    }
+    signedHeaders += header->first;
+  }
+
+  std::string canonicalRequest = method + "\n" + path + "\n" + query + "\n" +
+    canonicalHeaders + "\n" + signedHeaders + "\n" + payloadHash;
+  std::string date = amzDate.substr(0, 8);
+  std::string scope = date + "/" + region + "/s3/aws4_request";
+  std::string stringToSign = "AWS4-HMAC-SHA256\n" + amzDate + "\n" + scope +
+    "\n" + sha256Hex(canonicalRequest);
+
+  std::string signingKey = hmacSha256(
+    hmacSha256(hmacSha256(hmacSha256("AWS4" + secretKey, date), region), "s3"),
+    "aws4_request");
+  std::string signature = hmacSha256(signingKey, stringToSign);
+
+  return "AWS4-HMAC-SHA256 Credential=" + keyId + "/" + scope +
+    ",SignedHeaders=" + signedHeaders + ",Signature=" +
+    toHex((const unsigned char *)signature.data(), signature.size());
+}
+
+std::string SnowflakeS3CurlClient::getObjectUrl(const std::string &bucket,
+                                                const std::string &key,
+                                                std::string &host,
+                                                std::string &path) const
+{
+  if (m_pathStyle)
+  {
+    host = m_endpoint;
+    path = "/" + uriEncode(bucket, false) + "/" + uriEncode(key, true);
+  }
+  else
+  {
+    host = bucket + "." + m_endpoint;
+    path = "/" + uriEncode(key, true);
+  }
+  return m_scheme + "://" + host + path;
+}
+
+bool SnowflakeS3CurlClient::perform(S3CurlRequest &request, S3CurlResponse &response)
+{
+  std::string host, path;
+  std::string url = getObjectUrl(request.m_bucket, request.m_key, host, path);
+  if (!request.m_query.empty())
+  {
+    url += "?" + request.m_query;
+  }
+
+  char amzDate[32];
+  time_t now = time(nullptr);
+  struct tm tmNow;
+  strftime(amzDate, sizeof(amzDate), "%Y%m%dT%H%M%SZ", sf_gmtime(&now, &tmNow));
+
+  std::string keyId, secretKey, token;
+  _critical_section_lock(&m_credentialsMutex);
+  keyId = m_keyId;
+  secretKey = m_secretKey;
+  token = m_token;
+  _critical_section_unlock(&m_credentialsMutex);
+
+  // the bodies aren't hashed, as the sdk client doesn't, https protects them
+  bool hasBody = request.m_body != nullptr || request.m_bodyStream != nullptr;
+  std::string payloadHash = hasBody ? UNSIGNED_PAYLOAD : EMPTY_PAYLOAD_HASH;
+
+  std::map<std::string, std::string> headers;
+  for (auto header = request.m_headers.begin(); header != request.m_headers.end(); header++)
+  {
+    headers[header->first] = canonicalHeaderValue(header->second);
+  }
+  headers["host"] = host;
+  headers["x-amz-date"] = amzDate;
+  headers["x-amz-content-sha256"] = payloadHash;
+  if (!token.empty())
+  {
+    headers["x-amz-security-token"] = token;
+  }
+  std::string authorization = signRequest(request.m_method, path, request.m_query,
+                                          headers, payloadHash, amzDate, m_region,
+                                          keyId, secretKey);
+
+  struct curl_slist *headerList = nullptr;
+  for (auto header = headers.begin(); header != headers.end(); header++)
+  {
+    headerList = curl_slist_append(headerList,
+                                   (header->first + ": " + header->second).c_str());
+  }
+  headerList = curl_slist_append(headerList, ("Authorization: " + authorization).c_str());
+  // no round trip waiting for a 100 continue before the body
+  headerList = curl_slist_append(headerList, "Expect:");
+
+  CURL *curl = sf_curl_pool_acquire(m_curlPool);
+  if (curl == nullptr || !set_curl_tls_options(curl, SF_BOOLEAN_FALSE))
+  {
+    CXX_LOG_ERROR("Unable to set up a curl handle for s3.");
+    if (curl != nullptr)
+    {
+      sf_curl_pool_release(m_curlPool, curl);
+    }
+    curl_slist_free_all(headerList);
+    return false;
+  }
+  if (!m_caBundleFile.empty())
+  {
+    curl_easy_setopt(curl, CURLOPT_CAINFO, m_caBundleFile.c_str());
+  }
+
+  CurlTransfer transfer = {curl, &request, &response};
+  request.m_bodyOffset = 0;
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)CONNECT_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)LOW_SPEED_TIME);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeBody);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, writeHeader);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
+  if (strcmp(request.m_method, "HEAD") == 0)
+  {
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  }
+  else if (strcmp(request.m_method, "PUT") == 0)
+  {
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)request.m_bodySize);
+  }
+  else if (strcmp(request.m_method, "POST") == 0)
+  {
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request.m_bodySize);
+  }
+  else if (strcmp(request.m_method, "GET") != 0)
+  {
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.m_method);
+  }
+  if (hasBody || strcmp(request.m_method, "POST") == 0)
+  {
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, readBody);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &request);
+    curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, seekBody);
+    curl_easy_setopt(curl, CURLOPT_SEEKDATA, &request);
+  }
+
+  CURLcode res = curl_easy_perform(curl);
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.m_status);
+  sf_curl_pool_release(m_curlPool, curl);
+  curl_slist_free_all(headerList);
+
+  if (res != CURLE_OK)
+  {
+    CXX_LOG_ERROR("S3 %s request for %s failed: %s", request.m_method,
+                  request.m_key.c_str(), curl_easy_strerror(res));
+    response.m_status = 0;
+    return false;
+  }
+  return true;
+}
+
+bool SnowflakeS3CurlClient::send(S3CurlRequest &request, S3CurlResponse &response)
+{
+  unsigned int attempts = request.m_bodyStream || request.m_responseStream ?
+                          1 : MAX_REQUEST_ATTEMPTS;
+  for (unsigned int attempt = 1; ; attempt++)
+  {
+    response = S3CurlResponse();
+    bool sent = perform(request, response);
+    bool throttled = response.m_status == 503 ||
+      findXmlElement(response.m_body, "Code") == "SlowDown";
+    if (throttled)
+    {
+      m_throttledRequests++;
+    }
+    if ((sent && response.m_status < 500 && !throttled) || attempt >= attempts)
+    {
+      return sent;
+    }
+    unsigned int sleepMs = RETRY_BASE_SLEEP_MS << (attempt - 1);
+    CXX_LOG_DEBUG("Retrying the s3 %s request for %s in %u ms, status %ld.",
+                  request.m_method, request.m_key.c_str(), sleepMs, response.m_status);
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+  }
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::handleError(const S3CurlResponse &response)
+{
+  if (findXmlElement(response.m_body, "Code") == "ExpiredToken")
+  {
+    CXX_LOG_WARN("Token expired.");
+    return RemoteStorageRequestOutcome::TOKEN_EXPIRED;
+  }
+  CXX_LOG_ERROR("S3 request failed with status %ld: %s", response.m_status,
+                findXmlElement(response.m_body, "Message").c_str());
+  return RemoteStorageRequestOutcome::FAILED;
+}
+
+void SnowflakeS3CurlClient::extractBucketAndKey(const std::string &fileFullPath,
+                                                std::string &bucket,
+                                                std::string &key)
+{
+  size_t sepIndex = fileFullPath.find_first_of('/');
+  bucket = fileFullPath.substr(0, sepIndex);
+  key = fileFullPath.substr(sepIndex + 1);
+}
+
+void SnowflakeS3CurlClient::addUserMetadata(std::map<std::string, std::string> &headers,
+                                            FileMetadata *fileMetadata)
+{
+  headers[AMZ_META_PREFIX AMZ_KEY] = fileMetadata->encryptionMetadata.enKekEncoded;
+  headers[AMZ_META_PREFIX AMZ_MATDESC] = fileMetadata->encryptionMetadata.matDesc;
+
+  char ivEncoded[64];
+  size_t ivSize = Crypto::cryptoAlgoBlockSize(Crypto::CryptoAlgo::AES);
+  Util::Base64::encode(fileMetadata->encryptionMetadata.iv.data, ivSize, ivEncoded);
+  headers[AMZ_META_PREFIX AMZ_IV] =
+    std::string(ivEncoded, Util::Base64::encodedLength(ivSize));
+  headers[AMZ_META_PREFIX SFC_DIGEST] = fileMetadata->sha256Digest;
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::upload(FileMetadata *fileMetadata,
+                                                          std::basic_iostream<char> *dataStream)
+{
+  // If overWrite is true we do not perform file exist check.
+  if (!fileMetadata->overWrite &&
+      checkFileExists(fileMetadata) == RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE)
+  {
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+  if (fileMetadata->srcFileSize > m_uploadThreshold)
+    return doMultiPartUpload(fileMetadata, dataStream);
+  else
+    return doSingleUpload(fileMetadata, dataStream);
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::checkFileExists(FileMetadata *fileMetadata)
+{
+  std::string bucket, key;
+  extractBucketAndKey(m_stageInfo->location + fileMetadata->destFileName, bucket, key);
+
+  S3CurlRequest request("HEAD", bucket, key);
+  S3CurlResponse response;
+  if (send(request, response) && response.m_status / 100 == 2)
+  {
+    CXX_LOG_DEBUG("File %s already exists in the staging area. skip upload",
+                  fileMetadata->srcFileName.c_str());
+    return RemoteStorageRequestOutcome::SKIP_UPLOAD_FILE;
+  }
+  CXX_LOG_DEBUG("No file %s in the staging area, status %ld",
+                fileMetadata->destFileName.c_str(), response.m_status);
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::doSingleUpload(FileMetadata *fileMetadata,
+                                                                  std::basic_iostream<char> *dataStream)
+{
+  CXX_LOG_DEBUG("Start single part upload for file %s",
+                fileMetadata->srcFileToUpload.c_str());
+
+  std::string bucket, key;
+  extractBucketAndKey(m_stageInfo->location + fileMetadata->destFileName, bucket, key);
+
+  S3CurlRequest request("PUT", bucket, key);
+  addUserMetadata(request.m_headers, fileMetadata);
+  request.m_headers["content-type"] = CONTENT_TYPE_OCTET_STREAM;
+  request.m_bodyStream = dataStream->rdbuf();
+  request.m_bodySize = fileMetadata->encryptionMetadata.cipherStreamSize;
+
+  S3CurlResponse response;
+  if (send(request, response) && response.m_status / 100 == 2)
+  {
+    CXX_LOG_DEBUG("%s file uploaded successfully.", fileMetadata->srcFileToUpload.c_str());
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  CXX_LOG_ERROR("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
+  return handleError(response);
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::uploadPart(const std::string &bucket,
+                                                              const std::string &key,
+                                                              const std::string &uploadId,
+                                                              unsigned int partNumber,
+                                                              Util::ByteArrayStreamBuf *buf,
+                                                              std::string &etag)
+{
+  std::stringstream query;
+  query << "partNumber=" << partNumber << "&uploadId=" << uriEncode(uploadId, false);
+  S3CurlRequest request("PUT", bucket, key, query.str());
+  request.m_body = buf->getDataBuffer();
+  request.m_bodySize = buf->getSize();
+
+  S3CurlResponse response;
+  if (send(request, response) && response.m_status / 100 == 2)
+  {
+    etag = response.m_headers["etag"];
+    CXX_LOG_INFO("Upload parts request succeed. part number %u, etag %s",
+                 partNumber, etag.c_str());
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  return handleError(response);
+}
+
+void SnowflakeS3CurlClient::abortMultiPartUpload(const std::string &bucket,
+                                                 const std::string &key,
+                                                 const std::string &uploadId)
+{
+  S3CurlRequest request("DELETE", bucket, key, "uploadId=" + uriEncode(uploadId, false));
+  S3CurlResponse response;
+  if (!send(request, response) || response.m_status / 100 != 2)
+  {
+    CXX_LOG_WARN("Failed to abort multi part upload %s, status %ld", uploadId.c_str(),
+                 response.m_status);
+  }
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::doMultiPartUpload(FileMetadata *fileMetadata,
+                                                                     std::basic_iostream<char> *dataStream)
+{
+  CXX_LOG_DEBUG("Start multi part upload for file %s",
+                fileMetadata->srcFileToUpload.c_str());
+
+  initThreadPool();
+
+  std::string bucket, key;
+  extractBucketAndKey(m_stageInfo->location + fileMetadata->destFileName, bucket, key);
+
+  S3CurlRequest create("POST", bucket, key, "uploads=");
+  addUserMetadata(create.m_headers, fileMetadata);
+  create.m_headers["content-type"] = CONTENT_TYPE_OCTET_STREAM;
+  S3CurlResponse response;
+  std::string uploadId;
+  if (!send(create, response) || response.m_status / 100 != 2 ||
+      (uploadId = findXmlElement(response.m_body, "UploadId")).empty())
+  {
+    CXX_LOG_DEBUG("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
+    return handleError(response);
+  }
+  CXX_LOG_DEBUG("Create multi part upload request succeed, uploadId: %s",
+                uploadId.c_str());
+
+  // the last part may be empty, see StreamSplitter::getTotalParts()
+  long long streamSize = fileMetadata->encryptionMetadata.cipherStreamSize;
+  unsigned long long partSize = std::max((unsigned long long)m_uploadThreshold,
+                                         (unsigned long long)MIN_PART_SIZE);
+  partSize = std::max(partSize, (unsigned long long)streamSize / (S3_MAX_PARTS - 1) + 1);
+  partSize = (partSize + PART_SIZE_UNIT - 1) / PART_SIZE_UNIT * PART_SIZE_UNIT;
+
+  Util::StreamSplitter splitter(dataStream, m_partBufferPool, (unsigned int)partSize);
+  unsigned int totalParts = splitter.getTotalParts(streamSize);
+  CXX_LOG_INFO("Total file size: %lld, split into %d parts of %llu bytes.",
+               streamSize, totalParts, partSize);
+
+  std::vector<std::string> etags(totalParts);
+  std::vector<RemoteStorageRequestOutcome> outcomes(totalParts,
+                                                    RemoteStorageRequestOutcome::FAILED);
+  std::vector<unsigned int> retries(totalParts, 0);
+
+  Util::JobGroup partJobs;
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    partJobs.AddJob(*m_threadPool, [&, i]()->void
+    {
+      int partId;
+      Util::ByteArrayStreamBuf *buf = splitter.FillAndGetBuf(partId);
+      char retryPartBuflog[200];
+      snprintf(retryPartBuflog, sizeof(retryPartBuflog),
+               "Retrying partNumber=%u partId=%d.", i, partId);
+      RetryContext partRetryCtx(retryPartBuflog, m_maxRetries);
+      do
+      {
+        //Sleeps only when its a retry
+        partRetryCtx.waitForNextRetry();
+        outcomes[partId] = uploadPart(bucket, key, uploadId, partId + 1, buf, etags[partId]);
+      } while (partRetryCtx.isRetryable(outcomes[partId]));
+      retries[partId] = partRetryCtx.getRetries();
+      splitter.ReleaseBuf(buf);
+    });
+  }
+  partJobs.Wait();
+
+  fileMetadata->metrics.parts = totalParts;
+  std::stringstream completion;
+  completion << "<CompleteMultipartUpload>";
+  for (unsigned int i = 0; i < totalParts; i++)
+  {
+    fileMetadata->metrics.retries += retries[i];
+    if (outcomes[i] != RemoteStorageRequestOutcome::SUCCESS)
+    {
+      // the parts uploaded would be kept and billed until s3 drops them
+      abortMultiPartUpload(bucket, key, uploadId);
+      return outcomes[i];
+    }
+    completion << "<Part><PartNumber>" << (i + 1) << "</PartNumber><ETag>"
+               << etags[i] << "</ETag></Part>";
+  }
+  completion << "</CompleteMultipartUpload>";
+
+  std::string completionXml = completion.str();
+  S3CurlRequest complete("POST", bucket, key, "uploadId=" + uriEncode(uploadId, false));
+  complete.m_headers["content-type"] = "application/xml";
+  complete.m_body = completionXml.data();
+  complete.m_bodySize = (long long)completionXml.size();
+  // s3 may tell of an error in the body of a 200 once it took a while
+  if (send(complete, response) && response.m_status / 100 == 2 &&
+      response.m_body.find("<Error>") == std::string::npos)
+  {
+    CXX_LOG_DEBUG("Complete multi part upload request succeed. %s file uploaded successfully.",
+                  fileMetadata->srcFileToUpload.c_str());
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  CXX_LOG_DEBUG("%s file upload failed.", fileMetadata->srcFileToUpload.c_str());
+  return handleError(response);
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::download(FileMetadata *fileMetadata,
+                                                            std::basic_iostream<char> *dataStream)
+{
+  CXX_LOG_DEBUG("Start single part download for file %s",
+                fileMetadata->srcFileName.c_str());
+
+  std::string bucket, key;
+  extractBucketAndKey(fileMetadata->srcFileName, bucket, key);
+
+  S3CurlRequest request("GET", bucket, key);
+  request.m_responseStream = dataStream->rdbuf();
+  S3CurlResponse response;
+  if (send(request, response) && response.m_status / 100 == 2)
+  {
+    CXX_LOG_DEBUG("Single part download for file %s succeed",
+                  fileMetadata->srcFileName.c_str());
+    return RemoteStorageRequestOutcome::SUCCESS;
+  }
+  return handleError(response);
+}
+
+RemoteStorageRequestOutcome SnowflakeS3CurlClient::GetRemoteFileMetadata(
+  std::string *filePathFull, FileMetadata *fileMetadata)
+{
+  std::string bucket, key;
+  extractBucketAndKey(*filePathFull, bucket, key);
+
+  S3CurlRequest request("HEAD", bucket, key);
+  S3CurlResponse response;
+  if (!send(request, response) || response.m_status / 100 != 2)
+  {
+    return handleError(response);
+  }
+
+  auto iv = response.m_headers.find(AMZ_META_PREFIX AMZ_IV);
+  auto kek = response.m_headers.find(AMZ_META_PREFIX AMZ_KEY);
+  if (iv == response.m_headers.end() || kek == response.m_headers.end())
+  {
+    CXX_LOG_ERROR("Remote file %s has no encryption metadata.", key.c_str());
+    return RemoteStorageRequestOutcome::FAILED;
+  }
+
+  fileMetadata->srcFileSize = (long)strtoll(response.m_headers["content-length"].c_str(),
+                                           nullptr, 10);
+  CXX_LOG_INFO("Remote file %s content length: %ld.",
+               key.c_str(), fileMetadata->srcFileSize);
+  fileMetadata->remoteVersion = response.m_headers["etag"];
+  Util::Base64::decode(iv->second.c_str(), iv->second.size(),
+                       fileMetadata->encryptionMetadata.iv.data);
+  fileMetadata->encryptionMetadata.enKekEncoded = kek->second;
+  return RemoteStorageRequestOutcome::SUCCESS;
+}
+
+}
+}
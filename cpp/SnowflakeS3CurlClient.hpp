@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_SNOWFLAKES3CURLCLIENT_HPP
+#define SNOWFLAKECLIENT_SNOWFLAKES3CURLCLIENT_HPP
+
+#include <atomic>
+#include <map>
+#include <streambuf>
+#include <string>
+#include "snowflake/IFileTransferAgent.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include "IStorageClient.hpp"
+#include "FileMetadata.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/ByteArrayStreamBuf.hpp"
+#include "curl_pool.h"
+
+namespace Snowflake
+{
+namespace Client
+{
+
+/**
+ * Request to s3, signed and sent by SnowflakeS3CurlClient
+ */
+struct S3CurlRequest
+{
+  S3CurlRequest(const char *method, const std::string &bucket,
+                const std::string &key, const std::string &query = "") :
+    m_method(method),
+    m_bucket(bucket),
+    m_key(key),
+    m_query(query),
+    m_body(nullptr),
+    m_bodySize(0),
+    m_bodyOffset(0),
+    m_bodyStream(nullptr),
+    m_responseStream(nullptr)
+  {
+  }
+
+  /// http method
+  const char *m_method;
+  /// s3 bucket
+  std::string m_bucket;
+  /// s3 key, not encoded
+  std::string m_key;
+  /// canonical query string, the parameters sorted and encoded
+  std::string m_query;
+  /// headers signed with the request by lower case name, the host, date,
+  /// payload hash and token are added when it is sent
+  std::map<std::string, std::string> m_headers;
+  /// body in memory, e.g. a part or the list of parts completing an upload
+  const char *m_body;
+  /// bytes of the body, in memory or streamed
+  long long m_bodySize;
+  /// bytes of the body in memory sent so far
+  long long m_bodyOffset;
+  /// body streamed from the data to upload, NULL for the body in memory
+  std::streambuf *m_bodyStream;
+  /// stream the body of a successful response goes to, NULL to keep it
+  std::streambuf *m_responseStream;
+};
+
+/**
+ * Response of s3 to a S3CurlRequest
+ */
+struct S3CurlResponse
+{
+  S3CurlResponse() : m_status(0) {}
+
+  /// http status, 0 if no response came
+  long m_status;
+  /// headers by lower case name
+  std::map<std::string, std::string> m_headers;
+  /// body, unless it went to the response stream of the request
+  std::string m_body;
+};
+
+/**
+ * S3 client sending its requests through curl handles of the library and
+ * signing them itself with AWS signature version 4, instead of through the
+ * AWS SDK. The host names resolved, the TLS sessions and the connections are
+ * shared with the rest of the process, see sf_curl_share_init(), so that a
+ * PUT or GET reuses the connections warmed up by the session, and no SDK is
+ * initialized. Picked with TransferConfig::useCurlS3Client.
+ *
+ * The files are downloaded with a single GET each and decrypted by the
+ * transfer agent, large files are uploaded in parts on the threads of the
+ * client.
+ */
+class SnowflakeS3CurlClient : public Snowflake::Client::IStorageClient
+{
+public:
+  SnowflakeS3CurlClient(StageInfo *stageInfo,
+                        unsigned int parallel,
+                        size_t uploadThreshold,
+                        TransferConfig *transferConfig);
+
+  ~SnowflakeS3CurlClient();
+
+  /**
+   * Upload data to s3 bucket, in parts above the upload threshold. Object
+   * metadata is retrieved first to deduplicate the file unless it is
+   * overwritten.
+   */
+  RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                     std::basic_iostream<char> *dataStream) override;
+
+  RemoteStorageRequestOutcome download(FileMetadata *fileMetadata,
+                                       std::basic_iostream<char> *dataStream) override;
+
+  RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string *filePathFull, FileMetadata *fileMetadata) override;
+
+  RemoteStorageRequestOutcome checkFileExists(FileMetadata *fileMetadata) override;
+
+  bool updateStageInfo(StageInfo *stageInfo) override;
+
+  bool refreshCredentials(StageInfo *stageInfo) override;
+
+  void setMaxRetries(unsigned int maxRetries) override
+  {
+    m_maxRetries = maxRetries;
+  }
+
+  unsigned long long getThrottledRequests() override
+  {
+    return m_throttledRequests;
+  }
+
+  bool supportsConcurrentMultiPartUpload() override
+  {
+    return true;
+  }
+
+  /**
+   * URL of an object, addressed by path for a local s3 compatible storage
+   * and by virtual host otherwise
+   * @param bucket s3 bucket
+   * @param key s3 key, not encoded
+   * @param(OUT) host host of the URL, port included
+   * @param(OUT) path encoded path of the URL, the canonical URI signed
+   */
+  std::string getObjectUrl(const std::string &bucket, const std::string &key,
+                           std::string &host, std::string &path) const;
+
+  /**
+   * Value of the Authorization header of a request, signed with AWS
+   * signature version 4 for s3.
+   * @param method http method
+   * @param path canonical URI, encoded
+   * @param query canonical query string
+   * @param headers headers signed by lower case name, host included
+   * @param payloadHash hex SHA-256 of the body, or UNSIGNED-PAYLOAD
+   * @param amzDate time of the request as in x-amz-date, e.g.
+   *        20130524T000000Z
+   * @param region region of the bucket
+   * @param keyId access key id
+   * @param secretKey secret access key
+   */
+  static std::string signRequest(const std::string &method,
+                                 const std::string &path,
+                                 const std::string &query,
+                                 const std::map<std::string, std::string> &headers,
+                                 const std::string &payloadHash,
+                                 const std::string &amzDate,
+                                 const std::string &region,
+                                 const std::string &keyId,
+                                 const std::string &secretKey);
+
+  /**
+   * Encode a string as in a canonical URI or query string
+   * @param keepSlash true to leave the slashes of a path as they are
+   */
+  static std::string uriEncode(const std::string &value, bool keepSlash);
+
+private:
+  RemoteStorageRequestOutcome doSingleUpload(FileMetadata *fileMetadata,
+                                             std::basic_iostream<char> *dataStream);
+
+  RemoteStorageRequestOutcome doMultiPartUpload(FileMetadata *fileMetadata,
+                                                std::basic_iostream<char> *dataStream);
+
+  /**
+   * Upload a part of a multipart upload
+   * @param(OUT) etag etag of the part given by s3
+   */
+  RemoteStorageRequestOutcome uploadPart(const std::string &bucket,
+                                         const std::string &key,
+                                         const std::string &uploadId,
+                                         unsigned int partNumber,
+                                         Util::ByteArrayStreamBuf *buf,
+                                         std::string &etag);
+
+  void abortMultiPartUpload(const std::string &bucket, const std::string &key,
+                            const std::string &uploadId);
+
+  /**
+   * Sign and send a request once, with a handle of the curl pool
+   * @return false if no response came
+   */
+  bool perform(S3CurlRequest &request, S3CurlResponse &response);
+
+  /**
+   * Send a request, retrying it a few times on a connection failure, a
+   * server error or throttling when neither its body nor its response are
+   * streamed. Those are retried by the transfer agent.
+   * @return false if no response came
+   */
+  bool send(S3CurlRequest &request, S3CurlResponse &response);
+
+  RemoteStorageRequestOutcome handleError(const S3CurlResponse &response);
+
+  void addUserMetadata(std::map<std::string, std::string> &headers,
+                       FileMetadata *fileMetadata);
+
+  void extractBucketAndKey(const std::string &fileFullPath,
+                           std::string &bucket, std::string &key);
+
+  void initThreadPool();
+
+  StageInfo *m_stageInfo;
+
+  Util::ThreadPool *m_threadPool;
+
+  /// part buffers shared by the multipart uploads running at once
+  Util::StreamBufferPool *m_partBufferPool;
+
+  /// mutex protecting the creation of the thread pool and part buffers
+  SF_CRITICAL_SECTION_HANDLE m_poolMutex;
+
+  /// idle curl handles of the client, their connections shared with the
+  /// rest of the process
+  SF_CURL_POOL *m_curlPool;
+
+  const size_t m_uploadThreshold;
+
+  unsigned int m_parallel;
+
+  /// max bytes of the part buffers, 0 for one part per upload thread
+  size_t m_partBufferLimit;
+
+  unsigned int m_maxRetries;
+
+  /// requests that s3 throttled
+  std::atomic<unsigned long long> m_throttledRequests;
+
+  /// CA bundle of the transfer config, empty for the one of the library
+  std::string m_caBundleFile;
+
+  /// "https", or "http" for a local s3 compatible storage
+  std::string m_scheme;
+
+  /// host of the s3 endpoint, the bucket is prepended unless addressed by path
+  std::string m_endpoint;
+
+  /// true if the bucket goes in the path of the URL
+  bool m_pathStyle;
+
+  /// region the requests are signed for
+  std::string m_region;
+
+  /// credentials of the stage, replaced in place when the token is renewed
+  std::string m_keyId;
+  std::string m_secretKey;
+  std::string m_token;
+  SF_CRITICAL_SECTION_HANDLE m_credentialsMutex;
+};
+
+}
+}
+
+#endif //SNOWFLAKECLIENT_SNOWFLAKES3CURLCLIENT_HPP
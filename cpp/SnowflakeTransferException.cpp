@@ -11,7 +11,7 @@
 // be matched correspondingly
 static const char * errorMsgFmts[] = {
   "Internal error: %s", // INTERNAL_ERROR
-  "Auto GZIP compression failed, code %d", // COMPRESSION_ERROR
+  "Auto compression failed, code %d", // COMPRESSION_ERROR
   "Failed to create directory %s, code %d", // MKDIR_ERROR
   "Feature not supported yet: %s", // UNSUPPORTED_FEATURE
   "Column index %d out of range. Total column count: %d", // COLUMN_INDEX_OUT_OF_RANGE
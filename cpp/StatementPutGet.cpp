@@ -98,4 +98,9 @@ bool StatementPutGet::parsePutGetCommand(std::string *sql,
     putGetParseResponse->stageInfo.stageType = StageType::LOCAL_FS;
   }
   return true;
-}
\ No newline at end of file
+}
+
+const SF_TRACE_CONTEXT *StatementPutGet::traceContext()
+{
+  return &m_stmt->trace;
+}
@@ -26,6 +26,8 @@ public:
   virtual bool parsePutGetCommand(std::string *sql,
                                   PutGetParseResponse *putGetParseResponse);
 
+  virtual const SF_TRACE_CONTEXT *traceContext();
+
 private:
   SF_STMT *m_stmt;
 };
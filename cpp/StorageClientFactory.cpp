@@ -5,9 +5,15 @@
 #include "snowflake/SnowflakeTransferException.hpp"
 #include "StorageClientFactory.hpp"
 #include "SnowflakeS3Client.hpp"
+#include "SnowflakeS3CurlClient.hpp"
 #include "SnowflakeAzureClient.hpp"
 #include "SnowflakeGCSClient.hpp"
 #include "logger/SFLogger.hpp"
+#include <mutex>
+#include <sstream>
+
+// idle clients kept for reuse at most
+#define MAX_IDLE_CLIENTS 8
 
 namespace Snowflake
 {
@@ -16,6 +22,12 @@ namespace Client
 
 IStorageClient * StorageClientFactory::injectedClient = nullptr;
 
+std::multimap<std::string, IStorageClient *> StorageClientFactory::idleClients;
+
+std::map<IStorageClient *, std::string> StorageClientFactory::clientKeys;
+
+static std::mutex s_clientCacheMutex;
+
 IStorageClient * StorageClientFactory::getClient(StageInfo *stageInfo,
                                                  unsigned int parallel,
                                                  size_t uploadThreshold,
@@ -25,6 +37,12 @@ IStorageClient * StorageClientFactory::getClient(StageInfo *stageInfo,
   switch (stageInfo->stageType)
   {
     case StageType::S3:
+      if (transferConfig != nullptr && transferConfig->useCurlS3Client)
+      {
+        CXX_LOG_INFO("Creating S3 curl client");
+        return new SnowflakeS3CurlClient(stageInfo, parallel, uploadThreshold,
+                                         transferConfig);
+      }
       CXX_LOG_INFO("Creating S3 client");
       return new SnowflakeS3Client(stageInfo, parallel, uploadThreshold, transferConfig);
     case StageType::MOCKED_STAGE_TYPE:
@@ -34,7 +52,8 @@ IStorageClient * StorageClientFactory::getClient(StageInfo *stageInfo,
       return new SnowflakeAzureClient(stageInfo, parallel, uploadThreshold, transferConfig);
     case StageType::GCS:
       CXX_LOG_INFO("Creating GCS client");
-      return new SnowflakeGCSClient(stageInfo, parallel, transferConfig, statement);
+      return new SnowflakeGCSClient(stageInfo, parallel, uploadThreshold, transferConfig,
+                                    statement);
     default:
       // invalid stage type
       throw SnowflakeTransferException(TransferError::UNSUPPORTED_FEATURE,
@@ -42,6 +61,117 @@ IStorageClient * StorageClientFactory::getClient(StageInfo *stageInfo,
   }
 }
 
+std::string StorageClientFactory::getCacheKey(StageInfo *stageInfo,
+                                             unsigned int parallel,
+                                             size_t uploadThreshold,
+                                             TransferConfig *transferConfig)
+{
+  // gcs clients send their requests through the statement that made them
+  if ((stageInfo->stageType != StageType::S3) &&
+      (stageInfo->stageType != StageType::AZURE))
+  {
+    return "";
+  }
+
+  std::string location = stageInfo->location;
+  if (!location.empty() && location.back() == '/')
+  {
+    location.pop_back();
+  }
+  std::stringstream key;
+  key << stageInfo->stageType << '|' << location << '|' << stageInfo->region
+      << '|' << stageInfo->storageAccount << '|' << stageInfo->endPoint
+      << '|' << parallel << '|' << uploadThreshold;
+  if (transferConfig)
+  {
+    key << '|' << (transferConfig->caBundleFile ? transferConfig->caBundleFile : "")
+        << '|' << transferConfig->useS3regionalUrl
+        << '|' << transferConfig->multipartBufferLimit
+        << '|' << transferConfig->useCurlS3Client;
+  }
+  return key.str();
+}
+
+IStorageClient * StorageClientFactory::acquireClient(StageInfo *stageInfo,
+                                                     unsigned int parallel,
+                                                     size_t uploadThreshold,
+                                                     TransferConfig *transferConfig,
+                                                     IStatementPutGet * statement)
+{
+  std::string key = getCacheKey(stageInfo, parallel, uploadThreshold,
+                                transferConfig);
+  if (key.empty())
+  {
+    return getClient(stageInfo, parallel, uploadThreshold, transferConfig,
+                     statement);
+  }
+
+  IStorageClient *client = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(s_clientCacheMutex);
+    auto idle = idleClients.find(key);
+    while (idle != idleClients.end() && idle->first == key)
+    {
+      IStorageClient *candidate = idle->second;
+      idle = idleClients.erase(idle);
+      if (candidate->updateStageInfo(stageInfo))
+      {
+        client = candidate;
+        break;
+      }
+      delete candidate;
+    }
+  }
+
+  if (client)
+  {
+    CXX_LOG_INFO("Reusing storage client");
+  }
+  else
+  {
+    client = getClient(stageInfo, parallel, uploadThreshold, transferConfig,
+                       statement);
+  }
+
+  std::lock_guard<std::mutex> guard(s_clientCacheMutex);
+  clientKeys[client] = key;
+  return client;
+}
+
+void StorageClientFactory::releaseClient(IStorageClient *client)
+{
+  IStorageClient *evicted = client;
+  {
+    std::lock_guard<std::mutex> guard(s_clientCacheMutex);
+    auto handedOut = clientKeys.find(client);
+    if (handedOut != clientKeys.end())
+    {
+      idleClients.insert(std::make_pair(handedOut->second, client));
+      clientKeys.erase(handedOut);
+      evicted = nullptr;
+      if (idleClients.size() > MAX_IDLE_CLIENTS)
+      {
+        evicted = idleClients.begin()->second;
+        idleClients.erase(idleClients.begin());
+      }
+    }
+  }
+  delete evicted;
+}
+
+void StorageClientFactory::clearClientCache()
+{
+  std::multimap<std::string, IStorageClient *> clients;
+  {
+    std::lock_guard<std::mutex> guard(s_clientCacheMutex);
+    clients.swap(idleClients);
+  }
+  for (auto client = clients.begin(); client != clients.end(); client++)
+  {
+    delete client->second;
+  }
+}
+
 void StorageClientFactory::injectMockedClient(IStorageClient *client)
 {
   injectedClient = client;
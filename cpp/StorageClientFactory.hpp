@@ -5,7 +5,9 @@
 #ifndef SNOWFLAKECLIENT_STORAGECLIENTFACTORY_HPP
 #define SNOWFLAKECLIENT_STORAGECLIENTFACTORY_HPP
 
+#include <map>
 #include <memory>
+#include <string>
 #include "IStorageClient.hpp"
 #include "snowflake/PutGetParseResponse.hpp"
 #include "snowflake/IFileTransferAgent.hpp"
@@ -35,6 +37,30 @@ public:
                                    TransferConfig * transferConfig = nullptr,
                                    IStatementPutGet* statement = nullptr);
 
+  /**
+   * Return a client of the stage, an idle one left by an earlier command
+   * for the same stage if there is one, with the credentials of the stage
+   * info updated in place. The client is given back with releaseClient.
+   * @param stageInfo
+   * @return
+   */
+  static IStorageClient *acquireClient(StageInfo *stageInfo,
+                                       unsigned int parallel,
+                                       size_t uploadThreshold,
+                                       TransferConfig * transferConfig = nullptr,
+                                       IStatementPutGet* statement = nullptr);
+
+  /**
+   * Give back a client from acquireClient, kept for the next command on the
+   * same stage if it can be reused, deleted otherwise
+   */
+  static void releaseClient(IStorageClient *client);
+
+  /**
+   * Delete the idle clients kept for reuse
+   */
+  static void clearClientCache();
+
   /**
    * Testing method. Used to inject a mocked remote storage client.
    */
@@ -42,7 +68,22 @@ public:
 
 private:
 
+  /**
+   * @return the settings a client is created with, empty if its clients
+   * can't be reused
+   */
+  static std::string getCacheKey(StageInfo *stageInfo,
+                                 unsigned int parallel,
+                                 size_t uploadThreshold,
+                                 TransferConfig * transferConfig);
+
   static IStorageClient * injectedClient;
+
+  /// idle clients by cache key
+  static std::multimap<std::string, IStorageClient *> idleClients;
+
+  /// cache key of the reusable clients handed out
+  static std::map<IStorageClient *, std::string> clientKeys;
 };
 }
 }
@@ -11,10 +11,59 @@
 #include <openssl/evp.h>
 #include <assert.h>
 #include <iostream>
+#include <vector>
 
 using namespace std;
 using namespace Snowflake::Client::Crypto;
 
+namespace
+{
+  /// contexts kept by a thread for its next ciphers, a thread seldom has
+  /// more than a couple of cipher streams at once
+  const size_t MAX_CACHED_CONTEXTS = 4;
+
+  struct ContextCache
+  {
+    std::vector<EVP_CIPHER_CTX *> contexts;
+
+    ~ContextCache()
+    {
+      for (size_t i = 0; i < contexts.size(); i++)
+      {
+        EVP_CIPHER_CTX_free(contexts[i]);
+      }
+    }
+  };
+
+  thread_local ContextCache contextCache;
+
+  EVP_CIPHER_CTX *allocContext()
+  {
+    if (contextCache.contexts.empty())
+    {
+      return EVP_CIPHER_CTX_new();
+    }
+    EVP_CIPHER_CTX *ctx = contextCache.contexts.back();
+    contextCache.contexts.pop_back();
+    return ctx;
+  }
+
+  void releaseContext(EVP_CIPHER_CTX *ctx)
+  {
+    // the context may come from another thread, which is fine once reset,
+    // which also wipes the key schedule
+    if (contextCache.contexts.size() < MAX_CACHED_CONTEXTS &&
+        EVP_CIPHER_CTX_reset(ctx) == 1)
+    {
+      contextCache.contexts.push_back(ctx);
+    }
+    else
+    {
+      EVP_CIPHER_CTX_free(ctx);
+    }
+  }
+}
+
 namespace Snowflake
 {
 namespace Client
@@ -104,8 +153,9 @@ CipherContext::Impl::Impl(const CryptoAlgo algo,
   //TODO Make sure library context is erased in case of a core dump.
   //MemoryWiper::registerRegion(&this->ctx, sizeof(this->ctx));
 
-  // Initialize the library context.
-  this->ctx = EVP_CIPHER_CTX_new();
+  // Initialize the library context, one of those the thread used before
+  // unless it has none left, as every file transferred takes a few.
+  this->ctx = allocContext();
 
   // Set padding.
   bool pad;
@@ -130,8 +180,9 @@ CipherContext::Impl::Impl(const CryptoAlgo algo,
 
 CipherContext::Impl::~Impl() noexcept
 {
-  // Destroy the library context (securely cleans up any keys therein).
-  EVP_CIPHER_CTX_free(this->ctx);
+  // Reset the library context for the next one, or destroy it (either
+  // securely cleans up any keys therein).
+  releaseContext(this->ctx);
 
   //TODO OpenSSL has already cleaned up the library context.
   //MemoryWiper::unregisterRegion(&this->ctx, false);
@@ -233,6 +284,11 @@ void CipherContext::initialize(const CryptoOperation op,
     throw;
   //SF_THROW_CRYPTO(static_cast<int>(op));
 
+  // Setting up the cipher resets the padding to PKCS5, set it again.
+  if (EVP_CIPHER_CTX_set_padding(impl.ctx,
+                                 impl.padding == CryptoPadding::PKCS5) != 1)
+    throw;
+
   // Remember operation and offset.
   impl.op = op;
   impl.inOff = impl.outOff = offset;
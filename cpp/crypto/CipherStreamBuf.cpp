@@ -7,6 +7,101 @@
 #include "Cryptor.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  /// buffers kept by a thread for its next streams, a thread seldom has more
+  /// than a couple of cipher streams at once
+  const size_t MAX_CACHED_BUFFERS = 4;
+
+  /// buffers start on a cache line
+  const size_t BUFFER_ALIGNMENT = 64;
+
+  void freeAligned(char *buffer)
+  {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+  }
+
+  /**
+   * Buffers of the cipher streams closed on a thread, so that a thread
+   * encrypting one file after another allocates its buffers once
+   */
+  struct BufferCache
+  {
+    std::vector<std::pair<size_t, char *>> buffers;
+
+    ~BufferCache()
+    {
+      for (size_t i = 0; i < buffers.size(); i++)
+      {
+        freeAligned(buffers[i].second);
+      }
+    }
+  };
+
+  thread_local BufferCache bufferCache;
+
+  char *allocBuffer(size_t size)
+  {
+    std::vector<std::pair<size_t, char *>> &buffers = bufferCache.buffers;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+      if (buffers[i].first == size)
+      {
+        char *buffer = buffers[i].second;
+        buffers.erase(buffers.begin() + i);
+        return buffer;
+      }
+    }
+
+    void *buffer = nullptr;
+#ifdef _WIN32
+    buffer = _aligned_malloc(size, BUFFER_ALIGNMENT);
+#else
+    if (posix_memalign(&buffer, BUFFER_ALIGNMENT, size) != 0)
+    {
+      buffer = nullptr;
+    }
+#endif
+    if (buffer == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    return (char *)buffer;
+  }
+
+  void releaseBuffer(char *buffer, size_t size)
+  {
+    std::vector<std::pair<size_t, char *>> &buffers = bufferCache.buffers;
+    if (buffers.size() >= MAX_CACHED_BUFFERS)
+    {
+      // the oldest size is the least likely to come back
+      freeAligned(buffers.front().second);
+      buffers.erase(buffers.begin());
+    }
+    buffers.push_back(std::make_pair(size, buffer));
+  }
+
+  /**
+   * @return bytes of the source and the result buffers of a stream of a
+   * block size, the result starting on a cache line after the source
+   */
+  size_t buffersSize(size_t blockSize)
+  {
+    size_t srcSize = (blockSize + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+    return srcSize + blockSize + Snowflake::Client::Crypto::cryptoAlgoBlockSize(
+      Snowflake::Client::Crypto::CryptoAlgo::AES);
+  }
+}
 
 namespace Snowflake
 {
@@ -21,10 +116,32 @@ CipherStreamBuf::CipherStreamBuf(::std::basic_streambuf<char> *streambuf,
                                  CryptoIV &iv,
                                  size_t block_size) :
   m_streambuf(streambuf),
+  m_srcData(NULL),
+  m_srcDataSize(0),
   m_blockSize(block_size),
-  m_srcBuffer(new char[block_size]),
   m_readReachEnds(false),
   m_finalized(false)
+{
+  init(op, key, iv);
+}
+
+CipherStreamBuf::CipherStreamBuf(const char *data,
+                                 size_t size,
+                                 CryptoOperation op,
+                                 CryptoKey &key,
+                                 CryptoIV &iv,
+                                 size_t block_size) :
+  m_streambuf(NULL),
+  m_srcData(data),
+  m_srcDataSize(size),
+  m_blockSize(block_size),
+  m_readReachEnds(false),
+  m_finalized(false)
+{
+  init(op, key, iv);
+}
+
+void CipherStreamBuf::init(CryptoOperation op, CryptoKey &key, CryptoIV &iv)
 {
   // initialize cipher context
   m_cipherCtx = Cryptor::getInstance().createCipherContext(
@@ -33,34 +150,47 @@ CipherStreamBuf::CipherStreamBuf(::std::basic_streambuf<char> *streambuf,
   m_cipherCtx.initialize(op);
 
   // result size should be batch size plus aes block size
-  // because padding might be required
-  size_t resultLen = block_size + cryptoAlgoBlockSize(CryptoAlgo::AES);
-  m_resultBuffer = new char[resultLen];
-  memset(m_srcBuffer, 0, m_blockSize);
+  // because padding might be required, both buffers are taken at once
+  size_t resultLen = m_blockSize + cryptoAlgoBlockSize(CryptoAlgo::AES);
+  m_srcBuffer = allocBuffer(buffersSize(m_blockSize));
+  m_resultBuffer = m_srcBuffer + (buffersSize(m_blockSize) - resultLen);
 
   char *end = m_resultBuffer + resultLen;
   this->setg(m_resultBuffer, end, end);
-  this->setp(m_srcBuffer, m_srcBuffer + block_size);
+  this->setp(m_srcBuffer, m_srcBuffer + m_blockSize);
 }
 
 CipherStreamBuf::~CipherStreamBuf()
 {
-  delete[] m_srcBuffer;
-  delete[] m_resultBuffer;
+  releaseBuffer(m_srcBuffer, buffersSize(m_blockSize));
 }
 
-int CipherStreamBuf::underflow()
+size_t CipherStreamBuf::nextBlock(char *out)
 {
-  while(this->gptr() == this->egptr() && !m_readReachEnds)
+  ::std::streamsize bytesRead;
+  const char *src = m_srcBuffer;
+  if (m_streambuf)
   {
-    ::std::streamsize bytesRead = m_streambuf->sgetn(m_srcBuffer,
-                                                     m_blockSize);
-
-    m_readReachEnds = (size_t)bytesRead < m_blockSize;
-    size_t nextSize = m_cipherCtx.next(m_resultBuffer, m_srcBuffer,
-                                (size_t) bytesRead);
+    bytesRead = m_streambuf->sgetn(m_srcBuffer, m_blockSize);
+  }
+  else
+  {
+    // the cipher reads the memory as it is
+    bytesRead = (::std::streamsize)std::min(m_srcDataSize, m_blockSize);
+    src = m_srcData;
+    m_srcData += bytesRead;
+    m_srcDataSize -= (size_t)bytesRead;
+  }
 
+  m_readReachEnds = (size_t)bytesRead < m_blockSize;
+  return m_cipherCtx.next(out, src, (size_t) bytesRead);
+}
 
+int CipherStreamBuf::underflow()
+{
+  while(this->gptr() == this->egptr() && !m_readReachEnds)
+  {
+    size_t nextSize = nextBlock(m_resultBuffer);
     this->setg(m_resultBuffer, m_resultBuffer,
                m_resultBuffer + nextSize);
   }
@@ -77,8 +207,41 @@ int CipherStreamBuf::underflow()
 
 }
 
+::std::streamsize CipherStreamBuf::xsgetn(char *s, ::std::streamsize count)
+{
+  ::std::streamsize resultLen = (::std::streamsize)(m_blockSize +
+    cryptoAlgoBlockSize(CryptoAlgo::AES));
+  ::std::streamsize copied = 0;
+  while (copied < count)
+  {
+    ::std::streamsize available = this->egptr() - this->gptr();
+    if (available > 0)
+    {
+      ::std::streamsize n = std::min(available, count - copied);
+      memcpy(s + copied, this->gptr(), (size_t)n);
+      this->gbump((int)n);
+      copied += n;
+    }
+    else if (!m_readReachEnds && count - copied >= resultLen)
+    {
+      // a part buffer of an upload is filled by the cipher itself
+      copied += (::std::streamsize)nextBlock(s + copied);
+    }
+    else if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+    {
+      break;
+    }
+  }
+  return copied;
+}
+
 int CipherStreamBuf::overflow(int_type ch)
 {
+  if (pptr() - pbase() > 0 && !m_streambuf)
+  {
+    // data read from memory has nowhere to be written to
+    return traits_type::eof();
+  }
   if (pptr() - pbase() > 0)
   {
     size_t nextSize = m_cipherCtx.next(m_resultBuffer, m_srcBuffer,
@@ -110,7 +273,10 @@ int CipherStreamBuf::overflow(int_type ch)
 int CipherStreamBuf::sync()
 {
   std::basic_streambuf<char>::int_type result = this->overflow(traits_type::eof());
-  m_streambuf->pubsync();
+  if (m_streambuf)
+  {
+    m_streambuf->pubsync();
+  }
   return traits_type::eq_int_type(result, traits_type::eof()) ? -1 : 0;
 }
 
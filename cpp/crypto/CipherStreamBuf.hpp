@@ -28,16 +28,32 @@ public:
             CryptoIV &iv,
             size_t block_size);
 
+  /**
+   * Read the data to encrypt or decrypt from memory, without a copy
+   */
+  CipherStreamBuf(const char *data,
+            size_t size,
+            CryptoOperation op,
+            CryptoKey &key,
+            CryptoIV &iv,
+            size_t block_size);
+
   ~CipherStreamBuf();
 
 private:
-  /// underlying stream buf
+  /// underlying stream buf, NULL when reading from memory
   std::basic_streambuf<char> *m_streambuf;
 
+  /// data not read yet when reading from memory
+  const char *m_srcData;
+
+  size_t m_srcDataSize;
+
   /// array to store source data
   char *m_srcBuffer;
 
-  /// array to store encrypted/decrypted block data
+  /// array to store encrypted/decrypted block data, in the same allocation
+  /// as the source array, taken from the buffers cached by the thread
   char *m_resultBuffer;
 
   /// buffer size for each batch to be encrypted/decrypted
@@ -52,8 +68,24 @@ private:
 
   bool m_finalized;
 
+  void init(CryptoOperation op, CryptoKey &key, CryptoIV &iv);
+
+  /**
+   * Encrypt/decrypt the next batch of source data into out, which has room
+   * for a batch plus an aes block
+   *
+   * @return bytes written to out
+   */
+  size_t nextBlock(char *out);
+
   virtual int underflow();
 
+  /**
+   * Reads of at least a batch are encrypted/decrypted straight into the
+   * caller's array instead of going through the result array
+   */
+  virtual std::streamsize xsgetn(char *s, std::streamsize count);
+
   virtual int overflow(int_type ch);
 
   virtual int sync();
@@ -69,6 +101,15 @@ public:
                      size_t blockSize) :
     std::basic_iostream<char>(
       new CipherStreamBuf(stream.rdbuf(), op, key, iv, blockSize)) {}
+
+  CipherIOStream(const char *data,
+                     size_t size,
+                     CryptoOperation op,
+                     CryptoKey &key,
+                     CryptoIV &iv,
+                     size_t blockSize) :
+    std::basic_iostream<char>(
+      new CipherStreamBuf(data, size, op, key, iv, blockSize)) {}
   
   virtual ~CipherIOStream()
   {
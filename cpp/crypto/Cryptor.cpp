@@ -6,6 +6,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <memory>
 #include <new>
 #include <random>
 #include <utility>
@@ -15,6 +16,7 @@
 #include <openssl/conf.h>
 #include <openssl/evp.h>
 #include <openssl/err.h>
+#include <openssl/hmac.h>
 
 #include "CipherContext.hpp"
 #include "snowflake/platform.h"
@@ -58,8 +60,16 @@ static void getRandomBytesFromFile(char *const out,
   const size_t steps = nbBytes / STEP;
   const size_t rem = nbBytes % STEP;
 
-  // Create random device.
-  ::std::random_device rd(token);
+  // Random device of the thread, opened once rather than for every key and
+  // iv of every file transferred.
+  thread_local ::std::unique_ptr<::std::random_device> devices[2];
+  ::std::unique_ptr<::std::random_device> &device =
+    devices[dev == CryptoRandomDevice::DEV_RANDOM ? 0 : 1];
+  if (!device)
+  {
+    device.reset(new ::std::random_device(token));
+  }
+  ::std::random_device &rd = *device;
 
   // Generate required number of random values.
   char *outT = out;
@@ -343,6 +353,36 @@ HashContext Cryptor::createHashContext(const CryptoHashFunc func)
   return HashContext(func);
 }
 
+void Cryptor::hmac(const CryptoHashFunc func,
+                   const void *const key,
+                   const size_t keyLen,
+                   const void *const data,
+                   const size_t len,
+                   void *const digest)
+{
+  if (!HMAC(getDigest(func), key, (int)keyLen,
+            static_cast<const unsigned char *>(data), len,
+            static_cast<unsigned char *>(digest), nullptr))
+    throw;
+}
+
+size_t Cryptor::decryptPart(const CryptoKey &key,
+                            const CryptoIV &prevBlock,
+                            char *data,
+                            const size_t len,
+                            const bool last)
+{
+  CipherContext ctx = this->createCipherContext(
+    CryptoAlgo::AES, CryptoMode::CBC,
+    last ? CryptoPadding::PKCS5 : CryptoPadding::NONE, key, prevBlock, false);
+  ctx.initialize(CryptoOperation::DECRYPT);
+
+  // decrypting in place is fine in a single update, the padded last block is
+  // held back by the context and written over its cipher block at the end
+  size_t plainLen = ctx.next(data, data, len);
+  return plainLen + ctx.finalize(data + plainLen);
+}
+
 }
 }
 }
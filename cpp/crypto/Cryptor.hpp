@@ -118,6 +118,53 @@ public:
    */
   HashContext createHashContext(CryptoHashFunc func);
 
+  /**
+   * Compute the HMAC of a message in one go, e.g. to sign a request.
+   *
+   * @param func
+   *    Cryptographic hash function.
+   * @param key
+   *    Key of the HMAC.
+   * @param keyLen
+   *    Size of the key in number of bytes.
+   * @param data
+   *    Message to authenticate.
+   * @param len
+   *    Size of the message in number of bytes.
+   * @param(OUT) digest
+   *    Output HMAC, of the digest size of the hash function.
+   */
+  void hmac(CryptoHashFunc func,
+            const void *key,
+            size_t keyLen,
+            const void *data,
+            size_t len,
+            void *digest);
+
+  /**
+   * Decrypt in place a part of data encrypted with AES-CBC, apart from the
+   * parts before it. A CBC block only depends on the cipher block before it,
+   * so the parts of a file can be decrypted at once by different threads.
+   *
+   * @param key
+   *    Key of the data.
+   * @param prevBlock
+   *    Cipher block before the part, the iv of the data for the first part.
+   * @param data
+   *    Part to decrypt, starting on a cipher block.
+   * @param len
+   *    Bytes of the part, a multiple of the cipher block size.
+   * @param last
+   *    True for the part ending the data, which ends with the PKCS#5 padding.
+   * @return
+   *    Bytes of plain data at the start of the part.
+   */
+  size_t decryptPart(const CryptoKey &key,
+                     const CryptoIV &prevBlock,
+                     char *data,
+                     size_t len,
+                     bool last);
+
 private:
   Cryptor();
 
@@ -4,6 +4,54 @@
 
 #include "HashContext.hpp"
 #include <openssl/evp.h>
+#include <vector>
+
+namespace
+{
+  /// contexts kept by a thread for its next digests, a thread seldom has more
+  /// than a couple of digests going at once
+  const size_t MAX_CACHED_CONTEXTS = 4;
+
+  struct ContextCache
+  {
+    std::vector<EVP_MD_CTX *> contexts;
+
+    ~ContextCache()
+    {
+      for (size_t i = 0; i < contexts.size(); i++)
+      {
+        EVP_MD_CTX_free(contexts[i]);
+      }
+    }
+  };
+
+  thread_local ContextCache contextCache;
+
+  EVP_MD_CTX *allocContext()
+  {
+    if (contextCache.contexts.empty())
+    {
+      return EVP_MD_CTX_new();
+    }
+    EVP_MD_CTX *ctx = contextCache.contexts.back();
+    contextCache.contexts.pop_back();
+    return ctx;
+  }
+
+  void releaseContext(EVP_MD_CTX *ctx)
+  {
+    // the context may come from another thread, which is fine once reset
+    if (contextCache.contexts.size() < MAX_CACHED_CONTEXTS &&
+        EVP_MD_CTX_reset(ctx) == 1)
+    {
+      contextCache.contexts.push_back(ctx);
+    }
+    else
+    {
+      EVP_MD_CTX_free(ctx);
+    }
+  }
+}
 
 namespace Snowflake
 {
@@ -52,12 +100,14 @@ HashContext::Impl::Impl(const CryptoHashFunc func)
     m_digestSize(cryptoHashDigestSize(func)),
     m_md(getDigest(func))
 {
-  m_ctx = EVP_MD_CTX_new();
+  // the digests of many small files each take a context, reuse them rather
+  // than allocate one per file
+  m_ctx = allocContext();
 }
 
 HashContext::Impl::~Impl() noexcept
 {
-  EVP_MD_CTX_free(m_ctx);
+  releaseContext(m_ctx);
 }
 
 inline void HashContext::Impl::initialize()
@@ -65,7 +115,8 @@ inline void HashContext::Impl::initialize()
   //SF_ASSERT0(!m_isActive, "already_initialized");
   if (!EVP_DigestInit_ex(m_ctx, m_md, nullptr))
     //SF_THROW_CRYPTO(&m_ctx % m_md);
-    m_isActive = true;
+    throw;
+  m_isActive = true;
 }
 
 inline void HashContext::Impl::next(const void *const data,
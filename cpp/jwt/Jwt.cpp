@@ -51,6 +51,11 @@ JWTObject::JWTObject(const std::string &input)
   secret_ = remain.substr(pos + 1);
 }
 
+JWTObject::~JWTObject()
+{
+  if (signed_key_) EVP_PKEY_free(signed_key_);
+}
+
 bool JWTObject::verify(EVP_PKEY *key, bool format)
 {
   std::unique_ptr<ISigner> signer{ISigner::buildSigner(header_->getAlgorithmType())};
@@ -71,9 +76,23 @@ bool JWTObject::verify(EVP_PKEY *key, bool format)
 
 std::string JWTObject::serialize(EVP_PKEY *key)
 {
-  std::unique_ptr<ISigner> signer{ISigner::buildSigner(header_->getAlgorithmType())};
   std::string msg = header_->serialize() + '.' + claim_set_->serialize();
+  if (key == signed_key_ && msg == signed_msg_ && !secret_.empty())
+  {
+    return msg + '.' + this->secret_;
+  }
+
+  std::unique_ptr<ISigner> signer{ISigner::buildSigner(header_->getAlgorithmType())};
   this->secret_ = signer->sign(key, msg);
+
+  if (signed_key_) EVP_PKEY_free(signed_key_);
+  signed_key_ = nullptr;
+  signed_msg_.clear();
+  if (!secret_.empty() && EVP_PKEY_up_ref(key) == 1)
+  {
+    signed_key_ = key;
+    signed_msg_ = msg;
+  }
   return msg + '.' + this->secret_;
 }
 
@@ -33,6 +33,12 @@ public:
    */
   explicit JWTObject(const std::string &input);
 
+  ~JWTObject();
+
+  JWTObject(const JWTObject &) = delete;
+
+  JWTObject &operator=(const JWTObject &) = delete;
+
   /**
    * Set the claim set
    * @param claim_set
@@ -81,7 +87,10 @@ public:
   bool verify(EVP_PKEY *key, bool format);
 
   /**
-   * Serialize the JWT token to a string, the secret field would be set
+   * Serialize the JWT token to a string, the secret field would be set.
+   * The token is signed again only if the header, the claim set or the key
+   * changed since the last call, RSA signatures of the same message with the
+   * same key being the same.
    * @param key
    * @return
    */
@@ -91,6 +100,12 @@ private:
   HeaderPtr header_;
   ClaimSetPtr claim_set_;
   std::string secret_;
+
+  /// message the secret was signed from by serialize(), empty if none
+  std::string signed_msg_;
+
+  /// key the secret was signed with, referenced so that it stays the same
+  EVP_PKEY *signed_key_ = nullptr;
 };
 
 } // namespace Jwt
@@ -8,6 +8,38 @@
 #include "Util.hpp"
 #include "../util/Base64.hpp"
 
+namespace
+{
+  /**
+   * Digest context of a thread, reset and taken again by each signature or
+   * verification rather than allocated for each
+   */
+  struct ThreadDigestContext
+  {
+    EVP_MD_CTX *ctx = nullptr;
+
+    ~ThreadDigestContext()
+    {
+      if (ctx) EVP_MD_CTX_destroy(ctx);
+    }
+
+    EVP_MD_CTX *get()
+    {
+      if (ctx == nullptr)
+      {
+        ctx = EVP_MD_CTX_create();
+      }
+      else if (1 != EVP_MD_CTX_reset(ctx))
+      {
+        return nullptr;
+      }
+      return ctx;
+    }
+  };
+
+  thread_local ThreadDigestContext threadDigestContext;
+}
+
 namespace Snowflake
 {
 namespace Client
@@ -75,26 +107,25 @@ ISigner *ISigner::buildSigner(Snowflake::Client::Jwt::AlgorithmType type)
 template<typename Hash>
 std::string RSASigner<Hash>::sign(EVP_PKEY *key, const std::string &msg)
 {
-  /* Create the Message Digest Context */
-  std::unique_ptr<EVP_MD_CTX, std::function<void(EVP_MD_CTX *)>> mdctx(
-    EVP_MD_CTX_create(), EVP_MD_CTXDeleter);
+  /* Take the Message Digest Context of the thread */
+  EVP_MD_CTX *mdctx = threadDigestContext.get();
 
   if (mdctx == nullptr) return "";
 
   /* Initialise the DigestSign operation */
-  if (1 != EVP_DigestSignInit(mdctx.get(), nullptr, Hash{}(), nullptr, key)) return "";
+  if (1 != EVP_DigestSignInit(mdctx, nullptr, Hash{}(), nullptr, key)) return "";
 
   /* Call update with the message */
-  if (1 != EVP_DigestSignUpdate(mdctx.get(), msg.c_str(), msg.length())) return "";
+  if (1 != EVP_DigestSignUpdate(mdctx, msg.c_str(), msg.length())) return "";
 
   /* Finalise the DigestSign operation */
   /* First call EVP_DigestSignFinal with a NULL sig parameter to obtain the length of the
    * signature. Length is returned in slen */
   size_t slen;
-  if (1 != EVP_DigestSignFinal(mdctx.get(), nullptr, &slen)) return "";
+  if (1 != EVP_DigestSignFinal(mdctx, nullptr, &slen)) return "";
   std::vector<char> buf(slen);
   /* Obtain the signature */
-  if (1 != EVP_DigestSignFinal(mdctx.get(), (unsigned char *) buf.data(), &slen)) return "";
+  if (1 != EVP_DigestSignFinal(mdctx, (unsigned char *) buf.data(), &slen)) return "";
 
   /* Success */
   buf.resize(slen);
@@ -105,25 +136,26 @@ template<typename Hash>
 bool
 RSASigner<Hash>::verify(EVP_PKEY *key, const std::string &msg, const std::string &sig)
 {
-  /* Create the Message Digest Context */
-  std::unique_ptr<EVP_MD_CTX, std::function<void(EVP_MD_CTX *)>> mdctx(
-    EVP_MD_CTX_create(), EVP_MD_CTXDeleter);
+  /* Take the Message Digest Context of the thread */
+  EVP_MD_CTX *mdctx = threadDigestContext.get();
+
+  if (mdctx == nullptr) return false;
 
   /* Initialize `key` with a public key */
-  if (1 != EVP_DigestVerifyInit(mdctx.get(), nullptr, Hash{}(), nullptr, key))
+  if (1 != EVP_DigestVerifyInit(mdctx, nullptr, Hash{}(), nullptr, key))
   {
     return false;
   }
 
   /* Initialize `key` with a public key */
-  if (1 != EVP_DigestVerifyUpdate(mdctx.get(), msg.c_str(), msg.length()))
+  if (1 != EVP_DigestVerifyUpdate(mdctx, msg.c_str(), msg.length()))
   {
     return false;
   }
 
   auto sig_decode = Util::Base64::decodeURLNoPadding(sig);
 
-  return (1 == EVP_DigestVerifyFinal(mdctx.get(), (unsigned char *) sig_decode.data(), sig_decode.size()));
+  return (1 == EVP_DigestVerifyFinal(mdctx, (unsigned char *) sig_decode.data(), sig_decode.size()));
 }
 
 } // namespace Jwt
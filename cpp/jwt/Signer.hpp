@@ -136,16 +136,6 @@ class RSASigner : public ISigner
    */
   bool
   verify(EVP_PKEY *key, const std::string &msg, const std::string &sig) override;
-
-private:
-  /**
-   * Deleter function wrapper
-   * @param mdctx
-   */
-  static inline void EVP_MD_CTXDeleter(EVP_MD_CTX *mdctx)
-  {
-    if (mdctx) EVP_MD_CTX_destroy(mdctx);
-  }
 };
 } // namespace Jwt
 } // namespace Client
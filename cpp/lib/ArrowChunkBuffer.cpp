@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All right reserved.
+ */
+
+#include <string>
+
+#include "../logger/SFLogger.hpp"
+#include "ArrowChunkBuffer.hpp"
+#include "ChunkMemoryPool.hpp"
+
+#ifndef SF_NO_ARROW
+
+namespace Snowflake
+{
+namespace Client
+{
+
+ArrowChunkBuffer::ArrowChunkBuffer() :
+    m_body(ChunkMemoryPool::instance()),
+    m_decoded(false)
+{
+}
+
+size_t ArrowChunkBuffer::write(const char * data, size_t size)
+{
+    arrow::Status status = m_body.Append(data, size);
+    if (!status.ok())
+    {
+        CXX_LOG_ERROR("ArrowChunkBuffer: unable to buffer chunk: %s", status.ToString().c_str());
+        return 0;
+    }
+    return size;
+}
+
+void ArrowChunkBuffer::reset()
+{
+    m_body.Rewind(0);
+}
+
+bool ArrowChunkBuffer::decode()
+{
+    if (m_decoded)
+    {
+        return true;
+    }
+    m_decoded = true;
+
+    // Finishing the body hands its memory over to the record batches read from it
+    std::shared_ptr<arrow::Buffer> data;
+    arrow::Status status = m_body.Finish(&data);
+    if (!status.ok())
+    {
+        CXX_LOG_ERROR("ArrowChunkBuffer: unable to finish chunk: %s", status.ToString().c_str());
+        return false;
+    }
+    if (data->size() == 0)
+    {
+        return true;
+    }
+
+    arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchReader>> batchReader =
+        arrow::ipc::RecordBatchStreamReader::Open(std::make_shared<arrow::io::BufferReader>(data));
+    if (!batchReader.ok())
+    {
+        CXX_LOG_ERROR("ArrowChunkBuffer: unable to read chunk: %s",
+                      batchReader.status().ToString().c_str());
+        return false;
+    }
+    while (true)
+    {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        status = batchReader.ValueOrDie()->ReadNext(&batch);
+        if (!status.ok())
+        {
+            CXX_LOG_ERROR("ArrowChunkBuffer: unable to decode chunk: %s", status.ToString().c_str());
+            return false;
+        }
+        if (batch == nullptr)
+        {
+            return true;
+        }
+        m_batches.emplace_back(batch);
+    }
+}
+
+void ArrowChunkBuffer::takeBatches(std::vector<std::shared_ptr<arrow::RecordBatch> > & batches)
+{
+    (void) decode();
+    batches.swap(m_batches);
+}
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All Rights Reserved
+ */
+#ifndef SNOWFLAKECLIENT_ARROWCHUNKBUFFER_HPP
+#define SNOWFLAKECLIENT_ARROWCHUNKBUFFER_HPP
+
+#include "arrowheaders.hpp"
+
+#ifndef SF_NO_ARROW
+
+#include <memory>
+#include <vector>
+
+namespace Snowflake
+{
+namespace Client
+{
+
+/**
+ * An Arrow-format chunk that is buffered whole while it is being downloaded.
+ *
+ * The record batches are read out of the body by the chunk downloader thread once the whole
+ * chunk has been received, like the JSON chunks are parsed, so that the consumer takes a chunk
+ * that is ready instead of decoding it in snowflake_fetch().
+ */
+class ArrowChunkBuffer
+{
+public:
+
+    ArrowChunkBuffer();
+
+    ~ArrowChunkBuffer() = default;
+
+    // Downloader side =============================================================================
+
+    /**
+     * Appends the next part of the response body.
+     *
+     * @return the number of bytes handled, or 0 to abort the download if out of memory.
+     */
+    size_t write(const char * data, size_t size);
+
+    /**
+     * Drops the body received so far, since a retried download returns it from the start.
+     */
+    void reset();
+
+    /**
+     * Reads the record batches out of the body. Does nothing once they have been read.
+     *
+     * @return false if the body isn't a valid Arrow IPC stream.
+     */
+    bool decode();
+
+    /**
+     * @return the body, for a rowset that is already in memory to be decoded into.
+     */
+    arrow::BufferBuilder & body()
+    {
+        return m_body;
+    }
+
+    // Consumer side ===============================================================================
+
+    /**
+     * Takes the record batches, reading them out of the body first if they haven't been.
+     * The batches that could be read are taken from a body that isn't valid.
+     *
+     * @param batches              Set to the record batches of the chunk.
+     */
+    void takeBatches(std::vector<std::shared_ptr<arrow::RecordBatch> > & batches);
+
+private:
+
+    arrow::BufferBuilder m_body;
+
+    std::vector<std::shared_ptr<arrow::RecordBatch> > m_batches;
+
+    bool m_decoded;
+};
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
+#endif // SNOWFLAKECLIENT_ARROWCHUNKBUFFER_HPP
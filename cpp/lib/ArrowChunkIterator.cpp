@@ -4,6 +4,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <string>
 
@@ -11,9 +12,10 @@
 #include "snowflake/platform.h"
 #include "ArrowChunkIterator.hpp"
 #include "DataConversion.hpp"
+#include "hex.h"
 #include "ResultSetArrow.hpp"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 #undef BOOL
 
 namespace Snowflake
@@ -21,49 +23,29 @@ namespace Snowflake
 namespace Client
 {
 
-ArrowChunkIterator::ArrowChunkIterator(arrow::BufferBuilder * chunk,
+ArrowChunkIterator::ArrowChunkIterator(ArrowChunkBuffer * chunk,
                                        SF_COLUMN_DESC * metadata, std::string tzString,
                                        ResultSetArrow * parent)
     : m_metadata(metadata), m_tzString(tzString), m_parent(parent)
 {
-    // Finalize the currently built buffer and initialize reader objects from it.
-    // This resets the buffer builder for future use.
-    std::shared_ptr<arrow::Buffer> arrowResultData;
-    (void) chunk->Finish(&arrowResultData);
-    std::shared_ptr<arrow::io::BufferReader> bufferReader =
-        std::make_shared<arrow::io::BufferReader>(arrowResultData);
-
-    // Add the batches to a vector.
-    // This stores batches as they are retrieved from the server row-wise
-    // and passes them to the ArrowChunkIterator.
-    arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchReader>> batchReader =
-        arrow::ipc::RecordBatchStreamReader::Open(std::move(bufferReader));
-
-    while (true)
-    {
-        std::shared_ptr<arrow::RecordBatch> batch;
-        if (!batchReader.ok()) break;
-        (void) batchReader.ValueOrDie()->ReadNext(&batch);
-        if (batch == nullptr)
-            break;
-        m_cRecordBatches.emplace_back(batch);
-    }
+    // The chunk downloader has read the record batches out of the body already
+    chunk->takeBatches(m_cRecordBatches);
 
-    // delete the original BufferBuilder since the buffer is passed to batches already
+    // delete the original buffer since its memory is held by the batches already
     delete chunk;
 
-    m_batchCount = m_cRecordBatches.size();
-    m_columnCount = m_batchCount > 0 ? (m_cRecordBatches)[0]->num_columns() : 0;
-    m_rowCountInBatch = m_batchCount > 0 ? (m_cRecordBatches)[0]->num_rows() : 0;
-    m_currentSchema = m_batchCount > 0 ? (m_cRecordBatches)[0]->schema() : nullptr;
-    m_currBatchIndex = 0;
-    m_currRowIndexInBatch = -1;
+    initBatches();
+}
 
-    for (int col = 0; col < m_columnCount; ++col) {
-        m_arrowColumnDataTypes.push_back(m_currentSchema->field(col)->type()->id());
-        CXX_LOG_TRACE("ArrowChunkIterator: col:%d arrow::Type: %s",
-            col, m_currentSchema->field(col)->type()->name().c_str());
-    }
+ArrowChunkIterator::ArrowChunkIterator(ArrowChunkStream * stream,
+                                       SF_COLUMN_DESC * metadata, std::string tzString,
+                                       ResultSetArrow * parent)
+    : m_metadata(metadata), m_tzString(tzString), m_parent(parent),
+      m_stream(stream, [](ArrowChunkStream * s) { s->release(); })
+{
+    // The schema comes from the first record batch, so wait for it
+    fetchBatch(0);
+    initBatches();
 }
 
 // Public methods ==================================================================================
@@ -72,7 +54,7 @@ bool ArrowChunkIterator::next()
     m_currRowIndexInBatch++;
 
     //If its the first row in the batch then initialize the new set of columns.
-    if ((m_columns.size() == 0) && (m_batchCount > 0))
+    if (!m_currentBatch && (m_batchCount > 0))
         this->initColumnChunks();
 
     if (m_currRowIndexInBatch < m_rowCountInBatch)
@@ -84,87 +66,47 @@ bool ArrowChunkIterator::next()
         CXX_LOG_TRACE("ArrowChunkIterator: recordBatch %d with %ld rows.",
             m_currBatchIndex, m_rowCountInBatch);
         m_currBatchIndex++;
-        if (m_currBatchIndex < m_batchCount)
+        if (fetchBatch(m_currBatchIndex))
         {
             m_currRowIndexInBatch = 0;
             m_rowCountInBatch = (m_cRecordBatches)[m_currBatchIndex]->num_rows();
             CXX_LOG_TRACE("ArrowChunkIterator: Initiating record batch %d with %ld rows.",
                 m_currBatchIndex, m_rowCountInBatch);
             this->initColumnChunks();
+            releaseBatch(m_currBatchIndex - 1);
             return true;
         }
     }
     return false;
 }
 
+namespace
+{
+
+/**
+ * Reads an integer cell without switching on the column type. initColumnChunks() picks the
+ * instantiation matching each integer column once per record batch.
+ */
+template <typename ArrayType, ArrayType * ArrowColumn::*member>
+int64 readIntValue(const ArrowColumn & column, int64 row)
+{
+    return (int64)(column.*member)->Value(row);
+}
+
+/**
+ * Gets the scale of a DECIMAL column, the one Decimal128::ToString() formats its values with.
+ */
+int32 decimalScale(const arrow::Decimal128Array * array)
+{
+    return static_cast<const arrow::Decimal128Type &>(*array->type()).scale();
+}
+
+} // namespace
+
 bool ArrowChunkIterator::isCellNull(int32 col)
 {
-    switch (m_arrowColumnDataTypes[col])
-    {
-    case (arrow::Type::type::DATE32):
-    {
-        return m_columns[col].arrowDate32->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::DATE64):
-    {
-        return m_columns[col].arrowDate64->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::STRING):
-    {
-        return m_columns[col].arrowString->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::INT8):
-    {
-        return m_columns[col].arrowInt8->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::INT16):
-    {
-        return m_columns[col].arrowInt16->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::INT32):
-    {
-        return m_columns[col].arrowInt32->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::INT64):
-    {
-        return m_columns[col].arrowInt64->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::BOOL):
-    {
-        return m_columns[col].arrowBoolean->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::BINARY):
-    {
-        return m_columns[col].arrowBinary->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::DOUBLE):
-    {
-        return m_columns[col].arrowDouble->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::DECIMAL):
-    {
-        return m_columns[col].arrowDecimal128->IsNull(m_currRowIndexInBatch);
-        break;
-    }
-    case (arrow::Type::type::STRUCT):
-    {
-        return (m_columns[col].arrowTimestamp->sse->IsNull(m_currRowIndexInBatch));
-        break;
-    }
-    default:
-        break;
-    }
-    return false;
+    arrow::Array * validity = getColumn(col).validity;
+    return validity && validity->IsNull(m_currRowIndexInBatch);
 }
 
 SF_STATUS STDCALL
@@ -189,43 +131,43 @@ ArrowChunkIterator::getCellAsBool(size_t colIdx, sf_bool * out_data)
     {
         case arrow::Type::type::BOOL:
         {
-            auto rawData = m_columns[colIdx].arrowBoolean->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowBoolean->Value(m_currRowIndexInBatch);
             *out_data = (rawData) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::DOUBLE:
         {
-            auto rawData = m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch);
             *out_data = (rawData == 0.0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::INT8:
         {
-            auto rawData = m_columns[colIdx].arrowInt8->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowInt8->Value(m_currRowIndexInBatch);
             *out_data = (rawData == 0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::INT16:
         {
-            auto rawData = m_columns[colIdx].arrowInt16->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowInt16->Value(m_currRowIndexInBatch);
             *out_data = (rawData == 0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::INT32:
         {
-            auto rawData = m_columns[colIdx].arrowInt32->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowInt32->Value(m_currRowIndexInBatch);
             *out_data = (rawData == 0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::INT64:
         {
-            auto rawData = m_columns[colIdx].arrowInt64->Value(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowInt64->Value(m_currRowIndexInBatch);
             *out_data = (rawData == 0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         case arrow::Type::type::STRING:
         {
-            auto rawData = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+            auto rawData = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
             *out_data = (rawData.empty()) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
@@ -299,7 +241,7 @@ ArrowChunkIterator::getCellAsInt32(size_t colIdx, int32 * out_data)
     if ((arrow::Type::type::INT32 == m_arrowColumnDataTypes[colIdx]) &&
         ((SF_DB_TYPE_FIXED != m_metadata[colIdx].type) || (0 == m_metadata[colIdx].scale)))
     {
-        *out_data = m_columns[colIdx].arrowInt32->Value(m_currRowIndexInBatch);
+        *out_data = getColumn(colIdx).arrowInt32->Value(m_currRowIndexInBatch);
         return SF_STATUS_SUCCESS;
     }
 
@@ -343,10 +285,11 @@ ArrowChunkIterator::getCellAsInt64(size_t colIdx, int64 * out_data, bool rawData
     }
 
     // Not go through conversion if type matched for performance.
-    if ((arrow::Type::type::INT64 == m_arrowColumnDataTypes[colIdx]) &&
+    const ArrowColumn & column = getColumn(colIdx);
+    if (column.readInt64 &&
         ((SF_DB_TYPE_FIXED != m_metadata[colIdx].type) || (0 == m_metadata[colIdx].scale) || rawData))
     {
-        *out_data = m_columns[colIdx].arrowInt64->Value(m_currRowIndexInBatch);
+        *out_data = column.readInt64(column, m_currRowIndexInBatch);
         return SF_STATUS_SUCCESS;
     }
 
@@ -377,37 +320,37 @@ ArrowChunkIterator::getCellAsInt64(size_t colIdx, int64 * out_data, bool rawData
     {
         case arrow::Type::type::BOOL:
         {
-            data = (int64)m_columns[colIdx].arrowBoolean->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowBoolean->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::DATE32:
         {
-            data = (int64)m_columns[colIdx].arrowDate32->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowDate32->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::DATE64:
         {
-            data = (int64)m_columns[colIdx].arrowDate64->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowDate64->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::INT8:
         {
-            data = (int64)m_columns[colIdx].arrowInt8->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowInt8->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::INT16:
         {
-            data = (int64)m_columns[colIdx].arrowInt16->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowInt16->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::INT32:
         {
-            data = (int64)m_columns[colIdx].arrowInt32->Value(m_currRowIndexInBatch);
+            data = (int64)getColumn(colIdx).arrowInt32->Value(m_currRowIndexInBatch);
             break;
         }
         case arrow::Type::type::DOUBLE:
         {
-            double dblData = m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch);
+            double dblData = getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch);
             if ((dblData > SF_INT64_MAX) || (dblData < SF_INT64_MIN))
             {
                 m_parent->setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -419,12 +362,19 @@ ArrowChunkIterator::getCellAsInt64(size_t colIdx, int64 * out_data, bool rawData
         }
         case arrow::Type::type::DECIMAL:
         {
-            std::string strData = m_columns[colIdx].arrowDecimal128->FormatValue(m_currRowIndexInBatch);
+            const arrow::Decimal128Array * decimals = getColumn(colIdx).arrowDecimal128;
+            arrow::Decimal128 value(decimals->GetValue(m_currRowIndexInBatch));
+            if ((0 == decimalScale(decimals)) &&
+                Conversion::Arrow::Decimal128ToInt64(value.high_bits(), value.low_bits(), out_data))
+            {
+                return SF_STATUS_SUCCESS;
+            }
+            std::string strData = decimals->FormatValue(m_currRowIndexInBatch);
             return Conversion::Arrow::StringToInteger(strData, out_data, INT64);
         }
         case arrow::Type::type::STRING:
         {
-            std::string strData = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+            std::string strData = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
             return Conversion::Arrow::StringToInteger(strData, out_data, INT64);
         }
         default:
@@ -468,7 +418,7 @@ ArrowChunkIterator::getCellAsUint32(size_t colIdx, uint32 * out_data)
     if ((arrow::Type::type::INT32 == m_arrowColumnDataTypes[colIdx]) &&
         ((SF_DB_TYPE_FIXED != m_metadata[colIdx].type) || (0 == m_metadata[colIdx].scale)))
     {
-        int32 data = m_columns[colIdx].arrowInt32->Value(m_currRowIndexInBatch);
+        int32 data = getColumn(colIdx).arrowInt32->Value(m_currRowIndexInBatch);
         *out_data = (uint32)data;
         return SF_STATUS_SUCCESS;
     }
@@ -517,7 +467,7 @@ ArrowChunkIterator::getCellAsUint64(size_t colIdx, uint64 * out_data)
     if ((arrow::Type::type::INT64 == m_arrowColumnDataTypes[colIdx]) &&
         ((SF_DB_TYPE_FIXED != m_metadata[colIdx].type) || (0 == m_metadata[colIdx].scale)))
     {
-        data = m_columns[colIdx].arrowInt64->Value(m_currRowIndexInBatch);
+        data = getColumn(colIdx).arrowInt64->Value(m_currRowIndexInBatch);
         *out_data = (uint64)data;
         return SF_STATUS_SUCCESS;
     }
@@ -541,7 +491,7 @@ ArrowChunkIterator::getCellAsUint64(size_t colIdx, uint64 * out_data)
     }
     case arrow::Type::type::DOUBLE:
     {
-        double dblData = m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch);
+        double dblData = getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch);
         if ((dblData > SF_UINT64_MAX) || (dblData < SF_INT64_MIN))
         {
             m_parent->setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -553,13 +503,22 @@ ArrowChunkIterator::getCellAsUint64(size_t colIdx, uint64 * out_data)
     }
     case arrow::Type::type::DECIMAL:
     {
-        std::string strData = m_columns[colIdx].arrowDecimal128->FormatValue(m_currRowIndexInBatch);
+        const arrow::Decimal128Array * decimals = getColumn(colIdx).arrowDecimal128;
+        arrow::Decimal128 value(decimals->GetValue(m_currRowIndexInBatch));
+        if ((0 == decimalScale(decimals)) &&
+            Conversion::Arrow::Decimal128ToInt64(value.high_bits(), value.low_bits(), &data) &&
+            (data >= 0))
+        {
+            *out_data = (uint64)data;
+            return SF_STATUS_SUCCESS;
+        }
+        std::string strData = decimals->FormatValue(m_currRowIndexInBatch);
         status = Conversion::Arrow::StringToUint64(strData, out_data);
         break;
     }
     case arrow::Type::type::STRING:
     {
-        std::string strData = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+        std::string strData = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
         status = Conversion::Arrow::StringToUint64(strData, out_data);
         break;
     }
@@ -610,7 +569,7 @@ ArrowChunkIterator::getCellAsFloat32(size_t colIdx, float32 * out_data)
     // Not go through conversion if type matched for performance.
     if (arrow::Type::type::DOUBLE == m_arrowColumnDataTypes[colIdx])
     {
-        float64 floatValue = m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch);
+        float64 floatValue = getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch);
         if (floatValue == INFINITY || floatValue == -INFINITY)
         {
             m_parent->setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -644,13 +603,13 @@ ArrowChunkIterator::getCellAsFloat32(size_t colIdx, float32 * out_data)
     }
     case arrow::Type::type::DECIMAL:
     {
-        std::string strData = m_columns[colIdx].arrowDecimal128->FormatValue(m_currRowIndexInBatch);
+        std::string strData = getColumn(colIdx).arrowDecimal128->FormatValue(m_currRowIndexInBatch);
         status = Conversion::Arrow::StringToFloat(strData, out_data);
         break;
     }
     case arrow::Type::type::STRING:
     {
-        std::string strData = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+        std::string strData = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
         status = Conversion::Arrow::StringToFloat(strData, out_data);
         break;
     }
@@ -701,7 +660,7 @@ ArrowChunkIterator::getCellAsFloat64(size_t colIdx, float64 * out_data)
     // Not go through conversion if type matched for performance.
     if (arrow::Type::type::DOUBLE == m_arrowColumnDataTypes[colIdx])
     {
-        float64 floatValue = m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch);
+        float64 floatValue = getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch);
         if (floatValue == INFINITY || floatValue == -INFINITY)
         {
             m_parent->setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -713,6 +672,21 @@ ArrowChunkIterator::getCellAsFloat64(size_t colIdx, float64 * out_data)
         return SF_STATUS_SUCCESS;
     }
 
+    const ArrowColumn & column = getColumn(colIdx);
+    if (column.readInt64)
+    {
+        int64 intData = column.readInt64(column, m_currRowIndexInBatch);
+        if ((SF_DB_TYPE_FIXED == m_metadata[colIdx].type) && (m_metadata[colIdx].scale > 0))
+        {
+            *out_data = Conversion::Arrow::FixedToDouble(intData, m_metadata[colIdx].scale);
+        }
+        else
+        {
+            *out_data = (float64)intData;
+        }
+        return SF_STATUS_SUCCESS;
+    }
+
     SF_STATUS status;
     switch (m_arrowColumnDataTypes[colIdx])
     {
@@ -734,20 +708,27 @@ ArrowChunkIterator::getCellAsFloat64(size_t colIdx, float64 * out_data)
         float64 floatData = (float64)intData;
         if ((SF_DB_TYPE_FIXED == m_metadata[colIdx].type) && (m_metadata[colIdx].scale > 0))
         {
-            floatData /= (float64)(power10[m_metadata[colIdx].scale]);
+            floatData = Conversion::Arrow::FixedToDouble(intData, m_metadata[colIdx].scale);
         }
         *out_data = floatData;
         return SF_STATUS_SUCCESS;
     }
     case arrow::Type::type::DECIMAL:
     {
-        std::string strData = m_columns[colIdx].arrowDecimal128->FormatValue(m_currRowIndexInBatch);
+        const arrow::Decimal128Array * decimals = getColumn(colIdx).arrowDecimal128;
+        arrow::Decimal128 value(decimals->GetValue(m_currRowIndexInBatch));
+        if (Conversion::Arrow::Decimal128ToDouble(value.high_bits(), value.low_bits(),
+                                                  decimalScale(decimals), out_data))
+        {
+            return SF_STATUS_SUCCESS;
+        }
+        std::string strData = decimals->FormatValue(m_currRowIndexInBatch);
         status = Conversion::Arrow::StringToDouble(strData, out_data);
         break;
     }
     case arrow::Type::type::STRING:
     {
-        std::string strData = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+        std::string strData = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
         status = Conversion::Arrow::StringToDouble(strData, out_data);
         break;
     }
@@ -777,6 +758,45 @@ ArrowChunkIterator::getCellAsFloat64(size_t colIdx, float64 * out_data)
     return status;
 }
 
+SF_STATUS STDCALL
+ArrowChunkIterator::getCellAsBinary(size_t colIdx, const void ** out_data, size_t * out_len)
+{
+    if (colIdx >= m_columnCount)
+    {
+        m_parent->setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
+            "Column index must be between 1 and snowflake_num_fields()");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    // Set default value for null and error cases.
+    *out_data = NULL;
+    *out_len = 0;
+
+    if (isCellNull(colIdx))
+    {
+        return SF_STATUS_SUCCESS;
+    }
+
+    int32 len = 0;
+    switch (m_arrowColumnDataTypes[colIdx])
+    {
+    case arrow::Type::type::BINARY:
+        *out_data = getColumn(colIdx).arrowBinary->GetValue(getValueIndex(colIdx), &len);
+        break;
+    case arrow::Type::type::STRING:
+        *out_data = getColumn(colIdx).arrowString->GetValue(getValueIndex(colIdx), &len);
+        break;
+    default:
+        CXX_LOG_ERROR("Unsupported conversion from %d to BINARY.", m_arrowColumnDataTypes[colIdx]);
+        m_parent->setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
+            "No valid conversion to binary from data type.");
+        return SF_STATUS_ERROR_CONVERSION_FAILURE;
+    }
+
+    *out_len = (size_t) len;
+    return SF_STATUS_SUCCESS;
+}
+
 SF_STATUS STDCALL ArrowChunkIterator::getCellAsString(
     size_t colIdx,
     std::string& outString
@@ -829,27 +849,20 @@ SF_STATUS STDCALL ArrowChunkIterator::getCellAsString(
     {
     case arrow::Type::type::STRING:
     {
-        outString = m_columns[colIdx].arrowString->GetString(m_currRowIndexInBatch);
+        outString = getColumn(colIdx).arrowString->GetString(getValueIndex(colIdx));
         return SF_STATUS_SUCCESS;
     }
     case arrow::Type::type::BINARY:
     {
         int len = 0;
-        auto values = m_columns[colIdx].arrowBinary->GetValue(m_currRowIndexInBatch, &len);
-        std::vector<char> buffer(len * 2 + 1);
-        char* ptr = buffer.data();
-        for (int i = 0; i < len; i++)
-        {
-            sprintf(ptr, "%02X", values[i]);
-            ptr += 2;
-        }
-        *ptr = '\0';
-        outString = std::string(buffer.data());
+        auto values = getColumn(colIdx).arrowBinary->GetValue(getValueIndex(colIdx), &len);
+        outString.resize((size_t)len * 2);
+        sf_hex_encode(&outString[0], values, (size_t)len);
         return SF_STATUS_SUCCESS;
     }
     case arrow::Type::type::BOOL:
     {
-        outString = m_columns[colIdx].arrowBoolean->Value(m_currRowIndexInBatch) ?
+        outString = getColumn(colIdx).arrowBoolean->Value(m_currRowIndexInBatch) ?
                         SF_BOOLEAN_TRUE_STR : SF_BOOLEAN_FALSE_STR;
         return SF_STATUS_SUCCESS;
     }
@@ -858,19 +871,22 @@ SF_STATUS STDCALL ArrowChunkIterator::getCellAsString(
     case arrow::Type::type::INT32:
     case arrow::Type::type::INT64:
     {
-        if ((SF_DB_TYPE_FIXED == snowType) && (m_metadata[colIdx].scale != 0))
+        int64 data;
+        if (SF_DB_TYPE_FIXED == snowType)
         {
-            float64 floatData;
-            status = getCellAsFloat64(colIdx, &floatData);
+            // Formatted from the unscaled value, so no precision is lost on the way through
+            // a double, and the fraction has scale digits like in JSON results.
+            status = getCellAsInt64(colIdx, &data, true);
             if (SF_STATUS_SUCCESS != status)
             {
                 return status;
             }
-            outString = std::to_string(floatData);
+            char buf[Conversion::Arrow::FIXED_MAX_CHARS];
+            outString.assign(buf, Conversion::Arrow::FixedToChars(
+                data, m_metadata[colIdx].scale, buf));
             return SF_STATUS_SUCCESS;
         }
 
-        int64 data;
         status = getCellAsInt64(colIdx, &data);
         if (SF_STATUS_SUCCESS != status)
         {
@@ -910,14 +926,26 @@ SF_STATUS STDCALL ArrowChunkIterator::getCellAsString(
     }
     case arrow::Type::type::DOUBLE:
     {
-        outString = std::to_string(m_columns[colIdx].arrowDouble->Value(m_currRowIndexInBatch));
+        outString = std::to_string(getColumn(colIdx).arrowDouble->Value(m_currRowIndexInBatch));
         // remove trailing 0
         outString.erase(outString.find_last_not_of('0') + 1, std::string::npos);
         return SF_STATUS_SUCCESS;
     }
     case arrow::Type::type::DECIMAL:
     {
-        outString = m_columns[colIdx].arrowDecimal128->FormatValue(m_currRowIndexInBatch);
+        const arrow::Decimal128Array * decimals = getColumn(colIdx).arrowDecimal128;
+        arrow::Decimal128 value(decimals->GetValue(m_currRowIndexInBatch));
+        char buf[Conversion::Arrow::FIXED_MAX_CHARS];
+        size_t len = Conversion::Arrow::Decimal128ToChars(value.high_bits(), value.low_bits(),
+                                                          decimalScale(decimals), buf);
+        if (len > 0)
+        {
+            outString.assign(buf, len);
+        }
+        else
+        {
+            outString = decimals->FormatValue(m_currRowIndexInBatch);
+        }
         return SF_STATUS_SUCCESS;
     }
     default:
@@ -973,14 +1001,14 @@ ArrowChunkIterator::getCellAsTimestamp(size_t colIdx, SF_TIMESTAMP * out_data)
     }
     else
     {
-        if (m_columns[colIdx].arrowTimestamp->sse)
-            secondsSinceEpoch = m_columns[colIdx].arrowTimestamp->sse->Value(m_currRowIndexInBatch);
-        if (m_columns[colIdx].arrowTimestamp->fs)
-            fracSeconds = m_columns[colIdx].arrowTimestamp->fs->Value(m_currRowIndexInBatch);
-        if (m_columns[colIdx].arrowTimestamp->tz)
-            tz = m_columns[colIdx].arrowTimestamp->tz->Value(m_currRowIndexInBatch);
+        if (getColumn(colIdx).arrowTimestamp->sse)
+            secondsSinceEpoch = getColumn(colIdx).arrowTimestamp->sse->Value(m_currRowIndexInBatch);
+        if (getColumn(colIdx).arrowTimestamp->fs)
+            fracSeconds = getColumn(colIdx).arrowTimestamp->fs->Value(m_currRowIndexInBatch);
+        if (getColumn(colIdx).arrowTimestamp->tz)
+            tz = getColumn(colIdx).arrowTimestamp->tz->Value(m_currRowIndexInBatch);
 
-        if (SF_DB_TYPE_TIMESTAMP_TZ == snowType && !m_columns[colIdx].arrowTimestamp->tz)
+        if (SF_DB_TYPE_TIMESTAMP_TZ == snowType && !getColumn(colIdx).arrowTimestamp->tz)
         {
             // should have timezone information but it's null.
             // fracSeconds actually is timezone information and fracSeconds is included in secondsSinceEpoch
@@ -1070,108 +1098,776 @@ ArrowChunkIterator::getCellAsTimestamp(size_t colIdx, SF_TIMESTAMP * out_data)
 
 size_t ArrowChunkIterator::getRowCountInChunk()
 {
-    size_t rowCount = 0;
+    size_t rowCount = m_releasedRowCount;
+    // A streamed chunk has to be received completely to know its row count
+    while (fetchBatch(m_cRecordBatches.size()))
+    {
+    }
     for (unsigned int i = 0; i < (m_cRecordBatches).size(); ++i) {
-        size_t rowCountBatch = (m_cRecordBatches)[i]->num_rows();
-        rowCount += rowCountBatch;
+        if ((m_cRecordBatches)[i])
+        {
+            rowCount += (m_cRecordBatches)[i]->num_rows();
+        }
     }
     return rowCount;
 }
 
-// Private methods =================================================================================
-void ArrowChunkIterator::initColumnChunks()
+bool ArrowChunkIterator::getCellAsStrView(size_t colIdx, const char ** outData, size_t * outLen)
 {
-    m_columns.clear();
-
-    ArrowColumn arrowcol;
+    // The text of the timestamps is formatted
+    if ((colIdx >= m_columnCount) ||
+        (arrow::Type::type::STRING != m_arrowColumnDataTypes[colIdx]) ||
+        (SF_DB_TYPE_TIMESTAMP_TZ == m_metadata[colIdx].type) ||
+        (SF_DB_TYPE_TIMESTAMP_NTZ == m_metadata[colIdx].type) ||
+        (SF_DB_TYPE_TIMESTAMP_LTZ == m_metadata[colIdx].type))
+    {
+        return false;
+    }
 
-    std::shared_ptr<arrow::RecordBatch> currentBatch = (m_cRecordBatches)[m_currBatchIndex];
+    *outData = NULL;
+    *outLen = 0;
+    if (!isCellNull(colIdx))
+    {
+        int32 len = 0;
+        *outData = (const char *) getColumn(colIdx).arrowString->GetValue(getValueIndex(colIdx), &len);
+        *outLen = (size_t) len;
+    }
+    return true;
+}
 
-    m_currentSchema = currentBatch->schema();
-    m_rowCountInBatch = currentBatch->num_rows();
-    for (int i = 0; i < m_columnCount; i++)
+SF_STATUS STDCALL ArrowChunkIterator::getColumnAsStrings(size_t colIdx, ArrowStringColumn & outColumn)
+{
+    if (colIdx >= m_columnCount)
     {
-        std::shared_ptr<arrow::Array> columnArray = currentBatch->column(i);
-        std::shared_ptr<arrow::DataType> dt = m_currentSchema->field(i)->type();
+        m_parent->setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
+            "Column index must be between 1 and snowflake_num_fields()");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    outColumn.data.clear();
+    outColumn.offsets.clear();
+    outColumn.offsets.reserve(m_rowCountInBatch);
+    outColumn.failed.assign(m_rowCountInBatch, false);
 
-        switch (dt->id())
+    // Strings are copied as they are, without a temporary std::string
+    if ((arrow::Type::type::STRING == m_arrowColumnDataTypes[colIdx]) &&
+        (SF_DB_TYPE_TIMESTAMP_TZ != m_metadata[colIdx].type) &&
+        (SF_DB_TYPE_TIMESTAMP_NTZ != m_metadata[colIdx].type) &&
+        (SF_DB_TYPE_TIMESTAMP_LTZ != m_metadata[colIdx].type))
+    {
+        const ArrowColumn & column = getColumn(colIdx);
+        arrow::StringArray * array = column.arrowString;
+        if (column.arrowDictionary)
         {
-            case arrow::Type::STRUCT: {
-                auto values = std::static_pointer_cast<arrow::StructArray>(columnArray);
-                std::shared_ptr<ArrowTimestampArray> ts(new ArrowTimestampArray);
-                ts->sse = std::static_pointer_cast<arrow::Int64Array>(values->field(0)).get();
-                if (values->num_fields() > 1)
-                    ts->fs = std::static_pointer_cast<arrow::Int32Array>(values->field(1)).get();
-                if (values->num_fields() > 2)
-                    ts->tz = std::static_pointer_cast<arrow::Int32Array>(values->field(2)).get();
-                arrowcol.arrowTimestamp = ts;
-                m_columns.emplace_back(arrowcol);
-                break;
+            getDictionaryAsStrings(column, outColumn);
+            return SF_STATUS_SUCCESS;
+        }
+        outColumn.data.reserve(array->value_data() ? array->value_data()->size() + m_rowCountInBatch : 0);
+        for (uint32 row = 0; row < m_rowCountInBatch; ++row)
+        {
+            outColumn.offsets.push_back(outColumn.data.size());
+            if (!array->IsNull(row))
+            {
+                int32_t length = 0;
+                const uint8_t * value = array->GetValue(row, &length);
+                outColumn.data.insert(outColumn.data.end(), value, value + length);
             }
+            outColumn.data.push_back('\0');
+        }
+        return SF_STATUS_SUCCESS;
+    }
 
-            case arrow::Type::type::DATE32: {
-                arrowcol.arrowDate32 = std::static_pointer_cast<arrow::Date32Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
-            }
-            case arrow::Type::type::DATE64: {
-                arrowcol.arrowDate64 = std::static_pointer_cast<arrow::Date64Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
-            }
-            case arrow::Type::type::STRING: {
-                arrowcol.arrowString = std::static_pointer_cast<arrow::StringArray>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+    // Everything else goes through the cell conversion, one row after the other
+    uint32 currRow = m_currRowIndexInBatch;
+    std::string value;
+    for (uint32 row = 0; row < m_rowCountInBatch; ++row)
+    {
+        m_currRowIndexInBatch = row;
+        outColumn.offsets.push_back(outColumn.data.size());
+        if (SF_STATUS_SUCCESS != getCellAsString(colIdx, value))
+        {
+            outColumn.failed[row] = true;
+            value.clear();
+        }
+        outColumn.data.insert(outColumn.data.end(), value.begin(), value.end());
+        outColumn.data.push_back('\0');
+    }
+    m_currRowIndexInBatch = currRow;
+    return SF_STATUS_SUCCESS;
+}
+
+void ArrowChunkIterator::getDictionaryAsStrings(const ArrowColumn & column, ArrowStringColumn & outColumn)
+{
+    arrow::StringArray * values = column.arrowString;
+    int64 valueCount = values->length();
+
+    // Null rows share the empty string at the start, the other rows their dictionary entry
+    outColumn.data.reserve(1 + (values->value_data() ? values->value_data()->size() : 0) + valueCount);
+    outColumn.data.push_back('\0');
+    std::vector<size_t> valueOffsets(valueCount, 0);
+    for (int64 i = 0; i < valueCount; ++i)
+    {
+        if (values->IsNull(i))
+        {
+            continue;
+        }
+        int32_t length = 0;
+        const uint8_t * value = values->GetValue(i, &length);
+        valueOffsets[i] = outColumn.data.size();
+        outColumn.data.insert(outColumn.data.end(), value, value + length);
+        outColumn.data.push_back('\0');
+    }
+
+    for (uint32 row = 0; row < m_rowCountInBatch; ++row)
+    {
+        outColumn.offsets.push_back(column.arrowDictionary->IsNull(row) ? 0 :
+            valueOffsets[column.arrowDictionary->GetValueIndex(row)]);
+    }
+}
+
+SF_STATUS STDCALL
+ArrowChunkIterator::exportNextBatch(struct ArrowArray * outArray, struct ArrowSchema * outSchema)
+{
+    if (!fetchBatch(m_exportBatchIndex))
+    {
+        if (isIncomplete())
+        {
+            m_parent->setError(SF_STATUS_ERROR_CURL,
+                "Chunk download failed before all rows were received");
+            return SF_STATUS_ERROR_CURL;
+        }
+        return SF_STATUS_EOF;
+    }
+
+    // The exported structs hold references to the batch buffers, so they stay valid after
+    // the chunk has been released.
+    arrow::Status status = arrow::ExportRecordBatch(
+        *(m_cRecordBatches)[m_exportBatchIndex], outArray, outSchema);
+    if (!status.ok())
+    {
+        CXX_LOG_ERROR("ArrowChunkIterator: unable to export record batch %d: %s",
+            m_exportBatchIndex, status.ToString().c_str());
+        m_parent->setError(SF_STATUS_ERROR_GENERAL, "Unable to export Arrow record batch");
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    // The row cursor isn't used along with the export, see snowflake_fetch_arrow_batch()
+    releaseBatch(m_exportBatchIndex);
+    m_exportBatchIndex++;
+    return SF_STATUS_SUCCESS;
+}
+
+bool ArrowChunkIterator::copyNullBitmap(size_t colIdx, uint8 * nullBitmap, uint32 rowCount,
+                                        size_t * nullCount)
+{
+    if ((colIdx >= m_columnCount) || (rowCount > getRowsLeftInBatch()))
+    {
+        return false;
+    }
+
+    arrow::Array * validity = getColumn(colIdx).validity;
+    int64_t arrayNullCount = validity ? validity->null_count() : 0;
+    size_t byteCount = (rowCount + 7) / 8;
+    if ((0 == arrayNullCount) || (arrayNullCount == validity->length()))
+    {
+        // No bitmap to read when none or all of the cells are NULL
+        bool allNull = arrayNullCount > 0;
+        std::memset(nullBitmap, allNull ? 0xFF : 0, byteCount);
+        if (allNull && (rowCount % 8))
+        {
+            nullBitmap[byteCount - 1] = (uint8) ((1u << (rowCount % 8)) - 1);
+        }
+        *nullCount = allNull ? rowCount : 0;
+        return true;
+    }
+
+    *nullCount = copyNullBits(validity->null_bitmap_data(),
+                              (size_t) validity->offset() + m_currRowIndexInBatch, true,
+                              nullBitmap, rowCount);
+    return true;
+}
+
+namespace
+{
+
+void setNullBit(uint8 * nullBitmap, size_t bit, bool isNull)
+{
+    if (isNull)
+    {
+        nullBitmap[bit / 8] |= (uint8) (1 << (bit % 8));
+    }
+    else
+    {
+        nullBitmap[bit / 8] &= (uint8) ~(1 << (bit % 8));
+    }
+}
+
+/**
+ * Copies a run of values, null values as 0 like the single cell getters return them.
+ */
+template <typename ArrayType, typename OutType>
+void copyValues(ArrayType * array, OutType * outData, uint8 * nullBitmap,
+                size_t bitOffset, uint32 start, uint32 rowCount)
+{
+    const auto * values = array->raw_values() + start;
+    for (uint32 i = 0; i < rowCount; ++i)
+    {
+        outData[i] = (OutType) values[i];
+    }
+
+    bool hasNulls = array->null_count() > 0;
+    if (!hasNulls && !nullBitmap)
+    {
+        return;
+    }
+    for (uint32 i = 0; i < rowCount; ++i)
+    {
+        bool isNull = hasNulls && array->IsNull(start + i);
+        if (isNull)
+        {
+            outData[i] = 0;
+        }
+        if (nullBitmap)
+        {
+            setNullBit(nullBitmap, bitOffset + i, isNull);
+        }
+    }
+}
+
+/**
+ * Copies a run of scaled integers as doubles, the same way getCellAsFloat64() converts them.
+ */
+template <typename ArrayType>
+void copyScaledValues(ArrayType * array, float64 * outData, uint8 * nullBitmap,
+                      size_t bitOffset, uint32 start, uint32 rowCount, int64 scale)
+{
+    copyValues(array, outData, nullBitmap, bitOffset, start, rowCount);
+    const float64 divisor = doublePower10[scale];
+    for (uint32 i = 0; i < rowCount; ++i)
+    {
+        outData[i] /= divisor;
+    }
+}
+
+/**
+ * Copies a run of NUMBER(38, s) values as int64 or as doubles, null values as 0. Values that
+ * don't fit in 64 bits, or in a double without rounding, are left to the cell getters.
+ */
+bool copyDecimals(const arrow::Decimal128Array * array, SF_C_TYPE cType, void * outData,
+                  uint8 * nullBitmap, size_t bitOffset, uint32 start, uint32 rowCount)
+{
+    int64 scale = decimalScale(array);
+    bool hasNulls = array->null_count() > 0;
+    for (uint32 i = 0; i < rowCount; ++i)
+    {
+        bool isNull = hasNulls && array->IsNull(start + i);
+        if (nullBitmap)
+        {
+            setNullBit(nullBitmap, bitOffset + i, isNull);
+        }
+
+        arrow::Decimal128 value(array->GetValue(start + i));
+        if (SF_C_TYPE_INT64 == cType)
+        {
+            int64 * values = (int64 *) outData;
+            values[i] = 0;
+            if (!isNull &&
+                !Conversion::Arrow::Decimal128ToInt64(value.high_bits(), value.low_bits(), &values[i]))
+            {
+                return false;
             }
-            case arrow::Type::type::INT8: {
-                arrowcol.arrowInt8 = std::static_pointer_cast<arrow::Int8Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+        }
+        else
+        {
+            float64 * values = (float64 *) outData;
+            values[i] = 0.0;
+            if (!isNull &&
+                !Conversion::Arrow::Decimal128ToDouble(value.high_bits(), value.low_bits(), scale,
+                                                       &values[i]))
+            {
+                return false;
             }
-            case arrow::Type::type::INT16: {
-                arrowcol.arrowInt16 = std::static_pointer_cast<arrow::Int16Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool ArrowChunkIterator::copyColumn(size_t colIdx, SF_C_TYPE cType, void * outData,
+                                    uint8 * nullBitmap, size_t bitOffset, uint32 rowCount)
+{
+    if ((colIdx >= m_columnCount) || (rowCount > getRowsLeftInBatch()))
+    {
+        return false;
+    }
+
+    if (SF_C_TYPE_TIMESTAMP == cType)
+    {
+        return copyTimestamps(colIdx, (SF_TIMESTAMP *) outData, nullBitmap, bitOffset, rowCount);
+    }
+
+    uint32 start = m_currRowIndexInBatch;
+    bool fixedNoScale = (SF_DB_TYPE_FIXED == m_metadata[colIdx].type) &&
+                        (0 == m_metadata[colIdx].scale);
+    bool fixedScaled = (SF_DB_TYPE_FIXED == m_metadata[colIdx].type) &&
+                       (m_metadata[colIdx].scale > 0) &&
+                       (m_metadata[colIdx].scale <= Conversion::Arrow::FIXED_MAX_SCALE);
+    ArrowColumn & column = getColumn(colIdx);
+
+    switch (m_arrowColumnDataTypes[colIdx])
+    {
+    case arrow::Type::type::INT8:
+        if ((SF_C_TYPE_FLOAT64 == cType) && fixedScaled)
+        {
+            copyScaledValues(column.arrowInt8, (float64 *) outData, nullBitmap, bitOffset,
+                             start, rowCount, m_metadata[colIdx].scale);
+            return true;
+        }
+        if ((SF_C_TYPE_INT64 != cType) || !fixedNoScale)
+        {
+            return false;
+        }
+        copyValues(column.arrowInt8, (int64 *) outData, nullBitmap, bitOffset, start, rowCount);
+        return true;
+
+    case arrow::Type::type::INT16:
+        if ((SF_C_TYPE_FLOAT64 == cType) && fixedScaled)
+        {
+            copyScaledValues(column.arrowInt16, (float64 *) outData, nullBitmap, bitOffset,
+                             start, rowCount, m_metadata[colIdx].scale);
+            return true;
+        }
+        if ((SF_C_TYPE_INT64 != cType) || !fixedNoScale)
+        {
+            return false;
+        }
+        copyValues(column.arrowInt16, (int64 *) outData, nullBitmap, bitOffset, start, rowCount);
+        return true;
+
+    case arrow::Type::type::INT32:
+        if ((SF_C_TYPE_FLOAT64 == cType) && fixedScaled)
+        {
+            copyScaledValues(column.arrowInt32, (float64 *) outData, nullBitmap, bitOffset,
+                             start, rowCount, m_metadata[colIdx].scale);
+            return true;
+        }
+        if ((SF_C_TYPE_INT64 != cType) || !fixedNoScale)
+        {
+            return false;
+        }
+        copyValues(column.arrowInt32, (int64 *) outData, nullBitmap, bitOffset, start, rowCount);
+        return true;
+
+    case arrow::Type::type::INT64:
+        if ((SF_C_TYPE_FLOAT64 == cType) && fixedScaled)
+        {
+            copyScaledValues(column.arrowInt64, (float64 *) outData, nullBitmap, bitOffset,
+                             start, rowCount, m_metadata[colIdx].scale);
+            return true;
+        }
+        // Same condition as the shortcut in getCellAsInt64()
+        if ((SF_C_TYPE_INT64 != cType) ||
+            ((SF_DB_TYPE_FIXED == m_metadata[colIdx].type) && (0 != m_metadata[colIdx].scale)))
+        {
+            return false;
+        }
+        copyValues(column.arrowInt64, (int64 *) outData, nullBitmap, bitOffset, start, rowCount);
+        return true;
+
+    case arrow::Type::type::DOUBLE:
+    {
+        if (SF_C_TYPE_FLOAT64 != cType)
+        {
+            return false;
+        }
+        // Infinite values are an error in getCellAsFloat64(), leave them to it
+        const double * values = column.arrowDouble->raw_values() + start;
+        for (uint32 i = 0; i < rowCount; ++i)
+        {
+            if (std::isinf(values[i]) && !column.arrowDouble->IsNull(start + i))
+            {
+                return false;
             }
-            case arrow::Type::type::INT32: {
-                arrowcol.arrowInt32 = std::static_pointer_cast<arrow::Int32Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+        }
+        copyValues(column.arrowDouble, (float64 *) outData, nullBitmap, bitOffset, start, rowCount);
+        return true;
+    }
+
+    case arrow::Type::type::DECIMAL:
+        if ((SF_C_TYPE_FLOAT64 != cType) &&
+            ((SF_C_TYPE_INT64 != cType) || (0 != decimalScale(column.arrowDecimal128))))
+        {
+            return false;
+        }
+        return copyDecimals(column.arrowDecimal128, cType, outData, nullBitmap, bitOffset,
+                            start, rowCount);
+
+    case arrow::Type::type::BOOL:
+    {
+        if (SF_C_TYPE_BOOLEAN != cType)
+        {
+            return false;
+        }
+        // Booleans are bit-packed, so there is no raw array to copy from
+        sf_bool * out = (sf_bool *) outData;
+        for (uint32 i = 0; i < rowCount; ++i)
+        {
+            bool isNull = column.arrowBoolean->IsNull(start + i);
+            out[i] = (!isNull && column.arrowBoolean->Value(start + i)) ?
+                SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+            if (nullBitmap)
+            {
+                setNullBit(nullBitmap, bitOffset + i, isNull);
             }
-            case arrow::Type::type::INT64: {
-                arrowcol.arrowInt64 = std::static_pointer_cast<arrow::Int64Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+        }
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+// Private methods =================================================================================
+bool ArrowChunkIterator::copyTimestamps(size_t colIdx, SF_TIMESTAMP * outData, uint8 * nullBitmap,
+                                        size_t bitOffset, uint32 rowCount)
+{
+    SF_DB_TYPE snowType = m_metadata[colIdx].type;
+    int64 scale = m_metadata[colIdx].scale;
+    if (((SF_DB_TYPE_TIMESTAMP_NTZ != snowType) &&
+         (SF_DB_TYPE_TIMESTAMP_LTZ != snowType) &&
+         (SF_DB_TYPE_TIMESTAMP_TZ != snowType)) ||
+        (scale < 0) || (scale > 9))
+    {
+        return false;
+    }
+#if !defined(__linux__) && !defined(__APPLE__)
+    // The offset of the session timezone is only known where struct tm has tm_gmtoff
+    if (SF_DB_TYPE_TIMESTAMP_LTZ == snowType)
+    {
+        return false;
+    }
+#endif
+
+    const ArrowColumn & column = getColumn(colIdx);
+    const ArrowTimestampArray * ts = column.arrowTimestamp.get();
+    bool isStruct = (arrow::Type::type::STRUCT == m_arrowColumnDataTypes[colIdx]);
+    if ((isStruct && !ts->sse) || (!isStruct && !column.readInt64))
+    {
+        return false;
+    }
+    // TIMESTAMP_TZ with a low precision packs the scaled value and the timezone in two fields
+    bool packedTz = isStruct && (SF_DB_TYPE_TIMESTAMP_TZ == snowType) && !ts->tz;
+    if (packedTz && !ts->fs)
+    {
+        return false;
+    }
+
+    uint32 start = m_currRowIndexInBatch;
+    for (uint32 i = 0; i < rowCount; ++i)
+    {
+        int64 row = start + i;
+        SF_TIMESTAMP & out = outData[i];
+        bool isNull = column.validity->IsNull(row);
+        if (nullBitmap)
+        {
+            setNullBit(nullBitmap, bitOffset + i, isNull);
+        }
+        if (isNull)
+        {
+            snowflake_timestamp_from_parts(&out, 0, 0, 0, 0, 1, 1, 1970, 0, 9, SF_DB_TYPE_TIMESTAMP_NTZ);
+            continue;
+        }
+
+        // Split into whole seconds rounded down and the nanoseconds after them
+        int64 seconds;
+        int64 nanos;
+        int64 tz = 0;
+        if (isStruct && !packedTz)
+        {
+            seconds = ts->sse->Value(row);
+            nanos = ts->fs ? ts->fs->Value(row) : 0;
+            tz = ts->tz ? ts->tz->Value(row) : 0;
+        }
+        else
+        {
+            int64 value = isStruct ? ts->sse->Value(row) : column.readInt64(column, row);
+            if (packedTz)
+            {
+                tz = ts->fs->Value(row);
             }
-            case arrow::Type::type::BOOL: {
-                arrowcol.arrowBoolean = std::static_pointer_cast<arrow::BooleanArray>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+            seconds = value / power10[scale];
+            nanos = (value % power10[scale]) * power10[9 - scale];
+        }
+        seconds += nanos / power10[9];
+        nanos %= power10[9];
+        if (nanos < 0)
+        {
+            nanos += power10[9];
+            seconds--;
+        }
+
+        memset(&out, 0, sizeof(out));
+        int64 gmtOffset = 0;
+        if (SF_DB_TYPE_TIMESTAMP_TZ == snowType)
+        {
+            // Stored as minutes east of UTC plus 24 hours
+            out.tzoffset = tz ? (int32)(tz - 24 * 60) : 0;
+            Conversion::Arrow::EpochToTm(seconds + out.tzoffset * 60, out.tm_obj);
+            // What localtime() reports for the "UTC+hh:mm" timezone used by the cell getter
+            gmtOffset = -out.tzoffset * 60;
+        }
+        else if (SF_DB_TYPE_TIMESTAMP_LTZ == snowType)
+        {
+            ArrowLocalTimeOffset offset;
+            if (!getLocalTimeOffset(seconds, offset))
+            {
+                return false;
             }
-            case arrow::Type::type::BINARY: {
-                arrowcol.arrowBinary = std::static_pointer_cast<arrow::BinaryArray>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+            if (offset.changes)
+            {
+                if (SF_STATUS_SUCCESS != snowflake_timestamp_from_epoch_seconds(&out,
+                        std::to_string(seconds).c_str(), m_tzString.c_str(), 0, snowType))
+                {
+                    return false;
+                }
             }
-            case arrow::Type::type::DOUBLE: {
-                arrowcol.arrowDouble = std::static_pointer_cast<arrow::DoubleArray>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+            else
+            {
+                Conversion::Arrow::EpochToTm(seconds + offset.gmtOffset, out.tm_obj);
+                out.tm_obj.tm_isdst = offset.isDst;
+                out.tzoffset = (int32)(offset.gmtOffset / 60);
+                gmtOffset = offset.gmtOffset;
             }
-            case arrow::Type::type::DECIMAL:{
-                arrowcol.arrowDecimal128 = std::static_pointer_cast<arrow::Decimal128Array>(columnArray).get();
-                m_columns.emplace_back(arrowcol);
-                break;
+        }
+        else
+        {
+            Conversion::Arrow::EpochToTm(seconds, out.tm_obj);
+        }
+#if defined(__linux__) || defined(__APPLE__)
+        if (gmtOffset)
+        {
+            out.tm_obj.tm_gmtoff = gmtOffset;
+        }
+#endif
+        out.nsec = (int32) nanos;
+        out.scale = (int32) scale;
+        out.ts_type = snowType;
+    }
+    return true;
+}
+
+bool ArrowChunkIterator::getLocalTimeOffset(int64 secondsSinceEpoch, ArrowLocalTimeOffset & outOffset)
+{
+    int64 day = secondsSinceEpoch / Conversion::Arrow::SECONDS_IN_DAY;
+    if (secondsSinceEpoch % Conversion::Arrow::SECONDS_IN_DAY < 0)
+    {
+        day--;
+    }
+    auto found = m_localTimeOffsets.find(day);
+    if (found != m_localTimeOffsets.end())
+    {
+        outOffset = found->second;
+        return true;
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    // Timezones change their offset at most once a day, so a day with the same offset at both
+    // ends has it throughout.
+    SF_TIMESTAMP first;
+    SF_TIMESTAMP last;
+    int64 dayStart = day * Conversion::Arrow::SECONDS_IN_DAY;
+    if ((SF_STATUS_SUCCESS != snowflake_timestamp_from_epoch_seconds(&first,
+            std::to_string(dayStart).c_str(), m_tzString.c_str(), 0, SF_DB_TYPE_TIMESTAMP_LTZ)) ||
+        (SF_STATUS_SUCCESS != snowflake_timestamp_from_epoch_seconds(&last,
+            std::to_string(dayStart + Conversion::Arrow::SECONDS_IN_DAY - 1).c_str(),
+            m_tzString.c_str(), 0, SF_DB_TYPE_TIMESTAMP_LTZ)))
+    {
+        return false;
+    }
+
+    outOffset.gmtOffset = first.tm_obj.tm_gmtoff;
+    outOffset.isDst = first.tm_obj.tm_isdst;
+    outOffset.changes = (first.tm_obj.tm_gmtoff != last.tm_obj.tm_gmtoff) ||
+                        (first.tm_obj.tm_isdst != last.tm_obj.tm_isdst) ||
+                        (first.tm_obj.tm_gmtoff % 60 != 0);
+    m_localTimeOffsets[day] = outOffset;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ArrowChunkIterator::initBatches()
+{
+    m_batchCount = m_cRecordBatches.size();
+    m_columnCount = m_batchCount > 0 ? (m_cRecordBatches)[0]->num_columns() : 0;
+    m_rowCountInBatch = m_batchCount > 0 ? (m_cRecordBatches)[0]->num_rows() : 0;
+    m_currentSchema = m_batchCount > 0 ? (m_cRecordBatches)[0]->schema() : nullptr;
+    m_currBatchIndex = 0;
+    m_exportBatchIndex = 0;
+    m_currRowIndexInBatch = -1;
+    m_releasedRowCount = 0;
+
+    for (int col = 0; col < m_columnCount; ++col) {
+        std::shared_ptr<arrow::DataType> type = m_currentSchema->field(col)->type();
+        // Dictionary-encoded strings are read like plain ones, through the dictionary
+        if (arrow::Type::type::DICTIONARY == type->id())
+        {
+            auto valueType = std::static_pointer_cast<arrow::DictionaryType>(type)->value_type();
+            if ((arrow::Type::type::STRING == valueType->id()) ||
+                (arrow::Type::type::BINARY == valueType->id()))
+            {
+                type = valueType;
             }
+        }
+        m_arrowColumnDataTypes.push_back(type->id());
+        CXX_LOG_TRACE("ArrowChunkIterator: col:%d arrow::Type: %s",
+            col, m_currentSchema->field(col)->type()->name().c_str());
+    }
+}
 
-            default:
+bool ArrowChunkIterator::fetchBatch(uint32 batchIdx)
+{
+    if (batchIdx < m_cRecordBatches.size())
+    {
+        return true;
+    }
+    if (!m_stream)
+    {
+        return false;
+    }
+
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (m_cRecordBatches.size() <= batchIdx)
+    {
+        if (!m_stream->waitForBatch(m_cRecordBatches.size(), batch))
+        {
+            return false;
+        }
+        m_cRecordBatches.emplace_back(batch);
+    }
+    m_batchCount = m_cRecordBatches.size();
+    return true;
+}
+
+void ArrowChunkIterator::releaseBatch(uint32 batchIdx)
+{
+    std::shared_ptr<arrow::RecordBatch> & batch = (m_cRecordBatches)[batchIdx];
+    if (batch && batch != m_currentBatch)
+    {
+        m_releasedRowCount += batch->num_rows();
+        batch.reset();
+    }
+}
+
+void ArrowChunkIterator::initColumnChunks()
+{
+    // Columns are only set up when they are first accessed, see getColumn()
+    m_columns.assign(m_columnCount, ArrowColumn());
+    m_columnReady.assign(m_columnCount, false);
+
+    m_currentBatch = (m_cRecordBatches)[m_currBatchIndex];
+    m_currentSchema = m_currentBatch->schema();
+    m_rowCountInBatch = m_currentBatch->num_rows();
+}
+
+void ArrowChunkIterator::initColumn(size_t colIdx)
+{
+    ArrowColumn & arrowcol = m_columns[colIdx];
+    m_columnReady[colIdx] = true;
+
+    std::shared_ptr<arrow::Array> columnArray = m_currentBatch->column(colIdx);
+    std::shared_ptr<arrow::DataType> dt = m_currentSchema->field(colIdx)->type();
+
+    // Replaced by the seconds field for timestamps
+    arrowcol.validity = columnArray.get();
+
+    switch (dt->id())
+    {
+        case arrow::Type::STRUCT: {
+            auto values = std::static_pointer_cast<arrow::StructArray>(columnArray);
+            std::shared_ptr<ArrowTimestampArray> ts(new ArrowTimestampArray);
+            ts->sse = std::static_pointer_cast<arrow::Int64Array>(values->field(0)).get();
+            if (values->num_fields() > 1)
+                ts->fs = std::static_pointer_cast<arrow::Int32Array>(values->field(1)).get();
+            if (values->num_fields() > 2)
+                ts->tz = std::static_pointer_cast<arrow::Int32Array>(values->field(2)).get();
+            arrowcol.arrowTimestamp = ts;
+            arrowcol.validity = ts->sse;
+            break;
+        }
+
+        case arrow::Type::type::DATE32: {
+            arrowcol.arrowDate32 = std::static_pointer_cast<arrow::Date32Array>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::DATE64: {
+            arrowcol.arrowDate64 = std::static_pointer_cast<arrow::Date64Array>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::STRING: {
+            arrowcol.arrowString = std::static_pointer_cast<arrow::StringArray>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::INT8: {
+            arrowcol.arrowInt8 = std::static_pointer_cast<arrow::Int8Array>(columnArray).get();
+            arrowcol.readInt64 = &readIntValue<arrow::Int8Array, &ArrowColumn::arrowInt8>;
+            break;
+        }
+        case arrow::Type::type::INT16: {
+            arrowcol.arrowInt16 = std::static_pointer_cast<arrow::Int16Array>(columnArray).get();
+            arrowcol.readInt64 = &readIntValue<arrow::Int16Array, &ArrowColumn::arrowInt16>;
+            break;
+        }
+        case arrow::Type::type::INT32: {
+            arrowcol.arrowInt32 = std::static_pointer_cast<arrow::Int32Array>(columnArray).get();
+            arrowcol.readInt64 = &readIntValue<arrow::Int32Array, &ArrowColumn::arrowInt32>;
+            break;
+        }
+        case arrow::Type::type::INT64: {
+            arrowcol.arrowInt64 = std::static_pointer_cast<arrow::Int64Array>(columnArray).get();
+            arrowcol.readInt64 = &readIntValue<arrow::Int64Array, &ArrowColumn::arrowInt64>;
+            break;
+        }
+        case arrow::Type::type::BOOL: {
+            arrowcol.arrowBoolean = std::static_pointer_cast<arrow::BooleanArray>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::BINARY: {
+            arrowcol.arrowBinary = std::static_pointer_cast<arrow::BinaryArray>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::DOUBLE: {
+            arrowcol.arrowDouble = std::static_pointer_cast<arrow::DoubleArray>(columnArray).get();
+            break;
+        }
+        case arrow::Type::type::DECIMAL:{
+            arrowcol.arrowDecimal128 = std::static_pointer_cast<arrow::Decimal128Array>(columnArray).get();
+            break;
+        }
+
+        case arrow::Type::type::DICTIONARY: {
+            auto dictionary = std::static_pointer_cast<arrow::DictionaryArray>(columnArray);
+            arrowcol.arrowDictionary = dictionary.get();
+            if (arrow::Type::type::STRING == m_arrowColumnDataTypes[colIdx])
+            {
+                arrowcol.arrowString = std::static_pointer_cast<arrow::StringArray>(dictionary->dictionary()).get();
+            }
+            else if (arrow::Type::type::BINARY == m_arrowColumnDataTypes[colIdx])
             {
-                return;
+                arrowcol.arrowBinary = std::static_pointer_cast<arrow::BinaryArray>(dictionary->dictionary()).get();
             }
+            break;
+        }
+
+        default:
+        {
+            // Only the validity is known, the getters reject the type
+            break;
         }
     }
 }
 } // namespace Client
 } // namespace Snowflake
-#endif // ifndef SF_WIN32
+#endif // ifndef SF_NO_ARROW
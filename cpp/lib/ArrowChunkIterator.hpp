@@ -6,15 +6,18 @@
 
 #include "arrowheaders.hpp"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
 #include "snowflake/basic_types.h"
 #include "snowflake/client.h"
+#include "ArrowChunkBuffer.hpp"
+#include "ArrowChunkStream.hpp"
 
 namespace Snowflake
 {
@@ -74,6 +77,40 @@ struct ArrowColumn
     arrow::Int64Array      * arrowInt64;
     arrow::StringArray     * arrowString;
     std::shared_ptr<ArrowTimestampArray> arrowTimestamp;
+
+    // Set for dictionary-encoded strings, arrowString or arrowBinary is the dictionary then.
+    arrow::DictionaryArray * arrowDictionary;
+
+    // The array holding the validity of the cells, which is the seconds field for timestamps.
+    arrow::Array           * validity;
+
+    // Reads a cell of an INT8, INT16, INT32 or INT64 column as int64, NULL for other types.
+    int64 (*readInt64)(const ArrowColumn & column, int64 row);
+};
+
+/**
+ * The UTC offset of the session timezone over one day.
+ */
+struct ArrowLocalTimeOffset
+{
+    // Seconds east of UTC
+    int64 gmtOffset;
+    int isDst;
+    // The offset changes during the day, so it is looked up for every value instead.
+    bool changes;
+};
+
+/**
+ * The string form of every cell of a column in one record batch.
+ */
+struct ArrowStringColumn
+{
+    // Null terminated values, back to back
+    std::vector<char> data;
+    // Start of the value of each row in data. Rows with the same dictionary entry share it.
+    std::vector<size_t> offsets;
+    // Rows that failed to convert. They are left empty.
+    std::vector<bool> failed;
 };
 
 /**
@@ -137,11 +174,23 @@ public:
     /**
      * Parameterized constructor.
      *
-     * @param chunk           The chunk
+     * @param chunk           The chunk, deleted by the iterator.
+     * @param metadata        The column metadata retrieved from the Snowflake DB.
+     * @param tzString        The time zone.
+     */
+    ArrowChunkIterator(ArrowChunkBuffer * chunk,
+                       SF_COLUMN_DESC * metadata, std::string tzString,
+                       ResultSetArrow * parent);
+
+    /**
+     * Constructs an iterator over a chunk that is still being downloaded.
+     * Blocks until the first record batch has been received.
+     *
+     * @param stream          The chunk stream. The iterator takes over the consumer's reference.
      * @param metadata        The column metadata retrieved from the Snowflake DB.
      * @param tzString        The time zone.
      */
-    ArrowChunkIterator(arrow::BufferBuilder * chunk,
+    ArrowChunkIterator(ArrowChunkStream * stream,
                        SF_COLUMN_DESC * metadata, std::string tzString,
                        ResultSetArrow * parent);
 
@@ -331,6 +380,43 @@ public:
         size_t colIdx,
         std::string& outString);
 
+    /**
+     * Converts every cell of a column in the current record batch, like getCellAsString().
+     *
+     * @param colIdx               The index of the column to convert.
+     * @param outColumn            The converted column.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getColumnAsStrings(size_t colIdx, ArrowStringColumn & outColumn);
+
+    /**
+     * Gets the text of the given cell, pointing into the value buffer of the record batch,
+     * for the columns whose text is stored as is in Arrow.
+     *
+     * @param colIdx               The index of the column to get.
+     * @param outData              Set to the text of the cell, NULL for null cells.
+     * @param outLen               Set to the length of the text.
+     *
+     * @return false if the text of the column has to be formatted, nothing is set then.
+     */
+    bool getCellAsStrView(size_t colIdx, const char ** outData, size_t * outLen);
+
+    /**
+     * Gets the raw bytes of the given cell, pointing into the value buffer of the record batch.
+     *
+     * This API method supports the following data types:
+     * - BINARY
+     * - STRING
+     *
+     * @param colIdx               The index of the column to get.
+     * @param out_data             Set to the bytes of the cell, NULL for null cells.
+     * @param out_len              Set to the number of bytes.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getCellAsBinary(size_t colIdx, const void ** out_data, size_t * out_len);
+
     /**
      * Gets the value of the given cell as a timestamp.
      *
@@ -358,6 +444,91 @@ public:
         return m_columnCount;
     }
 
+    /**
+     * @return true if the chunk was streamed and its download failed before all record
+     *         batches were received.
+     */
+    bool isIncomplete()
+    {
+        return m_stream && m_stream->failed();
+    }
+
+    uint32 getCurrentBatchIndex()
+    {
+        return m_currBatchIndex;
+    }
+
+    uint32 getCurrentRowIndexInBatch()
+    {
+        return m_currRowIndexInBatch;
+    }
+
+    /**
+     * @return the number of rows left in the current record batch, the current row included.
+     */
+    uint32 getRowsLeftInBatch()
+    {
+        return m_currRowIndexInBatch < m_rowCountInBatch ?
+            m_rowCountInBatch - m_currRowIndexInBatch : 0;
+    }
+
+    /**
+     * Copies the values of a column for a run of rows, starting at the current row, straight
+     * from the record batch. Only done where the Arrow layout holds the values as they would
+     * be returned by the single cell getters:
+     * - INT8, INT16, INT32, INT64 without scale, as int64
+     * - INT8, INT16, INT32, INT64 with a scale, as float64
+     * - DOUBLE, as float64
+     * - DECIMAL without scale, as int64, and DECIMAL as float64, while the values fit
+     * - BOOLEAN, as sf_bool
+     * - TIMESTAMP_NTZ, TIMESTAMP_LTZ and TIMESTAMP_TZ, as SF_TIMESTAMP
+     *
+     * @param colIdx               The index of the column to copy.
+     * @param cType                The C type of the values in outData.
+     * @param outData              The buffer to write rowCount values to.
+     * @param nullBitmap           Bit i is set if row i is null, cleared otherwise. May be NULL.
+     * @param bitOffset            The bit of the current row in nullBitmap.
+     * @param rowCount             The number of rows, at most getRowsLeftInBatch().
+     *
+     * @return false if the column has to be read cell by cell, which overwrites anything
+     *         written to the buffers.
+     */
+    bool copyColumn(size_t colIdx, SF_C_TYPE cType, void * outData, uint8 * nullBitmap,
+                    size_t bitOffset, uint32 rowCount);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row, straight
+     * from the validity buffer of the record batch. See copyNullBits().
+     *
+     * @param colIdx               The index of the column.
+     * @param nullBitmap           The (rowCount + 7) / 8 bytes to write.
+     * @param rowCount             The number of rows, at most getRowsLeftInBatch().
+     * @param nullCount            Receives the number of NULL rows.
+     *
+     * @return false if the column index or the number of rows is out of bounds.
+     */
+    bool copyNullBitmap(size_t colIdx, uint8 * nullBitmap, uint32 rowCount, size_t * nullCount);
+
+    /**
+     * Exports the next record batch of the chunk through the Arrow C data interface, without
+     * copying the column buffers. Independent of the row position of next().
+     *
+     * @param outArray             Receives the record batch as a struct array.
+     * @param outSchema            Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if all record batches have been exported,
+     *         otherwise an error is returned.
+     */
+    SF_STATUS STDCALL exportNextBatch(struct ArrowArray * outArray, struct ArrowSchema * outSchema);
+
+    /**
+     * Moves forward by the given number of rows, at most getRowsLeftInBatch() - 1.
+     */
+    void skipRows(uint32 rowCount)
+    {
+        m_currRowIndexInBatch += rowCount;
+    }
+
 protected:
     /** schema of current record batch */
     std::shared_ptr<arrow::Schema> m_currentSchema;
@@ -368,11 +539,87 @@ protected:
      */
     std::vector<ArrowColumn> m_columns;
 
+    /**
+     * Whether each entry of m_columns has been set up for the current record batch.
+     */
+    std::vector<bool> m_columnReady;
+
+    /**
+     * The current record batch, once next() has been called.
+     */
+    std::shared_ptr<arrow::RecordBatch> m_currentBatch;
+
+    /**
+     * Returns a column of the current record batch, setting it up on first access so that
+     * columns which are never read cost nothing.
+     */
+    ArrowColumn & getColumn(size_t colIdx)
+    {
+        if (!m_columnReady[colIdx])
+        {
+            initColumn(colIdx);
+        }
+        return m_columns[colIdx];
+    }
+
 private:
 
-    /** Column chunks */
+    /**
+     * Converts a run of timestamp values to SF_TIMESTAMP the same way getCellAsTimestamp()
+     * does, but with the calendar arithmetic done here instead of in libc.
+     *
+     * @return false if the column has to be read cell by cell.
+     */
+    bool copyTimestamps(size_t colIdx, SF_TIMESTAMP * outData, uint8 * nullBitmap,
+                        size_t bitOffset, uint32 rowCount);
+
+    /**
+     * Looks up the offset of the session timezone for the day of the given time.
+     *
+     * @return false if the timezone could not be applied.
+     */
+    bool getLocalTimeOffset(int64 secondsSinceEpoch, ArrowLocalTimeOffset & outOffset);
+
+    /** Moves to the current record batch, resetting its columns */
     void initColumnChunks();
 
+    /** Sets up a column of the current record batch */
+    void initColumn(size_t colIdx);
+
+    /**
+     * Index of the value of the current row in the string or binary array of a column, which
+     * is the dictionary of a dictionary-encoded column.
+     */
+    int64 getValueIndex(size_t colIdx)
+    {
+        const ArrowColumn & column = getColumn(colIdx);
+        return column.arrowDictionary ?
+            column.arrowDictionary->GetValueIndex(m_currRowIndexInBatch) : m_currRowIndexInBatch;
+    }
+
+    /**
+     * Fills the string form of a dictionary-encoded string column, converting every
+     * dictionary entry once.
+     */
+    void getDictionaryAsStrings(const ArrowColumn & column, ArrowStringColumn & outColumn);
+
+    /** Initializes the iterator state from the record batches received so far */
+    void initBatches();
+
+    /**
+     * Makes sure the given record batch is in m_cRecordBatches, waiting for it if the chunk
+     * is still being streamed.
+     *
+     * @return false if the chunk has fewer record batches.
+     */
+    bool fetchBatch(uint32 batchIdx);
+
+    /**
+     * Drops the reference to a record batch the cursor has moved past, so that its memory is
+     * freed once no exported array holds it, rather than along with the whole chunk.
+     */
+    void releaseBatch(uint32 batchIdx);
+
     // Private members =============================================================================
 
     /**
@@ -395,6 +642,16 @@ private:
      */
     uint32 m_currBatchIndex;
 
+    /**
+     * Index of the next record batch to export with exportNextBatch().
+     */
+    uint32 m_exportBatchIndex;
+
+    /**
+     * Number of rows of the record batches released already, see releaseBatch().
+     */
+    size_t m_releasedRowCount;
+
     /**
      * Row index inside current record batch. Zero-indexed.
      * Internal use only.
@@ -416,11 +673,21 @@ private:
      */
     std::string m_tzString;
 
+    /**
+     * Offsets of m_tzString that have been looked up in libc, by day since the epoch.
+     */
+    std::unordered_map<int64, ArrowLocalTimeOffset> m_localTimeOffsets;
+
     ResultSetArrow * m_parent;
+
+    /**
+     * The chunk stream the record batches are taken from, if the chunk is streamed.
+     */
+    std::shared_ptr<ArrowChunkStream> m_stream;
 };
 
 } // namespace Client
 } // namespace Snowflake
 
-#endif  // SF_WIN32
+#endif  // SF_NO_ARROW
 #endif  // SNOWFLAKECLIENT_ARROWCHUNKITERATOR_HPP
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All right reserved.
+ */
+
+#include <string>
+
+#include "../logger/SFLogger.hpp"
+#include "ArrowChunkStream.hpp"
+#include "ChunkMemoryPool.hpp"
+
+#ifndef SF_NO_ARROW
+
+namespace Snowflake
+{
+namespace Client
+{
+
+ArrowChunkStream::ArrowChunkStream() :
+    m_done(false),
+    m_failed(false),
+    m_bytesDecoded(0),
+    m_bytesInAttempt(0),
+    m_refCount(2)
+{
+    arrow::ipc::IpcReadOptions options = arrow::ipc::IpcReadOptions::Defaults();
+    options.memory_pool = ChunkMemoryPool::instance();
+    m_decoder.reset(new arrow::ipc::StreamDecoder(std::make_shared<Listener>(this), options));
+}
+
+void ArrowChunkStream::retain()
+{
+    m_refCount++;
+}
+
+void ArrowChunkStream::release()
+{
+    if (--m_refCount == 0)
+    {
+        delete this;
+    }
+}
+
+size_t ArrowChunkStream::write(const char * data, size_t size)
+{
+    // Part of this attempt that an earlier attempt has already decoded
+    int64 skip = m_bytesDecoded - m_bytesInAttempt;
+    size_t newSize = size;
+    m_bytesInAttempt += size;
+    if (skip >= (int64) size)
+    {
+        return size;
+    }
+    if (skip > 0)
+    {
+        data += skip;
+        newSize -= (size_t) skip;
+    }
+
+    // The data belongs to curl, so the decoder gets its own copy
+    arrow::Status status = m_decoder->Consume(arrow::Buffer::FromString(std::string(data, newSize)));
+    if (!status.ok())
+    {
+        CXX_LOG_ERROR("ArrowChunkStream: unable to decode chunk: %s", status.ToString().c_str());
+        return 0;
+    }
+    m_bytesDecoded += newSize;
+    return size;
+}
+
+void ArrowChunkStream::reset()
+{
+    m_bytesInAttempt = 0;
+}
+
+void ArrowChunkStream::finish(bool success)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+        m_failed = !success;
+    }
+    m_cond.notify_all();
+    release();
+}
+
+bool ArrowChunkStream::waitForBatch(size_t index, std::shared_ptr<arrow::RecordBatch> & batch)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this, index] { return m_batches.size() > index || m_done; });
+    if (m_batches.size() <= index)
+    {
+        return false;
+    }
+    batch = m_batches[index];
+    return true;
+}
+
+bool ArrowChunkStream::failed()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+arrow::Status ArrowChunkStream::Listener::OnRecordBatchDecoded(std::shared_ptr<arrow::RecordBatch> batch)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stream->m_mutex);
+        m_stream->m_batches.emplace_back(batch);
+    }
+    m_stream->m_cond.notify_all();
+    return arrow::Status::OK();
+}
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All Rights Reserved
+ */
+#ifndef SNOWFLAKECLIENT_ARROWCHUNKSTREAM_HPP
+#define SNOWFLAKECLIENT_ARROWCHUNKSTREAM_HPP
+
+#include "arrowheaders.hpp"
+
+#ifndef SF_NO_ARROW
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "snowflake/basic_types.h"
+
+namespace Snowflake
+{
+namespace Client
+{
+
+/**
+ * An Arrow-format chunk that is decoded while it is being downloaded.
+ *
+ * The chunk downloader feeds the response body into write() as it arrives and every record
+ * batch becomes available to the consumer as soon as all of its bytes have been received,
+ * instead of after the whole chunk has been buffered.
+ *
+ * The stream is shared by the downloader thread and the consumer, and is reference counted:
+ * it is created with one reference for each side, and the downloader drops its reference in
+ * finish().
+ */
+class ArrowChunkStream
+{
+public:
+
+    ArrowChunkStream();
+
+    ~ArrowChunkStream() = default;
+
+    void retain();
+
+    void release();
+
+    // Downloader side =============================================================================
+
+    /**
+     * Decodes the next part of the response body.
+     *
+     * Bytes that have already been decoded during a previous attempt are skipped, since a
+     * retried download returns the same body from the start.
+     *
+     * @return the number of bytes handled, or 0 to abort the download if the data is invalid.
+     */
+    size_t write(const char * data, size_t size);
+
+    /**
+     * Marks the start of a new download attempt.
+     */
+    void reset();
+
+    /**
+     * Marks the end of the download and drops the downloader's reference.
+     *
+     * @param success              false if the download failed for good.
+     */
+    void finish(bool success);
+
+    // Consumer side ===============================================================================
+
+    /**
+     * Waits until the given record batch has been received, or the download has ended.
+     *
+     * @param index                The zero-based index of the record batch in the chunk.
+     * @param batch                Set to the record batch.
+     *
+     * @return false if the chunk has fewer record batches.
+     */
+    bool waitForBatch(size_t index, std::shared_ptr<arrow::RecordBatch> & batch);
+
+    /**
+     * @return true if the download failed. Only meaningful once waitForBatch() returned false.
+     */
+    bool failed();
+
+private:
+
+    class Listener : public arrow::ipc::Listener
+    {
+    public:
+        explicit Listener(ArrowChunkStream * stream) : m_stream(stream)
+        {
+        }
+
+        arrow::Status OnRecordBatchDecoded(std::shared_ptr<arrow::RecordBatch> batch) override;
+
+    private:
+        ArrowChunkStream * m_stream;
+    };
+
+    std::mutex m_mutex;
+
+    std::condition_variable m_cond;
+
+    /**
+     * Record batches decoded so far. Protected by m_mutex.
+     */
+    std::vector<std::shared_ptr<arrow::RecordBatch> > m_batches;
+
+    /**
+     * Set once the download has ended. Protected by m_mutex.
+     */
+    bool m_done;
+
+    bool m_failed;
+
+    /**
+     * Only used by the downloader thread.
+     */
+    std::unique_ptr<arrow::ipc::StreamDecoder> m_decoder;
+
+    /**
+     * Number of body bytes fed to the decoder, and received in the current attempt.
+     */
+    int64 m_bytesDecoded;
+
+    int64 m_bytesInAttempt;
+
+    std::atomic<int> m_refCount;
+};
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
+#endif // SNOWFLAKECLIENT_ARROWCHUNKSTREAM_HPP
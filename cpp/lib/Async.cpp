@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <snowflake/Async.hpp>
+#include "../util/ThreadPool.hpp"
+#include "../logger/SFLogger.hpp"
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace
+{
+  // Threads running the blocking calls of the asynchronous API
+  const unsigned int WORKER_THREADS = 4;
+
+  // The status of a query is polled often at first, then less and less
+  const std::chrono::milliseconds FIRST_POLL_INTERVAL(50);
+  const std::chrono::milliseconds MAX_POLL_INTERVAL(1000);
+
+  typedef std::shared_ptr<std::promise<SF_STATUS>> StatusPromise;
+
+  /**
+   * Service thread polling the status of the queries submitted by executeAsync(), and the
+   * worker pool the blocking calls run on. Created on first use, stopped at exit.
+   */
+  class AsyncService
+  {
+  public:
+    static AsyncService &instance()
+    {
+      static AsyncService service;
+      return service;
+    }
+
+    void run(std::function<void(void)> job)
+    {
+      m_pool.AddJob(std::move(job));
+    }
+
+    /**
+     * Polls the query of the statement until it has finished, then fetches its results.
+     */
+    void watch(SF_STMT *sfstmt, StatusPromise promise)
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      Query query;
+      query.sfstmt = sfstmt;
+      query.promise = promise;
+      query.interval = FIRST_POLL_INTERVAL;
+      query.nextPoll = std::chrono::steady_clock::now() + query.interval;
+      m_queries.push_back(query);
+      m_wakeup.notify_one();
+    }
+
+  private:
+    struct Query
+    {
+      SF_STMT *sfstmt;
+      StatusPromise promise;
+      std::chrono::milliseconds interval;
+      std::chrono::steady_clock::time_point nextPoll;
+    };
+
+    AsyncService() : m_pool(WORKER_THREADS), m_stopped(false)
+    {
+      m_thread = std::thread([this]() { poll(); });
+    }
+
+    ~AsyncService()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stopped = true;
+        m_wakeup.notify_one();
+      }
+      m_thread.join();
+    }
+
+    void poll()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (!m_stopped)
+      {
+        if (m_queries.empty())
+        {
+          m_wakeup.wait(lock);
+          continue;
+        }
+
+        std::chrono::steady_clock::time_point next = m_queries.front().nextPoll;
+        for (auto i = m_queries.begin(); i != m_queries.end(); i++)
+        {
+          if (i->nextPoll < next)
+          {
+            next = i->nextPoll;
+          }
+        }
+        if (m_wakeup.wait_until(lock, next) == std::cv_status::no_timeout)
+        {
+          // A query was added or the service stopped
+          continue;
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (auto i = m_queries.begin(); i != m_queries.end() && !m_stopped;)
+        {
+          if (i->nextPoll > now)
+          {
+            i++;
+            continue;
+          }
+          // The request is made without the lock, so that queries can be added meanwhile
+          Query query = *i;
+          lock.unlock();
+          bool done = check(query);
+          lock.lock();
+          if (done)
+          {
+            i = m_queries.erase(i);
+          }
+          else
+          {
+            i->interval = std::min(i->interval * 2, MAX_POLL_INTERVAL);
+            i->nextPoll = std::chrono::steady_clock::now() + i->interval;
+            i++;
+          }
+        }
+      }
+    }
+
+    /**
+     * @return true once the query has finished, its results then being fetched.
+     */
+    bool check(Query &query)
+    {
+      SF_STMT *sfstmt = query.sfstmt;
+      SF_QUERY_STATUS queryStatus;
+      SF_STATUS status = snowflake_query_status(sfstmt->connection, snowflake_sfqid(sfstmt),
+                                                &queryStatus);
+      if (status != SF_STATUS_SUCCESS)
+      {
+        CXX_LOG_ERROR("Unable to get the status of query %s, error %d",
+                      snowflake_sfqid(sfstmt), status);
+        query.promise->set_value(status);
+        return true;
+      }
+      if (snowflake_query_status_is_running(queryStatus))
+      {
+        return false;
+      }
+
+      StatusPromise promise = query.promise;
+      run([sfstmt, promise]() {
+        promise->set_value(snowflake_get_results(sfstmt, NULL));
+      });
+      return true;
+    }
+
+    Util::ThreadPool m_pool;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::list<Query> m_queries;
+    bool m_stopped;
+    std::thread m_thread;
+  };
+}
+}
+}
+
+std::future<SF_STATUS> Snowflake::Client::executeAsync(SF_STMT *sfstmt)
+{
+  StatusPromise promise = std::make_shared<std::promise<SF_STATUS>>();
+  std::future<SF_STATUS> future = promise->get_future();
+  AsyncService &service = AsyncService::instance();
+  service.run([sfstmt, promise, &service]() {
+    SF_STATUS status = snowflake_execute_async(sfstmt);
+    if (status != SF_STATUS_SUCCESS)
+    {
+      promise->set_value(status);
+      return;
+    }
+    service.watch(sfstmt, promise);
+  });
+  return future;
+}
+
+std::future<SF_STATUS> Snowflake::Client::fetchChunkAsync(SF_STMT *sfstmt,
+                                                         SF_RESULT_CHUNK **chunk,
+                                                         SF_ERROR_STRUCT *error)
+{
+  StatusPromise promise = std::make_shared<std::promise<SF_STATUS>>();
+  std::future<SF_STATUS> future = promise->get_future();
+  AsyncService::instance().run([sfstmt, chunk, error, promise]() {
+    promise->set_value(snowflake_fetch_chunk(sfstmt, chunk, error));
+  });
+  return future;
+}
@@ -0,0 +1,115 @@
+/*
+  * Copyright (c) 2021 Snowflake Computing, Inc. All right reserved.
+  */
+
+#include <cstring>
+
+#include "ChunkMemoryPool.hpp"
+#include "memory.h"
+
+#ifndef SF_NO_ARROW
+
+namespace Snowflake
+{
+namespace Client
+{
+
+namespace
+{
+
+bool isPooled(int64_t size)
+{
+    return size > 0 && sf_memory_pool_class_size((size_t) size) > 0;
+}
+
+}
+
+ChunkMemoryPool * ChunkMemoryPool::instance()
+{
+    // Never destroyed, buffers may still be released while the process exits
+    static ChunkMemoryPool * pool = new ChunkMemoryPool();
+    return pool;
+}
+
+ChunkMemoryPool::ChunkMemoryPool() :
+    m_bytesAllocated(0),
+    m_maxMemory(0)
+{
+}
+
+void ChunkMemoryPool::allocated(int64_t size)
+{
+    int64_t used = m_bytesAllocated.fetch_add(size) + size;
+    int64_t max = m_maxMemory.load();
+    while (used > max && !m_maxMemory.compare_exchange_weak(max, used))
+    {
+    }
+}
+
+arrow::Status ChunkMemoryPool::Allocate(int64_t size, uint8_t ** out)
+{
+    if (!isPooled(size))
+    {
+        arrow::Status status = arrow::default_memory_pool()->Allocate(size, out);
+        if (status.ok())
+        {
+            allocated(size);
+        }
+        return status;
+    }
+    *out = (uint8_t *) sf_memory_pool_alloc((size_t) size);
+    if (!*out)
+    {
+        return arrow::Status::OutOfMemory("malloc of size ", size, " failed");
+    }
+    allocated(size);
+    return arrow::Status::OK();
+}
+
+arrow::Status ChunkMemoryPool::Reallocate(int64_t old_size, int64_t new_size, uint8_t ** ptr)
+{
+    if (!isPooled(old_size) && !isPooled(new_size))
+    {
+        arrow::Status status = arrow::default_memory_pool()->Reallocate(old_size, new_size, ptr);
+        if (status.ok())
+        {
+            allocated(new_size - old_size);
+        }
+        return status;
+    }
+    if (sf_memory_pool_class_size((size_t) old_size) == sf_memory_pool_class_size((size_t) new_size))
+    {
+        // Still fits in its class
+        allocated(new_size - old_size);
+        return arrow::Status::OK();
+    }
+
+    uint8_t * data;
+    arrow::Status status = Allocate(new_size, &data);
+    if (!status.ok())
+    {
+        return status;
+    }
+    std::memcpy(data, *ptr, (size_t) (old_size < new_size ? old_size : new_size));
+    Free(*ptr, old_size);
+    *ptr = data;
+    return arrow::Status::OK();
+}
+
+void ChunkMemoryPool::Free(uint8_t * buffer, int64_t size)
+{
+    if (isPooled(size))
+    {
+        sf_memory_pool_free(buffer, (size_t) size);
+    }
+    else
+    {
+        arrow::default_memory_pool()->Free(buffer, size);
+    }
+    m_bytesAllocated.fetch_sub(size);
+}
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
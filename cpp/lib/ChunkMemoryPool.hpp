@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All Rights Reserved
+ */
+#ifndef SNOWFLAKECLIENT_CHUNKMEMORYPOOL_HPP
+#define SNOWFLAKECLIENT_CHUNKMEMORYPOOL_HPP
+
+#include "arrowheaders.hpp"
+
+#ifndef SF_NO_ARROW
+
+#include <atomic>
+#include <string>
+
+namespace Snowflake
+{
+namespace Client
+{
+
+/**
+ * Memory pool of the Arrow chunks. The buffers of the sizes the pool of the library has
+ * classes for, see sf_memory_pool_alloc(), are taken from it, so that the body of a chunk
+ * reuses the memory of a chunk released before. The other buffers come from the default pool.
+ */
+class ChunkMemoryPool : public arrow::MemoryPool
+{
+public:
+
+    /**
+     * @return the pool shared by all the statements.
+     */
+    static ChunkMemoryPool * instance();
+
+    arrow::Status Allocate(int64_t size, uint8_t ** out) override;
+
+    arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t ** ptr) override;
+
+    void Free(uint8_t * buffer, int64_t size) override;
+
+    int64_t bytes_allocated() const override
+    {
+        return m_bytesAllocated.load();
+    }
+
+    int64_t max_memory() const override
+    {
+        return m_maxMemory.load();
+    }
+
+    std::string backend_name() const override
+    {
+        return "snowflake";
+    }
+
+private:
+
+    ChunkMemoryPool();
+
+    void allocated(int64_t size);
+
+    std::atomic<int64_t> m_bytesAllocated;
+
+    std::atomic<int64_t> m_maxMemory;
+};
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
+#endif // SNOWFLAKECLIENT_CHUNKMEMORYPOOL_HPP
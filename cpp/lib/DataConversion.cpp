@@ -6,6 +6,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <limits>
 #include <stdexcept>
@@ -18,7 +19,7 @@
 #include "DataConversion.hpp"
 #include "ResultSet.hpp"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 namespace Snowflake
 {
 namespace Client
@@ -188,6 +189,29 @@ SF_STATUS STDCALL DateToString(
     char dateBuf[64];
     const char * dateFormat = "%Y-%m-%d";
 
+    // The days of years with four digits, nearly all of them, are written
+    // digit by digit rather than through gmtime and strftime.
+    if (date >= DATE_MIN_FIXED_WIDTH && date <= DATE_MAX_FIXED_WIDTH)
+    {
+        struct tm tm_obj;
+        EpochToTm(date * SECONDS_IN_DAY, tm_obj);
+        int values[] = {tm_obj.tm_year + 1900, tm_obj.tm_mon + 1, tm_obj.tm_mday};
+        int widths[] = {4, 2, 2};
+        char * out = dateBuf;
+        for (int i = 0; i < 3; i++)
+        {
+            char * end = out + widths[i];
+            for (int value = values[i]; end > out; value /= 10)
+            {
+                *--end = (char) ('0' + value % 10);
+            }
+            out += widths[i];
+            *out++ = '-';
+        }
+        outString.assign(dateBuf, out - dateBuf - 1);
+        return SF_STATUS_SUCCESS;
+    }
+
     // The main logic for the conversion.
     struct tm tm_obj;
     struct tm *tm_ptr;
@@ -250,9 +274,174 @@ SF_STATUS STDCALL TimeToString(
     return SF_STATUS_SUCCESS;
 }
 
+namespace
+{
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Writes the digits of a magnitude backwards, least significant pair first, ending at end.
+ */
+char * writeDigits(uint64 magnitude, char * end)
+{
+    char * digits = end;
+    while (magnitude >= 100)
+    {
+        const char * pair = &DIGIT_PAIRS[(magnitude % 100) * 2];
+        magnitude /= 100;
+        *--digits = pair[1];
+        *--digits = pair[0];
+    }
+    if (magnitude >= 10)
+    {
+        const char * pair = &DIGIT_PAIRS[magnitude * 2];
+        *--digits = pair[1];
+        *--digits = pair[0];
+    }
+    else
+    {
+        *--digits = (char) ('0' + magnitude);
+    }
+    return digits;
+}
+
+/**
+ * Writes the digits between digits and end with the sign and the decimal point of the scale.
+ */
+size_t writeScaled(char * digits, char * end, bool negative, int64 scale, char * outBuf)
+{
+    // Pad with zeros so that there is one integral digit
+    size_t digitCount = end - digits;
+    while (digitCount <= (size_t) scale)
+    {
+        *--digits = '0';
+        digitCount++;
+    }
+
+    char * out = outBuf;
+    if (negative)
+    {
+        *out++ = '-';
+    }
+    size_t integralCount = digitCount - (size_t) scale;
+    memcpy(out, digits, integralCount);
+    out += integralCount;
+    if (scale > 0)
+    {
+        *out++ = '.';
+        memcpy(out, digits + integralCount, (size_t) scale);
+        out += scale;
+    }
+    return out - outBuf;
+}
+
+} // namespace
+
+size_t FixedToChars(int64 value, int64 scale, char * outBuf)
+{
+    char digitBuf[FIXED_MAX_CHARS];
+    char * const end = digitBuf + sizeof(digitBuf);
+    bool negative = value < 0;
+    uint64 magnitude = negative ? 0 - (uint64) value : (uint64) value;
+
+    return writeScaled(writeDigits(magnitude, end), end, negative, scale, outBuf);
+}
+
+size_t Decimal128ToChars(int64 highBits, uint64 lowBits, int64 scale, char * outBuf)
+{
+    char digitBuf[FIXED_MAX_CHARS];
+    char * const end = digitBuf + sizeof(digitBuf);
+    char * digits = end;
+    bool negative = highBits < 0;
+    uint64 high = (uint64) highBits;
+    uint64 low = lowBits;
+    if (negative)
+    {
+        // Two's complement of the 128 bits
+        low = ~low + 1;
+        high = ~high + (low == 0 ? 1 : 0);
+    }
+
+    // Nine digits at a time while the magnitude takes more than 64 bits, dividing the 32-bit
+    // limbs by 10^9 so that no step needs 128-bit arithmetic
+    while (high != 0)
+    {
+        uint32 limbs[4] = {
+            (uint32) (high >> 32), (uint32) high, (uint32) (low >> 32), (uint32) low
+        };
+        uint64 remainder = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            uint64 current = (remainder << 32) | limbs[i];
+            limbs[i] = (uint32) (current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        high = ((uint64) limbs[0] << 32) | limbs[1];
+        low = ((uint64) limbs[2] << 32) | limbs[3];
+        for (int i = 0; i < 9; ++i)
+        {
+            *--digits = (char) ('0' + remainder % 10);
+            remainder /= 10;
+        }
+    }
+    digits = writeDigits(low, digits);
+
+    // Decimal128::ToString() switches to scientific notation, leave those values to it
+    if ((int64) (end - digits) - 1 - scale < -6)
+    {
+        return 0;
+    }
+    return writeScaled(digits, end, negative, scale, outBuf);
+}
+
+void EpochToTm(int64 secondsSinceEpoch, struct tm & outTm)
+{
+    int64 days = secondsSinceEpoch / SECONDS_IN_DAY;
+    int64 secondsInDay = secondsSinceEpoch % SECONDS_IN_DAY;
+    if (secondsInDay < 0)
+    {
+        secondsInDay += SECONDS_IN_DAY;
+        days--;
+    }
+    outTm.tm_hour = (int)(secondsInDay / 3600);
+    outTm.tm_min = (int)(secondsInDay / 60 % 60);
+    outTm.tm_sec = (int)(secondsInDay % 60);
+    // 1970-01-01 was a Thursday
+    outTm.tm_wday = (int)(((days + 4) % 7 + 7) % 7);
+
+    // Civil date from the day number, with years starting on March 1st so the leap day is last
+    int64 z = days + 719468;
+    int64 era = (z >= 0 ? z : z - 146096) / 146097;
+    int64 dayOfEra = z - era * 146097;
+    int64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64 shiftedMonth = (5 * dayOfYear + 2) / 153;
+    int64 day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    int64 month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    int64 year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    bool leap = ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+    static const int daysBeforeMonth[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+    outTm.tm_year = (int)(year - 1900);
+    outTm.tm_mon = (int)(month - 1);
+    outTm.tm_mday = (int)day;
+    outTm.tm_yday = daysBeforeMonth[month - 1] + (int)day - 1 + ((leap && month > 2) ? 1 : 0);
+    outTm.tm_isdst = 0;
+}
+
 } // namespace Arrow
 } // namespace Conversion
 } // namespace Client
 } // namespace Snowflake
 
-#endif // SF_WIN32
+#endif // SF_NO_ARROW
@@ -15,7 +15,7 @@
 #include "snowflake/client.h"
 #include "ArrowChunkIterator.hpp"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 namespace Snowflake
 {
 namespace Client
@@ -31,33 +31,34 @@ enum IntegerType
 };
 
 /**
- * Internal map to get the lower limit of the associated IntegerType.
+ * Internal table of the lower limit of each IntegerType, indexed by it.
+ * Constant initialized, unlike a map it costs nothing at load time.
  */
-static std::map<IntegerType, int64> intTypeToLowerLimit =
+static const int64 intTypeToLowerLimit[] =
 {
-    { INT8,   CHAR_MIN },
-    { INT16,  SHRT_MIN },
-    { INT32,  SF_INT32_MIN },
-    { INT64,  SF_INT64_MIN },
-    { UINT8,  CHAR_MIN },
-    { UINT16, SHRT_MIN },
-    { UINT32, SF_INT32_MIN },
-    { UINT64, SF_INT64_MIN }
+    /* INT8 */   CHAR_MIN,
+    /* INT16 */  SHRT_MIN,
+    /* INT32 */  SF_INT32_MIN,
+    /* INT64 */  SF_INT64_MIN,
+    /* UINT8 */  CHAR_MIN,
+    /* UINT16 */ SHRT_MIN,
+    /* UINT32 */ SF_INT32_MIN,
+    /* UINT64 */ SF_INT64_MIN
 };
 
 /**
- * Internal map to get the upper limit of the associated IntegerType.
+ * Internal table of the upper limit of each IntegerType, indexed by it.
  */
-static std::map<IntegerType, uint64> intTypeToUpperLimit =
+static const uint64 intTypeToUpperLimit[] =
 {
-    { INT8,   CHAR_MAX },
-    { INT16,  SHRT_MAX },
-    { INT32,  SF_INT32_MAX },
-    { INT64,  SF_INT64_MAX },
-    { UINT8,  UCHAR_MAX },
-    { UINT16, USHRT_MAX },
-    { UINT32, SF_UINT32_MAX },
-    { UINT64, SF_UINT64_MAX }
+    /* INT8 */   CHAR_MAX,
+    /* INT16 */  SHRT_MAX,
+    /* INT32 */  SF_INT32_MAX,
+    /* INT64 */  SF_INT64_MAX,
+    /* UINT8 */  UCHAR_MAX,
+    /* UINT16 */ USHRT_MAX,
+    /* UINT32 */ SF_UINT32_MAX,
+    /* UINT64 */ SF_UINT64_MAX
 };
 
 const int64 power10[10] = {
@@ -73,6 +74,16 @@ const int64 power10[10] = {
     1000000000
 };
 
+/**
+ * Powers of 10 up to the maximum scale of a NUMBER value.
+ */
+const float64 doublePower10[38] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+    1e20, 1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28, 1e29,
+    1e30, 1e31, 1e32, 1e33, 1e34, 1e35, 1e36, 1e37
+};
+
 /**
  * Namespace capturing all data conversion functions.
  */
@@ -174,10 +185,129 @@ namespace Arrow
         int64 scale,
         std::string& outString);
 
+    /**
+     * Maximum number of characters written by FixedToChars().
+     */
+    const size_t FIXED_MAX_CHARS = 48;
+
+    /**
+     * Maximum scale of a NUMBER value.
+     */
+    const int64 FIXED_MAX_SCALE = 37;
+
+    /**
+     * Number of seconds in a day, ignoring leap seconds like the epoch does.
+     */
+    const int64 SECONDS_IN_DAY = 86400;
+
+    /**
+     * Days since the epoch of 1000-01-01 and 9999-12-31, the dates written in a fixed width.
+     */
+    const int64 DATE_MIN_FIXED_WIDTH = -354285;
+    const int64 DATE_MAX_FIXED_WIDTH = 2932896;
+
+    /**
+     * Function to format a scaled integer, the Arrow form of a NUMBER(p, s) value, with exactly
+     * `scale` fractional digits, e.g. 12345 with a scale of 2 as "123.45".
+     *
+     * The digits are generated two at a time from a lookup table, so formatting a column of
+     * values is a tight loop without locale or stream machinery.
+     *
+     * @param value                The unscaled value.
+     * @param scale                The number of fractional digits, 0 to FIXED_MAX_SCALE.
+     * @param outBuf               The buffer to write to, at least FIXED_MAX_CHARS long.
+     *                             Not null terminated.
+     *
+     * @return the number of characters written.
+     */
+    size_t FixedToChars(int64 value, int64 scale, char * outBuf);
+
+    /**
+     * Function to convert a scaled integer to a double.
+     *
+     * @param value                The unscaled value.
+     * @param scale                The scale, 0 to FIXED_MAX_SCALE.
+     *
+     * @return the value divided by 10^scale.
+     */
+    inline float64 FixedToDouble(int64 value, int64 scale)
+    {
+        return (float64) value / doublePower10[scale];
+    }
+
+    /**
+     * Function to read a Decimal128 value, the Arrow form of a NUMBER(38, s) value, as an int64.
+     * Most values fit in 64 bits, then the high 64 bits only repeat the sign of the low ones.
+     *
+     * @param highBits             The high 64 bits of the unscaled value.
+     * @param lowBits              The low 64 bits of the unscaled value.
+     * @param outValue             The unscaled value.
+     *
+     * @return false if the value does not fit in 64 bits.
+     */
+    inline bool Decimal128ToInt64(int64 highBits, uint64 lowBits, int64 * outValue)
+    {
+        if (highBits != ((lowBits >> 63) ? -1 : 0))
+        {
+            return false;
+        }
+        *outValue = (int64) lowBits;
+        return true;
+    }
+
+    /**
+     * Function to convert a Decimal128 value to a double. The result is the same as parsing the
+     * text of the value, because both the value and the power of 10 are exact doubles then.
+     *
+     * @param highBits             The high 64 bits of the unscaled value.
+     * @param lowBits              The low 64 bits of the unscaled value.
+     * @param scale                The scale, 0 to FIXED_MAX_SCALE.
+     * @param outValue             The value divided by 10^scale.
+     *
+     * @return false if the unscaled value is beyond 2^53 or the scale beyond 22, in which case
+     *         the text of the value has to be parsed.
+     */
+    inline bool Decimal128ToDouble(int64 highBits, uint64 lowBits, int64 scale, float64 * outValue)
+    {
+        int64 value;
+        if ((scale > 22) || !Decimal128ToInt64(highBits, lowBits, &value) ||
+            (value > ((int64) 1 << 53)) || (value < -((int64) 1 << 53)))
+        {
+            return false;
+        }
+        *outValue = FixedToDouble(value, scale);
+        return true;
+    }
+
+    /**
+     * Function to format a Decimal128 value like FixedToChars() and like Decimal128::ToString()
+     * does. Values that fit in 64 bits are formatted the same way as by FixedToChars(), the
+     * others are divided into groups of nine digits first.
+     *
+     * @param highBits             The high 64 bits of the unscaled value.
+     * @param lowBits              The low 64 bits of the unscaled value.
+     * @param scale                The number of fractional digits, 0 to FIXED_MAX_SCALE.
+     * @param outBuf               The buffer to write to, at least FIXED_MAX_CHARS long.
+     *                             Not null terminated.
+     *
+     * @return the number of characters written, 0 for the small values that
+     *         Decimal128::ToString() writes in scientific notation.
+     */
+    size_t Decimal128ToChars(int64 highBits, uint64 lowBits, int64 scale, char * outBuf);
+
+    /**
+     * Function to split seconds since the epoch into calendar fields, the same as gmtime() but
+     * without going through libc. Only the standard struct tm fields are set.
+     *
+     * @param secondsSinceEpoch    The seconds since 1970-01-01 00:00:00, may be negative.
+     * @param outTm                The calendar fields.
+     */
+    void EpochToTm(int64 secondsSinceEpoch, struct tm & outTm);
+
 } // namespace Arrow
 } // namespace Conversion
 } // namespace Client
 } // namespace Snowflake
 
-#endif  // SF_WIN32
+#endif  // SF_NO_ARROW
 #endif  // SNOWFLAKECLIENT_ARROWCHUNKITERATOR_HPP
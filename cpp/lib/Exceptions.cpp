@@ -2,3 +2,34 @@
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
 
+#include <snowflake/Exceptions.hpp>
+
+SnowflakeException::SnowflakeException(SF_ERROR_STRUCT *error) : error(error) {}
+
+const char *SnowflakeException::what() const throw() {
+    return error && error->msg ? error->msg : "Unknown Snowflake error";
+}
+
+SF_STATUS SnowflakeException::code() {
+    return error ? error->error_code : SF_STATUS_ERROR_GENERAL;
+}
+
+const char *SnowflakeException::sqlstate() {
+    return error ? error->sqlstate : "";
+}
+
+const char *SnowflakeException::msg() {
+    return what();
+}
+
+const char *SnowflakeException::sfqid() {
+    return error ? error->sfqid : "";
+}
+
+const char *SnowflakeException::file() {
+    return error && error->file ? error->file : "";
+}
+
+int SnowflakeException::line() {
+    return error ? error->line : 0;
+}
@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "JsonArrowConverter.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include "arrowheaders.hpp"
+#include "ChunkMemoryPool.hpp"
+#include "../logger/SFLogger.hpp"
+#include "hex.h"
+#include "number_parse.h"
+
+#ifndef SF_NO_ARROW
+
+namespace Snowflake
+{
+namespace Client
+{
+
+namespace
+{
+
+const int64 power10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+// Minutes added to the timezone offsets of TIMESTAMP_TZ values, in JSON and in Arrow alike
+const int32 TIMEZONE_OFFSET_RANGE = 24 * 60;
+
+/**
+ * A decimal value of the text of a cell, its fraction in the digits of the scale of the
+ * column: the whole seconds and fraction of a time or timestamp, or the digits of a number.
+ */
+struct DecimalText
+{
+    bool negative;
+    uint64 whole;
+    // The fraction in 10^-scale units, extra digits cut off
+    uint64 fraction;
+    // After the number, e.g. the timezone of a TIMESTAMP_TZ
+    const char * end;
+};
+
+bool parseDecimal(const char * text, int64 scale, DecimalText & out)
+{
+    const char * p = text;
+    out.negative = (*p == '-');
+    if (out.negative || (*p == '+'))
+    {
+        p++;
+    }
+    const char * digits = p;
+    out.whole = 0;
+    for (; (unsigned int) (*p - '0') < 10; p++)
+    {
+        if (out.whole > ((uint64) power10[18] - 1))
+        {
+            return false;
+        }
+        out.whole = out.whole * 10 + (unsigned int) (*p - '0');
+    }
+    if (p == digits)
+    {
+        return false;
+    }
+
+    out.fraction = 0;
+    int64 fractionDigits = 0;
+    if (*p == '.')
+    {
+        for (p++; (unsigned int) (*p - '0') < 10; p++)
+        {
+            if (fractionDigits < scale)
+            {
+                out.fraction = out.fraction * 10 + (unsigned int) (*p - '0');
+                fractionDigits++;
+            }
+        }
+    }
+    for (; fractionDigits < scale; fractionDigits++)
+    {
+        out.fraction *= 10;
+    }
+    out.end = p;
+    return true;
+}
+
+/**
+ * @return false if the value doesn't fit in an int64 scaled integer
+ */
+bool toScaledInteger(const DecimalText & value, int64 scale, int64 & out)
+{
+    if (value.whole > ((uint64) std::numeric_limits<int64>::max() - value.fraction) /
+                      (uint64) power10[scale])
+    {
+        return false;
+    }
+    out = (int64) (value.whole * (uint64) power10[scale] + value.fraction);
+    if (value.negative)
+    {
+        out = -out;
+    }
+    return true;
+}
+
+/**
+ * Splits a timestamp into the epoch seconds rounded down and the nanoseconds after them.
+ */
+void toEpochAndNanos(const DecimalText & value, int64 scale, int64 & epoch, int32 & nanos)
+{
+    epoch = (int64) value.whole;
+    nanos = (int32) (value.fraction * (uint64) power10[9 - scale]);
+    if (value.negative)
+    {
+        epoch = -epoch;
+        if (nanos > 0)
+        {
+            epoch--;
+            nanos = (int32) power10[9] - nanos;
+        }
+    }
+}
+
+bool isTimestamp(SF_DB_TYPE type)
+{
+    return (SF_DB_TYPE_TIMESTAMP_NTZ == type) || (SF_DB_TYPE_TIMESTAMP_LTZ == type) ||
+           (SF_DB_TYPE_TIMESTAMP_TZ == type);
+}
+
+/**
+ * @return true if a FIXED column is read as decimal128 rather than int64
+ */
+bool isWideDecimal(const SF_COLUMN_DESC & desc)
+{
+    return (desc.precision <= 0) || (desc.precision > 18);
+}
+
+/**
+ * @return the Arrow type of the values of a column, see JsonArrowConverter
+ */
+std::shared_ptr<arrow::DataType> arrowType(const SF_COLUMN_DESC & desc)
+{
+    switch (desc.type)
+    {
+        case SF_DB_TYPE_FIXED:
+            return isWideDecimal(desc) ?
+                arrow::decimal128(desc.precision > 0 ? (int32_t) desc.precision : 38,
+                                  (int32_t) desc.scale) :
+                arrow::int64();
+        case SF_DB_TYPE_REAL:
+            return arrow::float64();
+        case SF_DB_TYPE_BOOLEAN:
+            return arrow::boolean();
+        case SF_DB_TYPE_DATE:
+            return arrow::date32();
+        case SF_DB_TYPE_TIME:
+            return arrow::int64();
+        case SF_DB_TYPE_TIMESTAMP_NTZ:
+        case SF_DB_TYPE_TIMESTAMP_LTZ:
+            if (desc.scale <= 7)
+            {
+                return arrow::int64();
+            }
+            return arrow::struct_({arrow::field("epoch", arrow::int64()),
+                                   arrow::field("fraction", arrow::int32())});
+        case SF_DB_TYPE_TIMESTAMP_TZ:
+            if (desc.scale <= 3)
+            {
+                return arrow::struct_({arrow::field("epoch", arrow::int64()),
+                                       arrow::field("timezone", arrow::int32())});
+            }
+            return arrow::struct_({arrow::field("epoch", arrow::int64()),
+                                   arrow::field("fraction", arrow::int32()),
+                                   arrow::field("timezone", arrow::int32())});
+        case SF_DB_TYPE_BINARY:
+            return arrow::binary();
+        default:
+            return arrow::utf8();
+    }
+}
+
+std::shared_ptr<arrow::Schema> arrowSchema(const SF_COLUMN_DESC * metadata, size_t columnCount)
+{
+    std::vector<std::shared_ptr<arrow::Field> > fields;
+    for (size_t i = 0; i < columnCount; i++)
+    {
+        const SF_COLUMN_DESC & desc = metadata[i];
+        std::vector<std::string> keys = {"logicalType", "precision", "scale"};
+        std::vector<std::string> values = {snowflake_type_to_string(desc.type),
+                                           std::to_string(desc.precision),
+                                           std::to_string(desc.scale)};
+        fields.push_back(arrow::field(desc.name ? desc.name : "", arrowType(desc), true,
+            std::make_shared<arrow::KeyValueMetadata>(keys, values)));
+    }
+    return arrow::schema(fields);
+}
+
+/**
+ * The cells of a column of a chunk, from a row on.
+ */
+class ColumnCells
+{
+public:
+    ColumnCells(const SF_JSON_ROWSET * rowset, size_t firstRow, size_t colIdx) :
+        m_rowset(rowset),
+        m_cell(rowset->cells + firstRow * rowset->column_count + colIdx),
+        m_rowsLeft(rowset->row_count - firstRow)
+    {
+    }
+
+    bool next()
+    {
+        if (m_rowsLeft == 0)
+        {
+            return false;
+        }
+        if (m_started)
+        {
+            m_cell += m_rowset->column_count;
+        }
+        m_started = true;
+        m_rowsLeft--;
+        return true;
+    }
+
+    /**
+     * @return the NUL-terminated value of the cell, NULL for a NULL cell
+     */
+    const char * value() const
+    {
+        return m_cell->is_null ? NULL : &m_rowset->buffer[m_cell->offset];
+    }
+
+    size_t length() const
+    {
+        return m_cell->len;
+    }
+
+private:
+    const SF_JSON_ROWSET * m_rowset;
+    const SF_JSON_CELL * m_cell;
+    size_t m_rowsLeft;
+    bool m_started = false;
+};
+
+arrow::Status invalidValue(const SF_COLUMN_DESC & desc, const char * value)
+{
+    return arrow::Status::Invalid("Value ", value, " of column ", desc.idx, " can't be read as ",
+                                  snowflake_type_to_string(desc.type));
+}
+
+template <typename Builder>
+arrow::Status startBuilder(Builder & builder, size_t rowCount)
+{
+    return builder.Reserve((int64_t) rowCount);
+}
+
+arrow::Status convertFixed(ColumnCells cells, const SF_COLUMN_DESC & desc, size_t rowCount,
+                           std::shared_ptr<arrow::Array> * out)
+{
+    arrow::MemoryPool * pool = ChunkMemoryPool::instance();
+    if (isWideDecimal(desc))
+    {
+        arrow::Decimal128Builder builder(arrowType(desc), pool);
+        ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+        std::string digits;
+        while (cells.next())
+        {
+            const char * value = cells.value();
+            if (!value)
+            {
+                ARROW_RETURN_NOT_OK(builder.AppendNull());
+                continue;
+            }
+            // The digits of the scaled integer, the fraction padded or cut to the scale
+            const char * point = strchr(value, '.');
+            size_t wholeLength = point ? (size_t) (point - value) : cells.length();
+            size_t fractionLength = point ? cells.length() - wholeLength - 1 : 0;
+            digits.assign(value, wholeLength);
+            if (point)
+            {
+                digits.append(point + 1, std::min(fractionLength, (size_t) desc.scale));
+            }
+            if (fractionLength < (size_t) desc.scale)
+            {
+                digits.append((size_t) desc.scale - fractionLength, '0');
+            }
+            arrow::Decimal128 decimal;
+            int32_t precision;
+            int32_t scale;
+            if (!arrow::Decimal128::FromString(digits, &decimal, &precision, &scale).ok())
+            {
+                return invalidValue(desc, value);
+            }
+            ARROW_RETURN_NOT_OK(builder.Append(decimal));
+        }
+        return builder.Finish(out);
+    }
+
+    arrow::Int64Builder builder(pool);
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        DecimalText text;
+        int64 scaled;
+        if (!value)
+        {
+            builder.UnsafeAppendNull();
+        }
+        else if (parseDecimal(value, desc.scale, text) && toScaledInteger(text, desc.scale, scaled))
+        {
+            builder.UnsafeAppend(scaled);
+        }
+        else
+        {
+            return invalidValue(desc, value);
+        }
+    }
+    return builder.Finish(out);
+}
+
+arrow::Status convertReal(ColumnCells cells, const SF_COLUMN_DESC & desc, size_t rowCount,
+                          std::shared_ptr<arrow::Array> * out)
+{
+    arrow::DoubleBuilder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        float64 parsed;
+        sf_bool outOfRange;
+        if (!value)
+        {
+            builder.UnsafeAppendNull();
+        }
+        else if (sf_parse_float64(value, &parsed, &outOfRange) != value)
+        {
+            builder.UnsafeAppend(parsed);
+        }
+        else
+        {
+            return invalidValue(desc, value);
+        }
+    }
+    return builder.Finish(out);
+}
+
+arrow::Status convertBoolean(ColumnCells cells, size_t rowCount,
+                             std::shared_ptr<arrow::Array> * out)
+{
+    arrow::BooleanBuilder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        if (!value)
+        {
+            builder.UnsafeAppendNull();
+        }
+        else
+        {
+            builder.UnsafeAppend(strcmp("1", value) == 0);
+        }
+    }
+    return builder.Finish(out);
+}
+
+arrow::Status convertDate(ColumnCells cells, const SF_COLUMN_DESC & desc, size_t rowCount,
+                          std::shared_ptr<arrow::Array> * out)
+{
+    arrow::Date32Builder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        int64 days;
+        sf_bool outOfRange = SF_BOOLEAN_FALSE;
+        if (!value)
+        {
+            builder.UnsafeAppendNull();
+        }
+        else if ((sf_parse_int64(value, &days, &outOfRange) != value) && !outOfRange &&
+                 (days >= std::numeric_limits<int32>::min()) &&
+                 (days <= std::numeric_limits<int32>::max()))
+        {
+            builder.UnsafeAppend((int32) days);
+        }
+        else
+        {
+            return invalidValue(desc, value);
+        }
+    }
+    return builder.Finish(out);
+}
+
+/**
+ * TIME, and the timestamps read as scaled integers
+ */
+arrow::Status convertScaledTime(ColumnCells cells, const SF_COLUMN_DESC & desc, size_t rowCount,
+                                std::shared_ptr<arrow::Array> * out)
+{
+    arrow::Int64Builder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        DecimalText text;
+        int64 scaled;
+        if (!value)
+        {
+            builder.UnsafeAppendNull();
+        }
+        else if (parseDecimal(value, desc.scale, text) && toScaledInteger(text, desc.scale, scaled))
+        {
+            builder.UnsafeAppend(scaled);
+        }
+        else
+        {
+            return invalidValue(desc, value);
+        }
+    }
+    return builder.Finish(out);
+}
+
+/**
+ * The timestamps read as structs, see JsonArrowConverter
+ */
+arrow::Status convertTimestampStruct(ColumnCells cells, const SF_COLUMN_DESC & desc,
+                                     size_t rowCount, std::shared_ptr<arrow::Array> * out)
+{
+    bool withTimezone = (SF_DB_TYPE_TIMESTAMP_TZ == desc.type);
+    // Low scale TIMESTAMP_TZ values pack the scaled integer and the timezone
+    bool packed = withTimezone && (desc.scale <= 3);
+    arrow::MemoryPool * pool = ChunkMemoryPool::instance();
+    arrow::Int64Builder epochs(pool);
+    arrow::Int32Builder fractions(pool);
+    arrow::Int32Builder timezones(pool);
+    ARROW_RETURN_NOT_OK(startBuilder(epochs, rowCount));
+    ARROW_RETURN_NOT_OK(startBuilder(fractions, packed ? 0 : rowCount));
+    ARROW_RETURN_NOT_OK(startBuilder(timezones, withTimezone ? rowCount : 0));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        if (!value)
+        {
+            epochs.UnsafeAppendNull();
+            if (!packed)
+            {
+                fractions.UnsafeAppendNull();
+            }
+            if (withTimezone)
+            {
+                timezones.UnsafeAppendNull();
+            }
+            continue;
+        }
+
+        DecimalText text;
+        if (!parseDecimal(value, desc.scale, text))
+        {
+            return invalidValue(desc, value);
+        }
+        if (packed)
+        {
+            int64 scaled;
+            if (!toScaledInteger(text, desc.scale, scaled))
+            {
+                return invalidValue(desc, value);
+            }
+            epochs.UnsafeAppend(scaled);
+        }
+        else
+        {
+            int64 epoch;
+            int32 nanos;
+            toEpochAndNanos(text, desc.scale, epoch, nanos);
+            epochs.UnsafeAppend(epoch);
+            fractions.UnsafeAppend(nanos);
+        }
+        if (withTimezone)
+        {
+            int64 timezone = TIMEZONE_OFFSET_RANGE;
+            sf_bool outOfRange = SF_BOOLEAN_FALSE;
+            if ((*text.end == ' ') &&
+                ((sf_parse_int64(text.end + 1, &timezone, &outOfRange) == text.end + 1) ||
+                 outOfRange || (timezone < 0) || (timezone > 2 * TIMEZONE_OFFSET_RANGE)))
+            {
+                return invalidValue(desc, value);
+            }
+            timezones.UnsafeAppend((int32) timezone);
+        }
+    }
+
+    std::vector<std::shared_ptr<arrow::Array> > children(1);
+    ARROW_RETURN_NOT_OK(epochs.Finish(&children[0]));
+    if (!packed)
+    {
+        children.emplace_back();
+        ARROW_RETURN_NOT_OK(fractions.Finish(&children.back()));
+    }
+    if (withTimezone)
+    {
+        children.emplace_back();
+        ARROW_RETURN_NOT_OK(timezones.Finish(&children.back()));
+    }
+    // The NULL structs are the NULL epochs
+    *out = std::make_shared<arrow::StructArray>(arrowType(desc), (int64_t) rowCount, children,
+                                                children[0]->null_bitmap(),
+                                                children[0]->null_count());
+    return arrow::Status::OK();
+}
+
+arrow::Status convertBinary(ColumnCells cells, const SF_COLUMN_DESC & desc, size_t rowCount,
+                            std::shared_ptr<arrow::Array> * out)
+{
+    arrow::BinaryBuilder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    std::string decoded;
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        if (!value)
+        {
+            ARROW_RETURN_NOT_OK(builder.AppendNull());
+            continue;
+        }
+        // The values are hex
+        decoded.resize(cells.length() / 2);
+        if ((cells.length() % 2 != 0) ||
+            !sf_hex_decode(&decoded[0], value, cells.length()))
+        {
+            return invalidValue(desc, value);
+        }
+        ARROW_RETURN_NOT_OK(builder.Append(decoded.data(), (int32_t) decoded.size()));
+    }
+    return builder.Finish(out);
+}
+
+arrow::Status convertString(ColumnCells cells, size_t rowCount,
+                            std::shared_ptr<arrow::Array> * out)
+{
+    arrow::StringBuilder builder(ChunkMemoryPool::instance());
+    ARROW_RETURN_NOT_OK(startBuilder(builder, rowCount));
+    while (cells.next())
+    {
+        const char * value = cells.value();
+        if (!value)
+        {
+            ARROW_RETURN_NOT_OK(builder.AppendNull());
+        }
+        else
+        {
+            ARROW_RETURN_NOT_OK(builder.Append(value, (int32_t) cells.length()));
+        }
+    }
+    return builder.Finish(out);
+}
+
+arrow::Status convertColumn(const SF_JSON_ROWSET * rowset, size_t firstRow, size_t colIdx,
+                            const SF_COLUMN_DESC & desc, std::shared_ptr<arrow::Array> * out)
+{
+    ColumnCells cells(rowset, firstRow, colIdx);
+    size_t rowCount = rowset->row_count - firstRow;
+    switch (desc.type)
+    {
+        case SF_DB_TYPE_FIXED:
+            return convertFixed(cells, desc, rowCount, out);
+        case SF_DB_TYPE_REAL:
+            return convertReal(cells, desc, rowCount, out);
+        case SF_DB_TYPE_BOOLEAN:
+            return convertBoolean(cells, rowCount, out);
+        case SF_DB_TYPE_DATE:
+            return convertDate(cells, desc, rowCount, out);
+        case SF_DB_TYPE_TIME:
+            return convertScaledTime(cells, desc, rowCount, out);
+        case SF_DB_TYPE_BINARY:
+            return convertBinary(cells, desc, rowCount, out);
+        default:
+            break;
+    }
+    if (isTimestamp(desc.type))
+    {
+        return arrow::int64()->Equals(arrowType(desc)) ?
+            convertScaledTime(cells, desc, rowCount, out) :
+            convertTimestampStruct(cells, desc, rowCount, out);
+    }
+    return convertString(cells, rowCount, out);
+}
+
+arrow::Status convertRows(const SF_JSON_ROWSET * rowset, size_t firstRow,
+                          const SF_COLUMN_DESC * metadata,
+                          std::shared_ptr<arrow::RecordBatch> * out)
+{
+    for (size_t i = 0; i < rowset->column_count; i++)
+    {
+        // Up to 18 digits of fraction in int64 numbers, 37 in decimals and 9 in times
+        if ((metadata[i].scale < 0) ||
+            (metadata[i].scale > ((SF_DB_TYPE_FIXED == metadata[i].type) ? 37 : 9)) ||
+            ((SF_DB_TYPE_FIXED == metadata[i].type) && !isWideDecimal(metadata[i]) &&
+             (metadata[i].scale > 18)))
+        {
+            return arrow::Status::Invalid("Scale ", metadata[i].scale, " of column ",
+                                          metadata[i].idx, " is out of range");
+        }
+    }
+
+    std::vector<std::shared_ptr<arrow::Array> > columns(rowset->column_count);
+    for (size_t i = 0; i < rowset->column_count; i++)
+    {
+        ARROW_RETURN_NOT_OK(convertColumn(rowset, firstRow, i, metadata[i], &columns[i]));
+    }
+    *out = arrow::RecordBatch::Make(arrowSchema(metadata, rowset->column_count),
+                                    (int64_t) (rowset->row_count - firstRow), columns);
+    return arrow::Status::OK();
+}
+
+void freeBatch(void * batch)
+{
+    delete static_cast<std::shared_ptr<arrow::RecordBatch> *>(batch);
+}
+
+} // namespace
+
+bool JsonArrowConverter::decodeChunk(SF_JSON_ROWSET * rowset, const SF_COLUMN_DESC * metadata)
+{
+    if (!rowset || !metadata || rowset->columnar)
+    {
+        return false;
+    }
+    std::shared_ptr<arrow::RecordBatch> batch;
+    arrow::Status status = convertRows(rowset, 0, metadata, &batch);
+    if (!status.ok())
+    {
+        // Converted again when the chunk is exported, which reports the error
+        CXX_LOG_WARN("JsonArrowConverter: chunk left unconverted: %s", status.ToString().c_str());
+        return false;
+    }
+    rowset->columnar = new std::shared_ptr<arrow::RecordBatch>(batch);
+    rowset->columnar_free = freeBatch;
+    return true;
+}
+
+SF_STATUS JsonArrowConverter::exportRows(const SF_JSON_ROWSET * rowset, size_t firstRow,
+                                         const SF_COLUMN_DESC * metadata,
+                                         struct ArrowArray * outArray,
+                                         struct ArrowSchema * outSchema,
+                                         std::string & errorMessage)
+{
+    std::shared_ptr<arrow::RecordBatch> batch;
+    arrow::Status status;
+    if (rowset->columnar)
+    {
+        batch = *static_cast<std::shared_ptr<arrow::RecordBatch> *>(rowset->columnar);
+        if (firstRow > 0)
+        {
+            batch = batch->Slice((int64_t) firstRow);
+        }
+    }
+    else
+    {
+        status = convertRows(rowset, firstRow, metadata, &batch);
+        if (!status.ok())
+        {
+            CXX_LOG_ERROR("JsonArrowConverter: unable to convert chunk: %s",
+                status.ToString().c_str());
+            errorMessage = status.message();
+            return SF_STATUS_ERROR_CONVERSION_FAILURE;
+        }
+    }
+
+    // The exported structs hold references to the batch buffers, so they stay valid after
+    // the chunk has been released.
+    status = arrow::ExportRecordBatch(*batch, outArray, outSchema);
+    if (!status.ok())
+    {
+        CXX_LOG_ERROR("JsonArrowConverter: unable to export record batch: %s",
+            status.ToString().c_str());
+        errorMessage = "Unable to export Arrow record batch";
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+} // namespace Client
+} // namespace Snowflake
+
+#else // SF_NO_ARROW
+
+namespace Snowflake
+{
+namespace Client
+{
+
+bool JsonArrowConverter::decodeChunk(SF_JSON_ROWSET * rowset, const SF_COLUMN_DESC * metadata)
+{
+    return false;
+}
+
+SF_STATUS JsonArrowConverter::exportRows(const SF_JSON_ROWSET * rowset, size_t firstRow,
+                                         const SF_COLUMN_DESC * metadata,
+                                         struct ArrowArray * outArray,
+                                         struct ArrowSchema * outSchema,
+                                         std::string & errorMessage)
+{
+    errorMessage = "Record batches can only be exported by a build with Arrow";
+    return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+}
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SF_NO_ARROW
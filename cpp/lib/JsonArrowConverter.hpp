@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_JSONARROWCONVERTER_HPP
+#define SNOWFLAKECLIENT_JSONARROWCONVERTER_HPP
+
+#include <string>
+#include "snowflake/client.h"
+#include "json_rowset.h"
+
+namespace Snowflake
+{
+namespace Client
+{
+
+/**
+ * Converts the rows of JSON result chunks to Arrow record batches, in the encoding of the
+ * record batches of the Arrow results, so that the record batches of any result can be
+ * exported the same way:
+ *   - FIXED as int64 scaled integers, or decimal128 above 18 digits of precision,
+ *   - REAL as double, BOOLEAN as boolean, DATE as date32 and BINARY as binary,
+ *   - TIME as int64 scaled integers,
+ *   - TIMESTAMP_NTZ and TIMESTAMP_LTZ as int64 scaled integers up to a scale of 7, as a
+ *     struct of the epoch seconds and nanoseconds above,
+ *   - TIMESTAMP_TZ as a struct of the scaled integer and the timezone up to a scale of 3, of
+ *     the epoch seconds, nanoseconds and timezone above, the timezone in minutes plus 1440,
+ *   - the other types as utf8 strings of their values.
+ * Each field has the Snowflake type in its logicalType metadata, with its precision and scale.
+ */
+class JsonArrowConverter
+{
+public:
+    /**
+     * Converts all the rows of a chunk and keeps the record batch as the columnar copy of the
+     * rowset, freed with it. Done by the chunk downloader threads, see SF_STMT_JSON_TO_ARROW.
+     *
+     * @param rowset               The parsed chunk.
+     * @param metadata             The metadata of the columns of the chunk.
+     *
+     * @return false if a value can't be converted, in which case exportRows() converts the
+     *         rows again to report the error.
+     */
+    static bool decodeChunk(SF_JSON_ROWSET * rowset, const SF_COLUMN_DESC * metadata);
+
+    /**
+     * Exports the rows of a chunk from the given row on as one record batch, through the Arrow
+     * C data interface. The columnar copy of the rowset is exported if it has one, otherwise
+     * the rows are converted.
+     *
+     * @param rowset               The chunk.
+     * @param firstRow             The first row to export.
+     * @param metadata             The metadata of the columns of the chunk.
+     * @param outArray             Receives the record batch.
+     * @param outSchema            Receives the schema of the record batch.
+     * @param errorMessage         Set to what went wrong on failure.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    static SF_STATUS exportRows(const SF_JSON_ROWSET * rowset, size_t firstRow,
+                                const SF_COLUMN_DESC * metadata, struct ArrowArray * outArray,
+                                struct ArrowSchema * outSchema, std::string & errorMessage);
+};
+
+} // namespace Client
+} // namespace Snowflake
+
+#endif // SNOWFLAKECLIENT_JSONARROWCONVERTER_HPP
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "arrowheaders.hpp"
+#include "snowflake/client.h"
+#include "../logger/SFLogger.hpp"
+#include "error.h"
+#include "csv_export.h"
+
+#ifndef SF_NO_ARROW
+
+using namespace Snowflake::Client;
+
+namespace
+{
+
+SF_STATUS exportFailed(SF_STMT *sfstmt, const char *message, const arrow::Status &status)
+{
+  CXX_LOG_ERROR("Result export of query %s failed. %s: %s", sfstmt->sfqid, message,
+                status.ToString().c_str());
+  SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_GENERAL, message,
+                           SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+  return SF_STATUS_ERROR_GENERAL;
+}
+
+template <typename ArrayType>
+arrow::Status widenToInt64(const arrow::Array &column, std::shared_ptr<arrow::Array> *out)
+{
+  const ArrayType &values = static_cast<const ArrayType &>(column);
+  arrow::Int64Builder builder;
+  arrow::Status status = builder.Reserve(values.length());
+  if (!status.ok())
+  {
+    return status;
+  }
+  for (int64_t i = 0; i < values.length(); i++)
+  {
+    if (values.IsNull(i))
+    {
+      builder.UnsafeAppendNull();
+    }
+    else
+    {
+      builder.UnsafeAppend(values.Value(i));
+    }
+  }
+  return builder.Finish(out);
+}
+
+/**
+ * The integers of a NUMBER column are as narrow as the values of each chunk allow, while a
+ * stream has one schema. They are widened to 64 bits, the other columns are kept as is.
+ */
+arrow::Status normalizeBatch(SF_STMT *sfstmt, std::shared_ptr<arrow::RecordBatch> &batch)
+{
+  std::vector<std::shared_ptr<arrow::Array> > columns;
+  std::vector<std::shared_ptr<arrow::Field> > fields = batch->schema()->fields();
+  bool widened = false;
+  for (int i = 0; i < batch->num_columns(); i++)
+  {
+    std::shared_ptr<arrow::Array> column = batch->column(i);
+    arrow::Status status;
+    bool isFixed = i < sfstmt->total_fieldcount && sfstmt->desc[i].type == SF_DB_TYPE_FIXED;
+    switch (isFixed ? column->type_id() : arrow::Type::NA)
+    {
+      case arrow::Type::INT8:
+        status = widenToInt64<arrow::Int8Array>(*batch->column(i), &column);
+        break;
+      case arrow::Type::INT16:
+        status = widenToInt64<arrow::Int16Array>(*batch->column(i), &column);
+        break;
+      case arrow::Type::INT32:
+        status = widenToInt64<arrow::Int32Array>(*batch->column(i), &column);
+        break;
+      default:
+        columns.push_back(column);
+        continue;
+    }
+    if (!status.ok())
+    {
+      return status;
+    }
+    columns.push_back(column);
+    fields[i] = fields[i]->WithType(arrow::int64());
+    widened = true;
+  }
+  if (widened)
+  {
+    batch = arrow::RecordBatch::Make(arrow::schema(fields, batch->schema()->metadata()),
+                                     batch->num_rows(), columns);
+  }
+  return arrow::Status::OK();
+}
+
+/**
+ * Writes the remaining record batches of the results as one Arrow IPC stream. The batches
+ * are imported without copying their buffers, which the stream writer then writes as they
+ * are: apart from narrow NUMBER integers, no value is converted on the way.
+ */
+SF_STATUS exportArrowStream(SF_STMT *sfstmt, const char *path)
+{
+  arrow::Result<std::shared_ptr<arrow::io::FileOutputStream> > file =
+    arrow::io::FileOutputStream::Open(path);
+  if (!file.ok())
+  {
+    return exportFailed(sfstmt, "Unable to open the export file", file.status());
+  }
+  std::shared_ptr<arrow::io::FileOutputStream> out = file.ValueOrDie();
+
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+  std::shared_ptr<arrow::Schema> writerSchema;
+  struct ArrowArray array;
+  struct ArrowSchema schema;
+  SF_STATUS ret;
+  // The chunks are downloaded and decoded ahead by the chunk downloader threads meanwhile
+  while ((ret = snowflake_fetch_arrow_batch(sfstmt, &array, &schema)) == SF_STATUS_SUCCESS)
+  {
+    // Releases the structs, even on failure
+    arrow::Result<std::shared_ptr<arrow::RecordBatch> > imported =
+      arrow::ImportRecordBatch(&array, &schema);
+    if (!imported.ok())
+    {
+      return exportFailed(sfstmt, "Unable to import a record batch", imported.status());
+    }
+    std::shared_ptr<arrow::RecordBatch> batch = imported.ValueOrDie();
+    arrow::Status status = normalizeBatch(sfstmt, batch);
+    if (!status.ok())
+    {
+      return exportFailed(sfstmt, "Unable to widen the integers of a record batch", status);
+    }
+    if (writer && !batch->schema()->Equals(*writerSchema, false))
+    {
+      return exportFailed(sfstmt, "The record batches of the chunks have different types",
+                          arrow::Status::TypeError(batch->schema()->ToString()));
+    }
+    if (!writer)
+    {
+      arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchWriter> > opened =
+        arrow::ipc::MakeStreamWriter(out.get(), batch->schema());
+      if (!opened.ok())
+      {
+        return exportFailed(sfstmt, "Unable to start the Arrow stream", opened.status());
+      }
+      writer = opened.ValueOrDie();
+      writerSchema = batch->schema();
+    }
+    status = writer->WriteRecordBatch(*batch);
+    if (!status.ok())
+    {
+      return exportFailed(sfstmt, "Unable to write a record batch", status);
+    }
+  }
+  if (ret != SF_STATUS_EOF)
+  {
+    // The error of the statement tells what went wrong
+    return ret;
+  }
+
+  // An empty result has no schema to start a stream with, the file is left empty
+  arrow::Status status = writer ? writer->Close() : arrow::Status::OK();
+  if (status.ok())
+  {
+    status = out->Close();
+  }
+  if (!status.ok())
+  {
+    return exportFailed(sfstmt, "Unable to finish the export file", status);
+  }
+  return SF_STATUS_SUCCESS;
+}
+
+}
+
+#endif // SF_NO_ARROW
+
+extern "C" {
+
+SF_STATUS STDCALL snowflake_export_result(SF_STMT *sfstmt, const char *path,
+                                          SF_EXPORT_FORMAT format)
+{
+  if (!sfstmt)
+  {
+    return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+  }
+  if (!path)
+  {
+    return SF_STATUS_ERROR_NULL_POINTER;
+  }
+  clear_snowflake_error(&sfstmt->error);
+  if (format == SF_EXPORT_FORMAT_CSV || format == SF_EXPORT_FORMAT_CSV_GZIP)
+  {
+    return sf_csv_export(sfstmt, path,
+                         format == SF_EXPORT_FORMAT_CSV_GZIP ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE,
+                         SF_CSV_EXPORT_THREADS);
+  }
+  if (format != SF_EXPORT_FORMAT_ARROW_IPC)
+  {
+    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                             "Unsupported export format", SF_SQLSTATE_GENERAL_ERROR,
+                             sfstmt->sfqid);
+    return SF_STATUS_ERROR_BAD_REQUEST;
+  }
+#ifdef SF_NO_ARROW
+  SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT,
+                           "Results can only be exported by a build with Arrow",
+                           SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+  return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+#else
+  return exportArrowStream(sfstmt, path);
+#endif
+}
+
+}
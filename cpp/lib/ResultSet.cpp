@@ -129,5 +129,41 @@ void ResultSet::initTzString()
     m_tzString = std::string(buffer);
 }
 
+// Helpers =========================================================================================
+
+size_t copyNullBits(const uint8 * bits, size_t bitOffset, bool validBits,
+                    uint8 * nullBitmap, size_t rowCount)
+{
+    const uint8 * src = bits + bitOffset / 8;
+    unsigned int shift = (unsigned int) (bitOffset % 8);
+    size_t byteCount = (rowCount + 7) / 8;
+    size_t srcByteCount = (shift + rowCount + 7) / 8;
+    size_t nullCount = 0;
+
+    for (size_t i = 0; i < byteCount; ++i)
+    {
+        unsigned int byte = src[i] >> shift;
+        if (shift && (i + 1 < srcByteCount))
+        {
+            byte |= (unsigned int) src[i + 1] << (8 - shift);
+        }
+        if (validBits)
+        {
+            byte = ~byte;
+        }
+        byte &= 0xFF;
+        if ((i + 1 == byteCount) && (rowCount % 8))
+        {
+            byte &= (1u << (rowCount % 8)) - 1;
+        }
+        nullBitmap[i] = (uint8) byte;
+        for (; byte; byte &= byte - 1)
+        {
+            ++nullCount;
+        }
+    }
+    return nullCount;
+}
+
 } // namespace Client
 } // namespace Snowflake
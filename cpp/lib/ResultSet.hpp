@@ -27,6 +27,22 @@ enum QueryResultFormat
     JSON
 };
 
+/**
+ * Writes the null bits of a run of rows taken from another bitmap, LSB first. Whole bytes are
+ * written, the bits past the run in the last byte are cleared.
+ *
+ * @param bits                 The bitmap to read.
+ * @param bitOffset            The bit of the first row of the run in bits.
+ * @param validBits            Whether a set bit in bits means a valid cell, as in Arrow,
+ *                             rather than a NULL one.
+ * @param nullBitmap           The (rowCount + 7) / 8 bytes to write, bit i set if row i is NULL.
+ * @param rowCount             The number of rows.
+ *
+ * @return the number of NULL rows.
+ */
+size_t copyNullBits(const uint8 * bits, size_t bitOffset, bool validBits,
+                    uint8 * nullBitmap, size_t rowCount);
+
 /**
  * The implementation of a base result set.
  *
@@ -184,6 +200,29 @@ public:
      */
     virtual SF_STATUS STDCALL getCellStrlen(size_t idx, size_t * out_data) = 0;
 
+    /**
+     * Writes the raw bytes of the given BINARY cell to the provided buffers.
+     *
+     * @param idx                  The index of the column or row to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    virtual SF_STATUS STDCALL getCellAsBinary(size_t idx, const void ** out_data, size_t * out_len) = 0;
+
+    /**
+     * Writes the text of the given cell, as getCellAsConstString() gives it, and its length
+     * to the provided buffers, without copying the strings of the result.
+     *
+     * @param idx                  The index of the column or row to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    virtual SF_STATUS STDCALL getCellAsStrView(size_t idx, const char ** out_data, size_t * out_len) = 0;
+
     /**
      * Indicates whether the given cell is null.
      *
@@ -3,6 +3,7 @@
  */
 
 #include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <memory>
 #include <sstream>
@@ -14,7 +15,7 @@
 #include "DataConversion.hpp"
 #include "results.h"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 namespace Snowflake
 {
 namespace Client
@@ -28,7 +29,24 @@ ResultSetArrow::ResultSetArrow() :
 }
 
 ResultSetArrow::ResultSetArrow(
-    arrow::BufferBuilder* initialChunk,
+    ArrowChunkBuffer * initialChunk,
+    SF_COLUMN_DESC * metadata,
+    std::string tzString
+) :
+    ResultSet(metadata, tzString)
+{
+    m_queryResultFormat = QueryResultFormat::ARROW;
+
+    this->appendChunk(initialChunk);
+
+    // Reset row indices so that they can be re-used by public API.
+    m_currChunkIdx = 0;
+    m_currChunkRowIdx = 0;
+    m_currRowIdx = 0;
+}
+
+ResultSetArrow::ResultSetArrow(
+    ArrowChunkStream * initialChunk,
     SF_COLUMN_DESC * metadata,
     std::string tzString
 ) :
@@ -51,7 +69,7 @@ ResultSetArrow::~ResultSetArrow()
 
 // Public methods ==================================================================================
 
-SF_STATUS STDCALL ResultSetArrow::appendChunk(arrow::BufferBuilder * chunk)
+SF_STATUS STDCALL ResultSetArrow::appendChunk(ArrowChunkBuffer * chunk)
 {
     if (chunk == nullptr)
     {
@@ -68,31 +86,42 @@ SF_STATUS STDCALL ResultSetArrow::appendChunk(arrow::BufferBuilder * chunk)
     m_currChunkIdx++;
 
     m_chunkIterator = std::make_shared<ArrowChunkIterator>(chunk, m_metadata, m_tzString, this);
-    if (m_isFirstChunk)
-    {
-        m_isFirstChunk = false;
-        m_totalColumnCount = m_chunkIterator->getColumnCount();
-        m_cacheStrVal.resize(m_totalColumnCount);
-        for (int i = 0; i < m_totalColumnCount; i++)
-        {
-            m_cacheStrVal[i].first = false;
-        }
-    }
+    initChunk();
     return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL ResultSetArrow::next()
+SF_STATUS STDCALL ResultSetArrow::appendChunk(ArrowChunkStream * chunk)
 {
-    // clear cache for each row
-    for (int i = 0; i < m_totalColumnCount; i++)
+    if (chunk == nullptr)
     {
-      m_cacheStrVal[i].first = false;
+        CXX_LOG_ERROR("appendChunk -- Received a null chunk stream to append.");
+        return SF_STATUS_ERROR_NULL_POINTER;
     }
 
+    CXX_LOG_INFO("appendChunk -- Chunk stream %d received.", m_currChunkIdx);
+    m_currChunkIdx++;
+
+    m_chunkIterator = std::make_shared<ArrowChunkIterator>(chunk, m_metadata, m_tzString, this);
+    initChunk();
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL ResultSetArrow::next()
+{
+    uint32 batchIdx = m_chunkIterator ? m_chunkIterator->getCurrentBatchIndex() : 0;
     if (!m_chunkIterator || !m_chunkIterator->next())
     {
+        if (m_chunkIterator && m_chunkIterator->isIncomplete())
+        {
+            setError(SF_STATUS_ERROR_CURL, "Chunk download failed before all rows were received");
+            return SF_STATUS_ERROR_CURL;
+        }
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
+    if (m_chunkIterator->getCurrentBatchIndex() != batchIdx)
+    {
+        resetStringColumns();
+    }
 
     return SF_STATUS_SUCCESS;
 }
@@ -144,32 +173,46 @@ SF_STATUS STDCALL ResultSetArrow::getCellAsFloat64(size_t idx, float64 * out_dat
 
 SF_STATUS STDCALL ResultSetArrow::getCellAsConstString(size_t idx, const char ** out_data)
 {
-    if ((0 == idx) || (idx > m_cacheStrVal.size()))
+    if ((0 == idx) || (idx > m_stringColumns.size()))
     {
         setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
             "Column index must be between 1 and snowflake_num_fields()");
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
-  
-    sf_bool isNull = SF_BOOLEAN_FALSE;
+
+    if (!m_chunkIterator || (0 == m_chunkIterator->getRowsLeftInBatch()))
+    {
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS, "No current row to read from");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
     if (m_chunkIterator->isCellNull(idx - 1))
     {
         *out_data = NULL;
         return SF_STATUS_SUCCESS;
     }
 
-    if (!m_cacheStrVal[idx - 1].first)
+    const ArrowStringColumn * column;
+    SF_STATUS ret = getStringColumn(idx - 1, &column);
+    if (SF_STATUS_SUCCESS != ret)
+    {
+        return ret;
+    }
+
+    uint32 row = m_chunkIterator->getCurrentRowIndexInBatch();
+    if (column->failed[row])
     {
-        SF_STATUS ret = m_chunkIterator->getCellAsString(idx - 1, m_cacheStrVal[idx - 1].second);
+        // Convert the cell again to report its error
+        ret = m_chunkIterator->getCellAsString(idx - 1, m_cellString);
         if (SF_STATUS_SUCCESS != ret)
         {
             return ret;
         }
-        m_cacheStrVal[idx - 1].first = true;
+        *out_data = m_cellString.c_str();
+        return SF_STATUS_SUCCESS;
     }
-    
-    *out_data = m_cacheStrVal[idx - 1].second.c_str();
 
+    *out_data = &column->data[column->offsets[row]];
     return SF_STATUS_SUCCESS;
 }
 
@@ -180,31 +223,59 @@ SF_STATUS STDCALL ResultSetArrow::getCellAsTimestamp(size_t idx, SF_TIMESTAMP *
 
 SF_STATUS STDCALL ResultSetArrow::getCellStrlen(size_t idx, size_t * out_data)
 {
-    if ((0 == idx) || (idx > m_cacheStrVal.size()))
+    const char * value = NULL;
+    SF_STATUS ret = getCellAsConstString(idx, &value);
+    if (SF_STATUS_SUCCESS != ret)
+    {
+        return ret;
+    }
+
+    *out_data = value ? strlen(value) : 0;
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL ResultSetArrow::getCellAsBinary(size_t idx, const void ** out_data, size_t * out_len)
+{
+    if ((0 == idx) || (idx > m_stringColumns.size()))
     {
         setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
             "Column index must be between 1 and snowflake_num_fields()");
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
-  
-    if (m_chunkIterator->isCellNull(idx - 1))
+
+    if (!m_chunkIterator || (0 == m_chunkIterator->getRowsLeftInBatch()))
     {
-        out_data = 0;
-        return SF_STATUS_SUCCESS;
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS, "No current row to read from");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    if (!m_cacheStrVal[idx - 1].first)
+    return m_chunkIterator->getCellAsBinary(idx - 1, out_data, out_len);
+}
+
+SF_STATUS STDCALL ResultSetArrow::getCellAsStrView(size_t idx, const char ** out_data, size_t * out_len)
+{
+    if ((0 == idx) || (idx > m_stringColumns.size()))
     {
-        SF_STATUS ret = m_chunkIterator->getCellAsString(idx - 1, m_cacheStrVal[idx - 1].second);
-        if (SF_STATUS_SUCCESS != ret)
-        {
-            return ret;
-        }
-        m_cacheStrVal[idx - 1].first = true;
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
+            "Column index must be between 1 and snowflake_num_fields()");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    *out_data = m_cacheStrVal[idx - 1].second.length();
-    return SF_STATUS_SUCCESS;
+    if (!m_chunkIterator || (0 == m_chunkIterator->getRowsLeftInBatch()))
+    {
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS, "No current row to read from");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    if (m_chunkIterator->getCellAsStrView(idx - 1, out_data, out_len))
+    {
+        return SF_STATUS_SUCCESS;
+    }
+
+    // Everything else is formatted into the strings of the column first
+    SF_STATUS ret = getCellAsConstString(idx, out_data);
+    *out_len = (SF_STATUS_SUCCESS == ret && *out_data) ? strlen(*out_data) : 0;
+    return ret;
 }
 
 size_t ResultSetArrow::getRowCountInChunk()
@@ -219,7 +290,7 @@ size_t ResultSetArrow::getRowCountInChunk()
 
 SF_STATUS STDCALL ResultSetArrow::isCellNull(size_t idx, sf_bool * out_data)
 {
-    if ((0 == idx) || (idx > m_cacheStrVal.size()))
+    if ((0 == idx) || (idx > m_stringColumns.size()))
     {
         setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
             "Column index must be between 1 and snowflake_num_fields()");
@@ -230,9 +301,90 @@ SF_STATUS STDCALL ResultSetArrow::isCellNull(size_t idx, sf_bool * out_data)
     return SF_STATUS_SUCCESS;
 }
 
+size_t ResultSetArrow::getRowsLeftInBatch()
+{
+    if (!m_chunkIterator)
+    {
+        return 0;
+    }
+    return m_chunkIterator->getRowsLeftInBatch();
+}
+
+bool ResultSetArrow::copyColumn(size_t idx, SF_C_TYPE cType, void * out_data, uint8 * null_bitmap,
+                                size_t bit_offset, size_t row_count)
+{
+    if (!m_chunkIterator || (0 == idx) || (idx > m_stringColumns.size()))
+    {
+        return false;
+    }
+    return m_chunkIterator->copyColumn(idx - 1, cType, out_data, null_bitmap,
+                                       bit_offset, (uint32) row_count);
+}
+
+bool ResultSetArrow::copyNullBitmap(size_t idx, uint8 * null_bitmap, size_t row_count,
+                                    size_t * null_count)
+{
+    if (!m_chunkIterator || (0 == idx) || (idx > m_stringColumns.size()))
+    {
+        return false;
+    }
+    return m_chunkIterator->copyNullBitmap(idx - 1, null_bitmap, (uint32) row_count, null_count);
+}
+
+void ResultSetArrow::skipRows(size_t row_count)
+{
+    if (!m_chunkIterator || (0 == row_count))
+    {
+        return;
+    }
+    // Stays within the record batch, so the string columns are still valid
+    m_chunkIterator->skipRows((uint32) row_count);
+}
+
+SF_STATUS STDCALL ResultSetArrow::exportNextBatch(struct ArrowArray * out_array,
+                                                 struct ArrowSchema * out_schema)
+{
+    if (!m_chunkIterator)
+    {
+        return SF_STATUS_EOF;
+    }
+    return m_chunkIterator->exportNextBatch(out_array, out_schema);
+}
+
 // Private methods =================================================================================
 
+void ResultSetArrow::initChunk()
+{
+    if (m_isFirstChunk)
+    {
+        m_isFirstChunk = false;
+        m_totalColumnCount = m_chunkIterator->getColumnCount();
+        m_stringColumns.resize(m_totalColumnCount);
+    }
+    resetStringColumns();
+}
+
+void ResultSetArrow::resetStringColumns()
+{
+    m_stringColumnReady.assign(m_stringColumns.size(), false);
+}
+
+SF_STATUS ResultSetArrow::getStringColumn(size_t colIdx, const ArrowStringColumn ** outColumn)
+{
+    if (!m_stringColumnReady[colIdx])
+    {
+        SF_STATUS ret = m_chunkIterator->getColumnAsStrings(colIdx, m_stringColumns[colIdx]);
+        if (SF_STATUS_SUCCESS != ret)
+        {
+            return ret;
+        }
+        m_stringColumnReady[colIdx] = true;
+    }
+    *outColumn = &m_stringColumns[colIdx];
+    return SF_STATUS_SUCCESS;
+}
+
 } // namespace Client
 } // namespace Snowflake
 
-#endif // SF_WIN32
+#endif // SF_NO_ARROW
@@ -15,7 +15,7 @@
 #include "ArrowChunkIterator.hpp"
 #include "ResultSet.hpp"
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
 
 namespace Snowflake
 {
@@ -41,7 +41,7 @@ namespace Client
  * Consume the results by using the next() method to advance the internal iterators
  * and retrieve data at particular cells using the numerous getters.
  */
-class ResultSetArrow : public Snowflake::Client::ResultSet
+class ResultSetArrow final : public Snowflake::Client::ResultSet
 {
 public:
 
@@ -57,12 +57,21 @@ public:
      * contained in the initial chunk. It will also initialize m_metadata with
      * the metadata in "metadata".
      *
-     * @param initialChunk         A pointer to arrow::BufferBuilder containing result
+     * @param initialChunk         A pointer to the ArrowChunkBuffer containing result
      *                               set data of the initial chunk.
      * @param metadata             An array of metadata objects for each column.
      * @param tzString             The time zone.
      */
-    ResultSetArrow(arrow::BufferBuilder * initialChunk, SF_COLUMN_DESC * metadata, std::string tzString);
+    ResultSetArrow(ArrowChunkBuffer * initialChunk, SF_COLUMN_DESC * metadata, std::string tzString);
+
+    /**
+     * Parameterized constructor taking an initial chunk that is still being downloaded.
+     *
+     * @param initialChunk         The chunk stream. The result set takes over the consumer's reference.
+     * @param metadata             An array of metadata objects for each column.
+     * @param tzString             The time zone.
+     */
+    ResultSetArrow(ArrowChunkStream * initialChunk, SF_COLUMN_DESC * metadata, std::string tzString);
 
     /**
      * Destructor.
@@ -78,7 +87,17 @@ public:
      *
      * @return 0 if successful, otherwise an error is returned.
      */
-    SF_STATUS STDCALL appendChunk(arrow::BufferBuilder * chunk);
+    SF_STATUS STDCALL appendChunk(ArrowChunkBuffer * chunk);
+
+    /**
+     * Appends a chunk that is still being downloaded. Its record batches can be consumed as
+     * soon as they have been received.
+     *
+     * @param chunk                The chunk stream. The result set takes over the consumer's reference.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL appendChunk(ArrowChunkStream * chunk);
 
     /**
      * Advances the internal iterator to the next row.
@@ -207,6 +226,34 @@ public:
      */
     SF_STATUS STDCALL getCellStrlen(size_t idx, size_t * out_data);
 
+    /**
+     * Writes the raw bytes of the given BINARY or TEXT cell to the provided buffers.
+     *
+     * The bytes point into the Arrow value buffer and stay valid until the next record batch.
+     *
+     * @param idx                  The index of the row to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getCellAsBinary(size_t idx, const void ** out_data, size_t * out_len);
+
+    /**
+     * Writes the text of the given cell and its length to the provided buffers.
+     *
+     * The text of a STRING column points into the Arrow value buffer, is not NUL-terminated
+     * and stays valid until the next record batch. The other columns are converted as by
+     * getCellAsConstString().
+     *
+     * @param idx                  The index of the row to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getCellAsStrView(size_t idx, const char ** out_data, size_t * out_len);
+
     /**
      * Gets the total number of rows in the current chunk being processed.
      *
@@ -224,21 +271,103 @@ public:
      */
     SF_STATUS STDCALL isCellNull(size_t idx, sf_bool * out_data);
 
+    /**
+     * Gets the number of rows left in the current record batch, the current row included.
+     */
+    size_t getRowsLeftInBatch();
+
+    /**
+     * Copies the values of a column for a run of rows starting at the current row, if the
+     * Arrow layout allows it. See ArrowChunkIterator::copyColumn().
+     *
+     * @param idx                  The index of the column to copy.
+     * @param cType                The C type of the values in out_data.
+     * @param out_data             The buffer to write row_count values to.
+     * @param null_bitmap          The null bitmap to update. May be NULL.
+     * @param bit_offset           The bit of the current row in null_bitmap.
+     * @param row_count            The number of rows.
+     *
+     * @return true if the values were copied.
+     */
+    bool copyColumn(size_t idx, SF_C_TYPE cType, void * out_data, uint8 * null_bitmap,
+                    size_t bit_offset, size_t row_count);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row. See
+     * ArrowChunkIterator::copyNullBitmap().
+     *
+     * @param idx                  The index of the column.
+     * @param null_bitmap          The (row_count + 7) / 8 bytes to write.
+     * @param row_count            The number of rows.
+     * @param null_count           Receives the number of NULL rows.
+     *
+     * @return true if the bits were written.
+     */
+    bool copyNullBitmap(size_t idx, uint8 * null_bitmap, size_t row_count, size_t * null_count);
+
+    /**
+     * Moves forward by the given number of rows within the current record batch.
+     */
+    void skipRows(size_t row_count);
+
+    /**
+     * Exports the next record batch of the current chunk. See ArrowChunkIterator::exportNextBatch().
+     *
+     * @param out_array            Receives the record batch.
+     * @param out_schema           Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if the chunk has no more record batches,
+     *         otherwise an error is returned.
+     */
+    SF_STATUS STDCALL exportNextBatch(struct ArrowArray * out_array, struct ArrowSchema * out_schema);
+
 private:
 
+    /**
+     * Sets up the string columns once a chunk has been appended.
+     */
+    void initChunk();
+
     /**
      * The Arrow-format chunk iterator object.
      */
     std::shared_ptr<Snowflake::Client::ArrowChunkIterator> m_chunkIterator;
 
     /**
-    * The cache for string value for each column of current row.
-    */
-    std::vector<std::pair<bool, std::string> > m_cacheStrVal;
+     * Forgets the string columns of the previous record batch.
+     */
+    void resetStringColumns();
+
+    /**
+     * Gets the string form of a column in the current record batch, converting the whole
+     * column on first access.
+     *
+     * @param colIdx               The zero-based index of the column.
+     * @param outColumn            Set to the converted column.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS getStringColumn(size_t colIdx, const ArrowStringColumn ** outColumn);
+
+    /**
+     * String values of the current record batch, per column. Pointers into them stay valid
+     * until the iterator moves on to another record batch.
+     */
+    std::vector<ArrowStringColumn> m_stringColumns;
+
+    /**
+     * Whether each column in m_stringColumns has been converted for the current record batch.
+     */
+    std::vector<bool> m_stringColumnReady;
+
+    /**
+     * Value of the current cell, for cells whose column conversion failed.
+     */
+    std::string m_cellString;
 };
 
 } // namespace Client
 } // namespace Snowflake
 
-#endif // SF_WIN32
+#endif // SF_NO_ARROW
 #endif // SNOWFLAKECLIENT_RESULTSETARROW_HPP
@@ -2,25 +2,31 @@
  * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
  */
 
-#include <cerrno>
 #include <cstring>
 #include <stdlib.h>
 
 #include "../logger/SFLogger.hpp"
 #include "DataConversion.hpp"
+#include "JsonArrowConverter.hpp"
 #include "memory.h"
 #include "ResultSetJson.hpp"
+#include "hex.h"
+#include "json_rowset.h"
+#include "number_parse.h"
 
 namespace Snowflake
 {
 namespace Client
 {
 
-
 ResultSetJson::ResultSetJson() :
     ResultSet()
 {
     m_queryResultFormat = QueryResultFormat::JSON;
+    m_chunk = nullptr;
+    m_currRowCells = nullptr;
+    m_rowCountInChunk = 0;
+    m_chunkExported = false;
 }
 
 ResultSetJson::ResultSetJson(
@@ -32,18 +38,55 @@ ResultSetJson::ResultSetJson(
 {
     m_queryResultFormat = QueryResultFormat::JSON;
     m_chunk = nullptr;
+    m_currRowCells = nullptr;
+    m_rowCountInChunk = 0;
+    m_chunkExported = false;
+
+    // The first rowset comes with the query response, which has been parsed by cJSON already
+    if (!snowflake_cJSON_IsArray(rowset))
+    {
+        CXX_LOG_ERROR("ResultSetJson -- Given rowset is not of type array.");
+        setError(SF_STATUS_ERROR_BAD_JSON, "Given rowset is not of type array.");
+    }
+    else
+    {
+        SF_JSON_ROWSET * chunk = sf_json_rowset_from_cjson(rowset);
+        if (chunk == nullptr)
+        {
+            CXX_LOG_ERROR("ResultSetJson -- Given rowset is not an array of rows.");
+            setError(SF_STATUS_ERROR_BAD_JSON, "Given rowset is not an array of rows.");
+        }
+        else
+        {
+            appendChunk(chunk);
+        }
+    }
+    snowflake_cJSON_Delete(rowset);
+}
+
+ResultSetJson::ResultSetJson(
+    SF_JSON_ROWSET * rowset,
+    SF_COLUMN_DESC * metadata,
+    std::string tzString
+) :
+    ResultSet(metadata, tzString)
+{
+    m_queryResultFormat = QueryResultFormat::JSON;
+    m_chunk = nullptr;
+    m_currRowCells = nullptr;
+    m_rowCountInChunk = 0;
+    m_chunkExported = false;
     appendChunk(rowset);
 }
 
 ResultSetJson::~ResultSetJson()
 {
-    if (m_chunk != nullptr)
-        snowflake_cJSON_Delete(m_chunk);
+    sf_json_rowset_free(m_chunk);
 }
 
 // Public methods ==================================================================================
 
-SF_STATUS STDCALL ResultSetJson::appendChunk(cJSON * chunk)
+SF_STATUS STDCALL ResultSetJson::appendChunk(SF_JSON_ROWSET * chunk)
 {
     if (chunk == nullptr)
     {
@@ -52,26 +95,20 @@ SF_STATUS STDCALL ResultSetJson::appendChunk(cJSON * chunk)
         return SF_STATUS_ERROR_NULL_POINTER;
     }
 
-    if (!snowflake_cJSON_IsArray(chunk))
-    {
-        CXX_LOG_ERROR("appendChunk -- Given chunk is not of type array.");
-        setError(SF_STATUS_ERROR_BAD_JSON, "Given chunk is not of type array.");
-        return SF_STATUS_ERROR_BAD_JSON;
-    }
-
     // Free previous chunk, if it exists, and set m_chunks to the given chunk.
-    if (m_chunk != nullptr)
-        snowflake_cJSON_Delete(m_chunk);
+    sf_json_rowset_free(m_chunk);
     m_chunk = chunk;
 
     // The initial state upon appending a new chunk.
     m_currChunkRowIdx = 0;
-    m_currRow = nullptr;
+    m_currRowCells = nullptr;
+    m_nullBitmaps.clear();
+    m_chunkExported = false;
 
     // Update other counts.
     if (m_isFirstChunk)
     {
-        m_totalColumnCount = snowflake_cJSON_GetArraySize(m_chunk->child);
+        m_totalColumnCount = m_chunk->column_count;
         if (0 == m_totalColumnCount)
         {
             m_rowCountInChunk = 0;
@@ -79,7 +116,15 @@ SF_STATUS STDCALL ResultSetJson::appendChunk(cJSON * chunk)
         }
         m_isFirstChunk = false;
     }
-    m_rowCountInChunk = snowflake_cJSON_GetArraySize(m_chunk);
+    else if (m_chunk->row_count > 0 && m_chunk->column_count != m_totalColumnCount)
+    {
+        CXX_LOG_ERROR("appendChunk -- Chunk has %d columns instead of %d.",
+            m_chunk->column_count, m_totalColumnCount);
+        setError(SF_STATUS_ERROR_BAD_JSON, "Chunk has a different number of columns.");
+        m_rowCountInChunk = 0;
+        return SF_STATUS_ERROR_BAD_JSON;
+    }
+    m_rowCountInChunk = m_chunk->row_count;
     m_totalChunkCount++;
     CXX_LOG_DEBUG("appendChunk -- Appended chunk of size %d.", m_rowCountInChunk);
 
@@ -88,23 +133,26 @@ SF_STATUS STDCALL ResultSetJson::appendChunk(cJSON * chunk)
 
 SF_STATUS STDCALL ResultSetJson::next()
 {
-    // If the current row is null, then this is the first call to next().
+    // If there is no current row, then this is the first call to next().
     // On the first call, we advance the iterator from a null state to the first element.
-    if (m_currRow == nullptr)
+    if (m_currRowCells == nullptr)
     {
-        m_currRow = m_chunk->child;
+        if (m_rowCountInChunk > 0)
+        {
+            m_currRowCells = m_chunk->cells;
+        }
         return SF_STATUS_SUCCESS;
     }
 
     // If we've reached the end of the chunk, then maintain this state until reset by appendChunk().
     // Otherwise, traverse to the next row as usual.
-    if (m_currRow->next == nullptr)
+    if (m_currChunkRowIdx + 1 >= m_rowCountInChunk)
     {
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
     else
     {
-        m_currRow = m_currRow->next;
+        m_currRowCells += m_totalColumnCount;
         m_currChunkRowIdx++;
         m_currRowIdx++;
     }
@@ -121,32 +169,34 @@ SF_STATUS STDCALL ResultSetJson::getCellAsBool(size_t idx, sf_bool * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = SF_BOOLEAN_FALSE;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return SF_STATUS_SUCCESS;
     }
 
-    char * endptr;
+    const char * endptr;
+    sf_bool outOfRange;
     SF_C_TYPE ctype = m_metadata[m_currColumnIdx].c_type;
     switch (ctype)
     {
         case SF_C_TYPE_BOOLEAN:
         {
-            *out_data = strcmp("1", cell->valuestring) == 0 ?
+            *out_data = strcmp("1", cellValue) == 0 ?
                 SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
             return SF_STATUS_SUCCESS;
         }
         case SF_C_TYPE_FLOAT64:
         {
-            float64 floatVal = strtod(cell->valuestring, &endptr);
+            float64 floatVal;
+            endptr = sf_parse_float64(cellValue, &floatVal, &outOfRange);
 
-            if (endptr == cell->valuestring)
+            if (endptr == cellValue)
             {
                 CXX_LOG_ERROR("Value cannot be converted from float64 to boolean.");
                 setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -166,9 +216,10 @@ SF_STATUS STDCALL ResultSetJson::getCellAsBool(size_t idx, sf_bool * out_data)
         }
         case SF_C_TYPE_INT64:
         {
-            int64 intVal = strtoll(cell->valuestring, &endptr, 10);
+            int64 intVal;
+            endptr = sf_parse_int64(cellValue, &intVal, &outOfRange);
 
-            if (endptr == cell->valuestring)
+            if (endptr == cellValue)
             {
                 CXX_LOG_ERROR("Value cannot be converted from int64 to boolean.");
                 setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -181,7 +232,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsBool(size_t idx, sf_bool * out_data)
         }
         case SF_C_TYPE_STRING:
         {
-            *out_data = strlen(cell->valuestring) == 0 ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
+            *out_data = strlen(cellValue) == 0 ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
             return SF_STATUS_SUCCESS;
         }
         default:
@@ -201,16 +252,16 @@ SF_STATUS STDCALL ResultSetJson::getCellAsInt8(size_t idx, int8 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         *out_data = 0;
         return SF_STATUS_SUCCESS;
     }
 
-    *out_data = static_cast<int8>(cell->valuestring[0]);
+    *out_data = static_cast<int8>(cellValue[0]);
     return SF_STATUS_SUCCESS;
 }
 
@@ -223,24 +274,23 @@ SF_STATUS STDCALL ResultSetJson::getCellAsInt32(size_t idx, int32 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return SF_STATUS_SUCCESS;
     }
 
     int64 value = 0;
-    char * endptr;
-    errno = 0;
-    value = std::strtoll(cell->valuestring, &endptr, 10);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_int64(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0)
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to int32.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -248,7 +298,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsInt32(size_t idx, int32 * out_data)
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    if (((value == LONG_MIN || value == LONG_MAX) && errno == ERANGE)
+    if (outOfRange
         || (value < SF_INT32_MIN || value > SF_INT32_MAX))
     {
         CXX_LOG_ERROR("Value out of range for int32.");
@@ -270,25 +320,24 @@ SF_STATUS STDCALL ResultSetJson::getCellAsInt64(size_t idx, int64 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         *out_data = 0;
         return SF_STATUS_SUCCESS;
     }
 
     int64 value = 0;
-    char * endptr;
-    errno = 0;
-    value = std::strtoll(cell->valuestring, &endptr, 10);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_int64(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0)
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to int64.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -296,7 +345,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsInt64(size_t idx, int64 * out_data)
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    if ((value == SF_INT64_MIN || value == SF_INT64_MAX) && errno == ERANGE)
+    if (outOfRange)
     {
         CXX_LOG_ERROR("Value out of range for int64.");
         setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -317,16 +366,16 @@ SF_STATUS STDCALL ResultSetJson::getCellAsUint8(size_t idx, uint8 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         *out_data = 0;
         return SF_STATUS_SUCCESS;
     }
 
-    *out_data = static_cast<uint8>(cell->valuestring[0]);
+    *out_data = static_cast<uint8>(cellValue[0]);
     return SF_STATUS_SUCCESS;
 }
 
@@ -339,25 +388,24 @@ SF_STATUS STDCALL ResultSetJson::getCellAsUint32(size_t idx, uint32 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         *out_data = 0;
         return SF_STATUS_SUCCESS;
     }
 
     uint64 value = 0;
-    char * endptr;
-    errno = 0;
-    value = std::strtoull(cell->valuestring, &endptr, 10);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_uint64(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0) 
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to uint32.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -365,9 +413,9 @@ SF_STATUS STDCALL ResultSetJson::getCellAsUint32(size_t idx, uint32 * out_data)
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    bool isNeg = (std::strchr(cell->valuestring, '-') != NULL) ? true : false;
+    bool isNeg = (std::strchr(cellValue, '-') != NULL) ? true : false;
 
-    if (((value == 0 || value == ULONG_MAX) && errno == ERANGE)
+    if (outOfRange
         || (isNeg && value < (SF_UINT64_MAX - SF_UINT32_MAX))
         || (!isNeg && value > SF_UINT32_MAX))
     {
@@ -394,24 +442,23 @@ SF_STATUS STDCALL ResultSetJson::getCellAsUint64(size_t idx, uint64 * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return SF_STATUS_SUCCESS;
     }
 
     uint64 value = 0;
-    char * endptr;
-    errno = 0;
-    value = std::strtoull(cell->valuestring, &endptr, 10);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_uint64(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0)
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to uint64.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -419,7 +466,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsUint64(size_t idx, uint64 * out_data)
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    if ((value == 0 || value == SF_UINT64_MAX) && errno == ERANGE)
+    if (outOfRange)
     {
         CXX_LOG_ERROR("Value out of range for uint64.");
         setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -440,24 +487,23 @@ SF_STATUS STDCALL ResultSetJson::getCellAsFloat32(size_t idx, float32 * out_data
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0.0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return SF_STATUS_SUCCESS;
     }
 
     float32 value = 0.0;
-    char * endptr;
-    errno = 0;
-    value = std::strtof(cell->valuestring, &endptr);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_float32(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0)
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to float32.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -465,7 +511,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsFloat32(size_t idx, float32 * out_data
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    if (errno == ERANGE || value == INFINITY || value == -INFINITY)
+    if (outOfRange || value == INFINITY || value == -INFINITY)
     {
         CXX_LOG_ERROR("Value out of range for float32.");
         setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -486,24 +532,23 @@ SF_STATUS STDCALL ResultSetJson::getCellAsFloat64(size_t idx, float64 * out_data
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
     // Set default value for error or null cases.
     *out_data = 0.0;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return SF_STATUS_SUCCESS;
     }
 
     float64 value = 0;
-    char * endptr;
-    errno = 0;
-    value = std::strtod(cell->valuestring, &endptr);
+    sf_bool outOfRange;
+    const char * endptr = sf_parse_float64(cellValue, &value, &outOfRange);
 
-    if ((value == 0 && std::strcmp(cell->valuestring, "0") != 0)
-        || endptr == cell->valuestring)
+    if ((value == 0 && std::strcmp(cellValue, "0") != 0)
+        || endptr == cellValue)
     {
         CXX_LOG_ERROR("Cannot convert value to float64.");
         setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
@@ -511,7 +556,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsFloat64(size_t idx, float64 * out_data
         return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
-    if (errno == ERANGE || value == -INFINITY || value == INFINITY)
+    if (outOfRange || value == -INFINITY || value == INFINITY)
     {
         CXX_LOG_ERROR("Value out of range for float64.");
         setError(SF_STATUS_ERROR_OUT_OF_RANGE,
@@ -532,16 +577,16 @@ SF_STATUS STDCALL ResultSetJson::getCellAsConstString(size_t idx, const char **
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         *out_data = NULL;
         return SF_STATUS_SUCCESS;
     }
 
-    *out_data = cell->valuestring;
+    *out_data = cellValue;
     return SF_STATUS_SUCCESS;
 }
 
@@ -554,12 +599,12 @@ SF_STATUS STDCALL ResultSetJson::getCellAsTimestamp(size_t idx, SF_TIMESTAMP * o
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
     SF_DB_TYPE snowType = m_metadata[m_currColumnIdx].type;
     SF_STATUS status = SF_STATUS_SUCCESS;
 
-    if (snowflake_cJSON_IsNull(cell))
+    if (cellValue == NULL)
     {
         return snowflake_timestamp_from_parts(out_data, 0, 0, 0, 0, 1, 1, 1970, 0, 9, SF_DB_TYPE_TIMESTAMP_NTZ);
     }
@@ -572,7 +617,7 @@ SF_STATUS STDCALL ResultSetJson::getCellAsTimestamp(size_t idx, SF_TIMESTAMP * o
     {
         status = snowflake_timestamp_from_epoch_seconds(
             out_data,
-            cell->valuestring,
+            cellValue,
             m_tzString.c_str(),
             m_metadata[m_currColumnIdx].scale,
             snowType);
@@ -601,18 +646,94 @@ SF_STATUS STDCALL ResultSetJson::getCellStrlen(size_t idx, size_t * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    size_t len = 0;
+    getCellValue(idx - 1, &len);
     m_currColumnIdx = idx - 1;
 
-    if (snowflake_cJSON_IsNull(cell))
+    *out_data = len;
+
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL ResultSetJson::getCellAsStrView(size_t idx, const char ** out_data, size_t * out_len)
+{
+    if (idx < 1 || idx > m_totalColumnCount)
     {
-      *out_data = 0;
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
+            "Column index must be between 1 and snowflake_num_fields()");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
-    else
+
+    size_t len = 0;
+    *out_data = getCellValue(idx - 1, &len);
+    *out_len = *out_data ? len : 0;
+    m_currColumnIdx = idx - 1;
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL ResultSetJson::getCellAsBinary(size_t idx, const void ** out_data, size_t * out_len)
+{
+    if (idx < 1 || idx > m_totalColumnCount)
+    {
+        setError(SF_STATUS_ERROR_OUT_OF_BOUNDS,
+            "Column index must be between 1 and snowflake_num_fields()");
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    size_t len = 0;
+    const char * cellValue = getCellValue(idx - 1, &len);
+    m_currColumnIdx = idx - 1;
+    SF_DB_TYPE snowType = m_metadata[m_currColumnIdx].type;
+
+    *out_data = NULL;
+    *out_len = 0;
+
+    if (cellValue == NULL)
+    {
+        return SF_STATUS_SUCCESS;
+    }
+
+    if (SF_DB_TYPE_TEXT == snowType)
+    {
+        *out_data = cellValue;
+        *out_len = len;
+        return SF_STATUS_SUCCESS;
+    }
+
+    if (SF_DB_TYPE_BINARY != snowType)
+    {
+        CXX_LOG_ERROR("Not a valid type for binary conversion: %d.", snowType);
+        setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
+            "Not a valid type for binary conversion.");
+        return SF_STATUS_ERROR_CONVERSION_FAILURE;
+    }
+
+    const char * hex = cellValue;
+    size_t hexLen = len;
+    if (hexLen % 2 != 0)
+    {
+        CXX_LOG_ERROR("Cannot convert value to binary.");
+        setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
+            "Cannot convert value to binary.");
+        return SF_STATUS_ERROR_CONVERSION_FAILURE;
+    }
+
+    if (m_binaryCells.size() < m_totalColumnCount)
+    {
+        m_binaryCells.resize(m_totalColumnCount);
+    }
+    std::string & bytes = m_binaryCells[m_currColumnIdx];
+    bytes.resize(hexLen / 2);
+    if (!sf_hex_decode(&bytes[0], hex, hexLen / 2))
     {
-      *out_data = std::strlen(cell->valuestring);
+        CXX_LOG_ERROR("Cannot convert value to binary.");
+        setError(SF_STATUS_ERROR_CONVERSION_FAILURE,
+            "Cannot convert value to binary.");
+        return SF_STATUS_ERROR_CONVERSION_FAILURE;
     }
 
+    *out_data = bytes.data();
+    *out_len = bytes.size();
     return SF_STATUS_SUCCESS;
 }
 
@@ -630,11 +751,243 @@ SF_STATUS STDCALL ResultSetJson::isCellNull(size_t idx, sf_bool * out_data)
         return SF_STATUS_ERROR_OUT_OF_BOUNDS;
     }
 
-    cJSON * cell = snowflake_cJSON_GetArrayItem(m_currRow, idx - 1);
+    const char * cellValue = getCellValue(idx - 1);
     m_currColumnIdx = idx - 1;
 
-    *out_data = snowflake_cJSON_IsNull(cell) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    *out_data = cellValue == NULL ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+
+    return SF_STATUS_SUCCESS;
+}
 
+size_t ResultSetJson::getRowsLeftInChunk()
+{
+    if (m_currRowCells == nullptr)
+    {
+        return 0;
+    }
+    return m_rowCountInChunk - m_currChunkRowIdx;
+}
+
+bool ResultSetJson::copyColumn(size_t idx, SF_C_TYPE cType, void * out_data, uint8 * null_bitmap,
+                               size_t bit_offset, size_t row_count)
+{
+    if ((idx < 1) || (idx > m_totalColumnCount) || (row_count > getRowsLeftInChunk()))
+    {
+        return false;
+    }
+    if (SF_C_TYPE_TIMESTAMP == cType)
+    {
+        return copyTimestampColumn(idx, (SF_TIMESTAMP *) out_data, null_bitmap, bit_offset,
+                                   row_count);
+    }
+    if ((SF_C_TYPE_INT64 != cType) && (SF_C_TYPE_UINT64 != cType) && (SF_C_TYPE_FLOAT64 != cType))
+    {
+        return false;
+    }
+
+    const SF_JSON_CELL * cell = m_currRowCells + (idx - 1);
+    for (size_t i = 0; i < row_count; ++i, cell += m_totalColumnCount)
+    {
+        bool isNull = cell->is_null ? true : false;
+        const char * cellValue = &m_chunk->buffer[cell->offset];
+        const char * endptr = cellValue;
+        sf_bool outOfRange = SF_BOOLEAN_FALSE;
+        bool isZero = false;
+
+        switch (cType)
+        {
+            case SF_C_TYPE_INT64:
+            {
+                int64 * values = (int64 *) out_data;
+                values[i] = 0;
+                if (!isNull)
+                {
+                    endptr = sf_parse_int64(cellValue, &values[i], &outOfRange);
+                    isZero = values[i] == 0;
+                }
+                break;
+            }
+            case SF_C_TYPE_UINT64:
+            {
+                uint64 * values = (uint64 *) out_data;
+                values[i] = 0;
+                if (!isNull)
+                {
+                    endptr = sf_parse_uint64(cellValue, &values[i], &outOfRange);
+                    isZero = values[i] == 0;
+                }
+                break;
+            }
+            default:
+            {
+                float64 * values = (float64 *) out_data;
+                values[i] = 0.0;
+                if (!isNull)
+                {
+                    endptr = sf_parse_float64(cellValue, &values[i], &outOfRange);
+                    isZero = values[i] == 0;
+                    if (values[i] == INFINITY || values[i] == -INFINITY)
+                    {
+                        outOfRange = SF_BOOLEAN_TRUE;
+                    }
+                }
+                break;
+            }
+        }
+
+        // Leave the errors to the cell getters
+        if (!isNull &&
+            (outOfRange || (endptr == cellValue) || (isZero && std::strcmp(cellValue, "0") != 0)))
+        {
+            return false;
+        }
+
+        if (null_bitmap)
+        {
+            size_t bit = bit_offset + i;
+            if (isNull)
+            {
+                null_bitmap[bit / 8] |= (uint8) (1 << (bit % 8));
+            }
+            else
+            {
+                null_bitmap[bit / 8] &= (uint8) ~(1 << (bit % 8));
+            }
+        }
+    }
+    return true;
+}
+
+bool ResultSetJson::copyTimestampColumn(size_t idx, SF_TIMESTAMP * out_data, uint8 * null_bitmap,
+                                        size_t bit_offset, size_t row_count)
+{
+    SF_DB_TYPE snowType = m_metadata[idx - 1].type;
+    if ((SF_DB_TYPE_DATE != snowType) && (SF_DB_TYPE_TIME != snowType)
+        && (SF_DB_TYPE_TIMESTAMP_LTZ != snowType) && (SF_DB_TYPE_TIMESTAMP_NTZ != snowType)
+        && (SF_DB_TYPE_TIMESTAMP_TZ != snowType))
+    {
+        return false;
+    }
+
+    std::vector<const char *> cellValues(row_count);
+    const SF_JSON_CELL * cell = m_currRowCells + (idx - 1);
+    for (size_t i = 0; i < row_count; ++i, cell += m_totalColumnCount)
+    {
+        cellValues[i] = cell->is_null ? NULL : &m_chunk->buffer[cell->offset];
+    }
+
+    // Leave the errors to the cell getters
+    if (snowflake_timestamps_from_epoch_seconds(out_data, cellValues.data(), row_count,
+            m_tzString.c_str(), (int32) m_metadata[idx - 1].scale, snowType) != SF_STATUS_SUCCESS)
+    {
+        return false;
+    }
+
+    if (null_bitmap)
+    {
+        for (size_t i = 0; i < row_count; ++i)
+        {
+            size_t bit = bit_offset + i;
+            if (cellValues[i] == NULL)
+            {
+                null_bitmap[bit / 8] |= (uint8) (1 << (bit % 8));
+            }
+            else
+            {
+                null_bitmap[bit / 8] &= (uint8) ~(1 << (bit % 8));
+            }
+        }
+    }
+    return true;
+}
+
+bool ResultSetJson::copyNullBitmap(size_t idx, uint8 * null_bitmap, size_t row_count,
+                                   size_t * null_count)
+{
+    if ((idx < 1) || (idx > m_totalColumnCount) || (row_count > getRowsLeftInChunk()))
+    {
+        return false;
+    }
+    *null_count = 0;
+    if (row_count == 0)
+    {
+        return true;
+    }
+
+    if (m_nullBitmaps.size() != m_totalColumnCount)
+    {
+        m_nullBitmaps.resize(m_totalColumnCount);
+    }
+    std::vector<uint8> & chunkBitmap = m_nullBitmaps[idx - 1];
+    if (chunkBitmap.empty())
+    {
+        chunkBitmap.assign((m_rowCountInChunk + 7) / 8, 0);
+        const SF_JSON_CELL * cell = m_chunk->cells + (idx - 1);
+        for (size_t row = 0; row < m_rowCountInChunk; ++row, cell += m_totalColumnCount)
+        {
+            if (cell->is_null)
+            {
+                chunkBitmap[row / 8] |= (uint8) (1 << (row % 8));
+            }
+        }
+    }
+
+    *null_count = copyNullBits(chunkBitmap.data(), m_currChunkRowIdx, false,
+                               null_bitmap, row_count);
+    return true;
+}
+
+void ResultSetJson::skipRows(size_t row_count)
+{
+    if ((m_currRowCells == nullptr) || (row_count == 0) || (row_count >= getRowsLeftInChunk()))
+    {
+        return;
+    }
+    m_currRowCells += row_count * m_totalColumnCount;
+    m_currChunkRowIdx += row_count;
+    m_currRowIdx += row_count;
+}
+
+void ResultSetJson::moveToRow(size_t row)
+{
+    if ((m_chunk == nullptr) || (row >= m_rowCountInChunk))
+    {
+        return;
+    }
+    // The row before it is the current one, or none for the first row
+    size_t currRow = (m_currRowCells == nullptr) ? 0 : m_currChunkRowIdx + 1;
+    m_currRowIdx = m_currRowIdx + row - currRow;
+    if (row == 0)
+    {
+        m_currRowCells = nullptr;
+        m_currChunkRowIdx = 0;
+    }
+    else
+    {
+        m_currRowCells = m_chunk->cells + (row - 1) * m_totalColumnCount;
+        m_currChunkRowIdx = row - 1;
+    }
+    m_chunkExported = false;
+}
+
+SF_STATUS STDCALL ResultSetJson::exportNextBatch(struct ArrowArray * out_array,
+                                                 struct ArrowSchema * out_schema)
+{
+    size_t firstRow = m_currRowCells ? m_currChunkRowIdx : 0;
+    if (m_chunkExported || (m_chunk == nullptr) || (firstRow >= m_rowCountInChunk))
+    {
+        return SF_STATUS_EOF;
+    }
+
+    std::string errorMessage;
+    SF_STATUS ret = JsonArrowConverter::exportRows(m_chunk, firstRow, m_metadata, out_array,
+                                                   out_schema, errorMessage);
+    if (ret != SF_STATUS_SUCCESS)
+    {
+        setError(ret, errorMessage.c_str());
+        return ret;
+    }
+    m_chunkExported = true;
     return SF_STATUS_SUCCESS;
 }
 
@@ -5,7 +5,10 @@
 #ifndef SNOWFLAKECLIENT_RESULTSETJSON_HPP
 #define SNOWFLAKECLIENT_RESULTSETJSON_HPP
 
+#include <vector>
+
 #include "cJSON.h"
+#include "json_rowset.h"
 #include "ResultSet.hpp"
 
 namespace Snowflake
@@ -16,7 +19,7 @@ namespace Client
 /**
  * Represents a result set retrieved in JSON format.
  *
- * Internally, the result set is stored as a cJSON structure representing the current chunk being
+ * Internally, the result set is stored as an SF_JSON_ROWSET representing the current chunk being
  * processed. This chunk will be continually freed and set as the application consumes chunks.
  *
  * When using this class, populate the result set one chunk at a time by using the client library
@@ -31,9 +34,9 @@ namespace Client
  * To advance to the next row, simply call snowflake_fetch() again, which will in turn call
  * next() or appendChunk() if there are no more rows to be consumed.
  *
- * Note: We cache both the current row for performance.
+ * Note: We cache the cells of the current row for performance.
  */
-class ResultSetJson : public Snowflake::Client::ResultSet
+class ResultSetJson final : public Snowflake::Client::ResultSet
 {
 public:
 
@@ -54,6 +57,18 @@ public:
         SF_COLUMN_DESC * metadata,
         std::string tzString);
 
+    /**
+     * Parameterized constructor.
+     *
+     * @param rowset                    A pointer to a downloaded chunk of the result set.
+     * @param metadata                  A pointer to the metadata of the result set.
+     * @param tzString                  The time zone.
+     */
+    ResultSetJson(
+        SF_JSON_ROWSET * rowset,
+        SF_COLUMN_DESC * metadata,
+        std::string tzString);
+
     /**
      * Destructor.
      */
@@ -66,7 +81,7 @@ public:
      *
      * @return 0 if successful, otherwise an error is returned.
      */
-    SF_STATUS STDCALL appendChunk(cJSON * chunk);
+    SF_STATUS STDCALL appendChunk(SF_JSON_ROWSET * chunk);
 
     /**
      * Advances the internal iterator to the next row. If there are no more rows to consume,
@@ -199,6 +214,33 @@ public:
      */
     SF_STATUS STDCALL getCellStrlen(size_t idx, size_t * out_data);
 
+    /**
+     * Writes the raw bytes of the given BINARY or TEXT cell to the provided buffers.
+     *
+     * BINARY cells arrive as hex text and are decoded into a per-column buffer, which stays
+     * valid until the column is read again or the cursor moves.
+     *
+     * @param idx                  The index of the column to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getCellAsBinary(size_t idx, const void ** out_data, size_t * out_len);
+
+    /**
+     * Writes the text of the given cell and its length to the provided buffers.
+     *
+     * The text points into the chunk, NUL-terminated, as getCellAsConstString() gives it.
+     *
+     * @param idx                  The index of the column to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL getCellAsStrView(size_t idx, const char ** out_data, size_t * out_len);
+
     /**
      * Gets the total number of rows in the current chunk being processed.
      *
@@ -216,22 +258,136 @@ public:
      */
     SF_STATUS STDCALL isCellNull(size_t idx, sf_bool * out_data);
 
+    /**
+     * Gets the number of rows left in the current chunk, the current row included.
+     */
+    size_t getRowsLeftInChunk();
+
+    /**
+     * Parses the values of a column for a run of rows starting at the current row. Supports
+     * int64, uint64, float64 and, for the date and time columns, timestamps, and converts the
+     * cells like the cell getters do.
+     *
+     * @param idx                  The index of the column to copy.
+     * @param cType                The C type of the values in out_data.
+     * @param out_data             The buffer to write row_count values to.
+     * @param null_bitmap          The null bitmap to update. May be NULL.
+     * @param bit_offset           The bit of the current row in null_bitmap.
+     * @param row_count            The number of rows.
+     *
+     * @return true if the values were copied, false if the C type is not supported or a cell
+     *         can't be converted, in which case the cell getters report the error.
+     */
+    bool copyColumn(size_t idx, SF_C_TYPE cType, void * out_data, uint8 * null_bitmap,
+                    size_t bit_offset, size_t row_count);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row. The null
+     * bitmap of the whole column is built from the cells the first time it is asked for and
+     * kept until the next chunk is appended.
+     *
+     * @param idx                  The index of the column.
+     * @param null_bitmap          The (row_count + 7) / 8 bytes to write.
+     * @param row_count            The number of rows.
+     * @param null_count           Receives the number of NULL rows.
+     *
+     * @return true if the bits were written.
+     */
+    bool copyNullBitmap(size_t idx, uint8 * null_bitmap, size_t row_count, size_t * null_count);
+
+    /**
+     * Moves forward by the given number of rows within the current chunk.
+     */
+    void skipRows(size_t row_count);
+
+    /**
+     * Exports the rows of the current chunk, from the current row on, as one record batch.
+     * See JsonArrowConverter::exportRows().
+     *
+     * @param out_array            Receives the record batch.
+     * @param out_schema           Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if the chunk has been exported already or has no
+     *         more rows, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL exportNextBatch(struct ArrowArray * out_array, struct ArrowSchema * out_schema);
+
+    /**
+     * Positions the iterator before a row of the current chunk, backward or forward, so that
+     * the next call to next() moves to that row.
+     *
+     * @param row                  The index of the row within the chunk.
+     */
+    void moveToRow(size_t row);
+
+    /**
+     * @return the current chunk, nullptr if there is none.
+     */
+    const SF_JSON_ROWSET * getChunk() const
+    {
+        return m_chunk;
+    }
+
 private:
 
+    /**
+     * Converts the values of a date or time column for a run of rows starting at the current
+     * row all at once, with the scale of the column. See copyColumn().
+     */
+    bool copyTimestampColumn(size_t idx, SF_TIMESTAMP * out_data, uint8 * null_bitmap,
+                             size_t bit_offset, size_t row_count);
+
+    /**
+     * Gets the value of a cell of the current row.
+     *
+     * @param colIdx               The zero-based index of the column.
+     * @param len                  Set to the length of the value, if not NULL.
+     *
+     * @return the NUL-terminated value, or NULL if the cell is null or there is no current row.
+     */
+    const char * getCellValue(size_t colIdx, size_t * len = NULL)
+    {
+        const SF_JSON_CELL * cell = m_currRowCells ? &m_currRowCells[colIdx] : nullptr;
+        if (len)
+        {
+            *len = (cell && !cell->is_null) ? cell->len : 0;
+        }
+        if (!cell || cell->is_null)
+        {
+            return NULL;
+        }
+        return &m_chunk->buffer[cell->offset];
+    }
+
     /**
      * The current chunk retrieved from the server.
      */
-    cJSON * m_chunk;
+    SF_JSON_ROWSET * m_chunk;
 
     /**
-     * The JSON array representing the current row.
+     * The cells of the current row, by column.
      */
-    cJSON * m_currRow;
+    const SF_JSON_CELL * m_currRowCells;
 
     /**
      * The number of rows in the chunk currently being processed.
      */
     size_t m_rowCountInChunk;
+
+    /**
+     * The decoded bytes of the BINARY cells last read through getCellAsBinary(), by column.
+     */
+    std::vector<std::string> m_binaryCells;
+
+    /**
+     * The null bitmaps of the columns of the current chunk, by column, empty until built.
+     */
+    std::vector<std::vector<uint8> > m_nullBitmaps;
+
+    /**
+     * Whether the current chunk has been exported by exportNextBatch().
+     */
+    bool m_chunkExported;
 };
 
 } // namespace Client
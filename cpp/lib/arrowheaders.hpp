@@ -8,7 +8,7 @@
 #include <vector>
 
 /*
-  Apache arrow is not implemented for WIN32
+  Apache arrow is only built for WIN32 when WIN32_ARROW is set
   The symbol _WIN32 is defined by the compiler to indicate that this is a (32bit) Windows compilation. 
   Unfortunately, for historical reasons, it is also defined for 64-bit compilation.
   The symbol _WIN64 is defined by the compiler to indicate that this is a 64-bit Windows compilation.
@@ -21,11 +21,16 @@
 #define SF_WIN32
 #endif
 
-#ifndef SF_WIN32
+// Arrow builds for 32-bit Windows are opt-in, see WIN32_ARROW in CMakeLists.txt
+#if defined(SF_WIN32) && !defined(SF_WIN32_ARROW) && !defined(SF_NO_ARROW)
+#define SF_NO_ARROW
+#endif
+
+#ifndef SF_NO_ARROW
 
 #undef BOOL              //Arrow redefines BOOL
 
-#ifdef _WIN64
+#ifdef _WIN32
 #undef max
 #undef min
 
@@ -35,6 +40,7 @@
 
 #include <arrow/api.h>
 #include <arrow/io/api.h>
+#include "arrow/c/bridge.h"
 #include "arrow/ipc/reader.h"
 #include "arrow/ipc/writer.h"
 #include "arrow/ipc/options.h"
@@ -5,10 +5,80 @@
 #include "result_set.h"
 #include "ResultSet.hpp"
 
+namespace
+{
+    // Adapt the accessors of a format to the untyped result set of rs_accessors_t
+
+    template <typename Handle, SF_STATUS (STDCALL * Next)(Handle *)>
+    SF_STATUS STDCALL nextAccessor(void * rs)
+    {
+        return Next(static_cast<Handle *>(rs));
+    }
+
+    template <typename Handle, typename T, SF_STATUS (STDCALL * Getter)(Handle *, size_t, T *)>
+    SF_STATUS STDCALL cellAccessor(void * rs, size_t idx, T * out_data)
+    {
+        return Getter(static_cast<Handle *>(rs), idx, out_data);
+    }
+
+    template <typename Handle,
+              SF_STATUS (STDCALL * Getter)(Handle *, size_t, const void **, size_t *)>
+    SF_STATUS STDCALL binaryAccessor(void * rs, size_t idx, const void ** out_data, size_t * out_len)
+    {
+        return Getter(static_cast<Handle *>(rs), idx, out_data, out_len);
+    }
+
+    template <typename Handle,
+              SF_STATUS (STDCALL * Getter)(Handle *, size_t, const char **, size_t *)>
+    SF_STATUS STDCALL strViewAccessor(void * rs, size_t idx, const char ** out_data, size_t * out_len)
+    {
+        return Getter(static_cast<Handle *>(rs), idx, out_data, out_len);
+    }
+
+#define RS_ACCESSORS(format) \
+    { \
+        nextAccessor<rs_##format##_t, rs_##format##_next>, \
+        cellAccessor<rs_##format##_t, sf_bool, rs_##format##_get_cell_as_bool>, \
+        cellAccessor<rs_##format##_t, int8, rs_##format##_get_cell_as_int8>, \
+        cellAccessor<rs_##format##_t, int32, rs_##format##_get_cell_as_int32>, \
+        cellAccessor<rs_##format##_t, int64, rs_##format##_get_cell_as_int64>, \
+        cellAccessor<rs_##format##_t, uint8, rs_##format##_get_cell_as_uint8>, \
+        cellAccessor<rs_##format##_t, uint32, rs_##format##_get_cell_as_uint32>, \
+        cellAccessor<rs_##format##_t, uint64, rs_##format##_get_cell_as_uint64>, \
+        cellAccessor<rs_##format##_t, float32, rs_##format##_get_cell_as_float32>, \
+        cellAccessor<rs_##format##_t, float64, rs_##format##_get_cell_as_float64>, \
+        cellAccessor<rs_##format##_t, const char *, rs_##format##_get_cell_as_const_string>, \
+        cellAccessor<rs_##format##_t, SF_TIMESTAMP, rs_##format##_get_cell_as_timestamp>, \
+        cellAccessor<rs_##format##_t, size_t, rs_##format##_get_cell_strlen>, \
+        binaryAccessor<rs_##format##_t, rs_##format##_get_cell_as_binary>, \
+        strViewAccessor<rs_##format##_t, rs_##format##_get_cell_as_str_view>, \
+        cellAccessor<rs_##format##_t, sf_bool, rs_##format##_is_cell_null>, \
+    }
+
+    const rs_accessors_t arrowAccessors = RS_ACCESSORS(arrow);
+
+    const rs_accessors_t jsonAccessors = RS_ACCESSORS(json);
+
+#undef RS_ACCESSORS
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    const rs_accessors_t * rs_get_accessors(QueryResultFormat_t * query_result_format)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return &arrowAccessors;
+            case JSON_FORMAT:
+                return &jsonAccessors;
+            default:
+                return nullptr;
+        }
+    }
+
     void * rs_create_with_json_result(
         cJSON * json_rowset,
         SF_COLUMN_DESC * metadata,
@@ -39,7 +109,7 @@ extern "C" {
             case ARROW_FORMAT:
                 return rs_arrow_create_with_chunk((NON_JSON_RESP*)initial_chunk, metadata, tz_string);
             case JSON_FORMAT:
-                return rs_json_create((cJSON*)initial_chunk, metadata, tz_string);
+                return rs_json_create_with_chunk((SF_JSON_ROWSET*)initial_chunk, metadata, tz_string);
             default:
                 return nullptr;
         }
@@ -67,7 +137,7 @@ extern "C" {
             case ARROW_FORMAT:
                 return rs_arrow_append_chunk((rs_arrow_t *) rs, (NON_JSON_RESP*)chunk);
             case JSON_FORMAT:
-                return rs_json_append_chunk((rs_json_t *) rs, (cJSON*)chunk);
+                return rs_json_append_chunk((rs_json_t *) rs, (SF_JSON_ROWSET*)chunk);
             default:
                 return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
         }
@@ -302,6 +372,44 @@ extern "C" {
         }
     }
 
+    SF_STATUS STDCALL rs_get_cell_as_binary(
+        void * rs,
+        QueryResultFormat_t * query_result_format,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len
+    )
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_get_cell_as_binary((rs_arrow_t *) rs, idx, out_data, out_len);
+            case JSON_FORMAT:
+                return rs_json_get_cell_as_binary((rs_json_t *) rs, idx, out_data, out_len);
+            default:
+                return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+        }
+    }
+
+    SF_STATUS STDCALL rs_get_cell_as_str_view(
+        void * rs,
+        QueryResultFormat_t * query_result_format,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len
+    )
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_get_cell_as_str_view((rs_arrow_t *) rs, idx, out_data, out_len);
+            case JSON_FORMAT:
+                return rs_json_get_cell_as_str_view((rs_json_t *) rs, idx, out_data, out_len);
+            default:
+                return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+        }
+    }
+
     size_t rs_get_row_count_in_chunk(void * rs, QueryResultFormat_t * query_result_format)
     {
         switch (*query_result_format)
@@ -333,6 +441,82 @@ extern "C" {
         }
     }
 
+    size_t rs_get_rows_left_in_batch(void * rs, QueryResultFormat_t * query_result_format)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_get_rows_left_in_batch((rs_arrow_t *) rs);
+            case JSON_FORMAT:
+                return rs_json_get_rows_left_in_chunk((rs_json_t *) rs);
+            default:
+                return 0;
+        }
+    }
+
+    sf_bool rs_copy_column(void * rs, QueryResultFormat_t * query_result_format, size_t idx,
+                           SF_C_TYPE c_type, void * out_data, uint8 * null_bitmap,
+                           size_t bit_offset, size_t row_count)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_copy_column((rs_arrow_t *) rs, idx, c_type, out_data,
+                                            null_bitmap, bit_offset, row_count);
+            case JSON_FORMAT:
+                return rs_json_copy_column((rs_json_t *) rs, idx, c_type, out_data,
+                                           null_bitmap, bit_offset, row_count);
+            default:
+                return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    sf_bool rs_copy_null_bitmap(void * rs, QueryResultFormat_t * query_result_format, size_t idx,
+                                uint8 * null_bitmap, size_t row_count, size_t * null_count)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_copy_null_bitmap((rs_arrow_t *) rs, idx, null_bitmap,
+                                                 row_count, null_count);
+            case JSON_FORMAT:
+                return rs_json_copy_null_bitmap((rs_json_t *) rs, idx, null_bitmap,
+                                                row_count, null_count);
+            default:
+                return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    void rs_skip_rows(void * rs, QueryResultFormat_t * query_result_format, size_t row_count)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                rs_arrow_skip_rows((rs_arrow_t *) rs, row_count);
+                break;
+            case JSON_FORMAT:
+                rs_json_skip_rows((rs_json_t *) rs, row_count);
+                break;
+            default:
+                break;
+        }
+    }
+
+    SF_STATUS STDCALL rs_export_arrow_batch(void * rs, QueryResultFormat_t * query_result_format,
+                                            struct ArrowArray * out_array,
+                                            struct ArrowSchema * out_schema)
+    {
+        switch (*query_result_format)
+        {
+            case ARROW_FORMAT:
+                return rs_arrow_export_next_batch((rs_arrow_t *) rs, out_array, out_schema);
+            case JSON_FORMAT:
+                return rs_json_export_next_batch((rs_json_t *) rs, out_array, out_schema);
+            default:
+                return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+        }
+    }
+
     SF_STATUS STDCALL rs_get_error(
         void * rs,
         QueryResultFormat_t * query_result_format
@@ -9,34 +9,60 @@
 #include "memory.h"
 #include "result_set_arrow.h"
 #include "ResultSetArrow.hpp"
+#include "ArrowChunkBuffer.hpp"
+#include "ArrowChunkStream.hpp"
+#include "../util/Base64.hpp"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#ifndef SF_WIN32
+#ifndef SF_NO_ARROW
     rs_arrow_t * rs_arrow_create_with_json_result(
         cJSON * json_rowset64,
         SF_COLUMN_DESC * metadata,
         const char * tz_string
     )
     {
-        arrow::BufferBuilder* bufferBuilder = NULL;
+        Snowflake::Client::ArrowChunkBuffer * initialChunk = NULL;
         if (json_rowset64)
         {
             const char * base64RowsetStr = snowflake_cJSON_GetStringValue(json_rowset64);
-            if (base64RowsetStr && strlen(base64RowsetStr) > 0)
+            size_t base64Length = base64RowsetStr ? strlen(base64RowsetStr) : 0;
+            if (base64Length > 0)
             {
-                // Decode Base64-encoded Arrow-format rowset of the chunk and build a buffer builder from it.
-                std::string decodedRowsetStr = arrow::util::base64_decode(std::string(base64RowsetStr));
-                bufferBuilder = new arrow::BufferBuilder();
-                (void) bufferBuilder->Append((void *)decodedRowsetStr.c_str(), decodedRowsetStr.length());
+                // Decode the Base64-encoded Arrow-format rowset straight into the buffer the
+                // record batches are read from, with no intermediate string to copy from.
+                size_t decodedLength = Snowflake::Client::Util::Base64::decodedLength(
+                    base64RowsetStr, base64Length);
+                initialChunk = new Snowflake::Client::ArrowChunkBuffer();
+                arrow::BufferBuilder & body = initialChunk->body();
+                if ((decodedLength == static_cast<size_t>(-1)) ||
+                    !body.Resize(decodedLength).ok())
+                {
+                    log_error("Unable to allocate %zu bytes for the Arrow rowset", decodedLength);
+                }
+                else
+                {
+                    decodedLength = Snowflake::Client::Util::Base64::decode(
+                        base64RowsetStr, base64Length, body.mutable_data());
+                    if (decodedLength == static_cast<size_t>(-1))
+                    {
+                        log_error("Invalid Base64 encoding of the Arrow rowset");
+                    }
+                    else
+                    {
+                        body.UnsafeAdvance(decodedLength);
+                    }
+                }
             }
+            // The encoded rowset can be as large as the decoded one, so don't keep it around
+            snowflake_cJSON_Delete(json_rowset64);
         }
 
         rs_arrow_t * rs_struct = (rs_arrow_t *) SF_MALLOC(sizeof(rs_arrow_t));
         Snowflake::Client::ResultSetArrow * rs_obj =
-            new Snowflake::Client::ResultSetArrow(bufferBuilder, metadata, std::string(tz_string));
+            new Snowflake::Client::ResultSetArrow(initialChunk, metadata, std::string(tz_string));
         rs_struct->rs_object = rs_obj;
 
         return rs_struct;
@@ -49,8 +75,17 @@ extern "C" {
     )
     {
       rs_arrow_t * rs_struct = (rs_arrow_t *)SF_MALLOC(sizeof(rs_arrow_t));
-      Snowflake::Client::ResultSetArrow * rs_obj =
-        new Snowflake::Client::ResultSetArrow((arrow::BufferBuilder*)(initial_chunk->buffer), metadata, std::string(tz_string));
+      Snowflake::Client::ResultSetArrow * rs_obj;
+      if (initial_chunk->finish_callback)
+      {
+        rs_obj = new Snowflake::Client::ResultSetArrow(
+          (Snowflake::Client::ArrowChunkStream*)(initial_chunk->buffer), metadata, std::string(tz_string));
+      }
+      else
+      {
+        rs_obj = new Snowflake::Client::ResultSetArrow(
+          (Snowflake::Client::ArrowChunkBuffer*)(initial_chunk->buffer), metadata, std::string(tz_string));
+      }
       rs_struct->rs_object = rs_obj;
 
       // the buffer is passed in to result set so the response is no longer needed
@@ -81,7 +116,16 @@ extern "C" {
 
         rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
 
-        arrow::BufferBuilder * buffer = (arrow::BufferBuilder*)(chunk->buffer);
+        if (chunk->finish_callback)
+        {
+            Snowflake::Client::ArrowChunkStream * stream =
+                (Snowflake::Client::ArrowChunkStream*)(chunk->buffer);
+            delete chunk;
+            return rs_obj->appendChunk(stream);
+        }
+
+        Snowflake::Client::ArrowChunkBuffer * buffer =
+            (Snowflake::Client::ArrowChunkBuffer*)(chunk->buffer);
         delete chunk;
         return rs_obj->appendChunk(buffer);
     }
@@ -263,6 +307,42 @@ extern "C" {
         return rs_obj->getCellStrlen(idx, out_data);
     }
 
+    SF_STATUS STDCALL rs_arrow_get_cell_as_binary(
+        rs_arrow_t * rs,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len
+    )
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->getCellAsBinary(idx, out_data, out_len);
+    }
+
+    SF_STATUS STDCALL rs_arrow_get_cell_as_str_view(
+        rs_arrow_t * rs,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len
+    )
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->getCellAsStrView(idx, out_data, out_len);
+    }
+
     size_t rs_arrow_get_row_count_in_chunk(rs_arrow_t * rs)
     {
         Snowflake::Client::ResultSetArrow * rs_obj;
@@ -289,25 +369,151 @@ extern "C" {
         return rs_obj->isCellNull(idx, out_data);
     }
 
+    size_t rs_arrow_get_rows_left_in_batch(rs_arrow_t * rs)
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return 0;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->getRowsLeftInBatch();
+    }
+
+    sf_bool rs_arrow_copy_column(rs_arrow_t * rs, size_t idx, SF_C_TYPE c_type, void * out_data,
+                                 uint8 * null_bitmap, size_t bit_offset, size_t row_count)
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_BOOLEAN_FALSE;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->copyColumn(idx, c_type, out_data, null_bitmap, bit_offset, row_count) ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+
+    sf_bool rs_arrow_copy_null_bitmap(rs_arrow_t * rs, size_t idx, uint8 * null_bitmap,
+                                      size_t row_count, size_t * null_count)
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_BOOLEAN_FALSE;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->copyNullBitmap(idx, null_bitmap, row_count, null_count) ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+
+    void rs_arrow_skip_rows(rs_arrow_t * rs, size_t row_count)
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        rs_obj->skipRows(row_count);
+    }
+
+    SF_STATUS STDCALL rs_arrow_export_next_batch(rs_arrow_t * rs, struct ArrowArray * out_array,
+                                                 struct ArrowSchema * out_schema)
+    {
+        Snowflake::Client::ResultSetArrow * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetArrow*> (rs->rs_object);
+        return rs_obj->exportNextBatch(out_array, out_schema);
+    }
+
     size_t arrow_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
     {
         size_t data_size = size * nmemb;
-        arrow::BufferBuilder * arrowBufBuilder = (arrow::BufferBuilder*)(userdata);
+        Snowflake::Client::ArrowChunkBuffer * buffer = (Snowflake::Client::ArrowChunkBuffer*)(userdata);
 
         log_debug("Curl response for arrow chunk size: %zu", data_size);
-        (void) arrowBufBuilder->Append(ptr, data_size);
-        return data_size;
+        return buffer->write(ptr, data_size);
+    }
+
+    void arrow_reset_callback(void *userdata)
+    {
+        ((Snowflake::Client::ArrowChunkBuffer*)(userdata))->reset();
+    }
+
+    sf_bool arrow_decode_callback(void *userdata)
+    {
+        return ((Snowflake::Client::ArrowChunkBuffer*)(userdata))->decode() ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+
+    void arrow_free_callback(NON_JSON_RESP *resp)
+    {
+        delete (Snowflake::Client::ArrowChunkBuffer*)(resp->buffer);
+        delete resp;
     }
 
     NON_JSON_RESP* callback_create_arrow_resp(void)
     {
         NON_JSON_RESP* arrow_resp = new NON_JSON_RESP;
-        arrow_resp->buffer = new arrow::BufferBuilder();
+        arrow_resp->buffer = new Snowflake::Client::ArrowChunkBuffer();
         arrow_resp->write_callback = arrow_write_callback;
+        arrow_resp->reset_callback = arrow_reset_callback;
+        arrow_resp->finish_callback = NULL;
+        arrow_resp->decode_callback = arrow_decode_callback;
+        arrow_resp->free_callback = arrow_free_callback;
         return arrow_resp;
     }
 
-#else  //  SF_WIN32
+    size_t arrow_stream_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        Snowflake::Client::ArrowChunkStream * stream = (Snowflake::Client::ArrowChunkStream*)(userdata);
+
+        log_debug("Curl response for streamed arrow chunk size: %zu", size * nmemb);
+        return stream->write(ptr, size * nmemb);
+    }
+
+    void arrow_stream_reset_callback(void *userdata)
+    {
+        ((Snowflake::Client::ArrowChunkStream*)(userdata))->reset();
+    }
+
+    void arrow_stream_finish_callback(void *userdata, sf_bool success)
+    {
+        ((Snowflake::Client::ArrowChunkStream*)(userdata))->finish(success == SF_BOOLEAN_TRUE);
+    }
+
+    void arrow_stream_free_callback(NON_JSON_RESP *resp)
+    {
+        delete (Snowflake::Client::ArrowChunkStream*)(resp->buffer);
+        delete resp;
+    }
+
+    NON_JSON_RESP* callback_create_arrow_stream_resp(void)
+    {
+        NON_JSON_RESP* arrow_resp = new NON_JSON_RESP;
+        arrow_resp->buffer = new Snowflake::Client::ArrowChunkStream();
+        arrow_resp->write_callback = arrow_stream_write_callback;
+        arrow_resp->reset_callback = arrow_stream_reset_callback;
+        arrow_resp->finish_callback = arrow_stream_finish_callback;
+        arrow_resp->decode_callback = NULL;
+        arrow_resp->free_callback = arrow_stream_free_callback;
+        return arrow_resp;
+    }
+
+#else  //  SF_NO_ARROW
 rs_arrow_t * rs_arrow_create_with_json_result(
     cJSON * json_rowset64,
     SF_COLUMN_DESC * metadata,
@@ -443,6 +649,28 @@ SF_STATUS STDCALL rs_arrow_get_cell_strlen(rs_arrow_t * rs, size_t idx, size_t *
     return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
 }
 
+SF_STATUS STDCALL rs_arrow_get_cell_as_binary(
+    rs_arrow_t * rs,
+    size_t idx,
+    const void ** out_data,
+    size_t * out_len
+)
+{
+    log_error("Query results were fetched using Arrow");
+    return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+}
+
+SF_STATUS STDCALL rs_arrow_get_cell_as_str_view(
+    rs_arrow_t * rs,
+    size_t idx,
+    const char ** out_data,
+    size_t * out_len
+)
+{
+    log_error("Query results were fetched using Arrow");
+    return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+}
+
 size_t rs_arrow_get_row_count_in_chunk(rs_arrow_t * rs)
 {
     log_error("Query results were fetched using Arrow");
@@ -461,6 +689,38 @@ SF_STATUS STDCALL rs_arrow_is_cell_null(rs_arrow_t * rs, size_t idx, sf_bool * o
     return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
 }
 
+size_t rs_arrow_get_rows_left_in_batch(rs_arrow_t * rs)
+{
+    log_error("Query results were fetched using Arrow");
+    return 0;
+}
+
+sf_bool rs_arrow_copy_column(rs_arrow_t * rs, size_t idx, SF_C_TYPE c_type, void * out_data,
+                             uint8 * null_bitmap, size_t bit_offset, size_t row_count)
+{
+    log_error("Query results were fetched using Arrow");
+    return SF_BOOLEAN_FALSE;
+}
+
+sf_bool rs_arrow_copy_null_bitmap(rs_arrow_t * rs, size_t idx, uint8 * null_bitmap,
+                                  size_t row_count, size_t * null_count)
+{
+    log_error("Query results were fetched using Arrow");
+    return SF_BOOLEAN_FALSE;
+}
+
+void rs_arrow_skip_rows(rs_arrow_t * rs, size_t row_count)
+{
+    log_error("Query results were fetched using Arrow");
+}
+
+SF_STATUS STDCALL rs_arrow_export_next_batch(rs_arrow_t * rs, struct ArrowArray * out_array,
+                                             struct ArrowSchema * out_schema)
+{
+    log_error("Query results were fetched using Arrow");
+    return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+}
+
 size_t arrow_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
     log_error("Query results were fetched using Arrow");
@@ -473,7 +733,13 @@ NON_JSON_RESP* callback_create_arrow_resp(void)
     return NULL;
 }
 
-#endif //  SF_WIN32
+NON_JSON_RESP* callback_create_arrow_stream_resp(void)
+{
+    log_error("Query results were fetched using Arrow");
+    return NULL;
+}
+
+#endif //  SF_NO_ARROW
 
 #ifdef __cplusplus
 } // extern "C"
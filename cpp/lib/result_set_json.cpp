@@ -6,6 +6,7 @@
 
 #include "memory.h"
 #include "result_set_json.h"
+#include "JsonArrowConverter.hpp"
 #include "ResultSetJson.hpp"
 
 
@@ -27,6 +28,20 @@ extern "C" {
         return rs_struct;
     }
 
+    rs_json_t * rs_json_create_with_chunk(
+        SF_JSON_ROWSET * chunk,
+        SF_COLUMN_DESC * metadata,
+        const char * tz_string
+    )
+    {
+        rs_json_t * rs_struct = (rs_json_t *) SF_MALLOC(sizeof(rs_json_t));
+        Snowflake::Client::ResultSetJson * rs_obj = new Snowflake::Client::ResultSetJson(
+            chunk, metadata, std::string(tz_string));
+        rs_struct->rs_object = rs_obj;
+
+        return rs_struct;
+    }
+
     void rs_json_destroy(rs_json_t * rs)
     {
         if (rs == NULL)
@@ -38,7 +53,7 @@ extern "C" {
         SF_FREE(rs);
     }
 
-    SF_STATUS STDCALL rs_json_append_chunk(rs_json_t * rs, cJSON * chunk)
+    SF_STATUS STDCALL rs_json_append_chunk(rs_json_t * rs, SF_JSON_ROWSET * chunk)
     {
         Snowflake::Client::ResultSetJson * rs_obj;
 
@@ -229,6 +244,42 @@ extern "C" {
         return rs_obj->getCellStrlen(idx, out_data);
     }
 
+    SF_STATUS STDCALL rs_json_get_cell_as_binary(
+        rs_json_t * rs,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len
+    )
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->getCellAsBinary(idx, out_data, out_len);
+    }
+
+    SF_STATUS STDCALL rs_json_get_cell_as_str_view(
+        rs_json_t * rs,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len
+    )
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->getCellAsStrView(idx, out_data, out_len);
+    }
+
     size_t rs_json_get_row_count_in_chunk(rs_json_t * rs)
     {
         Snowflake::Client::ResultSetJson * rs_obj;
@@ -255,6 +306,108 @@ extern "C" {
         return rs_obj->isCellNull(idx, out_data);
     }
 
+    size_t rs_json_get_rows_left_in_chunk(rs_json_t * rs)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return 0;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->getRowsLeftInChunk();
+    }
+
+    sf_bool rs_json_copy_column(rs_json_t * rs, size_t idx, SF_C_TYPE c_type, void * out_data,
+                                uint8 * null_bitmap, size_t bit_offset, size_t row_count)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_BOOLEAN_FALSE;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->copyColumn(idx, c_type, out_data, null_bitmap, bit_offset, row_count) ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+
+    sf_bool rs_json_copy_null_bitmap(rs_json_t * rs, size_t idx, uint8 * null_bitmap,
+                                     size_t row_count, size_t * null_count)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_BOOLEAN_FALSE;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->copyNullBitmap(idx, null_bitmap, row_count, null_count) ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+
+    void rs_json_skip_rows(rs_json_t * rs, size_t row_count)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        rs_obj->skipRows(row_count);
+    }
+
+    void rs_json_move_to_row(rs_json_t * rs, size_t row)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        rs_obj->moveToRow(row);
+    }
+
+    const SF_JSON_ROWSET * rs_json_get_chunk(rs_json_t * rs)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return NULL;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->getChunk();
+    }
+
+    SF_STATUS STDCALL rs_json_export_next_batch(rs_json_t * rs, struct ArrowArray * out_array,
+                                                struct ArrowSchema * out_schema)
+    {
+        Snowflake::Client::ResultSetJson * rs_obj;
+
+        if (rs == NULL)
+        {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+
+        rs_obj = static_cast<Snowflake::Client::ResultSetJson*> (rs->rs_object);
+        return rs_obj->exportNextBatch(out_array, out_schema);
+    }
+
+    void STDCALL rs_json_decode_arrow_chunk(SF_JSON_ROWSET * rowset, void * metadata)
+    {
+        Snowflake::Client::JsonArrowConverter::decodeChunk(
+            rowset, (const SF_COLUMN_DESC *) metadata);
+    }
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
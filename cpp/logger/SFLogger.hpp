@@ -28,95 +28,37 @@ public:
 private:
   static ISFLogger * m_externalLogger;
 
-#define CXX_LOG_FATAL(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_FATAL)) \
-    { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_FATAL, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
-    } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_FATAL, __FILE__, __VA_ARGS__); \
-    } \
-  } else { \
-    sf_log_fatal(CXX_LOG_NS, __VA_ARGS__); \
-  } \
-
-#define CXX_LOG_ERROR(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_ERROR)) \
-    { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_ERROR, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
-    } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_ERROR, __FILE__, __VA_ARGS__); \
-    } \
-  } else { \
-    sf_log_error(CXX_LOG_NS, __VA_ARGS__); \
-  } \
-
-#define CXX_LOG_WARN(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_WARN)) \
-    { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_WARN, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
-    } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_WARN, __FILE__, __VA_ARGS__); \
-    } \
-  } else { \
-    sf_log_warn(CXX_LOG_NS, __VA_ARGS__); \
-  } \
-
-#define CXX_LOG_INFO(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_INFO)) \
-    { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_INFO, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
-    } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_INFO, __FILE__, __VA_ARGS__); \
-    } \
-  } else { \
-    sf_log_info(CXX_LOG_NS, __VA_ARGS__); \
-  } \
-
-#define CXX_LOG_DEBUG(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_DEBUG)) \
-    { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_DEBUG, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
-    } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_DEBUG, __FILE__, __VA_ARGS__); \
-    } \
-  } else { \
-    sf_log_debug(CXX_LOG_NS, __VA_ARGS__); \
-  } \
-
-#define CXX_LOG_TRACE(...)  \
-  if (SFLogger::getExternalLogger() != NULL) \
-  { \
-    if ((SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) && \
-        (SFLogger::getExternalLogger()->getLogLevel() <= SF_LOG_LEVEL::SF_LOG_TRACE)) \
+/**
+ * Logs through the external logger if there is one, otherwise through log_log(). The level
+ * is checked first, so that nothing is formatted or masked for a message that isn't logged.
+ */
+#define CXX_LOG_AT(level, ...)  \
+  do { \
+    if (SFLogger::getExternalLogger() != NULL) \
     { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_TRACE, __FILE__, "%s", \
-                                             SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
+      if ((int) (level) < SF_LOG_COMPILED_LEVEL || \
+          SFLogger::getExternalLogger()->getLogLevel() > (level)) \
+      { \
+        break; \
+      } \
+      if (SFLogger::getExternalLogger()->needSecretMask() == SF_BOOLEAN_TRUE) \
+      { \
+        SFLogger::getExternalLogger()->logLine(level, __FILE__, "%s", \
+                                               SFLogger::getMaskedMsg(__VA_ARGS__).c_str()); \
+      } else { \
+        SFLogger::getExternalLogger()->logLine(level, __FILE__, __VA_ARGS__); \
+      } \
     } else { \
-      SFLogger::getExternalLogger()->logLine(SF_LOG_LEVEL::SF_LOG_TRACE, __FILE__, __VA_ARGS__); \
+      SF_LOG_AT(level, CXX_LOG_NS, __VA_ARGS__); \
     } \
-  } else { \
-    sf_log_trace(CXX_LOG_NS, __VA_ARGS__); \
-  } \
+  } while (0)
+
+#define CXX_LOG_FATAL(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_FATAL, __VA_ARGS__)
+#define CXX_LOG_ERROR(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_ERROR, __VA_ARGS__)
+#define CXX_LOG_WARN(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_WARN, __VA_ARGS__)
+#define CXX_LOG_INFO(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_INFO, __VA_ARGS__)
+#define CXX_LOG_DEBUG(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_DEBUG, __VA_ARGS__)
+#define CXX_LOG_TRACE(...) CXX_LOG_AT(SF_LOG_LEVEL::SF_LOG_TRACE, __VA_ARGS__)
 
 };
 
@@ -20,21 +20,34 @@ class SecretDetector
     static std::string maskSecrets(std::string); 
 
   private:
-    static boost::regex AWS_KEY_PATTERN;
-    static boost::regex AWS_TOKEN_PATTERN;
-    static boost::regex SAS_TOKEN_PATTERN;
-    static boost::regex PRIVATE_KEY_PATTERN;
-    static boost::regex PRIVATE_KEY_DATA_PATTERN;
-    static boost::regex CONNECTION_TOKEN_PATTERN;
-    static boost::regex PASSWORD_PATTERN;
-
-    static std::string maskAwsKeys(std::string text);
-    static std::string maskAwsTokens(std::string text);
-    static std::string maskSasTokens(std::string text);
-    static std::string maskPrivateKey(std::string text);
-    static std::string maskPrivateKeyData(std::string text);
-    static std::string maskConnectionToken(std::string text);
-    static std::string maskPassword(std::string text);
+    /**
+     * Patterns that may match a text, one bit per pattern
+     */
+    enum Pattern
+    {
+      AWS_KEY = 1 << 0,
+      AWS_TOKEN = 1 << 1,
+      SAS_TOKEN = 1 << 2,
+      PRIVATE_KEY = 1 << 3,
+      PRIVATE_KEY_DATA = 1 << 4,
+      CONNECTION_TOKEN = 1 << 5,
+      PASSWORD = 1 << 6
+    };
+
+    /**
+     * Scan the text once for the keywords the patterns start with, in any case.
+     * A pattern whose keywords are not in the text can't match it.
+     * @return the bits of the patterns that may match
+     */
+    static unsigned int findCandidates(const std::string &text);
+
+    static std::string maskAwsKeys(const std::string &text);
+    static std::string maskAwsTokens(const std::string &text);
+    static std::string maskSasTokens(const std::string &text);
+    static std::string maskPrivateKey(const std::string &text);
+    static std::string maskPrivateKeyData(const std::string &text);
+    static std::string maskConnectionToken(const std::string &text);
+    static std::string maskPassword(const std::string &text);
 };
 
 }
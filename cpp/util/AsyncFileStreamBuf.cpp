@@ -0,0 +1,792 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "AsyncFileStreamBuf.hpp"
+#include "logger/SFLogger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// io_uring is driven through its system calls, so only the kernel headers are
+// needed to build it, and a kernel without it falls back to pread and pwrite
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SF_HAS_IO_URING
+#endif
+#endif
+
+#ifdef SF_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// buffers are aligned and sized to pages
+#define ASYNC_IO_ALIGNMENT 4096
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+#ifdef SF_HAS_IO_URING
+struct IoRing
+{
+  int fd;
+  void *sq;
+  size_t sqSize;
+  void *cq;
+  size_t cqSize;
+  io_uring_sqe *sqes;
+  size_t sqesSize;
+  unsigned *sqTail;
+  unsigned *sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned *cqMask;
+  io_uring_cqe *cqes;
+  /// one per buffer, kept until the read or write completed
+  std::vector<iovec> iovecs;
+};
+#elif defined(_WIN32)
+struct IoRing
+{
+  HANDLE file;
+  /// one per buffer, kept until the read or write completed
+  std::vector<OVERLAPPED> overlapped;
+};
+#else
+struct IoRing
+{
+  int fd;
+};
+#endif
+
+}
+}
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::AsyncFileStreamBuf(size_t bufferSize,
+                                                                unsigned int depth) :
+  m_bufferSize(((std::max)(bufferSize, (size_t)1) + ASYNC_IO_ALIGNMENT - 1) /
+               ASYNC_IO_ALIGNMENT * ASYNC_IO_ALIGNMENT),
+  m_buffers((std::max)(depth, 1u)),
+  m_ring(nullptr),
+  m_fd(-1),
+  m_mode(READ),
+  m_fileSize(0),
+  m_nextOffset(0),
+  m_current(0),
+  m_error(false)
+{
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    m_buffers[i].data = nullptr;
+    m_buffers[i].offset = 0;
+    m_buffers[i].length = 0;
+    m_buffers[i].done = 0;
+    m_buffers[i].pending = false;
+  }
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::~AsyncFileStreamBuf()
+{
+  close();
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+#ifdef _WIN32
+    _aligned_free(m_buffers[i].data);
+#else
+    free(m_buffers[i].data);
+#endif
+  }
+}
+
+#ifdef _WIN32
+
+bool Snowflake::Client::Util::AsyncFileStreamBuf::open(const std::string &path,
+                                                      Mode mode)
+{
+  if (is_open())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    if (!m_buffers[i].data &&
+        !(m_buffers[i].data = (char *)_aligned_malloc(m_bufferSize, ASYNC_IO_ALIGNMENT)))
+    {
+      CXX_LOG_ERROR("Failed to allocate %d bytes of file buffers",
+                    (int)(m_bufferSize * m_buffers.size()));
+      return false;
+    }
+  }
+
+  HANDLE file = mode == READ ?
+    CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+                NULL) :
+    CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+  LARGE_INTEGER fileSize;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+  {
+    CXX_LOG_DEBUG("Could not open file %s. Error: %d", path.c_str(), (int)GetLastError());
+    if (file != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(file);
+    }
+    return false;
+  }
+
+  // one event per buffer, the reads and writes of a buffer are waited for on
+  // its own event while the others are in flight
+  IoRing *ring = new IoRing();
+  ring->file = file;
+  ring->overlapped.resize(m_buffers.size());
+  for (size_t i = 0; i < ring->overlapped.size(); i++)
+  {
+    memset(&ring->overlapped[i], 0, sizeof(OVERLAPPED));
+    ring->overlapped[i].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ring->overlapped[i].hEvent)
+    {
+      CXX_LOG_ERROR("Failed to create file I/O events. Error: %d", (int)GetLastError());
+      m_ring = ring;
+      releaseRing();
+      CloseHandle(file);
+      return false;
+    }
+  }
+  m_ring = ring;
+  // the file descriptor only tells that the file is open and closes the handle
+  m_fd = _open_osfhandle((intptr_t)file, mode == READ ? _O_RDONLY : _O_WRONLY);
+  if (m_fd < 0)
+  {
+    CXX_LOG_ERROR("Failed to open file descriptor of %s. Errno: %d", path.c_str(), errno);
+    releaseRing();
+    CloseHandle(file);
+    return false;
+  }
+  m_mode = mode;
+  m_fileSize = (long long)fileSize.QuadPart;
+  m_nextOffset = 0;
+  m_current = 0;
+  m_error = false;
+
+  if (mode == READ)
+  {
+    restartReads(0);
+  }
+  else
+  {
+    setp(m_buffers[0].data, m_buffers[0].data + m_bufferSize);
+  }
+  return true;
+}
+
+bool Snowflake::Client::Util::AsyncFileStreamBuf::close()
+{
+  if (!is_open())
+  {
+    return !m_error;
+  }
+
+  if (m_mode == WRITE)
+  {
+    sync();
+  }
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    wait(i);
+  }
+  releaseRing();
+
+  if (_close(m_fd) != 0 && m_mode == WRITE)
+  {
+    CXX_LOG_ERROR("Failed to close written file. Errno: %d", errno);
+    m_error = true;
+  }
+  m_fd = -1;
+  setg(nullptr, nullptr, nullptr);
+  setp(nullptr, nullptr);
+  return !m_error;
+}
+
+/**
+ * Start an overlapped read or write of a buffer, from where it got to
+ * @return false if it failed to start, or read past the end of the file
+ */
+static bool startOverlapped(HANDLE file, OVERLAPPED &overlapped, bool read,
+                            char *data, size_t length, long long offset)
+{
+  HANDLE event = overlapped.hEvent;
+  memset(&overlapped, 0, sizeof(OVERLAPPED));
+  overlapped.hEvent = event;
+  overlapped.Offset = (DWORD)((unsigned long long)offset & 0xFFFFFFFF);
+  overlapped.OffsetHigh = (DWORD)((unsigned long long)offset >> 32);
+  BOOL started = read ? ReadFile(file, data, (DWORD)length, NULL, &overlapped) :
+                 WriteFile(file, data, (DWORD)length, NULL, &overlapped);
+  // done at once or not, the outcome is taken from the overlapped result
+  return started || GetLastError() == ERROR_IO_PENDING;
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::submit(size_t index)
+{
+  Buffer &buffer = m_buffers[index];
+  buffer.done = 0;
+  buffer.pending = startOverlapped(m_ring->file, m_ring->overlapped[index], m_mode == READ,
+                                   buffer.data, buffer.length, buffer.offset);
+  // one that didn't start is done in place, which reports the error
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::reap(bool block)
+{
+  HANDLE events[MAXIMUM_WAIT_OBJECTS];
+  DWORD eventCount = 0;
+  bool completed = false;
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    Buffer &buffer = m_buffers[i];
+    if (!buffer.pending)
+    {
+      continue;
+    }
+    DWORD count = 0;
+    if (GetOverlappedResult(m_ring->file, &m_ring->overlapped[i], &count, FALSE))
+    {
+      buffer.done = (size_t)count;
+    }
+    else if (GetLastError() == ERROR_IO_INCOMPLETE)
+    {
+      if (eventCount < MAXIMUM_WAIT_OBJECTS)
+      {
+        events[eventCount++] = m_ring->overlapped[i].hEvent;
+      }
+      continue;
+    }
+    else
+    {
+      // a failed or short request is finished in place, which reports the error
+      buffer.done = 0;
+    }
+    buffer.pending = false;
+    completed = true;
+  }
+
+  if (block && !completed && eventCount > 0 &&
+      WaitForMultipleObjects(eventCount, events, FALSE, INFINITE) == WAIT_FAILED)
+  {
+    CXX_LOG_ERROR("Failed to wait for file %s. Error: %d",
+                  m_mode == READ ? "read" : "write", (int)GetLastError());
+    m_error = true;
+  }
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::complete(Buffer &buffer)
+{
+  OVERLAPPED &overlapped = m_ring->overlapped[(size_t)(&buffer - &m_buffers[0])];
+  while (buffer.done < buffer.length && !m_error)
+  {
+    DWORD count = 0;
+    bool started = startOverlapped(m_ring->file, overlapped, m_mode == READ,
+                                   buffer.data + buffer.done, buffer.length - buffer.done,
+                                   buffer.offset + (long long)buffer.done);
+    bool done = started && GetOverlappedResult(m_ring->file, &overlapped, &count, TRUE);
+    if (!done && m_mode == READ && GetLastError() == ERROR_HANDLE_EOF)
+    {
+      count = 0;
+    }
+    else if (!done || (count == 0 && m_mode == WRITE))
+    {
+      CXX_LOG_ERROR("Failed to %s file at offset %lld. Error: %d",
+                    m_mode == READ ? "read" : "write", buffer.offset, (int)GetLastError());
+      m_error = true;
+      break;
+    }
+    if (count == 0)
+    {
+      // the file got shorter since it was opened
+      m_fileSize = (std::min)(m_fileSize, buffer.offset + (long long)buffer.done);
+      break;
+    }
+    buffer.done += (size_t)count;
+  }
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::releaseRing()
+{
+  if (!m_ring)
+  {
+    return;
+  }
+  for (size_t i = 0; i < m_ring->overlapped.size(); i++)
+  {
+    if (m_ring->overlapped[i].hEvent)
+    {
+      CloseHandle(m_ring->overlapped[i].hEvent);
+    }
+  }
+  delete m_ring;
+  m_ring = nullptr;
+}
+
+#else
+
+bool Snowflake::Client::Util::AsyncFileStreamBuf::open(const std::string &path,
+                                                      Mode mode)
+{
+  if (is_open())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    if (!m_buffers[i].data &&
+        posix_memalign((void **)&m_buffers[i].data, ASYNC_IO_ALIGNMENT, m_bufferSize) != 0)
+    {
+      m_buffers[i].data = nullptr;
+      CXX_LOG_ERROR("Failed to allocate %d bytes of file buffers",
+                    (int)(m_bufferSize * m_buffers.size()));
+      return false;
+    }
+  }
+
+  m_fd = mode == READ ? ::open(path.c_str(), O_RDONLY | O_CLOEXEC) :
+         ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  struct stat fileStat;
+  if (m_fd < 0 || fstat(m_fd, &fileStat) != 0)
+  {
+    CXX_LOG_DEBUG("Could not open file %s. Errno: %d", path.c_str(), errno);
+    if (m_fd >= 0)
+    {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+    return false;
+  }
+  m_mode = mode;
+  m_fileSize = (long long)fileStat.st_size;
+  m_nextOffset = 0;
+  m_current = 0;
+  m_error = false;
+
+#ifdef SF_HAS_IO_URING
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ringFd = (int)syscall(__NR_io_uring_setup, (unsigned)m_buffers.size(), &params);
+  if (ringFd >= 0)
+  {
+    IoRing *ring = new IoRing();
+    ring->fd = ringFd;
+    ring->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sq = mmap(nullptr, ring->sqSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    ring->cq = mmap(nullptr, ring->cqSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    void *sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    ring->sqes = sqes == MAP_FAILED ? nullptr : (io_uring_sqe *)sqes;
+    m_ring = ring;
+    if (ring->sq == MAP_FAILED || ring->cq == MAP_FAILED || !ring->sqes)
+    {
+      CXX_LOG_WARN("Failed to map io_uring queues. Errno: %d", errno);
+      releaseRing();
+    }
+    else
+    {
+      char *sq = (char *)ring->sq;
+      char *cq = (char *)ring->cq;
+      ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+      ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+      ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+      ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+      ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+      ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+      ring->cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+      ring->iovecs.resize(m_buffers.size());
+    }
+  }
+  else
+  {
+    CXX_LOG_DEBUG("io_uring not available, reading and writing %s in place. Errno: %d",
+                  path.c_str(), errno);
+  }
+#endif
+
+  if (mode == READ)
+  {
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    restartReads(0);
+  }
+  else
+  {
+    setp(m_buffers[0].data, m_buffers[0].data + m_bufferSize);
+  }
+  return true;
+}
+
+bool Snowflake::Client::Util::AsyncFileStreamBuf::close()
+{
+  if (!is_open())
+  {
+    return !m_error;
+  }
+
+  if (m_mode == WRITE)
+  {
+    sync();
+  }
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    wait(i);
+  }
+  releaseRing();
+
+  if (::close(m_fd) != 0 && m_mode == WRITE)
+  {
+    CXX_LOG_ERROR("Failed to close written file. Errno: %d", errno);
+    m_error = true;
+  }
+  m_fd = -1;
+  setg(nullptr, nullptr, nullptr);
+  setp(nullptr, nullptr);
+  return !m_error;
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::submit(size_t index)
+{
+  Buffer &buffer = m_buffers[index];
+  buffer.done = 0;
+  buffer.pending = true;
+#ifdef SF_HAS_IO_URING
+  if (m_ring)
+  {
+    iovec &iov = m_ring->iovecs[index];
+    iov.iov_base = buffer.data;
+    iov.iov_len = buffer.length;
+
+    // no more than one request per buffer is in flight, so the queue has room
+    unsigned tail = *m_ring->sqTail;
+    unsigned slot = tail & *m_ring->sqMask;
+    io_uring_sqe *sqe = &m_ring->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = m_mode == READ ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = m_fd;
+    sqe->addr = (unsigned long long)(uintptr_t)&iov;
+    sqe->len = 1;
+    sqe->off = (unsigned long long)buffer.offset;
+    sqe->user_data = index;
+    m_ring->sqArray[slot] = slot;
+    __atomic_store_n(m_ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, m_ring->fd, 1, 0, 0, nullptr, 0) < 0)
+    {
+      if (errno == EAGAIN || errno == EBUSY)
+      {
+        // completions have to be taken before more is queued
+        reap(true);
+      }
+      else if (errno != EINTR)
+      {
+        CXX_LOG_ERROR("Failed to queue file %s. Errno: %d",
+                      m_mode == READ ? "read" : "write", errno);
+        m_error = true;
+        break;
+      }
+    }
+    return;
+  }
+#endif
+  complete(buffer);
+  buffer.pending = false;
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::reap(bool block)
+{
+#ifdef SF_HAS_IO_URING
+  if (!m_ring)
+  {
+    return;
+  }
+  if (block &&
+      syscall(__NR_io_uring_enter, m_ring->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+      errno != EINTR && errno != EAGAIN && errno != EBUSY)
+  {
+    CXX_LOG_ERROR("Failed to wait for file %s. Errno: %d",
+                  m_mode == READ ? "read" : "write", errno);
+    m_error = true;
+    return;
+  }
+
+  unsigned head = *m_ring->cqHead;
+  unsigned tail = __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++)
+  {
+    const io_uring_cqe &cqe = m_ring->cqes[head & *m_ring->cqMask];
+    Buffer &buffer = m_buffers[(size_t)cqe.user_data];
+    // a failed or short request is finished in place, which reports the error
+    buffer.done = cqe.res > 0 ? (size_t)cqe.res : 0;
+    buffer.pending = false;
+  }
+  __atomic_store_n(m_ring->cqHead, head, __ATOMIC_RELEASE);
+#endif
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::complete(Buffer &buffer)
+{
+  while (buffer.done < buffer.length && !m_error)
+  {
+    ssize_t count = m_mode == READ ?
+      pread(m_fd, buffer.data + buffer.done, buffer.length - buffer.done,
+            (off_t)(buffer.offset + buffer.done)) :
+      pwrite(m_fd, buffer.data + buffer.done, buffer.length - buffer.done,
+             (off_t)(buffer.offset + buffer.done));
+    if (count < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (count < 0 || (count == 0 && m_mode == WRITE))
+    {
+      CXX_LOG_ERROR("Failed to %s file at offset %lld. Errno: %d",
+                    m_mode == READ ? "read" : "write", buffer.offset, errno);
+      m_error = true;
+    }
+    else if (count == 0)
+    {
+      // the file got shorter since it was opened
+      m_fileSize = (std::min)(m_fileSize, buffer.offset + (long long)buffer.done);
+      break;
+    }
+    else
+    {
+      buffer.done += (size_t)count;
+    }
+  }
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::releaseRing()
+{
+#ifdef SF_HAS_IO_URING
+  if (!m_ring)
+  {
+    return;
+  }
+  if (m_ring->sq != MAP_FAILED)
+  {
+    munmap(m_ring->sq, m_ring->sqSize);
+  }
+  if (m_ring->cq != MAP_FAILED)
+  {
+    munmap(m_ring->cq, m_ring->cqSize);
+  }
+  if (m_ring->sqes)
+  {
+    munmap(m_ring->sqes, m_ring->sqesSize);
+  }
+  ::close(m_ring->fd);
+  delete m_ring;
+  m_ring = nullptr;
+#endif
+}
+
+#endif
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::wait(size_t index)
+{
+  Buffer &buffer = m_buffers[index];
+  while (buffer.pending && !m_error)
+  {
+    reap(true);
+  }
+  buffer.pending = false;
+  complete(buffer);
+}
+
+void Snowflake::Client::Util::AsyncFileStreamBuf::restartReads(long long offset)
+{
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    wait(i);
+  }
+  m_nextOffset = offset;
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    Buffer &buffer = m_buffers[i];
+    buffer.offset = m_nextOffset;
+    buffer.length = (size_t)(std::max)((std::min)((long long)m_bufferSize,
+                                              m_fileSize - m_nextOffset), 0LL);
+    m_nextOffset += buffer.length;
+    buffer.done = 0;
+    if (buffer.length > 0)
+    {
+      submit(i);
+    }
+  }
+  m_current = 0;
+  setg(nullptr, nullptr, nullptr);
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::int_type
+Snowflake::Client::Util::AsyncFileStreamBuf::underflow()
+{
+  if (gptr() < egptr())
+  {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (!is_open() || m_mode != READ || m_error)
+  {
+    return traits_type::eof();
+  }
+
+  if (eback())
+  {
+    // the buffer read through reads ahead after the others
+    Buffer &consumed = m_buffers[m_current];
+    consumed.offset = m_nextOffset;
+    consumed.length = (size_t)(std::max)((std::min)((long long)m_bufferSize,
+                                                m_fileSize - m_nextOffset), 0LL);
+    m_nextOffset += consumed.length;
+    consumed.done = 0;
+    if (consumed.length > 0)
+    {
+      submit(m_current);
+    }
+    m_current = (m_current + 1) % m_buffers.size();
+    setg(nullptr, nullptr, nullptr);
+  }
+
+  Buffer &buffer = m_buffers[m_current];
+  wait(m_current);
+  if (m_error || buffer.done == 0)
+  {
+    return traits_type::eof();
+  }
+  setg(buffer.data, buffer.data, buffer.data + buffer.done);
+  return traits_type::to_int_type(*gptr());
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::int_type
+Snowflake::Client::Util::AsyncFileStreamBuf::overflow(int_type c)
+{
+  if (!is_open() || m_mode != WRITE || !flushCurrent())
+  {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+  {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+bool Snowflake::Client::Util::AsyncFileStreamBuf::flushCurrent()
+{
+  Buffer &buffer = m_buffers[m_current];
+  buffer.length = (size_t)(pptr() - pbase());
+  if (buffer.length > 0)
+  {
+    buffer.offset = m_nextOffset;
+    m_nextOffset += buffer.length;
+    submit(m_current);
+    m_current = (m_current + 1) % m_buffers.size();
+  }
+
+  // the next buffer may still be written from
+  wait(m_current);
+  Buffer &next = m_buffers[m_current];
+  next.length = 0;
+  next.done = 0;
+  setp(next.data, next.data + m_bufferSize);
+  return !m_error;
+}
+
+int Snowflake::Client::Util::AsyncFileStreamBuf::sync()
+{
+  if (!is_open() || m_mode != WRITE)
+  {
+    return 0;
+  }
+  flushCurrent();
+  for (size_t i = 0; i < m_buffers.size(); i++)
+  {
+    wait(i);
+  }
+  return m_error ? -1 : 0;
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::pos_type
+Snowflake::Client::Util::AsyncFileStreamBuf::seekoff(off_type off,
+                                                    std::ios_base::seekdir dir,
+                                                    std::ios_base::openmode which)
+{
+  if (!is_open())
+  {
+    return pos_type(off_type(-1));
+  }
+
+  long long position;
+  if (m_mode == WRITE)
+  {
+    // the written file is only told, not seeked
+    position = m_nextOffset + (pptr() - pbase());
+    return off == 0 && dir == std::ios_base::cur ? pos_type(position) :
+           pos_type(off_type(-1));
+  }
+
+  position = eback() ? m_buffers[m_current].offset + (gptr() - eback()) :
+             m_buffers[m_current].offset;
+  if (dir == std::ios_base::cur && off == 0)
+  {
+    return pos_type(position);
+  }
+  if (dir == std::ios_base::beg)
+  {
+    position = off;
+  }
+  else if (dir == std::ios_base::cur)
+  {
+    position += off;
+  }
+  else
+  {
+    position = m_fileSize + off;
+  }
+  return seekpos(pos_type(position), which);
+}
+
+Snowflake::Client::Util::AsyncFileStreamBuf::pos_type
+Snowflake::Client::Util::AsyncFileStreamBuf::seekpos(pos_type pos,
+                                                    std::ios_base::openmode which)
+{
+  long long position = (long long)off_type(pos);
+  if (!is_open() || m_mode != READ || position < 0 || position > m_fileSize)
+  {
+    return pos_type(off_type(-1));
+  }
+  restartReads(position);
+  return pos;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_ASYNCFILESTREAMBUF_HPP
+#define SNOWFLAKECLIENT_ASYNCFILESTREAMBUF_HPP
+
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+struct IoRing;
+
+/**
+ * Stream buffer over a local file reading ahead or writing behind in a few
+ * large aligned buffers, so that the disk works while the caller encrypts and
+ * sends the data before or decrypts the data after. On Linux the reads and
+ * writes are queued to io_uring and the caller only waits when it catches up
+ * with the disk; where io_uring isn't there, as on older kernels, they are
+ * done in place with pread and pwrite, still in large blocks. On Windows
+ * they are overlapped reads and writes, each buffer waited for on its event.
+ */
+class AsyncFileStreamBuf : public std::streambuf
+{
+public:
+  enum Mode
+  {
+    READ,
+    WRITE
+  };
+
+  /**
+   * @param bufferSize bytes of each buffer, rounded up to a page
+   * @param depth number of buffers, reads or writes in flight at most
+   */
+  AsyncFileStreamBuf(size_t bufferSize, unsigned int depth);
+
+  ~AsyncFileStreamBuf();
+
+  /**
+   * Open a file to read from the start, or to write, creating or truncating
+   * it, and start reading ahead.
+   * @return false if the file couldn't be opened
+   */
+  bool open(const std::string &path, Mode mode);
+
+  /**
+   * Write what is buffered and close the file.
+   * @return false if any read or write failed
+   */
+  bool close();
+
+  bool is_open() const
+  {
+    return m_fd >= 0;
+  }
+
+  /**
+   * @return true if the reads and writes go through io_uring, or are
+   * overlapped on Windows
+   */
+  bool isAsync() const
+  {
+    return m_ring != nullptr;
+  }
+
+protected:
+  virtual int_type underflow();
+
+  virtual int_type overflow(int_type c);
+
+  virtual int sync();
+
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+private:
+  struct Buffer
+  {
+    char *data;
+    /// file offset of the first byte
+    long long offset;
+    /// bytes to read or write
+    size_t length;
+    /// bytes read or written so far
+    size_t done;
+    bool pending;
+  };
+
+  /**
+   * Queue the read or write of a buffer, or do it in place without io_uring
+   */
+  void submit(size_t index);
+
+  /**
+   * Wait until the read or write of a buffer completed and finish it in
+   * place if it came short
+   */
+  void wait(size_t index);
+
+  /**
+   * Move the completions from the ring to their buffers
+   * @param block wait for at least one completion
+   */
+  void reap(bool block);
+
+  /**
+   * Finish a read or write in place from where it got to
+   */
+  void complete(Buffer &buffer);
+
+  /**
+   * Wait for the reads in flight and read ahead from an offset
+   */
+  void restartReads(long long offset);
+
+  /**
+   * Queue the write of the buffer being filled and take the next one
+   */
+  bool flushCurrent();
+
+  void releaseRing();
+
+  const size_t m_bufferSize;
+
+  std::vector<Buffer> m_buffers;
+
+  IoRing *m_ring;
+
+  int m_fd;
+
+  Mode m_mode;
+
+  long long m_fileSize;
+
+  /// offset of the next read or write to queue
+  long long m_nextOffset;
+
+  /// buffer being read from or written to by the caller
+  size_t m_current;
+
+  bool m_error;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_ASYNCFILESTREAMBUF_HPP
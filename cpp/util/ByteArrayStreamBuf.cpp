@@ -4,13 +4,29 @@
 
 #include "snowflake/logger.h"
 #include "ByteArrayStreamBuf.hpp"
+#include "logger/SFLogger.hpp"
+#include "memory.h"
+#include <cerrno>
 #include <cstring>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 Snowflake::Client::Util::ByteArrayStreamBuf::ByteArrayStreamBuf(
   unsigned int capacity) :
   m_capacity(capacity)
 {
-  m_dataBuffer = new char[capacity];
+  // large part buffers come from the memory pool, backed by huge pages if
+  // enabled, see SF_GLOBAL_HUGE_PAGES
+  m_pooled = sf_memory_pool_class_size(capacity) > 0;
+  m_dataBuffer = m_pooled ? (char *)sf_memory_pool_alloc(capacity) : nullptr;
+  if (m_dataBuffer == nullptr)
+  {
+    m_pooled = false;
+    m_dataBuffer = new char[capacity];
+  }
   memset(m_dataBuffer, 0, capacity);
   setg(m_dataBuffer, m_dataBuffer, m_dataBuffer+capacity);
   setp(m_dataBuffer, m_dataBuffer + capacity);
@@ -18,7 +34,14 @@ Snowflake::Client::Util::ByteArrayStreamBuf::ByteArrayStreamBuf(
 
 Snowflake::Client::Util::ByteArrayStreamBuf::~ByteArrayStreamBuf()
 {
-  delete[] m_dataBuffer;
+  if (m_pooled)
+  {
+    sf_memory_pool_free(m_dataBuffer, m_capacity);
+  }
+  else
+  {
+    delete[] m_dataBuffer;
+  }
 }
 
 void * Snowflake::Client::Util::ByteArrayStreamBuf::updateSize(
@@ -30,28 +53,104 @@ void * Snowflake::Client::Util::ByteArrayStreamBuf::updateSize(
   return nullptr;
 }
 
+Snowflake::Client::Util::StreamBufferPool::StreamBufferPool(
+  unsigned int numOfBuffer,
+  size_t maxBytes) :
+  m_numOfBuffer(numOfBuffer > 0 ? numOfBuffer : 1),
+  m_maxBytes(maxBytes),
+  m_allocated(0),
+  m_allocatedBytes(0)
+{
+  _critical_section_init(&m_mutex);
+  _cond_init(&m_freeCv);
+}
+
+Snowflake::Client::Util::StreamBufferPool::~StreamBufferPool()
+{
+  for (unsigned int i=0; i<m_freeBuffers.size(); i++)
+  {
+    delete m_freeBuffers[i];
+  }
+  _cond_term(&m_freeCv);
+  _critical_section_term(&m_mutex);
+}
+
+Snowflake::Client::Util::ByteArrayStreamBuf*
+Snowflake::Client::Util::StreamBufferPool::Acquire(unsigned int size)
+{
+  ByteArrayStreamBuf * buf = nullptr;
+  _critical_section_lock(&m_mutex);
+  while (buf == nullptr)
+  {
+    for (size_t i=0; i<m_freeBuffers.size(); i++)
+    {
+      if (m_freeBuffers[i]->getCapacity() >= size)
+      {
+        buf = m_freeBuffers[i];
+        m_freeBuffers.erase(m_freeBuffers.begin() + i);
+        break;
+      }
+    }
+    if (buf != nullptr)
+    {
+      break;
+    }
+
+    // buffers are only allocated when needed, a small upload doesn't take them all
+    bool fits = (m_allocated < m_numOfBuffer) &&
+      (m_maxBytes == 0 || m_allocated == 0 || m_allocatedBytes + size <= m_maxBytes);
+    if (fits)
+    {
+      buf = new ByteArrayStreamBuf(size);
+      m_allocated ++;
+      m_allocatedBytes += size;
+    }
+    else if (!m_freeBuffers.empty())
+    {
+      // the free buffers are too small for this part, make room for a larger one
+      ByteArrayStreamBuf * small = m_freeBuffers.back();
+      m_freeBuffers.pop_back();
+      m_allocated --;
+      m_allocatedBytes -= small->getCapacity();
+      delete small;
+    }
+    else
+    {
+      _cond_wait(&m_freeCv, &m_mutex);
+    }
+  }
+  _critical_section_unlock(&m_mutex);
+  return buf;
+}
+
+void Snowflake::Client::Util::StreamBufferPool::Release(ByteArrayStreamBuf * buf)
+{
+  _critical_section_lock(&m_mutex);
+  m_freeBuffers.push_back(buf);
+  // waiters may need buffers of different sizes
+  _cond_broadcast(&m_freeCv);
+  _critical_section_unlock(&m_mutex);
+}
+
 Snowflake::Client::Util::StreamSplitter::StreamSplitter(
   std::basic_iostream<char> *inputStream,
-  unsigned int numOfBuffer,
+  StreamBufferPool *bufferPool,
   unsigned int partMaxSize) :
   m_inputStream(inputStream),
+  m_bufferPool(bufferPool),
   m_partMaxSize(partMaxSize),
   m_currentPartIndex(-1)
 {
   _critical_section_init(&streamMutex);
-  for (unsigned int i=0; i<numOfBuffer; i++)
-  {
-    buffers.push_back(new ByteArrayStreamBuf(partMaxSize));
-  }
 }
 
 Snowflake::Client::Util::ByteArrayStreamBuf*
-Snowflake::Client::Util::StreamSplitter::FillAndGetBuf(
-  int bufIndex, int &partIndex)
+Snowflake::Client::Util::StreamSplitter::FillAndGetBuf(int &partIndex)
 {
+  // wait for a buffer before taking the stream, so parts are read in order
+  // by the threads that can upload them
+  ByteArrayStreamBuf * buf = m_bufferPool->Acquire(m_partMaxSize);
   _critical_section_lock(&streamMutex);
-  ByteArrayStreamBuf * buf = buffers[bufIndex];
-  memset(buf->getDataBuffer(), 0, m_partMaxSize);
   m_inputStream->read(buf->getDataBuffer(), m_partMaxSize);
   buf->updateSize((long)m_inputStream->gcount());
   m_currentPartIndex ++;
@@ -60,13 +159,14 @@ Snowflake::Client::Util::StreamSplitter::FillAndGetBuf(
   return buf;
 }
 
+void Snowflake::Client::Util::StreamSplitter::ReleaseBuf(ByteArrayStreamBuf * buf)
+{
+  m_bufferPool->Release(buf);
+}
+
 Snowflake::Client::Util::StreamSplitter::~StreamSplitter()
 {
   _critical_section_term(&streamMutex);
-  for (unsigned int i=0; i<buffers.size(); i++)
-  {
-    delete buffers[i];
-  }
 }
 
 unsigned int Snowflake::Client::Util::StreamSplitter::getTotalParts(
@@ -82,7 +182,10 @@ Snowflake::Client::Util::StreamAppender::StreamAppender(
     m_totalPartNum(totalPartNum),
     m_parallel(parallel),
     m_partSize(partSize),
-    m_currentPartIndex(0)
+    m_currentPartIndex(0),
+    m_fd(-1),
+    m_partStride(0),
+    m_fileEnd(0)
 {
   m_buffers = new ByteArrayStreamBuf*[parallel];
   for (int i = 0; i < m_parallel; i++)
@@ -105,6 +208,57 @@ Snowflake::Client::Util::StreamAppender::~StreamAppender()
   }
 
   delete[] m_buffers;
+#ifndef _WIN32
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+  }
+#endif
+}
+
+bool Snowflake::Client::Util::StreamAppender::WriteToFile(
+  const std::string &filePath, long long partStride, long long maxFileSize)
+{
+#ifdef _WIN32
+  return false;
+#else
+  m_fd = ::open(filePath.c_str(), O_WRONLY);
+  if (m_fd < 0)
+  {
+    CXX_LOG_WARN("Could not open %s to write parts at their offsets: %s",
+                 filePath.c_str(), strerror(errno));
+    return false;
+  }
+  m_partStride = partStride;
+  if (maxFileSize > 0)
+  {
+    // the blocks are allocated once, not as every part lands past the end
+#ifdef __linux__
+    int err = posix_fallocate(m_fd, 0, (off_t)maxFileSize);
+#else
+    int err = ::ftruncate(m_fd, (off_t)maxFileSize) == 0 ? 0 : errno;
+#endif
+    if (err != 0)
+    {
+      CXX_LOG_DEBUG("Could not preallocate %lld bytes for %s: %s",
+                    maxFileSize, filePath.c_str(), strerror(err));
+    }
+  }
+  return true;
+#endif
+}
+
+bool Snowflake::Client::Util::StreamAppender::FinishFile()
+{
+#ifndef _WIN32
+  if (m_fd >= 0 && ::ftruncate(m_fd, (off_t)m_fileEnd) != 0)
+  {
+    CXX_LOG_ERROR("Failed to truncate the downloaded file: %s",
+                  strerror(errno));
+    return false;
+  }
+#endif
+  return true;
 }
 
 Snowflake::Client::Util::ByteArrayStreamBuf * Snowflake::Client::Util::
@@ -118,9 +272,43 @@ StreamAppender::GetBuffer(
   return m_buffers[threadId];
 }
 
-void Snowflake::Client::Util::StreamAppender::WritePartToOutputStream(
+bool Snowflake::Client::Util::StreamAppender::WritePartToOutputStream(
   int threadId, int partIndex)
 {
+#ifndef _WIN32
+  if (m_fd >= 0)
+  {
+    // parts don't overlap, so they are written without waiting for each other
+    const char *data = m_buffers[threadId]->getDataBuffer();
+    long size = m_buffers[threadId]->getSize();
+    off_t offset = (off_t)(partIndex * m_partStride);
+    while (size > 0)
+    {
+      ssize_t written = pwrite(m_fd, data, (size_t)size, offset);
+      if (written < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (written <= 0)
+      {
+        CXX_LOG_ERROR("Failed to write part %d: %s", partIndex,
+                      strerror(errno));
+        return false;
+      }
+      data += written;
+      size -= (long)written;
+      offset += written;
+    }
+    _critical_section_lock(&m_streamMutex);
+    if ((long long)offset > m_fileEnd)
+    {
+      m_fileEnd = (long long)offset;
+    }
+    _critical_section_unlock(&m_streamMutex);
+    return true;
+  }
+#endif
+
   _critical_section_lock(&m_streamMutex);
   while(partIndex > m_currentPartIndex)
   {
@@ -137,4 +325,5 @@ void Snowflake::Client::Util::StreamAppender::WritePartToOutputStream(
   }
   _cond_broadcast(&m_streamCv);
   _critical_section_unlock(&m_streamMutex);
+  return true;
 }
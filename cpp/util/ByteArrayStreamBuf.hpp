@@ -8,6 +8,7 @@
 #include <streambuf>
 #include <istream>
 #include <deque>
+#include <string>
 #include <vector>
 #include <snowflake/platform.h>
 
@@ -45,6 +46,14 @@ public:
     return size;
   }
 
+  /**
+   * @return number of bytes written since the last updateSize()
+   */
+  inline long getPutSize()
+  {
+    return (long)(pptr() - pbase());
+  }
+
 
 private:
   const unsigned int m_capacity;
@@ -52,24 +61,84 @@ private:
   long size;
 
   char * m_dataBuffer;
+
+  /// true if the buffer was taken from the memory pool
+  bool m_pooled;
 };
 
 /**
- * Split stream into parts. Manage in memory buffer to be reused.
+ * In memory buffers shared by the splitters of several streams, so that the
+ * memory they take together is bounded. Streams may be split in parts of
+ * different sizes.
+ */
+class StreamBufferPool
+{
+public:
+  /**
+   * @param numOfBuffer max number of buffers in use at once
+   * @param maxBytes max bytes of all the buffers, 0 for no limit. A single
+   *        buffer is always allowed, however large.
+   */
+  StreamBufferPool(unsigned int numOfBuffer, size_t maxBytes = 0);
+
+  ~StreamBufferPool();
+
+  /**
+   * Get a free buffer of at least size bytes, waiting for buffers to be
+   * released if the pool is full
+   */
+  ByteArrayStreamBuf * Acquire(unsigned int size);
+
+  /**
+   * Give a buffer back for the next part to use
+   */
+  void Release(ByteArrayStreamBuf * buf);
+
+private:
+  /// mutex protecting the buffers
+  SF_CRITICAL_SECTION_HANDLE m_mutex;
+
+  /// cv that threads wait on for a free buffer
+  SF_CONDITION_HANDLE m_freeCv;
+
+  /// max number of buffers
+  unsigned int m_numOfBuffer;
+
+  /// max bytes of the buffers
+  size_t m_maxBytes;
+
+  /// number of buffers allocated
+  unsigned int m_allocated;
+
+  /// bytes of the buffers allocated
+  size_t m_allocatedBytes;
+
+  /// buffers not in use
+  std::vector<ByteArrayStreamBuf *> m_freeBuffers;
+};
+
+/**
+ * Split stream into parts, read into buffers of a shared pool.
  */
 class StreamSplitter
 {
 public:
   StreamSplitter(std::basic_iostream<char> * inputStream,
-                 unsigned int numOfBuffer,
+                 StreamBufferPool * bufferPool,
                  unsigned int partMaxSize);
 
   ~StreamSplitter();
 
   /**
-   * Read data from input stream into in memory buffer
+   * Read the next part of the input stream into a buffer of the pool. The
+   * buffer must be given back with ReleaseBuf().
    */
-  ByteArrayStreamBuf * FillAndGetBuf(int bufIndex, int &partIndex);
+  ByteArrayStreamBuf * FillAndGetBuf(int &partIndex);
+
+  /**
+   * Give back a buffer returned by FillAndGetBuf()
+   */
+  void ReleaseBuf(ByteArrayStreamBuf * buf);
 
   /// return total parts given total input stream size
   unsigned int getTotalParts(long long int streamSize);
@@ -81,14 +150,14 @@ private:
   /// input stream to be splitted.
   std::basic_iostream<char> * m_inputStream;
 
+  /// pool of the buffers parts are read into
+  StreamBufferPool * m_bufferPool;
+
   /// part size
   unsigned int m_partMaxSize;
 
   /// current parts have been read
   int m_currentPartIndex;
-
-  /// array of in memory buffer
-  std::vector<ByteArrayStreamBuf *> buffers;
 };
 
 /**
@@ -102,11 +171,33 @@ public:
 
   ~StreamAppender();
 
+  /**
+   * Write the parts straight to a local file at their offsets, as soon as
+   * they are downloaded, rather than in order to the output stream. Not
+   * available on Windows.
+   * @param filePath file to write to, which must exist
+   * @param partStride bytes of every part but the last in the file
+   * @param maxFileSize bytes to preallocate the file with, so that parts
+   *        written past the end don't extend it piece by piece, 0 for none
+   * @return false if the file couldn't be opened, the parts then go to the
+   *         output stream
+   */
+  bool WriteToFile(const std::string &filePath, long long partStride,
+                   long long maxFileSize = 0);
+
+  /**
+   * Cut the file written to by WriteToFile() after the end of the last part,
+   * as the parts may end up shorter than the preallocated size
+   * @return false if the file couldn't be truncated
+   */
+  bool FinishFile();
+
   /**
    * Write single part into output stream. Will wait for other thread to
-   * write first so that output file is in order
+   * write first so that output file is in order, unless writing to a file
+   * @return false if the part couldn't be written to the file
    */
-  void WritePartToOutputStream(int threadId, int partIndex);
+  bool WritePartToOutputStream(int threadId, int partIndex);
 
   /**
    * Get in memory buffer to store the data downloaded before writing to
@@ -139,6 +230,15 @@ private:
 
   /// index of part that will be written to target ouput stream
   int m_currentPartIndex;
+
+  /// file the parts are written to at their offsets, -1 for none
+  int m_fd;
+
+  /// offset of a part in the file from the previous one
+  long long m_partStride;
+
+  /// end of the part written furthest into the file
+  long long m_fileEnd;
 };
 
 }
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "CompressionTuner.hpp"
+#include "logger/SFLogger.hpp"
+#include <cstdlib>
+
+// the files at a level are measured over at least this long, compressing
+// and uploading, before the level moves
+#define TUNER_MIN_WINDOW_MS 500
+
+// compressing takes this many times longer than uploading or less before
+// another level is tried
+#define TUNER_CPU_BOUND 1.5
+#define TUNER_NETWORK_BOUND 0.5
+
+Snowflake::Client::Util::CompressionTuner::CompressionTuner(
+  const std::vector<int> &levels, int initial) :
+  m_levels(levels.empty() ? std::vector<int>(1, initial) : levels),
+  m_current(0),
+  m_lightest(0),
+  m_heaviest(m_levels.size() - 1),
+  m_windowCompressMs(0),
+  m_windowTransferMs(0)
+{
+  for (size_t i = 1; i < m_levels.size(); i++)
+  {
+    if (std::abs(m_levels[i] - initial) < std::abs(m_levels[m_current] - initial))
+    {
+      m_current = i;
+    }
+  }
+}
+
+Snowflake::Client::Util::CompressionTuner *
+Snowflake::Client::Util::CompressionTuner::create(bool zstd, int initial)
+{
+  static const int GZIP_LEVELS[] = {0, 1, 3, 6, 9};
+  static const int ZSTD_LEVELS[] = {1, 3, 6, 9, 15};
+  if (zstd)
+  {
+    return new CompressionTuner(std::vector<int>(ZSTD_LEVELS, ZSTD_LEVELS + 5),
+                                initial < 0 ? 3 : initial);
+  }
+  return new CompressionTuner(std::vector<int>(GZIP_LEVELS, GZIP_LEVELS + 5),
+                              initial < 0 ? 6 : initial);
+}
+
+int Snowflake::Client::Util::CompressionTuner::getLevel()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_levels[m_current];
+}
+
+void Snowflake::Client::Util::CompressionTuner::record(int level,
+                                                       long long compressMs,
+                                                       long long transferMs)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  // the files compressed before the level moved say nothing of this one
+  if (level != m_levels[m_current] || compressMs < 0 || transferMs < 0)
+  {
+    return;
+  }
+  m_windowCompressMs += compressMs;
+  m_windowTransferMs += transferMs;
+  if (m_windowCompressMs + m_windowTransferMs < TUNER_MIN_WINDOW_MS)
+  {
+    return;
+  }
+
+  double ratio = m_windowTransferMs > 0 ?
+    (double)m_windowCompressMs / m_windowTransferMs : TUNER_CPU_BOUND * 2;
+  size_t previous = m_current;
+  // a level is left for good, so the level settles next to the one turned
+  // back from
+  if (ratio > TUNER_CPU_BOUND)
+  {
+    m_heaviest = m_current > m_lightest ? m_current - 1 : m_current;
+    m_current = m_heaviest;
+  }
+  else if (ratio < TUNER_NETWORK_BOUND)
+  {
+    m_lightest = m_current < m_heaviest ? m_current + 1 : m_current;
+    m_current = m_lightest;
+  }
+  m_windowCompressMs = 0;
+  m_windowTransferMs = 0;
+  if (m_current != previous)
+  {
+    CXX_LOG_INFO("Compressing %.2f times as long as uploading, compression level %d -> %d",
+                 ratio, m_levels[previous], m_levels[m_current]);
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_COMPRESSIONTUNER_HPP
+#define SNOWFLAKECLIENT_COMPRESSIONTUNER_HPP
+
+#include <mutex>
+#include <vector>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Picks the level the files of a PUT are compressed with from how long the
+ * files before took to compress and to upload. A level compressing much
+ * faster than its output is uploaded leaves the network as the bottleneck,
+ * and the next heavier level is tried; a level compressing much slower
+ * leaves the CPU as the bottleneck, and the next lighter one is tried. A
+ * level is not tried again once left, so the level settles where
+ * compressing a file takes about as long as uploading it.
+ */
+class CompressionTuner
+{
+public:
+  /**
+   * @param levels levels to pick from, the lightest first
+   * @param initial level to start with, the nearest of the levels is taken
+   */
+  CompressionTuner(const std::vector<int> &levels, int initial);
+
+  /**
+   * Tuner for the levels of gzip or of zstd, gzip level 0 storing the data
+   * uncompressed
+   * @param zstd true for zstd
+   * @param initial level to start with, negative for the default
+   */
+  static CompressionTuner *create(bool zstd, int initial);
+
+  /**
+   * @return level to compress the next file with
+   */
+  int getLevel();
+
+  /**
+   * Record a file compressed and uploaded, moving the level once enough
+   * files were measured at the current level.
+   * @param level level the file was compressed with
+   * @param compressMs time compressing the file
+   * @param transferMs time uploading the compressed file
+   */
+  void record(int level, long long compressMs, long long transferMs);
+
+private:
+  std::mutex m_mutex;
+
+  const std::vector<int> m_levels;
+
+  /// index of the current level
+  size_t m_current;
+
+  /// indexes of the lightest and heaviest levels still tried
+  size_t m_lightest;
+  size_t m_heaviest;
+
+  long long m_windowCompressMs;
+
+  long long m_windowTransferMs;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_COMPRESSIONTUNER_HPP
@@ -3,13 +3,41 @@
  */
 
 #include "CompressionUtil.hpp"
+#include "ThreadPool.hpp"
 #include <zlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <vector>
+
+// zstd comes with the arrow dependencies
+#if defined(_WIN32) && !defined(SF_WIN32_ARROW) && !defined(_WIN64)
+#define SF_NO_ZSTD
+#endif
+#if defined(SF_NO_ARROW) && !defined(SF_NO_ZSTD)
+#define SF_NO_ZSTD
+#endif
+#ifndef SF_NO_ZSTD
+#include <zstd.h>
+#endif
 
 #define CHUNK 16384
 #define WINDOW_BIT 15
 #define GZIP_ENCODING 16
+/* input compressed as one gzip member by compressWithGzipParallel */
+#define PARALLEL_BLOCK_SIZE (4 * 1024 * 1024)
+
+/* the members of compressWithGzipParallel carry their compressed size in a
+   subfield of the extra field of their header, as BGZF does, so that the
+   members can be inflated on several threads without scanning for them */
+#define MEMBER_SUBFIELD_ID1 'S'
+#define MEMBER_SUBFIELD_ID2 'F'
+#define MEMBER_EXTRA_LEN 8
+/* header bytes before the extra field, and before the size in it */
+#define MEMBER_EXTRA_OFFSET 12
+#define MEMBER_SIZE_OFFSET 16
+
+/* buffers of the streams decompressing downloads */
+#define DECOMPRESS_BUFFER_SIZE (128 * 1024)
 
 #ifdef _WIN32
 #  include <fcntl.h>
@@ -24,6 +52,15 @@ int Snowflake::Client::Util::CompressionUtil::compressWithGzip(FILE *source,
                                                                FILE *dest,
                                                                long &destSize,
                                                                int level)
+{
+  return compressWithGzip(source, dest, destSize, level, nullptr);
+}
+
+int Snowflake::Client::Util::CompressionUtil::compressWithGzip(FILE *source,
+                                                               FILE *dest,
+                                                               long &destSize,
+                                                               int level,
+                                                               const std::function<void(const char *, size_t)> &onOutput)
 {
   SET_BINARY_MODE(source);
   SET_BINARY_MODE(dest);
@@ -73,6 +110,10 @@ int Snowflake::Client::Util::CompressionUtil::compressWithGzip(FILE *source,
         (void) deflateEnd(&strm);
         return Z_ERRNO;
       }
+      if (onOutput && have > 0)
+      {
+        onOutput((const char *) out, have);
+      }
     } while (strm.avail_out == 0);
     assert(strm.avail_in == 0);     /* all input will be used */
 
@@ -87,6 +128,264 @@ int Snowflake::Client::Util::CompressionUtil::compressWithGzip(FILE *source,
   return Z_OK;
 }
 
+/*
+ * Compress a buffer in memory into one gzip member, with the given header
+ * if not NULL.
+ */
+static int deflateBuffer(const char *source, size_t sourceSize, std::string &dest,
+                         int level, gz_header *header)
+{
+  int ret;
+  z_stream strm;
+  unsigned char out[CHUNK];
+
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  if ((level < 0) || (level > 9))
+  {
+      level = Z_DEFAULT_COMPRESSION;
+  }
+  ret = deflateInit2(&strm, level, Z_DEFLATED,
+                     WINDOW_BIT | GZIP_ENCODING, 8, Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK)
+    return ret;
+  if (header)
+  {
+    ret = deflateSetHeader(&strm, header);
+    if (ret != Z_OK)
+    {
+      (void) deflateEnd(&strm);
+      return ret;
+    }
+  }
+
+  dest.clear();
+  size_t offset = 0;
+  int flush;
+  do
+  {
+    /* avail_in is 32 bits wide, so feed large buffers in pieces */
+    size_t piece = sourceSize - offset;
+    if (piece > CHUNK * 1024)
+    {
+      piece = CHUNK * 1024;
+    }
+    strm.next_in = (unsigned char *) (source + offset);
+    strm.avail_in = (unsigned int) piece;
+    offset += piece;
+    flush = offset >= sourceSize ? Z_FINISH : Z_NO_FLUSH;
+
+    do
+    {
+      strm.avail_out = CHUNK;
+      strm.next_out = out;
+      ret = deflate(&strm, flush);    /* no bad return value */
+      assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+      dest.append((const char *) out, CHUNK - strm.avail_out);
+    } while (strm.avail_out == 0);
+    assert(strm.avail_in == 0);     /* all input will be used */
+  } while (flush != Z_FINISH);
+  assert(ret == Z_STREAM_END);        /* stream will be complete */
+
+  (void) deflateEnd(&strm);
+  return Z_OK;
+}
+
+static unsigned long readLittleEndian32(const char *data)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  return (unsigned long)bytes[0] | ((unsigned long)bytes[1] << 8) |
+    ((unsigned long)bytes[2] << 16) | ((unsigned long)bytes[3] << 24);
+}
+
+/*
+ * Compress a block of compressWithGzipParallel into a gzip member with its
+ * compressed size in the header.
+ */
+static int compressMember(const char *source, size_t sourceSize, std::string &dest,
+                          int level)
+{
+  unsigned char extra[MEMBER_EXTRA_LEN] = {
+    MEMBER_SUBFIELD_ID1, MEMBER_SUBFIELD_ID2, 4, 0, 0, 0, 0, 0 };
+  gz_header header = {};
+  header.extra = extra;
+  header.extra_len = MEMBER_EXTRA_LEN;
+  header.os = 255;
+  int ret = deflateBuffer(source, sourceSize, dest, level, &header);
+  if (ret != Z_OK)
+  {
+    return ret;
+  }
+  size_t size = dest.size();
+  for (int i = 0; i < 4; i++)
+  {
+    dest[MEMBER_SIZE_OFFSET + i] = (char)((size >> (8 * i)) & 0xff);
+  }
+  return Z_OK;
+}
+
+/*
+ * @return bytes of the gzip member starting at data as written in its
+ * header, 0 if the header has no size or if len bytes are too few to tell,
+ * with more set to true then.
+ */
+static size_t memberSize(const char *data, size_t len, bool &more)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  more = false;
+  if (len < MEMBER_EXTRA_OFFSET)
+  {
+    more = true;
+    return 0;
+  }
+  if (bytes[0] != 0x1f || bytes[1] != 0x8b || bytes[2] != Z_DEFLATED || !(bytes[3] & 4))
+  {
+    return 0;
+  }
+  size_t extraEnd = MEMBER_EXTRA_OFFSET + (bytes[10] | (bytes[11] << 8));
+  if (len < extraEnd)
+  {
+    more = true;
+    return 0;
+  }
+  for (size_t pos = MEMBER_EXTRA_OFFSET; pos + 4 <= extraEnd;)
+  {
+    size_t subfieldLen = bytes[pos + 2] | (bytes[pos + 3] << 8);
+    if (bytes[pos] == MEMBER_SUBFIELD_ID1 && bytes[pos + 1] == MEMBER_SUBFIELD_ID2 &&
+        subfieldLen == 4 && pos + 8 <= extraEnd)
+    {
+      size_t size = (size_t)readLittleEndian32(data + pos + 4);
+      // at least the header, an empty deflate block and the trailer
+      return size >= extraEnd + 10 ? size : 0;
+    }
+    pos += 4 + subfieldLen;
+  }
+  return 0;
+}
+
+/*
+ * Inflate a whole gzip member at once, into as many bytes as its trailer
+ * gives.
+ */
+static int inflateMember(const char *data, size_t len, std::string &dest)
+{
+  size_t plainSize = (size_t)readLittleEndian32(data + len - 4);
+  if (plainSize > PARALLEL_BLOCK_SIZE)
+  {
+    // the members with their size in the header hold a block at most
+    return Z_DATA_ERROR;
+  }
+  // one more byte so that running out of output isn't taken for the end
+  dest.resize(plainSize + 1);
+
+  z_stream strm;
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.avail_in = 0;
+  strm.next_in = Z_NULL;
+  int ret = inflateInit2(&strm, WINDOW_BIT | GZIP_ENCODING);
+  if (ret != Z_OK)
+    return ret;
+  strm.next_in = (unsigned char *)data;
+  strm.avail_in = (unsigned int)len;
+  strm.next_out = (unsigned char *)&dest[0];
+  strm.avail_out = (unsigned int)dest.size();
+  ret = inflate(&strm, Z_FINISH);
+  bool complete = ret == Z_STREAM_END && strm.avail_in == 0 && strm.avail_out == 1;
+  (void)inflateEnd(&strm);
+  if (ret == Z_MEM_ERROR)
+  {
+    return ret;
+  }
+  dest.resize(plainSize);
+  return complete ? Z_OK : Z_DATA_ERROR;
+}
+
+int Snowflake::Client::Util::CompressionUtil::compressWithGzip(const char *source,
+                                                               size_t sourceSize,
+                                                               std::string &dest,
+                                                               int level)
+{
+  return deflateBuffer(source, sourceSize, dest, level, NULL);
+}
+
+int Snowflake::Client::Util::CompressionUtil::compressWithGzipParallel(FILE *source,
+                                                                       FILE *dest,
+                                                                       long &destSize,
+                                                                       int level,
+                                                                       unsigned int threads,
+                                                                       const std::function<void(const char *, size_t)> &onOutput)
+{
+  SET_BINARY_MODE(source);
+  SET_BINARY_MODE(dest);
+
+  if (threads < 2)
+  {
+    return compressWithGzip(source, dest, destSize, level, onOutput);
+  }
+
+  // one block per thread is read, compressed and written at a time
+  std::vector<std::string> blocks(threads);
+  std::vector<std::string> members(threads);
+  std::vector<int> results(threads);
+  ThreadPool pool(threads);
+  bool first = true;
+  bool eof = false;
+  destSize = 0;
+
+  while (!eof)
+  {
+    size_t count = 0;
+    for (; count < threads && !eof; count++)
+    {
+      blocks[count].resize(PARALLEL_BLOCK_SIZE);
+      size_t len = fread(&blocks[count][0], 1, PARALLEL_BLOCK_SIZE, source);
+      if (ferror(source))
+      {
+        return Z_ERRNO;
+      }
+      blocks[count].resize(len);
+      eof = len < PARALLEL_BLOCK_SIZE;
+      // an empty file still needs one member, a file of whole blocks none
+      if (len == 0 && !first)
+      {
+        break;
+      }
+      first = false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      pool.AddJob([&, i]() {
+        results[i] = compressMember(blocks[i].data(), blocks[i].size(),
+                                    members[i], level);
+      });
+    }
+    pool.WaitAll();
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (results[i] != Z_OK)
+      {
+        return results[i];
+      }
+      if (fwrite(members[i].data(), 1, members[i].size(), dest) != members[i].size() ||
+          ferror(dest))
+      {
+        return Z_ERRNO;
+      }
+      if (onOutput)
+      {
+        onOutput(members[i].data(), members[i].size());
+      }
+      destSize += (long)members[i].size();
+    }
+  }
+  return Z_OK;
+}
+
 /* Decompress from file source to file dest until stream ends or EOF.
 inf() returns Z_OK on success, Z_MEM_ERROR if memory could not be
 allocated for processing, Z_DATA_ERROR if the deflate data is
@@ -112,7 +411,7 @@ int Snowflake::Client::Util::CompressionUtil::decompressWithGzip(FILE *source,
   if (ret != Z_OK)
     return ret;
 
-  /* decompress until deflate stream ends or end of file */
+  /* decompress until the last gzip member ends or end of file */
   do {
     strm.avail_in = (unsigned int)fread(in, 1, CHUNK, source);
     if (ferror(source)) {
@@ -125,6 +424,10 @@ int Snowflake::Client::Util::CompressionUtil::decompressWithGzip(FILE *source,
 
     /* run inflate() on input until output buffer not full */
     do {
+      /* another member follows the one that ended */
+      if (ret == Z_STREAM_END && strm.avail_in > 0) {
+        (void)inflateReset(&strm);
+      }
       strm.avail_out = CHUNK;
       strm.next_out = out;
       ret = inflate(&strm, Z_NO_FLUSH);
@@ -142,12 +445,607 @@ int Snowflake::Client::Util::CompressionUtil::decompressWithGzip(FILE *source,
         (void)inflateEnd(&strm);
         return Z_ERRNO;
       }
-    } while (strm.avail_out == 0);
+    } while (strm.avail_out == 0 || (ret == Z_STREAM_END && strm.avail_in > 0));
 
-    /* done when inflate() says it's done */
-  } while (ret != Z_STREAM_END);
+    /* done when inflate() says it's done and nothing follows */
+  } while (ret != Z_STREAM_END || !feof(source));
 
   /* clean up and return */
   (void)inflateEnd(&strm);
   return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
 }
+
+namespace
+{
+  /**
+   * Output stream buf writing to a file, without a buffer of its own
+   */
+  class FileWriteStreamBuf : public std::basic_streambuf<char>
+  {
+  public:
+    explicit FileWriteStreamBuf(FILE *file) : m_file(file)
+    {
+    }
+
+  protected:
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+      return (std::streamsize)fwrite(s, 1, (size_t)n, m_file);
+    }
+
+    virtual int_type overflow(int_type ch) override
+    {
+      if (traits_type::eq_int_type(ch, traits_type::eof()))
+      {
+        return traits_type::not_eof(ch);
+      }
+      return fputc(ch, m_file) == EOF ? traits_type::eof() : ch;
+    }
+
+  private:
+    FILE *m_file;
+  };
+}
+
+int Snowflake::Client::Util::CompressionUtil::decompressWithGzipParallel(FILE *source,
+                                                                         FILE *dest,
+                                                                         unsigned int threads)
+{
+  if (threads < 2)
+  {
+    return decompressWithGzip(source, dest);
+  }
+
+  SET_BINARY_MODE(source);
+  SET_BINARY_MODE(dest);
+
+  FileWriteStreamBuf destBuf(dest);
+  DecompressStreamBuf decompressBuf(&destBuf, false, threads);
+  std::vector<char> in(DECOMPRESS_BUFFER_SIZE);
+  size_t len;
+  while ((len = fread(in.data(), 1, in.size(), source)) > 0)
+  {
+    if (decompressBuf.sputn(in.data(), (std::streamsize)len) != (std::streamsize)len)
+    {
+      break;
+    }
+  }
+  if (ferror(source))
+  {
+    return Z_ERRNO;
+  }
+  int ret = decompressBuf.finish();
+  return ret == Z_OK && ferror(dest) ? Z_ERRNO : ret;
+}
+
+bool Snowflake::Client::Util::CompressionUtil::isZstdSupported()
+{
+#ifndef SF_NO_ZSTD
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifndef SF_NO_ZSTD
+
+int Snowflake::Client::Util::CompressionUtil::compressWithZstd(FILE *source,
+                                                               FILE *dest,
+                                                               long &destSize,
+                                                               int level,
+                                                               unsigned int threads,
+                                                               const std::function<void(const char *, size_t)> &onOutput)
+{
+  SET_BINARY_MODE(source);
+  SET_BINARY_MODE(dest);
+
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  if (!cctx)
+  {
+    return Z_MEM_ERROR;
+  }
+  if (level < 0 || level > ZSTD_maxCLevel())
+  {
+    level = ZSTD_CLEVEL_DEFAULT;
+  }
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+  // fails when zstd is built without multithreading, which isn't an error
+  if (threads > 1)
+  {
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int)threads);
+  }
+
+  std::vector<char> in(ZSTD_CStreamInSize());
+  std::vector<char> out(ZSTD_CStreamOutSize());
+  int ret = Z_OK;
+  bool last;
+  destSize = 0;
+
+  do
+  {
+    size_t len = fread(in.data(), 1, in.size(), source);
+    if (ferror(source))
+    {
+      ret = Z_ERRNO;
+      break;
+    }
+    last = len < in.size();
+    ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+    ZSTD_inBuffer input = { in.data(), len, 0 };
+
+    /* compress until all input is used, or the frame is complete */
+    bool done;
+    do
+    {
+      ZSTD_outBuffer output = { out.data(), out.size(), 0 };
+      size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+      if (ZSTD_isError(remaining))
+      {
+        ret = Z_STREAM_ERROR;
+        break;
+      }
+      if (fwrite(out.data(), 1, output.pos, dest) != output.pos || ferror(dest))
+      {
+        ret = Z_ERRNO;
+        break;
+      }
+      if (onOutput && output.pos > 0)
+      {
+        onOutput(out.data(), output.pos);
+      }
+      destSize += (long)output.pos;
+      done = last ? remaining == 0 : input.pos == input.size;
+    } while (!done);
+  } while (ret == Z_OK && !last);
+
+  ZSTD_freeCCtx(cctx);
+  return ret;
+}
+
+int Snowflake::Client::Util::CompressionUtil::decompressWithZstd(FILE *source,
+                                                                 FILE *dest)
+{
+  SET_BINARY_MODE(source);
+  SET_BINARY_MODE(dest);
+
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  if (!dctx)
+  {
+    return Z_MEM_ERROR;
+  }
+
+  std::vector<char> in(ZSTD_DStreamInSize());
+  std::vector<char> out(ZSTD_DStreamOutSize());
+  int ret = Z_OK;
+  // stays non-zero while a frame is incomplete
+  size_t pending = 0;
+  size_t len;
+
+  while (ret == Z_OK && (len = fread(in.data(), 1, in.size(), source)) > 0)
+  {
+    ZSTD_inBuffer input = { in.data(), len, 0 };
+    while (input.pos < input.size)
+    {
+      ZSTD_outBuffer output = { out.data(), out.size(), 0 };
+      pending = ZSTD_decompressStream(dctx, &output, &input);
+      if (ZSTD_isError(pending))
+      {
+        ret = Z_DATA_ERROR;
+        break;
+      }
+      if (fwrite(out.data(), 1, output.pos, dest) != output.pos || ferror(dest))
+      {
+        ret = Z_ERRNO;
+        break;
+      }
+    }
+  }
+  if (ret == Z_OK && ferror(source))
+  {
+    ret = Z_ERRNO;
+  }
+  if (ret == Z_OK && pending != 0)
+  {
+    ret = Z_DATA_ERROR;
+  }
+
+  ZSTD_freeDCtx(dctx);
+  return ret;
+}
+
+#else
+
+int Snowflake::Client::Util::CompressionUtil::compressWithZstd(FILE *source,
+                                                               FILE *dest,
+                                                               long &destSize,
+                                                               int level,
+                                                               unsigned int threads,
+                                                               const std::function<void(const char *, size_t)> &onOutput)
+{
+  return Z_VERSION_ERROR;
+}
+
+int Snowflake::Client::Util::CompressionUtil::decompressWithZstd(FILE *source,
+                                                                 FILE *dest)
+{
+  return Z_VERSION_ERROR;
+}
+
+#endif
+
+Snowflake::Client::Util::DecompressStreamBuf::DecompressStreamBuf(
+  std::basic_streambuf<char> *dest, bool zstd, unsigned int threads) :
+  m_dest(dest),
+  m_zstd(zstd),
+  m_zstream(nullptr),
+  m_zstdCtx(nullptr),
+  m_inBuffer(DECOMPRESS_BUFFER_SIZE),
+  m_outBuffer(DECOMPRESS_BUFFER_SIZE),
+  m_ret(Z_OK),
+  m_ended(false),
+  m_threads(zstd || threads < 2 ? 1 : threads),
+  m_pool(nullptr),
+  m_membersLen(0)
+{
+  if (m_zstd)
+  {
+#ifndef SF_NO_ZSTD
+    m_zstdCtx = ZSTD_createDCtx();
+    m_ret = m_zstdCtx ? Z_OK : Z_MEM_ERROR;
+    m_outBuffer.resize(ZSTD_DStreamOutSize());
+#else
+    m_ret = Z_VERSION_ERROR;
+#endif
+  }
+  else
+  {
+    m_zstream = new z_stream();
+    m_zstream->zalloc = Z_NULL;
+    m_zstream->zfree = Z_NULL;
+    m_zstream->opaque = Z_NULL;
+    m_zstream->avail_in = 0;
+    m_zstream->next_in = Z_NULL;
+    m_ret = inflateInit2(m_zstream, WINDOW_BIT | 32);
+    if (m_ret != Z_OK)
+    {
+      delete m_zstream;
+      m_zstream = nullptr;
+    }
+  }
+  setp(m_inBuffer.data(), m_inBuffer.data() + m_inBuffer.size());
+}
+
+Snowflake::Client::Util::DecompressStreamBuf::~DecompressStreamBuf()
+{
+  delete m_pool;
+  if (m_zstream)
+  {
+    (void)inflateEnd(m_zstream);
+    delete m_zstream;
+  }
+#ifndef SF_NO_ZSTD
+  if (m_zstdCtx)
+  {
+    ZSTD_freeDCtx(m_zstdCtx);
+  }
+#endif
+}
+
+void Snowflake::Client::Util::DecompressStreamBuf::decompress(const char *data,
+                                                              size_t len)
+{
+  if (m_ret != Z_OK || len == 0)
+  {
+    return;
+  }
+
+  if (m_zstream && m_threads > 1)
+  {
+    decompressMembers(data, len);
+  }
+  else if (m_zstream)
+  {
+    m_zstream->next_in = (unsigned char *)data;
+    m_zstream->avail_in = (unsigned int)len;
+    do
+    {
+      /* another member follows the one that ended */
+      if (m_ended && m_zstream->avail_in > 0)
+      {
+        (void)inflateReset(m_zstream);
+        m_ended = false;
+      }
+      m_zstream->next_out = (unsigned char *)m_outBuffer.data();
+      m_zstream->avail_out = (unsigned int)m_outBuffer.size();
+      int ret = inflate(m_zstream, Z_NO_FLUSH);
+      if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+      {
+        m_ret = ret == Z_NEED_DICT ? Z_DATA_ERROR : ret;
+        return;
+      }
+      m_ended = ret == Z_STREAM_END;
+      std::streamsize have = (std::streamsize)(m_outBuffer.size() - m_zstream->avail_out);
+      if (m_dest->sputn(m_outBuffer.data(), have) != have)
+      {
+        m_ret = Z_ERRNO;
+        return;
+      }
+    } while (m_zstream->avail_in > 0 || m_zstream->avail_out == 0);
+  }
+#ifndef SF_NO_ZSTD
+  else if (m_zstdCtx)
+  {
+    ZSTD_inBuffer input = { data, len, 0 };
+    ZSTD_outBuffer output;
+    do
+    {
+      output = { m_outBuffer.data(), m_outBuffer.size(), 0 };
+      size_t pending = ZSTD_decompressStream(m_zstdCtx, &output, &input);
+      if (ZSTD_isError(pending))
+      {
+        m_ret = Z_DATA_ERROR;
+        return;
+      }
+      m_ended = pending == 0;
+      if (m_dest->sputn(m_outBuffer.data(), (std::streamsize)output.pos) !=
+          (std::streamsize)output.pos)
+      {
+        m_ret = Z_ERRNO;
+        return;
+      }
+    } while (input.pos < input.size || output.pos == output.size);
+  }
+#endif
+}
+
+void Snowflake::Client::Util::DecompressStreamBuf::decompressMembers(const char *data,
+                                                                     size_t len)
+{
+  m_members.append(data, len);
+  while (m_ret == Z_OK)
+  {
+    bool more = false;
+    size_t size = memberSize(m_members.data() + m_membersLen,
+                             m_members.size() - m_membersLen, more);
+    if (size == 0 && more)
+    {
+      return;
+    }
+    if (size == 0)
+    {
+      // not compressed by compressWithGzipParallel, the rest is inflated
+      // as it comes
+      inflateMembers();
+      m_threads = 1;
+      std::string rest;
+      rest.swap(m_members);
+      decompress(rest.data(), rest.size());
+      return;
+    }
+    if (m_members.size() - m_membersLen < size)
+    {
+      return;
+    }
+    m_memberSizes.push_back(size);
+    m_membersLen += size;
+    if (m_memberSizes.size() >= m_threads)
+    {
+      inflateMembers();
+    }
+  }
+}
+
+void Snowflake::Client::Util::DecompressStreamBuf::inflateMembers()
+{
+  size_t count = m_memberSizes.size();
+  if (m_ret != Z_OK || count == 0)
+  {
+    return;
+  }
+
+  std::vector<std::string> plain(count);
+  std::vector<int> results(count, Z_OK);
+  if (count == 1)
+  {
+    results[0] = inflateMember(m_members.data(), m_memberSizes[0], plain[0]);
+  }
+  else
+  {
+    if (!m_pool)
+    {
+      m_pool = new ThreadPool(m_threads);
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      const char *member = m_members.data() + offset;
+      size_t size = m_memberSizes[i];
+      m_pool->AddJob([&plain, &results, member, size, i]() {
+        results[i] = inflateMember(member, size, plain[i]);
+      });
+      offset += size;
+    }
+    m_pool->WaitAll();
+  }
+
+  for (size_t i = 0; i < count && m_ret == Z_OK; i++)
+  {
+    std::streamsize have = (std::streamsize)plain[i].size();
+    if (results[i] != Z_OK)
+    {
+      m_ret = results[i];
+    }
+    else if (m_dest->sputn(plain[i].data(), have) != have)
+    {
+      m_ret = Z_ERRNO;
+    }
+  }
+  m_members.erase(0, m_membersLen);
+  m_memberSizes.clear();
+  m_membersLen = 0;
+  m_ended = m_members.empty();
+}
+
+Snowflake::Client::Util::DecompressStreamBuf::int_type
+Snowflake::Client::Util::DecompressStreamBuf::overflow(int_type ch)
+{
+  decompress(pbase(), (size_t)(pptr() - pbase()));
+  setp(m_inBuffer.data(), m_inBuffer.data() + m_inBuffer.size());
+  if (m_ret != Z_OK)
+  {
+    return traits_type::eof();
+  }
+  if (!traits_type::eq_int_type(ch, traits_type::eof()))
+  {
+    sputc(traits_type::to_char_type(ch));
+  }
+  return traits_type::not_eof(ch);
+}
+
+int Snowflake::Client::Util::DecompressStreamBuf::sync()
+{
+  overflow(traits_type::eof());
+  m_dest->pubsync();
+  return m_ret == Z_OK ? 0 : -1;
+}
+
+int Snowflake::Client::Util::DecompressStreamBuf::finish()
+{
+  overflow(traits_type::eof());
+  if (m_threads > 1)
+  {
+    inflateMembers();
+  }
+  sync();
+  if (m_ret == Z_OK && !m_ended)
+  {
+    m_ret = Z_DATA_ERROR;
+  }
+  return m_ret;
+}
+
+Snowflake::Client::Util::CompressStreamBuf::CompressStreamBuf(
+  std::basic_streambuf<char> *source, bool zstd, int level) :
+  m_source(source),
+  m_zstd(zstd),
+  m_zstream(nullptr),
+  m_zstdCtx(nullptr),
+  m_inBuffer(DECOMPRESS_BUFFER_SIZE),
+  m_inPos(0),
+  m_inLen(0),
+  m_outBuffer(DECOMPRESS_BUFFER_SIZE),
+  m_sourceEnded(false),
+  m_finished(false),
+  m_ret(Z_OK)
+{
+  if (m_zstd)
+  {
+#ifndef SF_NO_ZSTD
+    m_zstdCtx = ZSTD_createCCtx();
+    m_ret = m_zstdCtx ? Z_OK : Z_MEM_ERROR;
+    if (m_zstdCtx)
+    {
+      // same parameters as compressWithZstd on one thread
+      if (level < 0 || level > ZSTD_maxCLevel())
+      {
+        level = ZSTD_CLEVEL_DEFAULT;
+      }
+      ZSTD_CCtx_setParameter(m_zstdCtx, ZSTD_c_compressionLevel, level);
+      ZSTD_CCtx_setParameter(m_zstdCtx, ZSTD_c_checksumFlag, 1);
+      m_inBuffer.resize(ZSTD_CStreamInSize());
+      m_outBuffer.resize(ZSTD_CStreamOutSize());
+    }
+#else
+    m_ret = Z_VERSION_ERROR;
+#endif
+  }
+  else
+  {
+    if ((level < 0) || (level > 9))
+    {
+      level = Z_DEFAULT_COMPRESSION;
+    }
+    m_zstream = new z_stream();
+    m_zstream->zalloc = Z_NULL;
+    m_zstream->zfree = Z_NULL;
+    m_zstream->opaque = Z_NULL;
+    m_ret = deflateInit2(m_zstream, level, Z_DEFLATED,
+                         WINDOW_BIT | GZIP_ENCODING, 8, Z_DEFAULT_STRATEGY);
+    if (m_ret != Z_OK)
+    {
+      delete m_zstream;
+      m_zstream = nullptr;
+    }
+  }
+  setg(m_outBuffer.data(), m_outBuffer.data(), m_outBuffer.data());
+}
+
+Snowflake::Client::Util::CompressStreamBuf::~CompressStreamBuf()
+{
+  if (m_zstream)
+  {
+    (void)deflateEnd(m_zstream);
+    delete m_zstream;
+  }
+#ifndef SF_NO_ZSTD
+  if (m_zstdCtx)
+  {
+    ZSTD_freeCCtx(m_zstdCtx);
+  }
+#endif
+}
+
+Snowflake::Client::Util::CompressStreamBuf::int_type
+Snowflake::Client::Util::CompressStreamBuf::underflow()
+{
+  size_t have = 0;
+  // the compressor may keep a whole block before it gives out any of it
+  while (have == 0 && !m_finished && m_ret == Z_OK)
+  {
+    if (m_inPos == m_inLen && !m_sourceEnded)
+    {
+      m_inLen = (size_t)m_source->sgetn(m_inBuffer.data(), (std::streamsize)m_inBuffer.size());
+      m_inPos = 0;
+      m_sourceEnded = m_inLen == 0;
+    }
+    bool last = m_sourceEnded && m_inPos == m_inLen;
+
+    if (m_zstd)
+    {
+#ifndef SF_NO_ZSTD
+      ZSTD_inBuffer input = { m_inBuffer.data(), m_inLen, m_inPos };
+      ZSTD_outBuffer output = { m_outBuffer.data(), m_outBuffer.size(), 0 };
+      size_t remaining = ZSTD_compressStream2(m_zstdCtx, &output, &input,
+                                              last ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining))
+      {
+        m_ret = Z_STREAM_ERROR;
+        break;
+      }
+      m_inPos = input.pos;
+      have = output.pos;
+      m_finished = last && remaining == 0;
+#endif
+    }
+    else
+    {
+      m_zstream->next_in = (Bytef *)m_inBuffer.data() + m_inPos;
+      m_zstream->avail_in = (uInt)(m_inLen - m_inPos);
+      m_zstream->next_out = (Bytef *)m_outBuffer.data();
+      m_zstream->avail_out = (uInt)m_outBuffer.size();
+      int ret = deflate(m_zstream, last ? Z_FINISH : Z_NO_FLUSH);
+      if (ret == Z_STREAM_ERROR)
+      {
+        m_ret = ret;
+        break;
+      }
+      m_inPos = m_inLen - m_zstream->avail_in;
+      have = m_outBuffer.size() - m_zstream->avail_out;
+      m_finished = ret == Z_STREAM_END;
+    }
+  }
+
+  setg(m_outBuffer.data(), m_outBuffer.data(), m_outBuffer.data() + have);
+  return have > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
@@ -6,6 +6,14 @@
 #define SNOWFLAKECLIENT_COMPRESSIONUTIL_HPP
 
 #include <stdio.h>
+#include <string>
+#include <functional>
+#include <streambuf>
+#include <vector>
+
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CCtx_s;
 
 namespace Snowflake
 {
@@ -14,6 +22,8 @@ namespace Client
 namespace Util
 {
 
+class ThreadPool;
+
 class CompressionUtil
 {
 public:
@@ -28,13 +38,228 @@ public:
   static int compressWithGzip(FILE *source, FILE *dest, long &destSize, int level = -1);
 
   /**
-   * Compress file with gzip
+   * Compress file with gzip, passing the compressed data to a callback as
+   * it is written, e.g. to hash it in the same pass
+   * @param source source file to compress
+   * @param dest destination file that compress result will write to
+   * @param destSize file size of compression result
+   * @param level compression level
+   * @param onOutput called with each piece of compressed data written
+   * @return
+   */
+  static int compressWithGzip(FILE *source, FILE *dest, long &destSize, int level,
+                              const std::function<void(const char *, size_t)> &onOutput);
+
+  /**
+   * Compress file with gzip on several threads. The file is split in blocks
+   * that are compressed independently and written as consecutive gzip
+   * members, which decompress to the whole file like a single member does.
    * @param source source file to compress
    * @param dest destination file that compress result will write to
    * @param destSize file size of compression result
+   * @param level compression level
+   * @param threads number of threads compressing blocks
+   * @param onOutput called with each piece of compressed data written
+   * @return
+   */
+  static int compressWithGzipParallel(FILE *source, FILE *dest, long &destSize,
+                                      int level, unsigned int threads,
+                                      const std::function<void(const char *, size_t)> &onOutput);
+
+  /**
+   * Compress a buffer in memory with gzip
+   * @param source data to compress
+   * @param sourceSize size of the data
+   * @param dest string that compress result will be written to
+   * @param level compression level
+   * @return
+   */
+  static int compressWithGzip(const char *source, size_t sourceSize, std::string &dest,
+                              int level = -1);
+
+  /**
+   * Decompress gzip file, including one made of several gzip members
+   * @param source source file to decompress
+   * @param dest destination file that decompress result will write to
    * @return
    */
   static int decompressWithGzip(FILE *source, FILE *dest);
+
+  /**
+   * Decompress gzip file, inflating the members compressed by
+   * compressWithGzipParallel on several threads. A file of members without
+   * their size in the header, e.g. of a single member, is decompressed on
+   * the calling thread from the first such member on.
+   * @param source source file to decompress
+   * @param dest destination file that decompress result will write to
+   * @param threads number of threads inflating members
+   * @return
+   */
+  static int decompressWithGzipParallel(FILE *source, FILE *dest, unsigned int threads);
+
+  /**
+   * @return true if the library is built with zstd
+   */
+  static bool isZstdSupported();
+
+  /**
+   * Compress file with zstd, passing the compressed data to a callback as
+   * it is written
+   * @param source source file to compress
+   * @param dest destination file that compress result will write to
+   * @param destSize file size of compression result
+   * @param level compression level, negative for the default level
+   * @param threads number of threads compressing the file, if zstd is built
+   *        with multithreading support
+   * @param onOutput called with each piece of compressed data written
+   * @return
+   */
+  static int compressWithZstd(FILE *source, FILE *dest, long &destSize,
+                              int level, unsigned int threads,
+                              const std::function<void(const char *, size_t)> &onOutput);
+
+  /**
+   * Decompress zstd file
+   * @param source source file to decompress
+   * @param dest destination file that decompress result will write to
+   * @return
+   */
+  static int decompressWithZstd(FILE *source, FILE *dest);
+};
+
+/**
+ * Output stream buf decompressing the gzip or zstd data written to it into
+ * another stream buf, for downloads that don't go through a file.
+ */
+class DecompressStreamBuf : public std::basic_streambuf<char>
+{
+public:
+  /**
+   * @param dest stream buf the decompressed data is written to (NOT OWN)
+   * @param zstd true for zstd data, false for gzip data
+   * @param threads number of threads inflating the gzip members compressed
+   *        by CompressionUtil::compressWithGzipParallel, 1 to inflate all
+   *        the data as it is written
+   */
+  DecompressStreamBuf(std::basic_streambuf<char> *dest, bool zstd,
+                      unsigned int threads = 1);
+
+  ~DecompressStreamBuf();
+
+  /**
+   * Decompress the data still buffered, once all the data is written.
+   * @return Z_OK if the compressed data is complete, zlib error code
+   *         otherwise
+   */
+  int finish();
+
+protected:
+  virtual int_type overflow(int_type ch) override;
+
+  virtual int sync() override;
+
+private:
+  void decompress(const char *data, size_t len);
+
+  /**
+   * Keep the data until members make up a batch, then inflate the batch
+   */
+  void decompressMembers(const char *data, size_t len);
+
+  /**
+   * Inflate the whole members kept, one per thread, and write them in order
+   */
+  void inflateMembers();
+
+  std::basic_streambuf<char> *m_dest;
+
+  bool m_zstd;
+
+  z_stream_s *m_zstream;
+
+  ZSTD_DCtx_s *m_zstdCtx;
+
+  std::vector<char> m_inBuffer;
+
+  std::vector<char> m_outBuffer;
+
+  /// first error met, Z_OK if none
+  int m_ret;
+
+  /// true when the data written so far ends at the end of a gzip member or
+  /// zstd frame
+  bool m_ended;
+
+  /// threads inflating the members, 1 once a member without its size is met
+  unsigned int m_threads;
+
+  ThreadPool *m_pool;
+
+  /// data written not inflated yet, whole members first
+  std::string m_members;
+
+  /// sizes of the whole members at the start of m_members
+  std::vector<size_t> m_memberSizes;
+
+  /// bytes of the whole members at the start of m_members
+  size_t m_membersLen;
+};
+
+/**
+ * Input stream buf compressing the data read from another stream buf with
+ * gzip or zstd as it is read, for uploads of data in memory that don't go
+ * through a file. The same data and level always give the same bytes, so
+ * the data can be compressed again for another pass over it.
+ */
+class CompressStreamBuf : public std::basic_streambuf<char>
+{
+public:
+  /**
+   * @param source stream buf the data to compress is read from (NOT OWN)
+   * @param zstd true to compress with zstd, false with gzip
+   * @param level compression level, negative for the default level
+   */
+  CompressStreamBuf(std::basic_streambuf<char> *source, bool zstd, int level);
+
+  ~CompressStreamBuf();
+
+  /**
+   * @return Z_OK, or the zlib error code that ended the compressed data
+   */
+  int getError()
+  {
+    return m_ret;
+  }
+
+protected:
+  virtual int_type underflow() override;
+
+private:
+  std::basic_streambuf<char> *m_source;
+
+  bool m_zstd;
+
+  z_stream_s *m_zstream;
+
+  ZSTD_CCtx_s *m_zstdCtx;
+
+  std::vector<char> m_inBuffer;
+
+  /// data read from the source not compressed yet
+  size_t m_inPos;
+
+  size_t m_inLen;
+
+  std::vector<char> m_outBuffer;
+
+  /// true once all the source is read
+  bool m_sourceEnded;
+
+  /// true once the end of the compressed data is written
+  bool m_finished;
+
+  /// first error met, Z_OK if none
+  int m_ret;
 };
 
 }
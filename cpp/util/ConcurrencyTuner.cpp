@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "ConcurrencyTuner.hpp"
+#include "logger/SFLogger.hpp"
+#include <algorithm>
+
+// the throughput is measured over at least this long, and over at least as
+// many transfers as allowed at once
+#define TUNER_MIN_WINDOW_MS 1000
+
+// relative change of the throughput taken as better or worse
+#define TUNER_THROUGHPUT_CHANGE 0.05
+
+Snowflake::Client::Util::ConcurrencyTuner::ConcurrencyTuner(unsigned int initial,
+                                                            unsigned int maxConcurrency) :
+  m_maxConcurrency(std::max(maxConcurrency, 1u)),
+  m_limit(std::min(std::max(initial, 1u), std::max(maxConcurrency, 1u))),
+  m_running(0),
+  m_direction(1),
+  m_step(1),
+  m_lastBytesPerSec(0),
+  m_windowStart(std::chrono::steady_clock::now()),
+  m_windowBytes(0),
+  m_windowTransfers(0),
+  m_throttledRequests(0)
+{
+}
+
+void Snowflake::Client::Util::ConcurrencyTuner::acquire()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_slotAvailable.wait(lock, [this]() { return m_running < m_limit; });
+  m_running++;
+}
+
+void Snowflake::Client::Util::ConcurrencyTuner::release(long long bytes,
+                                                        unsigned long long throttledRequests)
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_running--;
+  m_windowBytes += bytes;
+  m_windowTransfers++;
+
+  // throttling is answered at once, the throughput only over a full window
+  bool throttled = throttledRequests > m_throttledRequests;
+  m_throttledRequests = std::max(m_throttledRequests, throttledRequests);
+  auto now = std::chrono::steady_clock::now();
+  long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+    now - m_windowStart).count();
+  if (throttled ||
+      (elapsedMs >= TUNER_MIN_WINDOW_MS && m_windowTransfers >= m_limit))
+  {
+    adjust(elapsedMs / 1000.0, throttled);
+    m_windowStart = now;
+    m_windowBytes = 0;
+    m_windowTransfers = 0;
+  }
+  m_slotAvailable.notify_all();
+}
+
+unsigned int Snowflake::Client::Util::ConcurrencyTuner::getLimit()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_limit;
+}
+
+void Snowflake::Client::Util::ConcurrencyTuner::adjust(double elapsedSec, bool throttled)
+{
+  unsigned int previous = m_limit;
+  if (throttled)
+  {
+    // the next window measures the lower limit before climbing again
+    m_limit = std::max(m_limit / 2, 1u);
+    m_direction = 1;
+    m_step = 1;
+    m_lastBytesPerSec = 0;
+    CXX_LOG_INFO("Transfers throttled by the storage, concurrency %u -> %u",
+                 previous, m_limit);
+    return;
+  }
+
+  double bytesPerSec = elapsedSec > 0 ? m_windowBytes / elapsedSec : 0;
+  if (m_lastBytesPerSec == 0 ||
+      bytesPerSec > m_lastBytesPerSec * (1 + TUNER_THROUGHPUT_CHANGE))
+  {
+    // keep going the way that helped, faster each time
+    if (m_lastBytesPerSec > 0)
+    {
+      m_step = std::min(m_step * 2, m_maxConcurrency);
+    }
+  }
+  else if (bytesPerSec < m_lastBytesPerSec * (1 - TUNER_THROUGHPUT_CHANGE))
+  {
+    m_direction = -m_direction;
+    m_step = 1;
+  }
+  else
+  {
+    // no better and no worse, stay
+    m_step = 1;
+    m_lastBytesPerSec = bytesPerSec;
+    return;
+  }
+  m_lastBytesPerSec = bytesPerSec;
+
+  if (m_direction > 0)
+  {
+    m_limit = std::min(m_limit + m_step, m_maxConcurrency);
+  }
+  else
+  {
+    m_limit = m_limit > m_step ? m_limit - m_step : 1;
+  }
+  if (m_limit != previous)
+  {
+    CXX_LOG_DEBUG("Transfer throughput %.0f bytes/sec, concurrency %u -> %u",
+                  bytesPerSec, previous, m_limit);
+  }
+}
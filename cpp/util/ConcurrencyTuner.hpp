@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_CONCURRENCYTUNER_HPP
+#define SNOWFLAKECLIENT_CONCURRENCYTUNER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Limits the number of transfers running at once, moving the limit to where
+ * the throughput of all the transfers together is the highest. The limit
+ * climbs while the throughput improves, in larger steps while it keeps
+ * improving, turns back when the throughput drops and is halved when the
+ * storage throttles the requests.
+ */
+class ConcurrencyTuner
+{
+public:
+  /**
+   * @param initial number of transfers allowed at first
+   * @param maxConcurrency number of transfers allowed at most
+   */
+  ConcurrencyTuner(unsigned int initial, unsigned int maxConcurrency);
+
+  /**
+   * Wait until another transfer is allowed to start
+   */
+  void acquire();
+
+  /**
+   * Record a transfer done, adjusting the limit once enough transfers were
+   * measured since the last adjustment.
+   * @param bytes bytes transferred
+   * @param throttledRequests requests throttled by the storage so far, as
+   *        counted by the storage client
+   */
+  void release(long long bytes, unsigned long long throttledRequests);
+
+  /**
+   * @return number of transfers currently allowed at once
+   */
+  unsigned int getLimit();
+
+private:
+  /**
+   * Move the limit after a window of transfers, called with the mutex locked
+   */
+  void adjust(double elapsedSec, bool throttled);
+
+  std::mutex m_mutex;
+
+  std::condition_variable m_slotAvailable;
+
+  const unsigned int m_maxConcurrency;
+
+  unsigned int m_limit;
+
+  unsigned int m_running;
+
+  /// +1 while the limit climbs, -1 while it goes down
+  int m_direction;
+
+  /// the limit moves by this many transfers at the next adjustment
+  unsigned int m_step;
+
+  /// throughput of the window before, 0 if not measured yet
+  double m_lastBytesPerSec;
+
+  std::chrono::steady_clock::time_point m_windowStart;
+
+  long long m_windowBytes;
+
+  unsigned int m_windowTransfers;
+
+  unsigned long long m_throttledRequests;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_CONCURRENCYTUNER_HPP
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "DigestCache.hpp"
+#include "logger/SFLogger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace
+{
+  /**
+   * Get modification time and size of a file
+   * @return false if the file can't be found
+   */
+  bool getFileStatus(const std::string &path, long long &mtime, long long &size)
+  {
+#ifdef _WIN32
+    struct _stat64 fileStatus;
+    if (_stat64(path.c_str(), &fileStatus) != 0)
+#else
+    struct stat fileStatus;
+    if (stat(path.c_str(), &fileStatus) != 0)
+#endif
+    {
+      return false;
+    }
+    mtime = (long long)fileStatus.st_mtime;
+    size = (long long)fileStatus.st_size;
+    return true;
+  }
+}
+
+Snowflake::Client::Util::DigestCache::DigestCache(const std::string &cacheFile) :
+  m_cacheFile(cacheFile),
+  m_dirty(false)
+{
+  _critical_section_init(&m_mutex);
+  load();
+}
+
+Snowflake::Client::Util::DigestCache::~DigestCache()
+{
+  _critical_section_term(&m_mutex);
+}
+
+void Snowflake::Client::Util::DigestCache::load()
+{
+  std::ifstream cache(m_cacheFile.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!cache.is_open())
+  {
+    CXX_LOG_DEBUG("No digest cache at %s", m_cacheFile.c_str());
+    return;
+  }
+
+  // one file per line: mtime, size, compression, compressed size, digest and
+  // path, separated by tabs
+  std::string line;
+  while (std::getline(cache, line))
+  {
+    std::istringstream fields(line);
+    Entry entry;
+    std::string path;
+    fields >> entry.mtime >> entry.size >> entry.compression >>
+      entry.compressedSize >> entry.digest;
+    if (!fields || fields.get() != '\t' || !std::getline(fields, path) || path.empty())
+    {
+      CXX_LOG_WARN("Skipping invalid line in digest cache %s", m_cacheFile.c_str());
+      continue;
+    }
+    m_entries[path] = entry;
+  }
+  CXX_LOG_DEBUG("Loaded %d digests from %s", (int)m_entries.size(), m_cacheFile.c_str());
+}
+
+bool Snowflake::Client::Util::DigestCache::lookup(const std::string &path,
+                                                  const std::string &compression,
+                                                  Entry &entry)
+{
+  long long mtime, size;
+  if (!getFileStatus(path, mtime, size))
+  {
+    return false;
+  }
+
+  bool found = false;
+  _critical_section_lock(&m_mutex);
+  std::map<std::string, Entry>::const_iterator it = m_entries.find(path);
+  if (it != m_entries.end() && it->second.mtime == mtime && it->second.size == size &&
+      it->second.compression == compression)
+  {
+    entry = it->second;
+    found = true;
+  }
+  _critical_section_unlock(&m_mutex);
+
+  if (!found)
+  {
+    entry = Entry();
+    entry.mtime = mtime;
+    entry.size = size;
+    entry.compression = compression;
+  }
+  return found;
+}
+
+void Snowflake::Client::Util::DigestCache::update(const std::string &path,
+                                                  const Entry &entry)
+{
+  _critical_section_lock(&m_mutex);
+  m_entries[path] = entry;
+  m_dirty = true;
+  _critical_section_unlock(&m_mutex);
+}
+
+bool Snowflake::Client::Util::DigestCache::save()
+{
+  _critical_section_lock(&m_mutex);
+  if (!m_dirty)
+  {
+    _critical_section_unlock(&m_mutex);
+    return true;
+  }
+
+  // write a temporary file first, so that a crash leaves the old cache whole
+  std::string tempFile = m_cacheFile + ".tmp";
+  std::ofstream cache(tempFile.c_str(),
+                      std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  for (std::map<std::string, Entry>::const_iterator it = m_entries.begin();
+       cache && it != m_entries.end(); ++it)
+  {
+    const Entry &entry = it->second;
+    cache << entry.mtime << '\t' << entry.size << '\t' << entry.compression << '\t' <<
+      entry.compressedSize << '\t' << entry.digest << '\t' << it->first << '\n';
+  }
+  cache.close();
+
+  bool saved = !cache.fail();
+#ifdef _WIN32
+  // rename doesn't replace an existing file on Windows
+  saved = saved && (remove(m_cacheFile.c_str()) == 0 || errno == ENOENT);
+#endif
+  saved = saved && rename(tempFile.c_str(), m_cacheFile.c_str()) == 0;
+  if (saved)
+  {
+    m_dirty = false;
+  }
+  else
+  {
+    CXX_LOG_WARN("Failed to save digest cache %s. Errno: %d", m_cacheFile.c_str(), errno);
+    remove(tempFile.c_str());
+  }
+  _critical_section_unlock(&m_mutex);
+  return saved;
+}
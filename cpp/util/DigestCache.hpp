@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_DIGESTCACHE_HPP
+#define SNOWFLAKECLIENT_DIGESTCACHE_HPP
+
+#include <map>
+#include <string>
+#include "snowflake/platform.h"
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Digests and compressed sizes of the files uploaded before, kept in a local
+ * file, so that the files that haven't changed since don't have to be
+ * compressed and hashed again. A file is taken as unchanged while its
+ * modification time and size are the same.
+ */
+class DigestCache
+{
+public:
+  struct Entry
+  {
+    Entry() : mtime(0), size(0), compressedSize(0) {}
+
+    /// modification time of the file when the digest was calculated
+    long long mtime;
+
+    /// size of the file when the digest was calculated
+    long long size;
+
+    /// how the file is transformed before upload, e.g. "gzip:-1" or "none"
+    std::string compression;
+
+    /// base64 encoded SHA-256 digest of the data uploaded
+    std::string digest;
+
+    /// size of the data uploaded
+    long compressedSize;
+  };
+
+  /**
+   * Loads the cache file, if there is one
+   * @param cacheFile path of the cache file
+   */
+  explicit DigestCache(const std::string &cacheFile);
+
+  ~DigestCache();
+
+  /**
+   * Look up a file by its current modification time and size.
+   * @param path path of the file
+   * @param compression how the file is transformed before upload
+   * @param entry set to the cached entry on a hit. On a miss the
+   *        modification time and size found are set, to be passed to
+   *        update() once the digest is known.
+   * @return true if the file is unchanged since it was cached
+   */
+  bool lookup(const std::string &path, const std::string &compression, Entry &entry);
+
+  /**
+   * Record the digest of a file, with the modification time and size found
+   * by lookup() before the file was read.
+   */
+  void update(const std::string &path, const Entry &entry);
+
+  /**
+   * Write the cache file back if it changed.
+   * @return false if the cache file can't be written
+   */
+  bool save();
+
+private:
+  void load();
+
+  std::string m_cacheFile;
+
+  std::map<std::string, Entry> m_entries;
+
+  /// true if an entry changed since the cache was loaded
+  bool m_dirty;
+
+  SF_CRITICAL_SECTION_HANDLE m_mutex;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_DIGESTCACHE_HPP
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "DownloadCache.hpp"
+#include "crypto/Cryptor.hpp"
+#include "logger/SFLogger.hpp"
+#include "snowflake/platform.h"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+  /**
+   * Copy a file, the destination replaced if it exists
+   * @return false if the file can't be copied
+   */
+  bool copyFile(const std::string &srcPath, const std::string &destPath)
+  {
+    std::ifstream src(srcPath.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!src.is_open())
+    {
+      return false;
+    }
+    std::ofstream dest(destPath.c_str(),
+                       std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+    std::vector<char> buffer(64 * 1024);
+    while (dest && src.read(buffer.data(), (std::streamsize)buffer.size()).gcount() > 0)
+    {
+      dest.write(buffer.data(), src.gcount());
+    }
+    dest.close();
+    return !src.bad() && !dest.fail();
+  }
+
+  bool linkFile(const std::string &srcPath, const std::string &destPath)
+  {
+#ifdef _WIN32
+    return CreateHardLinkA(destPath.c_str(), srcPath.c_str(), NULL) != 0;
+#else
+    return link(srcPath.c_str(), destPath.c_str()) == 0;
+#endif
+  }
+
+  void setReadOnly(const std::string &path)
+  {
+#ifdef _WIN32
+    _chmod(path.c_str(), _S_IREAD);
+#else
+    chmod(path.c_str(), S_IRUSR | S_IRGRP | S_IROTH);
+#endif
+  }
+}
+
+Snowflake::Client::Util::DownloadCache::DownloadCache(const std::string &cacheDir) :
+  m_cacheDir(cacheDir),
+  m_tempCounter(0)
+{
+  if (sf_create_directory_if_not_exists_recursive(m_cacheDir.c_str()) != 0)
+  {
+    CXX_LOG_WARN("Failed to create download cache directory %s", m_cacheDir.c_str());
+  }
+}
+
+std::string Snowflake::Client::Util::DownloadCache::getCachedPath(
+  const std::string &remotePath, long size, const std::string &version)
+{
+  if (version.empty())
+  {
+    return std::string();
+  }
+
+  std::string key = remotePath + '\n' + std::to_string(size) + '\n' + version;
+  unsigned char digest[32];
+  Crypto::HashContext hashCtx(Crypto::Cryptor::getInstance().createHashContext(
+    Crypto::CryptoHashFunc::SHA256));
+  hashCtx.initialize();
+  hashCtx.next(key.data(), key.size());
+  hashCtx.finalize(digest);
+
+  static const char hexDigits[] = "0123456789abcdef";
+  std::string name;
+  for (size_t i = 0; i < sizeof(digest); i++)
+  {
+    name += hexDigits[digest[i] >> 4];
+    name += hexDigits[digest[i] & 0xf];
+  }
+  return m_cacheDir + PATH_SEP + name;
+}
+
+bool Snowflake::Client::Util::DownloadCache::fetch(const std::string &cachedPath,
+                                                   const std::string &destPath)
+{
+  if (cachedPath.empty() || !std::ifstream(cachedPath.c_str()).is_open())
+  {
+    return false;
+  }
+
+  if (remove(destPath.c_str()) != 0 && errno != ENOENT)
+  {
+    CXX_LOG_WARN("Failed to replace %s by its cached copy. Errno: %d",
+                 destPath.c_str(), errno);
+    return false;
+  }
+  if (linkFile(cachedPath, destPath))
+  {
+    return true;
+  }
+  // the cache is on another file system
+  if (!copyFile(cachedPath, destPath))
+  {
+    CXX_LOG_WARN("Failed to copy cached file %s to %s", cachedPath.c_str(),
+                 destPath.c_str());
+    remove(destPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool Snowflake::Client::Util::DownloadCache::store(const std::string &cachedPath,
+                                                   const std::string &srcPath)
+{
+  if (cachedPath.empty())
+  {
+    return false;
+  }
+
+  // copy to a temporary file first, so that a file in the cache is always whole
+  std::string tempFile = cachedPath + ".tmp" + std::to_string(m_tempCounter++);
+  bool stored = copyFile(srcPath, tempFile);
+  if (stored)
+  {
+    setReadOnly(tempFile);
+#ifdef _WIN32
+    // rename doesn't replace an existing file on Windows, a file cached by
+    // another download meanwhile is as good
+    stored = rename(tempFile.c_str(), cachedPath.c_str()) == 0 ||
+      std::ifstream(cachedPath.c_str()).is_open();
+#else
+    stored = rename(tempFile.c_str(), cachedPath.c_str()) == 0;
+#endif
+  }
+  if (!stored)
+  {
+    CXX_LOG_WARN("Failed to cache downloaded file %s. Errno: %d", srcPath.c_str(), errno);
+  }
+  remove(tempFile.c_str());
+  return stored;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_DOWNLOADCACHE_HPP
+#define SNOWFLAKECLIENT_DOWNLOADCACHE_HPP
+
+#include <atomic>
+#include <string>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Files downloaded before, decrypted, kept in a local directory under the
+ * SHA-256 digest of their stage path, size and version (the ETag given by
+ * the storage), so that a file that hasn't changed on the stage since isn't
+ * downloaded and decrypted again. The cached files are read only, and are
+ * hard linked to the files downloaded when both are on the same file
+ * system, copied otherwise.
+ */
+class DownloadCache
+{
+public:
+  /**
+   * @param cacheDir directory of the cached files, created if needed
+   */
+  explicit DownloadCache(const std::string &cacheDir);
+
+  /**
+   * @param remotePath full path of the file on the stage
+   * @param size size of the file on the stage
+   * @param version ETag of the file on the stage
+   * @return path of the cached copy of the file, empty if the storage gives
+   *         no version to tell whether the file changed
+   */
+  std::string getCachedPath(const std::string &remotePath, long size,
+                            const std::string &version);
+
+  /**
+   * Put the cached copy of a file at destPath, replacing the file there.
+   * @return false if the file isn't cached or can't be put there
+   */
+  bool fetch(const std::string &cachedPath, const std::string &destPath);
+
+  /**
+   * Copy a file downloaded into the cache.
+   * @return false if the file can't be copied
+   */
+  bool store(const std::string &cachedPath, const std::string &srcPath);
+
+private:
+  std::string m_cacheDir;
+
+  /// makes the names of the files being copied into the cache unique
+  std::atomic<unsigned int> m_tempCounter;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_DOWNLOADCACHE_HPP
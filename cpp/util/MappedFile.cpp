@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "MappedFile.hpp"
+#include "logger/SFLogger.hpp"
+#include <cerrno>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Snowflake::Client::Util::MappedFile::MappedFile() :
+  m_data(nullptr),
+  m_size(0),
+  m_open(false)
+{
+}
+
+Snowflake::Client::Util::MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool Snowflake::Client::Util::MappedFile::open(const std::string &path)
+{
+  if (m_open)
+  {
+    return false;
+  }
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  LARGE_INTEGER fileSize;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+  {
+    CXX_LOG_DEBUG("Could not open file %s to map. Error: %d", path.c_str(),
+                  (int)GetLastError());
+    if (file != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(file);
+    }
+    return false;
+  }
+  m_size = (size_t)fileSize.QuadPart;
+  if (m_size > 0)
+  {
+    // the view keeps the mapping and the file open
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    m_data = mapping ? (char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping)
+    {
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+  if (m_size > 0 && !m_data)
+  {
+    CXX_LOG_DEBUG("Could not map file %s. Error: %d", path.c_str(),
+                  (int)GetLastError());
+    m_size = 0;
+    return false;
+  }
+#else
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat fileStat;
+  if (fd < 0 || fstat(fd, &fileStat) != 0)
+  {
+    CXX_LOG_DEBUG("Could not open file %s to map. Errno: %d", path.c_str(), errno);
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+    return false;
+  }
+  m_size = (size_t)fileStat.st_size;
+  if (m_size > 0)
+  {
+    // the mapping keeps the file open
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    m_data = data == MAP_FAILED ? nullptr : (char *)data;
+  }
+  ::close(fd);
+  if (m_size > 0 && !m_data)
+  {
+    CXX_LOG_DEBUG("Could not map file %s. Errno: %d", path.c_str(), errno);
+    m_size = 0;
+    return false;
+  }
+  if (m_data)
+  {
+    madvise(m_data, m_size, MADV_SEQUENTIAL);
+  }
+#endif
+
+  m_open = true;
+  return true;
+}
+
+void Snowflake::Client::Util::MappedFile::close()
+{
+  if (m_data)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(m_data, m_size);
+#endif
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_MAPPEDFILE_HPP
+#define SNOWFLAKECLIENT_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Local file mapped in memory to read, so that it is hashed and encrypted
+ * straight from the page cache instead of copied out through a file stream.
+ * The file must not get shorter while it is mapped, reading pages no longer
+ * in the file fails with SIGBUS.
+ */
+class MappedFile
+{
+public:
+  MappedFile();
+
+  ~MappedFile();
+
+  /**
+   * Map a file to read
+   * @return false if the file couldn't be opened or mapped
+   */
+  bool open(const std::string &path);
+
+  void close();
+
+  bool is_open() const
+  {
+    return m_open;
+  }
+
+  /**
+   * @return the whole file, nullptr for an empty file
+   */
+  const char *data() const
+  {
+    return m_data;
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+
+private:
+  char *m_data;
+
+  size_t m_size;
+
+  /// an empty file is open without a mapping
+  bool m_open;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_MAPPEDFILE_HPP
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "StageSql.hpp"
+
+std::string Snowflake::Client::Util::StageSql::quote(const std::string &text)
+{
+  std::string quoted = "'";
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    if (text[i] == '\'')
+    {
+      quoted += '\'';
+    }
+    quoted += text[i];
+  }
+  return quoted + "'";
+}
+
+std::string Snowflake::Client::Util::StageSql::getTableStage(const std::string &table)
+{
+  size_t nameStart = table.rfind('.');
+  nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+  return "@" + table.substr(0, nameStart) + "%" + table.substr(nameStart);
+}
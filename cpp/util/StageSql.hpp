@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_STAGESQL_HPP
+#define SNOWFLAKECLIENT_STAGESQL_HPP
+
+#include <string>
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * Text of the PUT and COPY INTO commands the loaders of the client build
+ */
+class StageSql
+{
+public:
+  /**
+   * @return the text as a string literal, in single quotes with the quotes in
+   *         it doubled
+   */
+  static std::string quote(const std::string &text);
+
+  /**
+   * @return the stage of a table, e.g. @db.schema.%orders for db.schema.orders
+   */
+  static std::string getTableStage(const std::string &table);
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_STAGESQL_HPP
@@ -18,6 +18,8 @@
 #include <cstring>
 #include "snowflake/platform.h"
 #include "snowflake/SnowflakeTransferException.hpp"
+#include "io_threads.h"
+#include "thread_affinity.h"
 #include "../logger/SFLogger.hpp"
 #include "ByteArrayStreamBuf.hpp"
 
@@ -29,34 +31,63 @@ namespace Util
 {
 
 /**
- * A naive implementation of thread pool
+ * Thread pool where each thread has its own queue of jobs. A job added by a
+ * thread of the pool goes to the queue of that thread, other jobs are
+ * dealt out to the queues in turn. A thread runs the jobs of its queue
+ * first and steals from the others when it runs out, taking the oldest job
+ * either way, so that jobs of one caller run in the order they were added.
+ * A sleeping thread is only woken up when there is a job for it. The
+ * threads are taken from the process-wide I/O thread budget, so a pool may
+ * get fewer threads than asked for.
  */
 class ThreadPool {
 private:
 
+  /**
+   * Jobs of a thread
+   */
+  struct WorkerQueue
+  {
+    std::deque<std::function<void(void)>> jobs;
+
+    SF_CRITICAL_SECTION_HANDLE mutex;
+  };
+
   /// thread count
   const unsigned int threadCount;
 
   /// threads vector
   std::vector<SF_THREAD_HANDLE > threads;
 
-  /// task queue
-  std::deque<std::function<void(void)>> queue;
+  /// job queue of each thread
+  std::vector<WorkerQueue *> queues;
+
+  /// jobs in the queues
+  std::atomic<unsigned int> queuedJobs;
+
+  /// jobs added and not finished
+  std::atomic<unsigned int> pendingJobs;
 
-  /// threads not sleeping (initialize to thread count)
-  unsigned int busyThreads;
+  /// threads waiting for a job
+  std::atomic<unsigned int> sleepingThreads;
+
+  /// queue jobs from outside of the pool are dealt to next
+  std::atomic<unsigned int> nextQueue;
 
   /// true if thread pool is going to be shutdown
-  bool finished;
+  std::atomic<bool> finished;
+
+  /// threads of the pool are placed together, see sf_affinity_group()
+  const int affinityGroup;
 
-  /// condition variable that threads wait on task queue
+  /// condition variable that threads wait on for a job
   SF_CONDITION_HANDLE job_available_var;
 
-  /// cv that main threads wait on all worker to finish task queue
+  /// cv that main threads wait on all worker to finish the jobs
   SF_CONDITION_HANDLE wait_var;
 
-  /// queue mutex
-  SF_CRITICAL_SECTION_HANDLE queue_mutex;
+  /// mutex of the condition variables
+  SF_CRITICAL_SECTION_HANDLE sleep_mutex;
 
 #ifdef _WIN32
   DWORD key;
@@ -88,7 +119,8 @@ private:
 #else
     pthread_setspecific(*ctx->key, &ctx->threadIdx);
 #endif
-    ctx->tp->execute_thread();
+    sf_affinity_apply(ctx->tp->affinityGroup);
+    ctx->tp->execute_thread(ctx->threadIdx);
     delete ctx;
 #ifdef _WIN32
     delete lpData;
@@ -97,49 +129,87 @@ private:
   }
 
   /**
-   *  Get the next job; pop the first item in the queue,
-   *  otherwise wait for a signal from the main thread.
+   * @return index of the calling thread in this pool, -1 for a thread of
+   * something else
    */
-  void execute_thread() {
-    std::function<void(void)> res;
-    while(true)
-    {
-      _critical_section_lock(&queue_mutex);
-
-      busyThreads --;
-      if (busyThreads == 0)
-        _cond_signal(&wait_var);
+  int getOwnThreadIdx()
+  {
+#ifdef _WIN32
+    int *idx = (int *)TlsGetValue(key);
+#else
+    int *idx = (int *)pthread_getspecific(key);
+#endif
+    return idx ? *idx : -1;
+  }
 
-      // Wait for a job if we don't have any.
-      while (queue.empty() && !finished)
+  /**
+   * Take the oldest job of the queue of a thread, or steal the oldest job
+   * of another queue.
+   * @return false if all the queues are empty
+   */
+  bool take_job(unsigned int threadIdx, std::function<void(void)> &job)
+  {
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+      WorkerQueue *queue = queues[(threadIdx + i) % threadCount];
+      _critical_section_lock(&queue->mutex);
+      if (!queue->jobs.empty())
       {
-        _cond_wait(&job_available_var, &queue_mutex);
+        job = std::move(queue->jobs.front());
+        queue->jobs.pop_front();
+        queuedJobs --;
+        _critical_section_unlock(&queue->mutex);
+        return true;
       }
+      _critical_section_unlock(&queue->mutex);
+    }
+    return false;
+  }
 
-      // Get job from the queue
-      if (finished)
+  /**
+   *  Run jobs until the pool is shut down, sleeping while there are none.
+   */
+  void execute_thread(unsigned int threadIdx) {
+    std::function<void(void)> job;
+    while (!finished)
+    {
+      if (take_job(threadIdx, job))
       {
-        _critical_section_unlock(&queue_mutex);
-        break;
+        job();
+        job = nullptr;
+        if (--pendingJobs == 0)
+        {
+          _critical_section_lock(&sleep_mutex);
+          _cond_broadcast(&wait_var);
+          _critical_section_unlock(&sleep_mutex);
+        }
+        continue;
       }
-      else
+
+      // a job added after the count is checked sees this thread sleeping
+      // and wakes it up
+      _critical_section_lock(&sleep_mutex);
+      sleepingThreads ++;
+      while (queuedJobs == 0 && !finished)
       {
-        busyThreads ++;
-        res = queue.front();
-        queue.pop_front();
-        _critical_section_unlock(&queue_mutex);
-        res();
+        _cond_wait(&job_available_var, &sleep_mutex);
       }
+      sleepingThreads --;
+      _critical_section_unlock(&sleep_mutex);
     }
   }
 
 public:
   ThreadPool(unsigned int threadNum)
-    : finished( false )
-    , threadCount (threadNum)
-    , busyThreads (threadNum)
+    : threadCount ((unsigned int)sf_io_threads_acquire(threadNum))
+    , queuedJobs (0)
+    , pendingJobs (0)
+    , sleepingThreads (0)
+    , nextQueue (0)
+    , finished( false )
+    , affinityGroup (sf_affinity_group())
   {
-    _critical_section_init(&queue_mutex);
+    _critical_section_init(&sleep_mutex);
     _cond_init(&job_available_var);
     _cond_init(&wait_var);
 
@@ -161,6 +231,13 @@ public:
     }
 #endif
 
+    for( unsigned i = 0; i < threadCount; ++i )
+    {
+      WorkerQueue *queue = new WorkerQueue;
+      _critical_section_init(&queue->mutex);
+      queues.push_back(queue);
+    }
+
     for( unsigned i = 0; i < threadCount; ++i )
     {
       SF_THREAD_HANDLE tid;
@@ -188,6 +265,7 @@ public:
    */
   ~ThreadPool() {
     JoinAll();
+    sf_io_threads_release(threadCount);
 #ifdef _WIN32
     if (key != TLS_OUT_OF_INDEXES)
     {
@@ -196,41 +274,57 @@ public:
 #else
     pthread_key_delete(key);
 #endif
-    _critical_section_term(&queue_mutex);
+    for (auto queue : queues)
+    {
+      _critical_section_term(&queue->mutex);
+      delete queue;
+    }
+    _critical_section_term(&sleep_mutex);
     _cond_term(&job_available_var);
     _cond_term(&wait_var);
   }
 
   /**
-   *  Add a new job to the pool. If there are no jobs in the queue,
-   *  a thread is woken up to take the job. If all threads are busy,
-   *  the job is added to the end of the queue.
+   *  Add a new job to the pool, to the queue of the calling thread if it
+   *  is one of the pool, to the next queue in turn otherwise. A sleeping
+   *  thread is woken up to take the job.
    */
   void AddJob( std::function<void(void)> job ) {
-    _critical_section_lock(&queue_mutex);
-    queue.emplace_back( job );
-    _cond_signal(&job_available_var);
-    _critical_section_unlock(&queue_mutex);
+    int ownIdx = getOwnThreadIdx();
+    unsigned int idx = ownIdx >= 0 ? (unsigned int)ownIdx :
+      (nextQueue ++) % threadCount;
+
+    pendingJobs ++;
+    WorkerQueue *queue = queues[idx];
+    _critical_section_lock(&queue->mutex);
+    queue->jobs.emplace_back(std::move(job));
+    queuedJobs ++;
+    _critical_section_unlock(&queue->mutex);
+
+    if (sleepingThreads > 0)
+    {
+      _critical_section_lock(&sleep_mutex);
+      _cond_signal(&job_available_var);
+      _critical_section_unlock(&sleep_mutex);
+    }
   }
 
   /**
    *  Join with all threads. Block until all threads have completed.
-   *  Params: WaitForAll: If true, will wait for the queue to empty
-   *          before joining with threads. If false, will complete
-   *          current jobs, then inform the threads to exit.
-   *  The queue will be empty after this call, and the threads will
-   *  be done. After invoking `ThreadPool::JoinAll`, the pool can no
-   *  longer be used. If you need the pool to exist past completion
+   *  Threads complete the jobs they are running, then exit; jobs still
+   *  queued are not run. After invoking `ThreadPool::JoinAll`, the pool
+   *  can no longer be used. If you need the pool to exist past completion
    *  of jobs, look to use `ThreadPool::WaitAll`.
    */
   void JoinAll() {
-    _critical_section_lock(&queue_mutex);
+    _critical_section_lock(&sleep_mutex);
     finished = true;
     _cond_broadcast(&job_available_var);
-    _critical_section_unlock(&queue_mutex);
+    _critical_section_unlock(&sleep_mutex);
 
     for (auto &x : threads)
       _thread_join(x);
+    threads.clear();
   }
 
   /**
@@ -239,12 +333,74 @@ public:
    *  all jobs have finshed executing.
    */
   void WaitAll() {
-    _critical_section_lock(&queue_mutex);
-    while(busyThreads > 0 || !queue.empty())
+    _critical_section_lock(&sleep_mutex);
+    while (pendingJobs > 0)
+    {
+      _cond_wait(&wait_var, &sleep_mutex);
+    }
+    _critical_section_unlock(&sleep_mutex);
+  }
+};
+
+/**
+ * Jobs added to a thread pool shared with other callers, that can be waited
+ * on without waiting for the jobs of the others
+ */
+class JobGroup {
+private:
+  /// jobs added and not finished
+  unsigned int pending;
+
+  /// mutex protecting the pending count
+  SF_CRITICAL_SECTION_HANDLE mutex;
+
+  /// cv that the caller waits on for the jobs to finish
+  SF_CONDITION_HANDLE done_var;
+
+public:
+  JobGroup() : pending(0)
+  {
+    _critical_section_init(&mutex);
+    _cond_init(&done_var);
+  }
+
+  ~JobGroup()
+  {
+    Wait();
+    _cond_term(&done_var);
+    _critical_section_term(&mutex);
+  }
+
+  /**
+   * Add a job of the group to the pool
+   */
+  void AddJob(ThreadPool &pool, std::function<void(void)> job)
+  {
+    _critical_section_lock(&mutex);
+    pending ++;
+    _critical_section_unlock(&mutex);
+
+    pool.AddJob([this, job]()->void {
+      job();
+      _critical_section_lock(&mutex);
+      pending --;
+      if (pending == 0)
+        _cond_broadcast(&done_var);
+      _critical_section_unlock(&mutex);
+    });
+  }
+
+  /**
+   * Wait for the jobs of the group to finish
+   */
+  void Wait()
+  {
+    _critical_section_lock(&mutex);
+    while (pending > 0)
     {
-      _cond_wait(&wait_var, &queue_mutex);
+      _cond_wait(&done_var, &mutex);
     }
-    _critical_section_unlock(&queue_mutex);
+    _critical_section_unlock(&mutex);
   }
 };
 
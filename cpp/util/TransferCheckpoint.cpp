@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "TransferCheckpoint.hpp"
+#include "logger/SFLogger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  /**
+   * Split a line into fields separated by tabs, the last field taking the
+   * rest of the line
+   * @return false if the line has fewer fields
+   */
+  bool splitFields(const std::string &line, size_t count,
+                   std::vector<std::string> &fields)
+  {
+    fields.clear();
+    size_t start = 0;
+    while (fields.size() + 1 < count)
+    {
+      size_t end = line.find('\t', start);
+      if (end == std::string::npos)
+      {
+        return false;
+      }
+      fields.push_back(line.substr(start, end - start));
+      start = end + 1;
+    }
+    fields.push_back(line.substr(start));
+    return !fields.back().empty();
+  }
+}
+
+Snowflake::Client::Util::TransferCheckpoint::TransferCheckpoint(
+  const std::string &checkpointFile) :
+  m_checkpointFile(checkpointFile)
+{
+  _critical_section_init(&m_mutex);
+  load();
+}
+
+Snowflake::Client::Util::TransferCheckpoint::~TransferCheckpoint()
+{
+  _critical_section_term(&m_mutex);
+}
+
+void Snowflake::Client::Util::TransferCheckpoint::load()
+{
+  std::ifstream checkpoint(m_checkpointFile.c_str(),
+                           std::ios_base::in | std::ios_base::binary);
+  if (!checkpoint.is_open())
+  {
+    CXX_LOG_DEBUG("No transfer checkpoint at %s", m_checkpointFile.c_str());
+    return;
+  }
+
+  // an upload is a line of upload id, size, part size, digest, encrypted
+  // file key, iv, material descriptor and remote path, followed by a line of
+  // part number, etag and remote path for each part completed, separated by
+  // tabs. A line cut short by a crash is skipped.
+  std::string line;
+  std::vector<std::string> fields;
+  while (std::getline(checkpoint, line))
+  {
+    if (line.compare(0, 7, "upload\t") == 0 && splitFields(line, 9, fields))
+    {
+      Entry entry;
+      entry.uploadId = fields[1];
+      entry.size = std::strtoll(fields[2].c_str(), NULL, 10);
+      entry.partSize = (size_t)std::strtoull(fields[3].c_str(), NULL, 10);
+      entry.digest = fields[4];
+      entry.enKekEncoded = fields[5];
+      entry.iv = fields[6];
+      entry.matDesc = fields[7];
+      m_entries[fields[8]] = entry;
+    }
+    else if (line.compare(0, 5, "part\t") == 0 && splitFields(line, 4, fields) &&
+             m_entries.find(fields[3]) != m_entries.end())
+    {
+      unsigned int partNumber = (unsigned int)std::strtoul(fields[1].c_str(), NULL, 10);
+      m_entries[fields[3]].parts[partNumber] = fields[2];
+    }
+    else
+    {
+      CXX_LOG_WARN("Skipping invalid line in transfer checkpoint %s",
+                   m_checkpointFile.c_str());
+    }
+  }
+  CXX_LOG_DEBUG("Loaded %d uploads from %s", (int)m_entries.size(),
+                m_checkpointFile.c_str());
+}
+
+bool Snowflake::Client::Util::TransferCheckpoint::lookup(
+  const std::string &remotePath, Entry &entry)
+{
+  _critical_section_lock(&m_mutex);
+  std::map<std::string, Entry>::const_iterator it = m_entries.find(remotePath);
+  bool found = it != m_entries.end();
+  if (found)
+  {
+    entry = it->second;
+  }
+  _critical_section_unlock(&m_mutex);
+  return found;
+}
+
+void Snowflake::Client::Util::TransferCheckpoint::start(
+  const std::string &remotePath, const Entry &entry)
+{
+  _critical_section_lock(&m_mutex);
+  m_entries[remotePath] = entry;
+  save();
+  _critical_section_unlock(&m_mutex);
+}
+
+void Snowflake::Client::Util::TransferCheckpoint::completePart(
+  const std::string &remotePath, unsigned int partNumber, const std::string &etag)
+{
+  _critical_section_lock(&m_mutex);
+  std::map<std::string, Entry>::iterator it = m_entries.find(remotePath);
+  if (it != m_entries.end())
+  {
+    it->second.parts[partNumber] = etag;
+
+    // appending keeps the cost of a part the same however many there are
+    std::ofstream checkpoint(m_checkpointFile.c_str(),
+                             std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+    checkpoint << "part\t" << partNumber << '\t' << etag << '\t' << remotePath << '\n';
+    checkpoint.close();
+    if (checkpoint.fail())
+    {
+      CXX_LOG_WARN("Failed to update transfer checkpoint %s. Errno: %d",
+                   m_checkpointFile.c_str(), errno);
+    }
+  }
+  _critical_section_unlock(&m_mutex);
+}
+
+void Snowflake::Client::Util::TransferCheckpoint::remove(const std::string &remotePath)
+{
+  _critical_section_lock(&m_mutex);
+  if (m_entries.erase(remotePath) > 0)
+  {
+    save();
+  }
+  _critical_section_unlock(&m_mutex);
+}
+
+bool Snowflake::Client::Util::TransferCheckpoint::save()
+{
+  // write a temporary file first, so that a crash leaves the old checkpoint whole
+  std::string tempFile = m_checkpointFile + ".tmp";
+  std::ofstream checkpoint(tempFile.c_str(),
+                           std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  for (std::map<std::string, Entry>::const_iterator it = m_entries.begin();
+       checkpoint && it != m_entries.end(); ++it)
+  {
+    const Entry &entry = it->second;
+    checkpoint << "upload\t" << entry.uploadId << '\t' << entry.size << '\t' <<
+      entry.partSize << '\t' << entry.digest << '\t' << entry.enKekEncoded << '\t' <<
+      entry.iv << '\t' << entry.matDesc << '\t' << it->first << '\n';
+    for (std::map<unsigned int, std::string>::const_iterator part = entry.parts.begin();
+         part != entry.parts.end(); ++part)
+    {
+      checkpoint << "part\t" << part->first << '\t' << part->second << '\t' <<
+        it->first << '\n';
+    }
+  }
+  checkpoint.close();
+
+  bool saved = !checkpoint.fail();
+#ifdef _WIN32
+  // rename doesn't replace an existing file on Windows, MoveFileEx does so atomically
+  saved = saved && MoveFileExA(tempFile.c_str(), m_checkpointFile.c_str(),
+                               MOVEFILE_REPLACE_EXISTING) != 0;
+  int error = saved ? 0 : (int)GetLastError();
+#else
+  saved = saved && rename(tempFile.c_str(), m_checkpointFile.c_str()) == 0;
+  int error = saved ? 0 : errno;
+#endif
+  if (!saved)
+  {
+    CXX_LOG_WARN("Failed to save transfer checkpoint %s. Error: %d",
+                 m_checkpointFile.c_str(), error);
+    std::remove(tempFile.c_str());
+  }
+  return saved;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_TRANSFERCHECKPOINT_HPP
+#define SNOWFLAKECLIENT_TRANSFERCHECKPOINT_HPP
+
+#include <map>
+#include <string>
+#include "snowflake/platform.h"
+
+namespace Snowflake
+{
+namespace Client
+{
+namespace Util
+{
+
+/**
+ * State of the multipart uploads not completed yet, kept in a local file, so
+ * that a retried or restarted upload of the same data goes on from the parts
+ * already uploaded. The uploads are keyed by their full remote path.
+ */
+class TransferCheckpoint
+{
+public:
+  struct Entry
+  {
+    Entry() : size(0), partSize(0) {}
+
+    /// id of the multipart upload given by the storage
+    std::string uploadId;
+
+    /// size of the encrypted data uploaded
+    long long size;
+
+    /// size of the parts, all but the last one
+    size_t partSize;
+
+    /// base64 encoded SHA-256 digest of the data before encryption
+    std::string digest;
+
+    /// file key encrypted by the query stage master key, base64 encoded
+    std::string enKekEncoded;
+
+    /// base64 encoded iv of the encryption
+    std::string iv;
+
+    /// encryption material descriptor the file key was encrypted with
+    std::string matDesc;
+
+    /// etags of the parts completed, by part number
+    std::map<unsigned int, std::string> parts;
+  };
+
+  /**
+   * Loads the checkpoint file, if there is one
+   * @param checkpointFile path of the checkpoint file
+   */
+  explicit TransferCheckpoint(const std::string &checkpointFile);
+
+  ~TransferCheckpoint();
+
+  /**
+   * Look up the upload to a remote path
+   * @return true if an upload was started and not completed
+   */
+  bool lookup(const std::string &remotePath, Entry &entry);
+
+  /**
+   * Record a new upload to a remote path, replacing the one before
+   */
+  void start(const std::string &remotePath, const Entry &entry);
+
+  /**
+   * Record a part completed. Only the part is appended to the file.
+   */
+  void completePart(const std::string &remotePath, unsigned int partNumber,
+                    const std::string &etag);
+
+  /**
+   * Forget the upload to a remote path, once completed or given up
+   */
+  void remove(const std::string &remotePath);
+
+private:
+  void load();
+
+  /**
+   * Write all uploads to the checkpoint file, called with the mutex locked
+   */
+  bool save();
+
+  std::string m_checkpointFile;
+
+  std::map<std::string, Entry> m_entries;
+
+  SF_CRITICAL_SECTION_HANDLE m_mutex;
+};
+
+}
+}
+}
+
+#endif //SNOWFLAKECLIENT_TRANSFERCHECKPOINT_HPP
@@ -71,9 +71,17 @@ typedef pthread_mutex_t SF_MUTEX_HANDLE;
 #include "memdebug.h"
 #include "sf_ocsp_telemetry_data.h"
 
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#endif
+
 #define DEFAULT_OCSP_RESPONSE_CACHE_HOST "http://ocsp.snowflakecomputing.com"
 #define OCSP_RESPONSE_CACHE_JSON "ocsp_response_cache.json"
 #define OCSP_RESPONSE_CACHE_URL "%s/%s"
+#define OCSP_RESPONSE_CACHE_DIR_ENV "SF_OCSP_RESPONSE_CACHE_DIR"
+#define OCSP_RESPONSE_CACHE_TTL_ENV "SF_OCSP_RESPONSE_CACHE_TTL"
+#define OCSP_RESPONSE_CACHE_DEFAULT_TTL (24*60*60*5)
 #define OCSP_RESPONDER_RETRY_URL "http://ocsp.snowflakecomputing.com/retry"
 
 #define GET_STR_OCSP_LOG(X,Y) X->Y ? cJSON_CreateString(X->Y) : NULL
@@ -179,6 +187,9 @@ static OCSP_RESPONSE* extractOCSPRespFromValue(cJSON *cache_value,
 static cJSON *getCacheEntry(OCSP_CERTID* certid, struct Curl_easy *data);
 static void deleteCacheEntry(OCSP_CERTID* certid, struct Curl_easy *data);
 static void updateCacheWithBulkEntries(cJSON* tmp_cache, struct Curl_easy *data);
+static void mergeCacheFileEntries(cJSON* file_cache, struct Curl_easy *data);
+static void loadOCSPCacheFile(const char *cache_file, struct Curl_easy *data);
+static long getOCSPCacheTTL(void);
 static char * getOCSPPostReqData(const char *hname, OCSP_CERTID *cid,
                                  const char * ocsp_url, const char *ocsp_req,
                                  struct Curl_easy *data);
@@ -200,6 +211,13 @@ static cJSON * ocsp_cache_root = NULL;
 /* mutex for ocsp_cache_root */
 static SF_MUTEX_HANDLE ocsp_response_cache_mutex;
 
+/* set when the in memory cache has entries the cache file doesn't */
+static int ocsp_cache_dirty = 0;
+
+/* the cache file as it was when it was last read or written */
+static time_t ocsp_cache_file_mtime = 0;
+static off_t ocsp_cache_file_size = -1;
+
 /** OCSP Cache Server is used if enabled */
 static int ocsp_cache_server_enabled = 0;
 
@@ -837,6 +855,7 @@ void updateOCSPResponseInMem(OCSP_CERTID *certid, OCSP_RESPONSE *resp,
     cJSON_DeleteItemFromObject(ocsp_cache_root, found->string);
   }
   cJSON_AddItemToObject(ocsp_cache_root, cert_id_encode, cache_val_array);
+  ocsp_cache_dirty = 1;
   _mutex_unlock(&ocsp_response_cache_mutex);
 end:
   if (cert_id_encode) curl_free(cert_id_encode);
@@ -1140,8 +1159,8 @@ OCSP_RESPONSE* extractOCSPRespFromValue(cJSON *cache_value, struct Curl_easy *da
 
   last_query_time_l = (long)last_query_time->valuedouble;
 
-  /* valid for 120 hours */
-  if ((unsigned long)time(NULL) - last_query_time_l >= 24*60*60*5)
+  /* valid for 120 hours unless configured otherwise */
+  if ((unsigned long)time(NULL) - last_query_time_l >= (unsigned long)getOCSPCacheTTL())
   {
     infof(data, "OCSP Response Cache Expired\n");
     goto end;
@@ -1252,6 +1271,7 @@ void deleteCacheEntry(OCSP_CERTID* certid, struct Curl_easy *data)
   if (found)
   {
     cJSON_DeleteItemFromObject(ocsp_cache_root, found->string);
+    ocsp_cache_dirty = 1;
   }
   _mutex_unlock(&ocsp_response_cache_mutex);
 }
@@ -1285,6 +1305,50 @@ void updateCacheWithBulkEntries(cJSON* tmp_cache, struct Curl_easy *data)
       cJSON_DeleteItemFromObject(ocsp_cache_root, found->string);
     }
     cJSON_AddItemToObject(ocsp_cache_root, element_pointer->string, new_value);
+    ocsp_cache_dirty = 1;
+  }
+}
+
+/**
+ * Merge the entries of the cache file written by another process into the
+ * OCSP cache, keeping whichever entry was queried last.
+ * @param file_cache a cJSON data read from the cache file
+ * @param data curl handle
+ */
+void mergeCacheFileEntries(cJSON* file_cache, struct Curl_easy *data)
+{
+  cJSON *element_pointer = NULL;
+  cJSON *found = NULL;
+  cJSON *found_time = NULL;
+  cJSON *file_time = NULL;
+
+  cJSON_ArrayForEach(element_pointer, file_cache)
+  {
+    OCSP_CERTID *cert_id = decodeOCSPCertIDFromBase64(
+      element_pointer->string, data);
+    if (cert_id == NULL)
+    {
+      infof(data, "CertID is NULL\n");
+      continue;
+    }
+    found = getCacheEntry(cert_id, data);
+    OCSP_CERTID_free(cert_id);
+    if (found != NULL)
+    {
+      found_time = cJSON_GetArrayItem(found, 0);
+      file_time = cJSON_GetArrayItem(element_pointer, 0);
+      if (!cJSON_IsNumber(file_time) ||
+          (cJSON_IsNumber(found_time) &&
+           found_time->valuedouble >= file_time->valuedouble))
+      {
+        /* ours is newer, the file gets it on the next write */
+        ocsp_cache_dirty = 1;
+        continue;
+      }
+      cJSON_DeleteItemFromObject(ocsp_cache_root, found->string);
+    }
+    cJSON_AddItemToObject(ocsp_cache_root, element_pointer->string,
+                          cJSON_Duplicate(element_pointer, 1));
   }
 }
 
@@ -1727,6 +1791,22 @@ char* mkdirIfNotExists(char* dir, struct Curl_easy *data)
  */
 char* ensureCacheDir(char* cache_dir, struct Curl_easy *data)
 {
+  char *cache_dir_env = getenv(OCSP_RESPONSE_CACHE_DIR_ENV);
+  if (cache_dir_env != NULL && cache_dir_env[0] != '\0')
+  {
+    if (strlen(cache_dir_env) >= PATH_MAX)
+    {
+      failf(data, "OCSP cache directory is too long: %s\n", cache_dir_env);
+      goto err;
+    }
+    strcpy(cache_dir, cache_dir_env);
+    if (mkdirIfNotExists(cache_dir, data) == NULL)
+    {
+      goto err;
+    }
+    infof(data, "OCSP cache file directory: %s\n", cache_dir);
+    return cache_dir;
+  }
 #ifdef __linux__
   char *home_env = getenv("HOME");
   strcpy(cache_dir, (home_env == NULL ? (char*)"/tmp" : home_env));
@@ -1810,17 +1890,136 @@ err:
 }
 
 /**
- * Write OCSP cache onto a file in the cache directory
+ * TTL of the OCSP cache entries
+ * @return seconds an entry may be used after it was queried
+ */
+long getOCSPCacheTTL(void)
+{
+  char *ttl_env = getenv(OCSP_RESPONSE_CACHE_TTL_ENV);
+  long ttl;
+  if (ttl_env == NULL)
+  {
+    return OCSP_RESPONSE_CACHE_DEFAULT_TTL;
+  }
+  ttl = strtol(ttl_env, NULL, 10);
+  return ttl > 0 ? ttl : OCSP_RESPONSE_CACHE_DEFAULT_TTL;
+}
+
+/**
+ * Build the path of the cache file
+ * @param cache_file buffer of PATH_MAX bytes
  * @param data curl handle
+ * @return cache file name or NULL
  */
-void writeOCSPCacheFile(struct Curl_easy* data)
+static char* getOCSPCacheFile(char *cache_file, struct Curl_easy *data)
 {
   char cache_dir[PATH_MAX] = "";
+
+  if (ensureCacheDir(cache_dir, data) == NULL)
+  {
+    return NULL;
+  }
+  if (strlen(cache_dir) + strlen(PATH_SEP OCSP_RESPONSE_CACHE_JSON) >= PATH_MAX)
+  {
+    failf(data, "OCSP cache file path is too long\n");
+    return NULL;
+  }
+  strcpy(cache_file, cache_dir);
+  strcat(cache_file, PATH_SEP);
+  strcat(cache_file, OCSP_RESPONSE_CACHE_JSON);
+  infof(data, "OCSP cache file: %s\n", cache_file);
+  return cache_file;
+}
+
+/**
+ * Merge the cache file into the OCSP cache if another process has replaced
+ * it since it was last read or written. Must be mutex protected.
+ * @param cache_file cache file name
+ * @param data curl handle
+ */
+void loadOCSPCacheFile(const char *cache_file, struct Curl_easy *data)
+{
+  struct stat statbuf;
+  FILE *pfile = NULL;
+  char *ocsp_resp_cache_str = NULL;
+  size_t len;
+  cJSON *file_cache = NULL;
+
+  if (stat(cache_file, &statbuf) != 0)
+  {
+    infof(data, "No OCSP cache file found on disk. file: %s\n", cache_file);
+    return;
+  }
+  if (ocsp_cache_root != NULL &&
+      statbuf.st_mtime == ocsp_cache_file_mtime &&
+      statbuf.st_size == ocsp_cache_file_size)
+  {
+    infof(data, "OCSP cache file has not changed since it was read\n");
+    return;
+  }
+
+  pfile = fopen(cache_file, "rb");
+  if (pfile == NULL)
+  {
+    infof(data, "Failed to open OCSP response cache file. Ignored.\n");
+    return;
+  }
+  ocsp_resp_cache_str = (char *)malloc((size_t)statbuf.st_size + 1);
+  if (ocsp_resp_cache_str == NULL)
+  {
+    infof(data, "Failed to allocate memory for the OCSP response cache file. Ignored.\n");
+    goto file_close;
+  }
+  len = fread(ocsp_resp_cache_str, 1, (size_t)statbuf.st_size, pfile);
+  ocsp_resp_cache_str[len] = '\0';
+
+  file_cache = cJSON_Parse(ocsp_resp_cache_str);
+  if (file_cache == NULL)
+  {
+    infof(data, "Failed to parse cache file content in json format\n");
+    goto file_close;
+  }
+  if (ocsp_cache_root == NULL)
+  {
+    /* just attached the whole JSON object */
+    ocsp_cache_root = file_cache;
+    file_cache = NULL;
+  }
+  else
+  {
+    mergeCacheFileEntries(file_cache, data);
+  }
+  ocsp_cache_file_mtime = statbuf.st_mtime;
+  ocsp_cache_file_size = statbuf.st_size;
+  infof(data, "OCSP cache file was successfully loaded\n");
+
+file_close:
+  if (file_cache) cJSON_Delete(file_cache);
+  free(ocsp_resp_cache_str);
+  if (fclose(pfile) != 0)
+  {
+    infof(data, "Failed to close cache file. Ignored.\n");
+  }
+}
+
+/**
+ * Write OCSP cache onto a file in the cache directory. The file is written
+ * under a name of its own and renamed over the cache file, so other
+ * processes see either the old or the new file, never a partial one.
+ * @param data curl handle
+ */
+void writeOCSPCacheFile(struct Curl_easy* data)
+{
   char cache_file[PATH_MAX] = "";
-  char cache_lock_file[PATH_MAX] = "";
-  FILE *fh;
+  char tmp_file[PATH_MAX + 32] = "";
   FILE *fp;
-  char * jsonText;
+  char * jsonText = NULL;
+  cJSON *element_pointer = NULL;
+  cJSON *next = NULL;
+  cJSON *last_query_time = NULL;
+  struct stat statbuf;
+  int written;
+  unsigned long now = (unsigned long)time(NULL);
 
   _mutex_lock(&ocsp_response_cache_mutex);
   if (ocsp_cache_root == NULL)
@@ -1828,108 +2027,93 @@ void writeOCSPCacheFile(struct Curl_easy* data)
       infof(data, "Skipping writing OCSP cache file as no OCSP cache root exists.\n");
       goto end;
   }
+  if (!ocsp_cache_dirty)
+  {
+      infof(data, "Skipping writing OCSP cache file as it is up to date.\n");
+      goto end;
+  }
 
-  if (ensureCacheDir(cache_dir, data) == NULL)
+  if (getOCSPCacheFile(cache_file, data) == NULL)
   {
     failf(data, "The cache file is not accessible.\n");
     goto end;
   }
 
-  /* cache file */
-  strcpy(cache_file, cache_dir);
-  strcat(cache_file, PATH_SEP);
-  strcat(cache_file, OCSP_RESPONSE_CACHE_JSON);
-  infof(data, "OCSP Cache file: %s\n", cache_file);
+  /* keep the entries other processes have written since we read the file */
+  loadOCSPCacheFile(cache_file, data);
 
-  /* cache lock directory/file */
-  strcpy(cache_lock_file, cache_file);
-  strcat(cache_lock_file, ".lck");
-
-  if (access(cache_lock_file, F_OK) != -1)
+  /* expired entries are of no use to any process */
+  element_pointer = ocsp_cache_root->child;
+  while (element_pointer != NULL)
   {
-    /* lck file exists */
-    struct stat statbuf;
-    if (stat(cache_lock_file, &statbuf) != -1)
+    next = element_pointer->next;
+    last_query_time = cJSON_GetArrayItem(element_pointer, 0);
+    if (!cJSON_IsNumber(last_query_time) ||
+        now - (long)last_query_time->valuedouble >= (unsigned long)getOCSPCacheTTL())
     {
-      if ((long)time(NULL) - (long) statbuf.st_mtime < 60*60)
-      {
-        infof(data, "Other process lock the file, ignored\n");
-        goto end;
-      }
-      else
-      {
-        infof(data, "Remove the old lock file\n");
-        if (remove(cache_lock_file) != 0)
-        {
-          infof(data, "Failed to delete the lock file: %s, ignored\n", cache_lock_file);
-          goto end;
-        }
-      }
+      cJSON_Delete(cJSON_DetachItemViaPointer(ocsp_cache_root, element_pointer));
     }
+    element_pointer = next;
   }
 
-  /* create a new lck file */
-  fh = fopen(cache_lock_file, "w");
-  if (fh == NULL)
-  {
-    infof(data, "Failed to create a lock file: %s. Skipping writing OCSP cache file.\n",
-        cache_lock_file);
-    goto end;
-  }
-  if (fclose(fh) != 0)
-  {
-    infof(data, "Failed to close a lock file: %s. Ignored.\n", cache_lock_file);
-    goto end;
-  }
-
-  fp = fopen(cache_file, "w");
+  snprintf(tmp_file, sizeof(tmp_file), "%s.%d.tmp", cache_file, (int)getpid());
+  fp = fopen(tmp_file, "wb");
   if (fp == NULL)
   {
     infof(data, "Failed to open OCSP response cache file. Skipping writing OCSP cache file.\n");
     goto end;
   }
   jsonText = cJSON_PrintUnformatted(ocsp_cache_root);
-  if (fprintf(fp, "%s", jsonText) < 0)
+  written = jsonText != NULL && fputs(jsonText, fp) >= 0;
+  if (fclose(fp) != 0)
+  {
+    written = 0;
+  }
+  if (!written)
   {
     infof(data, "Failed to write OCSP response cache file. Skipping\n");
+    remove(tmp_file);
+    goto end;
   }
 
-  if (fclose(fp) != 0)
+#ifdef _WIN32
+  if (!MoveFileExA(tmp_file, cache_file, MOVEFILE_REPLACE_EXISTING))
+#else
+  if (rename(tmp_file, cache_file) != 0)
+#endif
   {
-    infof(data, "Failed to close OCSP response cache file: %s. Ignored\n", cache_file);
+    infof(data, "Failed to replace OCSP response cache file: %s. Ignored\n", cache_file);
+    remove(tmp_file);
+    goto end;
   }
   infof(data, "Write OCSP Response to cache file\n");
 
-  /* deallocate json string */
-  cJSON_free(jsonText);
-
-  if (remove(cache_lock_file) != 0)
+  ocsp_cache_dirty = 0;
+  if (stat(cache_file, &statbuf) == 0)
   {
-    infof(data, "Failed to delete the lock file: %s, ignored\n", cache_lock_file);
+    ocsp_cache_file_mtime = statbuf.st_mtime;
+    ocsp_cache_file_size = statbuf.st_size;
   }
+
 end:
-  if (ocsp_cache_root != NULL)
-  {
-    cJSON_Delete(ocsp_cache_root);
-    ocsp_cache_root = NULL;
-  }
+  /* deallocate json string */
+  if (jsonText) cJSON_free(jsonText);
   _mutex_unlock(&ocsp_response_cache_mutex);
 }
 
 /**
- * Read OCSP cache from from the local cache directory
+ * Read OCSP cache from from the local cache directory. The cache stays in
+ * memory across connections and is refreshed only when the cache file
+ * changes.
  * @param data curl handle
  */
 void readOCSPCacheFile(struct Curl_easy* data, SF_OTD *ocsp_log_data)
 {
-  char cache_dir[PATH_MAX] = "";
   char cache_file[PATH_MAX] = "";
-  char ocsp_resp_cache_str[20 * 1200]; /* TODO: malloc? */
-  FILE* pfile = NULL;
 
   _mutex_lock(&ocsp_response_cache_mutex);
 
-  if (ensureCacheDir(cache_dir, data) == NULL)
+  if (getOCSPCacheFile(cache_file, data) == NULL)
   {
     infof(data, "Could not ensure the presence of Cache Directory. "
                 "Skipping reading cache. Driver will try to download"
@@ -1938,57 +2122,14 @@ void readOCSPCacheFile(struct Curl_easy* data, SF_OTD *ocsp_log_data)
     goto end;
   }
 
-  /* cache file */
-  strcpy(cache_file, cache_dir);
-  strcat(cache_file, PATH_SEP);
-  strcat(cache_file, OCSP_RESPONSE_CACHE_JSON);
-  infof(data, "OCSP cache file: %s\n", cache_file);
-
-  if (ocsp_cache_root != NULL)
-  {
-    infof(data, "OCSP cache was already read onto memory\n");
-    goto end;
-  }
-  if (access(cache_file, F_OK) == -1)
-  {
-    infof(data, "No OCSP cache file found on disk. file: %s\n", cache_file);
-    sf_otd_set_event_sub_type(OCSP_CACHE_READ_FAILURE, ocsp_log_data);
-    goto end;
-  }
-
-  pfile = fopen(cache_file, "r");
-  if (pfile == NULL)
-  {
-    infof(data, "Failed to open OCSP response cache file. Ignored.\n");
-    sf_otd_set_event_sub_type(OCSP_CACHE_READ_FAILURE, ocsp_log_data);
-    goto end;
-  }
-
-  if (fgets(ocsp_resp_cache_str, sizeof(ocsp_resp_cache_str), pfile) == NULL) {
-    infof(data, "Failed to read OCSP response cache file. Ignored\n");
-    goto file_close;
-  }
-  /* just attached the whole JSON object */
-  ocsp_cache_root = cJSON_Parse(ocsp_resp_cache_str);
+  loadOCSPCacheFile(cache_file, data);
   if (ocsp_cache_root == NULL)
   {
-    infof(data, "Failed to parse cache file content in json format\n");
     sf_otd_set_event_sub_type(OCSP_CACHE_READ_FAILURE, ocsp_log_data);
   }
-  else
-  {
-    infof(data, "OCSP cache file was successfully loaded\n");
-  }
-file_close:
-  if (fclose(pfile) != 0)
-  {
-    infof(data, "Failed to close cache file. Ignored.\n");
-    goto end;
-  }
 end:
   if (ocsp_cache_root == NULL) ocsp_cache_root = cJSON_CreateObject();
   _mutex_unlock(&ocsp_response_cache_mutex);
-  return;
 }
 
 /**
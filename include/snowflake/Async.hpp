@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_ASYNC_HPP
+#define SNOWFLAKECLIENT_ASYNC_HPP
+
+#include <future>
+#include "client.h"
+
+namespace Snowflake {
+    namespace Client {
+        /**
+         * Executes a prepared statement without blocking. The query is submitted with
+         * snowflake_execute_async() and a single service thread of the process polls the
+         * status of all the queries submitted this way, so that many queries can run at
+         * once without a thread waiting for each. Once the query has finished, its results
+         * are fetched with snowflake_get_results() on a shared worker pool and the future
+         * becomes ready.
+         *
+         * Do not use the statement until the future is ready. The status of the queries is
+         * polled on their connection, whose error is overwritten meanwhile.
+         *
+         * @param sfstmt the prepared statement.
+         *
+         * @return the status of the execution, as snowflake_execute() would return it.
+         */
+        std::future<SF_STATUS> executeAsync(SF_STMT *sfstmt);
+
+        /**
+         * Takes the next chunk of the results with snowflake_fetch_chunk() on the shared
+         * worker pool, so that chunks can be consumed as they become ready. The same rules
+         * as for snowflake_fetch_chunk() apply.
+         *
+         * @param sfstmt the executed statement.
+         * @param chunk receives the chunk, or NULL at the end of the results, before the
+         *        future becomes ready.
+         * @param error receives the error of a failed fetch, NULL if not needed.
+         *
+         * @return the status of the fetch, SF_STATUS_EOF if no chunks are left.
+         */
+        std::future<SF_STATUS> fetchChunkAsync(SF_STMT *sfstmt, SF_RESULT_CHUNK **chunk,
+                                               SF_ERROR_STRUCT *error = nullptr);
+    }
+}
+
+#endif //SNOWFLAKECLIENT_ASYNC_HPP
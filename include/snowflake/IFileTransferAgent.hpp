@@ -14,6 +14,8 @@ namespace Snowflake
 namespace Client
 {
 
+#define DEFAULT_CREDENTIAL_REFRESH_SEC (30 * 60)
+
 /**
  * Config struct that is passed from external component
  */
@@ -23,11 +25,171 @@ struct TransferConfig
     caBundleFile(NULL),
     tempDir(NULL),
     useS3regionalUrl(false),
-    compressLevel(-1) {}
+    compressLevel(-1),
+    adaptiveCompressLevel(false),
+    compressThreads(1),
+    compressType(NULL),
+    decompressDownloads(false),
+    multipartBufferLimit(0),
+    digestCacheFile(NULL),
+    coalesceTargetSize(0),
+    checkpointFile(NULL),
+    maxConcurrency(0),
+    asyncIoBufferSize(0),
+    mapSourceFiles(false),
+    downloadCacheDir(NULL),
+    credentialRefreshSec(DEFAULT_CREDENTIAL_REFRESH_SEC),
+    useCurlS3Client(false),
+    composeGcsUploads(false) {}
   char * caBundleFile;
   char * tempDir;
   bool useS3regionalUrl;
+  // level of the auto compression, negative for the default of the type
   int compressLevel;
+  // move the level of the auto compression from file to file, lighter while
+  // compressing takes longer than uploading and heavier while uploading
+  // takes longer, starting from compressLevel. The level found carries over
+  // to the next PUT commands of the agent.
+  bool adaptiveCompressLevel;
+  // threads compressing a large file, 1 to compress it on the uploading thread.
+  // The gzip files compressed on several threads are also decompressed on as
+  // many threads when downloaded.
+  unsigned int compressThreads;
+  // auto compression type, "gzip" or "zstd", NULL for gzip
+  char * compressType;
+  // decompress downloaded .gz and .zst files, removing the extension
+  bool decompressDownloads;
+  // bytes of part buffers shared by the multipart uploads of a PUT,
+  // 0 for one part per upload thread
+  size_t multipartBufferLimit;
+  // local file caching the digests of the files uploaded, keyed by path,
+  // modification time and size, NULL for no cache
+  char * digestCacheFile;
+  // pack small auto compressed files into objects of up to this many bytes
+  // before compression, one file after another with a line break between
+  // them, 0 to upload each file on its own
+  size_t coalesceTargetSize;
+  // local file keeping the state of the multipart uploads not completed, so
+  // that a retried or restarted PUT of the same data resumes from the parts
+  // already uploaded, NULL for no checkpoints
+  char * checkpointFile;
+  // small files transferred at once at most, the number is tuned between 1
+  // and this by the throughput measured, starting from the parallelism given
+  // by the server and backing off when the storage throttles the requests.
+  // 0 to always transfer as many at once as given by the server.
+  unsigned int maxConcurrency;
+  // bytes of each of the buffers reading ahead the local files uploaded and
+  // writing behind the files downloaded, through io_uring on Linux where the
+  // kernel has it and overlapped I/O on Windows, 0 to read and write the local
+  // files with file streams
+  size_t asyncIoBufferSize;
+  // read the files uploaded above the multipart threshold mapped in memory,
+  // hashing and encrypting them without copying them out of the page cache.
+  // A file must not be truncated while it is uploaded then.
+  bool mapSourceFiles;
+  // local directory keeping a copy of the files downloaded by GET, keyed by
+  // their stage path and ETag. A file that hasn't changed on the stage is
+  // then hard linked or copied from there instead of downloaded again. The
+  // files hard linked are read only. NULL for no cache.
+  char * downloadCacheDir;
+  // seconds between renewals of the stage credentials in the background
+  // while a transfer is in progress, before they expire, for the storage
+  // clients that can take them without stopping the transfers. 0 to only
+  // renew the credentials once a request finds them expired.
+  unsigned int credentialRefreshSec;
+  // send the requests to S3 stages through the pooled curl handles of the
+  // library, signed by the client itself, instead of through the AWS SDK.
+  // The connections and TLS sessions are then shared with the rest of the
+  // process and no SDK is initialized, large files are downloaded in a
+  // single GET.
+  bool useCurlS3Client;
+  // upload the files above the multipart threshold to GCS stages given an
+  // access token in components at once, each retried on its own, and compose
+  // them into the file. The statement must implement http_post() and
+  // http_delete(). Files are otherwise uploaded in one request.
+  bool composeGcsUploads;
+};
+
+/**
+ * In memory file uploaded by PUT, see IFileTransferAgent::setUploadStreams
+ */
+struct UploadStream
+{
+  UploadStream() : stream(NULL), size(0) {}
+  // name of the file on the stage
+  std::string name;
+  // data of the file, gzip compressed, or compressed as it is uploaded if
+  // the command has AUTO_COMPRESS (NOT OWN)
+  std::basic_iostream<char> * stream;
+  // data size of the stream
+  size_t size;
+  // base64 encoded SHA-256 digest of the data, empty for the stream to be
+  // read once to calculate it and rewound. Unused for the data compressed
+  // by the upload, whose digest is calculated as it is compressed
+  std::string digest;
+};
+
+/**
+ * Told about the files of a put/get command started by
+ * IFileTransferAgent::executeAsync as they complete, on the threads
+ * transferring them, so possibly from several threads at once
+ */
+class ITransferListener
+{
+public:
+  virtual ~ITransferListener() {};
+
+  /**
+   * Called once for each file of the command when it is over, e.g. to load
+   * the files uploaded while the others are still transferring.
+   * @param srcFileName the local file for PUT, the stage path for GET
+   * @param destFileName name of the file on the stage for PUT, of the local
+   *        file for GET
+   * @param status status of the file in the result, e.g. UPLOADED, SKIPPED
+   *        or ERROR
+   * @param completedFiles files of the command over so far, this one included
+   * @param totalFiles files of the command
+   */
+  virtual void onFileCompleted(const std::string &srcFileName,
+                               const std::string &destFileName,
+                               const std::string &status,
+                               size_t completedFiles, size_t totalFiles) = 0;
+};
+
+/**
+ * Put/get command running in the background, see
+ * IFileTransferAgent::executeAsync. Deleting the handle waits for the
+ * command to be over.
+ */
+class ITransferHandle
+{
+public:
+  virtual ~ITransferHandle() {};
+
+  /**
+   * Wait for the command to be over, from one thread at a time
+   * @return result of the command, owned by the transfer agent as the one
+   *         of execute()
+   * @throw SnowflakeTransferException as execute() does
+   */
+  virtual ITransferResult *wait() = 0;
+
+  /**
+   * @return true once the command is over, wait() returns at once then
+   */
+  virtual bool isDone() = 0;
+
+  /**
+   * @param completedFiles set to the files over so far
+   * @param totalFiles set to the files of the command, 0 until they are listed
+   */
+  virtual void getProgress(size_t &completedFiles, size_t &totalFiles) = 0;
+
+  /**
+   * Skip the files not started yet, which end up SKIPPED in the result. The
+   * files transferring go on until they are over.
+   */
+  virtual void cancel() = 0;
 };
 
 class IFileTransferAgent
@@ -41,6 +203,23 @@ public:
    */
   virtual ITransferResult *execute(std::string *command) = 0;
 
+  /**
+   * Start a put/get command on a thread of its own and return at once, so
+   * that the caller can go on, e.g. producing the next files, meanwhile.
+   * The agent must not be given another command until the handle is
+   * deleted.
+   * @param command put/get command, kept until the command is over (NOT OWN)
+   * @param listener told about the files as they complete, NULL for none
+   *        (NOT OWN)
+   * @return handle of the command, caller need to delete it. NULL if the
+   *         agent can't run commands in the background
+   */
+  virtual ITransferHandle *executeAsync(std::string *command,
+                                        ITransferListener *listener)
+  {
+    return NULL;
+  }
+
   /**
   * Set upload stream to enable upload file from stream in memory.
   * @param uploadStream The stream to be uploaded.
@@ -48,6 +227,23 @@ public:
   */
   virtual void setUploadStream(std::basic_iostream<char>* uploadStream,
                                size_t dataSize) = 0;
+
+  /**
+  * Set download stream to make GET write the files to it instead of the
+  * local directory. The files are decrypted, decompressed if the transfer
+  * config asks for it, and written one after the other in the order of the
+  * result. A file that fails may leave part of its data in the stream.
+  * @param downloadStream The stream to write downloaded data to (NOT OWN).
+  */
+  virtual void setDownloadStream(std::basic_ostream<char>* downloadStream){};
+
+  /**
+  * Set several streams to be uploaded by PUT instead of the local files, in
+  * parallel like the local files are. The file names of the PUT command are
+  * replaced by the names of the streams.
+  * @param uploadStreams The streams to be uploaded, empty to upload files.
+  */
+  virtual void setUploadStreams(const std::vector<UploadStream>& uploadStreams){};
   /**
    * Static method to instantiate a IFileTransferAgent class
    * @return a newly allocated IFileTransferAgent, caller need to delete instance
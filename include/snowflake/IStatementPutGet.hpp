@@ -59,6 +59,8 @@ public:
   * @param payload The upload data.
   * @param responseHeaders The headers of the response.
   * @param headerOnly True if get response header only without payload body.
+  * Large files are downloaded in parts on several threads at once, each
+  * request with a "Range: bytes=<first>-<last>" header.
   *
   * return true if succeed otherwise false
   */
@@ -71,6 +73,50 @@ public:
     return false;
   }
 
+  /**
+  * PUT on GCS uses this interface to compose a large file from the
+  * components uploaded at once with http_put(), see
+  * TransferConfig::composeGcsUploads. Not implemented by default.
+  * @param url The url of the request.
+  * @param headers The headers of the request.
+  * @param body The body of the request, JSON.
+  * @param responseHeaders The headers of the response.
+  * @param responseBody The body of the response.
+  *
+  * return true if succeed otherwise false
+  */
+  virtual bool http_post(std::string const& url,
+                         std::vector<std::string> const& headers,
+                         std::string const& body,
+                         std::string& responseHeaders,
+                         std::string& responseBody)
+  {
+    return false;
+  }
+
+  /**
+  * PUT on GCS uses this interface to delete the components of a large file
+  * once composed. Not implemented by default.
+  * @param url The url of the request.
+  * @param headers The headers of the request.
+  *
+  * return true if succeed otherwise false
+  */
+  virtual bool http_delete(std::string const& url,
+                           std::vector<std::string> const& headers)
+  {
+    return false;
+  }
+
+  /**
+   * Parent of the spans of the transfer phases, see SF_TRACE_SPAN.
+   * NULL by default, for no spans.
+   */
+  virtual const SF_TRACE_CONTEXT *traceContext()
+  {
+    return nullptr;
+  }
+
   virtual ~IStatementPutGet()
   {
 
@@ -12,6 +12,58 @@ namespace Snowflake
 namespace Client
 {
 
+/**
+ * Sizes, timings and retries of the transfer of a file, or summed over all
+ * the files of a command. Times are in milliseconds.
+ */
+struct TransferMetrics
+{
+  TransferMetrics() :
+    rawBytes(0),
+    compressedBytes(0),
+    transferredBytes(0),
+    enumerateMs(0),
+    compressMs(0),
+    hashMs(0),
+    transferMs(0),
+    elapsedMs(0),
+    retries(0),
+    parts(0) {}
+
+  /// bytes of the data given to PUT, before compression, 0 for GET
+  long long rawBytes;
+
+  /// bytes of the data uploaded by PUT after compression, before encryption,
+  /// 0 for GET
+  long long compressedBytes;
+
+  /// encrypted bytes sent to or received from the storage
+  long long transferredBytes;
+
+  /// listing the files and getting their sizes, locally for PUT and from the
+  /// storage for GET, only in the totals of a command
+  long long enumerateMs;
+
+  /// compressing, with the digest calculated along
+  long long compressMs;
+
+  /// calculating the digest of the data not compressed by PUT
+  long long hashMs;
+
+  /// sending or receiving the data with all the attempts, with the
+  /// encryption or decryption streamed along
+  long long transferMs;
+
+  /// time the whole command took, only in the totals of a command
+  long long elapsedMs;
+
+  /// attempts after the first one, of the files and of their parts
+  unsigned int retries;
+
+  /// parts the data was sent or received in, 1 without multipart transfer
+  unsigned int parts;
+};
+
 /**
  * Interface consumed by external component to get transfer result
  *
@@ -60,6 +112,23 @@ public:
    * @return column index given column name
    */
   virtual int findColumnByName(const char *columnName, int columnNameSize) = 0;
+
+  /**
+   * @return metrics of the file of the current result, see next()
+   */
+  virtual TransferMetrics getMetrics()
+  {
+    return TransferMetrics();
+  }
+
+  /**
+   * @return metrics summed over all the files of the command. The transfer
+   * times of files transferred at once add up to more than the elapsed time.
+   */
+  virtual TransferMetrics getTotalMetrics()
+  {
+    return TransferMetrics();
+  }
 };
 }
 }
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_ROWS_HPP
+#define SNOWFLAKECLIENT_ROWS_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include "client.h"
+#include "Exceptions.hpp"
+
+namespace Snowflake {
+    namespace Client {
+        /**
+         * A value that can be NULL, for the columns read as Nullable<T>.
+         */
+        template <typename T>
+        struct Nullable {
+            bool isNull;
+            T value;
+
+            Nullable() : isNull(true), value() {}
+        };
+
+        /**
+         * Scratch memory the readers of a result share, kept for the whole iteration.
+         */
+        struct CellScratch {
+            char *buffer;
+            size_t size;
+
+            CellScratch() : buffer(NULL), size(0) {}
+
+            CellScratch(CellScratch &&other) : buffer(other.buffer), size(other.size) {
+                other.buffer = NULL;
+                other.size = 0;
+            }
+
+            ~CellScratch() {
+                // Allocated by snowflake_column_as_str(), see its documentation
+                free(buffer);
+            }
+
+        private:
+            CellScratch(const CellScratch &);
+
+            CellScratch &operator=(const CellScratch &);
+        };
+
+        /**
+         * Reads the cells of a column as T. Each supported type specializes it with:
+         *
+         *   - accepts(), whether a column of the Snowflake type converts to T. Checked once
+         *     for every column, before the first row.
+         *   - read(), which reads the cell of the current row with the C API function of T.
+         */
+        template <typename T>
+        struct CellReader;
+
+        template <>
+        struct CellReader<bool> {
+            static bool accepts(SF_DB_TYPE type) {
+                return type == SF_DB_TYPE_BOOLEAN || type == SF_DB_TYPE_FIXED ||
+                       type == SF_DB_TYPE_TEXT;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, bool &value) {
+                sf_bool cell = SF_BOOLEAN_FALSE;
+                SF_STATUS status = snowflake_column_as_boolean(sfstmt, idx, &cell);
+                value = cell != SF_BOOLEAN_FALSE;
+                return status;
+            }
+        };
+
+        template <>
+        struct CellReader<int32> {
+            static bool accepts(SF_DB_TYPE type) {
+                return type == SF_DB_TYPE_FIXED || type == SF_DB_TYPE_BOOLEAN ||
+                       type == SF_DB_TYPE_TEXT;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, int32 &value) {
+                return snowflake_column_as_int32(sfstmt, idx, &value);
+            }
+        };
+
+        template <>
+        struct CellReader<int64> {
+            static bool accepts(SF_DB_TYPE type) {
+                return CellReader<int32>::accepts(type);
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, int64 &value) {
+                return snowflake_column_as_int64(sfstmt, idx, &value);
+            }
+        };
+
+        template <>
+        struct CellReader<uint64> {
+            static bool accepts(SF_DB_TYPE type) {
+                return CellReader<int32>::accepts(type);
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, uint64 &value) {
+                return snowflake_column_as_uint64(sfstmt, idx, &value);
+            }
+        };
+
+        template <>
+        struct CellReader<float64> {
+            static bool accepts(SF_DB_TYPE type) {
+                return type == SF_DB_TYPE_FIXED || type == SF_DB_TYPE_REAL ||
+                       type == SF_DB_TYPE_TEXT;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, float64 &value) {
+                return snowflake_column_as_float64(sfstmt, idx, &value);
+            }
+        };
+
+        template <>
+        struct CellReader<SF_TIMESTAMP> {
+            static bool accepts(SF_DB_TYPE type) {
+                return type == SF_DB_TYPE_DATE || type == SF_DB_TYPE_TIME ||
+                       type == SF_DB_TYPE_TIMESTAMP_LTZ || type == SF_DB_TYPE_TIMESTAMP_NTZ ||
+                       type == SF_DB_TYPE_TIMESTAMP_TZ;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, SF_TIMESTAMP &value) {
+                return snowflake_column_as_timestamp(sfstmt, idx, &value);
+            }
+        };
+
+        /**
+         * The raw text of the cell, valid until the next row is fetched. NULL for NULL cells.
+         */
+        template <>
+        struct CellReader<const char *> {
+            static bool accepts(SF_DB_TYPE) {
+                return true;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &, const char *&value) {
+                return snowflake_column_as_const_str(sfstmt, idx, &value);
+            }
+        };
+
+        /**
+         * The cell formatted as snowflake_column_as_str() does.
+         */
+        template <>
+        struct CellReader<std::string> {
+            static bool accepts(SF_DB_TYPE) {
+                return true;
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &scratch,
+                                  std::string &value) {
+                size_t len = 0;
+                SF_STATUS status = snowflake_column_as_str(sfstmt, idx, &scratch.buffer, &len,
+                                                           &scratch.size);
+                if (status == SF_STATUS_SUCCESS) {
+                    value.assign(scratch.buffer, len);
+                }
+                return status;
+            }
+        };
+
+        template <typename T>
+        struct CellReader<Nullable<T> > {
+            static bool accepts(SF_DB_TYPE type) {
+                return CellReader<T>::accepts(type);
+            }
+
+            static SF_STATUS read(SF_STMT *sfstmt, int idx, CellScratch &scratch,
+                                  Nullable<T> &value) {
+                sf_bool isNull = SF_BOOLEAN_FALSE;
+                SF_STATUS status = snowflake_column_is_null(sfstmt, idx, &isNull);
+                value.isNull = isNull != SF_BOOLEAN_FALSE;
+                value.value = T();
+                if (status != SF_STATUS_SUCCESS || value.isNull) {
+                    return status;
+                }
+                return CellReader<T>::read(sfstmt, idx, scratch, value.value);
+            }
+        };
+
+        namespace Detail {
+            // The column readers of a row, unrolled at compile time from the last column
+            template <size_t N, typename Row>
+            struct RowColumns {
+                static const size_t I = N - 1;
+                typedef typename std::tuple_element<I, Row>::type Cell;
+
+                static void validate(SF_COLUMN_DESC *desc) {
+                    RowColumns<I, Row>::validate(desc);
+                    if (!CellReader<Cell>::accepts(desc[I].type)) {
+                        throw std::invalid_argument(
+                          "Column " + std::to_string(I + 1) + " (" + desc[I].name +
+                          ") can not be read as the requested type");
+                    }
+                }
+
+                static SF_STATUS read(SF_STMT *sfstmt, CellScratch &scratch, Row &row) {
+                    SF_STATUS status = RowColumns<I, Row>::read(sfstmt, scratch, row);
+                    if (status != SF_STATUS_SUCCESS) {
+                        return status;
+                    }
+                    return CellReader<Cell>::read(sfstmt, (int) N, scratch, std::get<I>(row));
+                }
+            };
+
+            template <typename Row>
+            struct RowColumns<0, Row> {
+                static void validate(SF_COLUMN_DESC *) {}
+
+                static SF_STATUS read(SF_STMT *, CellScratch &, Row &) {
+                    return SF_STATUS_SUCCESS;
+                }
+            };
+        }
+
+        /**
+         * The rows of an executed statement, read as tuples of the given types, one per
+         * column from the first:
+         *
+         *   for (const auto &row : rows<int64, std::string, SF_TIMESTAMP>(sfstmt)) {
+         *       std::tie(id, name, ts) = row;
+         *   }
+         *
+         * The reader of each column is picked at compile time and checked against the column
+         * description once, when the rows are created, so that a type mismatch throws
+         * std::invalid_argument before any row is fetched. Iterating fetches the rows with
+         * snowflake_fetch(); a failed fetch or conversion throws SnowflakeException with the
+         * statement error. The rows can be iterated once.
+         */
+        template <typename... Ts>
+        class Rows {
+        public:
+            typedef std::tuple<Ts...> Row;
+
+            explicit Rows(SF_STMT *sfstmt) : m_stmt(sfstmt) {
+                static_assert(sizeof...(Ts) > 0, "Rows need at least one column");
+                if (!sfstmt) {
+                    throw std::invalid_argument("No statement to read the rows of");
+                }
+                int64 fields = snowflake_num_fields(sfstmt);
+                if (fields < 0 || (size_t) fields < sizeof...(Ts)) {
+                    throw std::invalid_argument(
+                      "The results have " + std::to_string(fields < 0 ? 0 : fields) +
+                      " columns, fewer than the requested types");
+                }
+                Detail::RowColumns<sizeof...(Ts), Row>::validate(snowflake_desc(sfstmt));
+            }
+
+            class iterator {
+            public:
+                typedef std::input_iterator_tag iterator_category;
+                typedef Row value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const Row *pointer;
+                typedef const Row &reference;
+
+                iterator() : m_rows(NULL) {}
+
+                explicit iterator(Rows *rows) : m_rows(rows) {
+                    fetch();
+                }
+
+                const Row &operator*() const {
+                    return m_rows->m_row;
+                }
+
+                const Row *operator->() const {
+                    return &m_rows->m_row;
+                }
+
+                iterator &operator++() {
+                    fetch();
+                    return *this;
+                }
+
+                bool operator==(const iterator &other) const {
+                    return m_rows == other.m_rows;
+                }
+
+                bool operator!=(const iterator &other) const {
+                    return m_rows != other.m_rows;
+                }
+
+            private:
+                void fetch() {
+                    SF_STATUS status = snowflake_fetch(m_rows->m_stmt);
+                    if (status == SF_STATUS_SUCCESS) {
+                        status = Detail::RowColumns<sizeof...(Ts), Row>::read(
+                          m_rows->m_stmt, m_rows->m_scratch, m_rows->m_row);
+                    }
+                    if (status == SF_STATUS_EOF) {
+                        m_rows = NULL;
+                    } else if (status != SF_STATUS_SUCCESS) {
+                        throw SnowflakeException(snowflake_stmt_error(m_rows->m_stmt));
+                    }
+                }
+
+                Rows *m_rows;
+            };
+
+            iterator begin() {
+                return iterator(this);
+            }
+
+            iterator end() {
+                return iterator();
+            }
+
+        private:
+            SF_STMT *m_stmt;
+            // Row the iterators point to, overwritten by each fetch
+            Row m_row;
+            CellScratch m_scratch;
+        };
+
+        /**
+         * @return the rows of the statement, read as the given types.
+         */
+        template <typename... Ts>
+        Rows<Ts...> rows(SF_STMT *sfstmt) {
+            return Rows<Ts...>(sfstmt);
+        }
+    }
+}
+
+#endif //SNOWFLAKECLIENT_ROWS_HPP
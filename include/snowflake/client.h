@@ -9,6 +9,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <time.h>
 #include "basic_types.h"
 #include "platform.h"
@@ -61,6 +62,78 @@ extern "C" {
  */
 #define SF_LOGIN_TIMEOUT 120
 
+/**
+ * Default number of chunk downloader threads
+ */
+#define SF_DEFAULT_CHUNK_DOWNLOADER_THREADS 2
+
+/**
+ * Default number of chunks the chunk downloader may prefetch ahead of the consumer
+ */
+#define SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS 4
+
+/**
+ * Default interval in milliseconds to wait before checking again on a query still in progress.
+ * The interval doubles after every check up to SF_DEFAULT_QUERY_POLL_MAX_INTERVAL.
+ */
+#define SF_DEFAULT_QUERY_POLL_MIN_INTERVAL 100
+
+/**
+ * Default longest interval in milliseconds between two checks on a query still in progress
+ */
+#define SF_DEFAULT_QUERY_POLL_MAX_INTERVAL 5000
+
+/**
+ * Default shortest and longest wait in milliseconds before a failed request is retried.
+ * The wait grows with every retry of the same request, with some randomness.
+ */
+#define SF_DEFAULT_RETRY_BACKOFF_BASE 100
+#define SF_DEFAULT_RETRY_BACKOFF_CAP 16000
+
+/**
+ * Default number of seconds an OCSP response in the on-disk cache is used for
+ */
+#define SF_DEFAULT_OCSP_RESPONSE_CACHE_TTL 432000
+
+/**
+ * Default bytes of responses and milliseconds per result kept by the result cache, see
+ * SF_GLOBAL_RESULT_CACHE_SIZE
+ */
+#define SF_DEFAULT_RESULT_CACHE_MAX_BYTES (64 * 1024 * 1024)
+#define SF_DEFAULT_RESULT_CACHE_TTL 10000
+
+/**
+ * Default number of bound values (rows times parameters) from which the rows bound to a
+ * statement are uploaded to a stage instead of being sent with the query
+ */
+#define SF_DEFAULT_BIND_UPLOAD_THRESHOLD 65280
+
+/**
+ * Default deflated bytes of the chunks a scrollable statement keeps in memory, see
+ * SF_STMT_SCROLLABLE
+ */
+#define SF_DEFAULT_SCROLL_CACHE_MEMORY_LIMIT (256 * 1024 * 1024)
+
+/**
+ * Chunk downloader thread count/fetch slots value that sizes the downloader
+ * from the chunk count and uncompressed chunk sizes in the query response
+ */
+#define SF_CHUNK_DOWNLOADER_AUTO 0
+
+/**
+ * Bounds in MB of the result chunk size asked for with SF_STMT_RESULT_CHUNK_SIZE, the ones of
+ * the CLIENT_RESULT_CHUNK_SIZE parameter. SF_RESULT_CHUNK_SIZE_AUTO picks a size that fits
+ * the chunk downloader memory limit and otherwise leaves it to the server.
+ */
+#define SF_RESULT_CHUNK_SIZE_MIN 48
+#define SF_RESULT_CHUNK_SIZE_MAX 160
+#define SF_RESULT_CHUNK_SIZE_AUTO 0
+
+/**
+ * Indicator of a NULL value in a column bound with snowflake_bind_column()
+ */
+#define SF_NULL_DATA (-1)
+
 /**
  * Snowflake Data types
  *
@@ -132,7 +205,8 @@ typedef enum SF_STATUS {
     SF_STATUS_ERROR_NULL_POINTER = 240022,
     SF_STATUS_ERROR_BUFFER_TOO_SMALL = 240023,
     SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT = 240024,
-    SF_STATUS_ERROR_OTHER = 240025
+    SF_STATUS_ERROR_OTHER = 240025,
+    SF_STATUS_ERROR_CHUNK_URL_EXPIRED = 240026
 } SF_STATUS;
 
 /**
@@ -213,9 +287,64 @@ typedef enum SF_ATTRIBUTE {
     SF_DIR_QUERY_URL_PARAM,
     SF_DIR_QUERY_TOKEN,
     SF_RETRY_ON_CURLE_COULDNT_CONNECT_COUNT,
-    SF_QUERY_RESULT_TYPE
+    SF_QUERY_RESULT_TYPE,
+    SF_CON_CHUNK_DOWNLOADER_THREADS,
+    SF_CON_CHUNK_DOWNLOADER_FETCH_SLOTS,
+    SF_CON_CHUNK_DOWNLOADER_MEMORY_LIMIT,
+    SF_CON_CHUNK_DOWNLOADER_MULTIPLEX,
+    SF_CON_CHUNK_STREAMING_DECODE,
+    SF_CON_CHUNK_DOWNLOADER_HEDGING,
+    SF_CON_QUERY_POLL_MIN_INTERVAL,
+    SF_CON_QUERY_POLL_MAX_INTERVAL,
+    SF_CON_RETRY_BACKOFF_BASE,
+    SF_CON_RETRY_BACKOFF_CAP,
+    SF_CON_POLL_RETRY_BACKOFF_BASE,
+    SF_CON_POLL_RETRY_BACKOFF_CAP,
+    SF_CON_CHUNK_RETRY_BACKOFF_BASE,
+    SF_CON_CHUNK_RETRY_BACKOFF_CAP,
+    SF_CON_RETRY_BUDGET,
+    SF_CON_BACKGROUND_TOKEN_RENEWAL,
+    SF_CON_REQUEST_COMPRESSION_THRESHOLD,
+    SF_CON_DESCRIBE_CACHE_SIZE,
+    SF_CON_CHUNK_SPILL_DIR,
+    SF_CON_CHUNK_DECODER_INFLATE,
+    SF_CON_CHUNK_COMPRESSED_PREFETCH,
+    SF_CON_RESULT_CHUNK_SIZE,
+    SF_CON_QUERY_PRIORITY,
+    SF_CON_TOKEN_CACHE_DIR,
+    SF_CON_JSON_TO_ARROW,
+    SF_CON_MEMORY_LIMIT,
+    SF_CON_STATEMENT_MEMORY_LIMIT
 } SF_ATTRIBUTE;
 
+/**
+ * Placement of the threads of the client, see SF_GLOBAL_THREAD_AFFINITY.
+ */
+typedef enum SF_THREAD_AFFINITY {
+    // Threads run wherever the OS schedules them
+    SF_THREAD_AFFINITY_NONE,
+    // Threads run on the CPUs of SF_GLOBAL_THREAD_CPUS
+    SF_THREAD_AFFINITY_CPU_SET,
+    // The threads of each chunk downloader, or of each file transfer, run on the CPUs of one
+    // NUMA node, among SF_GLOBAL_THREAD_CPUS if set, with the nodes taken in turn. Their
+    // buffers are then allocated on the node of the threads downloading into them, which
+    // the threads decoding them share.
+    SF_THREAD_AFFINITY_NUMA_LOCAL
+} SF_THREAD_AFFINITY;
+
+/**
+ * Pages backing the large buffers of the client, see SF_GLOBAL_HUGE_PAGES.
+ */
+typedef enum SF_HUGE_PAGES {
+    // Pages of the default size
+    SF_HUGE_PAGES_NONE,
+    // Transparent huge pages, as the kernel can find them
+    SF_HUGE_PAGES_TRANSPARENT,
+    // Huge pages reserved by the system, e.g. with vm.nr_hugepages, transparent ones when
+    // none are left
+    SF_HUGE_PAGES_EXPLICIT
+} SF_HUGE_PAGES;
+
 /**
  * Attributes for Snowflake global context.
  */
@@ -224,16 +353,155 @@ typedef enum SF_GLOBAL_ATTRIBUTE {
     SF_GLOBAL_CA_BUNDLE_FILE,
     SF_GLOBAL_SSL_VERSION,
     SF_GLOBAL_DEBUG,
-    SF_GLOBAL_OCSP_CHECK
+    SF_GLOBAL_OCSP_CHECK,
+    SF_GLOBAL_OCSP_RESPONSE_CACHE_DIR,
+    SF_GLOBAL_OCSP_RESPONSE_CACHE_TTL,
+    /*
+     * Budget of the threads doing I/O in the process, downloading result chunks and
+     * transferring files, as uint64, 0 for no limit. It is a soft limit: once the budget is
+     * used up, each statement or transfer still gets one thread so that it makes progress, so
+     * it can be exceeded by one thread per statement or transfer running.
+     */
+    SF_GLOBAL_MAX_IO_THREADS,
+    /*
+     * Bytes of memory in use by JSON result sets, result chunk downloads and the text of bound
+     * values, as uint64. Read only.
+     */
+    SF_GLOBAL_RESULT_SET_MEMORY,
+    SF_GLOBAL_CHUNK_DOWNLOAD_MEMORY,
+    SF_GLOBAL_BIND_MEMORY,
+    /*
+     * SF_USER_MEM_HOOKS that the memory above is allocated with instead of the global ones, or
+     * NULL to go back to those. calloc_fn is optional. They can only be changed while none of
+     * that memory is in use, e.g. right after snowflake_global_init().
+     */
+    SF_GLOBAL_RESULT_SET_MEM_HOOKS,
+    SF_GLOBAL_CHUNK_DOWNLOAD_MEM_HOOKS,
+    SF_GLOBAL_BIND_MEM_HOOKS,
+    /*
+     * Results of read only queries kept in the process for the same query sent again, from
+     * any connection, in the same session context and with the same binds, as uint64: the
+     * number of queries kept, 0 (the default) for no caching, the bytes of their responses
+     * kept at most, and the milliseconds a result is returned for. To be set before queries
+     * are executed. A cached result is the one of the query that produced it, with its query
+     * id, and later changes to the tables aren't seen until it expires.
+     */
+    SF_GLOBAL_RESULT_CACHE_SIZE,
+    SF_GLOBAL_RESULT_CACHE_MAX_BYTES,
+    SF_GLOBAL_RESULT_CACHE_TTL,
+    /*
+     * sf_bool, SF_BOOLEAN_TRUE to write the log from a background thread instead of the
+     * threads logging, see log_start_async(). Debug logging slows down the client much less
+     * that way, at the cost of messages below warnings being dropped when they come faster
+     * than they are written, and of the last ones being lost if the process crashes.
+     */
+    SF_GLOBAL_LOG_ASYNC,
+    /*
+     * SF_TRACE_EXPORTER that the spans of the logins, queries, result chunks and PUT/GET
+     * transfers are handed to as they end, or NULL (the default) for no tracing.
+     */
+    SF_GLOBAL_TRACE_EXPORTER,
+    /*
+     * SF_METRICS_SNAPSHOT of the counters and histograms of the client since the process
+     * started, filled in by snowflake_global_get_attribute(). Read only.
+     */
+    SF_GLOBAL_METRICS,
+    /*
+     * Queries in flight and result chunk GETs in flight at most per account and warehouse,
+     * across the connections of the process, as uint64, 0 (the default) for no limit. Queries
+     * and chunk downloads over the limit wait for their turn, taken by priority, see
+     * SF_QUERY_PRIORITY. A query is in flight from its request to its response, the time the
+     * server runs it included when it isn't asynchronous.
+     */
+    SF_GLOBAL_MAX_QUERIES,
+    SF_GLOBAL_MAX_CHUNK_DOWNLOADS,
+    /*
+     * SF_THREAD_AFFINITY placing the chunk downloader and decoder threads and the threads of
+     * the file transfers started afterwards, SF_THREAD_AFFINITY_NONE by default, and the list
+     * of CPUs they run on as a string such as "0-7,16-23", NULL for all. Only supported on
+     * Linux.
+     */
+    SF_GLOBAL_THREAD_AFFINITY,
+    SF_GLOBAL_THREAD_CPUS,
+    /*
+     * Seconds the host names resolved are kept, as int64, 60 by default, -1 for ever and 0
+     * not to keep them, and seconds an idle connection is reused for, 0 (the default) for the
+     * default of libcurl. The DNS cache, the TLS sessions and the connections are shared by
+     * all the requests of the process, of the connections and the chunk downloaders alike.
+     */
+    SF_GLOBAL_DNS_CACHE_TTL,
+    SF_GLOBAL_CONNECTION_MAX_AGE,
+    /*
+     * SF_HUGE_PAGES backing the buffers of 2MB or more of the result chunks, Arrow ones
+     * included, and of the parts of the file transfers, SF_HUGE_PAGES_NONE by default, which
+     * saves the faults and TLB misses of touching them page by page. Can only be changed
+     * while none of those buffers is in use, e.g. right after snowflake_global_init(). Only
+     * supported on Linux.
+     */
+    SF_GLOBAL_HUGE_PAGES
 } SF_GLOBAL_ATTRIBUTE;
 
 /**
  * Attributes for Snowflake statement context.
  */
 typedef enum SF_STMT_ATTRIBUTE {
-    SF_STMT_USER_REALLOC_FUNC
+    SF_STMT_USER_REALLOC_FUNC,
+    SF_STMT_CHUNK_DOWNLOADER_THREADS,
+    SF_STMT_CHUNK_DOWNLOADER_FETCH_SLOTS,
+    SF_STMT_UNORDERED_FETCH,
+    SF_STMT_CHUNK_DOWNLOADER_MEMORY_LIMIT,
+    SF_STMT_CHUNK_DOWNLOADER_MULTIPLEX,
+    SF_STMT_CHUNK_STREAMING_DECODE,
+    SF_STMT_CHUNK_DOWNLOADER_HEDGING,
+    SF_STMT_PARAMSET_SIZE,
+    SF_STMT_BIND_UPLOAD_THRESHOLD,
+    SF_STMT_MULTI_STMT_COUNT,
+    SF_STMT_QUERY_RESULT_FORMAT,
+    SF_STMT_QUERY_PARAMETERS,
+    SF_STMT_CHUNK_DECODER_INFLATE,
+    SF_STMT_CHUNK_COMPRESSED_PREFETCH,
+    SF_STMT_RESULT_CHUNK_SIZE,
+    SF_STMT_QUERY_PRIORITY,
+    SF_STMT_JSON_TO_ARROW,
+    SF_STMT_SCROLLABLE,
+    SF_STMT_SCROLL_CACHE_MEMORY_LIMIT,
+    SF_STMT_SCROLL_CACHE_DISK_LIMIT,
+    SF_STMT_MEMORY_LIMIT
 } SF_STMT_ATTRIBUTE;
 
+/**
+ * Priority of the queries and chunk downloads of a statement waiting for a slot, see
+ * SF_GLOBAL_MAX_QUERIES. The waiters of each priority get their turn in proportion 4:2:1,
+ * so that the high priority ones go first while the low priority ones still make progress.
+ */
+typedef enum SF_QUERY_PRIORITY {
+    SF_QUERY_PRIORITY_HIGH,
+    SF_QUERY_PRIORITY_NORMAL,
+    SF_QUERY_PRIORITY_LOW,
+    SF_QUERY_PRIORITY_COUNT
+} SF_QUERY_PRIORITY;
+
+/**
+ * Status of a query, as reported by snowflake_query_status().
+ */
+typedef enum SF_QUERY_STATUS {
+    SF_QUERY_STATUS_RUNNING,
+    SF_QUERY_STATUS_ABORTING,
+    SF_QUERY_STATUS_SUCCESS,
+    SF_QUERY_STATUS_FAILED_WITH_ERROR,
+    SF_QUERY_STATUS_ABORTED,
+    SF_QUERY_STATUS_QUEUED,
+    SF_QUERY_STATUS_FAILED_WITH_INCIDENT,
+    SF_QUERY_STATUS_DISCONNECTED,
+    SF_QUERY_STATUS_RESUMING_WAREHOUSE,
+    SF_QUERY_STATUS_QUEUED_REPAIRING_WAREHOUSE,
+    SF_QUERY_STATUS_RESTARTED,
+    SF_QUERY_STATUS_BLOCKED,
+    // The server has no record of the query yet, or it belongs to another session
+    SF_QUERY_STATUS_NO_DATA,
+    SF_QUERY_STATUS_UNKNOWN
+} SF_QUERY_STATUS;
+
 /**
  * Snowflake Error
  */
@@ -246,6 +514,34 @@ typedef struct SF_ERROR_STRUCT {
     char *file;
     int line;
 } SF_ERROR_STRUCT;
+/**
+ * Reusable curl handles of a connection
+ */
+typedef struct SF_CURL_POOL SF_CURL_POOL;
+
+/**
+ * Request headers shared by the requests of a connection
+ */
+typedef struct SF_HEADER_LIST SF_HEADER_LIST;
+
+/**
+ * Responses to statements kept to answer the same statements again
+ */
+typedef struct SF_RESPONSE_CACHE SF_RESPONSE_CACHE;
+
+/**
+ * Bytes a statement, or all the statements of a connection, hold in result chunks
+ * prefetched ahead of the consumer and in query request bodies, see SF_STMT_MEMORY_LIMIT.
+ * Charging a budget charges its parent too. Only accessed through the sf_memory_budget_*
+ * functions of the library.
+ */
+typedef struct SF_MEMORY_BUDGET {
+    // 0 for no limit, the bytes are still counted
+    uint64 limit;
+    volatile unsigned long long used;
+    struct SF_MEMORY_BUDGET *parent;
+} SF_MEMORY_BUDGET;
+
 /**
  * Snowflake database session context.
  */
@@ -269,6 +565,12 @@ typedef struct SF_CONNECT {
     char *timezone;
     char *service_name;
     char *query_result_format;
+    /**
+     * Session parameters as the responses of the server and
+     * snowflake_set_session_parameter() last left them, see
+     * snowflake_get_session_parameter(). A cJSON object of their values as text.
+     */
+    void *session_parameters;
 
     /* used when updating parameters */
     SF_MUTEX_HANDLE mutex_parameters;
@@ -282,6 +584,29 @@ typedef struct SF_CONNECT {
     // Session info
     char *token;
     char *master_token;
+    // Guards the tokens, which the token renewal thread replaces
+    SF_MUTEX_HANDLE mutex_token;
+    // Changes whenever the tokens are replaced. Guarded by mutex_token.
+    uint64 token_generation;
+    // Serializes the session renewals, so that the statements running on the connection when
+    // the session token expires renew it once
+    SF_MUTEX_HANDLE mutex_renew_session;
+    // When the session token is to be renewed, see sf_monotonic_time_ms()
+    unsigned long long token_renew_at_ms;
+    // Directory that the tokens are kept in for the next process connecting with the same
+    // account, user, role and objects, NULL to log in every time. The sessions cached are left
+    // open by snowflake_term() and expire on the server.
+    char *token_cache_dir;
+    // Cache file of the session and the objects it was opened with, see sf_token_cache_open()
+    char *token_cache_file;
+    char *token_cache_key;
+    // Renew the session token in a thread of the connection before it expires
+    sf_bool background_token_renewal;
+    SF_THREAD_HANDLE token_renewal_thread;
+    sf_bool token_renewal_started;
+    sf_bool token_renewal_stop;
+    SF_CRITICAL_SECTION_HANDLE token_renewal_lock;
+    SF_CONDITION_HANDLE token_renewal_cond;
 
     int64 login_timeout;
     int64 network_timeout;
@@ -299,6 +624,73 @@ typedef struct SF_CONNECT {
 
     int8 retry_on_curle_couldnt_connect_count;
 
+    // Chunk downloader defaults for statements created on this connection.
+    // SF_CHUNK_DOWNLOADER_AUTO sizes them from the query response.
+    uint64 chunk_downloader_threads;
+    uint64 chunk_downloader_fetch_slots;
+    // Byte budget for prefetched chunks, 0 for no budget
+    uint64 chunk_downloader_memory_limit;
+    // Size in MB of the result chunks the server is asked for, see SF_RESULT_CHUNK_SIZE_AUTO
+    uint64 result_chunk_size;
+    // Fetch chunks over multiplexed HTTP/2 connections from a single I/O thread
+    sf_bool chunk_downloader_multiplex;
+    // Consume Arrow chunks while they are being downloaded
+    sf_bool chunk_streaming_decode;
+    // Send a duplicate request for chunk downloads that are much slower than the others
+    sf_bool chunk_downloader_hedging;
+    // Decompress multiplexed chunk downloads on the decoder threads rather than in libcurl
+    sf_bool chunk_decoder_inflate;
+    // Keep the multiplexed chunks downloaded ahead compressed until the consumer gets close
+    sf_bool chunk_compressed_prefetch;
+    // Convert the JSON chunks to Arrow record batches on the chunk downloader threads
+    sf_bool json_to_arrow;
+    // Directory that JSON chunks are written to instead of waiting for the consumer once the
+    // memory budget is used up, NULL to wait
+    char *chunk_spill_dir;
+    // Memory all the statements of the connection hold, with its limit, and the default limit
+    // of each statement, see SF_CON_MEMORY_LIMIT. 0 for no limit.
+    SF_MEMORY_BUDGET memory_budget;
+    uint64 statement_memory_limit;
+    // Priority of the statements waiting for a query or chunk download slot
+    SF_QUERY_PRIORITY query_priority;
+    // Milliseconds between the checks on a query in progress, 0 as maximum to check right away
+    uint64 query_poll_min_interval;
+    uint64 query_poll_max_interval;
+    // Milliseconds to back off before retrying login and query requests, result polls and chunk
+    // downloads
+    uint64 retry_backoff_base;
+    uint64 retry_backoff_cap;
+    uint64 poll_retry_backoff_base;
+    uint64 poll_retry_backoff_cap;
+    uint64 chunk_retry_backoff_base;
+    uint64 chunk_retry_backoff_cap;
+    // Retries the requests of the connection may make while they keep failing, 0 for no limit
+    uint64 retry_budget;
+    volatile unsigned long long retry_tokens;
+    // Request bodies of at least this many bytes are sent gzip compressed, 0 to never compress
+    uint64 request_compression_threshold;
+    // Statements whose describe only responses are kept for the next describe of the same
+    // SQL text, 0 to always ask the server
+    uint64 describe_cache_size;
+    SF_RESPONSE_CACHE *describe_cache;
+    // Set once the temporary stage for uploaded binds has been created in the session
+    sf_bool bind_stage_created;
+    // Statement running the transaction commands, created with the first one
+    struct SF_STMT *control_stmt;
+    // Set by snowflake_trans_begin() until the next statement starts the transaction
+    sf_bool trans_begin_pending;
+    // Guards the control statement and the pending transaction
+    SF_MUTEX_HANDLE mutex_transaction;
+    // Curl handles kept between requests
+    SF_CURL_POOL *curl_pool;
+    // Header lists built for the current tokens, by accept type. Guarded by mutex_token, the
+    // generation changes whenever the lists are dropped.
+    SF_HEADER_LIST *header_cache[2];
+    uint64 header_generation;
+    // Thread opening connections ahead of the first requests, see snowflake_warmup()
+    SF_THREAD_HANDLE warmup_thread;
+    sf_bool warmup_started;
+
     // Error
     SF_ERROR_STRUCT error;
 } SF_CONNECT;
@@ -338,8 +730,68 @@ typedef struct SF_QUERY_RESULT_CAPTURE {
     char* capture_buffer;
     // Actual response size
     size_t actual_response_size;
+    // Set to only capture the response, e.g. to forward it. Its rows are skipped over rather
+    // than parsed and the statement has no results to fetch, only its query id, columns and
+    // statistics.
+    sf_bool capture_only;
 } SF_QUERY_RESULT_CAPTURE;
 
+/**
+ * Sizes of the hex trace and span ids, with the terminating null.
+ */
+#define SF_TRACE_ID_LEN 33
+#define SF_SPAN_ID_LEN 17
+
+/**
+ * Timed operation of the client, with the ids of the W3C trace context that OpenTelemetry
+ * uses, so that an exporter can pass spans on as they are. The spans of a query are children
+ * of its "query" span, and carry its query id and request id once they are known.
+ *
+ * Names: "login", "query", "query.request" (the query request up to its first response),
+ * "query.poll" (waiting for the query to complete), "query.first_row" (from the start of the
+ * query to its first row fetched), "chunk.download", "chunk.parse" (JSON chunks, on the
+ * downloader threads), "chunk.decode" (when snowflake_fetch moves to a chunk),
+ * "put_get.prepare", "put_get.upload" and "put_get.download".
+ */
+typedef struct SF_TRACE_SPAN {
+    const char *name;
+    char trace_id[SF_TRACE_ID_LEN];
+    char span_id[SF_SPAN_ID_LEN];
+    // Empty for the root span of a trace
+    char parent_span_id[SF_SPAN_ID_LEN];
+    // Nanoseconds since the Unix epoch
+    uint64 start_time_ns;
+    uint64 end_time_ns;
+    // Empty when not known
+    char sfqid[SF_UUID4_LEN];
+    char request_id[SF_UUID4_LEN];
+    // Index of the chunk and bytes transferred, -1 when they don't apply
+    int64 chunk_index;
+    int64 bytes;
+    SF_STATUS status;
+} SF_TRACE_SPAN;
+
+/**
+ * Span that other spans are started as children of.
+ */
+typedef struct SF_TRACE_CONTEXT {
+    char trace_id[SF_TRACE_ID_LEN];
+    char span_id[SF_SPAN_ID_LEN];
+    char sfqid[SF_UUID4_LEN];
+    char request_id[SF_UUID4_LEN];
+} SF_TRACE_CONTEXT;
+
+/**
+ * Called on the thread that ended the span, from any number of threads at once. The span is
+ * only valid during the call.
+ */
+typedef void (STDCALL *SF_TRACE_EXPORT_FN)(const SF_TRACE_SPAN *span, void *user_data);
+
+typedef struct SF_TRACE_EXPORTER {
+    SF_TRACE_EXPORT_FN export_fn;
+    void *user_data;
+} SF_TRACE_EXPORTER;
+
 /**
  * Chunk downloader context
  */
@@ -361,7 +813,11 @@ typedef struct SF_STMT {
     SF_CONNECT *connection;
     void *qrf;
     char *sql_text;
+    // Bytes allocated for sql_text, which the next prepare reuses if the text fits
+    size_t sql_text_size;
     void *result_set;
+    // Cell accessors of the query result format, bound when the result set is created
+    const void *rs_accessors;
     int64 chunk_rowcount;
     int64 total_rowcount;
     int64 total_fieldcount;
@@ -369,7 +825,20 @@ typedef struct SF_STMT {
     void *params;
     void *name_list;
     unsigned int params_len;
+    /**
+     * Scratch memory for the text of the bound values while a request is built. It is
+     * emptied after every request and kept until the statement is reset.
+     */
+    void *bind_arena;
+    // Arrow batch bound by snowflake_bind_arrow(), instead of params
+    void *arrow_binds;
     SF_COLUMN_DESC *desc;
+    /**
+     * Number of columns in desc and a fingerprint of the rowtype it was built from. Executing
+     * the statement again keeps desc if the rowtype has the same fingerprint.
+     */
+    int64 desc_count;
+    uint64 desc_fingerprint;
     SF_STATS *stats;
     void *stmt_attrs;
     sf_bool is_dml;
@@ -379,10 +848,357 @@ typedef struct SF_STMT {
      */
     void *(*user_realloc_func)(void*, size_t);
 
+    /**
+     * Chunk downloader thread count and prefetch depth.
+     * Inherited from the connection when the statement is created.
+     * A non-zero memory limit bounds the uncompressed size of prefetched
+     * chunks instead of their number.
+     */
+    uint64 chunk_downloader_threads;
+    uint64 chunk_downloader_fetch_slots;
+    uint64 chunk_downloader_memory_limit;
+
+    /**
+     * Size in MB of the result chunks the server is asked for, within
+     * SF_RESULT_CHUNK_SIZE_MIN and SF_RESULT_CHUNK_SIZE_MAX. Larger chunks
+     * suit bulk exports, smaller ones give the first rows sooner.
+     * SF_RESULT_CHUNK_SIZE_AUTO fits them in the memory limit.
+     */
+    uint64 result_chunk_size;
+
+    /**
+     * When set, chunks are fetched over multiplexed HTTP/2 connections by a
+     * single I/O thread and the downloader threads only decode them.
+     */
+    sf_bool chunk_downloader_multiplex;
+
+    /**
+     * When set, the rows of an Arrow chunk can be fetched as soon as their
+     * record batch has been received, instead of once the whole chunk has
+     * been downloaded.
+     */
+    sf_bool chunk_streaming_decode;
+
+    /**
+     * When set together with chunk_downloader_multiplex, a chunk download
+     * that takes longer than 95% of the recent ones gets a duplicate request
+     * and the first response wins.
+     */
+    sf_bool chunk_downloader_hedging;
+
+    /**
+     * When set together with chunk_downloader_multiplex, the gzip compressed
+     * chunk bodies are kept as received and inflated by the decoder threads,
+     * instead of by libcurl on the single I/O thread.
+     */
+    sf_bool chunk_decoder_inflate;
+
+    /**
+     * When set together with chunk_downloader_multiplex, the chunks downloaded
+     * ahead are kept as received, gzip compressed, and only decoded once the
+     * consumer is within one chunk per decoder thread of them. Implies
+     * chunk_decoder_inflate.
+     */
+    sf_bool chunk_compressed_prefetch;
+
+    /**
+     * When set, the JSON chunks are converted to Arrow record batches by the
+     * chunk downloader threads right after they are parsed, for
+     * snowflake_fetch_arrow_batch() and snowflake_export_result() to take
+     * as they are. Otherwise those convert each chunk as they get to it.
+     */
+    sf_bool json_to_arrow;
+
+    /**
+     * Turn of the queries and chunk downloads of the statement waiting for a
+     * slot, see SF_GLOBAL_MAX_QUERIES.
+     */
+    SF_QUERY_PRIORITY query_priority;
+
+    /**
+     * When set, the JSON chunks fetched are kept, deflated, for
+     * snowflake_fetch_absolute() and snowflake_fetch_relative() to scroll back
+     * to. Those over scroll_cache_memory_limit bytes are written to the chunk
+     * spill directory of the connection, up to scroll_cache_disk_limit bytes.
+     * A chunk not kept, e.g. an Arrow chunk, is fetched again from the results
+     * of the query when scrolled back to.
+     */
+    sf_bool scrollable;
+    uint64 scroll_cache_memory_limit;
+    uint64 scroll_cache_disk_limit;
+    // The chunks kept for scrolling, see scroll_cache.h
+    void *scroll_cache;
+
+    /**
+     * Memory the statement holds in the chunks prefetched ahead of the
+     * consumer and in its query request body, within its own limit and the one
+     * of the connection. Once either is reached the chunk downloader stops
+     * prefetching, or spills the JSON chunks to the chunk spill directory,
+     * until the consumer takes the chunks downloaded already. The chunk the
+     * consumer needs next is always downloaded. A request body over the limit
+     * fails the query with SF_STATUS_ERROR_OUT_OF_MEMORY.
+     */
+    SF_MEMORY_BUDGET memory_budget;
+
+    /**
+     * When set, snowflake_fetch moves on to whichever downloaded chunk is
+     * available instead of the next chunk in result order.
+     */
+    sf_bool unordered_fetch;
+
+    /**
+     * Index of the chunk the current row belongs to. See snowflake_chunk_index().
+     */
+    int64 chunk_index;
+
+    /**
+     * Index of the first chunk of the results, 0 unless the results were fetched with
+     * snowflake_get_results_from_chunk().
+     */
+    int64 result_start_chunk;
+
+    /**
+     * Number of rows bound to the statement, see SF_STMT_PARAMSET_SIZE. Once there are at
+     * least bind_upload_threshold bound values, they are uploaded to a temporary stage
+     * instead of being inlined in the query request. 0 disables the upload.
+     */
+    uint64 paramset_size;
+    uint64 bind_upload_threshold;
+
+    /**
+     * Number of statements in the SQL text, see SF_STMT_MULTI_STMT_COUNT. 0 lets the
+     * server accept any number of statements.
+     */
+    int64 multi_stmt_count;
+    // Comma separated query ids of the statements of a multi-statement query
+    char *multi_stmt_result_ids;
+    // Query id whose results snowflake_next_result() fetches next, NULL after the last one
+    const char *multi_stmt_next_id;
+
+    /**
+     * Session parameters sent with each query of the statement rather than set on the
+     * session, so that they cost no ALTER SESSION round trip and don't change the session.
+     * SF_STMT_QUERY_RESULT_FORMAT is the C_API_QUERY_RESULT_FORMAT, e.g. "ARROW_FORCE" or
+     * "JSON". SF_STMT_QUERY_PARAMETERS is the text of a JSON object of other parameters,
+     * with string, boolean or integer values, e.g. {"QUERY_TAG": "etl", "TIMEZONE": "UTC"}.
+     * NULL for those of the session, the default.
+     */
+    char *query_result_format;
+    char *query_parameters;
+
+    /**
+     * "query" span of the last execution, empty when tracing is off, with the time the
+     * execution started and whether its first row has been traced.
+     */
+    SF_TRACE_CONTEXT trace;
+    uint64 trace_start_ns;
+    sf_bool first_row_traced;
+
+    /**
+     * Conversion of the results on worker threads, see snowflake_materialize_columns().
+     */
+    void *materializer;
+
+    /**
+     * Cell snowflake_column_get_data() reads in pieces: its column, 0 if none, the
+     * total_row_index of its row and the number of bytes already read.
+     */
+    int get_data_column;
+    int64 get_data_row;
+    size_t get_data_offset;
+
+    /**
+     * Columns bound with snowflake_bind_column(), which stay bound across executions.
+     */
+    void *bound_columns;
+    size_t bound_column_count;
+
     SF_CHUNK_DOWNLOADER *chunk_downloader;
     SF_PUT_GET_RESPONSE *put_get_response;
 } SF_STMT;
 
+/**
+ * Result chunk context. A self-contained slice of a statement's result set that
+ * can be iterated independently of the statement and of other chunks, see
+ * snowflake_fetch_chunk(). Always release it with snowflake_chunk_term().
+ */
+typedef struct SF_RESULT_CHUNK {
+    // Statement the chunk belongs to. Used for column metadata and settings.
+    SF_STMT *sfstmt;
+    // Chunk index as in snowflake_chunk_index()
+    int64 chunk_index;
+    // Number of rows in the chunk
+    int64 row_count;
+    // Number of rows not yet visited by snowflake_chunk_next()
+    int64 remaining_rows;
+    void *result_set;
+    SF_ERROR_STRUCT error;
+} SF_RESULT_CHUNK;
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+/**
+ * Arrow C data interface, as specified by Apache Arrow. Shared by every
+ * library that implements the interface, hence the guard.
+ */
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    // Array type description
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+/**
+ * Output column of snowflake_fetch_batch(). Values of row i of the batch are
+ * written to element i of the buffers.
+ */
+typedef struct SF_BATCH_COLUMN {
+    // Column index, starting at 1
+    int idx;
+    // C type of the values. One of SF_C_TYPE_INT8, SF_C_TYPE_UINT8,
+    // SF_C_TYPE_INT64, SF_C_TYPE_UINT64, SF_C_TYPE_FLOAT64, SF_C_TYPE_BOOLEAN,
+    // SF_C_TYPE_TIMESTAMP or SF_C_TYPE_STRING.
+    SF_C_TYPE c_type;
+    // Array of max_rows values. For SF_C_TYPE_STRING, max_rows slots of
+    // value_size bytes each, holding null terminated strings.
+    void *values;
+    // Size of a string slot, the null terminator included. Longer strings are
+    // truncated. Only used for SF_C_TYPE_STRING.
+    size_t value_size;
+    // Optional array of max_rows full string lengths. Only used for
+    // SF_C_TYPE_STRING.
+    size_t *lengths;
+    // Optional bitmap of (max_rows + 7) / 8 bytes. Bit i (LSB first) is set if
+    // the value of row i is NULL, which is written as 0 or an empty string.
+    uint8 *null_bitmap;
+} SF_BATCH_COLUMN;
+
+/**
+ * Download telemetry of one result chunk. Times are in milliseconds since the
+ * chunk downloader was created. Fields of a chunk that is still in flight are
+ * left 0 until the corresponding step has happened.
+ */
+typedef struct SF_CHUNK_FETCH_STATS {
+    // When a downloader thread picked the chunk up
+    uint64 queued_ms;
+    // When the download started, after any prefetch throttling
+    uint64 download_start_ms;
+    // When the last byte of the chunk was received
+    uint64 download_end_ms;
+    // Size of the response body, after content decoding
+    uint64 bytes;
+    // Number of times the download was retried
+    uint64 retries;
+    // Time spent decoding the chunk into rows
+    uint64 decode_ms;
+    // Time the application spent waiting for the chunk to become ready
+    uint64 consumer_wait_ms;
+} SF_CHUNK_FETCH_STATS;
+
+/**
+ * Download telemetry of a statement's result set, see
+ * snowflake_stmt_get_fetch_stats(). Always release it with
+ * snowflake_fetch_stats_term().
+ */
+typedef struct SF_FETCH_STATS {
+    // Number of downloaded chunks, the first chunk inlined in the query response excluded
+    uint64 chunk_count;
+    // Per-chunk stats, in result set order
+    SF_CHUNK_FETCH_STATS *chunks;
+    uint64 total_bytes;
+    uint64 total_retries;
+    uint64 total_download_ms;
+    uint64 total_decode_ms;
+    uint64 total_consumer_wait_ms;
+} SF_FETCH_STATS;
+
+/**
+ * Counters of the client, see SF_GLOBAL_METRICS.
+ */
+typedef enum SF_METRIC_COUNTER {
+    // HTTP requests sent, retries included, and the retries alone
+    SF_COUNTER_HTTP_REQUESTS,
+    SF_COUNTER_HTTP_RETRIES,
+    // Session tokens renewed
+    SF_COUNTER_TOKEN_RENEWALS,
+    // Result chunks downloaded and the bytes of their bodies
+    SF_COUNTER_CHUNKS_DOWNLOADED,
+    SF_COUNTER_CHUNK_BYTES,
+    SF_COUNTER_COUNT
+} SF_METRIC_COUNTER;
+
+/**
+ * Histograms of the client in microseconds, see SF_GLOBAL_METRICS.
+ */
+typedef enum SF_METRIC_HISTOGRAM {
+    // Time of an HTTP request, its retries included
+    SF_HISTOGRAM_HTTP_REQUEST_TIME,
+    // Download and decode time of a result chunk, to the millisecond
+    SF_HISTOGRAM_CHUNK_DOWNLOAD_TIME,
+    SF_HISTOGRAM_CHUNK_DECODE_TIME,
+    // Time to write the bound values of a query into its request, or into the file of them
+    // uploaded to a stage
+    SF_HISTOGRAM_BIND_SERIALIZE_TIME,
+    // Time a query or a chunk download waited for a slot, see SF_GLOBAL_MAX_QUERIES
+    SF_HISTOGRAM_SCHEDULER_WAIT_TIME,
+    SF_HISTOGRAM_COUNT
+} SF_METRIC_HISTOGRAM;
+
+/**
+ * Buckets are exact up to 3 and have 4 per power of two above, so that a value is off by 25%
+ * at most. The last one holds everything from about 2 hours up.
+ * See snowflake_metrics_bucket_bound().
+ */
+#define SF_METRIC_BUCKET_COUNT 128
+
+typedef struct SF_METRIC_HISTOGRAM_VALUES {
+    uint64 count;
+    uint64 sum;
+    uint64 buckets[SF_METRIC_BUCKET_COUNT];
+} SF_METRIC_HISTOGRAM_VALUES;
+
+typedef struct SF_METRICS_SNAPSHOT {
+    uint64 counters[SF_COUNTER_COUNT];
+    SF_METRIC_HISTOGRAM_VALUES histograms[SF_HISTOGRAM_COUNT];
+    // Bytes in use by JSON result sets, result chunk downloads and bound values
+    uint64 result_set_memory;
+    uint64 chunk_download_memory;
+    uint64 bind_memory;
+} SF_METRICS_SNAPSHOT;
+
 /**
  * Bind input parameter context
  */
@@ -458,6 +1274,13 @@ SF_STATUS STDCALL snowflake_global_set_attribute(
 SF_STATUS STDCALL snowflake_global_get_attribute(
     SF_GLOBAL_ATTRIBUTE type, void *value, size_t size);
 
+/**
+ * @param bucket index of a bucket of SF_METRIC_HISTOGRAM_VALUES.
+ * @return the largest value counted in the bucket, e.g. to export it as a Prometheus
+ *         histogram. (uint64) -1 for the last bucket.
+ */
+uint64 STDCALL snowflake_metrics_bucket_bound(int bucket);
+
 /**
  * Initializes a SNOWFLAKE connection context
  *
@@ -473,6 +1296,170 @@ SF_CONNECT *STDCALL snowflake_init();
  */
 SF_STATUS STDCALL snowflake_term(SF_CONNECT *sf);
 
+/**
+ * Opens connections to Snowflake in the background, so that the login and the first queries
+ * don't wait for the host name to resolve, the TLS handshakes and the OCSP checks. Call it
+ * once the account or host is set, possibly before snowflake_connect().
+ *
+ * @param sf SNOWFLAKE context.
+ * @return 0 if the warm up started, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_warmup(SF_CONNECT *sf);
+
+/**
+ * Logs in several connections at once, e.g. to fill a pool of sessions. The logins run in
+ * parallel and share their HTTP connections, so that the host name is resolved and the TLS
+ * handshakes are made once for all of them, and they take about as long as a single login.
+ * The connections keep sharing their HTTP connections afterwards.
+ *
+ * @param connections connections ready for snowflake_connect(), with the same host.
+ * @param count the number of connections.
+ * @param max_concurrency the number of logins in flight at a time, 0 for all of them.
+ * @param statuses count statuses set to the result of each login, or NULL.
+ * @return SF_STATUS_SUCCESS if all the connections logged in, otherwise the status of the
+ *         first one that failed. The error of each login is in its connection.
+ */
+SF_STATUS STDCALL snowflake_connect_many(SF_CONNECT **connections, size_t count,
+                                         size_t max_concurrency, SF_STATUS *statuses);
+
+/**
+ * Pool of logged in sessions, shared by the threads of a process
+ */
+typedef struct SF_SESSION_POOL SF_SESSION_POOL;
+
+/**
+ * Creates a connection for a session pool: snowflake_init() followed by the attributes of the
+ * session. The pool logs it in.
+ *
+ * @param ctx the context passed to snowflake_session_pool_create().
+ * @return the connection, or NULL on failure.
+ */
+typedef SF_CONNECT *(*SF_SESSION_CREATE)(void *ctx);
+
+/**
+ * Creates a session pool and logs in its first sessions.
+ *
+ * @param create creates the connections of the pool.
+ * @param ctx passed to create.
+ * @param min_size the number of sessions logged in right away.
+ * @param max_size the largest number of sessions open at a time.
+ * @return the pool, or NULL on invalid arguments or when out of memory. Sessions that fail to
+ *         log in are left out, see snowflake_session_pool_error().
+ */
+SF_SESSION_POOL *STDCALL snowflake_session_pool_create(SF_SESSION_CREATE create, void *ctx,
+                                                      size_t min_size, size_t max_size);
+
+/**
+ * Takes a session from the pool. A session that has been idle for a while is checked with a
+ * heartbeat first, which renews its token if needed, and replaced if it fails. A new session
+ * is logged in if none is idle, and the call blocks if max_size sessions are out.
+ *
+ * @param pool the session pool.
+ * @return the session, or NULL if a new session failed to log in.
+ */
+SF_CONNECT *STDCALL snowflake_session_pool_checkout(SF_SESSION_POOL *pool);
+
+/**
+ * Gives a session back to the pool. Its role, warehouse, database and schema are switched
+ * back to the ones it was logged in with. Other session parameters are not reset.
+ *
+ * @param pool the session pool.
+ * @param sf a session taken with snowflake_session_pool_checkout().
+ */
+void STDCALL snowflake_session_pool_checkin(SF_SESSION_POOL *pool, SF_CONNECT *sf);
+
+/**
+ * @param pool the session pool.
+ * @return the error of the last login that failed.
+ */
+SF_ERROR_STRUCT *STDCALL snowflake_session_pool_error(SF_SESSION_POOL *pool);
+
+/**
+ * Closes the sessions of a pool and frees it. All sessions must have been checked in.
+ *
+ * @param pool the session pool.
+ */
+void STDCALL snowflake_session_pool_destroy(SF_SESSION_POOL *pool);
+
+/**
+ * A query of a fan-out, see snowflake_fanout_execute().
+ */
+typedef struct SF_FANOUT_QUERY {
+    const char *sql;
+    // Parameters bound with snowflake_bind_param_array(), NULL for none. They must stay valid
+    // until the fan-out is closed.
+    SF_BIND_INPUT *params;
+    size_t param_count;
+} SF_FANOUT_QUERY;
+
+#define SF_FANOUT_DEFAULT_CONCURRENCY 4
+
+typedef struct SF_FANOUT_OPTIONS {
+    // Queries run at a time, SF_FANOUT_DEFAULT_CONCURRENCY if 0. Each takes a session of the
+    // pool, and keeps it until the consumer is done with its results.
+    uint64 max_concurrency;
+    // Chunk downloader threads and fetch slots of each query, the ones of the connection if
+    // 0. The chunks are downloaded ahead while the results of the other queries are fetched.
+    uint64 chunk_downloader_threads;
+    uint64 chunk_downloader_fetch_slots;
+} SF_FANOUT_OPTIONS;
+
+/**
+ * Queries running concurrently over the sessions of a pool, with their results merged
+ */
+typedef struct SF_FANOUT SF_FANOUT;
+
+/**
+ * Starts running queries concurrently, typically the same query with the binds of different
+ * partitions, over sessions of a pool. Their rows are fetched with snowflake_fanout_fetch(),
+ * query after query in the order they complete.
+ *
+ * @param pool the session pool the queries take their sessions from.
+ * @param queries the queries, which must stay valid until the fan-out is closed.
+ * @param count the number of queries.
+ * @param options the options, NULL for the defaults.
+ * @return the fan-out, or NULL on invalid arguments or when out of memory.
+ */
+SF_FANOUT *STDCALL snowflake_fanout_execute(SF_SESSION_POOL *pool, const SF_FANOUT_QUERY *queries,
+                                            size_t count, const SF_FANOUT_OPTIONS *options);
+
+/**
+ * Fetches the next row of the fan-out. Its columns are read from snowflake_fanout_stmt() with
+ * the snowflake_column_as_* functions.
+ *
+ * @param fanout the fan-out.
+ * @return SF_STATUS_SUCCESS with a row, SF_STATUS_EOF once the rows of all the queries are
+ *         fetched, or the error of a query that failed, see snowflake_fanout_error(). The
+ *         next call goes on with the other queries.
+ */
+SF_STATUS STDCALL snowflake_fanout_fetch(SF_FANOUT *fanout);
+
+/**
+ * @param fanout the fan-out.
+ * @return the statement of the row fetched last, valid until the next fetch.
+ */
+SF_STMT *STDCALL snowflake_fanout_stmt(SF_FANOUT *fanout);
+
+/**
+ * @param fanout the fan-out.
+ * @return the index of the query of the row fetched last, or of the query that failed.
+ */
+size_t STDCALL snowflake_fanout_query_index(SF_FANOUT *fanout);
+
+/**
+ * @param fanout the fan-out.
+ * @return the error of the query that failed last.
+ */
+SF_ERROR_STRUCT *STDCALL snowflake_fanout_error(SF_FANOUT *fanout);
+
+/**
+ * Stops the fan-out, waiting for the queries running to complete, gives the sessions back to
+ * the pool and frees the fan-out. The queries not started yet are not run.
+ *
+ * @param fanout the fan-out.
+ */
+void STDCALL snowflake_fanout_close(SF_FANOUT *fanout);
+
 /**
  * Creates a new session and connects to Snowflake database.
  *
@@ -493,7 +1480,9 @@ SF_STATUS STDCALL snowflake_set_attribute(
     SF_CONNECT *sf, SF_ATTRIBUTE type, const void *value);
 
 /**
- * Gets the attribute value from the session.
+ * Gets the attribute value from the session. The current database, schema, warehouse and
+ * role are replaced by the response of every statement, see snowflake_get_current_object()
+ * to read them while statements run on the connection.
  *
  * @param sf SNOWFLAKE context.
  * @param type the attribute name type
@@ -504,7 +1493,68 @@ SF_STATUS STDCALL snowflake_get_attribute(
     SF_CONNECT *sf, SF_ATTRIBUTE type, void **value);
 
 /**
- * Creates sf SNOWFLAKE_STMT context.
+ * Copies the value of a session parameter as the client last saw it, in the responses of
+ * the server or set with snowflake_set_session_parameter(), without a round trip. The
+ * parameters the server returns are refreshed by every response and a statement other than
+ * a query or DML, e.g. an ALTER SESSION, forgets the others until they are set again.
+ *
+ * @param sf SNOWFLAKE context.
+ * @param name the name of the parameter, in any case.
+ * @param buffer the buffer the value is copied to as text, e.g. true or 10 for a boolean or
+ *        a number.
+ * @param buffer_size the size of the buffer.
+ * @return 0 if success, SF_STATUS_EOF if the value of the parameter isn't known,
+ *         SF_STATUS_ERROR_BUFFER_TOO_SMALL if it doesn't fit, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_get_session_parameter(SF_CONNECT *sf, const char *name,
+                                                  char *buffer, size_t buffer_size);
+
+/**
+ * Copies the name of the current database, schema, warehouse or role of the session, as of
+ * the last response. Unlike the value snowflake_get_attribute() returns, the copy stays valid
+ * while other statements run on the connection.
+ *
+ * @param sf SNOWFLAKE context.
+ * @param type SF_CON_DATABASE, SF_CON_SCHEMA, SF_CON_WAREHOUSE or SF_CON_ROLE.
+ * @param buffer the buffer the name is copied to.
+ * @param buffer_size the size of the buffer.
+ * @return 0 if success, SF_STATUS_EOF if there is no current object of the type,
+ *         SF_STATUS_ERROR_BUFFER_TOO_SMALL if it doesn't fit, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_get_current_object(SF_CONNECT *sf, SF_ATTRIBUTE type,
+                                               char *buffer, size_t buffer_size);
+
+/**
+ * Sets a session parameter with ALTER SESSION, unless the client knows it to have the value
+ * already, see snowflake_get_session_parameter(). A value that is a number, true or false is
+ * sent as is, any other value as a string.
+ *
+ * @param sf SNOWFLAKE context.
+ * @param name the name of the parameter, letters, digits and underscores.
+ * @param value the value.
+ * @return 0 if success, otherwise an errno is returned and the error of sf is set.
+ */
+SF_STATUS STDCALL snowflake_set_session_parameter(SF_CONNECT *sf, const char *name,
+                                                  const char *value);
+
+/**
+ * Switches the current database, schema, warehouse or role of the session with USE, unless
+ * it is the current one already. The current objects are the ones of the last response, as
+ * snowflake_get_attribute() returns them. The name is compared the way the server resolves
+ * it: an unquoted name in upper case, a quoted one as is.
+ *
+ * @param sf SNOWFLAKE context.
+ * @param type SF_CON_DATABASE, SF_CON_SCHEMA, SF_CON_WAREHOUSE or SF_CON_ROLE.
+ * @param name the name, as it would be written in the USE statement.
+ * @return 0 if success, otherwise an errno is returned and the error of sf is set.
+ */
+SF_STATUS STDCALL snowflake_use_object(SF_CONNECT *sf, SF_ATTRIBUTE type, const char *name);
+
+/**
+ * Creates sf SNOWFLAKE_STMT context. The statements of a connection may run in different
+ * threads at the same time: they share the session and its tokens, which are renewed once
+ * when they expire, while each statement has its own results and error. A statement itself
+ * is used by one thread at a time.
  *
  * @param sfstmt SNOWFLAKE_STMT context.
  */
@@ -528,7 +1578,9 @@ SF_STMT *STDCALL snowflake_stmt(SF_CONNECT *sf);
 void STDCALL snowflake_stmt_term(SF_STMT *sfstmt);
 
 /**
- * Begins a new transaction.
+ * Begins a new transaction. With autocommit, the transaction is started on the server right
+ * before the next statement of the connection runs, and one without statements is neither
+ * started nor ended on the server.
  *
  * @param sf SNOWFLAKE context.
  * @return 0 if success, otherwise an errno is returned.
@@ -607,6 +1659,17 @@ int64 STDCALL snowflake_affected_rows(SF_STMT *sfstmt);
  */
 int64 STDCALL snowflake_num_rows(SF_STMT *sfstmt);
 
+/**
+ * Returns the index of the result chunk the current row belongs to. Index 0 is
+ * the rowset returned with the query response, and index N is the N-th chunk
+ * listed in the response. Mostly useful with SF_STMT_UNORDERED_FETCH, where
+ * chunks are returned in completion order rather than result order.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @return the chunk index, or -1 if no row has been fetched.
+ */
+int64 STDCALL snowflake_chunk_index(SF_STMT *sfstmt);
+
 /**
  * Returns the number of fields in the result set.
  *
@@ -631,6 +1694,105 @@ const char *STDCALL snowflake_sqlstate(SF_STMT *sfstmt);
  */
 SF_COLUMN_DESC *STDCALL snowflake_desc(SF_STMT *sfstmt);
 
+/**
+ * Takes the next chunk of the result set of an executed statement. Unlike
+ * snowflake_fetch(), this may be called from several threads at once on the
+ * same statement; each call hands out a different chunk, which the calling
+ * thread can then iterate with snowflake_chunk_next() and the
+ * snowflake_chunk_column_* functions without further synchronization.
+ *
+ * Chunks are handed out in result order unless SF_STMT_UNORDERED_FETCH is set.
+ * Do not mix this with snowflake_fetch() on the same statement, and release
+ * every chunk before the statement is reused or terminated.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param chunk receives the chunk, or NULL at the end of the result set.
+ * @param error receives the error of a failed call, NULL if not needed. The
+ * error of the statement isn't set, as other threads may be fetching from it.
+ * @return 0 if success, SF_STATUS_EOF if no chunks are left, otherwise an
+ * errno is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_chunk(SF_STMT *sfstmt, SF_RESULT_CHUNK **chunk,
+                                        SF_ERROR_STRUCT *error);
+
+/**
+ * Moves to the next row of a chunk. Must be called before reading the first row.
+ *
+ * @param chunk SF_RESULT_CHUNK context.
+ * @return 0 if success, SF_STATUS_EOF if no rows are left, otherwise an errno
+ * is returned.
+ */
+SF_STATUS STDCALL snowflake_chunk_next(SF_RESULT_CHUNK *chunk);
+
+/**
+ * Releases a chunk returned by snowflake_fetch_chunk().
+ *
+ * @param chunk SF_RESULT_CHUNK context.
+ */
+void STDCALL snowflake_chunk_term(SF_RESULT_CHUNK *chunk);
+
+/**
+ * Returns the error context of a chunk.
+ *
+ * @param chunk SF_RESULT_CHUNK context.
+ * @return error context.
+ */
+SF_ERROR_STRUCT *STDCALL snowflake_chunk_error(SF_RESULT_CHUNK *chunk);
+
+/**
+ * Column accessors for the current row of a chunk. They behave like the
+ * snowflake_column_* functions of the same name.
+ */
+SF_STATUS STDCALL snowflake_chunk_column_as_boolean(SF_RESULT_CHUNK *chunk, int idx, sf_bool *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_uint8(SF_RESULT_CHUNK *chunk, int idx, uint8 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_uint32(SF_RESULT_CHUNK *chunk, int idx, uint32 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_uint64(SF_RESULT_CHUNK *chunk, int idx, uint64 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_int8(SF_RESULT_CHUNK *chunk, int idx, int8 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_int32(SF_RESULT_CHUNK *chunk, int idx, int32 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_int64(SF_RESULT_CHUNK *chunk, int idx, int64 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_float32(SF_RESULT_CHUNK *chunk, int idx, float32 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_float64(SF_RESULT_CHUNK *chunk, int idx, float64 *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_timestamp(SF_RESULT_CHUNK *chunk, int idx, SF_TIMESTAMP *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_const_str(SF_RESULT_CHUNK *chunk, int idx, const char **value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_str(SF_RESULT_CHUNK *chunk, int idx, char **value_ptr,
+                                                size_t *value_len_ptr, size_t *max_value_size_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_strlen(SF_RESULT_CHUNK *chunk, int idx, size_t *value_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_as_binary(SF_RESULT_CHUNK *chunk, int idx, const void **value_ptr,
+                                                   size_t *value_len_ptr);
+
+SF_STATUS STDCALL snowflake_chunk_column_is_null(SF_RESULT_CHUNK *chunk, int idx, sf_bool *value_ptr);
+
+/**
+ * Takes a snapshot of the download telemetry of the current result set. It can
+ * be called at any time while the result set is being fetched.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param stats receives the snapshot. Its chunk_count is 0 if the result set
+ *        was not split into chunks.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_stmt_get_fetch_stats(SF_STMT *sfstmt, SF_FETCH_STATS **stats);
+
+/**
+ * Releases a snapshot returned by snowflake_stmt_get_fetch_stats().
+ *
+ * @param stats SF_FETCH_STATS context.
+ */
+void STDCALL snowflake_fetch_stats_term(SF_FETCH_STATS *stats);
+
 /**
  * Prepares a statement.
  *
@@ -673,7 +1835,81 @@ snowflake_stmt_get_attr(SF_STMT *sfstmt, SF_STMT_ATTRIBUTE type, void **value);
 SF_STATUS STDCALL snowflake_execute(SF_STMT *sfstmt);
 
 /**
- * Executes a statement with capture.
+ * Submits a statement without waiting for it to finish. The query id is available from
+ * snowflake_sfqid() once the call returns. Poll snowflake_query_status() until the query is
+ * no longer running, then call snowflake_get_results() to fetch its results.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ *
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_execute_async(SF_STMT *sfstmt);
+
+/**
+ * Gets the status of a query of the session without waiting for it.
+ *
+ * @param sf SNOWFLAKE_CONNECT context.
+ * @param query_id the id of the query.
+ * @param status receives the status of the query.
+ *
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_query_status(SF_CONNECT *sf, const char *query_id,
+                                         SF_QUERY_STATUS *status);
+
+/**
+ * @return true if a query with this status hasn't finished yet.
+ */
+sf_bool STDCALL snowflake_query_status_is_running(SF_QUERY_STATUS status);
+
+/**
+ * Fetches the results of a query submitted by snowflake_execute_async(), or of any other
+ * query of the session, into a statement. The statement is reset first, its rows are then
+ * fetched with snowflake_fetch() as after snowflake_execute(). Waits for the query to finish
+ * if it is still running.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param query_id the id of the query, or NULL for the last query of the statement.
+ *
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_get_results(SF_STMT *sfstmt, const char *query_id);
+
+/**
+ * Like snowflake_get_results(), but skips the rows of the chunks before a chunk, so that an
+ * export of the results that stopped halfway, even in another process, can be resumed without
+ * running the query again. The results of a query can be fetched by any session of the same
+ * user as long as the server keeps them, usually for a day. Only the chunks from the given one
+ * on are downloaded. snowflake_chunk_index() numbers the chunks as in the full results, and
+ * snowflake_num_rows() still counts all of their rows.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param query_id the id of the query, or NULL for the last query of the statement.
+ * @param start_chunk the index, as in snowflake_chunk_index(), of the first chunk to fetch.
+ *        0 fetches all the results.
+ *
+ * @return 0 if success, otherwise an errno is returned. SF_STATUS_ERROR_BAD_REQUEST if the
+ *         results have no chunk of that index.
+ */
+SF_STATUS STDCALL snowflake_get_results_from_chunk(SF_STMT *sfstmt, const char *query_id,
+                                                   int64 start_chunk);
+
+/**
+ * Moves on to the results of the next statement of a multi-statement query, see
+ * SF_STMT_MULTI_STMT_COUNT. The statements are executed in one request, the results of the
+ * first one are available right after snowflake_execute(). Fetching the results of each of
+ * the others takes one more request.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ *
+ * @return 0 if success, SF_STATUS_EOF if there are no more statements, otherwise an errno
+ *         is returned.
+ */
+SF_STATUS STDCALL snowflake_next_result(SF_STMT *sfstmt);
+
+/**
+ * Executes a statement with capture. The capture takes over the response text as it was
+ * received, see SF_QUERY_RESULT_CAPTURE.capture_only to skip reading its rows.
  * @param sfstmt SNOWFLAKE_STMT context.
  * @param result_capture pointer to a SF_QUERY_RESULT_CAPTURE
  * @return 0 if success, otherwise an errno is returned.
@@ -699,6 +1935,347 @@ SF_STATUS STDCALL snowflake_describe_with_capture(SF_STMT *sfstmt,
  */
 SF_STATUS STDCALL snowflake_fetch(SF_STMT *sfstmt);
 
+/**
+ * Binds a column to caller memory, similar to an ODBC bound column with row-wise binding.
+ * snowflake_fetch() converts the value of the column to the C type and writes it to the
+ * buffer, snowflake_fetch_rows() writes row i at i * stride bytes past it. The column stays
+ * bound for the next executions of the statement, until it is bound again or unbound.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param idx the column index, starting at 1.
+ * @param c_type SF_C_TYPE_INT8, SF_C_TYPE_UINT8, SF_C_TYPE_INT64, SF_C_TYPE_UINT64,
+ *        SF_C_TYPE_FLOAT64, SF_C_TYPE_BOOLEAN, SF_C_TYPE_TIMESTAMP or SF_C_TYPE_STRING.
+ * @param buffer the value of the first row, NULL to unbind the column.
+ * @param buffer_size the size of a string value, the null terminator included. Longer
+ *        strings are truncated. Only used for SF_C_TYPE_STRING.
+ * @param stride the bytes from the value of a row to the one of the next, and from its
+ *        indicator to the next, e.g. the size of the struct of a row. 0 for values and
+ *        indicators that are arrays of their own.
+ * @param indicator NULL, or set to SF_NULL_DATA for a NULL value, which is written as 0 or an
+ *        empty string, otherwise to the length of the value, e.g. the full length of a
+ *        truncated string.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_bind_column(SF_STMT *sfstmt, int idx, SF_C_TYPE c_type,
+                                        void *buffer, size_t buffer_size, size_t stride,
+                                        int64 *indicator);
+
+/**
+ * Fetches up to max_rows rows into the columns bound with snowflake_bind_column(), row i
+ * of them at i times the stride of the column. Afterwards the statement is positioned on
+ * the last fetched row.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param max_rows the number of rows the bound memory has room for.
+ * @param rows_fetched receives the number of rows written.
+ * @return 0 if success, SF_STATUS_EOF if no rows are left, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_rows(SF_STMT *sfstmt, size_t max_rows,
+                                       size_t *rows_fetched);
+
+/**
+ * Moves forward to a row of the results, so that the next snowflake_fetch() returns it.
+ * Whole chunks before the row are skipped by their row counts without being downloaded,
+ * unless they were prefetched already.
+ *
+ * @param sfstmt SNOWFLAKE_RESULTSET context.
+ * @param row_index index of the row from the start of the results, at least the number of
+ *        rows fetched so far.
+ * @return 0 if success, SF_STATUS_EOF if the results end before the row, otherwise an errno
+ *         is returned.
+ */
+SF_STATUS STDCALL snowflake_seek(SF_STMT *sfstmt, int64 row_index);
+
+/**
+ * Fetches a row of the results of a scrollable statement, see SF_STMT_SCROLLABLE, backward or
+ * forward, as snowflake_fetch() does the next one. The following snowflake_fetch() returns the
+ * row after it. Without SF_STMT_SCROLLABLE only rows after the current one can be fetched.
+ *
+ * The rows of a chunk kept by the statement are read back from it. A chunk that isn't kept is
+ * fetched again, from the results the server keeps for the query, without running the query
+ * again. Do not mix it with snowflake_fetch_chunk(), snowflake_materialize_columns() or
+ * SF_STMT_UNORDERED_FETCH on the same results.
+ *
+ * @param sfstmt SNOWFLAKE_RESULTSET context.
+ * @param row_index index of the row from the start of the results.
+ * @return 0 if success, SF_STATUS_EOF if the results end before the row, otherwise an errno
+ *         is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_absolute(SF_STMT *sfstmt, int64 row_index);
+
+/**
+ * Fetches the row at an offset from the current row, see snowflake_fetch_absolute(). An
+ * offset of 1 fetches the next row, -1 the previous one and 0 the current one again.
+ *
+ * @param sfstmt SNOWFLAKE_RESULTSET context.
+ * @param offset rows from the current row, or from before the first row if none was fetched.
+ * @return 0 if success, SF_STATUS_EOF if the results end before the row, otherwise an errno
+ *         is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_relative(SF_STMT *sfstmt, int64 offset);
+
+/**
+ * Stops fetching the results of the statement early, e.g. when the application has the
+ * rows it needs. The chunk downloads in flight are aborted instead of being waited for
+ * and no other chunk is downloaded, so that snowflake_stmt_term() returns right away.
+ * The rows of the chunk being fetched can still be fetched, after which fetching ends
+ * with SF_STATUS_EOF. Can be called from another thread than the one fetching.
+ *
+ * @param sfstmt SNOWFLAKE_RESULTSET context.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_cancel(SF_STMT *sfstmt);
+
+/**
+ * Converts the columns of the results to the given C types on worker threads, ahead of
+ * snowflake_fetch(). The threads take the chunks as snowflake_fetch_chunk() does and store the
+ * values of every row already converted, so that the snowflake_column_* functions of those
+ * types only look them up. A value that can not be converted fails its column function with
+ * the error the conversion got.
+ *
+ * Call it after the statement is executed and before the first row is fetched. Afterwards
+ * only the registered columns can be read, each through the functions of its type or
+ * snowflake_column_is_null(). Do not mix it with snowflake_seek(), snowflake_fetch_batch()
+ * or snowflake_fetch_chunk() on the same results.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param types C type of each column, starting with the first. SF_C_TYPE_INT64,
+ *        SF_C_TYPE_UINT64, SF_C_TYPE_FLOAT64, SF_C_TYPE_BOOLEAN or SF_C_TYPE_STRING, or
+ *        SF_C_TYPE_NULL for a column that is not converted.
+ * @param column_count the number of types, at most the number of columns.
+ * @param threads the number of worker threads, 0 for as many as the chunk downloader has.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_materialize_columns(SF_STMT *sfstmt, const SF_C_TYPE *types,
+                                                size_t column_count, unsigned int threads);
+
+/**
+ * Fetches up to max_rows rows at once into caller provided column buffers,
+ * similar to an ODBC array fetch. Arrow columns whose layout matches the
+ * requested C type are copied a record batch at a time, the others are read
+ * cell by cell. Afterwards the statement is positioned on the last fetched row.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param columns the columns to fetch.
+ * @param column_count the number of columns.
+ * @param max_rows the capacity of the column buffers, in rows.
+ * @param rows_fetched receives the number of rows written.
+ * @return 0 if success, SF_STATUS_EOF if no rows are left, otherwise an
+ *         errno is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_batch(SF_STMT *sfstmt, SF_BATCH_COLUMN *columns,
+                                        size_t column_count, size_t max_rows,
+                                        size_t *rows_fetched);
+
+/**
+ * Exports the next Arrow record batch of the result set through the Arrow C
+ * data interface, moving on to the next chunk as needed. The column buffers
+ * are shared, not copied, and stay valid until the consumer calls the release
+ * callbacks, even after the statement is gone. The columns are in Snowflake's
+ * Arrow encoding, e.g. scaled integers for NUMBER with a scale, with the
+ * Snowflake type in the field metadata.
+ *
+ * The rows of JSON results are converted into one record batch per chunk in
+ * the same encoding, on the chunk downloader threads with
+ * SF_STMT_JSON_TO_ARROW, otherwise on the calling thread. Only available in
+ * builds with Arrow, and not to be mixed with the row fetch functions on the
+ * same result set.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param array receives the record batch as a struct array.
+ * @param schema receives the schema of the record batch.
+ * @return 0 if success, SF_STATUS_EOF if no record batches are left,
+ *         otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_fetch_arrow_batch(SF_STMT *sfstmt, struct ArrowArray *array,
+                                              struct ArrowSchema *schema);
+
+/**
+ * File formats of snowflake_export_result()
+ */
+typedef enum SF_EXPORT_FORMAT {
+    // Arrow IPC stream, one record batch per batch of the result chunks
+    SF_EXPORT_FORMAT_ARROW_IPC,
+    // Comma separated values with a header line, the values as snowflake_column_as_str()
+    // formats them. NULL is an empty field, an empty string a quoted one.
+    SF_EXPORT_FORMAT_CSV,
+    // The same, compressed with gzip
+    SF_EXPORT_FORMAT_CSV_GZIP
+} SF_EXPORT_FORMAT;
+
+/**
+ * Writes the remaining rows of the results to a file.
+ *
+ * As an Arrow IPC stream, the file is written straight from the Arrow record batches of
+ * the result chunks, without converting any value. The chunks are downloaded and decoded
+ * ahead by the chunk downloader threads while the file is written, see
+ * snowflake_fetch_arrow_batch(), which the same rules apply to. JSON results are converted
+ * to record batches on the way. An empty result leaves an empty file.
+ *
+ * As CSV, the chunks are taken with snowflake_fetch_chunk(), which the same rules apply to,
+ * and formatted, and compressed, on worker threads while the file is written in result
+ * order. Each chunk is a gzip member of its own. JSON results can be exported this way too.
+ *
+ * On failure the file is left incomplete.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context.
+ * @param path the file to create or overwrite.
+ * @param format the file format.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_export_result(SF_STMT *sfstmt, const char *path,
+                                          SF_EXPORT_FORMAT format);
+
+/**
+ * Size the small files are packed into by snowflake_bulk_load() by default, before
+ * compression, about the size of the compressed files COPY INTO loads best at.
+ */
+#define SF_BULK_LOAD_FILE_SIZE_DEFAULT (512 * 1024 * 1024)
+
+/**
+ * Most files COPY INTO takes in its FILES list.
+ */
+#define SF_BULK_LOAD_MAX_GROUP_FILES 1000
+
+/**
+ * Options of snowflake_bulk_load()
+ */
+typedef struct SF_BULK_LOAD_OPTIONS {
+    // Stage the files are uploaded to, e.g. "@~" or "@my_stage/path". They are put into a
+    // directory of the stage of their own, named by a UUID.
+    const char *stage;
+    // FILE_FORMAT of the COPY INTO, e.g. "(TYPE = CSV FIELD_DELIMITER = '|')", NULL for the
+    // file format of the table
+    const char *file_format;
+    // Small files are packed into staged files of about this many bytes before compression,
+    // one after another with a line break between them. 0 for
+    // SF_BULK_LOAD_FILE_SIZE_DEFAULT, -1 to stage each file as it is, e.g. when they start
+    // with header lines.
+    int64 file_size;
+    // Most staged files that one COPY INTO loads, up to SF_BULK_LOAD_MAX_GROUP_FILES. 0 to
+    // load all the files uploaded while the previous COPY INTO was running, so that the
+    // loads keep up with the upload.
+    int64 group_files;
+    // Remove the files from the stage once they are loaded
+    sf_bool purge;
+} SF_BULK_LOAD_OPTIONS;
+
+/**
+ * Loads local files into a table, uploading them and loading them at once: the files are put
+ * to the stage by a PUT running in the background, and the files uploaded so far are loaded
+ * by a COPY INTO on sfstmt while the next ones upload, one COPY INTO after another until all
+ * the files are loaded.
+ *
+ * The files are compressed with gzip for upload unless they are compressed already. The
+ * PUT runs on a statement of its own.
+ *
+ * On failure, the upload of the files not started yet is cancelled and the files loaded so
+ * far stay loaded. sfstmt has the error, of the COPY INTO if it failed.
+ *
+ * @param sfstmt SNOWFLAKE_STMT context the COPY INTO statements are run on.
+ * @param files the files to load, a local path which may have wildcards as in PUT, e.g.
+ *        /data/orders_*.csv
+ * @param table the table to load into, e.g. "my_db.my_schema.orders"
+ * @param options how the files are staged and loaded, NULL for the defaults, the stage
+ *        of the table.
+ * @param rows_loaded set to the rows loaded in total, may be NULL.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_bulk_load(SF_STMT *sfstmt, const char *files, const char *table,
+                                      const SF_BULK_LOAD_OPTIONS *options,
+                                      int64 *rows_loaded);
+
+/**
+ * Defaults of SF_INGEST_OPTIONS
+ */
+#define SF_INGEST_FILE_SIZE_DEFAULT (64 * 1024 * 1024)
+#define SF_INGEST_FLUSH_INTERVAL_DEFAULT 1000
+#define SF_INGEST_THREADS_DEFAULT 2
+
+/**
+ * Writer loading rows into a table continuously, see snowflake_ingest_writer_open().
+ */
+typedef struct SF_INGEST_WRITER SF_INGEST_WRITER;
+
+/**
+ * Options of snowflake_ingest_writer_open()
+ */
+typedef struct SF_INGEST_OPTIONS {
+    // Stage the files are uploaded to, e.g. "@~" or "@my_stage/path", NULL for the stage of
+    // the table. They are put into a directory of the stage of their own, named by a UUID,
+    // and removed once loaded.
+    const char *stage;
+    // Bytes of CSV text a file is sealed for upload at, 0 for SF_INGEST_FILE_SIZE_DEFAULT
+    int64 file_size;
+    // Milliseconds after its first row that a file is sealed for upload at however small, 0
+    // for SF_INGEST_FLUSH_INTERVAL_DEFAULT, -1 to seal the files by size only
+    int64 flush_interval_ms;
+    // Bytes of rows buffered at most, the sealed files not loaded yet included, beyond which
+    // snowflake_ingest_append() waits for the files to load. 0 for twice the files the
+    // threads work on at once.
+    int64 max_buffered_size;
+    // Threads compressing, uploading and loading the sealed files, 0 for
+    // SF_INGEST_THREADS_DEFAULT
+    int threads;
+} SF_INGEST_OPTIONS;
+
+/**
+ * Opens a writer loading the rows appended to it into a table. The rows are buffered as CSV
+ * text into files, which are sealed once large enough or old enough, then compressed,
+ * uploaded from memory by a PUT and loaded by a COPY INTO on background threads, each on a
+ * statement of its own.
+ *
+ * @param sf SNOWFLAKE_CONNECT context, connected, to stay open until the writer is closed.
+ * @param table the table to load into, e.g. "my_db.my_schema.events"
+ * @param options how the rows are buffered and loaded, NULL for the defaults.
+ * @return the writer, NULL if out of memory or the threads can't be started.
+ */
+SF_INGEST_WRITER *STDCALL snowflake_ingest_writer_open(SF_CONNECT *sf, const char *table,
+                                                       const SF_INGEST_OPTIONS *options);
+
+/**
+ * Appends a row, waiting for files to load if the writer buffers as much as it may. May be
+ * called from several threads at once.
+ *
+ * @param writer the writer.
+ * @param values the values of the columns of the row in the order of the table, as text,
+ *        NULL for NULL.
+ * @param lengths the lengths of the values, NULL if they are NUL-terminated.
+ * @param count the number of values.
+ * @return 0 if success, otherwise an errno is returned, the first error of a file failing to
+ *         load once one has, see snowflake_ingest_error().
+ */
+SF_STATUS STDCALL snowflake_ingest_append(SF_INGEST_WRITER *writer, const char **values,
+                                          const size_t *lengths, size_t count);
+
+/**
+ * Seals the rows appended so far into a file and waits for all the files to be loaded.
+ *
+ * @param writer the writer.
+ * @return 0 if success, otherwise the errno of the first file that failed to load.
+ */
+SF_STATUS STDCALL snowflake_ingest_flush(SF_INGEST_WRITER *writer);
+
+/**
+ * @param writer the writer.
+ * @return the rows loaded into the table so far.
+ */
+int64 STDCALL snowflake_ingest_rows_loaded(SF_INGEST_WRITER *writer);
+
+/**
+ * @param writer the writer.
+ * @return the error of the first file that failed to load, valid until the writer is closed.
+ */
+SF_ERROR_STRUCT *STDCALL snowflake_ingest_error(SF_INGEST_WRITER *writer);
+
+/**
+ * Flushes the writer as snowflake_ingest_flush() does, then stops its threads and frees it.
+ *
+ * @param writer the writer, may be NULL.
+ * @return 0 if success, otherwise the errno of the first file that failed to load.
+ */
+SF_STATUS STDCALL snowflake_ingest_writer_close(SF_INGEST_WRITER *writer);
+
 /**
  * Returns the number of binding parameters in the statement.
  *
@@ -741,6 +2318,12 @@ SF_STATUS STDCALL snowflake_bind_param(
 /**
  * Binds an array of parameters with the statement for execution.
  *
+ * To insert many rows with one execution, set SF_STMT_PARAMSET_SIZE to the number of rows.
+ * The value of each parameter then points to an array with a value per row: fixed size
+ * types are packed, strings and binary values are len bytes apart and strings end at the
+ * first NUL. Large row sets of positional parameters are uploaded to a temporary stage as a
+ * compressed CSV file unless SF_STMT_BIND_UPLOAD_THRESHOLD is 0.
+ *
  * @param sfstmt SF_STMT context.
  * @param sfbind_array SF_BIND_INPUT array of bind input values.
  * @param size size_t size of the parameter array (sfbind_array).
@@ -749,6 +2332,26 @@ SF_STATUS STDCALL snowflake_bind_param(
 SF_STATUS snowflake_bind_param_array(
     SF_STMT *sfstmt, SF_BIND_INPUT *sfbind_array, size_t size);
 
+/**
+ * Binds a batch of rows exported through the Arrow C data interface, to insert them with
+ * one execution. The array is a struct array, e.g. an exported record batch, and its
+ * columns are bound in order as the positional parameters. The values are serialized
+ * straight from the Arrow buffers. Large batches are uploaded to a temporary stage as a
+ * compressed CSV file unless SF_STMT_BIND_UPLOAD_THRESHOLD is 0.
+ *
+ * Integer, floating point, boolean, UTF-8 string, binary and date32 columns, with or
+ * without nulls, are supported. The array and schema are borrowed, not released: keep them
+ * alive until the statement has been executed. Binding a batch replaces the previous one,
+ * and can't be combined with snowflake_bind_param() on the same statement.
+ *
+ * @param sfstmt SF_STMT context.
+ * @param array the batch, as a struct array with a child per column.
+ * @param schema the schema of the batch.
+ * @return 0 if success, otherwise an errno is returned.
+ */
+SF_STATUS STDCALL snowflake_bind_arrow(SF_STMT *sfstmt, struct ArrowArray *array,
+                                       struct ArrowSchema *schema);
+
 /**
  * Returns a query id associated with the statement after execution. If not
  * executed, NULL is returned.
@@ -904,6 +2507,9 @@ SF_STATUS STDCALL snowflake_column_as_timestamp(SF_STMT *sfstmt, int idx, SF_TIM
  * Returns the raw column data in the form of a const char pointer that the user can then use
  * to read the string data or copy to another buffer. A NULL column will return a NULL pointer
  *
+ * The pointer refers to the decoded result chunk itself, so no copy is made. It stays valid
+ * until the cursor moves to the next chunk.
+ *
  * @param sfstmt SF_STMT context
  * @param idx Column index
  * @param value_ptr Raw column data is stored in this pointer
@@ -911,6 +2517,21 @@ SF_STATUS STDCALL snowflake_column_as_timestamp(SF_STMT *sfstmt, int idx, SF_TIM
  */
 SF_STATUS STDCALL snowflake_column_as_const_str(SF_STMT *sfstmt, int idx, const char **value_ptr);
 
+/**
+ * Returns the same text as snowflake_column_as_const_str() along with its length. For the
+ * strings of an Arrow result the pointer refers to the value buffer of the record batch, so
+ * neither a copy nor a strlen() is made, and the text is NOT NUL-terminated. It stays valid
+ * until the cursor moves to the next record batch or chunk. A NULL column returns a NULL
+ * pointer and a length of 0.
+ *
+ * @param sfstmt SF_STMT context
+ * @param idx Column index
+ * @param value_ptr Set to the text of the column
+ * @param value_len_ptr Set to the length of the text in bytes
+ * @return 0 if success, otherwise an errno is returned
+ */
+SF_STATUS STDCALL snowflake_column_as_str_view(SF_STMT *sfstmt, int idx, const char **value_ptr, size_t *value_len_ptr);
+
 /**
  * Given the raw value as a string, returns the string representation
  *
@@ -964,6 +2585,86 @@ SF_STATUS STDCALL snowflake_column_as_str(SF_STMT *sfstmt, int idx, char **value
  */
 SF_STATUS STDCALL snowflake_column_strlen(SF_STMT *sfstmt, int idx, size_t *value_ptr);
 
+/**
+ * Types of the values snowflake_column_get_path() finds
+ */
+typedef enum SF_JSON_VALUE_TYPE {
+    // The column is NULL, or the path isn't in its value
+    SF_JSON_VALUE_NONE,
+    SF_JSON_VALUE_NULL,
+    SF_JSON_VALUE_BOOLEAN,
+    SF_JSON_VALUE_NUMBER,
+    SF_JSON_VALUE_STRING,
+    SF_JSON_VALUE_OBJECT,
+    SF_JSON_VALUE_ARRAY
+} SF_JSON_VALUE_TYPE;
+
+/**
+ * Extracts the value at a path from a VARIANT, OBJECT or ARRAY column, e.g. a.b[3].c or
+ * a["key.with.dots"][0], like GET_PATH() does on the server. The JSON text of the column is
+ * scanned on demand up to the value, skipping over what is before it, and no tree is built.
+ *
+ * A string is copied unescaped, a number, a boolean or null as its JSON text and an object
+ * or an array as its JSON text as is. The buffer is handled as by snowflake_column_as_str().
+ *
+ * @param sfstmt SF_STMT context
+ * @param idx Column index
+ * @param path the path of the value, an empty path being the whole value
+ * @param type_ptr set to the type of the value, SF_JSON_VALUE_NONE if there is no value at
+ *        the path, in which case the string is empty
+ * @param value_ptr Copied value is stored in this pointer
+ * @param value_len_ptr The length of the copied value
+ * @param max_value_size_ptr The size of the value buffer
+ * @return 0 if success, otherwise an errno is returned. SF_STATUS_ERROR_BAD_REQUEST if the
+ *         path can't be parsed, SF_STATUS_ERROR_DATA_CONVERSION if the column isn't
+ *         semi-structured and SF_STATUS_ERROR_BAD_JSON if its value isn't JSON.
+ */
+SF_STATUS STDCALL snowflake_column_get_path(SF_STMT *sfstmt, int idx, const char *path,
+                                            SF_JSON_VALUE_TYPE *type_ptr, char **value_ptr,
+                                            size_t *value_len_ptr, size_t *max_value_size_ptr);
+
+/**
+ * Returns the raw bytes of a BINARY column without converting them to hex text. For TEXT
+ * columns the bytes of the string are returned. A NULL column returns a NULL pointer and a
+ * length of 0.
+ *
+ * For Arrow results the pointer refers to the Arrow value buffer. For JSON results it refers
+ * to a buffer of the result set that is only valid until the column is read again or the
+ * cursor moves.
+ *
+ * @param sfstmt SF_STMT context
+ * @param idx Column index
+ * @param value_ptr Pointer to the raw bytes, owned by the library
+ * @param value_len_ptr Number of bytes
+ * @return 0 if success, otherwise an errno is returned
+ */
+SF_STATUS STDCALL snowflake_column_as_binary(SF_STMT *sfstmt, int idx, const void **value_ptr, size_t *value_len_ptr);
+
+/**
+ * Reads a large cell in pieces, like SQLGetData() does in ODBC. Each call copies the next
+ * piece of up to buffer_size bytes from the result chunk and the calls after the last piece
+ * return SF_STATUS_EOF, so a VARCHAR, BINARY or VARIANT value of any size is read through a
+ * buffer of a fixed size and is never copied whole. Reading another column, or moving the
+ * cursor, starts over.
+ *
+ * A BINARY column is read as its raw bytes, other columns as their text, which is not
+ * NUL-terminated. For JSON results, BOOLEAN, DATE, TIME and TIMESTAMP columns have to be
+ * formatted and can only be read with snowflake_column_as_str(). A NULL column reads as a
+ * single empty piece, see snowflake_column_is_null().
+ *
+ * @param sfstmt SF_STMT context
+ * @param idx Column index
+ * @param buffer the buffer to copy the piece to
+ * @param buffer_size the size of the buffer
+ * @param piece_len_ptr set to the number of bytes copied
+ * @param remaining_len_ptr (can be null) set to the number of bytes left after the piece
+ * @return 0 if success, SF_STATUS_EOF once the whole cell has been read, otherwise an errno
+ *         is returned
+ */
+SF_STATUS STDCALL snowflake_column_get_data(SF_STMT *sfstmt, int idx, void *buffer,
+                                            size_t buffer_size, size_t *piece_len_ptr,
+                                            size_t *remaining_len_ptr);
+
 /**
  * Returns whether or not the column data is null
  *
@@ -974,6 +2675,28 @@ SF_STATUS STDCALL snowflake_column_strlen(SF_STMT *sfstmt, int idx, size_t *valu
  */
 SF_STATUS STDCALL snowflake_column_is_null(SF_STMT *sfstmt, int idx, sf_bool *value_ptr);
 
+/**
+ * Gets the NULL cells of a column for a run of rows at once, rather than one cell at a time
+ * with snowflake_column_is_null(). The run starts at the current row and ends with the current
+ * record batch for Arrow results or the current chunk for JSON results, the same run
+ * snowflake_fetch_batch() copies in one go. The bits are taken from the Arrow validity buffer,
+ * or from a bitmap of the JSON chunk that is built once per column. The cursor doesn't move.
+ *
+ * @param sfstmt SF_STMT context
+ * @param idx Column index
+ * @param null_bitmap receives the bits, LSB first, bit i set if the cell i rows after the
+ *        current row is NULL, like the null_bitmap of SF_BATCH_COLUMN. Whole bytes are
+ *        written, so it has to hold (max_rows + 7) / 8 bytes.
+ * @param max_rows the most rows to describe
+ * @param row_count_ptr set to the number of rows described, 0 if there is no current row
+ * @param null_count_ptr (can be null) set to the number of NULL cells among them, so a run
+ *        without any can be told apart without looking at the bits
+ * @return 0 if success, otherwise an errno is returned
+ */
+SF_STATUS STDCALL snowflake_column_null_bitmap(SF_STMT *sfstmt, int idx, uint8 *null_bitmap,
+                                               size_t max_rows, size_t *row_count_ptr,
+                                               size_t *null_count_ptr);
+
 /**
  *
  * Start of timestamp functions
@@ -1003,17 +2726,36 @@ SF_STATUS STDCALL snowflake_timestamp_from_parts(SF_TIMESTAMP *ts, int32 nanosec
                                                  int32 year, int32 tzoffset, int32 scale, SF_DB_TYPE ts_type);
 
 /**
+ * Converts the text of a date or time value of the JSON results to a timestamp, days since the
+ * epoch for a date, "seconds.fraction" for the others, a TIMESTAMP_TZ followed by its offset.
  *
- * @param ts
- * @param str
- * @param timezone
- * @param scale
- * @param ts_type
- * @return
+ * @param ts the timestamp to fill.
+ * @param str the text of the value.
+ * @param timezone the session timezone, a TIMESTAMP_LTZ is in.
+ * @param scale the digits of the fraction, -1 to take it from the text.
+ * @param ts_type the type of the value.
+ * @return 0 if success, otherwise an errno is returned.
  */
 SF_STATUS STDCALL snowflake_timestamp_from_epoch_seconds(SF_TIMESTAMP *ts, const char *str, const char *timezone,
                                                          int32 scale, SF_DB_TYPE ts_type);
 
+/**
+ * Converts the values of a column as snowflake_timestamp_from_epoch_seconds() does, looking
+ * the session timezone up once for all of them.
+ *
+ * @param ts the count timestamps to fill.
+ * @param strs the texts of the values, NULL for NULL, which is converted to the epoch as the
+ *        cell getters do.
+ * @param count the number of values.
+ * @param timezone the session timezone, a TIMESTAMP_LTZ is in.
+ * @param scale the scale of the column, -1 to take it from the text of each value.
+ * @param ts_type the type of the column.
+ * @return 0 if success, otherwise the errno of the first value that failed.
+ */
+SF_STATUS STDCALL snowflake_timestamps_from_epoch_seconds(SF_TIMESTAMP *ts, const char **strs,
+                                                          size_t count, const char *timezone,
+                                                          int32 scale, SF_DB_TYPE ts_type);
+
 /**
  *
  * @param ts
@@ -39,6 +39,13 @@
  */
 #define SF_LOG_TIMESTAMP_FORMAT_COLOR "%s %s%-5s\x1b[0m \x1b[90m%-5s %-16s %4d:\x1b[0m "
 
+/**
+ * Default number of messages queued and milliseconds between flushes of asynchronous logging,
+ * see log_start_async()
+ */
+#define SF_LOG_ASYNC_DEFAULT_CAPACITY 8192
+#define SF_LOG_ASYNC_DEFAULT_FLUSH_INTERVAL 100
+
 typedef void (*log_LockFn)(void *udata, int lock);
 
 typedef enum SF_LOG_LEVEL {
@@ -52,24 +59,44 @@ typedef enum SF_LOG_LEVEL {
 
 #define CXX_LOG_NS "C++"
 
-#define log_trace(...) log_log(SF_LOG_TRACE, __FILE__, __LINE__, "C", __VA_ARGS__)
-#define log_debug(...) log_log(SF_LOG_DEBUG, __FILE__, __LINE__, "C", __VA_ARGS__)
-#define log_info(...)  log_log(SF_LOG_INFO,  __FILE__, __LINE__, "C", __VA_ARGS__)
-#define log_warn(...)  log_log(SF_LOG_WARN,  __FILE__, __LINE__, "C", __VA_ARGS__)
-#define log_error(...) log_log(SF_LOG_ERROR, __FILE__, __LINE__, "C", __VA_ARGS__)
-#define log_fatal(...) log_log(SF_LOG_FATAL, __FILE__, __LINE__, "C", __VA_ARGS__)
+/**
+ * Lowest level compiled in, as the value of an SF_LOG_LEVEL. Messages below it are compiled
+ * out with their arguments, see the SF_LOG_STRIP_DEBUG build option.
+ */
+#ifndef SF_LOG_COMPILED_LEVEL
+#define SF_LOG_COMPILED_LEVEL 0
+#endif
+
+#define SF_LOG_ENABLED(level) \
+    ((int) (level) >= SF_LOG_COMPILED_LEVEL && (int) (level) >= sf_log_min_level)
+
+#define SF_LOG_AT(level, ns, ...) \
+    (SF_LOG_ENABLED(level) ? log_log(level, __FILE__, __LINE__, ns, __VA_ARGS__) : (void) 0)
 
-#define sf_log_trace(ns, ...) log_log(SF_LOG_TRACE, __FILE__, __LINE__, ns, __VA_ARGS__)
-#define sf_log_debug(ns, ...) log_log(SF_LOG_DEBUG, __FILE__, __LINE__, ns, __VA_ARGS__)
-#define sf_log_info(ns, ...)  log_log(SF_LOG_INFO, __FILE__, __LINE__, ns, __VA_ARGS__)
-#define sf_log_warn(ns, ...)  log_log(SF_LOG_WARN,  __FILE__, __LINE__, ns, __VA_ARGS__)
-#define sf_log_error(ns, ...) log_log(SF_LOG_ERROR, __FILE__, __LINE__, ns, __VA_ARGS__)
-#define sf_log_fatal(ns, ...) log_log(SF_LOG_FATAL, __FILE__, __LINE__, ns, __VA_ARGS__)
+#define log_trace(...) SF_LOG_AT(SF_LOG_TRACE, "C", __VA_ARGS__)
+#define log_debug(...) SF_LOG_AT(SF_LOG_DEBUG, "C", __VA_ARGS__)
+#define log_info(...)  SF_LOG_AT(SF_LOG_INFO,  "C", __VA_ARGS__)
+#define log_warn(...)  SF_LOG_AT(SF_LOG_WARN,  "C", __VA_ARGS__)
+#define log_error(...) SF_LOG_AT(SF_LOG_ERROR, "C", __VA_ARGS__)
+#define log_fatal(...) SF_LOG_AT(SF_LOG_FATAL, "C", __VA_ARGS__)
+
+#define sf_log_trace(ns, ...) SF_LOG_AT(SF_LOG_TRACE, ns, __VA_ARGS__)
+#define sf_log_debug(ns, ...) SF_LOG_AT(SF_LOG_DEBUG, ns, __VA_ARGS__)
+#define sf_log_info(ns, ...)  SF_LOG_AT(SF_LOG_INFO,  ns, __VA_ARGS__)
+#define sf_log_warn(ns, ...)  SF_LOG_AT(SF_LOG_WARN,  ns, __VA_ARGS__)
+#define sf_log_error(ns, ...) SF_LOG_AT(SF_LOG_ERROR, ns, __VA_ARGS__)
+#define sf_log_fatal(ns, ...) SF_LOG_AT(SF_LOG_FATAL, ns, __VA_ARGS__)
 
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
+/**
+ * Level set with log_set_level(). Only read through SF_LOG_ENABLED(), so that the callers
+ * check it before any call or formatting.
+ */
+extern volatile int sf_log_min_level;
+
 void log_set_udata(void *udata);
 
 void log_set_lock(log_LockFn fn);
@@ -92,6 +119,26 @@ log_log_va_list(int level, const char *file, int line, const char *ns,
 
 void log_masked_va_list(FILE* fp, const char *fmt, va_list args);
 
+/**
+ * Makes logging asynchronous: the callers only format their message into a queue, and a
+ * writer thread masks, writes and flushes the messages in batches. While the queue is full,
+ * messages below SF_LOG_WARN are dropped and counted in the log, the others are written
+ * right away.
+ *
+ * @param capacity number of messages queued at most, rounded up to a power of two.
+ * @param flush_interval_ms milliseconds the writer waits for more messages before it writes
+ *        and flushes the queued ones.
+ * @return 0 if success or already asynchronous, -1 if the writer thread couldn't be started.
+ */
+int log_start_async(size_t capacity, unsigned int flush_interval_ms);
+
+/**
+ * Writes the queued messages and makes logging synchronous again.
+ */
+void log_stop_async(void);
+
+int log_is_async(void);
+
 SF_LOG_LEVEL log_from_str_to_level(const char *level_in_str);
 
 void log_set_path(const char* path);
@@ -21,7 +21,7 @@ typedef HANDLE SF_THREAD_HANDLE;
 typedef CONDITION_VARIABLE SF_CONDITION_HANDLE;
 typedef CRITICAL_SECTION SF_CRITICAL_SECTION_HANDLE;
 typedef SRWLOCK SF_RWLOCK_HANDLE;
-typedef HANDLE SF_MUTEX_HANDLE;
+typedef SRWLOCK SF_MUTEX_HANDLE;
 
 #define PATH_SEP '\\'
 #define ALTER_PATH_SEP '/'
@@ -79,6 +79,14 @@ int STDCALL _cond_signal(SF_CONDITION_HANDLE *cond);
 int STDCALL
 _cond_wait(SF_CONDITION_HANDLE *cond, SF_CRITICAL_SECTION_HANDLE *lock);
 
+/**
+ * Like _cond_wait(), but gives up after the given number of milliseconds.
+ *
+ * @return 0 if signaled, non zero on timeout or error.
+ */
+int STDCALL
+_cond_timed_wait(SF_CONDITION_HANDLE *cond, SF_CRITICAL_SECTION_HANDLE *lock, unsigned int ms);
+
 int STDCALL _cond_term(SF_CONDITION_HANDLE *cond);
 
 int STDCALL _critical_section_init(SF_CRITICAL_SECTION_HANDLE *lock);
@@ -109,6 +117,91 @@ int STDCALL _mutex_unlock(SF_MUTEX_HANDLE *lock);
 
 int STDCALL _mutex_term(SF_MUTEX_HANDLE *lock);
 
+/**
+ * Kinds of locks profiled by the wrappers above when built with SF_LOCK_PROFILING.
+ */
+typedef enum SF_LOCK_KIND {
+    SF_LOCK_CRITICAL_SECTION,
+    SF_LOCK_RWLOCK_READ,
+    SF_LOCK_RWLOCK_WRITE,
+    SF_LOCK_MUTEX,
+    SF_LOCK_KIND_COUNT
+} SF_LOCK_KIND;
+
+/**
+ * Contention of all the locks of a kind since the start or the last reset, in nanoseconds.
+ * Waits are only timed for the acquisitions that found the lock taken. The time a critical
+ * section is released by a condition wait is not held.
+ */
+typedef struct SF_LOCK_STATS {
+    unsigned long long acquisitions;
+    unsigned long long contended;
+    unsigned long long wait_ns;
+    unsigned long long max_wait_ns;
+    unsigned long long hold_ns;
+    unsigned long long max_hold_ns;
+} SF_LOCK_STATS;
+
+/**
+ * Copies the lock statistics by kind.
+ *
+ * @param stats SF_LOCK_KIND_COUNT statistics, indexed by SF_LOCK_KIND.
+ * @return 1 if the locks are profiled, 0 if the library is built without SF_LOCK_PROFILING
+ *         or on Windows, in which case the statistics are all 0.
+ */
+int STDCALL sf_lock_stats_get(SF_LOCK_STATS *stats);
+
+void STDCALL sf_lock_stats_reset(void);
+
+/**
+ * Atomic operations. All of them are sequentially consistent (full barrier).
+ * The integer variants operate on uint64 values.
+ */
+unsigned long long STDCALL
+sf_atomic_fetch_add(volatile unsigned long long *ptr, unsigned long long value);
+
+unsigned long long STDCALL
+sf_atomic_fetch_sub(volatile unsigned long long *ptr, unsigned long long value);
+
+unsigned long long STDCALL sf_atomic_load(volatile unsigned long long *ptr);
+
+void STDCALL sf_atomic_store(volatile unsigned long long *ptr, unsigned long long value);
+
+/**
+ * Replaces the value with desired if it is expected.
+ *
+ * @return non zero if the value was replaced.
+ */
+int STDCALL sf_atomic_compare_exchange(volatile unsigned long long *ptr, unsigned long long expected,
+                                       unsigned long long desired);
+
+void *STDCALL sf_atomic_load_ptr(void *volatile *ptr);
+
+void STDCALL sf_atomic_store_ptr(void *volatile *ptr, void *value);
+
+void *STDCALL sf_atomic_exchange_ptr(void *volatile *ptr, void *value);
+
+/**
+ * Milliseconds elapsed since an arbitrary point in the past. Not affected by changes of the
+ * wall clock, so only use it to measure intervals.
+ */
+unsigned long long STDCALL sf_monotonic_time_ms(void);
+
+/**
+ * Same as sf_monotonic_time_ms() in microseconds, for shorter intervals.
+ */
+unsigned long long STDCALL sf_monotonic_time_us(void);
+
+/**
+ * Nanoseconds since the Unix epoch by the wall clock.
+ */
+unsigned long long STDCALL sf_unix_time_ns(void);
+
+/**
+ * Suspends the calling thread for the given number of milliseconds.
+ */
+void STDCALL sf_sleep_ms(unsigned int ms);
+
 const char *STDCALL sf_os_name();
 
 void STDCALL sf_os_version(char *ret, size_t size);
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "arena.h"
+#include "memory.h"
+
+// Alignment of every allocation
+#define SF_ARENA_ALIGNMENT sizeof(void *)
+
+struct SF_ARENA_BLOCK {
+    SF_ARENA_BLOCK *next;
+    size_t capacity;
+    size_t used;
+};
+
+#define BLOCK_DATA(block) ((char *) ((block) + 1))
+
+static SF_ARENA_BLOCK *block_allocate(SF_ARENA *arena, size_t capacity) {
+    SF_ARENA_BLOCK *block = (SF_ARENA_BLOCK *) SF_TAG_MALLOC(arena->tag,
+                                                             sizeof(SF_ARENA_BLOCK) + capacity);
+    if (block) {
+        block->next = NULL;
+        block->capacity = capacity;
+        block->used = 0;
+    }
+    return block;
+}
+
+SF_ARENA *STDCALL sf_arena_init(SF_MEMORY_TAG tag) {
+    SF_ARENA *arena = (SF_ARENA *) SF_CALLOC(1, sizeof(SF_ARENA));
+    if (arena) {
+        arena->tag = tag;
+    }
+    return arena;
+}
+
+void STDCALL sf_arena_term(SF_ARENA *arena) {
+    SF_ARENA_BLOCK *block;
+    SF_ARENA_BLOCK *next;
+    if (!arena) {
+        return;
+    }
+    for (block = arena->first; block; block = next) {
+        next = block->next;
+        SF_TAG_FREE(arena->tag, block, sizeof(SF_ARENA_BLOCK) + block->capacity);
+    }
+    SF_FREE(arena);
+}
+
+void *STDCALL sf_arena_calloc(SF_ARENA *arena, size_t size) {
+    SF_ARENA_BLOCK *block;
+    char *ret;
+    size_t aligned = (size + SF_ARENA_ALIGNMENT - 1) & ~((size_t) SF_ARENA_ALIGNMENT - 1);
+    if (!arena || aligned < size) {
+        return NULL;
+    }
+
+    block = arena->current;
+    // Move on to a later block that has room, kept by a reset
+    while (block && block->capacity - block->used < aligned) {
+        block = block->next;
+    }
+    if (!block) {
+        // Large allocations get a block of their own
+        block = block_allocate(arena, aligned > SF_ARENA_BLOCK_SIZE ? aligned : SF_ARENA_BLOCK_SIZE);
+        if (!block) {
+            return NULL;
+        }
+        if (arena->current) {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        } else {
+            arena->first = block;
+        }
+    }
+    arena->current = block;
+    ret = BLOCK_DATA(block) + block->used;
+    block->used += aligned;
+    memset(ret, 0, size);
+    return ret;
+}
+
+void STDCALL sf_arena_reset(SF_ARENA *arena) {
+    SF_ARENA_BLOCK *block;
+    if (!arena) {
+        return;
+    }
+    for (block = arena->first; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = arena->first;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_ARENA_H
+#define SNOWFLAKE_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include "snowflake/platform.h"
+#include "memory.h"
+
+// Size of the blocks an arena carves its allocations from
+#define SF_ARENA_BLOCK_SIZE 4096
+
+typedef struct SF_ARENA_BLOCK SF_ARENA_BLOCK;
+
+/**
+ * Scratch memory for short-lived allocations that all die together, e.g. the text of the
+ * bound values while a query request is built. Allocations are carved from a few large
+ * blocks and never freed one by one; sf_arena_reset() takes them all back at once but keeps
+ * the blocks, so an arena that is reset between uses stops allocating after the first one.
+ * An arena is not thread safe.
+ */
+typedef struct SF_ARENA {
+    SF_ARENA_BLOCK *first;
+    // Block allocations are currently carved from
+    SF_ARENA_BLOCK *current;
+    // Tag the blocks are allocated with
+    SF_MEMORY_TAG tag;
+} SF_ARENA;
+
+SF_ARENA *STDCALL sf_arena_init(SF_MEMORY_TAG tag);
+
+/**
+ * Frees the arena, its blocks and so everything allocated from it.
+ */
+void STDCALL sf_arena_term(SF_ARENA *arena);
+
+/**
+ * Allocates zeroed memory, aligned for pointers, that stays valid until the arena is reset.
+ *
+ * @return the memory, or NULL if out of memory.
+ */
+void *STDCALL sf_arena_calloc(SF_ARENA *arena, size_t size);
+
+/**
+ * Takes back everything allocated from the arena, keeping its blocks for the next allocations.
+ */
+void STDCALL sf_arena_reset(SF_ARENA *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_ARENA_H
@@ -2,11 +2,12 @@
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
 
+#include <string.h>
 #include "arraylist.h"
 #include "memory.h"
 
 ARRAY_LIST* STDCALL sf_array_list_init() {
-    ARRAY_LIST *al = (ARRAY_LIST *) calloc(1, sizeof(ARRAY_LIST));
+    ARRAY_LIST *al = (ARRAY_LIST *) SF_CALLOC(1, sizeof(ARRAY_LIST));
     // No spots are used yet
     al->used = 0;
     // Always initialize to 8
@@ -40,6 +41,20 @@ void STDCALL sf_array_list_grow(ARRAY_LIST *al, size_t min_size) {
     al->size = new_size;
 }
 
+void STDCALL sf_array_list_reserve(ARRAY_LIST *al, size_t min_size) {
+    if (al && al->size < min_size) {
+        sf_array_list_grow(al, min_size);
+    }
+}
+
+void STDCALL sf_array_list_clear(ARRAY_LIST *al) {
+    if (!al) {
+        return;
+    }
+    memset(al->data, 0, sizeof(void *) * al->size);
+    al->used = 0;
+}
+
 void STDCALL sf_array_list_set(ARRAY_LIST *al, void *item, size_t index) {
     if (!al) {
         return;
@@ -63,8 +78,9 @@ void* STDCALL sf_array_list_get(ARRAY_LIST *al, size_t index) {
     if (!al) {
         return NULL;
     }
+    // Reading past the end doesn't need any memory
     if (al->size <= index) {
-        sf_array_list_grow(al, index+1);
+        return NULL;
     }
     return al->data[index];
 }
\ No newline at end of file
@@ -21,6 +21,14 @@ typedef struct sf_array_list {
 ARRAY_LIST * STDCALL sf_array_list_init();
 void STDCALL sf_array_list_deallocate(ARRAY_LIST *al);
 void STDCALL sf_array_list_grow(ARRAY_LIST *al, size_t min_size);
+/**
+ * Makes room for at least min_size items without growing again.
+ */
+void STDCALL sf_array_list_reserve(ARRAY_LIST *al, size_t min_size);
+/**
+ * Removes all items, keeping the memory for the next ones.
+ */
+void STDCALL sf_array_list_clear(ARRAY_LIST *al);
 void STDCALL sf_array_list_set(ARRAY_LIST *al, void *item, size_t index);
 void *STDCALL sf_array_list_get(ARRAY_LIST *al, size_t index);
 
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <snowflake/logger.h>
+#include "bind_arrow.h"
+#include "constants.h"
+#include "memory.h"
+#include "results.h"
+
+#define SF_MS_PER_DAY 86400000LL
+
+/**
+ * Maps the format string of a column to its kind and Snowflake type.
+ *
+ * @return whether the format is supported.
+ */
+static sf_bool parse_format(const char *format, SF_ARROW_BIND_KIND *kind, SF_DB_TYPE *type) {
+    *type = SF_DB_TYPE_FIXED;
+    if (strcmp(format, "tdD") == 0) {
+        *kind = SF_ARROW_BIND_DATE32;
+        *type = SF_DB_TYPE_DATE;
+        return SF_BOOLEAN_TRUE;
+    }
+    if (format[0] == '\0' || format[1] != '\0') {
+        return SF_BOOLEAN_FALSE;
+    }
+    switch (format[0]) {
+        case 'c':
+            *kind = SF_ARROW_BIND_INT8;
+            break;
+        case 'C':
+            *kind = SF_ARROW_BIND_UINT8;
+            break;
+        case 's':
+            *kind = SF_ARROW_BIND_INT16;
+            break;
+        case 'S':
+            *kind = SF_ARROW_BIND_UINT16;
+            break;
+        case 'i':
+            *kind = SF_ARROW_BIND_INT32;
+            break;
+        case 'I':
+            *kind = SF_ARROW_BIND_UINT32;
+            break;
+        case 'l':
+            *kind = SF_ARROW_BIND_INT64;
+            break;
+        case 'L':
+            *kind = SF_ARROW_BIND_UINT64;
+            break;
+        case 'f':
+            *kind = SF_ARROW_BIND_FLOAT32;
+            *type = SF_DB_TYPE_REAL;
+            break;
+        case 'g':
+            *kind = SF_ARROW_BIND_FLOAT64;
+            *type = SF_DB_TYPE_REAL;
+            break;
+        case 'b':
+            *kind = SF_ARROW_BIND_BOOLEAN;
+            *type = SF_DB_TYPE_BOOLEAN;
+            break;
+        case 'u':
+            *kind = SF_ARROW_BIND_UTF8;
+            *type = SF_DB_TYPE_TEXT;
+            break;
+        case 'U':
+            *kind = SF_ARROW_BIND_LARGE_UTF8;
+            *type = SF_DB_TYPE_TEXT;
+            break;
+        case 'z':
+            *kind = SF_ARROW_BIND_BINARY;
+            *type = SF_DB_TYPE_BINARY;
+            break;
+        case 'Z':
+            *kind = SF_ARROW_BIND_LARGE_BINARY;
+            *type = SF_DB_TYPE_BINARY;
+            break;
+        default:
+            return SF_BOOLEAN_FALSE;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+static sf_bool is_variable_length(SF_ARROW_BIND_KIND kind) {
+    return kind == SF_ARROW_BIND_UTF8 || kind == SF_ARROW_BIND_LARGE_UTF8 ||
+           kind == SF_ARROW_BIND_BINARY || kind == SF_ARROW_BIND_LARGE_BINARY;
+}
+
+SF_ARROW_BINDS *STDCALL bind_arrow_create(const struct ArrowArray *array,
+                                          const struct ArrowSchema *schema,
+                                          const char **error) {
+    SF_ARROW_BINDS *binds;
+    SF_ARROW_BIND_COLUMN *column;
+    const struct ArrowArray *child;
+    const struct ArrowSchema *child_schema;
+    int64 i;
+
+    if (!array || !schema || !array->release || !schema->release) {
+        *error = "The Arrow array or schema is missing or released";
+        return NULL;
+    }
+    if (!schema->format || strcmp(schema->format, "+s") != 0 ||
+        array->n_children != schema->n_children || array->n_children <= 0) {
+        *error = "Only a struct array with a child per column can be bound";
+        return NULL;
+    }
+    // A row can't be null as a whole, only its values
+    if (array->null_count > 0 || (array->null_count < 0 && array->n_buffers > 0 &&
+                                  array->buffers[0] != NULL)) {
+        *error = "The rows of a bound Arrow array can't be null";
+        return NULL;
+    }
+
+    binds = (SF_ARROW_BINDS *) SF_CALLOC(1, sizeof(SF_ARROW_BINDS));
+    if (binds) {
+        binds->columns = (SF_ARROW_BIND_COLUMN *) SF_CALLOC((size_t) array->n_children,
+                                                            sizeof(SF_ARROW_BIND_COLUMN));
+    }
+    if (!binds || !binds->columns) {
+        bind_arrow_term(binds);
+        *error = "Out of memory while binding an Arrow array";
+        return NULL;
+    }
+    binds->row_count = array->length;
+    binds->column_count = (size_t) array->n_children;
+
+    for (i = 0; i < array->n_children; i++) {
+        child = array->children[i];
+        child_schema = schema->children[i];
+        column = &binds->columns[i];
+        if (!child_schema->format || child_schema->dictionary ||
+            !parse_format(child_schema->format, &column->kind, &column->type)) {
+            log_error("Column %lld of the Arrow array has the unsupported format %s",
+                      (long long) i + 1, child_schema->format ? child_schema->format : "");
+            bind_arrow_term(binds);
+            *error = "An Arrow column has a format that can't be bound";
+            return NULL;
+        }
+        if (child->length < array->offset + array->length ||
+            child->n_buffers < (is_variable_length(column->kind) ? 3 : 2)) {
+            log_error("Column %lld of the Arrow array is shorter than the array",
+                      (long long) i + 1);
+            bind_arrow_term(binds);
+            *error = "An Arrow column doesn't have the layout of its format";
+            return NULL;
+        }
+        column->offset = array->offset + child->offset;
+        column->validity = child->null_count != 0 ? (const uint8 *) child->buffers[0] : NULL;
+        column->values = child->buffers[1];
+        column->data = is_variable_length(column->kind) ?
+                       (const char *) child->buffers[2] : NULL;
+    }
+    return binds;
+}
+
+void STDCALL bind_arrow_term(SF_ARROW_BINDS *binds) {
+    if (!binds) {
+        return;
+    }
+    SF_FREE(binds->columns);
+    SF_FREE(binds);
+}
+
+/**
+ * Formats a date as YYYY-MM-DD, from the days since the epoch.
+ */
+static size_t format_date(char *buffer, int64 days) {
+    // Civil from days, on the proleptic Gregorian calendar
+    int64 z = days + 719468;
+    int64 era = (z >= 0 ? z : z - 146096) / 146097;
+    int64 doe = z - era * 146097;
+    int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64 mp = (5 * doy + 2) / 153;
+    int64 day = doy - (153 * mp + 2) / 5 + 1;
+    int64 month = mp < 10 ? mp + 3 : mp - 9;
+    int64 year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%04lld-%02lld-%02lld", (long long) year,
+               (long long) month, (long long) day);
+    return strlen(buffer);
+}
+
+static size_t format_float(char *buffer, float64 value, int digits) {
+    if (isnan(value)) {
+        sb_strncpy(buffer, SF_ARROW_BIND_CELL_SIZE, "NaN", SF_ARROW_BIND_CELL_SIZE);
+    } else if (isinf(value)) {
+        sb_strncpy(buffer, SF_ARROW_BIND_CELL_SIZE, value > 0 ? "inf" : "-inf",
+                   SF_ARROW_BIND_CELL_SIZE);
+    } else {
+        // Enough digits for the value to read back the same
+        sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%.*g", digits, value);
+    }
+    return strlen(buffer);
+}
+
+const char *STDCALL bind_arrow_cell(const SF_ARROW_BINDS *binds, size_t column, int64 row,
+                                    sf_bool csv, char *buffer, SF_ARENA *arena, size_t *len) {
+    const SF_ARROW_BIND_COLUMN *c = &binds->columns[column];
+    int64 i = c->offset + row;
+    int64 start;
+    int64 end;
+    const char *text;
+
+    if (c->validity && !(c->validity[i >> 3] & (1 << (i & 7)))) {
+        *len = 0;
+        return NULL;
+    }
+    switch (c->kind) {
+        case SF_ARROW_BIND_INT8:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%d",
+                       ((const signed char *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_UINT8:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%u", ((const uint8 *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_INT16:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%d", ((const short *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_UINT16:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%u",
+                       ((const unsigned short *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_INT32:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%d", ((const int32 *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_UINT32:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%u", ((const uint32 *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_INT64:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%lld",
+                       (long long) ((const int64 *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_UINT64:
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%llu",
+                       (unsigned long long) ((const uint64 *) c->values)[i]);
+            break;
+        case SF_ARROW_BIND_FLOAT32:
+            *len = format_float(buffer, ((const float32 *) c->values)[i], 9);
+            return buffer;
+        case SF_ARROW_BIND_FLOAT64:
+            *len = format_float(buffer, ((const float64 *) c->values)[i], 17);
+            return buffer;
+        case SF_ARROW_BIND_BOOLEAN:
+            text = ((const uint8 *) c->values)[i >> 3] & (1 << (i & 7)) ?
+                   SF_BOOLEAN_INTERNAL_TRUE_STR : SF_BOOLEAN_INTERNAL_FALSE_STR;
+            *len = strlen(text);
+            return text;
+        case SF_ARROW_BIND_DATE32:
+            if (csv) {
+                *len = format_date(buffer, ((const int32 *) c->values)[i]);
+                return buffer;
+            }
+            sb_sprintf(buffer, SF_ARROW_BIND_CELL_SIZE, "%lld",
+                       (long long) ((const int32 *) c->values)[i] * SF_MS_PER_DAY);
+            break;
+        default:
+            // Variable length values, between consecutive offsets
+            if (c->kind == SF_ARROW_BIND_UTF8 || c->kind == SF_ARROW_BIND_BINARY) {
+                start = ((const int32 *) c->values)[i];
+                end = ((const int32 *) c->values)[i + 1];
+            } else {
+                start = ((const int64 *) c->values)[i];
+                end = ((const int64 *) c->values)[i + 1];
+            }
+            if (c->kind == SF_ARROW_BIND_UTF8 || c->kind == SF_ARROW_BIND_LARGE_UTF8) {
+                *len = (size_t) (end - start);
+                return c->data + start;
+            }
+            text = value_to_arena_string(arena, (void *) (c->data + start),
+                                         (size_t) (end - start), SF_C_TYPE_BINARY);
+            *len = text ? strlen(text) : 0;
+            return text;
+    }
+    *len = strlen(buffer);
+    return buffer;
+}
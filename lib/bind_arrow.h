@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_BIND_ARROW_H
+#define SNOWFLAKE_BIND_ARROW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+#include "arena.h"
+
+// Room for the text of any number or date cell
+#define SF_ARROW_BIND_CELL_SIZE 32
+
+typedef enum SF_ARROW_BIND_KIND {
+    SF_ARROW_BIND_INT8,
+    SF_ARROW_BIND_UINT8,
+    SF_ARROW_BIND_INT16,
+    SF_ARROW_BIND_UINT16,
+    SF_ARROW_BIND_INT32,
+    SF_ARROW_BIND_UINT32,
+    SF_ARROW_BIND_INT64,
+    SF_ARROW_BIND_UINT64,
+    SF_ARROW_BIND_FLOAT32,
+    SF_ARROW_BIND_FLOAT64,
+    SF_ARROW_BIND_BOOLEAN,
+    SF_ARROW_BIND_UTF8,
+    SF_ARROW_BIND_LARGE_UTF8,
+    SF_ARROW_BIND_BINARY,
+    SF_ARROW_BIND_LARGE_BINARY,
+    SF_ARROW_BIND_DATE32
+} SF_ARROW_BIND_KIND;
+
+/**
+ * A column of the bound batch, with its buffers resolved once.
+ */
+typedef struct SF_ARROW_BIND_COLUMN {
+    SF_ARROW_BIND_KIND kind;
+    // Snowflake type the values are bound as
+    SF_DB_TYPE type;
+    // Index of the first row of the batch in the buffers, the offsets of the batch and of
+    // the column added
+    int64 offset;
+    // Validity bitmap, NULL if no value is null
+    const uint8 *validity;
+    // Values, or offsets of the values of variable length types
+    const void *values;
+    // Bytes of the values of variable length types
+    const char *data;
+} SF_ARROW_BIND_COLUMN;
+
+/**
+ * A batch of rows bound to a statement, one positional parameter per column. The Arrow
+ * structures are borrowed from the caller.
+ */
+typedef struct SF_ARROW_BINDS {
+    int64 row_count;
+    size_t column_count;
+    SF_ARROW_BIND_COLUMN *columns;
+} SF_ARROW_BINDS;
+
+/**
+ * Checks the layout of a batch exported through the Arrow C data interface and resolves
+ * the buffers of its columns.
+ *
+ * @param array a struct array, the columns of which are its children.
+ * @param schema the schema of the array.
+ * @param error set to the reason the batch can't be bound, on failure.
+ *
+ * @return the binds, to free with bind_arrow_term(), or NULL.
+ */
+SF_ARROW_BINDS *STDCALL bind_arrow_create(const struct ArrowArray *array,
+                                          const struct ArrowSchema *schema,
+                                          const char **error);
+
+void STDCALL bind_arrow_term(SF_ARROW_BINDS *binds);
+
+/**
+ * Formats a cell the way its Snowflake type is bound.
+ *
+ * @param binds the binds.
+ * @param column zero based index of the column.
+ * @param row zero based index of the row.
+ * @param csv whether the text goes to a CSV file uploaded to the bind stage, which takes
+ *        dates as text rather than as milliseconds since the epoch.
+ * @param buffer SF_ARROW_BIND_CELL_SIZE bytes for the text of numbers and dates.
+ * @param arena memory for the text of binary values.
+ * @param len set to the length of the text, which isn't NUL-terminated.
+ *
+ * @return the text, or NULL if the cell is null or the arena is out of memory.
+ */
+const char *STDCALL bind_arrow_cell(const SF_ARROW_BINDS *binds, size_t column, int64 row,
+                                    sf_bool csv, char *buffer, SF_ARENA *arena, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_BIND_ARROW_H
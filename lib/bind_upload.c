@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "bind_arrow.h"
+#include "bind_upload.h"
+#include "client_int.h"
+#include "connection.h"
+#include "csv_export.h"
+#include "memory.h"
+#include "results.h"
+
+char *STDCALL bind_upload_serialize(SF_STMT *sfstmt, size_t *len) {
+    RAW_JSON_BUFFER text = {NULL, 0, 0, SF_MEMORY_TAG_NONE};
+    uint64 row;
+    size_t i;
+    SF_BIND_INPUT *input;
+    char *value;
+    SF_ARENA *arena;
+    sf_bool ok = SF_BOOLEAN_TRUE;
+
+    *len = 0;
+    if (_snowflake_get_current_param_style(sfstmt) != POSITIONAL) {
+        return NULL;
+    }
+    for (i = 0; i < sfstmt->params_len; i++) {
+        input = (SF_BIND_INPUT *) sf_param_store_get(sfstmt->params, i + 1, NULL);
+        // The text of timestamps is not supported by value_to_string()
+        if (input == NULL || input->c_type == SF_C_TYPE_TIMESTAMP) {
+            log_debug("Bind %lu can't be uploaded", (unsigned long) (i + 1));
+            return NULL;
+        }
+    }
+
+    if (!sfstmt->bind_arena) {
+        sfstmt->bind_arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    }
+    arena = (SF_ARENA *) sfstmt->bind_arena;
+    if (!arena) {
+        log_error("Out of memory while serializing the binds for upload");
+        return NULL;
+    }
+    for (row = 0; ok && row < sfstmt->paramset_size; row++) {
+        for (i = 0; ok && i < sfstmt->params_len; i++) {
+            input = (SF_BIND_INPUT *) sf_param_store_get(sfstmt->params, i + 1, NULL);
+            if (i > 0) {
+                ok = raw_json_buffer_append(&text, ",", 1);
+            }
+            value = value_to_arena_string(arena, _snowflake_bind_value_at(input, row),
+                                          input->len, input->c_type);
+            // An empty unquoted field is loaded as NULL
+            if (ok && value) {
+                ok = sf_csv_buffer_append_field(&text, value, strlen(value));
+            }
+            sf_arena_reset(arena);
+        }
+        if (ok) {
+            ok = raw_json_buffer_append(&text, "\n", 1);
+        }
+    }
+
+    if (!ok) {
+        log_error("Out of memory while serializing the binds for upload");
+        raw_json_buffer_free(&text);
+        return NULL;
+    }
+    *len = text.size;
+    return text.buffer;
+}
+
+char *STDCALL bind_upload_serialize_arrow(SF_STMT *sfstmt, size_t *len) {
+    const SF_ARROW_BINDS *binds = (const SF_ARROW_BINDS *) sfstmt->arrow_binds;
+    RAW_JSON_BUFFER text = {NULL, 0, 0, SF_MEMORY_TAG_NONE};
+    char cell[SF_ARROW_BIND_CELL_SIZE];
+    const char *value;
+    size_t value_len;
+    int64 row;
+    size_t i;
+    SF_ARENA *arena;
+    sf_bool ok = SF_BOOLEAN_TRUE;
+
+    *len = 0;
+    if (!sfstmt->bind_arena) {
+        sfstmt->bind_arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    }
+    arena = (SF_ARENA *) sfstmt->bind_arena;
+    if (!binds || !arena) {
+        return NULL;
+    }
+    // Row by row, straight from the buffers of the columns
+    for (row = 0; ok && row < binds->row_count; row++) {
+        for (i = 0; ok && i < binds->column_count; i++) {
+            if (i > 0) {
+                ok = raw_json_buffer_append(&text, ",", 1);
+            }
+            value = bind_arrow_cell(binds, i, row, SF_BOOLEAN_TRUE, cell, arena, &value_len);
+            if (ok && value) {
+                ok = sf_csv_buffer_append_field(&text, value, value_len);
+            }
+        }
+        sf_arena_reset(arena);
+        if (ok) {
+            ok = raw_json_buffer_append(&text, "\n", 1);
+        }
+    }
+
+    if (!ok) {
+        log_error("Out of memory while serializing the Arrow binds for upload");
+        raw_json_buffer_free(&text);
+        return NULL;
+    }
+    *len = text.size;
+    return text.buffer;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_BIND_UPLOAD_H
+#define SNOWFLAKE_BIND_UPLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// Temporary stage the bind files are uploaded to, created once per session
+#define SF_BIND_STAGE_NAME "SYSTEM$BIND"
+#define SF_BIND_STAGE_CREATE_SQL \
+    "CREATE TEMPORARY STAGE IF NOT EXISTS " SF_BIND_STAGE_NAME \
+    " file_format=(type=csv field_optionally_enclosed_by='\"')"
+// Size of a stage path, @SYSTEM$BIND/ followed by a UUID
+#define SF_BIND_STAGE_PATH_LEN 64
+
+/**
+ * Serializes the rows bound to a statement as CSV, one line per row and one field per
+ * positional parameter. Fields are formatted as sf_csv_buffer_append_field() does, so null
+ * values are left empty and empty strings are quoted.
+ *
+ * @param sfstmt the statement, with positional binds for sfstmt->paramset_size rows.
+ * @param len set to the length of the text.
+ *
+ * @return the text, which the caller frees with SF_FREE, or NULL if a bound type can't be
+ *         written as CSV.
+ */
+char *STDCALL bind_upload_serialize(SF_STMT *sfstmt, size_t *len);
+
+/**
+ * Serializes the Arrow batch bound to a statement as CSV, in the format of
+ * bind_upload_serialize().
+ *
+ * @param sfstmt the statement, with a batch bound by snowflake_bind_arrow().
+ * @param len set to the length of the text.
+ *
+ * @return the text, which the caller frees with SF_FREE, or NULL if out of memory.
+ */
+char *STDCALL bind_upload_serialize_arrow(SF_STMT *sfstmt, size_t *len);
+
+/**
+ * Compresses CSV text and uploads it to the bind stage of the session, creating the stage on
+ * first use.
+ *
+ * @param sfstmt the statement the binds belong to. Its error is not touched, the caller can
+ *        still send the binds with the query.
+ * @param data the CSV text.
+ * @param len the length of the text.
+ * @param stage_path receives the location to pass as bindStage in the query request.
+ *
+ * @return SF_STATUS_SUCCESS if the file was uploaded.
+ */
+SF_STATUS STDCALL bind_upload_put(SF_STMT *sfstmt, const char *data, size_t len,
+                                  char *stage_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_BIND_UPLOAD_H
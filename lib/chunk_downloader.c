@@ -3,16 +3,26 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
+#include <zlib.h>
 #include "chunk_downloader.h"
+#include "json_rowset.h"
 #include "memory.h"
 #include "connection.h"
 #include "error.h"
 #include "client_int.h"
+#include "io_threads.h"
+#include "thread_affinity.h"
+#include "tracing.h"
+#include "metrics.h"
 
 static void* chunk_downloader_thread(void *downloader);
+static void* chunk_io_thread(void *downloader);
+static void* chunk_decoder_thread(void *downloader);
 static void STDCALL set_shutdown(SF_CHUNK_DOWNLOADER *chunk_downloader, sf_bool value);
 static void STDCALL set_error(SF_CHUNK_DOWNLOADER *chunk_downloader, sf_bool value);
+static void STDCALL fail_downloader(SF_CHUNK_DOWNLOADER *chunk_downloader, SF_ERROR_STRUCT *err);
 
 #define PTHREAD_LOCK_INIT_ERROR_MSG(e, em) \
 switch(e) \
@@ -25,15 +35,6 @@ switch(e) \
     default: (em) = "Unknown non-zero pthread init error" ; break; \
 }
 
-#define PTHREAD_CREATE_ERROR_MSG(e, em) \
-switch(e) \
-{ \
-    case EAGAIN: (em) = "System lacked resources to create another thread"; break; \
-    case EPERM: (em) = "Caller doesn't have the privilege to set the required scheduling parameters"; break; \
-    case EINVAL: (em) = "The value specified by attr is invalid"; break; \
-    default: (em) = "Unknown non-zero pthread init error" ; break; \
-}
-
 #define PTHREAD_JOIN_ERROR_MSG(e, em) \
 switch(e) \
 { \
@@ -63,6 +64,7 @@ static void STDCALL set_shutdown(struct SF_CHUNK_DOWNLOADER *chunk_downloader, s
     _rwlock_wrlock(&chunk_downloader->attr_lock);
     chunk_downloader->is_shutdown = value;
     _rwlock_wrunlock(&chunk_downloader->attr_lock);
+    sf_atomic_store(&chunk_downloader->cancelled, value ? 1 : 0);
 }
 
 sf_bool STDCALL get_error(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
@@ -91,6 +93,18 @@ sf_bool STDCALL init_locks(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
         goto cleanup;
     }
 
+    if ((pthread_ret = _critical_section_init(&chunk_downloader->consumer_lock)) != 0) {
+        PTHREAD_LOCK_INIT_ERROR_MSG(pthread_ret, error_msg);
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
+        goto cleanup;
+    }
+
+    if ((pthread_ret = _critical_section_init(&chunk_downloader->url_lock)) != 0) {
+        PTHREAD_LOCK_INIT_ERROR_MSG(pthread_ret, error_msg);
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
+        goto cleanup;
+    }
+
     if ((pthread_ret = _rwlock_init(&chunk_downloader->attr_lock)) != 0) {
         PTHREAD_LOCK_INIT_ERROR_MSG(pthread_ret, error_msg);
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
@@ -106,6 +120,11 @@ sf_bool STDCALL init_locks(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
         goto cleanup;
     }
+    if ((pthread_ret = _cond_init(&chunk_downloader->decode_cond)) != 0) {
+        PTHREAD_LOCK_INIT_ERROR_MSG(pthread_ret, error_msg);
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
+        goto cleanup;
+    }
     // Success
     ret = SF_BOOLEAN_TRUE;
 
@@ -114,44 +133,165 @@ sf_bool STDCALL init_locks(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
 cleanup:
     // We may destroy some uninitialized locks/conds, but we don't care.
     _critical_section_term(&chunk_downloader->queue_lock);
+    _critical_section_term(&chunk_downloader->consumer_lock);
+    _critical_section_term(&chunk_downloader->url_lock);
     _cond_term(&chunk_downloader->producer_cond);
     _cond_term(&chunk_downloader->consumer_cond);
+    _cond_term(&chunk_downloader->decode_cond);
     _rwlock_term(&chunk_downloader->attr_lock);
     return ret;
 }
 
-sf_bool STDCALL fill_queue(struct SF_CHUNK_DOWNLOADER *chunk_downloader, cJSON *chunks, int chunk_count) {
-    int i;
-    cJSON *chunk = NULL;
+/**
+ * Picks a thread count and/or prefetch depth for parameters set to
+ * SF_CHUNK_DOWNLOADER_AUTO, based on the number of chunks and the sum of their
+ * uncompressed sizes. Falls back to the defaults when the sizes are missing.
+ */
+static void STDCALL auto_size_downloader(cJSON *chunks, uint64 *thread_count, uint64 *fetch_slots) {
+    int chunk_count = snowflake_cJSON_GetArraySize(chunks);
+    uint64 total_size = 0;
+    uint64 avg_size;
+    uint64 threads;
+    uint64 slots;
+    cJSON *entry;
+    cJSON *size;
+
+    snowflake_cJSON_ArrayForEach(entry, chunks) {
+        size = snowflake_cJSON_GetObjectItemCaseSensitive(entry, "uncompressedSize");
+        if (snowflake_cJSON_IsNumber(size) && size->valuedouble > 0) {
+            total_size += (uint64) size->valuedouble;
+        }
+    }
 
-    // We want to detach each chunk object so that after we create the queue item,
-    // we free the memory associated with the JSON blob
-    for (i = 0; i < chunk_count; i++) {
-        // Detach instead of getting so that we can free the chunk memory after we create our queue item
-        if (json_detach_object_from_array(&chunk, chunks, 0)) {
-            goto cleanup;
+    if (chunk_count <= 0 || total_size == 0) {
+        if (*thread_count == SF_CHUNK_DOWNLOADER_AUTO) {
+            *thread_count = SF_DEFAULT_CHUNK_DOWNLOADER_THREADS;
+        }
+        if (*fetch_slots == SF_CHUNK_DOWNLOADER_AUTO) {
+            *fetch_slots = SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS;
+        }
+        return;
+    }
+
+    if (*thread_count == SF_CHUNK_DOWNLOADER_AUTO) {
+        threads = total_size / SF_CHUNK_DOWNLOADER_AUTO_BYTES_PER_THREAD + 1;
+        if (threads < SF_DEFAULT_CHUNK_DOWNLOADER_THREADS) {
+            threads = SF_DEFAULT_CHUNK_DOWNLOADER_THREADS;
+        }
+        if (threads > SF_CHUNK_DOWNLOADER_AUTO_MAX_THREADS) {
+            threads = SF_CHUNK_DOWNLOADER_AUTO_MAX_THREADS;
+        }
+        if (threads > (uint64) chunk_count) {
+            threads = (uint64) chunk_count;
         }
+        *thread_count = threads;
+    }
+
+    if (*fetch_slots == SF_CHUNK_DOWNLOADER_AUTO) {
+        // Keep every thread busy with one extra chunk in flight, as long as the
+        // prefetched data fits into the prefetch budget.
+        avg_size = total_size / chunk_count + 1;
+        slots = *thread_count * 2;
+        if (slots * avg_size > SF_CHUNK_DOWNLOADER_AUTO_PREFETCH_BYTES) {
+            slots = SF_CHUNK_DOWNLOADER_AUTO_PREFETCH_BYTES / avg_size;
+        }
+        if (slots < *thread_count) {
+            slots = *thread_count;
+        }
+        *fetch_slots = slots;
+    }
+
+    log_debug("Chunk downloader auto sizing: %d chunks, %llu bytes uncompressed, "
+              "%llu threads, %llu fetch slots",
+              chunk_count, (unsigned long long) total_size,
+              (unsigned long long) *thread_count, (unsigned long long) *fetch_slots);
+}
+
+/**
+ * Checks whether a member of an object has the given key, ignoring case as
+ * snowflake_cJSON_GetObjectItem() does.
+ */
+static sf_bool STDCALL is_field(const cJSON *field, const char *key) {
+    return sf_strncasecmp(field->string, key, strlen(key) + 1) == 0 ? SF_BOOLEAN_TRUE :
+           SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Decodes an entry of the chunks array of a query response into a queue item. The fields are
+ * matched in a single pass over the entry instead of one lookup each, the first one of each
+ * key being used as with snowflake_cJSON_GetObjectItem().
+ */
+static sf_bool STDCALL decode_queue_item(SF_QUEUE_ITEM *item, const cJSON *entry) {
+    const cJSON *field;
+    sf_bool has_row_count = SF_BOOLEAN_FALSE;
+    sf_bool has_uncompressed_size = SF_BOOLEAN_FALSE;
+    sf_bool has_compressed_size = SF_BOOLEAN_FALSE;
+    size_t url_size;
+
+    if (!snowflake_cJSON_IsObject(entry)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    SF_FREE(item->url);
+    snowflake_cJSON_ArrayForEach(field, entry) {
+        if (!field->string) {
+            continue;
+        }
+        if (!item->url && is_field(field, "url")) {
+            if (!snowflake_cJSON_IsString(field)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            url_size = strlen(field->valuestring) + 1;
+            item->url = (char *) SF_MALLOC(url_size);
+            if (!item->url) {
+                return SF_BOOLEAN_FALSE;
+            }
+            memcpy(item->url, field->valuestring, url_size);
+        } else if (!has_row_count && is_field(field, "rowCount")) {
+            if (!snowflake_cJSON_IsNumber(field)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            item->row_count = (int64) field->valuedouble;
+            has_row_count = SF_BOOLEAN_TRUE;
+        } else if (!has_uncompressed_size && is_field(field, "uncompressedSize")) {
+            // Sizes are optional and only used for memory budgeting
+            if (snowflake_cJSON_IsNumber(field)) {
+                item->uncompressed_size = (int64) field->valuedouble;
+            }
+            has_uncompressed_size = SF_BOOLEAN_TRUE;
+        } else if (!has_compressed_size && is_field(field, "compressedSize")) {
+            if (snowflake_cJSON_IsNumber(field)) {
+                item->compressed_size = (int64) field->valuedouble;
+            }
+            has_compressed_size = SF_BOOLEAN_TRUE;
+        }
+    }
+
+    return item->url && has_row_count ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
 
+sf_bool STDCALL fill_queue(struct SF_CHUNK_DOWNLOADER *chunk_downloader, cJSON *chunks, int chunk_count) {
+    int i = 0;
+    cJSON *entry = NULL;
+
+    // Walk the array once, indexing into it would make the fill quadratic in the chunk count
+    snowflake_cJSON_ArrayForEach(entry, chunks) {
+        if (i >= chunk_count) {
+            break;
+        }
         chunk_downloader->queue[i].url = NULL;
         chunk_downloader->queue[i].row_count = 0;
+        chunk_downloader->queue[i].uncompressed_size = 0;
+        chunk_downloader->queue[i].compressed_size = 0;
         chunk_downloader->queue[i].chunk = NULL;
+        chunk_downloader->queue[i].consumed = SF_BOOLEAN_FALSE;
 
-        if (json_copy_string(&chunk_downloader->queue[i].url, chunk, "url")) {
-            goto cleanup;
-        }
-
-        // We need to update queue_size here to reflect the fact that we've already allocated memory for URL.
-        // This is because we use queue_size to free the created URLs if we run into an error so we must increase size
-        // here incase if we successfully copy the URL from the chunk, but fail to copy rowCount from the chunk
+        // Count the item first so that a URL copied before a missing rowCount is freed below
         chunk_downloader->queue_size++;
-
-        if (json_copy_int(&chunk_downloader->queue[i].row_count, chunk, "rowCount")) {
+        if (!decode_queue_item(&chunk_downloader->queue[i], entry)) {
+            log_error("Malformed entry %d in the chunks of the query response", i);
             goto cleanup;
         }
-
-        // Free detached chunk
-      snowflake_cJSON_Delete(chunk);
-        chunk = NULL;
+        i++;
     }
 
     return SF_BOOLEAN_TRUE;
@@ -159,8 +299,285 @@ sf_bool STDCALL fill_queue(struct SF_CHUNK_DOWNLOADER *chunk_downloader, cJSON *
 cleanup:
     for (i = 0; i < chunk_downloader->queue_size; i++) {
         SF_FREE(chunk_downloader->queue[i].url);
+        raw_json_buffer_free(&chunk_downloader->queue[i].raw);
+    }
+
+    return SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Milliseconds since the chunk downloader was created, the time base of the fetch stats.
+ */
+static uint64 STDCALL chunk_downloader_elapsed_ms(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    return sf_monotonic_time_ms() - chunk_downloader->start_ms;
+}
+
+/**
+ * Exports a span of a chunk that took the given milliseconds up to now, if the query is traced.
+ */
+static void STDCALL trace_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader, const char *name,
+                                uint64 index, uint64 elapsed_ms, SF_STATUS status) {
+    SF_TRACE_SPAN span;
+    sf_span_start_child(&span, name, &chunk_downloader->trace, elapsed_ms);
+    span.chunk_index = (int64) index;
+    span.bytes = (int64) chunk_downloader->queue[index].stats.bytes;
+    sf_span_end(&span, status);
+}
+
+/**
+ * Records a chunk that was just downloaded in the metrics and the trace of the query.
+ */
+static void STDCALL chunk_downloaded(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    SF_CHUNK_FETCH_STATS *stats = &chunk_downloader->queue[index].stats;
+    uint64 elapsed_ms = stats->download_end_ms - stats->download_start_ms;
+    sf_metric_add(SF_COUNTER_CHUNKS_DOWNLOADED, 1);
+    sf_metric_add(SF_COUNTER_CHUNK_BYTES, stats->bytes);
+    sf_metric_record(SF_HISTOGRAM_CHUNK_DOWNLOAD_TIME, elapsed_ms * 1000);
+    trace_chunk(chunk_downloader, "chunk.download", index, elapsed_ms, SF_STATUS_SUCCESS);
+}
+
+/**
+ * Makes a producer wait until the priority chunks are downloaded, or for at most
+ * SF_CHUNK_DOWNLOADER_PRIORITY_WAIT_MS from the start, so that the first rows come as soon as
+ * the whole bandwidth allows.
+ */
+static void STDCALL wait_for_priority_chunks(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    uint64 deadline_ms = chunk_downloader->start_ms + SF_CHUNK_DOWNLOADER_PRIORITY_WAIT_MS;
+    uint64 now_ms;
+
+    if (!sf_atomic_load(&chunk_downloader->priority_left)) {
+        return;
+    }
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    while (sf_atomic_load(&chunk_downloader->priority_left) &&
+           !get_shutdown_or_error(chunk_downloader) &&
+           (now_ms = sf_monotonic_time_ms()) < deadline_ms) {
+        _cond_timed_wait(&chunk_downloader->producer_cond, &chunk_downloader->queue_lock,
+                         (unsigned int) (deadline_ms - now_ms));
+    }
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+}
+
+/**
+ * Lets the other producers go once the last priority chunk is downloaded or skipped.
+ */
+static void STDCALL priority_chunk_done(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    if (index >= chunk_downloader->priority_chunks) {
+        return;
+    }
+    if (sf_atomic_fetch_sub(&chunk_downloader->priority_left, 1) == 1) {
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        _cond_broadcast(&chunk_downloader->producer_cond);
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+    }
+}
+
+/**
+ * Parses a JSON chunk body that was buffered with the opening bracket already prepended, and
+ * decodes it further with callback_decode_json if set. The rowset takes over the buffer.
+ *
+ * @return the rows of the chunk, or NULL if the body is not a valid rowset.
+ */
+static SF_JSON_ROWSET *STDCALL parse_json_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                                RAW_JSON_BUFFER *raw) {
+    char *buffer;
+    size_t size;
+    size_t capacity;
+    SF_JSON_ROWSET *rowset;
+
+    // Close the bracket opened before the download
+    if (!raw_json_buffer_append(raw, "]", 1)) {
+        return NULL;
+    }
+
+    buffer = raw->buffer;
+    size = raw->size;
+    capacity = raw->capacity;
+    raw->buffer = NULL;
+    raw->size = 0;
+    raw->capacity = 0;
+    rowset = sf_json_rowset_parse(buffer, size, capacity, raw->tag);
+    if (rowset && chunk_downloader->callback_decode_json) {
+        chunk_downloader->callback_decode_json(rowset, chunk_downloader->decode_context);
+    }
+    return rowset;
+}
+
+/**
+ * Memory a chunk takes until the consumer has it, as counted against memory_limit. Chunks are
+ * decompressed while downloading, so the uncompressed size is preferred.
+ */
+static uint64 STDCALL chunk_memory_size(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                        uint64 index) {
+    SF_QUEUE_ITEM *item = &chunk_downloader->queue[index];
+    // Only the few chunks near the consumer are decoded, the others stay as received
+    if (chunk_downloader->compressed_prefetch && item->compressed_size > 0) {
+        return (uint64) item->compressed_size;
+    }
+    if (item->uncompressed_size > 0) {
+        return (uint64) item->uncompressed_size;
+    }
+    return item->compressed_size > 0 ? (uint64) item->compressed_size : 0;
+}
+
+/**
+ * @return SF_BOOLEAN_TRUE if the bytes of the chunks the consumer has not taken yet are
+ *         counted, for memory_limit or for the memory budget.
+ */
+static sf_bool STDCALL counts_buffered(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    return chunk_downloader->memory_limit || chunk_downloader->memory_budget ?
+           SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Counts a chunk as buffered until the consumer takes it, charging the memory budget.
+ */
+static void STDCALL buffer_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    uint64 size = chunk_memory_size(chunk_downloader, index);
+    sf_atomic_fetch_add(&chunk_downloader->buffered_bytes, size);
+    sf_memory_budget_charge(chunk_downloader->memory_budget, size);
+    chunk_downloader->queue[index].buffered = SF_BOOLEAN_TRUE;
+}
+
+static void STDCALL unbuffer_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    uint64 size;
+    if (!chunk_downloader->queue[index].buffered) {
+        return;
+    }
+    size = chunk_memory_size(chunk_downloader, index);
+    sf_atomic_fetch_sub(&chunk_downloader->buffered_bytes, size);
+    sf_memory_budget_release(chunk_downloader->memory_budget, size);
+    chunk_downloader->queue[index].buffered = SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Ends the download of a streamed chunk, releasing its slot and its buffered bytes if the
+ * consumer took it already, otherwise the consumer releases them when it takes it.
+ */
+static void STDCALL finish_stream(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    SF_QUEUE_ITEM *item = &chunk_downloader->queue[index];
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    item->stream_open = SF_BOOLEAN_FALSE;
+    if (item->stream_taken) {
+        unbuffer_chunk(chunk_downloader, index);
+        sf_atomic_fetch_sub(&chunk_downloader->streams_taken, 1);
+        if (sf_atomic_load(&chunk_downloader->producers_waiting)) {
+            _cond_broadcast(&chunk_downloader->producer_cond);
+        }
+    }
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+}
+
+// Published in the slot of a spilled chunk, its rows are in the spill file
+static char spilled_chunk;
+
+// Published in the slot of a chunk that was skipped without being downloaded
+static char skipped_chunk;
+
+static sf_bool STDCALL is_skipped(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    return index < sf_atomic_load(&chunk_downloader->skip_until) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+static void STDCALL spill_path(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index,
+                               char *path, size_t size) {
+    sb_sprintf(path, size, "%s%csf_chunk_%s_%llu.json", chunk_downloader->spill_dir, PATH_SEP,
+               chunk_downloader->spill_prefix, (unsigned long long) index);
+}
+
+/**
+ * Writes an undecoded JSON chunk to the spill directory.
+ *
+ * @return SF_BOOLEAN_TRUE if the whole chunk was written.
+ */
+static sf_bool STDCALL spill_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index,
+                                   RAW_JSON_BUFFER *raw) {
+    char path[MAX_PATH];
+    FILE *file;
+    sf_bool ret;
+
+    spill_path(chunk_downloader, index, path, sizeof(path));
+    file = fopen(path, "wb");
+    if (!file) {
+        log_warn("Unable to create the spill file %s: %s", path, strerror(errno));
+        return SF_BOOLEAN_FALSE;
+    }
+    ret = fwrite(raw->buffer, 1, raw->size, file) == raw->size;
+    if (fclose(file) != 0 || !ret) {
+        log_warn("Unable to write the spill file %s", path);
+        remove(path);
+        return SF_BOOLEAN_FALSE;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Reads a spilled chunk back, decodes it and removes its file.
+ *
+ * @return the rows of the chunk, or NULL if the file couldn't be read or decoded.
+ */
+static SF_JSON_ROWSET *STDCALL unspill_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                             uint64 index) {
+    char path[MAX_PATH];
+    RAW_JSON_BUFFER raw;
+    SF_JSON_ROWSET *chunk = NULL;
+    FILE *file;
+    long size;
+
+    memset(&raw, 0, sizeof(raw));
+    raw.tag = SF_MEMORY_TAG_CHUNK_DOWNLOAD;
+    spill_path(chunk_downloader, index, path, sizeof(path));
+    file = fopen(path, "rb");
+    if (!file) {
+        log_error("Unable to open the spill file %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+        fseek(file, 0, SEEK_SET) == 0 &&
+        raw_json_buffer_reserve(&raw, (size_t) size + 1) &&
+        fread(raw.buffer, 1, (size_t) size, file) == (size_t) size) {
+        raw.size = (size_t) size;
+        chunk = parse_json_chunk(chunk_downloader, &raw);
+    } else {
+        log_error("Unable to read the spill file %s", path);
+    }
+    raw_json_buffer_free(&raw);
+    fclose(file);
+    remove(path);
+    return chunk;
+}
+
+/**
+ * Checks whether the producer that claimed the given slot has to wait before downloading it.
+ */
+static sf_bool STDCALL must_wait_for_consumer(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index) {
+    uint64 consumed = sf_atomic_load(&chunk_downloader->consumer_head);
+    uint64 streams_taken = sf_atomic_load(&chunk_downloader->streams_taken);
+    uint64 buffered;
+    uint64 size;
+
+    // Skipped chunks take neither a slot nor budget
+    if (is_skipped(chunk_downloader, index)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    // Streamed chunks the consumer took keep their slot until they are downloaded
+    if (index - consumed + streams_taken >= chunk_downloader->fetch_slots) {
+        return SF_BOOLEAN_TRUE;
     }
 
+    // In ordered mode the consumer needs chunk #consumed next, so it is always let through,
+    // as is a chunk that is bigger than the whole budget once nothing else is buffered. The
+    // memory budget may be used up by other statements too, waiting for the consumer to take
+    // a chunk of this one is the back-pressure then.
+    if (counts_buffered(chunk_downloader) && index != consumed) {
+        buffered = sf_atomic_load(&chunk_downloader->buffered_bytes);
+        size = chunk_memory_size(chunk_downloader, index);
+        if (buffered > 0 &&
+            ((chunk_downloader->memory_limit &&
+              buffered + size > chunk_downloader->memory_limit) ||
+             !sf_memory_budget_fits(chunk_downloader->memory_budget, size))) {
+            return SF_BOOLEAN_TRUE;
+        }
+    }
     return SF_BOOLEAN_FALSE;
 }
 
@@ -201,22 +618,227 @@ cleanup:
     return ret;
 }
 
-sf_bool STDCALL download_chunk(char *url, SF_HEADER *headers, cJSON **chunk, NON_JSON_RESP* non_json_resp, SF_ERROR_STRUCT *error, sf_bool insecure_mode) {
-    sf_bool ret = SF_BOOLEAN_FALSE;
-    CURL *curl = NULL;
-    curl = curl_easy_init();
+/**
+ * Copies the URL of a chunk, which a refresh may replace while the chunk is downloaded.
+ *
+ * @param generation set to the URL generation the copy belongs to.
+ *
+ * @return the URL, to be freed by the caller, or NULL if out of memory.
+ */
+static char *STDCALL copy_chunk_url(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index,
+                                    uint64 *generation) {
+    char *url;
+    size_t url_size;
+
+    _critical_section_lock(&chunk_downloader->url_lock);
+    url_size = strlen(chunk_downloader->queue[index].url) + 1;
+    url = (char *) SF_MALLOC(url_size);
+    if (url) {
+        memcpy(url, chunk_downloader->queue[index].url, url_size);
+    }
+    *generation = chunk_downloader->url_generation;
+    _critical_section_unlock(&chunk_downloader->url_lock);
+    return url;
+}
+
+/**
+ * Replaces the URLs of the chunks with the fresh ones from callback_refresh_urls, unless
+ * another thread has done so since the URL of the given generation was taken.
+ */
+static sf_bool STDCALL refresh_chunk_urls(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                          uint64 generation, SF_ERROR_STRUCT *err) {
+    cJSON *chunks;
+    cJSON *entry;
+    cJSON *field;
+    char *url;
+    size_t url_size;
+    uint64 i = 0;
+    sf_bool ret = SF_BOOLEAN_TRUE;
+
+    _critical_section_lock(&chunk_downloader->url_lock);
+    if (chunk_downloader->url_generation != generation) {
+        _critical_section_unlock(&chunk_downloader->url_lock);
+        return SF_BOOLEAN_TRUE;
+    }
+    log_info("A chunk URL was refused, requesting fresh chunk URLs");
+    chunks = chunk_downloader->callback_refresh_urls(chunk_downloader->refresh_context, err);
+    if (!chunks) {
+        _critical_section_unlock(&chunk_downloader->url_lock);
+        return SF_BOOLEAN_FALSE;
+    }
+    if ((uint64) snowflake_cJSON_GetArraySize(chunks) != chunk_downloader->queue_size) {
+        ret = SF_BOOLEAN_FALSE;
+    }
+    snowflake_cJSON_ArrayForEach(entry, chunks) {
+        if (!ret || i >= chunk_downloader->queue_size) {
+            break;
+        }
+        field = snowflake_cJSON_GetObjectItem(entry, "url");
+        if (!snowflake_cJSON_IsString(field)) {
+            ret = SF_BOOLEAN_FALSE;
+            break;
+        }
+        url_size = strlen(field->valuestring) + 1;
+        if ((url = (char *) SF_MALLOC(url_size)) == NULL) {
+            ret = SF_BOOLEAN_FALSE;
+            break;
+        }
+        memcpy(url, field->valuestring, url_size);
+        SF_FREE(chunk_downloader->queue[i].url);
+        chunk_downloader->queue[i++].url = url;
+    }
+    chunk_downloader->url_generation++;
+    _critical_section_unlock(&chunk_downloader->url_lock);
+    snowflake_cJSON_Delete(chunks);
+
+    if (!ret) {
+        SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_BAD_RESPONSE,
+                            "The refreshed chunk URLs don't match the chunks of the results.",
+                            SF_SQLSTATE_GENERAL_ERROR);
+    }
+    return ret;
+}
+
+/**
+ * Downloads a chunk with the given curl handle. The handle is reset but not cleaned up
+ * afterwards, so that the next download on the same handle can reuse the connection
+ * and TLS session to the result storage.
+ */
+sf_bool STDCALL download_chunk(CURL *curl, char *url, SF_HEADER *headers, cJSON **chunk, NON_JSON_RESP* non_json_resp, SF_ERROR_STRUCT *error, sf_bool insecure_mode,
+                               const SF_RETRY_POLICY *retry_policy) {
+    if (!curl) {
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL, "Unable to create curl handle for chunk download", "");
+        return SF_BOOLEAN_FALSE;
+    }
 
-    if (!curl || !http_perform(curl, GET_REQUEST_TYPE, url, headers, NULL, chunk, non_json_resp, DEFAULT_SNOWFLAKE_REQUEST_TIMEOUT, SF_BOOLEAN_TRUE, error, insecure_mode, 0)) {
+    if (!http_perform(curl, GET_REQUEST_TYPE, url, headers, NULL, chunk, non_json_resp, DEFAULT_SNOWFLAKE_REQUEST_TIMEOUT, SF_BOOLEAN_TRUE, error, insecure_mode, 0, retry_policy)) {
         // Error set in perform function
-        goto cleanup;
+        return SF_BOOLEAN_FALSE;
     }
 
-    ret = SF_BOOLEAN_TRUE;
+    return SF_BOOLEAN_TRUE;
+}
 
-cleanup:
-    curl_easy_cleanup(curl);
+/**
+ * Downloads a chunk of the queue with download_chunk(). A refused URL has most likely expired
+ * while the chunk waited for the consumer, so then the chunk is downloaded again with a fresh
+ * URL, up to SF_CHUNK_DOWNLOADER_MAX_URL_REFRESHES times.
+ */
+static sf_bool STDCALL download_queued_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                             CURL *curl, uint64 index, NON_JSON_RESP *resp,
+                                             SF_ERROR_STRUCT *err) {
+    uint64 generation;
+    uint64 refreshes = 0;
+    char *url;
+    sf_bool ret;
 
-    return ret;
+    while (1) {
+        if ((url = copy_chunk_url(chunk_downloader, index, &generation)) == NULL) {
+            SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                "Out of memory while downloading a chunk",
+                                SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+            return SF_BOOLEAN_FALSE;
+        }
+        ret = download_chunk(curl, url, chunk_downloader->chunk_headers, NULL, resp, err,
+                             chunk_downloader->insecure_mode, &chunk_downloader->retry_policy);
+        SF_FREE(url);
+        if (ret || err->error_code != SF_STATUS_ERROR_CHUNK_URL_EXPIRED ||
+            !chunk_downloader->callback_refresh_urls ||
+            refreshes++ >= SF_CHUNK_DOWNLOADER_MAX_URL_REFRESHES ||
+            get_shutdown_or_error(chunk_downloader)) {
+            return ret;
+        }
+        log_debug("The URL of chunk %llu was refused", (unsigned long long) index);
+        if (!refresh_chunk_urls(chunk_downloader, generation, err)) {
+            return SF_BOOLEAN_FALSE;
+        }
+        clear_snowflake_error(err);
+    }
+}
+
+/**
+ * Creates the curl multi handle and the transfer slots of the multiplexed downloader.
+ * Multiplexing is only requested when libcurl was built with HTTP/2 support; otherwise
+ * the transfers fall back to parallel HTTP/1.1 connections.
+ */
+static sf_bool STDCALL multi_init(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    curl_version_info_data *version = curl_version_info(CURLVERSION_NOW);
+    uint64 i;
+
+    chunk_downloader->transfer_count = chunk_downloader->fetch_slots;
+    if (chunk_downloader->transfer_count > SF_CHUNK_DOWNLOADER_MULTI_MAX_TRANSFERS) {
+        chunk_downloader->transfer_count = SF_CHUNK_DOWNLOADER_MULTI_MAX_TRANSFERS;
+    }
+    if (chunk_downloader->transfer_count == 0) {
+        chunk_downloader->transfer_count = 1;
+    }
+    chunk_downloader->primary_transfer_limit = chunk_downloader->transfer_count;
+    if (chunk_downloader->hedge_requests) {
+        chunk_downloader->transfer_count += SF_CHUNK_DOWNLOADER_MAX_HEDGES;
+    }
+
+    chunk_downloader->multi = curl_multi_init();
+    chunk_downloader->transfers = (SF_MULTI_TRANSFER *) SF_CALLOC(chunk_downloader->transfer_count,
+                                                                   sizeof(SF_MULTI_TRANSFER));
+    chunk_downloader->decode_queue = (uint64 *) SF_CALLOC(
+      chunk_downloader->queue_size > 0 ? chunk_downloader->queue_size : 1, sizeof(uint64));
+    if (!chunk_downloader->multi || !chunk_downloader->transfers || !chunk_downloader->decode_queue) {
+        SET_SNOWFLAKE_ERROR(chunk_downloader->sf_error, SF_STATUS_ERROR_CURL,
+                            "Unable to create curl multi handle for chunk download", "");
+        return SF_BOOLEAN_FALSE;
+    }
+
+    if (version && (version->features & CURL_VERSION_HTTP2)) {
+        curl_multi_setopt(chunk_downloader->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(chunk_downloader->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          (long) SF_CHUNK_DOWNLOADER_MULTI_MAX_CONNECTIONS);
+    } else {
+        log_debug("libcurl has no HTTP/2 support, chunks are fetched over HTTP/1.1");
+    }
+
+    for (i = 0; i < chunk_downloader->transfer_count; i++) {
+        SF_MULTI_TRANSFER *transfer = &chunk_downloader->transfers[i];
+        transfer->state = SF_TRANSFER_IDLE;
+        transfer->raw.tag = SF_MEMORY_TAG_CHUNK_DOWNLOAD;
+        transfer->djb = chunk_downloader->retry_policy.backoff;
+        transfer->retry_ctx.retry_timeout = DEFAULT_SNOWFLAKE_REQUEST_TIMEOUT;
+        transfer->retry_ctx.djb = &transfer->djb;
+        if ((transfer->curl = curl_easy_init()) == NULL) {
+            SET_SNOWFLAKE_ERROR(chunk_downloader->sf_error, SF_STATUS_ERROR_CURL,
+                                "Unable to create curl handle for chunk download", "");
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Frees the curl multi handle and the transfer slots. Must only be called once the I/O thread
+ * has exited.
+ */
+static void STDCALL multi_term(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    uint64 i;
+
+    if (chunk_downloader->transfers) {
+        for (i = 0; i < chunk_downloader->transfer_count; i++) {
+            if (!chunk_downloader->transfers[i].curl) {
+                continue;
+            }
+            if (chunk_downloader->transfers[i].state == SF_TRANSFER_RUNNING) {
+                curl_multi_remove_handle(chunk_downloader->multi, chunk_downloader->transfers[i].curl);
+            }
+            curl_easy_cleanup(chunk_downloader->transfers[i].curl);
+            raw_json_buffer_free(&chunk_downloader->transfers[i].raw);
+        }
+    }
+    if (chunk_downloader->multi) {
+        curl_multi_cleanup(chunk_downloader->multi);
+    }
+    SF_FREE(chunk_downloader->transfers);
+    SF_FREE(chunk_downloader->decode_queue);
+    chunk_downloader->multi = NULL;
+    chunk_downloader->transfer_count = 0;
 }
 
 SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
@@ -224,24 +846,41 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
                                                    cJSON *chunks,
                                                    uint64 thread_count,
                                                    uint64 fetch_slots,
+                                                   uint64 memory_limit,
+                                                   SF_MEMORY_BUDGET *memory_budget,
+                                                   sf_bool use_multi,
+                                                   sf_bool hedge_requests,
+                                                   sf_bool decoder_inflate,
+                                                   sf_bool compressed_prefetch,
+                                                   const char *spill_dir,
+                                                   SF_SCHEDULER_POOL *scheduler_pool,
+                                                   SF_QUERY_PRIORITY priority,
+                                                   const SF_TRACE_CONTEXT *trace,
                                                    SF_ERROR_STRUCT *sf_error,
                                                    sf_bool insecure_mode,
-                                                   NON_JSON_RESP* (*callback_create_resp)(void)) {
+                                                   const SF_RETRY_POLICY *retry_policy,
+                                                   NON_JSON_RESP* (*callback_create_resp)(void),
+                                                   SF_JSON_CHUNK_DECODE callback_decode_json,
+                                                   void *decode_context,
+                                                   SF_CHUNK_URL_REFRESH callback_refresh_urls,
+                                                   void *refresh_context) {
     struct SF_CHUNK_DOWNLOADER *chunk_downloader = NULL;
     const char *error_msg = NULL;
     int chunk_count;
     int i;
     int pthread_ret;
     size_t qrmk_len = 1;
-    // We need thread_count, fetch_slots, chunks, and either qrmk or chunk_headers
-    if (thread_count <= 0 ||
-            fetch_slots <= 0 ||
-            !chunks ||
+    // We need chunks, and either qrmk or chunk_headers
+    if (!chunks ||
             !snowflake_cJSON_IsArray(chunks) ||
             strcmp(chunks->string, "chunks") != 0) {
         return NULL;
     }
 
+    if (thread_count == SF_CHUNK_DOWNLOADER_AUTO || fetch_slots == SF_CHUNK_DOWNLOADER_AUTO) {
+        auto_size_downloader(chunks, &thread_count, &fetch_slots);
+    }
+
     if ((chunk_downloader = (SF_CHUNK_DOWNLOADER *) SF_CALLOC(1, sizeof(SF_CHUNK_DOWNLOADER))) == NULL) {
         return NULL;
     }
@@ -252,14 +891,90 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
     chunk_downloader->qrmk = NULL;
     chunk_downloader->chunk_headers = sf_header_create();
     chunk_downloader->thread_count = 0;
+    chunk_downloader->io_threads_taken = 0;
+    chunk_downloader->scheduler_pool = scheduler_pool;
+    chunk_downloader->priority = priority;
+    chunk_downloader->affinity_group = sf_affinity_group();
+    chunk_downloader->fetch_slots = fetch_slots;
+    chunk_downloader->memory_limit = memory_limit;
+    chunk_downloader->memory_budget = memory_budget;
+    chunk_downloader->buffered_bytes = 0;
+    chunk_downloader->streams_taken = 0;
     chunk_downloader->queue_size = 0;
     chunk_downloader->producer_head = 0;
     chunk_downloader->consumer_head = 0;
+    chunk_downloader->scan_head = 0;
+    chunk_downloader->skip_until = 0;
+    chunk_downloader->consumer_waiting = 0;
+    chunk_downloader->producers_waiting = 0;
+    chunk_downloader->use_multi = use_multi;
+    chunk_downloader->multi = NULL;
+    chunk_downloader->io_thread_started = SF_BOOLEAN_FALSE;
+    chunk_downloader->transfers = NULL;
+    chunk_downloader->transfer_count = 0;
+    chunk_downloader->primary_transfer_limit = 0;
+    chunk_downloader->hedge_requests = hedge_requests;
+    chunk_downloader->compressed_prefetch = use_multi && compressed_prefetch;
+    chunk_downloader->decoder_inflate = use_multi && (decoder_inflate || compressed_prefetch);
+    chunk_downloader->decode_ahead = 0;
+    chunk_downloader->download_time_count = 0;
+    chunk_downloader->hedge_threshold_ms = 0;
+    chunk_downloader->decode_queue = NULL;
+    chunk_downloader->decode_head = 0;
+    chunk_downloader->decode_tail = 0;
+    chunk_downloader->held_count = 0;
+    chunk_downloader->io_done = SF_BOOLEAN_FALSE;
     chunk_downloader->is_shutdown = SF_BOOLEAN_FALSE;
+    chunk_downloader->cancelled = 0;
+    if (chunk_downloader->chunk_headers) {
+        // Shutting down aborts the downloads in flight rather than waiting for them
+        chunk_downloader->chunk_headers->abort_flag = &chunk_downloader->cancelled;
+    }
     chunk_downloader->has_error = SF_BOOLEAN_FALSE;
+    chunk_downloader->start_ms = sf_monotonic_time_ms();
     chunk_downloader->sf_error = sf_error;
     chunk_downloader->insecure_mode = insecure_mode;
+    if (retry_policy) {
+        chunk_downloader->retry_policy = *retry_policy;
+    } else {
+        chunk_downloader->retry_policy.backoff.base = SF_DEFAULT_RETRY_BACKOFF_BASE;
+        chunk_downloader->retry_policy.backoff.cap = SF_DEFAULT_RETRY_BACKOFF_CAP;
+        chunk_downloader->retry_policy.budget_tokens = NULL;
+        chunk_downloader->retry_policy.budget_max = 0;
+    }
     chunk_downloader->callback_create_resp = callback_create_resp;
+    chunk_downloader->callback_decode_json = callback_decode_json;
+    chunk_downloader->decode_context = decode_context;
+    chunk_downloader->callback_refresh_urls = callback_refresh_urls;
+    chunk_downloader->refresh_context = refresh_context;
+    chunk_downloader->url_generation = 0;
+    chunk_downloader->spill_dir = NULL;
+    if (trace) {
+        chunk_downloader->trace = *trace;
+    }
+
+    // Chunks are only spilled where the memory budget would make the producers wait, and only
+    // JSON chunks, whose undecoded body can be decoded later on the consumer side
+    if (!is_string_empty(spill_dir) && (memory_limit || memory_budget) && !use_multi &&
+        !callback_create_resp) {
+        size_t spill_dir_len = strlen(spill_dir) + 1;
+        chunk_downloader->spill_dir = (char *) SF_CALLOC(1, spill_dir_len);
+        if (!chunk_downloader->spill_dir) {
+            goto cleanup;
+        }
+        sb_strncpy(chunk_downloader->spill_dir, spill_dir_len, spill_dir, spill_dir_len);
+        uuid4_generate(chunk_downloader->spill_prefix);
+    } else if (!is_string_empty(spill_dir)) {
+        log_debug("Chunks are not spilled without a memory limit, in multiplexed mode or in "
+                  "Arrow format");
+    }
+
+    if (!chunk_downloader->chunk_headers) {
+        SET_SNOWFLAKE_ERROR(sf_error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Unable to allocate the chunk headers",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        goto cleanup;
+    }
 
     // Initialize chunk_headers or qrmk
     if (chunk_headers) {
@@ -271,12 +986,23 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
         chunk_downloader->qrmk = (char *) SF_CALLOC(1, qrmk_len);
         sb_strncpy(chunk_downloader->qrmk, qrmk_len, qrmk, qrmk_len);
     }
+    if (chunk_downloader->decoder_inflate) {
+        // Asked for by libcurl otherwise, which then also inflates the bodies
+        chunk_downloader->chunk_headers->header = curl_slist_append(
+          chunk_downloader->chunk_headers->header, "Accept-Encoding: gzip");
+    }
 
     // Initialize mutexes and conditional variables
     if (!init_locks(chunk_downloader)) {
         goto cleanup;
     }
 
+    // A process running many statements at once starts fewer threads for each of them
+    chunk_downloader->io_threads_taken = sf_io_threads_acquire(thread_count);
+    thread_count = chunk_downloader->io_threads_taken;
+    // One chunk per decoder thread is decoded ahead of the consumer
+    chunk_downloader->decode_ahead = thread_count > 0 ? thread_count : 1;
+
     // Initialize queue and thread memory
     chunk_count = snowflake_cJSON_GetArraySize(chunks);
     chunk_downloader->threads = (SF_THREAD_HANDLE *)SF_CALLOC((int)thread_count, sizeof(SF_THREAD_HANDLE));
@@ -290,12 +1016,31 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
         goto cleanup;
     }
 
+    // With a single thread the chunks are downloaded in order anyway. The I/O thread of the
+    // multiplexed mode weighs the streams of the priority chunks instead.
+    chunk_downloader->priority_chunks = 0;
+    if (thread_count > 1 && !use_multi) {
+        chunk_downloader->priority_chunks = chunk_downloader->queue_size < SF_CHUNK_DOWNLOADER_PRIORITY_CHUNKS ?
+                                            chunk_downloader->queue_size : SF_CHUNK_DOWNLOADER_PRIORITY_CHUNKS;
+    }
+    chunk_downloader->priority_left = chunk_downloader->priority_chunks;
+
+    // With a memory budget the prefetch depth is bounded by bytes instead of chunks
+    if (memory_limit) {
+        chunk_downloader->fetch_slots = chunk_downloader->queue_size > 0 ? chunk_downloader->queue_size : 1;
+    }
+
+    // In multiplexed mode the threads only decode, the transfers are driven by the I/O thread
+    if (use_multi && !multi_init(chunk_downloader)) {
+        goto cleanup;
+    }
+
     // Initialize threads
     for (i = 0; i < thread_count; i++) {
         // If non-zero exit code, terminate chunk downloader
         if ((pthread_ret = _thread_init(
               &chunk_downloader->threads[i],
-              chunk_downloader_thread,
+              use_multi ? chunk_decoder_thread : chunk_downloader_thread,
               (void *)chunk_downloader)) != 0) {
             chunk_downloader_term(chunk_downloader);
             PTHREAD_CREATE_ERROR_MSG(pthread_ret, error_msg);
@@ -306,14 +1051,30 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
         chunk_downloader->thread_count++;
     }
 
+    if (use_multi) {
+        if ((pthread_ret = _thread_init(&chunk_downloader->io_thread, chunk_io_thread,
+                                        (void *)chunk_downloader)) != 0) {
+            chunk_downloader_term(chunk_downloader);
+            PTHREAD_CREATE_ERROR_MSG(pthread_ret, error_msg);
+            SET_SNOWFLAKE_ERROR(sf_error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
+            return NULL;
+        }
+        chunk_downloader->io_thread_started = SF_BOOLEAN_TRUE;
+    }
+
     return chunk_downloader;
 
 cleanup:
     if (chunk_downloader) {
+        if (use_multi) {
+            multi_term(chunk_downloader);
+        }
         SF_FREE(chunk_downloader->qrmk);
+        SF_FREE(chunk_downloader->spill_dir);
         sf_header_destroy(chunk_downloader->chunk_headers);
         SF_FREE(chunk_downloader->queue);
         SF_FREE(chunk_downloader->threads);
+        sf_io_threads_release(chunk_downloader->io_threads_taken);
     }
     SF_FREE(chunk_downloader);
 
@@ -341,15 +1102,18 @@ sf_bool STDCALL chunk_downloader_term(struct SF_CHUNK_DOWNLOADER *chunk_download
     }
 
     do {
-        // Already shutting down, just return false
-        if (get_shutdown(chunk_downloader)) {
-            return SF_BOOLEAN_FALSE;
-        }
+        // Once cancelled, the threads are stopping already and only need to be joined
+        if (!get_shutdown(chunk_downloader)) {
+            set_shutdown(chunk_downloader, SF_BOOLEAN_TRUE);
 
-        set_shutdown(chunk_downloader, SF_BOOLEAN_TRUE);
+            if (chunk_downloader->multi) {
+                curl_multi_wakeup(chunk_downloader->multi);
+            }
+        }
 
         if (_cond_broadcast(&chunk_downloader->consumer_cond) ||
             _cond_broadcast(&chunk_downloader->producer_cond) ||
+            _cond_broadcast(&chunk_downloader->decode_cond) ||
                 (_critical_section_unlock(&chunk_downloader->queue_lock))) {
             // Something went wrong with either notifying the producer/consumer or releasing the queue lock
             // Set and error and then try to continue with cleanup
@@ -377,116 +1141,1214 @@ sf_bool STDCALL chunk_downloader_term(struct SF_CHUNK_DOWNLOADER *chunk_download
                 _rwlock_wrunlock(&chunk_downloader->attr_lock);
             }
         }
-    } while (0);
 
-    // Free chunk downloader memory
-    SF_FREE(chunk_downloader->threads);
-    // Free all the memory of the items in the queue before freeing queue memory
+        if (chunk_downloader->io_thread_started &&
+            (pthread_ret = _thread_join(chunk_downloader->io_thread)) != 0) {
+            _rwlock_wrlock(&chunk_downloader->attr_lock);
+            if (!chunk_downloader->has_error) {
+                PTHREAD_JOIN_ERROR_MSG(pthread_ret, error_msg);
+                SET_SNOWFLAKE_ERROR(chunk_downloader->sf_error, SF_STATUS_ERROR_PTHREAD, error_msg, "");
+                chunk_downloader->has_error = SF_BOOLEAN_TRUE;
+            }
+            _rwlock_wrunlock(&chunk_downloader->attr_lock);
+        }
+    } while (0);
+
+    if (chunk_downloader->use_multi) {
+        multi_term(chunk_downloader);
+    }
+
+    // The chunks the consumer didn't take are charged to the budget until now
+    sf_memory_budget_release(chunk_downloader->memory_budget,
+                             sf_atomic_load(&chunk_downloader->buffered_bytes));
+
+    // Free chunk downloader memory
+    SF_FREE(chunk_downloader->threads);
+    sf_io_threads_release(chunk_downloader->io_threads_taken);
+    // Free all the memory of the items in the queue before freeing queue memory
     for (i = 0; i < chunk_downloader->queue_size; i++) {
         SF_FREE(chunk_downloader->queue[i].url);
-      snowflake_cJSON_Delete(chunk_downloader->queue[i].chunk);
+        raw_json_buffer_free(&chunk_downloader->queue[i].raw);
+        if (chunk_downloader->queue[i].chunk == &skipped_chunk) {
+            continue;
+        }
+        if (chunk_downloader->queue[i].chunk == &spilled_chunk) {
+            char path[MAX_PATH];
+            spill_path(chunk_downloader, i, path, sizeof(path));
+            remove(path);
+        } else if (!chunk_downloader->callback_create_resp) {
+            // Chunks of other formats belong to the callback that created them
+            sf_json_rowset_free((SF_JSON_ROWSET *) chunk_downloader->queue[i].chunk);
+        }
     }
     SF_FREE(chunk_downloader->queue);
     SF_FREE(chunk_downloader->qrmk);
+    SF_FREE(chunk_downloader->spill_dir);
     sf_header_destroy(chunk_downloader->chunk_headers);
     _critical_section_term(&chunk_downloader->queue_lock);
+    _critical_section_term(&chunk_downloader->consumer_lock);
+    _critical_section_term(&chunk_downloader->url_lock);
     _cond_term(&chunk_downloader->producer_cond);
     _cond_term(&chunk_downloader->consumer_cond);
+    _cond_term(&chunk_downloader->decode_cond);
     _rwlock_term(&chunk_downloader->attr_lock);
     SF_FREE(chunk_downloader);
 
     return SF_BOOLEAN_TRUE;
 }
 
+/**
+ * Wakes up every thread parked on the chunk downloader conditions, e.g. after an error.
+ */
+static void STDCALL wake_all(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    _cond_broadcast(&chunk_downloader->consumer_cond);
+    _cond_broadcast(&chunk_downloader->producer_cond);
+    _cond_broadcast(&chunk_downloader->decode_cond);
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+    if (chunk_downloader->multi) {
+        curl_multi_wakeup(chunk_downloader->multi);
+    }
+}
+
+void STDCALL chunk_downloader_cancel(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    if (!chunk_downloader || get_shutdown(chunk_downloader)) {
+        return;
+    }
+    log_debug("Cancelling the chunk downloads");
+    set_shutdown(chunk_downloader, SF_BOOLEAN_TRUE);
+    wake_all(chunk_downloader);
+}
+
+/**
+ * Looks for a downloaded chunk the consumer can take. In ordered mode that is only the
+ * lowest unconsumed slot, otherwise any published slot in the current window.
+ */
+static sf_bool STDCALL find_ready_slot(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                       sf_bool unordered,
+                                       uint64 *index,
+                                       void **ready) {
+    uint64 i;
+    uint64 end = unordered ? sf_atomic_load(&chunk_downloader->producer_head) :
+                 chunk_downloader->scan_head + 1;
+
+    if (end > chunk_downloader->queue_size) {
+        end = chunk_downloader->queue_size;
+    }
+    for (i = chunk_downloader->scan_head; i < end; i++) {
+        if (chunk_downloader->queue[i].consumed) {
+            continue;
+        }
+        if ((*ready = sf_atomic_load_ptr(&chunk_downloader->queue[i].chunk)) != NULL) {
+            *index = i;
+            return SF_BOOLEAN_TRUE;
+        }
+    }
+    return SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Hands the held chunks that the consumer has got close to over to the decoder threads,
+ * see compressed_prefetch.
+ */
+static void STDCALL release_held_chunks(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    uint64 i;
+    uint64 end = sf_atomic_load(&chunk_downloader->consumer_head) + chunk_downloader->decode_ahead;
+    sf_bool released = SF_BOOLEAN_FALSE;
+
+    if (end > chunk_downloader->queue_size) {
+        end = chunk_downloader->queue_size;
+    }
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    for (i = chunk_downloader->scan_head; i < end && chunk_downloader->held_count > 0; i++) {
+        if (chunk_downloader->queue[i].held) {
+            chunk_downloader->queue[i].held = SF_BOOLEAN_FALSE;
+            chunk_downloader->held_count--;
+            chunk_downloader->decode_queue[chunk_downloader->decode_tail++] = i;
+            released = SF_BOOLEAN_TRUE;
+        }
+    }
+    if (released) {
+        _cond_broadcast(&chunk_downloader->decode_cond);
+    }
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+}
+
+sf_bool STDCALL chunk_downloader_next_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                            sf_bool unordered,
+                                            uint64 *index,
+                                            void **chunk) {
+    void *ready = NULL;
+    sf_bool found;
+    uint64 wait_start;
+
+next:
+    *chunk = NULL;
+    *index = chunk_downloader->scan_head;
+    if (chunk_downloader->scan_head >= chunk_downloader->queue_size) {
+        // No more chunks
+        return SF_BOOLEAN_TRUE;
+    }
+
+    // Fast path: a chunk has already been published, no lock needed.
+    found = find_ready_slot(chunk_downloader, unordered, index, &ready);
+    if (!found) {
+        wait_start = sf_monotonic_time_ms();
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        // Announce that we're waiting before re-checking the slots, so that a producer
+        // either sees the flag or we see its chunk.
+        sf_atomic_store(&chunk_downloader->consumer_waiting, 1);
+        while (!(found = find_ready_slot(chunk_downloader, unordered, index, &ready)) &&
+               !get_shutdown_or_error(chunk_downloader)) {
+            _cond_wait(&chunk_downloader->consumer_cond, &chunk_downloader->queue_lock);
+        }
+        sf_atomic_store(&chunk_downloader->consumer_waiting, 0);
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+        if (found) {
+            chunk_downloader->queue[*index].stats.consumer_wait_ms = sf_monotonic_time_ms() - wait_start;
+        }
+    }
+
+    if (!found || get_shutdown_or_error(chunk_downloader)) {
+        // Cancelled results end here, ready chunks or not
+        *chunk = NULL;
+        return get_error(chunk_downloader) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
+    }
+
+    // Remove chunk reference from the queue and free up the slot
+    sf_atomic_store_ptr(&chunk_downloader->queue[*index].chunk, NULL);
+    chunk_downloader->queue[*index].consumed = SF_BOOLEAN_TRUE;
+    while (chunk_downloader->scan_head < chunk_downloader->queue_size &&
+           chunk_downloader->queue[chunk_downloader->scan_head].consumed) {
+        chunk_downloader->scan_head++;
+    }
+    if (chunk_downloader->queue[*index].streamed) {
+        // Still downloading, the download releases the chunk when it finishes
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        chunk_downloader->queue[*index].stream_taken = SF_BOOLEAN_TRUE;
+        if (chunk_downloader->queue[*index].stream_open) {
+            sf_atomic_fetch_add(&chunk_downloader->streams_taken, 1);
+        } else {
+            unbuffer_chunk(chunk_downloader, *index);
+        }
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+    } else {
+        unbuffer_chunk(chunk_downloader, *index);
+    }
+    sf_atomic_fetch_add(&chunk_downloader->consumer_head, 1);
+    if (sf_atomic_load(&chunk_downloader->producers_waiting)) {
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        _cond_broadcast(&chunk_downloader->producer_cond);
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+    }
+    // The I/O thread may be throttled on the slot we just freed
+    if (chunk_downloader->multi) {
+        curl_multi_wakeup(chunk_downloader->multi);
+    }
+    if (chunk_downloader->compressed_prefetch) {
+        release_held_chunks(chunk_downloader);
+    }
+
+    if (ready == &skipped_chunk) {
+        goto next;
+    }
+    if (ready == &spilled_chunk) {
+        SF_CHUNK_FETCH_STATS *stats = &chunk_downloader->queue[*index].stats;
+        uint64 decode_start = sf_monotonic_time_ms();
+        ready = unspill_chunk(chunk_downloader, *index);
+        stats->decode_ms += sf_monotonic_time_ms() - decode_start;
+        if (!ready) {
+            SF_ERROR_STRUCT err;
+            memset(&err, 0, sizeof(err));
+            SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_JSON,
+                                "Unable to read back a chunk spilled to disk.",
+                                SF_SQLSTATE_GENERAL_ERROR);
+            fail_downloader(chunk_downloader, &err);
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    *chunk = ready;
+    return SF_BOOLEAN_TRUE;
+}
+
+void STDCALL chunk_downloader_skip(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 count) {
+    uint64 until = chunk_downloader->scan_head + count;
+
+    if (until > chunk_downloader->queue_size) {
+        until = chunk_downloader->queue_size;
+    }
+    if (until <= sf_atomic_load(&chunk_downloader->skip_until)) {
+        return;
+    }
+    sf_atomic_store(&chunk_downloader->skip_until, until);
+    // Producers waiting for the consumer may hold one of the skipped chunks
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    _cond_broadcast(&chunk_downloader->producer_cond);
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+    if (chunk_downloader->multi) {
+        curl_multi_wakeup(chunk_downloader->multi);
+    }
+}
+
+/**
+ * Publishes a downloaded chunk into its queue slot and notifies the consumer if it is
+ * waiting for one.
+ */
+static sf_bool STDCALL publish_chunk(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 index, void *chunk) {
+    sf_bool ret = SF_BOOLEAN_TRUE;
+
+    sf_atomic_store_ptr(&chunk_downloader->queue[index].chunk, chunk);
+
+    if (sf_atomic_load(&chunk_downloader->consumer_waiting)) {
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        if (_cond_signal(&chunk_downloader->consumer_cond)) {
+            _rwlock_wrlock(&chunk_downloader->attr_lock);
+            if (!chunk_downloader->has_error) {
+                SET_SNOWFLAKE_ERROR(chunk_downloader->sf_error, SF_STATUS_ERROR_PTHREAD,
+                                    "Error sending consumer signal to notify of chunk downloaded", "");
+                chunk_downloader->has_error = SF_BOOLEAN_TRUE;
+            }
+            _rwlock_wrunlock(&chunk_downloader->attr_lock);
+            ret = SF_BOOLEAN_FALSE;
+        }
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+    }
+    return ret;
+}
+
+/**
+ * Records an error of a downloader thread, unless an error was recorded already, and wakes up
+ * every thread so that it notices.
+ */
+static void STDCALL fail_downloader(struct SF_CHUNK_DOWNLOADER *chunk_downloader, SF_ERROR_STRUCT *err) {
+    _rwlock_wrlock(&chunk_downloader->attr_lock);
+    if (!chunk_downloader->has_error) {
+        copy_snowflake_error(chunk_downloader->sf_error, err);
+        chunk_downloader->has_error = SF_BOOLEAN_TRUE;
+    }
+    _rwlock_wrunlock(&chunk_downloader->attr_lock);
+    wake_all(chunk_downloader);
+}
+
+/**
+ * Response wrapper of the blocking downloader threads. Counts the attempts and bytes of a
+ * download and passes the data on to the chunk's own response, or buffers it for JSON chunks.
+ */
+typedef struct SF_COUNTING_BUFFER {
+    NON_JSON_RESP *inner;
+    RAW_JSON_BUFFER raw;
+    // Size of the chunk reported by the server, the body is buffered in one allocation
+    uint64 expected_size;
+    uint64 attempts;
+    SF_CHUNK_FETCH_STATS *stats;
+} SF_COUNTING_BUFFER;
+
+static size_t counting_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    SF_COUNTING_BUFFER *counter = (SF_COUNTING_BUFFER *) userdata;
+
+    counter->stats->bytes += size * nmemb;
+    if (counter->inner) {
+        return counter->inner->write_callback(ptr, size, nmemb, counter->inner->buffer);
+    }
+    return json_resp_cb(ptr, size, nmemb, &counter->raw);
+}
+
+static void counting_reset_callback(void *userdata) {
+    SF_COUNTING_BUFFER *counter = (SF_COUNTING_BUFFER *) userdata;
+
+    counter->attempts++;
+    counter->stats->retries = counter->attempts - 1;
+    counter->stats->bytes = 0;
+    if (counter->inner) {
+        if (counter->inner->reset_callback) {
+            counter->inner->reset_callback(counter->inner->buffer);
+        }
+        return;
+    }
+    // JSON chunks come without the enclosing brackets. The memory of a failed attempt is kept.
+    counter->raw.size = 0;
+    raw_json_buffer_reserve(&counter->raw, counter->expected_size + 2);
+    raw_json_buffer_append(&counter->raw, "[", 1);
+}
+
 static void * chunk_downloader_thread(void *downloader) {
     struct SF_CHUNK_DOWNLOADER *chunk_downloader = (SF_CHUNK_DOWNLOADER *) downloader;
-    cJSON *chunk = NULL;
+    SF_JSON_ROWSET *chunk = NULL;
+    NON_JSON_RESP stream_resp;
+    NON_JSON_RESP counting_resp;
+    SF_COUNTING_BUFFER counter;
+    SF_CHUNK_FETCH_STATS *stats;
+    uint64 decode_start;
     uint64 index;
+    sf_bool spill;
+    sf_bool skip;
+    sf_bool decoded;
+    sf_bool downloaded;
     // Create err per thread so we don't have to lock the chunk downloader err
     SF_ERROR_STRUCT err;
     memset(&err, 0, sizeof(err));
     clear_snowflake_error(&err);
+    // Before the handle and the buffers are allocated, for them to be local to the thread
+    sf_affinity_apply(chunk_downloader->affinity_group);
+    // One handle per thread for all of its downloads, so that keep-alive connections
+    // and TLS sessions are reused instead of doing a new handshake for every chunk.
+    CURL *curl = curl_easy_init();
 
     // Loop forever until shutdown
     while (1) {
         // Reset from previous loop
         chunk = NULL;
-        _critical_section_lock(&chunk_downloader->queue_lock);
+        spill = SF_BOOLEAN_FALSE;
 
-        // If we've downloaded chunks == # of threads, wait until the consumer consumes a chunk.
-        // Ensure that the producer_head is less than the queue_size to ensure that we still have items to process
-        // If we're shutting down or an err has occurred, skip
-        while ((chunk_downloader->producer_head - chunk_downloader->consumer_head) >= chunk_downloader->thread_count &&
-                chunk_downloader->producer_head < chunk_downloader->queue_size &&
-                !get_shutdown_or_error(chunk_downloader)) {
-            _cond_wait(&chunk_downloader->producer_cond, &chunk_downloader->queue_lock);
-        }
+        // Claim the next queue slot. Once producer_head passes queue_size every thread exits.
+        index = sf_atomic_fetch_add(&chunk_downloader->producer_head, 1);
 
         // If we're shutting down, or we have reached the end of the results, then break
-        if (get_shutdown_or_error(chunk_downloader) || chunk_downloader->producer_head >= chunk_downloader->queue_size) {
+        if (index >= chunk_downloader->queue_size || get_shutdown_or_error(chunk_downloader)) {
             break;
         }
+        stats = &chunk_downloader->queue[index].stats;
+        stats->queued_ms = chunk_downloader_elapsed_ms(chunk_downloader);
 
-        // Get queue item and set it locally
-        index = chunk_downloader->producer_head++;
+        if (index >= chunk_downloader->priority_chunks) {
+            wait_for_priority_chunks(chunk_downloader);
+        }
 
-        // Unlock since we have our queue item, and don't need the lock while we're processing the queue
-        _critical_section_unlock(&chunk_downloader->queue_lock);
+        // If fetch_slots chunks (or memory_limit bytes) are already downloaded or in flight ahead
+        // of the consumer, wait until the consumer takes one. If we're shutting down or an err has
+        // occurred, skip. With a memory budget the check and the reservation happen under
+        // queue_lock so that concurrent producers can't overshoot the budget.
+        if (counts_buffered(chunk_downloader) || must_wait_for_consumer(chunk_downloader, index)) {
+            _critical_section_lock(&chunk_downloader->queue_lock);
+            sf_atomic_fetch_add(&chunk_downloader->producers_waiting, 1);
+            while (must_wait_for_consumer(chunk_downloader, index) &&
+                   !get_shutdown_or_error(chunk_downloader)) {
+                // Rather than holding the chunk URL until it may expire, download it to disk
+                if (chunk_downloader->spill_dir) {
+                    spill = SF_BOOLEAN_TRUE;
+                    break;
+                }
+                _cond_wait(&chunk_downloader->producer_cond, &chunk_downloader->queue_lock);
+            }
+            sf_atomic_fetch_sub(&chunk_downloader->producers_waiting, 1);
+            // Decided under the lock, so that the budget is only reserved for a chunk that
+            // is downloaded
+            skip = is_skipped(chunk_downloader, index);
+            if (counts_buffered(chunk_downloader) && !spill && !skip) {
+                buffer_chunk(chunk_downloader, index);
+            }
+            _critical_section_unlock(&chunk_downloader->queue_lock);
+
+            if (get_shutdown_or_error(chunk_downloader)) {
+                break;
+            }
+        } else {
+            skip = is_skipped(chunk_downloader, index);
+        }
+
+        if (skip) {
+            chunk_downloader->queue[index].skipped = SF_BOOLEAN_TRUE;
+            priority_chunk_done(chunk_downloader, index);
+            if (!publish_chunk(chunk_downloader, index, &skipped_chunk)) {
+                break;
+            }
+            continue;
+        }
 
         // Download chunk
-        cJSON** chunk_ptr = &chunk;
         NON_JSON_RESP * non_json_resp = NULL;
+        sf_bool streaming = SF_BOOLEAN_FALSE;
+        memset(&counter, 0, sizeof(counter));
+        counter.raw.tag = SF_MEMORY_TAG_CHUNK_DOWNLOAD;
+        counter.stats = stats;
+        counter.expected_size = chunk_downloader->queue[index].uncompressed_size > 0 ?
+                                (uint64) chunk_downloader->queue[index].uncompressed_size : 0;
         // create response buffer for arrow
         if (chunk_downloader->callback_create_resp)
         {
-            chunk_ptr = NULL;
             non_json_resp = chunk_downloader->callback_create_resp();
+            streaming = non_json_resp->finish_callback ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+            counter.inner = non_json_resp;
+        }
+        if (streaming) {
+            // A streamed chunk is published before it is downloaded, so that the consumer can
+            // take its rows as they arrive. The consumer frees the response once it takes the
+            // chunk, so keep a copy of it for the download.
+            stream_resp = *non_json_resp;
+            chunk_downloader->queue[index].streamed = SF_BOOLEAN_TRUE;
+            chunk_downloader->queue[index].stream_open = SF_BOOLEAN_TRUE;
+            if (!publish_chunk(chunk_downloader, index, (void *)non_json_resp)) {
+                stream_resp.finish_callback(stream_resp.buffer, SF_BOOLEAN_FALSE);
+                finish_stream(chunk_downloader, index);
+                break;
+            }
+            counter.inner = &stream_resp;
         }
-        if (!download_chunk(chunk_downloader->queue[index].url, chunk_downloader->chunk_headers,
-          chunk_ptr, non_json_resp, &err, chunk_downloader->insecure_mode)) {
+        // The body goes through a counting buffer so that retries and bytes show up in the
+        // fetch stats. JSON chunks are parsed here rather than in http_perform for the same reason.
+        counting_resp.write_callback = counting_write_callback;
+        counting_resp.buffer = (void *) &counter;
+        counting_resp.reset_callback = counting_reset_callback;
+        counting_resp.finish_callback = NULL;
+        counting_resp.decode_callback = NULL;
+        counting_resp.free_callback = NULL;
+        sf_scheduler_acquire(chunk_downloader->scheduler_pool, SF_SCHEDULER_CHUNK_DOWNLOADS,
+                             chunk_downloader->priority);
+        stats->download_start_ms = chunk_downloader_elapsed_ms(chunk_downloader);
+        downloaded = download_queued_chunk(chunk_downloader, curl, index, &counting_resp, &err);
+        sf_scheduler_release(chunk_downloader->scheduler_pool, SF_SCHEDULER_CHUNK_DOWNLOADS);
+        if (!downloaded) {
+            raw_json_buffer_free(&counter.raw);
+            trace_chunk(chunk_downloader, "chunk.download", index,
+                        chunk_downloader_elapsed_ms(chunk_downloader) - stats->download_start_ms,
+                        err.error_code);
             _rwlock_wrlock(&chunk_downloader->attr_lock);
-            if (!chunk_downloader->has_error) {
+            // A download aborted by the shutdown isn't an error of the results
+            if (!chunk_downloader->has_error && !chunk_downloader->is_shutdown) {
                 copy_snowflake_error(chunk_downloader->sf_error, &err);
                 chunk_downloader->has_error = SF_BOOLEAN_TRUE;
             }
             _rwlock_wrunlock(&chunk_downloader->attr_lock);
+            // The error is set before the stream ends, so that the consumer sees it
+            if (streaming) {
+                stream_resp.finish_callback(stream_resp.buffer, SF_BOOLEAN_FALSE);
+                finish_stream(chunk_downloader, index);
+            }
+            // Let the consumer and the other producers notice the error
+            wake_all(chunk_downloader);
+            break;
+        }
+
+        stats->download_end_ms = chunk_downloader_elapsed_ms(chunk_downloader);
+        chunk_downloaded(chunk_downloader, index);
+        priority_chunk_done(chunk_downloader, index);
+
+        if (streaming) {
+            stream_resp.finish_callback(stream_resp.buffer, SF_BOOLEAN_TRUE);
+            finish_stream(chunk_downloader, index);
+            continue;
+        }
+
+        if (spill && !non_json_resp) {
+            if (spill_chunk(chunk_downloader, index, &counter.raw)) {
+                raw_json_buffer_free(&counter.raw);
+                chunk_downloader->queue[index].spilled = SF_BOOLEAN_TRUE;
+                if (!publish_chunk(chunk_downloader, index, &spilled_chunk)) {
+                    break;
+                }
+                continue;
+            }
+            // Kept in memory over the budget then
+            buffer_chunk(chunk_downloader, index);
+        }
+
+        if (!non_json_resp) {
+            decode_start = sf_monotonic_time_ms();
+            chunk = parse_json_chunk(chunk_downloader, &counter.raw);
+            raw_json_buffer_free(&counter.raw);
+            stats->decode_ms += sf_monotonic_time_ms() - decode_start;
+            trace_chunk(chunk_downloader, "chunk.parse", index,
+                        sf_monotonic_time_ms() - decode_start,
+                        chunk ? SF_STATUS_SUCCESS : SF_STATUS_ERROR_BAD_JSON);
+            if (!chunk) {
+                SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_JSON,
+                                    "Unable to parse JSON text response.",
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
+                fail_downloader(chunk_downloader, &err);
+                break;
+            }
+        } else if (non_json_resp->decode_callback) {
+            // Decoded here like the JSON chunks, rather than by the consumer in snowflake_fetch
+            decode_start = sf_monotonic_time_ms();
+            decoded = non_json_resp->decode_callback(non_json_resp->buffer);
+            stats->decode_ms += sf_monotonic_time_ms() - decode_start;
+            trace_chunk(chunk_downloader, "chunk.parse", index,
+                        sf_monotonic_time_ms() - decode_start,
+                        decoded ? SF_STATUS_SUCCESS : SF_STATUS_ERROR_BAD_RESPONSE);
+            if (!decoded) {
+                SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_RESPONSE,
+                                    "Unable to decode the chunk response.",
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
+                fail_downloader(chunk_downloader, &err);
+                break;
+            }
+        }
+
+        // Publish the chunk, which marks the slot as ready
+        if (!publish_chunk(chunk_downloader, index,
+                           chunk_downloader->callback_create_resp ? (void *)non_json_resp : (void *)chunk)) {
             break;
         }
+    }
+
+    curl_easy_cleanup(curl);
+    _thread_exit();
+    return NULL;
+}
+
+static sf_bool STDCALL is_retryable_curl_code(CURLcode code) {
+    switch (code) {
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_GOT_NOTHING:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return SF_BOOLEAN_TRUE;
+        default:
+            return SF_BOOLEAN_FALSE;
+    }
+}
+
+/**
+ * Header callback of the transfers whose bodies are inflated by the decoder threads. Notes
+ * whether the body of the final response is gzip compressed.
+ */
+static size_t chunk_header_cb(char *data, size_t size, size_t nmemb, void *userdata) {
+    SF_MULTI_TRANSFER *transfer = (SF_MULTI_TRANSFER *) userdata;
+    size_t len = size * nmemb;
+    static const char encoding[] = "Content-Encoding:";
+    size_t i;
+
+    // Each response of the transfer, redirects included, starts over
+    if (len >= 5 && strncmp(data, "HTTP/", 5) == 0) {
+        transfer->gzip_body = SF_BOOLEAN_FALSE;
+    } else if (len > sizeof(encoding) - 1 &&
+               sf_strncasecmp(data, encoding, sizeof(encoding) - 1) == 0) {
+        for (i = sizeof(encoding) - 1; i + 4 <= len; i++) {
+            if (sf_strncasecmp(data + i, "gzip", 4) == 0) {
+                transfer->gzip_body = SF_BOOLEAN_TRUE;
+                break;
+            }
+        }
+    }
+    return len;
+}
 
-        // Gain back lock to set cJSON blob
+/**
+ * Sets up the easy handle of a transfer slot for its chunk and adds it to the multi handle.
+ */
+static sf_bool STDCALL start_transfer(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                      SF_MULTI_TRANSFER *transfer,
+                                      SF_ERROR_STRUCT *err) {
+    SF_QUEUE_ITEM *item = &chunk_downloader->queue[transfer->index];
+    CURL *curl = transfer->curl;
+    CURLcode res;
+    CURLMcode mres;
+    int64 body_size;
+
+    curl_easy_reset(curl);
+
+    // Reset buffer since this may not be our first attempt, its memory is kept
+    transfer->raw.size = 0;
+    transfer->gzip_body = SF_BOOLEAN_FALSE;
+    // Buffer the whole body in one allocation when its size is known
+    body_size = chunk_downloader->decoder_inflate ? item->compressed_size : item->uncompressed_size;
+    if (body_size > 0 && !raw_json_buffer_reserve(&transfer->raw, (size_t) body_size + 2)) {
+        SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while downloading a chunk",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return SF_BOOLEAN_FALSE;
+    }
+    if (!chunk_downloader->callback_create_resp && !chunk_downloader->decoder_inflate) {
+        // JSON chunks come without the enclosing brackets
+        raw_json_buffer_append(&transfer->raw, "[", 1);
+    }
+
+    // libcurl keeps a copy of the URL
+    _critical_section_lock(&chunk_downloader->url_lock);
+    res = curl_easy_setopt(curl, CURLOPT_URL, item->url);
+    transfer->url_generation = chunk_downloader->url_generation;
+    _critical_section_unlock(&chunk_downloader->url_lock);
+    if (res != CURLE_OK ||
+        (res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk_downloader->chunk_headers->header)) != CURLE_OK ||
+        (res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, (void *) &json_resp_cb)) != CURLE_OK ||
+        (res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) &transfer->raw)) != CURLE_OK ||
+        (res = curl_easy_setopt(curl, CURLOPT_PRIVATE, (void *) transfer)) != CURLE_OK ||
+        (chunk_downloader->decoder_inflate ?
+         ((res = curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, (void *) &chunk_header_cb)) != CURLE_OK ||
+          (res = curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *) transfer)) != CURLE_OK) :
+         (res = curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "")) != CURLE_OK)) {
+        log_error("Unable to set up chunk transfer [%s]", curl_easy_strerror(res));
+        SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_CURL, "Unable to set up chunk transfer", "");
+        return SF_BOOLEAN_FALSE;
+    }
+
+    // Ask for HTTP/2 and rather wait for a connection to multiplex on than open a new one.
+    // Both are ignored if the server or libcurl only speak HTTP/1.1.
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    if (transfer->index < SF_CHUNK_DOWNLOADER_PRIORITY_CHUNKS) {
+        // The first rows come sooner than with an even share of the connection
+        curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT, (long) SF_CHUNK_DOWNLOADER_PRIORITY_STREAM_WEIGHT);
+    }
+
+    if (!set_curl_tls_options(curl, chunk_downloader->insecure_mode)) {
+        SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_CURL, "Unable to set TLS options for chunk transfer", "");
+        return SF_BOOLEAN_FALSE;
+    }
+
+    if ((mres = curl_multi_add_handle(chunk_downloader->multi, curl)) != CURLM_OK) {
+        log_error("Unable to add chunk transfer [%s]", curl_multi_strerror(mres));
+        SET_SNOWFLAKE_ERROR(err, SF_STATUS_ERROR_CURL, "Unable to add chunk transfer", "");
+        return SF_BOOLEAN_FALSE;
+    }
+
+    transfer->state = SF_TRANSFER_RUNNING;
+    transfer->attempt_started_ms = sf_monotonic_time_ms();
+    sf_metric_add(SF_COUNTER_HTTP_REQUESTS, 1);
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Stops a transfer whose chunk is no longer needed and frees its slot.
+ */
+static void STDCALL cancel_transfer(struct SF_CHUNK_DOWNLOADER *chunk_downloader, SF_MULTI_TRANSFER *transfer) {
+    if (transfer->state == SF_TRANSFER_RUNNING) {
+        curl_multi_remove_handle(chunk_downloader->multi, transfer->curl);
+    }
+    transfer->state = SF_TRANSFER_IDLE;
+    raw_json_buffer_free(&transfer->raw);
+    if (transfer->twin) {
+        transfer->twin->twin = NULL;
+        transfer->twin = NULL;
+    }
+}
+
+static SF_MULTI_TRANSFER *STDCALL find_idle_transfer(struct SF_CHUNK_DOWNLOADER *chunk_downloader) {
+    uint64 i;
+    for (i = 0; i < chunk_downloader->transfer_count; i++) {
+        if (chunk_downloader->transfers[i].state == SF_TRANSFER_IDLE) {
+            return &chunk_downloader->transfers[i];
+        }
+    }
+    return NULL;
+}
+
+static int STDCALL compare_uint64(const void *a, const void *b) {
+    uint64 x = *((const uint64 *) a);
+    uint64 y = *((const uint64 *) b);
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * Adds the time of a successful download to the recent download times and updates the
+ * hedging threshold.
+ */
+static void STDCALL record_download_time(struct SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 elapsed_ms) {
+    uint64 sorted[SF_CHUNK_DOWNLOADER_HEDGE_WINDOW];
+    uint64 count;
+
+    chunk_downloader->download_times_ms[chunk_downloader->download_time_count % SF_CHUNK_DOWNLOADER_HEDGE_WINDOW] =
+      elapsed_ms;
+    chunk_downloader->download_time_count++;
+    if (chunk_downloader->download_time_count < SF_CHUNK_DOWNLOADER_HEDGE_MIN_SAMPLES) {
+        return;
+    }
+
+    count = chunk_downloader->download_time_count < SF_CHUNK_DOWNLOADER_HEDGE_WINDOW ?
+            chunk_downloader->download_time_count : SF_CHUNK_DOWNLOADER_HEDGE_WINDOW;
+    memcpy(sorted, chunk_downloader->download_times_ms, count * sizeof(uint64));
+    qsort(sorted, count, sizeof(uint64), compare_uint64);
+    chunk_downloader->hedge_threshold_ms = sorted[(count - 1) * SF_CHUNK_DOWNLOADER_HEDGE_PERCENTILE / 100];
+}
+
+/**
+ * Handles a finished transfer: queues the chunk for decoding, schedules a retry, or fails.
+ */
+static sf_bool STDCALL finish_transfer(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                       SF_MULTI_TRANSFER *transfer,
+                                       CURLcode result,
+                                       SF_ERROR_STRUCT *err) {
+    long int http_code = 0;
+    sf_bool retry = SF_BOOLEAN_FALSE;
+    sf_bool expired = SF_BOOLEAN_FALSE;
+    uint32 next_sleep_in_ms;
+    char msg[1024];
+
+    SF_QUEUE_ITEM *item = &chunk_downloader->queue[transfer->index];
+
+    curl_multi_remove_handle(chunk_downloader->multi, transfer->curl);
+    transfer->state = SF_TRANSFER_IDLE;
+
+    if (result != CURLE_OK) {
+        retry = is_retryable_curl_code(result);
+        sb_sprintf(msg, sizeof(msg), "Chunk download failed: %s", curl_easy_strerror(result));
+    } else if (curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &http_code) != CURLE_OK) {
+        sb_sprintf(msg, sizeof(msg), "Unable to get http response code");
+    } else if (http_code != 200) {
+        expired = is_expired_url_http_code(http_code);
+        retry = !expired && is_retryable_http_code(http_code);
+        sb_sprintf(msg, sizeof(msg), "Received http code: [%ld]", http_code);
+    } else {
+        if (transfer->twin) {
+            log_debug("%s request for chunk %llu won", transfer->is_hedge ? "Hedged" : "Original",
+                      transfer->index);
+            cancel_transfer(chunk_downloader, transfer->twin);
+        }
+        if (chunk_downloader->hedge_requests) {
+            record_download_time(chunk_downloader, sf_monotonic_time_ms() - transfer->attempt_started_ms);
+        }
+        retry_policy_refund(&chunk_downloader->retry_policy);
+        item->stats.download_end_ms = chunk_downloader_elapsed_ms(chunk_downloader);
+        item->stats.retries = transfer->retry_ctx.retry_count;
+        // JSON bodies start with the bracket added before the download, unless the decoder
+        // adds it, which then counts the inflated bytes in place of the bytes received.
+        item->stats.bytes = chunk_downloader->callback_create_resp ||
+                            chunk_downloader->decoder_inflate || transfer->raw.size == 0 ?
+                            transfer->raw.size : transfer->raw.size - 1;
+        chunk_downloaded(chunk_downloader, transfer->index);
+        raw_json_buffer_free(&item->raw);
+        item->raw = transfer->raw;
+        item->gzip_body = transfer->gzip_body;
+        transfer->raw.buffer = NULL;
+        transfer->raw.size = 0;
+        transfer->raw.capacity = 0;
+
+        // Hand the chunk over to the decoders, or keep it as is until the consumer gets close
         _critical_section_lock(&chunk_downloader->queue_lock);
+        if (chunk_downloader->compressed_prefetch &&
+            transfer->index >= sf_atomic_load(&chunk_downloader->consumer_head) +
+                               chunk_downloader->decode_ahead) {
+            item->held = SF_BOOLEAN_TRUE;
+            chunk_downloader->held_count++;
+        } else {
+            chunk_downloader->decode_queue[chunk_downloader->decode_tail++] = transfer->index;
+            _cond_signal(&chunk_downloader->decode_cond);
+        }
+        _critical_section_unlock(&chunk_downloader->queue_lock);
+        return SF_BOOLEAN_TRUE;
+    }
+    msg[sizeof(msg) - 1] = (char) 0;
+
+    // The other request for this chunk is still going, so leave it to that one
+    if (transfer->twin && transfer->twin->state != SF_TRANSFER_IDLE) {
+        log_debug("%s, the other request for chunk %llu continues", msg, transfer->index);
+        cancel_transfer(chunk_downloader, transfer);
+        return SF_BOOLEAN_TRUE;
+    }
+
+    // The URL has most likely expired while the chunk waited for the consumer, so download it
+    // again right away with a fresh one. This blocks the other transfers for one request.
+    if (expired && chunk_downloader->callback_refresh_urls &&
+        transfer->url_refreshes < SF_CHUNK_DOWNLOADER_MAX_URL_REFRESHES) {
+        log_debug("%s, the URL of chunk %llu was refused", msg, transfer->index);
+        transfer->url_refreshes++;
+        if (!refresh_chunk_urls(chunk_downloader, transfer->url_generation, err)) {
+            return SF_BOOLEAN_FALSE;
+        }
+        transfer->retry_at_ms = sf_monotonic_time_ms();
+        transfer->state = SF_TRANSFER_BACKOFF;
+        return SF_BOOLEAN_TRUE;
+    }
+
+    if (retry && (uint64) (time(NULL) - transfer->started_at) < transfer->retry_ctx.retry_timeout &&
+        retry_policy_take(&chunk_downloader->retry_policy)) {
+        next_sleep_in_ms = retry_ctx_next_sleep(&transfer->retry_ctx);
+        log_debug("%s, retry count %d, will retry after %d ms", msg,
+                  (int) transfer->retry_ctx.retry_count, (int) next_sleep_in_ms);
+        transfer->retry_at_ms = sf_monotonic_time_ms() + next_sleep_in_ms;
+        transfer->state = SF_TRANSFER_BACKOFF;
+        sf_metric_add(SF_COUNTER_HTTP_RETRIES, 1);
+        return SF_BOOLEAN_TRUE;
+    }
+
+    log_error(msg);
+    SET_SNOWFLAKE_ERROR(err, result != CURLE_OK ? SF_STATUS_ERROR_CURL :
+                             (expired ? SF_STATUS_ERROR_CHUNK_URL_EXPIRED : SF_STATUS_ERROR_RETRY),
+                        msg, SF_SQLSTATE_UNABLE_TO_CONNECT);
+    return SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Takes a chunk download slot for a transfer about to start. The I/O thread only waits for one
+ * when it has no transfer of its own left, which then give their slots back first.
+ */
+static sf_bool STDCALL take_transfer_slot(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                          SF_MULTI_TRANSFER *transfer, uint64 busy) {
+    if (busy == 0) {
+        sf_scheduler_acquire(chunk_downloader->scheduler_pool, SF_SCHEDULER_CHUNK_DOWNLOADS,
+                             chunk_downloader->priority);
+    } else if (!sf_scheduler_try_acquire(chunk_downloader->scheduler_pool,
+                                         SF_SCHEDULER_CHUNK_DOWNLOADS)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    transfer->holds_slot = SF_BOOLEAN_TRUE;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Gives back the chunk download slots of the idle transfers, or of all of them once the I/O
+ * thread is done.
+ */
+static void STDCALL release_transfer_slots(struct SF_CHUNK_DOWNLOADER *chunk_downloader, sf_bool all) {
+    uint64 i;
+    for (i = 0; i < chunk_downloader->transfer_count; i++) {
+        SF_MULTI_TRANSFER *transfer = &chunk_downloader->transfers[i];
+        if (transfer->holds_slot && (all || transfer->state == SF_TRANSFER_IDLE)) {
+            sf_scheduler_release(chunk_downloader->scheduler_pool, SF_SCHEDULER_CHUNK_DOWNLOADS);
+            transfer->holds_slot = SF_BOOLEAN_FALSE;
+        }
+    }
+}
+
+/**
+ * I/O thread of the multiplexed downloader. Keeps up to transfer_count chunk GETs in flight on
+ * the multi handle, within the same fetch_slots/memory_limit window as the blocking downloader
+ * threads, and queues every finished chunk for the decoder threads.
+ */
+static void * chunk_io_thread(void *downloader) {
+    struct SF_CHUNK_DOWNLOADER *chunk_downloader = (SF_CHUNK_DOWNLOADER *) downloader;
+    SF_MULTI_TRANSFER *transfer;
+    CURLMsg *msg;
+    CURLMcode mres;
+    CURL *easy;
+    CURLcode result;
+    int running = 0;
+    int msgs_left;
+    uint64 next = 0;
+    uint64 busy;
+    uint64 primaries;
+    uint64 hedges;
+    uint64 now_ms;
+    uint64 i;
+    time_t now;
+    SF_ERROR_STRUCT err;
+    memset(&err, 0, sizeof(err));
+    clear_snowflake_error(&err);
+    sf_affinity_apply(chunk_downloader->affinity_group);
+
+    while (!get_shutdown_or_error(chunk_downloader)) {
+        release_transfer_slots(chunk_downloader, SF_BOOLEAN_FALSE);
+
+        // Start due retries and count the slots in use
+        now = time(NULL);
+        now_ms = sf_monotonic_time_ms();
+        busy = 0;
+        primaries = 0;
+        hedges = 0;
+        for (i = 0; i < chunk_downloader->transfer_count; i++) {
+            transfer = &chunk_downloader->transfers[i];
+            if (transfer->state == SF_TRANSFER_BACKOFF && now_ms >= transfer->retry_at_ms) {
+                if (!start_transfer(chunk_downloader, transfer, &err)) {
+                    goto fail;
+                }
+            }
+            if (transfer->state != SF_TRANSFER_IDLE) {
+                busy++;
+                if (transfer->is_hedge) {
+                    hedges++;
+                } else {
+                    primaries++;
+                }
+            }
+        }
+
+        // Hand out the skipped chunks right away
+        while (next < chunk_downloader->queue_size && is_skipped(chunk_downloader, next)) {
+            chunk_downloader->queue[next].skipped = SF_BOOLEAN_TRUE;
+            if (!publish_chunk(chunk_downloader, next++, &skipped_chunk)) {
+                goto fail;
+            }
+        }
 
-        if (get_error(chunk_downloader)) {
+        // Start new transfers. This is the only producer, so the budget can be reserved without
+        // taking queue_lock.
+        for (i = 0; i < chunk_downloader->transfer_count &&
+                    primaries < chunk_downloader->primary_transfer_limit; i++) {
+            transfer = &chunk_downloader->transfers[i];
+            if (transfer->state != SF_TRANSFER_IDLE) {
+                continue;
+            }
+            if (next >= chunk_downloader->queue_size || must_wait_for_consumer(chunk_downloader, next) ||
+                !take_transfer_slot(chunk_downloader, transfer, busy)) {
+                break;
+            }
+            if (counts_buffered(chunk_downloader)) {
+                buffer_chunk(chunk_downloader, next);
+            }
+            chunk_downloader->queue[next].stats.queued_ms = chunk_downloader_elapsed_ms(chunk_downloader);
+            chunk_downloader->queue[next].stats.download_start_ms = chunk_downloader->queue[next].stats.queued_ms;
+            transfer->index = next++;
+            transfer->started_at = now;
+            transfer->retry_ctx.retry_count = 0;
+            transfer->retry_ctx.sleep_time = transfer->djb.base;
+            transfer->url_refreshes = 0;
+            transfer->is_hedge = SF_BOOLEAN_FALSE;
+            if (!start_transfer(chunk_downloader, transfer, &err)) {
+                goto fail;
+            }
+            busy++;
+            primaries++;
+        }
+
+        // Hedge the downloads that take longer than most recent ones, using the idle slots
+        if (chunk_downloader->hedge_threshold_ms > 0) {
+            now_ms = sf_monotonic_time_ms();
+            for (i = 0; i < chunk_downloader->transfer_count && hedges < SF_CHUNK_DOWNLOADER_MAX_HEDGES; i++) {
+                SF_MULTI_TRANSFER *straggler = &chunk_downloader->transfers[i];
+                if (straggler->state != SF_TRANSFER_RUNNING || straggler->is_hedge || straggler->twin ||
+                    now_ms - straggler->attempt_started_ms <= chunk_downloader->hedge_threshold_ms) {
+                    continue;
+                }
+                // A hedge is only sent with a slot to spare
+                if ((transfer = find_idle_transfer(chunk_downloader)) == NULL ||
+                    !sf_scheduler_try_acquire(chunk_downloader->scheduler_pool,
+                                              SF_SCHEDULER_CHUNK_DOWNLOADS)) {
+                    break;
+                }
+                transfer->holds_slot = SF_BOOLEAN_TRUE;
+                log_debug("Chunk %llu is taking more than %llu ms, sending a hedged request",
+                          straggler->index, chunk_downloader->hedge_threshold_ms);
+                transfer->index = straggler->index;
+                transfer->started_at = now;
+                transfer->retry_ctx.retry_count = 0;
+                transfer->retry_ctx.sleep_time = transfer->djb.base;
+                transfer->url_refreshes = 0;
+                transfer->is_hedge = SF_BOOLEAN_TRUE;
+                if (!start_transfer(chunk_downloader, transfer, &err)) {
+                    goto fail;
+                }
+                transfer->twin = straggler;
+                straggler->twin = transfer;
+                busy++;
+                hedges++;
+            }
+        }
+
+        if (next >= chunk_downloader->queue_size && busy == 0) {
+            // All chunks downloaded
             break;
         }
 
-        // Set the chunk
-        if (chunk_downloader->callback_create_resp)
-        {
-            chunk_downloader->queue[index].chunk = (void *)non_json_resp;
+        if ((mres = curl_multi_perform(chunk_downloader->multi, &running)) != CURLM_OK) {
+            log_error("curl_multi_perform() failed: %s", curl_multi_strerror(mres));
+            SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_CURL, "curl_multi_perform() failed", "");
+            goto fail;
         }
-        else
-        {
-            chunk_downloader->queue[index].chunk = (void *)chunk;
+
+        while ((msg = curl_multi_info_read(chunk_downloader->multi, &msgs_left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            // msg is invalidated once the handle is removed from the multi handle
+            easy = msg->easy_handle;
+            result = msg->data.result;
+            transfer = NULL;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **) &transfer);
+            if (transfer && transfer->state == SF_TRANSFER_RUNNING &&
+                !finish_transfer(chunk_downloader, transfer, result, &err)) {
+                goto fail;
+            }
         }
 
-        // Notify the consumer that we have a chunk ready
-        if (_cond_signal(&chunk_downloader->consumer_cond)) {
-            _rwlock_wrlock(&chunk_downloader->attr_lock);
-            if (!chunk_downloader->has_error) {
-                SET_SNOWFLAKE_ERROR(chunk_downloader->sf_error, SF_STATUS_ERROR_PTHREAD,
-                                    "Error sending consumer signal to notify of chunk downloaded", "");
-                chunk_downloader->has_error = SF_BOOLEAN_TRUE;
+        // Sleep until there is socket activity, the consumer frees a slot, or a retry is due
+        curl_multi_poll(chunk_downloader->multi, NULL, 0, SF_CHUNK_DOWNLOADER_MULTI_POLL_TIMEOUT, NULL);
+    }
+    goto done;
+
+fail:
+    fail_downloader(chunk_downloader, &err);
+
+done:
+    // The transfers still running are stopped by multi_term()
+    release_transfer_slots(chunk_downloader, SF_BOOLEAN_TRUE);
+
+    // Let the decoders drain the queue and exit
+    _critical_section_lock(&chunk_downloader->queue_lock);
+    chunk_downloader->io_done = SF_BOOLEAN_TRUE;
+    _cond_broadcast(&chunk_downloader->decode_cond);
+    _critical_section_unlock(&chunk_downloader->queue_lock);
+
+    _thread_exit();
+    return NULL;
+}
+
+/**
+ * Turns the body of a chunk downloaded with decoder_inflate into what libcurl would have
+ * written: the body inflated if it is gzip compressed, after the opening bracket of a JSON
+ * chunk. The inflated body is allocated once from the uncompressed size of the chunk and
+ * inflated in one go, instead of in the pieces libcurl decodes and hands over.
+ */
+static sf_bool STDCALL inflate_chunk_body(struct SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                          SF_QUEUE_ITEM *item) {
+    RAW_JSON_BUFFER out;
+    z_stream stream;
+    size_t prefix = chunk_downloader->callback_create_resp ? 0 : 1;
+    size_t expected;
+    size_t room;
+    int ret = Z_OK;
+
+    if (!item->gzip_body) {
+        if (prefix) {
+            if (!raw_json_buffer_reserve(&item->raw, prefix)) {
+                return SF_BOOLEAN_FALSE;
             }
-            _rwlock_wrunlock(&chunk_downloader->attr_lock);
+            memmove(item->raw.buffer + prefix, item->raw.buffer, item->raw.size);
+            item->raw.buffer[0] = '[';
+            item->raw.size += prefix;
+            item->raw.buffer[item->raw.size] = '\0';
+        }
+        item->stats.bytes = item->raw.size - prefix;
+        return SF_BOOLEAN_TRUE;
+    }
+
+    memset(&out, 0, sizeof(out));
+    out.tag = item->raw.tag;
+    // The closing bracket of JSON chunks is appended afterwards
+    expected = item->uncompressed_size > 0 ? (size_t) item->uncompressed_size : item->raw.size * 4;
+    if (!raw_json_buffer_reserve(&out, expected + prefix + 1)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (prefix) {
+        out.buffer[out.size++] = '[';
+    }
+
+    memset(&stream, 0, sizeof(stream));
+    // 32 lets zlib detect the gzip header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        raw_json_buffer_free(&out);
+        return SF_BOOLEAN_FALSE;
+    }
+    stream.next_in = (Bytef *) item->raw.buffer;
+    while (SF_BOOLEAN_TRUE) {
+        if (stream.avail_in == 0) {
+            room = item->raw.size - (size_t) ((char *) stream.next_in - item->raw.buffer);
+            stream.avail_in = (uInt) (room > UINT_MAX ? UINT_MAX : room);
+        }
+        if (out.size + 1 >= out.capacity && !raw_json_buffer_reserve(&out, out.capacity)) {
+            ret = Z_MEM_ERROR;
             break;
         }
+        room = out.capacity - out.size - 1;
+        stream.next_out = (Bytef *) out.buffer + out.size;
+        stream.avail_out = (uInt) (room > UINT_MAX ? UINT_MAX : room);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        out.size = (size_t) ((char *) stream.next_out - out.buffer);
+        if (ret == Z_STREAM_END && (char *) stream.next_in < item->raw.buffer + item->raw.size) {
+            // Another gzip member follows
+            ret = inflateReset(&stream);
+            continue;
+        }
+        if (ret != Z_OK) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    if (ret != Z_STREAM_END) {
+        log_error("Unable to inflate the chunk body [%d]", ret);
+        raw_json_buffer_free(&out);
+        return SF_BOOLEAN_FALSE;
+    }
+
+    out.buffer[out.size] = '\0';
+    raw_json_buffer_free(&item->raw);
+    item->raw = out;
+    item->gzip_body = SF_BOOLEAN_FALSE;
+    item->stats.bytes = item->raw.size - prefix;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Decoder thread of the multiplexed downloader. Turns the raw response bodies queued by the
+ * I/O thread into chunks and publishes them.
+ */
+static void * chunk_decoder_thread(void *downloader) {
+    struct SF_CHUNK_DOWNLOADER *chunk_downloader = (SF_CHUNK_DOWNLOADER *) downloader;
+    SF_QUEUE_ITEM *item;
+    NON_JSON_RESP *non_json_resp;
+    void *chunk;
+    uint64 decode_start;
+    uint64 index;
+    sf_bool inflate_ok;
+    SF_ERROR_STRUCT err;
+    memset(&err, 0, sizeof(err));
+    clear_snowflake_error(&err);
+    sf_affinity_apply(chunk_downloader->affinity_group);
 
-        // Drop the lock
+    while (1) {
+        _critical_section_lock(&chunk_downloader->queue_lock);
+        // Held chunks are queued by the consumer later on, even once the I/O thread is done
+        while (chunk_downloader->decode_head == chunk_downloader->decode_tail &&
+               (!chunk_downloader->io_done || chunk_downloader->held_count > 0) &&
+               !get_shutdown_or_error(chunk_downloader)) {
+            _cond_wait(&chunk_downloader->decode_cond, &chunk_downloader->queue_lock);
+        }
+        if (chunk_downloader->decode_head == chunk_downloader->decode_tail ||
+            get_shutdown_or_error(chunk_downloader)) {
+            _critical_section_unlock(&chunk_downloader->queue_lock);
+            break;
+        }
+        index = chunk_downloader->decode_queue[chunk_downloader->decode_head++];
         _critical_section_unlock(&chunk_downloader->queue_lock);
+
+        item = &chunk_downloader->queue[index];
+        decode_start = sf_monotonic_time_ms();
+        if (chunk_downloader->decoder_inflate) {
+            inflate_ok = inflate_chunk_body(chunk_downloader, item);
+            trace_chunk(chunk_downloader, "chunk.inflate", index,
+                        sf_monotonic_time_ms() - decode_start,
+                        inflate_ok ? SF_STATUS_SUCCESS : SF_STATUS_ERROR_BAD_RESPONSE);
+            if (!inflate_ok) {
+                raw_json_buffer_free(&item->raw);
+                SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_RESPONSE,
+                                    "Unable to decompress the chunk response.",
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
+                fail_downloader(chunk_downloader, &err);
+                break;
+            }
+        }
+        if (chunk_downloader->callback_create_resp) {
+            if ((non_json_resp = chunk_downloader->callback_create_resp()) == NULL) {
+                raw_json_buffer_free(&item->raw);
+                SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                    "Unable to allocate the chunk response.",
+                                    SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+                fail_downloader(chunk_downloader, &err);
+                break;
+            }
+            non_json_resp->write_callback(item->raw.buffer, 1, item->raw.size, non_json_resp->buffer);
+            // The body is complete already, so a streamed chunk ends right away
+            if (non_json_resp->finish_callback) {
+                non_json_resp->finish_callback(non_json_resp->buffer, SF_BOOLEAN_TRUE);
+            } else if (non_json_resp->decode_callback &&
+                       !non_json_resp->decode_callback(non_json_resp->buffer)) {
+                raw_json_buffer_free(&item->raw);
+                if (non_json_resp->free_callback) {
+                    non_json_resp->free_callback(non_json_resp);
+                }
+                SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_RESPONSE,
+                                    "Unable to decode the chunk response.",
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
+                fail_downloader(chunk_downloader, &err);
+                break;
+            }
+            chunk = (void *) non_json_resp;
+        } else {
+            chunk = (void *) parse_json_chunk(chunk_downloader, &item->raw);
+            trace_chunk(chunk_downloader, "chunk.parse", index,
+                        sf_monotonic_time_ms() - decode_start,
+                        chunk ? SF_STATUS_SUCCESS : SF_STATUS_ERROR_BAD_JSON);
+        }
+        raw_json_buffer_free(&item->raw);
+        item->stats.decode_ms += sf_monotonic_time_ms() - decode_start;
+
+        if (!chunk) {
+            SET_SNOWFLAKE_ERROR(&err, SF_STATUS_ERROR_BAD_JSON,
+                                "Unable to parse JSON text response.",
+                                SF_SQLSTATE_UNABLE_TO_CONNECT);
+            fail_downloader(chunk_downloader, &err);
+            break;
+        }
+
+        if (!publish_chunk(chunk_downloader, index, chunk)) {
+            break;
+        }
     }
 
-    _critical_section_unlock(&chunk_downloader->queue_lock);
     _thread_exit();
     return NULL;
 }
@@ -19,32 +19,246 @@ extern "C" {
 #include "snowflake/platform.h"
 #include "cJSON.h"
 #include "connection.h"
+#include "json_rowset.h"
+#include "query_scheduler.h"
+
+// Upper bound on the number of downloader threads picked in auto mode
+#define SF_CHUNK_DOWNLOADER_AUTO_MAX_THREADS 16
+// Amount of uncompressed result data each downloader thread is expected to handle in auto mode
+#define SF_CHUNK_DOWNLOADER_AUTO_BYTES_PER_THREAD (64 * 1024 * 1024)
+// Upper bound on the uncompressed size of prefetched chunks in auto mode
+#define SF_CHUNK_DOWNLOADER_AUTO_PREFETCH_BYTES (1024 * 1024 * 1024)
+// Upper bound on the number of concurrent transfers of the multiplexed downloader
+#define SF_CHUNK_DOWNLOADER_MULTI_MAX_TRANSFERS 64
+// Maximum number of connections per host the multiplexed downloader opens
+#define SF_CHUNK_DOWNLOADER_MULTI_MAX_CONNECTIONS 4
+// Maximum time the multiplexed downloader waits for socket activity, in milliseconds
+#define SF_CHUNK_DOWNLOADER_MULTI_POLL_TIMEOUT 100
+// Maximum number of hedged duplicate requests in flight at the same time
+#define SF_CHUNK_DOWNLOADER_MAX_HEDGES 4
+// Number of recent chunk download times the hedging threshold is computed from
+#define SF_CHUNK_DOWNLOADER_HEDGE_WINDOW 128
+// Number of chunks that must have been downloaded before any request is hedged
+#define SF_CHUNK_DOWNLOADER_HEDGE_MIN_SAMPLES 16
+// Percentile of recent download times above which a chunk download is hedged
+#define SF_CHUNK_DOWNLOADER_HEDGE_PERCENTILE 95
+// Number of chunks at the start of the results downloaded before the others, so that the
+// first rows don't share the bandwidth with the bulk of the downloads
+#define SF_CHUNK_DOWNLOADER_PRIORITY_CHUNKS 1
+// Maximum time the other chunks wait for the priority chunks to be downloaded, in milliseconds
+#define SF_CHUNK_DOWNLOADER_PRIORITY_WAIT_MS 2000
+// HTTP/2 stream weight of the priority chunks in multiplexed mode, the others have the default 16
+#define SF_CHUNK_DOWNLOADER_PRIORITY_STREAM_WEIGHT 256
+// Number of times a chunk is downloaded again with fresh URLs after its URL was refused
+#define SF_CHUNK_DOWNLOADER_MAX_URL_REFRESHES 2
+
+/**
+ * Requests the chunks array of the results again, for the fresh URLs in it.
+ *
+ * @return the chunks array, to be deleted by the caller, or NULL with the error set.
+ */
+typedef cJSON *(*SF_CHUNK_URL_REFRESH)(void *context, SF_ERROR_STRUCT *error);
+
+/**
+ * Decodes the rows of a JSON chunk once more right after they are parsed, into the columnar
+ * copy of the rowset. Leaving no copy, e.g. for a value that can't be decoded, doesn't fail
+ * the chunk.
+ */
+typedef void (*SF_JSON_CHUNK_DECODE)(SF_JSON_ROWSET *rowset, void *context);
+
+typedef enum SF_TRANSFER_STATE {
+    SF_TRANSFER_IDLE,
+    SF_TRANSFER_RUNNING,
+    SF_TRANSFER_BACKOFF
+} SF_TRANSFER_STATE;
+
+/**
+ * A transfer slot of the multiplexed downloader. The easy handle is kept for the life of the
+ * downloader so that its connection and TLS session are reused by the next chunk.
+ */
+typedef struct SF_MULTI_TRANSFER {
+    CURL *curl;
+    SF_TRANSFER_STATE state;
+    // Queue index of the chunk being downloaded
+    uint64 index;
+    // Time before which a failed transfer must not be retried, see sf_monotonic_time_ms()
+    uint64 retry_at_ms;
+    // Time the first attempt was started
+    time_t started_at;
+    // Start of the current attempt, see sf_monotonic_time_ms()
+    uint64 attempt_started_ms;
+    DECORRELATE_JITTER_BACKOFF djb;
+    RETRY_CONTEXT retry_ctx;
+    // Response body of the current attempt
+    RAW_JSON_BUFFER raw;
+    // The other transfer of the same chunk while a hedged request is in flight.
+    // Whichever finishes first wins and cancels the other.
+    struct SF_MULTI_TRANSFER *twin;
+    sf_bool is_hedge;
+    // URL refreshes for the chunk so far, and the URL generation the current attempt started with
+    uint64 url_refreshes;
+    uint64 url_generation;
+    // Set by the header callback when the body of the current attempt is gzip compressed
+    sf_bool gzip_body;
+    // Set while the transfer holds a chunk download slot of the scheduler, from its first
+    // attempt until it is idle again
+    sf_bool holds_slot;
+} SF_MULTI_TRANSFER;
 
 typedef struct SF_QUEUE_ITEM {
     char *url;
     int64 row_count;
-    void *chunk; //make it void * to allow arrow format
+    // Chunk sizes as reported by the server, 0 if unknown
+    int64 uncompressed_size;
+    int64 compressed_size;
+    // make it void * to allow arrow format.
+    // A non-NULL chunk marks the slot as ready; it is published atomically by the downloader thread.
+    void *volatile chunk;
+    // Set by the consumer once the chunk has been taken
+    sf_bool consumed;
+    // Undecoded response body of the winning transfer, only used by the multiplexed downloader
+    RAW_JSON_BUFFER raw;
+    // Set when raw is still gzip compressed, see decoder_inflate
+    sf_bool gzip_body;
+    // Set while the downloaded body waits for the consumer to get close before it is decoded,
+    // see compressed_prefetch. Protected by queue_lock.
+    sf_bool held;
+    // Written by the thread that currently owns the chunk, see snowflake_stmt_get_fetch_stats()
+    SF_CHUNK_FETCH_STATS stats;
+    // Set when the undecoded chunk was written to the spill directory instead of being kept in
+    // memory; the consumer reads and decodes it when it takes the chunk
+    sf_bool spilled;
+    // Set when the chunk was skipped without being downloaded, see chunk_downloader_skip()
+    sf_bool skipped;
+    // Set while the chunk is counted in buffered_bytes, see buffer_chunk()
+    sf_bool buffered;
+    // Set for a chunk published before its download finished, see the finish_callback of
+    // NON_JSON_RESP. stream_open is cleared once the download finished and stream_taken is
+    // set once the consumer took the chunk, both under queue_lock: the chunk keeps its fetch
+    // slot and its buffered bytes until both happened.
+    sf_bool streamed;
+    sf_bool stream_open;
+    sf_bool stream_taken;
 } SF_QUEUE_ITEM;
 
 struct SF_CHUNK_DOWNLOADER {
     uint64 thread_count;
 
-    // Threads
+    // Threads taken from the process-wide I/O thread budget, given back on term
+    uint64 io_threads_taken;
+
+    // Scheduler pool each chunk GET takes a slot of, and the priority it waits for one with
+    SF_SCHEDULER_POOL *scheduler_pool;
+    SF_QUERY_PRIORITY priority;
+
+    // Group of the downloader and decoder threads, placed together, see sf_affinity_group()
+    int affinity_group;
+
+    // Maximum number of chunks downloaded ahead of the consumer
+    uint64 fetch_slots;
+
+    // Maximum number of bytes of downloaded and in-flight chunks the consumer has not taken yet.
+    // 0 disables the memory budget; otherwise it replaces the fetch_slots limit.
+    uint64 memory_limit;
+    volatile uint64 buffered_bytes;
+    // Streamed chunks the consumer took while they were still downloading. They hold their
+    // fetch slot until they are downloaded. Changed under queue_lock, but atomic since the
+    // producers check it before taking the lock.
+    volatile uint64 streams_taken;
+    // Budget of the statement the buffered bytes are charged to, NULL for none. Once it, or
+    // a parent of it, is used up the producers wait for the consumer as for memory_limit.
+    SF_MEMORY_BUDGET *memory_budget;
+
+    // Threads. In multiplexed mode they only decode chunks downloaded by io_thread.
     SF_THREAD_HANDLE *threads;
 
-    // Queue
+    // Queue. The lock and conditions are only used to park threads when a slot is not
+    // ready (consumer) or the prefetch window is full (producers).
     SF_CRITICAL_SECTION_HANDLE queue_lock;
     SF_CONDITION_HANDLE producer_cond;
     SF_CONDITION_HANDLE consumer_cond;
 
-    // A "queue" that is actually just a locked array
+    // Serializes consumers when several application threads pull chunks, see snowflake_fetch_chunk()
+    SF_CRITICAL_SECTION_HANDLE consumer_lock;
+
+    // Ring of chunk slots. Downloader threads claim slots with an atomic increment of
+    // producer_head and publish chunks into them; the consumer advances consumer_head.
     SF_QUEUE_ITEM* queue;
 
-    // Queue attributes
-    uint64 producer_head;
-    uint64 consumer_head;
+    // Queue attributes. The heads are only accessed through the sf_atomic_* functions.
+    // consumer_head is the number of chunks consumed so far. In ordered mode that is also
+    // the index of the next chunk to consume.
+    volatile uint64 producer_head;
+    volatile uint64 consumer_head;
     uint64 queue_size;
 
+    // Lowest slot index that has not been consumed yet. Only touched by the consumer.
+    uint64 scan_head;
+
+    // Chunks below this slot index are not downloaded, see chunk_downloader_skip()
+    volatile uint64 skip_until;
+
+    // Number of priority chunks at the start of the queue, see SF_CHUNK_DOWNLOADER_PRIORITY_CHUNKS,
+    // and the number of them not downloaded yet. The other producers wait while any is left.
+    uint64 priority_chunks;
+    volatile uint64 priority_left;
+
+    // Number of threads parked on consumer_cond/producer_cond, so that wakeups
+    // are only sent when someone is waiting.
+    volatile uint64 consumer_waiting;
+    volatile uint64 producers_waiting;
+
+    // Multiplexed downloader. A single I/O thread drives all transfers through the curl multi
+    // handle and hands finished chunks to the threads above, which then only decode them.
+    sf_bool use_multi;
+    CURLM *multi;
+    SF_THREAD_HANDLE io_thread;
+    sf_bool io_thread_started;
+    SF_MULTI_TRANSFER *transfers;
+    uint64 transfer_count;
+    // Maximum number of transfers of distinct chunks; the remaining slots are kept for hedging
+    uint64 primary_transfer_limit;
+
+    // Hedged requests. A chunk download that runs longer than hedge_threshold_ms, the
+    // SF_CHUNK_DOWNLOADER_HEDGE_PERCENTILE of the recent download times, gets a duplicate request.
+    // Only touched by the I/O thread.
+    sf_bool hedge_requests;
+    uint64 download_times_ms[SF_CHUNK_DOWNLOADER_HEDGE_WINDOW];
+    uint64 download_time_count;
+    uint64 hedge_threshold_ms;
+
+    // Set when the I/O thread keeps gzip bodies compressed and the decoder threads inflate them,
+    // which spreads the decompression over the decoder threads. Only used in multiplexed mode.
+    sf_bool decoder_inflate;
+
+    // Set when the chunks downloaded ahead are kept undecoded, so that they only take their
+    // compressed size, until the consumer is within decode_ahead chunks of them. The budget of
+    // memory_limit then counts compressed sizes. Implies decoder_inflate.
+    sf_bool compressed_prefetch;
+    uint64 decode_ahead;
+
+    // FIFO of downloaded chunk indices waiting to be decoded, protected by queue_lock.
+    // io_done is set once the I/O thread has queued its last chunk.
+    SF_CONDITION_HANDLE decode_cond;
+    uint64 *decode_queue;
+    uint64 decode_head;
+    uint64 decode_tail;
+    sf_bool io_done;
+    // Number of downloaded chunks held back from the decoders, see compressed_prefetch
+    uint64 held_count;
+
+    // Time the chunk downloader was created, see sf_monotonic_time_ms()
+    uint64 start_ms;
+
+    // Directory that JSON chunks are spilled to once memory_limit is used up, NULL to make the
+    // producers wait for the consumer instead. Only used by the blocking downloader.
+    char *spill_dir;
+
+    // Parent of the download and parse spans of the chunks, empty if the query isn't traced
+    SF_TRACE_CONTEXT trace;
+    // Name prefix of the spilled chunks of this downloader
+    char spill_prefix[SF_UUID4_LEN];
+
     // Chunk downloader connection attributes
     char *qrmk;
     SF_HEADER *chunk_headers;
@@ -52,6 +266,9 @@ struct SF_CHUNK_DOWNLOADER {
     // Error/shutdown flags
     sf_bool is_shutdown;
     sf_bool has_error;
+    // Set along with is_shutdown, without the lock, so that the progress callback of the
+    // downloads in flight aborts them
+    volatile uint64 cancelled;
 
     // Chunk downloader attribute read-write lock. If you need to acquire both the queue_lock and attr_lock,
     // ALWAYS acquire the queue_lock first, otherwise we can deadlock
@@ -63,8 +280,23 @@ struct SF_CHUNK_DOWNLOADER {
     // Snowflake connection insecure mode flag
     sf_bool insecure_mode;
 
+    // Backoff and budget for the retries of chunk downloads
+    SF_RETRY_POLICY retry_policy;
+
     // callback function to create non-json response buffer. Json format will be used if this is set to NULL.
     NON_JSON_RESP* (*callback_create_resp)(void);
+
+    // Decodes the JSON chunks further on the downloader and decoder threads, NULL not to
+    SF_JSON_CHUNK_DECODE callback_decode_json;
+    void *decode_context;
+
+    // Fetches fresh chunk URLs once a URL is refused, NULL to fail the download instead.
+    // url_lock guards the URLs in the queue and serializes the refreshes, which url_generation
+    // counts so that threads whose URLs were refused at the same time refresh them only once.
+    SF_CHUNK_URL_REFRESH callback_refresh_urls;
+    void *refresh_context;
+    SF_CRITICAL_SECTION_HANDLE url_lock;
+    volatile uint64 url_generation;
 };
 
 SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
@@ -72,10 +304,64 @@ SF_CHUNK_DOWNLOADER *STDCALL chunk_downloader_init(const char *qrmk,
                                                    cJSON *chunks,
                                                    uint64 thread_count,
                                                    uint64 fetch_slots,
+                                                   uint64 memory_limit,
+                                                   SF_MEMORY_BUDGET *memory_budget,
+                                                   sf_bool use_multi,
+                                                   sf_bool hedge_requests,
+                                                   sf_bool decoder_inflate,
+                                                   sf_bool compressed_prefetch,
+                                                   const char *spill_dir,
+                                                   SF_SCHEDULER_POOL *scheduler_pool,
+                                                   SF_QUERY_PRIORITY priority,
+                                                   const SF_TRACE_CONTEXT *trace,
                                                    SF_ERROR_STRUCT *sf_error,
                                                    sf_bool insecure_mode,
-                                                   NON_JSON_RESP* (*callback_create_resp)(void));
+                                                   const SF_RETRY_POLICY *retry_policy,
+                                                   NON_JSON_RESP* (*callback_create_resp)(void),
+                                                   SF_JSON_CHUNK_DECODE callback_decode_json,
+                                                   void *decode_context,
+                                                   SF_CHUNK_URL_REFRESH callback_refresh_urls,
+                                                   void *refresh_context);
 sf_bool STDCALL chunk_downloader_term(SF_CHUNK_DOWNLOADER *chunk_downloader);
+
+/**
+ * Stops the chunk downloader without waiting for it: the downloads in flight are aborted,
+ * no other chunk is downloaded and chunk_downloader_next_chunk() reaches the end of results.
+ * Can be called from any thread until chunk_downloader_term(), which still has to be called.
+ *
+ * @param chunk_downloader the chunk downloader
+ */
+void STDCALL chunk_downloader_cancel(SF_CHUNK_DOWNLOADER *chunk_downloader);
+
+/**
+ * Takes the next chunk from the chunk downloader. Only blocks if no suitable chunk has
+ * been downloaded yet. Must be called from a single consumer thread at a time;
+ * concurrent consumers have to hold consumer_lock.
+ *
+ * @param chunk_downloader the chunk downloader
+ * @param unordered        SF_BOOLEAN_TRUE to take whichever downloaded chunk is available
+ *                         instead of the next chunk in result order.
+ * @param index            the queue index of the returned chunk
+ * @param chunk            the chunk; set to NULL once all chunks have been consumed.
+ *                         The caller takes ownership of the chunk.
+ *
+ * @return SF_BOOLEAN_TRUE if a chunk was taken or the end of results was reached, which
+ *         a cancelled chunk downloader is at, SF_BOOLEAN_FALSE if the chunk downloader failed.
+ */
+sf_bool STDCALL chunk_downloader_next_chunk(SF_CHUNK_DOWNLOADER *chunk_downloader,
+                                            sf_bool unordered,
+                                            uint64 *index,
+                                            void **chunk);
+/**
+ * Skips the next chunks in result order. The producers don't download the chunks they haven't
+ * started yet and chunk_downloader_next_chunk() passes over them; the chunks downloaded already
+ * are still handed out and are for the caller to drop. Only meant for ordered consumption.
+ *
+ * @param chunk_downloader the chunk downloader
+ * @param count            the number of chunks to skip from the next one to consume
+ */
+void STDCALL chunk_downloader_skip(SF_CHUNK_DOWNLOADER *chunk_downloader, uint64 count);
+
 sf_bool STDCALL get_shutdown_or_error(SF_CHUNK_DOWNLOADER *chunk_downloader);
 sf_bool STDCALL get_shutdown(SF_CHUNK_DOWNLOADER *chunk_downloader);
 sf_bool STDCALL get_error(SF_CHUNK_DOWNLOADER *chunk_downloader);
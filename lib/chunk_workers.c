@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "chunk_workers.h"
+#include "memory.h"
+#include "error.h"
+#include <snowflake/logger.h>
+
+static void *chunk_worker_thread(void *arg) {
+    SF_CHUNK_WORKERS *workers = (SF_CHUNK_WORKERS *) arg;
+    SF_RESULT_CHUNK *result_chunk;
+    SF_ERROR_STRUCT error;
+    SF_STATUS status;
+    uint64 number;
+    void *item;
+    sf_bool done;
+
+    memset(&error, 0, sizeof(error));
+    for (;;) {
+        // Waiting for room with the handout lock held keeps the numbers within the queue
+        _critical_section_lock(&workers->handout_lock);
+        _critical_section_lock(&workers->lock);
+        while (!workers->stopped && workers->next_number < workers->end_number &&
+               workers->next_number - workers->take_number >= workers->capacity) {
+            _cond_wait(&workers->space_cond, &workers->lock);
+        }
+        done = workers->stopped || workers->next_number >= workers->end_number;
+        _critical_section_unlock(&workers->lock);
+        if (done) {
+            _critical_section_unlock(&workers->handout_lock);
+            break;
+        }
+
+        result_chunk = NULL;
+        status = snowflake_fetch_chunk(workers->sfstmt, &result_chunk, &error);
+        number = workers->next_number;
+        if (status == SF_STATUS_SUCCESS) {
+            workers->next_number++;
+        } else {
+            sf_chunk_workers_end(workers, number, &error);
+        }
+        _critical_section_unlock(&workers->handout_lock);
+        if (status != SF_STATUS_SUCCESS) {
+            break;
+        }
+
+        item = workers->process(workers->context, result_chunk, &error);
+        snowflake_chunk_term(result_chunk);
+        if (!item) {
+            sf_chunk_workers_end(workers, number, &error);
+            break;
+        }
+
+        _critical_section_lock(&workers->lock);
+        if (workers->stopped) {
+            _critical_section_unlock(&workers->lock);
+            workers->free_item(workers->context, item);
+            break;
+        }
+        workers->queue[number % workers->capacity] = item;
+        _cond_broadcast(&workers->ready_cond);
+        _critical_section_unlock(&workers->lock);
+    }
+
+    clear_snowflake_error(&error);
+    return NULL;
+}
+
+SF_STATUS STDCALL sf_chunk_workers_init(SF_CHUNK_WORKERS *workers, SF_STMT *sfstmt,
+                                        unsigned int thread_count,
+                                        SF_CHUNK_WORKERS_PROCESS process,
+                                        SF_CHUNK_WORKERS_FREE free_item, void *context) {
+    memset(workers, 0, sizeof(SF_CHUNK_WORKERS));
+    workers->sfstmt = sfstmt;
+    workers->process = process;
+    workers->free_item = free_item;
+    workers->context = context;
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    workers->requested_threads = thread_count;
+    // Two chunks in flight per thread keep the threads busy while the caller takes them
+    workers->capacity = (uint64) thread_count * 2;
+    workers->end_number = (uint64) -1;
+    workers->queue = (void **) SF_CALLOC(workers->capacity, sizeof(void *));
+    workers->threads = (SF_THREAD_HANDLE *) SF_CALLOC(thread_count, sizeof(SF_THREAD_HANDLE));
+    if (!workers->queue || !workers->threads) {
+        SF_FREE(workers->queue);
+        SF_FREE(workers->threads);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+
+    _critical_section_init(&workers->handout_lock);
+    _critical_section_init(&workers->lock);
+    _cond_init(&workers->ready_cond);
+    _cond_init(&workers->space_cond);
+    clear_snowflake_error(&workers->error);
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL sf_chunk_workers_start(SF_CHUNK_WORKERS *workers) {
+    SF_ERROR_STRUCT error;
+    const char *error_msg;
+    int pthread_ret;
+    unsigned int i;
+
+    for (i = 0; i < workers->requested_threads; i++) {
+        if ((pthread_ret = _thread_init(&workers->threads[i], chunk_worker_thread,
+                                        (void *) workers)) != 0) {
+            memset(&error, 0, sizeof(error));
+            PTHREAD_CREATE_ERROR_MSG(pthread_ret, error_msg);
+            SET_SNOWFLAKE_STMT_ERROR(&error, SF_STATUS_ERROR_PTHREAD, error_msg, "",
+                                     workers->sfstmt->sfqid);
+            sf_chunk_workers_end(workers, 0, &error);
+            clear_snowflake_error(&error);
+            return SF_STATUS_ERROR_PTHREAD;
+        }
+        workers->thread_count++;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+void STDCALL sf_chunk_workers_end(SF_CHUNK_WORKERS *workers, uint64 number,
+                                  SF_ERROR_STRUCT *error) {
+    _critical_section_lock(&workers->lock);
+    if (number < workers->end_number) {
+        workers->end_number = number;
+    }
+    if (error && error->error_code && !workers->error.error_code) {
+        copy_snowflake_error(&workers->error, error);
+    }
+    _cond_broadcast(&workers->ready_cond);
+    _critical_section_unlock(&workers->lock);
+}
+
+SF_STATUS STDCALL sf_chunk_workers_take(SF_CHUNK_WORKERS *workers, void **item) {
+    SF_STATUS status = SF_STATUS_SUCCESS;
+    uint64 slot;
+
+    *item = NULL;
+    _critical_section_lock(&workers->lock);
+    slot = workers->take_number % workers->capacity;
+    while (!workers->queue[slot] && workers->take_number < workers->end_number &&
+           !workers->stopped) {
+        _cond_wait(&workers->ready_cond, &workers->lock);
+    }
+    // A chunk queued past the end is left for sf_chunk_workers_term() to free
+    if (workers->queue[slot] && workers->take_number < workers->end_number) {
+        *item = workers->queue[slot];
+        workers->queue[slot] = NULL;
+        workers->take_number++;
+        _cond_broadcast(&workers->space_cond);
+    } else if (workers->error.error_code) {
+        status = workers->error.error_code;
+        copy_snowflake_error(&workers->sfstmt->error, &workers->error);
+    } else {
+        status = SF_STATUS_EOF;
+    }
+    _critical_section_unlock(&workers->lock);
+    return status;
+}
+
+void STDCALL sf_chunk_workers_stop(SF_CHUNK_WORKERS *workers) {
+    unsigned int i;
+
+    _critical_section_lock(&workers->lock);
+    workers->stopped = SF_BOOLEAN_TRUE;
+    _cond_broadcast(&workers->space_cond);
+    _cond_broadcast(&workers->ready_cond);
+    _critical_section_unlock(&workers->lock);
+
+    for (i = 0; i < workers->thread_count; i++) {
+        _thread_join(workers->threads[i]);
+    }
+    workers->thread_count = 0;
+}
+
+void STDCALL sf_chunk_workers_term(SF_CHUNK_WORKERS *workers) {
+    uint64 i;
+
+    sf_chunk_workers_stop(workers);
+    for (i = 0; i < workers->capacity; i++) {
+        if (workers->queue[i]) {
+            workers->free_item(workers->context, workers->queue[i]);
+        }
+    }
+
+    _cond_term(&workers->space_cond);
+    _cond_term(&workers->ready_cond);
+    _critical_section_term(&workers->lock);
+    _critical_section_term(&workers->handout_lock);
+    clear_snowflake_error(&workers->error);
+
+    SF_FREE(workers->queue);
+    SF_FREE(workers->threads);
+}
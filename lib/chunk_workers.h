@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_CHUNK_WORKERS_H
+#define SNOWFLAKE_CHUNK_WORKERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Processes a chunk taken by a worker.
+ *
+ * @param context the context the workers were initialized with.
+ * @param result_chunk the chunk, terminated by the caller.
+ * @param error receives the error.
+ *
+ * @return the processed chunk, NULL on failure with the error set.
+ */
+typedef void *(STDCALL *SF_CHUNK_WORKERS_PROCESS)(void *context, SF_RESULT_CHUNK *result_chunk,
+                                                 SF_ERROR_STRUCT *error);
+
+/**
+ * Frees a processed chunk that won't be taken.
+ */
+typedef void (STDCALL *SF_CHUNK_WORKERS_FREE)(void *context, void *item);
+
+/**
+ * Worker threads processing the result set of a statement ahead of the caller. The workers
+ * take the chunks with snowflake_fetch_chunk(), numbered in the order they are handed out,
+ * process them and queue the result at its number. sf_chunk_workers_take() returns them in
+ * that order, so the caller sees the chunks in result order.
+ */
+typedef struct SF_CHUNK_WORKERS {
+    SF_STMT *sfstmt;
+    SF_CHUNK_WORKERS_PROCESS process;
+    SF_CHUNK_WORKERS_FREE free_item;
+    void *context;
+
+    SF_THREAD_HANDLE *threads;
+    // Threads started, of the requested ones
+    unsigned int thread_count;
+    unsigned int requested_threads;
+
+    // Held by a worker while it takes a chunk, so that the chunks are numbered in order
+    SF_CRITICAL_SECTION_HANDLE handout_lock;
+    uint64 next_number;
+
+    // Protects the fields below
+    SF_CRITICAL_SECTION_HANDLE lock;
+    // Signaled when a chunk is queued or the chunks end
+    SF_CONDITION_HANDLE ready_cond;
+    // Signaled when the caller takes a chunk or the workers are stopped
+    SF_CONDITION_HANDLE space_cond;
+    // Processed chunks not taken yet, at their number modulo the capacity
+    void **queue;
+    uint64 capacity;
+    // Number of the chunk the caller takes next
+    uint64 take_number;
+    // Number of chunks there are, once a worker has run out of them
+    uint64 end_number;
+    SF_ERROR_STRUCT error;
+    sf_bool stopped;
+} SF_CHUNK_WORKERS;
+
+/**
+ * Allocates the queue of the workers, two chunks in flight per thread. The threads are started
+ * by sf_chunk_workers_start().
+ *
+ * @param thread_count the number of worker threads, 0 taken as 1.
+ *
+ * @return 0 if success, SF_STATUS_ERROR_OUT_OF_MEMORY with nothing to terminate otherwise.
+ */
+SF_STATUS STDCALL sf_chunk_workers_init(SF_CHUNK_WORKERS *workers, SF_STMT *sfstmt,
+                                        unsigned int thread_count,
+                                        SF_CHUNK_WORKERS_PROCESS process,
+                                        SF_CHUNK_WORKERS_FREE free_item, void *context);
+
+/**
+ * Starts the threads. If one can't be started, the chunks end with the error.
+ *
+ * @return 0 if success, otherwise an errno is returned with the error of the workers set.
+ */
+SF_STATUS STDCALL sf_chunk_workers_start(SF_CHUNK_WORKERS *workers);
+
+/**
+ * Ends the chunks at the given number, keeping the first error.
+ */
+void STDCALL sf_chunk_workers_end(SF_CHUNK_WORKERS *workers, uint64 number,
+                                  SF_ERROR_STRUCT *error);
+
+/**
+ * Takes the next chunk, waiting for it to be processed.
+ *
+ * @param item receives the processed chunk.
+ * @return 0 if success, SF_STATUS_EOF if no chunks are left, otherwise an errno is returned
+ *         with the error copied to the statement.
+ */
+SF_STATUS STDCALL sf_chunk_workers_take(SF_CHUNK_WORKERS *workers, void **item);
+
+/**
+ * Stops the threads and waits for them, after which the error of the workers is final.
+ */
+void STDCALL sf_chunk_workers_stop(SF_CHUNK_WORKERS *workers);
+
+/**
+ * Stops the threads and frees the chunks not taken.
+ */
+void STDCALL sf_chunk_workers_term(SF_CHUNK_WORKERS *workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_CHUNK_WORKERS_H
@@ -6,6 +6,7 @@
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <openssl/crypto.h>
 #include <snowflake/client.h>
@@ -15,11 +16,29 @@
 #include "memory.h"
 #include "results.h"
 #include "result_set.h"
+#include "scroll_cache.h"
 #include "error.h"
 #include "chunk_downloader.h"
+#include "materializer.h"
+#include "tz_cache.h"
+#include "io_threads.h"
+#include "query_scheduler.h"
+#include "thread_affinity.h"
+#include "bind_arrow.h"
+#include "bind_upload.h"
+#include "curl_pool.h"
+#include "response_cache.h"
+#include "token_cache.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "json_path.h"
+#include "hex.h"
 
 #define curl_easier_escape(curl, string) curl_easy_escape(curl, string, 0)
 
+// Cell accessors of the results of a statement, see rs_get_accessors()
+#define STMT_RS_ACCESSORS(sfstmt) ((const rs_accessors_t *) (sfstmt)->rs_accessors)
+
 // Define internal constants
 sf_bool DISABLE_VERIFY_PEER;
 char *CA_BUNDLE_FILE;
@@ -31,12 +50,18 @@ char *SF_HEADER_USER_AGENT = NULL;
 static char *LOG_PATH = NULL;
 static FILE *LOG_FP = NULL;
 
+// Results of read only queries, see SF_GLOBAL_RESULT_CACHE_SIZE
+static SF_RESPONSE_CACHE *RESULT_CACHE = NULL;
+// Guards RESULT_CACHE, the executes using the cache hold a reference to it so that it can
+// be replaced while they run
+static SF_MUTEX_HANDLE result_cache_lock;
+static uint64 RESULT_CACHE_SIZE = 0;
+static uint64 RESULT_CACHE_MAX_BYTES = SF_DEFAULT_RESULT_CACHE_MAX_BYTES;
+static uint64 RESULT_CACHE_TTL = SF_DEFAULT_RESULT_CACHE_TTL;
+
 static SF_MUTEX_HANDLE log_lock;
 static SF_MUTEX_HANDLE gmlocaltime_lock;
 
-static SF_STATUS STDCALL
-_snowflake_internal_query(SF_CONNECT *sf, const char *sql);
-
 static SF_STATUS STDCALL
 _set_parameters_session_info(SF_CONNECT *sf, cJSON *data);
 
@@ -46,6 +71,7 @@ static SF_STATUS STDCALL
 _reset_connection_parameters(SF_CONNECT *sf, cJSON *parameters,
                              cJSON *session_info, sf_bool do_validate);
 
+#define _SF_STMT_TYPE_SELECT 0x1000
 #define _SF_STMT_TYPE_DML 0x3000
 #define _SF_STMT_TYPE_INSERT (_SF_STMT_TYPE_DML + 0x100)
 #define _SF_STMT_TYPE_UPDATE (_SF_STMT_TYPE_DML + 0x200)
@@ -76,6 +102,16 @@ static sf_bool detect_stmt_type(int64 stmt_type_id) {
     return ret;
 }
 
+/**
+ * Detects statements that can't change the description of another statement, queries and DML
+ * @param stmt_type_id statement type id
+ * @return SF_BOOLEAN_TRUE if the descriptions of other statements hold after the statement
+ */
+static sf_bool stmt_keeps_descriptions(int64 stmt_type_id) {
+    return (stmt_type_id & 0xf000) == _SF_STMT_TYPE_SELECT ||
+           (stmt_type_id & 0xf000) == _SF_STMT_TYPE_DML;
+}
+
 #define _SF_STMT_SQL_BEGIN "begin"
 #define _SF_STMT_SQL_COMMIT "commit"
 #define _SF_STMT_SQL_ROLLBACK "rollback"
@@ -149,6 +185,40 @@ static void log_lock_func(void *udata, int lock) {
     }
 }
 
+/**
+ * Records the value of a session parameter, see snowflake_get_session_parameter().
+ */
+static void STDCALL _cache_session_parameter(SF_CONNECT *sf, const char *name,
+                                             const char *value) {
+    if (!sf->session_parameters &&
+        !(sf->session_parameters = snowflake_cJSON_CreateObject())) {
+        return;
+    }
+    snowflake_cJSON_DeleteItemFromObject((cJSON *) sf->session_parameters, name);
+    snowflake_cJSON_AddStringToObject((cJSON *) sf->session_parameters, name, value);
+}
+
+/**
+ * Records the value of a session parameter in a response as text.
+ */
+static void STDCALL _cache_session_parameter_json(SF_CONNECT *sf, const char *name,
+                                                  const cJSON *value) {
+    char text[32];
+
+    if (snowflake_cJSON_IsString(value)) {
+        _cache_session_parameter(sf, name, value->valuestring);
+    } else if (snowflake_cJSON_IsBool(value)) {
+        _cache_session_parameter(sf, name, snowflake_cJSON_IsTrue(value) ? "true" : "false");
+    } else if (snowflake_cJSON_IsNumber(value)) {
+        if (value->valuedouble == (double) (int64) value->valuedouble) {
+            sb_sprintf(text, sizeof(text), "%lld", (long long) value->valuedouble);
+        } else {
+            sb_sprintf(text, sizeof(text), "%.17g", value->valuedouble);
+        }
+        _cache_session_parameter(sf, name, text);
+    }
+}
+
 /**
  * Reset the connection parameters with the returned parameteres
  * @param sf SF_CONNECT object
@@ -158,11 +228,14 @@ static SF_STATUS STDCALL _reset_connection_parameters(
     SF_CONNECT *sf, cJSON *parameters, cJSON *session_info,
     sf_bool do_validate) {
     if (parameters != NULL) {
-        int i, len;
-        for (i = 0, len = snowflake_cJSON_GetArraySize(parameters); i < len; ++i) {
-            cJSON *p1 = snowflake_cJSON_GetArrayItem(parameters, i);
+        cJSON *p1;
+        snowflake_cJSON_ArrayForEach(p1, parameters) {
             cJSON *name = snowflake_cJSON_GetObjectItem(p1, "name");
             cJSON *value = snowflake_cJSON_GetObjectItem(p1, "value");
+            if (!snowflake_cJSON_IsString(name)) {
+                continue;
+            }
+            _cache_session_parameter_json(sf, name->valuestring, value);
             if (strcmp(name->valuestring, "TIMEZONE") == 0) {
                 if (sf->timezone == NULL ||
                     strcmp(sf->timezone, value->valuestring) != 0) {
@@ -172,6 +245,8 @@ static SF_STATUS STDCALL _reset_connection_parameters(
                 if (sf->service_name == NULL ||
                     strcmp(sf->service_name, value->valuestring) != 0) {
                     alloc_buffer_and_copy(&sf->service_name, value->valuestring);
+                    // The service name is sent in the headers
+                    sf_header_cache_invalidate(sf);
                 }
             } else if (strcmp(name->valuestring, "C_API_QUERY_RESULT_FORMAT") == 0) {
                 if (sf->query_result_format == NULL ||
@@ -365,6 +440,19 @@ static void STDCALL log_term() {
     _mutex_term(&log_lock);
 }
 
+/**
+ * Writes the host of the account, for connections that don't set one.
+ */
+static void STDCALL _snowflake_default_host(SF_CONNECT *sf, char *buf, size_t size) {
+    if (sf->region) {
+        sb_sprintf(buf, size, "%s.%s.snowflakecomputing.com",
+                 sf->account, sf->region);
+    } else {
+        sb_sprintf(buf, size, "%s.snowflakecomputing.com",
+                 sf->account);
+    }
+}
+
 /**
  * Process connection parameters
  * @param sf SF_CONNECT
@@ -407,13 +495,7 @@ _snowflake_check_connection_parameters(SF_CONNECT *sf) {
     if (!sf->host) {
         // construct a host parameter if not specified,
         char buf[1024];
-        if (sf->region) {
-            sb_sprintf(buf, sizeof(buf), "%s.%s.snowflakecomputing.com",
-                     sf->account, sf->region);
-        } else {
-            sb_sprintf(buf, sizeof(buf), "%s.snowflakecomputing.com",
-                     sf->account);
-        }
+        _snowflake_default_host(sf, buf, sizeof(buf));
         alloc_buffer_and_copy(&sf->host, buf);
     }
     // split account and region if connected by a dot.
@@ -482,6 +564,11 @@ SF_STATUS STDCALL snowflake_global_init(
     _snowflake_memory_hooks_setup(hooks);
     sf_memory_init();
     sf_error_init();
+    sf_tz_cache_init();
+    sf_io_threads_init();
+    sf_scheduler_init();
+    sf_affinity_init();
+    _mutex_init(&result_cache_lock);
     if (!log_init(log_path, log_level)) {
         // no way to log error because log_init failed.
         fprintf(stderr, "Error during log initialization");
@@ -493,6 +580,7 @@ SF_STATUS STDCALL snowflake_global_init(
                   curl_easy_strerror(curl_ret));
         goto cleanup;
     }
+    sf_curl_share_init();
 
     if (SF_HEADER_USER_AGENT == NULL) {
 #ifdef __STDC__
@@ -514,21 +602,65 @@ cleanup:
 }
 
 SF_STATUS STDCALL snowflake_global_term() {
+    sf_curl_share_term();
     curl_global_cleanup();
 
     // Cleanup Constants
     SF_FREE(CA_BUNDLE_FILE);
     SF_FREE(SF_HEADER_USER_AGENT);
+    sf_response_cache_release(RESULT_CACHE);
+    RESULT_CACHE = NULL;
+    _mutex_term(&result_cache_lock);
 
     log_term();
+    // The idle buffers of the pool aren't leaks
+    sf_memory_pool_trim();
     sf_alloc_map_to_log(SF_BOOLEAN_TRUE);
+    sf_tz_cache_term();
+    sf_io_threads_term();
+    sf_scheduler_term();
+    sf_affinity_term();
     sf_error_term();
     sf_memory_term();
     return SF_STATUS_SUCCESS;
 }
 
+/**
+ * Routes the allocations of a tag to user hooks, or back to the global allocator.
+ */
+static SF_STATUS STDCALL _snowflake_set_tag_hooks(SF_MEMORY_TAG tag, const SF_USER_MEM_HOOKS *hooks) {
+    SF_INTERNAL_MEM_HOOKS tag_hooks;
+    if (hooks) {
+        tag_hooks.alloc = hooks->alloc_fn;
+        tag_hooks.dealloc = hooks->dealloc_fn;
+        tag_hooks.realloc = hooks->realloc_fn;
+        tag_hooks.calloc = hooks->calloc_fn;
+    }
+    if (!sf_memory_set_tag_hooks(tag, hooks ? &tag_hooks : NULL)) {
+        log_error("Unable to change the memory hooks of tag %d, its memory is in use "
+                  "or the hooks are incomplete", (int) tag);
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * @return a reference to the result cache, to be given back with sf_response_cache_release(),
+ *         or NULL if results aren't cached.
+ */
+static SF_RESPONSE_CACHE *STDCALL _snowflake_result_cache_acquire(void) {
+    SF_RESPONSE_CACHE *cache;
+    _mutex_lock(&result_cache_lock);
+    cache = RESULT_CACHE;
+    sf_response_cache_retain(cache);
+    _mutex_unlock(&result_cache_lock);
+    return cache;
+}
+
 SF_STATUS STDCALL
 snowflake_global_set_attribute(SF_GLOBAL_ATTRIBUTE type, const void *value) {
+    SF_RESPONSE_CACHE *result_cache;
+    SF_RESPONSE_CACHE *old_result_cache;
     switch (type) {
         case SF_GLOBAL_DISABLE_VERIFY_PEER:
             DISABLE_VERIFY_PEER = *(sf_bool *) value;
@@ -550,6 +682,94 @@ snowflake_global_set_attribute(SF_GLOBAL_ATTRIBUTE type, const void *value) {
         case SF_GLOBAL_OCSP_CHECK:
             SF_OCSP_CHECK = *(sf_bool *) value;
             break;
+        case SF_GLOBAL_OCSP_RESPONSE_CACHE_DIR:
+            if (value && *(const char *) value) {
+                sf_setenv(SF_OCSP_RESPONSE_CACHE_DIR_ENV, (const char *) value);
+            } else {
+                sf_unsetenv(SF_OCSP_RESPONSE_CACHE_DIR_ENV);
+            }
+            break;
+        case SF_GLOBAL_OCSP_RESPONSE_CACHE_TTL:
+            if (value && *(int64 *) value > 0) {
+                char ttl[32];
+                sb_sprintf(ttl, sizeof(ttl), "%lld", (long long) *(int64 *) value);
+                sf_setenv(SF_OCSP_RESPONSE_CACHE_TTL_ENV, ttl);
+            } else {
+                sf_unsetenv(SF_OCSP_RESPONSE_CACHE_TTL_ENV);
+            }
+            break;
+        case SF_GLOBAL_MAX_IO_THREADS:
+            sf_io_threads_set_limit(value ? *(uint64 *) value : 0);
+            break;
+        case SF_GLOBAL_MAX_QUERIES:
+            sf_scheduler_set_limit(SF_SCHEDULER_QUERIES, value ? *(uint64 *) value : 0);
+            break;
+        case SF_GLOBAL_MAX_CHUNK_DOWNLOADS:
+            sf_scheduler_set_limit(SF_SCHEDULER_CHUNK_DOWNLOADS, value ? *(uint64 *) value : 0);
+            break;
+        case SF_GLOBAL_THREAD_AFFINITY:
+            sf_affinity_set_policy(value ? *(SF_THREAD_AFFINITY *) value : SF_THREAD_AFFINITY_NONE);
+            break;
+        case SF_GLOBAL_THREAD_CPUS:
+            if (!sf_affinity_set_cpus((const char *) value)) {
+                return SF_STATUS_ERROR_OUT_OF_RANGE;
+            }
+            break;
+        case SF_GLOBAL_DNS_CACHE_TTL:
+            sf_curl_share_set_dns_ttl(value ? *(int64 *) value : SF_DEFAULT_DNS_CACHE_TTL);
+            break;
+        case SF_GLOBAL_CONNECTION_MAX_AGE:
+            sf_curl_share_set_connection_max_age(
+                value ? *(int64 *) value : SF_DEFAULT_CONNECTION_MAX_AGE);
+            break;
+        case SF_GLOBAL_HUGE_PAGES:
+            if (!sf_memory_pool_set_huge_pages(value ? *(SF_HUGE_PAGES *) value : SF_HUGE_PAGES_NONE)) {
+                log_error("Unable to change the pages of the memory pool, its buffers are in use");
+                return SF_STATUS_ERROR_GENERAL;
+            }
+            break;
+        case SF_GLOBAL_RESULT_SET_MEM_HOOKS:
+            return _snowflake_set_tag_hooks(SF_MEMORY_TAG_RESULT_SET, (const SF_USER_MEM_HOOKS *) value);
+        case SF_GLOBAL_CHUNK_DOWNLOAD_MEM_HOOKS:
+            return _snowflake_set_tag_hooks(SF_MEMORY_TAG_CHUNK_DOWNLOAD,
+                                            (const SF_USER_MEM_HOOKS *) value);
+        case SF_GLOBAL_BIND_MEM_HOOKS:
+            return _snowflake_set_tag_hooks(SF_MEMORY_TAG_BIND, (const SF_USER_MEM_HOOKS *) value);
+        case SF_GLOBAL_RESULT_CACHE_SIZE:
+        case SF_GLOBAL_RESULT_CACHE_MAX_BYTES:
+        case SF_GLOBAL_RESULT_CACHE_TTL:
+            if (type == SF_GLOBAL_RESULT_CACHE_SIZE) {
+                RESULT_CACHE_SIZE = value ? *(uint64 *) value : 0;
+            } else if (type == SF_GLOBAL_RESULT_CACHE_MAX_BYTES) {
+                RESULT_CACHE_MAX_BYTES = value ? *(uint64 *) value : SF_DEFAULT_RESULT_CACHE_MAX_BYTES;
+            } else {
+                RESULT_CACHE_TTL = value ? *(uint64 *) value : SF_DEFAULT_RESULT_CACHE_TTL;
+            }
+            // The cached results go with the old settings, the old cache is destroyed once
+            // the executes using it are done
+            result_cache = sf_response_cache_create((size_t) RESULT_CACHE_SIZE,
+                                                    (size_t) RESULT_CACHE_MAX_BYTES,
+                                                    RESULT_CACHE_TTL);
+            _mutex_lock(&result_cache_lock);
+            old_result_cache = RESULT_CACHE;
+            RESULT_CACHE = result_cache;
+            _mutex_unlock(&result_cache_lock);
+            sf_response_cache_release(old_result_cache);
+            break;
+        case SF_GLOBAL_LOG_ASYNC:
+            if (value && *(sf_bool *) value) {
+                if (log_start_async(SF_LOG_ASYNC_DEFAULT_CAPACITY,
+                                    SF_LOG_ASYNC_DEFAULT_FLUSH_INTERVAL) != 0) {
+                    log_error("Unable to start the log writer thread");
+                    return SF_STATUS_ERROR_PTHREAD;
+                }
+            } else {
+                log_stop_async();
+            }
+            break;
+        case SF_GLOBAL_TRACE_EXPORTER:
+            sf_trace_set_exporter((const SF_TRACE_EXPORTER *) value);
+            break;
         default:
             break;
     }
@@ -558,6 +778,9 @@ snowflake_global_set_attribute(SF_GLOBAL_ATTRIBUTE type, const void *value) {
 
 SF_STATUS STDCALL
 snowflake_global_get_attribute(SF_GLOBAL_ATTRIBUTE type, void *value, size_t size) {
+    char *env;
+    int64 ttl;
+
     switch (type) {
         case SF_GLOBAL_DISABLE_VERIFY_PEER:
             *((sf_bool *) value) = DISABLE_VERIFY_PEER;
@@ -576,6 +799,70 @@ snowflake_global_get_attribute(SF_GLOBAL_ATTRIBUTE type, void *value, size_t siz
         case SF_GLOBAL_OCSP_CHECK:
             *((sf_bool *) value) = SF_OCSP_CHECK;
             break;
+        case SF_GLOBAL_OCSP_RESPONSE_CACHE_DIR:
+            env = sf_getenv(SF_OCSP_RESPONSE_CACHE_DIR_ENV);
+            if (env) {
+                sb_strncpy(value, size, env, strlen(env) + 1);
+            } else if (size > 0) {
+                *((char *) value) = '\0';
+            }
+            break;
+        case SF_GLOBAL_OCSP_RESPONSE_CACHE_TTL:
+            env = sf_getenv(SF_OCSP_RESPONSE_CACHE_TTL_ENV);
+            ttl = env ? strtoll(env, NULL, 10) : 0;
+            *((int64 *) value) = ttl > 0 ? ttl : SF_DEFAULT_OCSP_RESPONSE_CACHE_TTL;
+            break;
+        case SF_GLOBAL_MAX_IO_THREADS:
+            *((uint64 *) value) = sf_io_threads_get_limit();
+            break;
+        case SF_GLOBAL_MAX_QUERIES:
+            *((uint64 *) value) = sf_scheduler_get_limit(SF_SCHEDULER_QUERIES);
+            break;
+        case SF_GLOBAL_MAX_CHUNK_DOWNLOADS:
+            *((uint64 *) value) = sf_scheduler_get_limit(SF_SCHEDULER_CHUNK_DOWNLOADS);
+            break;
+        case SF_GLOBAL_THREAD_AFFINITY:
+            *((SF_THREAD_AFFINITY *) value) = sf_affinity_get_policy();
+            break;
+        case SF_GLOBAL_THREAD_CPUS:
+            sf_affinity_get_cpus((char *) value, size);
+            break;
+        case SF_GLOBAL_DNS_CACHE_TTL:
+            *((int64 *) value) = sf_curl_share_get_dns_ttl();
+            break;
+        case SF_GLOBAL_CONNECTION_MAX_AGE:
+            *((int64 *) value) = sf_curl_share_get_connection_max_age();
+            break;
+        case SF_GLOBAL_HUGE_PAGES:
+            *((SF_HUGE_PAGES *) value) = sf_memory_pool_get_huge_pages();
+            break;
+        case SF_GLOBAL_RESULT_SET_MEMORY:
+            *((uint64 *) value) = sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET);
+            break;
+        case SF_GLOBAL_CHUNK_DOWNLOAD_MEMORY:
+            *((uint64 *) value) = sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+            break;
+        case SF_GLOBAL_BIND_MEMORY:
+            *((uint64 *) value) = sf_memory_tag_used(SF_MEMORY_TAG_BIND);
+            break;
+        case SF_GLOBAL_RESULT_CACHE_SIZE:
+            *((uint64 *) value) = RESULT_CACHE_SIZE;
+            break;
+        case SF_GLOBAL_RESULT_CACHE_MAX_BYTES:
+            *((uint64 *) value) = RESULT_CACHE_MAX_BYTES;
+            break;
+        case SF_GLOBAL_RESULT_CACHE_TTL:
+            *((uint64 *) value) = RESULT_CACHE_TTL;
+            break;
+        case SF_GLOBAL_LOG_ASYNC:
+            *((sf_bool *) value) = log_is_async() ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+            break;
+        case SF_GLOBAL_TRACE_EXPORTER:
+            *((const SF_TRACE_EXPORTER **) value) = sf_trace_get_exporter();
+            break;
+        case SF_GLOBAL_METRICS:
+            sf_metrics_snapshot((SF_METRICS_SNAPSHOT *) value);
+            break;
         default:
             break;
     }
@@ -611,6 +898,9 @@ SF_CONNECT *STDCALL snowflake_init() {
         alloc_buffer_and_copy(&sf->application_version, SF_API_VERSION);
 
         _mutex_init(&sf->mutex_parameters);
+        sf->control_stmt = NULL;
+        sf->trans_begin_pending = SF_BOOLEAN_FALSE;
+        _mutex_init(&sf->mutex_transaction);
 
         sf->token = NULL;
         sf->master_token = NULL;
@@ -625,6 +915,50 @@ SF_CONNECT *STDCALL snowflake_init() {
         sf->directURL = NULL;
         sf->direct_query_token = NULL;
         sf->retry_on_curle_couldnt_connect_count = 0;
+        sf->chunk_downloader_threads = SF_DEFAULT_CHUNK_DOWNLOADER_THREADS;
+        sf->chunk_downloader_fetch_slots = SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS;
+        sf->chunk_downloader_memory_limit = 0;
+        sf->result_chunk_size = SF_RESULT_CHUNK_SIZE_AUTO;
+        sf->chunk_downloader_multiplex = SF_BOOLEAN_FALSE;
+        sf->chunk_streaming_decode = SF_BOOLEAN_FALSE;
+        sf->chunk_downloader_hedging = SF_BOOLEAN_FALSE;
+        sf->chunk_decoder_inflate = SF_BOOLEAN_FALSE;
+        sf->chunk_compressed_prefetch = SF_BOOLEAN_FALSE;
+        sf->json_to_arrow = SF_BOOLEAN_FALSE;
+        sf->chunk_spill_dir = NULL;
+        sf_memory_budget_init(&sf->memory_budget, 0, NULL);
+        sf->statement_memory_limit = 0;
+        sf->query_priority = SF_QUERY_PRIORITY_NORMAL;
+        sf->query_poll_min_interval = SF_DEFAULT_QUERY_POLL_MIN_INTERVAL;
+        sf->query_poll_max_interval = SF_DEFAULT_QUERY_POLL_MAX_INTERVAL;
+        sf->retry_backoff_base = SF_DEFAULT_RETRY_BACKOFF_BASE;
+        sf->retry_backoff_cap = SF_DEFAULT_RETRY_BACKOFF_CAP;
+        sf->poll_retry_backoff_base = SF_DEFAULT_RETRY_BACKOFF_BASE;
+        sf->poll_retry_backoff_cap = SF_DEFAULT_RETRY_BACKOFF_CAP;
+        sf->chunk_retry_backoff_base = SF_DEFAULT_RETRY_BACKOFF_BASE;
+        sf->chunk_retry_backoff_cap = SF_DEFAULT_RETRY_BACKOFF_CAP;
+        sf->retry_budget = 0;
+        sf->retry_tokens = 0;
+        sf->request_compression_threshold = 0;
+        sf->describe_cache_size = 0;
+        sf->describe_cache = NULL;
+        sf->curl_pool = sf_curl_pool_create();
+        sf->header_cache[0] = NULL;
+        sf->header_cache[1] = NULL;
+        sf->header_generation = 0;
+        sf->warmup_started = SF_BOOLEAN_FALSE;
+        _mutex_init(&sf->mutex_token);
+        sf->token_generation = 0;
+        _mutex_init(&sf->mutex_renew_session);
+        sf->token_renew_at_ms = SF_TOKEN_RENEW_NEVER;
+        sf->token_cache_dir = NULL;
+        sf->token_cache_file = NULL;
+        sf->token_cache_key = NULL;
+        sf->background_token_renewal = SF_BOOLEAN_FALSE;
+        sf->token_renewal_started = SF_BOOLEAN_FALSE;
+        sf->token_renewal_stop = SF_BOOLEAN_FALSE;
+        _critical_section_init(&sf->token_renewal_lock);
+        _cond_init(&sf->token_renewal_cond);
     }
 
     return sf;
@@ -639,16 +973,30 @@ SF_STATUS STDCALL snowflake_term(SF_CONNECT *sf) {
     char *s_resp = NULL;
     clear_snowflake_error(&sf->error);
 
-    if (sf->token && sf->master_token) {
-        /* delete the session */
+    if (sf->token_renewal_started) {
+        _critical_section_lock(&sf->token_renewal_lock);
+        sf->token_renewal_stop = SF_BOOLEAN_TRUE;
+        _cond_signal(&sf->token_renewal_cond);
+        _critical_section_unlock(&sf->token_renewal_lock);
+        _thread_join(sf->token_renewal_thread);
+        sf->token_renewal_started = SF_BOOLEAN_FALSE;
+    }
+
+    snowflake_stmt_term(sf->control_stmt);
+    sf->control_stmt = NULL;
+
+    if (sf->token && sf->master_token && !sf->token_cache_file) {
+        /* delete the session, unless it's cached for the next process */
         URL_KEY_VALUE url_params[] = {
             {.key="delete=", .value="true", .formatted_key=NULL, .formatted_value=NULL, .key_size=0, .value_size=0}
         };
         if (request(sf, &resp, DELETE_SESSION_URL, url_params,
                     sizeof(url_params) / sizeof(URL_KEY_VALUE), NULL, NULL,
                     POST_REQUEST_TYPE, &sf->error, SF_BOOLEAN_FALSE)) {
-            s_resp = snowflake_cJSON_Print(resp);
-            log_trace("JSON response:\n%s", s_resp);
+            if (SF_LOG_ENABLED(SF_LOG_TRACE)) {
+                s_resp = snowflake_cJSON_PrintUnformatted(resp);
+                log_trace("JSON response:\n%s", s_resp);
+            }
             /* Even if the session deletion fails, it will be cleaned after 7 days.
              * Catching error here won't help
              */
@@ -657,8 +1005,22 @@ SF_STATUS STDCALL snowflake_term(SF_CONNECT *sf) {
         SF_FREE(s_resp);
     }
 
+    if (sf->warmup_started) {
+        _thread_join(sf->warmup_thread);
+        sf->warmup_started = SF_BOOLEAN_FALSE;
+    }
+    sf_curl_pool_destroy(sf->curl_pool);
+    sf->curl_pool = NULL;
+    sf_header_cache_invalidate(sf);
+    sf_response_cache_destroy(sf->describe_cache);
+    sf->describe_cache = NULL;
     _mutex_term(&sf->mutex_sequence_counter);
     _mutex_term(&sf->mutex_parameters);
+    _mutex_term(&sf->mutex_transaction);
+    _mutex_term(&sf->mutex_token);
+    _mutex_term(&sf->mutex_renew_session);
+    _cond_term(&sf->token_renewal_cond);
+    _critical_section_term(&sf->token_renewal_lock);
     SF_FREE(sf->host);
     SF_FREE(sf->port);
     SF_FREE(sf->user);
@@ -676,7 +1038,12 @@ SF_STATUS STDCALL snowflake_term(SF_CONNECT *sf) {
     SF_FREE(sf->application_version);
     SF_FREE(sf->timezone);
     SF_FREE(sf->service_name);
+    SF_FREE(sf->chunk_spill_dir);
+    SF_FREE(sf->token_cache_dir);
+    SF_FREE(sf->token_cache_file);
+    SF_FREE(sf->token_cache_key);
     SF_FREE(sf->query_result_format);
+    snowflake_cJSON_Delete((cJSON *) sf->session_parameters);
     SF_FREE(sf->master_token);
     SF_FREE(sf->token);
     SF_FREE(sf->directURL);
@@ -687,6 +1054,289 @@ SF_STATUS STDCALL snowflake_term(SF_CONNECT *sf) {
     return SF_STATUS_SUCCESS;
 }
 
+/**
+ * What the warm up thread needs, copied so that the connection can change meanwhile
+ */
+typedef struct SF_WARMUP_ARGS {
+    SF_CURL_POOL *pool;
+    char url[1024];
+    sf_bool insecure_mode;
+} SF_WARMUP_ARGS;
+
+/**
+ * The URL to open the connections of a warm up to.
+ */
+static void _snowflake_warmup_url(SF_CONNECT *sf, char *url, size_t size) {
+    char host[1024];
+
+    if (sf->host) {
+        sb_strcpy(host, sizeof(host), sf->host);
+    } else {
+        _snowflake_default_host(sf, host, sizeof(host));
+    }
+    sb_sprintf(url, size, "%s://%s:%s/",
+               sf->protocol ? sf->protocol : "https", host, sf->port ? sf->port : "443");
+}
+
+static void *warmup_thread(void *arg) {
+    SF_WARMUP_ARGS *args = (SF_WARMUP_ARGS *) arg;
+    sf_curl_pool_warmup(args->pool, args->url, SF_WARMUP_CONNECTIONS, args->insecure_mode);
+    SF_FREE(args);
+    return NULL;
+}
+
+SF_STATUS STDCALL snowflake_warmup(SF_CONNECT *sf) {
+    SF_WARMUP_ARGS *args;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!sf->host && is_string_empty(sf->account)) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_CONNECTION_PARAMS,
+                            "Account or host must be set to warm up the connection",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        return SF_STATUS_ERROR_BAD_CONNECTION_PARAMS;
+    }
+    // One warm up at a time, the previous one has done its job by now
+    if (sf->warmup_started) {
+        _thread_join(sf->warmup_thread);
+        sf->warmup_started = SF_BOOLEAN_FALSE;
+    }
+
+    args = (SF_WARMUP_ARGS *) SF_CALLOC(1, sizeof(SF_WARMUP_ARGS));
+    if (!args) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while warming up the connection",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    _snowflake_warmup_url(sf, args->url, sizeof(args->url));
+    args->pool = sf->curl_pool;
+    args->insecure_mode = sf->insecure_mode;
+
+    if (_thread_init(&sf->warmup_thread, warmup_thread, args) != 0) {
+        SF_FREE(args);
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_GENERAL,
+                            "Unable to start the warm up thread",
+                            SF_SQLSTATE_GENERAL_ERROR);
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    sf->warmup_started = SF_BOOLEAN_TRUE;
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Logins of snowflake_connect_many(), taken in turn by its threads
+ */
+typedef struct SF_CONNECT_MANY {
+    SF_CRITICAL_SECTION_HANDLE lock;
+    SF_CONNECT **connections;
+    SF_STATUS *statuses;
+    size_t count;
+    size_t next;
+} SF_CONNECT_MANY;
+
+static void *connect_many_thread(void *arg) {
+    SF_CONNECT_MANY *logins = (SF_CONNECT_MANY *) arg;
+    size_t i;
+
+    for (;;) {
+        _critical_section_lock(&logins->lock);
+        i = logins->next++;
+        _critical_section_unlock(&logins->lock);
+        if (i >= logins->count) {
+            break;
+        }
+        logins->statuses[i] = snowflake_connect(logins->connections[i]);
+    }
+    return NULL;
+}
+
+SF_STATUS STDCALL snowflake_connect_many(SF_CONNECT **connections, size_t count,
+                                         size_t max_concurrency, SF_STATUS *statuses) {
+    SF_CONNECT_MANY logins;
+    SF_THREAD_HANDLE *threads;
+    SF_CURL_POOL *shared;
+    char url[1024];
+    size_t thread_count;
+    size_t started;
+    size_t i;
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+
+    if (!connections && count > 0) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    for (i = 0; i < count; i++) {
+        if (!connections[i]) {
+            return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+        }
+    }
+    if (count == 0) {
+        return SF_STATUS_SUCCESS;
+    }
+    thread_count = max_concurrency > 0 && max_concurrency < count ? max_concurrency : count;
+
+    // The sessions share one pool, so that the connections and TLS sessions opened for one
+    // login serve the others
+    shared = connections[0]->curl_pool;
+    for (i = 1; i < count; i++) {
+        if (connections[i]->curl_pool != shared && !connections[i]->warmup_started) {
+            sf_curl_pool_destroy(connections[i]->curl_pool);
+            connections[i]->curl_pool = sf_curl_pool_share(shared);
+        }
+    }
+    // Resolve the host and make the handshakes once, in parallel, before the logins need them
+    if (connections[0]->host || !is_string_empty(connections[0]->account)) {
+        _snowflake_warmup_url(connections[0], url, sizeof(url));
+        sf_curl_pool_warmup(shared, url, thread_count, connections[0]->insecure_mode);
+    }
+
+    memset(&logins, 0, sizeof(logins));
+    logins.connections = connections;
+    logins.count = count;
+    logins.statuses = (SF_STATUS *) SF_CALLOC(count, sizeof(SF_STATUS));
+    threads = (SF_THREAD_HANDLE *) SF_CALLOC(thread_count, sizeof(SF_THREAD_HANDLE));
+    if (!logins.statuses || !threads) {
+        for (i = 0; statuses && i < count; i++) {
+            statuses[i] = SF_STATUS_ERROR_OUT_OF_MEMORY;
+        }
+        SF_FREE(logins.statuses);
+        SF_FREE(threads);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    _critical_section_init(&logins.lock);
+    for (started = 0; started < thread_count; started++) {
+        if (_thread_init(&threads[started], connect_many_thread, &logins) != 0) {
+            log_warn("Unable to start a login thread, %lu logins run at a time",
+                     (unsigned long) started);
+            break;
+        }
+    }
+    // Without any thread the logins run one after the other
+    if (started == 0) {
+        connect_many_thread(&logins);
+    }
+    for (i = 0; i < started; i++) {
+        _thread_join(threads[i]);
+    }
+    _critical_section_term(&logins.lock);
+
+    for (i = 0; i < count; i++) {
+        if (logins.statuses[i] != SF_STATUS_SUCCESS && ret == SF_STATUS_SUCCESS) {
+            ret = logins.statuses[i];
+        }
+    }
+    if (statuses) {
+        memcpy(statuses, logins.statuses, count * sizeof(SF_STATUS));
+    }
+    log_debug("Logged in %lu sessions over %lu threads", (unsigned long) count,
+              (unsigned long) started);
+    SF_FREE(logins.statuses);
+    SF_FREE(threads);
+    return ret;
+}
+
+/**
+ * Renews the session token of a connection shortly before it expires, so that queries don't
+ * have to renew it when the server rejects it.
+ */
+static void *token_renewal_thread(void *arg) {
+    SF_CONNECT *sf = (SF_CONNECT *) arg;
+    SF_ERROR_STRUCT error;
+    CURL *curl;
+    unsigned long long now;
+    unsigned long long renew_at;
+
+    memset(&error, 0, sizeof(error));
+    clear_snowflake_error(&error);
+    _critical_section_lock(&sf->token_renewal_lock);
+    while (!sf->token_renewal_stop) {
+        _mutex_lock(&sf->mutex_token);
+        renew_at = sf->token_renew_at_ms;
+        _mutex_unlock(&sf->mutex_token);
+        now = sf_monotonic_time_ms();
+        if (now < renew_at) {
+            _cond_timed_wait(&sf->token_renewal_cond, &sf->token_renewal_lock,
+                             renew_at - now < SF_UINT32_MAX ?
+                             (unsigned int) (renew_at - now) : SF_UINT32_MAX);
+            continue;
+        }
+
+        _critical_section_unlock(&sf->token_renewal_lock);
+        log_debug("Renewing the session token ahead of its expiry");
+        curl = sf_curl_pool_acquire(sf->curl_pool);
+        if (!renew_session(curl, sf, &error)) {
+            log_warn("Background token renewal failed: %s",
+                     error.msg ? error.msg : "unknown error");
+            _mutex_lock(&sf->mutex_token);
+            sf->token_renew_at_ms = sf_monotonic_time_ms() + SF_TOKEN_RENEWAL_RETRY_INTERVAL;
+            _mutex_unlock(&sf->mutex_token);
+        }
+        sf_curl_pool_release(sf->curl_pool, curl);
+        clear_snowflake_error(&error);
+        _critical_section_lock(&sf->token_renewal_lock);
+    }
+    _critical_section_unlock(&sf->token_renewal_lock);
+    return NULL;
+}
+
+/**
+ * Goes on with the session a previous process cached, renewing its session token if it
+ * expired meanwhile.
+ *
+ * @return SF_BOOLEAN_TRUE if the connection has a session, otherwise it is to log in.
+ */
+static sf_bool STDCALL _snowflake_resume_cached_session(SF_CONNECT *sf) {
+    cJSON *cached = sf_token_cache_load(sf);
+    cJSON *validity;
+    CURL *curl;
+    SF_STATUS status;
+    sf_bool ret = SF_BOOLEAN_FALSE;
+
+    if (!cached) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (!set_tokens(sf, cached, "token", "masterToken", &sf->error)) {
+        goto cleanup;
+    }
+    _mutex_lock(&sf->mutex_parameters);
+    status = _reset_connection_parameters(
+        sf,
+        snowflake_cJSON_GetObjectItem(cached, "parameters"),
+        snowflake_cJSON_GetObjectItem(cached, "sessionInfo"), SF_BOOLEAN_FALSE);
+    _mutex_unlock(&sf->mutex_parameters);
+    if (status != SF_STATUS_SUCCESS) {
+        goto cleanup;
+    }
+
+    ret = SF_BOOLEAN_TRUE;
+    validity = snowflake_cJSON_GetObjectItem(cached, "validityInSeconds");
+    if (validity->valuedouble <= 0) {
+        log_debug("The cached session token expired, renewing it");
+        curl = sf_curl_pool_acquire(sf->curl_pool);
+        ret = renew_session(curl, sf, &sf->error);
+        sf_curl_pool_release(sf->curl_pool, curl);
+    }
+
+cleanup:
+    if (ret) {
+        log_info("Resumed the cached session");
+    } else {
+        // The cached session is no good, log in afresh
+        sf_token_cache_remove(sf);
+        _mutex_lock(&sf->mutex_token);
+        SF_FREE(sf->token);
+        SF_FREE(sf->master_token);
+        sf->token_generation++;
+        sf->token_renew_at_ms = SF_TOKEN_RENEW_NEVER;
+        _mutex_unlock(&sf->mutex_token);
+        clear_snowflake_error(&sf->error);
+    }
+    snowflake_cJSON_Delete(cached);
+    return ret;
+}
+
 SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
     sf_bool success = SF_BOOLEAN_FALSE;
     SF_JSON_ERROR json_error;
@@ -738,6 +1388,8 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
         {.key = "warehouse=", .value=sf->warehouse, .formatted_key=NULL, .formatted_value=NULL, .key_size=0, .value_size=0},
         {.key = "roleName=", .value=sf->role, .formatted_key=NULL, .formatted_value=NULL, .key_size=0, .value_size=0},
     };
+    SF_TRACE_SPAN span;
+    sf_span_start(&span, "login", NULL);
     SF_STATUS ret = _snowflake_check_connection_parameters(sf);
     if (ret != SF_STATUS_SUCCESS) {
         goto cleanup;
@@ -745,6 +1397,11 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
     ret = SF_STATUS_ERROR_GENERAL; // reset to the error
 
     uuid4_generate(sf->request_id);// request id
+    memcpy(span.request_id, sf->request_id, SF_UUID4_LEN);
+
+    if (sf_token_cache_open(sf) && _snowflake_resume_cached_session(sf)) {
+        goto connected;
+    }
 
     // Create body
     body = create_auth_json_body(
@@ -755,7 +1412,7 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
         sf->timezone,
         sf->autocommit);
     log_trace("Created body");
-    s_body = snowflake_cJSON_Print(body);
+    s_body = snowflake_cJSON_PrintUnformatted(body);
     // TODO delete password before printing
     if (DEBUG) {
         log_debug("body:\n%s", s_body);
@@ -765,8 +1422,10 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
     if (request(sf, &resp, SESSION_URL, url_params,
                 sizeof(url_params) / sizeof(URL_KEY_VALUE), s_body, NULL,
                 POST_REQUEST_TYPE, &sf->error, SF_BOOLEAN_FALSE)) {
-        s_resp = snowflake_cJSON_Print(resp);
-        log_trace("Here is JSON response:\n%s", s_resp);
+        if (SF_LOG_ENABLED(SF_LOG_TRACE)) {
+            s_resp = snowflake_cJSON_PrintUnformatted(resp);
+            log_trace("Here is JSON response:\n%s", s_resp);
+        }
         if ((json_error = json_copy_bool(&success, resp, "success")) !=
             SF_JSON_ERROR_NONE) {
             log_error("JSON error: %d", json_error);
@@ -807,6 +1466,7 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
         if (ret > 0) {
             goto cleanup;
         }
+        sf_token_cache_save(sf, data, "token");
     } else {
         log_error("No response");
         if (sf->error.error_code == SF_STATUS_SUCCESS) {
@@ -817,9 +1477,19 @@ SF_STATUS STDCALL snowflake_connect(SF_CONNECT *sf) {
         goto cleanup;
     }
 
+connected:
     /* we are done... */
     ret = SF_STATUS_SUCCESS;
 
+    if (sf->background_token_renewal && !sf->token_renewal_started) {
+        sf->token_renewal_stop = SF_BOOLEAN_FALSE;
+        if (_thread_init(&sf->token_renewal_thread, token_renewal_thread, sf) == 0) {
+            sf->token_renewal_started = SF_BOOLEAN_TRUE;
+        } else {
+            log_warn("Unable to start the token renewal thread, tokens are renewed on expiry");
+        }
+    }
+
 cleanup:
     // Delete password and passcode for security's sake
     if (sf->password) {
@@ -836,6 +1506,7 @@ cleanup:
     snowflake_cJSON_Delete(resp);
     SF_FREE(s_body);
     SF_FREE(s_resp);
+    sf_span_end(&span, ret);
 
     return ret;
 }
@@ -946,10 +1617,106 @@ SF_STATUS STDCALL snowflake_set_attribute(
             break;
         case SF_DIR_QUERY_TOKEN:
             alloc_buffer_and_copy(&sf->direct_query_token, value);
+            sf_header_cache_invalidate(sf);
             break;
         case SF_RETRY_ON_CURLE_COULDNT_CONNECT_COUNT:
             sf->retry_on_curle_couldnt_connect_count = value ? *((int8 *) value) : 0;
             break;
+        case SF_CON_CHUNK_DOWNLOADER_THREADS:
+            sf->chunk_downloader_threads = value ?
+                *((uint64 *) value) : SF_DEFAULT_CHUNK_DOWNLOADER_THREADS;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_FETCH_SLOTS:
+            sf->chunk_downloader_fetch_slots = value ?
+                *((uint64 *) value) : SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_MEMORY_LIMIT:
+            sf->chunk_downloader_memory_limit = value ? *((uint64 *) value) : 0;
+            break;
+        case SF_CON_RESULT_CHUNK_SIZE:
+            sf->result_chunk_size = value ? *((uint64 *) value) : SF_RESULT_CHUNK_SIZE_AUTO;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_MULTIPLEX:
+            sf->chunk_downloader_multiplex = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_CHUNK_STREAMING_DECODE:
+            sf->chunk_streaming_decode = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_HEDGING:
+            sf->chunk_downloader_hedging = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_CHUNK_DECODER_INFLATE:
+            sf->chunk_decoder_inflate = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_CHUNK_COMPRESSED_PREFETCH:
+            sf->chunk_compressed_prefetch = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_JSON_TO_ARROW:
+            sf->json_to_arrow = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_MEMORY_LIMIT:
+            sf->memory_budget.limit = value ? *((uint64 *) value) : 0;
+            break;
+        case SF_CON_STATEMENT_MEMORY_LIMIT:
+            sf->statement_memory_limit = value ? *((uint64 *) value) : 0;
+            break;
+        case SF_CON_CHUNK_SPILL_DIR:
+            alloc_buffer_and_copy(&sf->chunk_spill_dir, value);
+            break;
+        case SF_CON_QUERY_PRIORITY:
+            sf->query_priority = value ?
+                *((SF_QUERY_PRIORITY *) value) : SF_QUERY_PRIORITY_NORMAL;
+            break;
+        case SF_CON_TOKEN_CACHE_DIR:
+            alloc_buffer_and_copy(&sf->token_cache_dir, value);
+            break;
+        case SF_CON_QUERY_POLL_MIN_INTERVAL:
+            sf->query_poll_min_interval = value ?
+                *((uint64 *) value) : SF_DEFAULT_QUERY_POLL_MIN_INTERVAL;
+            break;
+        case SF_CON_QUERY_POLL_MAX_INTERVAL:
+            sf->query_poll_max_interval = value ?
+                *((uint64 *) value) : SF_DEFAULT_QUERY_POLL_MAX_INTERVAL;
+            break;
+        case SF_CON_RETRY_BACKOFF_BASE:
+            sf->retry_backoff_base = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_BASE;
+            break;
+        case SF_CON_RETRY_BACKOFF_CAP:
+            sf->retry_backoff_cap = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_CAP;
+            break;
+        case SF_CON_POLL_RETRY_BACKOFF_BASE:
+            sf->poll_retry_backoff_base = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_BASE;
+            break;
+        case SF_CON_POLL_RETRY_BACKOFF_CAP:
+            sf->poll_retry_backoff_cap = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_CAP;
+            break;
+        case SF_CON_CHUNK_RETRY_BACKOFF_BASE:
+            sf->chunk_retry_backoff_base = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_BASE;
+            break;
+        case SF_CON_CHUNK_RETRY_BACKOFF_CAP:
+            sf->chunk_retry_backoff_cap = value ?
+                *((uint64 *) value) : SF_DEFAULT_RETRY_BACKOFF_CAP;
+            break;
+        case SF_CON_RETRY_BUDGET:
+            sf->retry_budget = value ? *((uint64 *) value) : 0;
+            sf_atomic_store(&sf->retry_tokens, sf->retry_budget * SF_RETRY_TOKEN_COST);
+            break;
+        case SF_CON_BACKGROUND_TOKEN_RENEWAL:
+            sf->background_token_renewal = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_CON_REQUEST_COMPRESSION_THRESHOLD:
+            sf->request_compression_threshold = value ? *((uint64 *) value) : 0;
+            break;
+        case SF_CON_DESCRIBE_CACHE_SIZE:
+            sf_response_cache_destroy(sf->describe_cache);
+            sf->describe_cache_size = value ? *((uint64 *) value) : 0;
+            sf->describe_cache = sf_response_cache_create((size_t) sf->describe_cache_size, 0, 0);
+            break;
         default:
             SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
                                 "Invalid attribute type",
@@ -1048,6 +1815,87 @@ SF_STATUS STDCALL snowflake_get_attribute(
         case SF_QUERY_RESULT_TYPE:
             *value = &sf->query_result_format;
             break;
+        case SF_CON_CHUNK_DOWNLOADER_THREADS:
+            *value = &sf->chunk_downloader_threads;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_FETCH_SLOTS:
+            *value = &sf->chunk_downloader_fetch_slots;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_MEMORY_LIMIT:
+            *value = &sf->chunk_downloader_memory_limit;
+            break;
+        case SF_CON_RESULT_CHUNK_SIZE:
+            *value = &sf->result_chunk_size;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_MULTIPLEX:
+            *value = &sf->chunk_downloader_multiplex;
+            break;
+        case SF_CON_CHUNK_STREAMING_DECODE:
+            *value = &sf->chunk_streaming_decode;
+            break;
+        case SF_CON_CHUNK_DOWNLOADER_HEDGING:
+            *value = &sf->chunk_downloader_hedging;
+            break;
+        case SF_CON_CHUNK_DECODER_INFLATE:
+            *value = &sf->chunk_decoder_inflate;
+            break;
+        case SF_CON_CHUNK_COMPRESSED_PREFETCH:
+            *value = &sf->chunk_compressed_prefetch;
+            break;
+        case SF_CON_JSON_TO_ARROW:
+            *value = &sf->json_to_arrow;
+            break;
+        case SF_CON_MEMORY_LIMIT:
+            *value = &sf->memory_budget.limit;
+            break;
+        case SF_CON_STATEMENT_MEMORY_LIMIT:
+            *value = &sf->statement_memory_limit;
+            break;
+        case SF_CON_CHUNK_SPILL_DIR:
+            *value = sf->chunk_spill_dir;
+            break;
+        case SF_CON_QUERY_PRIORITY:
+            *value = &sf->query_priority;
+            break;
+        case SF_CON_TOKEN_CACHE_DIR:
+            *value = sf->token_cache_dir;
+            break;
+        case SF_CON_QUERY_POLL_MIN_INTERVAL:
+            *value = &sf->query_poll_min_interval;
+            break;
+        case SF_CON_QUERY_POLL_MAX_INTERVAL:
+            *value = &sf->query_poll_max_interval;
+            break;
+        case SF_CON_RETRY_BACKOFF_BASE:
+            *value = &sf->retry_backoff_base;
+            break;
+        case SF_CON_RETRY_BACKOFF_CAP:
+            *value = &sf->retry_backoff_cap;
+            break;
+        case SF_CON_POLL_RETRY_BACKOFF_BASE:
+            *value = &sf->poll_retry_backoff_base;
+            break;
+        case SF_CON_POLL_RETRY_BACKOFF_CAP:
+            *value = &sf->poll_retry_backoff_cap;
+            break;
+        case SF_CON_CHUNK_RETRY_BACKOFF_BASE:
+            *value = &sf->chunk_retry_backoff_base;
+            break;
+        case SF_CON_CHUNK_RETRY_BACKOFF_CAP:
+            *value = &sf->chunk_retry_backoff_cap;
+            break;
+        case SF_CON_RETRY_BUDGET:
+            *value = &sf->retry_budget;
+            break;
+        case SF_CON_BACKGROUND_TOKEN_RENEWAL:
+            *value = &sf->background_token_renewal;
+            break;
+        case SF_CON_REQUEST_COMPRESSION_THRESHOLD:
+            *value = &sf->request_compression_threshold;
+            break;
+        case SF_CON_DESCRIBE_CACHE_SIZE:
+            *value = &sf->describe_cache_size;
+            break;
         default:
             SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
                                 "Invalid attribute type",
@@ -1065,12 +1913,14 @@ static void STDCALL _snowflake_stmt_desc_reset(SF_STMT *sfstmt) {
     int64 i = 0;
     if (sfstmt->desc) {
         /* column metadata */
-        for (i = 0; i < sfstmt->total_fieldcount; i++) {
+        for (i = 0; i < sfstmt->desc_count; i++) {
             SF_FREE(sfstmt->desc[i].name);
         }
         SF_FREE(sfstmt->desc);
     }
     sfstmt->desc = NULL;
+    sfstmt->desc_count = 0;
+    sfstmt->desc_fingerprint = 0;
 }
 
 /**
@@ -1133,19 +1983,55 @@ PARAM_TYPE STDCALL _snowflake_get_current_param_style(const SF_STMT *sfstmt)
 
     return ps->param_style;
 }
-/**
- * Helper function to initialize named parameter list
- *
- * @param name_list
- */
-static void STDCALL _snowflake_allocate_named_param_list(void ** name_list)
+void *STDCALL _snowflake_bind_value_at(const SF_BIND_INPUT *input, uint64 row)
 {
-    NamedParams *nparams = (NamedParams *)SF_CALLOC(1,sizeof(NamedParams));
-    nparams->name_list = SF_CALLOC(8, sizeof(void *));
-    nparams->allocd = 8;
-    nparams->used = 0;
-    *name_list = (void *)nparams;
-}
+    size_t size;
+
+    if (!input->value || row == 0)
+    {
+        return input->value;
+    }
+    switch (input->c_type)
+    {
+        case SF_C_TYPE_INT8:
+        case SF_C_TYPE_UINT8:
+            size = 1;
+            break;
+        case SF_C_TYPE_INT64:
+        case SF_C_TYPE_UINT64:
+            size = sizeof(int64);
+            break;
+        case SF_C_TYPE_FLOAT64:
+            size = sizeof(float64);
+            break;
+        case SF_C_TYPE_BOOLEAN:
+            size = sizeof(sf_bool);
+            break;
+        case SF_C_TYPE_NULL:
+            size = 0;
+            break;
+        default:
+            // strings and binaries are len bytes apart
+            size = input->len;
+            break;
+    }
+    return (char *) input->value + row * size;
+}
+
+/**
+ * Helper function to initialize named parameter list
+ *
+ * @param name_list
+ */
+static void STDCALL _snowflake_allocate_named_param_list(void ** name_list)
+{
+    NamedParams *nparams = (NamedParams *)SF_CALLOC(1,sizeof(NamedParams));
+    nparams->name_list = SF_CALLOC(8, sizeof(void *));
+    nparams->hashes = (uint64 *) SF_CALLOC(8, sizeof(uint64));
+    nparams->allocd = 8;
+    nparams->used = 0;
+    *name_list = (void *)nparams;
+}
 
 /**
  * Helper function to add names of named params to
@@ -1154,9 +2040,11 @@ static void STDCALL _snowflake_allocate_named_param_list(void ** name_list)
  * @params
  * name_list - pointer to struture holding the list of names of the params
  * name - the name to be added to the list
+ * hash - the hash of the name
  * cur_size - current size of the name list
  */
-static void STDCALL _snowflake_add_to_named_param_list(void *name_list, char * name, unsigned int cur_size)
+static void STDCALL _snowflake_add_to_named_param_list(void *name_list, char * name, uint64 hash,
+                                                       unsigned int cur_size)
 {
     NamedParams *nparams;
     if (!name_list)
@@ -1167,9 +2055,27 @@ static void STDCALL _snowflake_add_to_named_param_list(void *name_list, char * n
     if (cur_size == nparams->allocd)
     {
         nparams->name_list = SF_REALLOC(nparams->name_list,(2 * cur_size * sizeof(void *)));
+        nparams->hashes = (uint64 *) SF_REALLOC(nparams->hashes, 2 * cur_size * sizeof(uint64));
         nparams->allocd = 2 * cur_size;
     }
     nparams->name_list[cur_size] = (void *)name;
+    nparams->hashes[cur_size] = hash;
+}
+
+/**
+ * Makes room for count params in the param store and name list of a statement, so that
+ * binding an array of params grows them once
+ */
+static void STDCALL _snowflake_reserve_params(SF_STMT *sfstmt, size_t count)
+{
+    NamedParams *nparams = (NamedParams *) sfstmt->name_list;
+    sf_param_store_reserve(sfstmt->params, count);
+    if (nparams && nparams->allocd < count)
+    {
+        nparams->name_list = SF_REALLOC(nparams->name_list, count * sizeof(void *));
+        nparams->hashes = (uint64 *) SF_REALLOC(nparams->hashes, count * sizeof(uint64));
+        nparams->allocd = (unsigned int) count;
+    }
 }
 
 /**
@@ -1187,25 +2093,19 @@ static void STDCALL _snowflake_deallocate_named_param_list(void * name_list)
     }
     nparams = (NamedParams *)name_list;
     SF_FREE(nparams->name_list);
+    SF_FREE(nparams->hashes);
     SF_FREE(name_list);
 }
 
 /**
- * Resets SNOWFLAKE_STMT parameters.
+ * Releases the results of the last query of a statement, keeping the statement itself.
  *
  * @param sfstmt
  */
-static void STDCALL _snowflake_stmt_reset(SF_STMT *sfstmt) {
-
-    clear_snowflake_error(&sfstmt->error);
-
-    sb_strncpy(sfstmt->sfqid, SF_UUID4_LEN, "", sizeof(""));
-    sfstmt->request_id[0] = '\0';
-
-    if (sfstmt->sql_text) {
-        SF_FREE(sfstmt->sql_text); /* SQL */
-    }
-    sfstmt->sql_text = NULL;
+static void STDCALL _snowflake_stmt_results_reset(SF_STMT *sfstmt) {
+    // Stop the conversion first, its threads fetch from the results
+    sf_materializer_term((SF_MATERIALIZER *) sfstmt->materializer);
+    sfstmt->materializer = NULL;
 
     if (sfstmt->result_set) {
         rs_destroy(sfstmt->result_set, (QueryResultFormat_t *) sfstmt->qrf);
@@ -1216,20 +2116,92 @@ static void STDCALL _snowflake_stmt_reset(SF_STMT *sfstmt) {
         SF_FREE(sfstmt->qrf);
     }
     sfstmt->qrf = NULL;
+    sfstmt->rs_accessors = NULL;
 
-    if (_snowflake_get_current_param_style(sfstmt) == NAMED)
-    {
-        _snowflake_deallocate_named_param_list(sfstmt->name_list);
+    sfstmt->chunk_rowcount = -1;
+    sfstmt->total_rowcount = -1;
+    sfstmt->total_fieldcount = -1;
+    sfstmt->total_row_index = -1;
+    sfstmt->chunk_index = -1;
+    sfstmt->result_start_chunk = 0;
+    sfstmt->get_data_column = 0;
+
+    // Destroy chunk downloader
+    chunk_downloader_term(sfstmt->chunk_downloader);
+    sfstmt->chunk_downloader = NULL;
+
+    sf_scroll_cache_free((SF_SCROLL_CACHE *) sfstmt->scroll_cache);
+    sfstmt->scroll_cache = NULL;
+
+    if (sfstmt->put_get_response) {
+        // clean up put get response data
+        sf_put_get_response_deallocate(sfstmt->put_get_response);
+        sfstmt->put_get_response = NULL;
     }
+}
 
-    if (sfstmt->params) {
-        sf_param_store_deallocate(sfstmt->params);
+/**
+ * Resets SNOWFLAKE_STMT parameters.
+ *
+ * @param sfstmt
+ * @param keep_capacity set to keep the memory that the next query of the statement reuses:
+ *        the SQL text buffer, the param store and name list, the bind arena and the column
+ *        descriptors, which are kept if the next results have the same columns.
+ */
+static void STDCALL _snowflake_stmt_clear(SF_STMT *sfstmt, sf_bool keep_capacity) {
+
+    clear_snowflake_error(&sfstmt->error);
+
+    sb_strncpy(sfstmt->sfqid, SF_UUID4_LEN, "", sizeof(""));
+    sfstmt->request_id[0] = '\0';
+    memset(&sfstmt->trace, 0, sizeof(sfstmt->trace));
+    sfstmt->first_row_traced = SF_BOOLEAN_FALSE;
+
+    if (!keep_capacity) {
+        SF_FREE(sfstmt->sql_text); /* SQL */
+        sfstmt->sql_text = NULL;
+        sfstmt->sql_text_size = 0;
+    }
+
+    _snowflake_stmt_results_reset(sfstmt);
+    _snowflake_stmt_row_metadata_reset(sfstmt);
+
+    SF_FREE(sfstmt->multi_stmt_result_ids);
+    sfstmt->multi_stmt_result_ids = NULL;
+    sfstmt->multi_stmt_next_id = NULL;
+
+    if (keep_capacity && sfstmt->params) {
+        sf_param_store_clear(sfstmt->params);
+        if (sfstmt->name_list) {
+            ((NamedParams *) sfstmt->name_list)->used = 0;
+        }
+    } else {
+        if (_snowflake_get_current_param_style(sfstmt) == NAMED)
+        {
+            _snowflake_deallocate_named_param_list(sfstmt->name_list);
+        }
+
+        if (sfstmt->params) {
+            sf_param_store_deallocate(sfstmt->params);
+        }
+        sfstmt->params = NULL;
+        sfstmt->name_list = NULL;
     }
-    sfstmt->params = NULL;
     sfstmt->params_len = 0;
-    sfstmt->name_list = NULL;
 
-    _snowflake_stmt_desc_reset(sfstmt);
+    if (keep_capacity && sfstmt->bind_arena) {
+        sf_arena_reset((SF_ARENA *) sfstmt->bind_arena);
+    } else {
+        sf_arena_term((SF_ARENA *) sfstmt->bind_arena);
+        sfstmt->bind_arena = NULL;
+    }
+
+    bind_arrow_term((SF_ARROW_BINDS *) sfstmt->arrow_binds);
+    sfstmt->arrow_binds = NULL;
+
+    if (!keep_capacity) {
+        _snowflake_stmt_desc_reset(sfstmt);
+    }
 
     if (sfstmt->stmt_attrs) {
         sf_array_list_deallocate(sfstmt->stmt_attrs);
@@ -1238,20 +2210,37 @@ static void STDCALL _snowflake_stmt_reset(SF_STMT *sfstmt) {
 
     /* clear error handle */
     clear_snowflake_error(&sfstmt->error);
+}
 
-    sfstmt->chunk_rowcount = -1;
-    sfstmt->total_rowcount = -1;
-    sfstmt->total_fieldcount = -1;
-    sfstmt->total_row_index = -1;
+static void STDCALL _snowflake_stmt_reset(SF_STMT *sfstmt) {
+    _snowflake_stmt_clear(sfstmt, SF_BOOLEAN_FALSE);
+}
 
-    // Destroy chunk downloader
-    chunk_downloader_term(sfstmt->chunk_downloader);
-    sfstmt->chunk_downloader = NULL;
+/**
+ * Creates the param store of a statement for the style of the params about to be bound. The
+ * store left from the previous query is reused if the params have the same style.
+ */
+static void STDCALL _snowflake_init_param_store(SF_STMT *sfstmt, const SF_BIND_INPUT *input) {
+    PARAM_TYPE param_style = _snowflake_get_param_style(input);
 
-    if (sfstmt->put_get_response) {
-        // clean up put get response data
-        sf_put_get_response_deallocate(sfstmt->put_get_response);
-        sfstmt->put_get_response = NULL;
+    if (sfstmt->params && sfstmt->params_len == 0 &&
+        _snowflake_get_current_param_style(sfstmt) != param_style) {
+        if (_snowflake_get_current_param_style(sfstmt) == NAMED)
+        {
+            _snowflake_deallocate_named_param_list(sfstmt->name_list);
+        }
+        sf_param_store_deallocate(sfstmt->params);
+        sfstmt->params = NULL;
+        sfstmt->name_list = NULL;
+    }
+    if (sfstmt->params == NULL)
+    {
+        sf_param_store_init(param_style, &sfstmt->params);
+
+        if (_snowflake_get_current_param_style(sfstmt) == NAMED)
+        {
+            _snowflake_allocate_named_param_list(&sfstmt->name_list);
+        }
     }
 }
 
@@ -1297,6 +2286,288 @@ sf_put_get_response_deallocate(SF_PUT_GET_RESPONSE *put_get_response) {
 }
 
 
+SF_STATUS STDCALL snowflake_get_session_parameter(SF_CONNECT *sf, const char *name,
+                                                  char *buffer, size_t buffer_size) {
+    const cJSON *value;
+    SF_STATUS status = SF_STATUS_EOF;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!name || !buffer) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    _mutex_lock(&sf->mutex_parameters);
+    // Parameter names are looked up in any case
+    value = sf->session_parameters ?
+            snowflake_cJSON_GetObjectItem((cJSON *) sf->session_parameters, name) : NULL;
+    if (value && value->valuestring) {
+        if (strlen(value->valuestring) < buffer_size) {
+            sb_strcpy(buffer, buffer_size, value->valuestring);
+            status = SF_STATUS_SUCCESS;
+        } else {
+            status = SF_STATUS_ERROR_BUFFER_TOO_SMALL;
+        }
+    }
+    _mutex_unlock(&sf->mutex_parameters);
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_get_current_object(SF_CONNECT *sf, SF_ATTRIBUTE type,
+                                               char *buffer, size_t buffer_size) {
+    char **current;
+    SF_STATUS status = SF_STATUS_EOF;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!buffer) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    switch (type) {
+        case SF_CON_DATABASE:
+            current = &sf->database;
+            break;
+        case SF_CON_SCHEMA:
+            current = &sf->schema;
+            break;
+        case SF_CON_WAREHOUSE:
+            current = &sf->warehouse;
+            break;
+        case SF_CON_ROLE:
+            current = &sf->role;
+            break;
+        default:
+            SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
+                                "Only a database, schema, warehouse or role is current",
+                                SF_SQLSTATE_GENERAL_ERROR);
+            return SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE;
+    }
+    // The responses of the statements running on the connection replace the name meanwhile
+    _mutex_lock(&sf->mutex_parameters);
+    if (*current) {
+        if (strlen(*current) < buffer_size) {
+            sb_strcpy(buffer, buffer_size, *current);
+            status = SF_STATUS_SUCCESS;
+        } else {
+            status = SF_STATUS_ERROR_BUFFER_TOO_SMALL;
+        }
+    }
+    _mutex_unlock(&sf->mutex_parameters);
+    return status;
+}
+
+/**
+ * @return whether the value reads as a number, or a boolean, in a SQL statement.
+ */
+static sf_bool _snowflake_is_sql_literal(const char *value) {
+    const char *p = value;
+
+    if (sf_strncasecmp(value, "true", 5) == 0 || sf_strncasecmp(value, "false", 6) == 0) {
+        return SF_BOOLEAN_TRUE;
+    }
+    if (*p == '-') {
+        p++;
+    }
+    if (*p < '0' || *p > '9') {
+        return SF_BOOLEAN_FALSE;
+    }
+    while ((*p >= '0' && *p <= '9') || *p == '.') {
+        p++;
+    }
+    return *p == '\0' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Runs a statement that changes the session, its error being set on the connection.
+ */
+static SF_STATUS _snowflake_session_command(SF_CONNECT *sf, const char *command) {
+    SF_STATUS status;
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+
+    if (!sfstmt) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while creating a statement",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    status = snowflake_query(sfstmt, command, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        snowflake_propagate_error(sf, sfstmt);
+    }
+    snowflake_stmt_term(sfstmt);
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_set_session_parameter(SF_CONNECT *sf, const char *name,
+                                                  const char *value) {
+    const cJSON *current;
+    sf_bool same = SF_BOOLEAN_FALSE;
+    sf_bool literal;
+    char *command;
+    size_t size;
+    size_t len;
+    const char *p;
+    SF_STATUS status;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!name || !value) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    for (p = name; (*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') ||
+                   (*p >= '0' && *p <= '9') || *p == '_'; p++) {
+    }
+    if (p == name || *p != '\0') {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_REQUEST,
+                            "Invalid session parameter name", SF_SQLSTATE_GENERAL_ERROR);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    literal = _snowflake_is_sql_literal(value);
+
+    _mutex_lock(&sf->mutex_parameters);
+    current = sf->session_parameters ?
+              snowflake_cJSON_GetObjectItem((cJSON *) sf->session_parameters, name) : NULL;
+    if (current && current->valuestring) {
+        // Booleans are returned in lower case, strings have to be the same
+        same = (literal ? sf_strncasecmp(current->valuestring, value, strlen(value) + 1) :
+                strcmp(current->valuestring, value)) == 0 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+    _mutex_unlock(&sf->mutex_parameters);
+    if (same) {
+        return SF_STATUS_SUCCESS;
+    }
+
+    // The quotes and backslashes of a string are escaped
+    size = strlen(name) + strlen(value) * 2 + sizeof("alter session set  = ''");
+    if (!(command = (char *) SF_MALLOC(size))) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while setting a session parameter",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    sb_sprintf(command, size, "alter session set %s = ", name);
+    len = strlen(command);
+    if (literal) {
+        sb_strcpy(command + len, size - len, value);
+    } else {
+        command[len++] = '\'';
+        for (p = value; *p; p++) {
+            if (*p == '\'' || *p == '\\') {
+                command[len++] = '\\';
+            }
+            command[len++] = *p;
+        }
+        command[len++] = '\'';
+        command[len] = '\0';
+    }
+    status = _snowflake_session_command(sf, command);
+    SF_FREE(command);
+    if (status == SF_STATUS_SUCCESS) {
+        // Responses only have some of the parameters
+        _mutex_lock(&sf->mutex_parameters);
+        _cache_session_parameter(sf, name, value);
+        _mutex_unlock(&sf->mutex_parameters);
+    }
+    return status;
+}
+
+/**
+ * Compares the name of a current object, as the server returns it, with a name as it is
+ * written in SQL.
+ */
+static sf_bool _snowflake_same_identifier(const char *current, const char *name) {
+    size_t len = strlen(name);
+    const char *end;
+
+    if (!current) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (len >= 2 && name[0] == '"' && name[len - 1] == '"') {
+        // A quoted name is the text between the quotes, with its quotes doubled
+        for (name++, end = name + len - 2; name < end; name++, current++) {
+            if (*name == '"' && (++name >= end || *name != '"')) {
+                return SF_BOOLEAN_FALSE;
+            }
+            if (*current != *name) {
+                return SF_BOOLEAN_FALSE;
+            }
+        }
+        return *current == '\0' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    }
+    // An unquoted name is resolved in upper case
+    for (; *name; name++, current++) {
+        if (*current == '\0' || toupper((unsigned char) *name) != (unsigned char) *current) {
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+    return *current == '\0' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+SF_STATUS STDCALL snowflake_use_object(SF_CONNECT *sf, SF_ATTRIBUTE type, const char *name) {
+    const char *kind;
+    char **current;
+    char *command;
+    size_t size;
+    sf_bool same;
+    SF_STATUS status;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!name) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    switch (type) {
+        case SF_CON_DATABASE:
+            kind = "database";
+            current = &sf->database;
+            break;
+        case SF_CON_SCHEMA:
+            kind = "schema";
+            current = &sf->schema;
+            break;
+        case SF_CON_WAREHOUSE:
+            kind = "warehouse";
+            current = &sf->warehouse;
+            break;
+        case SF_CON_ROLE:
+            kind = "role";
+            current = &sf->role;
+            break;
+        default:
+            SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
+                                "Only a database, schema, warehouse or role can be used",
+                                SF_SQLSTATE_GENERAL_ERROR);
+            return SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE;
+    }
+
+    _mutex_lock(&sf->mutex_parameters);
+    same = _snowflake_same_identifier(*current, name);
+    _mutex_unlock(&sf->mutex_parameters);
+    if (same) {
+        return SF_STATUS_SUCCESS;
+    }
+
+    size = strlen(name) + sizeof("use warehouse ");
+    if (!(command = (char *) SF_MALLOC(size))) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while switching the current object",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    sb_sprintf(command, size, "use %s %s", kind, name);
+    // The current objects are updated from the response
+    status = _snowflake_session_command(sf, command);
+    SF_FREE(command);
+    return status;
+}
+
 SF_STMT *STDCALL snowflake_stmt(SF_CONNECT *sf) {
     if (!sf) {
         return NULL;
@@ -1306,7 +2577,23 @@ SF_STMT *STDCALL snowflake_stmt(SF_CONNECT *sf) {
     if (sfstmt) {
         _snowflake_stmt_reset(sfstmt);
         sfstmt->connection = sf;
-
+        sfstmt->chunk_downloader_threads = sf->chunk_downloader_threads;
+        sfstmt->chunk_downloader_fetch_slots = sf->chunk_downloader_fetch_slots;
+        sfstmt->chunk_downloader_memory_limit = sf->chunk_downloader_memory_limit;
+        sfstmt->result_chunk_size = sf->result_chunk_size;
+        sfstmt->chunk_downloader_multiplex = sf->chunk_downloader_multiplex;
+        sfstmt->chunk_streaming_decode = sf->chunk_streaming_decode;
+        sfstmt->chunk_downloader_hedging = sf->chunk_downloader_hedging;
+        sfstmt->chunk_decoder_inflate = sf->chunk_decoder_inflate;
+        sfstmt->chunk_compressed_prefetch = sf->chunk_compressed_prefetch;
+        sfstmt->json_to_arrow = sf->json_to_arrow;
+        sfstmt->query_priority = sf->query_priority;
+        sfstmt->paramset_size = 1;
+        sfstmt->bind_upload_threshold = SF_DEFAULT_BIND_UPLOAD_THRESHOLD;
+        sfstmt->multi_stmt_count = 1;
+        sfstmt->scroll_cache_memory_limit = SF_DEFAULT_SCROLL_CACHE_MEMORY_LIMIT;
+        sf_memory_budget_init(&sfstmt->memory_budget, sf->statement_memory_limit,
+                              &sf->memory_budget);
     }
     return sfstmt;
 }
@@ -1323,6 +2610,7 @@ void STDCALL snowflake_query_result_capture_init(SF_QUERY_RESULT_CAPTURE **init)
 
     capture->capture_buffer = NULL;
     capture->actual_response_size = 0;
+    capture->capture_only = SF_BOOLEAN_FALSE;
 
     *init = capture;
 }
@@ -1364,6 +2652,9 @@ void STDCALL snowflake_query_result_capture_term(SF_QUERY_RESULT_CAPTURE *captur
 void STDCALL snowflake_stmt_term(SF_STMT *sfstmt) {
     if (sfstmt) {
         _snowflake_stmt_reset(sfstmt);
+        SF_FREE(sfstmt->bound_columns);
+        SF_FREE(sfstmt->query_result_format);
+        SF_FREE(sfstmt->query_parameters);
         SF_FREE(sfstmt);
     }
 }
@@ -1372,23 +2663,23 @@ SF_STATUS STDCALL snowflake_bind_param(
     SF_STMT *sfstmt, SF_BIND_INPUT *sfbind) {
 
     SF_INT_RET_CODE retcode;
+    uint64 hash = 0;
     if (!sfstmt) {
         return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
     clear_snowflake_error(&sfstmt->error);
 
-    if (sfstmt->params == NULL)
-    {
-        sf_param_store_init(_snowflake_get_param_style(sfbind),
-                            &sfstmt->params);
+    _snowflake_init_param_store(sfstmt, sfbind);
 
-        if (_snowflake_get_current_param_style(sfstmt) == NAMED)
-        {
-            _snowflake_allocate_named_param_list(&sfstmt->name_list);
-        }
+    if (_snowflake_get_current_param_style(sfstmt) == NAMED && sfbind->name)
+    {
+        hash = sf_hashmap_hash(sfbind->name);
+        retcode = sf_param_store_set_named(sfstmt->params, sfbind, sfbind->name, hash);
+    }
+    else
+    {
+        retcode = sf_param_store_set(sfstmt->params, sfbind, sfbind->idx, sfbind->name);
     }
-
-    retcode = sf_param_store_set(sfstmt->params, sfbind, sfbind->idx, sfbind->name);
     if (retcode == SF_INT_RET_CODE_DUPLICATES)
     {
         return SF_STATUS_SUCCESS;
@@ -1399,13 +2690,13 @@ SF_STATUS STDCALL snowflake_bind_param(
     }
     /*
      * For named parameters, populate the name list in the
-     * sfstmt to help extract the params from the treemap
+     * sfstmt to help extract the params from the hash map
      * during execute
      */
     if (_snowflake_get_current_param_style(sfstmt) == NAMED)
     {
         _snowflake_add_to_named_param_list(sfstmt->name_list,
-                sfbind->name, sfstmt->params_len);
+                sfbind->name, hash, sfstmt->params_len);
     }
 
     sfstmt->params_len += 1;
@@ -1417,26 +2708,28 @@ SF_STATUS snowflake_bind_param_array(
     SF_STMT *sfstmt, SF_BIND_INPUT *sfbind_array, size_t size) {
     size_t i;
     SF_INT_RET_CODE retcode = SF_INT_RET_CODE_ERROR;
+    uint64 hash = 0;
 
     if (!sfstmt) {
         return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
     clear_snowflake_error(&sfstmt->error);
-    if (sfstmt->params == NULL)
-    {
-        sf_param_store_init(_snowflake_get_param_style(&sfbind_array[0]),
-                            &sfstmt->params);
-
-        if (_snowflake_get_current_param_style(sfstmt) == NAMED)
-        {
-            _snowflake_allocate_named_param_list(&sfstmt->name_list);
-        }
-    }
+    _snowflake_init_param_store(sfstmt, &sfbind_array[0]);
+    _snowflake_reserve_params(sfstmt, sfstmt->params_len + size);
 
     for (i = 0; i < size; i++)
     {
-        retcode = sf_param_store_set(sfstmt->params, &sfbind_array[i],
-                sfbind_array[i].idx, sfbind_array[i].name);
+        if (_snowflake_get_current_param_style(sfstmt) == NAMED && sfbind_array[i].name)
+        {
+            hash = sf_hashmap_hash(sfbind_array[i].name);
+            retcode = sf_param_store_set_named(sfstmt->params, &sfbind_array[i],
+                    sfbind_array[i].name, hash);
+        }
+        else
+        {
+            retcode = sf_param_store_set(sfstmt->params, &sfbind_array[i],
+                    sfbind_array[i].idx, sfbind_array[i].name);
+        }
 
         if (retcode == SF_INT_RET_CODE_DUPLICATES)
         {
@@ -1449,13 +2742,13 @@ SF_STATUS snowflake_bind_param_array(
 
         /*
          * For named parameters, populate the name list in the
-         * sfstmt to help extract the params from the treemap
+         * sfstmt to help extract the params from the hash map
          * during execute
          */
         if (_snowflake_get_current_param_style(sfstmt) == NAMED)
         {
             _snowflake_add_to_named_param_list(sfstmt->name_list,
-                    sfbind_array[i].name, sfstmt->params_len);
+                    sfbind_array[i].name, hash, sfstmt->params_len);
         }
 
         sfstmt->params_len += 1;
@@ -1464,6 +2757,39 @@ SF_STATUS snowflake_bind_param_array(
     return SF_STATUS_SUCCESS;
 }
 
+SF_STATUS STDCALL snowflake_bind_arrow(SF_STMT *sfstmt, struct ArrowArray *array,
+                                       struct ArrowSchema *schema) {
+    SF_ARROW_BINDS *binds;
+    const char *error = NULL;
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    if (sfstmt->params) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "An Arrow batch can't be bound with other parameters",
+                                 SF_SQLSTATE_FUNCTION_SEQUENCE_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    binds = bind_arrow_create(array, schema, &error);
+    if (!binds) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST, error,
+                                 SF_SQLSTATE_INVALID_DATA_TYPE, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    if (binds->row_count <= 0) {
+        bind_arrow_term(binds);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "The Arrow batch has no rows to bind",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    bind_arrow_term((SF_ARROW_BINDS *) sfstmt->arrow_binds);
+    sfstmt->arrow_binds = binds;
+    return SF_STATUS_SUCCESS;
+}
+
 SF_STATUS STDCALL snowflake_query(
     SF_STMT *sfstmt, const char *command, size_t command_size) {
     if (!sfstmt) {
@@ -1481,1241 +2807,4056 @@ SF_STATUS STDCALL snowflake_query(
     return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_fetch(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+/**
+ * @return the budget the memory of a statement is charged to, NULL if neither the statement
+ *         nor its connection has a memory limit.
+ */
+static SF_MEMORY_BUDGET *STDCALL _snowflake_memory_budget(SF_STMT *sfstmt) {
+    if (!sfstmt->memory_budget.limit && !sfstmt->connection->memory_budget.limit) {
+        return NULL;
     }
+    return &sfstmt->memory_budget;
+}
 
-    clear_snowflake_error(&sfstmt->error);
-    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
-    sf_bool get_chunk_success = SF_BOOLEAN_TRUE;
+/**
+ * @return the index, as in snowflake_chunk_index(), of the first chunk of the chunk downloader.
+ */
+static int64 STDCALL _snowflake_first_chunk_index(SF_STMT *sfstmt) {
+    return sfstmt->result_start_chunk > 0 ? sfstmt->result_start_chunk : 1;
+}
+
+/**
+ * Drops the rows before the chunk the results start at, those of the response and those of the
+ * chunks before it in the list of chunks.
+ *
+ * @return SF_BOOLEAN_FALSE if the results have no chunk of that index, the error is set in
+ *         the statement.
+ */
+static sf_bool STDCALL _snowflake_skip_chunks(SF_STMT *sfstmt, cJSON **rowset, cJSON *chunks) {
+    int64 i;
+    int64 chunk_count = chunks ? snowflake_cJSON_GetArraySize(chunks) : 0;
+
+    if (sfstmt->result_start_chunk > chunk_count) {
+        log_error("Results of query %s have %lld chunks, can't start at chunk %lld",
+                  sfstmt->sfqid, (long long) chunk_count, (long long) sfstmt->result_start_chunk);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "The results have no chunk of that index",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_BOOLEAN_FALSE;
+    }
+
+    snowflake_cJSON_Delete(*rowset);
+    *rowset = ARROW_FORMAT == *((QueryResultFormat_t *) sfstmt->qrf) ?
+              snowflake_cJSON_CreateString("") : snowflake_cJSON_CreateArray();
+    for (i = 1; i < sfstmt->result_start_chunk; i++) {
+        snowflake_cJSON_DeleteItemFromArray(chunks, 0);
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+static SF_STATUS STDCALL _snowflake_next_chunk(SF_STMT *sfstmt);
+static SF_STATUS STDCALL _snowflake_get_query_result(SF_STMT *sfstmt, const char *query_id,
+                                                     sf_bool is_multi_stmt_child);
+
+/**
+ * Sets up the cache of the chunks of a scrollable statement once the first chunk of its
+ * results is in the result set. Without it the results are only fetched forward.
+ */
+static void STDCALL _snowflake_scroll_cache_init(SF_STMT *sfstmt) {
+    SF_CHUNK_DOWNLOADER *chunk_downloader = sfstmt->chunk_downloader;
+    SF_SCROLL_CACHE *cache;
+    int64 chunk_count = 1 + (chunk_downloader ? (int64) chunk_downloader->queue_size : 0);
+    int64 *row_counts;
+    int64 i;
+
+    // A restart at a chunk keeps the cache of the first fetch
+    if (!sfstmt->scrollable || sfstmt->scroll_cache || sfstmt->result_start_chunk > 0 ||
+        sfstmt->unordered_fetch) {
+        return;
+    }
+    row_counts = (int64 *) SF_CALLOC(chunk_count, sizeof(int64));
+    if (!row_counts) {
+        log_warn("Out of memory for the scroll cache of query %s", sfstmt->sfqid);
+        return;
+    }
+    row_counts[0] = sfstmt->chunk_rowcount > 0 ? sfstmt->chunk_rowcount : 0;
+    for (i = 1; i < chunk_count; i++) {
+        row_counts[i] = chunk_downloader->queue[i - 1].row_count;
+    }
+    cache = sf_scroll_cache_create(row_counts, chunk_count, sfstmt->scroll_cache_memory_limit,
+                                   sfstmt->scroll_cache_disk_limit,
+                                   sfstmt->connection->chunk_spill_dir);
+    SF_FREE(row_counts);
+    if (!cache) {
+        log_warn("Out of memory for the scroll cache of query %s", sfstmt->sfqid);
+        return;
+    }
+    cache->current = 0;
+    sfstmt->scroll_cache = cache;
+}
+
+/**
+ * @return the index of the first chunk of the results not fetched yet, the chunks before it
+ *         can be scrolled back to.
+ */
+static int64 STDCALL _snowflake_scroll_fetched(SF_STMT *sfstmt) {
+    if (!sfstmt->chunk_downloader) {
+        return ((SF_SCROLL_CACHE *) sfstmt->scroll_cache)->chunk_count;
+    }
+    return (int64) sfstmt->chunk_downloader->scan_head + _snowflake_first_chunk_index(sfstmt);
+}
+
+/**
+ * Keeps the JSON chunk of the result set in the scroll cache before the result set moves on
+ * from it.
+ */
+static void STDCALL _snowflake_scroll_keep_current(SF_STMT *sfstmt) {
+    SF_SCROLL_CACHE *cache = (SF_SCROLL_CACHE *) sfstmt->scroll_cache;
+
+    if (cache && cache->current >= 0 && sfstmt->result_set &&
+        *((QueryResultFormat_t *) sfstmt->qrf) == JSON_FORMAT) {
+        sf_scroll_cache_put(cache, cache->current,
+                            rs_json_get_chunk((rs_json_t *) sfstmt->result_set));
+    }
+}
+
+/**
+ * Fetches the results of the query again from a chunk on, for a chunk the scroll cache
+ * doesn't keep. The query isn't run again, its results are fetched by its id. The statement
+ * is left before the chunk, or in it for the first chunk, which comes with the response.
+ */
+static SF_STATUS STDCALL _snowflake_scroll_restart(SF_STMT *sfstmt, int64 index) {
+    SF_SCROLL_CACHE *cache = (SF_SCROLL_CACHE *) sfstmt->scroll_cache;
+    char qid[SF_UUID4_LEN];
+    SF_STATUS ret;
+
+    log_debug("Fetching the results of query %s again from chunk %lld",
+              sfstmt->sfqid, (long long) index);
+    sb_strncpy(qid, SF_UUID4_LEN, sfstmt->sfqid, SF_UUID4_LEN);
+    // The cache outlives the results it was filled from
+    sfstmt->scroll_cache = NULL;
+    _snowflake_stmt_results_reset(sfstmt);
+    sfstmt->result_start_chunk = index;
+    ret = _snowflake_get_query_result(sfstmt, qid, SF_BOOLEAN_TRUE);
+    sf_scroll_cache_free((SF_SCROLL_CACHE *) sfstmt->scroll_cache);
+    sfstmt->scroll_cache = cache;
+    if (ret != SF_STATUS_SUCCESS) {
+        cache->current = -1;
+        return ret;
+    }
+
+    sfstmt->total_row_index = cache->row_starts[index];
+    if (index > 0) {
+        sfstmt->chunk_index = index - 1;
+        cache->current = -1;
+    } else {
+        cache->current = 0;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Makes a chunk fetched before the current one of the result set, positioned before its
+ * first row, from the scroll cache or from the server.
+ */
+static SF_STATUS STDCALL _snowflake_scroll_load(SF_STMT *sfstmt, int64 index) {
+    SF_SCROLL_CACHE *cache = (SF_SCROLL_CACHE *) sfstmt->scroll_cache;
+    SF_JSON_ROWSET *rowset;
+    SF_STATUS ret;
+
+    _snowflake_scroll_keep_current(sfstmt);
+    if ((rowset = sf_scroll_cache_get(cache, index)) == NULL) {
+        if ((ret = _snowflake_scroll_restart(sfstmt, index)) != SF_STATUS_SUCCESS || index == 0) {
+            return ret;
+        }
+        return _snowflake_next_chunk(sfstmt);
+    }
+
+    log_debug("Reading chunk %lld back from the scroll cache", (long long) index);
+    if (sfstmt->result_set == NULL) {
+        sfstmt->result_set = rs_create_with_chunk(rowset, sfstmt->desc,
+                                                  (QueryResultFormat_t *) sfstmt->qrf,
+                                                  sfstmt->connection->timezone);
+    } else {
+        rs_append_chunk(sfstmt->result_set, (QueryResultFormat_t *) sfstmt->qrf, rowset);
+    }
+    sfstmt->chunk_index = index;
+    sfstmt->chunk_rowcount = cache->row_starts[index + 1] - cache->row_starts[index];
+    sfstmt->total_row_index = cache->row_starts[index];
+    cache->current = index;
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Moves the result set on to the next chunk of the chunk downloader.
+ *
+ * @return 0 if success, SF_STATUS_EOF if no chunks are left, otherwise an
+ *         errno is returned and the error is set in the statement.
+ */
+static SF_STATUS STDCALL _snowflake_next_chunk(SF_STMT *sfstmt) {
+    void *chunk = NULL;
     uint64 index;
+    uint64 decode_start;
+    SF_TRACE_SPAN span;
 
-    // Check for chunk_downloader error
-    if (sfstmt->chunk_downloader && get_error(sfstmt->chunk_downloader)) {
-        goto cleanup;
+    if (sfstmt->scroll_cache &&
+        sfstmt->chunk_index + 1 < _snowflake_scroll_fetched(sfstmt)) {
+        // Scrolled back, the next chunk was fetched already
+        return _snowflake_scroll_load(sfstmt, sfstmt->chunk_index + 1);
     }
 
-    // If no more results, set return to SF_STATUS_EOF
-    if (sfstmt->chunk_rowcount == 0) {
-        if (sfstmt->chunk_downloader) {
-            log_debug("Fetching next chunk from chunk downloader.");
-            _critical_section_lock(&sfstmt->chunk_downloader->queue_lock);
-            do {
-                if (sfstmt->chunk_downloader->consumer_head >=
-                    sfstmt->chunk_downloader->queue_size) {
-                    // No more chunks, set EOL and break
-                    log_debug("Out of chunks, setting EOL.");
-                    ret = SF_STATUS_EOF;
-                    break;
-                } else {
-                    // Get index and increment
-                    index = sfstmt->chunk_downloader->consumer_head;
-                    while (
-                        sfstmt->chunk_downloader->queue[index].chunk == NULL &&
-                        !get_shutdown_or_error(
-                            sfstmt->chunk_downloader)) {
-                        _cond_wait(
-                            &sfstmt->chunk_downloader->consumer_cond,
-                            &sfstmt->chunk_downloader->queue_lock);
-                    }
-
-                    if (get_error(sfstmt->chunk_downloader)) {
-                        get_chunk_success = SF_BOOLEAN_FALSE;
-                        break;
-                    } else if (get_shutdown(sfstmt->chunk_downloader)) {
-                        get_chunk_success = SF_BOOLEAN_FALSE;
-                        break;
-                    }
-
-                    sfstmt->chunk_downloader->consumer_head++;
-
-                    // Set the new chunk, which will internally free the previous chunk appended.
-                    // If result set object doesn't exist yet, then create it.
-                    if (sfstmt->result_set == NULL) {
-                        sfstmt->result_set = rs_create_with_chunk(
-                            sfstmt->chunk_downloader->queue[index].chunk,
-                            sfstmt->desc,
-                            (QueryResultFormat_t *) sfstmt->qrf,
-                            sfstmt->connection->timezone);
-                    } else {
-                        rs_append_chunk(
-                            sfstmt->result_set,
-                            (QueryResultFormat_t *) sfstmt->qrf,
-                            sfstmt->chunk_downloader->queue[index].chunk);
-                    }
-
-                    // Remove chunk reference from locked array
-                    sfstmt->chunk_downloader->queue[index].chunk = NULL;
-                    sfstmt->chunk_rowcount = sfstmt->chunk_downloader->queue[index].row_count;
-                    log_debug("Acquired chunk %llu from chunk downloader",
-                              index);
-                    if (_cond_signal(
-                        &sfstmt->chunk_downloader->producer_cond)) {
-                        SET_SNOWFLAKE_ERROR(&sfstmt->error,
-                                            SF_STATUS_ERROR_PTHREAD,
-                                            "Unable to send signal using produce_cond",
-                                            "");
-                        get_chunk_success = SF_BOOLEAN_FALSE;
-                        break;
-                    }
-                }
+    if (!sfstmt->chunk_downloader) {
+        // If there is no chunk downloader set, then we've truly reached the end of the results and should set EOL
+        log_debug("No chunk downloader set, end of results.");
+        return SF_STATUS_EOF;
+    }
+
+    log_debug("Fetching next chunk from chunk downloader.");
+    if (!chunk_downloader_next_chunk(sfstmt->chunk_downloader,
+                                     sfstmt->unordered_fetch,
+                                     &index, &chunk)) {
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    if (chunk == NULL) {
+        // No more chunks, set EOL
+        log_debug("Out of chunks, setting EOL.");
+        return SF_STATUS_EOF;
+    }
+
+    _snowflake_scroll_keep_current(sfstmt);
+    decode_start = sf_monotonic_time_ms();
+    // Set the new chunk, which will internally free the previous chunk appended.
+    // If result set object doesn't exist yet, then create it.
+    if (sfstmt->result_set == NULL) {
+        sfstmt->result_set = rs_create_with_chunk(
+            chunk,
+            sfstmt->desc,
+            (QueryResultFormat_t *) sfstmt->qrf,
+            sfstmt->connection->timezone);
+    } else {
+        rs_append_chunk(
+            sfstmt->result_set,
+            (QueryResultFormat_t *) sfstmt->qrf,
+            chunk);
+    }
+    sfstmt->chunk_downloader->queue[index].stats.decode_ms +=
+        sf_monotonic_time_ms() - decode_start;
+    // On the downloader threads and here
+    sf_metric_record(SF_HISTOGRAM_CHUNK_DECODE_TIME,
+                     sfstmt->chunk_downloader->queue[index].stats.decode_ms * 1000);
+
+    sfstmt->chunk_rowcount = sfstmt->chunk_downloader->queue[index].row_count;
+    sfstmt->chunk_index = (int64) index + _snowflake_first_chunk_index(sfstmt);
+    if (sfstmt->scroll_cache) {
+        ((SF_SCROLL_CACHE *) sfstmt->scroll_cache)->current = sfstmt->chunk_index;
+    }
+    sf_span_start_child(&span, "chunk.decode", &sfstmt->trace,
+                        sf_monotonic_time_ms() - decode_start);
+    span.chunk_index = sfstmt->chunk_index;
+    span.bytes = (int64) sfstmt->chunk_downloader->queue[index].stats.bytes;
+    sf_span_end(&span, SF_STATUS_SUCCESS);
+    log_debug("Acquired chunk %llu from chunk downloader",
+              index);
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Moves to the next row, without writing the bound columns.
+ */
+static SF_STATUS STDCALL _snowflake_fetch_row(SF_STMT *sfstmt) {
+    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+    SF_MATERIALIZER *materializer = (SF_MATERIALIZER *) sfstmt->materializer;
+
+    if (materializer) {
+        // The rows come converted from the materializer threads
+        if ((ret = sf_materializer_next(materializer)) != SF_STATUS_SUCCESS) {
+            goto cleanup;
+        }
+        sfstmt->chunk_index = materializer->current->chunk_index;
+        sfstmt->chunk_rowcount = materializer->current->row_count - materializer->current_row - 1;
+    } else {
+        // Check for chunk_downloader error
+        if (sfstmt->chunk_downloader && get_error(sfstmt->chunk_downloader)) {
+            goto cleanup;
+        }
+
+        // If no more results, set return to SF_STATUS_EOF
+        if (sfstmt->chunk_rowcount == 0) {
+            // If we've reached the end, or we have an error getting the next chunk, goto cleanup and return status
+            if ((ret = _snowflake_next_chunk(sfstmt)) != SF_STATUS_SUCCESS) {
+                goto cleanup;
             }
-            while (0);
-            _critical_section_unlock(&sfstmt->chunk_downloader->queue_lock);
-        } else {
-            // If there is no chunk downloader set, then we've truly reached the end of the results and should set EOL
-            log_debug("No chunk downloader set, end of results.");
-            ret = SF_STATUS_EOF;
         }
 
-        // If we've reached the end, or we have an error getting the next chunk, goto cleanup and return status
-        if (ret == SF_STATUS_EOF || !get_chunk_success) {
+        // Get next result row. A streamed chunk ends early if its download failed.
+        if (_snowflake_next(sfstmt) != SF_STATUS_SUCCESS &&
+            sfstmt->chunk_downloader && get_error(sfstmt->chunk_downloader)) {
             goto cleanup;
         }
+        sfstmt->chunk_rowcount--;
     }
-
-    // Get next result row
-    _snowflake_next(sfstmt);
-    sfstmt->chunk_rowcount--;
     sfstmt->total_row_index++;
     ret = SF_STATUS_SUCCESS;
 
+    if (!sfstmt->first_row_traced) {
+        SF_TRACE_SPAN span;
+        sfstmt->first_row_traced = SF_BOOLEAN_TRUE;
+        sf_span_start_child(&span, "query.first_row", &sfstmt->trace, 0);
+        span.start_time_ns = sfstmt->trace_start_ns;
+        sf_span_end(&span, SF_STATUS_SUCCESS);
+    }
+
 cleanup:
     return ret;
 }
 
-static SF_STATUS STDCALL
-_snowflake_internal_query(SF_CONNECT *sf, const char *sql) {
-    if (!sf) {
-        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
-    }
+static SF_STATUS STDCALL _snowflake_write_bound_columns(SF_STMT *sfstmt, size_t row);
+static SF_STATUS STDCALL _snowflake_materialized_unsupported(SF_STMT *sfstmt);
+
+SF_STATUS STDCALL snowflake_fetch(SF_STMT *sfstmt) {
     SF_STATUS ret;
-    SF_STMT *sfstmt = snowflake_stmt(sf);
-    if (sfstmt == NULL) {
-        ret = SF_STATUS_ERROR_OUT_OF_MEMORY;
-        SET_SNOWFLAKE_ERROR(
-            &sf->error,
-            SF_STATUS_ERROR_OUT_OF_MEMORY,
-            "Out of memory in creating SF_STMT. ",
-            SF_SQLSTATE_UNABLE_TO_CONNECT);
-        goto error;
-    }
-    ret = snowflake_query(sfstmt, sql, 0);
-    if (ret != SF_STATUS_SUCCESS) {
-        snowflake_propagate_error(sf, sfstmt);
-        goto error;
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
 
-error:
-    snowflake_stmt_term(sfstmt);
+    clear_snowflake_error(&sfstmt->error);
+    ret = _snowflake_fetch_row(sfstmt);
+    if (ret == SF_STATUS_SUCCESS && sfstmt->bound_column_count > 0) {
+        ret = _snowflake_write_bound_columns(sfstmt, 0);
+    }
     return ret;
 }
 
-SF_STATUS STDCALL snowflake_trans_begin(SF_CONNECT *sf) {
-    return _snowflake_internal_query(sf, _SF_STMT_SQL_BEGIN);
-}
-
-SF_STATUS STDCALL snowflake_trans_commit(SF_CONNECT *sf) {
-    return _snowflake_internal_query(sf, _SF_STMT_SQL_COMMIT);
+SF_STATUS STDCALL snowflake_fetch_cancel(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    // The chunk downloader is only stopped here, it is released with the results
+    if (sfstmt->chunk_downloader) {
+        log_debug("Cancelling the fetch of the results of query %s", sfstmt->sfqid);
+        chunk_downloader_cancel(sfstmt->chunk_downloader);
+    }
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_trans_rollback(SF_CONNECT *sf) {
-    return _snowflake_internal_query(sf, _SF_STMT_SQL_ROLLBACK);
-}
+/**
+ * Skips the chunks after the current one that hold no more rows than the given number,
+ * by the row counts of the chunk downloader.
+ *
+ * @return the number of rows skipped.
+ */
+static int64 STDCALL _snowflake_skip_whole_chunks(SF_STMT *sfstmt, int64 rows) {
+    SF_CHUNK_DOWNLOADER *chunk_downloader = sfstmt->chunk_downloader;
+    uint64 until = chunk_downloader->scan_head;
+    uint64 index;
+    int64 skipped = 0;
+    void *chunk;
 
-int64 STDCALL snowflake_affected_rows(SF_STMT *sfstmt) {
-    size_t i;
-    int64 ret = -1;
-    cJSON *row = NULL;
-    cJSON *raw_row_result;
-    clear_snowflake_error(&sfstmt->error);
-    if (!sfstmt) {
-        /* no way to set the error other than return value */
-        return ret;
+    while (until < chunk_downloader->queue_size &&
+           skipped + chunk_downloader->queue[until].row_count <= rows) {
+        skipped += chunk_downloader->queue[until++].row_count;
     }
+    if (until == chunk_downloader->scan_head) {
+        return 0;
+    }
+    log_debug("Skipping chunks %llu to %llu", chunk_downloader->scan_head, until - 1);
+    _snowflake_scroll_keep_current(sfstmt);
+    if (sfstmt->scroll_cache) {
+        ((SF_SCROLL_CACHE *) sfstmt->scroll_cache)->current = -1;
+    }
+    chunk_downloader_skip(chunk_downloader, until - chunk_downloader->scan_head);
 
-    if (sfstmt->is_dml == SF_BOOLEAN_TRUE) {
-        if (SF_STATUS_SUCCESS != snowflake_fetch(sfstmt))
-        {
+    // Drop the chunks that were downloaded already
+    while (chunk_downloader->scan_head < until) {
+        if (!chunk_downloader_next_chunk(chunk_downloader, SF_BOOLEAN_FALSE, &index, &chunk)) {
             return -1;
         }
-        int64 total = 0;
-        for (int i = 1; i <= sfstmt->total_fieldcount; ++i) {
-            int64 field = 0;
-            if (SF_STATUS_SUCCESS != snowflake_column_as_int64(sfstmt, i, &field))
-            {
-                return -1;
-            }
-            total += field;
+        if (chunk == NULL) {
+            break;
+        }
+        if (*((QueryResultFormat_t *) sfstmt->qrf) == JSON_FORMAT) {
+            sf_json_rowset_free((SF_JSON_ROWSET *) chunk);
+        } else if (sfstmt->result_set == NULL) {
+            // Arrow chunks are only released by the result set
+            sfstmt->result_set = rs_create_with_chunk(chunk, sfstmt->desc,
+                                                      (QueryResultFormat_t *) sfstmt->qrf,
+                                                      sfstmt->connection->timezone);
+        } else {
+            rs_append_chunk(sfstmt->result_set, (QueryResultFormat_t *) sfstmt->qrf, chunk);
         }
-        return total;
-    }
-    else {
-        return sfstmt->total_rowcount;
     }
+    sfstmt->chunk_index = (int64) until - 1 + _snowflake_first_chunk_index(sfstmt);
+    sfstmt->total_row_index += skipped;
+    return skipped;
 }
 
-SF_STATUS STDCALL
-snowflake_prepare(SF_STMT *sfstmt, const char *command, size_t command_size) {
+SF_STATUS STDCALL snowflake_seek(SF_STMT *sfstmt, int64 row_index) {
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+    int64 rows;
+    int64 skipped;
+    size_t run;
+
     if (!sfstmt) {
         return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
     clear_snowflake_error(&sfstmt->error);
-    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
-    size_t sql_text_size = 1; // Don't forget about null terminator
-    if (!command) {
-        goto cleanup;
-    }
-    _snowflake_stmt_reset(sfstmt);
-    // Set sql_text to command
-    if (command_size == 0) {
-        log_debug("Command size is 0, using to strlen to find query length.");
-        sql_text_size += strlen(command);
-    } else {
-        log_debug("Command size non-zero, setting as sql text size.");
-        sql_text_size += command_size;
-    }
-    sfstmt->sql_text = (char *) SF_CALLOC(1, sql_text_size);
-    sb_memcpy(sfstmt->sql_text, sql_text_size, command, sql_text_size - 1);
-    // Null terminate
-    sfstmt->sql_text[sql_text_size - 1] = '\0';
+    if (row_index < sfstmt->total_row_index) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "Cannot seek back to a row that was fetched already",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+
+    rows = row_index - sfstmt->total_row_index;
+    while (rows > 0) {
+        if (sfstmt->chunk_rowcount == 0 && sfstmt->chunk_downloader && !sfstmt->unordered_fetch) {
+            if ((skipped = _snowflake_skip_whole_chunks(sfstmt, rows)) < 0) {
+                return SF_STATUS_ERROR_GENERAL;
+            }
+            if ((rows -= skipped) == 0) {
+                break;
+            }
+        }
 
-    ret = SF_STATUS_SUCCESS;
+        if ((ret = _snowflake_fetch_row(sfstmt)) != SF_STATUS_SUCCESS) {
+            break;
+        }
+        rows--;
 
-cleanup:
+        // The rest of the current record batch, within the chunk
+        run = rs_get_rows_left_in_batch(sfstmt->result_set, sfstmt->qrf);
+        run = run > 0 ? run - 1 : 0;
+        if (run > (size_t) sfstmt->chunk_rowcount) {
+            run = (size_t) sfstmt->chunk_rowcount;
+        }
+        if (run > (size_t) rows) {
+            run = (size_t) rows;
+        }
+        if (run > 0) {
+            rs_skip_rows(sfstmt->result_set, sfstmt->qrf, run);
+            sfstmt->chunk_rowcount -= (int64) run;
+            sfstmt->total_row_index += (int64) run;
+            rows -= (int64) run;
+        }
+    }
     return ret;
 }
 
-SF_STATUS STDCALL snowflake_describe_with_capture(SF_STMT *sfstmt,
-                                                  SF_QUERY_RESULT_CAPTURE *result_capture) {
-    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), result_capture, SF_BOOLEAN_TRUE);
-}
+/**
+ * Positions a scrollable statement before a row, see snowflake_fetch_absolute().
+ */
+static SF_STATUS STDCALL _snowflake_scroll_to(SF_STMT *sfstmt, int64 row_index) {
+    SF_SCROLL_CACHE *cache = (SF_SCROLL_CACHE *) sfstmt->scroll_cache;
+    int64 fetched = _snowflake_scroll_fetched(sfstmt);
+    int64 index = sf_scroll_cache_find(cache, row_index);
+    sf_bool json = *((QueryResultFormat_t *) sfstmt->qrf) == JSON_FORMAT;
+    SF_STATUS ret;
 
-SF_STATUS STDCALL snowflake_execute(SF_STMT *sfstmt) {
-    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), NULL, SF_BOOLEAN_FALSE);
-}
+    if (index < 0) {
+        return SF_STATUS_EOF;
+    }
+    if (index >= fetched) {
+        // Not fetched yet, the results go on from the end of the last chunk fetched
+        if (cache->current != fetched - 1) {
+            _snowflake_scroll_keep_current(sfstmt);
+            sfstmt->chunk_index = fetched - 1;
+            sfstmt->chunk_rowcount = 0;
+            sfstmt->total_row_index = cache->row_starts[fetched];
+            cache->current = -1;
+        }
+        return snowflake_seek(sfstmt, row_index);
+    }
 
-SF_STATUS STDCALL snowflake_execute_with_capture(SF_STMT *sfstmt, SF_QUERY_RESULT_CAPTURE *result_capture) {
-    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), result_capture, SF_BOOLEAN_FALSE);
+    // Arrow chunks are only read forward
+    if (index != cache->current || (!json && row_index < sfstmt->total_row_index)) {
+        if ((ret = _snowflake_scroll_load(sfstmt, index)) != SF_STATUS_SUCCESS) {
+            return ret == SF_STATUS_EOF ? SF_STATUS_ERROR_GENERAL : ret;
+        }
+    }
+    if (!json) {
+        return snowflake_seek(sfstmt, row_index);
+    }
+    rs_json_move_to_row((rs_json_t *) sfstmt->result_set,
+                        (size_t) (row_index - cache->row_starts[index]));
+    sfstmt->chunk_rowcount = cache->row_starts[index + 1] - row_index;
+    sfstmt->total_row_index = row_index;
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL _snowflake_execute_ex(SF_STMT *sfstmt,
-                                        sf_bool is_put_get_command,
-                                        SF_QUERY_RESULT_CAPTURE* result_capture,
-                                        sf_bool is_describe_only) {
+SF_STATUS STDCALL snowflake_fetch_absolute(SF_STMT *sfstmt, int64 row_index) {
+    SF_STATUS ret;
+
     if (!sfstmt) {
         return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
     clear_snowflake_error(&sfstmt->error);
-    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
-    SF_JSON_ERROR json_error;
-    const char *error_msg;
-    cJSON *body = NULL;
-    cJSON *data = NULL;
-    cJSON *rowtype = NULL;
-    cJSON *stats = NULL;
-    cJSON *resp = NULL;
-    cJSON *chunks = NULL;
-    cJSON *chunk_headers = NULL;
-    char *qrmk = NULL;
-    char *s_body = NULL;
-    char *s_resp = NULL;
-    sf_bool success = SF_BOOLEAN_FALSE;
-    uuid4_generate(sfstmt->request_id);
-    URL_KEY_VALUE url_params[] = {
-            {.key="requestId=", .value=sfstmt->request_id, .formatted_key=NULL, .formatted_value=NULL, .key_size=0, .value_size=0}
-    };
-    size_t i;
-    cJSON *bindings = NULL;
-    SF_BIND_INPUT *input;
-    const char *type;
-    char *value;
-
-    _mutex_lock(&sfstmt->connection->mutex_sequence_counter);
-    sfstmt->sequence_counter = ++sfstmt->connection->sequence_counter;
-    _mutex_unlock(&sfstmt->connection->mutex_sequence_counter);
-
-    if (_snowflake_get_current_param_style(sfstmt) == POSITIONAL)
-    {
-        bindings = snowflake_cJSON_CreateObject();
-        for (i = 0; i < sfstmt->params_len; i++)
-        {
-            cJSON *binding;
-            input = (SF_BIND_INPUT *) sf_param_store_get(sfstmt->params,
-                    i+1,NULL);
-            if (input == NULL) {
-                continue;
+    if (row_index < 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "Invalid row index", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+
+    if (sfstmt->scroll_cache && !sfstmt->materializer) {
+        ret = _snowflake_scroll_to(sfstmt, row_index);
+    } else if (row_index < sfstmt->total_row_index) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "Fetching a row back requires SF_STMT_SCROLLABLE",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    } else {
+        ret = snowflake_seek(sfstmt, row_index);
+    }
+    if (ret != SF_STATUS_SUCCESS) {
+        return ret;
+    }
+    return snowflake_fetch(sfstmt);
+}
+
+SF_STATUS STDCALL snowflake_fetch_relative(SF_STMT *sfstmt, int64 offset) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    // The current row is the last one fetched
+    return snowflake_fetch_absolute(sfstmt, sfstmt->total_row_index - 1 + offset);
+}
+
+/**
+ * Size of one value of a C type in a caller buffer, or 0 if the C type is not supported.
+ *
+ * @param string_size the size of a string value.
+ */
+static size_t STDCALL _snowflake_c_type_value_size(SF_C_TYPE c_type, size_t string_size) {
+    switch (c_type) {
+        case SF_C_TYPE_INT8:
+            return sizeof(int8);
+        case SF_C_TYPE_UINT8:
+            return sizeof(uint8);
+        case SF_C_TYPE_INT64:
+            return sizeof(int64);
+        case SF_C_TYPE_UINT64:
+            return sizeof(uint64);
+        case SF_C_TYPE_FLOAT64:
+            return sizeof(float64);
+        case SF_C_TYPE_BOOLEAN:
+            return sizeof(sf_bool);
+        case SF_C_TYPE_TIMESTAMP:
+            return sizeof(SF_TIMESTAMP);
+        case SF_C_TYPE_STRING:
+            return string_size;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Size of one value in an SF_BATCH_COLUMN buffer, or 0 if the C type is not supported.
+ */
+static size_t STDCALL _snowflake_batch_value_size(SF_BATCH_COLUMN *column) {
+    return _snowflake_c_type_value_size(column->c_type, column->value_size);
+}
+
+/**
+ * Writes the value of a column of the current row to caller memory, converted to a C type.
+ *
+ * @param value the memory of the value, value_size bytes.
+ * @param len set to the length of the value, the full length for a string.
+ * @param is_null set if the value is NULL.
+ */
+static SF_STATUS STDCALL
+_snowflake_write_cell(SF_STMT *sfstmt, int idx, SF_C_TYPE c_type, void *value,
+                      size_t value_size, size_t *len, sf_bool *is_null) {
+    SF_STATUS status;
+    const char *str = NULL;
+    size_t copy_len;
+
+    *is_null = SF_BOOLEAN_FALSE;
+    *len = value_size;
+    status = STMT_RS_ACCESSORS(sfstmt)->is_cell_null(sfstmt->result_set, idx, is_null);
+    if (status != SF_STATUS_SUCCESS) {
+        goto cleanup;
+    }
+    switch (c_type) {
+        case SF_C_TYPE_INT8:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_int8(sfstmt->result_set, idx, (int8 *) value);
+            break;
+        case SF_C_TYPE_UINT8:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_uint8(sfstmt->result_set, idx, (uint8 *) value);
+            break;
+        case SF_C_TYPE_INT64:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_int64(sfstmt->result_set, idx, (int64 *) value);
+            break;
+        case SF_C_TYPE_UINT64:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_uint64(sfstmt->result_set, idx, (uint64 *) value);
+            break;
+        case SF_C_TYPE_FLOAT64:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_float64(sfstmt->result_set, idx, (float64 *) value);
+            break;
+        case SF_C_TYPE_BOOLEAN:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_bool(sfstmt->result_set, idx, (sf_bool *) value);
+            break;
+        case SF_C_TYPE_TIMESTAMP:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_timestamp(sfstmt->result_set, idx,
+                                              (SF_TIMESTAMP *) value);
+            break;
+        case SF_C_TYPE_STRING:
+            status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_const_string(sfstmt->result_set, idx, &str);
+            if (status != SF_STATUS_SUCCESS) {
+                break;
             }
-            // TODO check if input is null and either set error or write msg to log
-            type = snowflake_type_to_string(
-                    c_type_to_snowflake(input->c_type, SF_DB_TYPE_TIMESTAMP_NTZ));
-            value = value_to_string(input->value, input->len, input->c_type);
-            binding = snowflake_cJSON_CreateObject();
-            char idxbuf[20];
-            sb_sprintf(idxbuf, sizeof(idxbuf), "%lu", (unsigned long) (i + 1));
-            snowflake_cJSON_AddStringToObject(binding, "type", type);
-            snowflake_cJSON_AddStringToObject(binding, "value", value);
-            snowflake_cJSON_AddItemToObject(bindings, idxbuf, binding);
-            if (value) {
-                SF_FREE(value);
+            *len = str ? strlen(str) : 0;
+            copy_len = *len < value_size ? *len : value_size - 1;
+            if (copy_len > 0) {
+                sb_memcpy(value, value_size, str, copy_len);
             }
+            ((char *) value)[copy_len] = '\0';
+            break;
+        default:
+            status = SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
+            break;
+    }
+
+cleanup:
+    if (status != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+/**
+ * Writes the current row of a column to element row of its batch buffers.
+ */
+static SF_STATUS STDCALL
+_snowflake_batch_fetch_cell(SF_STMT *sfstmt, SF_BATCH_COLUMN *column, size_t row) {
+    SF_STATUS status;
+    sf_bool is_null;
+    size_t len;
+
+    status = _snowflake_write_cell(sfstmt, column->idx, column->c_type,
+                                   (char *) column->values + row * _snowflake_batch_value_size(column),
+                                   column->value_size, &len, &is_null);
+    if (status != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (column->c_type == SF_C_TYPE_STRING && column->lengths) {
+        column->lengths[row] = len;
+    }
+    if (column->null_bitmap) {
+        if (is_null) {
+            column->null_bitmap[row / 8] |= (uint8) (1 << (row % 8));
+        } else {
+            column->null_bitmap[row / 8] &= (uint8) ~(1 << (row % 8));
         }
     }
-    else if (_snowflake_get_current_param_style(sfstmt) == NAMED)
-    {
-        bindings = snowflake_cJSON_CreateObject();
-        char *named_param = NULL;
-        for(i = 0; i < sfstmt->params_len; i++)
-        {
-            cJSON *binding;
-            named_param = (char *)(((NamedParams *)sfstmt->name_list)->name_list[i]);
-            input = (SF_BIND_INPUT *) sf_param_store_get(sfstmt->params,
-                    0,named_param);
-            if (input == NULL)
-            {
-                log_error("_snowflake_execute_ex: No parameter by this name %s",named_param);
-                continue;
-            }
-            type = snowflake_type_to_string(
-                    c_type_to_snowflake(input->c_type, SF_DB_TYPE_TIMESTAMP_NTZ));
-            value = value_to_string(input->value, input->len, input->c_type);
-            binding = snowflake_cJSON_CreateObject();
-
-            snowflake_cJSON_AddStringToObject(binding, "type", type);
-            snowflake_cJSON_AddStringToObject(binding, "value", value);
-            snowflake_cJSON_AddItemToObject(bindings, named_param, binding);
-            if (value)
-            {
-                SF_FREE(value);
-            }
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Writes the current row of the bound columns at row times their stride.
+ */
+static SF_STATUS STDCALL _snowflake_write_bound_columns(SF_STMT *sfstmt, size_t row) {
+    SF_BOUND_COLUMN *columns = (SF_BOUND_COLUMN *) sfstmt->bound_columns;
+    SF_BOUND_COLUMN *column;
+    SF_STATUS status;
+    sf_bool is_null;
+    size_t len;
+    size_t i;
+
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+    for (i = 0; i < sfstmt->bound_column_count; i++) {
+        column = &columns[i];
+        if (column->idx > sfstmt->total_fieldcount) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                     "A column is bound past snowflake_num_fields()", "",
+                                     sfstmt->sfqid);
+            return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+        }
+        status = _snowflake_write_cell(sfstmt, column->idx, column->c_type,
+                                       (char *) column->buffer + row * column->stride,
+                                       column->value_size, &len, &is_null);
+        if (status != SF_STATUS_SUCCESS) {
+            return status;
+        }
+        if (column->indicator) {
+            *(int64 *) ((char *) column->indicator + row * column->indicator_stride) =
+                is_null ? SF_NULL_DATA : (int64) len;
         }
     }
+    return SF_STATUS_SUCCESS;
+}
 
-    if (is_string_empty(sfstmt->connection->directURL) &&
-        (is_string_empty(sfstmt->connection->master_token) ||
-         is_string_empty(sfstmt->connection->token))) {
-        log_error(
-            "Missing session token or Master token. Are you sure that snowflake_connect was successful?");
-        SET_SNOWFLAKE_ERROR(&sfstmt->error,
-                            SF_STATUS_ERROR_BAD_CONNECTION_PARAMS,
-                            "Missing session or master token. Try running snowflake_connect.",
-                            SF_SQLSTATE_UNABLE_TO_CONNECT);
-        goto cleanup;
+SF_STATUS STDCALL snowflake_bind_column(SF_STMT *sfstmt, int idx, SF_C_TYPE c_type,
+                                        void *buffer, size_t buffer_size, size_t stride,
+                                        int64 *indicator) {
+    SF_BOUND_COLUMN *columns;
+    SF_BOUND_COLUMN *column = NULL;
+    size_t value_size;
+    size_t i;
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    if (idx < 1) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "Column index must be at least 1", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+    columns = (SF_BOUND_COLUMN *) sfstmt->bound_columns;
+    for (i = 0; i < sfstmt->bound_column_count; i++) {
+        if (columns[i].idx == idx) {
+            column = &columns[i];
+            break;
+        }
     }
 
-    // Create Body
-    body = create_query_json_body(sfstmt->sql_text, sfstmt->sequence_counter,
-                                  is_string_empty(sfstmt->connection->directURL) ?
-                                  NULL : sfstmt->request_id, is_describe_only);
-    if (bindings != NULL) {
-        /* binding parameters if exists */
-      snowflake_cJSON_AddItemToObject(body, "bindings", bindings);
+    if (!buffer) {
+        if (column) {
+            // The last column takes the place of the unbound one
+            *column = columns[--sfstmt->bound_column_count];
+        }
+        return SF_STATUS_SUCCESS;
     }
-    s_body = snowflake_cJSON_Print(body);
-    log_debug("Created body");
-    log_trace("Here is constructed body:\n%s", s_body);
+    value_size = _snowflake_c_type_value_size(c_type, buffer_size);
+    if (value_size == 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE,
+                                 c_type == SF_C_TYPE_STRING ?
+                                 "The buffer of a string column needs room for the terminator" :
+                                 "Unsupported C type for a bound column", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
+    }
+    if (!column) {
+        columns = (SF_BOUND_COLUMN *) SF_REALLOC(
+          sfstmt->bound_columns, (sfstmt->bound_column_count + 1) * sizeof(SF_BOUND_COLUMN));
+        if (!columns) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                     "Out of memory while binding a column",
+                                     SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+            return SF_STATUS_ERROR_OUT_OF_MEMORY;
+        }
+        sfstmt->bound_columns = columns;
+        column = &columns[sfstmt->bound_column_count++];
+    }
+    column->idx = idx;
+    column->c_type = c_type;
+    column->buffer = buffer;
+    column->value_size = value_size;
+    // Without a stride the values and the indicators are arrays of their own
+    column->stride = stride > 0 ? stride : value_size;
+    column->indicator = indicator;
+    column->indicator_stride = stride > 0 ? stride : sizeof(int64);
+    return SF_STATUS_SUCCESS;
+}
 
-    char* queryURL = is_string_empty(sfstmt->connection->directURL) ?
-                     QUERY_URL : sfstmt->connection->directURL;
-    int url_paramSize = is_string_empty(sfstmt->connection->directURL) ?
-                        sizeof(url_params) / sizeof(URL_KEY_VALUE) : 0;
-    if (request(sfstmt->connection, &resp, queryURL, url_params,
-                url_paramSize , s_body, NULL,
-                POST_REQUEST_TYPE, &sfstmt->error, is_put_get_command)) {
-        // s_resp will be freed by snowflake_query_result_capture_term
-        s_resp = snowflake_cJSON_Print(resp);
-        log_trace("Here is JSON response:\n%s", s_resp);
+SF_STATUS STDCALL snowflake_fetch_rows(SF_STMT *sfstmt, size_t max_rows,
+                                       size_t *rows_fetched) {
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+    size_t fetched = 0;
 
-        // Store the full query-response text in the capture buffer, if defined.
-        if (result_capture != NULL) {
-            result_capture->capture_buffer = s_resp;
-            result_capture->actual_response_size = strlen(s_resp) + 1;
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (!rows_fetched) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    while (fetched < max_rows) {
+        if ((ret = _snowflake_fetch_row(sfstmt)) != SF_STATUS_SUCCESS) {
+            break;
+        }
+        if ((ret = _snowflake_write_bound_columns(sfstmt, fetched)) != SF_STATUS_SUCCESS) {
+            break;
         }
+        fetched++;
+    }
+    // End of the result set after some rows is still a successful fetch
+    if (ret == SF_STATUS_EOF && fetched > 0) {
+        ret = SF_STATUS_SUCCESS;
+    }
+    *rows_fetched = fetched;
+    return ret;
+}
 
-        data = snowflake_cJSON_GetObjectItem(resp, "data");
+SF_STATUS STDCALL snowflake_materialize_columns(SF_STMT *sfstmt, const SF_C_TYPE *types,
+                                                size_t column_count, unsigned int threads) {
+    size_t i;
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (!types && column_count > 0) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    clear_snowflake_error(&sfstmt->error);
 
-        if (json_copy_string_no_alloc(sfstmt->sfqid, data, "queryId",
-                                      SF_UUID4_LEN) && !is_put_get_command) {
-            log_debug("No valid sfqid found in response");
+    if (sfstmt->materializer || sfstmt->total_row_index != 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_GENERAL,
+                                 "Columns can only be converted before the first row is fetched.",
+                                 SF_SQLSTATE_FUNCTION_SEQUENCE_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    if (column_count > (size_t) sfstmt->total_fieldcount) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "More types than snowflake_num_fields()", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+    for (i = 0; i < column_count; i++) {
+        switch (types[i]) {
+            case SF_C_TYPE_INT64:
+            case SF_C_TYPE_UINT64:
+            case SF_C_TYPE_FLOAT64:
+            case SF_C_TYPE_BOOLEAN:
+            case SF_C_TYPE_STRING:
+            case SF_C_TYPE_NULL:
+                break;
+            default:
+                SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE,
+                                         "Unsupported C type for a converted column", "",
+                                         sfstmt->sfqid);
+                return SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
         }
-        if ((json_error = json_copy_bool(&success, resp, "success")) ==
-            SF_JSON_ERROR_NONE && success) {
-            if (is_put_get_command) {
-                sfstmt->put_get_response = sf_put_get_response_allocate();
+    }
 
-                json_detach_array_from_object(
-                    (cJSON **) (&sfstmt->put_get_response->src_list),
-                    data, "src_locations");
-                json_copy_string_no_alloc(sfstmt->put_get_response->command,
-                                          data, "command", SF_COMMAND_LEN);
-                json_copy_int(&sfstmt->put_get_response->parallel, data,
-                              "parallel");
-                if (sf_strncasecmp(sfstmt->put_get_response->command, "UPLOAD", 6) == 0)
-                {
-                  json_copy_int(&sfstmt->put_get_response->threshold, data,
-                                "threshold");
-                }
-                json_copy_bool(&sfstmt->put_get_response->auto_compress, data,
-                               "autoCompress");
-                json_copy_bool(&sfstmt->put_get_response->overwrite, data,
-                               "overwrite");
-                json_copy_string_no_alloc(
-                    sfstmt->put_get_response->source_compression,
-                    data, "sourceCompression",
-                    SF_SOURCE_COMPRESSION_TYPE_LEN);
-                json_copy_bool(
-                    &sfstmt->put_get_response->client_show_encryption_param,
-                    data, "clientShowEncryptionParameter");
-
-                cJSON *enc_mat = snowflake_cJSON_GetObjectItem(data,
-                                                               "encryptionMaterial");
-
-                // In put command response, value of encryptionMaterial is an
-                // object, which in get command response, value is an array of
-                // object since different remote files might have different
-                // encryption material
-                if (snowflake_cJSON_IsArray(enc_mat))
-                {
-                    json_detach_array_from_object(
-                      (cJSON **) (&sfstmt->put_get_response->enc_mat_get),
-                      data, "encryptionMaterial");
-                }
-                else
-                {
-                    json_copy_string(
-                      &sfstmt->put_get_response->enc_mat_put->query_stage_master_key,
-                      enc_mat, "queryStageMasterKey");
-                    json_copy_string_no_alloc(
-                      sfstmt->put_get_response->enc_mat_put->query_id,
-                      enc_mat, "queryId", SF_UUID4_LEN);
-                    json_copy_int(&sfstmt->put_get_response->enc_mat_put->smk_id,
-                                  enc_mat, "smkId");
-                }
+    if (threads == 0) {
+        threads = sfstmt->chunk_downloader_threads > 0 ?
+                  (unsigned int) sfstmt->chunk_downloader_threads : 1;
+    }
+    sfstmt->materializer = sf_materializer_init(sfstmt, types, column_count, threads);
+    if (!sfstmt->materializer) {
+        // Error is set in the statement
+        return sfstmt->error.error_code ? sfstmt->error.error_code : SF_STATUS_ERROR_GENERAL;
+    }
+    return SF_STATUS_SUCCESS;
+}
 
-                cJSON *stage_info = snowflake_cJSON_GetObjectItem(data,
-                                                                  "stageInfo");
-                cJSON *stage_cred = snowflake_cJSON_GetObjectItem(stage_info,
-                                                                  "creds");
+SF_STATUS STDCALL snowflake_fetch_batch(SF_STMT *sfstmt, SF_BATCH_COLUMN *columns,
+                                        size_t column_count, size_t max_rows,
+                                        size_t *rows_fetched) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (!rows_fetched || (column_count > 0 && !columns)) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    *rows_fetched = 0;
 
-                json_copy_string(
-                    &sfstmt->put_get_response->stage_info->location_type,
-                    stage_info, "locationType");
-                json_copy_string(
-                    &sfstmt->put_get_response->stage_info->location,
-                    stage_info, "location");
-                json_copy_string(&sfstmt->put_get_response->stage_info->path,
-                                 stage_info, "path");
-                json_copy_string(&sfstmt->put_get_response->stage_info->region,
-                                 stage_info, "region");
-                json_copy_string(&sfstmt->put_get_response->stage_info->storageAccount,
-                                 stage_info, "storageAccount");
-                json_copy_string(&sfstmt->put_get_response->stage_info->endPoint,
-                                 stage_info, "endPoint");
-                json_copy_string(
-                    &sfstmt->put_get_response->stage_info->stage_cred->aws_secret_key,
-                    stage_cred, "AWS_SECRET_KEY");
-                json_copy_string(
-                    &sfstmt->put_get_response->stage_info->stage_cred->aws_key_id,
-                    stage_cred, "AWS_KEY_ID");
-                json_copy_string(
-                    &sfstmt->put_get_response->stage_info->stage_cred->aws_token,
-                    stage_cred, "AWS_TOKEN");
-                json_copy_string(
-                        &sfstmt->put_get_response->stage_info->stage_cred->azure_sas_token,
-                        stage_cred, "AZURE_SAS_TOKEN");
-                json_copy_string(
-                    &sfstmt->put_get_response->localLocation, data,
-                    "localLocation");
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+    sf_bool *copied = NULL;
+    sf_bool all_copied;
+    size_t fetched = 0;
+    size_t run;
+    size_t i;
+    size_t r;
+
+    for (i = 0; i < column_count; i++) {
+        if (columns[i].idx < 1 || columns[i].idx > sfstmt->total_fieldcount) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                     "Column index must be between 1 and snowflake_num_fields()",
+                                     "", sfstmt->sfqid);
+            return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+        }
+        if (!columns[i].values) {
+            return SF_STATUS_ERROR_NULL_POINTER;
+        }
+        if (_snowflake_batch_value_size(&columns[i]) == 0) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE,
+                                     "Unsupported C type for a batch column", "", sfstmt->sfqid);
+            return SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
+        }
+    }
 
-            } else {
-                // Set Database info
-                _mutex_lock(&sfstmt->connection->mutex_parameters);
-                /* Set other parameters. Ignore the status */
-                _set_current_objects(sfstmt, data);
-                _set_parameters_session_info(sfstmt->connection, data);
-                _mutex_unlock(&sfstmt->connection->mutex_parameters);
-                int64 stmt_type_id;
-                if (json_copy_int(&stmt_type_id, data, "statementTypeId")) {
-                    /* failed to get statement type id */
-                    sfstmt->is_dml = SF_BOOLEAN_FALSE;
-                } else {
-                    sfstmt->is_dml = detect_stmt_type(stmt_type_id);
-                }
-               rowtype = snowflake_cJSON_GetObjectItem(data, "rowtype");
-                if (snowflake_cJSON_IsArray(rowtype)) {
-                    sfstmt->total_fieldcount = snowflake_cJSON_GetArraySize(
-                      rowtype);
-                    _snowflake_stmt_desc_reset(sfstmt);
-                    sfstmt->desc = set_description(rowtype);
-                }
-                stats = snowflake_cJSON_GetObjectItem(data, "stats");
-                if (snowflake_cJSON_IsObject(stats)) {
-                    _snowflake_stmt_row_metadata_reset(sfstmt);
-                    sfstmt->stats = set_stats(stats);
-                } else {
-                    sfstmt->stats = NULL;
-                }
+    // Whether the current run of a column was copied without the cell getters
+    copied = (sf_bool *) SF_CALLOC(column_count > 0 ? column_count : 1, sizeof(sf_bool));
+    if (!copied) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Out of memory while fetching a batch of rows",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    while (fetched < max_rows) {
+        if ((ret = _snowflake_fetch_row(sfstmt)) != SF_STATUS_SUCCESS) {
+            break;
+        }
 
-                // Determine query result format and detach rowset object from data.
-                cJSON * qrf = snowflake_cJSON_GetObjectItem(data, "queryResultFormat");
-                char * qrf_str = snowflake_cJSON_GetStringValue(qrf);
-                sfstmt->qrf = SF_CALLOC(1, sizeof(QueryResultFormat_t));
-                cJSON * rowset = NULL;
-
-                if (strcmp(qrf_str, "arrow") == 0 || strcmp(qrf_str, "arrow_force") == 0) {
-#ifdef SF_WIN32
-                    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT,
-                        "Query results were fetched using Arrow, "
-                        "but the client library does not yet support decoding Arrow results", "",
-                        sfstmt->sfqid);
+        // The rest of the current record batch, within the buffers and the chunk
+        run = rs_get_rows_left_in_batch(sfstmt->result_set, sfstmt->qrf);
+        if (run > max_rows - fetched) {
+            run = max_rows - fetched;
+        }
+        if (run > (size_t) sfstmt->chunk_rowcount + 1) {
+            run = (size_t) sfstmt->chunk_rowcount + 1;
+        }
+        if (run == 0) {
+            run = 1;
+        }
 
-                    return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
-#endif
-                    *((QueryResultFormat_t *) sfstmt->qrf) = ARROW_FORMAT;
-                    rowset = snowflake_cJSON_DetachItemFromObject(data, "rowsetBase64");
-                    if (!rowset)
-                    {
-                        log_error("No valid rowset found in response");
-                        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error,
-                            SF_STATUS_ERROR_BAD_JSON,
-                            "Missing rowset from response. No results found.",
-                            SF_SQLSTATE_APP_REJECT_CONNECTION,
-                            sfstmt->sfqid);
-                        goto cleanup;
-                    }
-                }
-                else if (strcmp(qrf_str, "json") == 0) {
-                    *((QueryResultFormat_t *) sfstmt->qrf) = JSON_FORMAT;
-                    if (json_detach_array_from_object((cJSON **)(&rowset), data, "rowset"))
-                    {
-                        log_error("No valid rowset found in response");
-                        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error,
-                            SF_STATUS_ERROR_BAD_JSON,
-                            "Missing rowset from response. No results found.",
-                            SF_SQLSTATE_APP_REJECT_CONNECTION,
-                            sfstmt->sfqid);
-                        goto cleanup;
-                    }
-                }
-                else {
-                    log_error("Unsupported query result format: %s", qrf_str);
-                }
+        all_copied = SF_BOOLEAN_TRUE;
+        for (i = 0; i < column_count; i++) {
+            copied[i] = rs_copy_column(sfstmt->result_set, sfstmt->qrf, columns[i].idx,
+                                       columns[i].c_type,
+                                       (char *) columns[i].values + fetched * _snowflake_batch_value_size(&columns[i]),
+                                       columns[i].null_bitmap, fetched, run);
+            if (!copied[i]) {
+                all_copied = SF_BOOLEAN_FALSE;
+            }
+        }
 
-                // Index starts at 0 and incremented each fetch
-                sfstmt->total_row_index = 0;
-
-                // When the result set is sufficient large, the server response will contain
-                // an empty "rowset" object. Instead, it will have a "chunks" object that contains,
-                // among other fields, a URL from which the result set can be downloaded in chunks.
-                // In this case, we initialize the chunk downloader, which will download in the
-                // background as calls to snowflake_fetch() are made.
-                if ((chunks = snowflake_cJSON_GetObjectItem(data, "chunks")) != NULL) {
-                    // We don't care if there is no qrmk, so ignore return code
-                    json_copy_string(&qrmk, data, "qrmk");
-                    chunk_headers = snowflake_cJSON_GetObjectItem(data, "chunkHeaders");
-                    NON_JSON_RESP* (*callback_create_resp)(void) = NULL;
-                    if (ARROW_FORMAT == *((QueryResultFormat_t *)sfstmt->qrf)) {
-                        callback_create_resp = callback_create_arrow_resp;
-                    }
-
-                    sfstmt->chunk_downloader = chunk_downloader_init(
-                            qrmk,
-                            chunk_headers,
-                            chunks,
-                            2, // thread count
-                            4, // fetch slot
-                            &sfstmt->error,
-                            sfstmt->connection->insecure_mode,
-                            callback_create_resp);
-                    if (!sfstmt->chunk_downloader) {
-                        // Unable to create chunk downloader.
-                        // Error is set in chunk_downloader_init function.
-                        goto cleanup;
-                    }
-
-                    // Even when the result set is split into chunks, JSON format will still
-                    // response with the first chunk in "rowset", so be sure to include it.
-                    sfstmt->result_set = rs_create_with_json_result(
-                        rowset,
-                        sfstmt->desc,
-                        (QueryResultFormat_t *)sfstmt->qrf,
-                        sfstmt->connection->timezone);
-
-                    // Update chunk row count. Controls the chunk downloader.
-                    sfstmt->chunk_rowcount = rs_get_row_count_in_chunk(
-                        sfstmt->result_set,
-                        (QueryResultFormat_t *) sfstmt->qrf);
-
-                    // Update total row count. Used in snowflake_num_rows().
-                    if (json_copy_int(&sfstmt->total_rowcount, data, "total")) {
-                        log_warn(
-                            "No total count found in response. Reverting to using array size of results");
-                        sfstmt->total_rowcount = sfstmt->chunk_rowcount;
-                    }
-                } else {
-                    // Create a result set object and update the total rowcount.
-                    sfstmt->result_set = rs_create_with_json_result(
-                        rowset,
-                        sfstmt->desc,
-                        (QueryResultFormat_t *) sfstmt->qrf,
-                        sfstmt->connection->timezone);
-
-                    // Update chunk row count. Controls the chunk downloader.
-                    sfstmt->chunk_rowcount = rs_get_row_count_in_chunk(
-                        sfstmt->result_set,
-                        (QueryResultFormat_t *) sfstmt->qrf);
-
-                    // Update total row count. Used in snowflake_num_rows().
-                    if (json_copy_int(&sfstmt->total_rowcount, data, "total")) {
-                        log_warn(
-                            "No total count found in response. Reverting to using array size of results");
-                        sfstmt->total_rowcount = sfstmt->chunk_rowcount;
-                    }
-                }
+        if (all_copied) {
+            rs_skip_rows(sfstmt->result_set, sfstmt->qrf, run - 1);
+            sfstmt->chunk_rowcount -= (int64) run - 1;
+            sfstmt->total_row_index += (int64) run - 1;
+            fetched += run;
+            continue;
+        }
+
+        // Read the remaining columns row by row. The run stays within the current chunk,
+        // so fetching only moves to the next row here.
+        for (r = 0; r < run; r++) {
+            if (r > 0 && (ret = _snowflake_fetch_row(sfstmt)) != SF_STATUS_SUCCESS) {
+                goto cleanup;
             }
-        } else if (json_error != SF_JSON_ERROR_NONE) {
-            JSON_ERROR_MSG(json_error, error_msg, "Success code");
-            SET_SNOWFLAKE_STMT_ERROR(
-                &sfstmt->error, SF_STATUS_ERROR_BAD_JSON,
-                error_msg, SF_SQLSTATE_APP_REJECT_CONNECTION, sfstmt->sfqid);
-            goto cleanup;
-        } else if (!success) {
-            cJSON *messageJson = NULL;
-            char *message = NULL;
-            cJSON *codeJson = NULL;
-            int64 code = -1;
-            if (json_copy_string_no_alloc(sfstmt->error.sqlstate, data,
-                                          "sqlState", SF_SQLSTATE_LEN)) {
-                log_debug("No valid sqlstate found in response");
+            for (i = 0; i < column_count; i++) {
+                if (!copied[i] &&
+                    (ret = _snowflake_batch_fetch_cell(sfstmt, &columns[i], fetched)) != SF_STATUS_SUCCESS) {
+                    goto cleanup;
+                }
             }
-            messageJson = snowflake_cJSON_GetObjectItem(resp, "message");
-            if (messageJson) {
-                message = messageJson->valuestring;
+            fetched++;
+        }
+    }
+
+    // End of the result set after some rows is still a successful batch
+    if (ret == SF_STATUS_EOF && fetched > 0) {
+        ret = SF_STATUS_SUCCESS;
+    }
+
+cleanup:
+    *rows_fetched = fetched;
+    SF_FREE(copied);
+    return ret;
+}
+
+SF_STATUS STDCALL snowflake_fetch_arrow_batch(SF_STMT *sfstmt, struct ArrowArray *array,
+                                              struct ArrowSchema *schema) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (!array || !schema) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    clear_snowflake_error(&sfstmt->error);
+
+    SF_STATUS ret;
+    if (!sfstmt->qrf) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT,
+                                 "Record batches can only be exported from query results",
+                                 "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+    }
+
+    while (SF_BOOLEAN_TRUE) {
+        if (sfstmt->result_set) {
+            ret = rs_export_arrow_batch(sfstmt->result_set, sfstmt->qrf, array, schema);
+            if (ret == SF_STATUS_SUCCESS) {
+                sfstmt->total_row_index += array->length;
+                return ret;
             }
-            codeJson = snowflake_cJSON_GetObjectItem(resp, "code");
-            if (codeJson) {
-                code = (int64) atol(codeJson->valuestring);
-            } else {
-                log_debug("no code element.");
+            if (ret != SF_STATUS_EOF) {
+                SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, ret,
+                    rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+                return ret;
             }
-            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, code,
-                                     message ? message
-                                             : "Query was not successful",
-                                     NULL, sfstmt->sfqid);
-            goto cleanup;
         }
-    } else {
-        log_trace("Connection failed");
-        // Set the return status to the error code
-        // that we got from the connection layer
-        ret = sfstmt->error.error_code;
-        goto cleanup;
+        // The current chunk is exported completely
+        sfstmt->chunk_rowcount = 0;
+        if ((ret = _snowflake_next_chunk(sfstmt)) != SF_STATUS_SUCCESS) {
+            return ret;
+        }
+    }
+}
+
+/**
+ * Runs a transaction command on the control statement of the connection, which is created
+ * with the first one. The caller holds sf->mutex_transaction.
+ *
+ * @param error set to the error of the command if it fails.
+ */
+static SF_STATUS STDCALL
+_snowflake_transaction_command(SF_CONNECT *sf, const char *sql, SF_ERROR_STRUCT *error) {
+    SF_STATUS ret;
+
+    if (!sf->control_stmt && !(sf->control_stmt = snowflake_stmt(sf))) {
+        SET_SNOWFLAKE_ERROR(
+            error,
+            SF_STATUS_ERROR_OUT_OF_MEMORY,
+            "Out of memory in creating SF_STMT. ",
+            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    ret = snowflake_query(sf->control_stmt, sql, 0);
+    if (ret != SF_STATUS_SUCCESS) {
+        copy_snowflake_error(error, &sf->control_stmt->error);
+    }
+    return ret;
+}
+
+/**
+ * Starts the transaction begun on the connection, if any, before a statement runs.
+ */
+static SF_STATUS STDCALL _snowflake_start_pending_transaction(SF_STMT *sfstmt) {
+    SF_CONNECT *sf = sfstmt->connection;
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+
+    // The control statement runs its commands through here too
+    if (sfstmt == sf->control_stmt) {
+        return SF_STATUS_SUCCESS;
+    }
+    _mutex_lock(&sf->mutex_transaction);
+    if (sf->trans_begin_pending) {
+        ret = _snowflake_transaction_command(sf, _SF_STMT_SQL_BEGIN, &sfstmt->error);
+        if (ret == SF_STATUS_SUCCESS) {
+            sf->trans_begin_pending = SF_BOOLEAN_FALSE;
+        }
+    }
+    _mutex_unlock(&sf->mutex_transaction);
+    return ret;
+}
+
+/**
+ * Ends the transaction of the connection, unless no statement has started it yet.
+ */
+static SF_STATUS STDCALL _snowflake_end_transaction(SF_CONNECT *sf, const char *sql) {
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    _mutex_lock(&sf->mutex_transaction);
+    if (sf->trans_begin_pending) {
+        log_debug("Transaction without statements, not sending %s", sql);
+        sf->trans_begin_pending = SF_BOOLEAN_FALSE;
+    } else {
+        ret = _snowflake_transaction_command(sf, sql, &sf->error);
+    }
+    _mutex_unlock(&sf->mutex_transaction);
+    return ret;
+}
+
+SF_STATUS STDCALL snowflake_trans_begin(SF_CONNECT *sf) {
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    _mutex_lock(&sf->mutex_transaction);
+    // BEGIN goes out before the first statement of the transaction. A transaction still to be
+    // started is all there is to begin again.
+    if (!sf->trans_begin_pending) {
+        if (sf->autocommit) {
+            sf->trans_begin_pending = SF_BOOLEAN_TRUE;
+        } else {
+            // Without autocommit, the statements run before may have opened a transaction
+            // that the next COMMIT or ROLLBACK still has to end, so it isn't skipped
+            ret = _snowflake_transaction_command(sf, _SF_STMT_SQL_BEGIN, &sf->error);
+        }
+    }
+    _mutex_unlock(&sf->mutex_transaction);
+    return ret;
+}
+
+SF_STATUS STDCALL snowflake_trans_commit(SF_CONNECT *sf) {
+    return _snowflake_end_transaction(sf, _SF_STMT_SQL_COMMIT);
+}
+
+SF_STATUS STDCALL snowflake_trans_rollback(SF_CONNECT *sf) {
+    return _snowflake_end_transaction(sf, _SF_STMT_SQL_ROLLBACK);
+}
+
+int64 STDCALL snowflake_affected_rows(SF_STMT *sfstmt) {
+    size_t i;
+    int64 ret = -1;
+    cJSON *row = NULL;
+    cJSON *raw_row_result;
+    clear_snowflake_error(&sfstmt->error);
+    if (!sfstmt) {
+        /* no way to set the error other than return value */
+        return ret;
+    }
+
+    if (sfstmt->is_dml == SF_BOOLEAN_TRUE) {
+        if (SF_STATUS_SUCCESS != _snowflake_fetch_row(sfstmt))
+        {
+            return -1;
+        }
+        int64 total = 0;
+        for (int i = 1; i <= sfstmt->total_fieldcount; ++i) {
+            int64 field = 0;
+            if (SF_STATUS_SUCCESS != snowflake_column_as_int64(sfstmt, i, &field))
+            {
+                return -1;
+            }
+            total += field;
+        }
+        return total;
+    }
+    else {
+        return sfstmt->total_rowcount;
+    }
+}
+
+SF_STATUS STDCALL
+snowflake_prepare(SF_STMT *sfstmt, const char *command, size_t command_size) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+    size_t sql_text_size = 1; // Don't forget about null terminator
+    if (!command) {
+        goto cleanup;
+    }
+    // A statement run in a loop allocates nothing more once its buffers are large enough
+    _snowflake_stmt_clear(sfstmt, SF_BOOLEAN_TRUE);
+    // Set sql_text to command
+    if (command_size == 0) {
+        log_debug("Command size is 0, using to strlen to find query length.");
+        sql_text_size += strlen(command);
+    } else {
+        log_debug("Command size non-zero, setting as sql text size.");
+        sql_text_size += command_size;
+    }
+    if (sfstmt->sql_text_size < sql_text_size) {
+        SF_FREE(sfstmt->sql_text);
+        sfstmt->sql_text_size = 0;
+        sfstmt->sql_text = (char *) SF_CALLOC(1, sql_text_size);
+        if (!sfstmt->sql_text) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                     "Out of memory while copying the SQL text",
+                                     SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+            ret = SF_STATUS_ERROR_OUT_OF_MEMORY;
+            goto cleanup;
+        }
+        sfstmt->sql_text_size = sql_text_size;
+    }
+    sb_memcpy(sfstmt->sql_text, sql_text_size, command, sql_text_size - 1);
+    // Null terminate
+    sfstmt->sql_text[sql_text_size - 1] = '\0';
+
+    ret = SF_STATUS_SUCCESS;
+
+cleanup:
+    return ret;
+}
+
+SF_STATUS STDCALL snowflake_describe_with_capture(SF_STMT *sfstmt,
+                                                  SF_QUERY_RESULT_CAPTURE *result_capture) {
+    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), result_capture, SF_BOOLEAN_TRUE, SF_BOOLEAN_FALSE);
+}
+
+SF_STATUS STDCALL snowflake_execute(SF_STMT *sfstmt) {
+    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), NULL, SF_BOOLEAN_FALSE,
+                                 SF_BOOLEAN_FALSE);
+}
+
+SF_STATUS STDCALL snowflake_execute_with_capture(SF_STMT *sfstmt, SF_QUERY_RESULT_CAPTURE *result_capture) {
+    return _snowflake_execute_ex(sfstmt, _is_put_get_command(sfstmt->sql_text), result_capture, SF_BOOLEAN_FALSE,
+                                 SF_BOOLEAN_FALSE);
+}
+
+/**
+ * Writes one bound value as a string. Numbers and booleans are formatted straight into the
+ * request body, the other types go through their text in the arena.
+ */
+static void STDCALL _snowflake_write_bind_value(SF_JSON_WRITER *writer, SF_ARENA *arena,
+                                                void *value, size_t len, SF_C_TYPE c_type) {
+    // Same size value_to_string formats numbers into
+    char number[64];
+
+    if (value == NULL) {
+        sf_json_writer_string(writer, NULL);
+        return;
+    }
+    switch (c_type) {
+        case SF_C_TYPE_INT8:
+            sf_json_writer_int_string(writer, *(int8 *) value);
+            break;
+        case SF_C_TYPE_UINT8:
+            sf_json_writer_uint_string(writer, *(uint8 *) value);
+            break;
+        case SF_C_TYPE_INT64:
+            sf_json_writer_int_string(writer, *(int64 *) value);
+            break;
+        case SF_C_TYPE_UINT64:
+            sf_json_writer_uint_string(writer, *(uint64 *) value);
+            break;
+        case SF_C_TYPE_FLOAT64:
+            sb_sprintf(number, sizeof(number), "%f", *(float64 *) value);
+            sf_json_writer_string(writer, number);
+            break;
+        case SF_C_TYPE_BOOLEAN:
+            sf_json_writer_string(writer, *(sf_bool *) value != (sf_bool) 0 ?
+                                          SF_BOOLEAN_INTERNAL_TRUE_STR : SF_BOOLEAN_INTERNAL_FALSE_STR);
+            break;
+        default:
+            sf_json_writer_string(writer, value_to_arena_string(arena, value, len, c_type));
+            sf_arena_reset(arena);
+            break;
+    }
+}
+
+/**
+ * Writes the bindings member of the query request body, one object with a type and a value
+ * per bound parameter, keyed by position or by name.
+ */
+static void STDCALL _snowflake_write_bindings(SF_STMT *sfstmt, SF_JSON_WRITER *writer) {
+    size_t i;
+    uint64 row;
+    char idxbuf[20];
+    const char *key;
+    char *named_param;
+    SF_BIND_INPUT *input;
+    SF_ARENA *arena;
+    PARAM_TYPE param_style = _snowflake_get_current_param_style(sfstmt);
+
+    if (param_style != POSITIONAL && param_style != NAMED) {
+        return;
+    }
+    // The writer copies the values, so their text only has to live until the next one
+    if (!sfstmt->bind_arena) {
+        sfstmt->bind_arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    }
+    arena = (SF_ARENA *) sfstmt->bind_arena;
+
+    sf_json_writer_key(writer, "bindings");
+    sf_json_writer_begin_object(writer);
+    for (i = 0; i < sfstmt->params_len; i++)
+    {
+        if (param_style == POSITIONAL)
+        {
+            input = (SF_BIND_INPUT *) sf_param_store_get(sfstmt->params,
+                    i+1,NULL);
+            if (input == NULL) {
+                continue;
+            }
+            sb_sprintf(idxbuf, sizeof(idxbuf), "%lu", (unsigned long) (i + 1));
+            key = idxbuf;
+        }
+        else
+        {
+            named_param = (char *)(((NamedParams *)sfstmt->name_list)->name_list[i]);
+            input = (SF_BIND_INPUT *) sf_param_store_get_named(sfstmt->params, named_param,
+                    ((NamedParams *)sfstmt->name_list)->hashes[i]);
+            if (input == NULL)
+            {
+                log_error("_snowflake_execute_ex: No parameter by this name %s",named_param);
+                continue;
+            }
+            key = named_param;
+        }
+
+        sf_json_writer_key(writer, key);
+        sf_json_writer_begin_object(writer);
+        sf_json_writer_key(writer, "type");
+        sf_json_writer_string(writer, snowflake_type_to_string(
+            c_type_to_snowflake(input->c_type, SF_DB_TYPE_TIMESTAMP_NTZ)));
+        sf_json_writer_key(writer, "value");
+        if (sfstmt->paramset_size > 1)
+        {
+            // One value per row
+            sf_json_writer_begin_array(writer);
+            for (row = 0; row < sfstmt->paramset_size; row++)
+            {
+                _snowflake_write_bind_value(writer, arena, _snowflake_bind_value_at(input, row),
+                                            input->len, input->c_type);
+            }
+            sf_json_writer_end_array(writer);
+        }
+        else
+        {
+            _snowflake_write_bind_value(writer, arena, input->value, input->len, input->c_type);
+        }
+        sf_json_writer_end_object(writer);
+    }
+    sf_json_writer_end_object(writer);
+}
+
+/**
+ * Writes the bindings member of the query request body for an Arrow batch, one positional
+ * parameter per column with a value per row read straight from the column buffers.
+ */
+static void STDCALL _snowflake_write_arrow_bindings(SF_STMT *sfstmt, SF_JSON_WRITER *writer) {
+    const SF_ARROW_BINDS *binds = (const SF_ARROW_BINDS *) sfstmt->arrow_binds;
+    char idxbuf[20];
+    char cell[SF_ARROW_BIND_CELL_SIZE];
+    const char *value;
+    size_t len;
+    size_t i;
+    int64 row;
+    SF_ARENA *arena;
+
+    if (!sfstmt->bind_arena) {
+        sfstmt->bind_arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    }
+    arena = (SF_ARENA *) sfstmt->bind_arena;
+
+    sf_json_writer_key(writer, "bindings");
+    sf_json_writer_begin_object(writer);
+    for (i = 0; i < binds->column_count; i++) {
+        sb_sprintf(idxbuf, sizeof(idxbuf), "%lu", (unsigned long) (i + 1));
+        sf_json_writer_key(writer, idxbuf);
+        sf_json_writer_begin_object(writer);
+        sf_json_writer_key(writer, "type");
+        sf_json_writer_string(writer, snowflake_type_to_string(binds->columns[i].type));
+        sf_json_writer_key(writer, "value");
+        if (binds->row_count > 1) {
+            sf_json_writer_begin_array(writer);
+        }
+        for (row = 0; row < binds->row_count; row++) {
+            value = bind_arrow_cell(binds, i, row, SF_BOOLEAN_FALSE, cell, arena, &len);
+            if (value) {
+                sf_json_writer_string_len(writer, value, len);
+            } else {
+                sf_json_writer_string(writer, NULL);
+            }
+            sf_arena_reset(arena);
+        }
+        if (binds->row_count > 1) {
+            sf_json_writer_end_array(writer);
+        }
+        sf_json_writer_end_object(writer);
+    }
+    sf_json_writer_end_object(writer);
+}
+
+/**
+ * Requests the results of the query of a statement again, for the fresh chunk URLs they come
+ * with. Called by the chunk downloader once the URLs it has were refused, see
+ * SF_CHUNK_URL_REFRESH.
+ */
+static cJSON *_snowflake_refresh_chunk_urls(void *context, SF_ERROR_STRUCT *error) {
+    SF_STMT *sfstmt = (SF_STMT *) context;
+    char url[sizeof(QUERY_RESULT_URL) + SF_UUID4_LEN];
+    cJSON *resp = NULL;
+    cJSON *chunks = NULL;
+
+    sb_sprintf(url, sizeof(url), QUERY_RESULT_URL, sfstmt->sfqid);
+    if (request(sfstmt->connection, &resp, url, NULL, 0, NULL, NULL, GET_REQUEST_TYPE, error,
+                SF_BOOLEAN_FALSE)) {
+        chunks = snowflake_cJSON_DetachItemFromObject(snowflake_cJSON_GetObjectItem(resp, "data"),
+                                                      "chunks");
+        if (!snowflake_cJSON_IsArray(chunks)) {
+            snowflake_cJSON_Delete(chunks);
+            chunks = NULL;
+            SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_RESPONSE,
+                                "The results of the query came without chunks.",
+                                SF_SQLSTATE_GENERAL_ERROR);
+        }
+    }
+    snowflake_cJSON_Delete(resp);
+    return chunks;
+}
+
+/**
+ * Reads the response of a query request, or of a request for the results of a query, into
+ * the statement.
+ */
+static SF_STATUS STDCALL _snowflake_process_query_response(SF_STMT *sfstmt, cJSON *resp,
+                                                           sf_bool is_put_get_command,
+                                                           sf_bool is_async_exec,
+                                                           sf_bool capture_only) {
+    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+    SF_JSON_ERROR json_error;
+    const char *error_msg;
+    cJSON *data = NULL;
+    cJSON *rowtype = NULL;
+    cJSON *stats = NULL;
+    cJSON *chunks = NULL;
+    cJSON *chunk_headers = NULL;
+    char *qrmk = NULL;
+    sf_bool success = SF_BOOLEAN_FALSE;
+
+    data = snowflake_cJSON_GetObjectItem(resp, "data");
+
+    if (json_copy_string_no_alloc(sfstmt->sfqid, data, "queryId",
+                                  SF_UUID4_LEN) && !is_put_get_command) {
+        log_debug("No valid sfqid found in response");
+    }
+    if ((json_error = json_copy_bool(&success, resp, "success")) ==
+        SF_JSON_ERROR_NONE && success) {
+        if (is_async_exec) {
+            // Only the query id is known until the results are requested
+            log_debug("Submitted asynchronous query %s", sfstmt->sfqid);
+        } else if (is_put_get_command) {
+            sfstmt->put_get_response = sf_put_get_response_allocate();
+
+            json_detach_array_from_object(
+                (cJSON **) (&sfstmt->put_get_response->src_list),
+                data, "src_locations");
+            json_copy_string_no_alloc(sfstmt->put_get_response->command,
+                                      data, "command", SF_COMMAND_LEN);
+            json_copy_int(&sfstmt->put_get_response->parallel, data,
+                          "parallel");
+            if (sf_strncasecmp(sfstmt->put_get_response->command, "UPLOAD", 6) == 0)
+            {
+              json_copy_int(&sfstmt->put_get_response->threshold, data,
+                            "threshold");
+            }
+            json_copy_bool(&sfstmt->put_get_response->auto_compress, data,
+                           "autoCompress");
+            json_copy_bool(&sfstmt->put_get_response->overwrite, data,
+                           "overwrite");
+            json_copy_string_no_alloc(
+                sfstmt->put_get_response->source_compression,
+                data, "sourceCompression",
+                SF_SOURCE_COMPRESSION_TYPE_LEN);
+            json_copy_bool(
+                &sfstmt->put_get_response->client_show_encryption_param,
+                data, "clientShowEncryptionParameter");
+
+            cJSON *enc_mat = snowflake_cJSON_GetObjectItem(data,
+                                                           "encryptionMaterial");
+
+            // In put command response, value of encryptionMaterial is an
+            // object, which in get command response, value is an array of
+            // object since different remote files might have different
+            // encryption material
+            if (snowflake_cJSON_IsArray(enc_mat))
+            {
+                json_detach_array_from_object(
+                  (cJSON **) (&sfstmt->put_get_response->enc_mat_get),
+                  data, "encryptionMaterial");
+            }
+            else
+            {
+                json_copy_string(
+                  &sfstmt->put_get_response->enc_mat_put->query_stage_master_key,
+                  enc_mat, "queryStageMasterKey");
+                json_copy_string_no_alloc(
+                  sfstmt->put_get_response->enc_mat_put->query_id,
+                  enc_mat, "queryId", SF_UUID4_LEN);
+                json_copy_int(&sfstmt->put_get_response->enc_mat_put->smk_id,
+                              enc_mat, "smkId");
+            }
+
+            cJSON *stage_info = snowflake_cJSON_GetObjectItem(data,
+                                                              "stageInfo");
+            cJSON *stage_cred = snowflake_cJSON_GetObjectItem(stage_info,
+                                                              "creds");
+
+            json_copy_string(
+                &sfstmt->put_get_response->stage_info->location_type,
+                stage_info, "locationType");
+            json_copy_string(
+                &sfstmt->put_get_response->stage_info->location,
+                stage_info, "location");
+            json_copy_string(&sfstmt->put_get_response->stage_info->path,
+                             stage_info, "path");
+            json_copy_string(&sfstmt->put_get_response->stage_info->region,
+                             stage_info, "region");
+            json_copy_string(&sfstmt->put_get_response->stage_info->storageAccount,
+                             stage_info, "storageAccount");
+            json_copy_string(&sfstmt->put_get_response->stage_info->endPoint,
+                             stage_info, "endPoint");
+            json_copy_string(
+                &sfstmt->put_get_response->stage_info->stage_cred->aws_secret_key,
+                stage_cred, "AWS_SECRET_KEY");
+            json_copy_string(
+                &sfstmt->put_get_response->stage_info->stage_cred->aws_key_id,
+                stage_cred, "AWS_KEY_ID");
+            json_copy_string(
+                &sfstmt->put_get_response->stage_info->stage_cred->aws_token,
+                stage_cred, "AWS_TOKEN");
+            json_copy_string(
+                    &sfstmt->put_get_response->stage_info->stage_cred->azure_sas_token,
+                    stage_cred, "AZURE_SAS_TOKEN");
+            json_copy_string(
+                &sfstmt->put_get_response->localLocation, data,
+                "localLocation");
+
+        } else {
+            // Set Database info
+            int64 stmt_type_id;
+            _mutex_lock(&sfstmt->connection->mutex_parameters);
+            // A statement other than a query or DML may have changed any parameter, only
+            // those in its response are known afterwards
+            if (json_copy_int(&stmt_type_id, data, "statementTypeId") == SF_JSON_ERROR_NONE &&
+                !stmt_keeps_descriptions(stmt_type_id)) {
+                snowflake_cJSON_Delete((cJSON *) sfstmt->connection->session_parameters);
+                sfstmt->connection->session_parameters = NULL;
+            }
+            /* Set other parameters. Ignore the status */
+            _set_current_objects(sfstmt, data);
+            _set_parameters_session_info(sfstmt->connection, data);
+            _mutex_unlock(&sfstmt->connection->mutex_parameters);
+            if (json_copy_int(&stmt_type_id, data, "statementTypeId")) {
+                /* failed to get statement type id */
+                sfstmt->is_dml = SF_BOOLEAN_FALSE;
+            } else {
+                sfstmt->is_dml = detect_stmt_type(stmt_type_id);
+                if (!stmt_keeps_descriptions(stmt_type_id)) {
+                    sf_response_cache_clear(sfstmt->connection->describe_cache);
+                }
+                // Writes from this process are seen by the queries after them
+                if ((stmt_type_id & 0xf000) != _SF_STMT_TYPE_SELECT) {
+                    SF_RESPONSE_CACHE *result_cache = _snowflake_result_cache_acquire();
+                    sf_response_cache_clear(result_cache);
+                    sf_response_cache_release(result_cache);
+                }
+            }
+           rowtype = snowflake_cJSON_GetObjectItem(data, "rowtype");
+            if (snowflake_cJSON_IsArray(rowtype)) {
+                sfstmt->total_fieldcount = snowflake_cJSON_GetArraySize(
+                  rowtype);
+                // Re-executions usually return the same columns, so keep the descriptors
+                uint64 fingerprint = rowtype_fingerprint(rowtype);
+                if (!sfstmt->desc || sfstmt->desc_count != sfstmt->total_fieldcount ||
+                    sfstmt->desc_fingerprint != fingerprint) {
+                    _snowflake_stmt_desc_reset(sfstmt);
+                    sfstmt->desc = set_description(rowtype);
+                    sfstmt->desc_count = sfstmt->desc ? sfstmt->total_fieldcount : 0;
+                    sfstmt->desc_fingerprint = fingerprint;
+                } else {
+                    log_debug("Reusing the column descriptors of the previous execution");
+                }
+            }
+            stats = snowflake_cJSON_GetObjectItem(data, "stats");
+            if (snowflake_cJSON_IsObject(stats)) {
+                _snowflake_stmt_row_metadata_reset(sfstmt);
+                sfstmt->stats = set_stats(stats);
+            } else {
+                _snowflake_stmt_row_metadata_reset(sfstmt);
+            }
+            if (capture_only) {
+                // The rows are only in the captured text
+                ret = SF_STATUS_SUCCESS;
+                goto cleanup;
+            }
+
+            // Determine query result format and detach rowset object from data.
+            cJSON * qrf = snowflake_cJSON_GetObjectItem(data, "queryResultFormat");
+            char * qrf_str = snowflake_cJSON_GetStringValue(qrf);
+            sfstmt->qrf = SF_CALLOC(1, sizeof(QueryResultFormat_t));
+            cJSON * rowset = NULL;
+
+            if (strcmp(qrf_str, "arrow") == 0 || strcmp(qrf_str, "arrow_force") == 0) {
+#ifdef SF_NO_ARROW
+                SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT,
+                    "Query results were fetched using Arrow, "
+                    "but the client library does not yet support decoding Arrow results", "",
+                    sfstmt->sfqid);
+
+                return SF_STATUS_ERROR_UNSUPPORTED_QUERY_RESULT_FORMAT;
+#endif
+                *((QueryResultFormat_t *) sfstmt->qrf) = ARROW_FORMAT;
+                rowset = snowflake_cJSON_DetachItemFromObject(data, "rowsetBase64");
+                if (!rowset)
+                {
+                    log_error("No valid rowset found in response");
+                    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error,
+                        SF_STATUS_ERROR_BAD_JSON,
+                        "Missing rowset from response. No results found.",
+                        SF_SQLSTATE_APP_REJECT_CONNECTION,
+                        sfstmt->sfqid);
+                    goto cleanup;
+                }
+            }
+            else if (strcmp(qrf_str, "json") == 0) {
+                *((QueryResultFormat_t *) sfstmt->qrf) = JSON_FORMAT;
+                if (json_detach_array_from_object((cJSON **)(&rowset), data, "rowset"))
+                {
+                    log_error("No valid rowset found in response");
+                    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error,
+                        SF_STATUS_ERROR_BAD_JSON,
+                        "Missing rowset from response. No results found.",
+                        SF_SQLSTATE_APP_REJECT_CONNECTION,
+                        sfstmt->sfqid);
+                    goto cleanup;
+                }
+            }
+            else {
+                log_error("Unsupported query result format: %s", qrf_str);
+            }
+            sfstmt->rs_accessors = rs_get_accessors((QueryResultFormat_t *) sfstmt->qrf);
+
+            // Index starts at 0 and incremented each fetch
+            sfstmt->total_row_index = 0;
+            sfstmt->chunk_index = 0;
+
+            // Resuming at a chunk, the rows before it are dropped with the response
+            chunks = snowflake_cJSON_GetObjectItem(data, "chunks");
+            if (sfstmt->result_start_chunk > 0 &&
+                !_snowflake_skip_chunks(sfstmt, &rowset, chunks)) {
+                goto cleanup;
+            }
+
+            // When the result set is sufficient large, the server response will contain
+            // an empty "rowset" object. Instead, it will have a "chunks" object that contains,
+            // among other fields, a URL from which the result set can be downloaded in chunks.
+            // In this case, we initialize the chunk downloader, which will download in the
+            // background as calls to snowflake_fetch() are made.
+            if (chunks != NULL) {
+                // We don't care if there is no qrmk, so ignore return code
+                json_copy_string(&qrmk, data, "qrmk");
+                chunk_headers = snowflake_cJSON_GetObjectItem(data, "chunkHeaders");
+                NON_JSON_RESP* (*callback_create_resp)(void) = NULL;
+                SF_JSON_CHUNK_DECODE callback_decode_json = NULL;
+                if (ARROW_FORMAT == *((QueryResultFormat_t *)sfstmt->qrf)) {
+                    callback_create_resp = sfstmt->chunk_streaming_decode ?
+                                           callback_create_arrow_stream_resp :
+                                           callback_create_arrow_resp;
+                } else if (sfstmt->json_to_arrow) {
+                    callback_decode_json = rs_json_decode_arrow_chunk;
+                }
+                SF_RETRY_POLICY chunk_retry_policy;
+                retry_policy_init(&chunk_retry_policy, sfstmt->connection, SF_RETRY_CLASS_CHUNK);
+                // The query id is known by now, the chunk spans carry it
+                memcpy(sfstmt->trace.sfqid, sfstmt->sfqid, SF_UUID4_LEN);
+
+                sfstmt->chunk_downloader = chunk_downloader_init(
+                        qrmk,
+                        chunk_headers,
+                        chunks,
+                        sfstmt->chunk_downloader_threads,
+                        sfstmt->chunk_downloader_fetch_slots,
+                        sfstmt->chunk_downloader_memory_limit,
+                        _snowflake_memory_budget(sfstmt),
+                        sfstmt->chunk_downloader_multiplex,
+                        sfstmt->chunk_downloader_hedging,
+                        sfstmt->chunk_decoder_inflate,
+                        sfstmt->chunk_compressed_prefetch,
+                        sfstmt->connection->chunk_spill_dir,
+                        sf_scheduler_pool(sfstmt->connection->account,
+                                          sfstmt->connection->warehouse),
+                        sfstmt->query_priority,
+                        &sfstmt->trace,
+                        &sfstmt->error,
+                        sfstmt->connection->insecure_mode,
+                        &chunk_retry_policy,
+                        callback_create_resp,
+                        callback_decode_json,
+                        sfstmt->desc,
+                        _snowflake_refresh_chunk_urls,
+                        sfstmt);
+                if (!sfstmt->chunk_downloader) {
+                    // Unable to create chunk downloader.
+                    // Error is set in chunk_downloader_init function.
+                    goto cleanup;
+                }
+
+                // Even when the result set is split into chunks, JSON format will still
+                // response with the first chunk in "rowset", so be sure to include it.
+                sfstmt->result_set = rs_create_with_json_result(
+                    rowset,
+                    sfstmt->desc,
+                    (QueryResultFormat_t *)sfstmt->qrf,
+                    sfstmt->connection->timezone);
+
+                // Update chunk row count. Controls the chunk downloader.
+                sfstmt->chunk_rowcount = rs_get_row_count_in_chunk(
+                    sfstmt->result_set,
+                    (QueryResultFormat_t *) sfstmt->qrf);
+
+                // Update total row count. Used in snowflake_num_rows().
+                if (json_copy_int(&sfstmt->total_rowcount, data, "total")) {
+                    log_warn(
+                        "No total count found in response. Reverting to using array size of results");
+                    sfstmt->total_rowcount = sfstmt->chunk_rowcount;
+                }
+                _snowflake_scroll_cache_init(sfstmt);
+            } else {
+                // Create a result set object and update the total rowcount.
+                sfstmt->result_set = rs_create_with_json_result(
+                    rowset,
+                    sfstmt->desc,
+                    (QueryResultFormat_t *) sfstmt->qrf,
+                    sfstmt->connection->timezone);
+
+                // Update chunk row count. Controls the chunk downloader.
+                sfstmt->chunk_rowcount = rs_get_row_count_in_chunk(
+                    sfstmt->result_set,
+                    (QueryResultFormat_t *) sfstmt->qrf);
+
+                // Update total row count. Used in snowflake_num_rows().
+                if (json_copy_int(&sfstmt->total_rowcount, data, "total")) {
+                    log_warn(
+                        "No total count found in response. Reverting to using array size of results");
+                    sfstmt->total_rowcount = sfstmt->chunk_rowcount;
+                }
+                _snowflake_scroll_cache_init(sfstmt);
+            }
+        }
+    } else if (json_error != SF_JSON_ERROR_NONE) {
+        JSON_ERROR_MSG(json_error, error_msg, "Success code");
+        SET_SNOWFLAKE_STMT_ERROR(
+            &sfstmt->error, SF_STATUS_ERROR_BAD_JSON,
+            error_msg, SF_SQLSTATE_APP_REJECT_CONNECTION, sfstmt->sfqid);
+        goto cleanup;
+    } else if (!success) {
+        cJSON *messageJson = NULL;
+        char *message = NULL;
+        cJSON *codeJson = NULL;
+        int64 code = -1;
+        if (json_copy_string_no_alloc(sfstmt->error.sqlstate, data,
+                                      "sqlState", SF_SQLSTATE_LEN)) {
+            log_debug("No valid sqlstate found in response");
+        }
+        messageJson = snowflake_cJSON_GetObjectItem(resp, "message");
+        if (messageJson) {
+            message = messageJson->valuestring;
+        }
+        codeJson = snowflake_cJSON_GetObjectItem(resp, "code");
+        if (codeJson) {
+            code = (int64) atol(codeJson->valuestring);
+        } else {
+            log_debug("no code element.");
+        }
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, code,
+                                 message ? message
+                                         : "Query was not successful",
+                                 NULL, sfstmt->sfqid);
+        goto cleanup;
+    }
+
+    // Everything went well if we got to this point
+    ret = SF_STATUS_SUCCESS;
+
+cleanup:
+    SF_FREE(qrmk);
+
+    return ret;
+}
+
+/**
+ * Moves on to the results of the first statement when the response is the one of a
+ * multi-statement query. The response of such a query only lists the ids of its statements.
+ */
+static SF_STATUS STDCALL _snowflake_first_stmt_result(SF_STMT *sfstmt, cJSON *resp) {
+    if (json_copy_string(&sfstmt->multi_stmt_result_ids,
+                         snowflake_cJSON_GetObjectItem(resp, "data"), "resultIds") !=
+        SF_JSON_ERROR_NONE || is_string_empty(sfstmt->multi_stmt_result_ids)) {
+        SF_FREE(sfstmt->multi_stmt_result_ids);
+        sfstmt->multi_stmt_next_id = NULL;
+        return SF_STATUS_SUCCESS;
+    }
+    sfstmt->multi_stmt_next_id = sfstmt->multi_stmt_result_ids;
+    return snowflake_next_result(sfstmt);
+}
+
+/**
+ * Requests the results of a query and reads them into the statement.
+ *
+ * @param sfstmt the statement, whose previous results are released.
+ * @param query_id the id of the query.
+ * @param is_multi_stmt_child set when the query is a statement of a multi-statement query,
+ *        whose results can't refer to further statements.
+ */
+static SF_STATUS STDCALL _snowflake_get_query_result(SF_STMT *sfstmt, const char *query_id,
+                                                     sf_bool is_multi_stmt_child) {
+    SF_STATUS ret;
+    char url[sizeof(QUERY_RESULT_URL) + SF_UUID4_LEN];
+    cJSON *resp = NULL;
+
+    sb_strncpy(sfstmt->sfqid, SF_UUID4_LEN, query_id, SF_UUID4_LEN);
+    sb_sprintf(url, sizeof(url), QUERY_RESULT_URL, query_id);
+    if (!request(sfstmt->connection, &resp, url, NULL, 0, NULL, NULL, GET_REQUEST_TYPE,
+                 &sfstmt->error, SF_BOOLEAN_FALSE)) {
+        ret = sfstmt->error.error_code;
+        goto cleanup;
+    }
+    ret = _snowflake_process_query_response(sfstmt, resp, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE,
+                                            SF_BOOLEAN_FALSE);
+    if (ret == SF_STATUS_SUCCESS && !is_multi_stmt_child) {
+        ret = _snowflake_first_stmt_result(sfstmt, resp);
+    }
+
+cleanup:
+    snowflake_cJSON_Delete(resp);
+    return ret;
+}
+
+SF_STATUS STDCALL snowflake_next_result(SF_STMT *sfstmt) {
+    char query_id[SF_UUID4_LEN];
+    const char *next_id;
+    const char *end;
+    size_t len;
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    next_id = sfstmt->multi_stmt_next_id;
+    if (!next_id) {
+        return SF_STATUS_EOF;
+    }
+
+    end = strchr(next_id, ',');
+    len = end ? (size_t) (end - next_id) : strlen(next_id);
+    sfstmt->multi_stmt_next_id = end ? end + 1 : NULL;
+    if (len == 0 || len >= SF_UUID4_LEN) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_RESPONSE,
+                                 "Invalid statement id in the multi-statement response",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_RESPONSE;
+    }
+    memcpy(query_id, next_id, len);
+    query_id[len] = '\0';
+
+    _snowflake_stmt_results_reset(sfstmt);
+    return _snowflake_get_query_result(sfstmt, query_id, SF_BOOLEAN_TRUE);
+}
+
+/**
+ * @return the CLIENT_RESULT_CHUNK_SIZE in MB to ask for the results of a statement in, 0 to
+ *         leave it to the session. In auto mode a memory limit is shared by the chunks that
+ *         two prefetch slots per downloader thread hold, so that they fit in it.
+ */
+static int64 STDCALL _snowflake_result_chunk_size(SF_STMT *sfstmt) {
+    uint64 size = sfstmt->result_chunk_size;
+    uint64 threads = sfstmt->chunk_downloader_threads;
+
+    if (size == SF_RESULT_CHUNK_SIZE_AUTO) {
+        if (!sfstmt->chunk_downloader_memory_limit) {
+            return 0;
+        }
+        if (threads == SF_CHUNK_DOWNLOADER_AUTO) {
+            threads = SF_DEFAULT_CHUNK_DOWNLOADER_THREADS;
+        }
+        size = sfstmt->chunk_downloader_memory_limit / (threads * 2) / (1024 * 1024);
+    }
+    if (size < SF_RESULT_CHUNK_SIZE_MIN) {
+        size = SF_RESULT_CHUNK_SIZE_MIN;
+    } else if (size > SF_RESULT_CHUNK_SIZE_MAX) {
+        size = SF_RESULT_CHUNK_SIZE_MAX;
+    }
+    return (int64) size;
+}
+
+/**
+ * @return the account, user, session objects and options the response to a statement depends
+ *         on, joined in one string to be freed by the caller, or NULL if out of memory.
+ */
+static char *STDCALL _snowflake_session_context(SF_STMT *sfstmt) {
+    SF_CONNECT *sf = sfstmt->connection;
+    const char *objects[10];
+    char *context;
+    size_t size = 32;
+    int i;
+
+    _mutex_lock(&sf->mutex_parameters);
+    objects[0] = sf->host;
+    objects[1] = sf->account;
+    objects[2] = sf->user;
+    objects[3] = sf->database;
+    objects[4] = sf->schema;
+    objects[5] = sf->warehouse;
+    objects[6] = sf->role;
+    objects[7] = sf->timezone;
+    objects[8] = sfstmt->query_result_format;
+    objects[9] = sfstmt->query_parameters;
+    for (i = 0; i < 10; i++) {
+        objects[i] = objects[i] ? objects[i] : "";
+        size += strlen(objects[i]);
+    }
+    context = (char *) SF_MALLOC(size);
+    if (context) {
+        // Unit separators, names may contain anything else when quoted
+        sb_sprintf(context, size,
+                   "%s\x1f%s\x1f%s\x1f%s\x1f%s\x1f%s\x1f%s\x1f%s\x1f%lld\x1f%s\x1f%s",
+                   objects[0], objects[1], objects[2], objects[3], objects[4], objects[5],
+                   objects[6], objects[7], (long long) sfstmt->multi_stmt_count, objects[8],
+                   objects[9]);
+    }
+    _mutex_unlock(&sf->mutex_parameters);
+    return context;
+}
+
+/**
+ * @return the key of a query in the result cache, its SQL text and the bindings part of its
+ *         request body, to be freed by the caller, or NULL if out of memory.
+ */
+static char *STDCALL _snowflake_result_cache_key(const char *sql_text, const char *bindings) {
+    size_t sql_len = strlen(sql_text);
+    size_t bindings_len = strlen(bindings);
+    char *key = (char *) SF_MALLOC(sql_len + bindings_len + 2);
+    if (key) {
+        memcpy(key, sql_text, sql_len);
+        key[sql_len] = '\x1f';
+        memcpy(key + sql_len + 1, bindings, bindings_len + 1);
+    }
+    return key;
+}
+
+/**
+ * @return SF_BOOLEAN_TRUE if the response holds the results of a single read only query.
+ */
+static sf_bool STDCALL _snowflake_is_cacheable_result(cJSON *resp) {
+    int64 stmt_type_id;
+    cJSON *data = snowflake_cJSON_GetObjectItem(resp, "data");
+    if (json_copy_int(&stmt_type_id, data, "statementTypeId") != SF_JSON_ERROR_NONE) {
+        return SF_BOOLEAN_FALSE;
+    }
+    return (stmt_type_id & 0xf000) == _SF_STMT_TYPE_SELECT &&
+           !snowflake_cJSON_GetObjectItem(data, "resultIds");
+}
+
+/**
+ * Reads the response of a query request into the statement and hands its text to the capture.
+ */
+static SF_STATUS STDCALL _snowflake_read_query_response(SF_STMT *sfstmt, cJSON *resp,
+                                                       char *s_resp,
+                                                       SF_QUERY_RESULT_CAPTURE *result_capture,
+                                                       sf_bool is_put_get_command,
+                                                       sf_bool is_async_exec) {
+    SF_STATUS ret;
+    sf_bool capture_only = result_capture != NULL && result_capture->capture_only;
+
+    // Store the full query-response text in the capture buffer, if defined.
+    if (result_capture != NULL && s_resp != NULL) {
+        result_capture->capture_buffer = s_resp;
+        result_capture->actual_response_size = strlen(s_resp) + 1;
+    }
+
+    ret = _snowflake_process_query_response(sfstmt, resp, is_put_get_command, is_async_exec,
+                                            capture_only);
+    if (ret == SF_STATUS_SUCCESS && !is_async_exec && !is_put_get_command && !capture_only) {
+        ret = _snowflake_first_stmt_result(sfstmt, resp);
+    }
+    return ret;
+}
+
+SF_STATUS STDCALL _snowflake_execute_ex(SF_STMT *sfstmt,
+                                        sf_bool is_put_get_command,
+                                        SF_QUERY_RESULT_CAPTURE* result_capture,
+                                        sf_bool is_describe_only,
+                                        sf_bool is_async_exec) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+    cJSON *resp = NULL;
+    SF_HEADER *header = NULL;
+    char *s_body = NULL;
+    char *s_resp = NULL;
+    char *describe_context = NULL;
+    char *result_context = NULL;
+    char *result_key = NULL;
+    SF_RESPONSE_CACHE *result_cache = NULL;
+    sf_bool keep_response = SF_BOOLEAN_FALSE;
+    sf_bool capture_only = result_capture && result_capture->capture_only;
+    size_t bindings_offset;
+    uuid4_generate(sfstmt->request_id);
+    URL_KEY_VALUE url_params[] = {
+            {.key="requestId=", .value=sfstmt->request_id, .formatted_key=NULL, .formatted_value=NULL, .key_size=0, .value_size=0}
+    };
+    SF_JSON_WRITER body;
+    sf_json_writer_init(&body, SF_JSON_WRITER_INITIAL_SIZE);
+    body.budget = _snowflake_memory_budget(sfstmt);
+    SF_FREE(sfstmt->multi_stmt_result_ids);
+    sfstmt->multi_stmt_next_id = NULL;
+    char bind_stage[SF_BIND_STAGE_PATH_LEN];
+    char *bind_data = NULL;
+    size_t bind_data_len = 0;
+    sf_bool bind_uploaded = SF_BOOLEAN_FALSE;
+    uint64 bind_start;
+    SF_ARROW_BINDS *arrow_binds = (SF_ARROW_BINDS *) sfstmt->arrow_binds;
+    SF_TRACE_SPAN span;
+    cJSON *query_parameters;
+    SF_SCHEDULER_POOL *scheduler_pool;
+    sf_bool requested;
+
+    // The spans of the request, its polling and its results are children of this one
+    sf_span_start(&span, "query", NULL);
+    memcpy(span.request_id, sfstmt->request_id, SF_UUID4_LEN);
+    sf_span_context(&span, &sfstmt->trace);
+    sfstmt->trace_start_ns = span.start_time_ns;
+    sfstmt->first_row_traced = SF_BOOLEAN_FALSE;
+
+    _mutex_lock(&sfstmt->connection->mutex_sequence_counter);
+    sfstmt->sequence_counter = ++sfstmt->connection->sequence_counter;
+    _mutex_unlock(&sfstmt->connection->mutex_sequence_counter);
+
+    if (is_string_empty(sfstmt->connection->directURL) &&
+        (is_string_empty(sfstmt->connection->master_token) ||
+         is_string_empty(sfstmt->connection->token))) {
+        log_error(
+            "Missing session token or Master token. Are you sure that snowflake_connect was successful?");
+        SET_SNOWFLAKE_ERROR(&sfstmt->error,
+                            SF_STATUS_ERROR_BAD_CONNECTION_PARAMS,
+                            "Missing session or master token. Try running snowflake_connect.",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        goto cleanup;
+    }
+
+    // A transaction begun on the connection is started once it has a statement
+    if (!is_describe_only && _snowflake_start_pending_transaction(sfstmt) != SF_STATUS_SUCCESS) {
+        ret = sfstmt->error.error_code;
+        goto cleanup;
+    }
+
+    // A statement prepared again is described the way it was the last time
+    if (is_describe_only && sfstmt->connection->describe_cache && !is_put_get_command &&
+        !is_async_exec && !is_string_empty(sfstmt->sql_text)) {
+        describe_context = _snowflake_session_context(sfstmt);
+        s_resp = sf_response_cache_get(sfstmt->connection->describe_cache, sfstmt->sql_text,
+                                       describe_context);
+        if (s_resp) {
+            resp = capture_only ? sf_json_parse_without_rowset(s_resp, strlen(s_resp)) :
+                   snowflake_cJSON_Parse(s_resp);
+            if (resp) {
+                log_debug("Using the cached description of the statement");
+                ret = _snowflake_read_query_response(sfstmt, resp, s_resp, result_capture,
+                                                     is_put_get_command, is_async_exec);
+                goto cleanup;
+            }
+            SF_FREE(s_resp);
+        }
+    }
+
+    if (sfstmt->params && arrow_binds) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "An Arrow batch can't be bound with other parameters",
+                                 SF_SQLSTATE_FUNCTION_SEQUENCE_ERROR, sfstmt->sfqid);
+        ret = SF_STATUS_ERROR_BAD_REQUEST;
+        goto cleanup;
+    }
+
+    // Large array binds are uploaded to a stage as CSV and the query only refers to it
+    if (arrow_binds && arrow_binds->row_count > 1 && sfstmt->bind_upload_threshold > 0 &&
+        arrow_binds->column_count * (uint64) arrow_binds->row_count >=
+        sfstmt->bind_upload_threshold && !is_put_get_command && !is_describe_only) {
+        bind_start = sf_monotonic_time_us();
+        bind_data = bind_upload_serialize_arrow(sfstmt, &bind_data_len);
+        sf_metric_record(SF_HISTOGRAM_BIND_SERIALIZE_TIME, sf_monotonic_time_us() - bind_start);
+        if (bind_data &&
+            bind_upload_put(sfstmt, bind_data, bind_data_len, bind_stage) == SF_STATUS_SUCCESS) {
+            bind_uploaded = SF_BOOLEAN_TRUE;
+        } else {
+            log_warn("Failed to upload the Arrow binds to a stage, sending them with the query");
+        }
+        SF_FREE(bind_data);
+    } else if (sfstmt->params && sfstmt->paramset_size > 1 &&
+               sfstmt->bind_upload_threshold > 0 &&
+               sfstmt->params_len * sfstmt->paramset_size >= sfstmt->bind_upload_threshold &&
+               !is_put_get_command && !is_describe_only) {
+        bind_start = sf_monotonic_time_us();
+        bind_data = bind_upload_serialize(sfstmt, &bind_data_len);
+        sf_metric_record(SF_HISTOGRAM_BIND_SERIALIZE_TIME, sf_monotonic_time_us() - bind_start);
+        if (bind_data &&
+            bind_upload_put(sfstmt, bind_data, bind_data_len, bind_stage) == SF_STATUS_SUCCESS) {
+            bind_uploaded = SF_BOOLEAN_TRUE;
+        } else {
+            log_warn("Failed to upload the binds to a stage, sending them with the query");
+        }
+        SF_FREE(bind_data);
+    }
+
+    // Create Body. The bindings are formatted straight into the body, large array binds
+    // would make a large cJSON tree otherwise.
+    sf_json_writer_begin_object(&body);
+    query_parameters = sfstmt->query_parameters ?
+                       snowflake_cJSON_Parse(sfstmt->query_parameters) : NULL;
+    write_query_json_body(&body, sfstmt->sql_text, sfstmt->sequence_counter,
+                          is_string_empty(sfstmt->connection->directURL) ?
+                          NULL : sfstmt->request_id, is_describe_only, is_async_exec,
+                          sfstmt->multi_stmt_count, sfstmt->query_result_format,
+                          _snowflake_result_chunk_size(sfstmt), query_parameters);
+    snowflake_cJSON_Delete(query_parameters);
+    bindings_offset = body.len;
+    if (bind_uploaded) {
+        sf_json_writer_key(&body, "bindStage");
+        sf_json_writer_string(&body, bind_stage);
+    } else if (sfstmt->params) {
+        /* binding parameters if exists */
+        bind_start = sf_monotonic_time_us();
+        _snowflake_write_bindings(sfstmt, &body);
+        sf_metric_record(SF_HISTOGRAM_BIND_SERIALIZE_TIME, sf_monotonic_time_us() - bind_start);
+    } else if (arrow_binds) {
+        bind_start = sf_monotonic_time_us();
+        _snowflake_write_arrow_bindings(sfstmt, &body);
+        sf_metric_record(SF_HISTOGRAM_BIND_SERIALIZE_TIME, sf_monotonic_time_us() - bind_start);
+    }
+    sf_json_writer_end_object(&body);
+    if (body.over_budget) {
+        log_error("The query request body grew over the memory limit of the statement or of "
+                  "its connection");
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "The query request body is over the memory limit",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        ret = SF_STATUS_ERROR_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+    s_body = sf_json_writer_finish(&body);
+    if (!s_body) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Out of memory while creating the query request body",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        goto cleanup;
+    }
+    log_debug("Created body");
+    log_trace("Here is constructed body:\n%s", s_body);
+
+    // The same read only query may have just been run, from this connection or another one.
+    // Binds uploaded to a stage are in a new file every time.
+    if (!is_describe_only && !is_put_get_command && !is_async_exec && !bind_uploaded &&
+        (result_cache = _snowflake_result_cache_acquire()) != NULL) {
+        result_context = _snowflake_session_context(sfstmt);
+        result_key = _snowflake_result_cache_key(sfstmt->sql_text, s_body + bindings_offset);
+        s_resp = sf_response_cache_get(result_cache, result_key, result_context);
+        if (s_resp) {
+            resp = capture_only ? sf_json_parse_without_rowset(s_resp, strlen(s_resp)) :
+                   snowflake_cJSON_Parse(s_resp);
+            if (resp) {
+                log_debug("Using the cached results of the query");
+                ret = _snowflake_read_query_response(sfstmt, resp, s_resp, result_capture,
+                                                     is_put_get_command, is_async_exec);
+                goto cleanup;
+            }
+            SF_FREE(s_resp);
+        }
+    }
+
+    // The text of the response is only kept for the capture and the caches
+    keep_response = result_capture || describe_context || (result_key && result_context);
+    if (is_async_exec || sf_span_active(&span) || keep_response) {
+        // The response of an asynchronous query is returned as is, without polling for the
+        // results. A traced query times its request and polling.
+        header = sf_header_create();
+        header->use_application_json_accept_type = is_put_get_command;
+        header->async_exec = is_async_exec;
+        header->trace = sf_span_active(&span) ? &sfstmt->trace : NULL;
+        header->keep_raw_response = keep_response;
+        header->skip_rowset = capture_only;
+        if (!create_header(sfstmt->connection, header, &sfstmt->error)) {
+            ret = sfstmt->error.error_code;
+            goto cleanup;
+        }
+    }
+
+    char* queryURL = is_string_empty(sfstmt->connection->directURL) ?
+                     QUERY_URL : sfstmt->connection->directURL;
+    int url_paramSize = is_string_empty(sfstmt->connection->directURL) ?
+                        sizeof(url_params) / sizeof(URL_KEY_VALUE) : 0;
+    // The slot is held while the server runs the query, the results are downloaded with
+    // slots of their own
+    scheduler_pool = sf_scheduler_pool(sfstmt->connection->account,
+                                       sfstmt->connection->warehouse);
+    sf_scheduler_acquire(scheduler_pool, SF_SCHEDULER_QUERIES, sfstmt->query_priority);
+    requested = request(sfstmt->connection, &resp, queryURL, url_params,
+                       url_paramSize , s_body, header,
+                       POST_REQUEST_TYPE, &sfstmt->error, is_put_get_command);
+    sf_scheduler_release(scheduler_pool, SF_SCHEDULER_QUERIES);
+    if (requested) {
+        // s_resp will be freed by snowflake_query_result_capture_term
+        if (header && header->raw_response) {
+            s_resp = header->raw_response;
+            header->raw_response = NULL;
+        } else if (keep_response) {
+            s_resp = snowflake_cJSON_PrintUnformatted(resp);
+        }
+        if (SF_LOG_ENABLED(SF_LOG_TRACE)) {
+            char *s_trace = s_resp ? s_resp : snowflake_cJSON_PrintUnformatted(resp);
+            log_trace("Here is JSON response:\n%s", s_trace);
+            if (s_trace != s_resp) {
+                SF_FREE(s_trace);
+            }
+        }
+
+        ret = _snowflake_read_query_response(sfstmt, resp, s_resp, result_capture,
+                                             is_put_get_command, is_async_exec);
+        if (ret == SF_STATUS_SUCCESS && describe_context) {
+            sf_response_cache_put(sfstmt->connection->describe_cache, sfstmt->sql_text,
+                                  describe_context, s_resp);
+        }
+        if (ret == SF_STATUS_SUCCESS && result_key && result_context &&
+            _snowflake_is_cacheable_result(resp)) {
+            sf_response_cache_put(result_cache, result_key, result_context, s_resp);
+        }
+    } else {
+        log_trace("Connection failed");
+        // Set the return status to the error code
+        // that we got from the connection layer
+        ret = sfstmt->error.error_code;
+    }
+
+cleanup:
+    sf_json_writer_free(&body);
+    sf_header_destroy(header);
+    snowflake_cJSON_Delete(resp);
+    SF_FREE(s_body);
+    SF_FREE(describe_context);
+    SF_FREE(result_context);
+    SF_FREE(result_key);
+    sf_response_cache_release(result_cache);
+    if (result_capture == NULL) {
+        // If no result capture, we always free s_resp
+        SF_FREE(s_resp);
+    }
+    // Caller should always call result_capture_term to free s_resp,
+    // if result_capture is not NULL
+    memcpy(span.sfqid, sfstmt->sfqid, SF_UUID4_LEN);
+    memcpy(sfstmt->trace.sfqid, sfstmt->sfqid, SF_UUID4_LEN);
+    sf_span_end(&span, ret);
+
+    return ret;
+}
+
+/**
+ * Returns SF_BOOLEAN_TRUE if the query id fits in the URL buffers.
+ */
+static sf_bool STDCALL _snowflake_is_valid_query_id(const char *query_id) {
+    return !is_string_empty(query_id) && strlen(query_id) < SF_UUID4_LEN;
+}
+
+SF_STATUS STDCALL snowflake_execute_async(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (_is_put_get_command(sfstmt->sql_text)) {
+        clear_snowflake_error(&sfstmt->error);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "PUT and GET commands can't be executed asynchronously",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    return _snowflake_execute_ex(sfstmt, SF_BOOLEAN_FALSE, NULL, SF_BOOLEAN_FALSE,
+                                 SF_BOOLEAN_TRUE);
+}
+
+static const struct {
+    const char *name;
+    SF_QUERY_STATUS status;
+} query_status_names[] = {
+    {"RUNNING", SF_QUERY_STATUS_RUNNING},
+    {"ABORTING", SF_QUERY_STATUS_ABORTING},
+    {"SUCCESS", SF_QUERY_STATUS_SUCCESS},
+    {"FAILED_WITH_ERROR", SF_QUERY_STATUS_FAILED_WITH_ERROR},
+    {"ABORTED", SF_QUERY_STATUS_ABORTED},
+    {"QUEUED", SF_QUERY_STATUS_QUEUED},
+    {"FAILED_WITH_INCIDENT", SF_QUERY_STATUS_FAILED_WITH_INCIDENT},
+    {"DISCONNECTED", SF_QUERY_STATUS_DISCONNECTED},
+    {"RESUMING_WAREHOUSE", SF_QUERY_STATUS_RESUMING_WAREHOUSE},
+    {"QUEUED_REPARING_WAREHOUSE", SF_QUERY_STATUS_QUEUED_REPAIRING_WAREHOUSE},
+    {"RESTARTED", SF_QUERY_STATUS_RESTARTED},
+    {"BLOCKED", SF_QUERY_STATUS_BLOCKED},
+    {"NO_DATA", SF_QUERY_STATUS_NO_DATA},
+};
+
+SF_STATUS STDCALL snowflake_query_status(SF_CONNECT *sf, const char *query_id,
+                                         SF_QUERY_STATUS *status) {
+    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
+    char url[sizeof(QUERY_MONITORING_URL) + SF_UUID4_LEN];
+    cJSON *resp = NULL;
+    cJSON *query = NULL;
+    const char *name;
+    sf_bool success = SF_BOOLEAN_FALSE;
+    size_t i;
+
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    clear_snowflake_error(&sf->error);
+    if (!status || !_snowflake_is_valid_query_id(query_id)) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_REQUEST,
+                            "Invalid query id", SF_SQLSTATE_GENERAL_ERROR);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+
+    sb_sprintf(url, sizeof(url), QUERY_MONITORING_URL, query_id);
+    if (!request(sf, &resp, url, NULL, 0, NULL, NULL, GET_REQUEST_TYPE, &sf->error,
+                 SF_BOOLEAN_FALSE)) {
+        ret = sf->error.error_code;
+        goto cleanup;
+    }
+    if (json_copy_bool(&success, resp, "success") != SF_JSON_ERROR_NONE || !success) {
+        SET_SNOWFLAKE_ERROR(&sf->error, SF_STATUS_ERROR_BAD_RESPONSE,
+                            "Failed to get the status of the query",
+                            SF_SQLSTATE_GENERAL_ERROR);
+        ret = SF_STATUS_ERROR_BAD_RESPONSE;
+        goto cleanup;
+    }
+
+    // The monitoring endpoint has no entry for queries it doesn't know about
+    query = snowflake_cJSON_GetArrayItem(snowflake_cJSON_GetObjectItem(
+        snowflake_cJSON_GetObjectItem(resp, "data"), "queries"), 0);
+    if (!query) {
+        *status = SF_QUERY_STATUS_NO_DATA;
+    } else {
+        *status = SF_QUERY_STATUS_UNKNOWN;
+        name = snowflake_cJSON_GetStringValue(snowflake_cJSON_GetObjectItem(query, "status"));
+        for (i = 0; name && i < sizeof(query_status_names) / sizeof(query_status_names[0]); i++) {
+            if (strcmp(name, query_status_names[i].name) == 0) {
+                *status = query_status_names[i].status;
+                break;
+            }
+        }
+    }
+    ret = SF_STATUS_SUCCESS;
+
+cleanup:
+    snowflake_cJSON_Delete(resp);
+    return ret;
+}
+
+sf_bool STDCALL snowflake_query_status_is_running(SF_QUERY_STATUS status) {
+    switch (status) {
+        case SF_QUERY_STATUS_RUNNING:
+        case SF_QUERY_STATUS_QUEUED:
+        case SF_QUERY_STATUS_RESUMING_WAREHOUSE:
+        case SF_QUERY_STATUS_QUEUED_REPAIRING_WAREHOUSE:
+        case SF_QUERY_STATUS_NO_DATA:
+            return SF_BOOLEAN_TRUE;
+        default:
+            return SF_BOOLEAN_FALSE;
+    }
+}
+
+SF_STATUS STDCALL snowflake_get_results(SF_STMT *sfstmt, const char *query_id) {
+    return snowflake_get_results_from_chunk(sfstmt, query_id, 0);
+}
+
+SF_STATUS STDCALL snowflake_get_results_from_chunk(SF_STMT *sfstmt, const char *query_id,
+                                                   int64 start_chunk) {
+    char qid[SF_UUID4_LEN];
+
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    if (start_chunk < 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "Invalid chunk index", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+    if (!query_id) {
+        query_id = sfstmt->sfqid;
+    }
+    if (!_snowflake_is_valid_query_id(query_id)) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_REQUEST,
+                                 "Invalid query id", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+
+    // The id may be the one of the statement, which the reset clears
+    sb_strncpy(qid, SF_UUID4_LEN, query_id, SF_UUID4_LEN);
+    _snowflake_stmt_reset(sfstmt);
+    sfstmt->result_start_chunk = start_chunk;
+    return _snowflake_get_query_result(sfstmt, qid, SF_BOOLEAN_FALSE);
+}
+
+SF_ERROR_STRUCT *STDCALL snowflake_error(SF_CONNECT *sf) {
+    if (!sf) {
+        return NULL;
+    }
+    return &sf->error;
+}
+
+SF_ERROR_STRUCT *STDCALL snowflake_stmt_error(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return NULL;
+    }
+    return &sfstmt->error;
+}
+
+int64 STDCALL snowflake_num_rows(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return -1;
+    }
+
+    return sfstmt->total_rowcount;
+}
+
+int64 STDCALL snowflake_chunk_index(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return -1;
+    }
+
+    return sfstmt->chunk_index;
+}
+
+int64 STDCALL snowflake_num_fields(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return -1;
+    }
+    return sfstmt->total_fieldcount;
+}
+
+uint64 STDCALL snowflake_num_params(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        // TODO change to -1?
+        return 0;
+    }
+    return sfstmt->params_len;
+}
+
+const char *STDCALL snowflake_sfqid(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return NULL;
+    }
+    return sfstmt->sfqid;
+}
+
+const char *STDCALL snowflake_sqlstate(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return NULL;
+    }
+    return sfstmt->error.sqlstate;
+}
+
+SF_COLUMN_DESC *STDCALL snowflake_desc(SF_STMT *sfstmt) {
+    if (!sfstmt) {
+        return NULL;
+    }
+    return sfstmt->desc;
+}
+
+SF_STATUS STDCALL snowflake_stmt_get_attr(
+    SF_STMT *sfstmt, SF_STMT_ATTRIBUTE type, void **value) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    switch(type) {
+        case SF_STMT_USER_REALLOC_FUNC:
+            *value = sfstmt->user_realloc_func;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_THREADS:
+            *value = &sfstmt->chunk_downloader_threads;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_FETCH_SLOTS:
+            *value = &sfstmt->chunk_downloader_fetch_slots;
+            break;
+        case SF_STMT_UNORDERED_FETCH:
+            *value = &sfstmt->unordered_fetch;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_MEMORY_LIMIT:
+            *value = &sfstmt->chunk_downloader_memory_limit;
+            break;
+        case SF_STMT_RESULT_CHUNK_SIZE:
+            *value = &sfstmt->result_chunk_size;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_MULTIPLEX:
+            *value = &sfstmt->chunk_downloader_multiplex;
+            break;
+        case SF_STMT_CHUNK_STREAMING_DECODE:
+            *value = &sfstmt->chunk_streaming_decode;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_HEDGING:
+            *value = &sfstmt->chunk_downloader_hedging;
+            break;
+        case SF_STMT_CHUNK_DECODER_INFLATE:
+            *value = &sfstmt->chunk_decoder_inflate;
+            break;
+        case SF_STMT_CHUNK_COMPRESSED_PREFETCH:
+            *value = &sfstmt->chunk_compressed_prefetch;
+            break;
+        case SF_STMT_JSON_TO_ARROW:
+            *value = &sfstmt->json_to_arrow;
+            break;
+        case SF_STMT_SCROLLABLE:
+            *value = &sfstmt->scrollable;
+            break;
+        case SF_STMT_SCROLL_CACHE_MEMORY_LIMIT:
+            *value = &sfstmt->scroll_cache_memory_limit;
+            break;
+        case SF_STMT_SCROLL_CACHE_DISK_LIMIT:
+            *value = &sfstmt->scroll_cache_disk_limit;
+            break;
+        case SF_STMT_MEMORY_LIMIT:
+            *value = &sfstmt->memory_budget.limit;
+            break;
+        case SF_STMT_QUERY_PRIORITY:
+            *value = &sfstmt->query_priority;
+            break;
+        case SF_STMT_PARAMSET_SIZE:
+            *value = &sfstmt->paramset_size;
+            break;
+        case SF_STMT_BIND_UPLOAD_THRESHOLD:
+            *value = &sfstmt->bind_upload_threshold;
+            break;
+        case SF_STMT_MULTI_STMT_COUNT:
+            *value = &sfstmt->multi_stmt_count;
+            break;
+        case SF_STMT_QUERY_RESULT_FORMAT:
+            *value = sfstmt->query_result_format;
+            break;
+        case SF_STMT_QUERY_PARAMETERS:
+            *value = sfstmt->query_parameters;
+            break;
+        default:
+            SET_SNOWFLAKE_ERROR(
+                &sfstmt->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
+                "Invalid attribute type",
+                SF_SQLSTATE_UNABLE_TO_CONNECT);
+            return SF_STATUS_ERROR_APPLICATION_ERROR;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Replaces a string attribute of a statement with a copy of the value, NULL clearing it.
+ */
+static SF_STATUS _snowflake_stmt_set_string(SF_STMT *sfstmt, char **attribute,
+                                            const char *value) {
+    char *copy = NULL;
+    size_t len;
+
+    if (value) {
+        len = strlen(value);
+        if (!(copy = (char *) SF_MALLOC(len + 1))) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                     "Out of memory while setting a statement attribute",
+                                     SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+            return SF_STATUS_ERROR_OUT_OF_MEMORY;
+        }
+        memcpy(copy, value, len + 1);
+    }
+    SF_FREE(*attribute);
+    *attribute = copy;
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * @return whether the text is a JSON object of strings, booleans and integers.
+ */
+static sf_bool _snowflake_query_parameters_valid(const char *text) {
+    cJSON *parameters = snowflake_cJSON_Parse(text);
+    cJSON *parameter;
+    sf_bool valid = parameters && snowflake_cJSON_IsObject(parameters) ?
+                    SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+
+    for (parameter = valid ? parameters->child : NULL; parameter; parameter = parameter->next) {
+        if (!snowflake_cJSON_IsString(parameter) && !snowflake_cJSON_IsBool(parameter) &&
+            !(snowflake_cJSON_IsNumber(parameter) &&
+              parameter->valuedouble == (double) (int64) parameter->valuedouble)) {
+            valid = SF_BOOLEAN_FALSE;
+            break;
+        }
+    }
+    snowflake_cJSON_Delete(parameters);
+    return valid;
+}
+
+SF_STATUS STDCALL snowflake_stmt_set_attr(
+    SF_STMT *sfstmt, SF_STMT_ATTRIBUTE type, const void *value) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    switch(type) {
+        case SF_STMT_USER_REALLOC_FUNC:
+            sfstmt->user_realloc_func = (void*(*)(void*, size_t))value;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_THREADS:
+            sfstmt->chunk_downloader_threads = value ?
+                *((uint64 *) value) : sfstmt->connection->chunk_downloader_threads;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_FETCH_SLOTS:
+            sfstmt->chunk_downloader_fetch_slots = value ?
+                *((uint64 *) value) : sfstmt->connection->chunk_downloader_fetch_slots;
+            break;
+        case SF_STMT_UNORDERED_FETCH:
+            sfstmt->unordered_fetch = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_MEMORY_LIMIT:
+            sfstmt->chunk_downloader_memory_limit = value ?
+                *((uint64 *) value) : sfstmt->connection->chunk_downloader_memory_limit;
+            break;
+        case SF_STMT_RESULT_CHUNK_SIZE:
+            sfstmt->result_chunk_size = value ?
+                *((uint64 *) value) : sfstmt->connection->result_chunk_size;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_MULTIPLEX:
+            sfstmt->chunk_downloader_multiplex = value ?
+                *((sf_bool *) value) : sfstmt->connection->chunk_downloader_multiplex;
+            break;
+        case SF_STMT_CHUNK_STREAMING_DECODE:
+            sfstmt->chunk_streaming_decode = value ?
+                *((sf_bool *) value) : sfstmt->connection->chunk_streaming_decode;
+            break;
+        case SF_STMT_CHUNK_DOWNLOADER_HEDGING:
+            sfstmt->chunk_downloader_hedging = value ?
+                *((sf_bool *) value) : sfstmt->connection->chunk_downloader_hedging;
+            break;
+        case SF_STMT_CHUNK_DECODER_INFLATE:
+            sfstmt->chunk_decoder_inflate = value ?
+                *((sf_bool *) value) : sfstmt->connection->chunk_decoder_inflate;
+            break;
+        case SF_STMT_CHUNK_COMPRESSED_PREFETCH:
+            sfstmt->chunk_compressed_prefetch = value ?
+                *((sf_bool *) value) : sfstmt->connection->chunk_compressed_prefetch;
+            break;
+        case SF_STMT_JSON_TO_ARROW:
+            sfstmt->json_to_arrow = value ?
+                *((sf_bool *) value) : sfstmt->connection->json_to_arrow;
+            break;
+        case SF_STMT_SCROLLABLE:
+            sfstmt->scrollable = value ? *((sf_bool *) value) : SF_BOOLEAN_FALSE;
+            break;
+        case SF_STMT_SCROLL_CACHE_MEMORY_LIMIT:
+            sfstmt->scroll_cache_memory_limit = value ?
+                *((uint64 *) value) : SF_DEFAULT_SCROLL_CACHE_MEMORY_LIMIT;
+            break;
+        case SF_STMT_SCROLL_CACHE_DISK_LIMIT:
+            sfstmt->scroll_cache_disk_limit = value ? *((uint64 *) value) : 0;
+            break;
+        case SF_STMT_MEMORY_LIMIT:
+            sfstmt->memory_budget.limit = value ?
+                *((uint64 *) value) : sfstmt->connection->statement_memory_limit;
+            break;
+        case SF_STMT_QUERY_PRIORITY:
+            sfstmt->query_priority = value ?
+                *((SF_QUERY_PRIORITY *) value) : sfstmt->connection->query_priority;
+            break;
+        case SF_STMT_PARAMSET_SIZE:
+            sfstmt->paramset_size = value && *((uint64 *) value) > 0 ?
+                *((uint64 *) value) : 1;
+            break;
+        case SF_STMT_BIND_UPLOAD_THRESHOLD:
+            sfstmt->bind_upload_threshold = value ?
+                *((uint64 *) value) : SF_DEFAULT_BIND_UPLOAD_THRESHOLD;
+            break;
+        case SF_STMT_MULTI_STMT_COUNT:
+            sfstmt->multi_stmt_count = value ? *((int64 *) value) : 1;
+            break;
+        case SF_STMT_QUERY_RESULT_FORMAT:
+            return _snowflake_stmt_set_string(sfstmt, &sfstmt->query_result_format,
+                                              (const char *) value);
+        case SF_STMT_QUERY_PARAMETERS:
+            if (value && !_snowflake_query_parameters_valid((const char *) value)) {
+                SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_JSON,
+                                         "The query parameters have to be a JSON object of "
+                                         "strings, booleans and integers",
+                                         SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+                return SF_STATUS_ERROR_BAD_JSON;
+            }
+            return _snowflake_stmt_set_string(sfstmt, &sfstmt->query_parameters,
+                                              (const char *) value);
+        default:
+            SET_SNOWFLAKE_ERROR(
+                &sfstmt->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
+                "Invalid attribute type",
+                SF_SQLSTATE_UNABLE_TO_CONNECT);
+            return SF_STATUS_ERROR_APPLICATION_ERROR;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL snowflake_propagate_error(SF_CONNECT *sf, SF_STMT *sfstmt) {
+    if (!sf) {
+        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+    }
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    // Statements running concurrently on the connection may fail at the same time
+    _mutex_lock(&sf->mutex_parameters);
+    if (sf->error.error_code) {
+        /* if already error is set */
+        SF_FREE(sf->error.msg);
+    }
+    sb_memcpy(&sf->error, sizeof(SF_ERROR_STRUCT), &sfstmt->error, sizeof(SF_ERROR_STRUCT));
+    if (sfstmt->error.error_code) {
+        /* any error */
+        size_t len = strlen(sfstmt->error.msg);
+        sf->error.msg = SF_CALLOC(len + 1, sizeof(char));
+        if (sf->error.msg == NULL) {
+            SET_SNOWFLAKE_ERROR(
+                &sf->error,
+                SF_STATUS_ERROR_OUT_OF_MEMORY,
+                "Out of memory in creating a buffer for the error message.",
+                SF_SQLSTATE_APP_REJECT_CONNECTION);
+        }
+        sb_strncpy(sf->error.msg, len + 1, sfstmt->error.msg, len);
+    }
+    _mutex_unlock(&sf->mutex_parameters);
+    return SF_STATUS_SUCCESS;
+}
+
+// Does NULL checking and clears the SF_STMT error struct
+SF_STATUS STDCALL _snowflake_column_null_checks(SF_STMT *sfstmt, void *value_ptr) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    if (value_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "value_ptr must not be NULL", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+
+    return SF_STATUS_SUCCESS;
+}
+
+// Reads a column of the current row from the values converted by the materializer
+static SF_STATUS STDCALL _snowflake_materialized_value(SF_STMT *sfstmt, int idx, SF_C_TYPE type,
+                                                       void *value_ptr) {
+    SF_MATERIALIZER *materializer = (SF_MATERIALIZER *) sfstmt->materializer;
+    SF_MATERIALIZED_COLUMN *column;
+    int64 row = SF_MATERIALIZER_ROW(materializer);
+    SF_STATUS status;
+
+    if ((status = sf_materializer_column(materializer, idx, type, &column)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    switch (type) {
+        case SF_C_TYPE_INT64:
+            *(int64 *) value_ptr = ((int64 *) column->values)[row];
+            break;
+        case SF_C_TYPE_UINT64:
+            *(uint64 *) value_ptr = ((uint64 *) column->values)[row];
+            break;
+        case SF_C_TYPE_FLOAT64:
+            *(float64 *) value_ptr = ((float64 *) column->values)[row];
+            break;
+        case SF_C_TYPE_BOOLEAN:
+            *(sf_bool *) value_ptr = ((sf_bool *) column->values)[row];
+            break;
+        case SF_C_TYPE_STRING:
+            *(const char **) value_ptr = column->is_null[row] ? NULL : column->text + column->offsets[row];
+            break;
+        default:
+            *(sf_bool *) value_ptr = column->is_null[row];
+            break;
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+// The materializer only serves the types columns can be registered with
+static SF_STATUS STDCALL _snowflake_materialized_unsupported(SF_STMT *sfstmt) {
+    SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE,
+                             "Type is not served by the column conversion.",
+                             SF_SQLSTATE_INVALID_DATA_TYPE_IN_APPLICATION_DESCRIPTOR, sfstmt->sfqid);
+    return SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
+}
+
+SF_STATUS STDCALL _snowflake_next(SF_STMT *sfstmt) {
+    return STMT_RS_ACCESSORS(sfstmt)->next(sfstmt->result_set);
+}
+
+SF_STATUS STDCALL snowflake_column_as_boolean(SF_STMT *sfstmt, int idx, sf_bool *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_BOOLEAN, (void *) value_ptr);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_bool(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_uint8(SF_STMT *sfstmt, int idx, uint8 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_uint8(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_uint32(SF_STMT *sfstmt, int idx, uint32 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_uint32(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_uint64(SF_STMT *sfstmt, int idx, uint64 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_UINT64, (void *) value_ptr);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_uint64(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_int8(SF_STMT *sfstmt, int idx, int8 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_int8(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_int32(SF_STMT *sfstmt, int idx, int32 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_int32(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_int64(SF_STMT *sfstmt, int idx, int64 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_INT64, (void *) value_ptr);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_int64(
+            sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_float32(SF_STMT *sfstmt, int idx, float32 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_float32(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_float64(SF_STMT *sfstmt, int idx, float64 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_FLOAT64, (void *) value_ptr);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_float64(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_timestamp(SF_STMT *sfstmt, int idx, SF_TIMESTAMP *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_timestamp(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_const_str(SF_STMT *sfstmt, int idx, const char **value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_STRING, (void *) value_ptr);
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_const_string(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_column_as_str_view(SF_STMT *sfstmt, int idx, const char **value_ptr, size_t *value_len_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (value_len_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "value_len_ptr must not be NULL", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    if (sfstmt->materializer) {
+        status = _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_STRING, (void *) value_ptr);
+        *value_len_ptr = (status == SF_STATUS_SUCCESS && *value_ptr) ? strlen(*value_ptr) : 0;
+        return status;
+    }
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_str_view(
+        sfstmt->result_set, idx, value_ptr, value_len_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_raw_value_to_str_rep(SF_STMT *sfstmt, const char* const_str_val, const SF_DB_TYPE type, const char *connection_timezone,
+                                                 int32 scale, sf_bool isNull, char **value_ptr, size_t *value_len_ptr, size_t *max_value_size_ptr){
+
+    if (value_ptr == NULL) {
+      return SF_STATUS_ERROR_NULL_POINTER;
+    }
+
+    SF_STATUS status;
+
+    char *value = NULL;
+    size_t max_value_size = 0;
+    size_t init_value_len = 0;
+    size_t value_len = 0;
+    sf_bool preallocated = SF_BOOLEAN_FALSE;
+
+    // If value_ptr isn't null and max_value_size exists and is greater than 0,
+    // then the user passed in a buffer and we should reallocate if needed
+    if (*value_ptr != NULL && max_value_size_ptr != NULL && *max_value_size_ptr != 0) {
+        value = *value_ptr;
+        init_value_len = *max_value_size_ptr;
+        preallocated = SF_BOOLEAN_TRUE;
+    }
+
+
+    if (isNull == SF_BOOLEAN_TRUE) {
+      // If value is NULL, allocate buffer for empty string
+      if (init_value_len == 0) {
+        value = global_hooks.calloc(1, 1);
+        max_value_size = 1;
+      } else {
+        // If we don't need to allocate a buffer, set value len to the initial value len
+        max_value_size = init_value_len;
+      }
+      sb_strncpy(value, max_value_size, "", 1);
+      value_len = 0;
+      status = SF_STATUS_SUCCESS;
+      goto cleanup;
+    }
+
+    time_t sec = 0L;
+    struct tm tm_obj;
+    struct tm *tm_ptr;
+    memset(&tm_obj, 0, sizeof(tm_obj));
+
+    SF_ERROR_STRUCT *error = (sfstmt != NULL ? &sfstmt->error : NULL);
+    char *sfqid = sfstmt != NULL ? sfstmt->sfqid : NULL;
+
+    switch (type) {
+      case SF_DB_TYPE_BOOLEAN: ;
+        const char *bool_value;
+        if (strcmp(const_str_val, "0") == 0) {
+          /* False */
+          bool_value = SF_BOOLEAN_FALSE_STR;
+        } else {
+          /* True */
+          bool_value = SF_BOOLEAN_TRUE_STR;
+        }
+        value_len = strlen(bool_value);
+        if (value_len + 1 > init_value_len) {
+          if (preallocated) {
+            value = global_hooks.realloc(value, value_len + 1);
+          } else {
+            value = global_hooks.calloc(1, value_len + 1);
+          }
+          // If we have to allocate memory, then we need to set max_value_size
+          // otherwise we leave max_value_size as is
+          max_value_size = value_len + 1;
+        } else {
+          max_value_size = init_value_len;
+        }
+        sb_strncpy(value, max_value_size, bool_value, value_len + 1);
+        break;
+      case SF_DB_TYPE_DATE:
+        sec =
+                (time_t) strtol(const_str_val, NULL, 10) *
+                86400L;
+        _mutex_lock(&gmlocaltime_lock);
+        tm_ptr = sf_gmtime(&sec, &tm_obj);
+        _mutex_unlock(&gmlocaltime_lock);
+        if (tm_ptr == NULL) {
+          SET_SNOWFLAKE_STMT_ERROR(error,
+                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
+                                   "Failed to convert a date value to a string.",
+                                   SF_SQLSTATE_GENERAL_ERROR,
+                                   sfqid);
+          value = NULL;
+          max_value_size = 0;
+          goto cleanup;
+        }
+        // Max size of date string
+        value_len = DATE_STRING_MAX_SIZE;
+        if (value_len + 1 > init_value_len) {
+          if (preallocated) {
+            value = global_hooks.realloc(value, value_len + 1);
+          } else {
+            value = global_hooks.calloc(1, value_len + 1);
+          }
+          // If we have to allocate memory, then we need to set max_value_size
+          // otherwise we leave max_value_size as is
+          max_value_size = value_len + 1;
+        } else {
+          max_value_size = init_value_len;
+        }
+        value_len = strftime(value, value_len + 1, "%Y-%m-%d", &tm_obj);
+        break;
+      case SF_DB_TYPE_TIME:
+      case SF_DB_TYPE_TIMESTAMP_NTZ:
+      case SF_DB_TYPE_TIMESTAMP_LTZ:
+      case SF_DB_TYPE_TIMESTAMP_TZ: ;
+        SF_TIMESTAMP ts;
+        // Without a scale it is taken from the digits of the fraction
+        if (snowflake_timestamp_from_epoch_seconds(&ts,
+                                                   const_str_val,
+                                                   connection_timezone,
+                                                   scale,
+                                                   type)) {
+          SET_SNOWFLAKE_STMT_ERROR(error,
+                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
+                                   "Failed to convert the response from the server into a SF_TIMESTAMP.",
+                                   SF_SQLSTATE_GENERAL_ERROR,
+                                   sfqid);
+          value = NULL;
+          max_value_size = 0;
+          goto cleanup;
+        }
+        // TODO add format when format is no longer a fixed string
+        if (snowflake_timestamp_to_string(&ts, "", &value, max_value_size, &value_len, SF_BOOLEAN_TRUE)) {
+          SET_SNOWFLAKE_STMT_ERROR(error,
+                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
+                                   "Failed to convert a SF_TIMESTAMP value to a string.",
+                                   SF_SQLSTATE_GENERAL_ERROR,
+                                   sfqid);
+          // If the memory wasn't preallocated, then free it
+          if (!preallocated && value) {
+            global_hooks.dealloc(value);
+            value = NULL;
+            max_value_size = 0;
+          }
+          value_len = 0;
+          goto cleanup;
+        } else {
+          // If true, then we reallocated when writing the timestamp to a string
+          if (value_len + 1 > init_value_len) {
+            max_value_size = value_len + 1;
+          } else {
+            max_value_size = init_value_len;
+          }
+        }
+
+        break;
+      default:
+        value_len = strlen(const_str_val);
+        if (value_len + 1 > init_value_len) {
+          if (preallocated) {
+            value = global_hooks.realloc(value, value_len + 1);
+          } else {
+            value = global_hooks.calloc(1, value_len + 1);
+          }
+          // If we have to allocate memory, then we need to set max_value_size
+          // otherwise we leave max_value_size as is
+          max_value_size = value_len + 1;
+        } else {
+          max_value_size = init_value_len;
+        }
+        sb_strncpy(value, max_value_size, const_str_val, value_len + 1);
+        break;
     }
 
-    // Everything went well if we got to this point
-    ret = SF_STATUS_SUCCESS;
+    // Everything went okay
+    status = SF_STATUS_SUCCESS;
 
 cleanup:
-    snowflake_cJSON_Delete(body);
-    snowflake_cJSON_Delete(resp);
-    SF_FREE(s_body);
-    SF_FREE(qrmk);
-    if (result_capture == NULL) {
-        // If no result capture, we always free s_resp
-        SF_FREE(s_resp);
+    *value_ptr = value;
+    if (max_value_size_ptr) {
+        *max_value_size_ptr = max_value_size;
     }
-    // Caller should always call result_capture_term to free s_resp,
-    // if result_capture is not NULL
-
-    return ret;
-}
-
-SF_ERROR_STRUCT *STDCALL snowflake_error(SF_CONNECT *sf) {
-    if (!sf) {
-        return NULL;
+    if (value_len_ptr) {
+        *value_len_ptr = value_len;
     }
-    return &sf->error;
+    return status;
 }
 
-SF_ERROR_STRUCT *STDCALL snowflake_stmt_error(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return NULL;
+/**
+ * Whether the string of a JSON cell of a type has to be converted, the
+ * others are given to the caller as they are.
+ */
+static sf_bool _snowflake_type_needs_formatting(SF_DB_TYPE type) {
+    switch (type) {
+        case SF_DB_TYPE_BOOLEAN:
+        case SF_DB_TYPE_DATE:
+        case SF_DB_TYPE_TIME:
+        case SF_DB_TYPE_TIMESTAMP_NTZ:
+        case SF_DB_TYPE_TIMESTAMP_LTZ:
+        case SF_DB_TYPE_TIMESTAMP_TZ:
+            return SF_BOOLEAN_TRUE;
+        default:
+            return SF_BOOLEAN_FALSE;
     }
-    return &sfstmt->error;
 }
 
-int64 STDCALL snowflake_num_rows(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return -1;
+/**
+ * Makes room for a string of the given size, terminator included, in the buffer of the
+ * caller, growing a buffer too small to at least twice its size.
+ */
+static SF_STATUS _snowflake_reserve_str_value(size_t size, char **value_ptr,
+                                              size_t *max_value_size_ptr) {
+    char *value = *value_ptr;
+    size_t max_value_size = 0;
+    if (value != NULL && max_value_size_ptr != NULL && *max_value_size_ptr != 0) {
+        max_value_size = *max_value_size_ptr;
+        if (size > max_value_size) {
+            size_t grown = max_value_size * 2;
+            max_value_size = grown > size ? grown : size;
+            value = global_hooks.realloc(value, max_value_size);
+        }
+    } else {
+        max_value_size = size;
+        value = global_hooks.calloc(1, max_value_size);
     }
-
-    return sfstmt->total_rowcount;
-}
-
-int64 STDCALL snowflake_num_fields(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return -1;
+    if (value == NULL) {
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
     }
-    return sfstmt->total_fieldcount;
-}
 
-uint64 STDCALL snowflake_num_params(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        // TODO change to -1?
-        return 0;
+    *value_ptr = value;
+    if (max_value_size_ptr) {
+        *max_value_size_ptr = max_value_size;
     }
-    ARRAY_LIST *p = (ARRAY_LIST *) sfstmt->params;
-    return p->used;
+    return SF_STATUS_SUCCESS;
 }
 
-const char *STDCALL snowflake_sfqid(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return NULL;
+/**
+ * Copy a cell string that needs no conversion to the buffer of the caller,
+ * as snowflake_raw_value_to_str_rep does. A buffer too small is grown to at
+ * least twice its size, so that a column of growing values doesn't take a
+ * realloc for each.
+ */
+static SF_STATUS _snowflake_copy_str_value(const char *str_val, char **value_ptr,
+                                           size_t *value_len_ptr, size_t *max_value_size_ptr) {
+    size_t value_len = strlen(str_val);
+    SF_STATUS status = _snowflake_reserve_str_value(value_len + 1, value_ptr,
+                                                    max_value_size_ptr);
+    if (status != SF_STATUS_SUCCESS) {
+        return status;
     }
-    return sfstmt->sfqid;
-}
-
-const char *STDCALL snowflake_sqlstate(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return NULL;
+    memcpy(*value_ptr, str_val, value_len + 1);
+    if (value_len_ptr) {
+        *value_len_ptr = value_len;
     }
-    return sfstmt->error.sqlstate;
+    return SF_STATUS_SUCCESS;
 }
 
-SF_COLUMN_DESC *STDCALL snowflake_desc(SF_STMT *sfstmt) {
-    if (!sfstmt) {
-        return NULL;
-    }
-    return sfstmt->desc;
-}
+SF_STATUS STDCALL snowflake_column_as_str(SF_STMT *sfstmt, int idx, char **value_ptr, size_t *value_len_ptr, size_t *max_value_size_ptr) {
+    SF_STATUS status;
 
-SF_STATUS STDCALL snowflake_stmt_get_attr(
-    SF_STMT *sfstmt, SF_STMT_ATTRIBUTE type, void **value) {
-    if (!sfstmt) {
-        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
-    clear_snowflake_error(&sfstmt->error);
-    switch(type) {
-        case SF_STMT_USER_REALLOC_FUNC:
-            *value = sfstmt->user_realloc_func;
-            break;
-        default:
-            SET_SNOWFLAKE_ERROR(
-                &sfstmt->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
-                "Invalid attribute type",
-                SF_SQLSTATE_UNABLE_TO_CONNECT);
-            return SF_STATUS_ERROR_APPLICATION_ERROR;
+    if (sfstmt->materializer) {
+        const char *materialized = NULL;
+        if ((status = _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_STRING,
+                                                    (void *) &materialized)) != SF_STATUS_SUCCESS) {
+            return status;
+        }
+        status = _snowflake_copy_str_value(materialized ? materialized : "", value_ptr,
+                                           value_len_ptr, max_value_size_ptr);
+        if (status != SF_STATUS_SUCCESS) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+                                     "Failed to allocate the string of a column.",
+                                     SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        }
+        return status;
     }
-    return SF_STATUS_SUCCESS;
-}
 
-SF_STATUS STDCALL snowflake_stmt_set_attr(
-    SF_STMT *sfstmt, SF_STMT_ATTRIBUTE type, const void *value) {
-    if (!sfstmt) {
-        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
-    }
-    clear_snowflake_error(&sfstmt->error);
-    switch(type) {
-        case SF_STMT_USER_REALLOC_FUNC:
-            sfstmt->user_realloc_func = (void*(*)(void*, size_t))value;
-            break;
-        default:
-            SET_SNOWFLAKE_ERROR(
-                &sfstmt->error, SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE,
-                "Invalid attribute type",
-                SF_SQLSTATE_UNABLE_TO_CONNECT);
-            return SF_STATUS_ERROR_APPLICATION_ERROR;
+    const char* str_val = NULL;
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_const_string(
+            sfstmt->result_set,
+            idx,
+            &str_val)) != SF_STATUS_SUCCESS)
+    {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+        return status;
     }
-    return SF_STATUS_SUCCESS;
-}
 
-SF_STATUS STDCALL snowflake_propagate_error(SF_CONNECT *sf, SF_STMT *sfstmt) {
-    if (!sf) {
-        return SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
-    }
-    if (!sfstmt) {
-        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    // For Arrow the const string is formatted already, for JSON only some
+    // types are to be converted
+    if (str_val != NULL &&
+        (ARROW_FORMAT == *((QueryResultFormat_t *)sfstmt->qrf) ||
+         !_snowflake_type_needs_formatting(sfstmt->desc[idx - 1].type)))
+    {
+        status = _snowflake_copy_str_value(str_val, value_ptr, value_len_ptr,
+                                           max_value_size_ptr);
+        if (status != SF_STATUS_SUCCESS) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+                                     "Failed to allocate the string of a column.",
+                                     SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        }
+        return status;
     }
-    if (sf->error.error_code) {
-        /* if already error is set */
-        SF_FREE(sf->error.msg);
+
+    if (ARROW_FORMAT == *((QueryResultFormat_t *)sfstmt->qrf))
+    {
+        return snowflake_raw_value_to_str_rep(sfstmt, str_val,
+                                             SF_DB_TYPE_TEXT,
+                                             sfstmt->connection->timezone,
+                                             0,
+                                             str_val ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE,
+                                             value_ptr, value_len_ptr,
+                                             max_value_size_ptr);
     }
-    sb_memcpy(&sf->error, sizeof(SF_ERROR_STRUCT), &sfstmt->error, sizeof(SF_ERROR_STRUCT));
-    if (sfstmt->error.error_code) {
-        /* any error */
-        size_t len = strlen(sfstmt->error.msg);
-        sf->error.msg = SF_CALLOC(len + 1, sizeof(char));
-        if (sf->error.msg == NULL) {
-            SET_SNOWFLAKE_ERROR(
-                &sf->error,
-                SF_STATUS_ERROR_OUT_OF_MEMORY,
-                "Out of memory in creating a buffer for the error message.",
-                SF_SQLSTATE_APP_REJECT_CONNECTION);
-        }
-        sb_strncpy(sf->error.msg, len + 1, sfstmt->error.msg, len);
+    else
+    {
+        return snowflake_raw_value_to_str_rep(sfstmt, str_val,
+                                              sfstmt->desc[idx - 1].type,
+                                              sfstmt->connection->timezone,
+                                              (int32) sfstmt->desc[idx - 1].scale,
+                                              str_val ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE,
+                                              value_ptr, value_len_ptr,
+                                              max_value_size_ptr);
     }
-    return SF_STATUS_SUCCESS;
 }
 
-// Does NULL checking and clears the SF_STMT error struct
-SF_STATUS STDCALL _snowflake_column_null_checks(SF_STMT *sfstmt, void *value_ptr) {
-    if (!sfstmt) {
-        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+SF_STATUS STDCALL snowflake_column_strlen(SF_STMT *sfstmt, int idx, size_t *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
-    clear_snowflake_error(&sfstmt->error);
-    if (value_ptr == NULL) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
-                                 "value_ptr must not be NULL", "", sfstmt->sfqid);
-        return SF_STATUS_ERROR_NULL_POINTER;
+    if (sfstmt->materializer) {
+        SF_MATERIALIZED_COLUMN *column;
+        SF_MATERIALIZER *materializer = (SF_MATERIALIZER *) sfstmt->materializer;
+        if ((status = sf_materializer_column(materializer, idx, SF_C_TYPE_STRING,
+                                             &column)) != SF_STATUS_SUCCESS) {
+            return status;
+        }
+        *value_ptr = column->lengths[SF_MATERIALIZER_ROW(materializer)];
+        return SF_STATUS_SUCCESS;
     }
 
-    return SF_STATUS_SUCCESS;
-}
-
-SF_STATUS STDCALL _snowflake_next(SF_STMT *sfstmt) {
-    return rs_next(sfstmt->result_set, (QueryResultFormat_t *) sfstmt->qrf);
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_strlen(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    }
+    return status;
 }
 
-SF_STATUS STDCALL snowflake_column_as_boolean(SF_STMT *sfstmt, int idx, sf_bool *value_ptr) {
+SF_STATUS STDCALL snowflake_column_get_path(SF_STMT *sfstmt, int idx, const char *path,
+                                            SF_JSON_VALUE_TYPE *type_ptr, char **value_ptr,
+                                            size_t *value_len_ptr, size_t *max_value_size_ptr) {
     SF_STATUS status;
+    SF_DB_TYPE type;
+    const char *text = NULL;
+    const char *value = NULL;
+    size_t value_len = 0;
 
     if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
+    if (!path || !type_ptr) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "path and type_ptr must not be NULL", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    if ((status = snowflake_column_as_const_str(sfstmt, idx, &text)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    type = sfstmt->desc[idx - 1].type;
+    if (type != SF_DB_TYPE_VARIANT && type != SF_DB_TYPE_OBJECT && type != SF_DB_TYPE_ARRAY) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_DATA_CONVERSION,
+                                 "Only a VARIANT, OBJECT or ARRAY column has paths",
+                                 SF_SQLSTATE_INVALID_DATA_TYPE, sfstmt->sfqid);
+        return SF_STATUS_ERROR_DATA_CONVERSION;
+    }
+
+    *type_ptr = SF_JSON_VALUE_NONE;
+    if (text) {
+        status = sf_json_path_find(text, strlen(text), path, type_ptr, &value, &value_len);
+        if (status == SF_STATUS_ERROR_BAD_REQUEST) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status, "The path can't be parsed",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+            return status;
+        }
+        if (status != SF_STATUS_SUCCESS) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status, "The value of the column isn't JSON",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+            return status;
+        }
+    }
 
-    if ((status = rs_get_cell_as_bool(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_reserve_str_value(value_len + 1, value_ptr,
+                                               max_value_size_ptr)) != SF_STATUS_SUCCESS) {
         SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+                                 "Failed to allocate the string of a column.",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return status;
     }
-    return status;
+    if (*type_ptr == SF_JSON_VALUE_STRING) {
+        if (!sf_json_unescape(value, value_len, *value_ptr, &value_len)) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_JSON,
+                                     "The value of the column isn't JSON",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+            return SF_STATUS_ERROR_BAD_JSON;
+        }
+    } else {
+        if (value_len > 0) {
+            memcpy(*value_ptr, value, value_len);
+        }
+        (*value_ptr)[value_len] = '\0';
+    }
+    if (value_len_ptr) {
+        *value_len_ptr = value_len;
+    }
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_column_as_uint8(SF_STMT *sfstmt, int idx, uint8 *value_ptr) {
+SF_STATUS STDCALL snowflake_column_as_binary(SF_STMT *sfstmt, int idx, const void **value_ptr, size_t *value_len_ptr) {
     SF_STATUS status;
 
     if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+    if (value_len_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "value_len_ptr must not be NULL", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
 
-    if ((status = rs_get_cell_as_uint8(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_binary(
+        sfstmt->result_set, idx, value_ptr, value_len_ptr)) != SF_STATUS_SUCCESS) {
         SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
             rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_column_as_uint32(SF_STMT *sfstmt, int idx, uint32 *value_ptr) {
+SF_STATUS STDCALL snowflake_column_get_data(SF_STMT *sfstmt, int idx, void *buffer,
+                                            size_t buffer_size, size_t *piece_len_ptr,
+                                            size_t *remaining_len_ptr) {
     SF_STATUS status;
+    SF_DB_TYPE type;
+    sf_bool hex = SF_BOOLEAN_FALSE;
+    const void *value = NULL;
+    size_t value_len = 0;
+    size_t piece_len;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_column_null_checks(sfstmt, buffer)) != SF_STATUS_SUCCESS) {
         return status;
     }
-
-    if ((status = rs_get_cell_as_uint32(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+    if (piece_len_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "piece_len_ptr must not be NULL", "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    *piece_len_ptr = 0;
+    if (remaining_len_ptr) {
+        *remaining_len_ptr = 0;
+    }
+    if (idx < 1 || idx > sfstmt->total_fieldcount) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "Column index must be between 1 and snowflake_num_fields()",
+                                 "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    if (sfstmt->get_data_column != idx || sfstmt->get_data_row != sfstmt->total_row_index) {
+        sfstmt->get_data_column = idx;
+        sfstmt->get_data_row = sfstmt->total_row_index;
+        sfstmt->get_data_offset = 0;
+    } else if (sfstmt->get_data_offset == (size_t) -1) {
+        // The last piece has been read
+        return SF_STATUS_EOF;
+    }
+
+    type = sfstmt->desc[idx - 1].type;
+    if (type == SF_DB_TYPE_BINARY && ARROW_FORMAT == *((QueryResultFormat_t *) sfstmt->qrf)) {
+        status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_binary(sfstmt->result_set, idx,
+                                                               &value, &value_len);
+    } else if (ARROW_FORMAT == *((QueryResultFormat_t *) sfstmt->qrf) ||
+               !_snowflake_type_needs_formatting(type)) {
+        // The hex text of a JSON BINARY value is decoded piece by piece
+        hex = type == SF_DB_TYPE_BINARY ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+        status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_const_string(
+            sfstmt->result_set, idx, (const char **) &value);
+        value_len = value ? strlen((const char *) value) : 0;
+    } else {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_DATA_CONVERSION,
+                                 "The column has to be formatted, read it with "
+                                 "snowflake_column_as_str()",
+                                 SF_SQLSTATE_INVALID_DATA_TYPE, sfstmt->sfqid);
+        return SF_STATUS_ERROR_DATA_CONVERSION;
+    }
+    if (status != SF_STATUS_SUCCESS) {
         SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
             rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+        return status;
     }
-    return status;
+    if (hex) {
+        if (value_len % 2 != 0) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_CONVERSION_FAILURE,
+                                     "The hex text of a BINARY column has an odd length",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+            return SF_STATUS_ERROR_CONVERSION_FAILURE;
+        }
+        value_len /= 2;
+    }
+
+    piece_len = value_len - sfstmt->get_data_offset;
+    if (piece_len > buffer_size) {
+        piece_len = buffer_size;
+    }
+    if (hex) {
+        if (!sf_hex_decode(buffer, (const char *) value + sfstmt->get_data_offset * 2,
+                           piece_len)) {
+            SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_CONVERSION_FAILURE,
+                                     "The hex text of a BINARY column isn't valid",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+            return SF_STATUS_ERROR_CONVERSION_FAILURE;
+        }
+    } else if (piece_len > 0) {
+        memcpy(buffer, (const char *) value + sfstmt->get_data_offset, piece_len);
+    }
+
+    sfstmt->get_data_offset += piece_len;
+    *piece_len_ptr = piece_len;
+    if (remaining_len_ptr) {
+        *remaining_len_ptr = value_len - sfstmt->get_data_offset;
+    }
+    if (sfstmt->get_data_offset == value_len) {
+        sfstmt->get_data_offset = (size_t) -1;
+    }
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_column_as_uint64(SF_STMT *sfstmt, int idx, uint64 *value_ptr) {
+SF_STATUS STDCALL snowflake_column_is_null(SF_STMT *sfstmt, int idx, sf_bool *value_ptr) {
     SF_STATUS status;
 
     if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_value(sfstmt, idx, SF_C_TYPE_NULL, (void *) value_ptr);
+    }
 
-    if ((status = rs_get_cell_as_uint64(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->is_cell_null(
+        sfstmt->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
         SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
             rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_column_as_int8(SF_STMT *sfstmt, int idx, int8 *value_ptr) {
-    SF_STATUS status;
+SF_STATUS STDCALL snowflake_column_null_bitmap(SF_STMT *sfstmt, int idx, uint8 *null_bitmap,
+                                               size_t max_rows, size_t *row_count_ptr,
+                                               size_t *null_count_ptr) {
+    size_t rows;
+    size_t nulls = 0;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
-        return status;
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    clear_snowflake_error(&sfstmt->error);
+    if (!row_count_ptr || (max_rows > 0 && !null_bitmap)) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "null_bitmap and row_count_ptr must not be NULL", "",
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    *row_count_ptr = 0;
+    if (null_count_ptr) {
+        *null_count_ptr = 0;
+    }
+    if (sfstmt->materializer) {
+        return _snowflake_materialized_unsupported(sfstmt);
+    }
+    if (idx < 1 || idx > sfstmt->total_fieldcount) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "Column index must be between 1 and snowflake_num_fields()",
+                                 "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+    if (!sfstmt->result_set || !sfstmt->qrf) {
+        return SF_STATUS_SUCCESS;
     }
 
-    if ((status = rs_get_cell_as_int8(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    // The rest of the current record batch, within the buffer and the chunk
+    rows = rs_get_rows_left_in_batch(sfstmt->result_set, sfstmt->qrf);
+    if (rows > max_rows) {
+        rows = max_rows;
+    }
+    if (rows > (size_t) sfstmt->chunk_rowcount + 1) {
+        rows = (size_t) sfstmt->chunk_rowcount + 1;
+    }
+    if (rows == 0) {
+        return SF_STATUS_SUCCESS;
     }
-    return status;
-}
 
-SF_STATUS STDCALL snowflake_column_as_int32(SF_STMT *sfstmt, int idx, int32 *value_ptr) {
-    SF_STATUS status;
+    if (!rs_copy_null_bitmap(sfstmt->result_set, sfstmt->qrf, (size_t) idx, null_bitmap,
+                             rows, &nulls)) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_GENERAL,
+                                 "Unable to get the null bitmap of the column", "",
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_GENERAL;
+    }
+    *row_count_ptr = rows;
+    if (null_count_ptr) {
+        *null_count_ptr = nulls;
+    }
+    return SF_STATUS_SUCCESS;
+}
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
-        return status;
+// Does NULL checking and clears the SF_RESULT_CHUNK error struct
+static SF_STATUS STDCALL _snowflake_chunk_column_null_checks(SF_RESULT_CHUNK *chunk, void *value_ptr) {
+    if (!chunk) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    clear_snowflake_error(&chunk->error);
+    if (value_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "value_ptr must not be NULL", "", chunk->sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
     }
 
-    if ((status = rs_get_cell_as_int32(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * @return a new chunk of the rows of a result set, or NULL if out of memory.
+ */
+static SF_RESULT_CHUNK *STDCALL _snowflake_result_chunk_create(SF_STMT *sfstmt, int64 chunk_index,
+                                                                int64 row_count, void *result_set) {
+    SF_RESULT_CHUNK *result_chunk = (SF_RESULT_CHUNK *) SF_CALLOC(1, sizeof(SF_RESULT_CHUNK));
+    if (!result_chunk) {
+        return NULL;
     }
-    return status;
+    result_chunk->sfstmt = sfstmt;
+    result_chunk->chunk_index = chunk_index;
+    result_chunk->row_count = row_count;
+    result_chunk->remaining_rows = row_count;
+    result_chunk->result_set = result_set;
+    clear_snowflake_error(&result_chunk->error);
+    return result_chunk;
 }
 
-SF_STATUS STDCALL snowflake_column_as_int64(SF_STMT *sfstmt, int idx, int64 *value_ptr) {
-    SF_STATUS status;
+static SF_STATUS STDCALL _snowflake_fetch_chunk(SF_STMT *sfstmt, SF_RESULT_CHUNK **chunk,
+                                                SF_ERROR_STRUCT *error) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
+    }
+    if (!chunk) {
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_NULL_POINTER, "chunk must not be NULL",
+                            SF_SQLSTATE_GENERAL_ERROR);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    *chunk = NULL;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
-        return status;
+    SF_CHUNK_DOWNLOADER *chunk_downloader = sfstmt->chunk_downloader;
+    SF_RESULT_CHUNK *result_chunk = NULL;
+    void *result_set;
+    void *downloaded = NULL;
+    uint64 index;
+    uint64 decode_start;
+    sf_bool success;
+
+    // The first call takes over the rowset returned with the query response.
+    // The exchange makes sure only one thread gets it.
+    if ((result_set = sf_atomic_exchange_ptr(&sfstmt->result_set, NULL)) != NULL) {
+        if (sfstmt->chunk_rowcount > 0) {
+            result_chunk = _snowflake_result_chunk_create(sfstmt, 0, sfstmt->chunk_rowcount,
+                                                          result_set);
+            if (!result_chunk) {
+                rs_destroy(result_set, (QueryResultFormat_t *) sfstmt->qrf);
+                SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                         "Unable to allocate the chunk",
+                                         SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+                return SF_STATUS_ERROR_OUT_OF_MEMORY;
+            }
+            *chunk = result_chunk;
+            return SF_STATUS_SUCCESS;
+        }
+        rs_destroy(result_set, (QueryResultFormat_t *) sfstmt->qrf);
+    }
+
+    if (!chunk_downloader) {
+        return SF_STATUS_EOF;
+    }
+
+    _critical_section_lock(&chunk_downloader->consumer_lock);
+    success = chunk_downloader_next_chunk(chunk_downloader, sfstmt->unordered_fetch,
+                                          &index, &downloaded);
+    _critical_section_unlock(&chunk_downloader->consumer_lock);
+    if (!success) {
+        // The error of the results, set once by the chunk downloader
+        _rwlock_rdlock(&chunk_downloader->attr_lock);
+        copy_snowflake_error(error, chunk_downloader->sf_error);
+        _rwlock_rdunlock(&chunk_downloader->attr_lock);
+        if (!error->error_code) {
+            SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_GENERAL,
+                                     "Unable to download the chunk",
+                                     SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        }
+        return error->error_code;
+    }
+    if (downloaded == NULL) {
+        return SF_STATUS_EOF;
+    }
+
+    decode_start = sf_monotonic_time_ms();
+    result_set = rs_create_with_chunk(downloaded, sfstmt->desc,
+                                      (QueryResultFormat_t *) sfstmt->qrf,
+                                      sfstmt->connection->timezone);
+    chunk_downloader->queue[index].stats.decode_ms += sf_monotonic_time_ms() - decode_start;
+    if (!result_set) {
+        // The result set didn't take the chunk over. Arrow responses are only created, and
+        // so freed, by the result sets of a build with Arrow, where they always take them.
+        if (*((QueryResultFormat_t *) sfstmt->qrf) == JSON_FORMAT) {
+            sf_json_rowset_free((SF_JSON_ROWSET *) downloaded);
+        }
+        SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to create result set for chunk",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
     }
 
-    if ((status = rs_get_cell_as_int64(
-            sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    result_chunk = _snowflake_result_chunk_create(
+      sfstmt, (int64) index + _snowflake_first_chunk_index(sfstmt),
+      chunk_downloader->queue[index].row_count, result_set);
+    if (!result_chunk) {
+        rs_destroy(result_set, (QueryResultFormat_t *) sfstmt->qrf);
+        SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to allocate the chunk",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
     }
-    return status;
+    log_debug("Acquired chunk %llu from chunk downloader for parallel consumption", index);
+
+    *chunk = result_chunk;
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_column_as_float32(SF_STMT *sfstmt, int idx, float32 *value_ptr) {
+SF_STATUS STDCALL snowflake_fetch_chunk(SF_STMT *sfstmt, SF_RESULT_CHUNK **chunk,
+                                        SF_ERROR_STRUCT *error) {
+    SF_ERROR_STRUCT unused_error;
     SF_STATUS status;
+    if (error) {
+        clear_snowflake_error(error);
+        return _snowflake_fetch_chunk(sfstmt, chunk, error);
+    }
+    memset(&unused_error, 0, sizeof(unused_error));
+    status = _snowflake_fetch_chunk(sfstmt, chunk, &unused_error);
+    clear_snowflake_error(&unused_error);
+    return status;
+}
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
-        return status;
+SF_STATUS STDCALL snowflake_chunk_next(SF_RESULT_CHUNK *chunk) {
+    if (!chunk) {
+        return SF_STATUS_ERROR_NULL_POINTER;
     }
+    clear_snowflake_error(&chunk->error);
 
-    if ((status = rs_get_cell_as_float32(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if (chunk->remaining_rows <= 0) {
+        return SF_STATUS_EOF;
     }
-    return status;
+    chunk->remaining_rows--;
+    return STMT_RS_ACCESSORS(chunk->sfstmt)->next(chunk->result_set);
 }
 
-SF_STATUS STDCALL snowflake_column_as_float64(SF_STMT *sfstmt, int idx, float64 *value_ptr) {
-    SF_STATUS status;
+void STDCALL snowflake_chunk_term(SF_RESULT_CHUNK *chunk) {
+    if (!chunk) {
+        return;
+    }
+    if (chunk->result_set) {
+        rs_destroy(chunk->result_set, (QueryResultFormat_t *) chunk->sfstmt->qrf);
+    }
+    clear_snowflake_error(&chunk->error);
+    SF_FREE(chunk);
+}
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
-        return status;
+SF_ERROR_STRUCT *STDCALL snowflake_chunk_error(SF_RESULT_CHUNK *chunk) {
+    if (!chunk) {
+        return NULL;
     }
+    return &chunk->error;
+}
 
-    if ((status = rs_get_cell_as_float64(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+SF_STATUS STDCALL snowflake_stmt_get_fetch_stats(SF_STMT *sfstmt, SF_FETCH_STATS **stats) {
+    if (!sfstmt) {
+        return SF_STATUS_ERROR_STATEMENT_NOT_EXIST;
     }
-    return status;
+    if (!stats) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+
+    SF_CHUNK_DOWNLOADER *chunk_downloader = sfstmt->chunk_downloader;
+    SF_FETCH_STATS *result = (SF_FETCH_STATS *) SF_CALLOC(1, sizeof(SF_FETCH_STATS));
+    SF_CHUNK_FETCH_STATS *chunk_stats;
+    uint64 i;
+
+    if (!result) {
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    if (chunk_downloader && chunk_downloader->queue_size > 0) {
+        result->chunk_count = chunk_downloader->queue_size;
+        result->chunks = (SF_CHUNK_FETCH_STATS *) SF_CALLOC(
+          result->chunk_count, sizeof(SF_CHUNK_FETCH_STATS));
+        if (!result->chunks) {
+            SF_FREE(result);
+            return SF_STATUS_ERROR_OUT_OF_MEMORY;
+        }
+        // The downloader threads keep writing while this copies, so the
+        // stats of a chunk in flight may be partially updated.
+        for (i = 0; i < result->chunk_count; i++) {
+            chunk_stats = &result->chunks[i];
+            *chunk_stats = chunk_downloader->queue[i].stats;
+            result->total_bytes += chunk_stats->bytes;
+            result->total_retries += chunk_stats->retries;
+            if (chunk_stats->download_end_ms > chunk_stats->download_start_ms) {
+                result->total_download_ms +=
+                  chunk_stats->download_end_ms - chunk_stats->download_start_ms;
+            }
+            result->total_decode_ms += chunk_stats->decode_ms;
+            result->total_consumer_wait_ms += chunk_stats->consumer_wait_ms;
+        }
+    }
+
+    *stats = result;
+    return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_column_as_timestamp(SF_STMT *sfstmt, int idx, SF_TIMESTAMP *value_ptr) {
+void STDCALL snowflake_fetch_stats_term(SF_FETCH_STATS *stats) {
+    if (!stats) {
+        return;
+    }
+    SF_FREE(stats->chunks);
+    SF_FREE(stats);
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_as_boolean(SF_RESULT_CHUNK *chunk, int idx, sf_bool *value_ptr) {
     SF_STATUS status;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    if ((status = rs_get_cell_as_timestamp(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_bool(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_column_as_const_str(SF_STMT *sfstmt, int idx, const char **value_ptr) {
+SF_STATUS STDCALL snowflake_chunk_column_as_uint8(SF_RESULT_CHUNK *chunk, int idx, uint8 *value_ptr) {
     SF_STATUS status;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    if ((status = rs_get_cell_as_const_string(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_uint8(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_raw_value_to_str_rep(SF_STMT *sfstmt, const char* const_str_val, const SF_DB_TYPE type, const char *connection_timezone,
-                                                 int32 scale, sf_bool isNull, char **value_ptr, size_t *value_len_ptr, size_t *max_value_size_ptr){
-
-    if (value_ptr == NULL) {
-      return SF_STATUS_ERROR_NULL_POINTER;
-    }
-
+SF_STATUS STDCALL snowflake_chunk_column_as_uint32(SF_RESULT_CHUNK *chunk, int idx, uint32 *value_ptr) {
     SF_STATUS status;
 
-    char *value = NULL;
-    size_t max_value_size = 0;
-    size_t init_value_len = 0;
-    size_t value_len = 0;
-    sf_bool preallocated = SF_BOOLEAN_FALSE;
-
-    // If value_ptr isn't null and max_value_size exists and is greater than 0,
-    // then the user passed in a buffer and we should reallocate if needed
-    if (*value_ptr != NULL && max_value_size_ptr != NULL && *max_value_size_ptr != 0) {
-        value = *value_ptr;
-        init_value_len = *max_value_size_ptr;
-        preallocated = SF_BOOLEAN_TRUE;
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
 
-
-    if (isNull == SF_BOOLEAN_TRUE) {
-      // If value is NULL, allocate buffer for empty string
-      if (init_value_len == 0) {
-        value = global_hooks.calloc(1, 1);
-        max_value_size = 1;
-      } else {
-        // If we don't need to allocate a buffer, set value len to the initial value len
-        max_value_size = init_value_len;
-      }
-      sb_strncpy(value, max_value_size, "", 1);
-      value_len = 0;
-      status = SF_STATUS_SUCCESS;
-      goto cleanup;
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_uint32(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
+    return status;
+}
 
-    time_t sec = 0L;
-    struct tm tm_obj;
-    struct tm *tm_ptr;
-    memset(&tm_obj, 0, sizeof(tm_obj));
-
-    SF_ERROR_STRUCT *error = (sfstmt != NULL ? &sfstmt->error : NULL);
-    char *sfqid = sfstmt != NULL ? sfstmt->sfqid : NULL;
+SF_STATUS STDCALL snowflake_chunk_column_as_uint64(SF_RESULT_CHUNK *chunk, int idx, uint64 *value_ptr) {
+    SF_STATUS status;
 
-    switch (type) {
-      case SF_DB_TYPE_BOOLEAN: ;
-        const char *bool_value;
-        if (strcmp(const_str_val, "0") == 0) {
-          /* False */
-          bool_value = SF_BOOLEAN_FALSE_STR;
-        } else {
-          /* True */
-          bool_value = SF_BOOLEAN_TRUE_STR;
-        }
-        value_len = strlen(bool_value);
-        if (value_len + 1 > init_value_len) {
-          if (preallocated) {
-            value = global_hooks.realloc(value, value_len + 1);
-          } else {
-            value = global_hooks.calloc(1, value_len + 1);
-          }
-          // If we have to allocate memory, then we need to set max_value_size
-          // otherwise we leave max_value_size as is
-          max_value_size = value_len + 1;
-        } else {
-          max_value_size = init_value_len;
-        }
-        sb_strncpy(value, max_value_size, bool_value, value_len + 1);
-        break;
-      case SF_DB_TYPE_DATE:
-        sec =
-                (time_t) strtol(const_str_val, NULL, 10) *
-                86400L;
-        _mutex_lock(&gmlocaltime_lock);
-        tm_ptr = sf_gmtime(&sec, &tm_obj);
-        _mutex_unlock(&gmlocaltime_lock);
-        if (tm_ptr == NULL) {
-          SET_SNOWFLAKE_STMT_ERROR(error,
-                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
-                                   "Failed to convert a date value to a string.",
-                                   SF_SQLSTATE_GENERAL_ERROR,
-                                   sfqid);
-          value = NULL;
-          max_value_size = 0;
-          goto cleanup;
-        }
-        // Max size of date string
-        value_len = DATE_STRING_MAX_SIZE;
-        if (value_len + 1 > init_value_len) {
-          if (preallocated) {
-            value = global_hooks.realloc(value, value_len + 1);
-          } else {
-            value = global_hooks.calloc(1, value_len + 1);
-          }
-          // If we have to allocate memory, then we need to set max_value_size
-          // otherwise we leave max_value_size as is
-          max_value_size = value_len + 1;
-        } else {
-          max_value_size = init_value_len;
-        }
-        value_len = strftime(value, value_len + 1, "%Y-%m-%d", &tm_obj);
-        break;
-      case SF_DB_TYPE_TIME:
-      case SF_DB_TYPE_TIMESTAMP_NTZ:
-      case SF_DB_TYPE_TIMESTAMP_LTZ:
-      case SF_DB_TYPE_TIMESTAMP_TZ: ;
-        SF_TIMESTAMP ts;
-        if (scale < 0)
-        {
-          // If scale is not provided, try to calculate it.
-          // E.g., for raw value "1234567890 2040" scale is 0
-          // E.g., for raw value "1234567890.1234 2040" scale is from "." to " "
-          // before TZ offset
-          // E.g., for raw value "1234567890.1234" scale is calculated as length
-          // of input minus length of "1234567890." part
-
-          const char *scalePtr = strchr(const_str_val, (int) '.');
-          if (scalePtr == NULL)
-          {
-            scale = 0;
-          } else {
-            const char *tzOffsetPtr = strchr(scalePtr+1, (int) ' ');
-            if (tzOffsetPtr == NULL)
-            {
-              scale = strlen(const_str_val) - (scalePtr - const_str_val) - 1;
-            } else {
-              scale = tzOffsetPtr - scalePtr - 1;
-            }
-          }
-          log_info("scale is calculated as %d", scale);
-        }
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
 
-        if (snowflake_timestamp_from_epoch_seconds(&ts,
-                                                   const_str_val,
-                                                   connection_timezone,
-                                                   scale,
-                                                   type)) {
-          SET_SNOWFLAKE_STMT_ERROR(error,
-                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
-                                   "Failed to convert the response from the server into a SF_TIMESTAMP.",
-                                   SF_SQLSTATE_GENERAL_ERROR,
-                                   sfqid);
-          value = NULL;
-          max_value_size = 0;
-          goto cleanup;
-        }
-        // TODO add format when format is no longer a fixed string
-        if (snowflake_timestamp_to_string(&ts, "", &value, max_value_size, &value_len, SF_BOOLEAN_TRUE)) {
-          SET_SNOWFLAKE_STMT_ERROR(error,
-                                   SF_STATUS_ERROR_CONVERSION_FAILURE,
-                                   "Failed to convert a SF_TIMESTAMP value to a string.",
-                                   SF_SQLSTATE_GENERAL_ERROR,
-                                   sfqid);
-          // If the memory wasn't preallocated, then free it
-          if (!preallocated && value) {
-            global_hooks.dealloc(value);
-            value = NULL;
-            max_value_size = 0;
-          }
-          value_len = 0;
-          goto cleanup;
-        } else {
-          // If true, then we reallocated when writing the timestamp to a string
-          if (value_len + 1 > init_value_len) {
-            max_value_size = value_len + 1;
-          } else {
-            max_value_size = init_value_len;
-          }
-        }
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_uint64(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
 
-        break;
-      default:
-        value_len = strlen(const_str_val);
-        if (value_len + 1 > init_value_len) {
-          if (preallocated) {
-            value = global_hooks.realloc(value, value_len + 1);
-          } else {
-            value = global_hooks.calloc(1, value_len + 1);
-          }
-          // If we have to allocate memory, then we need to set max_value_size
-          // otherwise we leave max_value_size as is
-          max_value_size = value_len + 1;
-        } else {
-          max_value_size = init_value_len;
-        }
-        sb_strncpy(value, max_value_size, const_str_val, value_len + 1);
-        break;
+SF_STATUS STDCALL snowflake_chunk_column_as_int8(SF_RESULT_CHUNK *chunk, int idx, int8 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
 
-    // Everything went okay
-    status = SF_STATUS_SUCCESS;
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_int8(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
 
-cleanup:
-    *value_ptr = value;
-    if (max_value_size_ptr) {
-        *max_value_size_ptr = max_value_size;
+SF_STATUS STDCALL snowflake_chunk_column_as_int32(SF_RESULT_CHUNK *chunk, int idx, int32 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
-    if (value_len_ptr) {
-        *value_len_ptr = value_len;
+
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_int32(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_column_as_str(SF_STMT *sfstmt, int idx, char **value_ptr, size_t *value_len_ptr, size_t *max_value_size_ptr) {
+SF_STATUS STDCALL snowflake_chunk_column_as_int64(SF_RESULT_CHUNK *chunk, int idx, int64 *value_ptr) {
     SF_STATUS status;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    const char* str_val = NULL;
-    if ((status = rs_get_cell_as_const_string(
-            sfstmt->result_set,
-            sfstmt->qrf,
-            idx,
-            &str_val)) != SF_STATUS_SUCCESS)
-    {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_int64(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_as_float32(SF_RESULT_CHUNK *chunk, int idx, float32 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    if (ARROW_FORMAT == *((QueryResultFormat_t *)sfstmt->qrf))
-    {
-        // For Arrow the const string is formatted already
-        return snowflake_raw_value_to_str_rep(sfstmt, str_val,
-                                             SF_DB_TYPE_TEXT,
-                                             sfstmt->connection->timezone,
-                                             0,
-                                             str_val ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE,
-                                             value_ptr, value_len_ptr,
-                                             max_value_size_ptr);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_float32(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
-    else
-    {
-        return snowflake_raw_value_to_str_rep(sfstmt, str_val,
-                                              sfstmt->desc[idx - 1].type,
-                                              sfstmt->connection->timezone,
-                                              (int32) sfstmt->desc[idx - 1].scale,
-                                              str_val ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE,
-                                              value_ptr, value_len_ptr,
-                                              max_value_size_ptr);
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_as_float64(SF_RESULT_CHUNK *chunk, int idx, float64 *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
     }
+
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_float64(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
 }
 
-SF_STATUS STDCALL snowflake_column_strlen(SF_STMT *sfstmt, int idx, size_t *value_ptr) {
+SF_STATUS STDCALL snowflake_chunk_column_as_timestamp(SF_RESULT_CHUNK *chunk, int idx, SF_TIMESTAMP *value_ptr) {
     SF_STATUS status;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    if ((status = rs_get_cell_strlen(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_timestamp(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
     return status;
 }
 
-SF_STATUS STDCALL snowflake_column_is_null(SF_STMT *sfstmt, int idx, sf_bool *value_ptr) {
+SF_STATUS STDCALL snowflake_chunk_column_as_const_str(SF_RESULT_CHUNK *chunk, int idx, const char **value_ptr) {
     SF_STATUS status;
 
-    if ((status = _snowflake_column_null_checks(sfstmt, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
         return status;
     }
 
-    if ((status = rs_is_cell_null(
-        sfstmt->result_set, sfstmt->qrf, idx, value_ptr)) != SF_STATUS_SUCCESS) {
-        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
-            rs_get_error_message(sfstmt->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_const_string(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_as_str(SF_RESULT_CHUNK *chunk, int idx, char **value_ptr,
+                                                size_t *value_len_ptr, size_t *max_value_size_ptr) {
+    SF_STATUS status;
+    SF_STMT *sfstmt;
+    const char *str_val = NULL;
+    sf_bool is_arrow;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    sfstmt = chunk->sfstmt;
+
+    if ((status = STMT_RS_ACCESSORS(sfstmt)->get_cell_as_const_string(
+            chunk->result_set, idx, &str_val)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, sfstmt->qrf), "", sfstmt->sfqid);
+        return status;
+    }
+
+    // Pass no statement so that errors are not written to the shared statement error.
+    // For Arrow the const string is formatted already.
+    is_arrow = ARROW_FORMAT == *((QueryResultFormat_t *) sfstmt->qrf);
+    status = snowflake_raw_value_to_str_rep(NULL, str_val,
+                                            is_arrow ? SF_DB_TYPE_TEXT : sfstmt->desc[idx - 1].type,
+                                            sfstmt->connection->timezone,
+                                            is_arrow ? 0 : (int32) sfstmt->desc[idx - 1].scale,
+                                            str_val ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE,
+                                            value_ptr, value_len_ptr,
+                                            max_value_size_ptr);
+    if (status != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+                                 "Failed to convert value to string", "", sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_strlen(SF_RESULT_CHUNK *chunk, int idx, size_t *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_strlen(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_as_binary(SF_RESULT_CHUNK *chunk, int idx, const void **value_ptr,
+                                                   size_t *value_len_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+    if (value_len_ptr == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, SF_STATUS_ERROR_NULL_POINTER,
+                                 "value_len_ptr must not be NULL", "", chunk->sfstmt->sfqid);
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->get_cell_as_binary(
+        chunk->result_set, idx, value_ptr, value_len_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
+    }
+    return status;
+}
+
+SF_STATUS STDCALL snowflake_chunk_column_is_null(SF_RESULT_CHUNK *chunk, int idx, sf_bool *value_ptr) {
+    SF_STATUS status;
+
+    if ((status = _snowflake_chunk_column_null_checks(chunk, (void *) value_ptr)) != SF_STATUS_SUCCESS) {
+        return status;
+    }
+
+    if ((status = STMT_RS_ACCESSORS(chunk->sfstmt)->is_cell_null(
+        chunk->result_set, idx, value_ptr)) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&chunk->error, status,
+            rs_get_error_message(chunk->result_set, chunk->sfstmt->qrf), "", chunk->sfstmt->sfqid);
     }
     return status;
 }
@@ -2790,89 +6931,150 @@ SF_STATUS STDCALL snowflake_timestamp_from_parts(SF_TIMESTAMP *ts, int32 nanosec
     return SF_STATUS_SUCCESS;
 }
 
-SF_STATUS STDCALL snowflake_timestamp_from_epoch_seconds(SF_TIMESTAMP *ts, const char *str, const char *timezone,
-                                                         int32 scale, SF_DB_TYPE ts_type) {
-    if (!ts) {
-        return SF_STATUS_ERROR_NULL_POINTER;
+/**
+ * Parses the text of a date or time value of the JSON results in one pass, without libc: days
+ * since the epoch for a date, "seconds[.fraction][ offset]" for the others, the offset of a
+ * TIMESTAMP_TZ being minutes east of UTC plus TIMEZONE_OFFSET_RANGE.
+ *
+ * @param str the NUL-terminated text.
+ * @param ts_type the type of the value.
+ * @param scale the digits the fraction is scaled to, set to the digits of the text if negative.
+ * @param sec set to the seconds since the epoch, or the days for a date, rounded down.
+ * @param frac set to the fraction of a second past sec, in units of the scale.
+ * @param tzoffset set to the offset in minutes, 0 if the text has none.
+ *
+ * @return SF_BOOLEAN_FALSE if the text isn't in that form.
+ */
+static sf_bool STDCALL _parse_epoch_text(const char *str, SF_DB_TYPE ts_type, int32 *scale,
+                                         int64 *sec, int64 *frac, int64 *tzoffset) {
+    const char *p = str;
+    const char *digits;
+    sf_bool negative = *p == '-' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    uint64 value = 0;
+    int32 frac_digits = 0;
+
+    *frac = 0;
+    *tzoffset = 0;
+    if (*scale > 9) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    // 18 digits always fit, and are more than the range of a timestamp
+    for (digits = p; (unsigned int) (*p - '0') < 10 && p - digits < 18; p++) {
+        value = value * 10 + (unsigned int) (*p - '0');
+    }
+    if (p == digits || (unsigned int) (*p - '0') < 10) {
+        return SF_BOOLEAN_FALSE;
+    }
+    *sec = negative ? -(int64) value : (int64) value;
+    if (ts_type == SF_DB_TYPE_DATE) {
+        if (*scale < 0) {
+            *scale = 0;
+        }
+        return SF_BOOLEAN_TRUE;
     }
 
-    SF_STATUS ret = SF_STATUS_ERROR_GENERAL;
-    time_t nsec = 0L;
-    time_t sec = 0L;
-    int64 tzoffset = 0;
+    if (*p == '.') {
+        value = 0;
+        for (digits = ++p; (unsigned int) (*p - '0') < 10; p++) {
+            if (frac_digits < 9) {
+                value = value * 10 + (unsigned int) (*p - '0');
+                frac_digits++;
+            }
+        }
+        if (*scale < 0) {
+            *scale = frac_digits;
+        }
+        // the server always writes scale digits, scale any other count to them
+        for (; frac_digits < *scale; frac_digits++) {
+            value *= 10;
+        }
+        for (; frac_digits > *scale; frac_digits--) {
+            value /= 10;
+        }
+        *frac = (int64) value;
+    } else if (*scale > 0) {
+        return SF_BOOLEAN_FALSE;
+    } else if (*scale < 0) {
+        *scale = 0;
+    }
+
+    if (*p == ' ') {
+        value = 0;
+        for (digits = ++p; (unsigned int) (*p - '0') < 10 && p - digits < 9; p++) {
+            value = value * 10 + (unsigned int) (*p - '0');
+        }
+        *tzoffset = (int64) value - TIMEZONE_OFFSET_RANGE
+    }
+
+    // before the epoch the fraction counts from the second below
+    if (negative && *frac > 0) {
+        *frac = pow10_int64[*scale] - *frac;
+        (*sec)--;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Fills a timestamp from the parsed text of a value, see _parse_epoch_text().
+ *
+ * @param tz_rules the rules of the session timezone for a TIMESTAMP_LTZ, NULL if it isn't in
+ *        the zoneinfo database, in which case the TZ environment variable is set to it.
+ */
+static SF_STATUS STDCALL _timestamp_from_epoch(SF_TIMESTAMP *ts, time_t sec, int64 frac,
+                                               int64 tzoffset, const char *timezone,
+                                               const SF_TZ_RULES *tz_rules, int32 scale,
+                                               SF_DB_TYPE ts_type) {
     struct tm *tm_ptr = NULL;
-    char tzname[64];
-    char *tzptr = (char *) timezone;
+    int32 gmtoff = 0;
+    int isdst = 0;
+    const char *tz_abbrev = NULL;
 
     memset(&ts->tm_obj, 0, sizeof(ts->tm_obj));
-    ts->nsec = 0;
     ts->scale = scale;
     ts->ts_type = ts_type;
     ts->tzoffset = 0;
+    // Transform the fraction to a 9 digit number to store in the timestamp struct
+    ts->nsec = (int32) (frac * pow10_int64[9 - scale]);
 
-    /* Search for a decimal point if scale > 0
-     * When scale == 0, str will look like e.g. "1593586800 2040"*/
-    const char *ptr = scale > 0 ? strchr(str, (int) '.') : str;
-    // No decimal point exists for date types
-    if (ptr == NULL && ts->ts_type != SF_DB_TYPE_DATE) {
-        ret = SF_STATUS_ERROR_GENERAL;
-        goto cleanup;
-    }
-
-    sec = strtoll(str, NULL, 10);
-
-    if (ts->ts_type == SF_DB_TYPE_DATE) {
+    if (ts_type == SF_DB_TYPE_DATE) {
         sec = sec * SECONDS_IN_AN_HOUR;
-    } else {
-        if (scale > 0) {
-          nsec = strtoll(ptr + 1, NULL, 10);
-        }
-        /* Search for a space for TIMESTAMP_TZ */
-        char *sptr = strchr(ptr + 1, (int) ' ');
-        if (sptr != NULL) {
-            /* TIMESTAMP_TZ */
-            tzoffset = strtoll(sptr + 1, NULL, 10) - TIMEZONE_OFFSET_RANGE;
-        }
-    }
-
-    // If timestamp is before the epoch, we have to do some
-    // math to make things work just right
-    if (sec < 0 && nsec > 0) {
-        nsec = pow10_int64[ts->scale] - nsec;
-        sec--;
-    }
-    // Transform nsec to a 9 digit number to store in the timestamp struct
-    ts->nsec = (int32) (nsec * pow10_int64[9-ts->scale]);
-
-    if (ts->ts_type == SF_DB_TYPE_TIMESTAMP_TZ) {
-        /* make up Timezone name from the tzoffset */
-        ldiv_t dm = ldiv((long) tzoffset, 60L);
-        sb_sprintf(tzname, sizeof(tzname), "UTC%c%02ld:%02ld",
-                dm.quot > 0 ? '+' : '-', labs(dm.quot), labs(dm.rem));
-        tzptr = tzname;
+        tm_ptr = sf_gmtime(&sec, &ts->tm_obj);
+    } else if (ts_type == SF_DB_TYPE_TIMESTAMP_NTZ || ts_type == SF_DB_TYPE_TIME) {
+        tm_ptr = sf_gmtime(&sec, &ts->tm_obj);
+    } else if (ts_type == SF_DB_TYPE_TIMESTAMP_TZ) {
+        /* the offset comes with the value, so no timezone has to be looked up */
         ts->tzoffset = (int32) tzoffset;
-    }
-
-    /* replace a dot character with NULL */
-    if (ts->ts_type == SF_DB_TYPE_TIMESTAMP_NTZ ||
-        ts->ts_type == SF_DB_TYPE_TIME ||
-        ts->ts_type == SF_DB_TYPE_DATE) {
+        sec += tzoffset * 60;
         tm_ptr = sf_gmtime(&sec, &ts->tm_obj);
-    } else if (ts->ts_type == SF_DB_TYPE_TIMESTAMP_LTZ ||
-      ts->ts_type == SF_DB_TYPE_TIMESTAMP_TZ) {
+#if defined(__linux__) || defined(__APPLE__)
+        /* what localtime reported when TZ was set to UTC+hh:mm for the offset */
+        ts->tm_obj.tm_gmtoff = (long) (-tzoffset * 60);
+#endif
+    } else if (ts_type == SF_DB_TYPE_TIMESTAMP_LTZ && tz_rules != NULL) {
+        /* the session timezone is in the zoneinfo database, avoid the TZ environment */
+        sf_tz_rules_offset(tz_rules, (int64) sec, &gmtoff, &isdst, &tz_abbrev);
+        sec += gmtoff;
+        tm_ptr = sf_gmtime(&sec, &ts->tm_obj);
+        ts->tm_obj.tm_isdst = isdst;
+#if defined(__linux__) || defined(__APPLE__)
+        ts->tm_obj.tm_gmtoff = gmtoff;
+        ts->tm_obj.tm_zone = (char *) tz_abbrev;
+        ts->tzoffset = gmtoff / 60;
+#endif
+    } else if (ts_type == SF_DB_TYPE_TIMESTAMP_LTZ) {
         /* set the environment variable TZ to the session timezone
          * so that localtime_tz honors it.
          */
         _mutex_lock(&gmlocaltime_lock);
         const char *prev_tz_ptr = sf_getenv("TZ");
-        sf_setenv("TZ", tzptr);
+        sf_setenv("TZ", timezone);
         sf_tzset();
-        sec += tzoffset * 60 * 2; /* adjust for TIMESTAMP_TZ */
         tm_ptr = sf_localtime(&sec, &ts->tm_obj);
 #if defined(__linux__) || defined(__APPLE__)
-        if (ts->ts_type == SF_DB_TYPE_TIMESTAMP_LTZ) {
-            ts->tzoffset = (int32) (ts->tm_obj.tm_gmtoff / 60);
-        }
+        ts->tzoffset = (int32) (ts->tm_obj.tm_gmtoff / 60);
 #endif
         if (prev_tz_ptr != NULL) {
             sf_setenv("TZ", prev_tz_ptr); /* cannot set to NULL */
@@ -2882,17 +7084,99 @@ SF_STATUS STDCALL snowflake_timestamp_from_epoch_seconds(SF_TIMESTAMP *ts, const
         sf_tzset();
         _mutex_unlock(&gmlocaltime_lock);
     }
-    if (tm_ptr == NULL) {
-        ret = SF_STATUS_ERROR_GENERAL;
-        goto cleanup;
+    return tm_ptr == NULL ? SF_STATUS_ERROR_GENERAL : SF_STATUS_SUCCESS;
+}
+
+SF_STATUS STDCALL snowflake_timestamp_from_epoch_seconds(SF_TIMESTAMP *ts, const char *str, const char *timezone,
+                                                         int32 scale, SF_DB_TYPE ts_type) {
+    int64 sec = 0;
+    int64 frac = 0;
+    int64 tzoffset = 0;
+
+    if (!ts) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    if (!str || !_parse_epoch_text(str, ts_type, &scale, &sec, &frac, &tzoffset)) {
+        memset(&ts->tm_obj, 0, sizeof(ts->tm_obj));
+        ts->nsec = 0;
+        ts->scale = scale;
+        ts->ts_type = ts_type;
+        ts->tzoffset = 0;
+        return SF_STATUS_ERROR_GENERAL;
     }
+    return _timestamp_from_epoch(ts, (time_t) sec, frac, tzoffset, timezone,
+                                 ts_type == SF_DB_TYPE_TIMESTAMP_LTZ ? sf_tz_cache_get(timezone) : NULL,
+                                 scale, ts_type);
+}
 
+SF_STATUS STDCALL snowflake_timestamps_from_epoch_seconds(SF_TIMESTAMP *ts, const char **strs,
+                                                          size_t count, const char *timezone,
+                                                          int32 scale, SF_DB_TYPE ts_type) {
+    const SF_TZ_RULES *tz_rules = NULL;
+    SF_STATUS ret;
+    int64 sec;
+    int64 frac;
+    int64 tzoffset;
+    int32 value_scale;
+    size_t i;
 
-    ret = SF_STATUS_SUCCESS;
-cleanup:
-    return ret;
+    if (!ts || (!strs && count > 0)) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    // the timezone is looked up once for the whole column
+    if (ts_type == SF_DB_TYPE_TIMESTAMP_LTZ) {
+        tz_rules = sf_tz_cache_get(timezone);
+    }
+    for (i = 0; i < count; i++) {
+        if (!strs[i]) {
+            ret = snowflake_timestamp_from_parts(&ts[i], 0, 0, 0, 0, 1, 1, 1970, 0, 9,
+                                                 SF_DB_TYPE_TIMESTAMP_NTZ);
+        } else {
+            value_scale = scale;
+            ret = _parse_epoch_text(strs[i], ts_type, &value_scale, &sec, &frac, &tzoffset) ?
+                  _timestamp_from_epoch(&ts[i], (time_t) sec, frac, tzoffset, timezone,
+                                        tz_rules, value_scale, ts_type) :
+                  SF_STATUS_ERROR_GENERAL;
+        }
+        if (ret != SF_STATUS_SUCCESS) {
+            return ret;
+        }
+    }
+    return SF_STATUS_SUCCESS;
+}
+
+/**
+ * Write a number in a fixed count of digits, zero padded, as %0Nd would
+ * for a number that fits in them.
+ */
+static char *_write_fixed_digits(char *out, int64 value, int digits) {
+    char *end = out + digits;
+    char *p = end;
+    while (p > out) {
+        *--p = (char) ('0' + value % 10);
+        value /= 10;
+    }
+    return end;
 }
 
+/**
+ * Whether the fields of a timestamp fit the fixed width of the output,
+ * which is written digit by digit rather than with strftime then. The others,
+ * as years before 1000, are left to strftime to be written the same as ever.
+ */
+static sf_bool _timestamp_has_fixed_width(const SF_TIMESTAMP *ts) {
+    const struct tm *tm_obj = &ts->tm_obj;
+    if (ts->ts_type != SF_DB_TYPE_TIME &&
+        (tm_obj->tm_year + 1900 < 1000 || tm_obj->tm_year + 1900 > 9999 ||
+         tm_obj->tm_mon < 0 || tm_obj->tm_mon > 11 ||
+         tm_obj->tm_mday < 0 || tm_obj->tm_mday > 99)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    return tm_obj->tm_hour >= 0 && tm_obj->tm_hour <= 99 &&
+           tm_obj->tm_min >= 0 && tm_obj->tm_min <= 99 &&
+           tm_obj->tm_sec >= 0 && tm_obj->tm_sec <= 99 &&
+           ts->nsec >= 0 && ts->nsec < 1000000000 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
 
 SF_STATUS STDCALL snowflake_timestamp_to_string(SF_TIMESTAMP *ts, const char *fmt, char **buffer_ptr,
                                                 size_t buf_size, size_t *bytes_written,
@@ -2915,10 +7199,6 @@ SF_STATUS STDCALL snowflake_timestamp_to_string(SF_TIMESTAMP *ts, const char *fm
         max_len += 8;
         fmt0 = "%H:%M:%S";
     }
-    /* adjust scale */
-    char fmt_static[20];
-    sb_sprintf(fmt_static, sizeof(fmt_static), ".%%0%dld", ts->scale);
-
     // Add space for scale if scale is greater than 0
     max_len += (ts->scale > 0) ? 1 + ts->scale : 0;
     // Add space for timezone if SF_DB_TYPE_TIMESTAMP_TZ is set
@@ -2933,13 +7213,41 @@ SF_STATUS STDCALL snowflake_timestamp_to_string(SF_TIMESTAMP *ts, const char *fm
             goto cleanup;
         }
     }
-    len = strftime(buffer, buf_size, fmt0, &ts->tm_obj);
-    if (ts->scale > 0) {
-        int64 nsec = ts->nsec / pow10_int64[9-ts->scale];
-        len += sb_sprintf(
-          &(buffer)[len],
-          max_len - len, fmt_static,
-          nsec);
+    if (_timestamp_has_fixed_width(ts) && ts->scale <= 9) {
+        // the same as strftime and sprintf below write, digit by digit
+        // rather than interpreting the formats for each value
+        char *out = buffer;
+        if (ts->ts_type != SF_DB_TYPE_TIME) {
+            out = _write_fixed_digits(out, ts->tm_obj.tm_year + 1900, 4);
+            *out++ = '-';
+            out = _write_fixed_digits(out, ts->tm_obj.tm_mon + 1, 2);
+            *out++ = '-';
+            out = _write_fixed_digits(out, ts->tm_obj.tm_mday, 2);
+            *out++ = ' ';
+        }
+        out = _write_fixed_digits(out, ts->tm_obj.tm_hour, 2);
+        *out++ = ':';
+        out = _write_fixed_digits(out, ts->tm_obj.tm_min, 2);
+        *out++ = ':';
+        out = _write_fixed_digits(out, ts->tm_obj.tm_sec, 2);
+        if (ts->scale > 0) {
+            *out++ = '.';
+            out = _write_fixed_digits(out, ts->nsec / pow10_int64[9 - ts->scale], ts->scale);
+        }
+        *out = '\0';
+        len = out - buffer;
+    } else {
+        len = strftime(buffer, buf_size, fmt0, &ts->tm_obj);
+        if (ts->scale > 0) {
+            /* adjust scale */
+            char fmt_static[20];
+            sb_sprintf(fmt_static, sizeof(fmt_static), ".%%0%dld", ts->scale);
+            int64 nsec = ts->nsec / pow10_int64[9-ts->scale];
+            len += sb_sprintf(
+              &(buffer)[len],
+              max_len - len, fmt_static,
+              nsec);
+        }
     }
     if (ts->ts_type == SF_DB_TYPE_TIMESTAMP_TZ) {
         /* Timezone info */
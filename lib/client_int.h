@@ -12,6 +12,7 @@
 
 #define HEADER_SNOWFLAKE_TOKEN_FORMAT "Authorization: Snowflake Token=\"%s\""
 #define HEADER_CONTENT_TYPE_APPLICATION_JSON "Content-Type: application/json"
+#define HEADER_CONTENT_ENCODING_GZIP "Content-Encoding: gzip"
 #define HEADER_ACCEPT_TYPE_APPLICATION_SNOWFLAKE "accept: application/snowflake"
 #define HEADER_ACCEPT_TYPE_APPLICATION_JSON "accept: application/json"
 #define HEADER_C_API_USER_AGENT_FORMAT "User-Agent: %s/%s (%s_%s) %s/%lu"
@@ -26,6 +27,16 @@
 #define QUERY_URL "/queries/v1/query-request"
 #define RENEW_SESSION_URL "/session/token-request"
 #define DELETE_SESSION_URL "/session"
+#define SESSION_HEARTBEAT_URL "/session/heartbeat"
+#define QUERY_MONITORING_URL "/monitoring/queries/%s"
+#define QUERY_RESULT_URL "/queries/%s/result"
+
+// Connections opened by snowflake_warmup()
+#define SF_WARMUP_CONNECTIONS 2
+
+// Read by the OCSP checks in curl, which have no access to the global attributes
+#define SF_OCSP_RESPONSE_CACHE_DIR_ENV "SF_OCSP_RESPONSE_CACHE_DIR"
+#define SF_OCSP_RESPONSE_CACHE_TTL_ENV "SF_OCSP_RESPONSE_CACHE_TTL"
 
 #define URL_QUERY_DELIMITER "?"
 #define URL_PARAM_DELIM "&"
@@ -104,10 +115,28 @@ struct SF_PUT_GET_RESPONSE {
 typedef struct NAMED_PARAMS
 {
     void ** name_list;
+    // Hashes of the names, computed once when they are bound
+    uint64 * hashes;
     unsigned int used;
     unsigned int allocd;
 }NamedParams;
 
+/**
+ * Column bound with snowflake_bind_column(), with what its values are converted to.
+ */
+typedef struct SF_BOUND_COLUMN
+{
+    int idx;
+    SF_C_TYPE c_type;
+    void *buffer;
+    // Size of a value for the C type, the string size for strings
+    size_t value_size;
+    // Bytes between the values of consecutive rows, and between their indicators
+    size_t stride;
+    int64 *indicator;
+    size_t indicator_stride;
+}SF_BOUND_COLUMN;
+
 /**
  * Allocate memory for put get response struct
  */
@@ -126,13 +155,15 @@ SF_PUT_GET_RESPONSE *STDCALL sf_put_get_response_allocate();
  * @param raw_response_buffer optional pointer to an SF_QUERY_RESULT_CAPTURE,
  * @param is_describe_only should the statement be executed in describe only mode
  * if the query response is to be captured.
+ * @param is_async_exec should the call return once the query is submitted
  *
  * @return 0 if success, otherwise an errno is returned.
  */
 SF_STATUS STDCALL _snowflake_execute_ex(SF_STMT *sfstmt,
                                         sf_bool use_application_json_accept_type,
                                         struct SF_QUERY_RESULT_CAPTURE* result_capture,
-                                        sf_bool is_describe_only);
+                                        sf_bool is_describe_only,
+                                        sf_bool is_async_exec);
 
 /**
  * @return true if this is a put/get command, otherwise false
@@ -144,4 +175,20 @@ sf_bool STDCALL _is_put_get_command(char* sql_text);
  */
 PARAM_TYPE STDCALL _snowflake_get_param_style(const SF_BIND_INPUT *input);
 
+/**
+ * @return NAMED/ POSITIONAL for the params bound to the statement
+ */
+PARAM_TYPE STDCALL _snowflake_get_current_param_style(const SF_STMT *sfstmt);
+
+/**
+ * Returns the value of a bind for a row, when an array of
+ * SF_STMT_PARAMSET_SIZE values is bound to it.
+ *
+ * @param input the bind.
+ * @param row the row, starting at 0.
+ *
+ * @return the address of the value.
+ */
+void *STDCALL _snowflake_bind_value_at(const SF_BIND_INPUT *input, uint64 row);
+
 #endif //SNOWFLAKE_CLIENT_INT_H
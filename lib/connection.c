@@ -3,6 +3,7 @@
  */
 
 #include <string.h>
+#include <zlib.h>
 #include "connection.h"
 #include <snowflake/logger.h>
 #include "snowflake/platform.h"
@@ -10,8 +11,11 @@
 #include "client_int.h"
 #include "constants.h"
 #include "error.h"
+#include "curl_pool.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "token_cache.h"
 
-#define curl_easier_escape(curl, string) curl_easy_escape(curl, string, 0)
 #define QUERYCODE_LEN 7
 #define REQUEST_GUID_KEY_SIZE 13
 
@@ -25,6 +29,8 @@ dump(const char *text, FILE *stream, unsigned char *ptr, size_t size,
 static int my_trace(CURL *handle, curl_infotype type, char *data, size_t size,
                     void *userp);
 
+static void header_cache_clear(SF_CONNECT *sf);
+
 static
 void dump(const char *text,
           FILE *stream, unsigned char *ptr, size_t size,
@@ -183,32 +189,89 @@ cJSON *STDCALL create_auth_json_body(SF_CONNECT *sf,
     return body;
 }
 
-cJSON *STDCALL create_query_json_body(const char *sql_text, int64 sequence_id, const char *request_id, sf_bool is_describe_only) {
-    cJSON *body;
-    double submission_time;
-    // Create body
+void STDCALL write_query_json_body(SF_JSON_WRITER *writer, const char *sql_text, int64 sequence_id,
+                                   const char *request_id, sf_bool is_describe_only,
+                                   sf_bool is_async_exec, int64 multi_stmt_count,
+                                   const char *result_format, int64 result_chunk_size,
+                                   const cJSON *parameters) {
+    int64 submission_time;
+    const cJSON *parameter;
+    sf_bool has_parameters = multi_stmt_count != 1 || result_format || result_chunk_size > 0 ||
+                             (parameters && parameters->child);
 #ifdef MOCK_ENABLED
     submission_time = 0;
 #else
-    submission_time = (double) time(NULL) * 1000;
+    submission_time = (int64) time(NULL) * 1000;
 #endif
-    body = snowflake_cJSON_CreateObject();
-    snowflake_cJSON_AddStringToObject(body, "sqlText", sql_text);
-    snowflake_cJSON_AddBoolToObject(body, "asyncExec", SF_BOOLEAN_FALSE);
-    snowflake_cJSON_AddNumberToObject(body, "sequenceId", (double) sequence_id);
-    snowflake_cJSON_AddNumberToObject(body, "querySubmissionTime", submission_time);
-    snowflake_cJSON_AddBoolToObject(body, "describeOnly", is_describe_only);
+    sf_json_writer_key(writer, "sqlText");
+    sf_json_writer_string(writer, sql_text);
+    sf_json_writer_key(writer, "asyncExec");
+    sf_json_writer_bool(writer, is_async_exec);
+    sf_json_writer_key(writer, "sequenceId");
+    sf_json_writer_int(writer, sequence_id);
+    sf_json_writer_key(writer, "querySubmissionTime");
+    sf_json_writer_int(writer, submission_time);
+    sf_json_writer_key(writer, "describeOnly");
+    sf_json_writer_bool(writer, is_describe_only);
     if (request_id)
     {
-        snowflake_cJSON_AddStringToObject(body, "requestId", request_id);
+        sf_json_writer_key(writer, "requestId");
+        sf_json_writer_string(writer, request_id);
     }
 
-#ifdef SF_WIN32
-    cJSON * parameters = snowflake_cJSON_CreateObject();
-    snowflake_cJSON_AddStringToObject(parameters, "C_API_QUERY_RESULT_FORMAT", "JSON");
-    snowflake_cJSON_AddItemToObject(body, "parameters", parameters);
+#ifdef SF_NO_ARROW
+    has_parameters = SF_BOOLEAN_TRUE;
 #endif
-    return body;
+    if (!has_parameters)
+    {
+        return;
+    }
+    sf_json_writer_key(writer, "parameters");
+    sf_json_writer_begin_object(writer);
+#ifdef SF_NO_ARROW
+    // Only JSON results can be read
+    result_format = "JSON";
+#endif
+    if (result_format)
+    {
+        sf_json_writer_key(writer, "C_API_QUERY_RESULT_FORMAT");
+        sf_json_writer_string(writer, result_format);
+    }
+    if (multi_stmt_count != 1)
+    {
+        sf_json_writer_key(writer, "MULTI_STATEMENT_COUNT");
+        sf_json_writer_int(writer, multi_stmt_count);
+    }
+    if (result_chunk_size > 0)
+    {
+        sf_json_writer_key(writer, "CLIENT_RESULT_CHUNK_SIZE");
+        sf_json_writer_int(writer, result_chunk_size);
+    }
+    for (parameter = parameters ? parameters->child : NULL; parameter; parameter = parameter->next)
+    {
+        // The parameters of their own take precedence
+        if ((result_format && strcmp(parameter->string, "C_API_QUERY_RESULT_FORMAT") == 0) ||
+            (multi_stmt_count != 1 && strcmp(parameter->string, "MULTI_STATEMENT_COUNT") == 0) ||
+            (result_chunk_size > 0 && strcmp(parameter->string, "CLIENT_RESULT_CHUNK_SIZE") == 0))
+        {
+            continue;
+        }
+        sf_json_writer_key(writer, parameter->string);
+        if (snowflake_cJSON_IsString(parameter))
+        {
+            sf_json_writer_string(writer, parameter->valuestring);
+        }
+        else if (snowflake_cJSON_IsBool(parameter))
+        {
+            sf_json_writer_bool(writer, snowflake_cJSON_IsTrue(parameter) ?
+                                        SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE);
+        }
+        else
+        {
+            sf_json_writer_int(writer, (int64) parameter->valuedouble);
+        }
+    }
+    sf_json_writer_end_object(writer);
 }
 
 cJSON *STDCALL create_renew_session_json_body(const char *old_token) {
@@ -226,21 +289,48 @@ sf_bool STDCALL create_header(SF_CONNECT *sf, SF_HEADER *header, SF_ERROR_STRUCT
     size_t header_token_size;
     size_t header_direct_query_token_size;
     size_t header_service_name_size;
-    const char *token = header->renew_session ? sf->master_token : sf->token;
-
-    // Generate header tokens
+    const char *token;
+    sf_bool has_token;
+    int cache_index = header->use_application_json_accept_type ? 1 : 0;
+    uint64 generation;
+    SF_HEADER_LIST *shared;
+
+    header->compress_body_threshold = (size_t) sf->request_compression_threshold;
+
+    // Generate header tokens. The tokens may be renewed by another thread meanwhile.
+    _mutex_lock(&sf->mutex_token);
+    // The list built for the current tokens is shared by the requests that don't renew them
+    shared = header->renew_session ? NULL : sf->header_cache[cache_index];
+    if (shared) {
+        sf_atomic_fetch_add(&shared->refs, 1);
+        header->token_generation = sf->token_generation;
+        _mutex_unlock(&sf->mutex_token);
+        header->shared = shared;
+        header->header = shared->list;
+        return SF_BOOLEAN_TRUE;
+    }
+    generation = sf->header_generation;
+    header->token_generation = sf->token_generation;
+    token = header->renew_session ? sf->master_token : sf->token;
+    has_token = token != NULL;
     if (token) {
         header_token_size = strlen(HEADER_SNOWFLAKE_TOKEN_FORMAT) - 2 +
                             strlen(token) + 1;
         header->header_token = (char *) SF_CALLOC(1, header_token_size);
+        if (header->header_token) {
+            sb_sprintf(header->header_token, header_token_size,
+                     HEADER_SNOWFLAKE_TOKEN_FORMAT, token);
+        }
+    }
+    _mutex_unlock(&sf->mutex_token);
+
+    if (has_token) {
         if (!header->header_token) {
             SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
                                 "Ran out of memory trying to create header token",
                                 SF_SQLSTATE_UNABLE_TO_CONNECT);
             goto error;
         }
-        sb_sprintf(header->header_token, header_token_size,
-                 HEADER_SNOWFLAKE_TOKEN_FORMAT, token);
     } else if (sf->direct_query_token) {
         header_direct_query_token_size = strlen(HEADER_DIRECT_QUERY_TOKEN_FORMAT) - 2 +
                                          strlen(sf->direct_query_token) + 1;
@@ -295,6 +385,23 @@ sf_bool STDCALL create_header(SF_CONNECT *sf, SF_HEADER *header, SF_ERROR_STRUCT
 
     log_trace("Created header");
 
+    // Share the list, unless the tokens changed while it was built
+    if (!header->renew_session) {
+        _mutex_lock(&sf->mutex_token);
+        if (header->header && generation == sf->header_generation &&
+            !sf->header_cache[cache_index]) {
+            shared = (SF_HEADER_LIST *) SF_CALLOC(1, sizeof(SF_HEADER_LIST));
+            if (shared) {
+                shared->list = header->header;
+                // One for the cache, one for this header
+                shared->refs = 2;
+                header->shared = shared;
+                sf->header_cache[cache_index] = shared;
+            }
+        }
+        _mutex_unlock(&sf->mutex_token);
+    }
+
     // All good :dancingpenguin:
     ret = SF_BOOLEAN_TRUE;
 
@@ -302,6 +409,18 @@ error:
     return ret;
 }
 
+/**
+ * Moves the response text kept by the header of a request sent again with a renewed session
+ * to the header of the caller.
+ */
+static void take_raw_response(SF_HEADER *header, SF_HEADER *new_header) {
+    if (new_header->raw_response) {
+        SF_FREE(header->raw_response);
+        header->raw_response = new_header->raw_response;
+        new_header->raw_response = NULL;
+    }
+}
+
 sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
                                CURL *curl,
                                char *url,
@@ -317,19 +436,28 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
     SF_HEADER *new_header = NULL;
     sf_bool ret = SF_BOOLEAN_FALSE;
     sf_bool stop = SF_BOOLEAN_FALSE;
+    SF_RETRY_POLICY retry_policy;
+    uint64 poll_interval = sf->query_poll_min_interval;
+    unsigned long long poll_start;
+    unsigned long long poll_elapsed;
+    SF_TRACE_SPAN span;
 
     // Set to 0
     memset(query_code, 0, QUERYCODE_LEN);
+    retry_policy_init(&retry_policy, sf, SF_RETRY_CLASS_REQUEST);
 
     do {
+        sf_span_start_child(&span, "query.request", header->trace, 0);
         if (!http_perform(curl, POST_REQUEST_TYPE, url, header, body, json, NULL,
                           sf->network_timeout, SF_BOOLEAN_FALSE, error,
                           sf->insecure_mode,
-                          sf->retry_on_curle_couldnt_connect_count) ||
+                          sf->retry_on_curle_couldnt_connect_count, &retry_policy) ||
             !*json) {
             // Error is set in the perform function
+            sf_span_end(&span, error->error_code);
             break;
         }
+        sf_span_end(&span, SF_STATUS_SUCCESS);
         if ((json_error = json_copy_string_no_alloc(query_code, *json, "code",
                                                     QUERYCODE_LEN)) !=
             SF_JSON_ERROR_NONE &&
@@ -347,7 +475,7 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
         }
 
         if (strcmp(query_code, SESSION_TOKEN_EXPIRED_CODE) == 0) {
-            if (!renew_session(curl, sf, error)) {
+            if (!renew_expired_session(curl, sf, header, error)) {
                 // Error is set in renew session function
                 break;
             } else {
@@ -355,6 +483,10 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
                 new_header = sf_header_create();
                 new_header->use_application_json_accept_type = SF_BOOLEAN_FALSE;
                 new_header->renew_session = SF_BOOLEAN_FALSE;
+                new_header->async_exec = header->async_exec;
+                new_header->trace = header->trace;
+                new_header->keep_raw_response = header->keep_raw_response;
+                new_header->skip_rowset = header->skip_rowset;
                 if (!create_header(sf, new_header, error)) {
                     break;
                 }
@@ -363,6 +495,7 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
                     // Error is set in curl call
                     break;
                 }
+                take_raw_response(header, new_header);
             }
         }
         else if (strcmp(query_code, SESSION_TOKEN_INVALID_CODE) == 0) {
@@ -376,6 +509,18 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
             break;
         }
 
+        // The query id of an asynchronous query is all the caller waits for
+        if (header->async_exec && strcmp(query_code, QUERY_IN_PROGRESS_ASYNC_CODE) == 0) {
+            ret = SF_BOOLEAN_TRUE;
+            break;
+        }
+
+        if (strcmp(query_code, QUERY_IN_PROGRESS_CODE) == 0 ||
+            strcmp(query_code, QUERY_IN_PROGRESS_ASYNC_CODE) == 0) {
+            sf_span_start_child(&span, "query.poll", header->trace, 0);
+            json_copy_string_no_alloc(span.sfqid, snowflake_cJSON_GetObjectItem(*json, "data"),
+                                      "queryId", SF_UUID4_LEN);
+        }
         while (strcmp(query_code, QUERY_IN_PROGRESS_CODE) == 0 ||
                strcmp(query_code, QUERY_IN_PROGRESS_ASYNC_CODE) == 0) {
             // Remove old result URL and query code if this isn't our first rodeo
@@ -392,6 +537,7 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
             }
 
             log_trace("ping pong starting...");
+            poll_start = sf_monotonic_time_ms();
             if (!request(sf, json, result_url, NULL, 0, NULL, header,
                          GET_REQUEST_TYPE, error, SF_BOOLEAN_FALSE)) {
                 // Error came from request up, just break
@@ -410,8 +556,27 @@ sf_bool STDCALL curl_post_call(SF_CONNECT *sf,
                                     SF_SQLSTATE_UNABLE_TO_CONNECT);
                 break;
             }
+
+            /* The server holds the result request for a while before answering that the
+             * query is still running. Only wait when it answered sooner, and back off so that
+             * long running queries are not checked on more often than needed. */
+            if ((strcmp(query_code, QUERY_IN_PROGRESS_CODE) == 0 ||
+                 strcmp(query_code, QUERY_IN_PROGRESS_ASYNC_CODE) == 0) &&
+                sf->query_poll_max_interval > 0) {
+                poll_elapsed = sf_monotonic_time_ms() - poll_start;
+                if (poll_elapsed < poll_interval) {
+                    log_trace("Query in progress, checking again in %llu ms",
+                              (unsigned long long) (poll_interval - poll_elapsed));
+                    sf_sleep_ms((unsigned int) (poll_interval - poll_elapsed));
+                }
+                poll_interval = poll_interval > 0 ? poll_interval * 2 : 1;
+                if (poll_interval > sf->query_poll_max_interval) {
+                    poll_interval = sf->query_poll_max_interval;
+                }
+            }
         }
 
+        sf_span_end(&span, stop ? error->error_code : SF_STATUS_SUCCESS);
         if (stop) {
             break;
         }
@@ -438,15 +603,17 @@ sf_bool STDCALL curl_get_call(SF_CONNECT *sf,
     char *result_url = NULL;
     SF_HEADER *new_header = NULL;
     sf_bool ret = SF_BOOLEAN_FALSE;
+    SF_RETRY_POLICY retry_policy;
 
     // Set to 0
     memset(query_code, 0, QUERYCODE_LEN);
+    retry_policy_init(&retry_policy, sf, SF_RETRY_CLASS_POLL);
 
     do {
         if (!http_perform(curl, GET_REQUEST_TYPE, url, header, NULL, json, NULL,
                           sf->network_timeout, SF_BOOLEAN_FALSE, error,
                           sf->insecure_mode,
-                          sf->retry_on_curle_couldnt_connect_count) ||
+                          sf->retry_on_curle_couldnt_connect_count, &retry_policy) ||
             !*json) {
             // Error is set in the perform function
             break;
@@ -468,12 +635,14 @@ sf_bool STDCALL curl_get_call(SF_CONNECT *sf,
         }
 
         if (strcmp(query_code, SESSION_TOKEN_EXPIRED_CODE) == 0) {
-            if (!renew_session(curl, sf, error)) {
+            if (!renew_expired_session(curl, sf, header, error)) {
                 // Error is set in renew session function
                 break;
             } else {
                 // Create new header since we have a new token
                 new_header = sf_header_create();
+                new_header->keep_raw_response = header->keep_raw_response;
+                new_header->skip_rowset = header->skip_rowset;
                 if (!create_header(sf, new_header, error)) {
                     break;
                 }
@@ -481,6 +650,7 @@ sf_bool STDCALL curl_get_call(SF_CONNECT *sf,
                     // Error is set in curl call
                     break;
                 }
+                take_raw_response(header, new_header);
             }
         }
         else if (strcmp(query_code, SESSION_TOKEN_INVALID_CODE) == 0) {
@@ -526,7 +696,51 @@ decorrelate_jitter_next_sleep(DECORRELATE_JITTER_BACKOFF *djb, uint32 sleep) {
     {
       sleep = 4;
     }
-    return ((uint32)(sleep/2) + (uint32) (rand() % (sleep/2)));
+    return uimax((uint32)(sleep/2) + (uint32) (rand() % (sleep/2)), djb->base);
+}
+
+/**
+ * Whether curl_easy_escape() leaves a character as is.
+ */
+static sf_bool url_unreserved(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+/**
+ * Length of a value percent-encoded the way curl_easy_escape() does.
+ */
+static size_t url_escaped_len(const char *value) {
+    size_t len = 0;
+
+    for (; *value; value++) {
+        len += url_unreserved((unsigned char) *value) ? 1 : 3;
+    }
+    return len;
+}
+
+/**
+ * Percent-encodes a value into dest, which has room for url_escaped_len(value) characters.
+ */
+static void url_escape(char *dest, const char *value) {
+    static const char hex[] = "0123456789ABCDEF";
+    unsigned char c;
+
+    for (; *value; value++) {
+        c = (unsigned char) *value;
+        if (url_unreserved(c)) {
+            *dest++ = (char) c;
+        } else {
+            *dest++ = '%';
+            *dest++ = hex[c >> 4];
+            *dest++ = hex[c & 0xf];
+        }
+    }
+}
+
+static size_t url_append(char *dest, size_t len, const char *text, size_t text_len) {
+    memcpy(dest + len, text, text_len);
+    return len + text_len;
 }
 
 char * STDCALL encode_url(CURL *curl,
@@ -548,15 +762,10 @@ char * STDCALL encode_url(CURL *curl,
     size_t base_url_size = 1; //Null terminator
     // Size used to determine buffer size
     size_t encoded_url_size;
-    // Initialize reqeust_guid with a blank uuid that will be replaced for each request
-    URL_KEY_VALUE request_guid = {
-      "request_guid=",
-      "00000000-0000-0000-0000-000000000000",
-      NULL,
-      NULL,
-      0,
-      0
-    };
+    // Blank request_guid that http_perform replaces for each request
+    const char *request_guid_key = "request_guid=";
+    const char *request_guid_value = "00000000-0000-0000-0000-000000000000";
+    size_t len;
     const char *amp = "&";
     size_t amp_size = strlen(amp);
 
@@ -591,28 +800,22 @@ char * STDCALL encode_url(CURL *curl,
       strlen(url) + strlen(URL_QUERY_DELIMITER);
 
     encoded_url_size = base_url_size;
-    // Encode URL parameters and set size info
+    // Size the URL parameters. They are escaped straight into the URL, which is allocated once.
     for (i = 0; i < num_args; i++) {
         if (vars[i].value && *vars[i].value) {
             vars[i].formatted_key = vars[i].key;
-            vars[i].formatted_value = curl_easier_escape(curl, vars[i].value);
+            vars[i].value_size = url_escaped_len(vars[i].value);
         } else {
             vars[i].formatted_key = "";
-            vars[i].formatted_value = curl_easier_escape(curl, "");
+            vars[i].value_size = 0;
         }
         vars[i].key_size = strlen(vars[i].formatted_key);
-        vars[i].value_size = strlen(vars[i].formatted_value);
         // Add an ampersand for each URL parameter since we are going to add request_guid to the end
         encoded_url_size += vars[i].key_size + vars[i].value_size + amp_size;
     }
 
-    // Encode request_guid and set size info
-    request_guid.formatted_key = request_guid.key;
-    request_guid.formatted_value = curl_easier_escape(curl, request_guid.value);
-    request_guid.key_size = strlen(request_guid.formatted_key);
-    request_guid.value_size = strlen(request_guid.formatted_value);
-    encoded_url_size += request_guid.key_size + request_guid.value_size;
-
+    // The request_guid placeholder needs no escaping
+    encoded_url_size += strlen(request_guid_key) + strlen(request_guid_value);
 
     encoded_url_size += extraUrlParams ?
                         strlen(extraUrlParams) + strlen(URL_PARAM_DELIM) : 0;
@@ -622,42 +825,40 @@ char * STDCALL encode_url(CURL *curl,
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
                             "Ran out of memory trying to create encoded url",
                             SF_SQLSTATE_UNABLE_TO_CONNECT);
-        goto cleanup;
+        return NULL;
     }
     sb_sprintf(encoded_url, base_url_size, format, protocol, account, host, port,
              url);
+    len = strlen(encoded_url);
 
     // Initially add the query delimiter "?"
-    sb_strncat(encoded_url, encoded_url_size, URL_QUERY_DELIMITER, strlen(URL_QUERY_DELIMITER));
+    len = url_append(encoded_url, len, URL_QUERY_DELIMITER, strlen(URL_QUERY_DELIMITER));
 
     // Add encoded URL parameters to encoded_url buffer
     for (i = 0; i < num_args; i++) {
-        sb_strncat(encoded_url, encoded_url_size, vars[i].formatted_key, vars[i].key_size);
-        sb_strncat(encoded_url, encoded_url_size, vars[i].formatted_value, vars[i].value_size);
-        sb_strncat(encoded_url, encoded_url_size, amp, amp_size);
+        len = url_append(encoded_url, len, vars[i].formatted_key, vars[i].key_size);
+        if (vars[i].value_size > 0) {
+            url_escape(encoded_url + len, vars[i].value);
+            len += vars[i].value_size;
+        }
+        len = url_append(encoded_url, len, amp, amp_size);
     }
 
-    // Add encoded request_guid to encoded_url buffer
-    sb_strncat(encoded_url, encoded_url_size, request_guid.formatted_key, request_guid.key_size);
-    sb_strncat(encoded_url, encoded_url_size, request_guid.formatted_value, request_guid.value_size);
+    // Add request_guid to encoded_url buffer
+    len = url_append(encoded_url, len, request_guid_key, strlen(request_guid_key));
+    len = url_append(encoded_url, len, request_guid_value, strlen(request_guid_value));
 
     // Adding the extra url param (setter of extraUrlParams is responsible to make
     // sure extraUrlParams is correct)
     if (extraUrlParams && !is_string_empty(extraUrlParams))
     {
-      sb_strncat(encoded_url, encoded_url_size, URL_PARAM_DELIM, 1);
-      sb_strncat(encoded_url, encoded_url_size, extraUrlParams, strlen(extraUrlParams));
+      len = url_append(encoded_url, len, URL_PARAM_DELIM, 1);
+      len = url_append(encoded_url, len, extraUrlParams, strlen(extraUrlParams));
     }
+    encoded_url[len] = '\0';
 
     log_debug("URL: %s", encoded_url);
 
-cleanup:
-    // Free created memory
-    for (i = 0; i < num_args; i++) {
-        curl_free(vars[i].formatted_value);
-    }
-    curl_free(request_guid.formatted_value);
-
     return encoded_url;
 }
 
@@ -665,6 +866,28 @@ sf_bool is_string_empty(const char *str) {
     return (str && strcmp(str, "") != 0) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
 }
 
+sf_bool STDCALL sf_same_name(const char *name, const char *other) {
+    if (!name || !other) {
+        return name == other;
+    }
+    return strcmp(name, other) == 0;
+}
+
+char *STDCALL sf_copy_name(const char *name) {
+    char *copy;
+    size_t len;
+
+    if (!name) {
+        return NULL;
+    }
+    len = strlen(name) + 1;
+    copy = (char *) SF_CALLOC(1, len);
+    if (copy) {
+        sb_strcpy(copy, len, name);
+    }
+    return copy;
+}
+
 SF_JSON_ERROR STDCALL
 json_copy_string(char **dest, cJSON *data, const char *item) {
     size_t blob_size;
@@ -843,15 +1066,87 @@ ARRAY_LIST *json_get_object_keys(const cJSON *item) {
 size_t
 json_resp_cb(char *data, size_t size, size_t nmemb, RAW_JSON_BUFFER *raw_json) {
     size_t data_size = size * nmemb;
-    log_debug("Curl response size: %zu", data_size);
-    raw_json->buffer = (char *) SF_REALLOC(raw_json->buffer,
-                                           raw_json->size + data_size + 1);
+    log_trace("Curl response size: %zu", data_size);
+    // Anything but data_size makes curl fail the transfer
+    return raw_json_buffer_append(raw_json, data, data_size) ? data_size : 0;
+}
+
+sf_bool STDCALL raw_json_buffer_reserve(RAW_JSON_BUFFER *raw_json, size_t len) {
+    size_t capacity;
+    char *buffer;
+
+    if (raw_json->size + len + 1 <= raw_json->capacity) {
+        return SF_BOOLEAN_TRUE;
+    }
+    capacity = raw_json->capacity > 0 ? raw_json->capacity * 2 : RAW_JSON_BUFFER_INITIAL_SIZE;
+    if (capacity < raw_json->size + len + 1) {
+        capacity = raw_json->size + len + 1;
+    }
+    buffer = (char *) SF_TAG_REALLOC(raw_json->tag, raw_json->buffer, raw_json->capacity, capacity);
+    if (!buffer) {
+        return SF_BOOLEAN_FALSE;
+    }
+    raw_json->buffer = buffer;
+    raw_json->capacity = capacity;
+    return SF_BOOLEAN_TRUE;
+}
+
+sf_bool STDCALL raw_json_buffer_append(RAW_JSON_BUFFER *raw_json, const char *data, size_t len) {
+    if (!raw_json_buffer_reserve(raw_json, len)) {
+        return SF_BOOLEAN_FALSE;
+    }
     // Start copying where last null terminator existed
-    sb_memcpy(&raw_json->buffer[raw_json->size], data_size, data, data_size);
-    raw_json->size += data_size;
+    memcpy(&raw_json->buffer[raw_json->size], data, len);
+    raw_json->size += len;
     // Set null terminator
     raw_json->buffer[raw_json->size] = '\0';
-    return data_size;
+    return SF_BOOLEAN_TRUE;
+}
+
+void STDCALL raw_json_buffer_free(RAW_JSON_BUFFER *raw_json) {
+    SF_TAG_FREE(raw_json->tag, raw_json->buffer, raw_json->capacity);
+    raw_json->size = 0;
+    raw_json->capacity = 0;
+}
+
+sf_bool STDCALL gzip_compress(const char *data, size_t len, char **compressed,
+                              size_t *compressed_len) {
+    z_stream strm;
+    uLong bound;
+    char *buffer;
+    int res;
+
+    *compressed = NULL;
+    *compressed_len = 0;
+    if (len > SF_UINT32_MAX) {
+        return SF_BOOLEAN_FALSE;
+    }
+    memset(&strm, 0, sizeof(strm));
+    // 15 bits of window plus 16 for a gzip header and trailer instead of a zlib one
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return SF_BOOLEAN_FALSE;
+    }
+    // The whole output fits, so a single deflate call finishes the stream
+    bound = deflateBound(&strm, (uLong) len);
+    buffer = (char *) SF_MALLOC(bound);
+    if (!buffer) {
+        deflateEnd(&strm);
+        return SF_BOOLEAN_FALSE;
+    }
+    strm.next_in = (Bytef *) data;
+    strm.avail_in = (uInt) len;
+    strm.next_out = (Bytef *) buffer;
+    strm.avail_out = (uInt) bound;
+    res = deflate(&strm, Z_FINISH);
+    deflateEnd(&strm);
+    if (res != Z_STREAM_END) {
+        SF_FREE(buffer);
+        return SF_BOOLEAN_FALSE;
+    }
+    *compressed = buffer;
+    *compressed_len = (size_t) strm.total_out;
+    return SF_BOOLEAN_TRUE;
 }
 
 sf_bool STDCALL is_retryable_http_code(long int code) {
@@ -859,6 +1154,10 @@ sf_bool STDCALL is_retryable_http_code(long int code) {
             code == 408) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
 }
 
+sf_bool STDCALL is_expired_url_http_code(long int code) {
+    return (code == 400 || code == 403) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
 sf_bool STDCALL request(SF_CONNECT *sf,
                         cJSON **json,
                         const char *url,
@@ -873,7 +1172,7 @@ sf_bool STDCALL request(SF_CONNECT *sf,
     CURL *curl = NULL;
     char *encoded_url = NULL;
     SF_HEADER *my_header = NULL;
-    curl = curl_easy_init();
+    curl = sf_curl_pool_acquire(sf->curl_pool);
     if (curl) {
         // Use passed in header if one exists
         if (header) {
@@ -914,13 +1213,16 @@ cleanup:
     if (!header) {
         sf_header_destroy(my_header);
     }
-    curl_easy_cleanup(curl);
+    sf_curl_pool_release(sf->curl_pool, curl);
     SF_FREE(encoded_url);
 
     return ret;
 }
 
-sf_bool STDCALL renew_session(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error) {
+/**
+ * Renews the session. The caller holds sf->mutex_renew_session.
+ */
+static sf_bool renew_session_locked(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error) {
     sf_bool ret = SF_BOOLEAN_FALSE;
     if (!is_string_empty(sf->directURL))
     {
@@ -964,8 +1266,10 @@ sf_bool STDCALL renew_session(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error
     }
 
     // Create body and convert to string
+    _mutex_lock(&sf->mutex_token);
     body = create_renew_session_json_body(sf->token);
-    s_body = snowflake_cJSON_Print(body);
+    _mutex_unlock(&sf->mutex_token);
+    s_body = snowflake_cJSON_PrintUnformatted(body);
 
     // Create request id, set in url parameter and encode url
     uuid4_generate(request_id);
@@ -995,6 +1299,8 @@ sf_bool STDCALL renew_session(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_RESPONSE,
                             "Request returned as being unsuccessful",
                             SF_SQLSTATE_UNABLE_TO_CONNECT);
+        // The master token was rejected, the next process is to log in
+        sf_token_cache_remove(sf);
         goto cleanup;
     } else if (!(data = snowflake_cJSON_GetObjectItem(json, "data"))) {
         log_error("Missing data field in response");
@@ -1013,10 +1319,12 @@ sf_bool STDCALL renew_session(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error
         if (!set_tokens(sf, data, "sessionToken", "masterToken", error)) {
             goto cleanup;
         }
+        sf_token_cache_save(sf, data, "sessionToken");
         log_debug("Finished updating session");
     }
 
     ret = SF_BOOLEAN_TRUE;
+    sf_metric_add(SF_COUNTER_TOKEN_RENEWALS, 1);
 
 cleanup:
     sf_header_destroy(header);
@@ -1028,6 +1336,34 @@ cleanup:
     return ret;
 }
 
+sf_bool STDCALL renew_session(CURL *curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error) {
+    sf_bool ret;
+
+    _mutex_lock(&sf->mutex_renew_session);
+    ret = renew_session_locked(curl, sf, error);
+    _mutex_unlock(&sf->mutex_renew_session);
+    return ret;
+}
+
+sf_bool STDCALL renew_expired_session(CURL *curl, SF_CONNECT *sf, const SF_HEADER *header,
+                                      SF_ERROR_STRUCT *error) {
+    sf_bool renewed;
+    sf_bool ret = SF_BOOLEAN_TRUE;
+
+    _mutex_lock(&sf->mutex_renew_session);
+    // The requests that failed with the same token wait here for the first one to renew it
+    _mutex_lock(&sf->mutex_token);
+    renewed = sf->token_generation != header->token_generation;
+    _mutex_unlock(&sf->mutex_token);
+    if (renewed) {
+        log_debug("Session token already renewed by another request");
+    } else {
+        ret = renew_session_locked(curl, sf, error);
+    }
+    _mutex_unlock(&sf->mutex_renew_session);
+    return ret;
+}
+
 void STDCALL reset_curl(CURL *curl) {
     curl_easy_reset(curl);
 }
@@ -1041,8 +1377,9 @@ RETRY_CONTEXT *STDCALL retry_ctx_init(uint64 timeout) {
                                                            sizeof(RETRY_CONTEXT));
     retry_ctx->retry_timeout = timeout;
     retry_ctx->retry_count = 0;
-    retry_ctx->sleep_time = 1;
-    retry_ctx->djb = decorrelate_jitter_init(1, 16);
+    retry_ctx->sleep_time = SF_DEFAULT_RETRY_BACKOFF_BASE;
+    retry_ctx->djb = decorrelate_jitter_init(SF_DEFAULT_RETRY_BACKOFF_BASE,
+                                             SF_DEFAULT_RETRY_BACKOFF_CAP);
     return retry_ctx;
 }
 
@@ -1052,28 +1389,119 @@ uint32 STDCALL retry_ctx_next_sleep(RETRY_CONTEXT *retry_ctx) {
     return retry_ctx->sleep_time;
 }
 
+void STDCALL retry_policy_init(SF_RETRY_POLICY *policy, SF_CONNECT *sf,
+                               SF_RETRY_CLASS retry_class) {
+    uint64 base;
+    uint64 cap;
+
+    switch (retry_class) {
+        case SF_RETRY_CLASS_POLL:
+            base = sf->poll_retry_backoff_base;
+            cap = sf->poll_retry_backoff_cap;
+            break;
+        case SF_RETRY_CLASS_CHUNK:
+            base = sf->chunk_retry_backoff_base;
+            cap = sf->chunk_retry_backoff_cap;
+            break;
+        default:
+            base = sf->retry_backoff_base;
+            cap = sf->retry_backoff_cap;
+            break;
+    }
+    // The sleep time is doubled before it is capped, keep it in range
+    policy->backoff.cap = (uint32) (cap < SF_UINT32_MAX / 2 ? cap : SF_UINT32_MAX / 2);
+    policy->backoff.base = (uint32) (base < policy->backoff.cap ? base : policy->backoff.cap);
+    if (sf->retry_budget > 0) {
+        policy->budget_tokens = &sf->retry_tokens;
+        policy->budget_max = sf->retry_budget * SF_RETRY_TOKEN_COST;
+    } else {
+        policy->budget_tokens = NULL;
+        policy->budget_max = 0;
+    }
+}
+
+sf_bool STDCALL retry_policy_take(const SF_RETRY_POLICY *policy) {
+    uint64 tokens;
+    if (!policy || !policy->budget_tokens) {
+        return SF_BOOLEAN_TRUE;
+    }
+    // Taken only while enough are left, so that concurrent retries can't wrap the count
+    do {
+        tokens = sf_atomic_load(policy->budget_tokens);
+        if (tokens < SF_RETRY_TOKEN_COST) {
+            log_warn("Retry budget of the connection is exhausted, not retrying");
+            return SF_BOOLEAN_FALSE;
+        }
+    } while (!sf_atomic_compare_exchange(policy->budget_tokens, tokens,
+                                         tokens - SF_RETRY_TOKEN_COST));
+    return SF_BOOLEAN_TRUE;
+}
+
+void STDCALL retry_policy_refund(const SF_RETRY_POLICY *policy) {
+    uint64 tokens;
+    if (!policy || !policy->budget_tokens) {
+        return;
+    }
+    do {
+        tokens = sf_atomic_load(policy->budget_tokens);
+        if (tokens >= policy->budget_max) {
+            return;
+        }
+    } while (!sf_atomic_compare_exchange(policy->budget_tokens, tokens, tokens + 1));
+}
+
 sf_bool STDCALL set_tokens(SF_CONNECT *sf,
                            cJSON *data,
                            const char *session_token_str,
                            const char *master_token_str,
                            SF_ERROR_STRUCT *error) {
+    char *token = NULL;
+    char *master_token = NULL;
+    cJSON *validity;
+    unsigned long long validity_ms;
+
     // Get token
-    if (json_copy_string(&sf->token, data, session_token_str)) {
+    if (json_copy_string(&token, data, session_token_str)) {
         log_error("No valid token found in response");
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_JSON,
                             "Cannot find valid session token in response",
                             SF_SQLSTATE_UNABLE_TO_CONNECT);
+        SF_FREE(token);
         return SF_BOOLEAN_FALSE;
     }
     // Get master token
-    if (json_copy_string(&sf->master_token, data, master_token_str)) {
+    if (json_copy_string(&master_token, data, master_token_str)) {
         log_error("No valid master token found in response");
         SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_JSON,
                             "Cannot find valid master token in response",
                             SF_SQLSTATE_UNABLE_TO_CONNECT);
+        SF_FREE(token);
+        SF_FREE(master_token);
         return SF_BOOLEAN_FALSE;
     }
 
+    // The login response and the renewal response name the validity differently
+    validity = snowflake_cJSON_GetObjectItem(data, "validityInSeconds");
+    if (!snowflake_cJSON_IsNumber(validity)) {
+        validity = snowflake_cJSON_GetObjectItem(data, "validityInSecondsST");
+    }
+
+    _mutex_lock(&sf->mutex_token);
+    SF_FREE(sf->token);
+    SF_FREE(sf->master_token);
+    sf->token = token;
+    sf->master_token = master_token;
+    sf->token_generation++;
+    header_cache_clear(sf);
+    if (snowflake_cJSON_IsNumber(validity) && validity->valuedouble > 0) {
+        // Renew when nine tenths of the validity have passed
+        validity_ms = (unsigned long long) (validity->valuedouble * 1000);
+        sf->token_renew_at_ms = sf_monotonic_time_ms() + validity_ms - validity_ms / 10;
+    } else {
+        sf->token_renew_at_ms = SF_TOKEN_RENEW_NEVER;
+    }
+    _mutex_unlock(&sf->mutex_token);
+
     return SF_BOOLEAN_TRUE;
 }
 
@@ -1085,9 +1513,44 @@ SF_HEADER* STDCALL sf_header_create() {
     sf_header->header_token = NULL;
     sf_header->use_application_json_accept_type = SF_BOOLEAN_FALSE;
     sf_header->renew_session = SF_BOOLEAN_FALSE;
+    sf_header->async_exec = SF_BOOLEAN_FALSE;
+    sf_header->compress_body_threshold = 0;
+    sf_header->shared = NULL;
+    sf_header->trace = NULL;
+    sf_header->keep_raw_response = SF_BOOLEAN_FALSE;
+    sf_header->raw_response = NULL;
+    sf_header->skip_rowset = SF_BOOLEAN_FALSE;
+    sf_header->abort_flag = NULL;
+    sf_header->token_generation = 0;
     return sf_header;
 }
 
+static void header_list_release(SF_HEADER_LIST *shared) {
+    if (shared && sf_atomic_fetch_sub(&shared->refs, 1) == 1) {
+        curl_slist_free_all(shared->list);
+        SF_FREE(shared);
+    }
+}
+
+/**
+ * Drops the shared header lists. The caller holds sf->mutex_token.
+ */
+static void header_cache_clear(SF_CONNECT *sf) {
+    size_t i;
+
+    sf->header_generation++;
+    for (i = 0; i < sizeof(sf->header_cache) / sizeof(sf->header_cache[0]); i++) {
+        header_list_release(sf->header_cache[i]);
+        sf->header_cache[i] = NULL;
+    }
+}
+
+void STDCALL sf_header_cache_invalidate(SF_CONNECT *sf) {
+    _mutex_lock(&sf->mutex_token);
+    header_cache_clear(sf);
+    _mutex_unlock(&sf->mutex_token);
+}
+
 void STDCALL sf_header_destroy(SF_HEADER *sf_header) {
     if (!sf_header) {
         return;
@@ -1096,6 +1559,11 @@ void STDCALL sf_header_destroy(SF_HEADER *sf_header) {
     SF_FREE(sf_header->header_token);
     SF_FREE(sf_header->header_service_name);
     SF_FREE(sf_header->header_direct_query_token);
-    curl_slist_free_all(sf_header->header);
+    SF_FREE(sf_header->raw_response);
+    if (sf_header->shared) {
+        header_list_release(sf_header->shared);
+    } else {
+        curl_slist_free_all(sf_header->header);
+    }
     SF_FREE(sf_header);
 }
@@ -6,7 +6,7 @@
 #define SNOWFLAKE_CONNECTION_H
 
 /*
-  Apache arrow is not implemented for WIN32
+  Apache arrow is only built for WIN32 when WIN32_ARROW is set
   The symbol _WIN32 is defined by the compiler to indicate that this is a (32bit) Windows compilation. 
   Unfortunately, for historical reasons, it is also defined for 64-bit compilation.
   The symbol _WIN64 is defined by the compiler to indicate that this is a 64-bit Windows compilation.
@@ -21,6 +21,11 @@
 #endif
 #endif
 
+// Arrow builds for 32-bit Windows are opt-in, see WIN32_ARROW in CMakeLists.txt
+#if defined(SF_WIN32) && !defined(SF_WIN32_ARROW) && !defined(SF_NO_ARROW)
+#define SF_NO_ARROW
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +42,8 @@ extern "C" {
 #include "snowflake/platform.h"
 #include "cJSON.h"
 #include "arraylist.h"
+#include "json_writer.h"
+#include "memory.h"
 
 /**
  * Request type
@@ -78,6 +85,9 @@ typedef enum SF_JSON_ERROR {
     SF_JSON_ERROR_OOM
 } SF_JSON_ERROR;
 
+// Smallest allocation of a RAW_JSON_BUFFER, curl writes up to 16K at a time
+#define RAW_JSON_BUFFER_INITIAL_SIZE (16 * 1024)
+
 /**
  * Dynamically growing char buffer to hold retrieved in cURL call.
  */
@@ -86,6 +96,10 @@ typedef struct RAW_JSON_BUFFER {
     char *buffer;
     // Number of characters in char buffer
     size_t size;
+    // Allocated size of the char buffer, 0 whenever buffer is NULL
+    size_t capacity;
+    // Tag the char buffer is allocated with
+    SF_MEMORY_TAG tag;
 } RAW_JSON_BUFFER;
 
 /**
@@ -110,9 +124,9 @@ typedef struct URL_KEY_VALUE {
  * Used to keep track of min and max backoff time for a connection retry
  */
 typedef struct DECORRELATE_JITTER_BACKOFF {
-    // Minimum backoff time
+    // Minimum backoff time in milliseconds
     uint32 base;
-    // Maximum backoff time
+    // Maximum backoff time in milliseconds
     uint32 cap;
 } DECORRELATE_JITTER_BACKOFF;
 
@@ -124,12 +138,52 @@ typedef struct RETRY_CONTEXT {
     uint64 retry_count;
     // Retry timeout in number of seconds.
     uint64 retry_timeout;
-    // Time to sleep in seconds
+    // Time to sleep in milliseconds
     uint32 sleep_time;
     // Decorrelate Jitter is used to determine sleep time
     DECORRELATE_JITTER_BACKOFF *djb;
 } RETRY_CONTEXT;
 
+/**
+ * Kinds of requests that are retried with their own backoff
+ */
+typedef enum SF_RETRY_CLASS {
+    // Login, query and other requests posted to Snowflake
+    SF_RETRY_CLASS_REQUEST,
+    // Requests for the status or the result of a query
+    SF_RETRY_CLASS_POLL,
+    // Result chunk downloads
+    SF_RETRY_CLASS_CHUNK
+} SF_RETRY_CLASS;
+
+// Token renewal time of a session whose token validity is not known
+#define SF_TOKEN_RENEW_NEVER ((unsigned long long) -1)
+// Milliseconds before a failed background token renewal is tried again
+#define SF_TOKEN_RENEWAL_RETRY_INTERVAL 60000
+
+// Retry tokens a retry takes from the budget of a connection. A successful request gives one back.
+#define SF_RETRY_TOKEN_COST 10
+
+/**
+ * How a request is retried
+ */
+typedef struct SF_RETRY_POLICY {
+    DECORRELATE_JITTER_BACKOFF backoff;
+    // Retry tokens of the connection, NULL if retries are not limited
+    volatile unsigned long long *budget_tokens;
+    // Tokens of a full budget
+    uint64 budget_max;
+} SF_RETRY_POLICY;
+
+/**
+ * Header list shared by the requests of a connection while its tokens stay the same.
+ */
+struct SF_HEADER_LIST {
+    struct curl_slist *list;
+    // Headers using the list, plus one while it is cached in the connection
+    volatile unsigned long long refs;
+};
+
 typedef struct SF_HEADER {
     struct curl_slist *header;
     char *header_direct_query_token;
@@ -138,6 +192,24 @@ typedef struct SF_HEADER {
 
     sf_bool use_application_json_accept_type;
     sf_bool renew_session;
+    // Set for asyncExec query requests, the in-progress response is returned instead of polled
+    sf_bool async_exec;
+    // Bodies of at least this many bytes are sent gzip compressed, 0 to never compress
+    size_t compress_body_threshold;
+    // Set if header is the list shared with other requests rather than one of its own
+    SF_HEADER_LIST *shared;
+    // Parent of the spans of a query request and its polling, NULL for no spans
+    const SF_TRACE_CONTEXT *trace;
+    // Set to keep the text of the last JSON response in raw_response, which the header owns
+    sf_bool keep_raw_response;
+    char *raw_response;
+    // Set to leave the rows of a query response out of the parsed JSON, see
+    // sf_json_parse_without_rowset()
+    sf_bool skip_rowset;
+    // The transfers of the request are aborted once this is non-zero, NULL to never abort
+    volatile uint64 *abort_flag;
+    // sf->token_generation of the token in the header
+    uint64 token_generation;
 } SF_HEADER;
 
 /**
@@ -153,6 +225,19 @@ struct data {
 typedef struct non_json_response {
     size_t (*write_callback)(char *ptr, size_t size, size_t nmemb, void *userdata);
     void * buffer;
+    // Optional. Called with the buffer before every attempt, so that a response that is
+    // consumed while it arrives can tell a retried download from new data.
+    void (*reset_callback)(void *userdata);
+    // Optional. Set for responses that are consumed while they arrive; called with the
+    // buffer once the download has succeeded or failed for good.
+    void (*finish_callback)(void *userdata, sf_bool success);
+    // Optional. Called with the buffer on the downloader thread once the whole body of a
+    // response that isn't streamed has arrived, so that it is decoded before the consumer
+    // takes it. Returns SF_BOOLEAN_FALSE if the body can't be decoded.
+    sf_bool (*decode_callback)(void *userdata);
+    // Optional. Frees the response, buffer included, when the downloader gives up on it
+    // before the consumer takes it.
+    void (*free_callback)(struct non_json_response *resp);
 } NON_JSON_RESP;
 
 /**
@@ -183,15 +268,28 @@ cJSON *STDCALL create_auth_json_body(SF_CONNECT *sf, const char *application, co
                                      const char *int_app_version, const char* timezone, sf_bool autocommit);
 
 /**
- * Creates a cJSON blob used to execute queries. cJSON blob must be freed by the caller using cJSON_Delete.
+ * Writes the members of the body used to execute queries. The caller begins the object and
+ * ends it after adding the bindings, if any.
  *
+ * @param writer The writer of the body.
  * @param sql_text The sql query to send to Snowflake
  * @param sequence_id Sequence ID from the Snowflake Connection object.
  * @param request_id  requestId to be passed as a part of body instead of header.
  * @param is_describe_only is the query describe only.
- * @return Query cJSON Body.
- */
-cJSON *STDCALL create_query_json_body(const char *sql_text, int64 sequence_id, const char *request_id, sf_bool is_describe_only);
+ * @param is_async_exec should the server return without waiting for the query to finish.
+ * @param multi_stmt_count number of statements in sql_text, 0 for any. 1 is the default and
+ *        isn't sent.
+ * @param result_format C_API_QUERY_RESULT_FORMAT of the query, NULL for that of the session.
+ * @param result_chunk_size CLIENT_RESULT_CHUNK_SIZE of the query in MB, 0 for that of the
+ *        session.
+ * @param parameters other session parameters of the query, an object of strings, booleans and
+ *        integers, or NULL.
+ */
+void STDCALL write_query_json_body(SF_JSON_WRITER *writer, const char *sql_text, int64 sequence_id,
+                                   const char *request_id, sf_bool is_describe_only,
+                                   sf_bool is_async_exec, int64 multi_stmt_count,
+                                   const char *result_format, int64 result_chunk_size,
+                                   const cJSON *parameters);
 
 /**
  * Creates a cJSON blob that is used to renew a session with Snowflake. cJSON blob must be freed by the caller using
@@ -239,15 +337,16 @@ sf_bool STDCALL curl_get_call(SF_CONNECT *sf, CURL *curl, char *url, SF_HEADER *
  * Used to determine the sleep time during the next backoff caused by request failure.
  *
  * @param djb Decorrelate Jitter Backoff object used to determine min and max backoff time.
- * @param sleep Duration of last sleep in seconds.
- * @return Number of seconds to sleep.
+ * @param sleep Duration of last sleep in milliseconds.
+ * @return Number of milliseconds to sleep.
  */
 uint32 decorrelate_jitter_next_sleep(DECORRELATE_JITTER_BACKOFF *djb, uint32 sleep);
 
 /**
  * Creates a URL that is safe to use with cURL. Caller must free the memory associated with the encoded URL.
  *
- * @param curl cURL object for the request.
+ * @param curl cURL object for the request. Not used, the values are escaped the way
+ *             curl_easy_escape() does without allocating each of them.
  * @param protocol Protocol to use in the request. Either HTTP or HTTPS.
  * @param account Snowflake account name. This should be the account of the user.
  * @param host Host to connect to. Used when connecting to different Snowflake deployments
@@ -272,6 +371,18 @@ char * STDCALL encode_url(CURL *curl, const char *protocol, const char *account,
  */
 sf_bool is_string_empty(const char * str);
 
+/**
+ * Compares two names, either of which may be NULL. A NULL name only matches another NULL one.
+ */
+sf_bool STDCALL sf_same_name(const char *name, const char *other);
+
+/**
+ * Copies a name, which may be NULL.
+ *
+ * @return the copy, NULL if the name is NULL or out of memory.
+ */
+char *STDCALL sf_copy_name(const char *name);
+
 /**
  * A convenience function that copies an item value, specified by the item field, to the dest field if the item
  * exists, isn't null and is the right type.
@@ -373,6 +484,50 @@ ARRAY_LIST *json_get_object_keys(const cJSON *item);
  */
 size_t json_resp_cb(char *data, size_t size, size_t nmemb, RAW_JSON_BUFFER *raw_json);
 
+/**
+ * Makes room for len more characters and the null terminator. The buffer at least doubles
+ * when it grows, so that a response written in many pieces is copied a few times only.
+ *
+ * @param raw_json The buffer.
+ * @param len The number of characters to make room for, e.g. the expected size of a response.
+ * @return SF_BOOLEAN_TRUE if successful, SF_BOOLEAN_FALSE if out of memory.
+ */
+sf_bool STDCALL raw_json_buffer_reserve(RAW_JSON_BUFFER *raw_json, size_t len);
+
+/**
+ * Appends characters to the buffer and null terminates it.
+ *
+ * @return SF_BOOLEAN_TRUE if successful, SF_BOOLEAN_FALSE if out of memory.
+ */
+sf_bool STDCALL raw_json_buffer_append(RAW_JSON_BUFFER *raw_json, const char *data, size_t len);
+
+/**
+ * Frees the characters of the buffer.
+ */
+void STDCALL raw_json_buffer_free(RAW_JSON_BUFFER *raw_json);
+
+/**
+ * Compresses data in the gzip format, as sent with a Content-Encoding: gzip header.
+ *
+ * @param data The data to compress.
+ * @param len The length of the data.
+ * @param compressed Set to the compressed data, which the caller frees with SF_FREE.
+ * @param compressed_len Set to the length of the compressed data.
+ * @return SF_BOOLEAN_TRUE if successful, SF_BOOLEAN_FALSE if the data can't be compressed.
+ */
+sf_bool STDCALL gzip_compress(const char *data, size_t len, char **compressed,
+                              size_t *compressed_len);
+
+/**
+ * Sets the TLS related options (peer verification, CA bundle, SSL version and OCSP check)
+ * on a curl handle, the same way http_perform does for every request.
+ *
+ * @param curl cURL instance
+ * @param insecure_mode Insecure mode disable OCSP check when set to true
+ * @return Success/failure status. 1 = Success; 0 = Failure
+ */
+sf_bool STDCALL set_curl_tls_options(CURL *curl, sf_bool insecure_mode);
+
 /**
  * Performs an HTTP request with retry.
  *
@@ -392,12 +547,14 @@ size_t json_resp_cb(char *data, size_t size, size_t nmemb, RAW_JSON_BUFFER *raw_
  * @param error Reference to the Snowflake Error object to set an error if one occurs.
  * @param insecure_mode Insecure mode disable OCSP check when set to true
  * @param retry_on_curle_couldnt_connect_count number of times retrying server connection on CURLE_COULDNT_CONNECT error
+ * @param retry_policy Backoff and budget of the retries, NULL for the default backoff without budget.
  * @return Success/failure status of http request call. 1 = Success; 0 = Failure
  */
 sf_bool STDCALL http_perform(CURL *curl, SF_REQUEST_TYPE request_type, char *url, SF_HEADER *header,
                              char *body, cJSON **json, NON_JSON_RESP* non_json_resp, int64 network_timeout, sf_bool chunk_downloader,
                              SF_ERROR_STRUCT *error, sf_bool insecure_mode,
-                             int8 retry_on_curle_couldnt_connect_count);
+                             int8 retry_on_curle_couldnt_connect_count,
+                             const SF_RETRY_POLICY *retry_policy);
 
 /**
  * Returns true if HTTP code is retryable, false otherwise.
@@ -407,6 +564,14 @@ sf_bool STDCALL http_perform(CURL *curl, SF_REQUEST_TYPE request_type, char *url
  */
 sf_bool STDCALL is_retryable_http_code(long int code);
 
+/**
+ * Returns true if the HTTP code is the one a presigned URL past its expiry is refused with,
+ * 403 from S3 and Azure, 400 from GCS. Retrying the same URL doesn't help then.
+ *
+ * @param code The HTTP code to test.
+ */
+sf_bool STDCALL is_expired_url_http_code(long int code);
+
 /**
  * Renews a session once the session token has expired.
  *
@@ -417,6 +582,19 @@ sf_bool STDCALL is_retryable_http_code(long int code);
  */
 sf_bool STDCALL renew_session(CURL * curl, SF_CONNECT *sf, SF_ERROR_STRUCT *error);
 
+/**
+ * Renews a session once the server answered a request that its session token has expired,
+ * unless another request of the connection has renewed it since the header was created.
+ *
+ * @param curl cURL object to use for the renew session request to Snowflake
+ * @param sf The Snowflake Connection object to use for connection details.
+ * @param header The header of the request with the expired token.
+ * @param error Reference to the Snowflake Error object to set an error if one occurs.
+ * @return Success/failure status of session renewal. 1 = Success; 0 = Failure
+ */
+sf_bool STDCALL renew_expired_session(CURL *curl, SF_CONNECT *sf, const SF_HEADER *header,
+                                      SF_ERROR_STRUCT *error);
+
 /**
  * Runs a request to Snowflake. Encodes the URL and creates the cURL object that is used for the request.
  *
@@ -463,10 +641,35 @@ RETRY_CONTEXT *STDCALL retry_ctx_init(uint64 timeout);
  *
  * As a side effect will set context's retry_count with the new value and increment retry_count
  * @param retry_ctx Retry Context object. Used to determine next sleep.
- * @return Returns number of seconds to sleep.
+ * @return Returns number of milliseconds to sleep.
  */
 uint32 STDCALL retry_ctx_next_sleep(RETRY_CONTEXT *retry_ctx);
 
+/**
+ * Sets up the retry policy of a kind of request from the attributes of a connection.
+ *
+ * @param policy the policy to set up.
+ * @param sf the connection, whose retry budget the policy refers to.
+ * @param retry_class the kind of request.
+ */
+void STDCALL retry_policy_init(SF_RETRY_POLICY *policy, SF_CONNECT *sf,
+                               SF_RETRY_CLASS retry_class);
+
+/**
+ * Takes a retry from the budget of the connection.
+ *
+ * @param policy the retry policy of the request, may be NULL.
+ * @return SF_BOOLEAN_TRUE if the request may be retried.
+ */
+sf_bool STDCALL retry_policy_take(const SF_RETRY_POLICY *policy);
+
+/**
+ * Gives part of a retry back to the budget of the connection after a successful request.
+ *
+ * @param policy the retry policy of the request, may be NULL.
+ */
+void STDCALL retry_policy_refund(const SF_RETRY_POLICY *policy);
+
 /**
  * Convenience function to set tokens in Snowflake Connect object from cJSON blob. Returns success/failure.
  *
@@ -484,6 +687,15 @@ SF_HEADER* STDCALL sf_header_create();
 
 void STDCALL sf_header_destroy(SF_HEADER *sf_header);
 
+/**
+ * Drops the header lists shared by the requests of a connection, so that the next requests
+ * build them again. The lists are dropped on their own when the tokens change, this is for
+ * the other values they carry.
+ *
+ * @param sf The Snowflake Connection object.
+ */
+void STDCALL sf_header_cache_invalidate(SF_CONNECT *sf);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "csv_export.h"
+#include "memory.h"
+#include "error.h"
+#include <snowflake/logger.h>
+
+static void STDCALL free_text(RAW_JSON_BUFFER *text) {
+    if (!text) {
+        return;
+    }
+    raw_json_buffer_free(text);
+    SF_FREE(text);
+}
+
+sf_bool STDCALL sf_csv_buffer_append_field(RAW_JSON_BUFFER *text, const char *value,
+                                           size_t value_len) {
+    size_t quotes = 0;
+    sf_bool quoted;
+    size_t i;
+    char *out;
+
+    if (!value) {
+        return SF_BOOLEAN_TRUE;
+    }
+    quoted = value_len == 0 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    for (i = 0; i < value_len; i++) {
+        switch (value[i]) {
+            case '"':
+                quotes++;
+                quoted = SF_BOOLEAN_TRUE;
+                break;
+            case ',':
+            case '\n':
+            case '\r':
+                quoted = SF_BOOLEAN_TRUE;
+                break;
+            default:
+                break;
+        }
+    }
+    if (!quoted) {
+        return raw_json_buffer_append(text, value, value_len);
+    }
+
+    if (!raw_json_buffer_reserve(text, value_len + quotes + 2)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    out = text->buffer + text->size;
+    *out++ = '"';
+    if (quotes == 0) {
+        memcpy(out, value, value_len);
+        out += value_len;
+    } else {
+        for (i = 0; i < value_len; i++) {
+            if (value[i] == '"') {
+                *out++ = '"';
+            }
+            *out++ = value[i];
+        }
+    }
+    *out++ = '"';
+    *out = '\0';
+    text->size = (size_t) (out - text->buffer);
+    return SF_BOOLEAN_TRUE;
+}
+
+sf_bool STDCALL sf_csv_buffer_append_line(RAW_JSON_BUFFER *text, const char **values,
+                                          const size_t *lengths, size_t count) {
+    size_t i;
+    for (i = 0; i < count; i++) {
+        size_t value_len = 0;
+        if (values[i]) {
+            value_len = lengths ? lengths[i] : strlen(values[i]);
+        }
+        if ((i > 0 && !raw_json_buffer_append(text, ",", 1)) ||
+            !sf_csv_buffer_append_field(text, values[i], value_len)) {
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+    return raw_json_buffer_append(text, "\n", 1);
+}
+
+/**
+ * Compresses the text to a gzip member, in place of the text.
+ *
+ * @return SF_BOOLEAN_FALSE if out of memory.
+ */
+static sf_bool STDCALL compress_text(RAW_JSON_BUFFER *text) {
+    char *compressed;
+    size_t compressed_len;
+
+    if (!gzip_compress(text->buffer, text->size, &compressed, &compressed_len)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    raw_json_buffer_free(text);
+    text->buffer = compressed;
+    text->size = compressed_len;
+    text->capacity = compressed_len;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Formats the header line, the names of the columns.
+ */
+static RAW_JSON_BUFFER *STDCALL format_header(SF_CSV_EXPORT *export) {
+    SF_STMT *sfstmt = export->sfstmt;
+    RAW_JSON_BUFFER *text;
+    int64 i;
+
+    if ((text = (RAW_JSON_BUFFER *) SF_CALLOC(1, sizeof(RAW_JSON_BUFFER))) == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < sfstmt->total_fieldcount; i++) {
+        const char *name = sfstmt->desc[i].name ? sfstmt->desc[i].name : "";
+        if ((i > 0 && !raw_json_buffer_append(text, ",", 1)) ||
+            !sf_csv_buffer_append_field(text, name, strlen(name))) {
+            goto error;
+        }
+    }
+    if (!raw_json_buffer_append(text, "\n", 1) || (export->gzip && !compress_text(text))) {
+        goto error;
+    }
+    return text;
+
+error:
+    free_text(text);
+    return NULL;
+}
+
+/**
+ * Formats every row of a chunk, then compresses the text if asked to.
+ *
+ * @return the text, NULL on failure with the error set.
+ */
+static void *STDCALL format_chunk(void *context, SF_RESULT_CHUNK *result_chunk,
+                                  SF_ERROR_STRUCT *error) {
+    SF_CSV_EXPORT *export = (SF_CSV_EXPORT *) context;
+    SF_STMT *sfstmt = export->sfstmt;
+    RAW_JSON_BUFFER *text;
+    char *scratch = NULL;
+    size_t scratch_len = 0;
+    size_t scratch_size = 0;
+    SF_STATUS status;
+    sf_bool is_null;
+    int idx;
+
+    if ((text = (RAW_JSON_BUFFER *) SF_CALLOC(1, sizeof(RAW_JSON_BUFFER))) == NULL) {
+        goto oom;
+    }
+    // Room for short values to start with, grown as needed
+    if (!raw_json_buffer_reserve(text, (size_t) (result_chunk->row_count + 1) *
+                                       (size_t) (sfstmt->total_fieldcount + 1) * 8)) {
+        goto oom;
+    }
+
+    while ((status = snowflake_chunk_next(result_chunk)) == SF_STATUS_SUCCESS) {
+        for (idx = 1; idx <= sfstmt->total_fieldcount; idx++) {
+            if (idx > 1 && !raw_json_buffer_append(text, ",", 1)) {
+                goto oom;
+            }
+            if ((status = snowflake_chunk_column_is_null(result_chunk, idx, &is_null)) !=
+                SF_STATUS_SUCCESS) {
+                goto failed;
+            }
+            if (is_null) {
+                continue;
+            }
+            scratch_len = 0;
+            if ((status = snowflake_chunk_column_as_str(result_chunk, idx, &scratch, &scratch_len,
+                                                        &scratch_size)) != SF_STATUS_SUCCESS) {
+                goto failed;
+            }
+            if (!sf_csv_buffer_append_field(text, scratch, scratch_len)) {
+                goto oom;
+            }
+        }
+        if (!raw_json_buffer_append(text, "\n", 1)) {
+            goto oom;
+        }
+    }
+    if (status != SF_STATUS_EOF) {
+        goto failed;
+    }
+    if (export->gzip && !compress_text(text)) {
+        goto oom;
+    }
+    SF_FREE(scratch);
+    return text;
+
+failed:
+    if (snowflake_chunk_error(result_chunk)->error_code) {
+        copy_snowflake_error(error, snowflake_chunk_error(result_chunk));
+    } else {
+        SET_SNOWFLAKE_STMT_ERROR(error, status, "Unable to format a row of the export.",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+    }
+    SF_FREE(scratch);
+    free_text(text);
+    return NULL;
+
+oom:
+    SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                             "Unable to allocate the text of a chunk to export.",
+                             SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+    SF_FREE(scratch);
+    free_text(text);
+    return NULL;
+}
+
+static void STDCALL free_chunk_text(void *context, void *item) {
+    free_text((RAW_JSON_BUFFER *) item);
+}
+
+/**
+ * Writes the text to the file, then releases it.
+ *
+ * @return SF_BOOLEAN_FALSE if the file can't be written.
+ */
+static sf_bool STDCALL write_text(FILE *file, RAW_JSON_BUFFER *text) {
+    sf_bool ok = fwrite(text->buffer, 1, text->size, file) == text->size ?
+                 SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    free_text(text);
+    return ok;
+}
+
+SF_STATUS STDCALL sf_csv_export(SF_STMT *sfstmt, const char *path, sf_bool gzip,
+                                unsigned int thread_count) {
+    SF_CSV_EXPORT *export;
+    RAW_JSON_BUFFER *text;
+    SF_ERROR_STRUCT error;
+    SF_STATUS ret = SF_STATUS_SUCCESS;
+    FILE *file;
+    void *item;
+
+    if ((export = (SF_CSV_EXPORT *) SF_CALLOC(1, sizeof(SF_CSV_EXPORT))) == NULL ||
+        sf_chunk_workers_init(&export->workers, sfstmt, thread_count, format_chunk,
+                              free_chunk_text, export) != SF_STATUS_SUCCESS) {
+        SF_FREE(export);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to allocate the export.",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_MEMORY;
+    }
+    export->sfstmt = sfstmt;
+    export->gzip = gzip;
+    memset(&error, 0, sizeof(error));
+
+    if ((file = fopen(path, "wb")) == NULL) {
+        log_error("Unable to open the export file %s, errno %d", path, errno);
+        sf_chunk_workers_term(&export->workers);
+        SF_FREE(export);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_GENERAL,
+                                 "Unable to open the export file.", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_GENERAL;
+    }
+
+    // Failures of the writer end the chunks like those of the workers, the first one is kept
+    if ((text = format_header(export)) == NULL) {
+        SET_SNOWFLAKE_STMT_ERROR(&error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to allocate the header of the export.",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        sf_chunk_workers_end(&export->workers, 0, &error);
+    } else if (!write_text(file, text)) {
+        SET_SNOWFLAKE_STMT_ERROR(&error, SF_STATUS_ERROR_GENERAL,
+                                 "Unable to write the export file.", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        sf_chunk_workers_end(&export->workers, 0, &error);
+    } else {
+        sf_chunk_workers_start(&export->workers);
+    }
+    log_debug("Exporting the results of query %s as CSV on %u threads", sfstmt->sfqid,
+              export->workers.thread_count);
+
+    // The chunks are written in the order they were handed out, as they become ready
+    while (sf_chunk_workers_take(&export->workers, &item) == SF_STATUS_SUCCESS) {
+        if (!write_text(file, (RAW_JSON_BUFFER *) item)) {
+            SET_SNOWFLAKE_STMT_ERROR(&error, SF_STATUS_ERROR_GENERAL,
+                                     "Unable to write the export file.", SF_SQLSTATE_GENERAL_ERROR,
+                                     sfstmt->sfqid);
+            sf_chunk_workers_end(&export->workers, 0, &error);
+            break;
+        }
+    }
+
+    if (fclose(file) != 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&error, SF_STATUS_ERROR_GENERAL,
+                                 "Unable to write the export file.", SF_SQLSTATE_GENERAL_ERROR,
+                                 sfstmt->sfqid);
+        sf_chunk_workers_end(&export->workers, 0, &error);
+    }
+    clear_snowflake_error(&error);
+
+    // Stopped before the error is read, a worker may still be setting it
+    sf_chunk_workers_stop(&export->workers);
+    if (export->workers.error.error_code) {
+        log_error("Export of the results of query %s failed: %s", sfstmt->sfqid,
+                  export->workers.error.msg ? export->workers.error.msg : "");
+        copy_snowflake_error(&sfstmt->error, &export->workers.error);
+        ret = export->workers.error.error_code;
+    }
+    sf_chunk_workers_term(&export->workers);
+    SF_FREE(export);
+    return ret;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_CSV_EXPORT_H
+#define SNOWFLAKE_CSV_EXPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+#include "chunk_workers.h"
+#include "connection.h"
+
+// Threads formatting, and compressing, the chunks of an export
+#define SF_CSV_EXPORT_THREADS 4
+
+/**
+ * Export of the result set of a statement to a CSV file. The chunk workers format the rows of
+ * the chunks and compress the text if asked to. The calling thread writes the text to the file
+ * as the chunks are taken, so the file has the rows in result order.
+ */
+typedef struct SF_CSV_EXPORT {
+    SF_STMT *sfstmt;
+    sf_bool gzip;
+    SF_CHUNK_WORKERS workers;
+} SF_CSV_EXPORT;
+
+/**
+ * Appends a field to a line of CSV text. Fields with a separator, a quote or a line break are
+ * quoted, doubling their quotes, and so is an empty string so that it reads back apart from
+ * NULL, which is an empty field.
+ *
+ * @param text the text, grown as needed.
+ * @param value the value, NULL for NULL.
+ * @param value_len the length of the value.
+ *
+ * @return SF_BOOLEAN_FALSE if out of memory.
+ */
+sf_bool STDCALL sf_csv_buffer_append_field(RAW_JSON_BUFFER *text, const char *value,
+                                           size_t value_len);
+
+/**
+ * Appends a line of CSV text, the fields formatted as sf_csv_buffer_append_field() does.
+ *
+ * @param text the text, grown as needed.
+ * @param values the values of the fields, NULL for NULL.
+ * @param lengths the lengths of the values, NULL if they are NUL-terminated.
+ * @param count the number of fields.
+ *
+ * @return SF_BOOLEAN_FALSE if out of memory.
+ */
+sf_bool STDCALL sf_csv_buffer_append_line(RAW_JSON_BUFFER *text, const char **values,
+                                          const size_t *lengths, size_t count);
+
+/**
+ * Writes the remaining rows of the results of a statement to a file as CSV, with a header line
+ * of the column names. Each chunk is compressed to a gzip member of its own when asked to, the
+ * members one after the other being a valid gzip file.
+ *
+ * @param sfstmt the executed statement.
+ * @param path the file to create or overwrite.
+ * @param gzip whether to compress the file.
+ * @param thread_count the number of worker threads, 0 taken as 1.
+ *
+ * @return 0 if success, otherwise an errno is returned and the error of the statement set.
+ */
+SF_STATUS STDCALL sf_csv_export(SF_STMT *sfstmt, const char *path, sf_bool gzip,
+                                unsigned int thread_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_CSV_EXPORT_H
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <snowflake/logger.h>
+#include "curl_pool.h"
+#include "connection.h"
+#include "memory.h"
+
+// Process wide share of the DNS cache, the TLS sessions and the connections of all the
+// handles the client sends requests with
+static CURLSH *curl_share = NULL;
+static SF_MUTEX_HANDLE curl_share_locks[CURL_LOCK_DATA_LAST];
+static int64 curl_share_dns_ttl = SF_DEFAULT_DNS_CACHE_TTL;
+static int64 curl_share_connection_max_age = SF_DEFAULT_CONNECTION_MAX_AGE;
+
+static void share_lock(CURL *curl, curl_lock_data data, curl_lock_access access,
+                       void *userptr) {
+    _mutex_lock(&curl_share_locks[data]);
+}
+
+static void share_unlock(CURL *curl, curl_lock_data data, void *userptr) {
+    _mutex_unlock(&curl_share_locks[data]);
+}
+
+void STDCALL sf_curl_share_init() {
+    int i;
+
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        _mutex_init(&curl_share_locks[i]);
+    }
+    curl_share_dns_ttl = SF_DEFAULT_DNS_CACHE_TTL;
+    curl_share_connection_max_age = SF_DEFAULT_CONNECTION_MAX_AGE;
+
+    // Without a share the handles still keep their own connections
+    curl_share = curl_share_init();
+    if (curl_share) {
+        curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    } else {
+        log_warn("Unable to create curl share, connections are only reused per handle");
+    }
+}
+
+void STDCALL sf_curl_share_term() {
+    int i;
+
+    if (curl_share) {
+        curl_share_cleanup(curl_share);
+        curl_share = NULL;
+    }
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        _mutex_term(&curl_share_locks[i]);
+    }
+}
+
+void STDCALL sf_curl_share_set_dns_ttl(int64 seconds) {
+    curl_share_dns_ttl = seconds;
+}
+
+int64 STDCALL sf_curl_share_get_dns_ttl() {
+    return curl_share_dns_ttl;
+}
+
+void STDCALL sf_curl_share_set_connection_max_age(int64 seconds) {
+    curl_share_connection_max_age = seconds;
+}
+
+int64 STDCALL sf_curl_share_get_connection_max_age() {
+    return curl_share_connection_max_age;
+}
+
+void STDCALL sf_curl_share_apply(CURL *curl) {
+    if (curl_share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
+    }
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, (long) curl_share_dns_ttl);
+    if (curl_share_connection_max_age > 0) {
+        curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, (long) curl_share_connection_max_age);
+    }
+}
+
+SF_CURL_POOL *STDCALL sf_curl_pool_create() {
+    SF_CURL_POOL *pool = (SF_CURL_POOL *) SF_CALLOC(1, sizeof(SF_CURL_POOL));
+    if (!pool) {
+        return NULL;
+    }
+    _mutex_init(&pool->mutex);
+    pool->refs = 1;
+    return pool;
+}
+
+SF_CURL_POOL *STDCALL sf_curl_pool_share(SF_CURL_POOL *pool) {
+    if (pool) {
+        _mutex_lock(&pool->mutex);
+        pool->refs++;
+        _mutex_unlock(&pool->mutex);
+    }
+    return pool;
+}
+
+void STDCALL sf_curl_pool_destroy(SF_CURL_POOL *pool) {
+    size_t i;
+    size_t refs;
+
+    if (!pool) {
+        return;
+    }
+    _mutex_lock(&pool->mutex);
+    refs = --pool->refs;
+    _mutex_unlock(&pool->mutex);
+    if (refs > 0) {
+        return;
+    }
+    for (i = 0; i < pool->idle_count; i++) {
+        curl_easy_cleanup(pool->idle[i]);
+    }
+    _mutex_term(&pool->mutex);
+    SF_FREE(pool);
+}
+
+CURL *STDCALL sf_curl_pool_acquire(SF_CURL_POOL *pool) {
+    CURL *curl = NULL;
+
+    if (!pool) {
+        return curl_easy_init();
+    }
+
+    _mutex_lock(&pool->mutex);
+    if (pool->idle_count > 0) {
+        curl = pool->idle[--pool->idle_count];
+    }
+    _mutex_unlock(&pool->mutex);
+    if (curl) {
+        return curl;
+    }
+
+    return curl_easy_init();
+}
+
+void STDCALL sf_curl_pool_release(SF_CURL_POOL *pool, CURL *curl) {
+    if (!curl) {
+        return;
+    }
+    if (!pool) {
+        curl_easy_cleanup(curl);
+        return;
+    }
+
+    curl_easy_reset(curl);
+    _mutex_lock(&pool->mutex);
+    if (pool->idle_count < SF_CURL_POOL_MAX_IDLE) {
+        pool->idle[pool->idle_count++] = curl;
+        curl = NULL;
+    }
+    _mutex_unlock(&pool->mutex);
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+}
+
+void STDCALL sf_curl_pool_warmup(SF_CURL_POOL *pool, const char *url, size_t connections,
+                                 sf_bool insecure_mode) {
+    CURL *handles[SF_CURL_POOL_MAX_IDLE];
+    CURLM *multi;
+    CURLMsg *msg;
+    size_t count;
+    size_t i;
+    int running = 0;
+    int msgs_left;
+
+    if (!pool || (multi = curl_multi_init()) == NULL) {
+        return;
+    }
+    if (connections > SF_CURL_POOL_MAX_IDLE) {
+        connections = SF_CURL_POOL_MAX_IDLE;
+    }
+    for (count = 0; count < connections; count++) {
+        if ((handles[count] = sf_curl_pool_acquire(pool)) == NULL) {
+            break;
+        }
+        curl_easy_setopt(handles[count], CURLOPT_URL, url);
+        curl_easy_setopt(handles[count], CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(handles[count], CURLOPT_TIMEOUT, (long) SF_CURL_POOL_WARMUP_TIMEOUT);
+        set_curl_tls_options(handles[count], insecure_mode);
+        curl_multi_add_handle(multi, handles[count]);
+    }
+
+    do {
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            break;
+        }
+        if (running) {
+            curl_multi_poll(multi, NULL, 0, 1000, NULL);
+        }
+    } while (running);
+    while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+        if (msg->msg == CURLMSG_DONE && msg->data.result != CURLE_OK) {
+            log_warn("Warm up request to %s failed: %s", url,
+                     curl_easy_strerror(msg->data.result));
+        }
+    }
+
+    // The connections stay in the cache shared by the handles of the pool
+    for (i = 0; i < count; i++) {
+        curl_multi_remove_handle(multi, handles[i]);
+        sf_curl_pool_release(pool, handles[i]);
+    }
+    curl_multi_cleanup(multi);
+    log_debug("Warmed up %lu connections to %s", (unsigned long) count, url);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_CURL_POOL_H
+#define SNOWFLAKE_CURL_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CURL_STATICLIB
+#include <curl/curl.h>
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// Maximum number of idle handles a connection keeps for its next requests
+#define SF_CURL_POOL_MAX_IDLE 8
+
+// Seconds a warm up request may take
+#define SF_CURL_POOL_WARMUP_TIMEOUT 10
+
+// Seconds the host names resolved are kept by default, as libcurl does
+#define SF_DEFAULT_DNS_CACHE_TTL 60
+
+// Seconds an idle connection is reused for by default, 0 for the default of libcurl
+#define SF_DEFAULT_CONNECTION_MAX_AGE 0
+
+/**
+ * Curl handles of a connection, kept between requests so that the next request reuses a warm
+ * connection instead of paying for a TCP connect, a TLS handshake and an OCSP check.
+ */
+struct SF_CURL_POOL {
+    SF_MUTEX_HANDLE mutex;
+    CURL *idle[SF_CURL_POOL_MAX_IDLE];
+    size_t idle_count;
+    // Connections using the pool, guarded by mutex
+    size_t refs;
+};
+
+/**
+ * The DNS cache, the TLS sessions and the connections are shared by all the handles of the
+ * process, those of the connections, the chunk downloaders and the warm ups alike, so that
+ * the host names are resolved and the handshakes are made once per host. Called from
+ * snowflake_global_init() and snowflake_global_term(), all the handles must be cleaned up
+ * before the term.
+ */
+void STDCALL sf_curl_share_init();
+
+void STDCALL sf_curl_share_term();
+
+/**
+ * Seconds the host names resolved are kept, -1 for ever and 0 not to keep them, see
+ * SF_GLOBAL_DNS_CACHE_TTL. Applies to the requests sent afterwards.
+ */
+void STDCALL sf_curl_share_set_dns_ttl(int64 seconds);
+
+int64 STDCALL sf_curl_share_get_dns_ttl();
+
+/**
+ * Seconds an idle connection is reused for, 0 for the default of libcurl, see
+ * SF_GLOBAL_CONNECTION_MAX_AGE.
+ */
+void STDCALL sf_curl_share_set_connection_max_age(int64 seconds);
+
+int64 STDCALL sf_curl_share_get_connection_max_age();
+
+/**
+ * Makes a handle use the share and its TTLs. Called with the TLS options of every request,
+ * as curl_easy_reset() leaves the share but not the TTLs.
+ */
+void STDCALL sf_curl_share_apply(CURL *curl);
+
+/**
+ * @return a new pool, or NULL if out of memory.
+ */
+SF_CURL_POOL *STDCALL sf_curl_pool_create();
+
+/**
+ * Lets one more connection use the pool, so that the sessions logged in together reuse each
+ * other's connections and TLS sessions.
+ *
+ * @return the pool, to be given up with sf_curl_pool_destroy().
+ */
+SF_CURL_POOL *STDCALL sf_curl_pool_share(SF_CURL_POOL *pool);
+
+/**
+ * Gives up a pool. The last connection using it cleans up the idle handles and the pool, all
+ * handles taken must have been given back by then.
+ */
+void STDCALL sf_curl_pool_destroy(SF_CURL_POOL *pool);
+
+/**
+ * Takes an idle handle, or creates one if there is none. A NULL pool always creates one.
+ *
+ * @return the handle, or NULL if curl failed to create one.
+ */
+CURL *STDCALL sf_curl_pool_acquire(SF_CURL_POOL *pool);
+
+/**
+ * Gives back a handle taken with sf_curl_pool_acquire(). Its options are reset, its
+ * connections are kept open for the next request.
+ */
+void STDCALL sf_curl_pool_release(SF_CURL_POOL *pool, CURL *curl);
+
+/**
+ * Opens connections to a host in parallel with HEAD requests and keeps them in the pool. The
+ * host name is resolved, and the TLS handshakes and OCSP checks are done, before the first
+ * real request needs them. Failures are only logged.
+ *
+ * @param pool the pool to warm up.
+ * @param url the URL to send the requests to.
+ * @param connections the number of connections to open, at most SF_CURL_POOL_MAX_IDLE.
+ * @param insecure_mode skip the OCSP check.
+ */
+void STDCALL sf_curl_pool_warmup(SF_CURL_POOL *pool, const char *url, size_t connections,
+                                 sf_bool insecure_mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_CURL_POOL_H
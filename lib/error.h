@@ -9,6 +9,7 @@
 extern "C" {
 #endif
 
+#include <errno.h>
 #include <snowflake/client.h>
 #include "snowflake/platform.h"
 
@@ -36,6 +37,16 @@ void STDCALL copy_snowflake_error(SF_ERROR_STRUCT *dst, SF_ERROR_STRUCT *src);
 #define ERR_MSG_SESSION_TOKEN_INVALID "The session token is invalid. Please reconnect"
 #define ERR_MSG_GONE_SESSION "The session no longer exists on the server. Please reconnect"
 
+// Sets the message of an error returned by _thread_init()
+#define PTHREAD_CREATE_ERROR_MSG(e, em) \
+switch(e) \
+{ \
+    case EAGAIN: (em) = "System lacked resources to create another thread"; break; \
+    case EPERM: (em) = "Caller doesn't have the privilege to set the required scheduling parameters"; break; \
+    case EINVAL: (em) = "The value specified by attr is invalid"; break; \
+    default: (em) = "Unknown non-zero pthread init error" ; break; \
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "fanout.h"
+#include "error.h"
+#include "memory.h"
+
+/**
+ * Runs a query on a session of the pool. The statement of the item is left NULL when the
+ * query couldn't get one.
+ */
+static void execute_query(SF_FANOUT *fanout, SF_FANOUT_ITEM *item) {
+    const SF_FANOUT_QUERY *query = &fanout->queries[item->index];
+
+    if ((item->sf = snowflake_session_pool_checkout(fanout->pool)) == NULL) {
+        SET_SNOWFLAKE_ERROR(&item->error, SF_STATUS_ERROR_CONNECTION_NOT_EXIST,
+                            "Unable to get a session of the pool for the query",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        item->status = SF_STATUS_ERROR_CONNECTION_NOT_EXIST;
+        return;
+    }
+    if ((item->sfstmt = snowflake_stmt(item->sf)) == NULL) {
+        SET_SNOWFLAKE_ERROR(&item->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while creating the statement of the query",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        item->status = SF_STATUS_ERROR_OUT_OF_MEMORY;
+        return;
+    }
+    if (fanout->options.chunk_downloader_threads) {
+        snowflake_stmt_set_attr(item->sfstmt, SF_STMT_CHUNK_DOWNLOADER_THREADS,
+                                &fanout->options.chunk_downloader_threads);
+    }
+    if (fanout->options.chunk_downloader_fetch_slots) {
+        snowflake_stmt_set_attr(item->sfstmt, SF_STMT_CHUNK_DOWNLOADER_FETCH_SLOTS,
+                                &fanout->options.chunk_downloader_fetch_slots);
+    }
+
+    item->status = snowflake_prepare(item->sfstmt, query->sql, 0);
+    if (item->status == SF_STATUS_SUCCESS && query->params && query->param_count > 0) {
+        item->status = snowflake_bind_param_array(item->sfstmt, query->params, query->param_count);
+    }
+    if (item->status == SF_STATUS_SUCCESS) {
+        item->status = snowflake_execute(item->sfstmt);
+    }
+    if (item->status != SF_STATUS_SUCCESS) {
+        log_error("Fan-out query %llu failed: %s", (unsigned long long) item->index,
+                  item->sfstmt->error.msg ? item->sfstmt->error.msg : "");
+    }
+}
+
+static void *fanout_worker(void *arg) {
+    SF_FANOUT *fanout = (SF_FANOUT *) arg;
+    SF_FANOUT_ITEM item;
+
+    _critical_section_lock(&fanout->lock);
+    while (!fanout->closed && fanout->next_query < fanout->query_count) {
+        memset(&item, 0, sizeof(item));
+        clear_snowflake_error(&item.error);
+        item.index = fanout->next_query++;
+        _critical_section_unlock(&fanout->lock);
+
+        execute_query(fanout, &item);
+
+        // Hand the results over and wait for the consumer to be done with them
+        _critical_section_lock(&fanout->lock);
+        if (fanout->ready_tail) {
+            fanout->ready_tail->next = &item;
+        } else {
+            fanout->ready_head = &item;
+        }
+        fanout->ready_tail = &item;
+        _cond_signal(&fanout->consumer_cond);
+        while (!item.done) {
+            _cond_wait(&fanout->worker_cond, &fanout->lock);
+        }
+        _critical_section_unlock(&fanout->lock);
+
+        if (item.sfstmt) {
+            snowflake_stmt_term(item.sfstmt);
+        }
+        if (item.sf) {
+            snowflake_session_pool_checkin(fanout->pool, item.sf);
+        }
+        clear_snowflake_error(&item.error);
+        _critical_section_lock(&fanout->lock);
+    }
+    fanout->workers_done++;
+    _cond_broadcast(&fanout->consumer_cond);
+    _critical_section_unlock(&fanout->lock);
+
+    _thread_exit();
+    return NULL;
+}
+
+/**
+ * Lets the worker of a query go on with the next one. Called with the lock taken.
+ */
+static void finish_item(SF_FANOUT *fanout, SF_FANOUT_ITEM *item) {
+    item->done = SF_BOOLEAN_TRUE;
+    _cond_broadcast(&fanout->worker_cond);
+}
+
+SF_FANOUT *STDCALL snowflake_fanout_execute(SF_SESSION_POOL *pool, const SF_FANOUT_QUERY *queries,
+                                            size_t count, const SF_FANOUT_OPTIONS *options) {
+    SF_FANOUT *fanout;
+    size_t i;
+
+    if (!pool || (!queries && count > 0)) {
+        return NULL;
+    }
+    if ((fanout = (SF_FANOUT *) SF_CALLOC(1, sizeof(SF_FANOUT))) == NULL) {
+        return NULL;
+    }
+    fanout->pool = pool;
+    fanout->queries = queries;
+    fanout->query_count = count;
+    if (options) {
+        fanout->options = *options;
+    }
+    if (fanout->options.max_concurrency == 0) {
+        fanout->options.max_concurrency = SF_FANOUT_DEFAULT_CONCURRENCY;
+    }
+    clear_snowflake_error(&fanout->error);
+    _critical_section_init(&fanout->lock);
+    _cond_init(&fanout->consumer_cond);
+    _cond_init(&fanout->worker_cond);
+
+    fanout->thread_count = fanout->options.max_concurrency < count ?
+                           (size_t) fanout->options.max_concurrency : count;
+    if (fanout->thread_count > 0 &&
+        (fanout->threads = (SF_THREAD_HANDLE *) SF_CALLOC(fanout->thread_count,
+                                                          sizeof(SF_THREAD_HANDLE))) == NULL) {
+        fanout->thread_count = 0;
+        snowflake_fanout_close(fanout);
+        return NULL;
+    }
+    for (i = 0; i < fanout->thread_count; i++) {
+        if (_thread_init(&fanout->threads[i], fanout_worker, (void *) fanout) != 0) {
+            log_error("Unable to start fan-out worker %llu", (unsigned long long) i);
+            // The workers started run all the queries
+            fanout->thread_count = i;
+            break;
+        }
+    }
+    if (fanout->thread_count == 0 && count > 0) {
+        snowflake_fanout_close(fanout);
+        return NULL;
+    }
+    log_debug("Fan-out of %llu queries over %llu workers", (unsigned long long) count,
+              (unsigned long long) fanout->thread_count);
+    return fanout;
+}
+
+SF_STATUS STDCALL snowflake_fanout_fetch(SF_FANOUT *fanout) {
+    SF_FANOUT_ITEM *item;
+    SF_STATUS ret;
+
+    if (!fanout) {
+        return SF_STATUS_ERROR_NULL_POINTER;
+    }
+    while (1) {
+        if (fanout->current) {
+            ret = snowflake_fetch(fanout->current->sfstmt);
+            if (ret == SF_STATUS_SUCCESS) {
+                return ret;
+            }
+            if (ret != SF_STATUS_EOF) {
+                copy_snowflake_error(&fanout->error, &fanout->current->sfstmt->error);
+            }
+            _critical_section_lock(&fanout->lock);
+            finish_item(fanout, fanout->current);
+            fanout->current = NULL;
+            _critical_section_unlock(&fanout->lock);
+            if (ret != SF_STATUS_EOF) {
+                return ret;
+            }
+        }
+
+        _critical_section_lock(&fanout->lock);
+        while (!fanout->ready_head && fanout->workers_done < fanout->thread_count) {
+            _cond_wait(&fanout->consumer_cond, &fanout->lock);
+        }
+        if ((item = fanout->ready_head) == NULL) {
+            _critical_section_unlock(&fanout->lock);
+            return SF_STATUS_EOF;
+        }
+        fanout->ready_head = item->next;
+        if (!fanout->ready_head) {
+            fanout->ready_tail = NULL;
+        }
+        fanout->current_index = item->index;
+        if (item->status != SF_STATUS_SUCCESS) {
+            copy_snowflake_error(&fanout->error,
+                                 item->sfstmt ? &item->sfstmt->error : &item->error);
+            ret = item->status;
+            finish_item(fanout, item);
+            _critical_section_unlock(&fanout->lock);
+            return ret;
+        }
+        fanout->current = item;
+        _critical_section_unlock(&fanout->lock);
+    }
+}
+
+SF_STMT *STDCALL snowflake_fanout_stmt(SF_FANOUT *fanout) {
+    return fanout && fanout->current ? fanout->current->sfstmt : NULL;
+}
+
+size_t STDCALL snowflake_fanout_query_index(SF_FANOUT *fanout) {
+    return fanout ? fanout->current_index : 0;
+}
+
+SF_ERROR_STRUCT *STDCALL snowflake_fanout_error(SF_FANOUT *fanout) {
+    return fanout ? &fanout->error : NULL;
+}
+
+void STDCALL snowflake_fanout_close(SF_FANOUT *fanout) {
+    SF_FANOUT_ITEM *item;
+    size_t i;
+
+    if (!fanout) {
+        return;
+    }
+    // Let the workers go, they exit once their query is done
+    _critical_section_lock(&fanout->lock);
+    fanout->closed = SF_BOOLEAN_TRUE;
+    if (fanout->current) {
+        finish_item(fanout, fanout->current);
+        fanout->current = NULL;
+    }
+    while (fanout->workers_done < fanout->thread_count) {
+        for (item = fanout->ready_head; item; item = item->next) {
+            finish_item(fanout, item);
+        }
+        fanout->ready_head = NULL;
+        fanout->ready_tail = NULL;
+        _cond_wait(&fanout->consumer_cond, &fanout->lock);
+    }
+    _critical_section_unlock(&fanout->lock);
+
+    for (i = 0; i < fanout->thread_count; i++) {
+        _thread_join(fanout->threads[i]);
+    }
+    clear_snowflake_error(&fanout->error);
+    _cond_term(&fanout->worker_cond);
+    _cond_term(&fanout->consumer_cond);
+    _critical_section_term(&fanout->lock);
+    SF_FREE(fanout->threads);
+    SF_FREE(fanout);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_FANOUT_H
+#define SNOWFLAKE_FANOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * A query of a fan-out executed by a worker, on the stack of the worker. It is queued for the
+ * consumer once executed, and the worker waits for the consumer to be done with its results
+ * before it runs the next query, so that the results of at most one query per worker are
+ * held at a time.
+ */
+typedef struct SF_FANOUT_ITEM {
+    size_t index;
+    SF_CONNECT *sf;
+    SF_STMT *sfstmt;
+    SF_STATUS status;
+    // Error of a query that got no statement, the others are in the statement
+    SF_ERROR_STRUCT error;
+    // Set by the consumer once it is done with the results
+    sf_bool done;
+    struct SF_FANOUT_ITEM *next;
+} SF_FANOUT_ITEM;
+
+struct SF_FANOUT {
+    SF_SESSION_POOL *pool;
+    const SF_FANOUT_QUERY *queries;
+    size_t query_count;
+    SF_FANOUT_OPTIONS options;
+
+    SF_THREAD_HANDLE *threads;
+    size_t thread_count;
+
+    SF_CRITICAL_SECTION_HANDLE lock;
+    // Signaled when a query is queued for the consumer or a worker exits
+    SF_CONDITION_HANDLE consumer_cond;
+    // Signaled when the consumer is done with a query, or the fan-out is closed
+    SF_CONDITION_HANDLE worker_cond;
+    // Next query for a worker to take
+    size_t next_query;
+    // Executed queries the consumer hasn't taken yet, in the order they were executed
+    SF_FANOUT_ITEM *ready_head;
+    SF_FANOUT_ITEM *ready_tail;
+    size_t workers_done;
+    sf_bool closed;
+
+    // Query whose rows the consumer fetches, only touched by the consumer
+    SF_FANOUT_ITEM *current;
+    size_t current_index;
+    SF_ERROR_STRUCT error;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_FANOUT_H
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "hashmap.h"
+#include "memory.h"
+
+HASH_MAP * STDCALL sf_hashmap_init(size_t expected)
+{
+    size_t capacity = HASH_MAP_MIN_CAPACITY;
+    HASH_MAP *hash_map = (HASH_MAP *) SF_CALLOC(1, sizeof(HASH_MAP));
+    if (!hash_map)
+    {
+        log_error("sf_hashmap_init: Memory Allocation failed\n");
+        return NULL;
+    }
+    while (capacity / 4 * 3 < expected)
+    {
+        capacity *= 2;
+    }
+    hash_map->entries = (HASH_MAP_ENTRY *) SF_CALLOC(capacity, sizeof(HASH_MAP_ENTRY));
+    if (!hash_map->entries)
+    {
+        log_error("sf_hashmap_init: Memory Allocation failed\n");
+        SF_FREE(hash_map);
+        return NULL;
+    }
+    hash_map->capacity = capacity;
+    return hash_map;
+}
+
+uint64 STDCALL sf_fnv1a(uint64 hash, const void *data, size_t len)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64 STDCALL sf_hashmap_hash(const char *key)
+{
+    return sf_fnv1a(SF_FNV_OFFSET_BASIS, key, strlen(key));
+}
+
+/*
+** Finds the slot of a key, or the empty slot it would go to.
+** The map always has an empty slot, so the probing ends.
+*/
+static HASH_MAP_ENTRY *sf_hashmap_find(HASH_MAP *hash_map, const char *key, uint64 hash)
+{
+    size_t mask = hash_map->capacity - 1;
+    size_t index = (size_t) hash & mask;
+    HASH_MAP_ENTRY *entry;
+
+    while (1)
+    {
+        entry = &hash_map->entries[index];
+        if (!entry->key || (entry->hash == hash && strcmp(entry->key, key) == 0))
+        {
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+static sf_bool sf_hashmap_resize(HASH_MAP *hash_map, size_t capacity)
+{
+    size_t i;
+    HASH_MAP old = *hash_map;
+    HASH_MAP_ENTRY *entries = (HASH_MAP_ENTRY *) SF_CALLOC(capacity, sizeof(HASH_MAP_ENTRY));
+    if (!entries)
+    {
+        return SF_BOOLEAN_FALSE;
+    }
+    hash_map->entries = entries;
+    hash_map->capacity = capacity;
+    for (i = 0; i < old.capacity; i++)
+    {
+        if (old.entries[i].key)
+        {
+            *sf_hashmap_find(hash_map, old.entries[i].key, old.entries[i].hash) = old.entries[i];
+        }
+    }
+    SF_FREE(old.entries);
+    return SF_BOOLEAN_TRUE;
+}
+
+sf_bool STDCALL sf_hashmap_reserve(HASH_MAP *hash_map, size_t count)
+{
+    size_t capacity;
+    if (!hash_map)
+    {
+        return SF_BOOLEAN_FALSE;
+    }
+    capacity = hash_map->capacity;
+    while (capacity / 4 * 3 < count)
+    {
+        capacity *= 2;
+    }
+    return capacity == hash_map->capacity || sf_hashmap_resize(hash_map, capacity);
+}
+
+SF_INT_RET_CODE STDCALL sf_hashmap_set(HASH_MAP *hash_map, void *param, char *key)
+{
+    if (!key)
+    {
+        log_error("sf_hashmap_set: key passed is NULL\n");
+        return SF_INT_RET_CODE_ERROR;
+    }
+    return sf_hashmap_set_hashed(hash_map, param, key, sf_hashmap_hash(key));
+}
+
+SF_INT_RET_CODE STDCALL sf_hashmap_set_hashed(HASH_MAP *hash_map, void *param, char *key,
+                                              uint64 hash)
+{
+    HASH_MAP_ENTRY *entry;
+
+    if (!hash_map || !param || !key)
+    {
+        log_error("sf_hashmap_set: Hash Map || Param || key passed is NULL\n");
+        return SF_INT_RET_CODE_ERROR;
+    }
+
+    entry = sf_hashmap_find(hash_map, key, hash);
+    if (entry->key)
+    {
+        log_debug("sf_hashmap_set: Duplicate param found, Overwrite\n");
+        entry->key = key;
+        entry->param = param;
+        return SF_INT_RET_CODE_DUPLICATES;
+    }
+    if ((hash_map->count + 1) > hash_map->capacity / 4 * 3)
+    {
+        if (!sf_hashmap_resize(hash_map, hash_map->capacity * 2))
+        {
+            log_error("sf_hashmap_set: Not able to grow the hash map\n");
+            return SF_INT_RET_CODE_ERROR;
+        }
+        entry = sf_hashmap_find(hash_map, key, hash);
+    }
+    entry->key = key;
+    entry->hash = hash;
+    entry->param = param;
+    hash_map->count++;
+    return SF_INT_RET_CODE_SUCCESS;
+}
+
+void * STDCALL sf_hashmap_get(HASH_MAP *hash_map, const char *key)
+{
+    if (!key)
+    {
+        return NULL;
+    }
+    return sf_hashmap_get_hashed(hash_map, key, sf_hashmap_hash(key));
+}
+
+void * STDCALL sf_hashmap_get_hashed(HASH_MAP *hash_map, const char *key, uint64 hash)
+{
+    if (!hash_map || !key)
+    {
+        return NULL;
+    }
+    return sf_hashmap_find(hash_map, key, hash)->param;
+}
+
+void STDCALL sf_hashmap_clear(HASH_MAP *hash_map)
+{
+    if (!hash_map)
+    {
+        return;
+    }
+    memset(hash_map->entries, 0, hash_map->capacity * sizeof(HASH_MAP_ENTRY));
+    hash_map->count = 0;
+}
+
+void STDCALL sf_hashmap_deallocate(HASH_MAP *hash_map)
+{
+    if (!hash_map)
+    {
+        log_debug("sf_hashmap_deallocate: hashmap is NULL\n");
+        return;
+    }
+    SF_FREE(hash_map->entries);
+    SF_FREE(hash_map);
+}
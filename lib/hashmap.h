@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_HASHMAP_H
+#define SNOWFLAKE_HASHMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include "snowflake/platform.h"
+#include "snowflake/basic_types.h"
+#include "snowflake/logger.h"
+#include "lib_common.h"
+
+// Smallest number of slots of a hash map, always a power of two
+#define HASH_MAP_MIN_CAPACITY 8
+
+typedef struct sf_hashmap_entry
+{
+    // NULL for an empty slot. Keys are not copied.
+    char *key;
+    uint64 hash;
+    void *param;
+} HASH_MAP_ENTRY;
+
+/*
+** Map from names to params with open addressing. All entries live in one
+** array that is kept at most 3/4 full and probed linearly, so a lookup
+** usually touches a single cache line and compares one key.
+*/
+typedef struct sf_hashmap
+{
+    HASH_MAP_ENTRY *entries;
+    size_t capacity;
+    size_t count;
+} HASH_MAP;
+
+/*
+** sf_hashmap_init
+** @param expected number of keys the map is sized for. It grows beyond.
+** @return pointer to HASH_MAP, NULL if out of memory
+*/
+HASH_MAP * STDCALL sf_hashmap_init(size_t expected);
+
+/*
+** sf_hashmap_reserve
+** grow the map so that it takes count keys without growing again
+** @return SF_BOOLEAN_FALSE if out of memory
+*/
+sf_bool STDCALL sf_hashmap_reserve(HASH_MAP *hash_map, size_t count);
+
+// Hash of no bytes, the start of an FNV-1a hash
+#define SF_FNV_OFFSET_BASIS 14695981039346656037ULL
+
+/*
+** sf_fnv1a
+** 64-bit FNV-1a hash of bytes, continuing the given hash so that several values are hashed
+** as one, the first one starting from SF_FNV_OFFSET_BASIS
+*/
+uint64 STDCALL sf_fnv1a(uint64 hash, const void *data, size_t len);
+
+/*
+** sf_hashmap_hash
+** hash of a key, to be computed once and passed to the *_hashed functions
+*/
+uint64 STDCALL sf_hashmap_hash(const char *key);
+
+/* sf_hashmap_set
+** insert param into hash map, replacing the param of an existing key
+** @return SF_INT_RET_CODE_DUPLICATES if the key existed
+*/
+SF_INT_RET_CODE STDCALL sf_hashmap_set(HASH_MAP *hash_map, void *param, char *key);
+
+SF_INT_RET_CODE STDCALL sf_hashmap_set_hashed(HASH_MAP *hash_map, void *param, char *key,
+                                              uint64 hash);
+
+/*
+** sf_hashmap_get
+** @return the param of a key, NULL if it is not in the map
+*/
+void * STDCALL sf_hashmap_get(HASH_MAP *hash_map, const char *key);
+
+void * STDCALL sf_hashmap_get_hashed(HASH_MAP *hash_map, const char *key, uint64 hash);
+
+/* sf_hashmap_clear
+** remove all keys, keeping the slots for the next ones
+*/
+void STDCALL sf_hashmap_clear(HASH_MAP *hash_map);
+
+/* sf_hashmap_deallocate
+** deallocate hash map, but not its keys and params.
+*/
+void STDCALL sf_hashmap_deallocate(HASH_MAP *hash_map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SNOWFLAKE_HASHMAP_H */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "hex.h"
+
+// The AVX2 kernels are built into any x86 build and only used where the CPU has it, whatever
+// the flags the rest of the library is built with
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SF_HEX_AVX2
+#include <immintrin.h>
+#endif
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+#ifdef SF_HEX_AVX2
+static sf_bool has_avx2() {
+    return __builtin_cpu_supports("avx2") ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Encodes 32 bytes at a time, each nibble looked up in a table of the digits.
+ *
+ * @return bytes encoded, a multiple of 32.
+ */
+__attribute__((target("avx2")))
+static size_t encode_avx2(char *dst, const unsigned char *src, size_t len) {
+    const __m256i digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    size_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i high = _mm256_shuffle_epi8(
+            digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, low_nibble));
+        // The digits are paired within the 128 bit lanes, bytes 0-7 and 16-23 first
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i *) (dst + i * 2),
+                            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *) (dst + i * 2 + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+
+/**
+ * Values of 32 hex digits, all of them valid if *valid is left true.
+ */
+__attribute__((target("avx2")))
+static __m256i digit_values_avx2(__m256i chars, sf_bool *valid) {
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i five = _mm256_set1_epi8(5);
+    __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    // 'A'-'F' and 'a'-'f' become 0-5, every other character something else
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)),
+                                     _mm256_set1_epi8('a'));
+    __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+    __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, five), letter);
+
+    if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != -1) {
+        *valid = SF_BOOLEAN_FALSE;
+    }
+    return _mm256_blendv_epi8(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), digit, is_digit);
+}
+
+/**
+ * Decodes 64 digits at a time, stopping before the first block with a character that isn't a
+ * hex digit, left to the scalar decoder to reject.
+ *
+ * @return bytes decoded, a multiple of 32.
+ */
+__attribute__((target("avx2")))
+static size_t decode_avx2(unsigned char *dst, const char *src, size_t len) {
+    // Each pair of digits is high * 16 + low
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        sf_bool valid = SF_BOOLEAN_TRUE;
+        __m256i first = digit_values_avx2(
+            _mm256_loadu_si256((const __m256i *) (src + i * 2)), &valid);
+        __m256i second = digit_values_avx2(
+            _mm256_loadu_si256((const __m256i *) (src + i * 2 + 32)), &valid);
+        __m256i bytes;
+
+        if (!valid) {
+            break;
+        }
+        // Packing works within the lanes, leaving bytes 0-7, 16-23, 8-15, 24-31 in order
+        bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights),
+                                    _mm256_maddubs_epi16(second, weights));
+        _mm256_storeu_si256((__m256i *) (dst + i),
+                            _mm256_permute4x64_epi64(bytes, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return i;
+}
+#endif
+
+int STDCALL sf_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+void STDCALL sf_hex_encode(char *dst, const void *src, size_t len) {
+    const unsigned char *bytes = (const unsigned char *) src;
+    size_t i = 0;
+
+#ifdef SF_HEX_AVX2
+    if (len >= 32 && has_avx2()) {
+        i = encode_avx2(dst, bytes, len);
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i * 2] = HEX_DIGITS[bytes[i] >> 4];
+        dst[i * 2 + 1] = HEX_DIGITS[bytes[i] & 0x0f];
+    }
+}
+
+sf_bool STDCALL sf_hex_decode(void *dst, const char *src, size_t len) {
+    unsigned char *bytes = (unsigned char *) dst;
+    size_t i = 0;
+    int high;
+    int low;
+
+#ifdef SF_HEX_AVX2
+    if (len >= 32 && has_avx2()) {
+        i = decode_avx2(bytes, src, len);
+    }
+#endif
+    for (; i < len; i++) {
+        high = sf_hex_digit(src[i * 2]);
+        low = sf_hex_digit(src[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return SF_BOOLEAN_FALSE;
+        }
+        bytes[i] = (unsigned char) ((high << 4) | low);
+    }
+    return SF_BOOLEAN_TRUE;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_HEX_H
+#define SNOWFLAKE_HEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Encodes bytes as the upper case hex text BINARY values are given and bound in. Runs 32 bytes
+ * at a time where the CPU has AVX2.
+ *
+ * @param dst receives 2 * len characters, not NUL-terminated.
+ * @param src the bytes.
+ * @param len number of bytes.
+ */
+void STDCALL sf_hex_encode(char *dst, const void *src, size_t len);
+
+/**
+ * Decodes hex text, digits of either case, the way sf_hex_encode() is reversed. Runs 64
+ * characters at a time where the CPU has AVX2.
+ *
+ * @param dst receives len bytes, left partly written if the text isn't valid.
+ * @param src 2 * len hex digits.
+ * @param len number of bytes to decode.
+ *
+ * @return SF_BOOLEAN_FALSE if a character isn't a hex digit.
+ */
+sf_bool STDCALL sf_hex_decode(void *dst, const char *src, size_t len);
+
+/**
+ * Value of a hex digit, or -1 if the character isn't one.
+ */
+int STDCALL sf_hex_digit(char c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_HEX_H
@@ -28,6 +28,9 @@
 #include "memory.h"
 #include "constants.h"
 #include "client_int.h"
+#include "metrics.h"
+#include "curl_pool.h"
+#include "json_rowset.h"
 
 #define REQUEST_GUID_KEY_SIZE 13
 
@@ -38,7 +41,6 @@ dump(const char *text, FILE *stream, unsigned char *ptr, size_t size,
 static int my_trace(CURL *handle, curl_infotype type, char *data, size_t size,
                     void *userp);
 
-static void my_sleep_ms(uint32 sleepMs);
 
 static
 void dump(const char *text,
@@ -130,14 +132,90 @@ int my_trace(CURL *handle, curl_infotype type,
     return 0;
 }
 
-static
-void my_sleep_ms(uint32 sleepMs)
-{
-#ifdef _WIN32
-  Sleep(sleepMs);
-#else
-  usleep(sleepMs * 1000); // usleep takes sleep time in us (1 millionth of a second)
+sf_bool STDCALL set_curl_tls_options(CURL *curl, sf_bool insecure_mode) {
+    CURLcode res;
+
+    if (DISABLE_VERIFY_PEER) {
+        res = curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        if (res != CURLE_OK) {
+            log_error("Failed to disable peer verification [%s]",
+                      curl_easy_strerror(res));
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    if (CA_BUNDLE_FILE) {
+        res = curl_easy_setopt(curl, CURLOPT_CAINFO, CA_BUNDLE_FILE);
+        if (res != CURLE_OK) {
+            log_error("Unable to set certificate file [%s]",
+                      curl_easy_strerror(res));
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+
+    res = curl_easy_setopt(curl, CURLOPT_SSLVERSION, SSL_VERSION);
+    if (res != CURLE_OK) {
+        log_error("Unable to set SSL Version [%s]",
+                  curl_easy_strerror(res));
+        return SF_BOOLEAN_FALSE;
+    }
+
+#ifndef _WIN32
+#ifndef LIBSFCLI_FOR_XP
+    // If insecure mode is set to true, skip OCSP check not matter the value of SF_OCSP_CHECK (global OCSP variable)
+    sf_bool ocsp_check;
+    if (insecure_mode) {
+        ocsp_check = SF_BOOLEAN_FALSE;
+    } else {
+        ocsp_check = SF_OCSP_CHECK;
+    }
+    res = curl_easy_setopt(curl, CURLOPT_SSL_SF_OCSP_CHECK, ocsp_check);
+    if (res != CURLE_OK) {
+        log_error("Unable to set OCSP check enable/disable [%s]",
+                  curl_easy_strerror(res));
+        return SF_BOOLEAN_FALSE;
+    }
 #endif
+#endif
+
+    // Every request goes through here, whatever the handle it's sent with
+    sf_curl_share_apply(curl);
+    return SF_BOOLEAN_TRUE;
+}
+
+static sf_bool is_aborted(const SF_HEADER *header) {
+    return header && header->abort_flag && sf_atomic_load(header->abort_flag) ?
+           SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Progress callback of the transfers that can be aborted, called by curl while it waits
+ * for data as well as when data arrives. A non-zero return aborts the transfer.
+ */
+static int abort_xferinfo_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                   curl_off_t ultotal, curl_off_t ulnow) {
+    (void) dltotal;
+    (void) dlnow;
+    (void) ultotal;
+    (void) ulnow;
+    return sf_atomic_load((volatile uint64 *) clientp) ? 1 : 0;
+}
+
+/**
+ * Sleeps before a retry, in short steps so that an aborted request doesn't wait out the
+ * backoff.
+ */
+static void sleep_unless_aborted(const SF_HEADER *header, uint32 sleep_ms) {
+    uint32 step;
+    if (!header || !header->abort_flag) {
+        sf_sleep_ms(sleep_ms);
+        return;
+    }
+    while (sleep_ms > 0 && !is_aborted(header)) {
+        step = sleep_ms < 100 ? sleep_ms : 100;
+        sf_sleep_ms(step);
+        sleep_ms -= step;
+    }
 }
 
 sf_bool STDCALL http_perform(CURL *curl,
@@ -151,30 +229,65 @@ sf_bool STDCALL http_perform(CURL *curl,
                              sf_bool chunk_downloader,
                              SF_ERROR_STRUCT *error,
                              sf_bool insecure_mode,
-                             int8 retry_on_curle_couldnt_connect_count) {
+                             int8 retry_on_curle_couldnt_connect_count,
+                             const SF_RETRY_POLICY *retry_policy) {
     CURLcode res;
     sf_bool ret = SF_BOOLEAN_FALSE;
     sf_bool retry = SF_BOOLEAN_FALSE;
     long int http_code = 0;
     DECORRELATE_JITTER_BACKOFF djb = {
-      1,      //base
-      16      //cap
+      SF_DEFAULT_RETRY_BACKOFF_BASE,      //base
+      SF_DEFAULT_RETRY_BACKOFF_CAP        //cap
     };
+    if (retry_policy) {
+        djb = retry_policy->backoff;
+    }
     network_timeout = (network_timeout > 0) ? network_timeout : SF_LOGIN_TIMEOUT;
     RETRY_CONTEXT curl_retry_ctx = {
             0,      //retry_count
             network_timeout,
-            1,      // time to sleep
+            djb.base,      // time to sleep
             &djb    // Decorrelate jitter
     };
     time_t elapsedRetryTime = time(NULL);
-    RAW_JSON_BUFFER buffer = {NULL, 0};
+    RAW_JSON_BUFFER buffer = {NULL, 0, 0, SF_MEMORY_TAG_NONE};
     struct data config;
+    char *compressed_body = NULL;
+    size_t compressed_body_len = 0;
+    struct curl_slist *compressed_header = NULL;
+    struct curl_slist *item;
+    struct curl_slist *list = NULL;
+    uint64 start_us;
     config.trace_ascii = 1;
 
     if (curl == NULL) {
         return SF_BOOLEAN_FALSE;
     }
+    start_us = sf_monotonic_time_us();
+
+    // Compress a large body once for all attempts. The header list belongs to the caller,
+    // the encoding is added to a copy of it.
+    if (request_type == POST_REQUEST_TYPE && body && header &&
+        header->compress_body_threshold > 0 && strlen(body) >= header->compress_body_threshold) {
+        if (gzip_compress(body, strlen(body), &compressed_body, &compressed_body_len)) {
+            for (item = header->header; item; item = item->next) {
+                if (!(compressed_header = curl_slist_append(list, item->data))) {
+                    break;
+                }
+                list = compressed_header;
+            }
+            if (!item) {
+                compressed_header = curl_slist_append(list, HEADER_CONTENT_ENCODING_GZIP);
+            }
+        }
+        if (compressed_header) {
+            log_trace("Compressed request body from %lu to %lu bytes",
+                      (unsigned long) strlen(body), (unsigned long) compressed_body_len);
+        } else {
+            log_warn("Unable to compress the request body, sending it uncompressed");
+            curl_slist_free_all(list);
+        }
+    }
 
     //TODO set error buffer
 
@@ -186,9 +299,19 @@ sf_bool STDCALL http_perform(CURL *curl,
     }
 
     do {
-        // Reset buffer since this may not be our first rodeo
-        SF_FREE(buffer.buffer);
+        if (is_aborted(header)) {
+            log_debug("Request aborted before it was sent");
+            SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL, "The request was aborted",
+                                SF_SQLSTATE_UNABLE_TO_CONNECT);
+            retry = SF_BOOLEAN_FALSE;
+            break;
+        }
+
+        // Reset buffer since this may not be our first rodeo, its memory is kept
         buffer.size = 0;
+        if (non_json_resp && non_json_resp->reset_callback) {
+            non_json_resp->reset_callback(non_json_resp->buffer);
+        }
 
         // Generate new request guid, if request guid exists in url
         if (request_guid_ptr && uuid4_generate_non_terminated(request_guid_ptr)) {
@@ -212,7 +335,8 @@ sf_bool STDCALL http_perform(CURL *curl,
         }
 
         if (header) {
-            res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header->header);
+            res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER,
+                                   compressed_header ? compressed_header : header->header);
             if (res != CURLE_OK) {
                 log_error("Failed to set header [%s]", curl_easy_strerror(res));
                 break;
@@ -227,10 +351,20 @@ sf_bool STDCALL http_perform(CURL *curl,
                 break;
             }
 
-            if (body) {
-                res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+            if (compressed_header) {
+                // Binary data, so the size isn't taken from a terminator
+                res = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                                       (curl_off_t) compressed_body_len);
+                if (res == CURLE_OK) {
+                    res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, compressed_body);
+                }
             } else {
-                res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+                // The handle may be reused, e.g. to renew the session, after sending a
+                // compressed body, whose size must not be kept for this one
+                res = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) -1);
+                if (res == CURLE_OK) {
+                    res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body ? body : "");
+                }
             }
             if (res != CURLE_OK) {
                 log_error("Failed to set body [%s]", curl_easy_strerror(res));
@@ -264,49 +398,24 @@ sf_bool STDCALL http_perform(CURL *curl,
           break;
         }
 
-        if (DISABLE_VERIFY_PEER) {
-            res = curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-            if (res != CURLE_OK) {
-                log_error("Failed to disable peer verification [%s]",
-                          curl_easy_strerror(res));
-                break;
-            }
+        if (!set_curl_tls_options(curl, insecure_mode)) {
+            break;
         }
 
-        if (CA_BUNDLE_FILE) {
-            res = curl_easy_setopt(curl, CURLOPT_CAINFO, CA_BUNDLE_FILE);
+        if (header && header->abort_flag) {
+            res = curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, abort_xferinfo_callback);
+            if (res == CURLE_OK) {
+                res = curl_easy_setopt(curl, CURLOPT_XFERINFODATA, (void *) header->abort_flag);
+            }
+            if (res == CURLE_OK) {
+                res = curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            }
             if (res != CURLE_OK) {
-                log_error("Unable to set certificate file [%s]",
-                          curl_easy_strerror(res));
+                log_error("Unable to set the abort callback [%s]", curl_easy_strerror(res));
                 break;
             }
         }
 
-        res = curl_easy_setopt(curl, CURLOPT_SSLVERSION, SSL_VERSION);
-        if (res != CURLE_OK) {
-            log_error("Unable to set SSL Version [%s]",
-                      curl_easy_strerror(res));
-            break;
-        }
-
-#ifndef _WIN32
-#ifndef LIBSFCLI_FOR_XP
-        // If insecure mode is set to true, skip OCSP check not matter the value of SF_OCSP_CHECK (global OCSP variable)
-        sf_bool ocsp_check;
-        if (insecure_mode) {
-            ocsp_check = SF_BOOLEAN_FALSE;
-        } else {
-            ocsp_check = SF_OCSP_CHECK;
-        }
-        res = curl_easy_setopt(curl, CURLOPT_SSL_SF_OCSP_CHECK, ocsp_check);
-        if (res != CURLE_OK) {
-            log_error("Unable to set OCSP check enable/disable [%s]",
-                      curl_easy_strerror(res));
-            break;
-        }
-#endif
-#endif
-
         // Set chunk downloader specific stuff here
         if (chunk_downloader) {
             res = curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
@@ -319,10 +428,7 @@ sf_bool STDCALL http_perform(CURL *curl,
             if (json)
             {
                 // Set the first character in the buffer as a bracket
-                buffer.buffer = (char *)SF_CALLOC(1,
-                  2); // Don't forget null terminator
-                buffer.size = 1;
-                sb_strncpy(buffer.buffer, 2, "[", 2);
+                raw_json_buffer_append(&buffer, "[", 1);
             }
         }
 
@@ -330,20 +436,26 @@ sf_bool STDCALL http_perform(CURL *curl,
         retry = SF_BOOLEAN_FALSE;
 
         log_trace("Running curl call");
+        sf_metric_add(SF_COUNTER_HTTP_REQUESTS, 1);
         res = curl_easy_perform(curl);
         /* Check for errors */
         if (res != CURLE_OK) {
-          if (res == CURLE_COULDNT_CONNECT && curl_retry_ctx.retry_count <
-                                              retry_on_curle_couldnt_connect_count)
+          if (res == CURLE_ABORTED_BY_CALLBACK && is_aborted(header)) {
+              log_debug("curl_easy_perform() aborted");
+              SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL, "The request was aborted",
+                                  SF_SQLSTATE_UNABLE_TO_CONNECT);
+          } else if (res == CURLE_COULDNT_CONNECT && curl_retry_ctx.retry_count <
+                                              retry_on_curle_couldnt_connect_count &&
+              retry_policy_take(retry_policy))
             {
               retry = SF_BOOLEAN_TRUE;
-              uint32 next_sleep_in_secs = retry_ctx_next_sleep(&curl_retry_ctx);
+              uint32 next_sleep_in_ms = retry_ctx_next_sleep(&curl_retry_ctx);
               log_error(
                       "curl_easy_perform() failed connecting to server on attempt %d, "
-                      "will retry after %d second",
+                      "will retry after %d ms",
                       curl_retry_ctx.retry_count,
-                      next_sleep_in_secs);
-              my_sleep_ms(next_sleep_in_secs*1000);
+                      next_sleep_in_ms);
+              sleep_unless_aborted(header, next_sleep_in_ms);
             } else {
               char msg[1024];
               if (res == CURLE_SSL_CACERT_BADFILE) {
@@ -367,6 +479,15 @@ sf_bool STDCALL http_perform(CURL *curl,
                 SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL,
                                     "Unable to get http response code",
                                     SF_SQLSTATE_UNABLE_TO_CONNECT);
+            } else if (http_code != 200 && chunk_downloader &&
+                       is_expired_url_http_code(http_code)) {
+                // Retrying an expired chunk URL is no use, the chunk downloader asks for a new one
+                char msg[1024];
+                sb_sprintf(msg, sizeof(msg), "Chunk URL refused, http code: [%d]", http_code);
+                SET_SNOWFLAKE_ERROR(error,
+                                    SF_STATUS_ERROR_CHUNK_URL_EXPIRED,
+                                    msg,
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
             } else if (http_code != 200) {
               retry = is_retryable_http_code(http_code);
               if (!retry) {
@@ -379,16 +500,17 @@ sf_bool STDCALL http_perform(CURL *curl,
                                     SF_SQLSTATE_UNABLE_TO_CONNECT);
               }
               if (retry &&
-                  ((time(NULL) - elapsedRetryTime) < curl_retry_ctx.retry_timeout)
+                  ((time(NULL) - elapsedRetryTime) < curl_retry_ctx.retry_timeout) &&
+                  retry_policy_take(retry_policy)
               )
               {
-                uint32 next_sleep_in_secs = retry_ctx_next_sleep(&curl_retry_ctx);
+                uint32 next_sleep_in_ms = retry_ctx_next_sleep(&curl_retry_ctx);
                 log_debug(
                     "curl_easy_perform() Got retryable error http code %d, retry count  %d "
-                    "will retry after %d seconds", http_code,
+                    "will retry after %d ms", http_code,
                     curl_retry_ctx.retry_count,
-                    next_sleep_in_secs);
-                my_sleep_ms(next_sleep_in_secs * 1000);
+                    next_sleep_in_ms);
+                sleep_unless_aborted(header, next_sleep_in_ms);
               }
               else {
                 char msg[1024];
@@ -403,30 +525,41 @@ sf_bool STDCALL http_perform(CURL *curl,
               }
             } else {
                 ret = SF_BOOLEAN_TRUE;
+                retry_policy_refund(retry_policy);
             }
         }
 
         // Reset everything
         reset_curl(curl);
         http_code = 0;
+        if (retry) {
+            sf_metric_add(SF_COUNTER_HTTP_RETRIES, 1);
+        }
     }
     while (retry);
+    sf_metric_record(SF_HISTOGRAM_HTTP_REQUEST_TIME, sf_monotonic_time_us() - start_us);
 
     if (ret && json) {
       // We were successful so parse JSON from text
       if (chunk_downloader) {
-            buffer.buffer = (char *) SF_REALLOC(buffer.buffer, buffer.size +
-                                                               2); // 1 byte for closing bracket, 1 for null terminator
-            sb_memcpy(&buffer.buffer[buffer.size], 1, "]", 1);
-            buffer.size += 1;
-            // Set null terminator
-            buffer.buffer[buffer.size] = '\0';
+            raw_json_buffer_append(&buffer, "]", 1);
         }
         snowflake_cJSON_Delete(*json);
         *json = NULL;
-        *json = snowflake_cJSON_Parse(buffer.buffer);
+        if (header && header->skip_rowset && !chunk_downloader && buffer.buffer) {
+            *json = sf_json_parse_without_rowset(buffer.buffer, buffer.size);
+        } else {
+            *json = snowflake_cJSON_Parse(buffer.buffer);
+        }
         if (*json) {
             ret = SF_BOOLEAN_TRUE;
+            // The text is handed over rather than printed again from the parsed response.
+            // An untagged buffer is freed like any other allocation.
+            if (header && header->keep_raw_response && !chunk_downloader) {
+                SF_FREE(header->raw_response);
+                header->raw_response = buffer.buffer;
+                buffer.buffer = NULL;
+            }
         } else {
             SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_JSON,
                                 "Unable to parse JSON text response.",
@@ -435,13 +568,83 @@ sf_bool STDCALL http_perform(CURL *curl,
         }
     }
 
-    SF_FREE(buffer.buffer);
+    raw_json_buffer_free(&buffer);
+    SF_FREE(compressed_body);
+    curl_slist_free_all(compressed_header);
 
     return ret;
 }
 
 #ifdef MOCK_ENABLED
 
+static MOCK_HTTP_RESPONDER mock_responder = NULL;
+static void *mock_responder_data = NULL;
+
+void STDCALL mock_http_perform_set_responder(MOCK_HTTP_RESPONDER responder, void *user_data) {
+    mock_responder = responder;
+    mock_responder_data = user_data;
+}
+
+/**
+ * Hands the response of the responder over the way curl would: a non JSON response is
+ * written in pieces the size of a curl buffer, a JSON one is parsed, with the enclosing
+ * brackets added for a JSON chunk.
+ */
+static sf_bool mock_respond(SF_REQUEST_TYPE request_type, char *url, SF_HEADER *header,
+                            char *body, cJSON **json, NON_JSON_RESP *non_json_resp,
+                            sf_bool chunk_downloader, SF_ERROR_STRUCT *error) {
+    RAW_JSON_BUFFER buffer = {NULL, 0, 0, SF_MEMORY_TAG_NONE};
+    size_t size = 0;
+    size_t offset;
+    const char *resp = mock_responder(request_type, url, body, &size, mock_responder_data);
+
+    if (!resp) {
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL, "No mock response for the request",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        return SF_BOOLEAN_FALSE;
+    }
+    if (non_json_resp) {
+        if (non_json_resp->reset_callback) {
+            non_json_resp->reset_callback(non_json_resp->buffer);
+        }
+        for (offset = 0; offset < size; offset += CURL_MAX_WRITE_SIZE) {
+            size_t part = size - offset < CURL_MAX_WRITE_SIZE ? size - offset : CURL_MAX_WRITE_SIZE;
+            if (non_json_resp->write_callback((char *) resp + offset, 1, part,
+                                              non_json_resp->buffer) != part) {
+                SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_CURL, "Mock response not taken",
+                                    SF_SQLSTATE_UNABLE_TO_CONNECT);
+                return SF_BOOLEAN_FALSE;
+            }
+        }
+        return SF_BOOLEAN_TRUE;
+    }
+
+    if (chunk_downloader) {
+        raw_json_buffer_append(&buffer, "[", 1);
+    }
+    raw_json_buffer_append(&buffer, resp, size);
+    if (chunk_downloader) {
+        raw_json_buffer_append(&buffer, "]", 1);
+    }
+    if (header && header->skip_rowset && !chunk_downloader) {
+        *json = sf_json_parse_without_rowset(buffer.buffer, buffer.size);
+    } else {
+        *json = snowflake_cJSON_Parse(buffer.buffer);
+    }
+    if (*json && header && header->keep_raw_response && !chunk_downloader) {
+        SF_FREE(header->raw_response);
+        header->raw_response = buffer.buffer;
+        buffer.buffer = NULL;
+    }
+    raw_json_buffer_free(&buffer);
+    if (!*json) {
+        SET_SNOWFLAKE_ERROR(error, SF_STATUS_ERROR_BAD_JSON, "Unable to parse mock response",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+        return SF_BOOLEAN_FALSE;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
 sf_bool STDCALL __wrap_http_perform(CURL *curl,
                                     SF_REQUEST_TYPE request_type,
                                     char *url,
@@ -452,10 +655,17 @@ sf_bool STDCALL __wrap_http_perform(CURL *curl,
                                     int64 network_timeout,
                                     sf_bool chunk_downloader,
                                     SF_ERROR_STRUCT *error,
-                                    sf_bool insecure_mode) {
+                                    sf_bool insecure_mode,
+                                    int8 retry_on_curle_couldnt_connect_count,
+                                    const SF_RETRY_POLICY *retry_policy) {
     char *resp;
     const char *request_type_str = request_type == POST_REQUEST_TYPE ? "POST" : "GET";
 
+    if (mock_responder) {
+        return mock_respond(request_type, url, header, body, json, non_json_resp,
+                            chunk_downloader, error);
+    }
+
     // Remove request ID from URL (since it isn't deterministic
     char *found = strchr(url, '?');
     found[0] = '\0';
@@ -473,6 +683,13 @@ sf_bool STDCALL __wrap_http_perform(CURL *curl,
     // Get back mock response (assuming all inputs checked out) and parse as JSON
     resp = mock_ptr_type(char *);
     *json = snowflake_cJSON_Parse(resp);
+    if (*json && header && header->keep_raw_response) {
+        SF_FREE(header->raw_response);
+        header->raw_response = (char *) SF_MALLOC(strlen(resp) + 1);
+        if (header->raw_response) {
+            memcpy(header->raw_response, resp, strlen(resp) + 1);
+        }
+    }
 
     return SF_BOOLEAN_TRUE;
 }
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <snowflake/logger.h>
+#include "io_threads.h"
+
+static SF_MUTEX_HANDLE io_threads_lock;
+static uint64 io_threads_limit = 0;
+static uint64 io_threads_taken = 0;
+
+void STDCALL sf_io_threads_init() {
+    _mutex_init(&io_threads_lock);
+    io_threads_limit = 0;
+    io_threads_taken = 0;
+}
+
+void STDCALL sf_io_threads_term() {
+    _mutex_term(&io_threads_lock);
+}
+
+void STDCALL sf_io_threads_set_limit(uint64 limit) {
+    _mutex_lock(&io_threads_lock);
+    io_threads_limit = limit;
+    _mutex_unlock(&io_threads_lock);
+}
+
+uint64 STDCALL sf_io_threads_get_limit() {
+    uint64 limit;
+    _mutex_lock(&io_threads_lock);
+    limit = io_threads_limit;
+    _mutex_unlock(&io_threads_lock);
+    return limit;
+}
+
+uint64 STDCALL sf_io_threads_acquire(uint64 wanted) {
+    uint64 granted = wanted > 0 ? wanted : 1;
+    uint64 taken;
+
+    _mutex_lock(&io_threads_lock);
+    if (io_threads_limit > 0) {
+        uint64 left = io_threads_taken < io_threads_limit ?
+                      io_threads_limit - io_threads_taken : 0;
+        if (granted > left) {
+            granted = left > 0 ? left : 1;
+        }
+    }
+    io_threads_taken += granted;
+    taken = io_threads_taken;
+    _mutex_unlock(&io_threads_lock);
+
+    if (granted < wanted) {
+        log_debug("%llu of %llu I/O threads granted, %llu in use",
+                  (unsigned long long) granted, (unsigned long long) wanted,
+                  (unsigned long long) taken);
+    }
+    return granted;
+}
+
+void STDCALL sf_io_threads_release(uint64 count) {
+    _mutex_lock(&io_threads_lock);
+    io_threads_taken = io_threads_taken > count ? io_threads_taken - count : 0;
+    _mutex_unlock(&io_threads_lock);
+}
+
+uint64 STDCALL sf_io_threads_in_use() {
+    uint64 taken;
+    _mutex_lock(&io_threads_lock);
+    taken = io_threads_taken;
+    _mutex_unlock(&io_threads_lock);
+    return taken;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_IO_THREADS_H
+#define SNOWFLAKE_IO_THREADS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Process-wide budget of the threads doing I/O: the chunk downloader threads of the statements,
+ * and the thread pools of the file transfers and their storage clients. Before starting its
+ * threads, each of them asks the budget how many it may have, and gives them back once they
+ * are joined. With a limit set, a caller gets as many of the threads it asks for as are left,
+ * but always at least one so that every statement and transfer makes progress, which means the
+ * limit can be exceeded by one thread per caller at most.
+ */
+void STDCALL sf_io_threads_init();
+
+void STDCALL sf_io_threads_term();
+
+/**
+ * Sets the limit of the budget, 0 for no limit. Threads already taken are not affected.
+ */
+void STDCALL sf_io_threads_set_limit(uint64 limit);
+
+/**
+ * @return the limit of the budget, 0 for no limit.
+ */
+uint64 STDCALL sf_io_threads_get_limit();
+
+/**
+ * Takes threads from the budget.
+ *
+ * @param wanted the number of threads the caller would like to start.
+ *
+ * @return the number of threads the caller may start, between 1 and wanted, to be given back
+ *         with sf_io_threads_release().
+ */
+uint64 STDCALL sf_io_threads_acquire(uint64 wanted);
+
+/**
+ * Gives back threads taken with sf_io_threads_acquire().
+ */
+void STDCALL sf_io_threads_release(uint64 count);
+
+/**
+ * @return the number of threads taken and not given back.
+ */
+uint64 STDCALL sf_io_threads_in_use();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_IO_THREADS_H
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "json_path.h"
+#include "json_scanner.h"
+#include "memory.h"
+
+/**
+ * A step of a path: the key of an object member or the index of an array element.
+ */
+typedef struct SF_JSON_PATH_STEP {
+    const char *key;
+    size_t key_len;
+    uint64 index;
+    sf_bool is_index;
+} SF_JSON_PATH_STEP;
+
+/**
+ * Reads the next step of a path.
+ *
+ * @return 1 if a step is read, 0 at the end of the path, -1 if the path can't be parsed.
+ */
+static int next_step(const char **path, sf_bool first, SF_JSON_PATH_STEP *step) {
+    const char *p = *path;
+    const char *end;
+
+    memset(step, 0, sizeof(SF_JSON_PATH_STEP));
+    if (*p == '\0') {
+        return 0;
+    }
+    if (*p == '[') {
+        p++;
+        if (*p == '"') {
+            // A quoted key, which may have dots and brackets
+            if (!(end = strchr(p + 1, '"')) || end[1] != ']') {
+                return -1;
+            }
+            step->key = p + 1;
+            step->key_len = (size_t) (end - p - 1);
+            *path = end + 2;
+            return 1;
+        }
+        if (*p < '0' || *p > '9') {
+            return -1;
+        }
+        step->is_index = SF_BOOLEAN_TRUE;
+        for (; *p >= '0' && *p <= '9'; p++) {
+            if (step->index > (SF_UINT64_MAX - 9) / 10) {
+                return -1;
+            }
+            step->index = step->index * 10 + (uint64) (*p - '0');
+        }
+        if (*p != ']') {
+            return -1;
+        }
+        *path = p + 1;
+        return 1;
+    }
+    if (!first) {
+        if (*p != '.') {
+            return -1;
+        }
+        p++;
+    }
+    for (end = p; *end != '\0' && *end != '.' && *end != '['; end++) {
+    }
+    if (end == p) {
+        return -1;
+    }
+    step->key = p;
+    step->key_len = (size_t) (end - p);
+    *path = end;
+    return 1;
+}
+
+/**
+ * Compares the escaped key of a member with a key of the path. Keys rarely have escapes, so
+ * they are only unescaped, to a copy, when they do.
+ */
+static sf_bool key_equals(const char *key, size_t key_len, const char *name, size_t name_len) {
+    char *unescaped;
+    size_t unescaped_len;
+    sf_bool equal;
+
+    if (!memchr(key, '\\', key_len)) {
+        return key_len == name_len && memcmp(key, name, key_len) == 0;
+    }
+    if (key_len < name_len || !(unescaped = (char *) SF_MALLOC(key_len + 1))) {
+        return SF_BOOLEAN_FALSE;
+    }
+    equal = sf_json_unescape(key, key_len, unescaped, &unescaped_len) &&
+            unescaped_len == name_len && memcmp(unescaped, name, name_len) == 0 ?
+            SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    SF_FREE(unescaped);
+    return equal;
+}
+
+/**
+ * Moves to the value of a member of the object the scanner is at.
+ *
+ * @return 1 if found, 0 if the object has no such member, -1 on a syntax error.
+ */
+static int find_member(SF_JSON_SCANNER *scanner, const char *name, size_t name_len) {
+    size_t key;
+    size_t key_len;
+    char c;
+
+    scanner->pos++;
+    if (sf_json_peek(scanner) == '}') {
+        return 0;
+    }
+    for (;;) {
+        if (sf_json_peek(scanner) != '"') {
+            return -1;
+        }
+        key = scanner->pos + 1;
+        if (!sf_json_skip_string(scanner)) {
+            return -1;
+        }
+        key_len = scanner->pos - 1 - key;
+        if (sf_json_peek(scanner) != ':') {
+            return -1;
+        }
+        scanner->pos++;
+        if (key_equals(scanner->text + key, key_len, name, name_len)) {
+            return 1;
+        }
+        if (!sf_json_skip_value(scanner)) {
+            return -1;
+        }
+        c = sf_json_peek(scanner);
+        if (c == '}') {
+            return 0;
+        }
+        if (c != ',') {
+            return -1;
+        }
+        scanner->pos++;
+    }
+}
+
+/**
+ * Moves to an element of the array the scanner is at.
+ *
+ * @return 1 if found, 0 if the array is shorter, -1 on a syntax error.
+ */
+static int find_element(SF_JSON_SCANNER *scanner, uint64 index) {
+    uint64 i;
+    char c;
+
+    scanner->pos++;
+    if (sf_json_peek(scanner) == ']') {
+        return 0;
+    }
+    for (i = 0; i < index; i++) {
+        if (!sf_json_skip_value(scanner)) {
+            return -1;
+        }
+        c = sf_json_peek(scanner);
+        if (c == ']') {
+            return 0;
+        }
+        if (c != ',') {
+            return -1;
+        }
+        scanner->pos++;
+    }
+    return 1;
+}
+
+SF_STATUS STDCALL sf_json_path_find(const char *text, size_t len, const char *path,
+                                    SF_JSON_VALUE_TYPE *type, const char **value,
+                                    size_t *value_len) {
+    SF_JSON_SCANNER scanner;
+    SF_JSON_PATH_STEP step;
+    sf_bool first = SF_BOOLEAN_TRUE;
+    size_t start;
+    int found;
+    char c;
+
+    *type = SF_JSON_VALUE_NONE;
+    *value = NULL;
+    *value_len = 0;
+    scanner.text = text;
+    scanner.pos = 0;
+    scanner.len = len;
+
+    while ((found = next_step(&path, first, &step)) > 0) {
+        first = SF_BOOLEAN_FALSE;
+        c = sf_json_peek(&scanner);
+        if (step.is_index) {
+            found = c == '[' ? find_element(&scanner, step.index) : 0;
+        } else {
+            found = c == '{' ? find_member(&scanner, step.key, step.key_len) : 0;
+        }
+        if (found < 0) {
+            return SF_STATUS_ERROR_BAD_JSON;
+        }
+        if (found == 0) {
+            // The path may only be checked to its end
+            while ((found = next_step(&path, SF_BOOLEAN_FALSE, &step)) > 0) {
+            }
+            return found < 0 ? SF_STATUS_ERROR_BAD_REQUEST : SF_STATUS_SUCCESS;
+        }
+    }
+    if (found < 0) {
+        return SF_STATUS_ERROR_BAD_REQUEST;
+    }
+
+    c = sf_json_peek(&scanner);
+    start = scanner.pos;
+    if (c == '"') {
+        if (!sf_json_skip_string(&scanner)) {
+            return SF_STATUS_ERROR_BAD_JSON;
+        }
+        *type = SF_JSON_VALUE_STRING;
+        *value = text + start + 1;
+        *value_len = scanner.pos - start - 2;
+        return SF_STATUS_SUCCESS;
+    }
+    if (c == '{' || c == '[') {
+        if (!sf_json_skip_value(&scanner)) {
+            return SF_STATUS_ERROR_BAD_JSON;
+        }
+        *type = c == '{' ? SF_JSON_VALUE_OBJECT : SF_JSON_VALUE_ARRAY;
+    } else {
+        sf_json_skip_scalar(&scanner);
+        if (scanner.pos - start == 4 && memcmp(text + start, "null", 4) == 0) {
+            *type = SF_JSON_VALUE_NULL;
+        } else if ((scanner.pos - start == 4 && memcmp(text + start, "true", 4) == 0) ||
+                   (scanner.pos - start == 5 && memcmp(text + start, "false", 5) == 0)) {
+            *type = SF_JSON_VALUE_BOOLEAN;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            *type = SF_JSON_VALUE_NUMBER;
+        } else {
+            return SF_STATUS_ERROR_BAD_JSON;
+        }
+    }
+    *value = text + start;
+    *value_len = scanner.pos - start;
+    return SF_STATUS_SUCCESS;
+}
+
+sf_bool STDCALL sf_json_unescape(const char *text, size_t len, char *out, size_t *out_len) {
+    size_t read = 0;
+    size_t write = 0;
+    uint32 code_point;
+    uint32 low;
+
+    while (read < len) {
+        if (text[read] != '\\') {
+            out[write++] = text[read++];
+            continue;
+        }
+        if (read + 1 >= len) {
+            return SF_BOOLEAN_FALSE;
+        }
+        switch (text[read + 1]) {
+            case '"':
+            case '\\':
+            case '/':
+                out[write++] = text[read + 1];
+                break;
+            case 'b':
+                out[write++] = '\b';
+                break;
+            case 'f':
+                out[write++] = '\f';
+                break;
+            case 'n':
+                out[write++] = '\n';
+                break;
+            case 'r':
+                out[write++] = '\r';
+                break;
+            case 't':
+                out[write++] = '\t';
+                break;
+            case 'u':
+                if (!sf_json_read_hex4(text, len, read + 2, &code_point) ||
+                    (code_point >= 0xDC00 && code_point <= 0xDFFF)) {
+                    return SF_BOOLEAN_FALSE;
+                }
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // A high surrogate has to be followed by a low one
+                    if (read + 11 >= len || text[read + 6] != '\\' || text[read + 7] != 'u' ||
+                        !sf_json_read_hex4(text, len, read + 8, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        return SF_BOOLEAN_FALSE;
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    read += 6;
+                }
+                write += sf_json_write_utf8(&out[write], code_point);
+                read += 6;
+                continue;
+            default:
+                return SF_BOOLEAN_FALSE;
+        }
+        read += 2;
+    }
+    out[write] = '\0';
+    *out_len = write;
+    return SF_BOOLEAN_TRUE;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_JSON_PATH_H
+#define SNOWFLAKE_JSON_PATH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Finds the value at a path in the JSON text of a VARIANT, OBJECT or ARRAY cell. The text is
+ * scanned on demand: the members and elements before the one on the path are skipped over by
+ * looking for quotes and brackets only, and nothing after the value is read, so no tree is
+ * built however large the cell is.
+ *
+ * A path is a sequence of keys and indexes, e.g. a.b[3].c or a["key.with.dots"][0]. An empty
+ * path refers to the whole text.
+ *
+ * @param text the JSON text.
+ * @param len the length of the text.
+ * @param path the NUL-terminated path.
+ * @param type set to the type of the value, SF_JSON_VALUE_NONE if the path isn't in the text.
+ * @param value set to the text of the value in the JSON text. For a string it is the text
+ *        between the quotes, still escaped, see sf_json_unescape().
+ * @param value_len set to the length of the text of the value.
+ *
+ * @return 0 if success, SF_STATUS_ERROR_BAD_REQUEST if the path can't be parsed or
+ *         SF_STATUS_ERROR_BAD_JSON if the text along the path isn't JSON.
+ */
+SF_STATUS STDCALL sf_json_path_find(const char *text, size_t len, const char *path,
+                                    SF_JSON_VALUE_TYPE *type, const char **value,
+                                    size_t *value_len);
+
+/**
+ * Unescapes the text of a JSON string, without its quotes, and terminates it.
+ *
+ * @param text the escaped text.
+ * @param len the length of the escaped text.
+ * @param out len + 1 bytes for the unescaped text, which is never longer. It may be text.
+ * @param out_len set to the length of the unescaped text.
+ *
+ * @return SF_BOOLEAN_FALSE if an escape sequence is invalid.
+ */
+sf_bool STDCALL sf_json_unescape(const char *text, size_t len, char *out, size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_JSON_PATH_H
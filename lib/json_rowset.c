@@ -0,0 +1,730 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "json_rowset.h"
+#include "json_scanner.h"
+#include "memory.h"
+
+/**
+ * The characters a container is skipped over by. Anything else, i.e. most of the text, is
+ * stepped over in a loop with a single table lookup per byte.
+ */
+static const unsigned char STRUCTURAL[256] = {
+    ['"'] = 1, ['['] = 1, [']'] = 1, ['{'] = 1, ['}'] = 1
+};
+
+/**
+ * State of a single pass over the JSON text of a rowset.
+ */
+typedef struct SF_JSON_ROWSET_PARSER {
+    // The text of the scanner, which the values are unescaped in
+    char *buf;
+    SF_JSON_SCANNER scanner;
+    SF_JSON_CELL *cells;
+    size_t cell_count;
+    size_t cell_capacity;
+} SF_JSON_ROWSET_PARSER;
+
+void STDCALL sf_json_skip_whitespace(SF_JSON_SCANNER *scanner) {
+    while (scanner->pos < scanner->len) {
+        char c = scanner->text[scanner->pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            break;
+        }
+        scanner->pos++;
+    }
+}
+
+char STDCALL sf_json_peek(SF_JSON_SCANNER *scanner) {
+    sf_json_skip_whitespace(scanner);
+    return scanner->pos < scanner->len ? scanner->text[scanner->pos] : '\0';
+}
+
+/**
+ * The quotes are found with memchr(), a quote being escaped if an odd number of backslashes is
+ * before it.
+ */
+sf_bool STDCALL sf_json_skip_string(SF_JSON_SCANNER *scanner) {
+    size_t start;
+    size_t quote;
+    size_t backslash;
+    const char *found;
+
+    if (sf_json_peek(scanner) != '"') {
+        return SF_BOOLEAN_FALSE;
+    }
+    start = ++scanner->pos;
+    while ((found = memchr(scanner->text + scanner->pos, '"', scanner->len - scanner->pos))) {
+        quote = (size_t) (found - scanner->text);
+        for (backslash = quote; backslash > start && scanner->text[backslash - 1] == '\\';
+             backslash--) {
+        }
+        scanner->pos = quote + 1;
+        if (((quote - backslash) & 1) == 0) {
+            return SF_BOOLEAN_TRUE;
+        }
+    }
+    return SF_BOOLEAN_FALSE;
+}
+
+void STDCALL sf_json_skip_scalar(SF_JSON_SCANNER *scanner) {
+    while (scanner->pos < scanner->len) {
+        char c = scanner->text[scanner->pos];
+        if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\n' || c == '\r' ||
+            c == '\t') {
+            break;
+        }
+        scanner->pos++;
+    }
+}
+
+sf_bool STDCALL sf_json_skip_value(SF_JSON_SCANNER *scanner) {
+    size_t depth = 0;
+    char c = sf_json_peek(scanner);
+
+    if (c == '"') {
+        return sf_json_skip_string(scanner);
+    }
+    if (c != '[' && c != '{') {
+        sf_json_skip_scalar(scanner);
+        return SF_BOOLEAN_TRUE;
+    }
+    while (scanner->pos < scanner->len) {
+        while (scanner->pos < scanner->len &&
+               !STRUCTURAL[(unsigned char) scanner->text[scanner->pos]]) {
+            scanner->pos++;
+        }
+        if (scanner->pos == scanner->len) {
+            break;
+        }
+        c = scanner->text[scanner->pos];
+        if (c == '"') {
+            if (!sf_json_skip_string(scanner)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            continue;
+        }
+        scanner->pos++;
+        if (c == '[' || c == '{') {
+            depth++;
+        } else if (--depth == 0) {
+            return SF_BOOLEAN_TRUE;
+        }
+    }
+    return SF_BOOLEAN_FALSE;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+sf_bool STDCALL sf_json_read_hex4(const char *text, size_t len, size_t pos, uint32 *value) {
+    int i;
+    int digit;
+
+    if (pos + 4 > len) {
+        return SF_BOOLEAN_FALSE;
+    }
+    *value = 0;
+    for (i = 0; i < 4; i++) {
+        if ((digit = hex_value(text[pos + i])) < 0) {
+            return SF_BOOLEAN_FALSE;
+        }
+        *value = (*value << 4) | (uint32) digit;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+size_t STDCALL sf_json_write_utf8(char *out, uint32 code_point) {
+    if (code_point < 0x80) {
+        out[0] = (char) code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (char) (0xC0 | (code_point >> 6));
+        out[1] = (char) (0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = (char) (0xE0 | (code_point >> 12));
+        out[1] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (char) (0xF0 | (code_point >> 18));
+    out[1] = (char) (0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (char) (0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+static SF_JSON_CELL *add_cell(SF_JSON_ROWSET_PARSER *parser) {
+    if (parser->cell_count == parser->cell_capacity) {
+        size_t capacity = parser->cell_capacity ? parser->cell_capacity * 2 : SF_JSON_ROWSET_INITIAL_CELLS;
+        SF_JSON_CELL *cells = (SF_JSON_CELL *) SF_TAG_REALLOC(SF_MEMORY_TAG_RESULT_SET, parser->cells,
+                                                              parser->cell_capacity * sizeof(SF_JSON_CELL),
+                                                              capacity * sizeof(SF_JSON_CELL));
+        if (!cells) {
+            return NULL;
+        }
+        parser->cells = cells;
+        parser->cell_capacity = capacity;
+    }
+    return &parser->cells[parser->cell_count++];
+}
+
+/**
+ * Parses a string starting at its opening quote. The unescaped value is written over the
+ * escaped one and terminated where the closing quote was, or before it.
+ */
+static sf_bool parse_string(SF_JSON_ROWSET_PARSER *parser, SF_JSON_CELL *cell) {
+    char *buf = parser->buf;
+    size_t start = parser->scanner.pos + 1;
+    size_t read = start;
+    size_t write;
+    uint32 code_point;
+    uint32 low;
+
+    // Most values have no escapes, so they are scanned without being moved
+    while (read < parser->scanner.len && buf[read] != '"' && buf[read] != '\\') {
+        read++;
+    }
+    write = read;
+
+    while (read < parser->scanner.len && buf[read] != '"') {
+        if (buf[read] != '\\') {
+            buf[write++] = buf[read++];
+            continue;
+        }
+        if (read + 1 >= parser->scanner.len) {
+            return SF_BOOLEAN_FALSE;
+        }
+        switch (buf[read + 1]) {
+            case '"':
+            case '\\':
+            case '/':
+                buf[write++] = buf[read + 1];
+                break;
+            case 'b':
+                buf[write++] = '\b';
+                break;
+            case 'f':
+                buf[write++] = '\f';
+                break;
+            case 'n':
+                buf[write++] = '\n';
+                break;
+            case 'r':
+                buf[write++] = '\r';
+                break;
+            case 't':
+                buf[write++] = '\t';
+                break;
+            case 'u':
+                if (!sf_json_read_hex4(buf, parser->scanner.len, read + 2, &code_point)) {
+                    return SF_BOOLEAN_FALSE;
+                }
+                if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    return SF_BOOLEAN_FALSE;
+                }
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // A high surrogate has to be followed by a low one
+                    if (read + 11 >= parser->scanner.len || buf[read + 6] != '\\' || buf[read + 7] != 'u' ||
+                        !sf_json_read_hex4(buf, parser->scanner.len, read + 8, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        return SF_BOOLEAN_FALSE;
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    read += 6;
+                }
+                write += sf_json_write_utf8(&buf[write], code_point);
+                read += 6;
+                continue;
+            default:
+                return SF_BOOLEAN_FALSE;
+        }
+        read += 2;
+    }
+    if (read >= parser->scanner.len) {
+        return SF_BOOLEAN_FALSE;
+    }
+
+    buf[write] = '\0';
+    cell->offset = start;
+    cell->len = write - start;
+    cell->is_null = SF_BOOLEAN_FALSE;
+    parser->scanner.pos = read + 1;
+    return SF_BOOLEAN_TRUE;
+}
+
+static sf_bool is_digit(char c) {
+    return c >= '0' && c <= '9' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Checks a number against the JSON grammar: an optional minus, an integer part without
+ * leading zeros, then an optional fraction and an optional exponent.
+ */
+static sf_bool is_number(const char *text, size_t len) {
+    size_t i = 0;
+
+    if (i < len && text[i] == '-') {
+        i++;
+    }
+    if (i < len && text[i] == '0') {
+        i++;
+    } else if (i < len && is_digit(text[i])) {
+        while (i < len && is_digit(text[i])) {
+            i++;
+        }
+    } else {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (i < len && text[i] == '.') {
+        if (++i >= len || !is_digit(text[i])) {
+            return SF_BOOLEAN_FALSE;
+        }
+        while (i < len && is_digit(text[i])) {
+            i++;
+        }
+    }
+    if (i < len && (text[i] == 'e' || text[i] == 'E')) {
+        if (++i < len && (text[i] == '+' || text[i] == '-')) {
+            i++;
+        }
+        if (i >= len || !is_digit(text[i])) {
+            return SF_BOOLEAN_FALSE;
+        }
+        while (i < len && is_digit(text[i])) {
+            i++;
+        }
+    }
+    return i == len ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Parses a number, true or false, which the server doesn't send but cJSON accepted. The value
+ * is moved one byte back, over the separator before it, to make room for its terminator.
+ */
+static sf_bool parse_literal(SF_JSON_ROWSET_PARSER *parser, SF_JSON_CELL *cell) {
+    char *buf = parser->buf;
+    size_t start = parser->scanner.pos;
+    size_t end = start;
+    char c;
+
+    while (end < parser->scanner.len) {
+        c = buf[end];
+        if (c == ',' || c == ']' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            break;
+        }
+        if (c == '"' || c == '[' || c == '{' || c == '}' || c == ':') {
+            return SF_BOOLEAN_FALSE;
+        }
+        end++;
+    }
+    if (end == start) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (!is_number(&buf[start], end - start) &&
+        !(end - start == 4 && strncmp(&buf[start], "true", 4) == 0) &&
+        !(end - start == 5 && strncmp(&buf[start], "false", 5) == 0)) {
+        return SF_BOOLEAN_FALSE;
+    }
+
+    memmove(&buf[start - 1], &buf[start], end - start);
+    buf[end - 1] = '\0';
+    cell->offset = start - 1;
+    cell->len = end - start;
+    cell->is_null = SF_BOOLEAN_FALSE;
+    parser->scanner.pos = end;
+    return SF_BOOLEAN_TRUE;
+}
+
+static sf_bool parse_cell(SF_JSON_ROWSET_PARSER *parser) {
+    SF_JSON_CELL *cell = add_cell(parser);
+    if (!cell) {
+        return SF_BOOLEAN_FALSE;
+    }
+
+    if (parser->buf[parser->scanner.pos] == '"') {
+        return parse_string(parser, cell);
+    }
+    if (parser->scanner.pos + 4 <= parser->scanner.len && strncmp(&parser->buf[parser->scanner.pos], "null", 4) == 0) {
+        cell->offset = 0;
+        cell->len = 0;
+        cell->is_null = SF_BOOLEAN_TRUE;
+        parser->scanner.pos += 4;
+        return SF_BOOLEAN_TRUE;
+    }
+    return parse_literal(parser, cell);
+}
+
+/**
+ * Parses a row starting at its opening bracket.
+ *
+ * @return the number of cells in the row, or -1 if it is malformed.
+ */
+static int64 parse_row(SF_JSON_ROWSET_PARSER *parser) {
+    size_t first_cell = parser->cell_count;
+    char c;
+
+    parser->scanner.pos++;
+    if (sf_json_peek(&parser->scanner) == ']') {
+        parser->scanner.pos++;
+        return 0;
+    }
+    while (1) {
+        if (sf_json_peek(&parser->scanner) == '\0' || !parse_cell(parser)) {
+            return -1;
+        }
+        c = sf_json_peek(&parser->scanner);
+        parser->scanner.pos++;
+        if (c == ']') {
+            return (int64) (parser->cell_count - first_cell);
+        }
+        if (c != ',') {
+            return -1;
+        }
+    }
+}
+
+static sf_bool parse_rows(SF_JSON_ROWSET_PARSER *parser, SF_JSON_ROWSET *rowset) {
+    int64 cell_count;
+    char c;
+
+    if (sf_json_peek(&parser->scanner) != '[') {
+        return SF_BOOLEAN_FALSE;
+    }
+    parser->scanner.pos++;
+    if (sf_json_peek(&parser->scanner) == ']') {
+        parser->scanner.pos++;
+        return sf_json_peek(&parser->scanner) == '\0';
+    }
+
+    while (1) {
+        if (sf_json_peek(&parser->scanner) != '[' || (cell_count = parse_row(parser)) < 0) {
+            return SF_BOOLEAN_FALSE;
+        }
+        if (rowset->row_count == 0) {
+            rowset->column_count = (size_t) cell_count;
+        } else if ((size_t) cell_count != rowset->column_count) {
+            log_error("Row %llu of the rowset has %lld columns instead of %llu",
+                      (unsigned long long) rowset->row_count, (long long) cell_count,
+                      (unsigned long long) rowset->column_count);
+            return SF_BOOLEAN_FALSE;
+        }
+        rowset->row_count++;
+
+        c = sf_json_peek(&parser->scanner);
+        parser->scanner.pos++;
+        if (c == ']') {
+            return sf_json_peek(&parser->scanner) == '\0';
+        }
+        if (c != ',') {
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+}
+
+SF_JSON_ROWSET *STDCALL sf_json_rowset_parse(char *buffer, size_t size, size_t capacity,
+                                              SF_MEMORY_TAG tag) {
+    SF_JSON_ROWSET_PARSER parser;
+    SF_JSON_ROWSET *rowset;
+
+    if (!buffer) {
+        return NULL;
+    }
+    rowset = (SF_JSON_ROWSET *) SF_CALLOC(1, sizeof(SF_JSON_ROWSET));
+    if (!rowset) {
+        SF_TAG_FREE(tag, buffer, capacity);
+        return NULL;
+    }
+
+    memset(&parser, 0, sizeof(parser));
+    parser.buf = buffer;
+    parser.scanner.text = buffer;
+    parser.scanner.len = size;
+    if (!parse_rows(&parser, rowset)) {
+        log_error("Unable to parse JSON rowset at offset %llu", (unsigned long long) parser.scanner.pos);
+        SF_TAG_FREE(SF_MEMORY_TAG_RESULT_SET, parser.cells,
+                    parser.cell_capacity * sizeof(SF_JSON_CELL));
+        SF_FREE(rowset);
+        SF_TAG_FREE(tag, buffer, capacity);
+        return NULL;
+    }
+
+    rowset->buffer = buffer;
+    rowset->buffer_capacity = capacity;
+    rowset->buffer_tag = tag;
+    rowset->cells = parser.cells;
+    rowset->cell_capacity = parser.cell_capacity;
+    return rowset;
+}
+
+SF_JSON_ROWSET *STDCALL sf_json_rowset_from_cjson(const cJSON *rows) {
+    SF_JSON_ROWSET *rowset = NULL;
+    const cJSON *row;
+    const cJSON *item;
+    char *printed;
+    const char *value;
+    size_t buffer_size = 0;
+    size_t buffer_capacity = 0;
+    size_t cell_index = 0;
+    size_t len;
+    int row_count;
+    int column_count;
+
+    if (!snowflake_cJSON_IsArray(rows)) {
+        return NULL;
+    }
+    row_count = snowflake_cJSON_GetArraySize(rows);
+    column_count = row_count > 0 ? snowflake_cJSON_GetArraySize(rows->child) : 0;
+
+    rowset = (SF_JSON_ROWSET *) SF_CALLOC(1, sizeof(SF_JSON_ROWSET));
+    if (!rowset) {
+        return NULL;
+    }
+    rowset->row_count = (size_t) row_count;
+    rowset->column_count = (size_t) column_count;
+    if (row_count == 0 || column_count == 0) {
+        return rowset;
+    }
+    rowset->cells = (SF_JSON_CELL *) SF_TAG_CALLOC(SF_MEMORY_TAG_RESULT_SET,
+                                                   (size_t) row_count * (size_t) column_count,
+                                                   sizeof(SF_JSON_CELL));
+    if (!rowset->cells) {
+        goto error;
+    }
+    rowset->cell_capacity = (size_t) row_count * (size_t) column_count;
+    rowset->buffer_tag = SF_MEMORY_TAG_RESULT_SET;
+
+    // Size the buffer for all strings up front, so that it's allocated once
+    for (row = rows->child; row; row = row->next) {
+        for (item = row->child; item; item = item->next) {
+            if (snowflake_cJSON_IsString(item)) {
+                buffer_capacity += strlen(item->valuestring) + 1;
+            }
+        }
+    }
+    if (buffer_capacity > 0 &&
+        (rowset->buffer = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_RESULT_SET, buffer_capacity)) == NULL) {
+        goto error;
+    }
+    rowset->buffer_capacity = buffer_capacity;
+
+    for (row = rows->child; row; row = row->next) {
+        if (!snowflake_cJSON_IsArray(row) || snowflake_cJSON_GetArraySize(row) != column_count) {
+            log_error("Row %llu of the rowset is not an array of %d columns",
+                      (unsigned long long) (cell_index / (size_t) column_count), column_count);
+            goto error;
+        }
+        for (item = row->child; item; item = item->next, cell_index++) {
+            SF_JSON_CELL *cell = &rowset->cells[cell_index];
+            if (snowflake_cJSON_IsNull(item)) {
+                cell->is_null = SF_BOOLEAN_TRUE;
+                continue;
+            }
+
+            printed = NULL;
+            if (snowflake_cJSON_IsString(item)) {
+                value = item->valuestring;
+            } else if ((printed = snowflake_cJSON_PrintUnformatted(item)) != NULL) {
+                value = printed;
+            } else {
+                goto error;
+            }
+
+            len = strlen(value);
+            // Only values that had to be printed don't fit
+            if (buffer_size + len + 1 > buffer_capacity) {
+                char *buffer;
+                buffer_capacity = (buffer_size + len + 1) * 2;
+                buffer = (char *) SF_TAG_REALLOC(SF_MEMORY_TAG_RESULT_SET, rowset->buffer,
+                                                 rowset->buffer_capacity, buffer_capacity);
+                if (!buffer) {
+                    if (printed) {
+                        snowflake_cJSON_free(printed);
+                    }
+                    goto error;
+                }
+                rowset->buffer = buffer;
+                rowset->buffer_capacity = buffer_capacity;
+            }
+            memcpy(&rowset->buffer[buffer_size], value, len + 1);
+            cell->offset = buffer_size;
+            cell->len = len;
+            cell->is_null = SF_BOOLEAN_FALSE;
+            buffer_size += len + 1;
+            if (printed) {
+                snowflake_cJSON_free(printed);
+            }
+        }
+    }
+    return rowset;
+
+error:
+    sf_json_rowset_free(rowset);
+    return NULL;
+}
+
+SF_JSON_ROWSET *STDCALL sf_json_rowset_alloc(size_t row_count, size_t column_count,
+                                              size_t buffer_size) {
+    SF_JSON_ROWSET *rowset = (SF_JSON_ROWSET *) SF_CALLOC(1, sizeof(SF_JSON_ROWSET));
+    if (!rowset) {
+        return NULL;
+    }
+    rowset->row_count = row_count;
+    rowset->column_count = column_count;
+    rowset->buffer_tag = SF_MEMORY_TAG_RESULT_SET;
+    if (row_count > 0 && column_count > 0) {
+        rowset->cells = (SF_JSON_CELL *) SF_TAG_CALLOC(SF_MEMORY_TAG_RESULT_SET,
+                                                       row_count * column_count,
+                                                       sizeof(SF_JSON_CELL));
+        if (!rowset->cells) {
+            goto error;
+        }
+        rowset->cell_capacity = row_count * column_count;
+    }
+    if (buffer_size > 0) {
+        rowset->buffer = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_RESULT_SET, buffer_size);
+        if (!rowset->buffer) {
+            goto error;
+        }
+        rowset->buffer_capacity = buffer_size;
+    }
+    return rowset;
+
+error:
+    sf_json_rowset_free(rowset);
+    return NULL;
+}
+
+void STDCALL sf_json_rowset_free(SF_JSON_ROWSET *rowset) {
+    if (!rowset) {
+        return;
+    }
+    if (rowset->columnar && rowset->columnar_free) {
+        rowset->columnar_free(rowset->columnar);
+    }
+    SF_TAG_FREE(rowset->buffer_tag, rowset->buffer, rowset->buffer_capacity);
+    SF_TAG_FREE(SF_MEMORY_TAG_RESULT_SET, rowset->cells,
+                rowset->cell_capacity * sizeof(SF_JSON_CELL));
+    SF_FREE(rowset);
+}
+
+/**
+ * Reads the key of an object member and the colon after it.
+ */
+static sf_bool read_key(SF_JSON_ROWSET_PARSER *parser, size_t *start, size_t *len) {
+    sf_json_skip_whitespace(&parser->scanner);
+    *start = parser->scanner.pos + 1;
+    if (!sf_json_skip_string(&parser->scanner) || sf_json_peek(&parser->scanner) != ':') {
+        return SF_BOOLEAN_FALSE;
+    }
+    *len = parser->scanner.pos - 1 - *start;
+    parser->scanner.pos++;
+    return SF_BOOLEAN_TRUE;
+}
+
+static sf_bool key_is(SF_JSON_ROWSET_PARSER *parser, size_t start, size_t len, const char *name) {
+    return len == strlen(name) && memcmp(parser->buf + start, name, len) == 0;
+}
+
+/**
+ * Moves past the separator after a member, or the end of the object.
+ *
+ * @return SF_BOOLEAN_FALSE at the end of the object or on a syntax error.
+ */
+static sf_bool next_member(SF_JSON_ROWSET_PARSER *parser) {
+    char c = sf_json_peek(&parser->scanner);
+    parser->scanner.pos++;
+    return c == ',' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Finds the value of data.rowset, or data.rowsetBase64, in a query response.
+ */
+static sf_bool find_rowset(SF_JSON_ROWSET_PARSER *parser, size_t *start, size_t *end) {
+    size_t key;
+    size_t key_len;
+
+    if (sf_json_peek(&parser->scanner) != '{') {
+        return SF_BOOLEAN_FALSE;
+    }
+    parser->scanner.pos++;
+    if (sf_json_peek(&parser->scanner) == '}') {
+        return SF_BOOLEAN_FALSE;
+    }
+    do {
+        if (!read_key(parser, &key, &key_len)) {
+            return SF_BOOLEAN_FALSE;
+        }
+        if (!key_is(parser, key, key_len, "data") || sf_json_peek(&parser->scanner) != '{') {
+            if (!sf_json_skip_value(&parser->scanner)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            continue;
+        }
+        parser->scanner.pos++;
+        if (sf_json_peek(&parser->scanner) == '}') {
+            parser->scanner.pos++;
+            continue;
+        }
+        do {
+            if (!read_key(parser, &key, &key_len)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            sf_json_skip_whitespace(&parser->scanner);
+            *start = parser->scanner.pos;
+            if (!sf_json_skip_value(&parser->scanner)) {
+                return SF_BOOLEAN_FALSE;
+            }
+            if (key_is(parser, key, key_len, "rowset") ||
+                key_is(parser, key, key_len, "rowsetBase64")) {
+                *end = parser->scanner.pos;
+                return SF_BOOLEAN_TRUE;
+            }
+        } while (next_member(parser));
+    } while (next_member(parser));
+    return SF_BOOLEAN_FALSE;
+}
+
+cJSON *STDCALL sf_json_parse_without_rowset(const char *text, size_t size) {
+    SF_JSON_ROWSET_PARSER parser;
+    size_t start;
+    size_t end;
+    char *trimmed;
+    cJSON *json;
+
+    memset(&parser, 0, sizeof(parser));
+    parser.buf = (char *) text;
+    parser.scanner.text = text;
+    parser.scanner.len = size;
+    if (!find_rowset(&parser, &start, &end)) {
+        return snowflake_cJSON_Parse(text);
+    }
+
+    // Only the text around the rows is copied, the rows being most of a response
+    trimmed = (char *) SF_MALLOC(size - (end - start) + sizeof("null"));
+    if (!trimmed) {
+        return NULL;
+    }
+    memcpy(trimmed, text, start);
+    memcpy(trimmed + start, "null", 4);
+    memcpy(trimmed + start + 4, text + end, size - end);
+    trimmed[size - (end - start) + 4] = '\0';
+    json = snowflake_cJSON_Parse(trimmed);
+    SF_FREE(trimmed);
+    return json;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_JSON_ROWSET_H
+#define SNOWFLAKE_JSON_ROWSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+#include "cJSON.h"
+#include "memory.h"
+
+// Number of cells the cell array of a rowset starts with
+#define SF_JSON_ROWSET_INITIAL_CELLS 1024
+
+/**
+ * A cell of a JSON rowset. The value is a NUL-terminated string in the buffer of the rowset.
+ */
+typedef struct SF_JSON_CELL {
+    size_t offset;
+    size_t len;
+    sf_bool is_null;
+} SF_JSON_CELL;
+
+/**
+ * The rows of a JSON result chunk, i.e. an array of arrays of strings or nulls. All values live
+ * in one buffer and all cells in one array, so a chunk costs two allocations however many cells
+ * it has.
+ */
+typedef struct SF_JSON_ROWSET {
+    char *buffer;
+    // Allocated size and tag of the buffer
+    size_t buffer_capacity;
+    SF_MEMORY_TAG buffer_tag;
+    // The cells of all rows, row after row, allocated with SF_MEMORY_TAG_RESULT_SET
+    SF_JSON_CELL *cells;
+    size_t cell_capacity;
+    size_t row_count;
+    size_t column_count;
+    // The rows decoded into columns along with the parse, e.g. an Arrow record batch, and the
+    // function freeing them with the rowset. NULL if they weren't.
+    void *columnar;
+    void (*columnar_free)(void *columnar);
+} SF_JSON_ROWSET;
+
+/**
+ * Parses a JSON rowset in a single pass. The values are unescaped in place, so the rowset takes
+ * over the buffer.
+ *
+ * @param buffer the JSON text, allocated with SF_TAG_MALLOC. It is owned by the rowset
+ *        afterwards, or freed if the text can't be parsed.
+ * @param size the length of the JSON text.
+ * @param capacity the allocated size of the buffer.
+ * @param tag the tag the buffer is allocated with.
+ *
+ * @return the rowset, or NULL if the text is not an array of arrays of strings or nulls, or
+ *         if its rows differ in length.
+ */
+SF_JSON_ROWSET *STDCALL sf_json_rowset_parse(char *buffer, size_t size, size_t capacity,
+                                              SF_MEMORY_TAG tag);
+
+/**
+ * Copies a rowset that has already been parsed into a cJSON tree, e.g. the first rowset of a
+ * query response.
+ *
+ * @param rows a cJSON array of rows. It is not modified.
+ *
+ * @return the rowset, or NULL if rows is not an array of arrays or if its rows differ in length.
+ */
+SF_JSON_ROWSET *STDCALL sf_json_rowset_from_cjson(const cJSON *rows);
+
+/**
+ * Allocates a rowset of row_count rows of column_count cells, zeroed, with a buffer of
+ * buffer_size bytes for their values, for the caller to fill in.
+ *
+ * @return the rowset, or NULL if out of memory.
+ */
+SF_JSON_ROWSET *STDCALL sf_json_rowset_alloc(size_t row_count, size_t column_count,
+                                              size_t buffer_size);
+
+void STDCALL sf_json_rowset_free(SF_JSON_ROWSET *rowset);
+
+/**
+ * Parses a query response, the rows of which are skipped over rather than parsed: the value
+ * of data.rowset, or data.rowsetBase64, is null in the tree.
+ *
+ * @param text the NUL-terminated JSON text. It is not modified.
+ * @param size the length of the text.
+ *
+ * @return the tree, or NULL if the text can't be parsed.
+ */
+cJSON *STDCALL sf_json_parse_without_rowset(const char *text, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_JSON_ROWSET_H
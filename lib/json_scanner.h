@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_JSON_SCANNER_H
+#define SNOWFLAKE_JSON_SCANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Position in a JSON text being scanned without building a tree of it, shared by the rowset
+ * parser and the path lookup.
+ */
+typedef struct SF_JSON_SCANNER {
+    const char *text;
+    size_t pos;
+    size_t len;
+} SF_JSON_SCANNER;
+
+/**
+ * Skips whitespace.
+ */
+void STDCALL sf_json_skip_whitespace(SF_JSON_SCANNER *scanner);
+
+/**
+ * Skips whitespace and returns the next character, or '\0' at the end of the text.
+ */
+char STDCALL sf_json_peek(SF_JSON_SCANNER *scanner);
+
+/**
+ * Skips over a string, from its opening quote to after its closing one.
+ *
+ * @return SF_BOOLEAN_FALSE if the scanner isn't at a string or the string isn't closed.
+ */
+sf_bool STDCALL sf_json_skip_string(SF_JSON_SCANNER *scanner);
+
+/**
+ * Skips over a number or a literal, up to the separator after it.
+ */
+void STDCALL sf_json_skip_scalar(SF_JSON_SCANNER *scanner);
+
+/**
+ * Skips over a value without looking into it, the nesting of arrays and objects only being
+ * counted.
+ *
+ * @return SF_BOOLEAN_FALSE if a string or a container isn't closed.
+ */
+sf_bool STDCALL sf_json_skip_value(SF_JSON_SCANNER *scanner);
+
+/**
+ * Reads the four hex digits of a \u escape at the given position of a text.
+ *
+ * @return SF_BOOLEAN_FALSE if they aren't hex digits or the text ends before them.
+ */
+sf_bool STDCALL sf_json_read_hex4(const char *text, size_t len, size_t pos, uint32 *value);
+
+/**
+ * Writes a code point as UTF-8 and returns the number of bytes written. The escape sequence of
+ * the code point is always longer, so it can be written over it.
+ */
+size_t STDCALL sf_json_write_utf8(char *out, uint32 code_point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_JSON_SCANNER_H
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "json_writer.h"
+#include "memory.h"
+
+/**
+ * Makes room for len more bytes and the terminator.
+ */
+static sf_bool reserve(SF_JSON_WRITER *writer, size_t len) {
+    size_t capacity;
+    char *buffer;
+
+    if (writer->oom) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (writer->len + len + 1 <= writer->capacity) {
+        return SF_BOOLEAN_TRUE;
+    }
+
+    capacity = writer->capacity > 0 ? writer->capacity : SF_JSON_WRITER_INITIAL_SIZE;
+    while (capacity < writer->len + len + 1) {
+        capacity *= 2;
+    }
+    if (writer->budget && capacity > writer->charged) {
+        if (!sf_memory_budget_reserve(writer->budget, capacity - writer->charged)) {
+            writer->oom = SF_BOOLEAN_TRUE;
+            writer->over_budget = SF_BOOLEAN_TRUE;
+            return SF_BOOLEAN_FALSE;
+        }
+        writer->charged = capacity;
+    }
+    buffer = (char *) SF_REALLOC(writer->buffer, capacity);
+    if (!buffer) {
+        writer->oom = SF_BOOLEAN_TRUE;
+        return SF_BOOLEAN_FALSE;
+    }
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    return SF_BOOLEAN_TRUE;
+}
+
+static void append(SF_JSON_WRITER *writer, const char *text, size_t len) {
+    if (!reserve(writer, len)) {
+        return;
+    }
+    memcpy(writer->buffer + writer->len, text, len);
+    writer->len += len;
+    writer->buffer[writer->len] = '\0';
+}
+
+static void separate(SF_JSON_WRITER *writer) {
+    if (writer->need_comma) {
+        append(writer, ",", 1);
+    }
+}
+
+static void append_quoted(SF_JSON_WRITER *writer, const char *value, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = value;
+    const char *end = value + len;
+    const char *p;
+    char escape[6];
+
+    append(writer, "\"", 1);
+    for (p = value; p < end; p++) {
+        unsigned char c = (unsigned char) *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the plain characters before the one to escape in one go
+        append(writer, run, (size_t) (p - run));
+        run = p + 1;
+        escape[0] = '\\';
+        switch (c) {
+            case '"':
+            case '\\':
+                escape[1] = (char) c;
+                break;
+            case '\b':
+                escape[1] = 'b';
+                break;
+            case '\f':
+                escape[1] = 'f';
+                break;
+            case '\n':
+                escape[1] = 'n';
+                break;
+            case '\r':
+                escape[1] = 'r';
+                break;
+            case '\t':
+                escape[1] = 't';
+                break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[c >> 4];
+                escape[5] = hex[c & 0xf];
+                append(writer, escape, 6);
+                continue;
+        }
+        append(writer, escape, 2);
+    }
+    append(writer, run, (size_t) (p - run));
+    append(writer, "\"", 1);
+}
+
+void STDCALL sf_json_writer_init(SF_JSON_WRITER *writer, size_t initial_size) {
+    writer->buffer = NULL;
+    writer->len = 0;
+    writer->capacity = 0;
+    writer->oom = SF_BOOLEAN_FALSE;
+    writer->budget = NULL;
+    writer->charged = 0;
+    writer->over_budget = SF_BOOLEAN_FALSE;
+    writer->need_comma = SF_BOOLEAN_FALSE;
+    reserve(writer, initial_size > 0 ? initial_size - 1 : 0);
+}
+
+void STDCALL sf_json_writer_free(SF_JSON_WRITER *writer) {
+    SF_FREE(writer->buffer);
+    sf_memory_budget_release(writer->budget, writer->charged);
+    writer->charged = 0;
+    writer->len = 0;
+    writer->capacity = 0;
+    writer->need_comma = SF_BOOLEAN_FALSE;
+}
+
+char *STDCALL sf_json_writer_finish(SF_JSON_WRITER *writer) {
+    char *text = writer->buffer;
+
+    if (writer->oom) {
+        sf_json_writer_free(writer);
+        return NULL;
+    }
+    writer->buffer = NULL;
+    writer->len = 0;
+    writer->capacity = 0;
+    writer->need_comma = SF_BOOLEAN_FALSE;
+    // The text is the caller's now
+    sf_memory_budget_release(writer->budget, writer->charged);
+    writer->charged = 0;
+    return text;
+}
+
+void STDCALL sf_json_writer_begin_object(SF_JSON_WRITER *writer) {
+    separate(writer);
+    append(writer, "{", 1);
+    writer->need_comma = SF_BOOLEAN_FALSE;
+}
+
+void STDCALL sf_json_writer_end_object(SF_JSON_WRITER *writer) {
+    append(writer, "}", 1);
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+void STDCALL sf_json_writer_begin_array(SF_JSON_WRITER *writer) {
+    separate(writer);
+    append(writer, "[", 1);
+    writer->need_comma = SF_BOOLEAN_FALSE;
+}
+
+void STDCALL sf_json_writer_end_array(SF_JSON_WRITER *writer) {
+    append(writer, "]", 1);
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+void STDCALL sf_json_writer_key(SF_JSON_WRITER *writer, const char *key) {
+    separate(writer);
+    append_quoted(writer, key, strlen(key));
+    append(writer, ":", 1);
+    writer->need_comma = SF_BOOLEAN_FALSE;
+}
+
+void STDCALL sf_json_writer_string(SF_JSON_WRITER *writer, const char *value) {
+    separate(writer);
+    if (value) {
+        append_quoted(writer, value, strlen(value));
+    } else {
+        append(writer, "null", 4);
+    }
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+void STDCALL sf_json_writer_string_len(SF_JSON_WRITER *writer, const char *value, size_t len) {
+    separate(writer);
+    append_quoted(writer, value, len);
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+// Room for the digits and sign of any 64 bit integer and two quotes
+#define SF_JSON_WRITER_INT_SIZE 24
+
+/**
+ * Writes the digits of an integer backwards from the end of a buffer.
+ *
+ * @return the first character.
+ */
+static char *format_int(char *end, uint64 magnitude, sf_bool negative) {
+    char *p = end;
+    do {
+        *--p = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (negative) {
+        *--p = '-';
+    }
+    return p;
+}
+
+static uint64 int_magnitude(int64 value) {
+    return value < 0 ? (uint64) 0 - (uint64) value : (uint64) value;
+}
+
+void STDCALL sf_json_writer_int(SF_JSON_WRITER *writer, int64 value) {
+    char digits[SF_JSON_WRITER_INT_SIZE];
+    char *p = format_int(digits + sizeof(digits), int_magnitude(value), value < 0);
+
+    separate(writer);
+    append(writer, p, (size_t) (digits + sizeof(digits) - p));
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Writes the digits of an integer in quotes. Digits never need escaping.
+ */
+static void write_int_string(SF_JSON_WRITER *writer, uint64 magnitude, sf_bool negative) {
+    char digits[SF_JSON_WRITER_INT_SIZE];
+    char *end = digits + sizeof(digits);
+    char *p;
+
+    *--end = '"';
+    p = format_int(end, magnitude, negative);
+    *--p = '"';
+
+    separate(writer);
+    append(writer, p, (size_t) (digits + sizeof(digits) - p));
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
+
+void STDCALL sf_json_writer_int_string(SF_JSON_WRITER *writer, int64 value) {
+    write_int_string(writer, int_magnitude(value), value < 0);
+}
+
+void STDCALL sf_json_writer_uint_string(SF_JSON_WRITER *writer, uint64 value) {
+    write_int_string(writer, value, SF_BOOLEAN_FALSE);
+}
+
+void STDCALL sf_json_writer_bool(SF_JSON_WRITER *writer, sf_bool value) {
+    separate(writer);
+    if (value) {
+        append(writer, "true", 4);
+    } else {
+        append(writer, "false", 5);
+    }
+    writer->need_comma = SF_BOOLEAN_TRUE;
+}
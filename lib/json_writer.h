@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_JSON_WRITER_H
+#define SNOWFLAKE_JSON_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// Size of the buffer a writer starts with
+#define SF_JSON_WRITER_INITIAL_SIZE 1024
+
+/**
+ * Writes compact JSON text into one growable buffer, without building a tree first. The
+ * caller is responsible for the structure, the writer only formats values and keeps track of
+ * whether a comma is due.
+ */
+typedef struct SF_JSON_WRITER {
+    char *buffer;
+    size_t len;
+    size_t capacity;
+    // Set once an allocation failed, all later writes are ignored
+    sf_bool oom;
+    // Budget the buffer is charged to, NULL for none, set by the caller after
+    // sf_json_writer_init(). over_budget is set with oom once it refused the buffer to grow.
+    SF_MEMORY_BUDGET *budget;
+    size_t charged;
+    sf_bool over_budget;
+    // Set after a value, so that the next key or element is preceded by a comma
+    sf_bool need_comma;
+} SF_JSON_WRITER;
+
+void STDCALL sf_json_writer_init(SF_JSON_WRITER *writer, size_t initial_size);
+
+/**
+ * Frees the text of the writer, unless it has been taken with sf_json_writer_finish().
+ */
+void STDCALL sf_json_writer_free(SF_JSON_WRITER *writer);
+
+/**
+ * Returns the NUL-terminated text, which the caller frees with SF_FREE, and resets the writer.
+ *
+ * @return the text, or NULL if the writer ran out of memory.
+ */
+char *STDCALL sf_json_writer_finish(SF_JSON_WRITER *writer);
+
+void STDCALL sf_json_writer_begin_object(SF_JSON_WRITER *writer);
+
+void STDCALL sf_json_writer_end_object(SF_JSON_WRITER *writer);
+
+void STDCALL sf_json_writer_begin_array(SF_JSON_WRITER *writer);
+
+void STDCALL sf_json_writer_end_array(SF_JSON_WRITER *writer);
+
+/**
+ * Writes the key of the next member of an object.
+ */
+void STDCALL sf_json_writer_key(SF_JSON_WRITER *writer, const char *key);
+
+/**
+ * Writes a string value, escaped as JSON requires. A NULL string is written as null.
+ */
+void STDCALL sf_json_writer_string(SF_JSON_WRITER *writer, const char *value);
+
+/**
+ * Writes the first len bytes of a string as a string value, for text that isn't
+ * NUL-terminated.
+ */
+void STDCALL sf_json_writer_string_len(SF_JSON_WRITER *writer, const char *value, size_t len);
+
+void STDCALL sf_json_writer_int(SF_JSON_WRITER *writer, int64 value);
+
+/**
+ * Writes the decimal digits of an integer as a string value, e.g. for bound values, which are
+ * all sent as text.
+ */
+void STDCALL sf_json_writer_int_string(SF_JSON_WRITER *writer, int64 value);
+
+void STDCALL sf_json_writer_uint_string(SF_JSON_WRITER *writer, uint64 value);
+
+void STDCALL sf_json_writer_bool(SF_JSON_WRITER *writer, sf_bool value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_JSON_WRITER_H
@@ -33,11 +33,12 @@ static struct {
     void *udata;
     log_LockFn lock;
     FILE *fp;
-    int level;
     int quiet;
     const char *path;
 } L;
 
+volatile int sf_log_min_level = SF_LOG_TRACE;
+
 
 static const char *level_names[] = {
     "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
@@ -80,11 +81,11 @@ void log_set_fp(FILE *fp) {
 
 int log_get_level()
 {
-    return L.level;
+    return sf_log_min_level;
 }
 
 void log_set_level(int level) {
-    L.level = level;
+    sf_log_min_level = level;
 }
 
 
@@ -102,21 +103,11 @@ void log_log(int level, const char *file, int line, const char *ns,
 }
 
 
-void
-log_log_va_list(int level, const char *file, int line, const char *ns,
-                const char *fmt, va_list args) {
-    if (level < L.level) {
-        return;
-    }
-
-    char tsbuf[50];    /* timestamp buffer*/
-    sf_log_timestamp(tsbuf, sizeof(tsbuf));
-
-    char *basename = sf_filename_from_path(file);
-
-    /* Acquire lock */
-    lock();
-
+/**
+ * Writes a message to stderr and the log file. The caller holds the lock.
+ */
+static void write_va_list(int level, const char *basename, int line, const char *ns,
+                          const char *tsbuf, int flush, const char *fmt, va_list args) {
     /* Log to stderr */
     if (!L.quiet) {
 #ifdef LOG_USE_COLOR
@@ -127,7 +118,7 @@ log_log_va_list(int level, const char *file, int line, const char *ns,
 #else
         fprintf(
             stderr, SF_LOG_TIMESTAMP_FORMAT,
-             buf, level_names[level], namespace, basename, line);
+            tsbuf, level_names[level], ns, basename, line);
 #endif
         // va_list can only be consumed once. Make a copy here in case both
         // console and file logging are turned on.
@@ -136,7 +127,9 @@ log_log_va_list(int level, const char *file, int line, const char *ns,
         log_masked_va_list(stderr, fmt, copy);
         va_end(copy);
         fprintf(stderr, "\n");
-        fflush(stderr);
+        if (flush) {
+            fflush(stderr);
+        }
     }
 
     /* Log to file */
@@ -161,9 +154,269 @@ log_log_va_list(int level, const char *file, int line, const char *ns,
             tsbuf, level_names[level], ns, basename, line);
         log_masked_va_list(L.fp, fmt, args);
         fprintf(L.fp, "\n");
+        if (flush) {
+            fflush(L.fp);
+        }
+    }
+}
+
+static void write_message(int level, const char *basename, int line, const char *ns,
+                          const char *tsbuf, int flush, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    write_va_list(level, basename, line, ns, tsbuf, flush, fmt, args);
+    va_end(args);
+}
+
+static void flush_outputs(void) {
+    if (!L.quiet) {
+        fflush(stderr);
+    }
+    if (L.fp) {
         fflush(L.fp);
     }
+}
+
+/*
+ * Asynchronous logging. Callers format their message into the next record of a ring and
+ * return; a writer thread masks and writes the records in batches and flushes on an
+ * interval. The ring is a bounded multi producer queue: a record is free for position pos
+ * when its sequence is pos, and written for the writer when it is pos + 1.
+ */
+#define LOG_ASYNC_INLINE_SIZE 512
+#define LOG_ASYNC_NS_SIZE 16
+
+typedef struct log_record {
+    volatile unsigned long long sequence;
+    int level;
+    int line;
+    // Points into __FILE__ of the caller
+    const char *basename;
+    char ns[LOG_ASYNC_NS_SIZE];
+    char tsbuf[50];
+    // Either inline_text or allocated for longer messages
+    char *text;
+    char inline_text[LOG_ASYNC_INLINE_SIZE];
+} log_record;
+
+static struct {
+    log_record *records;
+    unsigned long long capacity;
+    // Next position to claim, and the next one the writer takes
+    volatile unsigned long long tail;
+    volatile unsigned long long head;
+    // Messages dropped while the ring was full, reported by the writer
+    volatile unsigned long long dropped;
+    // Set while callers may enqueue, and the number of callers doing so
+    volatile unsigned long long enabled;
+    volatile unsigned long long producers;
+    volatile unsigned long long running;
+    unsigned int flush_interval_ms;
+    SF_THREAD_HANDLE thread;
+    SF_CRITICAL_SECTION_HANDLE wake_lock;
+    SF_CONDITION_HANDLE wake_cond;
+} A;
+
+/**
+ * @return 0 if the message was queued, -1 if the ring is full.
+ */
+static int enqueue(int level, const char *basename, int line, const char *ns,
+                   const char *tsbuf, const char *fmt, va_list args) {
+    unsigned long long mask = A.capacity - 1;
+    unsigned long long pos = sf_atomic_load(&A.tail);
+    log_record *record;
+    va_list copy;
+    int len;
+
+    while (1) {
+        record = &A.records[pos & mask];
+        long long diff = (long long) (sf_atomic_load(&record->sequence) - pos);
+        if (diff == 0) {
+            if (sf_atomic_compare_exchange(&A.tail, pos, pos + 1)) {
+                break;
+            }
+            pos = sf_atomic_load(&A.tail);
+        } else if (diff < 0) {
+            // The writer hasn't taken the record written a lap ago
+            return -1;
+        } else {
+            pos = sf_atomic_load(&A.tail);
+        }
+    }
+
+    record->level = level;
+    record->line = line;
+    record->basename = basename;
+    sb_strncpy(record->ns, sizeof(record->ns), ns, sizeof(record->ns) - 1);
+    sb_strncpy(record->tsbuf, sizeof(record->tsbuf), tsbuf, sizeof(record->tsbuf) - 1);
+    record->text = record->inline_text;
+    va_copy(copy, args);
+    len = vsnprintf(record->inline_text, sizeof(record->inline_text), fmt, copy);
+    va_end(copy);
+    if (len >= (int) sizeof(record->inline_text)) {
+        char *text = (char *) malloc((size_t) len + 1);
+        if (text) {
+            vsnprintf(text, (size_t) len + 1, fmt, args);
+            record->text = text;
+        }
+    } else if (len < 0) {
+        record->inline_text[0] = '\0';
+    }
+
+    sf_atomic_store(&record->sequence, pos + 1);
+    // Wake the writer early once the ring is half full rather than waiting for the interval
+    if (pos - sf_atomic_load(&A.head) == A.capacity / 2) {
+        _cond_signal(&A.wake_cond);
+    }
+    return 0;
+}
+
+/**
+ * Writes the queued records.
+ *
+ * @return the number of records written.
+ */
+static unsigned long long drain(void) {
+    unsigned long long written = 0;
+    unsigned long long dropped;
+    unsigned long long head = A.head;
+    log_record *record;
+
+    lock();
+    while (1) {
+        record = &A.records[head & (A.capacity - 1)];
+        if (sf_atomic_load(&record->sequence) != head + 1) {
+            break;
+        }
+        write_message(record->level, record->basename, record->line, record->ns,
+                      record->tsbuf, 0, "%s", record->text);
+        if (record->text != record->inline_text) {
+            free(record->text);
+        }
+        sf_atomic_store(&record->sequence, head + A.capacity);
+        sf_atomic_store(&A.head, ++head);
+        written++;
+    }
+    if ((dropped = sf_atomic_load(&A.dropped)) > 0) {
+        sf_atomic_fetch_sub(&A.dropped, dropped);
+        char tsbuf[50];
+        sf_log_timestamp(tsbuf, sizeof(tsbuf));
+        write_message(SF_LOG_WARN, sf_filename_from_path(__FILE__), __LINE__, "C", tsbuf, 0,
+                      "%llu log messages were dropped while the log queue was full", dropped);
+        written++;
+    }
+    if (written > 0) {
+        flush_outputs();
+    }
+    unlock();
+    return written;
+}
+
+static void *writer_thread(void *unused) {
+    while (sf_atomic_load(&A.running)) {
+        if (drain() == 0) {
+            _critical_section_lock(&A.wake_lock);
+            _cond_timed_wait(&A.wake_cond, &A.wake_lock, A.flush_interval_ms);
+            _critical_section_unlock(&A.wake_lock);
+        }
+    }
+    // Whatever the callers queued before logging went back to synchronous
+    drain();
+    return NULL;
+}
+
+int log_start_async(size_t capacity, unsigned int flush_interval_ms) {
+    unsigned long long i;
+
+    if (sf_atomic_load(&A.enabled)) {
+        return 0;
+    }
+    // A power of two, so that positions map to records with a mask
+    A.capacity = 2;
+    while (A.capacity < capacity) {
+        A.capacity <<= 1;
+    }
+    A.records = (log_record *) calloc((size_t) A.capacity, sizeof(log_record));
+    if (!A.records) {
+        return -1;
+    }
+    for (i = 0; i < A.capacity; i++) {
+        A.records[i].sequence = i;
+    }
+    A.tail = 0;
+    A.head = 0;
+    A.dropped = 0;
+    A.flush_interval_ms = flush_interval_ms > 0 ? flush_interval_ms : 1;
+    _critical_section_init(&A.wake_lock);
+    _cond_init(&A.wake_cond);
+    sf_atomic_store(&A.running, 1);
+    if (_thread_init(&A.thread, writer_thread, NULL) != 0) {
+        _cond_term(&A.wake_cond);
+        _critical_section_term(&A.wake_lock);
+        free(A.records);
+        A.records = NULL;
+        return -1;
+    }
+    sf_atomic_store(&A.enabled, 1);
+    return 0;
+}
+
+void log_stop_async(void) {
+    if (!sf_atomic_load(&A.enabled)) {
+        return;
+    }
+    // New messages are written by their callers again; wait for the ones being queued
+    sf_atomic_store(&A.enabled, 0);
+    while (sf_atomic_load(&A.producers) > 0) {
+        sf_sleep_ms(1);
+    }
+    sf_atomic_store(&A.running, 0);
+    _critical_section_lock(&A.wake_lock);
+    _cond_signal(&A.wake_cond);
+    _critical_section_unlock(&A.wake_lock);
+    _thread_join(A.thread);
+    _cond_term(&A.wake_cond);
+    _critical_section_term(&A.wake_lock);
+    free(A.records);
+    A.records = NULL;
+}
 
+int log_is_async(void) {
+    return sf_atomic_load(&A.enabled) ? 1 : 0;
+}
+
+void
+log_log_va_list(int level, const char *file, int line, const char *ns,
+                const char *fmt, va_list args) {
+    if (!SF_LOG_ENABLED(level)) {
+        return;
+    }
+
+    char tsbuf[50];    /* timestamp buffer*/
+    sf_log_timestamp(tsbuf, sizeof(tsbuf));
+
+    char *basename = sf_filename_from_path(file);
+
+    if (sf_atomic_load(&A.enabled)) {
+        int queued = -1;
+        sf_atomic_fetch_add(&A.producers, 1);
+        if (sf_atomic_load(&A.enabled)) {
+            queued = enqueue(level, basename, line, ns, tsbuf, fmt, args);
+        }
+        sf_atomic_fetch_sub(&A.producers, 1);
+        if (queued == 0) {
+            return;
+        }
+        // With the ring full, warnings and errors are still written right away
+        if (queued < 0 && sf_atomic_load(&A.enabled) && level < SF_LOG_WARN) {
+            sf_atomic_fetch_add(&A.dropped, 1);
+            return;
+        }
+    }
+
+    /* Acquire lock */
+    lock();
+    write_va_list(level, basename, line, ns, tsbuf, 1, fmt, args);
     /* Release lock */
     unlock();
 }
@@ -187,6 +440,9 @@ void log_set_path(const char *path) {
 }
 
 void log_close() {
+    // The writer thread writes the queued messages to the file first
+    log_stop_async();
+
     /* Acquire lock */
     lock();
 
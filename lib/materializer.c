@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "materializer.h"
+#include "hashmap.h"
+#include "memory.h"
+#include "error.h"
+#include <snowflake/logger.h>
+
+static size_t STDCALL value_size(SF_C_TYPE type) {
+    switch (type) {
+        case SF_C_TYPE_INT64:
+            return sizeof(int64);
+        case SF_C_TYPE_UINT64:
+            return sizeof(uint64);
+        case SF_C_TYPE_FLOAT64:
+            return sizeof(float64);
+        case SF_C_TYPE_BOOLEAN:
+            return sizeof(sf_bool);
+        default:
+            return 0;
+    }
+}
+
+static void STDCALL free_chunk(SF_MATERIALIZED_CHUNK *chunk, size_t column_count) {
+    size_t i;
+    if (!chunk) {
+        return;
+    }
+    if (chunk->columns) {
+        for (i = 0; i < column_count; i++) {
+            SF_MATERIALIZED_COLUMN *column = &chunk->columns[i];
+            SF_FREE(column->values);
+            SF_FREE(column->text);
+            SF_FREE(column->offsets);
+            SF_FREE(column->lengths);
+            SF_FREE(column->is_null);
+            SF_FREE(column->statuses);
+        }
+        SF_FREE(chunk->columns);
+    }
+    SF_FREE(chunk);
+}
+
+static void STDCALL free_interns(SF_INTERN_TABLE *interns, size_t column_count) {
+    size_t i;
+    if (!interns) {
+        return;
+    }
+    for (i = 0; i < column_count; i++) {
+        SF_FREE(interns[i].slots);
+    }
+    SF_FREE(interns);
+}
+
+/**
+ * Appends a NUL terminated string to the text of a string column.
+ *
+ * @return SF_BOOLEAN_FALSE if out of memory.
+ */
+static sf_bool STDCALL append_text(SF_MATERIALIZED_COLUMN *column, size_t *text_len,
+                                   size_t *text_cap, int64 row, const char *value, size_t len) {
+    if (*text_len + len + 1 > *text_cap) {
+        size_t cap = *text_cap * 2;
+        char *text;
+        if (cap < *text_len + len + 1) {
+            cap = *text_len + len + 1;
+        }
+        if ((text = (char *) SF_REALLOC(column->text, cap)) == NULL) {
+            return SF_BOOLEAN_FALSE;
+        }
+        column->text = text;
+        *text_cap = cap;
+    }
+    memcpy(column->text + *text_len, value, len);
+    column->text[*text_len + len] = '\0';
+    column->offsets[row] = *text_len;
+    column->lengths[row] = len;
+    *text_len += len + 1;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Appends a string to the text of a string column, unless the column of the chunk has it
+ * already, in which case the row shares it. Short values repeat in low-cardinality columns,
+ * e.g. statuses or country codes, and the NULL rows all share the empty string. The table
+ * stops taking values once the column turns out to have too many distinct ones.
+ *
+ * @return SF_BOOLEAN_FALSE if out of memory.
+ */
+static sf_bool STDCALL append_interned(SF_MATERIALIZED_COLUMN *column, SF_INTERN_TABLE *intern,
+                                       size_t *text_len, size_t *text_cap, int64 row,
+                                       const char *value, size_t len) {
+    uint32 hash;
+    size_t slot;
+    SF_INTERN_SLOT *entry;
+
+    if (len > SF_INTERN_MAX_LEN || intern->disabled) {
+        return append_text(column, text_len, text_cap, row, value, len);
+    }
+    if (!intern->slots) {
+        intern->slots = (SF_INTERN_SLOT *) SF_CALLOC(SF_INTERN_SLOTS, sizeof(SF_INTERN_SLOT));
+        if (!intern->slots) {
+            // Only a saving, the values are copied as they are
+            intern->disabled = SF_BOOLEAN_TRUE;
+            return append_text(column, text_len, text_cap, row, value, len);
+        }
+    }
+
+    hash = (uint32) sf_fnv1a(SF_FNV_OFFSET_BASIS, value, len);
+    for (slot = hash & (SF_INTERN_SLOTS - 1); intern->slots[slot].offset > 0;
+         slot = (slot + 1) & (SF_INTERN_SLOTS - 1)) {
+        entry = &intern->slots[slot];
+        if (entry->hash == hash && entry->len == len &&
+            memcmp(column->text + entry->offset - 1, value, len) == 0) {
+            column->offsets[row] = entry->offset - 1;
+            column->lengths[row] = len;
+            return SF_BOOLEAN_TRUE;
+        }
+    }
+
+    if (!append_text(column, text_len, text_cap, row, value, len)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (++intern->count > SF_INTERN_MAX_VALUES) {
+        intern->disabled = SF_BOOLEAN_TRUE;
+        SF_FREE(intern->slots);
+        return SF_BOOLEAN_TRUE;
+    }
+    entry = &intern->slots[slot];
+    entry->offset = column->offsets[row] + 1;
+    entry->len = len;
+    entry->hash = hash;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Converts the registered columns of every row of a chunk.
+ *
+ * @return the converted chunk, NULL if out of memory.
+ */
+static SF_MATERIALIZED_CHUNK *STDCALL convert_chunk(SF_MATERIALIZER *materializer,
+                                                    SF_RESULT_CHUNK *result_chunk) {
+    SF_MATERIALIZED_CHUNK *chunk;
+    size_t *text_lens = NULL;
+    size_t *text_caps = NULL;
+    SF_INTERN_TABLE *interns = NULL;
+    char *scratch = NULL;
+    size_t scratch_len = 0;
+    size_t scratch_size = 0;
+    int64 rows = result_chunk->row_count;
+    int64 row;
+    size_t i;
+
+    chunk = (SF_MATERIALIZED_CHUNK *) SF_CALLOC(1, sizeof(SF_MATERIALIZED_CHUNK));
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->chunk_index = result_chunk->chunk_index;
+    chunk->row_count = rows;
+    chunk->columns = (SF_MATERIALIZED_COLUMN *) SF_CALLOC(materializer->column_count,
+                                                          sizeof(SF_MATERIALIZED_COLUMN));
+    text_lens = (size_t *) SF_CALLOC(materializer->column_count, sizeof(size_t));
+    text_caps = (size_t *) SF_CALLOC(materializer->column_count, sizeof(size_t));
+    interns = (SF_INTERN_TABLE *) SF_CALLOC(materializer->column_count, sizeof(SF_INTERN_TABLE));
+    if (!chunk->columns || !text_lens || !text_caps || !interns) {
+        goto error;
+    }
+
+    // Allocated for one row at least, so that an empty chunk needs no special case
+    for (i = 0; i < materializer->column_count; i++) {
+        SF_MATERIALIZED_COLUMN *column = &chunk->columns[i];
+        column->type = materializer->types[i];
+        if (column->type == SF_C_TYPE_NULL) {
+            continue;
+        }
+        column->is_null = (sf_bool *) SF_CALLOC(rows + 1, sizeof(sf_bool));
+        if (column->type == SF_C_TYPE_STRING) {
+            column->offsets = (size_t *) SF_CALLOC(rows + 1, sizeof(size_t));
+            column->lengths = (size_t *) SF_CALLOC(rows + 1, sizeof(size_t));
+            // Room for short values to start with, grown as needed
+            text_caps[i] = (size_t) (rows + 1) * 16;
+            column->text = (char *) SF_CALLOC(1, text_caps[i]);
+        } else {
+            column->values = SF_CALLOC(rows + 1, value_size(column->type));
+        }
+        if (!column->is_null ||
+            (column->type == SF_C_TYPE_STRING ?
+             !column->offsets || !column->lengths || !column->text : !column->values)) {
+            goto error;
+        }
+    }
+
+    for (row = 0; row < rows && snowflake_chunk_next(result_chunk) == SF_STATUS_SUCCESS; row++) {
+        for (i = 0; i < materializer->column_count; i++) {
+            SF_MATERIALIZED_COLUMN *column = &chunk->columns[i];
+            int idx = (int) i + 1;
+            SF_STATUS status = SF_STATUS_SUCCESS;
+            sf_bool is_null = SF_BOOLEAN_FALSE;
+
+            if (column->type == SF_C_TYPE_NULL) {
+                continue;
+            }
+            if ((status = snowflake_chunk_column_is_null(result_chunk, idx, &is_null)) ==
+                SF_STATUS_SUCCESS && !is_null) {
+                switch (column->type) {
+                    case SF_C_TYPE_INT64:
+                        status = snowflake_chunk_column_as_int64(result_chunk, idx,
+                                                                 (int64 *) column->values + row);
+                        break;
+                    case SF_C_TYPE_UINT64:
+                        status = snowflake_chunk_column_as_uint64(result_chunk, idx,
+                                                                  (uint64 *) column->values + row);
+                        break;
+                    case SF_C_TYPE_FLOAT64:
+                        status = snowflake_chunk_column_as_float64(result_chunk, idx,
+                                                                   (float64 *) column->values + row);
+                        break;
+                    case SF_C_TYPE_BOOLEAN:
+                        status = snowflake_chunk_column_as_boolean(result_chunk, idx,
+                                                                   (sf_bool *) column->values + row);
+                        break;
+                    default:
+                        scratch_len = 0;
+                        if ((status = snowflake_chunk_column_as_str(
+                                result_chunk, idx, &scratch, &scratch_len, &scratch_size)) ==
+                            SF_STATUS_SUCCESS &&
+                            !append_interned(column, &interns[i], &text_lens[i], &text_caps[i],
+                                             row, scratch, scratch_len)) {
+                            goto error;
+                        }
+                        break;
+                }
+            }
+            column->is_null[row] = is_null;
+            if (column->type == SF_C_TYPE_STRING && (is_null || status != SF_STATUS_SUCCESS) &&
+                !append_interned(column, &interns[i], &text_lens[i], &text_caps[i], row, "", 0)) {
+                goto error;
+            }
+            if (status != SF_STATUS_SUCCESS) {
+                // Reported when the cell is read, like the column functions would
+                if (!column->statuses &&
+                    (column->statuses = (SF_STATUS *) SF_CALLOC(rows, sizeof(SF_STATUS))) == NULL) {
+                    goto error;
+                }
+                column->statuses[row] = status;
+            }
+        }
+    }
+    chunk->row_count = row;
+
+    free_interns(interns, materializer->column_count);
+    SF_FREE(scratch);
+    SF_FREE(text_lens);
+    SF_FREE(text_caps);
+    return chunk;
+
+error:
+    free_interns(interns, materializer->column_count);
+    SF_FREE(scratch);
+    SF_FREE(text_lens);
+    SF_FREE(text_caps);
+    free_chunk(chunk, materializer->column_count);
+    return NULL;
+}
+
+static void *STDCALL convert_worker_chunk(void *context, SF_RESULT_CHUNK *result_chunk,
+                                           SF_ERROR_STRUCT *error) {
+    SF_MATERIALIZER *materializer = (SF_MATERIALIZER *) context;
+    SF_MATERIALIZED_CHUNK *chunk = convert_chunk(materializer, result_chunk);
+
+    if (!chunk) {
+        SET_SNOWFLAKE_STMT_ERROR(error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to allocate the converted values of a chunk.",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, materializer->sfstmt->sfqid);
+    }
+    return chunk;
+}
+
+static void STDCALL free_worker_chunk(void *context, void *item) {
+    free_chunk((SF_MATERIALIZED_CHUNK *) item, ((SF_MATERIALIZER *) context)->column_count);
+}
+
+SF_MATERIALIZER *STDCALL sf_materializer_init(SF_STMT *sfstmt, const SF_C_TYPE *types,
+                                              size_t column_count, unsigned int thread_count) {
+    SF_MATERIALIZER *materializer;
+
+    if ((materializer = (SF_MATERIALIZER *) SF_CALLOC(1, sizeof(SF_MATERIALIZER))) == NULL) {
+        return NULL;
+    }
+    materializer->sfstmt = sfstmt;
+    materializer->column_count = column_count;
+    materializer->current_row = -1;
+    materializer->types = (SF_C_TYPE *) SF_CALLOC(column_count, sizeof(SF_C_TYPE));
+    if (!materializer->types ||
+        sf_chunk_workers_init(&materializer->workers, sfstmt, thread_count, convert_worker_chunk,
+                              free_worker_chunk, materializer) != SF_STATUS_SUCCESS) {
+        SF_FREE(materializer->types);
+        SF_FREE(materializer);
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                                 "Unable to allocate the column conversion.",
+                                 SF_SQLSTATE_MEMORY_ALLOCATION_ERROR, sfstmt->sfqid);
+        return NULL;
+    }
+    memcpy(materializer->types, types, column_count * sizeof(SF_C_TYPE));
+
+    if (sf_chunk_workers_start(&materializer->workers) != SF_STATUS_SUCCESS) {
+        copy_snowflake_error(&sfstmt->error, &materializer->workers.error);
+        sf_materializer_term(materializer);
+        return NULL;
+    }
+    log_debug("Converting %llu columns on %u threads", (unsigned long long) column_count,
+              thread_count);
+    return materializer;
+}
+
+void STDCALL sf_materializer_term(SF_MATERIALIZER *materializer) {
+    if (!materializer) {
+        return;
+    }
+
+    sf_chunk_workers_term(&materializer->workers);
+    free_chunk(materializer->current, materializer->column_count);
+
+    SF_FREE(materializer->types);
+    SF_FREE(materializer);
+}
+
+SF_STATUS STDCALL sf_materializer_next(SF_MATERIALIZER *materializer) {
+    SF_MATERIALIZED_CHUNK *chunk = materializer->current;
+    SF_STATUS status = SF_STATUS_SUCCESS;
+    void *item;
+
+    if (chunk && materializer->current_row + 1 < chunk->row_count) {
+        materializer->current_row++;
+        return SF_STATUS_SUCCESS;
+    }
+
+    // Empty chunks are skipped
+    while (status == SF_STATUS_SUCCESS &&
+           (!chunk || materializer->current_row + 1 >= chunk->row_count)) {
+        free_chunk(chunk, materializer->column_count);
+        materializer->current = chunk = NULL;
+        materializer->current_row = -1;
+
+        status = sf_chunk_workers_take(&materializer->workers, &item);
+        materializer->current = chunk = (SF_MATERIALIZED_CHUNK *) item;
+    }
+
+    if (status == SF_STATUS_SUCCESS) {
+        materializer->current_row = 0;
+    }
+    return status;
+}
+
+SF_STATUS STDCALL sf_materializer_column(SF_MATERIALIZER *materializer, int idx, SF_C_TYPE type,
+                                         SF_MATERIALIZED_COLUMN **column) {
+    SF_STMT *sfstmt = materializer->sfstmt;
+    SF_MATERIALIZED_COLUMN *found;
+    SF_STATUS status;
+
+    if (!materializer->current || materializer->current_row < 0) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "No row has been fetched.", SF_SQLSTATE_INVALID_CURSOR_POSITION,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+    if (idx < 1 || (size_t) idx > materializer->column_count) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_OUT_OF_BOUNDS,
+                                 "Column index is not one of the converted columns.",
+                                 "", sfstmt->sfqid);
+        return SF_STATUS_ERROR_OUT_OF_BOUNDS;
+    }
+    found = &materializer->current->columns[idx - 1];
+    // Any type reads whether the value is NULL
+    if (found->type == SF_C_TYPE_NULL || (type != SF_C_TYPE_NULL && found->type != type)) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE,
+                                 "Column was not converted to the requested type.",
+                                 SF_SQLSTATE_INVALID_DATA_TYPE_IN_APPLICATION_DESCRIPTOR,
+                                 sfstmt->sfqid);
+        return SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE;
+    }
+    if (type != SF_C_TYPE_NULL && found->statuses &&
+        (status = found->statuses[materializer->current_row]) != SF_STATUS_SUCCESS) {
+        SET_SNOWFLAKE_STMT_ERROR(&sfstmt->error, status,
+                                 "Value of the column could not be converted.",
+                                 SF_SQLSTATE_GENERAL_ERROR, sfstmt->sfqid);
+        return status;
+    }
+    *column = found;
+    return SF_STATUS_SUCCESS;
+}
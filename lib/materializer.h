@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_MATERIALIZER_H
+#define SNOWFLAKE_MATERIALIZER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+#include "chunk_workers.h"
+
+/**
+ * Values of a column of a chunk, converted to the C type the column was registered with.
+ */
+typedef struct SF_MATERIALIZED_COLUMN {
+    SF_C_TYPE type;
+    // One value per row, of the C type. NULL for the strings.
+    void *values;
+    // Strings: NUL terminated values one after the other, starting at the offset of each row.
+    // Rows with the same short value may share it.
+    char *text;
+    size_t *offsets;
+    size_t *lengths;
+    sf_bool *is_null;
+    // Status of the conversion of each row, NULL if every row was converted
+    SF_STATUS *statuses;
+} SF_MATERIALIZED_COLUMN;
+
+// Longest string the rows of a column of a chunk share rather than copy
+#define SF_INTERN_MAX_LEN 64
+// Slots of the table of the strings of a column of a chunk, a power of two
+#define SF_INTERN_SLOTS 1024
+// Distinct strings a column of a chunk shares at most, past which it isn't low-cardinality
+#define SF_INTERN_MAX_VALUES (SF_INTERN_SLOTS / 2)
+
+/**
+ * A string of the text of a column, by its offset plus one, 0 for an empty slot.
+ */
+typedef struct SF_INTERN_SLOT {
+    size_t offset;
+    size_t len;
+    uint32 hash;
+} SF_INTERN_SLOT;
+
+/**
+ * The strings of a column of a chunk being converted, for the rows with the same value to
+ * share its text. Open addressing, allocated on the first string.
+ */
+typedef struct SF_INTERN_TABLE {
+    SF_INTERN_SLOT *slots;
+    size_t count;
+    sf_bool disabled;
+} SF_INTERN_TABLE;
+
+typedef struct SF_MATERIALIZED_CHUNK {
+    int64 chunk_index;
+    int64 row_count;
+    SF_MATERIALIZED_COLUMN *columns;
+} SF_MATERIALIZED_CHUNK;
+
+/**
+ * Conversion of the result set of a statement ahead of the fetch, see
+ * snowflake_materialize_columns(). The chunk workers convert the registered columns of every
+ * row of the chunks, snowflake_fetch() takes the chunks in result order and the column
+ * functions look the values up in them.
+ */
+typedef struct SF_MATERIALIZER {
+    SF_STMT *sfstmt;
+    SF_C_TYPE *types;
+    size_t column_count;
+    SF_CHUNK_WORKERS workers;
+
+    // Only used by the consumer
+    SF_MATERIALIZED_CHUNK *current;
+    int64 current_row;
+} SF_MATERIALIZER;
+
+/**
+ * Starts the workers converting the result set of the statement.
+ */
+SF_MATERIALIZER *STDCALL sf_materializer_init(SF_STMT *sfstmt, const SF_C_TYPE *types,
+                                              size_t column_count, unsigned int thread_count);
+
+/**
+ * Stops the workers and frees the chunks converted.
+ */
+void STDCALL sf_materializer_term(SF_MATERIALIZER *materializer);
+
+/**
+ * Moves to the next row, waiting for its chunk to be converted.
+ *
+ * @return 0 if success, SF_STATUS_EOF if no rows are left, otherwise an errno is returned
+ *         with the error set on the statement.
+ */
+SF_STATUS STDCALL sf_materializer_next(SF_MATERIALIZER *materializer);
+
+/**
+ * Looks up a column of the current row, which must have been registered with the given type.
+ *
+ * @param column receives the column of the current chunk.
+ * @return 0 if success, otherwise an errno is returned with the error set on the statement.
+ */
+SF_STATUS STDCALL sf_materializer_column(SF_MATERIALIZER *materializer, int idx, SF_C_TYPE type,
+                                         SF_MATERIALIZED_COLUMN **column);
+
+/**
+ * @return the row of the current chunk the column functions read.
+ */
+#define SF_MATERIALIZER_ROW(materializer) ((materializer)->current_row)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_MATERIALIZER_H
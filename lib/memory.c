@@ -2,6 +2,12 @@
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
 
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
 #include <snowflake/logger.h>
 #include "memory.h"
 #include "snowflake/platform.h"
@@ -10,8 +16,48 @@
 #define sf_ptr_hash(p, t) (((unsigned long) ((unsigned long long)p) >> 3) & (sizeof (t)/sizeof ((t)[0]) - 1))
 #define SF_ALLOC_MAP_SIZE 2048
 
+/*
+ * One in SF_MEMORY_TRACKING_SAMPLE allocations, chosen by address, is tracked in the
+ * allocation map so that leaks can be logged at shutdown. Only those take the allocation
+ * lock. 1 tracks every allocation, 0 compiles the tracking out.
+ */
+#ifndef SF_MEMORY_TRACKING_SAMPLE
+#define SF_MEMORY_TRACKING_SAMPLE 64
+#endif
+
+#if SF_MEMORY_TRACKING_SAMPLE > 0
+// Mixes the address bits first, as allocators tend to hand out addresses with the same low bits
+#define sf_ptr_tracked(p) ((p) != NULL && \
+    ((((unsigned long long) (p) >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) % SF_MEMORY_TRACKING_SAMPLE == 0)
+#else
+#define sf_ptr_tracked(p) SF_BOOLEAN_FALSE
+#endif
+
 static SF_MUTEX_HANDLE allocation_lock;
 
+static volatile unsigned long long allocation_count;
+static volatile unsigned long long free_count;
+static volatile unsigned long long allocated_bytes;
+
+// Bytes in use per tag
+static volatile unsigned long long tag_used[SF_MEMORY_TAG_COUNT];
+// Allocator of each tag, no alloc function for the global one
+static SF_INTERNAL_MEM_HOOKS tag_hooks[SF_MEMORY_TAG_COUNT];
+
+// Idle buffers of each class of the pool, protected by pool_lock
+static SF_MUTEX_HANDLE pool_lock;
+static void *pool_idle[SF_MEMORY_POOL_CLASSES][SF_MEMORY_POOL_DEPTH];
+static int pool_idle_count[SF_MEMORY_POOL_CLASSES];
+static volatile unsigned long long pool_idle_bytes;
+// Buffers of the pool allocated and not freed yet, idle ones included
+static volatile unsigned long long pool_buffers;
+// Pages backing the buffers of the pool, only changed while it has none
+static SF_HUGE_PAGES pool_huge_pages = SF_HUGE_PAGES_NONE;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+#define SF_POOL_HUGE_PAGES_SUPPORTED
+#endif
+
 static struct allocation {
     struct allocation *link;
     const void *ptr;
@@ -69,9 +115,12 @@ static void alloc_remove(const void *ptr) {
 
 void sf_memory_init() {
     _mutex_init(&allocation_lock);
+    _mutex_init(&pool_lock);
 }
 
 void sf_memory_term() {
+    sf_memory_pool_trim();
+    _mutex_term(&pool_lock);
     _mutex_term(&allocation_lock);
 }
 
@@ -87,9 +136,13 @@ void *sf_malloc(size_t size, const char *file, int line) {
         exit(EXIT_FAILURE);
     }
 
-    _mutex_lock(&allocation_lock);
-    alloc_insert(data, size, file, line);
-    _mutex_unlock(&allocation_lock);
+    sf_atomic_fetch_add(&allocation_count, 1);
+    sf_atomic_fetch_add(&allocated_bytes, size);
+    if (sf_ptr_tracked(data)) {
+        _mutex_lock(&allocation_lock);
+        alloc_insert(data, size, file, line);
+        _mutex_unlock(&allocation_lock);
+    }
 
     return data;
 }
@@ -106,58 +159,451 @@ void *sf_calloc(size_t num, size_t size, const char *file, int line) {
         exit(EXIT_FAILURE);
     }
 
-    _mutex_lock(&allocation_lock);
-    alloc_insert(data, num * size, file, line);
-    _mutex_unlock(&allocation_lock);
+    sf_atomic_fetch_add(&allocation_count, 1);
+    sf_atomic_fetch_add(&allocated_bytes, num * size);
+    if (sf_ptr_tracked(data)) {
+        _mutex_lock(&allocation_lock);
+        alloc_insert(data, num * size, file, line);
+        _mutex_unlock(&allocation_lock);
+    }
 
     return data;
 }
 
 void *sf_realloc(void *ptr, size_t size, const char *file, int line) {
     struct allocation *alloc;
+    void *data;
+    sf_bool old_tracked = sf_ptr_tracked(ptr);
+
+    // The old entry goes along with the old memory, before another thread can get its address
+    if (old_tracked) {
+        _mutex_lock(&allocation_lock);
+    }
     // New pointer returned by realloc
-    void *data = realloc(ptr, size);
+    data = realloc(ptr, size);
     // If we could not allocate the needed data, exit
     if (data == NULL && size > 0) {
         log_fatal("Could not allocate %zu bytes of memory. Most likely out of memory. Exiting...", size);
         exit(EXIT_FAILURE);
     }
 
-    _mutex_lock(&allocation_lock);
-    alloc = alloc_find(ptr);
-    // If we don't find old entry then create new one
-    if (alloc) {
-        // No need to rehash since pointer is the same. Just update associated fields
-        if (ptr == data) {
+    if (old_tracked) {
+        alloc = alloc_find(ptr);
+        if (alloc && ptr == data) {
+            // No need to rehash since pointer is the same. Just update associated fields
             alloc->size = size;
             alloc->file = file;
             alloc->line = line;
         } else {
             // Pointer is different, so we need to remove old entry, and create new entry
             alloc_remove(ptr);
-            alloc_insert(data, size, file, line);
+            if (sf_ptr_tracked(data)) {
+                alloc_insert(data, size, file, line);
+            }
         }
-    } else {
+        _mutex_unlock(&allocation_lock);
+    } else if (sf_ptr_tracked(data)) {
+        _mutex_lock(&allocation_lock);
         alloc_insert(data, size, file, line);
+        _mutex_unlock(&allocation_lock);
     }
-    _mutex_unlock(&allocation_lock);
+
+    if (ptr == NULL) {
+        sf_atomic_fetch_add(&allocation_count, 1);
+    }
+    if (data == NULL) {
+        sf_atomic_fetch_add(&free_count, 1);
+    }
+    sf_atomic_fetch_add(&allocated_bytes, size);
 
     return data;
 }
 
 void sf_free(void *ptr, const char *file, int line) {
-    if (ptr) {
+    if (!ptr) {
+        return;
+    }
+    sf_atomic_fetch_add(&free_count, 1);
+    if (sf_ptr_tracked(ptr)) {
         _mutex_lock(&allocation_lock);
         free(ptr);
         alloc_remove(ptr);
         _mutex_unlock(&allocation_lock);
+    } else {
+        free(ptr);
+    }
+}
+
+void sf_memory_stats(SF_MEMORY_STATS *stats) {
+    stats->allocations = sf_atomic_load(&allocation_count);
+    stats->frees = sf_atomic_load(&free_count);
+    stats->allocated_bytes = sf_atomic_load(&allocated_bytes);
+}
+
+/**
+ * @return the class of buffers of a size, -1 if buffers of that size aren't pooled
+ */
+static int pool_class(size_t size, size_t *class_size) {
+    size_t base = SF_MEMORY_POOL_MIN_SIZE;
+    int index = 0;
+    int step;
+
+    if (size < SF_MEMORY_POOL_MIN_SIZE) {
+        return -1;
+    }
+    for (; index < SF_MEMORY_POOL_CLASSES; base *= 2) {
+        for (step = 0; step < 4; step++, index++) {
+            if (base + step * (base / 4) >= size) {
+                *class_size = base + step * (base / 4);
+                return index;
+            }
+        }
+    }
+    return -1;
+}
+
+#ifdef SF_POOL_HUGE_PAGES_SUPPORTED
+/**
+ * @return SF_BOOLEAN_TRUE if buffers of a class are backed by huge pages
+ */
+static sf_bool pool_huge(size_t class_size) {
+    return pool_huge_pages != SF_HUGE_PAGES_NONE && class_size >= SF_MEMORY_POOL_HUGE_PAGE_SIZE ?
+           SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * @return the bytes mapped for a buffer of reserved huge pages, whole huge pages
+ */
+static size_t pool_huge_mapping(size_t class_size) {
+    return (class_size + SF_MEMORY_POOL_HUGE_PAGE_SIZE - 1) & ~((size_t) SF_MEMORY_POOL_HUGE_PAGE_SIZE - 1);
+}
+
+static void *pool_huge_alloc(size_t class_size) {
+    void *data = NULL;
+    size_t mapping = pool_huge_mapping(class_size);
+
+    if (pool_huge_pages == SF_HUGE_PAGES_EXPLICIT) {
+#ifdef MAP_HUGETLB
+        data = mmap(NULL, mapping, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            return data;
+        }
+#endif
+        // No reserved huge pages left, mapped the same way to be unmapped alike
+        data = mmap(NULL, mapping, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            return NULL;
+        }
+    } else if (posix_memalign(&data, SF_MEMORY_POOL_HUGE_PAGE_SIZE, class_size) != 0) {
+        return NULL;
+    }
+    // Only a hint, the buffer is used with the pages the kernel can find
+    madvise(data, pool_huge_pages == SF_HUGE_PAGES_EXPLICIT ? mapping : class_size, MADV_HUGEPAGE);
+    return data;
+}
+#endif
+
+static void *pool_os_alloc(size_t class_size) {
+#ifdef _WIN32
+    return _aligned_malloc(class_size, SF_MEMORY_POOL_ALIGNMENT);
+#else
+    void *data = NULL;
+#ifdef SF_POOL_HUGE_PAGES_SUPPORTED
+    if (pool_huge(class_size)) {
+        return pool_huge_alloc(class_size);
+    }
+#endif
+    return posix_memalign(&data, SF_MEMORY_POOL_ALIGNMENT, class_size) == 0 ? data : NULL;
+#endif
+}
+
+static void pool_os_free(void *ptr, size_t class_size) {
+    sf_atomic_fetch_add(&free_count, 1);
+    sf_atomic_fetch_sub(&pool_buffers, 1);
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+#ifdef SF_POOL_HUGE_PAGES_SUPPORTED
+    if (pool_huge(class_size) && pool_huge_pages == SF_HUGE_PAGES_EXPLICIT) {
+        munmap(ptr, pool_huge_mapping(class_size));
+        return;
+    }
+#endif
+    free(ptr);
+#endif
+}
+
+size_t sf_memory_pool_class_size(size_t size) {
+    size_t class_size = 0;
+    return pool_class(size, &class_size) >= 0 ? class_size : 0;
+}
+
+void *sf_memory_pool_alloc(size_t size) {
+    size_t class_size = 0;
+    int index = pool_class(size, &class_size);
+    void *data = NULL;
+
+    if (index < 0) {
+        return NULL;
+    }
+    _mutex_lock(&pool_lock);
+    if (pool_idle_count[index] > 0) {
+        data = pool_idle[index][--pool_idle_count[index]];
+        pool_idle_bytes -= class_size;
+    }
+    _mutex_unlock(&pool_lock);
+    if (data) {
+        return data;
+    }
+
+    if ((data = pool_os_alloc(class_size)) != NULL) {
+        sf_atomic_fetch_add(&allocation_count, 1);
+        sf_atomic_fetch_add(&allocated_bytes, class_size);
+        sf_atomic_fetch_add(&pool_buffers, 1);
+    }
+    return data;
+}
+
+void sf_memory_pool_free(void *ptr, size_t size) {
+    size_t class_size = 0;
+    int index = pool_class(size, &class_size);
+    sf_bool kept = SF_BOOLEAN_FALSE;
+
+    if (!ptr || index < 0) {
+        return;
+    }
+    _mutex_lock(&pool_lock);
+    if (pool_idle_count[index] < SF_MEMORY_POOL_DEPTH &&
+        pool_idle_bytes + class_size <= SF_MEMORY_POOL_MAX_IDLE_BYTES) {
+        pool_idle[index][pool_idle_count[index]++] = ptr;
+        pool_idle_bytes += class_size;
+        kept = SF_BOOLEAN_TRUE;
+    }
+    _mutex_unlock(&pool_lock);
+    if (!kept) {
+        pool_os_free(ptr, class_size);
+    }
+}
+
+void sf_memory_pool_trim() {
+    int index;
+    size_t class_size;
+    _mutex_lock(&pool_lock);
+    for (index = 0; index < SF_MEMORY_POOL_CLASSES; index++) {
+        class_size = (SF_MEMORY_POOL_MIN_SIZE << (index / 4)) / 4 * (4 + index % 4);
+        while (pool_idle_count[index] > 0) {
+            pool_os_free(pool_idle[index][--pool_idle_count[index]], class_size);
+        }
+    }
+    pool_idle_bytes = 0;
+    _mutex_unlock(&pool_lock);
+}
+
+uint64 sf_memory_pool_idle() {
+    uint64 idle;
+    _mutex_lock(&pool_lock);
+    idle = pool_idle_bytes;
+    _mutex_unlock(&pool_lock);
+    return idle;
+}
+
+sf_bool sf_memory_pool_set_huge_pages(SF_HUGE_PAGES mode) {
+    sf_bool set = SF_BOOLEAN_FALSE;
+    if (mode == pool_huge_pages) {
+        return SF_BOOLEAN_TRUE;
+    }
+    sf_memory_pool_trim();
+    _mutex_lock(&pool_lock);
+    if (sf_atomic_load(&pool_buffers) == 0) {
+        pool_huge_pages = mode;
+        set = SF_BOOLEAN_TRUE;
+    }
+    _mutex_unlock(&pool_lock);
+#ifndef SF_POOL_HUGE_PAGES_SUPPORTED
+    if (set && mode != SF_HUGE_PAGES_NONE) {
+        log_warn("Huge pages aren't supported on this platform, the buffers use pages of the "
+                 "default size");
+    }
+#endif
+    return set;
+}
+
+SF_HUGE_PAGES sf_memory_pool_get_huge_pages() {
+    return pool_huge_pages;
+}
+
+/**
+ * @return whether the allocations of a tag of this size come from the pool
+ */
+static sf_bool tag_pooled(SF_MEMORY_TAG tag, size_t size) {
+    return tag == SF_MEMORY_TAG_CHUNK_DOWNLOAD && !tag_hooks[tag].alloc &&
+           sf_memory_pool_class_size(size) > 0 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+void *sf_tag_malloc(SF_MEMORY_TAG tag, size_t size, const char *file, int line) {
+    void *data;
+    if (tag_pooled(tag, size)) {
+        data = sf_memory_pool_alloc(size);
+    } else if (tag == SF_MEMORY_TAG_NONE || !tag_hooks[tag].alloc) {
+        data = sf_malloc(size, file, line);
+    } else {
+        data = size > 0 ? tag_hooks[tag].alloc(size) : NULL;
+    }
+    if (data) {
+        sf_atomic_fetch_add(&tag_used[tag], size);
+    }
+    return data;
+}
+
+void *sf_tag_calloc(SF_MEMORY_TAG tag, size_t num, size_t size, const char *file, int line) {
+    void *data;
+    if (size > 0 && num <= (size_t) -1 / size && tag_pooled(tag, num * size)) {
+        if ((data = sf_memory_pool_alloc(num * size)) != NULL) {
+            memset(data, 0, num * size);
+        }
+    } else if (tag == SF_MEMORY_TAG_NONE || !tag_hooks[tag].alloc) {
+        data = sf_calloc(num, size, file, line);
+    } else if (num == 0 || size == 0 || num > (size_t) -1 / size) {
+        data = NULL;
+    } else if (tag_hooks[tag].calloc) {
+        data = tag_hooks[tag].calloc(num, size);
+    } else if ((data = tag_hooks[tag].alloc(num * size)) != NULL) {
+        memset(data, 0, num * size);
+    }
+    if (data) {
+        sf_atomic_fetch_add(&tag_used[tag], num * size);
+    }
+    return data;
+}
+
+void *sf_tag_realloc(SF_MEMORY_TAG tag, void *ptr, size_t old_size, size_t size,
+                     const char *file, int line) {
+    void *data;
+    if (size == 0) {
+        sf_tag_free(tag, ptr, old_size, file, line);
+        return NULL;
+    }
+    if (ptr == NULL) {
+        old_size = 0;
+    }
+    if (tag_pooled(tag, size) || tag_pooled(tag, old_size)) {
+        if (ptr && sf_memory_pool_class_size(size) == sf_memory_pool_class_size(old_size)) {
+            // Still fits in its class
+            data = ptr;
+        } else {
+            data = tag_pooled(tag, size) ? sf_memory_pool_alloc(size) : sf_malloc(size, file, line);
+            if (data && ptr) {
+                memcpy(data, ptr, old_size < size ? old_size : size);
+                if (tag_pooled(tag, old_size)) {
+                    sf_memory_pool_free(ptr, old_size);
+                } else {
+                    sf_free(ptr, file, line);
+                }
+            }
+        }
+    } else if (tag == SF_MEMORY_TAG_NONE || !tag_hooks[tag].alloc) {
+        data = sf_realloc(ptr, size, file, line);
+    } else {
+        data = tag_hooks[tag].realloc(ptr, size);
+    }
+    if (data) {
+        if (size > old_size) {
+            sf_atomic_fetch_add(&tag_used[tag], size - old_size);
+        } else {
+            sf_atomic_fetch_sub(&tag_used[tag], old_size - size);
+        }
+    }
+    return data;
+}
+
+void sf_tag_free(SF_MEMORY_TAG tag, void *ptr, size_t size, const char *file, int line) {
+    if (!ptr) {
+        return;
+    }
+    if (tag_pooled(tag, size)) {
+        sf_memory_pool_free(ptr, size);
+    } else if (tag == SF_MEMORY_TAG_NONE || !tag_hooks[tag].alloc) {
+        sf_free(ptr, file, line);
+    } else {
+        tag_hooks[tag].dealloc(ptr);
+    }
+    sf_atomic_fetch_sub(&tag_used[tag], size);
+}
+
+uint64 sf_memory_tag_used(SF_MEMORY_TAG tag) {
+    return tag < SF_MEMORY_TAG_COUNT ? sf_atomic_load(&tag_used[tag]) : 0;
+}
+
+void sf_memory_budget_init(SF_MEMORY_BUDGET *budget, uint64 limit, SF_MEMORY_BUDGET *parent) {
+    budget->limit = limit;
+    budget->used = 0;
+    budget->parent = parent;
+}
+
+sf_bool sf_memory_budget_fits(SF_MEMORY_BUDGET *budget, uint64 size) {
+    for (; budget; budget = budget->parent) {
+        if (budget->limit && sf_atomic_load(&budget->used) + size > budget->limit) {
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+sf_bool sf_memory_budget_reserve(SF_MEMORY_BUDGET *budget, uint64 size) {
+    SF_MEMORY_BUDGET *level;
+    SF_MEMORY_BUDGET *charged;
+    uint64 used;
+
+    for (level = budget; level; level = level->parent) {
+        do {
+            used = sf_atomic_load(&level->used);
+            if (level->limit && used + size > level->limit) {
+                // Undo the levels charged already
+                for (charged = budget; charged != level; charged = charged->parent) {
+                    sf_atomic_fetch_sub(&charged->used, size);
+                }
+                return SF_BOOLEAN_FALSE;
+            }
+        } while (!sf_atomic_compare_exchange(&level->used, used, used + size));
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+void sf_memory_budget_charge(SF_MEMORY_BUDGET *budget, uint64 size) {
+    for (; budget; budget = budget->parent) {
+        sf_atomic_fetch_add(&budget->used, size);
+    }
+}
+
+void sf_memory_budget_release(SF_MEMORY_BUDGET *budget, uint64 size) {
+    for (; budget; budget = budget->parent) {
+        sf_atomic_fetch_sub(&budget->used, size);
+    }
+}
+
+sf_bool sf_memory_set_tag_hooks(SF_MEMORY_TAG tag, const SF_INTERNAL_MEM_HOOKS *hooks) {
+    if (tag == SF_MEMORY_TAG_NONE || tag >= SF_MEMORY_TAG_COUNT ||
+        (hooks && (!hooks->alloc || !hooks->dealloc || !hooks->realloc)) ||
+        sf_memory_tag_used(tag) > 0) {
+        return SF_BOOLEAN_FALSE;
     }
+    if (hooks) {
+        tag_hooks[tag] = *hooks;
+    } else {
+        memset(&tag_hooks[tag], 0, sizeof(tag_hooks[tag]));
+    }
+    return SF_BOOLEAN_TRUE;
 }
 
 void sf_alloc_map_to_log(sf_bool cleanup) {
     int i;
     struct allocation *alloc;
     struct allocation *link;
+    SF_MEMORY_STATS stats;
+    sf_memory_stats(&stats);
+    log_debug("%llu allocations of %llu bytes in total, %llu not freed",
+              stats.allocations, stats.allocated_bytes, stats.allocations - stats.frees);
     _mutex_lock(&allocation_lock);
     for (i = 0; i < SF_ALLOC_MAP_SIZE; i++) {
         if (alloc_map[i]) {
@@ -172,6 +618,9 @@ void sf_alloc_map_to_log(sf_bool cleanup) {
                 }
                 alloc = link;
             }
+            if (cleanup) {
+                alloc_map[i] = NULL;
+            }
         }
     }
     _mutex_unlock(&allocation_lock);
@@ -11,6 +11,7 @@ extern "C" {
 
 #include <stdlib.h>
 #include <snowflake/basic_types.h>
+#include <snowflake/client.h>
 #include "snowflake/platform.h"
 
 #define SF_MALLOC(s) sf_malloc(s, __FILE__, __LINE__)
@@ -27,12 +28,175 @@ typedef struct SF_INTERNAL_MEM_HOOKS {
 
 static SF_INTERNAL_MEM_HOOKS global_hooks = {malloc, free, realloc, calloc};
 
+/**
+ * Subsystems whose memory is accounted separately and can be routed to an allocator of its
+ * own, see sf_memory_set_tag_hooks(). Tagged memory is allocated and freed with the
+ * SF_TAG_* macros, which take the size of the allocation so that no header is needed.
+ * SF_MEMORY_TAG_NONE makes them behave like the untagged macros.
+ */
+typedef enum SF_MEMORY_TAG {
+    SF_MEMORY_TAG_NONE,
+    // Cells of JSON result chunks, and the rows of the first chunk copied from the response
+    SF_MEMORY_TAG_RESULT_SET,
+    // Bodies of downloaded result chunks, which JSON chunks keep their text in once decoded
+    SF_MEMORY_TAG_CHUNK_DOWNLOAD,
+    // Text of bound values
+    SF_MEMORY_TAG_BIND,
+    SF_MEMORY_TAG_COUNT
+} SF_MEMORY_TAG;
+
+#define SF_TAG_MALLOC(tag, s) sf_tag_malloc(tag, s, __FILE__, __LINE__)
+#define SF_TAG_CALLOC(tag, n, s) sf_tag_calloc(tag, n, s, __FILE__, __LINE__)
+#define SF_TAG_REALLOC(tag, p, old_size, s) sf_tag_realloc(tag, p, old_size, s, __FILE__, __LINE__)
+#define SF_TAG_FREE(tag, p, s) ((void) (sf_tag_free(tag, p, s, __FILE__, __LINE__), (p) = NULL))
+
+/**
+ * Allocation statistics since the library was loaded. They cover every allocation, whether
+ * it is tracked in the allocation map or not.
+ */
+typedef struct SF_MEMORY_STATS {
+    uint64 allocations;
+    uint64 frees;
+    // Bytes requested by all allocations and reallocations
+    uint64 allocated_bytes;
+} SF_MEMORY_STATS;
+
 void sf_memory_init();
 void sf_memory_term();
 void *sf_malloc(size_t size, const char *file, int line);
 void *sf_calloc(size_t num, size_t size, const char *file, int line);
 void *sf_realloc(void *ptr, size_t size, const char *file, int line);
 void sf_free(void *ptr, const char *file, int line);
+void sf_memory_stats(SF_MEMORY_STATS *stats);
+
+/**
+ * Tagged allocations. They may return NULL when the tag has an allocator of its own, e.g. one
+ * that enforces a limit, so callers have to check.
+ */
+void *sf_tag_malloc(SF_MEMORY_TAG tag, size_t size, const char *file, int line);
+void *sf_tag_calloc(SF_MEMORY_TAG tag, size_t num, size_t size, const char *file, int line);
+void *sf_tag_realloc(SF_MEMORY_TAG tag, void *ptr, size_t old_size, size_t size,
+                     const char *file, int line);
+void sf_tag_free(SF_MEMORY_TAG tag, void *ptr, size_t size, const char *file, int line);
+
+/**
+ * @return the bytes of the memory of a tag that is in use
+ */
+uint64 sf_memory_tag_used(SF_MEMORY_TAG tag);
+
+/**
+ * Routes the allocations of a tag to other functions, or back to the global ones if hooks
+ * is NULL. calloc may be NULL, the others may not.
+ *
+ * @return SF_BOOLEAN_FALSE if memory of the tag is in use, as it couldn't be freed anymore
+ */
+sf_bool sf_memory_set_tag_hooks(SF_MEMORY_TAG tag, const SF_INTERNAL_MEM_HOOKS *hooks);
+
+/**
+ * Sets a budget up with no bytes used.
+ *
+ * @param limit the bytes the budget allows, 0 for no limit.
+ * @param parent the budget that is charged too, e.g. the one of the connection of a
+ *        statement, or NULL.
+ */
+void sf_memory_budget_init(SF_MEMORY_BUDGET *budget, uint64 limit, SF_MEMORY_BUDGET *parent);
+
+/**
+ * @return SF_BOOLEAN_TRUE if size more bytes are within the limits of the budget and of its
+ *         parents, always for a NULL budget
+ */
+sf_bool sf_memory_budget_fits(SF_MEMORY_BUDGET *budget, uint64 size);
+
+/**
+ * Charges size bytes to the budget and its parents if they are within all of their limits.
+ *
+ * @return SF_BOOLEAN_FALSE if they are not, nothing is charged then
+ */
+sf_bool sf_memory_budget_reserve(SF_MEMORY_BUDGET *budget, uint64 size);
+
+/**
+ * Charges size bytes to the budget and its parents whether they are within the limits or not,
+ * for memory that can't wait, e.g. the chunk the consumer needs next.
+ */
+void sf_memory_budget_charge(SF_MEMORY_BUDGET *budget, uint64 size);
+
+/**
+ * Gives back bytes charged to the budget.
+ */
+void sf_memory_budget_release(SF_MEMORY_BUDGET *budget, uint64 size);
+
+/**
+ * Pool of large buffers of fixed size classes, shared by all statements, so that fetching
+ * chunk after chunk reuses the buffers of the chunks released before instead of allocating,
+ * and faulting in, new ones. The classes are four per power of two from SF_MEMORY_POOL_MIN_SIZE.
+ * The buffers are aligned to SF_MEMORY_POOL_ALIGNMENT bytes, as Arrow buffers are, and must
+ * only be released to the pool, with the size they were taken with.
+ *
+ * The tagged allocations of SF_MEMORY_TAG_CHUNK_DOWNLOAD come from the pool when the tag has
+ * no hooks of its own. A reallocation within the class of a buffer keeps the buffer.
+ *
+ * The buffers of SF_MEMORY_POOL_HUGE_PAGE_SIZE or more can be backed by huge pages, see
+ * sf_memory_pool_set_huge_pages(), aligned to a huge page then.
+ */
+#define SF_MEMORY_POOL_MIN_SIZE (256 * 1024)
+#define SF_MEMORY_POOL_DOUBLINGS 10
+#define SF_MEMORY_POOL_CLASSES (4 * SF_MEMORY_POOL_DOUBLINGS)
+// Idle buffers kept per class
+#define SF_MEMORY_POOL_DEPTH 4
+// Maximum bytes of all the idle buffers, the others are freed when released
+#define SF_MEMORY_POOL_MAX_IDLE_BYTES (256 * 1024 * 1024)
+#define SF_MEMORY_POOL_ALIGNMENT 64
+#define SF_MEMORY_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @return the size of the class of buffers of a size, 0 if buffers of that size aren't pooled
+ */
+size_t sf_memory_pool_class_size(size_t size);
+
+/**
+ * Takes a buffer from the pool, or allocates one.
+ *
+ * @param size the size of the buffer, which must be pooled, see sf_memory_pool_class_size().
+ * @return the buffer, NULL if out of memory.
+ */
+void *sf_memory_pool_alloc(size_t size);
+
+/**
+ * Releases a buffer taken with sf_memory_pool_alloc().
+ *
+ * @param ptr the buffer, may be NULL.
+ * @param size the size it was taken with, or any other size of its class.
+ */
+void sf_memory_pool_free(void *ptr, size_t size);
+
+/**
+ * Frees the idle buffers of the pool.
+ */
+void sf_memory_pool_trim();
+
+/**
+ * @return the bytes of the idle buffers of the pool
+ */
+uint64 sf_memory_pool_idle();
+
+/**
+ * Backs the buffers of the pool allocated from now on by huge pages, or by pages of the
+ * default size again. The idle buffers are freed.
+ *
+ * @return SF_BOOLEAN_FALSE if buffers of the pool are in use, as they couldn't be freed
+ *         anymore
+ */
+sf_bool sf_memory_pool_set_huge_pages(SF_HUGE_PAGES mode);
+
+/**
+ * @return the pages backing the buffers of the pool
+ */
+SF_HUGE_PAGES sf_memory_pool_get_huge_pages();
+
+/**
+ * Logs the tracked allocations that were not freed yet. Only one in SF_MEMORY_TRACKING_SAMPLE
+ * allocations is tracked, see memory.c.
+ */
 void sf_alloc_map_to_log(sf_bool cleanup);
 
 #ifdef __cplusplus
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "metrics.h"
+#include "memory.h"
+
+#ifdef _WIN32
+#define SF_THREAD_LOCAL __declspec(thread)
+#else
+#define SF_THREAD_LOCAL __thread
+#endif
+
+// Threads are given shards in turn, so up to this many record without contention
+#define METRIC_SHARD_COUNT 16
+
+typedef struct METRIC_HISTOGRAM {
+    volatile unsigned long long count;
+    volatile unsigned long long sum;
+    volatile unsigned long long buckets[SF_METRIC_BUCKET_COUNT];
+} METRIC_HISTOGRAM;
+
+typedef struct METRIC_SHARD {
+    volatile unsigned long long counters[SF_COUNTER_COUNT];
+    METRIC_HISTOGRAM histograms[SF_HISTOGRAM_COUNT];
+    // Keeps the counters of the next shard off the cache line of the last buckets
+    char padding[64];
+} METRIC_SHARD;
+
+static METRIC_SHARD SHARDS[METRIC_SHARD_COUNT];
+static volatile unsigned long long NEXT_SHARD = 0;
+static SF_THREAD_LOCAL METRIC_SHARD *thread_shard = NULL;
+
+static METRIC_SHARD *get_shard(void) {
+    if (!thread_shard) {
+        thread_shard = &SHARDS[sf_atomic_fetch_add(&NEXT_SHARD, 1) % METRIC_SHARD_COUNT];
+    }
+    return thread_shard;
+}
+
+void STDCALL sf_metric_add(SF_METRIC_COUNTER counter, uint64 value) {
+    sf_atomic_fetch_add(&get_shard()->counters[counter], value);
+}
+
+int STDCALL sf_metric_bucket(uint64 value) {
+    int exponent = 2;
+    int bucket;
+    if (value < 4) {
+        return (int) value;
+    }
+    while (exponent < 63 && (value >> (exponent + 1)) != 0) {
+        exponent++;
+    }
+    // The two bits after the highest one pick one of the 4 buckets of the power of two
+    bucket = 4 * (exponent - 1) + (int) ((value >> (exponent - 2)) & 3);
+    return bucket < SF_METRIC_BUCKET_COUNT ? bucket : SF_METRIC_BUCKET_COUNT - 1;
+}
+
+uint64 STDCALL snowflake_metrics_bucket_bound(int bucket) {
+    int exponent;
+    uint64 lower;
+    if (bucket < 4) {
+        return bucket < 0 ? 0 : (uint64) bucket;
+    }
+    if (bucket >= SF_METRIC_BUCKET_COUNT - 1) {
+        return (uint64) -1;
+    }
+    exponent = bucket / 4 + 1;
+    lower = (uint64) (4 + bucket % 4) << (exponent - 2);
+    return lower + ((uint64) 1 << (exponent - 2)) - 1;
+}
+
+void STDCALL sf_metric_record(SF_METRIC_HISTOGRAM histogram, uint64 value) {
+    METRIC_HISTOGRAM *h = &get_shard()->histograms[histogram];
+    sf_atomic_fetch_add(&h->buckets[sf_metric_bucket(value)], 1);
+    sf_atomic_fetch_add(&h->sum, value);
+    sf_atomic_fetch_add(&h->count, 1);
+}
+
+void STDCALL sf_metrics_snapshot(SF_METRICS_SNAPSHOT *snapshot) {
+    int shard;
+    int i;
+    int b;
+    memset(snapshot, 0, sizeof(SF_METRICS_SNAPSHOT));
+    for (shard = 0; shard < METRIC_SHARD_COUNT; shard++) {
+        METRIC_SHARD *s = &SHARDS[shard];
+        for (i = 0; i < SF_COUNTER_COUNT; i++) {
+            snapshot->counters[i] += sf_atomic_load(&s->counters[i]);
+        }
+        for (i = 0; i < SF_HISTOGRAM_COUNT; i++) {
+            SF_METRIC_HISTOGRAM_VALUES *values = &snapshot->histograms[i];
+            values->count += sf_atomic_load(&s->histograms[i].count);
+            values->sum += sf_atomic_load(&s->histograms[i].sum);
+            for (b = 0; b < SF_METRIC_BUCKET_COUNT; b++) {
+                values->buckets[b] += sf_atomic_load(&s->histograms[i].buckets[b]);
+            }
+        }
+    }
+    snapshot->result_set_memory = sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET);
+    snapshot->chunk_download_memory = sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+    snapshot->bind_memory = sf_memory_tag_used(SF_MEMORY_TAG_BIND);
+}
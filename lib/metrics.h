@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_METRICS_H
+#define SNOWFLAKE_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+
+/**
+ * Adds to a counter. The counters and histograms are sharded by thread, so that threads
+ * recording at the same time mostly don't touch the same cache lines.
+ */
+void STDCALL sf_metric_add(SF_METRIC_COUNTER counter, uint64 value);
+
+/**
+ * Records a value in microseconds in a histogram.
+ */
+void STDCALL sf_metric_record(SF_METRIC_HISTOGRAM histogram, uint64 value);
+
+/**
+ * @return the bucket of a histogram a value is counted in.
+ */
+int STDCALL sf_metric_bucket(uint64 value);
+
+/**
+ * Sums up the shards. Values recorded at the same time may be in the counts of a histogram
+ * and not yet in its sum, or the other way around.
+ */
+void STDCALL sf_metrics_snapshot(SF_METRICS_SNAPSHOT *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_METRICS_H
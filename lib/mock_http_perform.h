@@ -18,7 +18,31 @@ extern "C" {
 // This is just the mock interface
 sf_bool STDCALL __wrap_http_perform(CURL *curl, SF_REQUEST_TYPE request_type, char *url, SF_HEADER *header,
                                     char *body, cJSON **json, NON_JSON_RESP *non_json_resp, int64 network_timeout, sf_bool chunk_downloader,
-                                    SF_ERROR_STRUCT *error, sf_bool insecure_mode);
+                                    SF_ERROR_STRUCT *error, sf_bool insecure_mode,
+                                    int8 retry_on_curle_couldnt_connect_count,
+                                    const SF_RETRY_POLICY *retry_policy);
+
+/**
+ * Answers a request in place of the server.
+ *
+ * @param request_type POST or GET.
+ * @param url the full URL of the request, request ID included.
+ * @param body the body of the request, NULL for a GET.
+ * @param size set to the bytes of the response.
+ * @param user_data as given to mock_http_perform_set_responder().
+ * @return the body of the response, kept by the responder until the mock is done with the
+ *         request, or NULL to fail the request.
+ */
+typedef const char *(*MOCK_HTTP_RESPONDER)(SF_REQUEST_TYPE request_type, const char *url,
+                                           const char *body, size_t *size, void *user_data);
+
+/**
+ * Answers all the requests with a responder instead of the cmocka expectations, e.g. to
+ * replay recorded responses. Unlike the expectations the responder is called from any thread,
+ * the chunk downloader threads included, so it must be thread safe.
+ * Set it before connecting and back to NULL after the connection is gone.
+ */
+void STDCALL mock_http_perform_set_responder(MOCK_HTTP_RESPONDER responder, void *user_data);
 
 #endif
 
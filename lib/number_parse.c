@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include "number_parse.h"
+
+// Significant digits that always fit in a uint64
+#define SF_PARSE_MAX_DIGITS 19
+// Longest text the strtod() fallback copies to swap the decimal point of the locale
+#define SF_PARSE_FALLBACK_SIZE 128
+
+static const float64 float64_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float32 float32_pow10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static sf_bool is_digit(char c) {
+    return c >= '0' && c <= '9' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+static const char *skip_space(const char *p) {
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r')) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Parses the digits of an integer, starting at the first digit.
+ *
+ * @param p the first digit.
+ * @param limit the largest magnitude that is in range.
+ * @param magnitude set to the magnitude of the value.
+ * @param out_of_range set to true if the magnitude is larger than limit.
+ *
+ * @return the end of the digits.
+ */
+static const char *parse_magnitude(const char *p, uint64 limit, uint64 *magnitude,
+                                   sf_bool *out_of_range) {
+    uint64 m = 0;
+    unsigned int d;
+
+    *out_of_range = SF_BOOLEAN_FALSE;
+    for (; is_digit(*p); p++) {
+        d = (unsigned int) (*p - '0');
+        if (*out_of_range) {
+            continue;
+        }
+        if (m > (limit - d) / 10) {
+            *out_of_range = SF_BOOLEAN_TRUE;
+            continue;
+        }
+        m = m * 10 + d;
+    }
+    *magnitude = m;
+    return p;
+}
+
+const char *STDCALL sf_parse_int64(const char *str, int64 *value, sf_bool *out_of_range) {
+    const char *p = skip_space(str);
+    sf_bool negative = SF_BOOLEAN_FALSE;
+    uint64 limit;
+    uint64 magnitude;
+
+    *value = 0;
+    *out_of_range = SF_BOOLEAN_FALSE;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+        p++;
+    }
+    if (!is_digit(*p)) {
+        return str;
+    }
+
+    limit = negative ? (uint64) SF_INT64_MAX + 1 : (uint64) SF_INT64_MAX;
+    p = parse_magnitude(p, limit, &magnitude, out_of_range);
+    if (*out_of_range) {
+        *value = negative ? SF_INT64_MIN : SF_INT64_MAX;
+    } else if (negative) {
+        *value = magnitude == limit ? SF_INT64_MIN : -(int64) magnitude;
+    } else {
+        *value = (int64) magnitude;
+    }
+    return p;
+}
+
+const char *STDCALL sf_parse_uint64(const char *str, uint64 *value, sf_bool *out_of_range) {
+    const char *p = skip_space(str);
+    sf_bool negative = SF_BOOLEAN_FALSE;
+    uint64 magnitude;
+
+    *value = 0;
+    *out_of_range = SF_BOOLEAN_FALSE;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+        p++;
+    }
+    if (!is_digit(*p)) {
+        return str;
+    }
+
+    p = parse_magnitude(p, SF_UINT64_MAX, &magnitude, out_of_range);
+    if (*out_of_range) {
+        *value = SF_UINT64_MAX;
+    } else {
+        *value = negative ? (uint64) 0 - magnitude : magnitude;
+    }
+    return p;
+}
+
+/**
+ * Splits a decimal number into its significant digits and a power of ten.
+ *
+ * @return true if the number has at most SF_PARSE_MAX_DIGITS significant digits and is not in
+ *         a form only strtod() knows (hex, inf, nan), in which case end is set past the number.
+ */
+static sf_bool parse_decimal(const char *str, sf_bool *negative, uint64 *mantissa,
+                             int64 *exponent, const char **end) {
+    const char *p = skip_space(str);
+    const char *q;
+    uint64 m = 0;
+    int digits = 0;
+    int64 exp10 = 0;
+    int64 e = 0;
+    sf_bool any = SF_BOOLEAN_FALSE;
+    sf_bool exp_negative = SF_BOOLEAN_FALSE;
+
+    *negative = SF_BOOLEAN_FALSE;
+    if (*p == '-' || *p == '+') {
+        *negative = *p == '-' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+        p++;
+    }
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        return SF_BOOLEAN_FALSE;
+    }
+
+    for (; is_digit(*p); p++) {
+        any = SF_BOOLEAN_TRUE;
+        if (m == 0 && *p == '0') {
+            continue;
+        }
+        if (digits == SF_PARSE_MAX_DIGITS) {
+            return SF_BOOLEAN_FALSE;
+        }
+        m = m * 10 + (uint64) (*p - '0');
+        digits++;
+    }
+    if (*p == '.') {
+        for (p++; is_digit(*p); p++) {
+            any = SF_BOOLEAN_TRUE;
+            exp10--;
+            if (m == 0 && *p == '0') {
+                continue;
+            }
+            if (digits == SF_PARSE_MAX_DIGITS) {
+                return SF_BOOLEAN_FALSE;
+            }
+            m = m * 10 + (uint64) (*p - '0');
+            digits++;
+        }
+    }
+    if (!any) {
+        return SF_BOOLEAN_FALSE;
+    }
+
+    // The exponent belongs to the number only if it has digits
+    if (*p == 'e' || *p == 'E') {
+        q = p + 1;
+        if (*q == '-' || *q == '+') {
+            exp_negative = *q == '-' ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+            q++;
+        }
+        if (is_digit(*q)) {
+            for (; is_digit(*q); q++) {
+                if (e < 100000) {
+                    e = e * 10 + (*q - '0');
+                }
+            }
+            exp10 += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    *mantissa = m;
+    *exponent = exp10;
+    *end = p;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Calls strtod() or strtof() as if the locale were C, by swapping the decimal point for the
+ * one of the locale.
+ */
+static const char *parse_float_fallback(const char *str, sf_bool single, float64 *value,
+                                        sf_bool *out_of_range) {
+    char buffer[SF_PARSE_FALLBACK_SIZE];
+    const char *point = localeconv()->decimal_point;
+    const char *text = str;
+    char *end;
+    size_t len;
+    size_t i;
+
+    if (point && point[0] != '.' && point[0] != '\0' && point[1] == '\0' && strchr(str, '.')) {
+        len = strlen(str);
+        if (len < sizeof(buffer)) {
+            for (i = 0; i <= len; i++) {
+                buffer[i] = str[i] == '.' ? point[0] : str[i];
+            }
+            text = buffer;
+        }
+    }
+
+    errno = 0;
+    if (single) {
+        *value = strtof(text, &end);
+    } else {
+        *value = strtod(text, &end);
+    }
+    *out_of_range = errno == ERANGE ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    return str + (end - text);
+}
+
+const char *STDCALL sf_parse_float64(const char *str, float64 *value, sf_bool *out_of_range) {
+    sf_bool negative;
+    uint64 mantissa;
+    int64 exponent;
+    const char *end;
+
+    *out_of_range = SF_BOOLEAN_FALSE;
+    if (!parse_decimal(str, &negative, &mantissa, &exponent, &end)) {
+        return parse_float_fallback(str, SF_BOOLEAN_FALSE, value, out_of_range);
+    }
+    if (mantissa == 0) {
+        *value = negative ? -0.0 : 0.0;
+        return end;
+    }
+    // Both the mantissa and the power of ten are exact doubles, so one rounding is all it takes
+    if (mantissa > ((uint64) 1 << 53) || exponent < -22 || exponent > 22) {
+        return parse_float_fallback(str, SF_BOOLEAN_FALSE, value, out_of_range);
+    }
+    *value = exponent < 0 ? (float64) mantissa / float64_pow10[-exponent]
+                          : (float64) mantissa * float64_pow10[exponent];
+    if (negative) {
+        *value = -*value;
+    }
+    return end;
+}
+
+const char *STDCALL sf_parse_float32(const char *str, float32 *value, sf_bool *out_of_range) {
+    sf_bool negative;
+    uint64 mantissa;
+    int64 exponent;
+    const char *end;
+    float64 fallback;
+
+    *out_of_range = SF_BOOLEAN_FALSE;
+    if (!parse_decimal(str, &negative, &mantissa, &exponent, &end)) {
+        end = parse_float_fallback(str, SF_BOOLEAN_TRUE, &fallback, out_of_range);
+        *value = (float32) fallback;
+        return end;
+    }
+    if (mantissa == 0) {
+        *value = negative ? -0.0f : 0.0f;
+        return end;
+    }
+    if (mantissa > ((uint64) 1 << 24) || exponent < -10 || exponent > 10) {
+        end = parse_float_fallback(str, SF_BOOLEAN_TRUE, &fallback, out_of_range);
+        *value = (float32) fallback;
+        return end;
+    }
+    *value = exponent < 0 ? (float32) mantissa / float32_pow10[-exponent]
+                          : (float32) mantissa * float32_pow10[exponent];
+    if (negative) {
+        *value = -*value;
+    }
+    return end;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_NUMBER_PARSE_H
+#define SNOWFLAKE_NUMBER_PARSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * Parses a decimal integer the way strtoll(str, &end, 10) does in the C locale, whatever the
+ * locale of the process is. Leading whitespace and a sign are accepted.
+ *
+ * @param str the NUL-terminated text.
+ * @param value set to the value, or to SF_INT64_MIN / SF_INT64_MAX if it is out of range.
+ * @param out_of_range set to true if the value doesn't fit in an int64.
+ *
+ * @return the end of the number, or str if the text doesn't start with one.
+ */
+const char *STDCALL sf_parse_int64(const char *str, int64 *value, sf_bool *out_of_range);
+
+/**
+ * Parses a decimal integer the way strtoull(str, &end, 10) does in the C locale. As with
+ * strtoull, a negative value wraps around.
+ *
+ * @param str the NUL-terminated text.
+ * @param value set to the value, or to SF_UINT64_MAX if it is out of range.
+ * @param out_of_range set to true if the magnitude doesn't fit in a uint64.
+ *
+ * @return the end of the number, or str if the text doesn't start with one.
+ */
+const char *STDCALL sf_parse_uint64(const char *str, uint64 *value, sf_bool *out_of_range);
+
+/**
+ * Parses a decimal floating point number the way strtod() does in the C locale. Numbers with
+ * up to 19 significant digits and a small exponent are converted exactly without libc, other
+ * text (long mantissas, large exponents, inf, nan) goes through strtod().
+ *
+ * @param str the NUL-terminated text.
+ * @param value set to the value.
+ * @param out_of_range set to true if strtod() would set errno to ERANGE.
+ *
+ * @return the end of the number, or str if the text doesn't start with one.
+ */
+const char *STDCALL sf_parse_float64(const char *str, float64 *value, sf_bool *out_of_range);
+
+/**
+ * Same as sf_parse_float64(), for a float32 the way strtof() parses it.
+ */
+const char *STDCALL sf_parse_float32(const char *str, float32 *value, sf_bool *out_of_range);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_NUMBER_PARSE_H
@@ -10,7 +10,7 @@ void STDCALL sf_param_store_init(PARAM_TYPE ptype, void **ps)
     {
         case NAMED:
             pstore->param_style = NAMED;
-            pstore->tree_map = sf_treemap_init();
+            pstore->hash_map = sf_hashmap_init(0);
             break;
         case POSITIONAL:
             pstore->param_style = POSITIONAL;
@@ -33,11 +33,38 @@ void STDCALL sf_param_store_deallocate(void *ps)
     }
     else if (pstore->param_style == NAMED)
     {
-        sf_treemap_deallocate(pstore->tree_map);
+        sf_hashmap_deallocate(pstore->hash_map);
     }
     SF_FREE(pstore);
 }
 
+void STDCALL sf_param_store_reserve(void *ps, size_t count)
+{
+    PARAM_STORE *pstore = (PARAM_STORE *)ps;
+    if (pstore->param_style == POSITIONAL)
+    {
+        // Positions start at 1
+        sf_array_list_reserve(pstore->array_list, count + 1);
+    }
+    else if (pstore->param_style == NAMED)
+    {
+        sf_hashmap_reserve(pstore->hash_map, count);
+    }
+}
+
+void STDCALL sf_param_store_clear(void *ps)
+{
+    PARAM_STORE *pstore = (PARAM_STORE *)ps;
+    if (pstore->param_style == POSITIONAL)
+    {
+        sf_array_list_clear(pstore->array_list);
+    }
+    else if (pstore->param_style == NAMED)
+    {
+        sf_hashmap_clear(pstore->hash_map);
+    }
+}
+
 SF_INT_RET_CODE STDCALL sf_param_store_set(void *ps,
                                 void *item,
                                 size_t idx,
@@ -56,7 +83,7 @@ SF_INT_RET_CODE STDCALL sf_param_store_set(void *ps,
     }
     else if (pstore->param_style == NAMED)
     {
-        retval = sf_treemap_set(pstore->tree_map, item, name);
+        retval = sf_hashmap_set(pstore->hash_map, item, name);
     }
     return retval;
 }
@@ -79,7 +106,32 @@ void *STDCALL sf_param_store_get(void *ps, size_t index, char *key)
             log_error("sf_param_store_get: Key NULL for named params \n");
             return NULL;
         }
-        return sf_treemap_get(pstore->tree_map, key);
+        return sf_hashmap_get(pstore->hash_map, key);
     }
     return NULL;
+}
+
+SF_INT_RET_CODE STDCALL sf_param_store_set_named(void *ps,
+                                                 void *item,
+                                                 char *name,
+                                                 uint64 hash)
+{
+    PARAM_STORE *pstore = (PARAM_STORE *)ps;
+    if (pstore->param_style != NAMED)
+    {
+        return SF_INT_RET_CODE_ERROR;
+    }
+    return sf_hashmap_set_hashed(pstore->hash_map, item, name, hash);
+}
+
+void *STDCALL sf_param_store_get_named(void *ps,
+                                       const char *name,
+                                       uint64 hash)
+{
+    PARAM_STORE *pstore = (PARAM_STORE *)ps;
+    if (pstore->param_style != NAMED || !name)
+    {
+        return NULL;
+    }
+    return sf_hashmap_get_hashed(pstore->hash_map, name, hash);
 }
\ No newline at end of file
@@ -10,7 +10,7 @@ extern "C" {
 #endif
 
 #include "memory.h"
-#include "treemap.h"
+#include "hashmap.h"
 #include "arraylist.h"
 
 typedef enum {
@@ -24,7 +24,7 @@ typedef struct param_store
     PARAM_TYPE param_style;
     union
     {
-        TREE_MAP *tree_map;
+        HASH_MAP *hash_map;
         ARRAY_LIST *array_list;
     };
 }PARAM_STORE;
@@ -34,6 +34,16 @@ void STDCALL sf_param_store_init(PARAM_TYPE ptype,
 
 void STDCALL sf_param_store_deallocate(void *ps);
 
+/*
+ * Makes room for count params, so that binding them doesn't grow the store.
+ */
+void STDCALL sf_param_store_reserve(void *ps, size_t count);
+
+/*
+ * Removes all params, keeping the memory of the store for binding the next ones.
+ */
+void STDCALL sf_param_store_clear(void *ps);
+
 SF_INT_RET_CODE STDCALL sf_param_store_set(void *ps,
                                 void *item,
                                 size_t idx,
@@ -42,6 +52,19 @@ SF_INT_RET_CODE STDCALL sf_param_store_set(void *ps,
 void *STDCALL sf_param_store_get(void *ps,
                                  size_t index,
                                  char *key);
+
+/*
+ * Same as sf_param_store_set and sf_param_store_get for named params,
+ * with the hash of the name from sf_hashmap_hash computed beforehand.
+ */
+SF_INT_RET_CODE STDCALL sf_param_store_set_named(void *ps,
+                                                 void *item,
+                                                 char *name,
+                                                 uint64 hash);
+
+void *STDCALL sf_param_store_get_named(void *ps,
+                                       const char *name,
+                                       uint64 hash);
 #ifdef __cplusplus
 }
 #endif
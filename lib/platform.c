@@ -326,6 +326,131 @@ void STDCALL _thread_exit() {
 #endif
 }
 
+#if defined(SF_LOCK_PROFILING) && !defined(_WIN32)
+
+// Locks held by a thread that are timed, the ones nested deeper aren't
+#define LOCK_PROFILE_MAX_HELD 16
+
+typedef struct LOCK_PROFILE_HELD {
+    const void *lock;
+    unsigned long long acquired_ns;
+} LOCK_PROFILE_HELD;
+
+static SF_LOCK_STATS lock_stats[SF_LOCK_KIND_COUNT];
+static __thread LOCK_PROFILE_HELD lock_profile_held[LOCK_PROFILE_MAX_HELD];
+static __thread int lock_profile_held_count = 0;
+
+static unsigned long long lock_profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000 + (unsigned long long) ts.tv_nsec;
+}
+
+static void lock_profile_max(unsigned long long *max, unsigned long long value) {
+    unsigned long long current = sf_atomic_load(max);
+    while (value > current && !sf_atomic_compare_exchange(max, current, value)) {
+        current = sf_atomic_load(max);
+    }
+}
+
+static void lock_profile_hold(const void *lock) {
+    if (lock_profile_held_count < LOCK_PROFILE_MAX_HELD) {
+        lock_profile_held[lock_profile_held_count].lock = lock;
+        lock_profile_held[lock_profile_held_count].acquired_ns = lock_profile_now();
+        lock_profile_held_count++;
+    }
+}
+
+/**
+ * Records an acquisition, wait_begin_ns is 0 if the lock was free.
+ */
+static void lock_profile_acquired(SF_LOCK_KIND kind, const void *lock,
+                                  unsigned long long wait_begin_ns) {
+    SF_LOCK_STATS *stats = &lock_stats[kind];
+    sf_atomic_fetch_add(&stats->acquisitions, 1);
+    if (wait_begin_ns) {
+        unsigned long long waited = lock_profile_now() - wait_begin_ns;
+        sf_atomic_fetch_add(&stats->contended, 1);
+        sf_atomic_fetch_add(&stats->wait_ns, waited);
+        lock_profile_max(&stats->max_wait_ns, waited);
+    }
+    lock_profile_hold(lock);
+}
+
+static void lock_profile_released(SF_LOCK_KIND kind, const void *lock) {
+    SF_LOCK_STATS *stats = &lock_stats[kind];
+    int i;
+    // Locks aren't always released in the reverse order they were taken in
+    for (i = lock_profile_held_count - 1; i >= 0; i--) {
+        if (lock_profile_held[i].lock == lock) {
+            unsigned long long held = lock_profile_now() - lock_profile_held[i].acquired_ns;
+            sf_atomic_fetch_add(&stats->hold_ns, held);
+            lock_profile_max(&stats->max_hold_ns, held);
+            memmove(&lock_profile_held[i], &lock_profile_held[i + 1],
+                    (size_t) (lock_profile_held_count - i - 1) * sizeof(LOCK_PROFILE_HELD));
+            lock_profile_held_count--;
+            return;
+        }
+    }
+}
+
+// Only the acquisitions finding the lock taken read the clock twice
+#define PROFILED_LOCK(kind, lock, try_lock, blocking_lock) \
+    do { \
+        unsigned long long wait_begin_ns = 0; \
+        int ret = try_lock(lock); \
+        if (ret == EBUSY) { \
+            wait_begin_ns = lock_profile_now(); \
+            ret = blocking_lock(lock); \
+        } \
+        if (ret == 0) { \
+            lock_profile_acquired(kind, lock, wait_begin_ns); \
+        } \
+        return ret; \
+    } while (0)
+#define LOCK_PROFILE_RELEASED(kind, lock) lock_profile_released(kind, lock)
+#define LOCK_PROFILE_HOLD(lock) lock_profile_hold(lock)
+
+#else
+
+#define PROFILED_LOCK(kind, lock, try_lock, blocking_lock) return blocking_lock(lock)
+#define LOCK_PROFILE_RELEASED(kind, lock)
+#define LOCK_PROFILE_HOLD(lock)
+
+#endif
+
+int STDCALL sf_lock_stats_get(SF_LOCK_STATS *stats) {
+#if defined(SF_LOCK_PROFILING) && !defined(_WIN32)
+    int i;
+    for (i = 0; i < SF_LOCK_KIND_COUNT; i++) {
+        stats[i].acquisitions = sf_atomic_load(&lock_stats[i].acquisitions);
+        stats[i].contended = sf_atomic_load(&lock_stats[i].contended);
+        stats[i].wait_ns = sf_atomic_load(&lock_stats[i].wait_ns);
+        stats[i].max_wait_ns = sf_atomic_load(&lock_stats[i].max_wait_ns);
+        stats[i].hold_ns = sf_atomic_load(&lock_stats[i].hold_ns);
+        stats[i].max_hold_ns = sf_atomic_load(&lock_stats[i].max_hold_ns);
+    }
+    return 1;
+#else
+    memset(stats, 0, SF_LOCK_KIND_COUNT * sizeof(SF_LOCK_STATS));
+    return 0;
+#endif
+}
+
+void STDCALL sf_lock_stats_reset(void) {
+#if defined(SF_LOCK_PROFILING) && !defined(_WIN32)
+    int i;
+    for (i = 0; i < SF_LOCK_KIND_COUNT; i++) {
+        sf_atomic_store(&lock_stats[i].acquisitions, 0);
+        sf_atomic_store(&lock_stats[i].contended, 0);
+        sf_atomic_store(&lock_stats[i].wait_ns, 0);
+        sf_atomic_store(&lock_stats[i].max_wait_ns, 0);
+        sf_atomic_store(&lock_stats[i].hold_ns, 0);
+        sf_atomic_store(&lock_stats[i].max_hold_ns, 0);
+    }
+#endif
+}
+
 int STDCALL _cond_init(SF_CONDITION_HANDLE *cond) {
 #ifdef _WIN32
     InitializeConditionVariable(cond);
@@ -359,7 +484,33 @@ _cond_wait(SF_CONDITION_HANDLE *cond, SF_CRITICAL_SECTION_HANDLE *crit) {
     BOOL ret = SleepConditionVariableCS(cond, crit, INFINITE);
     return ret ? 0 : 1;
 #else
-    return pthread_cond_wait(cond, crit);
+    int ret;
+    LOCK_PROFILE_RELEASED(SF_LOCK_CRITICAL_SECTION, crit);
+    ret = pthread_cond_wait(cond, crit);
+    LOCK_PROFILE_HOLD(crit);
+    return ret;
+#endif
+}
+
+int STDCALL
+_cond_timed_wait(SF_CONDITION_HANDLE *cond, SF_CRITICAL_SECTION_HANDLE *crit, unsigned int ms) {
+#ifdef _WIN32
+    BOOL ret = SleepConditionVariableCS(cond, crit, ms);
+    return ret ? 0 : 1;
+#else
+    struct timespec ts;
+    int ret;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long) (ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    LOCK_PROFILE_RELEASED(SF_LOCK_CRITICAL_SECTION, crit);
+    ret = pthread_cond_timedwait(cond, crit, &ts);
+    LOCK_PROFILE_HOLD(crit);
+    return ret;
 #endif
 }
 
@@ -372,9 +523,15 @@ int STDCALL _cond_term(SF_CONDITION_HANDLE *cond) {
 #endif
 }
 
+#ifdef _WIN32
+// Spins of a contended critical section before it waits, as the heap of Windows does
+#define SF_CRITICAL_SECTION_SPIN_COUNT 4000
+#endif
+
 int STDCALL _critical_section_init(SF_CRITICAL_SECTION_HANDLE *crit) {
 #ifdef _WIN32
-    InitializeCriticalSection(crit);
+    // Spin a while before waiting in the kernel, the sections are held briefly
+    InitializeCriticalSectionAndSpinCount(crit, SF_CRITICAL_SECTION_SPIN_COUNT);
     return 0;
 #else
     return pthread_mutex_init(crit, NULL);
@@ -386,7 +543,7 @@ int STDCALL _critical_section_lock(SF_CRITICAL_SECTION_HANDLE *crit) {
     EnterCriticalSection(crit);
     return 0;
 #else
-    return pthread_mutex_lock(crit);
+    PROFILED_LOCK(SF_LOCK_CRITICAL_SECTION, crit, pthread_mutex_trylock, pthread_mutex_lock);
 #endif
 }
 
@@ -395,6 +552,7 @@ int STDCALL _critical_section_unlock(SF_CRITICAL_SECTION_HANDLE *crit) {
     LeaveCriticalSection(crit);
     return 0;
 #else
+    LOCK_PROFILE_RELEASED(SF_LOCK_CRITICAL_SECTION, crit);
     return pthread_mutex_unlock(crit);
 #endif
 }
@@ -422,7 +580,7 @@ int STDCALL _rwlock_rdlock(SF_RWLOCK_HANDLE *lock) {
     AcquireSRWLockShared(lock);
     return 0;
 #else
-    return pthread_rwlock_rdlock(lock);
+    PROFILED_LOCK(SF_LOCK_RWLOCK_READ, lock, pthread_rwlock_tryrdlock, pthread_rwlock_rdlock);
 #endif
 }
 
@@ -431,6 +589,7 @@ int STDCALL _rwlock_rdunlock(SF_RWLOCK_HANDLE *lock) {
     ReleaseSRWLockShared(lock);
     return 0;
 #else
+    LOCK_PROFILE_RELEASED(SF_LOCK_RWLOCK_READ, lock);
     return pthread_rwlock_unlock(lock);
 #endif
 }
@@ -440,7 +599,7 @@ int STDCALL _rwlock_wrlock(SF_RWLOCK_HANDLE *lock) {
     AcquireSRWLockExclusive(lock);
     return 0;
 #else
-    return pthread_rwlock_wrlock(lock);
+    PROFILED_LOCK(SF_LOCK_RWLOCK_WRITE, lock, pthread_rwlock_trywrlock, pthread_rwlock_wrlock);
 #endif
 }
 
@@ -449,6 +608,7 @@ int STDCALL _rwlock_wrunlock(SF_RWLOCK_HANDLE *lock) {
     ReleaseSRWLockExclusive(lock);
     return 0;
 #else
+    LOCK_PROFILE_RELEASED(SF_LOCK_RWLOCK_WRITE, lock);
     return pthread_rwlock_unlock(lock);
 #endif
 }
@@ -464,11 +624,9 @@ int STDCALL _rwlock_term(SF_RWLOCK_HANDLE *lock) {
 
 int STDCALL _mutex_init(SF_MUTEX_HANDLE *lock) {
 #ifdef _WIN32
-    *lock = CreateMutex(
-        NULL,  // default security attribute
-        FALSE, // initially not owned
-        NULL   // unnamed mutext
-    );
+    // Taken in user mode unless contended, unlike a kernel mutex. Not recursive, as on
+    // the other platforms.
+    InitializeSRWLock(lock);
     return 0;
 #else
     return pthread_mutex_init(lock, NULL);
@@ -477,31 +635,151 @@ int STDCALL _mutex_init(SF_MUTEX_HANDLE *lock) {
 
 int STDCALL _mutex_lock(SF_MUTEX_HANDLE *lock) {
 #ifdef _WIN32
-    DWORD ret = WaitForSingleObject(*lock, INFINITE);
-    return ret == WAIT_OBJECT_0 ? 0 : 1;
+    AcquireSRWLockExclusive(lock);
+    return 0;
 #else
-    return pthread_mutex_lock(lock);
+    PROFILED_LOCK(SF_LOCK_MUTEX, lock, pthread_mutex_trylock, pthread_mutex_lock);
 #endif
 }
 
 int STDCALL _mutex_unlock(SF_MUTEX_HANDLE *lock) {
 #ifdef _WIN32
-    ReleaseMutex(*lock);
+    ReleaseSRWLockExclusive(lock);
     return 0;
 #else
+    LOCK_PROFILE_RELEASED(SF_LOCK_MUTEX, lock);
     return pthread_mutex_unlock(lock);
 #endif
 }
 
 int STDCALL _mutex_term(SF_MUTEX_HANDLE *lock) {
 #ifdef _WIN32
-    CloseHandle(*lock);
+    // An SRW lock holds no resources
     return 0;
 #else
     return pthread_mutex_destroy(lock);
 #endif
 }
 
+unsigned long long STDCALL
+sf_atomic_fetch_add(volatile unsigned long long *ptr, unsigned long long value) {
+#ifdef _WIN32
+    return (unsigned long long) InterlockedExchangeAdd64((volatile LONG64 *) ptr, (LONG64) value);
+#else
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+unsigned long long STDCALL
+sf_atomic_fetch_sub(volatile unsigned long long *ptr, unsigned long long value) {
+#ifdef _WIN32
+    return (unsigned long long) InterlockedExchangeAdd64((volatile LONG64 *) ptr, -((LONG64) value));
+#else
+    return __atomic_fetch_sub(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+unsigned long long STDCALL sf_atomic_load(volatile unsigned long long *ptr) {
+#ifdef _WIN32
+    return (unsigned long long) InterlockedCompareExchange64((volatile LONG64 *) ptr, 0, 0);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void STDCALL sf_atomic_store(volatile unsigned long long *ptr, unsigned long long value) {
+#ifdef _WIN32
+    InterlockedExchange64((volatile LONG64 *) ptr, (LONG64) value);
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int STDCALL sf_atomic_compare_exchange(volatile unsigned long long *ptr, unsigned long long expected,
+                                       unsigned long long desired) {
+#ifdef _WIN32
+    return InterlockedCompareExchange64((volatile LONG64 *) ptr, (LONG64) desired,
+                                        (LONG64) expected) == (LONG64) expected;
+#else
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_SEQ_CST);
+#endif
+}
+
+void *STDCALL sf_atomic_load_ptr(void *volatile *ptr) {
+#ifdef _WIN32
+    return InterlockedCompareExchangePointer(ptr, NULL, NULL);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void STDCALL sf_atomic_store_ptr(void *volatile *ptr, void *value) {
+#ifdef _WIN32
+    InterlockedExchangePointer(ptr, value);
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void *STDCALL sf_atomic_exchange_ptr(void *volatile *ptr, void *value) {
+#ifdef _WIN32
+    return InterlockedExchangePointer(ptr, value);
+#else
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+unsigned long long STDCALL sf_monotonic_time_ms(void) {
+#ifdef _WIN32
+    return (unsigned long long) GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000 + (unsigned long long) ts.tv_nsec / 1000000;
+#endif
+}
+
+unsigned long long STDCALL sf_monotonic_time_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (unsigned long long) (counter.QuadPart / frequency.QuadPart * 1000000 +
+                                 counter.QuadPart % frequency.QuadPart * 1000000 /
+                                 frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000 + (unsigned long long) ts.tv_nsec / 1000;
+#endif
+}
+
+unsigned long long STDCALL sf_unix_time_ns(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER t;
+    GetSystemTimeAsFileTime(&ft);
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    // 100 ns intervals since 1601-01-01
+    return (t.QuadPart - 116444736000000000ULL) * 100;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + (unsigned long long) ts.tv_nsec;
+#endif
+}
+
+void STDCALL sf_sleep_ms(unsigned int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000); // usleep takes sleep time in us (1 millionth of a second)
+#endif
+}
+
 sf_bool STDCALL _is_put_get_command(char *sql_text) {
 #ifdef _WIN32
   // TODO use some library to parse put get command in windows
@@ -693,7 +971,9 @@ void STDCALL sf_log_timestamp(char *tsbuf, size_t tsbufsize) {
     /* Get current time */
     struct timeval tmnow;
     gettimeofday(&tmnow, NULL);
-    struct tm *lt = gmtime(&tmnow.tv_sec);
+    // Called by every thread logging, outside of the log lock
+    struct tm tm_buf;
+    struct tm *lt = gmtime_r(&tmnow.tv_sec, &tm_buf);
     char msec[10];    /* Microsecond buffer */
 
     sb_sprintf(msec, sizeof(msec), "%03d", (int) tmnow.tv_usec / 1000);
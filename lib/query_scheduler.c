@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "query_scheduler.h"
+#include "connection.h"
+#include "memory.h"
+#include "metrics.h"
+
+/**
+ * A caller waiting for a slot, on its own stack. Each has its condition so that a slot given
+ * back wakes the one it goes to only.
+ */
+typedef struct SF_SCHEDULER_WAITER {
+    SF_CONDITION_HANDLE cond;
+    sf_bool granted;
+    struct SF_SCHEDULER_WAITER *next;
+} SF_SCHEDULER_WAITER;
+
+typedef struct SF_SCHEDULER_QUEUE {
+    uint64 in_use;
+    uint64 waiting;
+    // FIFO of the waiters of each priority
+    SF_SCHEDULER_WAITER *head[SF_QUERY_PRIORITY_COUNT];
+    SF_SCHEDULER_WAITER *tail[SF_QUERY_PRIORITY_COUNT];
+    // Slots each priority may still get in the current round
+    uint64 credits[SF_QUERY_PRIORITY_COUNT];
+} SF_SCHEDULER_QUEUE;
+
+struct SF_SCHEDULER_POOL {
+    char *account;
+    char *warehouse;
+    SF_SCHEDULER_QUEUE queues[SF_SCHEDULER_RESOURCE_COUNT];
+    struct SF_SCHEDULER_POOL *next;
+};
+
+static const uint64 scheduler_weights[SF_QUERY_PRIORITY_COUNT] = {
+    SF_SCHEDULER_WEIGHT_HIGH,
+    SF_SCHEDULER_WEIGHT_NORMAL,
+    SF_SCHEDULER_WEIGHT_LOW
+};
+
+static SF_CRITICAL_SECTION_HANDLE scheduler_lock;
+static uint64 scheduler_limits[SF_SCHEDULER_RESOURCE_COUNT];
+static SF_SCHEDULER_POOL *scheduler_pools = NULL;
+
+static void STDCALL reset_credits(SF_SCHEDULER_QUEUE *queue) {
+    int i;
+    for (i = 0; i < SF_QUERY_PRIORITY_COUNT; i++) {
+        queue->credits[i] = scheduler_weights[i];
+    }
+}
+
+/**
+ * Takes the next waiter out of the queues: the first one of the highest priority with credits
+ * left, or once the priorities with waiters have used up their credits, the first one of a new
+ * round. Called with scheduler_lock taken.
+ */
+static SF_SCHEDULER_WAITER *STDCALL next_waiter(SF_SCHEDULER_QUEUE *queue) {
+    SF_SCHEDULER_WAITER *waiter;
+    int round;
+    int i;
+
+    if (queue->waiting == 0) {
+        return NULL;
+    }
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < SF_QUERY_PRIORITY_COUNT; i++) {
+            if (queue->head[i] && queue->credits[i] > 0) {
+                waiter = queue->head[i];
+                queue->head[i] = waiter->next;
+                if (!queue->head[i]) {
+                    queue->tail[i] = NULL;
+                }
+                queue->credits[i]--;
+                queue->waiting--;
+                return waiter;
+            }
+        }
+        reset_credits(queue);
+    }
+    return NULL;
+}
+
+static void STDCALL grant(SF_SCHEDULER_WAITER *waiter) {
+    waiter->granted = SF_BOOLEAN_TRUE;
+    _cond_signal(&waiter->cond);
+}
+
+/**
+ * Lets waiters in while slots are left. Called with scheduler_lock taken.
+ */
+static void STDCALL admit_waiters(SF_SCHEDULER_QUEUE *queue, uint64 limit) {
+    SF_SCHEDULER_WAITER *waiter;
+    while ((limit == 0 || queue->in_use < limit) && (waiter = next_waiter(queue)) != NULL) {
+        queue->in_use++;
+        grant(waiter);
+    }
+}
+
+void STDCALL sf_scheduler_init() {
+    int i;
+    _critical_section_init(&scheduler_lock);
+    for (i = 0; i < SF_SCHEDULER_RESOURCE_COUNT; i++) {
+        scheduler_limits[i] = 0;
+    }
+    scheduler_pools = NULL;
+}
+
+void STDCALL sf_scheduler_term() {
+    SF_SCHEDULER_POOL *pool;
+    while ((pool = scheduler_pools) != NULL) {
+        scheduler_pools = pool->next;
+        SF_FREE(pool->account);
+        SF_FREE(pool->warehouse);
+        SF_FREE(pool);
+    }
+    _critical_section_term(&scheduler_lock);
+}
+
+void STDCALL sf_scheduler_set_limit(SF_SCHEDULER_RESOURCE resource, uint64 limit) {
+    SF_SCHEDULER_POOL *pool;
+    _critical_section_lock(&scheduler_lock);
+    scheduler_limits[resource] = limit;
+    for (pool = scheduler_pools; pool; pool = pool->next) {
+        admit_waiters(&pool->queues[resource], limit);
+    }
+    _critical_section_unlock(&scheduler_lock);
+}
+
+uint64 STDCALL sf_scheduler_get_limit(SF_SCHEDULER_RESOURCE resource) {
+    uint64 limit;
+    _critical_section_lock(&scheduler_lock);
+    limit = scheduler_limits[resource];
+    _critical_section_unlock(&scheduler_lock);
+    return limit;
+}
+
+SF_SCHEDULER_POOL *STDCALL sf_scheduler_pool(const char *account, const char *warehouse) {
+    SF_SCHEDULER_POOL *pool;
+    int i;
+
+    _critical_section_lock(&scheduler_lock);
+    for (pool = scheduler_pools; pool; pool = pool->next) {
+        if (sf_same_name(pool->account, account) && sf_same_name(pool->warehouse, warehouse)) {
+            break;
+        }
+    }
+    if (!pool && (pool = (SF_SCHEDULER_POOL *) SF_CALLOC(1, sizeof(SF_SCHEDULER_POOL))) != NULL) {
+        pool->account = sf_copy_name(account);
+        pool->warehouse = sf_copy_name(warehouse);
+        if ((account && !pool->account) || (warehouse && !pool->warehouse)) {
+            SF_FREE(pool->account);
+            SF_FREE(pool->warehouse);
+            SF_FREE(pool);
+        } else {
+            for (i = 0; i < SF_SCHEDULER_RESOURCE_COUNT; i++) {
+                reset_credits(&pool->queues[i]);
+            }
+            pool->next = scheduler_pools;
+            scheduler_pools = pool;
+        }
+    }
+    _critical_section_unlock(&scheduler_lock);
+    return pool;
+}
+
+void STDCALL sf_scheduler_acquire(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource,
+                                  SF_QUERY_PRIORITY priority) {
+    SF_SCHEDULER_QUEUE *queue;
+    SF_SCHEDULER_WAITER waiter;
+    uint64 limit;
+    uint64 wait_start;
+
+    if (!pool) {
+        return;
+    }
+    if ((int) priority < 0 || priority >= SF_QUERY_PRIORITY_COUNT) {
+        priority = SF_QUERY_PRIORITY_NORMAL;
+    }
+    queue = &pool->queues[resource];
+
+    _critical_section_lock(&scheduler_lock);
+    limit = scheduler_limits[resource];
+    // Waiters go first, a slot is only free with nobody waiting once they are all in
+    if (limit == 0 || (queue->in_use < limit && queue->waiting == 0)) {
+        queue->in_use++;
+        _critical_section_unlock(&scheduler_lock);
+        return;
+    }
+
+    _cond_init(&waiter.cond);
+    waiter.granted = SF_BOOLEAN_FALSE;
+    waiter.next = NULL;
+    if (queue->tail[priority]) {
+        queue->tail[priority]->next = &waiter;
+    } else {
+        queue->head[priority] = &waiter;
+    }
+    queue->tail[priority] = &waiter;
+    queue->waiting++;
+    log_debug("Waiting for one of the %llu %s slots of %s/%s, %llu waiting",
+              (unsigned long long) limit,
+              resource == SF_SCHEDULER_QUERIES ? "query" : "chunk download",
+              pool->account, pool->warehouse, (unsigned long long) queue->waiting);
+
+    wait_start = sf_monotonic_time_us();
+    while (!waiter.granted) {
+        _cond_wait(&waiter.cond, &scheduler_lock);
+    }
+    _critical_section_unlock(&scheduler_lock);
+    _cond_term(&waiter.cond);
+    sf_metric_record(SF_HISTOGRAM_SCHEDULER_WAIT_TIME, sf_monotonic_time_us() - wait_start);
+}
+
+sf_bool STDCALL sf_scheduler_try_acquire(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource) {
+    SF_SCHEDULER_QUEUE *queue;
+    uint64 limit;
+    sf_bool taken = SF_BOOLEAN_FALSE;
+
+    if (!pool) {
+        return SF_BOOLEAN_TRUE;
+    }
+    queue = &pool->queues[resource];
+    _critical_section_lock(&scheduler_lock);
+    limit = scheduler_limits[resource];
+    if (limit == 0 || (queue->in_use < limit && queue->waiting == 0)) {
+        queue->in_use++;
+        taken = SF_BOOLEAN_TRUE;
+    }
+    _critical_section_unlock(&scheduler_lock);
+    return taken;
+}
+
+void STDCALL sf_scheduler_release(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource) {
+    SF_SCHEDULER_QUEUE *queue;
+    SF_SCHEDULER_WAITER *waiter;
+    uint64 limit;
+
+    if (!pool) {
+        return;
+    }
+    queue = &pool->queues[resource];
+    _critical_section_lock(&scheduler_lock);
+    limit = scheduler_limits[resource];
+    // The slot goes over to the next waiter as it is, unless the limit was lowered below it
+    if ((limit == 0 || queue->in_use <= limit) && (waiter = next_waiter(queue)) != NULL) {
+        grant(waiter);
+    } else if (queue->in_use > 0) {
+        queue->in_use--;
+    }
+    _critical_section_unlock(&scheduler_lock);
+}
+
+uint64 STDCALL sf_scheduler_in_use(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource) {
+    uint64 in_use;
+    if (!pool) {
+        return 0;
+    }
+    _critical_section_lock(&scheduler_lock);
+    in_use = pool->queues[resource].in_use;
+    _critical_section_unlock(&scheduler_lock);
+    return in_use;
+}
+
+uint64 STDCALL sf_scheduler_waiting(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource) {
+    uint64 waiting;
+    if (!pool) {
+        return 0;
+    }
+    _critical_section_lock(&scheduler_lock);
+    waiting = pool->queues[resource].waiting;
+    _critical_section_unlock(&scheduler_lock);
+    return waiting;
+}
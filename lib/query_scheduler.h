@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_QUERY_SCHEDULER_H
+#define SNOWFLAKE_QUERY_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+/**
+ * What the scheduler hands out slots of.
+ */
+typedef enum SF_SCHEDULER_RESOURCE {
+    // Query requests sent and not answered yet, their polling included
+    SF_SCHEDULER_QUERIES,
+    // Result chunk GETs in flight
+    SF_SCHEDULER_CHUNK_DOWNLOADS,
+    SF_SCHEDULER_RESOURCE_COUNT
+} SF_SCHEDULER_RESOURCE;
+
+/**
+ * Slots given to the waiters of each priority in a round of the queues, when all have waiters.
+ */
+#define SF_SCHEDULER_WEIGHT_HIGH 4
+#define SF_SCHEDULER_WEIGHT_NORMAL 2
+#define SF_SCHEDULER_WEIGHT_LOW 1
+
+/**
+ * Slots of an account and warehouse, shared by all the connections to them.
+ */
+typedef struct SF_SCHEDULER_POOL SF_SCHEDULER_POOL;
+
+/**
+ * Process-wide admission control of the queries and of the chunk downloads. Each account and
+ * warehouse has a pool of slots per resource, at most the limit of the resource in use at a
+ * time. A caller finding no slot left waits in the queue of its priority, and a slot given
+ * back goes straight to a waiter, so that a burst of callers doesn't thrash on the lock. The
+ * queues of the priorities are served in weighted round robin, see SF_SCHEDULER_WEIGHT_HIGH,
+ * for the high priority work to go first without starving the low priority one.
+ */
+void STDCALL sf_scheduler_init();
+
+void STDCALL sf_scheduler_term();
+
+/**
+ * Sets the slots of a resource in each pool, 0 for no limit. Waiters are let in right away if
+ * the limit is raised, while slots already taken above a lowered limit are kept.
+ */
+void STDCALL sf_scheduler_set_limit(SF_SCHEDULER_RESOURCE resource, uint64 limit);
+
+/**
+ * @return the slots of a resource in each pool, 0 for no limit.
+ */
+uint64 STDCALL sf_scheduler_get_limit(SF_SCHEDULER_RESOURCE resource);
+
+/**
+ * Gets the pool of an account and warehouse, created the first time. Pools are kept until
+ * sf_scheduler_term().
+ *
+ * @param account the account, NULL for none.
+ * @param warehouse the warehouse, NULL for none.
+ *
+ * @return the pool, NULL when out of memory, for the calls below to do nothing then.
+ */
+SF_SCHEDULER_POOL *STDCALL sf_scheduler_pool(const char *account, const char *warehouse);
+
+/**
+ * Takes a slot of a pool, waiting for one if none is left.
+ */
+void STDCALL sf_scheduler_acquire(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource,
+                                  SF_QUERY_PRIORITY priority);
+
+/**
+ * Takes a slot of a pool if one is left and nobody waits for it.
+ *
+ * @return SF_BOOLEAN_TRUE if a slot was taken.
+ */
+sf_bool STDCALL sf_scheduler_try_acquire(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource);
+
+/**
+ * Gives back a slot taken with sf_scheduler_acquire() or sf_scheduler_try_acquire().
+ */
+void STDCALL sf_scheduler_release(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource);
+
+/**
+ * @return the slots of a pool taken and not given back.
+ */
+uint64 STDCALL sf_scheduler_in_use(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource);
+
+/**
+ * @return the callers waiting for a slot of a pool.
+ */
+uint64 STDCALL sf_scheduler_waiting(SF_SCHEDULER_POOL *pool, SF_SCHEDULER_RESOURCE resource);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_QUERY_SCHEDULER_H
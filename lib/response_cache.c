@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "response_cache.h"
+#include "hashmap.h"
+#include "memory.h"
+
+static char *copy_string(const char *str, size_t len) {
+    char *copy = (char *) SF_MALLOC(len + 1);
+    if (copy) {
+        memcpy(copy, str, len + 1);
+    }
+    return copy;
+}
+
+static void remove_entry(SF_RESPONSE_CACHE *cache, SF_RESPONSE_CACHE_ENTRY *entry) {
+    SF_FREE(entry->key);
+    SF_FREE(entry->context);
+    SF_FREE(entry->response);
+    cache->bytes -= entry->response_size;
+    // The last entry takes the place of the removed one
+    *entry = cache->entries[--cache->count];
+    memset(&cache->entries[cache->count], 0, sizeof(SF_RESPONSE_CACHE_ENTRY));
+}
+
+static sf_bool is_expired(SF_RESPONSE_CACHE *cache, SF_RESPONSE_CACHE_ENTRY *entry,
+                          uint64 now) {
+    return cache->ttl_ms > 0 && now - entry->created_at >= cache->ttl_ms;
+}
+
+/**
+ * @return the entry of the key in the context, or NULL.
+ */
+static SF_RESPONSE_CACHE_ENTRY *find_entry(SF_RESPONSE_CACHE *cache, uint64 hash,
+                                           const char *key, const char *context) {
+    size_t i;
+    for (i = 0; i < cache->count; i++) {
+        SF_RESPONSE_CACHE_ENTRY *entry = &cache->entries[i];
+        if (entry->hash == hash && strcmp(entry->key, key) == 0 &&
+            strcmp(entry->context, context) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Removes the least recently used entry.
+ */
+static void evict(SF_RESPONSE_CACHE *cache) {
+    SF_RESPONSE_CACHE_ENTRY *oldest = &cache->entries[0];
+    size_t i;
+    for (i = 1; i < cache->count; i++) {
+        if (cache->entries[i].last_used < oldest->last_used) {
+            oldest = &cache->entries[i];
+        }
+    }
+    remove_entry(cache, oldest);
+}
+
+SF_RESPONSE_CACHE *STDCALL sf_response_cache_create(size_t capacity, size_t max_bytes,
+                                                    uint64 ttl_ms) {
+    SF_RESPONSE_CACHE *cache;
+    if (capacity == 0) {
+        return NULL;
+    }
+    cache = (SF_RESPONSE_CACHE *) SF_CALLOC(1, sizeof(SF_RESPONSE_CACHE));
+    if (!cache) {
+        return NULL;
+    }
+    cache->entries = (SF_RESPONSE_CACHE_ENTRY *) SF_CALLOC(capacity,
+                                                           sizeof(SF_RESPONSE_CACHE_ENTRY));
+    if (!cache->entries) {
+        SF_FREE(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->max_bytes = max_bytes;
+    cache->ttl_ms = ttl_ms;
+    cache->refs = 1;
+    _mutex_init(&cache->mutex);
+    return cache;
+}
+
+void STDCALL sf_response_cache_retain(SF_RESPONSE_CACHE *cache) {
+    if (cache) {
+        sf_atomic_fetch_add(&cache->refs, 1);
+    }
+}
+
+void STDCALL sf_response_cache_release(SF_RESPONSE_CACHE *cache) {
+    if (cache && sf_atomic_fetch_sub(&cache->refs, 1) == 1) {
+        sf_response_cache_destroy(cache);
+    }
+}
+
+void STDCALL sf_response_cache_destroy(SF_RESPONSE_CACHE *cache) {
+    if (!cache) {
+        return;
+    }
+    sf_response_cache_clear(cache);
+    _mutex_term(&cache->mutex);
+    SF_FREE(cache->entries);
+    SF_FREE(cache);
+}
+
+char *STDCALL sf_response_cache_get(SF_RESPONSE_CACHE *cache, const char *key,
+                                    const char *context) {
+    SF_RESPONSE_CACHE_ENTRY *entry;
+    char *response = NULL;
+    uint64 hash;
+
+    if (!cache || !key || !context) {
+        return NULL;
+    }
+    hash = sf_hashmap_hash(key);
+    _mutex_lock(&cache->mutex);
+    entry = find_entry(cache, hash, key, context);
+    if (entry && is_expired(cache, entry, sf_monotonic_time_ms())) {
+        remove_entry(cache, entry);
+    } else if (entry) {
+        entry->last_used = ++cache->tick;
+        response = copy_string(entry->response, entry->response_size);
+    }
+    _mutex_unlock(&cache->mutex);
+    return response;
+}
+
+void STDCALL sf_response_cache_put(SF_RESPONSE_CACHE *cache, const char *key,
+                                   const char *context, const char *response) {
+    SF_RESPONSE_CACHE_ENTRY *entry;
+    size_t response_size;
+    uint64 hash;
+
+    if (!cache || !key || !context || !response) {
+        return;
+    }
+    response_size = strlen(response);
+    if (cache->max_bytes > 0 && response_size > cache->max_bytes) {
+        return;
+    }
+    hash = sf_hashmap_hash(key);
+    _mutex_lock(&cache->mutex);
+    entry = find_entry(cache, hash, key, context);
+    if (entry) {
+        remove_entry(cache, entry);
+    }
+    while (cache->count == cache->capacity ||
+           (cache->max_bytes > 0 && cache->bytes + response_size > cache->max_bytes)) {
+        evict(cache);
+    }
+
+    entry = &cache->entries[cache->count++];
+    entry->hash = hash;
+    entry->key = copy_string(key, strlen(key));
+    entry->context = copy_string(context, strlen(context));
+    entry->response = copy_string(response, response_size);
+    entry->response_size = response_size;
+    entry->created_at = sf_monotonic_time_ms();
+    entry->last_used = ++cache->tick;
+    cache->bytes += response_size;
+    if (!entry->key || !entry->context || !entry->response) {
+        remove_entry(cache, entry);
+        log_warn("Out of memory while caching the response of a statement");
+    }
+    _mutex_unlock(&cache->mutex);
+}
+
+void STDCALL sf_response_cache_clear(SF_RESPONSE_CACHE *cache) {
+    if (!cache) {
+        return;
+    }
+    _mutex_lock(&cache->mutex);
+    while (cache->count > 0) {
+        remove_entry(cache, &cache->entries[cache->count - 1]);
+    }
+    _mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_RESPONSE_CACHE_H
+#define SNOWFLAKE_RESPONSE_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+typedef struct SF_RESPONSE_CACHE_ENTRY {
+    uint64 hash;
+    char *key;
+    // Session objects and options the response was given in, they resolve the names of the
+    // statement and shape its results
+    char *context;
+    char *response;
+    size_t response_size;
+    // See sf_monotonic_time_ms()
+    uint64 created_at;
+    // Tick of the last lookup hitting the entry, the oldest goes first
+    uint64 last_used;
+} SF_RESPONSE_CACHE_ENTRY;
+
+/**
+ * Responses of query requests by statement, for the statements whose response holds again
+ * when they are sent again: describe only queries of a connection, or the results of the
+ * same read only query sent from several connections in quick succession.
+ */
+struct SF_RESPONSE_CACHE {
+    SF_MUTEX_HANDLE mutex;
+    SF_RESPONSE_CACHE_ENTRY *entries;
+    size_t capacity;
+    size_t count;
+    // Bytes of all the responses, kept under max_bytes unless that is 0
+    size_t bytes;
+    size_t max_bytes;
+    // Milliseconds a response is good for, 0 for as long as it isn't evicted
+    uint64 ttl_ms;
+    uint64 tick;
+    // Holders of the cache, see sf_response_cache_retain()
+    volatile unsigned long long refs;
+};
+
+/**
+ * @param capacity number of responses kept at most, the least recently used go first.
+ * @param max_bytes bytes of responses kept at most, 0 for no limit.
+ * @param ttl_ms milliseconds a response is returned for, 0 for no limit.
+ * @return a new cache, or NULL if the capacity is 0 or out of memory.
+ */
+SF_RESPONSE_CACHE *STDCALL sf_response_cache_create(size_t capacity, size_t max_bytes,
+                                                    uint64 ttl_ms);
+
+void STDCALL sf_response_cache_destroy(SF_RESPONSE_CACHE *cache);
+
+/**
+ * Takes a reference to a cache shared by several threads, the cache is created with one.
+ */
+void STDCALL sf_response_cache_retain(SF_RESPONSE_CACHE *cache);
+
+/**
+ * Gives back a reference to the cache, destroying it with the last one.
+ */
+void STDCALL sf_response_cache_release(SF_RESPONSE_CACHE *cache);
+
+/**
+ * @return a copy of the response to the statement with the key in the context, to be freed by
+ *         the caller, or NULL if there is none or it expired.
+ */
+char *STDCALL sf_response_cache_get(SF_RESPONSE_CACHE *cache, const char *key,
+                                    const char *context);
+
+/**
+ * Keeps a copy of the response to the statement with the key in the context. Responses larger
+ * than the whole cache are not kept.
+ */
+void STDCALL sf_response_cache_put(SF_RESPONSE_CACHE *cache, const char *key,
+                                   const char *context, const char *response);
+
+/**
+ * Drops all the responses.
+ */
+void STDCALL sf_response_cache_clear(SF_RESPONSE_CACHE *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_RESPONSE_CACHE_H
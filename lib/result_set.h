@@ -26,6 +26,33 @@ extern "C" {
         ARROW_FORMAT, JSON_FORMAT, FORMAT_MAX
     } QueryResultFormat_t;
 
+    /**
+     * Cell accessors of one query result format, the rs_* functions of the same name without
+     * the format to switch on. Bound once with the result set, so reading a cell costs one
+     * indirect call to the accessor of the concrete result set.
+     */
+    typedef struct rs_accessors
+    {
+        SF_STATUS (STDCALL * next)(void * rs);
+        SF_STATUS (STDCALL * get_cell_as_bool)(void * rs, size_t idx, sf_bool * out_data);
+        SF_STATUS (STDCALL * get_cell_as_int8)(void * rs, size_t idx, int8 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_int32)(void * rs, size_t idx, int32 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_int64)(void * rs, size_t idx, int64 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_uint8)(void * rs, size_t idx, uint8 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_uint32)(void * rs, size_t idx, uint32 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_uint64)(void * rs, size_t idx, uint64 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_float32)(void * rs, size_t idx, float32 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_float64)(void * rs, size_t idx, float64 * out_data);
+        SF_STATUS (STDCALL * get_cell_as_const_string)(void * rs, size_t idx, const char ** out_data);
+        SF_STATUS (STDCALL * get_cell_as_timestamp)(void * rs, size_t idx, SF_TIMESTAMP * out_data);
+        SF_STATUS (STDCALL * get_cell_strlen)(void * rs, size_t idx, size_t * out_data);
+        SF_STATUS (STDCALL * get_cell_as_binary)(
+            void * rs, size_t idx, const void ** out_data, size_t * out_len);
+        SF_STATUS (STDCALL * get_cell_as_str_view)(
+            void * rs, size_t idx, const char ** out_data, size_t * out_len);
+        SF_STATUS (STDCALL * is_cell_null)(void * rs, size_t idx, sf_bool * out_data);
+    } rs_accessors_t;
+
     // Result Set API ==============================================================================
 
     /**
@@ -62,6 +89,15 @@ extern "C" {
         QueryResultFormat_t * query_result_format,
         const char * tz_string);
 
+    /**
+     * Gets the cell accessors of a query result format.
+     *
+     * @param query_result_format  The query result format.
+     *
+     * @return the accessors, NULL if the format is not supported.
+     */
+    const rs_accessors_t * rs_get_accessors(QueryResultFormat_t * query_result_format);
+
     /**
      * Destructor.
      *
@@ -284,6 +320,43 @@ extern "C" {
         size_t idx,
         size_t * out_data);
 
+    /**
+     * Writes the raw bytes of the current BINARY cell to the provided buffers.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param idx                  The index of the column or row to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_get_cell_as_binary(
+        void * rs,
+        QueryResultFormat_t * query_result_format,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len);
+
+    /**
+     * Writes the text of the current cell, as rs_get_cell_as_const_string() gives it, and its
+     * length to the provided buffers, without copying the strings of the result.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param idx                  The index of the column or row to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_get_cell_as_str_view(
+        void * rs,
+        QueryResultFormat_t * query_result_format,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len);
+
     /**
      * Gets the number of rows in the current chunk being processed.
      *
@@ -310,6 +383,78 @@ extern "C" {
         size_t idx,
         sf_bool * out_data);
 
+    /**
+     * Gets the number of rows that can be read in one run from the current row on, the current
+     * row included. For Arrow that is the rest of the current record batch, for JSON the rest
+     * of the current chunk.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     *
+     * @return the number of rows in the run, 0 if there is no current row.
+     */
+    size_t rs_get_rows_left_in_batch(void * rs, QueryResultFormat_t * query_result_format);
+
+    /**
+     * Copies the values of a column for a run of rows starting at the current row, if the
+     * format stores them in the layout of the given C type.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param idx                  The index of the column to copy.
+     * @param c_type               The C type of the values in out_data.
+     * @param out_data             The buffer to write row_count values to.
+     * @param null_bitmap          The null bitmap to update. May be NULL.
+     * @param bit_offset           The bit of the current row in null_bitmap.
+     * @param row_count            The number of rows, at most rs_get_rows_left_in_batch().
+     *
+     * @return true if the values were copied, false if they have to be read cell by cell.
+     */
+    sf_bool rs_copy_column(void * rs, QueryResultFormat_t * query_result_format, size_t idx,
+                           SF_C_TYPE c_type, void * out_data, uint8 * null_bitmap,
+                           size_t bit_offset, size_t row_count);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row, bit i
+     * set if row i is NULL, LSB first.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param idx                  The index of the column.
+     * @param null_bitmap          The (row_count + 7) / 8 bytes to write.
+     * @param row_count            The number of rows, at most rs_get_rows_left_in_batch().
+     * @param null_count           Receives the number of NULL rows.
+     *
+     * @return true if the bits were written.
+     */
+    sf_bool rs_copy_null_bitmap(void * rs, QueryResultFormat_t * query_result_format, size_t idx,
+                                uint8 * null_bitmap, size_t row_count, size_t * null_count);
+
+    /**
+     * Moves forward by the given number of rows, at most rs_get_rows_left_in_batch() - 1.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param row_count            The number of rows to skip.
+     */
+    void rs_skip_rows(void * rs, QueryResultFormat_t * query_result_format, size_t row_count);
+
+    /**
+     * Exports the next record batch of the current chunk through the Arrow C data interface.
+     * Only supported for Arrow results.
+     *
+     * @param rs                   The ResultSet object.
+     * @param query_result_format  The query result format.
+     * @param out_array            Receives the record batch.
+     * @param out_schema           Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if the chunk has no more record batches,
+     *         otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_export_arrow_batch(void * rs, QueryResultFormat_t * query_result_format,
+                                            struct ArrowArray * out_array,
+                                            struct ArrowSchema * out_schema);
+
     /**
     * Get the latest error code.
     *
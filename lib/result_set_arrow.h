@@ -29,6 +29,8 @@ extern "C" {
      * Initializes the result set with rowset64 data in json result set.
      *
      * @param json_rowset64             A pointer to the rowset64 data in json result set.
+     *                                  The result set takes ownership of it and frees it
+     *                                  once the rowset is decoded.
      * @param metadata                  A pointer to the metadata for the result set.
      * @param tz_string                 The time zone.
      */
@@ -239,6 +241,39 @@ extern "C" {
      */
     SF_STATUS STDCALL rs_arrow_get_cell_strlen(rs_arrow_t * rs, size_t idx, size_t * out_data);
 
+    /**
+     * Writes the raw bytes of the current BINARY cell to the provided buffers.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param idx                  The index of the row to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_arrow_get_cell_as_binary(
+        rs_arrow_t * rs,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len);
+
+    /**
+     * Writes the text of the current cell and its length to the provided buffers, without
+     * copying the strings of the result.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param idx                  The index of the row to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_arrow_get_cell_as_str_view(
+        rs_arrow_t * rs,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len);
+
     /**
      * Gets the number of rows in the current chunk being processed.
      *
@@ -259,8 +294,76 @@ extern "C" {
      */
     SF_STATUS STDCALL rs_arrow_is_cell_null(rs_arrow_t * rs, size_t idx, sf_bool * out_data);
 
+    /**
+     * Gets the number of rows left in the current record batch, the current row included.
+     *
+     * @param rs                   The ResultSetArrow object.
+     *
+     * @return the number of rows left in the current record batch.
+     */
+    size_t rs_arrow_get_rows_left_in_batch(rs_arrow_t * rs);
+
+    /**
+     * Copies the values of a column for a run of rows starting at the current row, without
+     * going through the cell getters, if the Arrow layout allows it.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param idx                  The index of the column to copy.
+     * @param c_type               The C type of the values in out_data.
+     * @param out_data             The buffer to write row_count values to.
+     * @param null_bitmap          The null bitmap to update. May be NULL.
+     * @param bit_offset           The bit of the current row in null_bitmap.
+     * @param row_count            The number of rows, at most rs_arrow_get_rows_left_in_batch().
+     *
+     * @return true if the values were copied, false if they have to be read cell by cell.
+     */
+    sf_bool rs_arrow_copy_column(rs_arrow_t * rs, size_t idx, SF_C_TYPE c_type, void * out_data,
+                                 uint8 * null_bitmap, size_t bit_offset, size_t row_count);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row, from the
+     * validity buffer of the current record batch.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param idx                  The index of the column.
+     * @param null_bitmap          The (row_count + 7) / 8 bytes to write, bit i set if row i is NULL.
+     * @param row_count            The number of rows, at most rs_arrow_get_rows_left_in_batch().
+     * @param null_count           Receives the number of NULL rows.
+     *
+     * @return true if the bits were written.
+     */
+    sf_bool rs_arrow_copy_null_bitmap(rs_arrow_t * rs, size_t idx, uint8 * null_bitmap,
+                                      size_t row_count, size_t * null_count);
+
+    /**
+     * Moves forward by the given number of rows within the current record batch.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param row_count            The number of rows to skip.
+     */
+    void rs_arrow_skip_rows(rs_arrow_t * rs, size_t row_count);
+
+    /**
+     * Exports the next record batch of the current chunk through the Arrow C data interface.
+     *
+     * @param rs                   The ResultSetArrow object.
+     * @param out_array            Receives the record batch.
+     * @param out_schema           Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if the chunk has no more record batches,
+     *         otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_arrow_export_next_batch(rs_arrow_t * rs, struct ArrowArray * out_array,
+                                                 struct ArrowSchema * out_schema);
+
     NON_JSON_RESP* callback_create_arrow_resp(void);
 
+    /**
+     * Creates a response for an Arrow chunk whose record batches can be consumed while the
+     * rest of the chunk is still being downloaded.
+     */
+    NON_JSON_RESP* callback_create_arrow_stream_resp(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
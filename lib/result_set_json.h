@@ -6,6 +6,7 @@
 #define SNOWFLAKE_RESULTSETJSON_H
 
 #include "cJSON.h"
+#include "json_rowset.h"
 #include "snowflake/basic_types.h"
 #include "snowflake/client.h"
 
@@ -36,6 +37,19 @@ extern "C" {
         SF_COLUMN_DESC * metadata,
         const char * tz_string);
 
+    /**
+     * Parameterized constructor.
+     * Initializes the result set with required information as well as a downloaded chunk.
+     *
+     * @param chunk                     A pointer to the chunk of the result set.
+     * @param metadata                  A pointer to the metadata for the result set.
+     * @param tz_string                 The time zone.
+     */
+    rs_json_t * rs_json_create_with_chunk(
+        SF_JSON_ROWSET * chunk,
+        SF_COLUMN_DESC * metadata,
+        const char * tz_string);
+
     /**
      * Destructor.
      */
@@ -49,7 +63,7 @@ extern "C" {
      *
      * @return 0 if successful, otherwise an error is returned.
      */
-    SF_STATUS STDCALL rs_json_append_chunk(rs_json_t * rs, cJSON * chunk);
+    SF_STATUS STDCALL rs_json_append_chunk(rs_json_t * rs, SF_JSON_ROWSET * chunk);
 
     /**
      * Advances to next row.
@@ -223,6 +237,39 @@ extern "C" {
      */
     SF_STATUS STDCALL rs_json_get_cell_strlen(rs_json_t * rs, size_t idx, size_t * out_data);
 
+    /**
+     * Writes the raw bytes of the current BINARY cell to the provided buffers.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param idx                  The index of the column to retrieve.
+     * @param out_data             The buffer to write the pointer to the bytes to.
+     * @param out_len              The buffer to write the number of bytes to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_json_get_cell_as_binary(
+        rs_json_t * rs,
+        size_t idx,
+        const void ** out_data,
+        size_t * out_len);
+
+    /**
+     * Writes the text of the current cell and its length to the provided buffers, without
+     * copying the strings of the result.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param idx                  The index of the column to retrieve.
+     * @param out_data             The buffer to write the pointer to the text to.
+     * @param out_len              The buffer to write the length of the text to.
+     *
+     * @return 0 if successful, otherwise an error is returned.
+     */
+    SF_STATUS STDCALL rs_json_get_cell_as_str_view(
+        rs_json_t * rs,
+        size_t idx,
+        const char ** out_data,
+        size_t * out_len);
+
     /**
      * Gets the number of rows in the current chunk being processed.
      *
@@ -252,6 +299,96 @@ extern "C" {
      */
     SF_STATUS STDCALL rs_json_is_cell_null(rs_json_t * rs, size_t idx, sf_bool * out_data);
 
+    /**
+     * Gets the number of rows left in the current chunk, the current row included.
+     *
+     * @param rs                   The ResultSetJson object.
+     *
+     * @return the number of rows, 0 if there is no current row.
+     */
+    size_t rs_json_get_rows_left_in_chunk(rs_json_t * rs);
+
+    /**
+     * Parses the int64, uint64 or float64 values of a column for a run of rows starting at the
+     * current row.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param idx                  The index of the column to copy.
+     * @param c_type               The C type of the values in out_data.
+     * @param out_data             The buffer to write row_count values to.
+     * @param null_bitmap          The null bitmap to update. May be NULL.
+     * @param bit_offset           The bit of the current row in null_bitmap.
+     * @param row_count            The number of rows.
+     *
+     * @return true if the values were copied, false if they have to be read cell by cell.
+     */
+    sf_bool rs_json_copy_column(rs_json_t * rs, size_t idx, SF_C_TYPE c_type, void * out_data,
+                                uint8 * null_bitmap, size_t bit_offset, size_t row_count);
+
+    /**
+     * Writes the null bits of a column for a run of rows starting at the current row, from the
+     * null bitmap of the column built once for the current chunk.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param idx                  The index of the column.
+     * @param null_bitmap          The (row_count + 7) / 8 bytes to write, bit i set if row i is NULL.
+     * @param row_count            The number of rows.
+     * @param null_count           Receives the number of NULL rows.
+     *
+     * @return true if the bits were written.
+     */
+    sf_bool rs_json_copy_null_bitmap(rs_json_t * rs, size_t idx, uint8 * null_bitmap,
+                                     size_t row_count, size_t * null_count);
+
+    /**
+     * Moves forward by the given number of rows within the current chunk.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param row_count            The number of rows to skip.
+     */
+    void rs_json_skip_rows(rs_json_t * rs, size_t row_count);
+
+    /**
+     * Positions the result set before a row of the current chunk, backward or forward, so
+     * that the next row is that one.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param row                  The index of the row within the chunk.
+     */
+    void rs_json_move_to_row(rs_json_t * rs, size_t row);
+
+    /**
+     * Gets the rows of the current chunk, which the result set keeps ownership of.
+     *
+     * @param rs                   The ResultSetJson object.
+     *
+     * @return the current chunk, or NULL if there is none.
+     */
+    const SF_JSON_ROWSET * rs_json_get_chunk(rs_json_t * rs);
+
+    /**
+     * Exports the rows of the current chunk left, from the current row on, as one Arrow record
+     * batch through the Arrow C data interface, in the encoding of the Arrow results.
+     *
+     * @param rs                   The ResultSetJson object.
+     * @param out_array            Receives the record batch.
+     * @param out_schema           Receives the schema of the record batch.
+     *
+     * @return 0 if successful, SF_STATUS_EOF if the chunk is exported already, otherwise an
+     *         error is returned.
+     */
+    SF_STATUS STDCALL rs_json_export_next_batch(rs_json_t * rs, struct ArrowArray * out_array,
+                                                struct ArrowSchema * out_schema);
+
+    /**
+     * Converts the rows of a chunk to an Arrow record batch kept as the columnar copy of the
+     * rowset, for rs_json_export_next_batch(). See SF_JSON_CHUNK_DECODE.
+     *
+     * @param rowset               The parsed chunk.
+     * @param metadata             The SF_COLUMN_DESC array of the columns of the results.
+     */
+    void STDCALL rs_json_decode_arrow_chunk(SF_JSON_ROWSET * rowset, void * metadata);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
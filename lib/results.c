@@ -6,32 +6,11 @@
 #include "results.h"
 #include "connection.h"
 #include "memory.h"
+#include "arena.h"
+#include "hex.h"
+#include "hashmap.h"
 #include <snowflake/logger.h>
 
-static size_t _bin2hex(
-  char *dst, const char *src, size_t dst_max_len, size_t src_len) {
-    size_t i = 0;
-    size_t dlen = 0;
-    if (dst_max_len < src_len * 2) {
-        return 0;
-    }
-    for (i=0, dlen=0; i < src_len && dlen < dst_max_len; ++i, dlen+=2) {
-        unsigned char hb = (unsigned char)src[i] >> 4;
-        unsigned char lb = (unsigned char)src[i] & (unsigned char)0xf;
-        if (hb > 9) {
-            dst[i*2] = (unsigned char)'A' + (hb - (unsigned char) 10);
-        } else {
-            dst[i*2] = (unsigned char)'0' + hb;
-        }
-        if (lb > 9) {
-            dst[i*2+1] = (unsigned char)'A' + (lb - (unsigned char) 10);
-        } else {
-            dst[i*2+1] = (unsigned char)'0' + lb;
-        }
-    }
-    return dlen;
-}
-
 SF_DB_TYPE string_to_snowflake_type(const char *string) {
     if (strcmp(string, "fixed") == 0) {
         return SF_DB_TYPE_FIXED;
@@ -186,7 +165,11 @@ SF_DB_TYPE c_type_to_snowflake(SF_C_TYPE c_type, SF_DB_TYPE tsmode) {
     }
 }
 
-char *value_to_string(void *value, size_t len, SF_C_TYPE c_type) {
+static void *_value_alloc(SF_ARENA *arena, size_t size) {
+    return arena ? sf_arena_calloc(arena, size) : SF_CALLOC(1, size);
+}
+
+static char *_value_to_string(void *value, size_t len, SF_C_TYPE c_type, SF_ARENA *arena) {
     size_t size;
     char *ret;
     if (value == NULL) {
@@ -200,38 +183,38 @@ char *value_to_string(void *value, size_t len, SF_C_TYPE c_type) {
     // TODO turn cases into macro and check to see if ret if null
     switch (c_type) {
         case SF_C_TYPE_INT8:
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_sprintf(ret, size, "%d", *(int8 *) value);
             return ret;
         case SF_C_TYPE_UINT8:
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_sprintf(ret, size, "%u", *(uint8 *) value);
             return ret;
         case SF_C_TYPE_INT64:
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_sprintf(ret, size, "%lld", *(int64 *) value);
             return ret;
         case SF_C_TYPE_UINT64:
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_sprintf(ret, size, "%llu", *(uint64 *) value);
             return ret;
         case SF_C_TYPE_FLOAT64:
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_sprintf(ret, size, "%f", *(float64 *) value);
             return ret;
         case SF_C_TYPE_BOOLEAN:
-            ret = (char*) SF_CALLOC(1, size + 1);
+            ret = (char*) _value_alloc(arena, size + 1);
             sb_strncpy(ret, size + 1, *(sf_bool*)value != (sf_bool)0 ? SF_BOOLEAN_INTERNAL_TRUE_STR : SF_BOOLEAN_INTERNAL_FALSE_STR, size + 1);
             return ret;
         case SF_C_TYPE_BINARY:
             size = (size_t)len * 2 + 1;
-            ret = (char*) SF_CALLOC(1, size);
-            _bin2hex(ret, (const char *) value, size - 1, (size_t) len);
+            ret = (char*) _value_alloc(arena, size);
+            sf_hex_encode(ret, value, (size_t) len);
             ret[size-1] = '\0';
             return ret;
         case SF_C_TYPE_STRING:
             size = (size_t)len + 1;
-            ret = (char *) SF_CALLOC(1, size);
+            ret = (char *) _value_alloc(arena, size);
             sb_strncpy(ret, size, (const char *) value, size);
             return ret;
         case SF_C_TYPE_TIMESTAMP:
@@ -242,12 +225,23 @@ char *value_to_string(void *value, size_t len, SF_C_TYPE c_type) {
         default:
             // TODO better default case
             // Return empty string in default case
-            ret = (char *) SF_CALLOC(1, 1);
+            ret = (char *) _value_alloc(arena, 1);
             ret[0] = '\0';
             return ret;
     }
 }
 
+char *value_to_string(void *value, size_t len, SF_C_TYPE c_type) {
+    return _value_to_string(value, len, c_type, NULL);
+}
+
+char *value_to_arena_string(SF_ARENA *arena, void *value, size_t len, SF_C_TYPE c_type) {
+    if (!arena) {
+        return NULL;
+    }
+    return _value_to_string(value, len, c_type, arena);
+}
+
 SF_COLUMN_DESC * set_description(const cJSON *rowtype) {
     int i;
     cJSON *blob;
@@ -258,8 +252,9 @@ SF_COLUMN_DESC * set_description(const cJSON *rowtype) {
         return desc;
     }
     desc = (SF_COLUMN_DESC *) SF_CALLOC(array_size, sizeof(SF_COLUMN_DESC));
-    for (i = 0; i < (int)array_size; i++) {
-        column = snowflake_cJSON_GetArrayItem(rowtype, i);
+    // Walk the columns in order rather than indexing, which would be quadratic for wide results
+    i = 0;
+    snowflake_cJSON_ArrayForEach(column, rowtype) {
         // Index starts at 1
         desc[i].idx = (size_t) i + 1;
         if(json_copy_string(&desc[i].name, column, "name")) {
@@ -290,12 +285,39 @@ SF_COLUMN_DESC * set_description(const cJSON *rowtype) {
         }
         desc[i].c_type = snowflake_to_c_type(desc[i].type, desc[i].precision, desc[i].scale);
         log_debug("Found type and ctype; %i: %i", desc[i].type, desc[i].c_type);
-
+        i++;
     }
 
     return desc;
 }
 
+static uint64 fingerprint_item(uint64 hash, const cJSON *item) {
+    const cJSON *child;
+    unsigned char end_mark = 0;
+
+    hash = sf_fnv1a(hash, &item->type, sizeof(item->type));
+    if (item->string) {
+        hash = sf_fnv1a(hash, item->string, strlen(item->string) + 1);
+    }
+    if (snowflake_cJSON_IsString(item)) {
+        hash = sf_fnv1a(hash, item->valuestring, strlen(item->valuestring) + 1);
+    } else if (snowflake_cJSON_IsNumber(item)) {
+        hash = sf_fnv1a(hash, &item->valuedouble, sizeof(item->valuedouble));
+    }
+    snowflake_cJSON_ArrayForEach(child, item) {
+        hash = fingerprint_item(hash, child);
+    }
+    // Separates the children of nested items from the items that follow
+    return sf_fnv1a(hash, &end_mark, sizeof(end_mark));
+}
+
+uint64 rowtype_fingerprint(const cJSON *rowtype) {
+    if (rowtype == NULL) {
+        return 0;
+    }
+    return fingerprint_item(SF_FNV_OFFSET_BASIS, rowtype);
+}
+
 SF_STATS * set_stats(cJSON *stats) {
     SF_STATS *metadata = NULL;
     metadata = (SF_STATS *) SF_MALLOC(sizeof(SF_STATS));
@@ -12,12 +12,25 @@ extern "C" {
 #include <snowflake/client.h>
 #include "snowflake/platform.h"
 #include "cJSON.h"
+#include "arena.h"
 
 SF_DB_TYPE string_to_snowflake_type(const char *string);
 SF_C_TYPE snowflake_to_c_type(SF_DB_TYPE type, int64 precision, int64 scale);
 SF_DB_TYPE c_type_to_snowflake(SF_C_TYPE c_type, SF_DB_TYPE tsmode);
 char *value_to_string(void *value, size_t len, SF_C_TYPE c_type);
+
+/**
+ * Same as value_to_string(), but the text is allocated from an arena instead of with SF_MALLOC
+ * and must not be freed on its own.
+ */
+char *value_to_arena_string(SF_ARENA *arena, void *value, size_t len, SF_C_TYPE c_type);
 SF_COLUMN_DESC * set_description(const cJSON *rowtype);
+
+/**
+ * Hashes the names and values of all fields of the columns in a rowtype, so that an unchanged
+ * rowtype can be recognized without building its column descriptors.
+ */
+uint64 rowtype_fingerprint(const cJSON *rowtype);
 SF_STATS * set_stats(cJSON *stats);
 
 #ifdef __cplusplus
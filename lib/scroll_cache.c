@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <zlib.h>
+#include "scroll_cache.h"
+#include "client_int.h"
+#include "connection.h"
+#include "memory.h"
+#include "error.h"
+
+SF_SCROLL_CACHE *STDCALL sf_scroll_cache_create(const int64 *row_counts, int64 chunk_count,
+                                                uint64 memory_limit, uint64 disk_limit,
+                                                const char *spill_dir) {
+    SF_SCROLL_CACHE *cache = (SF_SCROLL_CACHE *) SF_CALLOC(1, sizeof(SF_SCROLL_CACHE));
+    size_t spill_dir_len;
+    int64 i;
+
+    if (!cache) {
+        return NULL;
+    }
+    cache->chunk_count = chunk_count;
+    cache->current = -1;
+    cache->memory_limit = memory_limit;
+    cache->disk_limit = disk_limit;
+    cache->row_starts = (int64 *) SF_CALLOC((size_t) chunk_count + 1, sizeof(int64));
+    cache->chunks = (SF_SCROLL_CHUNK *) SF_CALLOC((size_t) chunk_count + 1,
+                                                  sizeof(SF_SCROLL_CHUNK));
+    if (!cache->row_starts || !cache->chunks) {
+        goto error;
+    }
+    for (i = 0; i < chunk_count; i++) {
+        cache->row_starts[i + 1] = cache->row_starts[i] + row_counts[i];
+    }
+    if (!is_string_empty(spill_dir) && disk_limit > 0) {
+        spill_dir_len = strlen(spill_dir) + 1;
+        if ((cache->spill_dir = (char *) SF_CALLOC(1, spill_dir_len)) == NULL) {
+            goto error;
+        }
+        sb_strncpy(cache->spill_dir, spill_dir_len, spill_dir, spill_dir_len);
+        uuid4_generate(cache->spill_prefix);
+    }
+    return cache;
+
+error:
+    sf_scroll_cache_free(cache);
+    return NULL;
+}
+
+static void STDCALL chunk_path(SF_SCROLL_CACHE *cache, int64 index, char *path, size_t size) {
+    sb_sprintf(path, size, "%s%csf_scroll_%s_%lld.z", cache->spill_dir, PATH_SEP,
+               cache->spill_prefix, (long long) index);
+}
+
+void STDCALL sf_scroll_cache_free(SF_SCROLL_CACHE *cache) {
+    char path[MAX_PATH];
+    int64 i;
+
+    if (!cache) {
+        return;
+    }
+    for (i = 0; cache->chunks && i < cache->chunk_count; i++) {
+        if (cache->chunks[i].state == SF_SCROLL_CHUNK_DISK) {
+            chunk_path(cache, i, path, sizeof(path));
+            remove(path);
+        }
+        SF_TAG_FREE(SF_MEMORY_TAG_RESULT_SET, cache->chunks[i].data, cache->chunks[i].size);
+    }
+    SF_FREE(cache->row_starts);
+    SF_FREE(cache->chunks);
+    SF_FREE(cache->spill_dir);
+    SF_FREE(cache);
+}
+
+int64 STDCALL sf_scroll_cache_find(const SF_SCROLL_CACHE *cache, int64 row_index) {
+    int64 low = 0;
+    int64 high;
+    int64 middle;
+
+    if (row_index < 0 || row_index >= cache->row_starts[cache->chunk_count]) {
+        return -1;
+    }
+    // The last chunk starting at or before the row, past the empty chunks
+    high = cache->chunk_count - 1;
+    while (low < high) {
+        middle = low + (high - low + 1) / 2;
+        if (cache->row_starts[middle] <= row_index) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+sf_bool STDCALL sf_scroll_cache_contains(const SF_SCROLL_CACHE *cache, int64 index) {
+    return index >= 0 && index < cache->chunk_count &&
+           cache->chunks[index].state != SF_SCROLL_CHUNK_NONE ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Deflates the cells of a rowset, pointing into a buffer of only their values, and then
+ * those values.
+ *
+ * @param size set to the deflated size.
+ * @param value_size set to the size of the values.
+ *
+ * @return the deflated rows, allocated with SF_MEMORY_TAG_RESULT_SET, or NULL on failure.
+ */
+static char *STDCALL pack_rowset(const SF_JSON_ROWSET *rowset, size_t *size,
+                                 size_t *value_size) {
+    size_t cell_count = rowset->row_count * rowset->column_count;
+    size_t cell_bytes = cell_count * sizeof(SF_JSON_CELL);
+    SF_JSON_CELL *cells = NULL;
+    char *values = NULL;
+    char *data = NULL;
+    char *shrunk;
+    size_t values_size = 0;
+    size_t bound = 0;
+    size_t i;
+    z_stream stream;
+    sf_bool stream_init = SF_BOOLEAN_FALSE;
+
+    for (i = 0; i < cell_count; i++) {
+        if (!rowset->cells[i].is_null) {
+            values_size += rowset->cells[i].len + 1;
+        }
+    }
+    if (cell_bytes > UINT_MAX || values_size > UINT_MAX) {
+        return NULL;
+    }
+    cells = (SF_JSON_CELL *) SF_CALLOC(cell_count > 0 ? cell_count : 1, sizeof(SF_JSON_CELL));
+    values = (char *) SF_MALLOC(values_size > 0 ? values_size : 1);
+    if (!cells || !values) {
+        goto cleanup;
+    }
+    values_size = 0;
+    for (i = 0; i < cell_count; i++) {
+        cells[i].is_null = rowset->cells[i].is_null;
+        if (!rowset->cells[i].is_null) {
+            cells[i].offset = values_size;
+            cells[i].len = rowset->cells[i].len;
+            memcpy(&values[values_size], &rowset->buffer[rowset->cells[i].offset],
+                   rowset->cells[i].len + 1);
+            values_size += rowset->cells[i].len + 1;
+        }
+    }
+
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK) {
+        goto cleanup;
+    }
+    stream_init = SF_BOOLEAN_TRUE;
+    bound = (size_t) deflateBound(&stream, (uLong) (cell_bytes + values_size));
+    if ((data = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_RESULT_SET, bound)) == NULL) {
+        goto cleanup;
+    }
+    // Bound to the whole input, so that each call takes in all of its part
+    stream.next_out = (Bytef *) data;
+    stream.avail_out = (uInt) bound;
+    stream.next_in = (Bytef *) cells;
+    stream.avail_in = (uInt) cell_bytes;
+    if (deflate(&stream, Z_NO_FLUSH) != Z_OK || stream.avail_in != 0) {
+        goto error;
+    }
+    stream.next_in = (Bytef *) values;
+    stream.avail_in = (uInt) values_size;
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        goto error;
+    }
+    *size = (size_t) stream.total_out;
+    *value_size = values_size;
+    if ((shrunk = (char *) SF_TAG_REALLOC(SF_MEMORY_TAG_RESULT_SET, data, bound, *size)) == NULL) {
+        goto error;
+    }
+    data = shrunk;
+    goto cleanup;
+
+error:
+    SF_TAG_FREE(SF_MEMORY_TAG_RESULT_SET, data, bound);
+
+cleanup:
+    if (stream_init) {
+        deflateEnd(&stream);
+    }
+    SF_FREE(cells);
+    SF_FREE(values);
+    return data;
+}
+
+/**
+ * Inflates the next bytes of the stream into the given memory.
+ *
+ * @return SF_BOOLEAN_FALSE if the stream ends early or is corrupt.
+ */
+static sf_bool STDCALL inflate_into(z_stream *stream, void *out, size_t size) {
+    int ret = Z_OK;
+
+    stream->next_out = (Bytef *) out;
+    stream->avail_out = (uInt) size;
+    while (stream->avail_out > 0) {
+        ret = inflate(stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        if (ret != Z_OK) {
+            return SF_BOOLEAN_FALSE;
+        }
+    }
+    return stream->avail_out == 0 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+static SF_JSON_ROWSET *STDCALL unpack_rowset(const SF_SCROLL_CHUNK *chunk, const char *data,
+                                             size_t row_count) {
+    SF_JSON_ROWSET *rowset;
+    z_stream stream;
+    sf_bool ret;
+
+    rowset = sf_json_rowset_alloc(row_count, chunk->column_count, chunk->value_size);
+    if (!rowset) {
+        return NULL;
+    }
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef *) data;
+    stream.avail_in = (uInt) chunk->size;
+    if (inflateInit(&stream) != Z_OK) {
+        sf_json_rowset_free(rowset);
+        return NULL;
+    }
+    ret = inflate_into(&stream, rowset->cells,
+                       row_count * chunk->column_count * sizeof(SF_JSON_CELL)) &&
+          inflate_into(&stream, rowset->buffer, chunk->value_size);
+    inflateEnd(&stream);
+    if (!ret) {
+        log_error("Unable to inflate a chunk of the scroll cache");
+        sf_json_rowset_free(rowset);
+        return NULL;
+    }
+    return rowset;
+}
+
+/**
+ * Moves the deflated rows of a chunk out of the memory, to disk if there is room there.
+ * The chunk no longer counts against the memory limit.
+ */
+static void STDCALL leave_memory(SF_SCROLL_CACHE *cache, int64 index) {
+    SF_SCROLL_CHUNK *chunk = &cache->chunks[index];
+    char path[MAX_PATH];
+    FILE *file;
+    sf_bool written = SF_BOOLEAN_FALSE;
+
+    if (cache->spill_dir && cache->disk_used + chunk->size <= cache->disk_limit) {
+        chunk_path(cache, index, path, sizeof(path));
+        if ((file = fopen(path, "wb")) != NULL) {
+            written = fwrite(chunk->data, 1, chunk->size, file) == chunk->size;
+            if (fclose(file) != 0) {
+                written = SF_BOOLEAN_FALSE;
+            }
+            if (!written) {
+                remove(path);
+            }
+        }
+        if (!written) {
+            log_warn("Unable to write the scroll cache file %s: %s", path, strerror(errno));
+        }
+    }
+    SF_TAG_FREE(SF_MEMORY_TAG_RESULT_SET, chunk->data, chunk->size);
+    if (written) {
+        chunk->state = SF_SCROLL_CHUNK_DISK;
+        cache->disk_used += chunk->size;
+    } else {
+        log_debug("Chunk %lld left the scroll cache", (long long) index);
+        chunk->state = SF_SCROLL_CHUNK_NONE;
+        chunk->size = 0;
+    }
+}
+
+void STDCALL sf_scroll_cache_put(SF_SCROLL_CACHE *cache, int64 index,
+                                const SF_JSON_ROWSET *rowset) {
+    SF_SCROLL_CHUNK *chunk;
+    int64 oldest;
+    int64 i;
+
+    if (!cache || !rowset || index < 0 || index >= cache->chunk_count) {
+        return;
+    }
+    chunk = &cache->chunks[index];
+    chunk->last_used = ++cache->clock;
+    if (chunk->state != SF_SCROLL_CHUNK_NONE) {
+        return;
+    }
+    if ((int64) rowset->row_count != cache->row_starts[index + 1] - cache->row_starts[index]) {
+        log_warn("Chunk %lld has %llu rows instead of %lld, not kept for scrolling",
+                 (long long) index, (unsigned long long) rowset->row_count,
+                 (long long) (cache->row_starts[index + 1] - cache->row_starts[index]));
+        return;
+    }
+    chunk->data = pack_rowset(rowset, &chunk->size, &chunk->value_size);
+    if (!chunk->data) {
+        log_warn("Unable to keep chunk %lld for scrolling", (long long) index);
+        chunk->size = 0;
+        return;
+    }
+    chunk->column_count = rowset->column_count;
+
+    // The least recently used chunks make room
+    while (cache->memory_used + chunk->size > cache->memory_limit) {
+        oldest = -1;
+        for (i = 0; i < cache->chunk_count; i++) {
+            if (cache->chunks[i].state == SF_SCROLL_CHUNK_MEMORY &&
+                (oldest < 0 || cache->chunks[i].last_used < cache->chunks[oldest].last_used)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        cache->memory_used -= cache->chunks[oldest].size;
+        leave_memory(cache, oldest);
+    }
+    if (cache->memory_used + chunk->size <= cache->memory_limit) {
+        chunk->state = SF_SCROLL_CHUNK_MEMORY;
+        cache->memory_used += chunk->size;
+    } else {
+        leave_memory(cache, index);
+    }
+}
+
+SF_JSON_ROWSET *STDCALL sf_scroll_cache_get(SF_SCROLL_CACHE *cache, int64 index) {
+    SF_SCROLL_CHUNK *chunk;
+    SF_JSON_ROWSET *rowset = NULL;
+    char path[MAX_PATH];
+    char *data;
+    FILE *file;
+    size_t row_count;
+
+    if (!cache || !sf_scroll_cache_contains(cache, index)) {
+        return NULL;
+    }
+    chunk = &cache->chunks[index];
+    chunk->last_used = ++cache->clock;
+    row_count = (size_t) (cache->row_starts[index + 1] - cache->row_starts[index]);
+    if (chunk->state == SF_SCROLL_CHUNK_MEMORY) {
+        return unpack_rowset(chunk, chunk->data, row_count);
+    }
+
+    chunk_path(cache, index, path, sizeof(path));
+    if ((file = fopen(path, "rb")) == NULL) {
+        log_error("Unable to open the scroll cache file %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    if ((data = (char *) SF_MALLOC(chunk->size > 0 ? chunk->size : 1)) != NULL) {
+        if (fread(data, 1, chunk->size, file) == chunk->size) {
+            rowset = unpack_rowset(chunk, data, row_count);
+        } else {
+            log_error("Unable to read the scroll cache file %s", path);
+        }
+        SF_FREE(data);
+    }
+    fclose(file);
+    return rowset;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_SCROLL_CACHE_H
+#define SNOWFLAKE_SCROLL_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+#include "json_rowset.h"
+
+typedef enum SF_SCROLL_CHUNK_STATE {
+    // Not kept, its rows are fetched from the server again when scrolled back to
+    SF_SCROLL_CHUNK_NONE,
+    SF_SCROLL_CHUNK_MEMORY,
+    SF_SCROLL_CHUNK_DISK
+} SF_SCROLL_CHUNK_STATE;
+
+/**
+ * A chunk kept by the scroll cache: its cells, then the values they point to one after the
+ * other, deflated in one stream.
+ */
+typedef struct SF_SCROLL_CHUNK {
+    SF_SCROLL_CHUNK_STATE state;
+    // The deflated rows in memory, NULL once they are on disk
+    char *data;
+    // Deflated size, the size of the values once inflated and the number of columns
+    size_t size;
+    size_t value_size;
+    size_t column_count;
+    // Clock of the cache the last time the chunk was put or taken, the least recently used
+    // chunk leaves the memory first
+    uint64 last_used;
+} SF_SCROLL_CHUNK;
+
+/**
+ * The JSON chunks a scrollable statement has fetched, see SF_STMT_SCROLLABLE, numbered as in
+ * snowflake_chunk_index(), chunk 0 being the rows of the query response. The chunks over the
+ * memory limit are written to the spill directory, up to the disk limit, and the ones over
+ * that are dropped.
+ */
+typedef struct SF_SCROLL_CACHE {
+    int64 chunk_count;
+    // Index of the first row of each chunk, followed by the number of rows of the results
+    int64 *row_starts;
+    SF_SCROLL_CHUNK *chunks;
+    // Chunk of the rows of the result set of the statement, -1 if it has none
+    int64 current;
+    uint64 memory_limit;
+    uint64 memory_used;
+    uint64 disk_limit;
+    uint64 disk_used;
+    // NULL to keep no chunks on disk
+    char *spill_dir;
+    char spill_prefix[SF_UUID4_LEN];
+    uint64 clock;
+} SF_SCROLL_CACHE;
+
+/**
+ * @param row_counts   the number of rows of each chunk.
+ * @param chunk_count  the number of chunks of the results.
+ * @param memory_limit the deflated bytes of the chunks kept in memory at most.
+ * @param disk_limit   the deflated bytes of the chunks kept on disk at most.
+ * @param spill_dir    the directory the chunks are written to, NULL or empty for none.
+ *
+ * @return the cache, or NULL if out of memory.
+ */
+SF_SCROLL_CACHE *STDCALL sf_scroll_cache_create(const int64 *row_counts, int64 chunk_count,
+                                                uint64 memory_limit, uint64 disk_limit,
+                                                const char *spill_dir);
+
+/**
+ * Frees the cache and removes the chunks it wrote to disk.
+ */
+void STDCALL sf_scroll_cache_free(SF_SCROLL_CACHE *cache);
+
+/**
+ * @return the chunk of a row of the results, -1 if the results end before the row.
+ */
+int64 STDCALL sf_scroll_cache_find(const SF_SCROLL_CACHE *cache, int64 row_index);
+
+/**
+ * @return SF_BOOLEAN_TRUE if the rows of the chunk are kept, in memory or on disk.
+ */
+sf_bool STDCALL sf_scroll_cache_contains(const SF_SCROLL_CACHE *cache, int64 index);
+
+/**
+ * Keeps a copy of the rows of a chunk, unless it is kept already. The least recently used
+ * chunks leave the memory for it when the memory limit is reached. Not keeping it, e.g. once
+ * out of memory or disk space, is not an error.
+ */
+void STDCALL sf_scroll_cache_put(SF_SCROLL_CACHE *cache, int64 index,
+                                const SF_JSON_ROWSET *rowset);
+
+/**
+ * @return a copy of the rows of a chunk, to be freed with sf_json_rowset_free(), or NULL if
+ *         the chunk isn't kept or can't be read back.
+ */
+SF_JSON_ROWSET *STDCALL sf_scroll_cache_get(SF_SCROLL_CACHE *cache, int64 index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_SCROLL_CACHE_H
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include <snowflake/logger.h>
+#include "session_pool.h"
+#include "client_int.h"
+#include "connection.h"
+#include "error.h"
+#include "memory.h"
+
+static void free_slot(SF_POOLED_SESSION *session) {
+    session->sf = NULL;
+    session->in_use = SF_BOOLEAN_FALSE;
+    session->idle = SF_BOOLEAN_FALSE;
+    SF_FREE(session->role);
+    SF_FREE(session->warehouse);
+    SF_FREE(session->database);
+    SF_FREE(session->schema);
+}
+
+/**
+ * Sends a heartbeat, which also renews the session token if it has expired.
+ */
+static sf_bool heartbeat(SF_CONNECT *sf) {
+    cJSON *resp = NULL;
+    sf_bool success = SF_BOOLEAN_FALSE;
+
+    if (request(sf, &resp, SESSION_HEARTBEAT_URL, NULL, 0, NULL, NULL, POST_REQUEST_TYPE,
+                &sf->error, SF_BOOLEAN_FALSE) &&
+        json_copy_bool(&success, resp, "success") != SF_JSON_ERROR_NONE) {
+        success = SF_BOOLEAN_FALSE;
+    }
+    snowflake_cJSON_Delete(resp);
+    return success;
+}
+
+/**
+ * Switches the session back to an object it was logged in with. A session that had none
+ * can't be switched back.
+ */
+static sf_bool restore_object(SF_CONNECT *sf, SF_ATTRIBUTE type, const char *original,
+                              const char *current) {
+    char quoted[512];
+    size_t len = 0;
+    const char *p;
+
+    if (sf_same_name(original, current)) {
+        return SF_BOOLEAN_TRUE;
+    }
+    if (!original) {
+        return SF_BOOLEAN_FALSE;
+    }
+    // Quote the name as it was returned by the server, doubling the quotes in it
+    quoted[len++] = '"';
+    for (p = original; *p && len < sizeof(quoted) - 3; p++) {
+        if (*p == '"') {
+            quoted[len++] = '"';
+        }
+        quoted[len++] = *p;
+    }
+    if (*p) {
+        return SF_BOOLEAN_FALSE;
+    }
+    quoted[len++] = '"';
+    quoted[len] = '\0';
+
+    if (snowflake_use_object(sf, type, quoted) != SF_STATUS_SUCCESS) {
+        log_warn("Unable to restore the current objects of a pooled session: %s",
+                 sf->error.msg);
+        return SF_BOOLEAN_FALSE;
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Puts a session that logged in into its slot.
+ */
+static void fill_slot(SF_POOLED_SESSION *slot, SF_CONNECT *sf) {
+    slot->role = sf_copy_name(sf->role);
+    slot->warehouse = sf_copy_name(sf->warehouse);
+    slot->database = sf_copy_name(sf->database);
+    slot->schema = sf_copy_name(sf->schema);
+    slot->sf = sf;
+}
+
+/**
+ * Logs in a new session into a slot reserved by the caller.
+ */
+static SF_CONNECT *open_session(SF_SESSION_POOL *pool, SF_POOLED_SESSION *slot) {
+    SF_CONNECT *sf = pool->create(pool->create_ctx);
+
+    if (sf && snowflake_connect(sf) == SF_STATUS_SUCCESS) {
+        fill_slot(slot, sf);
+        return sf;
+    }
+
+    _critical_section_lock(&pool->lock);
+    if (sf) {
+        copy_snowflake_error(&pool->error, &sf->error);
+    } else {
+        SET_SNOWFLAKE_ERROR(&pool->error, SF_STATUS_ERROR_GENERAL,
+                            "Unable to create a session for the pool",
+                            SF_SQLSTATE_UNABLE_TO_CONNECT);
+    }
+    free_slot(slot);
+    pool->open_count--;
+    _cond_signal(&pool->cond);
+    _critical_section_unlock(&pool->lock);
+    log_error("Unable to open a pooled session: %s", pool->error.msg);
+    snowflake_term(sf);
+    return NULL;
+}
+
+/**
+ * Closes a session that is not fit for reuse and frees its slot.
+ */
+static void discard_session(SF_SESSION_POOL *pool, SF_POOLED_SESSION *slot) {
+    SF_CONNECT *sf = slot->sf;
+
+    _critical_section_lock(&pool->lock);
+    free_slot(slot);
+    pool->open_count--;
+    _cond_signal(&pool->cond);
+    _critical_section_unlock(&pool->lock);
+    snowflake_term(sf);
+}
+
+static SF_POOLED_SESSION *find_free_slot(SF_SESSION_POOL *pool) {
+    size_t i;
+
+    for (i = 0; i < pool->max_size; i++) {
+        if (!pool->sessions[i].in_use) {
+            return &pool->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Logs in the first sessions of a pool all at once.
+ */
+static void open_first_sessions(SF_SESSION_POOL *pool) {
+    SF_CONNECT **connections;
+    SF_STATUS *statuses;
+    size_t count = 0;
+    size_t i;
+
+    if (pool->min_size == 0) {
+        return;
+    }
+    connections = (SF_CONNECT **) SF_CALLOC(pool->min_size, sizeof(SF_CONNECT *));
+    statuses = (SF_STATUS *) SF_CALLOC(pool->min_size, sizeof(SF_STATUS));
+    if (!connections || !statuses) {
+        SF_FREE(connections);
+        SF_FREE(statuses);
+        SET_SNOWFLAKE_ERROR(&pool->error, SF_STATUS_ERROR_OUT_OF_MEMORY,
+                            "Out of memory while opening the sessions of the pool",
+                            SF_SQLSTATE_MEMORY_ALLOCATION_ERROR);
+        return;
+    }
+    for (i = 0; i < pool->min_size; i++) {
+        if ((connections[count] = pool->create(pool->create_ctx)) != NULL) {
+            count++;
+        } else {
+            SET_SNOWFLAKE_ERROR(&pool->error, SF_STATUS_ERROR_GENERAL,
+                                "Unable to create a session for the pool",
+                                SF_SQLSTATE_UNABLE_TO_CONNECT);
+        }
+    }
+
+    snowflake_connect_many(connections, count, 0, statuses);
+    for (i = 0; i < count; i++) {
+        if (statuses[i] == SF_STATUS_SUCCESS) {
+            fill_slot(&pool->sessions[pool->open_count], connections[i]);
+            pool->sessions[pool->open_count].in_use = SF_BOOLEAN_TRUE;
+            pool->sessions[pool->open_count].idle = SF_BOOLEAN_TRUE;
+            pool->sessions[pool->open_count].idle_since_ms = sf_monotonic_time_ms();
+            pool->open_count++;
+        } else {
+            copy_snowflake_error(&pool->error, &connections[i]->error);
+            log_error("Unable to open a pooled session: %s", pool->error.msg);
+            snowflake_term(connections[i]);
+        }
+    }
+    SF_FREE(connections);
+    SF_FREE(statuses);
+}
+
+SF_SESSION_POOL *STDCALL snowflake_session_pool_create(SF_SESSION_CREATE create, void *ctx,
+                                                      size_t min_size, size_t max_size) {
+    SF_SESSION_POOL *pool;
+
+    if (!create || max_size == 0 || min_size > max_size) {
+        return NULL;
+    }
+    pool = (SF_SESSION_POOL *) SF_CALLOC(1, sizeof(SF_SESSION_POOL));
+    if (!pool) {
+        return NULL;
+    }
+    pool->sessions = (SF_POOLED_SESSION *) SF_CALLOC(max_size, sizeof(SF_POOLED_SESSION));
+    if (!pool->sessions) {
+        SF_FREE(pool);
+        return NULL;
+    }
+    _critical_section_init(&pool->lock);
+    _cond_init(&pool->cond);
+    pool->create = create;
+    pool->create_ctx = ctx;
+    pool->min_size = min_size;
+    pool->max_size = max_size;
+    pool->open_count = 0;
+    clear_snowflake_error(&pool->error);
+
+    // Log in the minimum number of sessions now, so that checkouts don't have to
+    open_first_sessions(pool);
+    return pool;
+}
+
+SF_CONNECT *STDCALL snowflake_session_pool_checkout(SF_SESSION_POOL *pool) {
+    SF_POOLED_SESSION *slot;
+    size_t i;
+
+    if (!pool) {
+        return NULL;
+    }
+
+    for (;;) {
+        _critical_section_lock(&pool->lock);
+        for (;;) {
+            // The session used last is the most likely to still be warm
+            slot = NULL;
+            for (i = 0; i < pool->max_size; i++) {
+                if (pool->sessions[i].idle &&
+                    (!slot || pool->sessions[i].idle_since_ms > slot->idle_since_ms)) {
+                    slot = &pool->sessions[i];
+                }
+            }
+            if (slot || pool->open_count < pool->max_size) {
+                break;
+            }
+            _cond_wait(&pool->cond, &pool->lock);
+        }
+
+        if (!slot) {
+            // Reserve a slot, and log in outside of the lock
+            slot = find_free_slot(pool);
+            slot->in_use = SF_BOOLEAN_TRUE;
+            pool->open_count++;
+            _critical_section_unlock(&pool->lock);
+            return open_session(pool, slot);
+        }
+
+        slot->idle = SF_BOOLEAN_FALSE;
+        _critical_section_unlock(&pool->lock);
+        if (sf_monotonic_time_ms() - slot->idle_since_ms < SF_SESSION_POOL_VALIDATION_INTERVAL ||
+            heartbeat(slot->sf)) {
+            return slot->sf;
+        }
+        log_debug("Pooled session failed its heartbeat, closing it");
+        discard_session(pool, slot);
+    }
+}
+
+void STDCALL snowflake_session_pool_checkin(SF_SESSION_POOL *pool, SF_CONNECT *sf) {
+    SF_POOLED_SESSION *slot = NULL;
+    size_t i;
+
+    if (!pool || !sf) {
+        return;
+    }
+    for (i = 0; i < pool->max_size; i++) {
+        if (pool->sessions[i].sf == sf) {
+            slot = &pool->sessions[i];
+            break;
+        }
+    }
+    if (!slot) {
+        log_warn("Session checked in to a pool it doesn't belong to, closing it");
+        snowflake_term(sf);
+        return;
+    }
+
+    // The next user gets the session the way it was logged in. The role goes first, the others
+    // may not be usable with the current one.
+    if (!restore_object(sf, SF_CON_ROLE, slot->role, sf->role) ||
+        !restore_object(sf, SF_CON_WAREHOUSE, slot->warehouse, sf->warehouse) ||
+        !restore_object(sf, SF_CON_DATABASE, slot->database, sf->database) ||
+        !restore_object(sf, SF_CON_SCHEMA, slot->schema, sf->schema)) {
+        log_debug("Pooled session can't be reset, closing it");
+        discard_session(pool, slot);
+        return;
+    }
+
+    _critical_section_lock(&pool->lock);
+    slot->idle = SF_BOOLEAN_TRUE;
+    slot->idle_since_ms = sf_monotonic_time_ms();
+    _cond_signal(&pool->cond);
+    _critical_section_unlock(&pool->lock);
+}
+
+SF_ERROR_STRUCT *STDCALL snowflake_session_pool_error(SF_SESSION_POOL *pool) {
+    return pool ? &pool->error : NULL;
+}
+
+void STDCALL snowflake_session_pool_destroy(SF_SESSION_POOL *pool) {
+    size_t i;
+
+    if (!pool) {
+        return;
+    }
+    for (i = 0; i < pool->max_size; i++) {
+        if (pool->sessions[i].sf) {
+            if (!pool->sessions[i].idle) {
+                log_warn("Session pool destroyed while a session is checked out");
+            }
+            snowflake_term(pool->sessions[i].sf);
+        }
+        free_slot(&pool->sessions[i]);
+    }
+    clear_snowflake_error(&pool->error);
+    _cond_term(&pool->cond);
+    _critical_section_term(&pool->lock);
+    SF_FREE(pool->sessions);
+    SF_FREE(pool);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_SESSION_POOL_H
+#define SNOWFLAKE_SESSION_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// Milliseconds a session may sit idle before it is checked with a heartbeat on checkout
+#define SF_SESSION_POOL_VALIDATION_INTERVAL 60000
+
+/**
+ * A session of the pool, with the objects it was logged in with so that they can be restored
+ * when it is checked in.
+ */
+typedef struct SF_POOLED_SESSION {
+    SF_CONNECT *sf;
+    char *role;
+    char *warehouse;
+    char *database;
+    char *schema;
+    // Set while the slot holds a session, or one is being logged in for it
+    sf_bool in_use;
+    // Set while nobody has the session checked out
+    sf_bool idle;
+    // Time the session was checked in, see sf_monotonic_time_ms()
+    uint64 idle_since_ms;
+} SF_POOLED_SESSION;
+
+struct SF_SESSION_POOL {
+    SF_CRITICAL_SECTION_HANDLE lock;
+    // Signaled when a session is checked in or a slot frees up
+    SF_CONDITION_HANDLE cond;
+    SF_SESSION_CREATE create;
+    void *create_ctx;
+    size_t min_size;
+    size_t max_size;
+    // max_size slots, a slot with a NULL session is free
+    SF_POOLED_SESSION *sessions;
+    // Slots in use, including the sessions being logged in
+    size_t open_count;
+    // Error of the last login that failed
+    SF_ERROR_STRUCT error;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_SESSION_POOL_H
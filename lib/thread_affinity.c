@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// for sched_setaffinity() and the CPU_* macros
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <snowflake/logger.h>
+#include "thread_affinity.h"
+#include "memory.h"
+
+#ifdef __linux__
+#include <sched.h>
+
+typedef cpu_set_t SF_CPU_SET;
+#endif
+
+static SF_MUTEX_HANDLE affinity_lock;
+static SF_THREAD_AFFINITY affinity_policy = SF_THREAD_AFFINITY_NONE;
+static char *affinity_cpu_list = NULL;
+static int affinity_next_group = 0;
+
+#ifdef __linux__
+static sf_bool affinity_has_cpus;
+static SF_CPU_SET affinity_cpus;
+// CPUs of each NUMA node found, read once the policy asks for them
+static sf_bool affinity_nodes_read;
+static int affinity_node_count = 0;
+static SF_CPU_SET affinity_node_cpus[SF_AFFINITY_MAX_NODES];
+
+/**
+ * Parses a list of CPUs in the format of the kernel, e.g. "0-3,8,10-11".
+ */
+static sf_bool STDCALL parse_cpu_list(const char *list, SF_CPU_SET *cpus) {
+    const char *p = list;
+    char *end;
+    long first;
+    long last;
+
+    CPU_ZERO(cpus);
+    while (*p) {
+        first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return SF_BOOLEAN_FALSE;
+        }
+        last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(++p, &end, 10);
+            if (end == p || last < first) {
+                return SF_BOOLEAN_FALSE;
+            }
+            p = end;
+        }
+        if (last >= CPU_SETSIZE) {
+            return SF_BOOLEAN_FALSE;
+        }
+        for (; first <= last; first++) {
+            CPU_SET((int) first, cpus);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p && *p != '\n') {
+            return SF_BOOLEAN_FALSE;
+        } else {
+            break;
+        }
+    }
+    return CPU_COUNT(cpus) > 0 ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+/**
+ * Reads the CPUs of the NUMA nodes. Called with affinity_lock taken.
+ */
+static void STDCALL read_nodes() {
+    char path[64];
+    char list[1024];
+    FILE *file;
+    int node;
+
+    affinity_nodes_read = SF_BOOLEAN_TRUE;
+    for (node = 0; node < SF_AFFINITY_MAX_NODES; node++) {
+        sb_sprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if ((file = fopen(path, "r")) == NULL) {
+            continue;
+        }
+        if (fgets(list, sizeof(list), file) &&
+            parse_cpu_list(list, &affinity_node_cpus[affinity_node_count])) {
+            affinity_node_count++;
+        }
+        fclose(file);
+    }
+    log_debug("%d NUMA nodes found", affinity_node_count);
+}
+#endif
+
+void STDCALL sf_affinity_init() {
+    _mutex_init(&affinity_lock);
+    affinity_policy = SF_THREAD_AFFINITY_NONE;
+    affinity_cpu_list = NULL;
+    affinity_next_group = 0;
+#ifdef __linux__
+    affinity_has_cpus = SF_BOOLEAN_FALSE;
+#endif
+}
+
+void STDCALL sf_affinity_term() {
+    SF_FREE(affinity_cpu_list);
+    _mutex_term(&affinity_lock);
+}
+
+void STDCALL sf_affinity_set_policy(SF_THREAD_AFFINITY policy) {
+#ifndef __linux__
+    if (policy != SF_THREAD_AFFINITY_NONE) {
+        log_warn("Thread affinity isn't supported on this platform, the policy is ignored");
+    }
+#endif
+    _mutex_lock(&affinity_lock);
+    affinity_policy = policy;
+#ifdef __linux__
+    if (policy == SF_THREAD_AFFINITY_NUMA_LOCAL && !affinity_nodes_read) {
+        read_nodes();
+    }
+#endif
+    _mutex_unlock(&affinity_lock);
+}
+
+SF_THREAD_AFFINITY STDCALL sf_affinity_get_policy() {
+    SF_THREAD_AFFINITY policy;
+    _mutex_lock(&affinity_lock);
+    policy = affinity_policy;
+    _mutex_unlock(&affinity_lock);
+    return policy;
+}
+
+sf_bool STDCALL sf_affinity_set_cpus(const char *cpus) {
+    char *copy = NULL;
+    size_t len;
+#ifdef __linux__
+    SF_CPU_SET parsed;
+
+    if (cpus && !parse_cpu_list(cpus, &parsed)) {
+        log_error("Invalid list of CPUs for the client threads: %s", cpus);
+        return SF_BOOLEAN_FALSE;
+    }
+#endif
+    if (cpus) {
+        len = strlen(cpus) + 1;
+        if ((copy = (char *) SF_CALLOC(1, len)) == NULL) {
+            return SF_BOOLEAN_FALSE;
+        }
+        sb_strcpy(copy, len, cpus);
+    }
+
+    _mutex_lock(&affinity_lock);
+    SF_FREE(affinity_cpu_list);
+    affinity_cpu_list = copy;
+#ifdef __linux__
+    affinity_has_cpus = cpus ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    if (cpus) {
+        affinity_cpus = parsed;
+    }
+#endif
+    _mutex_unlock(&affinity_lock);
+    return SF_BOOLEAN_TRUE;
+}
+
+void STDCALL sf_affinity_get_cpus(char *cpus, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    _mutex_lock(&affinity_lock);
+    if (affinity_cpu_list) {
+        sb_strncpy(cpus, size, affinity_cpu_list, size - 1);
+        cpus[size - 1] = '\0';
+    } else {
+        cpus[0] = '\0';
+    }
+    _mutex_unlock(&affinity_lock);
+}
+
+int STDCALL sf_affinity_group() {
+    int group;
+    _mutex_lock(&affinity_lock);
+    group = affinity_next_group++;
+    _mutex_unlock(&affinity_lock);
+    return group;
+}
+
+void STDCALL sf_affinity_apply(int group) {
+#ifdef __linux__
+    SF_CPU_SET cpus;
+    SF_CPU_SET local;
+    sf_bool pin = SF_BOOLEAN_FALSE;
+
+    _mutex_lock(&affinity_lock);
+    if (affinity_policy != SF_THREAD_AFFINITY_NONE && affinity_has_cpus) {
+        cpus = affinity_cpus;
+        pin = SF_BOOLEAN_TRUE;
+    }
+    if (affinity_policy == SF_THREAD_AFFINITY_NUMA_LOCAL && affinity_node_count > 0) {
+        local = affinity_node_cpus[(unsigned int) group % affinity_node_count];
+        // The CPUs set on the node, or the whole node if none of them is on it
+        if (pin) {
+            CPU_AND(&cpus, &cpus, &local);
+        }
+        if (!pin || CPU_COUNT(&cpus) == 0) {
+            cpus = local;
+        }
+        pin = SF_BOOLEAN_TRUE;
+    }
+    _mutex_unlock(&affinity_lock);
+
+    if (pin && sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        log_warn("Unable to set the CPU affinity of a client thread");
+    }
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_THREAD_AFFINITY_H
+#define SNOWFLAKE_THREAD_AFFINITY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// NUMA nodes looked for in /sys/devices/system/node
+#define SF_AFFINITY_MAX_NODES 64
+
+/**
+ * Placement of the threads of the client on the CPUs, see SF_GLOBAL_THREAD_AFFINITY. The
+ * threads working on the same buffers form a group, e.g. the downloader and decoder threads
+ * of a chunk downloader, or the threads of a thread pool, and each thread moves itself to the
+ * CPUs of its group when it starts. Pinning is only supported on Linux, elsewhere the threads
+ * stay where the OS puts them.
+ */
+void STDCALL sf_affinity_init();
+
+void STDCALL sf_affinity_term();
+
+/**
+ * Sets the placement policy. It applies to the threads started afterwards.
+ */
+void STDCALL sf_affinity_set_policy(SF_THREAD_AFFINITY policy);
+
+SF_THREAD_AFFINITY STDCALL sf_affinity_get_policy();
+
+/**
+ * Sets the CPUs the threads may run on, as a list of CPU numbers and ranges such as
+ * "0-7,16-23", NULL for all.
+ *
+ * @return SF_BOOLEAN_FALSE if the list is invalid, the CPUs are left unchanged then.
+ */
+sf_bool STDCALL sf_affinity_set_cpus(const char *cpus);
+
+/**
+ * Copies the list of CPUs set, an empty string for all.
+ */
+void STDCALL sf_affinity_get_cpus(char *cpus, size_t size);
+
+/**
+ * Places a new group of threads, with the NUMA nodes taken in turn under
+ * SF_THREAD_AFFINITY_NUMA_LOCAL.
+ *
+ * @return the group to pass to sf_affinity_apply() from the threads of the group.
+ */
+int STDCALL sf_affinity_group();
+
+/**
+ * Moves the calling thread to the CPUs of its group under the current policy. Memory the
+ * thread touches first afterwards is then allocated on its node by the kernel, so that the
+ * buffers a downloader thread fills are local to the decoder threads of the same group.
+ */
+void STDCALL sf_affinity_apply(int group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_THREAD_AFFINITY_H
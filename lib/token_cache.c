@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <snowflake/logger.h>
+#include "token_cache.h"
+#include "client_int.h"
+#include "connection.h"
+#include "hashmap.h"
+#include "memory.h"
+#include <openssl/evp.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static unsigned long long now_ms() {
+    return sf_unix_time_ns() / 1000000;
+}
+
+static const char *or_empty(const char *str) {
+    return str ? str : "";
+}
+
+/**
+ * Validity of a token in seconds, under any of the names the login and renewal responses
+ * give it. -1 if it isn't there.
+ */
+static double get_validity(cJSON *data, const char *name, const char *alt_name) {
+    cJSON *validity = snowflake_cJSON_GetObjectItem(data, name);
+    if (!snowflake_cJSON_IsNumber(validity)) {
+        validity = snowflake_cJSON_GetObjectItem(data, alt_name);
+    }
+    return snowflake_cJSON_IsNumber(validity) ? validity->valuedouble : -1;
+}
+
+static double get_number(cJSON *entry, const char *name) {
+    cJSON *number = snowflake_cJSON_GetObjectItem(entry, name);
+    return snowflake_cJSON_IsNumber(number) ? number->valuedouble : 0;
+}
+
+static void set_item(cJSON *entry, const char *name, cJSON *item) {
+    if (snowflake_cJSON_HasObjectItem(entry, name)) {
+        snowflake_cJSON_ReplaceItemInObject(entry, name, item);
+    } else {
+        snowflake_cJSON_AddItemToObject(entry, name, item);
+    }
+}
+
+/**
+ * Reads the cache file of the connection.
+ *
+ * @return the entry of the connection, or NULL if there is none or it's for other objects.
+ */
+static cJSON *read_entry(SF_CONNECT *sf) {
+    FILE *fp;
+    char *text = NULL;
+    size_t size = 0;
+    size_t chunk;
+    cJSON *entry = NULL;
+    cJSON *key;
+#ifndef _WIN32
+    struct stat st;
+#endif
+
+    if ((fp = fopen(sf->token_cache_file, "rb")) == NULL) {
+        return NULL;
+    }
+#ifndef _WIN32
+    // Tokens anyone else could have read or planted aren't used
+    if (fstat(fileno(fp), &st) != 0 || st.st_uid != geteuid() ||
+        (st.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+        log_warn("Ignoring the token cache file %s, it is accessible to other users",
+                 sf->token_cache_file);
+        fclose(fp);
+        return NULL;
+    }
+#endif
+    if ((text = (char *) SF_CALLOC(1, SF_TOKEN_CACHE_MAX_FILE_SIZE + 1)) != NULL) {
+        while (size < SF_TOKEN_CACHE_MAX_FILE_SIZE &&
+               (chunk = fread(text + size, 1, SF_TOKEN_CACHE_MAX_FILE_SIZE - size, fp)) > 0) {
+            size += chunk;
+        }
+        text[size] = '\0';
+        entry = snowflake_cJSON_Parse(text);
+        SF_FREE(text);
+    }
+    fclose(fp);
+
+    key = snowflake_cJSON_GetObjectItem(entry, "key");
+    if (!snowflake_cJSON_IsString(key) || strcmp(key->valuestring, sf->token_cache_key) != 0) {
+        snowflake_cJSON_Delete(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/**
+ * Replaces the cache file of the connection. The entry is written to a file of its own first,
+ * so that the processes reading the cache meanwhile get the old tokens or the new ones.
+ */
+static void write_entry(SF_CONNECT *sf, cJSON *entry) {
+    char tmp_path[MAX_PATH];
+    char uuid[SF_UUID4_LEN];
+    char *text;
+    size_t len;
+    sf_bool written;
+    FILE *fp = NULL;
+#ifndef _WIN32
+    int fd;
+#endif
+
+    if ((text = snowflake_cJSON_PrintUnformatted(entry)) == NULL) {
+        return;
+    }
+    uuid4_generate(uuid);
+    sb_sprintf(tmp_path, sizeof(tmp_path), "%s.%s", sf->token_cache_file, uuid);
+#ifndef _WIN32
+    if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) >= 0 &&
+        (fp = fdopen(fd, "wb")) == NULL) {
+        close(fd);
+    }
+#else
+    fp = fopen(tmp_path, "wb");
+#endif
+    if (!fp) {
+        log_warn("Unable to create the token cache file %s: %s", tmp_path, strerror(errno));
+        SF_FREE(text);
+        return;
+    }
+    len = strlen(text);
+    written = fwrite(text, 1, len, fp) == len;
+    if (fclose(fp) != 0 || !written) {
+        log_warn("Unable to write the token cache file %s", tmp_path);
+        remove(tmp_path);
+        SF_FREE(text);
+        return;
+    }
+#ifdef _WIN32
+    // rename doesn't replace an existing file on Windows, MoveFileEx does so atomically
+    if (!MoveFileExA(tmp_path, sf->token_cache_file, MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (rename(tmp_path, sf->token_cache_file) != 0) {
+#endif
+        log_warn("Unable to replace the token cache file %s: %s", sf->token_cache_file,
+                 strerror(errno));
+        remove(tmp_path);
+    }
+    SF_FREE(text);
+}
+
+/**
+ * Digest of the credentials of the connection, so that a session is only resumed by a
+ * connection that would have logged in to it. The one-time passcode of an MFA login isn't
+ * part of it, it changes for every login of the same user.
+ *
+ * @return SF_BOOLEAN_FALSE if the digest can't be computed.
+ */
+static sf_bool credentials_digest(SF_CONNECT *sf, char *hex, size_t hex_size) {
+    static const char digits[] = "0123456789abcdef";
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    unsigned int i;
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    sf_bool ret = SF_BOOLEAN_FALSE;
+
+    if (ctx && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) &&
+        // The user and account salt the digest of the password
+        EVP_DigestUpdate(ctx, or_empty(sf->account), strlen(or_empty(sf->account)) + 1) &&
+        EVP_DigestUpdate(ctx, or_empty(sf->user), strlen(or_empty(sf->user)) + 1) &&
+        EVP_DigestUpdate(ctx, or_empty(sf->password), strlen(or_empty(sf->password))) &&
+        EVP_DigestFinal_ex(ctx, digest, &digest_len) && hex_size > digest_len * 2) {
+        for (i = 0; i < digest_len; i++) {
+            hex[i * 2] = digits[digest[i] >> 4];
+            hex[i * 2 + 1] = digits[digest[i] & 0xf];
+        }
+        hex[digest_len * 2] = '\0';
+        ret = SF_BOOLEAN_TRUE;
+    }
+    EVP_MD_CTX_free(ctx);
+    return ret;
+}
+
+sf_bool STDCALL sf_token_cache_open(SF_CONNECT *sf) {
+    char credentials[EVP_MAX_MD_SIZE * 2 + 1];
+    size_t len;
+
+    SF_FREE(sf->token_cache_key);
+    SF_FREE(sf->token_cache_file);
+    if (is_string_empty(sf->token_cache_dir)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (!credentials_digest(sf, credentials, sizeof(credentials))) {
+        log_warn("Unable to digest the credentials of the connection, not caching its session");
+        return SF_BOOLEAN_FALSE;
+    }
+    // A session is only good for the objects and the credentials it was opened with
+    len = strlen(or_empty(sf->host)) + strlen(or_empty(sf->account)) +
+          strlen(or_empty(sf->user)) + strlen(or_empty(sf->role)) +
+          strlen(or_empty(sf->database)) + strlen(or_empty(sf->schema)) +
+          strlen(or_empty(sf->warehouse)) + strlen(or_empty(sf->authenticator)) +
+          strlen(credentials) + 9;
+    sf->token_cache_key = (char *) SF_CALLOC(1, len);
+    sf->token_cache_file = (char *) SF_CALLOC(1, MAX_PATH);
+    if (!sf->token_cache_key || !sf->token_cache_file) {
+        SF_FREE(sf->token_cache_key);
+        SF_FREE(sf->token_cache_file);
+        return SF_BOOLEAN_FALSE;
+    }
+    sb_sprintf(sf->token_cache_key, len, "%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s\n%s",
+               or_empty(sf->host), or_empty(sf->account), or_empty(sf->user),
+               or_empty(sf->role), or_empty(sf->database), or_empty(sf->schema),
+               or_empty(sf->warehouse), or_empty(sf->authenticator), credentials);
+    sb_sprintf(sf->token_cache_file, MAX_PATH, "%s%csf_token_%016llx.json",
+               sf->token_cache_dir, PATH_SEP,
+               (unsigned long long) sf_hashmap_hash(sf->token_cache_key));
+    return SF_BOOLEAN_TRUE;
+}
+
+cJSON *STDCALL sf_token_cache_load(SF_CONNECT *sf) {
+    cJSON *entry;
+    unsigned long long now = now_ms();
+    double token_expires_at;
+
+    if (!sf->token_cache_file || (entry = read_entry(sf)) == NULL) {
+        return NULL;
+    }
+    if (get_number(entry, "masterTokenExpiresAt") <= (double) now ||
+        !snowflake_cJSON_IsString(snowflake_cJSON_GetObjectItem(entry, "token")) ||
+        !snowflake_cJSON_IsString(snowflake_cJSON_GetObjectItem(entry, "masterToken"))) {
+        log_debug("The cached session expired, logging in");
+        snowflake_cJSON_Delete(entry);
+        sf_token_cache_remove(sf);
+        return NULL;
+    }
+    token_expires_at = get_number(entry, "tokenExpiresAt");
+    set_item(entry, "validityInSeconds",
+             snowflake_cJSON_CreateNumber((token_expires_at - (double) now) / 1000));
+    return entry;
+}
+
+void STDCALL sf_token_cache_save(SF_CONNECT *sf, cJSON *data, const char *session_token_str) {
+    cJSON *entry;
+    cJSON *token = snowflake_cJSON_GetObjectItem(data, session_token_str);
+    cJSON *master_token = snowflake_cJSON_GetObjectItem(data, "masterToken");
+    cJSON *item;
+    unsigned long long now = now_ms();
+    double validity;
+    double master_validity;
+
+    if (!sf->token_cache_file || !snowflake_cJSON_IsString(token) ||
+        !snowflake_cJSON_IsString(master_token)) {
+        return;
+    }
+    // The login of the session left the parameters for the renewals
+    if ((entry = read_entry(sf)) == NULL) {
+        entry = snowflake_cJSON_CreateObject();
+        snowflake_cJSON_AddStringToObject(entry, "key", sf->token_cache_key);
+    }
+    set_item(entry, "token", snowflake_cJSON_CreateString(token->valuestring));
+    set_item(entry, "masterToken", snowflake_cJSON_CreateString(master_token->valuestring));
+
+    // A session token of unknown validity is renewed by the next process
+    validity = get_validity(data, "validityInSeconds", "validityInSecondsST");
+    set_item(entry, "tokenExpiresAt",
+             snowflake_cJSON_CreateNumber((double) now + (validity > 0 ? validity * 1000 : 0)));
+    master_validity = get_validity(data, "masterValidityInSeconds", "validityInSecondsMT");
+    if (master_validity > 0) {
+        set_item(entry, "masterTokenExpiresAt",
+                 snowflake_cJSON_CreateNumber((double) now + master_validity * 1000));
+    } else if (get_number(entry, "masterTokenExpiresAt") <= 0) {
+        // Without an expiry the master token could be used long after the server dropped it
+        log_debug("No master token validity in the response, the session isn't cached");
+        snowflake_cJSON_Delete(entry);
+        return;
+    }
+    if ((item = snowflake_cJSON_GetObjectItem(data, "parameters")) != NULL) {
+        set_item(entry, "parameters", snowflake_cJSON_Duplicate(item, 1));
+    }
+    if ((item = snowflake_cJSON_GetObjectItem(data, "sessionInfo")) != NULL) {
+        set_item(entry, "sessionInfo", snowflake_cJSON_Duplicate(item, 1));
+    }
+
+    write_entry(sf, entry);
+    snowflake_cJSON_Delete(entry);
+}
+
+void STDCALL sf_token_cache_remove(SF_CONNECT *sf) {
+    if (sf->token_cache_file && remove(sf->token_cache_file) == 0) {
+        log_debug("Removed the cached session %s", sf->token_cache_file);
+    }
+}
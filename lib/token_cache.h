@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_TOKEN_CACHE_H
+#define SNOWFLAKE_TOKEN_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "cJSON.h"
+
+// Largest cache file read back, the session parameters make up most of it
+#define SF_TOKEN_CACHE_MAX_FILE_SIZE (1024 * 1024)
+
+/**
+ * Sessions kept on disk across processes, see SF_CON_TOKEN_CACHE_DIR. Each file holds the
+ * session and master tokens of one account, user and role, with the session objects asked for,
+ * their expiry and the session parameters of the login response, so that a process connecting
+ * right after another one can go on with its session rather than log in again.
+ *
+ * The files are only readable by the user that wrote them. Files readable by anyone else are
+ * ignored, on Windows the permissions of the directory are relied on.
+ */
+
+/**
+ * Works out the cache file of the connection from the objects and the credentials it connects
+ * with. Called before the login, as the server may change the objects afterwards.
+ *
+ * @return SF_BOOLEAN_TRUE if the connection has a cache directory.
+ */
+sf_bool STDCALL sf_token_cache_open(SF_CONNECT *sf);
+
+/**
+ * Reads the session of the connection back.
+ *
+ * @return the cached login data, with "token", "masterToken", the seconds left of the session
+ *         token in "validityInSeconds" and the "parameters" and "sessionInfo" of the login, to
+ *         be deleted by the caller. NULL if there is none, it's for other objects or the master
+ *         token expired. The session token left may have expired already.
+ */
+cJSON *STDCALL sf_token_cache_load(SF_CONNECT *sf);
+
+/**
+ * Writes the tokens of a login or session renewal response to the cache file of the
+ * connection. The parameters and session info of the login are kept by the renewals.
+ *
+ * @param data data of the response.
+ * @param session_token_str name of the session token in the response.
+ */
+void STDCALL sf_token_cache_save(SF_CONNECT *sf, cJSON *data, const char *session_token_str);
+
+/**
+ * Removes the cache file of the connection, once its tokens were rejected.
+ */
+void STDCALL sf_token_cache_remove(SF_CONNECT *sf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_TOKEN_CACHE_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <string.h>
+#include "tracing.h"
+
+static SF_TRACE_EXPORTER EXPORTER;
+static volatile unsigned long long ENABLED = 0;
+// Ids are drawn from a counter scrambled by splitmix64, seeded from the clock
+static volatile unsigned long long ID_STATE = 0;
+
+static uint64 next_id(void) {
+    uint64 z = sf_atomic_fetch_add(&ID_STATE, 0x9E3779B97F4A7C15ULL) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    // All zero ids are invalid
+    return z ? z : 1;
+}
+
+static void write_hex(char *out, uint64 value) {
+    static const char DIGITS[] = "0123456789abcdef";
+    int i;
+    for (i = 15; i >= 0; i--) {
+        out[i] = DIGITS[value & 0xf];
+        value >>= 4;
+    }
+}
+
+void STDCALL sf_trace_set_exporter(const SF_TRACE_EXPORTER *exporter) {
+    sf_atomic_store(&ENABLED, 0);
+    if (!exporter || !exporter->export_fn) {
+        return;
+    }
+    EXPORTER = *exporter;
+    sf_atomic_compare_exchange(&ID_STATE, 0, sf_unix_time_ns() ^
+                                             (unsigned long long) (size_t) &EXPORTER);
+    sf_atomic_store(&ENABLED, 1);
+}
+
+const SF_TRACE_EXPORTER *STDCALL sf_trace_get_exporter(void) {
+    return sf_trace_enabled() ? &EXPORTER : NULL;
+}
+
+sf_bool STDCALL sf_trace_enabled(void) {
+    return sf_atomic_load(&ENABLED) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+static void start(SF_TRACE_SPAN *span, const char *name, const SF_TRACE_CONTEXT *parent,
+                  uint64 elapsed_ms) {
+    memset(span, 0, sizeof(SF_TRACE_SPAN));
+    if (!sf_trace_enabled()) {
+        return;
+    }
+    span->name = name;
+    if (parent) {
+        memcpy(span->trace_id, parent->trace_id, SF_TRACE_ID_LEN);
+        memcpy(span->parent_span_id, parent->span_id, SF_SPAN_ID_LEN);
+        memcpy(span->sfqid, parent->sfqid, SF_UUID4_LEN);
+        memcpy(span->request_id, parent->request_id, SF_UUID4_LEN);
+    } else {
+        write_hex(span->trace_id, next_id());
+        write_hex(span->trace_id + 16, next_id());
+    }
+    write_hex(span->span_id, next_id());
+    span->chunk_index = -1;
+    span->bytes = -1;
+    span->start_time_ns = sf_unix_time_ns() - elapsed_ms * 1000000;
+}
+
+void STDCALL sf_span_start(SF_TRACE_SPAN *span, const char *name,
+                           const SF_TRACE_CONTEXT *parent) {
+    start(span, name, parent, 0);
+}
+
+void STDCALL sf_span_start_child(SF_TRACE_SPAN *span, const char *name,
+                                 const SF_TRACE_CONTEXT *parent, uint64 elapsed_ms) {
+    if (!parent || !parent->trace_id[0]) {
+        memset(span, 0, sizeof(SF_TRACE_SPAN));
+        return;
+    }
+    start(span, name, parent, elapsed_ms);
+}
+
+void STDCALL sf_span_end(SF_TRACE_SPAN *span, SF_STATUS status) {
+    SF_TRACE_EXPORTER exporter;
+    if (!span->name) {
+        return;
+    }
+    span->end_time_ns = sf_unix_time_ns();
+    span->status = status;
+    if (sf_trace_enabled()) {
+        exporter = EXPORTER;
+        exporter.export_fn(span, exporter.user_data);
+    }
+    span->name = NULL;
+}
+
+sf_bool STDCALL sf_span_active(const SF_TRACE_SPAN *span) {
+    return span->name ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+}
+
+void STDCALL sf_span_context(const SF_TRACE_SPAN *span, SF_TRACE_CONTEXT *context) {
+    memcpy(context->trace_id, span->trace_id, SF_TRACE_ID_LEN);
+    memcpy(context->span_id, span->span_id, SF_SPAN_ID_LEN);
+    memcpy(context->sfqid, span->sfqid, SF_UUID4_LEN);
+    memcpy(context->request_id, span->request_id, SF_UUID4_LEN);
+}
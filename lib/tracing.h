@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_TRACING_H
+#define SNOWFLAKE_TRACING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+
+/**
+ * Sets the exporter spans are handed to, NULL or one without export_fn to stop tracing.
+ * Spans ending at the same time may still go to the previous exporter.
+ */
+void STDCALL sf_trace_set_exporter(const SF_TRACE_EXPORTER *exporter);
+
+/**
+ * @return the exporter spans are handed to, NULL if tracing is off.
+ */
+const SF_TRACE_EXPORTER *STDCALL sf_trace_get_exporter(void);
+
+/**
+ * @return true if there is an exporter. Spans started while there is none are not exported.
+ */
+sf_bool STDCALL sf_trace_enabled(void);
+
+/**
+ * Starts a span now, as a child of parent, inheriting its query id and request id, or as the
+ * root of a new trace if parent is NULL. Does nothing if tracing is off.
+ */
+void STDCALL sf_span_start(SF_TRACE_SPAN *span, const char *name,
+                           const SF_TRACE_CONTEXT *parent);
+
+/**
+ * Starts a span as a child of parent that started the given number of milliseconds ago.
+ * Does nothing if the parent is NULL or empty, i.e. wasn't traced.
+ */
+void STDCALL sf_span_start_child(SF_TRACE_SPAN *span, const char *name,
+                                 const SF_TRACE_CONTEXT *parent, uint64 elapsed_ms);
+
+/**
+ * Ends a span now and exports it. Does nothing if the span wasn't started.
+ */
+void STDCALL sf_span_end(SF_TRACE_SPAN *span, SF_STATUS status);
+
+/**
+ * @return true if the span was started and not ended yet.
+ */
+sf_bool STDCALL sf_span_active(const SF_TRACE_SPAN *span);
+
+/**
+ * Makes the span the parent of the spans started with the context.
+ */
+void STDCALL sf_span_context(const SF_TRACE_SPAN *span, SF_TRACE_CONTEXT *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_TRACING_H
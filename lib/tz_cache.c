@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <snowflake/logger.h>
+#include "tz_cache.h"
+#include "memory.h"
+
+#define SF_TZ_SECONDS_IN_DAY 86400L
+#define SF_TZ_HEADER_SIZE 44
+
+/**
+ * A local time type of a timezone.
+ */
+typedef struct SF_TZ_TYPE {
+    int32 gmtoff;
+    int isdst;
+    char abbrev[SF_TZ_ABBREV_SIZE];
+} SF_TZ_TYPE;
+
+/**
+ * A daylight saving time change of a POSIX TZ rule.
+ */
+typedef struct SF_TZ_RULE_DATE {
+    // 'J' for Jn, 'D' for n and 'M' for Mm.w.d
+    char kind;
+    int day;
+    int week;
+    int month;
+    // Local time of the change, in seconds after midnight
+    int32 time;
+} SF_TZ_RULE_DATE;
+
+struct SF_TZ_RULES {
+    char *name;
+    // Set if the timezone is not in the zoneinfo database, so it isn't looked up again
+    sf_bool missing;
+    int64 *transitions;
+    uint8 *transition_types;
+    size_t transition_count;
+    SF_TZ_TYPE *types;
+    size_t type_count;
+    // POSIX TZ rule for the times after the last transition
+    sf_bool has_rule;
+    sf_bool rule_has_dst;
+    SF_TZ_TYPE rule_std;
+    SF_TZ_TYPE rule_dst;
+    SF_TZ_RULE_DATE rule_start;
+    SF_TZ_RULE_DATE rule_end;
+    struct SF_TZ_RULES *next;
+};
+
+static SF_MUTEX_HANDLE tz_cache_lock;
+static SF_TZ_RULES *tz_cache = NULL;
+
+static uint32 tz_read32(const unsigned char *p) {
+    return ((uint32) p[0] << 24) | ((uint32) p[1] << 16) | ((uint32) p[2] << 8) | (uint32) p[3];
+}
+
+static int64 tz_read64(const unsigned char *p) {
+    return (int64) (((uint64) tz_read32(p) << 32) | (uint64) tz_read32(p + 4));
+}
+
+/**
+ * Days since the epoch of a date of the proleptic Gregorian calendar.
+ */
+static int64 tz_days_from_civil(int64 year, int month, int day) {
+    year -= month <= 2;
+    int64 era = (year >= 0 ? year : year - 399) / 400;
+    int64 year_of_era = year - era * 400;
+    int64 day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64 day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static int64 tz_year_from_days(int64 days) {
+    int64 z = days + 719468;
+    int64 era = (z >= 0 ? z : z - 146096) / 146097;
+    int64 day_of_era = z - era * 146097;
+    int64 year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64 day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64 shifted_month = (5 * day_of_year + 2) / 153;
+    return year_of_era + era * 400 + (shifted_month >= 10 ? 1 : 0);
+}
+
+static sf_bool tz_is_leap(int64 year) {
+    return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+}
+
+static int64 tz_floor_div(int64 value, int64 divisor) {
+    int64 quotient = value / divisor;
+    return (value % divisor < 0) ? quotient - 1 : quotient;
+}
+
+// POSIX TZ rules =================================================================================
+
+static const char *tz_parse_name(const char *p, char *out) {
+    size_t len = 0;
+    if (*p == '<') {
+        // Quoted form, e.g. <+0545>
+        for (p++; *p && *p != '>'; p++) {
+            if (len < SF_TZ_ABBREV_SIZE - 1) {
+                out[len++] = *p;
+            }
+        }
+        if (*p != '>') {
+            return NULL;
+        }
+        p++;
+    } else {
+        for (; (*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'); p++) {
+            if (len < SF_TZ_ABBREV_SIZE - 1) {
+                out[len++] = *p;
+            }
+        }
+    }
+    out[len] = '\0';
+    return len > 0 ? p : NULL;
+}
+
+/**
+ * Parses [+-]hh[:mm[:ss]] into seconds.
+ */
+static const char *tz_parse_time(const char *p, int32 *seconds) {
+    int32 sign = 1;
+    int32 parts[3] = {0, 0, 0};
+    int part;
+    if (*p == '+' || *p == '-') {
+        sign = *p == '-' ? -1 : 1;
+        p++;
+    }
+    if (*p < '0' || *p > '9') {
+        return NULL;
+    }
+    for (part = 0; part < 3; part++) {
+        while (*p >= '0' && *p <= '9') {
+            parts[part] = parts[part] * 10 + (*p - '0');
+            if (parts[part] > 167) {
+                return NULL;
+            }
+            p++;
+        }
+        if (part == 2 || *p != ':') {
+            break;
+        }
+        p++;
+    }
+    *seconds = sign * (parts[0] * 3600 + parts[1] * 60 + parts[2]);
+    return p;
+}
+
+static const char *tz_parse_number(const char *p, int *value) {
+    if (*p < '0' || *p > '9') {
+        return NULL;
+    }
+    *value = 0;
+    while (*p >= '0' && *p <= '9') {
+        *value = *value * 10 + (*p - '0');
+        if (*value > 1000) {
+            return NULL;
+        }
+        p++;
+    }
+    return p;
+}
+
+static const char *tz_parse_date(const char *p, SF_TZ_RULE_DATE *date) {
+    memset(date, 0, sizeof(*date));
+    if (*p == 'J') {
+        date->kind = 'J';
+        p = tz_parse_number(p + 1, &date->day);
+        if (!p || date->day < 1 || date->day > 365) {
+            return NULL;
+        }
+    } else if (*p == 'M') {
+        date->kind = 'M';
+        p = tz_parse_number(p + 1, &date->month);
+        if (!p || *p != '.' || !(p = tz_parse_number(p + 1, &date->week)) ||
+            *p != '.' || !(p = tz_parse_number(p + 1, &date->day))) {
+            return NULL;
+        }
+        if (date->month < 1 || date->month > 12 || date->week < 1 || date->week > 5 ||
+            date->day > 6) {
+            return NULL;
+        }
+    } else {
+        date->kind = 'D';
+        p = tz_parse_number(p, &date->day);
+        if (!p || date->day > 365) {
+            return NULL;
+        }
+    }
+
+    date->time = 2 * 3600;
+    if (*p == '/') {
+        p = tz_parse_time(p + 1, &date->time);
+    }
+    return p;
+}
+
+/**
+ * Parses the POSIX TZ string at the end of a zoneinfo file, e.g. PST8PDT,M3.2.0,M11.1.0
+ */
+static sf_bool tz_parse_rule(SF_TZ_RULES *rules, const char *p) {
+    int32 offset;
+    if (!(p = tz_parse_name(p, rules->rule_std.abbrev)) || !(p = tz_parse_time(p, &offset))) {
+        return SF_BOOLEAN_FALSE;
+    }
+    // POSIX offsets are west of UTC
+    rules->rule_std.gmtoff = -offset;
+    rules->rule_std.isdst = 0;
+    if (*p == '\0') {
+        rules->rule_has_dst = SF_BOOLEAN_FALSE;
+        return SF_BOOLEAN_TRUE;
+    }
+
+    if (!(p = tz_parse_name(p, rules->rule_dst.abbrev))) {
+        return SF_BOOLEAN_FALSE;
+    }
+    rules->rule_dst.gmtoff = rules->rule_std.gmtoff + 3600;
+    rules->rule_dst.isdst = 1;
+    if (*p != ',' && *p != '\0') {
+        if (!(p = tz_parse_time(p, &offset))) {
+            return SF_BOOLEAN_FALSE;
+        }
+        rules->rule_dst.gmtoff = -offset;
+    }
+    if (*p == '\0') {
+        // Default to the US rules
+        p = "M3.2.0,M11.1.0";
+    } else if (*p == ',') {
+        p++;
+    } else {
+        return SF_BOOLEAN_FALSE;
+    }
+    if (!(p = tz_parse_date(p, &rules->rule_start)) || *p != ',' ||
+        !(p = tz_parse_date(p + 1, &rules->rule_end)) || *p != '\0') {
+        return SF_BOOLEAN_FALSE;
+    }
+    rules->rule_has_dst = SF_BOOLEAN_TRUE;
+    return SF_BOOLEAN_TRUE;
+}
+
+/**
+ * Local time of a daylight saving time change in the given year, as seconds since the
+ * epoch as if local time were UTC.
+ */
+static int64 tz_rule_date_local(const SF_TZ_RULE_DATE *date, int64 year) {
+    static const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int64 days;
+    if (date->kind == 'J') {
+        // Day 1 to 365, February 29th is never counted
+        days = tz_days_from_civil(year, 1, 1) + date->day - 1;
+        if (tz_is_leap(year) && date->day >= 60) {
+            days++;
+        }
+    } else if (date->kind == 'D') {
+        days = tz_days_from_civil(year, 1, 1) + date->day;
+    } else {
+        // Day d of week w of month m, week 5 being the last one
+        int64 first = tz_days_from_civil(year, date->month, 1);
+        int first_wday = (int) (((first + 4) % 7 + 7) % 7);
+        int length = month_days[date->month - 1] + (date->month == 2 && tz_is_leap(year) ? 1 : 0);
+        int mday = 1 + (date->day - first_wday + 7) % 7 + (date->week - 1) * 7;
+        while (mday > length) {
+            mday -= 7;
+        }
+        days = first + mday - 1;
+    }
+    return days * SF_TZ_SECONDS_IN_DAY + date->time;
+}
+
+static const SF_TZ_TYPE *tz_rule_type(const SF_TZ_RULES *rules, int64 utc) {
+    if (!rules->rule_has_dst) {
+        return &rules->rule_std;
+    }
+    int64 year = tz_year_from_days(tz_floor_div(utc + rules->rule_std.gmtoff, SF_TZ_SECONDS_IN_DAY));
+    // The start is in standard time and the end in daylight saving time
+    int64 start = tz_rule_date_local(&rules->rule_start, year) - rules->rule_std.gmtoff;
+    int64 end = tz_rule_date_local(&rules->rule_end, year) - rules->rule_dst.gmtoff;
+    sf_bool in_dst;
+    if (start < end) {
+        in_dst = (utc >= start && utc < end) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE;
+    } else {
+        // Southern hemisphere, daylight saving time spans the new year
+        in_dst = (utc >= end && utc < start) ? SF_BOOLEAN_FALSE : SF_BOOLEAN_TRUE;
+    }
+    return in_dst ? &rules->rule_dst : &rules->rule_std;
+}
+
+// Zoneinfo files =================================================================================
+
+/**
+ * Parses a zoneinfo file, see RFC 8536. The 64-bit data of version 2 and later is used when
+ * present.
+ */
+static sf_bool tz_parse_file(SF_TZ_RULES *rules, const unsigned char *data, size_t size) {
+    const unsigned char *header = data;
+    const unsigned char *p;
+    const unsigned char *end = data + size;
+    size_t time_size = 4;
+    size_t leap_size = 8;
+    uint32 isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+    size_t block_size;
+    size_t i;
+
+    if (size < SF_TZ_HEADER_SIZE || memcmp(data, "TZif", 4) != 0) {
+        return SF_BOOLEAN_FALSE;
+    }
+    for (;;) {
+        isutcnt = tz_read32(header + 20);
+        isstdcnt = tz_read32(header + 24);
+        leapcnt = tz_read32(header + 28);
+        timecnt = tz_read32(header + 32);
+        typecnt = tz_read32(header + 36);
+        charcnt = tz_read32(header + 40);
+        if (timecnt > SF_TZ_MAX_FILE_SIZE || typecnt == 0 || typecnt > 256 ||
+            charcnt > SF_TZ_MAX_FILE_SIZE || leapcnt > SF_TZ_MAX_FILE_SIZE ||
+            isstdcnt > typecnt || isutcnt > typecnt) {
+            return SF_BOOLEAN_FALSE;
+        }
+        block_size = timecnt * time_size + timecnt + typecnt * 6 + charcnt +
+                     leapcnt * leap_size + isstdcnt + isutcnt;
+        if ((size_t) (end - header) < SF_TZ_HEADER_SIZE + block_size) {
+            return SF_BOOLEAN_FALSE;
+        }
+        if (time_size == 8 || data[4] < '2') {
+            break;
+        }
+        // Skip the 32-bit data to the second header
+        header += SF_TZ_HEADER_SIZE + block_size;
+        if ((size_t) (end - header) < SF_TZ_HEADER_SIZE || memcmp(header, "TZif", 4) != 0) {
+            return SF_BOOLEAN_FALSE;
+        }
+        time_size = 8;
+        leap_size = 12;
+    }
+
+    rules->transitions = (int64 *) SF_CALLOC(timecnt > 0 ? timecnt : 1, sizeof(int64));
+    rules->transition_types = (uint8 *) SF_CALLOC(timecnt > 0 ? timecnt : 1, sizeof(uint8));
+    rules->types = (SF_TZ_TYPE *) SF_CALLOC(typecnt, sizeof(SF_TZ_TYPE));
+    if (!rules->transitions || !rules->transition_types || !rules->types) {
+        return SF_BOOLEAN_FALSE;
+    }
+    rules->transition_count = timecnt;
+    rules->type_count = typecnt;
+
+    p = header + SF_TZ_HEADER_SIZE;
+    for (i = 0; i < timecnt; i++, p += time_size) {
+        rules->transitions[i] = time_size == 8 ? tz_read64(p) : (int64) (int32) tz_read32(p);
+    }
+    for (i = 0; i < timecnt; i++, p++) {
+        if (*p >= typecnt) {
+            return SF_BOOLEAN_FALSE;
+        }
+        rules->transition_types[i] = *p;
+    }
+    const unsigned char *chars = p + typecnt * 6;
+    for (i = 0; i < typecnt; i++, p += 6) {
+        size_t abbrev_index = p[5];
+        rules->types[i].gmtoff = (int32) tz_read32(p);
+        rules->types[i].isdst = p[4] ? 1 : 0;
+        if (abbrev_index < charcnt) {
+            size_t len = strnlen((const char *) chars + abbrev_index, charcnt - abbrev_index);
+            if (len >= SF_TZ_ABBREV_SIZE) {
+                len = SF_TZ_ABBREV_SIZE - 1;
+            }
+            memcpy(rules->types[i].abbrev, chars + abbrev_index, len);
+        }
+    }
+
+    // The footer holds the rule for the times after the last transition
+    p = header + SF_TZ_HEADER_SIZE + block_size;
+    if (time_size == 8 && p < end && *p == '\n') {
+        const unsigned char *rule_end = memchr(p + 1, '\n', (size_t) (end - p - 1));
+        if (rule_end && rule_end > p + 1 && (size_t) (rule_end - p - 1) < 256) {
+            char rule[256];
+            memcpy(rule, p + 1, (size_t) (rule_end - p - 1));
+            rule[rule_end - p - 1] = '\0';
+            rules->has_rule = tz_parse_rule(rules, rule);
+            if (!rules->has_rule) {
+                log_debug("Unsupported rule %s for timezone %s", rule, rules->name);
+            }
+        }
+    }
+    return SF_BOOLEAN_TRUE;
+}
+
+static void tz_free_rules(SF_TZ_RULES *rules) {
+    SF_FREE(rules->name);
+    SF_FREE(rules->transitions);
+    SF_FREE(rules->transition_types);
+    SF_FREE(rules->types);
+    SF_FREE(rules);
+}
+
+/**
+ * Loads the zoneinfo file of a timezone. Leaves missing set if it can't be used.
+ */
+static void tz_load(SF_TZ_RULES *rules) {
+    const char *dir = sf_getenv("TZDIR");
+    char path[1024];
+    unsigned char *data = NULL;
+    size_t size = 0;
+    size_t chunk;
+    FILE *fp = NULL;
+
+    rules->missing = SF_BOOLEAN_TRUE;
+    // Only names of the database, never paths outside of it
+    if (rules->name[0] == '\0' || rules->name[0] == '/' || rules->name[0] == '\\' ||
+        strstr(rules->name, "..") != NULL) {
+        return;
+    }
+    if (!dir || dir[0] == '\0') {
+        dir = SF_TZ_DEFAULT_DIR;
+    }
+    if (strlen(dir) + strlen(rules->name) + 2 > sizeof(path)) {
+        return;
+    }
+    sb_sprintf(path, sizeof(path), "%s/%s", dir, rules->name);
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        log_debug("Timezone %s is not in %s", rules->name, dir);
+        return;
+    }
+    data = (unsigned char *) SF_CALLOC(1, SF_TZ_MAX_FILE_SIZE);
+    if (data) {
+        while (size < SF_TZ_MAX_FILE_SIZE &&
+               (chunk = fread(data + size, 1, SF_TZ_MAX_FILE_SIZE - size, fp)) > 0) {
+            size += chunk;
+        }
+    }
+    fclose(fp);
+
+    if (data && size < SF_TZ_MAX_FILE_SIZE && tz_parse_file(rules, data, size)) {
+        rules->missing = SF_BOOLEAN_FALSE;
+        log_debug("Loaded timezone %s, %lu transitions", rules->name,
+                  (unsigned long) rules->transition_count);
+    } else {
+        log_warn("Unable to parse timezone file %s", path);
+    }
+    SF_FREE(data);
+}
+
+void STDCALL sf_tz_cache_init() {
+    _mutex_init(&tz_cache_lock);
+}
+
+void STDCALL sf_tz_cache_term() {
+    _mutex_lock(&tz_cache_lock);
+    while (tz_cache) {
+        SF_TZ_RULES *next = tz_cache->next;
+        tz_free_rules(tz_cache);
+        tz_cache = next;
+    }
+    _mutex_unlock(&tz_cache_lock);
+    _mutex_term(&tz_cache_lock);
+}
+
+const SF_TZ_RULES *STDCALL sf_tz_cache_get(const char *name) {
+    SF_TZ_RULES *rules;
+    size_t name_len;
+
+    if (!name) {
+        return NULL;
+    }
+    _mutex_lock(&tz_cache_lock);
+    for (rules = tz_cache; rules; rules = rules->next) {
+        if (strcmp(rules->name, name) == 0) {
+            break;
+        }
+    }
+    if (!rules) {
+        rules = (SF_TZ_RULES *) SF_CALLOC(1, sizeof(SF_TZ_RULES));
+        name_len = strlen(name);
+        if (rules && (rules->name = (char *) SF_CALLOC(1, name_len + 1)) != NULL) {
+            memcpy(rules->name, name, name_len);
+            tz_load(rules);
+            rules->next = tz_cache;
+            tz_cache = rules;
+        } else if (rules) {
+            SF_FREE(rules);
+        }
+    }
+    _mutex_unlock(&tz_cache_lock);
+
+    return (rules && !rules->missing) ? rules : NULL;
+}
+
+void STDCALL sf_tz_rules_offset(const SF_TZ_RULES *rules, int64 utc, int32 *gmtoff,
+                                int *isdst, const char **abbrev) {
+    const SF_TZ_TYPE *type;
+    size_t count = rules->transition_count;
+
+    if ((count == 0 || utc >= rules->transitions[count - 1]) && rules->has_rule) {
+        type = tz_rule_type(rules, utc);
+    } else if (count == 0 || utc < rules->transitions[0]) {
+        // Times before the first transition use the first type
+        type = &rules->types[0];
+    } else {
+        // Last transition at or before the time
+        size_t low = 0;
+        size_t high = count - 1;
+        while (low < high) {
+            size_t mid = low + (high - low + 1) / 2;
+            if (rules->transitions[mid] <= utc) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        type = &rules->types[rules->transition_types[low]];
+    }
+
+    *gmtoff = type->gmtoff;
+    *isdst = type->isdst;
+    if (abbrev) {
+        *abbrev = type->abbrev;
+    }
+}
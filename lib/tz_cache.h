@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKE_TZ_CACHE_H
+#define SNOWFLAKE_TZ_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <snowflake/client.h>
+#include "snowflake/platform.h"
+
+// Directory of the zoneinfo database, unless TZDIR is set
+#define SF_TZ_DEFAULT_DIR "/usr/share/zoneinfo"
+// Upper bound on the size of a zoneinfo file
+#define SF_TZ_MAX_FILE_SIZE (1024 * 1024)
+// Size of a timezone abbreviation, including the terminator
+#define SF_TZ_ABBREV_SIZE 16
+
+/**
+ * The rules of a timezone, loaded from the zoneinfo database. They are never changed once
+ * loaded, so they can be used from any thread without a lock.
+ */
+typedef struct SF_TZ_RULES SF_TZ_RULES;
+
+void STDCALL sf_tz_cache_init();
+
+void STDCALL sf_tz_cache_term();
+
+/**
+ * Returns the rules of a timezone, loading them on first use.
+ *
+ * @param name the name of the timezone, e.g. America/Los_Angeles.
+ *
+ * @return the rules, which stay valid until sf_tz_cache_term(), or NULL if the timezone is
+ *         not in the zoneinfo database. The caller then has to go through the TZ environment
+ *         variable.
+ */
+const SF_TZ_RULES *STDCALL sf_tz_cache_get(const char *name);
+
+/**
+ * Computes the local time of a timezone at a point in time. Doesn't touch the process
+ * environment.
+ *
+ * @param rules the rules of the timezone.
+ * @param utc seconds since the epoch.
+ * @param gmtoff set to the offset of the local time, in seconds east of UTC.
+ * @param isdst set to 1 during daylight saving time, 0 otherwise.
+ * @param abbrev set to the abbreviation of the local time, e.g. PDT. May be NULL.
+ */
+void STDCALL sf_tz_rules_offset(const SF_TZ_RULES *rules, int64 utc, int32 *gmtoff,
+                                int *isdst, const char **abbrev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKE_TZ_CACHE_H
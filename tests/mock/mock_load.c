@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "mock_load.h"
+#include "../utils/mock_endpoints.h"
+
+#define MOCK_LOAD_EMPTY_RESPONSE "{\"code\":null,\"data\":null,\"message\":null,\"success\":true}"
+
+static char *query_response(const MOCK_LOAD_SERVER *server, int query, int chunks,
+                            int rows_per_chunk, int columns, size_t *size) {
+    char *resp = malloc(4096 + (size_t) columns * 256 + (size_t) chunks * 256);
+    size_t len;
+    int c;
+
+    assert_non_null(resp);
+    len = (size_t) sprintf(resp,
+                           "{\"data\":{\"parameters\":[],\"rowtype\":[{\"name\":\"C0\","
+                           "\"byteLength\":null,\"length\":null,\"type\":\"fixed\","
+                           "\"nullable\":false,\"precision\":38,\"scale\":0}");
+    for (c = 1; c < columns; c++) {
+        len += (size_t) sprintf(resp + len,
+                                ",{\"name\":\"C%d\",\"byteLength\":64,\"length\":16,"
+                                "\"type\":\"text\",\"nullable\":false,\"precision\":null,"
+                                "\"scale\":null}", c);
+    }
+    len += (size_t) sprintf(resp + len,
+                            "],\"rowset\":[],\"total\":%d,\"returned\":%d,"
+                            "\"queryId\":\"01a0c0f1-0000-0000-0000-%012d\","
+                            "\"queryResultFormat\":\"json\",\"qrmk\":\"mock\",\"chunks\":[",
+                            chunks * rows_per_chunk, chunks * rows_per_chunk, query);
+    for (c = 0; c < chunks; c++) {
+        len += (size_t) sprintf(resp + len,
+                                "%s{\"url\":\"" MOCK_LOAD_URL_STEM "%d/%d\",\"rowCount\":%d,"
+                                "\"uncompressedSize\":%llu,\"compressedSize\":%llu}",
+                                c > 0 ? "," : "", query, c, rows_per_chunk,
+                                (unsigned long long) server->chunk_size,
+                                (unsigned long long) server->chunk_size);
+    }
+    len += (size_t) sprintf(resp + len, "],\"statementTypeId\":4096,\"version\":0},"
+                                        "\"message\":null,\"code\":null,\"success\":true}");
+    *size = len;
+    return resp;
+}
+
+void mock_load_server_init(MOCK_LOAD_SERVER *server, int query_count, int chunks,
+                           int rows_per_chunk, int columns) {
+    size_t capacity = (size_t) rows_per_chunk * (size_t) (columns * 24 + 4) + 1;
+    size_t size = 0;
+    int q;
+    int r;
+    int c;
+
+    memset(server, 0, sizeof(MOCK_LOAD_SERVER));
+    server->chunk = malloc(capacity);
+    assert_non_null(server->chunk);
+    for (r = 0; r < rows_per_chunk; r++) {
+        size += (size_t) sprintf(server->chunk + size, "%s[\"%d\"", r > 0 ? "," : "", r);
+        for (c = 1; c < columns; c++) {
+            size += (size_t) sprintf(server->chunk + size, ",\"value_%d_%d\"", r % 1000, c % 100);
+        }
+        server->chunk[size++] = ']';
+    }
+    server->chunk[size] = '\0';
+    server->chunk_size = size;
+
+    server->query_count = query_count;
+    server->query_responses = calloc((size_t) query_count, sizeof(char *));
+    server->query_response_sizes = calloc((size_t) query_count, sizeof(size_t));
+    assert_non_null(server->query_responses);
+    assert_non_null(server->query_response_sizes);
+    for (q = 0; q < query_count; q++) {
+        server->query_responses[q] = query_response(server, q, chunks, rows_per_chunk, columns,
+                                                    &server->query_response_sizes[q]);
+    }
+}
+
+void mock_load_server_term(MOCK_LOAD_SERVER *server) {
+    int q;
+    for (q = 0; q < server->query_count; q++) {
+        free(server->query_responses[q]);
+    }
+    free(server->query_responses);
+    free(server->query_response_sizes);
+    free(server->chunk);
+}
+
+const char *mock_load_responder(SF_REQUEST_TYPE request_type, const char *url,
+                                const char *body, size_t *size, void *user_data) {
+    MOCK_LOAD_SERVER *server = (MOCK_LOAD_SERVER *) user_data;
+    const char *query_text;
+    int query = 0;
+    int chunk;
+    int delay;
+
+    if (strstr(url, "/session/v1/login-request")) {
+        *size = strlen(MOCK_RESPONSE_STANDARD_LOGIN);
+        return MOCK_RESPONSE_STANDARD_LOGIN;
+    }
+    if (strstr(url, "/queries/v1/query-request")) {
+        if (body && (query_text = strstr(body, MOCK_LOAD_QUERY_PREFIX)) != NULL) {
+            query = atoi(query_text + strlen(MOCK_LOAD_QUERY_PREFIX));
+        }
+        if (query < 0 || query >= server->query_count) {
+            query = 0;
+        }
+        mock_load_sleep_ms(server->latency_ms);
+        *size = server->query_response_sizes[query];
+        return server->query_responses[query];
+    }
+    if (strncmp(url, MOCK_LOAD_URL_STEM, strlen(MOCK_LOAD_URL_STEM)) == 0 &&
+        sscanf(url + strlen(MOCK_LOAD_URL_STEM), "%d/%d", &query, &chunk) == 2) {
+        delay = server->chunk_delay ? server->chunk_delay(server, query, chunk) :
+                server->latency_ms;
+        if (delay < 0) {
+            return NULL;
+        }
+        mock_load_sleep_ms(delay);
+        *size = server->chunk_size;
+        return server->chunk;
+    }
+    *size = strlen(MOCK_LOAD_EMPTY_RESPONSE);
+    return MOCK_LOAD_EMPTY_RESPONSE;
+}
+
+void mock_load_sleep_ms(int ms) {
+    if (ms <= 0) {
+        return;
+    }
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep((useconds_t) ms * 1000);
+#endif
+}
+
+void mock_load_report_lock_stats(const char *label) {
+    static const char *const kinds[SF_LOCK_KIND_COUNT] = {
+        "critical section", "rwlock read", "rwlock write", "mutex"};
+    SF_LOCK_STATS stats[SF_LOCK_KIND_COUNT];
+    int i;
+
+    if (!sf_lock_stats_get(stats)) {
+        printf("%s: locks not profiled, build with SF_LOCK_PROFILING\n", label);
+        return;
+    }
+    for (i = 0; i < SF_LOCK_KIND_COUNT; i++) {
+        if (stats[i].acquisitions == 0) {
+            continue;
+        }
+        printf("%s: %-16s %10llu acquired, %5.2f%% contended, wait %8.0f ns avg %10llu ns max, "
+               "hold %8.0f ns avg %10llu ns max\n",
+               label, kinds[i], stats[i].acquisitions,
+               100.0 * stats[i].contended / stats[i].acquisitions,
+               stats[i].contended ? (double) stats[i].wait_ns / stats[i].contended : 0.0,
+               stats[i].max_wait_ns, (double) stats[i].hold_ns / stats[i].acquisitions,
+               stats[i].max_hold_ns);
+    }
+}
+
+void mock_load_run_threads(void *(*fn)(void *), void *args, size_t arg_size, int count,
+                           struct timespec *begin, struct timespec *end) {
+    SF_THREAD_HANDLE *threads = calloc((size_t) count, sizeof(SF_THREAD_HANDLE));
+    int i;
+
+    assert_non_null(threads);
+    clock_gettime(CLOCK_MONOTONIC, begin);
+    for (i = 0; i < count; i++) {
+        assert_int_equal(_thread_init(&threads[i], fn, (char *) args + (size_t) i * arg_size), 0);
+    }
+    for (i = 0; i < count; i++) {
+        _thread_join(threads[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, end);
+    free(threads);
+}
+
+void mock_load_watchdog(unsigned int seconds) {
+#ifndef _WIN32
+    alarm(seconds);
+#endif
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#ifndef SNOWFLAKECLIENT_MOCK_LOAD_H
+#define SNOWFLAKECLIENT_MOCK_LOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+#include "../utils/test_setup.h"
+#include "mock_http_perform.h"
+
+/**
+ * Helpers of the mock tests loading the client with many statements at once: a mock server of
+ * JSON results answering from memory, and the running and reporting of the rounds.
+ */
+
+#define MOCK_LOAD_URL_STEM "https://mock-results.s3.amazonaws.com/results/"
+// Queries with this text before their number are answered with the result of that number,
+// the others with the first result
+#define MOCK_LOAD_QUERY_PREFIX "select mock_query_"
+
+typedef struct MOCK_LOAD_SERVER MOCK_LOAD_SERVER;
+
+/**
+ * @return the milliseconds to wait before answering a chunk of a query, -1 to fail it.
+ */
+typedef int (*MOCK_LOAD_CHUNK_DELAY)(const MOCK_LOAD_SERVER *server, int query, int chunk);
+
+/**
+ * Results of the queries, only read while the statements run. Every chunk is the same, each
+ * row holding its position in the chunk followed by text for the other columns.
+ */
+struct MOCK_LOAD_SERVER {
+    char **query_responses;
+    size_t *query_response_sizes;
+    int query_count;
+    char *chunk;
+    size_t chunk_size;
+    // Milliseconds before a query, or a chunk without a chunk_delay, is answered
+    int latency_ms;
+    MOCK_LOAD_CHUNK_DELAY chunk_delay;
+    void *user_data;
+};
+
+/**
+ * Generates the results, the first column a number and the others text.
+ */
+void mock_load_server_init(MOCK_LOAD_SERVER *server, int query_count, int chunks,
+                           int rows_per_chunk, int columns);
+
+void mock_load_server_term(MOCK_LOAD_SERVER *server);
+
+/**
+ * The responder of mock_http_perform_set_responder(), the user data being the server.
+ */
+const char *mock_load_responder(SF_REQUEST_TYPE request_type, const char *url,
+                                const char *body, size_t *size, void *user_data);
+
+void mock_load_sleep_ms(int ms);
+
+/**
+ * Prints the contention of the locks since sf_lock_stats_reset(), when the library is built
+ * with SF_LOCK_PROFILING.
+ */
+void mock_load_report_lock_stats(const char *label);
+
+/**
+ * Runs a function on threads of their own, one per argument, and waits for them. cmocka must
+ * not be called off the main thread so the function should only record its outcome.
+ *
+ * @param args the arguments, arg_size bytes apart.
+ * @param begin receives the time before the threads are started.
+ * @param end receives the time after all of them are done.
+ */
+void mock_load_run_threads(void *(*fn)(void *), void *args, size_t arg_size, int count,
+                           struct timespec *begin, struct timespec *end);
+
+/**
+ * Kills the test after the given seconds, so that a fetch that never returns fails the test
+ * rather than blocking the build.
+ */
+void mock_load_watchdog(unsigned int seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SNOWFLAKECLIENT_MOCK_LOAD_H
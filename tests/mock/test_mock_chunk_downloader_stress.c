@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Many statements fetching at once, each from its own connection, with the chunks answered by
+ * the mock after a delay and some of them failing. The delays and the failures only depend on
+ * the statement and the chunk, so every run waits and fails the same way: the statements whose
+ * chunk fails must report an error without hanging, all the others must return every row.
+ *
+ * Each round reports its throughput as a performance result and, when the library is built
+ * with SF_LOCK_PROFILING, the contention of the locks of the fetch path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/test_setup.h"
+#include "mock_load.h"
+
+#define STRESS_STATEMENTS 16
+#define STRESS_CHUNKS 12
+#define STRESS_ROWS_PER_CHUNK 200
+// Every statement of this many fails one of its chunks
+#define STRESS_FAILURE_PERIOD 5
+// Seconds before a run that hangs is killed
+#define STRESS_WATCHDOG_SECONDS 300
+
+typedef struct STRESS_ROUND {
+    const char *label;
+    uint64 downloader_threads;
+    uint64 fetch_slots;
+    // Longest delay of a chunk, 0 to answer at once
+    int max_delay_ms;
+} STRESS_ROUND;
+
+static const STRESS_ROUND STRESS_ROUNDS[] = {
+    {"chunk_downloader_stress_1_thread", 1, 2, 4},
+    {"chunk_downloader_stress_2_threads", 2, 4, 4},
+    {"chunk_downloader_stress_8_threads", 8, 8, 4},
+    {"chunk_downloader_stress_8_threads_no_delay", 8, 2, 0},
+};
+
+typedef struct STRESS_STATEMENT {
+    const STRESS_ROUND *round;
+    int index;
+    SF_STATUS connect_status;
+    SF_STATUS fetch_status;
+    int64 rows;
+    // Rows whose value isn't the one of the chunk served
+    int64 bad_rows;
+    char error_message[256];
+} STRESS_STATEMENT;
+
+static sf_bool is_failing(int statement) {
+    return statement % STRESS_FAILURE_PERIOD == STRESS_FAILURE_PERIOD - 1;
+}
+
+static int failing_chunk(int statement) {
+    return statement % STRESS_CHUNKS;
+}
+
+/**
+ * The delays and the failures only depend on the statement and the chunk
+ */
+static int chunk_delay(const MOCK_LOAD_SERVER *server, int statement, int chunk) {
+    const STRESS_ROUND *round = (const STRESS_ROUND *) server->user_data;
+    if (is_failing(statement) && chunk == failing_chunk(statement)) {
+        return -1;
+    }
+    if (round->max_delay_ms == 0) {
+        return 0;
+    }
+    return (statement * 7 + chunk * 13) % (round->max_delay_ms + 1);
+}
+
+/**
+ * Runs a statement, cmocka must not be called off the main thread so the outcome is only
+ * recorded
+ */
+static void *run_statement(void *arg) {
+    STRESS_STATEMENT *stmt = (STRESS_STATEMENT *) arg;
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STMT *sfstmt;
+    char query[64];
+    int64 value;
+
+    snowflake_set_attribute(sf, SF_CON_CHUNK_DOWNLOADER_THREADS,
+                            &stmt->round->downloader_threads);
+    snowflake_set_attribute(sf, SF_CON_CHUNK_DOWNLOADER_FETCH_SLOTS, &stmt->round->fetch_slots);
+    stmt->connect_status = snowflake_connect(sf);
+    if (stmt->connect_status != SF_STATUS_SUCCESS) {
+        snprintf(stmt->error_message, sizeof(stmt->error_message), "%s",
+                 sf->error.msg ? sf->error.msg : "");
+        snowflake_term(sf);
+        return NULL;
+    }
+
+    sfstmt = snowflake_stmt(sf);
+    sprintf(query, MOCK_LOAD_QUERY_PREFIX "%d", stmt->index);
+    stmt->fetch_status = snowflake_query(sfstmt, query, 0);
+    if (stmt->fetch_status == SF_STATUS_SUCCESS) {
+        while ((stmt->fetch_status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+            snowflake_column_as_int64(sfstmt, 1, &value);
+            if (value != stmt->rows % STRESS_ROWS_PER_CHUNK) {
+                stmt->bad_rows++;
+            }
+            stmt->rows++;
+        }
+    }
+    if (stmt->fetch_status != SF_STATUS_EOF) {
+        snprintf(stmt->error_message, sizeof(stmt->error_message), "%s",
+                 sfstmt->error.msg ? sfstmt->error.msg : "");
+    }
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+    return NULL;
+}
+
+static void run_round(const STRESS_ROUND *round) {
+    MOCK_LOAD_SERVER server;
+    STRESS_STATEMENT stmts[STRESS_STATEMENTS];
+    struct timespec begin, end;
+    int64 rows = 0;
+    int s;
+
+    mock_load_server_init(&server, STRESS_STATEMENTS, STRESS_CHUNKS, STRESS_ROWS_PER_CHUNK, 1);
+    server.chunk_delay = chunk_delay;
+    server.user_data = (void *) round;
+    memset(stmts, 0, sizeof(stmts));
+    for (s = 0; s < STRESS_STATEMENTS; s++) {
+        stmts[s].round = round;
+        stmts[s].index = s;
+    }
+    mock_http_perform_set_responder(mock_load_responder, &server);
+    sf_lock_stats_reset();
+
+    mock_load_run_threads(run_statement, stmts, sizeof(STRESS_STATEMENT), STRESS_STATEMENTS,
+                          &begin, &end);
+    mock_http_perform_set_responder(NULL, NULL);
+
+    for (s = 0; s < STRESS_STATEMENTS; s++) {
+        STRESS_STATEMENT *stmt = &stmts[s];
+        if (stmt->connect_status != SF_STATUS_SUCCESS) {
+            fail_msg("%s: statement %d did not connect: %s", round->label, s,
+                     stmt->error_message);
+        }
+        if (is_failing(s)) {
+            if (stmt->fetch_status == SF_STATUS_SUCCESS || stmt->fetch_status == SF_STATUS_EOF) {
+                fail_msg("%s: the failed chunk of statement %d was not reported", round->label, s);
+            }
+            assert_true(stmt->rows <= (int64) failing_chunk(s) * STRESS_ROWS_PER_CHUNK);
+        } else {
+            if (stmt->fetch_status != SF_STATUS_EOF) {
+                fail_msg("%s: statement %d failed: %s", round->label, s, stmt->error_message);
+            }
+            assert_int_equal(stmt->rows, STRESS_CHUNKS * STRESS_ROWS_PER_CHUNK);
+        }
+        assert_int_equal(stmt->bad_rows, 0);
+        rows += stmt->rows;
+    }
+
+    process_results(begin, end, (int) rows, round->label);
+    mock_load_report_lock_stats(round->label);
+    mock_load_server_term(&server);
+}
+
+void test_chunk_downloader_stress(void **unused) {
+    size_t i;
+    for (i = 0; i < sizeof(STRESS_ROUNDS) / sizeof(STRESS_ROUNDS[0]); i++) {
+        run_round(&STRESS_ROUNDS[i]);
+    }
+}
+
+int test_setup(void **unused) {
+    putenv("SNOWFLAKE_TEST_HOST=standard.snowflakecomputing.com");
+    putenv("SNOWFLAKE_TEST_USER=standarduser");
+    putenv("SNOWFLAKE_TEST_ACCOUNT=standard");
+    putenv("SNOWFLAKE_TEST_PASSWORD=secret-password");
+    return 0;
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    log_set_level(SF_LOG_WARN);
+    mock_load_watchdog(STRESS_WATCHDOG_SECONDS);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_chunk_downloader_stress),
+    };
+    int ret = cmocka_run_group_tests(tests, test_setup, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * How the client scales with concurrency, end to end but without a server: each round runs
+ * a number of threads sharing a number of connections, each thread running its statements one
+ * after the other and fetching all their rows, the query responses and the chunks answered by
+ * the mock after an injected latency. The rounds grow the number of threads so that the round
+ * where the throughput stops growing with them shows where the client stops scaling, the lock
+ * contention reported with each round telling which locks are the cause when the library is
+ * built with SF_LOCK_PROFILING.
+ *
+ * Each round reports rows and statements per second, the median and 99th percentile latency
+ * of the statements, from the query to their last row, and the CPU time of the process per row.
+ * The rounds are set with environment variables:
+ *   SNOWFLAKE_TEST_SCALING_THREADS       the threads of each round, "1,2,4,8" by default,
+ *   SNOWFLAKE_TEST_SCALING_CONNECTIONS   the connections shared by the threads, 0, the
+ *                                        default, for one connection per thread,
+ *   SNOWFLAKE_TEST_SCALING_STATEMENTS    the statements each thread runs, 4 by default,
+ *   SNOWFLAKE_TEST_SCALING_CHUNKS        the chunks of each result, 4 by default,
+ *   SNOWFLAKE_TEST_SCALING_ROWS          the rows of each chunk, 500 by default,
+ *   SNOWFLAKE_TEST_SCALING_COLUMNS       the columns of each row, 4 by default,
+ *   SNOWFLAKE_TEST_SCALING_LATENCY_MS    the latency of the queries and chunks, 2 by default,
+ *   SNOWFLAKE_TEST_SCALING_DOWNLOADERS   the chunk downloader threads of each statement, 0,
+ *                                        the default, for the default of the connection.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "../utils/test_setup.h"
+#include "mock_load.h"
+
+#define SCALING_MAX_ROUNDS 16
+// Seconds before a run that hangs is killed
+#define SCALING_WATCHDOG_SECONDS 600
+
+typedef struct SCALING_CONFIG {
+    int threads[SCALING_MAX_ROUNDS];
+    int round_count;
+    int connections;
+    int statements;
+    int chunks;
+    int rows_per_chunk;
+    int columns;
+    int latency_ms;
+    uint64 downloader_threads;
+} SCALING_CONFIG;
+
+typedef struct SCALING_THREAD {
+    const SCALING_CONFIG *config;
+    SF_CONNECT *sf;
+    // Milliseconds of each statement of the thread, from the query to its last row
+    double *latencies_ms;
+    int64 rows;
+    SF_STATUS status;
+    char error_message[256];
+} SCALING_THREAD;
+
+static int env_int(const char *name, int default_value) {
+    const char *value = getenv(name);
+    return value && *value ? atoi(value) : default_value;
+}
+
+static void config_init(SCALING_CONFIG *config) {
+    const char *threads = getenv("SNOWFLAKE_TEST_SCALING_THREADS");
+    const char *p;
+
+    memset(config, 0, sizeof(SCALING_CONFIG));
+    p = threads && *threads ? threads : "1,2,4,8";
+    while (p && config->round_count < SCALING_MAX_ROUNDS) {
+        int count = atoi(p);
+        if (count > 0) {
+            config->threads[config->round_count++] = count;
+        }
+        p = strchr(p, ',');
+        if (p) {
+            p++;
+        }
+    }
+    config->connections = env_int("SNOWFLAKE_TEST_SCALING_CONNECTIONS", 0);
+    config->statements = env_int("SNOWFLAKE_TEST_SCALING_STATEMENTS", 4);
+    config->chunks = env_int("SNOWFLAKE_TEST_SCALING_CHUNKS", 4);
+    config->rows_per_chunk = env_int("SNOWFLAKE_TEST_SCALING_ROWS", 500);
+    config->columns = env_int("SNOWFLAKE_TEST_SCALING_COLUMNS", 4);
+    config->latency_ms = env_int("SNOWFLAKE_TEST_SCALING_LATENCY_MS", 2);
+    config->downloader_threads = (uint64) env_int("SNOWFLAKE_TEST_SCALING_DOWNLOADERS", 0);
+}
+
+static double elapsed_ms(struct timespec begin, struct timespec end) {
+    return (double) (end.tv_sec - begin.tv_sec) * 1e3 +
+           (double) (end.tv_nsec - begin.tv_nsec) / 1e6;
+}
+
+/**
+ * @return the CPU time of the process in seconds, user and system, or 0 where not known
+ */
+static double cpu_seconds(void) {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Runs the statements of a thread, cmocka must not be called off the main thread so the
+ * outcome is only recorded
+ */
+static void *run_thread(void *arg) {
+    SCALING_THREAD *thread = (SCALING_THREAD *) arg;
+    const SCALING_CONFIG *config = thread->config;
+    struct timespec begin, end;
+    const char *value;
+    int s;
+    int c;
+
+    for (s = 0; s < config->statements; s++) {
+        SF_STMT *sfstmt = snowflake_stmt(thread->sf);
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        thread->status = snowflake_query(sfstmt, "select * from scaling", 0);
+        if (thread->status == SF_STATUS_SUCCESS) {
+            while ((thread->status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+                for (c = 1; c <= config->columns; c++) {
+                    snowflake_column_as_const_str(sfstmt, c, &value);
+                }
+                thread->rows++;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        thread->latencies_ms[s] = elapsed_ms(begin, end);
+        if (thread->status != SF_STATUS_EOF) {
+            snprintf(thread->error_message, sizeof(thread->error_message), "%s",
+                     sfstmt->error.msg ? sfstmt->error.msg : "");
+            snowflake_stmt_term(sfstmt);
+            return NULL;
+        }
+        snowflake_stmt_term(sfstmt);
+    }
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * @return the value at the given percentile of sorted values, the nearest rank
+ */
+static double percentile(const double *sorted, size_t count, double pct) {
+    size_t rank = (size_t) (pct / 100.0 * (double) count + 0.5);
+    if (count == 0) {
+        return 0;
+    }
+    return sorted[rank == 0 ? 0 : (rank > count ? count - 1 : rank - 1)];
+}
+
+/**
+ * Runs a round, the connections are made before it so that only the statements are measured
+ * @return the rows per second of the round
+ */
+static double run_round(const SCALING_CONFIG *config, int thread_count,
+                        double single_thread_rate) {
+    int connection_count = config->connections > 0 && config->connections < thread_count ?
+                           config->connections : thread_count;
+    SF_CONNECT **connections = calloc((size_t) connection_count, sizeof(SF_CONNECT *));
+    SCALING_THREAD *threads = calloc((size_t) thread_count, sizeof(SCALING_THREAD));
+    double *latencies = calloc((size_t) thread_count * (size_t) config->statements,
+                               sizeof(double));
+    size_t latency_count = (size_t) thread_count * (size_t) config->statements;
+    int64 expected = (int64) config->chunks * config->rows_per_chunk * config->statements;
+    struct timespec begin, end;
+    double cpu_begin, cpu;
+    double seconds;
+    double rate;
+    int64 rows = 0;
+    char label[128];
+    int i;
+
+    assert_non_null(connections);
+    assert_non_null(threads);
+    assert_non_null(latencies);
+    snprintf(label, sizeof(label), "concurrency_scaling_%d_threads_%d_connections",
+             thread_count, connection_count);
+
+    for (i = 0; i < connection_count; i++) {
+        SF_STATUS status;
+        connections[i] = setup_snowflake_connection();
+        if (config->downloader_threads > 0) {
+            snowflake_set_attribute(connections[i], SF_CON_CHUNK_DOWNLOADER_THREADS,
+                                    &config->downloader_threads);
+        }
+        status = snowflake_connect(connections[i]);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(&(connections[i]->error));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+    }
+    sf_lock_stats_reset();
+
+    for (i = 0; i < thread_count; i++) {
+        threads[i].config = config;
+        threads[i].sf = connections[i % connection_count];
+        threads[i].latencies_ms = latencies + (size_t) i * (size_t) config->statements;
+    }
+    cpu_begin = cpu_seconds();
+    mock_load_run_threads(run_thread, threads, sizeof(SCALING_THREAD), thread_count, &begin,
+                          &end);
+    cpu = cpu_seconds() - cpu_begin;
+
+    for (i = 0; i < thread_count; i++) {
+        if (threads[i].status != SF_STATUS_EOF) {
+            fail_msg("%s: thread %d failed: %s", label, i, threads[i].error_message);
+        }
+        assert_int_equal(threads[i].rows, expected);
+        rows += threads[i].rows;
+    }
+
+    qsort(latencies, latency_count, sizeof(double), compare_double);
+    seconds = elapsed_ms(begin, end) / 1e3;
+    rate = rows / seconds;
+    process_results(begin, end, (int) rows, label);
+    printf("%s: %.0f rows/s, %.1f statements/s, latency p50 %.2f ms p99 %.2f ms, "
+           "%.0f ns CPU/row, %.0f%% of linear scaling\n",
+           label, rate, latency_count / seconds, percentile(latencies, latency_count, 50),
+           percentile(latencies, latency_count, 99), rows > 0 ? cpu * 1e9 / rows : 0.0,
+           single_thread_rate > 0 ? 100.0 * rate / (single_thread_rate * thread_count) : 100.0);
+    mock_load_report_lock_stats(label);
+
+    for (i = 0; i < connection_count; i++) {
+        snowflake_term(connections[i]);
+    }
+    free(latencies);
+    free(threads);
+    free(connections);
+    return rate;
+}
+
+void test_concurrency_scaling(void **unused) {
+    SCALING_CONFIG config;
+    MOCK_LOAD_SERVER server;
+    double single_thread_rate = 0;
+    int i;
+
+    config_init(&config);
+    assert_true(config.round_count > 0);
+    assert_true(config.statements > 0 && config.chunks > 0);
+    assert_true(config.rows_per_chunk > 0 && config.columns > 0);
+    mock_load_server_init(&server, 1, config.chunks, config.rows_per_chunk, config.columns);
+    server.latency_ms = config.latency_ms;
+    mock_http_perform_set_responder(mock_load_responder, &server);
+    for (i = 0; i < config.round_count; i++) {
+        double rate = run_round(&config, config.threads[i], single_thread_rate);
+        // The rounds are compared to the rate of one thread, estimated from the first round
+        if (i == 0) {
+            single_thread_rate = rate / config.threads[0];
+        }
+    }
+    mock_http_perform_set_responder(NULL, NULL);
+    mock_load_server_term(&server);
+}
+
+int test_setup(void **unused) {
+    putenv("SNOWFLAKE_TEST_HOST=standard.snowflakecomputing.com");
+    putenv("SNOWFLAKE_TEST_USER=standarduser");
+    putenv("SNOWFLAKE_TEST_ACCOUNT=standard");
+    putenv("SNOWFLAKE_TEST_PASSWORD=secret-password");
+    return 0;
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    // Logging every request would be measured as well
+    log_set_level(SF_LOG_WARN);
+    mock_load_watchdog(SCALING_WATCHDOG_SECONDS);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_concurrency_scaling),
+    };
+    int ret = cmocka_run_group_tests(tests, test_setup, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Throughput of the fetch path without a server: the query response and its chunks are
+ * answered by the mock, so that the chunk downloader, the decoding of the chunks and the
+ * result sets are all that is measured. Each case reports rows and bytes per second and the
+ * allocations of the result set and chunk download memory per row.
+ *
+ * The cases are generated JSON results of several widths, types and sizes. A recorded result,
+ * JSON or Arrow, is replayed as well when SNOWFLAKE_TEST_FETCH_RECORDING names a directory
+ * holding the query response as query_response.json and the bodies of its chunks, as served
+ * and in the order of its "chunks", as chunk_0, chunk_1 and so on.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../utils/test_setup.h"
+#include "../utils/mock_setup.h"
+#include "../utils/mock_endpoints.h"
+#include "mock_http_perform.h"
+#include "cJSON.h"
+
+#define BENCH_CHUNK_URL "https://bench-results.s3.amazonaws.com/results/chunk_"
+#define BENCH_EMPTY_RESPONSE "{\"code\":null,\"data\":null,\"message\":null,\"success\":true}"
+
+typedef struct BENCH_CASE {
+    const char *label;
+    const char *type;
+    int columns;
+    int rows_per_chunk;
+    int chunk_count;
+    // Characters of each text value
+    int text_length;
+} BENCH_CASE;
+
+static const BENCH_CASE BENCH_CASES[] = {
+    {"fetch_json_fixed_narrow", "fixed", 1, 50000, 8, 0},
+    {"fetch_json_fixed_wide", "fixed", 32, 5000, 8, 0},
+    {"fetch_json_real", "real", 8, 10000, 8, 0},
+    {"fetch_json_text_short", "text", 8, 10000, 8, 8},
+    {"fetch_json_text_long", "text", 4, 2000, 8, 1024},
+    {"fetch_json_many_small_chunks", "fixed", 8, 500, 128, 0},
+};
+
+typedef struct BENCH_BUFFER {
+    char *data;
+    size_t size;
+    size_t capacity;
+} BENCH_BUFFER;
+
+/**
+ * Responses of one query, read by the downloader threads but only changed between cases
+ */
+typedef struct BENCH_SERVER {
+    BENCH_BUFFER query_response;
+    int chunk_count;
+    char **chunk_urls;
+    BENCH_BUFFER *chunks;
+    size_t chunk_bytes;
+    int64 rows;
+} BENCH_SERVER;
+
+static int64 bench_allocations = 0;
+
+static void *count_alloc(size_t size) {
+    __sync_fetch_and_add(&bench_allocations, 1);
+    return malloc(size);
+}
+
+static void *count_realloc(void *ptr, size_t size) {
+    __sync_fetch_and_add(&bench_allocations, 1);
+    return realloc(ptr, size);
+}
+
+static void *count_calloc(size_t nitems, size_t size) {
+    __sync_fetch_and_add(&bench_allocations, 1);
+    return calloc(nitems, size);
+}
+
+static SF_USER_MEM_HOOKS counting_hooks = {count_alloc, free, count_realloc, count_calloc};
+
+static void buffer_append(BENCH_BUFFER *buffer, const char *data, size_t size) {
+    if (buffer->size + size + 1 > buffer->capacity) {
+        buffer->capacity = (buffer->size + size + 1) * 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        assert_non_null(buffer->data);
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    buffer->data[buffer->size] = '\0';
+}
+
+static void buffer_printf(BENCH_BUFFER *buffer, const char *format, ...) {
+    char text[512];
+    va_list args;
+    int size;
+
+    va_start(args, format);
+    size = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    buffer_append(buffer, text, (size_t) size);
+}
+
+static sf_bool read_file(const char *path, BENCH_BUFFER *buffer) {
+    char data[65536];
+    size_t size;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return SF_BOOLEAN_FALSE;
+    }
+    while ((size = fread(data, 1, sizeof(data), file)) > 0) {
+        buffer_append(buffer, data, size);
+    }
+    fclose(file);
+    return SF_BOOLEAN_TRUE;
+}
+
+static void server_free(BENCH_SERVER *server) {
+    int i;
+    for (i = 0; i < server->chunk_count; i++) {
+        free(server->chunk_urls[i]);
+        free(server->chunks[i].data);
+    }
+    free(server->chunk_urls);
+    free(server->chunks);
+    free(server->query_response.data);
+    memset(server, 0, sizeof(BENCH_SERVER));
+}
+
+static void server_alloc_chunks(BENCH_SERVER *server, int chunk_count) {
+    server->chunk_count = chunk_count;
+    server->chunk_urls = calloc((size_t) chunk_count, sizeof(char *));
+    server->chunks = calloc((size_t) chunk_count, sizeof(BENCH_BUFFER));
+    assert_non_null(server->chunk_urls);
+    assert_non_null(server->chunks);
+}
+
+static void append_value(BENCH_BUFFER *chunk, const BENCH_CASE *bench, int64 row, int column) {
+    int i;
+    if (strcmp(bench->type, "text") == 0) {
+        buffer_append(chunk, "\"", 1);
+        for (i = 0; i < bench->text_length; i++) {
+            char c = (char) ('a' + (row + column + i) % 26);
+            buffer_append(chunk, &c, 1);
+        }
+        buffer_append(chunk, "\"", 1);
+    } else if (strcmp(bench->type, "real") == 0) {
+        buffer_printf(chunk, "\"%lld.25\"", (long long) (row * bench->columns + column));
+    } else {
+        buffer_printf(chunk, "\"%lld\"", (long long) (row * bench->columns + column));
+    }
+}
+
+/**
+ * Generates the chunks of a case and a query response pointing at them
+ */
+static void server_generate(BENCH_SERVER *server, const BENCH_CASE *bench) {
+    BENCH_BUFFER *resp = &server->query_response;
+    int64 row = 0;
+    int i;
+    int r;
+    int c;
+
+    server_alloc_chunks(server, bench->chunk_count);
+    for (i = 0; i < bench->chunk_count; i++) {
+        BENCH_BUFFER *chunk = &server->chunks[i];
+        for (r = 0; r < bench->rows_per_chunk; r++, row++) {
+            buffer_append(chunk, r == 0 ? "[" : ",[", r == 0 ? 1 : 2);
+            for (c = 0; c < bench->columns; c++) {
+                if (c > 0) {
+                    buffer_append(chunk, ",", 1);
+                }
+                append_value(chunk, bench, row, c);
+            }
+            buffer_append(chunk, "]", 1);
+        }
+        server->chunk_urls[i] = malloc(sizeof(BENCH_CHUNK_URL) + 16);
+        sprintf(server->chunk_urls[i], BENCH_CHUNK_URL "%d", i);
+        server->chunk_bytes += chunk->size;
+    }
+    server->rows = row;
+
+    buffer_printf(resp, "{\"data\":{\"parameters\":[],\"rowtype\":[");
+    for (c = 0; c < bench->columns; c++) {
+        if (strcmp(bench->type, "text") == 0) {
+            buffer_printf(resp, "%s{\"name\":\"C%d\",\"byteLength\":%d,\"length\":%d,"
+                                "\"type\":\"text\",\"nullable\":false,\"precision\":null,"
+                                "\"scale\":null}",
+                          c > 0 ? "," : "", c, bench->text_length * 4, bench->text_length);
+        } else {
+            buffer_printf(resp, "%s{\"name\":\"C%d\",\"byteLength\":null,\"length\":null,"
+                                "\"type\":\"%s\",\"nullable\":false,\"precision\":38,"
+                                "\"scale\":0}",
+                          c > 0 ? "," : "", c, bench->type);
+        }
+    }
+    buffer_printf(resp, "],\"rowset\":[],\"total\":%lld,\"returned\":%lld,"
+                        "\"queryId\":\"01a0c0f1-0000-0000-0000-000000000001\","
+                        "\"queryResultFormat\":\"json\",\"qrmk\":\"bench\",\"chunks\":[",
+                  (long long) row, (long long) row);
+    for (i = 0; i < bench->chunk_count; i++) {
+        buffer_printf(resp, "%s{\"url\":\"%s\",\"rowCount\":%d,\"uncompressedSize\":%llu,"
+                            "\"compressedSize\":%llu}",
+                      i > 0 ? "," : "", server->chunk_urls[i], bench->rows_per_chunk,
+                      (unsigned long long) server->chunks[i].size,
+                      (unsigned long long) server->chunks[i].size);
+    }
+    buffer_printf(resp, "],\"statementTypeId\":4096,\"version\":0},"
+                        "\"message\":null,\"code\":null,\"success\":true}");
+}
+
+/**
+ * Loads a recorded query response and its chunks
+ * @return false if there is no recording in the directory
+ */
+static sf_bool server_load(BENCH_SERVER *server, const char *dir) {
+    char path[4096];
+    cJSON *resp;
+    cJSON *chunks;
+    cJSON *chunk;
+    int i = 0;
+
+    snprintf(path, sizeof(path), "%s/query_response.json", dir);
+    if (!read_file(path, &server->query_response)) {
+        return SF_BOOLEAN_FALSE;
+    }
+    resp = snowflake_cJSON_Parse(server->query_response.data);
+    assert_non_null(resp);
+    chunks = snowflake_cJSON_GetObjectItem(snowflake_cJSON_GetObjectItem(resp, "data"), "chunks");
+    server_alloc_chunks(server, snowflake_cJSON_GetArraySize(chunks));
+    snowflake_cJSON_ArrayForEach(chunk, chunks) {
+        const char *url = snowflake_cJSON_GetStringValue(
+            snowflake_cJSON_GetObjectItem(chunk, "url"));
+        cJSON *row_count = snowflake_cJSON_GetObjectItem(chunk, "rowCount");
+        server->rows += row_count ? (int64) row_count->valuedouble : 0;
+        assert_non_null(url);
+        server->chunk_urls[i] = strdup(url);
+        snprintf(path, sizeof(path), "%s/chunk_%d", dir, i);
+        assert_true(read_file(path, &server->chunks[i]));
+        server->chunk_bytes += server->chunks[i].size;
+        i++;
+    }
+    snowflake_cJSON_Delete(resp);
+    return SF_BOOLEAN_TRUE;
+}
+
+static const char *bench_responder(SF_REQUEST_TYPE request_type, const char *url,
+                                   const char *body, size_t *size, void *user_data) {
+    BENCH_SERVER *server = (BENCH_SERVER *) user_data;
+    int i;
+
+    if (strstr(url, "/session/v1/login-request")) {
+        *size = strlen(MOCK_RESPONSE_STANDARD_LOGIN);
+        return MOCK_RESPONSE_STANDARD_LOGIN;
+    }
+    if (strstr(url, "/queries/v1/query-request")) {
+        *size = server->query_response.size;
+        return server->query_response.data;
+    }
+    for (i = 0; i < server->chunk_count; i++) {
+        if (strcmp(url, server->chunk_urls[i]) == 0) {
+            *size = server->chunks[i].size;
+            return server->chunks[i].data;
+        }
+    }
+    // Logout and anything else the session does on the side
+    *size = strlen(BENCH_EMPTY_RESPONSE);
+    return BENCH_EMPTY_RESPONSE;
+}
+
+static void run_case(BENCH_SERVER *server, const char *label) {
+    SF_STATUS status;
+    SF_CONNECT *sf;
+    SF_STMT *sfstmt;
+    struct timespec begin, end;
+    const char *value;
+    int64 rows = 0;
+    int64 allocations;
+    int columns;
+    int i;
+    double seconds;
+
+    mock_http_perform_set_responder(bench_responder, server);
+    sf = setup_snowflake_connection();
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    sfstmt = snowflake_stmt(sf);
+    allocations = bench_allocations;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    status = snowflake_query(sfstmt, "select * from bench", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    columns = (int) snowflake_num_fields(sfstmt);
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        for (i = 1; i <= columns; i++) {
+            snowflake_column_as_const_str(sfstmt, i, &value);
+        }
+        rows++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(rows, server->rows);
+    allocations = bench_allocations - allocations;
+
+    process_results(begin, end, (int) rows, label);
+    seconds = (double) (end.tv_sec - begin.tv_sec) + (double) (end.tv_nsec - begin.tv_nsec) / 1e9;
+    printf("%s: %lld rows, %.0f rows/s, %.1f MB/s, %.2f allocations/row\n", label,
+           (long long) rows, rows / seconds, server->chunk_bytes / seconds / 1e6,
+           rows > 0 ? (double) allocations / rows : 0.0);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+    mock_http_perform_set_responder(NULL, NULL);
+}
+
+void test_fetch_throughput_generated(void **unused) {
+    size_t i;
+    for (i = 0; i < sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]); i++) {
+        BENCH_SERVER server;
+        memset(&server, 0, sizeof(server));
+        server_generate(&server, &BENCH_CASES[i]);
+        run_case(&server, BENCH_CASES[i].label);
+        server_free(&server);
+    }
+}
+
+void test_fetch_throughput_recorded(void **unused) {
+    BENCH_SERVER server;
+    const char *dir = getenv("SNOWFLAKE_TEST_FETCH_RECORDING");
+    if (!dir) {
+        skip();
+    }
+    memset(&server, 0, sizeof(server));
+    assert_true(server_load(&server, dir));
+    run_case(&server, "fetch_recorded");
+    server_free(&server);
+}
+
+int test_setup(void **unused) {
+    putenv("SNOWFLAKE_TEST_HOST=standard.snowflakecomputing.com");
+    putenv("SNOWFLAKE_TEST_USER=standarduser");
+    putenv("SNOWFLAKE_TEST_ACCOUNT=standard");
+    putenv("SNOWFLAKE_TEST_PASSWORD=secret-password");
+    return 0;
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    // Logging every request would be measured as well
+    log_set_level(SF_LOG_WARN);
+    snowflake_global_set_attribute(SF_GLOBAL_RESULT_SET_MEM_HOOKS, &counting_hooks);
+    snowflake_global_set_attribute(SF_GLOBAL_CHUNK_DOWNLOAD_MEM_HOOKS, &counting_hooks);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_fetch_throughput_generated),
+      cmocka_unit_test(test_fetch_throughput_recorded),
+    };
+    int ret = cmocka_run_group_tests(tests, test_setup, NULL);
+    snowflake_global_term();
+    return ret;
+}
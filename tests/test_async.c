@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+
+void test_async(void **unused) {
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* submit the query without waiting for it */
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_prepare(sfstmt, "select system$wait(2), 1;", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_execute_async(sfstmt);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_true(strlen(snowflake_sfqid(sfstmt)) > 0);
+
+    SF_QUERY_STATUS query_status;
+    do {
+        status = snowflake_query_status(sf, snowflake_sfqid(sfstmt), &query_status);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(&(sf->error));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+    } while (snowflake_query_status_is_running(query_status));
+    assert_int_equal(query_status, SF_QUERY_STATUS_SUCCESS);
+
+    status = snowflake_get_results(sfstmt, NULL);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_num_rows(sfstmt), 1);
+
+    int64 out = 0;
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 2, &out);
+    assert_int_equal(out, 1);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_EOF);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_async),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -115,10 +115,20 @@ void test_selectbin_helper(sf_bool use_arrow) {
     while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
         int64 c1 = 0;
         const char *c2 = NULL;
+        const void *c2bin = NULL;
+        size_t c2binlen = 0;
         snowflake_column_as_int64(sfstmt, 1, &c1);
         snowflake_column_as_const_str(sfstmt, 2, &c2);
         TEST_CASE_TO_STRING v = test_cases[c1 - 1];
         assert_string_equal(v.c2out, c2);
+
+        status = snowflake_column_as_binary(sfstmt, 2, &c2bin, &c2binlen);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+        assert_int_equal(v.c2inlen, c2binlen);
+        assert_memory_equal(v.c2in, c2bin, c2binlen);
     }
     if (status != SF_STATUS_EOF) {
         dump_error(&(sfstmt->error));
@@ -140,7 +150,7 @@ void test_selectbin_arrow(void **unused) {
 }
 
 void test_selectbin_json(void **unused) {
-    test_selectbin_helper(SF_BOOLEAN_TRUE);
+    test_selectbin_helper(SF_BOOLEAN_FALSE);
 }
 
 int main(void) {
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "hashmap.h"
+#include "memory.h"
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+
+void test_set()
+{
+    char * test_param = "Test Param";
+    char * test_param2 = "Test Param 2";
+    HASH_MAP *test_map = sf_hashmap_init(0);
+    assert_non_null(test_map);
+    assert_int_equal(sf_hashmap_set(test_map, test_param, "test_node"), SF_INT_RET_CODE_SUCCESS);
+    assert_int_equal(sf_hashmap_set(test_map, test_param2, "test_node"), SF_INT_RET_CODE_DUPLICATES);
+    assert_string_equal(sf_hashmap_get(test_map, "test_node"), test_param2);
+    assert_null(sf_hashmap_get(test_map, "absent_node"));
+    assert_int_equal(test_map->count, 1);
+    sf_hashmap_deallocate(test_map);
+}
+
+void test_set_bulk()
+{
+    int i = 0;
+    HASH_MAP *test_map = sf_hashmap_init(10);
+    char **test_param = NULL;
+    char **test_node = NULL;
+    test_param = (char **)SF_CALLOC(10000, sizeof(char *));
+    test_node = (char **)SF_CALLOC(10000,sizeof(char *));
+    char *test_param_ret = NULL;
+    for (i = 0; i < 10000; i++)
+    {
+        test_param[i] = (char *)SF_CALLOC(1,sizeof("TEST_PARAM")+sizeof(i));
+        test_node[i] = (char *)SF_CALLOC(1,sizeof("TEST_NODE")+sizeof(i));
+        sprintf(test_param[i],"%s%d","TEST_PARAM",i);
+        sprintf(test_node[i],"%s%d","TEST_NODE",i);
+        assert_int_equal(sf_hashmap_set(test_map,test_param[i],test_node[i]),
+                         SF_INT_RET_CODE_SUCCESS);
+    }
+    assert_true(test_map->count * 4 <= test_map->capacity * 3);
+    for (i = 0; i < 10000; i++)
+    {
+        test_param_ret = (char *)sf_hashmap_get_hashed(test_map, test_node[i],
+                                                       sf_hashmap_hash(test_node[i]));
+        assert_non_null(test_param_ret);
+        assert_string_equal(test_param_ret, test_param[i]);
+    }
+    for (i = 0; i < 10000; i++)
+    {
+        SF_FREE(test_param[i]);
+        SF_FREE(test_node[i]);
+    }
+    SF_FREE(test_param);
+    SF_FREE(test_node);
+    sf_hashmap_deallocate(test_map);
+}
+
+void test_reserve()
+{
+    HASH_MAP *test_map = sf_hashmap_init(0);
+    HASH_MAP_ENTRY *entries;
+    assert_int_equal(sf_hashmap_set(test_map, "Test Param", "test_node"), SF_INT_RET_CODE_SUCCESS);
+    assert_true(sf_hashmap_reserve(test_map, 1000));
+    assert_true(test_map->capacity * 3 / 4 >= 1000);
+    assert_string_equal(sf_hashmap_get(test_map, "test_node"), "Test Param");
+    // No more growth up to the reserved count
+    entries = test_map->entries;
+    assert_true(sf_hashmap_reserve(test_map, 10));
+    assert_ptr_equal(test_map->entries, entries);
+    sf_hashmap_deallocate(test_map);
+}
+
+int main (void) {
+    const struct CMUnitTest tests[] =
+            {
+                    cmocka_unit_test(test_set),
+                    cmocka_unit_test(test_set_bulk),
+                    cmocka_unit_test(test_reserve)
+            };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -156,10 +156,52 @@ done:
     snowflake_term(sf);
 }
 
+void test_bind_after_prepare_again(void **unused) {
+    SF_BIND_INPUT named;
+    SF_BIND_INPUT positional;
+    int64 value = 1;
+    const char *long_sql = "select :NUMBER, :NUMBER + 1, :NUMBER + 2 from dual";
+    SF_CONNECT *sf = snowflake_init();
+    SF_STMT *stmt = snowflake_stmt(sf);
+
+    snowflake_bind_input_init(&named);
+    named.name = "NUMBER";
+    named.c_type = SF_C_TYPE_INT64;
+    named.value = &value;
+    named.len = sizeof(value);
+    snowflake_bind_input_init(&positional);
+    positional.idx = 1;
+    positional.c_type = SF_C_TYPE_INT64;
+    positional.value = &value;
+    positional.len = sizeof(value);
+
+    /* the buffers of the last statement are reused by the next one */
+    assert_int_equal(snowflake_prepare(stmt, long_sql, 0), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_param(stmt, &named), SF_STATUS_SUCCESS);
+    assert_int_equal(stmt->params_len, 1);
+    const char *sql_text = stmt->sql_text;
+
+    assert_int_equal(snowflake_prepare(stmt, "select :NUMBER", 0), SF_STATUS_SUCCESS);
+    assert_ptr_equal(stmt->sql_text, sql_text);
+    assert_string_equal(stmt->sql_text, "select :NUMBER");
+    assert_int_equal(stmt->params_len, 0);
+    assert_int_equal(snowflake_bind_param(stmt, &named), SF_STATUS_SUCCESS);
+    assert_int_equal(stmt->params_len, 1);
+
+    /* params of another style get a store of their own */
+    assert_int_equal(snowflake_prepare(stmt, "select ?", 0), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_param(stmt, &positional), SF_STATUS_SUCCESS);
+    assert_int_equal(stmt->params_len, 1);
+
+    snowflake_stmt_term(stmt);
+    snowflake_term(sf);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
             cmocka_unit_test(test_bind_named_parameters),
+            cmocka_unit_test(test_bind_after_prepare_again),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
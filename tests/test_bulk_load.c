@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "utils/test_setup.h"
+
+#define BULK_LOAD_FILES 3
+
+static void write_files(const char *dir) {
+    char path[MAX_PATH + 32];
+    int i;
+    for (i = 0; i < BULK_LOAD_FILES; i++) {
+        FILE *file;
+        sprintf(path, "%sbulk_load_%d.csv", dir, i);
+        file = fopen(path, "w");
+        assert_non_null(file);
+        fprintf(file, "%d,first\n%d,second\n", i * 2, i * 2 + 1);
+        fclose(file);
+    }
+}
+
+static void check_loaded_rows(SF_STMT *sfstmt, int64 expected) {
+    int64 count = 0;
+    SF_STATUS status = snowflake_query(sfstmt, "select count(distinct c1) from t", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &count);
+    assert_int_equal(count, expected);
+}
+
+static void bulk_load(const SF_BULK_LOAD_OPTIONS *options) {
+    SF_STATUS status;
+    char dir[MAX_PATH] = {0};
+    char files[MAX_PATH + 32];
+    int64 rows_loaded = 0;
+    SF_CONNECT *sf = setup_snowflake_connection();
+
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(
+        sfstmt, "create or replace temporary table t (c1 number, c2 string)", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    sf_get_uniq_tmp_dir(dir);
+    write_files(dir);
+    sprintf(files, "%sbulk_load_*.csv", dir);
+
+    status = snowflake_bulk_load(sfstmt, files, "t", options, &rows_loaded);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(rows_loaded, BULK_LOAD_FILES * 2);
+    check_loaded_rows(sfstmt, BULK_LOAD_FILES * 2);
+
+    sf_delete_uniq_dir_if_exists(dir);
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_bulk_load_defaults(void **unused) {
+    bulk_load(NULL);
+}
+
+void test_bulk_load_file_groups(void **unused) {
+    SF_BULK_LOAD_OPTIONS options;
+    memset(&options, 0, sizeof(options));
+    options.file_format = "(TYPE = CSV)";
+    // each file staged as it is and loaded by a COPY INTO of its own
+    options.file_size = -1;
+    options.group_files = 1;
+    options.purge = SF_BOOLEAN_TRUE;
+    bulk_load(&options);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_bulk_load_defaults),
+        cmocka_unit_test(test_bulk_load_file_groups),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
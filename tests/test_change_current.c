@@ -34,10 +34,138 @@ void test_change_current_schema(void **unused) {
     snowflake_term(sf); // purge snowflake context
 }
 
+static uint64 http_requests(void) {
+    SF_METRICS_SNAPSHOT metrics;
+    snowflake_global_get_attribute(SF_GLOBAL_METRICS, &metrics, sizeof(metrics));
+    return metrics.counters[SF_COUNTER_HTTP_REQUESTS];
+}
+
+void test_change_current_if_different(void **unused) {
+    /* init */
+    SF_STATUS status;
+    char value[64];
+    uint64 requests;
+    SF_CONNECT *sf = setup_snowflake_connection();
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* the current objects are switched to only if they aren't current */
+    status = snowflake_use_object(sf, SF_CON_SCHEMA, "phpschema_current");
+    assert_int_not_equal(status, SF_STATUS_SUCCESS);
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, "create or replace schema phpschema_current", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    requests = http_requests();
+    assert_int_equal(snowflake_use_object(sf, SF_CON_SCHEMA, "phpschema_current"),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_use_object(sf, SF_CON_SCHEMA, "\"PHPSCHEMA_CURRENT\""),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(http_requests(), requests);
+    assert_int_equal(snowflake_use_object(sf, SF_CON_SCHEMA, "public"), SF_STATUS_SUCCESS);
+    assert_string_equal(sf->schema, "PUBLIC");
+    assert_true(http_requests() > requests);
+
+    /* so are the session parameters */
+    assert_int_equal(snowflake_set_session_parameter(sf, "QUERY_TAG", "it's a test"),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_get_session_parameter(sf, "query_tag", value, sizeof(value)),
+                     SF_STATUS_SUCCESS);
+    assert_string_equal(value, "it's a test");
+    assert_int_equal(snowflake_get_session_parameter(sf, "query_tag", value, 4),
+                     SF_STATUS_ERROR_BUFFER_TOO_SMALL);
+    requests = http_requests();
+    assert_int_equal(snowflake_set_session_parameter(sf, "QUERY_TAG", "it's a test"),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(http_requests(), requests);
+    assert_int_equal(snowflake_set_session_parameter(sf, "QUERY TAG", "x"),
+                     SF_STATUS_ERROR_BAD_REQUEST);
+
+    status = snowflake_query(sfstmt, "drop schema if exists phpschema_current", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf); // purge snowflake context
+}
+
+typedef struct STATEMENT_WORKER_CONTEXT {
+    SF_CONNECT *sf;
+    int64 row_count;
+    SF_STATUS status;
+} STATEMENT_WORKER_CONTEXT;
+
+static void *statement_worker(void *arg) {
+    STATEMENT_WORKER_CONTEXT *ctx = (STATEMENT_WORKER_CONTEXT *) arg;
+    char schema[256];
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        SF_STMT *sfstmt = snowflake_stmt(ctx->sf);
+        ctx->status = snowflake_query(
+          sfstmt, "select seq4() from table(generator(rowcount=>1000))", 0);
+        if (ctx->status == SF_STATUS_SUCCESS) {
+            while ((ctx->status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+                ctx->row_count++;
+            }
+        }
+        snowflake_stmt_term(sfstmt);
+        if (ctx->status != SF_STATUS_EOF) {
+            break;
+        }
+        snowflake_get_current_object(ctx->sf, SF_CON_SCHEMA, schema, sizeof(schema));
+    }
+    return NULL;
+}
+
+void test_concurrent_statements(void **unused) {
+    STATEMENT_WORKER_CONTEXT ctx[4];
+    SF_THREAD_HANDLE threads[4];
+    char schema[256];
+    int i;
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* the statements of a connection run in threads of their own */
+    for (i = 0; i < 4; i++) {
+        memset(&ctx[i], 0, sizeof(ctx[i]));
+        ctx[i].sf = sf;
+        assert_int_equal(_thread_init(&threads[i], statement_worker, &ctx[i]), 0);
+    }
+    for (i = 0; i < 4; i++) {
+        _thread_join(threads[i]);
+        assert_int_equal(ctx[i].status, SF_STATUS_EOF);
+        assert_int_equal(ctx[i].row_count, 5000);
+    }
+
+    assert_int_equal(snowflake_get_current_object(sf, SF_CON_SCHEMA, schema, sizeof(schema)),
+                     SF_STATUS_SUCCESS);
+    assert_string_equal(schema, sf->schema);
+    assert_int_equal(snowflake_get_current_object(sf, SF_CON_SCHEMA, schema, 1),
+                     SF_STATUS_ERROR_BUFFER_TOO_SMALL);
+    assert_int_equal(snowflake_get_current_object(sf, SF_CON_USER, schema, sizeof(schema)),
+                     SF_STATUS_ERROR_BAD_ATTRIBUTE_TYPE);
+
+    snowflake_term(sf);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_change_current_schema),
+      cmocka_unit_test(test_change_current_if_different),
+      cmocka_unit_test(test_concurrent_statements),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
@@ -1056,6 +1056,63 @@ void test_column_as_const_str_helper(sf_bool use_arrow) {
     snowflake_term(sf);
 }
 
+void test_column_as_str_view_helper(sf_bool use_arrow) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+
+    // Setup connection, run query, and get results back
+    setup_and_run_query(&sf, &sfstmt,
+                        use_arrow == SF_BOOLEAN_TRUE
+                        ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                        : "alter session set C_API_QUERY_RESULT_FORMAT=JSON");
+
+    snowflake_query(sfstmt, "select 'some string that is not empty', '', "
+                            "as_integer(to_variant(10)), NULL", 0);
+
+    // Stores the result from the fetch operation
+    const char *out;
+    size_t out_len;
+
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        // Basic Case, the text isn't NUL-terminated for Arrow
+        if (snowflake_column_as_str_view(sfstmt, 1, &out, &out_len)) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(out_len, strlen("some string that is not empty"));
+        assert_memory_equal("some string that is not empty", out, out_len);
+
+        // Case where string is empty
+        if (snowflake_column_as_str_view(sfstmt, 2, &out, &out_len)) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(out_len, 0);
+
+        // Case with a INTEGER DB type
+        if (snowflake_column_as_str_view(sfstmt, 3, &out, &out_len)) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(out_len, 2);
+        assert_memory_equal("10", out, out_len);
+
+        // Get the value of a NULL column
+        if (snowflake_column_as_str_view(sfstmt, 4, &out, &out_len)) {
+            dump_error(&(sfstmt->error));
+        }
+        assert(out == NULL);
+        assert_int_equal(out_len, 0);
+
+        // Out of bounds check
+        if (!(status = snowflake_column_as_str_view(sfstmt, 5, &out, &out_len))) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(status, SF_STATUS_ERROR_OUT_OF_BOUNDS);
+    }
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
 void test_column_is_null_helper(sf_bool use_arrow) {
     SF_STATUS status;
     SF_CONNECT *sf = NULL;
@@ -1158,6 +1215,73 @@ void test_column_strlen_helper(sf_bool use_arrow) {
     snowflake_term(sf);
 }
 
+void test_column_get_data_helper(sf_bool use_arrow) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+
+    // Setup connection, run query, and get results back
+    setup_and_run_query(&sf, &sfstmt,
+                        use_arrow == SF_BOOLEAN_TRUE
+                        ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                        : "alter session set C_API_QUERY_RESULT_FORMAT=JSON");
+
+    snowflake_query(sfstmt, "select repeat('abc', 1000), to_binary('0a0b0c', 'HEX'), NULL", 0);
+
+    char text[3001];
+    char piece[7];
+    size_t piece_len;
+    size_t remaining;
+    size_t len;
+
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        // A large string read in small pieces
+        len = 0;
+        while ((status = snowflake_column_get_data(sfstmt, 1, piece, sizeof(piece),
+                                                   &piece_len, &remaining)) == SF_STATUS_SUCCESS) {
+            assert_true(len + piece_len <= 3000);
+            memcpy(text + len, piece, piece_len);
+            len += piece_len;
+            assert_int_equal(len + remaining, 3000);
+        }
+        assert_int_equal(status, SF_STATUS_EOF);
+        assert_int_equal(len, 3000);
+        text[len] = '\0';
+        assert_memory_equal(text, "abcabcabc", 9);
+        assert_string_equal(text + 2997, "abc");
+
+        // Binary values are read as raw bytes
+        status = snowflake_column_get_data(sfstmt, 2, piece, 2, &piece_len, &remaining);
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+        assert_int_equal(piece_len, 2);
+        assert_int_equal(remaining, 1);
+        assert_memory_equal(piece, "\x0a\x0b", 2);
+        status = snowflake_column_get_data(sfstmt, 2, piece, 2, &piece_len, &remaining);
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+        assert_int_equal(piece_len, 1);
+        assert_int_equal(piece[0], 0x0c);
+        assert_int_equal(snowflake_column_get_data(sfstmt, 2, piece, 2, &piece_len, NULL),
+                         SF_STATUS_EOF);
+
+        // Reading another column starts over, a NULL column is a single empty piece
+        assert_int_equal(snowflake_column_get_data(sfstmt, 3, piece, 2, &piece_len, NULL),
+                         SF_STATUS_SUCCESS);
+        assert_int_equal(piece_len, 0);
+        assert_int_equal(snowflake_column_get_data(sfstmt, 3, piece, 2, &piece_len, NULL),
+                         SF_STATUS_EOF);
+        assert_int_equal(snowflake_column_get_data(sfstmt, 1, piece, 2, &piece_len, NULL),
+                         SF_STATUS_SUCCESS);
+        assert_memory_equal(piece, "ab", 2);
+
+        // Out of bounds check
+        assert_int_equal(snowflake_column_get_data(sfstmt, 4, piece, 2, &piece_len, NULL),
+                         SF_STATUS_ERROR_OUT_OF_BOUNDS);
+    }
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
 void test_column_as_str_helper(sf_bool use_arrow) {
     SF_STATUS status;
     SF_CONNECT *sf = NULL;
@@ -1263,6 +1387,282 @@ void test_column_as_str_helper(sf_bool use_arrow) {
     snowflake_term(sf);
 }
 
+void test_fetch_batch_helper(sf_bool use_arrow) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+
+    // Setup connection, run query, and get results back
+    setup_and_run_query(&sf, &sfstmt,
+                        use_arrow == SF_BOOLEAN_TRUE
+                        ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                        : "alter session set C_API_QUERY_RESULT_FORMAT=JSON");
+
+    status = snowflake_query(sfstmt, "select seq4(), iff(seq4() % 3 = 0, null, seq4() * 0.5::double), "
+                                     "to_varchar(seq4()) from table(generator(rowcount => 1000));", 0);
+    if (status) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    int64 ids[64];
+    float64 halves[64];
+    uint8 halves_nulls[8];
+    char strs[64][8];
+    size_t strs_len[64];
+    SF_BATCH_COLUMN columns[3] = {
+        {1, SF_C_TYPE_INT64, ids, 0, NULL, NULL},
+        {2, SF_C_TYPE_FLOAT64, halves, 0, NULL, halves_nulls},
+        {3, SF_C_TYPE_STRING, strs, sizeof(strs[0]), strs_len, NULL}
+    };
+    size_t rows = 0;
+    int64 expected = 0;
+    char expected_str[8];
+
+    // Batches don't line up with the 64 rows of the buffers
+    while ((status = snowflake_fetch_batch(sfstmt, columns, 3, 64, &rows)) == SF_STATUS_SUCCESS) {
+        assert_true(rows > 0 && rows <= 64);
+        for (size_t i = 0; i < rows; i++, expected++) {
+            assert_int_equal(ids[i], expected);
+            if (expected % 3 == 0) {
+                assert_true(halves_nulls[i / 8] & (1 << (i % 8)));
+            } else {
+                assert_false(halves_nulls[i / 8] & (1 << (i % 8)));
+                assert_true(halves[i] == expected * 0.5);
+            }
+            sprintf(expected_str, "%lld", (long long) expected);
+            assert_string_equal(strs[i], expected_str);
+            assert_int_equal(strs_len[i], strlen(expected_str));
+        }
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(rows, 0);
+    assert_int_equal(expected, 1000);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_column_null_bitmap_helper(sf_bool use_arrow) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+
+    // Setup connection, run query, and get results back
+    setup_and_run_query(&sf, &sfstmt,
+                        use_arrow == SF_BOOLEAN_TRUE
+                        ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                        : "alter session set C_API_QUERY_RESULT_FORMAT=JSON");
+
+    status = snowflake_query(sfstmt, "select seq4(), iff(seq4() % 3 = 0, null, seq4() * 0.5::double) "
+                                     "from table(generator(rowcount => 1000));", 0);
+    if (status) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    uint8 nulls[125];
+    size_t rows = 0;
+    size_t null_count = 0;
+    size_t expected_nulls;
+    int64 row = 0;
+
+    assert_int_equal(snowflake_column_null_bitmap(sfstmt, 3, nulls, 1000, &rows, NULL),
+                     SF_STATUS_ERROR_OUT_OF_BOUNDS);
+
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        // Every 7th row, so the runs start anywhere within a byte
+        if (row % 7 == 0) {
+            status = snowflake_column_null_bitmap(sfstmt, 2, nulls, 1000, &rows, &null_count);
+            assert_int_equal(status, SF_STATUS_SUCCESS);
+            assert_true(rows > 0 && rows <= (size_t) (1000 - row));
+            expected_nulls = 0;
+            for (size_t i = 0; i < rows; i++) {
+                if ((row + i) % 3 == 0) {
+                    assert_true(nulls[i / 8] & (1 << (i % 8)));
+                    expected_nulls++;
+                } else {
+                    assert_false(nulls[i / 8] & (1 << (i % 8)));
+                }
+            }
+            assert_int_equal(null_count, expected_nulls);
+
+            status = snowflake_column_null_bitmap(sfstmt, 1, nulls, 1000, &rows, &null_count);
+            assert_int_equal(status, SF_STATUS_SUCCESS);
+            assert_int_equal(null_count, 0);
+            for (size_t i = 0; i < (rows + 7) / 8; i++) {
+                assert_int_equal(nulls[i], 0);
+            }
+        }
+        row++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(row, 1000);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+typedef struct BOUND_ROW {
+    int64 id;
+    int64 id_indicator;
+    float64 half;
+    int64 half_indicator;
+    char str[4];
+    int64 str_indicator;
+} BOUND_ROW;
+
+void test_bind_column_helper(sf_bool use_arrow) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+    BOUND_ROW rows[50];
+    size_t fetched = 0;
+    int64 expected = 0;
+    char expected_str[8];
+
+    // Setup connection, run query, and get results back
+    setup_and_run_query(&sf, &sfstmt,
+                        use_arrow == SF_BOOLEAN_TRUE
+                        ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                        : "alter session set C_API_QUERY_RESULT_FORMAT=JSON");
+
+    status = snowflake_query(sfstmt, "select seq4(), iff(seq4() % 3 = 0, null, seq4() * 0.5::double), "
+                                     "to_varchar(seq4()) from table(generator(rowcount => 1000));", 0);
+    if (status) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    assert_int_equal(snowflake_bind_column(sfstmt, 1, SF_C_TYPE_INT64, &rows[0].id, 0,
+                                           sizeof(BOUND_ROW), &rows[0].id_indicator),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_column(sfstmt, 2, SF_C_TYPE_FLOAT64, &rows[0].half, 0,
+                                           sizeof(BOUND_ROW), &rows[0].half_indicator),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_column(sfstmt, 3, SF_C_TYPE_STRING, rows[0].str,
+                                           sizeof(rows[0].str), sizeof(BOUND_ROW),
+                                           &rows[0].str_indicator),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_column(sfstmt, 3, SF_C_TYPE_BINARY, rows[0].str, 4, 0, NULL),
+                     SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE);
+
+    // A single row goes to the first struct
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    assert_int_equal(rows[0].id, 0);
+    assert_int_equal(rows[0].half_indicator, SF_NULL_DATA);
+    assert_string_equal(rows[0].str, "0");
+    assert_int_equal(rows[0].str_indicator, 1);
+    expected++;
+
+    while ((status = snowflake_fetch_rows(sfstmt, 50, &fetched)) == SF_STATUS_SUCCESS) {
+        assert_true(fetched > 0 && fetched <= 50);
+        for (size_t i = 0; i < fetched; i++, expected++) {
+            assert_int_equal(rows[i].id, expected);
+            if (expected % 3 == 0) {
+                assert_int_equal(rows[i].half_indicator, SF_NULL_DATA);
+            } else {
+                assert_int_equal(rows[i].half_indicator, sizeof(float64));
+                assert_true(rows[i].half == expected * 0.5);
+            }
+            // Longer strings are truncated, the indicator has their full length
+            sprintf(expected_str, "%lld", (long long) expected);
+            assert_int_equal(rows[i].str_indicator, strlen(expected_str));
+            assert_int_equal(strncmp(rows[i].str, expected_str, sizeof(rows[i].str) - 1), 0);
+        }
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(expected, 1000);
+
+    // Unbound columns are left alone
+    assert_int_equal(snowflake_bind_column(sfstmt, 2, SF_C_TYPE_FLOAT64, NULL, 0, 0, NULL),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_bind_column(sfstmt, 3, SF_C_TYPE_STRING, NULL, 0, 0, NULL),
+                     SF_STATUS_SUCCESS);
+    rows[0].half = -1;
+    status = snowflake_query(sfstmt, "select 7, 0.5::double", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    assert_int_equal(rows[0].id, 7);
+    assert_true(rows[0].half == -1);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_fetch_batch_timestamp_arrow(void **unused) {
+    SF_STATUS status;
+    SF_CONNECT *sf = NULL;
+    SF_STMT *sfstmt = NULL;
+    const char *query = "select dateadd(minute, seq4() * 97, '1969-12-31 22:00:00.123456'::timestamp_ntz(6)), "
+                        "dateadd(minute, seq4() * 97, '2021-03-13 20:00:00.5'::timestamp_ltz(9)), "
+                        "iff(seq4() % 5 = 0, null, dateadd(minute, seq4() * 97, "
+                        "'2021-03-13 22:00:00.123 +05:45'::timestamp_tz(3))) "
+                        "from table(generator(rowcount => 200));";
+
+    setup_and_run_query(&sf, &sfstmt, "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE");
+    // The NTZ values cross the epoch and the LTZ values a daylight saving change
+    snowflake_query(sfstmt, "alter session set timezone='America/Los_Angeles'", 0);
+
+    SF_TIMESTAMP batch[3][200];
+    uint8 nulls[3][25];
+    SF_BATCH_COLUMN columns[3] = {
+        {1, SF_C_TYPE_TIMESTAMP, batch[0], 0, NULL, nulls[0]},
+        {2, SF_C_TYPE_TIMESTAMP, batch[1], 0, NULL, nulls[1]},
+        {3, SF_C_TYPE_TIMESTAMP, batch[2], 0, NULL, nulls[2]}
+    };
+    size_t rows = 0;
+    status = snowflake_query(sfstmt, query, 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_fetch_batch(sfstmt, columns, 3, 200, &rows);
+    if (status) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(rows, 200);
+
+    // The batch values have to match the single cell getter
+    char expected_str[64];
+    char actual_str[64];
+    char *expected_ptr = expected_str;
+    char *actual_ptr = actual_str;
+    SF_TIMESTAMP expected;
+    size_t row = 0;
+    status = snowflake_query(sfstmt, query, 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        for (int col = 0; col < 3; col++) {
+            sf_bool is_null;
+            snowflake_column_is_null(sfstmt, col + 1, &is_null);
+            assert_int_equal(is_null, (nulls[col][row / 8] & (1 << (row % 8))) ? SF_BOOLEAN_TRUE : SF_BOOLEAN_FALSE);
+            if (is_null) {
+                continue;
+            }
+            assert_int_equal(snowflake_column_as_timestamp(sfstmt, col + 1, &expected), SF_STATUS_SUCCESS);
+            snowflake_timestamp_to_string(&expected, "", &expected_ptr, sizeof(expected_str), NULL, SF_BOOLEAN_FALSE);
+            snowflake_timestamp_to_string(&batch[col][row], "", &actual_ptr, sizeof(actual_str), NULL, SF_BOOLEAN_FALSE);
+            assert_string_equal(actual_str, expected_str);
+            assert_int_equal(batch[col][row].nsec, expected.nsec);
+            assert_int_equal(batch[col][row].tzoffset, expected.tzoffset);
+        }
+        row++;
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(row, 200);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
 void test_column_as_boolean_arrow(void **unused) {
     test_column_as_boolean_helper(SF_BOOLEAN_TRUE);
 }
@@ -1359,6 +1759,14 @@ void test_column_as_const_str_json(void **unused) {
     test_column_as_const_str_helper(SF_BOOLEAN_FALSE);
 }
 
+void test_column_as_str_view_arrow(void **unused) {
+    test_column_as_str_view_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_column_as_str_view_json(void **unused) {
+    test_column_as_str_view_helper(SF_BOOLEAN_FALSE);
+}
+
 void test_column_is_null_arrow(void **unused) {
     test_column_is_null_helper(SF_BOOLEAN_TRUE);
 }
@@ -1375,6 +1783,14 @@ void test_column_strlen_json(void **unused) {
     test_column_strlen_helper(SF_BOOLEAN_FALSE);
 }
 
+void test_column_get_data_arrow(void **unused) {
+    test_column_get_data_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_column_get_data_json(void **unused) {
+    test_column_get_data_helper(SF_BOOLEAN_FALSE);
+}
+
 void test_column_as_str_arrow(void **unused) {
     test_column_as_str_helper(SF_BOOLEAN_TRUE);
 }
@@ -1383,6 +1799,30 @@ void test_column_as_str_json(void **unused) {
     test_column_as_str_helper(SF_BOOLEAN_FALSE);
 }
 
+void test_fetch_batch_arrow(void **unused) {
+    test_fetch_batch_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_fetch_batch_json(void **unused) {
+    test_fetch_batch_helper(SF_BOOLEAN_FALSE);
+}
+
+void test_column_null_bitmap_arrow(void **unused) {
+    test_column_null_bitmap_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_column_null_bitmap_json(void **unused) {
+    test_column_null_bitmap_helper(SF_BOOLEAN_FALSE);
+}
+
+void test_bind_column_arrow(void **unused) {
+    test_bind_column_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_bind_column_json(void **unused) {
+    test_bind_column_helper(SF_BOOLEAN_FALSE);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
@@ -1413,12 +1853,25 @@ int main(void) {
 #endif
       cmocka_unit_test(test_column_as_const_str_arrow),
       cmocka_unit_test(test_column_as_const_str_json),
+      cmocka_unit_test(test_column_as_str_view_arrow),
+      cmocka_unit_test(test_column_as_str_view_json),
       cmocka_unit_test(test_column_is_null_arrow),
       cmocka_unit_test(test_column_is_null_json),
       cmocka_unit_test(test_column_strlen_arrow),
       cmocka_unit_test(test_column_strlen_json),
+      cmocka_unit_test(test_column_get_data_arrow),
+      cmocka_unit_test(test_column_get_data_json),
       cmocka_unit_test(test_column_as_str_arrow),
       cmocka_unit_test(test_column_as_str_json),
+      cmocka_unit_test(test_fetch_batch_arrow),
+      cmocka_unit_test(test_fetch_batch_json),
+      cmocka_unit_test(test_column_null_bitmap_arrow),
+      cmocka_unit_test(test_column_null_bitmap_json),
+      cmocka_unit_test(test_bind_column_arrow),
+      cmocka_unit_test(test_bind_column_json),
+#ifndef _WIN32
+      cmocka_unit_test(test_fetch_batch_timestamp_arrow),
+#endif
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
@@ -72,6 +72,43 @@ void test_connect_with_full_parameters(void **unused) {
     snowflake_term(sf); // purge snowflake context
 }
 
+/**
+ * Test logging in several connections at once
+ */
+void test_connect_many(void **unused) {
+    SF_CONNECT *connections[4];
+    SF_STATUS statuses[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        connections[i] = setup_snowflake_connection();
+    }
+    SF_STATUS status = snowflake_connect_many(connections, 4, 0, statuses);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(connections[0]->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    for (i = 0; i < 4; i++) {
+        assert_int_equal(statuses[i], SF_STATUS_SUCCESS);
+        assert_ptr_equal(connections[i]->curl_pool, connections[0]->curl_pool);
+    }
+    for (i = 0; i < 4; i++) {
+        snowflake_term(connections[i]);
+    }
+
+    // A connection missing its parameters fails on its own
+    connections[0] = setup_snowflake_connection();
+    connections[1] = snowflake_init();
+    status = snowflake_connect_many(connections, 2, 1, statuses);
+    assert_int_not_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(statuses[0], SF_STATUS_SUCCESS);
+    assert_int_equal(statuses[1], status);
+    assert_int_equal(snowflake_error(connections[1])->error_code,
+                     SF_STATUS_ERROR_BAD_CONNECTION_PARAMS);
+    snowflake_term(connections[0]);
+    snowflake_term(connections[1]);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
@@ -79,6 +116,7 @@ int main(void) {
       cmocka_unit_test(test_no_connection_parameters),
       cmocka_unit_test(test_connect_with_minimum_parameters),
       cmocka_unit_test(test_connect_with_full_parameters),
+      cmocka_unit_test(test_connect_many),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
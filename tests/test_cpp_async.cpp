@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <future>
+#include <vector>
+#include "snowflake/Async.hpp"
+#include "utils/test_setup.h"
+
+using namespace ::Snowflake::Client;
+
+/**
+ * Queries executed at once become ready independently of each other
+ */
+void test_cpp_async_execute(void **unused)
+{
+  SF_CONNECT *sf = setup_snowflake_connection();
+  SF_STATUS status = snowflake_connect(sf);
+  if (status != SF_STATUS_SUCCESS)
+  {
+    dump_error(&(sf->error));
+  }
+  assert_int_equal(status, SF_STATUS_SUCCESS);
+
+  const int QUERIES = 3;
+  std::vector<SF_STMT *> stmts;
+  std::vector<std::future<SF_STATUS> > futures;
+  for (int i = 0; i < QUERIES; i++)
+  {
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_prepare(
+      sfstmt, "select system$wait(2), seq4() from table(generator(rowcount=>10));", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    stmts.push_back(sfstmt);
+    futures.push_back(executeAsync(sfstmt));
+  }
+
+  for (int i = 0; i < QUERIES; i++)
+  {
+    status = futures[i].get();
+    if (status != SF_STATUS_SUCCESS)
+    {
+      dump_error(&(stmts[i]->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_num_rows(stmts[i]), 10);
+
+    int rows = 0;
+    while ((status = snowflake_fetch(stmts[i])) == SF_STATUS_SUCCESS)
+    {
+      rows++;
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(rows, 10);
+    snowflake_stmt_term(stmts[i]);
+  }
+
+  // A query the server rejects fails the future
+  SF_STMT *sfstmt = snowflake_stmt(sf);
+  status = snowflake_prepare(sfstmt, "select * from table_that_does_not_exist;", 0);
+  assert_int_equal(status, SF_STATUS_SUCCESS);
+  assert_int_not_equal(executeAsync(sfstmt).get(), SF_STATUS_SUCCESS);
+  snowflake_stmt_term(sfstmt);
+
+  snowflake_term(sf);
+}
+
+int main(void)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_cpp_async_execute),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  snowflake_global_term();
+  return ret;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+
+#define PARTITIONS 6
+#define PARTITION_ROWS 1000
+
+static SF_CONNECT *create_session(void *ctx) {
+    return setup_snowflake_connection();
+}
+
+/**
+ * Tests that the rows of all the partitions come out of the fan-out, each with its query
+ */
+void test_fanout_partitions(void **unused) {
+    SF_FANOUT_QUERY queries[PARTITIONS];
+    SF_BIND_INPUT binds[PARTITIONS];
+    int64 partitions[PARTITIONS];
+    int64 rows[PARTITIONS] = {0};
+    SF_FANOUT_OPTIONS options;
+    SF_FANOUT *fanout;
+    SF_STATUS status;
+    int64 partition;
+    size_t index;
+    int i;
+    SF_SESSION_POOL *pool = snowflake_session_pool_create(create_session, NULL, 1, 3);
+
+    assert_non_null(pool);
+    for (i = 0; i < PARTITIONS; i++) {
+        partitions[i] = i;
+        snowflake_bind_input_init(&binds[i]);
+        binds[i].idx = 1;
+        binds[i].c_type = SF_C_TYPE_INT64;
+        binds[i].value = &partitions[i];
+        binds[i].len = sizeof(int64);
+        queries[i].sql = "select ?, seq4() from table(generator(rowcount => 1000))";
+        queries[i].params = &binds[i];
+        queries[i].param_count = 1;
+    }
+    memset(&options, 0, sizeof(options));
+    options.max_concurrency = 3;
+
+    fanout = snowflake_fanout_execute(pool, queries, PARTITIONS, &options);
+    assert_non_null(fanout);
+    while ((status = snowflake_fanout_fetch(fanout)) == SF_STATUS_SUCCESS) {
+        index = snowflake_fanout_query_index(fanout);
+        assert_true(index < PARTITIONS);
+        snowflake_column_as_int64(snowflake_fanout_stmt(fanout), 1, &partition);
+        assert_int_equal(partition, partitions[index]);
+        rows[index]++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(snowflake_fanout_error(fanout));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    for (i = 0; i < PARTITIONS; i++) {
+        assert_int_equal(rows[i], PARTITION_ROWS);
+    }
+    snowflake_fanout_close(fanout);
+
+    // Closed before its rows are all fetched, with a failing query among the others
+    queries[1].sql = "select * from table_that_does_not_exist";
+    queries[1].params = NULL;
+    fanout = snowflake_fanout_execute(pool, queries, PARTITIONS, NULL);
+    assert_non_null(fanout);
+    do {
+        status = snowflake_fanout_fetch(fanout);
+    } while (status == SF_STATUS_SUCCESS);
+    assert_int_not_equal(status, SF_STATUS_EOF);
+    assert_int_equal(snowflake_fanout_query_index(fanout), 1);
+    snowflake_fanout_close(fanout);
+
+    snowflake_session_pool_destroy(pool);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_fanout_partitions),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
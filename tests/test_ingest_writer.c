@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "utils/test_setup.h"
+
+#define INGEST_ROWS 1000
+
+static int64 query_count(SF_STMT *sfstmt, const char *query) {
+    int64 count = -1;
+    SF_STATUS status = snowflake_query(sfstmt, query, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &count);
+    return count;
+}
+
+void test_ingest_writer(void **unused) {
+    SF_STATUS status;
+    SF_INGEST_OPTIONS options;
+    SF_INGEST_WRITER *writer;
+    char number[32];
+    const char *values[2];
+    int i;
+    SF_CONNECT *sf = setup_snowflake_connection();
+
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(
+        sfstmt, "create or replace temporary table t (c1 number, c2 string)", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // small files and little buffering, for the rows to go in several files
+    memset(&options, 0, sizeof(options));
+    options.file_size = 4096;
+    options.max_buffered_size = 16384;
+    options.flush_interval_ms = 50;
+    writer = snowflake_ingest_writer_open(sf, "t", &options);
+    assert_non_null(writer);
+
+    for (i = 0; i < INGEST_ROWS; i++) {
+        sprintf(number, "%d", i);
+        values[0] = number;
+        // text the CSV has to quote, an empty string and NULL
+        values[1] = i % 3 == 0 ? "a \"quoted\", text" : i % 3 == 1 ? "" : NULL;
+        status = snowflake_ingest_append(writer, values, NULL, 2);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(snowflake_ingest_error(writer));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+    }
+
+    status = snowflake_ingest_flush(writer);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(snowflake_ingest_error(writer));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_ingest_rows_loaded(writer), INGEST_ROWS);
+    assert_int_equal(snowflake_ingest_writer_close(writer), SF_STATUS_SUCCESS);
+
+    assert_int_equal(query_count(sfstmt, "select count(distinct c1) from t"), INGEST_ROWS);
+    assert_int_equal(query_count(sfstmt, "select count(*) from t where c2 is null"),
+                     INGEST_ROWS / 3);
+    assert_int_equal(query_count(sfstmt, "select count(*) from t where c2 = ''"),
+                     INGEST_ROWS / 3);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_ingest_writer),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -1,15 +1,19 @@
 /*
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
+#include <string.h>
 #include "utils/test_setup.h"
 
 
-void test_large_result_set_helper(sf_bool use_arrow) {
+void test_large_result_set_helper(sf_bool use_arrow, uint64 downloader_threads, uint64 fetch_slots,
+                                  uint64 memory_limit, sf_bool multiplex, sf_bool streaming,
+                                  const char *spill_dir) {
 
     int rows = 100000; // total number of rows
 
     SF_STMT *sfstmt = NULL;
     SF_CONNECT *sf = setup_snowflake_connection();
+    snowflake_set_attribute(sf, SF_CON_CHUNK_SPILL_DIR, spill_dir);
     SF_STATUS status = snowflake_connect(sf);
     if (status != SF_STATUS_SUCCESS) {
         dump_error(&(sfstmt->error));
@@ -25,6 +29,17 @@ void test_large_result_set_helper(sf_bool use_arrow) {
     /* query */
     sfstmt = snowflake_stmt(sf);
 
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_THREADS, &downloader_threads);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_FETCH_SLOTS, &fetch_slots);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_MEMORY_LIMIT, &memory_limit);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_MULTIPLEX, &multiplex);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_STREAMING_DECODE, &streaming);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
     /* Set query result format to Arrow if necessary */
     status = snowflake_query(
         sfstmt,
@@ -56,16 +71,722 @@ void test_large_result_set_helper(sf_bool use_arrow) {
     }
     assert_int_equal(status, SF_STATUS_EOF);
 
+    // Every chunk has been downloaded, so the stats must account for it
+    SF_FETCH_STATS *stats = NULL;
+    assert_int_equal(snowflake_stmt_get_fetch_stats(sfstmt, &stats), SF_STATUS_SUCCESS);
+    assert_true(stats->chunk_count > 0);
+    for (uint64 i = 0; i < stats->chunk_count; i++) {
+        assert_true(stats->chunks[i].bytes > 0);
+        assert_true(stats->chunks[i].download_end_ms >= stats->chunks[i].download_start_ms);
+    }
+    assert_true(stats->total_bytes > 0);
+    snowflake_fetch_stats_term(stats);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_unordered(void **unused) {
+    int rows = 100000; // total number of rows
+    sf_bool unordered = SF_BOOLEAN_TRUE;
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4(),randstr(1000,random()) from table(generator(rowcount=>%d));",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_UNORDERED_FETCH, &unordered);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_chunk_index(sfstmt), -1);
+
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // Rows may come back in any chunk order, so only check that every row shows up once.
+    uint64 counter = 0;
+    int64 sum = 0;
+    int64 value;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        assert_true(snowflake_chunk_index(sfstmt) >= 0);
+        snowflake_column_as_int64(sfstmt, 1, &value);
+        sum += value;
+        counter++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(counter, rows);
+    assert_true(sum == (int64) rows * (rows - 1) / 2);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+typedef struct CHUNK_WORKER_CONTEXT {
+    SF_STMT *sfstmt;
+    int64 row_count;
+    int64 sum;
+    SF_STATUS status;
+} CHUNK_WORKER_CONTEXT;
+
+static void *chunk_worker(void *arg) {
+    CHUNK_WORKER_CONTEXT *ctx = (CHUNK_WORKER_CONTEXT *) arg;
+    SF_RESULT_CHUNK *chunk = NULL;
+    int64 value;
+
+    while ((ctx->status = snowflake_fetch_chunk(ctx->sfstmt, &chunk, NULL)) == SF_STATUS_SUCCESS) {
+        while (snowflake_chunk_next(chunk) == SF_STATUS_SUCCESS) {
+            snowflake_chunk_column_as_int64(chunk, 1, &value);
+            ctx->sum += value;
+            ctx->row_count++;
+        }
+        snowflake_chunk_term(chunk);
+    }
+    return NULL;
+}
+
+void test_large_result_set_parallel_chunks(void **unused) {
+    int rows = 100000; // total number of rows
+    int i;
+    int64 total_rows = 0;
+    int64 total_sum = 0;
+    CHUNK_WORKER_CONTEXT ctx[4];
+    SF_THREAD_HANDLE threads[4];
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4(),randstr(1000,random()) from table(generator(rowcount=>%d));",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    for (i = 0; i < 4; i++) {
+        memset(&ctx[i], 0, sizeof(ctx[i]));
+        ctx[i].sfstmt = sfstmt;
+        assert_int_equal(_thread_init(&threads[i], chunk_worker, &ctx[i]), 0);
+    }
+    for (i = 0; i < 4; i++) {
+        _thread_join(threads[i]);
+        assert_int_equal(ctx[i].status, SF_STATUS_EOF);
+        total_rows += ctx[i].row_count;
+        total_sum += ctx[i].sum;
+    }
+    assert_int_equal(total_rows, rows);
+    assert_true(total_sum == (int64) rows * (rows - 1) / 2);
+
     snowflake_stmt_term(sfstmt);
     snowflake_term(sf);
 }
 
 void test_large_result_set_arrow(void **unused) {
-    test_large_result_set_helper(SF_BOOLEAN_TRUE);
+    test_large_result_set_helper(SF_BOOLEAN_TRUE,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_THREADS,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS, 0,
+                                 SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, NULL);
 }
 
 void test_large_result_set_json(void **unused) {
-    test_large_result_set_helper(SF_BOOLEAN_FALSE);
+    test_large_result_set_helper(SF_BOOLEAN_FALSE,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_THREADS,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS, 0,
+                                 SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, NULL);
+}
+
+void test_large_result_set_arrow_auto_downloader(void **unused) {
+    test_large_result_set_helper(SF_BOOLEAN_TRUE,
+                                 SF_CHUNK_DOWNLOADER_AUTO,
+                                 SF_CHUNK_DOWNLOADER_AUTO, 0,
+                                 SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, NULL);
+}
+
+void test_large_result_set_json_single_thread(void **unused) {
+    test_large_result_set_helper(SF_BOOLEAN_FALSE, 1, 1, 0, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, NULL);
+}
+
+void test_large_result_set_arrow_memory_limit(void **unused) {
+    // A budget smaller than a single chunk still has to make progress
+    test_large_result_set_helper(SF_BOOLEAN_TRUE, 4, SF_CHUNK_DOWNLOADER_AUTO, 1024, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, NULL);
+}
+
+void test_large_result_set_json_spill(void **unused) {
+    // Chunks over the budget go to disk and are read back as they are fetched
+    char spill_dir[MAX_PATH] = {0};
+    sf_get_tmp_dir(spill_dir);
+    test_large_result_set_helper(SF_BOOLEAN_FALSE, 4, SF_CHUNK_DOWNLOADER_AUTO, 1024,
+                                 SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, spill_dir);
+}
+
+void test_large_result_set_arrow_multiplex(void **unused) {
+    test_large_result_set_helper(SF_BOOLEAN_TRUE, 2, 16, 0, SF_BOOLEAN_TRUE, SF_BOOLEAN_FALSE, NULL);
+}
+
+void test_large_result_set_json_multiplex(void **unused) {
+    test_large_result_set_helper(SF_BOOLEAN_FALSE, 2, 16, 0, SF_BOOLEAN_TRUE, SF_BOOLEAN_FALSE, NULL);
+}
+
+/**
+ * Fetches JSON results with the multiplexed downloader and one of its options set, the
+ * rows must be the same.
+ */
+static void multiplex_option_helper(SF_STMT_ATTRIBUTE option) {
+    int rows = 100000;
+    uint64 threads = 2;
+    sf_bool multiplex = SF_BOOLEAN_TRUE;
+    sf_bool enabled = SF_BOOLEAN_TRUE;
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    assert_int_equal(snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_THREADS, &threads),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_stmt_set_attr(sfstmt, SF_STMT_CHUNK_DOWNLOADER_MULTIPLEX, &multiplex),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_stmt_set_attr(sfstmt, option, &enabled), SF_STATUS_SUCCESS);
+    status = snowflake_query(sfstmt, "alter session set C_API_QUERY_RESULT_FORMAT=JSON", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_query(
+      sfstmt, "select seq4(),randstr(1000,random()) from table(generator(rowcount=>100000));", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    int64 counter = 0;
+    int64 value = 0;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        assert_int_equal(snowflake_column_as_int64(sfstmt, 1, &value), SF_STATUS_SUCCESS);
+        counter++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(counter, rows);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_json_multiplex_inflate(void **unused) {
+    // The decoder threads inflate the bodies
+    multiplex_option_helper(SF_STMT_CHUNK_DECODER_INFLATE);
+}
+
+void test_large_result_set_json_compressed_prefetch(void **unused) {
+    // The chunks ahead stay compressed until the consumer gets close
+    multiplex_option_helper(SF_STMT_CHUNK_COMPRESSED_PREFETCH);
+}
+
+void test_large_result_set_arrow_streaming(void **unused) {
+    test_large_result_set_helper(SF_BOOLEAN_TRUE,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_THREADS,
+                                 SF_DEFAULT_CHUNK_DOWNLOADER_FETCH_SLOTS, 0,
+                                 SF_BOOLEAN_FALSE, SF_BOOLEAN_TRUE, NULL);
+}
+
+/**
+ * Exports the result as record batches, the JSON chunks converted by the downloader threads
+ * if json_to_arrow is set, by the fetching thread otherwise.
+ */
+static void arrow_export_helper(const char *format, sf_bool json_to_arrow) {
+    int rows = 100000; // total number of rows
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4(),randstr(1000,random()) from table(generator(rowcount=>%d));",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    char format_buf[128];
+    sprintf(format_buf, "alter session set C_API_QUERY_RESULT_FORMAT=%s", format);
+    status = snowflake_query(sfstmt, format_buf, 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    snowflake_stmt_set_attr(sfstmt, SF_STMT_JSON_TO_ARROW, &json_to_arrow);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    int64 counter = 0;
+    while ((status = snowflake_fetch_arrow_batch(sfstmt, &array, &schema)) == SF_STATUS_SUCCESS) {
+        assert_int_equal(schema.n_children, 2);
+        assert_int_equal(array.n_children, 2);
+        counter += array.length;
+        array.release(&array);
+        schema.release(&schema);
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(counter, rows);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_arrow_export(void **unused) {
+    arrow_export_helper("ARROW_FORCE", SF_BOOLEAN_FALSE);
+}
+
+void test_large_result_set_json_arrow_export(void **unused) {
+    arrow_export_helper("JSON", SF_BOOLEAN_FALSE);
+}
+
+void test_large_result_set_json_arrow_export_decoded(void **unused) {
+    arrow_export_helper("JSON", SF_BOOLEAN_TRUE);
+}
+
+void test_large_result_set_arrow_export_file(void **unused) {
+    const char *path = "test_large_result_set_export.arrows";
+    unsigned char header[4] = {0};
+    FILE *file;
+    long size;
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    // The integers are as narrow as the values of each chunk allow
+    status = snowflake_query(
+      sfstmt, "select seq4(),randstr(100,random()) from table(generator(rowcount=>100000));", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    status = snowflake_export_result(sfstmt, path, SF_EXPORT_FORMAT_ARROW_IPC);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // The stream starts with the continuation marker of its schema message
+    file = fopen(path, "rb");
+    assert_non_null(file);
+    assert_int_equal(fread(header, 1, sizeof(header), file), sizeof(header));
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fclose(file);
+    remove(path);
+    assert_memory_equal(header, "\xff\xff\xff\xff", sizeof(header));
+    assert_true(size > 100000 * 100);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_csv_export_file(void **unused) {
+    const char *path = "test_large_result_set_export.csv";
+    char line[256];
+    int rows = 0;
+    FILE *file;
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(
+      sfstmt, "select seq4() as id, 'a,\"b\"' as text, null as nothing "
+              "from table(generator(rowcount=>100000)) order by 1;", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    status = snowflake_export_result(sfstmt, path, SF_EXPORT_FORMAT_CSV);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // The chunks are formatted on several threads but written in result order
+    file = fopen(path, "r");
+    assert_non_null(file);
+    assert_non_null(fgets(line, sizeof(line), file));
+    assert_string_equal(line, "ID,TEXT,NOTHING\n");
+    while (fgets(line, sizeof(line), file)) {
+        char expected[256];
+        sprintf(expected, "%d,\"a,\"\"b\"\"\",\n", rows);
+        assert_string_equal(line, expected);
+        rows++;
+    }
+    fclose(file);
+    remove(path);
+    assert_int_equal(rows, 100000);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_resume(void **unused) {
+    int rows = 100000; // total number of rows
+    char qid[SF_UUID4_LEN];
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4() from table(generator(rowcount=>%d)) order by 1;",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    sb_strncpy(qid, SF_UUID4_LEN, snowflake_sfqid(sfstmt), SF_UUID4_LEN);
+    snowflake_stmt_term(sfstmt);
+
+    // Resume at the second chunk from another statement, as an export job restarted would
+    sfstmt = snowflake_stmt(sf);
+    status = snowflake_get_results_from_chunk(sfstmt, qid, 2);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_num_rows(sfstmt), rows);
+
+    int64 counter = 0;
+    int64 first = -1;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        if (counter++ == 0) {
+            assert_int_equal(snowflake_chunk_index(sfstmt), 2);
+            snowflake_column_as_int64(sfstmt, 1, &first);
+        }
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    // The rows of the response and of the first chunk are skipped
+    assert_true(counter > 0 && counter < rows);
+    assert_int_equal(first, rows - counter);
+
+    status = snowflake_get_results_from_chunk(sfstmt, qid, 1000000);
+    assert_int_equal(status, SF_STATUS_ERROR_BAD_REQUEST);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_seek(void **unused) {
+    int rows = 100000; // total number of rows
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4() from table(generator(rowcount=>%d)) order by 1;",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // Within the first rows, then over several chunks, then to the last row
+    int64 targets[] = {10, 11, 5000, 90000, rows - 1};
+    int64 value = -1;
+    size_t i;
+    for (i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        status = snowflake_seek(sfstmt, targets[i]);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+        assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+        snowflake_column_as_int64(sfstmt, 1, &value);
+        assert_int_equal(value, targets[i]);
+    }
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_EOF);
+
+    assert_int_equal(snowflake_seek(sfstmt, 0), SF_STATUS_ERROR_BAD_REQUEST);
+    // Not scrollable, only the rows after the current one can be fetched
+    assert_int_equal(snowflake_fetch_absolute(sfstmt, 0), SF_STATUS_ERROR_BAD_REQUEST);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+/**
+ * Scrolls back and forth over the chunks of a scrollable statement, checking each row by
+ * its value.
+ */
+static void scroll_helper(const char *format, uint64 memory_limit) {
+    int rows = 100000; // total number of rows
+    sf_bool scrollable = SF_BOOLEAN_TRUE;
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4() from table(generator(rowcount=>%d)) order by 1;",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    char format_buf[128];
+    sprintf(format_buf, "alter session set C_API_QUERY_RESULT_FORMAT=%s", format);
+    status = snowflake_query(sfstmt, format_buf, 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    snowflake_stmt_set_attr(sfstmt, SF_STMT_SCROLLABLE, &scrollable);
+    snowflake_stmt_set_attr(sfstmt, SF_STMT_SCROLL_CACHE_MEMORY_LIMIT, &memory_limit);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    // Forward over chunks, back within a chunk and over chunks, then forward again
+    int64 targets[] = {50000, 49999, 10, 0, 70000, 99999, 20000};
+    int64 value = -1;
+    size_t i;
+    for (i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        status = snowflake_fetch_absolute(sfstmt, targets[i]);
+        if (status != SF_STATUS_SUCCESS) {
+            dump_error(&(sfstmt->error));
+        }
+        assert_int_equal(status, SF_STATUS_SUCCESS);
+        snowflake_column_as_int64(sfstmt, 1, &value);
+        assert_int_equal(value, targets[i]);
+    }
+
+    // The next rows follow the one scrolled to
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &value);
+    assert_int_equal(value, 20001);
+    assert_int_equal(snowflake_fetch_relative(sfstmt, -2), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &value);
+    assert_int_equal(value, 19999);
+    assert_int_equal(snowflake_fetch_relative(sfstmt, 0), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &value);
+    assert_int_equal(value, 19999);
+
+    int64 counter = 0;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        counter++;
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(counter, rows - 20000);
+    assert_int_equal(snowflake_fetch_absolute(sfstmt, rows), SF_STATUS_EOF);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_json_scroll(void **unused) {
+    scroll_helper("JSON", SF_DEFAULT_SCROLL_CACHE_MEMORY_LIMIT);
+}
+
+void test_large_result_set_json_scroll_dropped(void **unused) {
+    // Room for no chunk, they are all fetched again
+    scroll_helper("JSON", 1);
+}
+
+void test_large_result_set_arrow_scroll(void **unused) {
+    scroll_helper("ARROW_FORCE", SF_DEFAULT_SCROLL_CACHE_MEMORY_LIMIT);
+}
+
+void test_large_result_set_fetch_cancel(void **unused) {
+    int rows = 1000000; // total number of rows
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4(), randstr(100, random()) from table(generator(rowcount=>%d));",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    int counter = 0;
+    while (counter < 10 && (status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        counter++;
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    assert_int_equal(snowflake_fetch_cancel(sfstmt), SF_STATUS_SUCCESS);
+    // At most the rest of the current chunk is left
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        counter++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_true(counter < rows);
+    assert_int_equal(sfstmt->error.error_code, SF_STATUS_SUCCESS);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+void test_large_result_set_materialized(void **unused) {
+    int rows = 100000; // total number of rows
+
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    char sql_buf[1024];
+    sprintf(
+      sql_buf,
+      "select seq4(), seq4()::varchar, iff(seq4() %% 7 = 0, null, seq4() / 2), "
+      "iff(seq4() %% 3 = 0, 'ACTIVE', 'INACTIVE') "
+      "from table(generator(rowcount=>%d)) order by 1;",
+      rows);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_C_TYPE types[] = {SF_C_TYPE_INT64, SF_C_TYPE_STRING, SF_C_TYPE_FLOAT64,
+                         SF_C_TYPE_STRING};
+    SF_C_TYPE unsupported[] = {SF_C_TYPE_TIMESTAMP};
+    assert_int_equal(snowflake_materialize_columns(sfstmt, unsupported, 1, 0),
+                     SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE);
+    status = snowflake_materialize_columns(sfstmt, types, 4, 2);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_not_equal(snowflake_materialize_columns(sfstmt, types, 4, 2), SF_STATUS_SUCCESS);
+
+    char expected[32];
+    const char *str = NULL;
+    int64 value = -1;
+    int64 value_count = 0;
+    float64 half = 0;
+    sf_bool is_null;
+    int32 narrow;
+    const char *active = NULL;
+    int64 shared_count = 0;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        assert_int_equal(snowflake_column_as_int64(sfstmt, 1, &value), SF_STATUS_SUCCESS);
+        assert_int_equal(value, value_count);
+
+        sprintf(expected, "%lld", (long long) value);
+        assert_int_equal(snowflake_column_as_const_str(sfstmt, 2, &str), SF_STATUS_SUCCESS);
+        assert_string_equal(str, expected);
+
+        assert_int_equal(snowflake_column_is_null(sfstmt, 3, &is_null), SF_STATUS_SUCCESS);
+        assert_int_equal(is_null, value % 7 == 0);
+        if (!is_null) {
+            assert_int_equal(snowflake_column_as_float64(sfstmt, 3, &half), SF_STATUS_SUCCESS);
+            assert_true(half == value / 2.0);
+        }
+
+        assert_int_equal(snowflake_column_as_const_str(sfstmt, 4, &str), SF_STATUS_SUCCESS);
+        assert_string_equal(str, value % 3 == 0 ? "ACTIVE" : "INACTIVE");
+        if (value % 3 == 0) {
+            // The rows of a chunk share the repeated value
+            shared_count += str == active;
+            active = str;
+        }
+        value_count++;
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+    assert_int_equal(value_count, rows);
+    assert_true(shared_count > 0);
+
+    // Only the registered types are served
+    status = snowflake_query(sfstmt, sql_buf, 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_materialize_columns(sfstmt, types, 1, 0), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_column_as_int32(sfstmt, 1, &narrow),
+                     SF_STATUS_ERROR_BAD_DATA_OUTPUT_TYPE);
+    assert_int_equal(snowflake_column_as_const_str(sfstmt, 2, &str),
+                     SF_STATUS_ERROR_OUT_OF_BOUNDS);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
 }
 
 int main(void) {
@@ -73,6 +794,29 @@ int main(void) {
     const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_large_result_set_arrow),
       cmocka_unit_test(test_large_result_set_json),
+      cmocka_unit_test(test_large_result_set_arrow_auto_downloader),
+      cmocka_unit_test(test_large_result_set_json_single_thread),
+      cmocka_unit_test(test_large_result_set_arrow_memory_limit),
+      cmocka_unit_test(test_large_result_set_json_spill),
+      cmocka_unit_test(test_large_result_set_arrow_multiplex),
+      cmocka_unit_test(test_large_result_set_json_multiplex),
+      cmocka_unit_test(test_large_result_set_json_multiplex_inflate),
+      cmocka_unit_test(test_large_result_set_json_compressed_prefetch),
+      cmocka_unit_test(test_large_result_set_arrow_streaming),
+      cmocka_unit_test(test_large_result_set_unordered),
+      cmocka_unit_test(test_large_result_set_parallel_chunks),
+      cmocka_unit_test(test_large_result_set_arrow_export),
+      cmocka_unit_test(test_large_result_set_json_arrow_export),
+      cmocka_unit_test(test_large_result_set_json_arrow_export_decoded),
+      cmocka_unit_test(test_large_result_set_arrow_export_file),
+      cmocka_unit_test(test_large_result_set_csv_export_file),
+      cmocka_unit_test(test_large_result_set_resume),
+      cmocka_unit_test(test_large_result_set_seek),
+      cmocka_unit_test(test_large_result_set_json_scroll),
+      cmocka_unit_test(test_large_result_set_json_scroll_dropped),
+      cmocka_unit_test(test_large_result_set_arrow_scroll),
+      cmocka_unit_test(test_large_result_set_fetch_cancel),
+      cmocka_unit_test(test_large_result_set_materialized),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
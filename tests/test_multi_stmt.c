@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+
+void test_multi_stmt(void **unused) {
+    SF_CONNECT *sf = setup_snowflake_connection();
+    SF_STATUS status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* three statements in one request */
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    int64 multi_stmt_count = 3;
+    status = snowflake_stmt_set_attr(sfstmt, SF_STMT_MULTI_STMT_COUNT, &multi_stmt_count);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_query(
+      sfstmt,
+      "create or replace temporary table t_multi_stmt(c1 int);"
+      "insert into t_multi_stmt values(1),(2);"
+      "select c1 from t_multi_stmt order by c1;",
+      0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* create */
+    assert_int_equal(snowflake_num_rows(sfstmt), 1);
+
+    /* insert */
+    status = snowflake_next_result(sfstmt);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_affected_rows(sfstmt), 2);
+
+    /* select */
+    status = snowflake_next_result(sfstmt);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_num_rows(sfstmt), 2);
+    int64 out = 0;
+    int64 expected = 1;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        snowflake_column_as_int64(sfstmt, 1, &out);
+        assert_int_equal(out, expected);
+        ++expected;
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+
+    assert_int_equal(snowflake_next_result(sfstmt), SF_STATUS_EOF);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_multi_stmt),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
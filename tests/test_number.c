@@ -1,6 +1,7 @@
 /*
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "utils/test_setup.h"
@@ -173,6 +174,90 @@ void test_number_helper(sf_bool use_arrow) {
     snowflake_term(sf);
 }
 
+typedef struct test_case_decimal {
+    const char *c2out;
+    const char *c3out;
+    const int64 c3int;
+    const SF_STATUS c3int_status;
+} TEST_CASE_DECIMAL;
+
+void test_number_decimal_helper(sf_bool use_arrow) {
+    // One value of each column takes more than 64 bits, so all of them come as Decimal128
+    TEST_CASE_DECIMAL test_cases[] = {
+      {.c2out = "12345678901234567890123.45", .c3out = "123456789012345678901234567890",
+       .c3int = 0, .c3int_status = SF_STATUS_ERROR_OUT_OF_RANGE},
+      {.c2out = "-0.05", .c3out = "-9223372036854775808",
+       .c3int = SF_INT64_MIN, .c3int_status = SF_STATUS_SUCCESS},
+      {.c2out = "1234.56", .c3out = "42", .c3int = 42, .c3int_status = SF_STATUS_SUCCESS}
+    };
+
+    SF_STATUS status;
+    SF_CONNECT *sf = setup_snowflake_connection();
+
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt,
+                    use_arrow == SF_BOOLEAN_TRUE
+                    ? "alter session set C_API_QUERY_RESULT_FORMAT=ARROW_FORCE"
+                    : "alter session set C_API_QUERY_RESULT_FORMAT=JSON",
+                    0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    status = snowflake_query(
+      sfstmt,
+      "select column1, column2::number(38,2), column3::number(38,0) from values "
+      "(0, '12345678901234567890123.45', '123456789012345678901234567890'), "
+      "(1, '-0.05', '-9223372036854775808'), "
+      "(2, '1234.56', '42') order by 1",
+      0
+    );
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    int64 c1 = 0;
+    char *str = NULL;
+    size_t str_len = 0;
+    size_t max_str_len = 0;
+    int64 int_val = 0;
+    float64 float_val = 0.0;
+    while ((status = snowflake_fetch(sfstmt)) == SF_STATUS_SUCCESS) {
+        snowflake_column_as_int64(sfstmt, 1, &c1);
+        TEST_CASE_DECIMAL v = test_cases[c1];
+        assert_int_equal(snowflake_column_as_str(sfstmt, 2, &str, &str_len, &max_str_len),
+                         SF_STATUS_SUCCESS);
+        assert_string_equal(v.c2out, str);
+        assert_int_equal(snowflake_column_as_float64(sfstmt, 2, &float_val), SF_STATUS_SUCCESS);
+        assert_true(float_val == strtod(v.c2out, NULL));
+        assert_int_equal(snowflake_column_as_str(sfstmt, 3, &str, &str_len, &max_str_len),
+                         SF_STATUS_SUCCESS);
+        assert_string_equal(v.c3out, str);
+        assert_int_equal(snowflake_column_as_int64(sfstmt, 3, &int_val), v.c3int_status);
+        if (v.c3int_status == SF_STATUS_SUCCESS) {
+            assert_int_equal(int_val, v.c3int);
+        }
+        assert_int_equal(snowflake_column_as_float64(sfstmt, 3, &float_val), SF_STATUS_SUCCESS);
+        assert_true(float_val == strtod(v.c3out, NULL));
+    }
+    if (status != SF_STATUS_EOF) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_EOF);
+
+    free(str);
+    str = NULL;
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
 
 void test_number_arrow(void **unused) {
     test_number_helper(SF_BOOLEAN_TRUE);
@@ -182,11 +267,21 @@ void test_number_json(void **unused) {
     test_number_helper(SF_BOOLEAN_FALSE);
 }
 
+void test_number_decimal_arrow(void **unused) {
+    test_number_decimal_helper(SF_BOOLEAN_TRUE);
+}
+
+void test_number_decimal_json(void **unused) {
+    test_number_decimal_helper(SF_BOOLEAN_FALSE);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_number_arrow),
       cmocka_unit_test(test_number_json),
+      cmocka_unit_test(test_number_decimal_arrow),
+      cmocka_unit_test(test_number_decimal_json),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Nanoseconds per cell of the type conversions, without a server: result sets of one
+ * column of each Snowflake type are made from generated JSON rows and Arrow record batches,
+ * and every snowflake_column_as_* getter is timed over them. The Arrow getters are the
+ * getCellAs* of ArrowChunkIterator underneath. snowflake_raw_value_to_str_rep() and the
+ * string parsing of DataConversion are timed on their own.
+ *
+ * Each line gives the time per cell with the move to the next row taken out, which is timed
+ * on the same result set without any getter. The timings are appended to the performance
+ * CSV like the other perf tests.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <time.h>
+#include "lib/DataConversion.hpp"
+#include "util/Base64.hpp"
+#include "utils/test_setup.h"
+#include "memory.h"
+#include "results.h"
+#include "result_set.h"
+#include "json_rowset.h"
+
+namespace
+{
+
+const int ROWS = 100000;
+
+struct ColumnCase
+{
+  const char *label;
+  SF_DB_TYPE type;
+  // Column of the rowtype
+  const char *rowtype;
+  // Text of the value in JSON rows
+  std::function<std::string(int)> jsonValue;
+#ifndef SF_NO_ARROW
+  // Column of a record batch
+  std::function<std::shared_ptr<arrow::Array>(int)> arrowColumn;
+#endif
+  int32 scale;
+};
+
+struct Getter
+{
+  const char *label;
+  std::function<SF_STATUS(SF_STMT *)> get;
+};
+
+#ifndef SF_NO_ARROW
+template <typename Builder, typename Value>
+std::shared_ptr<arrow::Array> buildArray(Builder &builder, int rows,
+                                         std::function<Value(int)> value)
+{
+  std::shared_ptr<arrow::Array> array;
+  for (int i = 0; i < rows; i++)
+  {
+    assert_true(builder.Append(value(i)).ok());
+  }
+  assert_true(builder.Finish(&array).ok());
+  return array;
+}
+
+std::shared_ptr<arrow::Array> int64Column(int rows, std::function<int64_t(int)> value)
+{
+  arrow::Int64Builder builder;
+  return buildArray<arrow::Int64Builder, int64_t>(builder, rows, value);
+}
+#endif
+
+std::string fraction(int64 whole, int64 part, int digits)
+{
+  char text[64];
+  snprintf(text, sizeof(text), "%lld.%0*lld", (long long)whole, digits, (long long)part);
+  return text;
+}
+
+std::vector<ColumnCase> columnCases()
+{
+  std::vector<ColumnCase> cases;
+  ColumnCase c;
+
+  c.label = "fixed";
+  c.type = SF_DB_TYPE_FIXED;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"fixed\",\"precision\":38,\"scale\":0,\"nullable\":true}";
+  c.jsonValue = [](int i) { return std::to_string((int64)i * 7919 % 1000003); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    return int64Column(rows, [](int i) { return (int64_t)i * 7919 % 1000003; });
+  };
+#endif
+  c.scale = 0;
+  cases.push_back(c);
+
+  c.label = "fixed_scaled";
+  c.rowtype = "{\"name\":\"C\",\"type\":\"fixed\",\"precision\":10,\"scale\":2,\"nullable\":true}";
+  c.jsonValue = [](int i) { return fraction(i / 100, i % 100, 2); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    return int64Column(rows, [](int i) { return (int64_t)i; });
+  };
+#endif
+  c.scale = 2;
+  cases.push_back(c);
+
+  c.label = "decimal";
+  c.rowtype = "{\"name\":\"C\",\"type\":\"fixed\",\"precision\":38,\"scale\":2,\"nullable\":true}";
+  c.jsonValue = [](int i) { return fraction((int64)i * 7919, i % 100, 2); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::Decimal128Builder builder(arrow::decimal128(38, 2));
+    return buildArray<arrow::Decimal128Builder, arrow::Decimal128>(
+      builder, rows, [](int i) { return arrow::Decimal128((int64_t)i * 791900 + i % 100); });
+  };
+#endif
+  c.scale = 2;
+  cases.push_back(c);
+
+  c.label = "real";
+  c.type = SF_DB_TYPE_REAL;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"real\",\"nullable\":true}";
+  c.jsonValue = [](int i) { return fraction(i, 25, 2); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::DoubleBuilder builder;
+    return buildArray<arrow::DoubleBuilder, double>(builder, rows,
+                                                    [](int i) { return i + 0.25; });
+  };
+#endif
+  c.scale = 0;
+  cases.push_back(c);
+
+  c.label = "text";
+  c.type = SF_DB_TYPE_TEXT;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"text\",\"length\":16,\"byteLength\":64,\"nullable\":true}";
+  c.jsonValue = [](int i) { return "value_" + std::to_string(i); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::StringBuilder builder;
+    return buildArray<arrow::StringBuilder, std::string>(
+      builder, rows, [](int i) { return "value_" + std::to_string(i); });
+  };
+#endif
+  cases.push_back(c);
+
+  c.label = "boolean";
+  c.type = SF_DB_TYPE_BOOLEAN;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"boolean\",\"nullable\":true}";
+  c.jsonValue = [](int i) { return std::string(i % 2 ? "1" : "0"); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::BooleanBuilder builder;
+    return buildArray<arrow::BooleanBuilder, bool>(builder, rows,
+                                                   [](int i) { return i % 2 == 1; });
+  };
+#endif
+  cases.push_back(c);
+
+  c.label = "date";
+  c.type = SF_DB_TYPE_DATE;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"date\",\"nullable\":true}";
+  c.jsonValue = [](int i) { return std::to_string(18000 + i % 3650); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::Date32Builder builder;
+    return buildArray<arrow::Date32Builder, int32_t>(builder, rows,
+                                                     [](int i) { return 18000 + i % 3650; });
+  };
+#endif
+  cases.push_back(c);
+
+  c.label = "time";
+  c.type = SF_DB_TYPE_TIME;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"time\",\"scale\":9,\"nullable\":true}";
+  c.jsonValue = [](int i) { return fraction(i % 86400, i * 1001 % 1000000000, 9); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    return int64Column(rows, [](int i) {
+      return (int64_t)(i % 86400) * 1000000000 + i * 1001 % 1000000000;
+    });
+  };
+#endif
+  c.scale = 9;
+  cases.push_back(c);
+
+  c.label = "timestamp_ntz";
+  c.type = SF_DB_TYPE_TIMESTAMP_NTZ;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"timestamp_ntz\",\"scale\":3,\"nullable\":true}";
+  c.jsonValue = [](int i) { return fraction(1600000000 + (int64)i * 37, i % 1000, 3); };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    return int64Column(rows, [](int i) {
+      return (1600000000 + (int64_t)i * 37) * 1000 + i % 1000;
+    });
+  };
+#endif
+  c.scale = 3;
+  cases.push_back(c);
+
+  c.label = "binary";
+  c.type = SF_DB_TYPE_BINARY;
+  c.rowtype = "{\"name\":\"C\",\"type\":\"binary\",\"length\":8,\"byteLength\":8,\"nullable\":true}";
+  c.jsonValue = [](int i) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llX", (unsigned long long)i * 2654435761ULL);
+    return std::string(text);
+  };
+#ifndef SF_NO_ARROW
+  c.arrowColumn = [](int rows) {
+    arrow::BinaryBuilder builder;
+    return buildArray<arrow::BinaryBuilder, std::string>(builder, rows, [](int i) {
+      uint64 value = (uint64)i * 2654435761ULL;
+      return std::string((const char *)&value, sizeof(value));
+    });
+  };
+#endif
+  c.scale = 0;
+  cases.push_back(c);
+
+  return cases;
+}
+
+// Buffers the getters write to, kept across calls like an application would
+int64 int64Out;
+int32 int32Out;
+int8 int8Out;
+uint64 uint64Out;
+uint32 uint32Out;
+uint8 uint8Out;
+float32 float32Out;
+float64 float64Out;
+sf_bool boolOut;
+SF_TIMESTAMP timestampOut;
+const char *constStrOut;
+const void *binaryOut;
+size_t lenOut;
+char *strOut = NULL;
+size_t strOutSize = 0;
+
+std::vector<Getter> getters()
+{
+  std::vector<Getter> list;
+  list.push_back({"boolean", [](SF_STMT *s) { return snowflake_column_as_boolean(s, 1, &boolOut); }});
+  list.push_back({"int8", [](SF_STMT *s) { return snowflake_column_as_int8(s, 1, &int8Out); }});
+  list.push_back({"int32", [](SF_STMT *s) { return snowflake_column_as_int32(s, 1, &int32Out); }});
+  list.push_back({"int64", [](SF_STMT *s) { return snowflake_column_as_int64(s, 1, &int64Out); }});
+  list.push_back({"uint8", [](SF_STMT *s) { return snowflake_column_as_uint8(s, 1, &uint8Out); }});
+  list.push_back({"uint32", [](SF_STMT *s) { return snowflake_column_as_uint32(s, 1, &uint32Out); }});
+  list.push_back({"uint64", [](SF_STMT *s) { return snowflake_column_as_uint64(s, 1, &uint64Out); }});
+  list.push_back({"float32", [](SF_STMT *s) { return snowflake_column_as_float32(s, 1, &float32Out); }});
+  list.push_back({"float64", [](SF_STMT *s) { return snowflake_column_as_float64(s, 1, &float64Out); }});
+  list.push_back({"timestamp", [](SF_STMT *s) {
+    return snowflake_column_as_timestamp(s, 1, &timestampOut);
+  }});
+  list.push_back({"const_str", [](SF_STMT *s) {
+    return snowflake_column_as_const_str(s, 1, &constStrOut);
+  }});
+  list.push_back({"str", [](SF_STMT *s) {
+    return snowflake_column_as_str(s, 1, &strOut, &lenOut, &strOutSize);
+  }});
+  list.push_back({"binary", [](SF_STMT *s) {
+    return snowflake_column_as_binary(s, 1, &binaryOut, &lenOut);
+  }});
+  return list;
+}
+
+double elapsedNs(const struct timespec &begin, const struct timespec &end)
+{
+  return (double)(end.tv_sec - begin.tv_sec) * 1e9 + (double)(end.tv_nsec - begin.tv_nsec);
+}
+
+void report(const std::string &label, const struct timespec &begin, const struct timespec &end,
+            double baselineNs, int cells)
+{
+  process_results(begin, end, cells, label.c_str());
+  printf("%-40s %8.1f ns/cell\n", label.c_str(),
+         (elapsedNs(begin, end) - baselineNs) / cells);
+}
+
+std::string jsonRows(const ColumnCase &c)
+{
+  std::string rows = "[";
+  for (int i = 0; i < ROWS; i++)
+  {
+    rows += i > 0 ? ",[\"" : "[\"";
+    rows += c.jsonValue(i);
+    rows += "\"]";
+  }
+  return rows + "]";
+}
+
+#ifndef SF_NO_ARROW
+/**
+ * @return the record batch of the column as a Base64 encoded IPC stream, the way the
+ *         server sends the first rowset
+ */
+std::string arrowRows(const ColumnCase &c)
+{
+  std::shared_ptr<arrow::Array> column = c.arrowColumn(ROWS);
+  std::shared_ptr<arrow::Schema> schema = arrow::schema({arrow::field("C", column->type())});
+  std::shared_ptr<arrow::RecordBatch> batch = arrow::RecordBatch::Make(schema, ROWS, {column});
+  std::shared_ptr<arrow::io::BufferOutputStream> sink =
+    arrow::io::BufferOutputStream::Create().ValueOrDie();
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer =
+    arrow::ipc::MakeStreamWriter(sink.get(), schema).ValueOrDie();
+  assert_true(writer->WriteRecordBatch(*batch).ok());
+  assert_true(writer->Close().ok());
+  std::shared_ptr<arrow::Buffer> stream = sink->Finish().ValueOrDie();
+
+  std::string encoded(Snowflake::Client::Util::Base64::encodedLength(stream->size()), '\0');
+  encoded.resize(Snowflake::Client::Util::Base64::encode(stream->data(), stream->size(),
+                                                         &encoded[0]));
+  return encoded;
+}
+#endif
+
+/**
+ * Makes a statement holding a one column result set of the rows, in JSON or in Arrow
+ */
+SF_STMT *makeStatement(SF_CONNECT *sf, const ColumnCase &c, const std::string &rows,
+                       QueryResultFormat_t format)
+{
+  SF_STMT *sfstmt = snowflake_stmt(sf);
+  cJSON *rowtype = snowflake_cJSON_Parse(("[" + std::string(c.rowtype) + "]").c_str());
+  sfstmt->desc = set_description(rowtype);
+  snowflake_cJSON_Delete(rowtype);
+  sfstmt->total_fieldcount = 1;
+  sfstmt->qrf = SF_CALLOC(1, sizeof(QueryResultFormat_t));
+  *(QueryResultFormat_t *)sfstmt->qrf = format;
+  sfstmt->rs_accessors = rs_get_accessors((QueryResultFormat_t *)sfstmt->qrf);
+
+  if (format == JSON_FORMAT)
+  {
+    // The rows of a downloaded chunk
+    char *buffer = (char *)SF_TAG_MALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, rows.size() + 1);
+    memcpy(buffer, rows.c_str(), rows.size() + 1);
+    SF_JSON_ROWSET *chunk = sf_json_rowset_parse(buffer, rows.size(), rows.size() + 1,
+                                                 SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+    assert_non_null(chunk);
+    sfstmt->result_set = rs_create_with_chunk(chunk, sfstmt->desc,
+                                              (QueryResultFormat_t *)sfstmt->qrf, "UTC");
+  }
+  else
+  {
+    sfstmt->result_set = rs_create_with_json_result(
+      snowflake_cJSON_CreateString(rows.c_str()), sfstmt->desc,
+      (QueryResultFormat_t *)sfstmt->qrf, "UTC");
+  }
+  assert_non_null(sfstmt->result_set);
+  return sfstmt;
+}
+
+/**
+ * Times the move over every row
+ */
+double timeRows(SF_CONNECT *sf, const ColumnCase &c, const std::string &rows,
+                QueryResultFormat_t format)
+{
+  struct timespec begin, end;
+  SF_STMT *sfstmt = makeStatement(sf, c, rows, format);
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  while (rs_next(sfstmt->result_set, (QueryResultFormat_t *)sfstmt->qrf) == SF_STATUS_SUCCESS)
+  {
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  snowflake_stmt_term(sfstmt);
+  return elapsedNs(begin, end);
+}
+
+void timeGetters(QueryResultFormat_t format)
+{
+  const char *formatLabel = format == JSON_FORMAT ? "json" : "arrow";
+  SF_CONNECT *sf = snowflake_init();
+  snowflake_set_attribute(sf, SF_CON_TIMEZONE, "UTC");
+  std::vector<ColumnCase> cases = columnCases();
+  std::vector<Getter> list = getters();
+
+  for (size_t i = 0; i < cases.size(); i++)
+  {
+    std::string rows;
+#ifndef SF_NO_ARROW
+    rows = format == JSON_FORMAT ? jsonRows(cases[i]) : arrowRows(cases[i]);
+#else
+    rows = jsonRows(cases[i]);
+#endif
+    double baselineNs = timeRows(sf, cases[i], rows, format);
+
+    for (size_t g = 0; g < list.size(); g++)
+    {
+      std::string label = std::string("conversion_") + formatLabel + "_" + cases[i].label +
+                          "_as_" + list[g].label;
+      struct timespec begin, end;
+      SF_STMT *sfstmt = makeStatement(sf, cases[i], rows, format);
+      QueryResultFormat_t *qrf = (QueryResultFormat_t *)sfstmt->qrf;
+
+      assert_int_equal(rs_next(sfstmt->result_set, qrf), SF_STATUS_SUCCESS);
+      if (list[g].get(sfstmt) != SF_STATUS_SUCCESS)
+      {
+        // Not a conversion the type has
+        snowflake_stmt_term(sfstmt);
+        continue;
+      }
+      snowflake_stmt_term(sfstmt);
+
+      sfstmt = makeStatement(sf, cases[i], rows, format);
+      qrf = (QueryResultFormat_t *)sfstmt->qrf;
+      clock_gettime(CLOCK_MONOTONIC, &begin);
+      while (rs_next(sfstmt->result_set, qrf) == SF_STATUS_SUCCESS)
+      {
+        list[g].get(sfstmt);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      report(label, begin, end, baselineNs, ROWS);
+      snowflake_stmt_term(sfstmt);
+    }
+  }
+  snowflake_term(sf);
+}
+
+} // namespace
+
+void test_perf_conversion_json(void **unused)
+{
+  timeGetters(JSON_FORMAT);
+}
+
+void test_perf_conversion_arrow(void **unused)
+{
+#ifdef SF_NO_ARROW
+  skip();
+#else
+  timeGetters(ARROW_FORMAT);
+#endif
+}
+
+/**
+ * snowflake_raw_value_to_str_rep() on the JSON text of each type, into the same buffer
+ */
+void test_perf_raw_value_to_str_rep(void **unused)
+{
+  std::vector<ColumnCase> cases = columnCases();
+  for (size_t i = 0; i < cases.size(); i++)
+  {
+    std::vector<std::string> values;
+    struct timespec begin, end;
+    for (int r = 0; r < ROWS; r++)
+    {
+      values.push_back(cases[i].jsonValue(r));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int r = 0; r < ROWS; r++)
+    {
+      snowflake_raw_value_to_str_rep(NULL, values[r].c_str(), cases[i].type, "UTC",
+                                     cases[i].scale, SF_BOOLEAN_FALSE, &strOut, &lenOut,
+                                     &strOutSize);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    report(std::string("raw_value_to_str_rep_") + cases[i].label, begin, end, 0, ROWS);
+  }
+}
+
+/**
+ * The string parsing the JSON getters and the Arrow string columns convert with
+ */
+void test_perf_string_parsing(void **unused)
+{
+#ifdef SF_NO_ARROW
+  skip();
+#else
+  using namespace Snowflake::Client::Conversion::Arrow;
+  std::vector<std::string> integers;
+  std::vector<std::string> doubles;
+  struct timespec begin, end;
+  int64 integer;
+  float64 real;
+
+  for (int i = 0; i < ROWS; i++)
+  {
+    integers.push_back(std::to_string((int64)i * 2654435761LL));
+    doubles.push_back(fraction(i, i % 1000, 3));
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  for (int i = 0; i < ROWS; i++)
+  {
+    StringToInteger(integers[i], &integer, Snowflake::Client::INT64);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  report("conversion_string_to_integer", begin, end, 0, ROWS);
+
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  for (int i = 0; i < ROWS; i++)
+  {
+    StringToDouble(doubles[i], &real);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  report("conversion_string_to_double", begin, end, 0, ROWS);
+#endif
+}
+
+static int teardown(void **unused)
+{
+  SF_FREE(strOut);
+  strOutSize = 0;
+  return 0;
+}
+
+int main(void)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  // Logging the conversions would be measured as well
+  log_set_level(SF_LOG_WARN);
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_perf_conversion_json),
+    cmocka_unit_test(test_perf_conversion_arrow),
+    cmocka_unit_test(test_perf_raw_value_to_str_rep),
+    cmocka_unit_test(test_perf_string_parsing),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, teardown);
+  snowflake_global_term();
+  return ret;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * PUT and GET throughput against a local S3 compatible storage such as MinIO,
+ * so that changes to the transfer pipeline can be compared without a stage:
+ *
+ *   docker run -p 9000:9000 minio/minio server /data
+ *   SNOWFLAKE_TEST_LOCAL_S3_ENDPOINT=http://127.0.0.1:9000 ./test_perf_put_get_local
+ *
+ * The bucket, SNOWFLAKE_TEST_LOCAL_S3_BUCKET or "sfbench", must exist, and
+ * SNOWFLAKE_TEST_LOCAL_S3_KEY_ID and SNOWFLAKE_TEST_LOCAL_S3_SECRET_KEY default
+ * to the MinIO defaults. Without the endpoint the test is skipped.
+ *
+ * Every case sweeps file counts and sizes, auto compression and parallelism and
+ * reports the throughput of each phase from the transfer metrics, which are
+ * the times recorded in the FileMetadata of the files. The files are always
+ * encrypted, the client has no stage without client side encryption.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <sys/stat.h>
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include "snowflake/ITransferResult.hpp"
+#include "FileTransferAgent.hpp"
+#include "utils/test_setup.h"
+
+using namespace ::Snowflake::Client;
+
+namespace
+{
+
+struct TransferCase
+{
+  unsigned int fileCount;
+  size_t fileSize;
+  bool autoCompress;
+  int parallel;
+};
+
+const TransferCase CASES[] = {
+  {256, 4 * 1024, false, 4},
+  {256, 4 * 1024, true, 16},
+  {16, 1024 * 1024, false, 1},
+  {16, 1024 * 1024, false, 8},
+  {16, 1024 * 1024, true, 8},
+  {1, 256 * 1024 * 1024, false, 8},
+  {1, 256 * 1024 * 1024, true, 8},
+};
+
+const char *envOr(const char *name, const char *fallback)
+{
+  const char *value = getenv(name);
+  return value && *value ? value : fallback;
+}
+
+/**
+ * Statement answering PUT and GET with a stage on the local storage
+ */
+class LocalStageStatement : public IStatementPutGet
+{
+public:
+  LocalStageStatement(const std::string &prefix) : IStatementPutGet(),
+    m_keyId(envOr("SNOWFLAKE_TEST_LOCAL_S3_KEY_ID", "minioadmin")),
+    m_secretKey(envOr("SNOWFLAKE_TEST_LOCAL_S3_SECRET_KEY", "minioadmin")),
+    m_token("")
+  {
+    m_stageInfo.stageType = StageType::S3;
+    m_stageInfo.location = std::string(envOr("SNOWFLAKE_TEST_LOCAL_S3_BUCKET", "sfbench")) +
+                           "/" + prefix + "/";
+    m_stageInfo.region = "us-east-1";
+    m_stageInfo.endPoint = getenv("SNOWFLAKE_TEST_LOCAL_S3_ENDPOINT");
+    m_stageInfo.credentials["AWS_KEY_ID"] = &m_keyId[0];
+    m_stageInfo.credentials["AWS_SECRET_KEY"] = &m_secretKey[0];
+    m_stageInfo.credentials["AWS_TOKEN"] = &m_token[0];
+  }
+
+  void setUpload(const std::string &srcLocation, bool autoCompress, int parallel)
+  {
+    m_command = CommandType::UPLOAD;
+    m_srcLocations.assign(1, srcLocation);
+    m_autoCompress = autoCompress;
+    m_parallel = parallel;
+  }
+
+  void setDownload(const std::vector<std::string> &srcLocations, const std::string &localDir,
+                   int parallel)
+  {
+    m_command = CommandType::DOWNLOAD;
+    m_srcLocations = srcLocations;
+    m_localLocation = localDir;
+    m_autoCompress = false;
+    m_parallel = parallel;
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = m_command;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = m_autoCompress;
+    putGetParseResponse->overwrite = true;
+    putGetParseResponse->parallel = m_parallel;
+    putGetParseResponse->localLocation = &m_localLocation[0];
+    // one for the upload, one per file downloaded
+    putGetParseResponse->encryptionMaterials.assign(
+      m_command == CommandType::UPLOAD ? 1 : m_srcLocations.size(),
+      EncryptionMaterial((char *)"3dOoaBhkB1wSw4hyfA5DJw==", (char *)"1234", 1234));
+    return true;
+  }
+
+private:
+  StageInfo m_stageInfo;
+  std::string m_keyId;
+  std::string m_secretKey;
+  std::string m_token;
+  CommandType m_command;
+  std::vector<std::string> m_srcLocations;
+  std::string m_localLocation;
+  bool m_autoCompress;
+  int m_parallel;
+};
+
+std::string makeDir(const std::string &name)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string dir = std::string(tmpDir) + name;
+  mkdir(dir.c_str(), 0755);
+  return dir + "/";
+}
+
+/**
+ * Writes files of text rows, which compress about as well as the CSV files
+ * usually loaded
+ * @return the names of the files
+ */
+std::vector<std::string> createFiles(const std::string &dir, const TransferCase &c)
+{
+  std::vector<std::string> names;
+  for (unsigned int i = 0; i < c.fileCount; i++)
+  {
+    std::string name = "file_" + std::to_string(i) + ".csv";
+    FILE *file = fopen((dir + name).c_str(), "wb");
+    assert_non_null(file);
+    for (size_t size = 0, row = 0; size < c.fileSize; row++)
+    {
+      size += (size_t)fprintf(file, "%zu,%u,%08zx,some text of row %zu\n", row, i,
+                              row * 2654435761u, row % 977);
+    }
+    fclose(file);
+    names.push_back(name);
+  }
+  return names;
+}
+
+double perSecond(long long bytes, long long ms)
+{
+  return ms > 0 ? bytes / 1048576.0 * 1000 / ms : 0;
+}
+
+void report(const std::string &label, const struct timespec &begin,
+            const struct timespec &end, ITransferResult *result, int parallel)
+{
+  size_t files = result->getResultSize();
+  int statusColumn = result->findColumnByName("status", 6);
+  while (result->next())
+  {
+    std::string status;
+    result->getColumnAsString(statusColumn, status);
+    if (status != "UPLOADED" && status != "DOWNLOADED")
+    {
+      fail_msg("%s: a file was %s", label.c_str(), status.c_str());
+    }
+  }
+  TransferMetrics total = result->getTotalMetrics();
+  process_results(begin, end, (int)files, label.c_str());
+  // the phase times add up over the files transferred at once, so they are
+  // the throughput of one thread
+  printf("%-36s %8.1f MB/s, compress %8.1f MB/s, hash %8.1f MB/s, "
+         "transfer %8.1f MB/s per stream (%d)\n",
+         label.c_str(), perSecond(total.rawBytes ? total.rawBytes : total.transferredBytes,
+                                  total.elapsedMs),
+         perSecond(total.rawBytes, total.compressMs), perSecond(total.rawBytes, total.hashMs),
+         perSecond(total.transferredBytes, total.transferMs), parallel);
+}
+
+} // namespace
+
+void test_perf_put_get_local(void **unused)
+{
+  if (!getenv("SNOWFLAKE_TEST_LOCAL_S3_ENDPOINT"))
+  {
+    skip();
+  }
+  TransferConfig config;
+  std::string caBundle = envOr("SNOWFLAKE_TEST_CA_BUNDLE_FILE",
+                               "/etc/ssl/certs/ca-certificates.crt");
+  config.caBundleFile = &caBundle[0];
+
+  for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+  {
+    const TransferCase &c = CASES[i];
+    std::string label = std::to_string(c.fileCount) + "x" + std::to_string(c.fileSize) +
+                        (c.autoCompress ? "_gzip" : "") + "_p" + std::to_string(c.parallel);
+    std::string srcDir = makeDir("put_get_local_src");
+    std::string dstDir = makeDir("put_get_local_dst");
+    std::vector<std::string> names = createFiles(srcDir, c);
+    std::string command = "put/get";
+    struct timespec begin, end;
+
+    LocalStageStatement statement("bench_" + label);
+    statement.setUpload(srcDir + "file_*.csv", c.autoCompress, c.parallel);
+    {
+      FileTransferAgent agent(&statement, &config);
+      clock_gettime(CLOCK_MONOTONIC, &begin);
+      ITransferResult *result = agent.execute(&command);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      report("put_local_" + label, begin, end, result, c.parallel);
+    }
+
+    for (size_t n = 0; n < names.size(); n++)
+    {
+      remove((srcDir + names[n]).c_str());
+      if (c.autoCompress)
+      {
+        names[n] += ".gz";
+      }
+    }
+    statement.setDownload(names, dstDir, c.parallel);
+    {
+      FileTransferAgent agent(&statement, &config);
+      clock_gettime(CLOCK_MONOTONIC, &begin);
+      ITransferResult *result = agent.execute(&command);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      report("get_local_" + label, begin, end, result, c.parallel);
+    }
+    for (size_t n = 0; n < names.size(); n++)
+    {
+      remove((dstDir + names[n]).c_str());
+    }
+  }
+}
+
+int main(void)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  log_set_level(SF_LOG_WARN);
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_perf_put_get_local),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  snowflake_global_term();
+  return ret;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Startup cost of a process using the client, for the short lived processes that run a few
+ * queries and exit. The test runs itself again as a child many times:
+ *
+ *   - "exit" returns at once, the time the binary takes to load, static initialization of the
+ *     library included.
+ *   - "init" also initializes and terminates the library and a connection, without connecting.
+ *
+ * The subsystems only some statements use, the AWS SDK, the OpenSSL ciphers of the file
+ * transfers or the secret masking patterns, are initialized when first used, so neither may
+ * grow much past the time a process takes to run /bin/true, reported as the baseline.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "utils/test_setup.h"
+
+namespace
+{
+
+const int SPAWNS = 50;
+
+const char *s_self = NULL;
+
+void spawn(const char *path, const char *mode)
+{
+  pid_t pid = fork();
+  assert_true(pid >= 0);
+  if (pid == 0)
+  {
+    execl(path, path, mode, (char *)NULL);
+    _exit(127);
+  }
+  int status = 0;
+  assert_int_equal(waitpid(pid, &status, 0), pid);
+  assert_true(WIFEXITED(status));
+  assert_int_equal(WEXITSTATUS(status), 0);
+}
+
+/**
+ * @return milliseconds per run
+ */
+double measure(const char *label, const char *path, const char *mode)
+{
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  for (int i = 0; i < SPAWNS; i++)
+  {
+    spawn(path, mode);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  process_results(begin, end, SPAWNS, label);
+  double ms = ((end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6) / SPAWNS;
+  printf("%-24s %8.2f ms per process\n", label, ms);
+  return ms;
+}
+
+int runChild(const char *mode)
+{
+  if (strcmp(mode, "init") == 0)
+  {
+    if (snowflake_global_init(NULL, SF_LOG_WARN, NULL) != SF_STATUS_SUCCESS)
+    {
+      return 1;
+    }
+    SF_CONNECT *sf = snowflake_init();
+    if (!sf)
+    {
+      return 1;
+    }
+    snowflake_term(sf);
+    snowflake_global_term();
+  }
+  return 0;
+}
+
+} // namespace
+
+void test_perf_startup(void **unused)
+{
+  double baseline = measure("startup_bin_true", "/bin/true", "");
+  double load = measure("startup_exit", s_self, "exit");
+  double init = measure("startup_init", s_self, "init");
+  printf("load and static initialization %.2f ms, global init and a connection %.2f ms\n",
+         load - baseline, init - load);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    return runChild(argv[1]);
+  }
+  s_self = argv[0];
+  initialize_test(SF_BOOLEAN_FALSE);
+  log_set_level(SF_LOG_WARN);
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_perf_startup),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  snowflake_global_term();
+  return ret;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+
+static SF_CONNECT *create_session(void *ctx) {
+    return setup_snowflake_connection();
+}
+
+/**
+ * Tests that checked in sessions are handed out again, with their original schema
+ */
+void test_session_pool_reuse(void **unused) {
+    SF_SESSION_POOL *pool = snowflake_session_pool_create(create_session, NULL, 1, 2);
+    SF_CONNECT *first;
+    SF_CONNECT *second;
+    SF_CONNECT *again;
+    SF_STMT *sfstmt;
+    SF_STATUS status;
+
+    assert_non_null(pool);
+    first = snowflake_session_pool_checkout(pool);
+    if (!first) {
+        dump_error(snowflake_session_pool_error(pool));
+    }
+    assert_non_null(first);
+    second = snowflake_session_pool_checkout(pool);
+    assert_non_null(second);
+    assert_ptr_not_equal(first, second);
+
+    sfstmt = snowflake_stmt(first);
+    status = snowflake_query(sfstmt, "use schema information_schema", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    snowflake_stmt_term(sfstmt);
+
+    snowflake_session_pool_checkin(pool, first);
+    again = snowflake_session_pool_checkout(pool);
+    assert_ptr_equal(again, first);
+    assert_string_not_equal(again->schema, "INFORMATION_SCHEMA");
+
+    snowflake_session_pool_checkin(pool, again);
+    snowflake_session_pool_checkin(pool, second);
+    snowflake_session_pool_destroy(pool);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_session_pool_reuse),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
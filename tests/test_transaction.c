@@ -165,10 +165,64 @@ void test_transaction(void **unused) {
     snowflake_term(sf); // purge snowflake context
 }
 
+static uint64 http_requests(void) {
+    SF_METRICS_SNAPSHOT metrics;
+    snowflake_global_get_attribute(SF_GLOBAL_METRICS, &metrics, sizeof(metrics));
+    return metrics.counters[SF_COUNTER_HTTP_REQUESTS];
+}
+
+void test_transaction_deferred_begin(void **unused) {
+    SF_STATUS status;
+    uint64 requests;
+    int64 count = -1;
+    SF_CONNECT *sf = setup_snowflake_connection();
+    status = snowflake_connect(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    status = snowflake_query(sfstmt, "create or replace temporary table t_deferred(c1 int)", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    /* a transaction without statements is never sent */
+    requests = http_requests();
+    assert_int_equal(snowflake_trans_begin(sf), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_trans_commit(sf), SF_STATUS_SUCCESS);
+    assert_int_equal(http_requests(), requests);
+
+    /* BEGIN goes out with the first statement */
+    assert_int_equal(snowflake_trans_begin(sf), SF_STATUS_SUCCESS);
+    status = snowflake_query(sfstmt, "insert into t_deferred values(1)", 0);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sfstmt->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    status = snowflake_trans_rollback(sf);
+    if (status != SF_STATUS_SUCCESS) {
+        dump_error(&(sf->error));
+    }
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+
+    status = snowflake_query(sfstmt, "select count(*) from t_deferred", 0);
+    assert_int_equal(status, SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_fetch(sfstmt), SF_STATUS_SUCCESS);
+    snowflake_column_as_int64(sfstmt, 1, &count);
+    assert_int_equal(count, 0);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
 int main(void) {
     initialize_test(SF_BOOLEAN_FALSE);
     const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_transaction),
+      cmocka_unit_test(test_transaction_deferred_begin),
     };
     int ret = cmocka_run_group_tests(tests, NULL, NULL);
     snowflake_global_term();
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "arena.h"
+#include "results.h"
+#include "memory.h"
+
+/**
+ * Tests that allocations are zeroed, aligned and don't overlap, also across blocks and for
+ * allocations larger than a block, and that a reset reuses the blocks
+ */
+void test_arena_alloc_reset(void **unused) {
+    SF_ARENA *arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    char *values[100];
+    char *large;
+    char *first;
+    int i;
+
+    assert_non_null(arena);
+    for (i = 0; i < 100; i++) {
+        values[i] = (char *) sf_arena_calloc(arena, 100 + i);
+        assert_non_null(values[i]);
+        assert_int_equal((size_t) values[i] % sizeof(void *), 0);
+        assert_int_equal(values[i][99 + i], 0);
+        memset(values[i], i, 100 + i);
+    }
+    large = (char *) sf_arena_calloc(arena, SF_ARENA_BLOCK_SIZE * 3);
+    assert_non_null(large);
+    memset(large, 0xff, SF_ARENA_BLOCK_SIZE * 3);
+    for (i = 0; i < 100; i++) {
+        assert_int_equal(values[i][0], i);
+        assert_int_equal(values[i][99 + i], i);
+    }
+
+    first = values[0];
+    sf_arena_reset(arena);
+    values[0] = (char *) sf_arena_calloc(arena, 10);
+    assert_ptr_equal(values[0], first);
+    assert_int_equal(values[0][0], 0);
+    sf_arena_term(arena);
+}
+
+/**
+ * Tests that bound values are converted to the same text as with value_to_string()
+ */
+void test_arena_value_to_string(void **unused) {
+    SF_ARENA *arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    int64 number = -1234567890123LL;
+    sf_bool flag = SF_BOOLEAN_TRUE;
+    char binary[] = {'\x01', '\xab'};
+    char *text;
+
+    assert_string_equal(value_to_arena_string(arena, &number, sizeof(number),
+                                              SF_C_TYPE_INT64), "-1234567890123");
+    text = value_to_string(&flag, sizeof(flag), SF_C_TYPE_BOOLEAN);
+    assert_string_equal(value_to_arena_string(arena, &flag, sizeof(flag), SF_C_TYPE_BOOLEAN),
+                        text);
+    SF_FREE(text);
+    assert_string_equal(value_to_arena_string(arena, binary, sizeof(binary),
+                                              SF_C_TYPE_BINARY), "01AB");
+    assert_string_equal(value_to_arena_string(arena, "abc", 3, SF_C_TYPE_STRING), "abc");
+    assert_null(value_to_arena_string(arena, NULL, 0, SF_C_TYPE_STRING));
+    assert_null(value_to_arena_string(NULL, &number, sizeof(number), SF_C_TYPE_INT64));
+    sf_arena_term(arena);
+}
+
+static size_t hooked_allocations;
+
+static void *hooked_malloc(size_t size) {
+    hooked_allocations++;
+    return malloc(size);
+}
+
+static void hooked_free(void *ptr) {
+    hooked_allocations--;
+    free(ptr);
+}
+
+/**
+ * Tests that the blocks of an arena are accounted to its tag and go to the allocator of the tag
+ */
+void test_arena_tag_hooks(void **unused) {
+    SF_INTERNAL_MEM_HOOKS hooks = {hooked_malloc, hooked_free, realloc, NULL};
+    SF_ARENA *arena;
+
+    assert_true(sf_memory_set_tag_hooks(SF_MEMORY_TAG_BIND, &hooks));
+    arena = sf_arena_init(SF_MEMORY_TAG_BIND);
+    assert_non_null(sf_arena_calloc(arena, 10));
+    assert_non_null(sf_arena_calloc(arena, SF_ARENA_BLOCK_SIZE));
+    assert_int_equal(hooked_allocations, 2);
+    assert_true(sf_memory_tag_used(SF_MEMORY_TAG_BIND) >= SF_ARENA_BLOCK_SIZE * 2);
+    // Memory of the tag is in use
+    assert_false(sf_memory_set_tag_hooks(SF_MEMORY_TAG_BIND, NULL));
+
+    sf_arena_term(arena);
+    assert_int_equal(hooked_allocations, 0);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_BIND), 0);
+    assert_true(sf_memory_set_tag_hooks(SF_MEMORY_TAG_BIND, NULL));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_arena_alloc_reset),
+      cmocka_unit_test(test_arena_value_to_string),
+      cmocka_unit_test(test_arena_tag_hooks),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "util/AsyncFileStreamBuf.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::Util::AsyncFileStreamBuf;
+
+static std::string testFile(const char *name)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  return std::string(tmpDir) + name;
+}
+
+/**
+ * Data written behind over several buffers reads back the same ahead, in
+ * parts smaller and larger than the buffers, and again after a seek.
+ */
+void test_async_file_round_trip(void **unused)
+{
+  std::string fileName = testFile("async_file_round_trip_test.dat");
+  std::string data;
+  for (int i = 0; data.size() < 100000; i++)
+  {
+    data += std::to_string(i) + ",";
+  }
+
+  {
+    AsyncFileStreamBuf buffer(4096, 3);
+    assert_true(buffer.open(fileName, AsyncFileStreamBuf::WRITE));
+    std::ostream out(&buffer);
+    out.write(data.data(), 10);
+    out.write(data.data() + 10, 50000);
+    out << data.substr(50010);
+    assert_true(out.tellp() == (std::streamoff)data.size());
+    assert_true(buffer.close());
+  }
+  {
+    std::ifstream file(fileName.c_str(), std::ios_base::binary);
+    std::string written((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    assert_true(written == data);
+  }
+
+  AsyncFileStreamBuf buffer(4096, 3);
+  assert_true(buffer.open(fileName, AsyncFileStreamBuf::READ));
+  std::istream in(&buffer);
+  std::string read(data.size() + 10, '\0');
+  in.read(&read[0], 100);
+  in.read(&read[100], (std::streamsize)read.size() - 100);
+  assert_int_equal(in.gcount(), data.size() - 100);
+  read.resize(data.size());
+  assert_true(read == data);
+
+  in.clear();
+  in.seekg(5000, std::ios_base::beg);
+  std::string rest((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  assert_true(rest == data.substr(5000));
+  assert_true(buffer.close());
+
+  remove(fileName.c_str());
+}
+
+/**
+ * An empty file reads nothing and a missing one doesn't open.
+ */
+void test_async_file_empty(void **unused)
+{
+  std::string fileName = testFile("async_file_empty_test.dat");
+  {
+    AsyncFileStreamBuf buffer(4096, 2);
+    assert_true(buffer.open(fileName, AsyncFileStreamBuf::WRITE));
+    assert_true(buffer.close());
+  }
+
+  AsyncFileStreamBuf buffer(4096, 2);
+  assert_true(buffer.open(fileName, AsyncFileStreamBuf::READ));
+  std::istream in(&buffer);
+  assert_int_equal(in.get(), EOF);
+  assert_true(buffer.close());
+  remove(fileName.c_str());
+
+  assert_false(buffer.open(fileName, AsyncFileStreamBuf::READ));
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_async_file_round_trip),
+    cmocka_unit_test(test_async_file_empty),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "SnowflakeAzureClient.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::SnowflakeAzureClient;
+
+#define MB (1024ULL * 1024ULL)
+#define GB (1024ULL * MB)
+
+/**
+ * Every thread gets a block of its own, no smaller than the threshold.
+ */
+void test_block_size_per_thread(void **unused)
+{
+  assert_int_equal(SnowflakeAzureClient::chooseBlockSize(300 * MB, 16 * MB, 4), 76 * MB);
+  assert_int_equal(SnowflakeAzureClient::chooseBlockSize(200 * MB, 64 * MB, 4), 64 * MB);
+}
+
+/**
+ * A large file is put in blocks as large as Azure takes.
+ */
+void test_block_size_max(void **unused)
+{
+  assert_int_equal(SnowflakeAzureClient::chooseBlockSize(2 * GB, 64 * MB, 4), 100 * MB);
+}
+
+/**
+ * A huge file is never split in more blocks than Azure allows.
+ */
+void test_block_size_max_blocks(void **unused)
+{
+  unsigned long long size = 6000 * GB;
+  size_t blockSize = SnowflakeAzureClient::chooseBlockSize(size, 64 * MB, 4);
+  assert_true(size / blockSize + 1 <= 50000);
+  assert_int_equal(blockSize % MB, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_block_size_per_thread),
+    cmocka_unit_test(test_block_size_max),
+    cmocka_unit_test(test_block_size_max_blocks),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
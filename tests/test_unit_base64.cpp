@@ -260,12 +260,47 @@ void test_base64_url_coding(void **unused)
   }
 }
 
+/**
+ * Test that long inputs, decoded in large blocks where the CPU allows, decode
+ * to exactly their data and that a bad character anywhere is found
+ * @param unused
+ */
+void test_base64_long_coding(void **unused)
+{
+  for (size_t size : {0, 1, 2, 3, 31, 32, 33, 47, 48, 49, 100, 257, 1000, 100001})
+  {
+    std::vector<char> data(size);
+    for (size_t i = 0; i < size; i++)
+    {
+      data[i] = (char)(i * 131 + size);
+    }
+    std::string encoded = Base64::encodePadding(data);
+    assert_true(Base64::decodePadding(encoded) == data);
+
+    // the output buffer is exactly as large as the data, for ASan to check
+    std::vector<char> decoded(Base64::decodedLength(encoded.data(), encoded.size()));
+    assert_int_equal(decoded.size(), size);
+    for (size_t bad : {(size_t)0, encoded.size() / 2, encoded.size() > 5 ? encoded.size() - 5 : 0})
+    {
+      if (bad >= encoded.size())
+      {
+        continue;
+      }
+      std::string corrupted = encoded;
+      corrupted[bad] = '*';
+      assert_int_equal(Base64::decode(corrupted.data(), corrupted.size(), decoded.data()),
+                       (size_t)-1);
+    }
+  }
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_base64_coding),
     cmocka_unit_test(test_base64_cpp_coding),
     cmocka_unit_test(test_base64_url_coding),
     cmocka_unit_test(test_base64_url_cpp_coding),
+    cmocka_unit_test(test_base64_long_coding),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "bind_upload.h"
+#include "memory.h"
+
+/**
+ * Tests that array binds are written as one CSV line per row
+ */
+void test_bind_upload_serialize(void **unused) {
+    SF_CONNECT *sf = snowflake_init();
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    SF_BIND_INPUT binds[2];
+    int64 ids[3] = {1, -2, 3};
+    char names[3][12] = {"a", "say \"hi\"", ""};
+    uint64 paramset_size = 3;
+    size_t len;
+    char *text;
+
+    snowflake_bind_input_init(&binds[0]);
+    binds[0].idx = 1;
+    binds[0].c_type = SF_C_TYPE_INT64;
+    binds[0].value = ids;
+    binds[0].len = sizeof(int64);
+    snowflake_bind_input_init(&binds[1]);
+    binds[1].idx = 2;
+    binds[1].c_type = SF_C_TYPE_STRING;
+    binds[1].value = names;
+    binds[1].len = sizeof(names[0]);
+    assert_int_equal(snowflake_bind_param_array(sfstmt, binds, 2), SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_stmt_set_attr(sfstmt, SF_STMT_PARAMSET_SIZE, &paramset_size),
+                     SF_STATUS_SUCCESS);
+
+    text = bind_upload_serialize(sfstmt, &len);
+    assert_non_null(text);
+    assert_string_equal(text, "1,a\n-2,\"say \"\"hi\"\"\"\n3,\"\"\n");
+    assert_int_equal(len, strlen(text));
+    SF_FREE(text);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+static void release_schema(struct ArrowSchema *schema) {
+    schema->release = NULL;
+}
+
+static void release_array(struct ArrowArray *array) {
+    array->release = NULL;
+}
+
+/**
+ * Tests that the columns of an Arrow batch are written as CSV straight from their buffers,
+ * offsets and null values included
+ */
+void test_bind_upload_serialize_arrow(void **unused) {
+    SF_CONNECT *sf = snowflake_init();
+    SF_STMT *sfstmt = snowflake_stmt(sf);
+    // Four rows, the first one skipped by the offset of the batch
+    int64 ids[4] = {0, 1, -2, 3};
+    uint8 id_validity = 0x0b;
+    int32 name_offsets[5] = {0, 1, 2, 10, 10};
+    const char *names = "xasay \"hi\"";
+    int32 days[4] = {0, 0, 18628, -1};
+    float64 prices[4] = {0, 1.5, 0.1, -2};
+    const void *id_buffers[2] = {&id_validity, ids};
+    const void *name_buffers[3] = {NULL, name_offsets, names};
+    const void *day_buffers[2] = {NULL, days};
+    const void *price_buffers[2] = {NULL, prices};
+    struct ArrowSchema child_schemas[4] = {
+      {"l", "ID", NULL, ARROW_FLAG_NULLABLE, 0, NULL, NULL, release_schema, NULL},
+      {"u", "NAME", NULL, ARROW_FLAG_NULLABLE, 0, NULL, NULL, release_schema, NULL},
+      {"tdD", "DAY", NULL, 0, 0, NULL, NULL, release_schema, NULL},
+      {"g", "PRICE", NULL, 0, 0, NULL, NULL, release_schema, NULL},
+    };
+    struct ArrowArray children[4] = {
+      {4, 1, 0, 2, 0, id_buffers, NULL, NULL, release_array, NULL},
+      {4, 0, 0, 3, 0, name_buffers, NULL, NULL, release_array, NULL},
+      {4, 0, 0, 2, 0, day_buffers, NULL, NULL, release_array, NULL},
+      {4, 0, 0, 2, 0, price_buffers, NULL, NULL, release_array, NULL},
+    };
+    struct ArrowSchema *schema_children[4] = {
+      &child_schemas[0], &child_schemas[1], &child_schemas[2], &child_schemas[3]
+    };
+    struct ArrowArray *array_children[4] = {
+      &children[0], &children[1], &children[2], &children[3]
+    };
+    const void *struct_buffers[1] = {NULL};
+    struct ArrowSchema schema = {"+s", "", NULL, 0, 4, schema_children, NULL, release_schema,
+                                 NULL};
+    struct ArrowArray array = {3, 0, 1, 1, 4, struct_buffers, array_children, NULL,
+                               release_array, NULL};
+    size_t len;
+    char *text;
+
+    assert_int_equal(snowflake_bind_arrow(sfstmt, &array, &schema), SF_STATUS_SUCCESS);
+    text = bind_upload_serialize_arrow(sfstmt, &len);
+    assert_non_null(text);
+    assert_string_equal(text,
+                        "1,a,1970-01-01,1.5\n"
+                        ",\"say \"\"hi\"\"\",2021-01-01,0.10000000000000001\n"
+                        "3,\"\",1969-12-31,-2\n");
+    assert_int_equal(len, strlen(text));
+    SF_FREE(text);
+
+    // Only the formats that can be bound are accepted
+    child_schemas[3].format = "d:38,2";
+    assert_int_equal(snowflake_bind_arrow(sfstmt, &array, &schema), SF_STATUS_ERROR_BAD_REQUEST);
+
+    snowflake_stmt_term(sfstmt);
+    snowflake_term(sf);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_bind_upload_serialize),
+      cmocka_unit_test(test_bind_upload_serialize_arrow),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
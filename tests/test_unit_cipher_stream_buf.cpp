@@ -1,11 +1,14 @@
 /*
  * Copyright (c) 2018-2019 Snowflake Computing, Inc. All rights reserved.
  */
+#include <algorithm>
 #include <sstream>
 #include <fstream>
+#include <iterator>
 #include <crypto/Cryptor.hpp>
 #include "utils/test_setup.h"
 #include "crypto/CipherStreamBuf.hpp"
+#include "util/MappedFile.hpp"
 
 using Snowflake::Client::Crypto::CryptoIV;
 using Snowflake::Client::Crypto::Cryptor;
@@ -62,11 +65,206 @@ void test_cipher_stream_buf_two(void **unused)
   test_cipher_stream_core(16, testData, strlen(testData), CryptoRandomDevice::DEV_URANDOM);
 }
 
+/**
+ * Large blocks encrypt the same as small ones, with the buffers of one stream
+ * taken again by the next.
+ */
+void test_cipher_stream_buf_large(void **unused)
+{
+  CryptoIV iv;
+  Cryptor::generateIV(iv, CryptoRandomDevice::DEV_URANDOM);
+  CryptoKey key;
+  Cryptor::generateKey(key, 256, CryptoRandomDevice::DEV_URANDOM);
+
+  std::string data(1024 * 1024 + 5, 'x');
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i] = (char)(i * 7);
+  }
+
+  std::string expected;
+  for (int blockSize : {16, 256 * 1024, 256 * 1024})
+  {
+    std::stringstream ss(data);
+    CipherIOStream encrypted(ss, CryptoOperation::ENCRYPT, key, iv, blockSize);
+    std::string result((std::istreambuf_iterator<char>(encrypted)),
+                       std::istreambuf_iterator<char>());
+    assert_int_equal(result.size(), 1024 * 1024 + 16);
+    if (expected.empty())
+    {
+      expected = result;
+    }
+    assert_true(result == expected);
+  }
+}
+
+/**
+ * A file mapped in memory encrypts the same as read through a stream, the
+ * data a multiple of the block size or not.
+ */
+void test_cipher_stream_buf_mapped(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string fileName = std::string(tmpDir) + "cipher_stream_buf_mapped_test.dat";
+  CryptoIV iv;
+  Cryptor::generateIV(iv, CryptoRandomDevice::DEV_URANDOM);
+  CryptoKey key;
+  Cryptor::generateKey(key, 256, CryptoRandomDevice::DEV_URANDOM);
+
+  const char * testData[] = {"0123456789012345", "01234567890123456789"};
+  for (const char *data : testData)
+  {
+    {
+      std::ofstream file(fileName.c_str(), std::ios_base::binary);
+      file << data;
+    }
+    Snowflake::Client::Util::MappedFile mappedFile;
+    assert_true(mappedFile.open(fileName));
+    assert_int_equal(mappedFile.size(), strlen(data));
+
+    std::stringstream ss(data);
+    CipherIOStream streamed(ss, CryptoOperation::ENCRYPT, key, iv, 16);
+    CipherIOStream mapped(mappedFile.data(), mappedFile.size(),
+                          CryptoOperation::ENCRYPT, key, iv, 16);
+    std::string expected((std::istreambuf_iterator<char>(streamed)),
+                         std::istreambuf_iterator<char>());
+    std::string result((std::istreambuf_iterator<char>(mapped)),
+                       std::istreambuf_iterator<char>());
+    assert_int_equal(result.size(), 32);
+    assert_true(result == expected);
+  }
+  remove(fileName.c_str());
+}
+
+/**
+ * The parts of an encrypted stream decrypt on their own with the cipher block
+ * before each as its iv, in any order.
+ */
+void test_cipher_stream_buf_parts(void **unused)
+{
+  CryptoIV iv;
+  Cryptor::generateIV(iv, CryptoRandomDevice::DEV_URANDOM);
+  CryptoKey key;
+  Cryptor::generateKey(key, 256, CryptoRandomDevice::DEV_URANDOM);
+
+  std::string data(100, 'x');
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i] = (char)(i * 13);
+  }
+  std::stringstream ss(data);
+  CipherIOStream encrypted(ss, CryptoOperation::ENCRYPT, key, iv, 16);
+  std::string cipher((std::istreambuf_iterator<char>(encrypted)),
+                     std::istreambuf_iterator<char>());
+  assert_int_equal(cipher.size(), 112);
+
+  // parts of 32 bytes, the last one of 16 with the padding
+  std::string plain[4];
+  for (int part = 3; part >= 0; part--)
+  {
+    size_t start = part * 32;
+    size_t len = std::min((size_t)32, cipher.size() - start);
+    CryptoIV prevBlock = iv;
+    if (part > 0)
+    {
+      memcpy(prevBlock.data, cipher.data() + start - 16, 16);
+    }
+    std::string buf = cipher.substr(start, len);
+    size_t plainLen = Cryptor::getInstance().decryptPart(key, prevBlock,
+                                                         &buf[0], len, part == 3);
+    plain[part] = buf.substr(0, plainLen);
+  }
+  assert_int_equal(plain[3].size(), 4);
+  assert_true(plain[0] + plain[1] + plain[2] + plain[3] == data);
+}
+
+/**
+ * Reads large enough to be encrypted straight into the caller's array give
+ * the same bytes as reads going through the stream buffer, from a stream or
+ * from memory.
+ */
+void test_cipher_stream_buf_direct_read(void **unused)
+{
+  CryptoIV iv;
+  Cryptor::generateIV(iv, CryptoRandomDevice::DEV_URANDOM);
+  CryptoKey key;
+  Cryptor::generateKey(key, 256, CryptoRandomDevice::DEV_URANDOM);
+
+  std::string data(100, 'x');
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i] = (char)(i * 7);
+  }
+  std::stringstream ss(data);
+  CipherIOStream encrypted(ss, CryptoOperation::ENCRYPT, key, iv, 16);
+  std::string expected((std::istreambuf_iterator<char>(encrypted)),
+                       std::istreambuf_iterator<char>());
+  assert_int_equal(expected.size(), 112);
+
+  // a few bytes first so that reads start in the middle of a cipher block
+  size_t readSizes[] = {40, 3, 64, 100};
+  for (int fromMemory = 0; fromMemory < 2; fromMemory++)
+  {
+    std::stringstream src(data);
+    CipherIOStream streamed(src, CryptoOperation::ENCRYPT, key, iv, 16);
+    CipherIOStream mapped(data.data(), data.size(),
+                          CryptoOperation::ENCRYPT, key, iv, 16);
+    CipherIOStream &stream = fromMemory ? mapped : streamed;
+    std::string result;
+    for (size_t readSize : readSizes)
+    {
+      char buf[100];
+      stream.read(buf, readSize);
+      result.append(buf, (size_t)stream.gcount());
+    }
+    assert_true(result == expected);
+  }
+}
+
+/**
+ * Digests taken one after the other, and two at once, with the contexts of
+ * the thread reused, are those of the data.
+ */
+void test_hash_context_reuse(void **unused)
+{
+  using Snowflake::Client::Crypto::CryptoHashFunc;
+  using Snowflake::Client::Crypto::HashContext;
+  // sha256("abc")
+  const unsigned char expected[] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde,
+    0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+    0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad};
+
+  for (int i = 0; i < 10; i++)
+  {
+    HashContext first(Cryptor::getInstance().createHashContext(CryptoHashFunc::SHA256));
+    HashContext second(Cryptor::getInstance().createHashContext(CryptoHashFunc::SHA256));
+    first.initialize();
+    second.initialize();
+    first.next("ab", 2);
+    second.next("a", 1);
+    first.next("c", 1);
+    second.next("bc", 2);
+
+    unsigned char digest[32];
+    first.finalize(digest);
+    assert_memory_equal(digest, expected, sizeof(expected));
+    second.finalize(digest);
+    assert_memory_equal(digest, expected, sizeof(expected));
+  }
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_cipher_stream_buf_zero),
     cmocka_unit_test(test_cipher_stream_buf_one),
     cmocka_unit_test(test_cipher_stream_buf_two),
+    cmocka_unit_test(test_cipher_stream_buf_large),
+    cmocka_unit_test(test_cipher_stream_buf_mapped),
+    cmocka_unit_test(test_cipher_stream_buf_parts),
+    cmocka_unit_test(test_cipher_stream_buf_direct_read),
+    cmocka_unit_test(test_hash_context_reuse),
   };
   int ret = cmocka_run_group_tests(tests, NULL, NULL);
   return ret;
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "utils/test_setup.h"
+#include "util/CompressionTuner.hpp"
+#include <memory>
+
+using Snowflake::Client::Util::CompressionTuner;
+
+/**
+ * On a fast network the level gets lighter down to storing the data, and
+ * settles where compressing takes about as long as uploading.
+ */
+void test_compression_tuner_cpu_bound(void **unused)
+{
+  std::unique_ptr<CompressionTuner> tuner(CompressionTuner::create(false, -1));
+  assert_int_equal(tuner->getLevel(), 6);
+
+  // not enough measured yet
+  tuner->record(6, 200, 50);
+  assert_int_equal(tuner->getLevel(), 6);
+  tuner->record(6, 400, 100);
+  assert_int_equal(tuner->getLevel(), 3);
+
+  // files compressed at the level before are ignored
+  tuner->record(6, 1000, 10);
+  assert_int_equal(tuner->getLevel(), 3);
+  tuner->record(3, 800, 100);
+  assert_int_equal(tuner->getLevel(), 1);
+  tuner->record(1, 800, 100);
+  assert_int_equal(tuner->getLevel(), 0);
+  tuner->record(0, 800, 100);
+  assert_int_equal(tuner->getLevel(), 0);
+}
+
+/**
+ * On a slow network the level gets heavier, and a level left is not tried
+ * again.
+ */
+void test_compression_tuner_network_bound(void **unused)
+{
+  std::unique_ptr<CompressionTuner> tuner(CompressionTuner::create(true, 3));
+  assert_int_equal(tuner->getLevel(), 3);
+  tuner->record(3, 100, 1000);
+  assert_int_equal(tuner->getLevel(), 6);
+
+  // balanced, stays
+  tuner->record(6, 500, 500);
+  assert_int_equal(tuner->getLevel(), 6);
+
+  tuner->record(6, 100, 1000);
+  assert_int_equal(tuner->getLevel(), 9);
+  // too heavy, but 6 was too light, so it settles
+  tuner->record(9, 2000, 500);
+  assert_int_equal(tuner->getLevel(), 9);
+  tuner->record(9, 100, 1000);
+  assert_int_equal(tuner->getLevel(), 9);
+  tuner->record(9, 2000, 500);
+  assert_int_equal(tuner->getLevel(), 9);
+}
+
+/**
+ * The level to start with is the nearest of the levels tried.
+ */
+void test_compression_tuner_initial(void **unused)
+{
+  std::unique_ptr<CompressionTuner> gzip(CompressionTuner::create(false, 8));
+  assert_int_equal(gzip->getLevel(), 9);
+  std::unique_ptr<CompressionTuner> zstd(CompressionTuner::create(true, 19));
+  assert_int_equal(zstd->getLevel(), 15);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_compression_tuner_cpu_bound),
+    cmocka_unit_test(test_compression_tuner_network_bound),
+    cmocka_unit_test(test_compression_tuner_initial),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "utils/test_setup.h"
+#include "util/ConcurrencyTuner.hpp"
+#include <atomic>
+#include <thread>
+
+using Snowflake::Client::Util::ConcurrencyTuner;
+
+/**
+ * Throttling halves the limit at once, down to a single transfer, and the
+ * limit climbs again once a window of transfers was measured.
+ */
+void test_concurrency_tuner_throttled(void **unused)
+{
+  ConcurrencyTuner tuner(8, 64);
+  assert_int_equal(tuner.getLimit(), 8);
+
+  unsigned long long throttled = 0;
+  unsigned int expected[] = {4, 2, 1, 1};
+  for (unsigned int limit : expected)
+  {
+    tuner.acquire();
+    tuner.release(1000, ++throttled);
+    assert_int_equal(tuner.getLimit(), limit);
+  }
+
+  // no throttling, but the window isn't over yet
+  tuner.acquire();
+  tuner.release(1000, throttled);
+  assert_int_equal(tuner.getLimit(), 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  tuner.acquire();
+  tuner.release(1000, throttled);
+  assert_int_equal(tuner.getLimit(), 2);
+}
+
+/**
+ * No more transfers than the limit run at once.
+ */
+void test_concurrency_tuner_limit(void **unused)
+{
+  ConcurrencyTuner tuner(2, 4);
+  tuner.acquire();
+  tuner.acquire();
+
+  std::atomic<bool> started(false);
+  std::thread third([&]() {
+    tuner.acquire();
+    started = true;
+    tuner.release(0, 0);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  assert_false(started);
+  tuner.release(0, 0);
+  third.join();
+  assert_true(started);
+  tuner.release(0, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_concurrency_tuner_throttled),
+    cmocka_unit_test(test_concurrency_tuner_limit),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the stage credentials renewed in the background while files are
+ * transferred, before they expire
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+/**
+ * Answers the command with new credentials each time it is parsed
+ */
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(const std::string &srcLocation)
+    : IStatementPutGet(), m_numParseCalled(0)
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back(srcLocation);
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->stageInfo.credentials = {
+      {"AWS_TOKEN", (char *)TOKENS[std::min(m_numParseCalled.load(), 3)]}
+    };
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = false;
+    putGetParseResponse->parallel = 4;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+    m_numParseCalled++;
+    return true;
+  }
+
+  static const char *TOKENS[4];
+
+  std::atomic<int> m_numParseCalled;
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+const char *MockedStatementPut::TOKENS[4] = {"token0", "token1", "token2", "token3"};
+
+/**
+ * Uploads slowly, taking the renewed credentials in place if asked to
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient(bool inPlace) :
+    m_inPlace(inPlace), m_numRefreshed(0), m_token("token0")
+  {
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+  virtual bool refreshCredentials(StageInfo *stageInfo)
+  {
+    if (!m_inPlace)
+    {
+      return false;
+    }
+    m_token = stageInfo->credentials.at("AWS_TOKEN");
+    m_numRefreshed++;
+    return true;
+  }
+
+  bool m_inPlace;
+  std::atomic<int> m_numRefreshed;
+  std::string m_token;
+};
+
+/**
+ * Uploads a file taking 2.5 seconds with the credentials renewed every second
+ * @return times the command was parsed
+ */
+static int uploadSlowly(bool inPlace, int *numRefreshed, std::string *token)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string testDir = std::string(tmpDir) + "cred_refresh" + PATH_SEP;
+  sf_create_directory_if_not_exists(testDir.c_str());
+  {
+    std::ofstream ofs(testDir + "f.csv", std::ios::binary);
+    ofs << "1,2,3\n";
+  }
+
+  MockedStatementPut statement(testDir + "f.csv");
+  MockedStorageClient *client = new MockedStorageClient(inPlace);
+  StorageClientFactory::injectMockedClient(client);
+  TransferConfig config;
+  config.credentialRefreshSec = 1;
+  std::string cmd = "put file://" + testDir + "f.csv @odbctestStage";
+  Snowflake::Client::FileTransferAgent agent(&statement, &config);
+  ITransferResult *result = agent.execute(&cmd);
+
+  std::string put_status;
+  while (result->next())
+  {
+    result->getColumnAsString(6, put_status);
+    assert_string_equal("UPLOADED", put_status.c_str());
+  }
+  sf_delete_directory_if_exists(testDir.c_str());
+  // the client is released with the agent
+  *numRefreshed = client->m_numRefreshed;
+  *token = client->m_token;
+  return statement.m_numParseCalled;
+}
+
+/**
+ * The credentials are renewed every second the upload takes, without it
+ * finding them expired
+ */
+void test_cred_refresh_in_place(void **unused)
+{
+  int numRefreshed = 0;
+  std::string token;
+  int numParseCalled = uploadSlowly(true, &numRefreshed, &token);
+
+  assert_in_range(numRefreshed, 1, 2);
+  assert_int_equal(numParseCalled, 1 + numRefreshed);
+  assert_string_equal(token.c_str(), MockedStatementPut::TOKENS[numRefreshed]);
+}
+
+/**
+ * A client that can't take the credentials in place stops the renewals,
+ * they are renewed once they expire then
+ */
+void test_cred_refresh_not_in_place(void **unused)
+{
+  int numRefreshed = 0;
+  std::string token;
+  int numParseCalled = uploadSlowly(false, &numRefreshed, &token);
+
+  assert_int_equal(numParseCalled, 2);
+  assert_int_equal(numRefreshed, 0);
+  assert_string_equal(token.c_str(), "token0");
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_cred_refresh_in_place),
+    cmocka_unit_test(test_cred_refresh_not_in_place),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
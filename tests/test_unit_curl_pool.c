@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+#include "curl_pool.h"
+#include "connection.h"
+
+/**
+ * Tests that released handles are handed out again, up to the idle limit
+ */
+void test_curl_pool_reuse(void **unused) {
+    SF_CURL_POOL *pool = sf_curl_pool_create();
+    CURL *handles[SF_CURL_POOL_MAX_IDLE + 2];
+    CURL *curl;
+    size_t i;
+
+    assert_non_null(pool);
+    for (i = 0; i < SF_CURL_POOL_MAX_IDLE + 2; i++) {
+        handles[i] = sf_curl_pool_acquire(pool);
+        assert_non_null(handles[i]);
+    }
+    for (i = 0; i < SF_CURL_POOL_MAX_IDLE + 2; i++) {
+        sf_curl_pool_release(pool, handles[i]);
+    }
+    assert_int_equal(pool->idle_count, SF_CURL_POOL_MAX_IDLE);
+
+    // The last handle kept is the first one handed out
+    curl = sf_curl_pool_acquire(pool);
+    assert_ptr_equal(curl, handles[SF_CURL_POOL_MAX_IDLE - 1]);
+    sf_curl_pool_release(pool, curl);
+    sf_curl_pool_destroy(pool);
+
+    // Without a pool the handles are not kept
+    sf_curl_pool_release(NULL, sf_curl_pool_acquire(NULL));
+}
+
+/**
+ * Tests that a shared pool lives on until the last connection using it gives it up
+ */
+void test_curl_pool_share(void **unused) {
+    SF_CURL_POOL *pool = sf_curl_pool_create();
+    SF_CURL_POOL *shared;
+
+    assert_non_null(pool);
+    shared = sf_curl_pool_share(pool);
+    assert_ptr_equal(shared, pool);
+    sf_curl_pool_destroy(pool);
+    assert_int_equal(shared->refs, 1);
+    sf_curl_pool_release(shared, sf_curl_pool_acquire(shared));
+    assert_int_equal(shared->idle_count, 1);
+    sf_curl_pool_destroy(shared);
+
+    assert_null(sf_curl_pool_share(NULL));
+}
+
+/**
+ * Tests that the TTLs of the process wide share are kept and reset
+ */
+void test_curl_share_ttls(void **unused) {
+    int64 ttl = 300;
+    int64 max_age = 30;
+    int64 value = 0;
+    CURL *curl;
+
+    snowflake_global_set_attribute(SF_GLOBAL_DNS_CACHE_TTL, &ttl);
+    snowflake_global_set_attribute(SF_GLOBAL_CONNECTION_MAX_AGE, &max_age);
+    snowflake_global_get_attribute(SF_GLOBAL_DNS_CACHE_TTL, &value, sizeof(value));
+    assert_int_equal(value, 300);
+    snowflake_global_get_attribute(SF_GLOBAL_CONNECTION_MAX_AGE, &value, sizeof(value));
+    assert_int_equal(value, 30);
+
+    // Handles of every pool take the share with the TLS options
+    curl = sf_curl_pool_acquire(NULL);
+    assert_non_null(curl);
+    assert_true(set_curl_tls_options(curl, SF_BOOLEAN_TRUE));
+    sf_curl_pool_release(NULL, curl);
+
+    snowflake_global_set_attribute(SF_GLOBAL_DNS_CACHE_TTL, NULL);
+    snowflake_global_set_attribute(SF_GLOBAL_CONNECTION_MAX_AGE, NULL);
+    snowflake_global_get_attribute(SF_GLOBAL_DNS_CACHE_TTL, &value, sizeof(value));
+    assert_int_equal(value, SF_DEFAULT_DNS_CACHE_TTL);
+    snowflake_global_get_attribute(SF_GLOBAL_CONNECTION_MAX_AGE, &value, sizeof(value));
+    assert_int_equal(value, SF_DEFAULT_CONNECTION_MAX_AGE);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_curl_pool_reuse),
+      cmocka_unit_test(test_curl_pool_share),
+      cmocka_unit_test(test_curl_share_ttls),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the local digest cache of Put
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <cstdio>
+#include <fstream>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "util/DigestCache.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(const std::string &fileName)
+    : IStatementPutGet()
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back(fileName);
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = true;
+    putGetParseResponse->overwrite = false;
+    putGetParseResponse->parallel = 1;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    return true;
+  }
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+/**
+ * Counts the uploads. A file is on the stage once it was uploaded.
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient(int &uploads) : m_uploads(uploads)
+  {
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    m_uploads++;
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome checkFileExists(FileMetadata *fileMetadata)
+  {
+    return m_uploads > 0 ? SKIP_UPLOAD_FILE : SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+private:
+  int &m_uploads;
+};
+
+static std::string putStatus(const std::string &fileName, TransferConfig *config,
+                             int &uploads)
+{
+  StorageClientFactory::injectMockedClient(new MockedStorageClient(uploads));
+  std::string cmd = "put file://" + fileName + " @odbctestStage";
+  MockedStatementPut mockedStatementPut(fileName);
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut, config);
+  ITransferResult * result = agent.execute(&cmd);
+
+  std::string status;
+  assert_true(result->next());
+  result->getColumnAsString(6, status);
+  return status;
+}
+
+/**
+ * A file already uploaded is skipped without being compressed again.
+ */
+void test_digest_cache_skip(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string fileName = std::string(tmpDir) + "digest_cache_test.csv";
+  std::string cacheFile = std::string(tmpDir) + "digest_cache_test.cache";
+  remove(cacheFile.c_str());
+  {
+    std::ofstream file(fileName.c_str());
+    file << "1,2,3\n4,5,6\n";
+  }
+
+  TransferConfig config;
+  config.digestCacheFile = (char *)cacheFile.c_str();
+  int uploads = 0;
+  assert_string_equal(putStatus(fileName, &config, uploads).c_str(), "UPLOADED");
+  assert_int_equal(uploads, 1);
+
+  Util::DigestCache cache(cacheFile);
+  Util::DigestCache::Entry entry;
+  assert_true(cache.lookup(fileName, "gzip:-1:1", entry));
+  assert_int_equal(entry.size, 12);
+  assert_int_equal(entry.digest.size(), 44);
+  assert_false(cache.lookup(fileName, "zstd:-1:1", entry));
+
+  assert_string_equal(putStatus(fileName, &config, uploads).c_str(), "SKIPPED");
+  assert_int_equal(uploads, 1);
+
+  // a file that changed is missed
+  {
+    std::ofstream file(fileName.c_str(), std::ios_base::app);
+    file << "7,8,9\n";
+  }
+  assert_false(cache.lookup(fileName, "gzip:-1:1", entry));
+
+  remove(fileName.c_str());
+  remove(cacheFile.c_str());
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_digest_cache_skip),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
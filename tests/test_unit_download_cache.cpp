@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the local cache of the files downloaded by Get
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "util/DownloadCache.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::Util::DownloadCache;
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+  std::ofstream file(path.c_str(), std::ios_base::out | std::ios_base::binary);
+  file << data;
+}
+
+static std::string readFile(const std::string &path)
+{
+  std::ifstream file(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+/**
+ * A file stored in the cache is fetched back while its stage path, size and
+ * version are the same, over the file already at the destination.
+ */
+void test_download_cache_hit(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string cacheDir = std::string(tmpDir) + "download_cache_test";
+  std::string downloaded = std::string(tmpDir) + "download_cache_test_file.csv";
+  std::string fetched = std::string(tmpDir) + "download_cache_test_fetched.csv";
+  DownloadCache cache(cacheDir);
+
+  std::string cachedPath = cache.getCachedPath("stage/dir/file.csv", 100, "\"etag1\"");
+  assert_false(cachedPath.empty());
+  remove(cachedPath.c_str());
+  assert_false(cache.fetch(cachedPath, fetched));
+
+  writeFile(downloaded, "1,2,3\n");
+  assert_true(cache.store(cachedPath, downloaded));
+  writeFile(fetched, "stale\n");
+  assert_true(cache.fetch(cachedPath, fetched));
+  assert_true(readFile(fetched) == "1,2,3\n");
+
+  // another version, size or path of the file is another entry
+  assert_true(cache.getCachedPath("stage/dir/file.csv", 100, "\"etag2\"") != cachedPath);
+  assert_true(cache.getCachedPath("stage/dir/file.csv", 101, "\"etag1\"") != cachedPath);
+  assert_true(cache.getCachedPath("stage/dir/file2.csv", 100, "\"etag1\"") != cachedPath);
+  assert_true(cache.getCachedPath("stage/dir/file.csv", 100, "\"etag1\"") == cachedPath);
+
+  // without a version the file can't be told unchanged
+  assert_true(cache.getCachedPath("stage/dir/file.csv", 100, "").empty());
+
+  remove(fetched.c_str());
+  remove(downloaded.c_str());
+  remove(cachedPath.c_str());
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_download_cache_hit),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
@@ -141,6 +141,52 @@ void test_file_pattern_match(void **unused)
 
 }
 
+/**
+ * Many files are initialized in parallel and come back in the order of the
+ * directory listing, with their compression type detected.
+ */
+void test_file_metadata_init_parallel(void **unused)
+{
+  std::string testDir = getTestFileMatchDir() + "parallel" + PATH_SEP;
+  assert_int_equal(0, sf_create_directory_if_not_exists(testDir.c_str()));
+  const int numFiles = 300;
+  for (int i = 0; i < numFiles; i++)
+  {
+    std::ofstream ofs(testDir + "file" + std::to_string(i), std::ios::binary);
+    // every third file is gzipped
+    ofs << (i % 3 ? "1,2,3" : "\x1f\x8b\x08");
+  }
+
+  std::vector<std::string> serialFiles;
+  for (unsigned int parallel : {1u, 8u})
+  {
+    std::vector<FileMetadata> smallFileMetadata;
+    std::vector<FileMetadata> largeFileMetadata;
+    FileMetadataInitializer initializer(smallFileMetadata, largeFileMetadata);
+    initializer.setSourceCompression((char *)"auto_detect");
+    initializer.setParallel(parallel);
+
+    std::string pattern = testDir + "file*";
+    initializer.populateSrcLocUploadMetadata(pattern, DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD);
+    assert_int_equal(smallFileMetadata.size(), numFiles);
+
+    std::vector<std::string> files;
+    for (auto i = smallFileMetadata.begin(); i != smallFileMetadata.end(); i++)
+    {
+      int index = std::stoi(i->destFileName.substr(4));
+      assert_true(i->sourceCompression == (index % 3 ?
+        &FileCompressionType::NONE : &FileCompressionType::GZIP));
+      assert_int_equal(i->srcFileSize, index % 3 ? 5 : 3);
+      files.push_back(i->srcFileName);
+    }
+    if (parallel == 1)
+    {
+      serialFiles = files;
+    }
+    assert_true(files == serialFiles);
+  }
+}
+
 static int gr_setup(void **unused)
 {
   initialize_test(SF_BOOLEAN_FALSE);
@@ -158,6 +204,9 @@ int main(void) {
     cmocka_unit_test_setup_teardown(test_file_pattern_match,
                                     file_pattern_match_setup,
                                     file_pattern_match_teardown),
+    cmocka_unit_test_setup_teardown(test_file_metadata_init_parallel,
+                                    file_pattern_match_setup,
+                                    file_pattern_match_teardown),
   };
   int ret = cmocka_run_group_tests(tests, gr_setup, gr_teardown);
   return ret;
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include "snowflake/IStatementPutGet.hpp"
+#include "SnowflakeGCSClient.hpp"
+#include "FileMetadataInitializer.hpp"
+#include "cJSON.h"
+#include "utils/test_setup.h"
+
+using namespace Snowflake::Client;
+
+static const size_t THRESHOLD = 1024 * 1024;
+
+static char accessToken[] = "ya29.token";
+
+/**
+ * Keeps the components put until they are deleted, and the compose request.
+ */
+class MockedComposeStatement : public IStatementPutGet
+{
+public:
+  MockedComposeStatement(bool failPost) :
+    m_failPost(failPost), m_failedOnce(false)
+  {
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    return false;
+  }
+
+  virtual bool http_put(std::string const& url,
+                        std::vector<std::string> const& headers,
+                        std::basic_iostream<char>& payload,
+                        size_t payloadLen,
+                        std::string& responseHeaders)
+  {
+    std::string data(payloadLen, '\0');
+    payload.read(&data[0], payloadLen);
+    std::lock_guard<std::mutex> guard(m_mutex);
+    assert_string_equal(headers[0].c_str(), "Authorization: Bearer ya29.token");
+    // the second component fails once and is put again on its own
+    if (!m_failedOnce && url.find("_1") == url.size() - 2)
+    {
+      m_failedOnce = true;
+      return false;
+    }
+    m_objects[url] = data;
+    m_puts[url] = data;
+    return true;
+  }
+
+  virtual bool http_post(std::string const& url,
+                         std::vector<std::string> const& headers,
+                         std::string const& body,
+                         std::string& responseHeaders,
+                         std::string& responseBody)
+  {
+    m_composeUrl = url;
+    m_composeBody = body;
+    return !m_failPost;
+  }
+
+  virtual bool http_delete(std::string const& url,
+                           std::vector<std::string> const& headers)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_objects.erase(url) == 1;
+  }
+
+  bool m_failPost;
+
+  bool m_failedOnce;
+
+  std::mutex m_mutex;
+
+  /// objects of the bucket by url
+  std::map<std::string, std::string> m_objects;
+
+  /// data put by url, kept once deleted
+  std::map<std::string, std::string> m_puts;
+
+  std::string m_composeUrl;
+
+  std::string m_composeBody;
+};
+
+static void initStageInfo(StageInfo &stageInfo)
+{
+  stageInfo.stageType = StageType::GCS;
+  stageInfo.location = "bucket/stage dir/";
+  stageInfo.credentials["GCS_ACCESS_TOKEN"] = accessToken;
+}
+
+static void initMetadata(FileMetadata &metadata, size_t size)
+{
+  metadata.srcFileToUpload = "/tmp/large.csv.gz";
+  metadata.destFileName = "large.csv.gz";
+  metadata.sha256Digest = "digest";
+  metadata.encryptionMetadata.cipherStreamSize = (long long)size;
+  metadata.encryptionMetadata.enKekEncoded = "kek";
+  metadata.encryptionMetadata.matDesc = "{\"queryId\":\"1\"}";
+  memset(metadata.encryptionMetadata.iv.data, 7,
+         sizeof(metadata.encryptionMetadata.iv.data));
+}
+
+static std::string makeData(size_t size)
+{
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++)
+  {
+    data[i] = (char)(i * 31 + i / 4096);
+  }
+  return data;
+}
+
+/**
+ * The components are put at once, composed in order with the metadata of
+ * the file and deleted.
+ */
+void test_gcs_composite_upload(void **unused)
+{
+  std::string data = makeData(3 * THRESHOLD + 12345);
+  MockedComposeStatement statement(false);
+  StageInfo stageInfo;
+  initStageInfo(stageInfo);
+  TransferConfig config;
+  config.composeGcsUploads = true;
+  SnowflakeGCSClient client(&stageInfo, 4, THRESHOLD, &config, &statement);
+  client.setMaxRetries(1);
+
+  FileMetadata metadata;
+  initMetadata(metadata, data.size());
+  std::stringstream input(data);
+  assert_int_equal(client.upload(&metadata, &input),
+                   RemoteStorageRequestOutcome::SUCCESS);
+  assert_int_equal(metadata.metrics.parts, 4);
+  assert_int_equal(metadata.metrics.retries, 1);
+  assert_string_equal(statement.m_composeUrl.c_str(),
+    "https://storage.googleapis.com/storage/v1/b/bucket/o/"
+    "stage%20dir%2Flarge.csv.gz/compose");
+
+  cJSON *body = snowflake_cJSON_Parse(statement.m_composeBody.c_str());
+  cJSON *sources = snowflake_cJSON_GetObjectItem(body, "sourceObjects");
+  assert_int_equal(snowflake_cJSON_GetArraySize(sources), 4);
+  const std::string dir = "stage dir/";
+  std::string composed;
+  for (int i = 0; i < 4; i++)
+  {
+    std::string name = snowflake_cJSON_GetObjectItem(
+      snowflake_cJSON_GetArrayItem(sources, i), "name")->valuestring;
+    assert_int_equal(name.find(dir + "large.csv.gz.sfc_component_"), 0);
+    assert_string_equal(name.substr(name.rfind('_')).c_str(),
+                        ("_" + std::to_string(i)).c_str());
+    composed += statement.m_puts[
+      "https://storage.googleapis.com/bucket/stage%20dir/" + name.substr(dir.size())];
+  }
+  assert_true(composed == data);
+  assert_true(statement.m_objects.empty());
+
+  cJSON *fileMetadata = snowflake_cJSON_GetObjectItem(
+    snowflake_cJSON_GetObjectItem(body, "destination"), "metadata");
+  assert_string_equal(
+    snowflake_cJSON_GetObjectItem(fileMetadata, "sfc-digest")->valuestring, "digest");
+  assert_string_equal(
+    snowflake_cJSON_GetObjectItem(fileMetadata, "matdesc")->valuestring,
+    "{\"queryId\":\"1\"}");
+  assert_non_null(strstr(
+    snowflake_cJSON_GetObjectItem(fileMetadata, "encryptiondata")->valuestring,
+    "\"EncryptedKey\":\"kek\""));
+  snowflake_cJSON_Delete(body);
+}
+
+/**
+ * A failed compose fails the file, the components are deleted anyway.
+ */
+void test_gcs_composite_upload_compose_failed(void **unused)
+{
+  std::string data = makeData(2 * THRESHOLD + 1);
+  MockedComposeStatement statement(true);
+  StageInfo stageInfo;
+  initStageInfo(stageInfo);
+  TransferConfig config;
+  config.composeGcsUploads = true;
+  SnowflakeGCSClient client(&stageInfo, 4, THRESHOLD, &config, &statement);
+  client.setMaxRetries(1);
+
+  FileMetadata metadata;
+  initMetadata(metadata, data.size());
+  std::stringstream input(data);
+  assert_int_equal(client.upload(&metadata, &input),
+                   RemoteStorageRequestOutcome::FAILED);
+  assert_false(statement.m_composeBody.empty());
+  assert_true(statement.m_objects.empty());
+}
+
+/**
+ * The file is composed from 32 components at most.
+ */
+void test_gcs_component_size(void **unused)
+{
+  assert_int_equal(SnowflakeGCSClient::chooseComponentSize(100 * THRESHOLD, 64 * THRESHOLD),
+                   64 * THRESHOLD);
+  assert_int_equal(SnowflakeGCSClient::chooseComponentSize(3100LL * THRESHOLD, THRESHOLD),
+                   101 * THRESHOLD);
+  assert_int_equal(SnowflakeGCSClient::chooseComponentSize(10, 100), THRESHOLD);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_gcs_composite_upload),
+    cmocka_unit_test(test_gcs_composite_upload_compose_failed),
+    cmocka_unit_test(test_gcs_component_size),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
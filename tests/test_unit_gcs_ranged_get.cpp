@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <sstream>
+#include <string>
+#include "snowflake/IStatementPutGet.hpp"
+#include "SnowflakeGCSClient.hpp"
+#include "FileMetadataInitializer.hpp"
+#include "utils/test_setup.h"
+
+using namespace Snowflake::Client;
+
+/**
+ * Serves an object over GET, honoring the Range header unless told not to.
+ */
+class MockedRangeStatement : public IStatementPutGet
+{
+public:
+  MockedRangeStatement(const std::string &object, bool honorRange) :
+    m_object(object), m_honorRange(honorRange)
+  {
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    return false;
+  }
+
+  virtual bool http_get(std::string const& url,
+                        std::vector<std::string> const& headers,
+                        std::basic_iostream<char>* payload,
+                        std::string& responseHeaders,
+                        bool headerOnly)
+  {
+    size_t first = 0;
+    size_t last = m_object.size() - 1;
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+      if (m_honorRange &&
+          sscanf(headers[i].c_str(), "Range: bytes=%zu-%zu", &first, &last) != 2)
+      {
+        return false;
+      }
+    }
+    payload->write(m_object.data() + first, last - first + 1);
+    return true;
+  }
+
+private:
+  std::string m_object;
+
+  bool m_honorRange;
+};
+
+static std::string makeObject(size_t size)
+{
+  std::string object(size, '\0');
+  for (size_t i = 0; i < size; i++)
+  {
+    object[i] = (char)(i * 31 + i / 4096);
+  }
+  return object;
+}
+
+/**
+ * An object of a few parts, the last one short, comes back whole and in order.
+ */
+void test_gcs_ranged_get(void **unused)
+{
+  std::string object = makeObject(3 * DOWNLOAD_DATA_SIZE_THRESHOLD + 12345);
+  MockedRangeStatement statement(object, true);
+  SnowflakeGCSClient client(NULL, 4, 0, NULL, &statement);
+
+  FileMetadata metadata;
+  metadata.srcFileSize = (long)object.size();
+  std::stringstream output;
+  assert_int_equal(client.download(&metadata, &output),
+                   RemoteStorageRequestOutcome::SUCCESS);
+  assert_true(output.str() == object);
+}
+
+/**
+ * A server sending the whole object for a ranged request fails the download.
+ */
+void test_gcs_ranged_get_ignored(void **unused)
+{
+  std::string object = makeObject(2 * DOWNLOAD_DATA_SIZE_THRESHOLD + 1);
+  MockedRangeStatement statement(object, false);
+  SnowflakeGCSClient client(NULL, 4, 0, NULL, &statement);
+
+  FileMetadata metadata;
+  metadata.srcFileSize = (long)object.size();
+  std::stringstream output;
+  assert_int_equal(client.download(&metadata, &output),
+                   RemoteStorageRequestOutcome::FAILED);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_gcs_ranged_get),
+    cmocka_unit_test(test_gcs_ranged_get_ignored),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the metadata lookups of Get running while the files download
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "util/Base64.hpp"
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "utils/test_setup.h"
+
+using namespace ::Snowflake::Client;
+
+static const int NUM_FILES = 8;
+
+class MockedStatementGet : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementGet()
+    : Snowflake::Client::IStatementPutGet()
+  {
+    m_stageInfo.stageType = Snowflake::Client::StageType::MOCKED_STAGE_TYPE;
+    m_stageInfo.location = "stage/";
+    for (int i = 0; i < NUM_FILES; i++)
+    {
+      m_encryptionMaterial.emplace_back(
+        (char *)"dvkZi0dkBfrcHr6YxXLRFg==\0",
+        (char *)"1234\0",
+        1234
+      );
+      m_srcLocations.push_back("lookup_test_" + std::to_string(i) + ".csv");
+    }
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::DOWNLOAD;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->autoCompress = false;
+    putGetParseResponse->parallel = 4;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+    putGetParseResponse->localLocation = (char *)"/tmp\0";
+
+    return true;
+  }
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+/**
+ * Takes a while to look up each file. The second file isn't on the stage,
+ * the third one is large.
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient() :
+    m_lookups(0),
+    m_runningLookups(0),
+    m_maxRunningLookups(0),
+    m_lookupsBeforeFirstDownload(-1)
+  {
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_maxRunningLookups = std::max(m_maxRunningLookups, ++m_runningLookups);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_runningLookups--;
+    m_lookups++;
+    if (*filePathFull == "stage/lookup_test_1.csv")
+    {
+      return FAILED;
+    }
+    std::string iv = "ZxQiil366wJ+QqrhDKckBQ==";
+    Snowflake::Client::Util::Base64::decode(iv.c_str(), iv.size(), fileMetadata->
+      encryptionMetadata.iv.data);
+    fileMetadata->encryptionMetadata.enKekEncoded = "rgANWKrHN14aKoHRxoIh9GtjXYScNdjseX4kmLZRnEc=";
+    fileMetadata->srcFileSize = *filePathFull == "stage/lookup_test_2.csv" ?
+      DOWNLOAD_DATA_SIZE_THRESHOLD + 1 : 10;
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_lookupsBeforeFirstDownload < 0)
+    {
+      m_lookupsBeforeFirstDownload = m_lookups;
+    }
+    m_downloaded.insert(fileMetadata->srcFileName);
+    return SUCCESS;
+  }
+
+  std::mutex m_mutex;
+
+  int m_lookups;
+
+  int m_runningLookups;
+
+  int m_maxRunningLookups;
+
+  int m_lookupsBeforeFirstDownload;
+
+  std::set<std::string> m_downloaded;
+};
+
+/**
+ * The files are looked up at once, each downloaded once it is known, and
+ * those not found are left out of the results.
+ */
+void test_get_metadata_lookup_parallel(void **unused)
+{
+  MockedStorageClient * client = new MockedStorageClient();
+  StorageClientFactory::injectMockedClient(client);
+
+  std::string cmd = "fake get command";
+  MockedStatementGet mockedStatementGet;
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementGet);
+  ITransferResult * result = agent.execute(&cmd);
+
+  assert_int_equal(result->getResultSize(), NUM_FILES - 1);
+  std::string file;
+  std::string get_status;
+  while (result->next())
+  {
+    result->getColumnAsString(0, file);
+    result->getColumnAsString(2, get_status);
+    assert_string_equal("DOWNLOADED", get_status.c_str());
+    assert_string_not_equal("lookup_test_1.csv", file.c_str());
+  }
+
+  assert_int_equal(client->m_lookups, NUM_FILES);
+  assert_true(client->m_maxRunningLookups > 1);
+  assert_true(client->m_lookupsBeforeFirstDownload < NUM_FILES);
+  assert_int_equal(client->m_downloaded.size(), NUM_FILES - 1);
+  assert_true(client->m_downloaded.count("stage/lookup_test_2.csv") == 1);
+
+  for (int i = 0; i < NUM_FILES; i++)
+  {
+    std::remove(("/tmp/lookup_test_" + std::to_string(i) + ".csv").c_str());
+  }
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_get_metadata_lookup_parallel),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
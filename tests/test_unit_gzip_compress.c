@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include <zlib.h>
+#include "utils/test_setup.h"
+#include "connection.h"
+#include "memory.h"
+
+/**
+ * Tests that a compressed request body inflates back to the original
+ */
+void test_gzip_compress_round_trip(void **unused) {
+    char body[8192];
+    char inflated[sizeof(body)];
+    char *compressed = NULL;
+    size_t compressed_len = 0;
+    z_stream strm;
+    size_t i;
+
+    for (i = 0; i < sizeof(body) - 1; i++) {
+        body[i] = "SELECT ?, ?;"[i % 12];
+    }
+    body[sizeof(body) - 1] = '\0';
+
+    assert_true(gzip_compress(body, strlen(body), &compressed, &compressed_len));
+    assert_non_null(compressed);
+    assert_true(compressed_len < strlen(body));
+    // gzip magic number
+    assert_int_equal((unsigned char) compressed[0], 0x1f);
+    assert_int_equal((unsigned char) compressed[1], 0x8b);
+
+    memset(&strm, 0, sizeof(strm));
+    assert_int_equal(inflateInit2(&strm, 15 + 16), Z_OK);
+    strm.next_in = (Bytef *) compressed;
+    strm.avail_in = (uInt) compressed_len;
+    strm.next_out = (Bytef *) inflated;
+    strm.avail_out = sizeof(inflated);
+    assert_int_equal(inflate(&strm, Z_FINISH), Z_STREAM_END);
+    assert_int_equal(strm.total_out, strlen(body));
+    inflateEnd(&strm);
+    assert_memory_equal(inflated, body, strlen(body));
+
+    SF_FREE(compressed);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_gzip_compress_round_trip),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "hex.h"
+
+#define MAX_LEN 200
+
+static void fill(unsigned char *bytes, size_t len, unsigned int seed) {
+    size_t i;
+    for (i = 0; i < len; i++) {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = (unsigned char) (seed >> 16);
+    }
+}
+
+/**
+ * Tests that every length, so every mix of vector blocks and scalar tail, encodes as %02X
+ * does and decodes back
+ */
+void test_hex_round_trip(void **unused) {
+    unsigned char bytes[MAX_LEN];
+    unsigned char decoded[MAX_LEN];
+    char text[MAX_LEN * 2 + 1];
+    char expected[MAX_LEN * 2 + 1];
+    size_t len;
+    size_t i;
+
+    for (len = 0; len <= MAX_LEN; len++) {
+        fill(bytes, len, (unsigned int) len);
+        for (i = 0; i < len; i++) {
+            sprintf(expected + i * 2, "%02X", bytes[i]);
+        }
+        expected[len * 2] = '\0';
+        sf_hex_encode(text, bytes, len);
+        text[len * 2] = '\0';
+        assert_string_equal(text, expected);
+
+        memset(decoded, 0, sizeof(decoded));
+        assert_true(sf_hex_decode(decoded, text, len));
+        assert_memory_equal(decoded, bytes, len);
+    }
+}
+
+/**
+ * Tests that lower case digits are decoded and any other character is rejected wherever
+ * it is
+ */
+void test_hex_decode_invalid(void **unused) {
+    static const char bad[] = {'G', 'g', '/', ':', '@', '`', ' ', '\0', (char) 0xC1};
+    unsigned char bytes[MAX_LEN];
+    unsigned char decoded[MAX_LEN];
+    char text[MAX_LEN * 2 + 1];
+    size_t i;
+    size_t b;
+
+    fill(bytes, MAX_LEN, 7);
+    for (i = 0; i < MAX_LEN; i++) {
+        sprintf(text + i * 2, "%02x", bytes[i]);
+    }
+    assert_true(sf_hex_decode(decoded, text, MAX_LEN));
+    assert_memory_equal(decoded, bytes, MAX_LEN);
+
+    for (i = 0; i < MAX_LEN * 2; i++) {
+        char digit = text[i];
+        for (b = 0; b < sizeof(bad); b++) {
+            text[i] = bad[b];
+            assert_false(sf_hex_decode(decoded, text, MAX_LEN));
+        }
+        text[i] = digit;
+    }
+    assert_int_equal(sf_hex_digit('f'), 15);
+    assert_int_equal(sf_hex_digit('G'), -1);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_hex_round_trip),
+      cmocka_unit_test(test_hex_decode_invalid),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "json_path.h"
+
+static const char *VARIANT =
+  "{\n"
+  "  \"skipped\": {\"a\": [1, \"]}\\\"\", {\"b\": null}]},\n"
+  "  \"a\": {\n"
+  "    \"b\": [10, \"x\", [], {\"c\": \"d\\u00e9\\n\"}],\n"
+  "    \"key.with.dots\": true,\n"
+  "    \"n\\u0061me\": -1.5e3\n"
+  "  }\n"
+  "}";
+
+static SF_JSON_VALUE_TYPE find(const char *path, char *value) {
+    SF_JSON_VALUE_TYPE type;
+    const char *text;
+    size_t len;
+
+    assert_int_equal(sf_json_path_find(VARIANT, strlen(VARIANT), path, &type, &text, &len),
+                     SF_STATUS_SUCCESS);
+    memcpy(value, text ? text : "", len);
+    value[len] = '\0';
+    return type;
+}
+
+/**
+ * Tests that the values along a path are found, skipping over the members before them
+ */
+void test_json_path_find(void **unused) {
+    char value[256];
+    size_t len;
+
+    assert_int_equal(find("a.b[0]", value), SF_JSON_VALUE_NUMBER);
+    assert_string_equal(value, "10");
+    assert_int_equal(find("a.b[1]", value), SF_JSON_VALUE_STRING);
+    assert_string_equal(value, "x");
+    assert_int_equal(find("a.b[2]", value), SF_JSON_VALUE_ARRAY);
+    assert_string_equal(value, "[]");
+    assert_int_equal(find("a.b[3].c", value), SF_JSON_VALUE_STRING);
+    assert_string_equal(value, "d\\u00e9\\n");
+    assert_true(sf_json_unescape(value, strlen(value), value, &len));
+    assert_string_equal(value, "d\xc3\xa9\n");
+    assert_int_equal(len, 4);
+    assert_int_equal(find("a[\"key.with.dots\"]", value), SF_JSON_VALUE_BOOLEAN);
+    assert_string_equal(value, "true");
+    assert_int_equal(find("a.name", value), SF_JSON_VALUE_NUMBER);
+    assert_string_equal(value, "-1.5e3");
+    assert_int_equal(find("skipped.a[2].b", value), SF_JSON_VALUE_NULL);
+    assert_int_equal(find("skipped.a[1]", value), SF_JSON_VALUE_STRING);
+    assert_string_equal(value, "]}\\\"");
+    assert_int_equal(find("a.b[3]", value), SF_JSON_VALUE_OBJECT);
+    assert_string_equal(value, "{\"c\": \"d\\u00e9\\n\"}");
+    assert_int_equal(find("", value), SF_JSON_VALUE_OBJECT);
+    assert_string_equal(value, VARIANT);
+
+    // Paths that aren't in the value
+    assert_int_equal(find("a.b[4]", value), SF_JSON_VALUE_NONE);
+    assert_int_equal(find("a.c", value), SF_JSON_VALUE_NONE);
+    assert_int_equal(find("a.b.c", value), SF_JSON_VALUE_NONE);
+    assert_int_equal(find("a[0]", value), SF_JSON_VALUE_NONE);
+    assert_int_equal(find("a.b[0].c[1]", value), SF_JSON_VALUE_NONE);
+}
+
+/**
+ * Tests that malformed paths and text are reported
+ */
+void test_json_path_invalid(void **unused) {
+    SF_JSON_VALUE_TYPE type;
+    const char *text;
+    size_t len;
+    char out[16];
+
+    assert_int_equal(sf_json_path_find(VARIANT, strlen(VARIANT), "a..b", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_REQUEST);
+    assert_int_equal(sf_json_path_find(VARIANT, strlen(VARIANT), "a[x]", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_REQUEST);
+    assert_int_equal(sf_json_path_find(VARIANT, strlen(VARIANT), "a[\"b]", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_REQUEST);
+    assert_int_equal(sf_json_path_find(VARIANT, strlen(VARIANT), "c.d[", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_REQUEST);
+    assert_int_equal(sf_json_path_find("{\"a\": [1, 2", 11, "a[3]", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_JSON);
+    assert_int_equal(sf_json_path_find("{\"a\" 1}", 7, "a", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_JSON);
+    assert_int_equal(sf_json_path_find("{\"a\": x}", 8, "a", &type, &text, &len),
+                     SF_STATUS_ERROR_BAD_JSON);
+    assert_false(sf_json_unescape("\\ud83d", 6, out, &len));
+    assert_false(sf_json_unescape("\\q", 2, out, &len));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_json_path_find),
+      cmocka_unit_test(test_json_path_invalid),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
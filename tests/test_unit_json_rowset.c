@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "json_rowset.h"
+#include "memory.h"
+
+static SF_JSON_ROWSET *parse(const char *text) {
+    size_t len = strlen(text);
+    char *buffer = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, len + 1);
+    memcpy(buffer, text, len + 1);
+    return sf_json_rowset_parse(buffer, len, len + 1, SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+}
+
+static const char *cell_value(SF_JSON_ROWSET *rowset, size_t row, size_t col) {
+    SF_JSON_CELL *cell = &rowset->cells[row * rowset->column_count + col];
+    return cell->is_null ? NULL : &rowset->buffer[cell->offset];
+}
+
+/**
+ * Tests that cells are unescaped in place and nulls are kept apart from empty strings
+ */
+void test_json_rowset_parse(void **unused) {
+    SF_JSON_ROWSET *rowset = parse(
+      "[[\"1\", null, \"a\\\"b\\\\c\"],\n"
+      " [\"\", \"\\u00e9\\ud83d\\ude00\\n\", null]]");
+    assert_non_null(rowset);
+    assert_int_equal(rowset->row_count, 2);
+    assert_int_equal(rowset->column_count, 3);
+
+    assert_string_equal(cell_value(rowset, 0, 0), "1");
+    assert_null(cell_value(rowset, 0, 1));
+    assert_string_equal(cell_value(rowset, 0, 2), "a\"b\\c");
+    assert_int_equal(rowset->cells[2].len, 5);
+    assert_string_equal(cell_value(rowset, 1, 0), "");
+    assert_string_equal(cell_value(rowset, 1, 1), "\xc3\xa9\xf0\x9f\x98\x80\n");
+    assert_null(cell_value(rowset, 1, 2));
+    sf_json_rowset_free(rowset);
+
+    rowset = parse("[]");
+    assert_non_null(rowset);
+    assert_int_equal(rowset->row_count, 0);
+    sf_json_rowset_free(rowset);
+
+    rowset = parse("[[-1.5e+3, 0, 12E-2, true]]");
+    assert_non_null(rowset);
+    assert_string_equal(cell_value(rowset, 0, 0), "-1.5e+3");
+    assert_string_equal(cell_value(rowset, 0, 1), "0");
+    assert_string_equal(cell_value(rowset, 0, 2), "12E-2");
+    assert_string_equal(cell_value(rowset, 0, 3), "true");
+    sf_json_rowset_free(rowset);
+}
+
+/**
+ * Tests that malformed rowsets are rejected
+ */
+void test_json_rowset_invalid(void **unused) {
+    assert_null(parse("[[\"a\"], [\"a\", \"b\"]]"));
+    assert_null(parse("[[\"a\"]"));
+    assert_null(parse("[[\"a\"]] x"));
+    assert_null(parse("[[\"a]]"));
+    assert_null(parse("[[{}]]"));
+    assert_null(parse("[[\"\\ud83d\"]]"));
+    assert_null(parse("[[1-2.5]]"));
+    assert_null(parse("[[--1]]"));
+    assert_null(parse("[[01]]"));
+    assert_null(parse("[[1.]]"));
+    assert_null(parse("[[1e]]"));
+    assert_null(parse("[[-]]"));
+    // The buffers of rejected rowsets are freed
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD), 0);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET), 0);
+}
+
+/**
+ * Tests that a rowset parsed by cJSON is copied cell by cell
+ */
+void test_json_rowset_from_cjson(void **unused) {
+    cJSON *rows = snowflake_cJSON_Parse("[[\"a\", null], [\"\", \"bc\"]]");
+    SF_JSON_ROWSET *rowset = sf_json_rowset_from_cjson(rows);
+    assert_non_null(rowset);
+    assert_int_equal(rowset->row_count, 2);
+    assert_int_equal(rowset->column_count, 2);
+    assert_string_equal(cell_value(rowset, 0, 0), "a");
+    assert_null(cell_value(rowset, 0, 1));
+    assert_string_equal(cell_value(rowset, 1, 0), "");
+    assert_string_equal(cell_value(rowset, 1, 1), "bc");
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET),
+                     rowset->buffer_capacity + 4 * sizeof(SF_JSON_CELL));
+    sf_json_rowset_free(rowset);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET), 0);
+    snowflake_cJSON_Delete(rows);
+}
+
+/**
+ * Tests that the rows of a query response are left out of the parsed tree, and only them
+ */
+void test_json_parse_without_rowset(void **unused) {
+    const char *text =
+      "{\"code\": null, \"data\": {\"parameters\": [{\"name\": \"rowset\"}],\n"
+      " \"rowset\": [[\"1\", \"]}\\\"\"], [null, \"{\"]], \"total\": 2,\n"
+      " \"queryId\": \"abc\"}, \"success\": true}";
+    cJSON *json = sf_json_parse_without_rowset(text, strlen(text));
+    cJSON *data;
+    assert_non_null(json);
+    data = snowflake_cJSON_GetObjectItem(json, "data");
+    assert_true(snowflake_cJSON_IsNull(snowflake_cJSON_GetObjectItem(data, "rowset")));
+    assert_int_equal(snowflake_cJSON_GetObjectItem(data, "total")->valueint, 2);
+    assert_string_equal(snowflake_cJSON_GetObjectItem(data, "queryId")->valuestring, "abc");
+    assert_string_equal(snowflake_cJSON_GetObjectItem(
+      snowflake_cJSON_GetArrayItem(snowflake_cJSON_GetObjectItem(data, "parameters"), 0),
+      "name")->valuestring, "rowset");
+    assert_true(snowflake_cJSON_IsTrue(snowflake_cJSON_GetObjectItem(json, "success")));
+    snowflake_cJSON_Delete(json);
+
+    // Without rows the response is parsed as is
+    json = sf_json_parse_without_rowset("{\"success\": false}", 18);
+    assert_non_null(json);
+    snowflake_cJSON_Delete(json);
+    assert_null(sf_json_parse_without_rowset("{\"data\": {\"rowset\": [[}", 23));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_json_rowset_parse),
+      cmocka_unit_test(test_json_rowset_invalid),
+      cmocka_unit_test(test_json_rowset_from_cjson),
+      cmocka_unit_test(test_json_parse_without_rowset),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "json_writer.h"
+#include "connection.h"
+#include "memory.h"
+
+/**
+ * Tests that members are separated and strings are escaped
+ */
+void test_json_writer_object(void **unused) {
+    SF_JSON_WRITER writer;
+    char *text;
+
+    // A tiny buffer makes the writer grow a few times
+    sf_json_writer_init(&writer, 4);
+    sf_json_writer_begin_object(&writer);
+    sf_json_writer_key(&writer, "sqlText");
+    sf_json_writer_string(&writer, "select \"a\\b\"\n\x01\xc3\xa9");
+    sf_json_writer_key(&writer, "sequenceId");
+    sf_json_writer_int(&writer, -9223372036854775807LL - 1);
+    sf_json_writer_key(&writer, "bindings");
+    sf_json_writer_begin_object(&writer);
+    sf_json_writer_key(&writer, "1");
+    sf_json_writer_begin_object(&writer);
+    sf_json_writer_key(&writer, "value");
+    sf_json_writer_string(&writer, NULL);
+    sf_json_writer_end_object(&writer);
+    sf_json_writer_key(&writer, "2");
+    sf_json_writer_begin_object(&writer);
+    sf_json_writer_end_object(&writer);
+    sf_json_writer_end_object(&writer);
+    sf_json_writer_key(&writer, "describeOnly");
+    sf_json_writer_bool(&writer, SF_BOOLEAN_TRUE);
+    sf_json_writer_end_object(&writer);
+
+    text = sf_json_writer_finish(&writer);
+    assert_string_equal(text,
+      "{\"sqlText\":\"select \\\"a\\\\b\\\"\\n\\u0001\xc3\xa9\","
+      "\"sequenceId\":-9223372036854775808,"
+      "\"bindings\":{\"1\":{\"value\":null},\"2\":{}},"
+      "\"describeOnly\":true}");
+    SF_FREE(text);
+    sf_json_writer_free(&writer);
+}
+
+/**
+ * Tests that integers written as strings are quoted, at both ends of their range
+ */
+void test_json_writer_int_string(void **unused) {
+    SF_JSON_WRITER writer;
+    char *text;
+
+    sf_json_writer_init(&writer, 4);
+    sf_json_writer_begin_array(&writer);
+    sf_json_writer_int_string(&writer, 0);
+    sf_json_writer_int_string(&writer, -9223372036854775807LL - 1);
+    sf_json_writer_uint_string(&writer, 18446744073709551615ULL);
+    sf_json_writer_end_array(&writer);
+
+    text = sf_json_writer_finish(&writer);
+    assert_string_equal(text, "[\"0\",\"-9223372036854775808\",\"18446744073709551615\"]");
+    SF_FREE(text);
+    sf_json_writer_free(&writer);
+}
+
+/**
+ * Tests that the session parameters of a statement are sent in the query body
+ */
+void test_query_json_body_parameters(void **unused) {
+    SF_JSON_WRITER writer;
+    cJSON *parameters = snowflake_cJSON_Parse(
+      "{\"QUERY_TAG\": \"etl\", \"C_API_QUERY_RESULT_FORMAT\": \"ARROW\", "
+      "\"ROWS_PER_RESULTSET\": 10, \"QUOTED_IDENTIFIERS_IGNORE_CASE\": true}");
+    char *text;
+
+    sf_json_writer_init(&writer, 64);
+    sf_json_writer_begin_object(&writer);
+    write_query_json_body(&writer, "select 1", 1, NULL, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, 1,
+                          "JSON", 0, parameters);
+    sf_json_writer_end_object(&writer);
+    text = sf_json_writer_finish(&writer);
+    // The result format of its own takes precedence over the one in the parameters
+    assert_non_null(strstr(text, "\"parameters\":{\"C_API_QUERY_RESULT_FORMAT\":\"JSON\","
+                                 "\"QUERY_TAG\":\"etl\",\"ROWS_PER_RESULTSET\":10,"
+                                 "\"QUOTED_IDENTIFIERS_IGNORE_CASE\":true}}"));
+    SF_FREE(text);
+
+    // Without parameters of the statement, those of the session apply
+    sf_json_writer_begin_object(&writer);
+    write_query_json_body(&writer, "select 1", 1, NULL, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, 1,
+                          NULL, 0, NULL);
+    sf_json_writer_end_object(&writer);
+    text = sf_json_writer_finish(&writer);
+#ifndef SF_NO_ARROW
+    assert_null(strstr(text, "\"parameters\""));
+#endif
+    SF_FREE(text);
+
+    // The chunk size of its own takes precedence as well
+    snowflake_cJSON_Delete(parameters);
+    parameters = snowflake_cJSON_Parse("{\"CLIENT_RESULT_CHUNK_SIZE\": 160}");
+    sf_json_writer_begin_object(&writer);
+    write_query_json_body(&writer, "select 1", 1, NULL, SF_BOOLEAN_FALSE, SF_BOOLEAN_FALSE, 1,
+                          NULL, 64, parameters);
+    sf_json_writer_end_object(&writer);
+    text = sf_json_writer_finish(&writer);
+    assert_non_null(strstr(text, "\"CLIENT_RESULT_CHUNK_SIZE\":64}}"));
+    assert_null(strstr(text, "160"));
+    SF_FREE(text);
+    sf_json_writer_free(&writer);
+    snowflake_cJSON_Delete(parameters);
+}
+
+/**
+ * Tests that the buffer of a writer grows within its budget, and that it is given back to the
+ * budget with the text
+ */
+void test_json_writer_budget(void **unused) {
+    SF_JSON_WRITER writer;
+    SF_MEMORY_BUDGET budget;
+    char *text;
+    int i;
+
+    sf_memory_budget_init(&budget, 4 * SF_JSON_WRITER_INITIAL_SIZE, NULL);
+    sf_json_writer_init(&writer, SF_JSON_WRITER_INITIAL_SIZE);
+    writer.budget = &budget;
+    sf_json_writer_begin_array(&writer);
+    for (i = 0; i < 200; i++) {
+        sf_json_writer_string(&writer, "0123456789");
+    }
+    sf_json_writer_end_array(&writer);
+    assert_false(writer.over_budget);
+    assert_int_equal(budget.used, 4 * SF_JSON_WRITER_INITIAL_SIZE);
+    text = sf_json_writer_finish(&writer);
+    assert_non_null(text);
+    assert_int_equal(budget.used, 0);
+    SF_FREE(text);
+
+    // Twice as much text doesn't fit
+    sf_json_writer_begin_array(&writer);
+    for (i = 0; i < 400; i++) {
+        sf_json_writer_string(&writer, "0123456789");
+    }
+    sf_json_writer_end_array(&writer);
+    assert_true(writer.over_budget);
+    assert_null(sf_json_writer_finish(&writer));
+    assert_int_equal(budget.used, 0);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_json_writer_object),
+      cmocka_unit_test(test_json_writer_int_string),
+      cmocka_unit_test(test_query_json_body_parameters),
+      cmocka_unit_test(test_json_writer_budget),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -24,6 +24,32 @@ void test_log_str_to_level(void **unused) {
     assert_int_equal(log_from_str_to_level(NULL), SF_LOG_FATAL);
 }
 
+static int log_argument_calls = 0;
+
+static int log_argument(void) {
+    return ++log_argument_calls;
+}
+
+/**
+ * Tests that the arguments of messages below the log level are not evaluated
+ */
+void test_log_level_gate(void **unused) {
+    log_set_lock(NULL);
+    log_set_quiet(1);
+    log_set_level(SF_LOG_WARN);
+    assert_false(SF_LOG_ENABLED(SF_LOG_DEBUG));
+    assert_true(SF_LOG_ENABLED(SF_LOG_ERROR));
+
+    log_debug("not logged %d", log_argument());
+    log_trace("not logged %d", log_argument());
+    assert_int_equal(log_argument_calls, 0);
+
+    log_set_level(SF_LOG_TRACE);
+    log_info("logged %d", log_argument());
+    assert_int_equal(log_argument_calls, 1);
+    log_set_level(SF_LOG_FATAL);
+}
+
 #ifndef _WIN32
 /**
  * Tests timing of log file creation
@@ -115,11 +141,15 @@ void test_mask_secret_log(void **unused) {
             "\"privateKeyData\": \"abcdefghijk\"",
             "\"privateKeyData\": \"XXXX\""
         },
+        {//13
+            "Connecting with PassWord= random!TEST/-pwd=123++#",
+            "Connecting with PassWord= ****"
+        },
     };
 
     char * line = NULL;
     size_t len = 0;
-    for (int i = 0; i < 13; i++)
+    for (int i = 0; i < 14; i++)
     {
         fseek(fp, 0, SEEK_SET);
         log_trace("%s", logtext[i][0]);
@@ -135,14 +165,105 @@ void test_mask_secret_log(void **unused) {
     free(line);
     fclose(fp);
 }
+
+static SF_MUTEX_HANDLE async_log_mutex;
+
+static void async_log_lock(void *udata, int lock) {
+    if (lock) {
+        _mutex_lock(&async_log_mutex);
+    } else {
+        _mutex_unlock(&async_log_mutex);
+    }
+}
+
+#define ASYNC_LOG_THREADS 4
+#define ASYNC_LOG_MESSAGES 500
+
+static void *async_log_worker(void *arg) {
+    int i;
+    for (i = 0; i < ASYNC_LOG_MESSAGES; i++) {
+        log_info("async message %d from thread %d", i, *(int *) arg);
+    }
+    return NULL;
+}
+
+/**
+ * Tests that asynchronous logging writes every message that wasn't dropped, masked, once the
+ * writer thread stops
+ */
+void test_async_log(void **unused) {
+    char logname[] = "dummy_async.log";
+    char long_message[2000];
+    int ids[ASYNC_LOG_THREADS];
+    SF_THREAD_HANDLE threads[ASYNC_LOG_THREADS];
+    int i;
+
+    remove(logname);
+    FILE *fp = fopen(logname, "w+");
+    assert_non_null(fp);
+    // Warnings written while the queue is full go along with the writer thread
+    _mutex_init(&async_log_mutex);
+    log_set_lock(&async_log_lock);
+    log_set_level(SF_LOG_TRACE);
+    log_set_quiet(1);
+    log_set_fp(fp);
+
+    assert_int_equal(log_start_async(64, 10), 0);
+    assert_true(log_is_async());
+    for (i = 0; i < ASYNC_LOG_THREADS; i++) {
+        ids[i] = i;
+        assert_int_equal(_thread_init(&threads[i], async_log_worker, &ids[i]), 0);
+    }
+    for (i = 0; i < ASYNC_LOG_THREADS; i++) {
+        _thread_join(threads[i]);
+    }
+    // Longer than a record holds inline
+    memset(long_message, 'x', sizeof(long_message));
+    sb_strncpy(long_message, sizeof(long_message), "password: secret123 ", 20);
+    long_message[sizeof(long_message) - 1] = '\0';
+    log_warn("%s", long_message);
+    log_stop_async();
+    assert_false(log_is_async());
+
+    fseek(fp, 0, SEEK_SET);
+    char *line = NULL;
+    size_t len = 0;
+    unsigned long long messages = 0;
+    unsigned long long dropped = 0;
+    unsigned long long count;
+    int long_found = 0;
+    while (getline(&line, &len, fp) > 0) {
+        char *text = strstr(line, ": ");
+        if (strstr(line, "async message") != NULL) {
+            messages++;
+        } else if (text && sscanf(text + 2, "%llu log messages were dropped", &count) == 1) {
+            dropped += count;
+        } else if (strstr(line, "password: ****") != NULL) {
+            assert_null(strstr(line, "secret123"));
+            assert_true(strlen(strstr(line, "xxx")) >= sizeof(long_message) - 40);
+            long_found = 1;
+        }
+    }
+    assert_int_equal(messages + dropped, ASYNC_LOG_THREADS * ASYNC_LOG_MESSAGES);
+    assert_true(long_found);
+
+    free(line);
+    log_set_fp(NULL);
+    log_set_lock(NULL);
+    _mutex_term(&async_log_mutex);
+    fclose(fp);
+    remove(logname);
+}
 #endif
 
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_log_str_to_level),
+        cmocka_unit_test(test_log_level_gate),
 #ifndef _WIN32
         cmocka_unit_test(test_log_creation),
         cmocka_unit_test(test_mask_secret_log),
+        cmocka_unit_test(test_async_log),
 #endif
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
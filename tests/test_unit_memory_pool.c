@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "memory.h"
+
+/**
+ * Tests the size classes of the pool, four per power of two
+ */
+void test_memory_pool_classes(void **unused) {
+    assert_int_equal(sf_memory_pool_class_size(0), 0);
+    assert_int_equal(sf_memory_pool_class_size(1000), 0);
+    assert_int_equal(sf_memory_pool_class_size(SF_MEMORY_POOL_MIN_SIZE - 1), 0);
+    assert_int_equal(sf_memory_pool_class_size(SF_MEMORY_POOL_MIN_SIZE), SF_MEMORY_POOL_MIN_SIZE);
+    assert_int_equal(sf_memory_pool_class_size(SF_MEMORY_POOL_MIN_SIZE + 1),
+                     SF_MEMORY_POOL_MIN_SIZE + SF_MEMORY_POOL_MIN_SIZE / 4);
+    assert_int_equal(sf_memory_pool_class_size(3 * SF_MEMORY_POOL_MIN_SIZE / 2 + 1),
+                     7 * SF_MEMORY_POOL_MIN_SIZE / 4);
+    assert_int_equal(sf_memory_pool_class_size(7 * SF_MEMORY_POOL_MIN_SIZE / 4 + 1),
+                     2 * SF_MEMORY_POOL_MIN_SIZE);
+    assert_int_equal(sf_memory_pool_class_size(5 * 1024 * 1024), 5 * 1024 * 1024);
+    // Beyond the largest class
+    assert_int_equal(sf_memory_pool_class_size((size_t) 1024 * 1024 * 1024), 0);
+}
+
+/**
+ * Tests that a released buffer is reused by the next allocation of its class, and that the
+ * tagged chunk download memory comes from the pool and grows within a class in place
+ */
+void test_memory_pool_reuse(void **unused) {
+    SF_MEMORY_STATS before;
+    SF_MEMORY_STATS after;
+    size_t size = 3 * 1024 * 1024;
+    char *first;
+    char *second;
+
+    sf_memory_pool_trim();
+    first = (char *) sf_memory_pool_alloc(size);
+    assert_non_null(first);
+    assert_int_equal((size_t) first % SF_MEMORY_POOL_ALIGNMENT, 0);
+    memset(first, 1, sf_memory_pool_class_size(size));
+    sf_memory_pool_free(first, size);
+    assert_int_equal(sf_memory_pool_idle(), sf_memory_pool_class_size(size));
+
+    sf_memory_stats(&before);
+    second = (char *) sf_memory_pool_alloc(size - 1000);
+    sf_memory_stats(&after);
+    assert_ptr_equal(first, second);
+    assert_int_equal(after.allocations, before.allocations);
+    assert_int_equal(sf_memory_pool_idle(), 0);
+    sf_memory_pool_free(second, size - 1000);
+
+    // The JSON chunk bodies
+    first = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, size - 4096);
+    assert_ptr_equal(first, second);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD), size - 4096);
+    first[0] = 'a';
+    second = (char *) SF_TAG_REALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, first, size - 4096, size);
+    assert_ptr_equal(first, second);
+    first = (char *) SF_TAG_REALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, second, size, 4 * size);
+    assert_non_null(first);
+    assert_int_equal(first[0], 'a');
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD), 4 * size);
+    SF_TAG_FREE(SF_MEMORY_TAG_CHUNK_DOWNLOAD, first, 4 * size);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_CHUNK_DOWNLOAD), 0);
+    assert_int_equal(sf_memory_pool_idle(),
+                     sf_memory_pool_class_size(size) + sf_memory_pool_class_size(4 * size));
+
+    sf_memory_pool_trim();
+    assert_int_equal(sf_memory_pool_idle(), 0);
+}
+
+/**
+ * Tests the buffers backed by huge pages, aligned to one when large enough, and that the pages
+ * can't be changed while buffers of the pool are in use
+ */
+void test_memory_pool_huge_pages(void **unused) {
+    SF_HUGE_PAGES modes[] = {SF_HUGE_PAGES_TRANSPARENT, SF_HUGE_PAGES_EXPLICIT};
+    size_t size = 5 * 1024 * 1024 / 2;
+    char *large;
+    char *small;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        assert_true(sf_memory_pool_set_huge_pages(modes[i]));
+        assert_int_equal(sf_memory_pool_get_huge_pages(), modes[i]);
+        large = (char *) sf_memory_pool_alloc(size);
+        small = (char *) sf_memory_pool_alloc(SF_MEMORY_POOL_MIN_SIZE);
+        assert_non_null(large);
+        assert_non_null(small);
+#ifdef __linux__
+        assert_int_equal((size_t) large % SF_MEMORY_POOL_HUGE_PAGE_SIZE, 0);
+#endif
+        assert_int_equal((size_t) small % SF_MEMORY_POOL_ALIGNMENT, 0);
+        memset(large, 1, sf_memory_pool_class_size(size));
+        memset(small, 1, SF_MEMORY_POOL_MIN_SIZE);
+
+        assert_false(sf_memory_pool_set_huge_pages(SF_HUGE_PAGES_NONE));
+        assert_int_equal(sf_memory_pool_get_huge_pages(), modes[i]);
+        sf_memory_pool_free(large, size);
+        assert_false(sf_memory_pool_set_huge_pages(SF_HUGE_PAGES_NONE));
+        sf_memory_pool_free(small, SF_MEMORY_POOL_MIN_SIZE);
+        // The idle buffers are freed with the pages they were allocated with
+        assert_true(sf_memory_pool_set_huge_pages(SF_HUGE_PAGES_NONE));
+        assert_int_equal(sf_memory_pool_idle(), 0);
+    }
+}
+
+/**
+ * Tests that a statement budget is charged along with the one of its connection, and that a
+ * reservation over either limit leaves both as they were
+ */
+void test_memory_budget(void **unused) {
+    SF_MEMORY_BUDGET connection;
+    SF_MEMORY_BUDGET statement;
+    SF_MEMORY_BUDGET other;
+
+    sf_memory_budget_init(&connection, 1000, NULL);
+    sf_memory_budget_init(&statement, 600, &connection);
+    sf_memory_budget_init(&other, 0, &connection);
+
+    assert_true(sf_memory_budget_reserve(&statement, 500));
+    assert_int_equal(statement.used, 500);
+    assert_int_equal(connection.used, 500);
+    // Over the limit of the statement
+    assert_false(sf_memory_budget_fits(&statement, 200));
+    assert_false(sf_memory_budget_reserve(&statement, 200));
+    assert_int_equal(statement.used, 500);
+    assert_int_equal(connection.used, 500);
+
+    // Over the limit of the connection, the other statement has none of its own
+    assert_true(sf_memory_budget_reserve(&other, 400));
+    assert_false(sf_memory_budget_fits(&other, 200));
+    assert_false(sf_memory_budget_reserve(&other, 200));
+    assert_int_equal(other.used, 400);
+    assert_int_equal(connection.used, 900);
+
+    // Charged anyway
+    sf_memory_budget_charge(&other, 200);
+    assert_int_equal(connection.used, 1100);
+    sf_memory_budget_release(&other, 600);
+    sf_memory_budget_release(&statement, 500);
+    assert_int_equal(other.used, 0);
+    assert_int_equal(statement.used, 0);
+    assert_int_equal(connection.used, 0);
+
+    // No budget, no limit
+    assert_true(sf_memory_budget_fits(NULL, (uint64) -1));
+    assert_true(sf_memory_budget_reserve(NULL, 1));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_memory_pool_classes),
+      cmocka_unit_test(test_memory_pool_reuse),
+      cmocka_unit_test(test_memory_pool_huge_pages),
+      cmocka_unit_test(test_memory_budget),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+#include "metrics.h"
+
+#define THREAD_COUNT 4
+#define ADDS_PER_THREAD 10000
+
+static void *record_metrics(void *unused) {
+    int i;
+    for (i = 0; i < ADDS_PER_THREAD; i++) {
+        sf_metric_add(SF_COUNTER_CHUNK_BYTES, 3);
+        sf_metric_record(SF_HISTOGRAM_BIND_SERIALIZE_TIME, (uint64) i);
+    }
+    return NULL;
+}
+
+/**
+ * Tests that every value is counted in the one bucket whose bounds hold it
+ */
+void test_metrics_buckets(void **unused) {
+    uint64 value;
+    int bucket;
+
+    for (value = 0; value < 70000; value++) {
+        bucket = sf_metric_bucket(value);
+        assert_true(value <= snowflake_metrics_bucket_bound(bucket));
+        if (bucket > 0) {
+            assert_true(value > snowflake_metrics_bucket_bound(bucket - 1));
+        }
+        // Off by at most a quarter
+        assert_true(snowflake_metrics_bucket_bound(bucket) - value <= value / 4);
+    }
+    assert_int_equal(sf_metric_bucket(5), 5);
+    assert_int_equal(snowflake_metrics_bucket_bound(8), 9);
+    assert_int_equal(sf_metric_bucket((uint64) -1), SF_METRIC_BUCKET_COUNT - 1);
+    assert_true(snowflake_metrics_bucket_bound(SF_METRIC_BUCKET_COUNT - 1) == (uint64) -1);
+}
+
+/**
+ * Tests that the values recorded from several threads add up in the snapshot
+ */
+void test_metrics_snapshot(void **unused) {
+    SF_THREAD_HANDLE threads[THREAD_COUNT];
+    SF_METRICS_SNAPSHOT before;
+    SF_METRICS_SNAPSHOT after;
+    SF_METRIC_HISTOGRAM_VALUES *histogram;
+    uint64 buckets = 0;
+    int i;
+
+    snowflake_global_get_attribute(SF_GLOBAL_METRICS, &before, sizeof(before));
+    for (i = 0; i < THREAD_COUNT; i++) {
+        assert_int_equal(_thread_init(&threads[i], record_metrics, NULL), 0);
+    }
+    for (i = 0; i < THREAD_COUNT; i++) {
+        _thread_join(threads[i]);
+    }
+    snowflake_global_get_attribute(SF_GLOBAL_METRICS, &after, sizeof(after));
+
+    assert_int_equal(after.counters[SF_COUNTER_CHUNK_BYTES] -
+                     before.counters[SF_COUNTER_CHUNK_BYTES],
+                     3 * THREAD_COUNT * ADDS_PER_THREAD);
+    histogram = &after.histograms[SF_HISTOGRAM_BIND_SERIALIZE_TIME];
+    assert_int_equal(histogram->count -
+                     before.histograms[SF_HISTOGRAM_BIND_SERIALIZE_TIME].count,
+                     THREAD_COUNT * ADDS_PER_THREAD);
+    assert_int_equal(histogram->sum - before.histograms[SF_HISTOGRAM_BIND_SERIALIZE_TIME].sum,
+                     (uint64) THREAD_COUNT * ADDS_PER_THREAD * (ADDS_PER_THREAD - 1) / 2);
+    for (i = 0; i < SF_METRIC_BUCKET_COUNT; i++) {
+        buckets += histogram->buckets[i];
+    }
+    assert_int_equal(buckets, histogram->count);
+    assert_int_equal(histogram->buckets[1] -
+                     before.histograms[SF_HISTOGRAM_BIND_SERIALIZE_TIME].buckets[1],
+                     THREAD_COUNT);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_metrics_buckets),
+      cmocka_unit_test(test_metrics_snapshot),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
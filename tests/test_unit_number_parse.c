@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils/test_setup.h"
+#include "number_parse.h"
+
+/**
+ * Tests integer parsing at the bounds of int64 and uint64
+ */
+void test_number_parse_integers(void **unused) {
+    int64 value;
+    uint64 uvalue;
+    sf_bool out_of_range;
+    const char *text;
+
+    text = "-9223372036854775808";
+    assert_ptr_equal(sf_parse_int64(text, &value, &out_of_range), text + strlen(text));
+    assert_true(value == SF_INT64_MIN);
+    assert_false(out_of_range);
+
+    text = "9223372036854775808";
+    sf_parse_int64(text, &value, &out_of_range);
+    assert_true(value == SF_INT64_MAX);
+    assert_true(out_of_range);
+
+    text = "12.5";
+    assert_ptr_equal(sf_parse_int64(text, &value, &out_of_range), text + 2);
+    assert_int_equal(value, 12);
+
+    text = "abc";
+    assert_ptr_equal(sf_parse_int64(text, &value, &out_of_range), text);
+
+    text = "18446744073709551615";
+    sf_parse_uint64(text, &uvalue, &out_of_range);
+    assert_true(uvalue == SF_UINT64_MAX);
+    assert_false(out_of_range);
+
+    text = "-1";
+    sf_parse_uint64(text, &uvalue, &out_of_range);
+    assert_true(uvalue == SF_UINT64_MAX);
+    assert_false(out_of_range);
+
+    text = "18446744073709551616";
+    sf_parse_uint64(text, &uvalue, &out_of_range);
+    assert_true(out_of_range);
+}
+
+/**
+ * Tests that floating point numbers are parsed exactly as strtod() parses them
+ */
+void test_number_parse_floats(void **unused) {
+    const char *texts[] = {
+      "0", "-0", "1.5", "3.14159265358979", "-123.456e-7", "1E22", "9007199254740993",
+      "0.000000000000000000001", "123456789012345678901234", "1.7976931348623157e308",
+      "1e-400", "1e400", "1e", "inf", "-nan", ".5", "5."
+    };
+    size_t i;
+    char *end;
+    float64 expected;
+    float64 value;
+    float32 expected32;
+    float32 value32;
+    sf_bool out_of_range;
+    const char *parsed_end;
+
+    for (i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        errno = 0;
+        expected = strtod(texts[i], &end);
+        parsed_end = sf_parse_float64(texts[i], &value, &out_of_range);
+        assert_memory_equal(&value, &expected, sizeof(value));
+        assert_ptr_equal(parsed_end, end);
+        assert_int_equal(out_of_range, errno == ERANGE);
+
+        errno = 0;
+        expected32 = strtof(texts[i], &end);
+        parsed_end = sf_parse_float32(texts[i], &value32, &out_of_range);
+        assert_memory_equal(&value32, &expected32, sizeof(value32));
+        assert_ptr_equal(parsed_end, end);
+        assert_int_equal(out_of_range, errno == ERANGE);
+    }
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_number_parse_integers),
+      cmocka_unit_test(test_number_parse_floats),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
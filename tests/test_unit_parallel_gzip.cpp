@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <string>
+#include <zlib.h>
+#include "util/CompressionUtil.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::Util::CompressionUtil;
+
+static std::string read_file(FILE *file)
+{
+  std::string data;
+  char buffer[4096];
+  size_t len;
+  rewind(file);
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    data.append(buffer, len);
+  }
+  return data;
+}
+
+/**
+ * Decompresses compressed data on threads threads into a string.
+ */
+static int decompress_parallel(const std::string &compressed, unsigned int threads,
+                               std::string &result)
+{
+  FILE *source = tmpfile();
+  FILE *dest = tmpfile();
+  assert_non_null(source);
+  assert_non_null(dest);
+  assert_int_equal(fwrite(compressed.data(), 1, compressed.size(), source),
+                   compressed.size());
+  rewind(source);
+  int ret = CompressionUtil::decompressWithGzipParallel(source, dest, threads);
+  result = read_file(dest);
+  fclose(source);
+  fclose(dest);
+  return ret;
+}
+
+/**
+ * Compresses size bytes on several threads and checks that the gzip members
+ * decompress back to the original data.
+ */
+static void compress_and_check(size_t size)
+{
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++)
+  {
+    data[i] = (char)("Snowflake"[i % 9] + (i / 4096) % 7);
+  }
+
+  FILE *source = tmpfile();
+  FILE *dest = tmpfile();
+  assert_non_null(source);
+  assert_non_null(dest);
+  assert_int_equal(fwrite(data.data(), 1, size, source), size);
+  rewind(source);
+
+  long destSize = 0;
+  size_t hashed = 0;
+  int ret = CompressionUtil::compressWithGzipParallel(source, dest, destSize, -1, 4,
+    [&hashed](const char *, size_t len)
+    {
+      hashed += len;
+    });
+  assert_int_equal(ret, Z_OK);
+  assert_int_equal((size_t)destSize, hashed);
+  assert_int_equal(ftell(dest), destSize);
+
+  // decompress member by member, inflateReset() keeps the output position
+  std::string compressed(destSize, '\0');
+  rewind(dest);
+  assert_int_equal(fread(&compressed[0], 1, destSize, dest), (size_t)destSize);
+  std::string inflated(size + 1, '\0');
+  z_stream strm = {};
+  assert_int_equal(inflateInit2(&strm, 15 + 16), Z_OK);
+  strm.next_in = (Bytef *)compressed.data();
+  strm.avail_in = (uInt)compressed.size();
+  strm.next_out = (Bytef *)&inflated[0];
+  strm.avail_out = (uInt)inflated.size();
+  while ((ret = inflate(&strm, Z_NO_FLUSH)) == Z_STREAM_END && strm.avail_in > 0)
+  {
+    inflateReset(&strm);
+  }
+  assert_int_equal(ret, Z_STREAM_END);
+  inflateEnd(&strm);
+  inflated.resize(inflated.size() - strm.avail_out);
+  assert_true(inflated == data);
+
+  // and on several threads, member by member
+  std::string result;
+  assert_int_equal(decompress_parallel(compressed, 3, result), Z_OK);
+  assert_true(result == data);
+
+  fclose(source);
+  fclose(dest);
+}
+
+void test_parallel_gzip_empty(void **unused)
+{
+  compress_and_check(0);
+}
+
+void test_parallel_gzip_blocks(void **unused)
+{
+  // five blocks and a half, more than one round of four threads
+  compress_and_check(22 * 1024 * 1024);
+}
+
+/**
+ * Members without their size in the header, after those compressed on
+ * several threads, are decompressed too, and a truncated member fails.
+ */
+void test_parallel_gunzip_mixed(void **unused)
+{
+  std::string data(9 * 1024 * 1024, '\0');
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i] = (char)("Snowflake"[i % 9] + (i / 1000) % 5);
+  }
+  FILE *source = tmpfile();
+  FILE *dest = tmpfile();
+  assert_int_equal(fwrite(data.data(), 1, data.size(), source), data.size());
+  rewind(source);
+  long destSize = 0;
+  assert_int_equal(CompressionUtil::compressWithGzipParallel(source, dest, destSize, 1, 2,
+                                                             nullptr), Z_OK);
+  std::string compressed = read_file(dest);
+  fclose(source);
+  fclose(dest);
+
+  std::string tail(50000, 't');
+  std::string member;
+  assert_int_equal(CompressionUtil::compressWithGzip(tail.data(), tail.size(), member), Z_OK);
+  std::string result;
+  assert_int_equal(decompress_parallel(compressed + member, 4, result), Z_OK);
+  assert_true(result == data + tail);
+
+  assert_int_equal(decompress_parallel(compressed.substr(0, compressed.size() - 1), 4,
+                                       result), Z_DATA_ERROR);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_parallel_gzip_empty),
+    cmocka_unit_test(test_parallel_gzip_blocks),
+    cmocka_unit_test(test_parallel_gunzip_mixed),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing Put in the background, with the files told about as they complete
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(int parallel)
+    : IStatementPutGet(),
+      m_parallel(parallel)
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back("batch.csv.gz");
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"gzip";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = false;
+    putGetParseResponse->parallel = m_parallel;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    return true;
+  }
+
+private:
+  int m_parallel;
+
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    std::stringstream data;
+    data << dataStream->rdbuf();
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+};
+
+/**
+ * Records the files completed, cancelling the command after the first one
+ * if asked to
+ */
+class RecordingListener : public ITransferListener
+{
+public:
+  RecordingListener(FileTransferAgent *agent, bool cancelAfterFirst) :
+    m_agent(agent), m_cancelAfterFirst(cancelAfterFirst)
+  {
+  }
+
+  virtual void onFileCompleted(const std::string &srcFileName,
+                               const std::string &destFileName,
+                               const std::string &status,
+                               size_t completedFiles, size_t totalFiles)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_files.push_back(destFileName);
+    m_statuses.push_back(status);
+    m_completed.push_back(completedFiles);
+    assert_int_equal(totalFiles, 3);
+    if (m_cancelAfterFirst)
+    {
+      m_agent->cancel();
+    }
+  }
+
+  std::vector<std::string> m_files;
+
+  std::vector<std::string> m_statuses;
+
+  std::vector<size_t> m_completed;
+
+private:
+  std::mutex m_mutex;
+
+  FileTransferAgent *m_agent;
+
+  bool m_cancelAfterFirst;
+};
+
+static void put_async(int parallel, bool cancel, const char *laterStatus)
+{
+  StorageClientFactory::injectMockedClient(new MockedStorageClient());
+
+  std::stringstream a(std::string(100, 'a'));
+  std::stringstream b(std::string(1000, 'b'));
+  std::stringstream c(std::string(20000, 'c'));
+  std::vector<UploadStream> streams(3);
+  streams[0].name = "a.csv.gz";
+  streams[0].stream = &a;
+  streams[0].size = 100;
+  streams[1].name = "b.csv.gz";
+  streams[1].stream = &b;
+  streams[1].size = 1000;
+  streams[2].name = "c.csv.gz";
+  streams[2].stream = &c;
+  streams[2].size = 20000;
+
+  std::string cmd = "put file://batch.csv.gz @odbctestStage AUTO_COMPRESS=false "
+                    "SOURCE_COMPRESSION=gzip";
+  MockedStatementPut mockedStatementPut(parallel);
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut);
+  agent.setUploadStreams(streams);
+  RecordingListener listener(&agent, cancel);
+  std::unique_ptr<ITransferHandle> handle(agent.executeAsync(&cmd, &listener));
+  assert_non_null(handle.get());
+  ITransferResult *result = handle->wait();
+  assert_true(handle->isDone());
+
+  size_t completedFiles, totalFiles;
+  handle->getProgress(completedFiles, totalFiles);
+  assert_int_equal(completedFiles, 3);
+  assert_int_equal(totalFiles, 3);
+
+  // each file is told about once, in the order they complete
+  assert_int_equal(listener.m_files.size(), 3);
+  for (size_t i = 0; i < 3; i++)
+  {
+    assert_int_equal(listener.m_completed[i], i + 1);
+    assert_string_equal(listener.m_statuses[i].c_str(), i == 0 ? "UPLOADED" : laterStatus);
+  }
+
+  std::string status;
+  int files = 0;
+  while (result->next())
+  {
+    result->getColumnAsString(6, status);
+    files += status == "UPLOADED" ? 1 : 0;
+  }
+  assert_int_equal(files, cancel ? 1 : 3);
+}
+
+void test_put_async(void **unused)
+{
+  put_async(4, false, "UPLOADED");
+}
+
+void test_put_async_cancel(void **unused)
+{
+  // one file at a time, the files after the first one aren't started
+  put_async(1, true, "SKIPPED");
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_put_async),
+    cmocka_unit_test(test_put_async_cancel),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the checkpoint of the multipart uploads of Put
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <cstdio>
+#include <fstream>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "util/TransferCheckpoint.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(const std::string &fileName)
+    : IStatementPutGet()
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back(fileName);
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = true;
+    putGetParseResponse->overwrite = true;
+    putGetParseResponse->parallel = 1;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    return true;
+  }
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+/**
+ * Starts a multipart upload in the checkpoint, as if the client was stopped
+ * after the first part, and records the file key used.
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient(std::string &fileKey, std::string &iv) :
+    m_fileKey(fileKey), m_iv(iv), m_checkpoint(nullptr)
+  {
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    const EncryptionMetadata &encryption = fileMetadata->encryptionMetadata;
+    m_fileKey = std::string((char *)encryption.fileKey.data, encryption.fileKey.nbBits / 8);
+    m_iv = std::string((char *)encryption.iv.data, sizeof(encryption.iv.data));
+
+    Util::TransferCheckpoint::Entry entry;
+    if (m_checkpoint && !m_checkpoint->lookup(fileMetadata->destFileName, entry))
+    {
+      entry.uploadId = "upload id";
+      entry.size = encryption.cipherStreamSize;
+      entry.partSize = 8;
+      entry.digest = fileMetadata->sha256Digest;
+      entry.enKekEncoded = encryption.enKekEncoded;
+      entry.iv = "AAECAwQFBgcICQoLDA0ODw==";
+      entry.matDesc = encryption.matDesc;
+      m_checkpoint->start(fileMetadata->destFileName, entry);
+      m_checkpoint->completePart(fileMetadata->destFileName, 1, "\"etag 1\"");
+    }
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+  virtual void setCheckpoint(Util::TransferCheckpoint *checkpoint)
+  {
+    m_checkpoint = checkpoint;
+  }
+
+private:
+  std::string &m_fileKey;
+
+  std::string &m_iv;
+
+  Util::TransferCheckpoint *m_checkpoint;
+};
+
+static void put(const std::string &fileName, TransferConfig *config,
+                std::string &fileKey, std::string &iv)
+{
+  StorageClientFactory::injectMockedClient(new MockedStorageClient(fileKey, iv));
+  std::string cmd = "put file://" + fileName + " @odbctestStage";
+  MockedStatementPut mockedStatementPut(fileName);
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut, config);
+  ITransferResult * result = agent.execute(&cmd);
+
+  std::string status;
+  assert_true(result->next());
+  result->getColumnAsString(6, status);
+  assert_string_equal(status.c_str(), "UPLOADED");
+}
+
+/**
+ * The uploads and their parts are read back from the checkpoint file.
+ */
+void test_checkpoint_file(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string checkpointFile = std::string(tmpDir) + "checkpoint_file_test.checkpoint";
+  remove(checkpointFile.c_str());
+
+  Util::TransferCheckpoint::Entry entry;
+  entry.uploadId = "upload id";
+  entry.size = 123456789012LL;
+  entry.partSize = 8388608;
+  entry.digest = "digest";
+  entry.enKekEncoded = "file key";
+  entry.iv = "iv";
+  entry.matDesc = "{\"queryId\":\"1\", \"smkId\":\"1234\", \"keySize\":\"128\"}";
+  {
+    Util::TransferCheckpoint checkpoint(checkpointFile);
+    checkpoint.start("bucket/a.csv.gz", entry);
+    checkpoint.start("bucket/b.csv.gz", entry);
+    checkpoint.completePart("bucket/a.csv.gz", 1, "\"etag 1\"");
+    checkpoint.completePart("bucket/a.csv.gz", 3, "\"etag 3\"");
+    checkpoint.remove("bucket/b.csv.gz");
+  }
+
+  // a line cut short is skipped
+  {
+    std::ofstream file(checkpointFile.c_str(), std::ios_base::app);
+    file << "part\t2";
+  }
+
+  Util::TransferCheckpoint checkpoint(checkpointFile);
+  Util::TransferCheckpoint::Entry loaded;
+  assert_false(checkpoint.lookup("bucket/b.csv.gz", loaded));
+  assert_true(checkpoint.lookup("bucket/a.csv.gz", loaded));
+  assert_string_equal(loaded.uploadId.c_str(), "upload id");
+  assert_true(loaded.size == 123456789012LL);
+  assert_int_equal(loaded.partSize, 8388608);
+  assert_string_equal(loaded.matDesc.c_str(), entry.matDesc.c_str());
+  assert_int_equal(loaded.parts.size(), 2);
+  assert_string_equal(loaded.parts[1].c_str(), "\"etag 1\"");
+  assert_string_equal(loaded.parts[3].c_str(), "\"etag 3\"");
+
+  remove(checkpointFile.c_str());
+}
+
+/**
+ * A restarted upload of the same data takes the file key and iv of the upload
+ * in the checkpoint, a changed file doesn't.
+ */
+void test_checkpoint_resume(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string fileName = std::string(tmpDir) + "checkpoint_resume_test.csv";
+  std::string checkpointFile = std::string(tmpDir) + "checkpoint_resume_test.checkpoint";
+  remove(checkpointFile.c_str());
+  {
+    std::ofstream file(fileName.c_str());
+    file << "1,2,3\n4,5,6\n";
+  }
+
+  TransferConfig config;
+  config.checkpointFile = (char *)checkpointFile.c_str();
+  std::string firstKey, firstIv, fileKey, iv;
+  put(fileName, &config, firstKey, firstIv);
+  assert_int_equal(firstKey.size(), 16);
+
+  put(fileName, &config, fileKey, iv);
+  assert_true(fileKey == firstKey);
+  assert_true(iv == std::string("\x00\x01\x02\x03\x04\x05\x06\x07"
+                                "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f", 16));
+
+  {
+    std::ofstream file(fileName.c_str(), std::ios_base::app);
+    file << "7,8,9\n";
+  }
+  put(fileName, &config, fileKey, iv);
+  assert_false(fileKey == firstKey);
+
+  remove(fileName.c_str());
+  remove(checkpointFile.c_str());
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_checkpoint_file),
+    cmocka_unit_test(test_checkpoint_resume),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
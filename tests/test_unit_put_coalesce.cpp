@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing Put packing small files into larger objects
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <zlib.h>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(const std::string &srcLocation)
+    : IStatementPutGet()
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back(srcLocation);
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"AUTO_DETECT";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = true;
+    putGetParseResponse->parallel = 4;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    return true;
+  }
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+/**
+ * Records the decompressed data of each object uploaded
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    std::string data;
+    if (fileMetadata->requireCompress)
+    {
+      gzFile file = gzopen(fileMetadata->srcFileToUpload.c_str(), "rb");
+      char buf[256];
+      int len;
+      while ((len = gzread(file, buf, sizeof(buf))) > 0)
+      {
+        data.append(buf, len);
+      }
+      gzclose(file);
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_objects[fileMetadata->destFileName] = data;
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+  std::map<std::string, std::string> m_objects;
+
+private:
+  std::mutex m_mutex;
+};
+
+/**
+ * Files of 10 bytes are packed by two into objects of up to 25 bytes, a line
+ * break is added to the file not ending with one, and the gzipped file is
+ * uploaded on its own.
+ */
+void test_put_coalesce(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string testDir = std::string(tmpDir) + "put_coalesce" + PATH_SEP;
+  sf_create_directory_if_not_exists(testDir.c_str());
+  const char *files[] = {"f0.csv", "f1.csv", "f2.csv"};
+  for (int i = 0; i < 3; i++)
+  {
+    std::ofstream ofs(testDir + files[i], std::ios::binary);
+    ofs << (i == 1 ? "1,2,3,4,55" : "1,2,3,4,5\n");
+  }
+  {
+    gzFile gz = gzopen((testDir + "g.csv.gz").c_str(), "wb");
+    gzwrite(gz, "6,7\n", 4);
+    gzclose(gz);
+  }
+
+  MockedStorageClient * client = new MockedStorageClient();
+  StorageClientFactory::injectMockedClient(client);
+  TransferConfig config;
+  config.coalesceTargetSize = 25;
+  std::string cmd = "put file://" + testDir + "* @odbctestStage";
+  MockedStatementPut mockedStatementPut(testDir + "*");
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut, &config);
+  ITransferResult * result = agent.execute(&cmd);
+
+  std::string put_status;
+  int objects = 0;
+  while(result->next())
+  {
+    result->getColumnAsString(6, put_status);
+    assert_string_equal("UPLOADED", put_status.c_str());
+    objects++;
+  }
+  assert_int_equal(objects, 3);
+  assert_int_equal(client->m_objects.size(), 3);
+  assert_true(client->m_objects.count("g.csv.gz") == 1);
+
+  // two of the three files are packed, depending on the order they are listed in
+  std::string packed;
+  for (auto i = client->m_objects.begin(); i != client->m_objects.end(); i++)
+  {
+    if (i->first != "g.csv.gz")
+    {
+      if (i->first.find("coalesced_") == 0)
+      {
+        assert_in_range(i->second.size(), 20, 21);
+      }
+      else
+      {
+        assert_int_equal(i->second.size(), 10);
+      }
+      packed += i->second;
+    }
+  }
+  assert_int_equal(packed.size(), 31);
+  assert_true(packed.find("1,2,3,4,55\n") != std::string::npos);
+
+  sf_delete_directory_if_exists(testDir.c_str());
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_put_coalesce),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
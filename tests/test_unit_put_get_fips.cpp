@@ -172,6 +172,49 @@ void test_simple_put_stage_endpoint(void ** unused)
   //                                             "abc.testendpoint.us-east-1.snowflakecomputing.com");
 }
 
+/**
+ * A released S3 client is reused for the same stage with new credentials,
+ * not for another region.
+ */
+void test_storage_client_reuse(void ** unused)
+{
+  TransferConfig transferConfig;
+  char cafile[] = "/tmp/cafile";
+  transferConfig.caBundleFile = cafile;
+  char aws_token[] = "AWS_TOKEN";
+  char aws_key_id[] = "AWS_KEY_ID";
+  char aws_secret_key[] = "AWS_SECRET_KEY";
+
+  StageInfo stageInfo;
+  stageInfo.stageType = StageType::S3;
+  stageInfo.location = "bucket/path";
+  stageInfo.region = "us-west-2";
+  stageInfo.credentials.insert({{"AWS_TOKEN", aws_token},
+                                {"AWS_KEY_ID", aws_key_id},
+                                {"AWS_SECRET_KEY", aws_secret_key}});
+  IStorageClient *client = StorageClientFactory::acquireClient(
+    &stageInfo, 4, DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD, &transferConfig);
+  StorageClientFactory::releaseClient(client);
+
+  char new_token[] = "NEW_AWS_TOKEN";
+  StageInfo renewed = stageInfo;
+  renewed.location = "bucket/path";
+  renewed.credentials["AWS_TOKEN"] = new_token;
+  IStorageClient *reused = StorageClientFactory::acquireClient(
+    &renewed, 4, DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD, &transferConfig);
+  assert_ptr_equal(client, reused);
+  assert_string_equal(renewed.location.c_str(), "bucket/path/");
+
+  StageInfo otherRegion = stageInfo;
+  otherRegion.region = "us-east-1";
+  IStorageClient *other = StorageClientFactory::acquireClient(
+    &otherRegion, 4, DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD, &transferConfig);
+  assert_ptr_not_equal(client, other);
+
+  StorageClientFactory::releaseClient(reused);
+  StorageClientFactory::releaseClient(other);
+  StorageClientFactory::clearClientCache();
+}
 
 static int gr_setup(void **unused)
 {
@@ -182,6 +225,7 @@ static int gr_setup(void **unused)
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_simple_put_stage_endpoint),
+    cmocka_unit_test(test_storage_client_reuse),
   };
   int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
   return ret;
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing Put fetching the presigned URLs of the files while uploading them
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "snowflake/SnowflakeTransferException.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+#define FILE_COUNT 8
+
+/**
+ * Answers the command with all the files, and the command of each file with
+ * its presigned URL, a while later
+ */
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(const std::string &srcLocation, const std::string &failingFile)
+    : IStatementPutGet(), m_urlsFetched(0), m_failingFile(failingFile)
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back(srcLocation);
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)"NONE";
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = false;
+    putGetParseResponse->parallel = 4;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    if (sql->find('*') == std::string::npos)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      if (!m_failingFile.empty() && sql->find(m_failingFile) != std::string::npos)
+      {
+        return false;
+      }
+      putGetParseResponse->stageInfo.presignedUrl = "https://presigned/" + *sql;
+      m_urlsFetched++;
+    }
+    return true;
+  }
+
+  std::atomic<int> m_urlsFetched;
+
+private:
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+
+  std::string m_failingFile;
+};
+
+/**
+ * Records the URL each file is uploaded to and how many URLs were fetched
+ * when the first upload started
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient(MockedStatementPut *statement) :
+    m_statement(statement), m_urlsFetchedAtFirstUpload(-1)
+  {
+  }
+
+  virtual bool requirePresignedUrl()
+  {
+    return true;
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_urlsFetchedAtFirstUpload < 0)
+    {
+      m_urlsFetchedAtFirstUpload = m_statement->m_urlsFetched;
+    }
+    m_urls[fileMetadata->destFileName] = fileMetadata->presignedUrl;
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+  std::map<std::string, std::string> m_urls;
+  int m_urlsFetchedAtFirstUpload;
+
+private:
+  MockedStatementPut *m_statement;
+  std::mutex m_mutex;
+};
+
+static std::string createFiles()
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string testDir = std::string(tmpDir) + "put_presigned_url" + PATH_SEP;
+  sf_create_directory_if_not_exists(testDir.c_str());
+  for (int i = 0; i < FILE_COUNT; i++)
+  {
+    std::ofstream ofs(testDir + "f" + std::to_string(i) + ".csv", std::ios::binary);
+    ofs << "1,2,3\n";
+  }
+  return testDir;
+}
+
+/**
+ * Every file is uploaded to its own URL, the first before the URLs of all
+ * the files are fetched
+ */
+void test_put_presigned_url_prefetch(void **unused)
+{
+  std::string testDir = createFiles();
+  MockedStatementPut statement(testDir + "*", "");
+  MockedStorageClient *client = new MockedStorageClient(&statement);
+  StorageClientFactory::injectMockedClient(client);
+  std::string cmd = "put file://" + testDir + "* @odbctestStage";
+  Snowflake::Client::FileTransferAgent agent(&statement);
+  ITransferResult *result = agent.execute(&cmd);
+
+  std::string put_status;
+  while (result->next())
+  {
+    result->getColumnAsString(6, put_status);
+    assert_string_equal("UPLOADED", put_status.c_str());
+  }
+  assert_int_equal(statement.m_urlsFetched, FILE_COUNT);
+  assert_int_equal(client->m_urls.size(), FILE_COUNT);
+  for (auto i = client->m_urls.begin(); i != client->m_urls.end(); i++)
+  {
+    assert_true(i->second.find("file://" + i->first + " ") != std::string::npos);
+  }
+  assert_in_range(client->m_urlsFetchedAtFirstUpload, 1, FILE_COUNT - 1);
+
+  sf_delete_directory_if_exists(testDir.c_str());
+}
+
+/**
+ * A URL that can't be fetched fails the command, without waiting forever
+ */
+void test_put_presigned_url_failure(void **unused)
+{
+  std::string testDir = createFiles();
+  MockedStatementPut statement(testDir + "*", "f3.csv");
+  MockedStorageClient *client = new MockedStorageClient(&statement);
+  StorageClientFactory::injectMockedClient(client);
+  std::string cmd = "put file://" + testDir + "* @odbctestStage";
+  Snowflake::Client::FileTransferAgent agent(&statement);
+
+  bool failed = false;
+  try
+  {
+    agent.execute(&cmd);
+  }
+  catch (SnowflakeTransferException &)
+  {
+    failed = true;
+  }
+  assert_true(failed);
+  assert_true(client->m_urls.size() < FILE_COUNT);
+
+  sf_delete_directory_if_exists(testDir.c_str());
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_put_presigned_url_prefetch),
+    cmocka_unit_test(test_put_presigned_url_failure),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing Put of several in memory streams
+ *
+ * Note: storage client in this class is mocked
+ */
+
+#include "snowflake/IStatementPutGet.hpp"
+#include "snowflake/PutGetParseResponse.hpp"
+#include <map>
+#include <mutex>
+#include <sstream>
+#include "FileTransferAgent.hpp"
+#include "StorageClientFactory.hpp"
+#include "util/CompressionUtil.hpp"
+#include "utils/test_setup.h"
+#include "utils/TestSetup.hpp"
+
+using namespace ::Snowflake::Client;
+
+class MockedStatementPut : public Snowflake::Client::IStatementPutGet
+{
+public:
+  MockedStatementPut(bool autoCompress = false, const char *sourceCompression = "gzip")
+    : IStatementPutGet(),
+    m_autoCompress(autoCompress),
+    m_sourceCompression(sourceCompression)
+  {
+    m_stageInfo.stageType = StageType::MOCKED_STAGE_TYPE;
+    m_srcLocations.push_back("batch.csv.gz");
+    m_encryptionMaterial.emplace_back(
+      (char *)"3dOoaBhkB1wSw4hyfA5DJw==\0",
+      (char *)"1234\0",
+      1234);
+  }
+
+  virtual bool parsePutGetCommand(std::string *sql,
+                                  PutGetParseResponse *putGetParseResponse)
+  {
+    putGetParseResponse->stageInfo = m_stageInfo;
+    putGetParseResponse->command = CommandType::UPLOAD;
+    putGetParseResponse->sourceCompression = (char *)m_sourceCompression;
+    putGetParseResponse->srcLocations = m_srcLocations;
+    putGetParseResponse->threshold = DEFAULT_UPLOAD_DATA_SIZE_THRESHOLD;
+    putGetParseResponse->autoCompress = m_autoCompress;
+    putGetParseResponse->parallel = 4;
+    putGetParseResponse->encryptionMaterials = m_encryptionMaterial;
+
+    return true;
+  }
+
+private:
+  bool m_autoCompress;
+
+  const char *m_sourceCompression;
+
+  StageInfo m_stageInfo;
+
+  std::vector<EncryptionMaterial> m_encryptionMaterial;
+
+  std::vector<std::string> m_srcLocations;
+};
+
+/**
+ * Records the encrypted size and digest of each upload. The first upload of
+ * b.csv.gz fails after reading the data, to be retried.
+ */
+class MockedStorageClient : public Snowflake::Client::IStorageClient
+{
+public:
+  MockedStorageClient() : m_failed(false)
+  {
+  }
+
+  virtual RemoteStorageRequestOutcome upload(FileMetadata *fileMetadata,
+                                 std::basic_iostream<char> *dataStream)
+  {
+    std::stringstream data;
+    data << dataStream->rdbuf();
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (fileMetadata->destFileName == "b.csv.gz" && !m_failed)
+    {
+      m_failed = true;
+      return FAILED;
+    }
+    m_sizes[fileMetadata->destFileName] = data.str().size();
+    m_streamSizes[fileMetadata->destFileName] =
+      (size_t)fileMetadata->encryptionMetadata.cipherStreamSize;
+    m_digests[fileMetadata->destFileName] = fileMetadata->sha256Digest;
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome GetRemoteFileMetadata(
+    std::string * filePathFull, FileMetadata *fileMetadata)
+  {
+    return SUCCESS;
+  }
+
+  virtual RemoteStorageRequestOutcome download(FileMetadata * fileMetadata,
+                                               std::basic_iostream<char>* dataStream)
+  {
+    return SUCCESS;
+  }
+
+  std::map<std::string, size_t> m_sizes;
+
+  /// sizes announced before the uploads
+  std::map<std::string, size_t> m_streamSizes;
+
+  std::map<std::string, std::string> m_digests;
+
+private:
+  std::mutex m_mutex;
+
+  bool m_failed;
+};
+
+void test_put_streams(void **unused)
+{
+  MockedStorageClient * client = new MockedStorageClient();
+  StorageClientFactory::injectMockedClient(client);
+
+  std::stringstream a(std::string(100, 'a'));
+  std::stringstream b(std::string(1000, 'b'));
+  std::stringstream c(std::string(20000, 'c'));
+  std::vector<UploadStream> streams(3);
+  streams[0].name = "a.csv.gz";
+  streams[0].stream = &a;
+  streams[0].size = 100;
+  streams[0].digest = "given digest";
+  streams[1].name = "b.csv.gz";
+  streams[1].stream = &b;
+  streams[1].size = 1000;
+  streams[2].name = "c.csv.gz";
+  streams[2].stream = &c;
+  streams[2].size = 20000;
+
+  std::string cmd = "put file://batch.csv.gz @odbctestStage AUTO_COMPRESS=false "
+                    "SOURCE_COMPRESSION=gzip";
+  MockedStatementPut mockedStatementPut;
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut);
+  agent.setUploadStreams(streams);
+  ITransferResult * result = agent.execute(&cmd);
+
+  std::string put_status;
+  std::string target;
+  int files = 0;
+  while(result->next())
+  {
+    result->getColumnAsString(6, put_status);
+    assert_string_equal("UPLOADED", put_status.c_str());
+    result->getColumnAsString(1, target);
+    TransferMetrics metrics = result->getMetrics();
+    assert_int_equal(metrics.retries, target == "b.csv.gz" ? 1 : 0);
+    assert_int_equal(metrics.parts, 1);
+    assert_int_equal(metrics.rawBytes, target == "a.csv.gz" ? 100 :
+                                       target == "b.csv.gz" ? 1000 : 20000);
+    assert_int_equal(metrics.transferredBytes, client->m_sizes[target]);
+    files++;
+  }
+  assert_int_equal(files, 3);
+
+  TransferMetrics total = result->getTotalMetrics();
+  assert_int_equal(total.rawBytes, 21100);
+  assert_int_equal(total.compressedBytes, 21100);
+  assert_int_equal(total.transferredBytes, 21136);
+  assert_int_equal(total.retries, 1);
+  assert_int_equal(total.parts, 3);
+  assert_true(total.elapsedMs >= total.enumerateMs);
+
+  // the data is padded by the encryption, a retry reads the whole stream again
+  assert_int_equal(client->m_sizes["a.csv.gz"], 112);
+  assert_int_equal(client->m_sizes["b.csv.gz"], 1008);
+  assert_int_equal(client->m_sizes["c.csv.gz"], 20016);
+  assert_string_equal(client->m_digests["a.csv.gz"].c_str(), "given digest");
+  assert_int_equal(client->m_digests["b.csv.gz"].size(), 44);
+  assert_int_equal(client->m_digests["c.csv.gz"].size(), 44);
+}
+
+/**
+ * The streams of data not compressed yet are compressed as they are
+ * uploaded, retries included, the gzip ones uploaded as they are.
+ */
+void test_put_streams_auto_compress(void **unused)
+{
+  MockedStorageClient * client = new MockedStorageClient();
+  StorageClientFactory::injectMockedClient(client);
+
+  std::string rows;
+  for (int i = 0; i < 10000; i++)
+  {
+    rows += std::to_string(i) + ",some text\n";
+  }
+  std::string gzipped;
+  assert_int_equal(Util::CompressionUtil::compressWithGzip(rows.data(), rows.size(),
+                                                           gzipped), 0);
+  std::stringstream a(rows);
+  std::stringstream b(rows);
+  std::stringstream c(gzipped);
+  std::vector<UploadStream> streams(3);
+  streams[0].name = "a.csv";
+  streams[0].stream = &a;
+  streams[0].size = rows.size();
+  streams[0].digest = "digest of the raw data";
+  // renamed b.csv.gz once compressed, failing once
+  streams[1].name = "b.csv";
+  streams[1].stream = &b;
+  streams[1].size = rows.size();
+  streams[2].name = "c.csv.gz";
+  streams[2].stream = &c;
+  streams[2].size = gzipped.size();
+
+  std::string cmd = "put file://batch.csv @odbctestStage";
+  MockedStatementPut mockedStatementPut(true, "auto_detect");
+  Snowflake::Client::FileTransferAgent agent(&mockedStatementPut);
+  agent.setUploadStreams(streams);
+  ITransferResult * result = agent.execute(&cmd);
+
+  std::string put_status;
+  std::string target;
+  int files = 0;
+  while(result->next())
+  {
+    result->getColumnAsString(6, put_status);
+    assert_string_equal("UPLOADED", put_status.c_str());
+    result->getColumnAsString(1, target);
+    TransferMetrics metrics = result->getMetrics();
+    assert_true(metrics.compressedBytes < rows.size() / 2);
+    files++;
+  }
+  assert_int_equal(files, 3);
+
+  for (const char *name : {"a.csv.gz", "b.csv.gz", "c.csv.gz"})
+  {
+    assert_true(client->m_sizes[name] > 0);
+    assert_int_equal(client->m_sizes[name], client->m_streamSizes[name]);
+    assert_int_equal(client->m_digests[name].size(), 44);
+  }
+  assert_true(client->m_sizes["a.csv.gz"] == client->m_sizes["b.csv.gz"]);
+  assert_true(client->m_digests["a.csv.gz"] == client->m_digests["b.csv.gz"]);
+}
+
+static int gr_setup(void **unused)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  return 0;
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_put_streams),
+    cmocka_unit_test(test_put_streams_auto_compress),
+  };
+  int ret = cmocka_run_group_tests(tests, gr_setup, NULL);
+  return ret;
+}
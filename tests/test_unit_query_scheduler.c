@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+#include "query_scheduler.h"
+
+#define MAX_WAITERS 16
+
+typedef struct WAITER_ARGS {
+    SF_SCHEDULER_POOL *pool;
+    SF_QUERY_PRIORITY priority;
+} WAITER_ARGS;
+
+static SF_QUERY_PRIORITY granted[MAX_WAITERS];
+static int granted_count;
+
+static void *wait_for_slot(void *args) {
+    WAITER_ARGS *waiter = (WAITER_ARGS *) args;
+    sf_scheduler_acquire(waiter->pool, SF_SCHEDULER_QUERIES, waiter->priority);
+    // The slots are taken one at a time, the scheduler lock orders the writes
+    granted[granted_count++] = waiter->priority;
+    sf_scheduler_release(waiter->pool, SF_SCHEDULER_QUERIES);
+    return NULL;
+}
+
+/**
+ * Starts a thread waiting for a slot, once the ones before it are in the queue
+ */
+static void start_waiter(SF_THREAD_HANDLE *thread, WAITER_ARGS *args) {
+    uint64 waiting = sf_scheduler_waiting(args->pool, SF_SCHEDULER_QUERIES);
+    assert_int_equal(_thread_init(thread, wait_for_slot, args), 0);
+    while (sf_scheduler_waiting(args->pool, SF_SCHEDULER_QUERIES) == waiting) {
+        sf_sleep_ms(1);
+    }
+}
+
+/**
+ * Tests that the slots are shared by the connections to an account and warehouse only, and
+ * that a waiter gets the slot given back
+ */
+void test_scheduler_limit(void **unused) {
+    uint64 limit = 2;
+    SF_THREAD_HANDLE thread;
+    WAITER_ARGS args;
+    SF_SCHEDULER_POOL *pool = sf_scheduler_pool("account", "limit_wh");
+    SF_SCHEDULER_POOL *other = sf_scheduler_pool("account", "other_wh");
+
+    assert_non_null(pool);
+    assert_ptr_equal(pool, sf_scheduler_pool("account", "limit_wh"));
+    assert_ptr_not_equal(pool, other);
+
+    snowflake_global_set_attribute(SF_GLOBAL_MAX_QUERIES, &limit);
+    sf_scheduler_acquire(pool, SF_SCHEDULER_QUERIES, SF_QUERY_PRIORITY_NORMAL);
+    assert_true(sf_scheduler_try_acquire(pool, SF_SCHEDULER_QUERIES));
+    assert_false(sf_scheduler_try_acquire(pool, SF_SCHEDULER_QUERIES));
+    assert_true(sf_scheduler_try_acquire(other, SF_SCHEDULER_QUERIES));
+    // The chunk downloads have no limit
+    assert_true(sf_scheduler_try_acquire(pool, SF_SCHEDULER_CHUNK_DOWNLOADS));
+    sf_scheduler_release(pool, SF_SCHEDULER_CHUNK_DOWNLOADS);
+
+    granted_count = 0;
+    args.pool = pool;
+    args.priority = SF_QUERY_PRIORITY_LOW;
+    start_waiter(&thread, &args);
+    assert_int_equal(granted_count, 0);
+    sf_scheduler_release(pool, SF_SCHEDULER_QUERIES);
+    _thread_join(thread);
+    assert_int_equal(granted_count, 1);
+    assert_int_equal(sf_scheduler_in_use(pool, SF_SCHEDULER_QUERIES), 1);
+
+    sf_scheduler_release(pool, SF_SCHEDULER_QUERIES);
+    sf_scheduler_release(other, SF_SCHEDULER_QUERIES);
+    assert_int_equal(sf_scheduler_in_use(pool, SF_SCHEDULER_QUERIES), 0);
+    limit = 0;
+    snowflake_global_set_attribute(SF_GLOBAL_MAX_QUERIES, &limit);
+}
+
+/**
+ * Tests that the waiters get the slot in weighted round robin of their priorities
+ */
+void test_scheduler_priorities(void **unused) {
+    static const SF_QUERY_PRIORITY queued[] = {
+        SF_QUERY_PRIORITY_LOW, SF_QUERY_PRIORITY_LOW,
+        SF_QUERY_PRIORITY_NORMAL, SF_QUERY_PRIORITY_NORMAL, SF_QUERY_PRIORITY_NORMAL,
+        SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_HIGH,
+        SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_HIGH
+    };
+    // 4 high, 2 normal and 1 low a round
+    static const SF_QUERY_PRIORITY expected[] = {
+        SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_HIGH,
+        SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_NORMAL, SF_QUERY_PRIORITY_NORMAL,
+        SF_QUERY_PRIORITY_LOW,
+        SF_QUERY_PRIORITY_HIGH, SF_QUERY_PRIORITY_NORMAL, SF_QUERY_PRIORITY_LOW
+    };
+    const int count = sizeof(queued) / sizeof(queued[0]);
+    SF_THREAD_HANDLE threads[MAX_WAITERS];
+    WAITER_ARGS args[MAX_WAITERS];
+    uint64 limit = 1;
+    int i;
+    SF_SCHEDULER_POOL *pool = sf_scheduler_pool("account", "priorities_wh");
+
+    snowflake_global_set_attribute(SF_GLOBAL_MAX_QUERIES, &limit);
+    sf_scheduler_acquire(pool, SF_SCHEDULER_QUERIES, SF_QUERY_PRIORITY_NORMAL);
+    granted_count = 0;
+    for (i = 0; i < count; i++) {
+        args[i].pool = pool;
+        args[i].priority = queued[i];
+        start_waiter(&threads[i], &args[i]);
+    }
+    sf_scheduler_release(pool, SF_SCHEDULER_QUERIES);
+    for (i = 0; i < count; i++) {
+        _thread_join(threads[i]);
+    }
+
+    assert_int_equal(granted_count, count);
+    for (i = 0; i < count; i++) {
+        assert_int_equal(granted[i], expected[i]);
+    }
+    assert_int_equal(sf_scheduler_in_use(pool, SF_SCHEDULER_QUERIES), 0);
+    limit = 0;
+    snowflake_global_set_attribute(SF_GLOBAL_MAX_QUERIES, &limit);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_scheduler_limit),
+      cmocka_unit_test(test_scheduler_priorities),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
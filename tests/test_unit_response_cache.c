@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "response_cache.h"
+#include "memory.h"
+
+static void assert_cached(SF_RESPONSE_CACHE *cache, const char *key, const char *context,
+                          const char *expected) {
+    char *response = sf_response_cache_get(cache, key, context);
+    if (expected) {
+        assert_non_null(response);
+        assert_string_equal(response, expected);
+    } else {
+        assert_null(response);
+    }
+    SF_FREE(response);
+}
+
+/**
+ * Tests that responses are found by key and context, replaced, evicted least recently used
+ * first and cleared
+ */
+void test_response_cache(void **unused) {
+    SF_RESPONSE_CACHE *cache = sf_response_cache_create(2, 0, 0);
+
+    assert_null(sf_response_cache_create(0, 0, 0));
+    assert_non_null(cache);
+    assert_cached(cache, "select 1", "db", NULL);
+
+    sf_response_cache_put(cache, "select 1", "db", "one");
+    sf_response_cache_put(cache, "select 2", "db", "two");
+    assert_cached(cache, "select 1", "db", "one");
+    assert_cached(cache, "select 1", "other db", NULL);
+    assert_cached(cache, "select 2", "db", "two");
+
+    sf_response_cache_put(cache, "select 2", "db", "two again");
+    assert_cached(cache, "select 2", "db", "two again");
+    assert_int_equal(cache->count, 2);
+
+    // select 1 was used last the longest ago
+    sf_response_cache_put(cache, "select 3", "db", "three");
+    assert_cached(cache, "select 1", "db", NULL);
+    assert_cached(cache, "select 2", "db", "two again");
+    assert_cached(cache, "select 3", "db", "three");
+
+    sf_response_cache_clear(cache);
+    assert_cached(cache, "select 3", "db", NULL);
+    assert_int_equal(cache->count, 0);
+    assert_int_equal(cache->bytes, 0);
+    sf_response_cache_destroy(cache);
+}
+
+/**
+ * Tests that responses expire and that the cache stays within its bytes
+ */
+void test_response_cache_limits(void **unused) {
+    SF_RESPONSE_CACHE *cache = sf_response_cache_create(10, 10, 100);
+
+    sf_response_cache_put(cache, "a", "", "12345");
+    sf_response_cache_put(cache, "b", "", "12345");
+    assert_int_equal(cache->bytes, 10);
+    // Too large to keep at all
+    sf_response_cache_put(cache, "c", "", "12345678901");
+    assert_cached(cache, "c", "", NULL);
+    assert_cached(cache, "b", "", "12345");
+
+    // a goes to make room
+    sf_response_cache_put(cache, "c", "", "123");
+    assert_cached(cache, "a", "", NULL);
+    assert_cached(cache, "b", "", "12345");
+    assert_cached(cache, "c", "", "123");
+    assert_int_equal(cache->bytes, 8);
+
+    sf_sleep_ms(200);
+    assert_cached(cache, "b", "", NULL);
+    assert_cached(cache, "c", "", NULL);
+    assert_int_equal(cache->count, 0);
+    sf_response_cache_destroy(cache);
+}
+
+/**
+ * Tests that a shared cache stays usable until its last reference is given back
+ */
+void test_response_cache_refs(void **unused) {
+    SF_RESPONSE_CACHE *cache = sf_response_cache_create(2, 0, 0);
+
+    sf_response_cache_retain(cache);
+    sf_response_cache_put(cache, "select 1", "db", "one");
+    sf_response_cache_release(cache);
+    assert_int_equal(cache->refs, 1);
+    assert_cached(cache, "select 1", "db", "one");
+    sf_response_cache_release(cache);
+    // Caching turned off
+    sf_response_cache_retain(NULL);
+    sf_response_cache_release(NULL);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_response_cache),
+      cmocka_unit_test(test_response_cache_limits),
+      cmocka_unit_test(test_response_cache_refs),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include "utils/test_setup.h"
+#include "connection.h"
+
+/**
+ * Tests that the backoff stays within the configured range
+ */
+void test_retry_policy_backoff(void **unused) {
+    SF_CONNECT *sf = snowflake_init();
+    SF_RETRY_POLICY policy;
+    RETRY_CONTEXT retry_ctx;
+    uint64 base = 20;
+    uint64 cap = 300;
+    uint32 sleep_ms;
+    int i;
+
+    assert_int_equal(snowflake_set_attribute(sf, SF_CON_POLL_RETRY_BACKOFF_BASE, &base),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(snowflake_set_attribute(sf, SF_CON_POLL_RETRY_BACKOFF_CAP, &cap),
+                     SF_STATUS_SUCCESS);
+    retry_policy_init(&policy, sf, SF_RETRY_CLASS_POLL);
+    assert_int_equal(policy.backoff.base, 20);
+    assert_int_equal(policy.backoff.cap, 300);
+    assert_null(policy.budget_tokens);
+
+    retry_ctx.retry_count = 0;
+    retry_ctx.retry_timeout = 0;
+    retry_ctx.sleep_time = policy.backoff.base;
+    retry_ctx.djb = &policy.backoff;
+    for (i = 0; i < 20; i++) {
+        sleep_ms = retry_ctx_next_sleep(&retry_ctx);
+        assert_true(sleep_ms >= 20);
+        assert_true(sleep_ms <= 300);
+    }
+
+    snowflake_term(sf);
+}
+
+/**
+ * Tests that retries stop once the budget of the connection is used up, and that
+ * successful requests refill it
+ */
+void test_retry_policy_budget(void **unused) {
+    SF_CONNECT *sf = snowflake_init();
+    SF_RETRY_POLICY policy;
+    uint64 budget = 2;
+    int i;
+
+    assert_int_equal(snowflake_set_attribute(sf, SF_CON_RETRY_BUDGET, &budget),
+                     SF_STATUS_SUCCESS);
+    retry_policy_init(&policy, sf, SF_RETRY_CLASS_REQUEST);
+    assert_true(retry_policy_take(&policy));
+    assert_true(retry_policy_take(&policy));
+    assert_false(retry_policy_take(&policy));
+
+    for (i = 0; i < SF_RETRY_TOKEN_COST; i++) {
+        retry_policy_refund(&policy);
+    }
+    assert_true(retry_policy_take(&policy));
+    assert_false(retry_policy_take(&policy));
+
+    snowflake_term(sf);
+}
+
+#define RETRY_TAKERS 8
+
+typedef struct RETRY_TAKER {
+    SF_RETRY_POLICY *policy;
+    int taken;
+} RETRY_TAKER;
+
+static void *take_all(void *arg) {
+    RETRY_TAKER *taker = (RETRY_TAKER *) arg;
+    while (retry_policy_take(taker->policy)) {
+        taker->taken++;
+    }
+    return NULL;
+}
+
+/**
+ * Tests that concurrent retries never take more than the budget
+ */
+void test_retry_policy_budget_concurrent(void **unused) {
+    SF_CONNECT *sf = snowflake_init();
+    SF_RETRY_POLICY policy;
+    SF_THREAD_HANDLE threads[RETRY_TAKERS];
+    RETRY_TAKER takers[RETRY_TAKERS];
+    uint64 budget = 1000;
+    int taken = 0;
+    int i;
+
+    assert_int_equal(snowflake_set_attribute(sf, SF_CON_RETRY_BUDGET, &budget),
+                     SF_STATUS_SUCCESS);
+    retry_policy_init(&policy, sf, SF_RETRY_CLASS_REQUEST);
+    for (i = 0; i < RETRY_TAKERS; i++) {
+        takers[i].policy = &policy;
+        takers[i].taken = 0;
+        assert_int_equal(_thread_init(&threads[i], take_all, &takers[i]), 0);
+    }
+    for (i = 0; i < RETRY_TAKERS; i++) {
+        _thread_join(threads[i]);
+        taken += takers[i].taken;
+    }
+    assert_int_equal(taken, budget);
+    assert_false(retry_policy_take(&policy));
+
+    snowflake_term(sf);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_retry_policy_backoff),
+      cmocka_unit_test(test_retry_policy_budget),
+      cmocka_unit_test(test_retry_policy_budget_concurrent),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+/**
+ * Testing the typed rows of the C++ API, over a result set made from JSON rows
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "snowflake/Rows.hpp"
+#include "utils/test_setup.h"
+#include "memory.h"
+#include "results.h"
+#include "result_set.h"
+#include "json_rowset.h"
+
+using namespace ::Snowflake::Client;
+
+namespace
+{
+
+const char *ROWTYPE =
+  "[{\"name\":\"ID\",\"type\":\"fixed\",\"precision\":38,\"scale\":0,\"nullable\":true},"
+  "{\"name\":\"NAME\",\"type\":\"text\",\"length\":16,\"byteLength\":64,\"nullable\":true},"
+  "{\"name\":\"PRICE\",\"type\":\"real\",\"nullable\":true}]";
+
+const char *ROWS = "[[\"1\",\"one\",\"1.5\"],[\"2\",null,\"2.5\"],[\"3\",\"three\",null]]";
+
+/**
+ * Makes a statement holding the rows, as if just executed
+ */
+SF_STMT *makeStatement(SF_CONNECT *sf)
+{
+  SF_STMT *sfstmt = snowflake_stmt(sf);
+  cJSON *rowtype = snowflake_cJSON_Parse(ROWTYPE);
+  sfstmt->desc = set_description(rowtype);
+  snowflake_cJSON_Delete(rowtype);
+  sfstmt->total_fieldcount = 3;
+  sfstmt->qrf = SF_CALLOC(1, sizeof(QueryResultFormat_t));
+  *(QueryResultFormat_t *)sfstmt->qrf = JSON_FORMAT;
+  sfstmt->rs_accessors = rs_get_accessors((QueryResultFormat_t *)sfstmt->qrf);
+
+  size_t len = strlen(ROWS);
+  char *buffer = (char *)SF_TAG_MALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, len + 1);
+  memcpy(buffer, ROWS, len + 1);
+  SF_JSON_ROWSET *chunk = sf_json_rowset_parse(buffer, len, len + 1,
+                                               SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+  assert_non_null(chunk);
+  sfstmt->result_set = rs_create_with_chunk(chunk, sfstmt->desc,
+                                            (QueryResultFormat_t *)sfstmt->qrf, "UTC");
+  assert_non_null(sfstmt->result_set);
+  sfstmt->chunk_rowcount = 3;
+  sfstmt->total_rowcount = 3;
+  sfstmt->total_row_index = 0;
+  return sfstmt;
+}
+
+} // namespace
+
+/**
+ * Every row is read as the tuple of the requested types
+ */
+void test_rows_iterate(void **unused)
+{
+  SF_CONNECT *sf = snowflake_init();
+  SF_STMT *sfstmt = makeStatement(sf);
+
+  std::vector<int64> ids;
+  std::vector<std::string> names;
+  std::vector<Nullable<float64> > prices;
+  for (const auto &row : rows<int64, std::string, Nullable<float64> >(sfstmt))
+  {
+    ids.push_back(std::get<0>(row));
+    names.push_back(std::get<1>(row));
+    prices.push_back(std::get<2>(row));
+  }
+
+  assert_int_equal(ids.size(), 3);
+  assert_int_equal(ids[0], 1);
+  assert_int_equal(ids[2], 3);
+  assert_string_equal(names[0].c_str(), "one");
+  assert_string_equal(names[1].c_str(), "");
+  assert_string_equal(names[2].c_str(), "three");
+  assert_false(prices[0].isNull);
+  assert_true(prices[0].value == 1.5);
+  assert_false(prices[1].isNull);
+  assert_true(prices[1].value == 2.5);
+  assert_true(prices[2].isNull);
+
+  snowflake_stmt_term(sfstmt);
+  snowflake_term(sf);
+}
+
+/**
+ * The requested types are checked against the columns before any row is fetched
+ */
+void test_rows_validate(void **unused)
+{
+  SF_CONNECT *sf = snowflake_init();
+  SF_STMT *sfstmt = makeStatement(sf);
+
+  bool rejected = false;
+  try
+  {
+    rows<int64, SF_TIMESTAMP>(sfstmt);
+  }
+  catch (std::invalid_argument &)
+  {
+    rejected = true;
+  }
+  assert_true(rejected);
+
+  rejected = false;
+  try
+  {
+    rows<int64, const char *, float64, int64>(sfstmt);
+  }
+  catch (std::invalid_argument &)
+  {
+    rejected = true;
+  }
+  assert_true(rejected);
+
+  // No row was fetched by the rejected types
+  int64 first = 0;
+  const char *name = NULL;
+  Rows<int64, const char *> valid(sfstmt);
+  Rows<int64, const char *>::iterator it = valid.begin();
+  assert_true(it != valid.end());
+  std::tie(first, name) = *it;
+  assert_int_equal(first, 1);
+  assert_string_equal(name, "one");
+
+  snowflake_stmt_term(sfstmt);
+  snowflake_term(sf);
+}
+
+int main(void)
+{
+  initialize_test(SF_BOOLEAN_FALSE);
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_rows_iterate),
+    cmocka_unit_test(test_rows_validate),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  snowflake_global_term();
+  return ret;
+}
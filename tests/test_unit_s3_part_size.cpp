@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include "SnowflakeS3Client.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::SnowflakeS3Client;
+
+#define MB (1024ULL * 1024ULL)
+#define GB (1024ULL * MB)
+
+/**
+ * The part size of a file with enough parts for every thread is the threshold
+ * until the throughput is measured.
+ */
+void test_part_size_threshold(void **unused)
+{
+  assert_int_equal(SnowflakeS3Client::choosePartSize(2 * GB, 64 * MB, 4, 0), 64 * MB);
+}
+
+/**
+ * A file of a few parts is split in smaller ones so that each thread uploads
+ * one, but not below the minimum part size.
+ */
+void test_part_size_small_file(void **unused)
+{
+  assert_int_equal(SnowflakeS3Client::choosePartSize(100 * MB, 64 * MB, 4, 0), 25 * MB);
+  assert_int_equal(SnowflakeS3Client::choosePartSize(20 * MB, 16 * MB, 8, 0), 8 * MB);
+}
+
+/**
+ * Parts grow with the measured throughput, up to the cap of growth.
+ */
+void test_part_size_throughput(void **unused)
+{
+  // two seconds of 50 MB/s
+  assert_int_equal(SnowflakeS3Client::choosePartSize(50 * GB, 64 * MB, 4, 50 * MB), 100 * MB);
+  assert_int_equal(SnowflakeS3Client::choosePartSize(50 * GB, 64 * MB, 4, 1 * GB), 256 * MB);
+  // a slow link doesn't shrink the parts
+  assert_int_equal(SnowflakeS3Client::choosePartSize(50 * GB, 64 * MB, 4, 1 * MB), 64 * MB);
+}
+
+/**
+ * A huge file is never split in more parts than s3 allows.
+ */
+void test_part_size_max_parts(void **unused)
+{
+  unsigned long long size = 4000 * GB;
+  size_t partSize = SnowflakeS3Client::choosePartSize(size, 64 * MB, 4, 0);
+  assert_true(size / partSize + 1 <= 10000);
+  assert_int_equal(partSize % MB, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_part_size_threshold),
+    cmocka_unit_test(test_part_size_small_file),
+    cmocka_unit_test(test_part_size_throughput),
+    cmocka_unit_test(test_part_size_max_parts),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "scroll_cache.h"
+#include "memory.h"
+
+static const int64 ROW_COUNTS[] = {2, 0, 2, 2};
+
+static SF_JSON_ROWSET *parse(const char *text) {
+    size_t len = strlen(text);
+    char *buffer = (char *) SF_TAG_MALLOC(SF_MEMORY_TAG_CHUNK_DOWNLOAD, len + 1);
+    memcpy(buffer, text, len + 1);
+    return sf_json_rowset_parse(buffer, len, len + 1, SF_MEMORY_TAG_CHUNK_DOWNLOAD);
+}
+
+static const char *cell_value(SF_JSON_ROWSET *rowset, size_t row, size_t col) {
+    SF_JSON_CELL *cell = &rowset->cells[row * rowset->column_count + col];
+    return cell->is_null ? NULL : &rowset->buffer[cell->offset];
+}
+
+/**
+ * Tests that rows are found in their chunk, empty chunks included
+ */
+void test_scroll_cache_find(void **unused) {
+    SF_SCROLL_CACHE *cache = sf_scroll_cache_create(ROW_COUNTS, 4, 1024, 0, NULL);
+    assert_non_null(cache);
+    assert_int_equal(sf_scroll_cache_find(cache, 0), 0);
+    assert_int_equal(sf_scroll_cache_find(cache, 1), 0);
+    assert_int_equal(sf_scroll_cache_find(cache, 2), 2);
+    assert_int_equal(sf_scroll_cache_find(cache, 3), 2);
+    assert_int_equal(sf_scroll_cache_find(cache, 5), 3);
+    assert_int_equal(sf_scroll_cache_find(cache, 6), -1);
+    assert_int_equal(sf_scroll_cache_find(cache, -1), -1);
+    sf_scroll_cache_free(cache);
+}
+
+/**
+ * Tests that a chunk is read back as it was put, values, nulls and empty strings included
+ */
+void test_scroll_cache_put_get(void **unused) {
+    SF_SCROLL_CACHE *cache = sf_scroll_cache_create(ROW_COUNTS, 4, 1024 * 1024, 0, NULL);
+    SF_JSON_ROWSET *rowset = parse("[[\"1\", null, \"abc\"], [\"\", \"\\u00e9\", null]]");
+    SF_JSON_ROWSET *copy;
+
+    assert_non_null(rowset);
+    assert_false(sf_scroll_cache_contains(cache, 0));
+    sf_scroll_cache_put(cache, 0, rowset);
+    assert_true(sf_scroll_cache_contains(cache, 0));
+    assert_true(cache->memory_used > 0);
+    // Not kept for a chunk of another row count
+    sf_scroll_cache_put(cache, 1, rowset);
+    assert_false(sf_scroll_cache_contains(cache, 1));
+    sf_json_rowset_free(rowset);
+
+    copy = sf_scroll_cache_get(cache, 0);
+    assert_non_null(copy);
+    assert_int_equal(copy->row_count, 2);
+    assert_int_equal(copy->column_count, 3);
+    assert_string_equal(cell_value(copy, 0, 0), "1");
+    assert_null(cell_value(copy, 0, 1));
+    assert_string_equal(cell_value(copy, 0, 2), "abc");
+    assert_int_equal(copy->cells[2].len, 3);
+    assert_string_equal(cell_value(copy, 1, 0), "");
+    assert_string_equal(cell_value(copy, 1, 1), "\xc3\xa9");
+    assert_null(cell_value(copy, 1, 2));
+    sf_json_rowset_free(copy);
+    assert_null(sf_scroll_cache_get(cache, 2));
+
+    sf_scroll_cache_free(cache);
+    assert_int_equal(sf_memory_tag_used(SF_MEMORY_TAG_RESULT_SET), 0);
+}
+
+/**
+ * Tests that the least recently used chunk leaves the memory for the disk, then is dropped
+ * once the disk limit is reached
+ */
+void test_scroll_cache_eviction(void **unused) {
+    SF_SCROLL_CACHE *cache = sf_scroll_cache_create(ROW_COUNTS, 4, 1024 * 1024, 0, NULL);
+    SF_JSON_ROWSET *rowset = parse("[[\"a\", \"b\"], [\"c\", null]]");
+    SF_JSON_ROWSET *copy;
+    char path[MAX_PATH];
+    uint64 size;
+    FILE *file;
+
+    assert_non_null(rowset);
+    sf_scroll_cache_put(cache, 0, rowset);
+    size = cache->memory_used;
+    sf_scroll_cache_free(cache);
+
+    // Room for one chunk in memory and one on disk
+    cache = sf_scroll_cache_create(ROW_COUNTS, 4, size, size, ".");
+    assert_non_null(cache);
+    sf_scroll_cache_put(cache, 0, rowset);
+    sf_scroll_cache_put(cache, 2, rowset);
+    assert_int_equal(cache->chunks[0].state, SF_SCROLL_CHUNK_DISK);
+    assert_int_equal(cache->chunks[2].state, SF_SCROLL_CHUNK_MEMORY);
+    sf_scroll_cache_put(cache, 3, rowset);
+    assert_int_equal(cache->chunks[0].state, SF_SCROLL_CHUNK_DISK);
+    assert_false(sf_scroll_cache_contains(cache, 2));
+    assert_int_equal(cache->chunks[3].state, SF_SCROLL_CHUNK_MEMORY);
+    assert_int_equal(cache->memory_used, size);
+    assert_int_equal(cache->disk_used, size);
+    sf_json_rowset_free(rowset);
+
+    copy = sf_scroll_cache_get(cache, 0);
+    assert_non_null(copy);
+    assert_string_equal(cell_value(copy, 1, 0), "c");
+    assert_null(cell_value(copy, 1, 1));
+    sf_json_rowset_free(copy);
+
+    // The file of the chunk on disk is removed with the cache
+    sb_sprintf(path, sizeof(path), ".%csf_scroll_%s_0.z", PATH_SEP, cache->spill_prefix);
+    file = fopen(path, "rb");
+    assert_non_null(file);
+    fclose(file);
+    sf_scroll_cache_free(cache);
+    assert_null(fopen(path, "rb"));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_scroll_cache_find),
+      cmocka_unit_test(test_scroll_cache_put_get),
+      cmocka_unit_test(test_scroll_cache_eviction),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
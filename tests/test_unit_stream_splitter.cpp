@@ -12,6 +12,7 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <atomic>
 
 using Snowflake::Client::Crypto::CryptoIV;
 using Snowflake::Client::Crypto::Cryptor;
@@ -63,7 +64,9 @@ void test_stream_splitter_appender(void **unused)
     std::stringstream outputStream;
     CipherIOStream decryptOutputStream(outputStream, CryptoOperation::DECRYPT, key, iv, 128);
 
-    Snowflake::Client::Util::StreamSplitter splitter(&encryptedInputStream, threadNum, partSize);
+    Snowflake::Client::Util::StreamBufferPool bufferPool(threadNum);
+    Snowflake::Client::Util::StreamSplitter splitter(&encryptedInputStream, &bufferPool,
+                                                     partSize);
     Snowflake::Client::Util::StreamAppender appender(&decryptOutputStream, splitParts,
                                                      threadNum, partSize);
 
@@ -72,13 +75,13 @@ void test_stream_splitter_appender(void **unused)
     Snowflake::Client::Util::ThreadPool tp(threadNum);
     for (int i = 0; i < splitParts; i++) {
       tp.AddJob([&]() {
-        int threadIdx = tp.GetThreadIdx();
         int partId;
         Snowflake::Client::Util::ByteArrayStreamBuf *srcBuf =
-          splitter.FillAndGetBuf(threadIdx, partId);
+          splitter.FillAndGetBuf(partId);
 
         memcpy(encryptedParts[partId], srcBuf->getDataBuffer(),
                srcBuf->getSize());
+        splitter.ReleaseBuf(srcBuf);
       });
     }
     tp.WaitAll();
@@ -101,10 +104,143 @@ void test_stream_splitter_appender(void **unused)
   }
 }
 
+/**
+ * Test that the parts of two streams split at once in one thread pool share
+ * the buffers of one pool, and each is waited on by itself.
+ */
+void test_stream_splitter_shared_pool(void **unused)
+{
+  const int partSize = 4;
+  const int threadNum = 4;
+  const int numBuffers = 2;
+  std::string inputs[2] = {"aaaabbbbccccddddeeee", "ffffgggghhhh"};
+
+  Snowflake::Client::Util::ThreadPool tp(threadNum);
+  Snowflake::Client::Util::StreamBufferPool bufferPool(numBuffers);
+  std::atomic<int> inUse(0);
+  std::atomic<int> maxInUse(0);
+
+  std::thread uploads[2];
+  std::string outputs[2][5];
+  for (int f = 0; f < 2; f++)
+  {
+    uploads[f] = std::thread([&, f]() {
+      std::stringstream inputStream(inputs[f]);
+      Snowflake::Client::Util::StreamSplitter splitter(&inputStream, &bufferPool, partSize);
+      int parts = (int)inputs[f].size() / partSize;
+      Snowflake::Client::Util::JobGroup jobs;
+      for (int i = 0; i < parts; i++)
+      {
+        jobs.AddJob(tp, [&]() {
+          int partId;
+          ByteArrayStreamBuf *buf = splitter.FillAndGetBuf(partId);
+          int now = ++inUse;
+          int seen = maxInUse;
+          while (now > seen && !maxInUse.compare_exchange_weak(seen, now));
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          outputs[f][partId] = std::string(buf->getDataBuffer(), buf->getSize());
+          --inUse;
+          splitter.ReleaseBuf(buf);
+        });
+      }
+      jobs.Wait();
+    });
+  }
+  uploads[0].join();
+  uploads[1].join();
+
+  for (int f = 0; f < 2; f++)
+  {
+    std::string joined;
+    for (int i = 0; i < 5; i++)
+    {
+      joined += outputs[f][i];
+    }
+    assert_string_equal(inputs[f].c_str(), joined.c_str());
+  }
+  assert_true(maxInUse <= numBuffers);
+}
+
+/**
+ * Test that a pool bounded in bytes hands out buffers for parts of different
+ * sizes and gives a single large part a buffer anyway.
+ */
+void test_stream_buffer_pool_bytes(void **unused)
+{
+  Snowflake::Client::Util::StreamBufferPool bufferPool(4, 16);
+
+  ByteArrayStreamBuf *small = bufferPool.Acquire(4);
+  ByteArrayStreamBuf *other = bufferPool.Acquire(8);
+  assert_true(small->getCapacity() >= 4);
+  assert_true(other->getCapacity() >= 8);
+  bufferPool.Release(small);
+  bufferPool.Release(other);
+
+  // larger than the limit, the free buffers make room for it
+  ByteArrayStreamBuf *large = bufferPool.Acquire(32);
+  assert_true(large->getCapacity() >= 32);
+  bufferPool.Release(large);
+
+  // reused for a part that fits
+  assert_ptr_equal(bufferPool.Acquire(20), large);
+  bufferPool.Release(large);
+}
+
+#ifndef _WIN32
+/**
+ * Test that parts written to a file land at their offsets, in any order, the
+ * last one shorter, and that the preallocated file is cut after it.
+ */
+void test_stream_appender_file(void **unused)
+{
+  char tmpDir[100] = {0};
+  sf_get_tmp_dir(tmpDir);
+  std::string fileName = std::string(tmpDir) + "stream_appender_file_test.dat";
+  std::ofstream(fileName.c_str(), std::ios_base::binary).close();
+
+  std::string inputStr = "aaaabbbbccccdd";
+  const int partSize = 4;
+  const int splitParts = 4;
+  const int threadNum = 2;
+  std::stringstream outputStream;
+  Snowflake::Client::Util::StreamAppender appender(&outputStream, splitParts,
+                                                   threadNum, partSize);
+  assert_true(appender.WriteToFile(fileName, partSize, splitParts * partSize));
+
+  Snowflake::Client::Util::ThreadPool tp(threadNum);
+  for (int i = splitParts - 1; i >= 0; i--)
+  {
+    tp.AddJob([&, i]() {
+      int threadIdx = tp.GetThreadIdx();
+      ByteArrayStreamBuf *dstBuf = appender.GetBuffer(threadIdx);
+      std::string part = inputStr.substr(i * partSize, partSize);
+      memcpy(dstBuf->getDataBuffer(), part.data(), part.size());
+      dstBuf->updateSize((long)part.size());
+      assert_true(appender.WritePartToOutputStream(threadIdx, i));
+    });
+  }
+  tp.WaitAll();
+  assert_true(appender.FinishFile());
+
+  assert_true(outputStream.str().empty());
+  std::ifstream file(fileName.c_str(), std::ios_base::binary);
+  std::string written((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  assert_string_equal(inputStr.c_str(), written.c_str());
+  file.close();
+  remove(fileName.c_str());
+}
+#endif
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_byte_array_stream),
     cmocka_unit_test(test_stream_splitter_appender),
+    cmocka_unit_test(test_stream_splitter_shared_pool),
+    cmocka_unit_test(test_stream_buffer_pool_bytes),
+#ifndef _WIN32
+    cmocka_unit_test(test_stream_appender_file),
+#endif
   };
   int ret = cmocka_run_group_tests(tests, NULL, NULL);
   return ret;
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include "utils/test_setup.h"
+#include "thread_affinity.h"
+
+#ifdef __linux__
+#include <sched.h>
+
+static cpu_set_t placed;
+
+static void *place_thread(void *unused) {
+    sf_affinity_apply(sf_affinity_group());
+    sched_getaffinity(0, sizeof(placed), &placed);
+    return NULL;
+}
+
+static void start_placed_thread() {
+    SF_THREAD_HANDLE thread;
+    CPU_ZERO(&placed);
+    assert_int_equal(_thread_init(&thread, place_thread, NULL), 0);
+    _thread_join(thread);
+}
+#endif
+
+/**
+ * Tests that the lists of CPUs are checked and kept
+ */
+void test_affinity_cpu_list(void **unused) {
+    char cpus[32];
+
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, "0-1,3"),
+                     SF_STATUS_SUCCESS);
+    snowflake_global_get_attribute(SF_GLOBAL_THREAD_CPUS, cpus, sizeof(cpus));
+    assert_string_equal(cpus, "0-1,3");
+#ifdef __linux__
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, "3-1"),
+                     SF_STATUS_ERROR_OUT_OF_RANGE);
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, "0,a"),
+                     SF_STATUS_ERROR_OUT_OF_RANGE);
+    snowflake_global_get_attribute(SF_GLOBAL_THREAD_CPUS, cpus, sizeof(cpus));
+    assert_string_equal(cpus, "0-1,3");
+#endif
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, NULL),
+                     SF_STATUS_SUCCESS);
+    snowflake_global_get_attribute(SF_GLOBAL_THREAD_CPUS, cpus, sizeof(cpus));
+    assert_string_equal(cpus, "");
+}
+
+/**
+ * Tests that the threads placed run on the CPUs of the policy
+ */
+void test_affinity_policies(void **unused) {
+#ifdef __linux__
+    SF_THREAD_AFFINITY policy = SF_THREAD_AFFINITY_CPU_SET;
+
+    // Without a policy the CPUs listed don't matter
+    snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, "0");
+    start_placed_thread();
+    assert_true(CPU_COUNT(&placed) >= 1);
+
+    snowflake_global_set_attribute(SF_GLOBAL_THREAD_AFFINITY, &policy);
+    start_placed_thread();
+    assert_int_equal(CPU_COUNT(&placed), 1);
+    assert_true(CPU_ISSET(0, &placed));
+
+    // Pinned to a node, which has CPU 0 or to which CPU 0 is left out
+    policy = SF_THREAD_AFFINITY_NUMA_LOCAL;
+    snowflake_global_set_attribute(SF_GLOBAL_THREAD_AFFINITY, &policy);
+    start_placed_thread();
+    assert_true(CPU_COUNT(&placed) >= 1);
+
+    policy = SF_THREAD_AFFINITY_NONE;
+    snowflake_global_set_attribute(SF_GLOBAL_THREAD_AFFINITY, &policy);
+    snowflake_global_set_attribute(SF_GLOBAL_THREAD_CPUS, NULL);
+#endif
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_affinity_cpu_list),
+      cmocka_unit_test(test_affinity_policies),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -5,6 +5,8 @@
 #include "util/ByteArrayStreamBuf.hpp"
 #include "utils/test_setup.h"
 #include "util/ThreadPool.hpp"
+#include "io_threads.h"
+#include <atomic>
 #include <thread>
 
 void test_thread_pool(void **unused)
@@ -31,9 +33,67 @@ void test_thread_pool(void **unused)
 
 }
 
+/**
+ * Jobs added by the jobs themselves are run and waited on too.
+ */
+void test_thread_pool_nested_jobs(void **unused)
+{
+  Snowflake::Client::Util::ThreadPool tp(4);
+  std::atomic<int> done(0);
+  const int jobs = 1000;
+  for (int i = 0; i < jobs; i++)
+  {
+    tp.AddJob([&tp, &done]{
+      tp.AddJob([&done]{
+        done ++;
+      });
+      done ++;
+    });
+  }
+
+  tp.WaitAll();
+  assert_int_equal(done, 2 * jobs);
+
+  // the pool is still usable after waiting
+  tp.AddJob([&done]{
+    done ++;
+  });
+  tp.WaitAll();
+  assert_int_equal(done, 2 * jobs + 1);
+}
+
+/**
+ * Pools take their threads from the process-wide budget, and get at least
+ * one once it is used up.
+ */
+void test_thread_pool_io_budget(void **unused)
+{
+  sf_io_threads_set_limit(5);
+  {
+    Snowflake::Client::Util::ThreadPool tp1(4);
+    assert_int_equal(sf_io_threads_in_use(), 4);
+    Snowflake::Client::Util::ThreadPool tp2(4);
+    assert_int_equal(sf_io_threads_in_use(), 5);
+    Snowflake::Client::Util::ThreadPool tp3(4);
+    assert_int_equal(sf_io_threads_in_use(), 6);
+
+    int done = 0;
+    tp3.AddJob([&done]{
+      done ++;
+    });
+    tp3.WaitAll();
+    assert_int_equal(done, 1);
+  }
+  assert_int_equal(sf_io_threads_in_use(), 0);
+  sf_io_threads_set_limit(0);
+}
+
 int main(void) {
+  sf_io_threads_init();
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_thread_pool),
+    cmocka_unit_test(test_thread_pool_nested_jobs),
+    cmocka_unit_test(test_thread_pool_io_budget),
   };
   int ret = cmocka_run_group_tests(tests, NULL, NULL);
   return ret;
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <sys/stat.h>
+#include "utils/test_setup.h"
+#include "token_cache.h"
+
+static char cache_dir[MAX_PATH];
+
+static SF_CONNECT *cached_connection(const char *role) {
+    SF_CONNECT *sf = snowflake_init();
+    snowflake_set_attribute(sf, SF_CON_ACCOUNT, "testaccount");
+    snowflake_set_attribute(sf, SF_CON_HOST, "testaccount.snowflakecomputing.com");
+    snowflake_set_attribute(sf, SF_CON_USER, "testuser");
+    snowflake_set_attribute(sf, SF_CON_ROLE, role);
+    snowflake_set_attribute(sf, SF_CON_TOKEN_CACHE_DIR, cache_dir);
+    assert_true(sf_token_cache_open(sf));
+    return sf;
+}
+
+static cJSON *login_data(const char *token, double validity, double master_validity) {
+    cJSON *data = snowflake_cJSON_CreateObject();
+    cJSON *parameters = snowflake_cJSON_AddArrayToObject(data, "parameters");
+    cJSON *parameter = snowflake_cJSON_CreateObject();
+    cJSON *session_info = snowflake_cJSON_AddObjectToObject(data, "sessionInfo");
+
+    snowflake_cJSON_AddStringToObject(data, "token", token);
+    snowflake_cJSON_AddStringToObject(data, "masterToken", "master");
+    snowflake_cJSON_AddNumberToObject(data, "validityInSeconds", validity);
+    snowflake_cJSON_AddNumberToObject(data, "masterValidityInSeconds", master_validity);
+    snowflake_cJSON_AddStringToObject(parameter, "name", "TIMEZONE");
+    snowflake_cJSON_AddStringToObject(parameter, "value", "UTC");
+    snowflake_cJSON_AddItemToArray(parameters, parameter);
+    snowflake_cJSON_AddStringToObject(session_info, "databaseName", "TESTDB");
+    snowflake_cJSON_AddStringToObject(session_info, "schemaName", "PUBLIC");
+    snowflake_cJSON_AddStringToObject(session_info, "warehouseName", "TESTWH");
+    snowflake_cJSON_AddStringToObject(session_info, "roleName", "TESTROLE");
+    return data;
+}
+
+static const char *item_string(cJSON *entry, const char *name) {
+    return snowflake_cJSON_GetObjectItem(entry, name)->valuestring;
+}
+
+/**
+ * Tests that a session saved by one connection is found by the next one, renewals included
+ */
+void test_token_cache_round_trip(void **unused) {
+    SF_CONNECT *first = cached_connection("TESTROLE");
+    SF_CONNECT *second = cached_connection("TESTROLE");
+    cJSON *data = login_data("session", 3600, 14400);
+    cJSON *renewal = snowflake_cJSON_CreateObject();
+    cJSON *entry;
+    double validity;
+
+    assert_null(sf_token_cache_load(second));
+    sf_token_cache_save(first, data, "token");
+    entry = sf_token_cache_load(second);
+    assert_non_null(entry);
+    assert_string_equal(item_string(entry, "token"), "session");
+    assert_string_equal(item_string(entry, "masterToken"), "master");
+    validity = snowflake_cJSON_GetObjectItem(entry, "validityInSeconds")->valuedouble;
+    assert_true(validity > 3500 && validity <= 3600);
+    assert_string_equal(
+        item_string(snowflake_cJSON_GetObjectItem(entry, "sessionInfo"), "warehouseName"),
+        "TESTWH");
+    snowflake_cJSON_Delete(entry);
+
+    // A renewal replaces the tokens and keeps what the login left
+    snowflake_cJSON_AddStringToObject(renewal, "sessionToken", "renewed");
+    snowflake_cJSON_AddStringToObject(renewal, "masterToken", "master");
+    snowflake_cJSON_AddNumberToObject(renewal, "validityInSecondsST", 3600);
+    snowflake_cJSON_AddNumberToObject(renewal, "validityInSecondsMT", 14400);
+    sf_token_cache_save(second, renewal, "sessionToken");
+    entry = sf_token_cache_load(first);
+    assert_non_null(entry);
+    assert_string_equal(item_string(entry, "token"), "renewed");
+    assert_non_null(snowflake_cJSON_GetObjectItem(entry, "parameters"));
+    snowflake_cJSON_Delete(entry);
+
+    sf_token_cache_remove(first);
+    assert_null(sf_token_cache_load(second));
+
+    snowflake_cJSON_Delete(renewal);
+    snowflake_cJSON_Delete(data);
+    snowflake_term(first);
+    snowflake_term(second);
+}
+
+/**
+ * Tests that the sessions are kept apart by role and credentials and dropped once the master
+ * token expires
+ */
+void test_token_cache_keys_and_expiry(void **unused) {
+    SF_CONNECT *sf = cached_connection("TESTROLE");
+    SF_CONNECT *other = cached_connection("OTHERROLE");
+    SF_CONNECT *wrong_password;
+    SF_CONNECT *other_authenticator;
+    cJSON *data = login_data("session", -1, 14400);
+    cJSON *expiring = login_data("expiring", 3600, 0.001);
+    cJSON *entry;
+
+    sf_token_cache_save(sf, data, "token");
+    assert_null(sf_token_cache_load(other));
+
+    wrong_password = cached_connection("TESTROLE");
+    snowflake_set_attribute(wrong_password, SF_CON_PASSWORD, "wrong");
+    assert_true(sf_token_cache_open(wrong_password));
+    assert_null(sf_token_cache_load(wrong_password));
+    assert_null(strstr(wrong_password->token_cache_key, "wrong"));
+    snowflake_term(wrong_password);
+
+    other_authenticator = cached_connection("TESTROLE");
+    snowflake_set_attribute(other_authenticator, SF_CON_AUTHENTICATOR, "externalbrowser");
+    assert_true(sf_token_cache_open(other_authenticator));
+    assert_null(sf_token_cache_load(other_authenticator));
+    snowflake_term(other_authenticator);
+
+    // A session token that expired is left to renew with the master token
+    entry = sf_token_cache_load(sf);
+    assert_non_null(entry);
+    assert_true(snowflake_cJSON_GetObjectItem(entry, "validityInSeconds")->valuedouble <= 0);
+    snowflake_cJSON_Delete(entry);
+
+    sf_token_cache_save(other, expiring, "token");
+    sf_sleep_ms(10);
+    assert_null(sf_token_cache_load(other));
+    assert_null(fopen(other->token_cache_file, "rb"));
+
+    sf_token_cache_remove(sf);
+    snowflake_cJSON_Delete(expiring);
+    snowflake_cJSON_Delete(data);
+    snowflake_term(sf);
+    snowflake_term(other);
+}
+
+/**
+ * Tests that the files are only readable by their owner and ignored otherwise
+ */
+void test_token_cache_permissions(void **unused) {
+#ifndef _WIN32
+    SF_CONNECT *sf = cached_connection("TESTROLE");
+    cJSON *data = login_data("session", 3600, 14400);
+    cJSON *entry;
+    struct stat st;
+
+    sf_token_cache_save(sf, data, "token");
+    assert_int_equal(stat(sf->token_cache_file, &st), 0);
+    assert_int_equal(st.st_mode & 0777, 0600);
+    entry = sf_token_cache_load(sf);
+    assert_non_null(entry);
+    snowflake_cJSON_Delete(entry);
+
+    chmod(sf->token_cache_file, 0644);
+    assert_null(sf_token_cache_load(sf));
+
+    sf_token_cache_remove(sf);
+    snowflake_cJSON_Delete(data);
+    snowflake_term(sf);
+#endif
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    cache_dir[0] = '\0';
+    sf_get_uniq_tmp_dir(cache_dir);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_token_cache_round_trip),
+      cmocka_unit_test(test_token_cache_keys_and_expiry),
+      cmocka_unit_test(test_token_cache_permissions),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    sf_delete_directory_if_exists(cache_dir);
+    snowflake_global_term();
+    return ret;
+}
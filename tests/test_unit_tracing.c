@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "tracing.h"
+
+#define MAX_SPANS 4
+
+static SF_TRACE_SPAN exported[MAX_SPANS];
+static int exported_count;
+
+static void STDCALL export_span(const SF_TRACE_SPAN *span, void *user_data) {
+    assert_ptr_equal(user_data, &exported_count);
+    if (exported_count < MAX_SPANS) {
+        exported[exported_count] = *span;
+    }
+    exported_count++;
+}
+
+static void assert_hex(const char *id, size_t len) {
+    size_t i;
+    assert_int_equal(strlen(id), len);
+    for (i = 0; i < len; i++) {
+        assert_non_null(strchr("0123456789abcdef", id[i]));
+    }
+}
+
+/**
+ * Tests that a child span is in the trace of its parent and inherits its query id, and that
+ * both are exported as they end
+ */
+void test_tracing_spans(void **unused) {
+    SF_TRACE_EXPORTER exporter = {export_span, &exported_count};
+    const SF_TRACE_EXPORTER *current = NULL;
+    SF_TRACE_SPAN root;
+    SF_TRACE_SPAN child;
+    SF_TRACE_CONTEXT context;
+
+    exported_count = 0;
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_TRACE_EXPORTER, &exporter),
+                     SF_STATUS_SUCCESS);
+    snowflake_global_get_attribute(SF_GLOBAL_TRACE_EXPORTER, &current, sizeof(current));
+    assert_non_null(current);
+    assert_true(current->export_fn == export_span);
+
+    sf_span_start(&root, "query", NULL);
+    assert_true(sf_span_active(&root));
+    strcpy(root.sfqid, "01a2b3c4-0000-0000-0000-000000000001");
+    sf_span_context(&root, &context);
+    sf_span_start_child(&child, "query.request", &context, 5);
+    child.bytes = 10;
+    sf_span_end(&child, SF_STATUS_SUCCESS);
+    sf_span_end(&root, SF_STATUS_ERROR_GENERAL);
+    assert_false(sf_span_active(&root));
+    // Ending again exports nothing
+    sf_span_end(&root, SF_STATUS_SUCCESS);
+
+    assert_int_equal(exported_count, 2);
+    assert_string_equal(exported[0].name, "query.request");
+    assert_string_equal(exported[1].name, "query");
+    assert_hex(exported[1].trace_id, SF_TRACE_ID_LEN - 1);
+    assert_hex(exported[1].span_id, SF_SPAN_ID_LEN - 1);
+    assert_string_equal(exported[1].parent_span_id, "");
+    assert_int_equal(exported[1].status, SF_STATUS_ERROR_GENERAL);
+    assert_int_equal(exported[1].chunk_index, -1);
+
+    assert_string_equal(exported[0].trace_id, exported[1].trace_id);
+    assert_string_equal(exported[0].parent_span_id, exported[1].span_id);
+    assert_string_not_equal(exported[0].span_id, exported[1].span_id);
+    assert_string_equal(exported[0].sfqid, "01a2b3c4-0000-0000-0000-000000000001");
+    assert_int_equal(exported[0].bytes, 10);
+    assert_int_equal(exported[0].status, SF_STATUS_SUCCESS);
+    assert_true(exported[0].start_time_ns + 5000000 <= exported[0].end_time_ns);
+    assert_true(exported[1].start_time_ns <= exported[1].end_time_ns);
+
+    assert_int_equal(snowflake_global_set_attribute(SF_GLOBAL_TRACE_EXPORTER, NULL),
+                     SF_STATUS_SUCCESS);
+}
+
+/**
+ * Tests that nothing is exported without an exporter or under a parent that wasn't traced
+ */
+void test_tracing_off(void **unused) {
+    SF_TRACE_EXPORTER exporter = {export_span, &exported_count};
+    SF_TRACE_CONTEXT untraced;
+    SF_TRACE_SPAN span;
+
+    exported_count = 0;
+    sf_span_start(&span, "login", NULL);
+    assert_false(sf_span_active(&span));
+    sf_span_end(&span, SF_STATUS_SUCCESS);
+
+    sf_trace_set_exporter(&exporter);
+    memset(&untraced, 0, sizeof(untraced));
+    sf_span_start_child(&span, "chunk.download", &untraced, 0);
+    assert_false(sf_span_active(&span));
+    sf_span_end(&span, SF_STATUS_SUCCESS);
+    sf_span_start_child(&span, "chunk.download", NULL, 0);
+    assert_false(sf_span_active(&span));
+
+    // A span started before the exporter is removed isn't exported either
+    sf_span_start(&span, "login", NULL);
+    sf_trace_set_exporter(NULL);
+    sf_span_end(&span, SF_STATUS_SUCCESS);
+    assert_int_equal(exported_count, 0);
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_tracing_spans),
+      cmocka_unit_test(test_tracing_off),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+#include <string.h>
+#include "utils/test_setup.h"
+#include "tz_cache.h"
+
+#ifndef _WIN32
+/**
+ * Converts seconds since the epoch to a TIMESTAMP_LTZ value in the given timezone
+ */
+static void check_ltz(const char *timezone, const char *epoch, int32 tzoffset, int hour, int isdst) {
+    SF_TIMESTAMP ts;
+    assert_int_equal(snowflake_timestamp_from_epoch_seconds(&ts, epoch, timezone, 0, SF_DB_TYPE_TIMESTAMP_LTZ),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(ts.tzoffset, tzoffset);
+    assert_int_equal(ts.tm_obj.tm_hour, hour);
+    assert_int_equal(ts.tm_obj.tm_isdst, isdst);
+}
+
+/**
+ * Tests the offsets computed from the zoneinfo database around daylight saving time changes
+ */
+void test_tz_cache_offsets(void **unused) {
+    if (!sf_tz_cache_get("America/Los_Angeles")) {
+        // No zoneinfo database on this system
+        return;
+    }
+    // 2021-03-14 01:59:59 PST and 03:00:00 PDT
+    check_ltz("America/Los_Angeles", "1615715999", -480, 1, 0);
+    check_ltz("America/Los_Angeles", "1615716000", -420, 3, 1);
+
+    // 2100, past the transitions listed in the file
+    check_ltz("Australia/Sydney", "4103654400", 660, 11, 1);
+    check_ltz("Australia/Sydney", "4119292800", 600, 10, 0);
+    check_ltz("Asia/Kathmandu", "4119292800", 345, 5, 0);
+}
+#endif
+
+/**
+ * Tests the texts of the JSON results, a column of them converted at once
+ */
+void test_timestamps_from_epoch_text(void **unused) {
+    const char *values[] = {"1593586800.123456789 2040", NULL, "-0.500000000 1440", "12.5 1380"};
+    SF_TIMESTAMP ts[4];
+    assert_int_equal(snowflake_timestamps_from_epoch_seconds(ts, values, 4, NULL, 9,
+                                                             SF_DB_TYPE_TIMESTAMP_TZ),
+                     SF_STATUS_SUCCESS);
+    // 2020-07-01 07:00:00.123456789 +10:00
+    assert_int_equal(ts[0].tzoffset, 600);
+    assert_int_equal(ts[0].tm_obj.tm_hour, 17);
+    assert_int_equal(ts[0].nsec, 123456789);
+    // NULL is the epoch
+    assert_int_equal(ts[1].tm_obj.tm_year, 70);
+    assert_int_equal(ts[1].ts_type, SF_DB_TYPE_TIMESTAMP_NTZ);
+    // half a second before the epoch
+    assert_int_equal(ts[2].tm_obj.tm_year, 69);
+    assert_int_equal(ts[2].tm_obj.tm_sec, 59);
+    assert_int_equal(ts[2].nsec, 500000000);
+    // fewer digits than the scale
+    assert_int_equal(ts[3].tzoffset, -60);
+    assert_int_equal(ts[3].tm_obj.tm_hour, 23);
+    assert_int_equal(ts[3].nsec, 500000000);
+
+    // the scale taken from the digits
+    assert_int_equal(snowflake_timestamp_from_epoch_seconds(&ts[0], "86399.25", NULL, -1,
+                                                            SF_DB_TYPE_TIME),
+                     SF_STATUS_SUCCESS);
+    assert_int_equal(ts[0].scale, 2);
+    assert_int_equal(ts[0].tm_obj.tm_hour, 23);
+    assert_int_equal(ts[0].nsec, 250000000);
+
+    assert_int_equal(snowflake_timestamp_from_epoch_seconds(&ts[0], "abc", NULL, 0,
+                                                            SF_DB_TYPE_TIMESTAMP_NTZ),
+                     SF_STATUS_ERROR_GENERAL);
+}
+
+/**
+ * Tests that names outside of the zoneinfo database are not loaded
+ */
+void test_tz_cache_invalid_names(void **unused) {
+    assert_null(sf_tz_cache_get(NULL));
+    assert_null(sf_tz_cache_get(""));
+    assert_null(sf_tz_cache_get("../../etc/passwd"));
+    assert_null(sf_tz_cache_get("/etc/localtime"));
+    assert_null(sf_tz_cache_get("No/Such_Zone"));
+}
+
+int main(void) {
+    initialize_test(SF_BOOLEAN_FALSE);
+    const struct CMUnitTest tests[] = {
+#ifndef _WIN32
+      cmocka_unit_test(test_tz_cache_offsets),
+#endif
+      cmocka_unit_test(test_tz_cache_invalid_names),
+      cmocka_unit_test(test_timestamps_from_epoch_text),
+    };
+    int ret = cmocka_run_group_tests(tests, NULL, NULL);
+    snowflake_global_term();
+    return ret;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2021 Snowflake Computing, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <sstream>
+#include <string>
+#include <zlib.h>
+#include "util/CompressionUtil.hpp"
+#include "utils/test_setup.h"
+
+using Snowflake::Client::Util::CompressionUtil;
+using Snowflake::Client::Util::CompressStreamBuf;
+using Snowflake::Client::Util::DecompressStreamBuf;
+
+static FILE *write_tmpfile(const std::string &data)
+{
+  FILE *file = tmpfile();
+  assert_non_null(file);
+  assert_int_equal(fwrite(data.data(), 1, data.size(), file), data.size());
+  rewind(file);
+  return file;
+}
+
+static std::string read_tmpfile(FILE *file)
+{
+  std::string data;
+  char buffer[4096];
+  size_t len;
+  rewind(file);
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    data.append(buffer, len);
+  }
+  return data;
+}
+
+/**
+ * Compresses size bytes with zstd and checks that they decompress back to the
+ * original data.
+ */
+static void zstd_round_trip(size_t size, unsigned int threads)
+{
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++)
+  {
+    data[i] = (char)("Snowflake"[i % 9] + (i / 4096) % 7);
+  }
+
+  FILE *source = write_tmpfile(data);
+  FILE *compressed = tmpfile();
+  FILE *decompressed = tmpfile();
+  assert_non_null(compressed);
+  assert_non_null(decompressed);
+
+  long destSize = 0;
+  size_t hashed = 0;
+  int ret = CompressionUtil::compressWithZstd(source, compressed, destSize, -1, threads,
+    [&hashed](const char *, size_t len)
+    {
+      hashed += len;
+    });
+  assert_int_equal(ret, Z_OK);
+  assert_int_equal((size_t)destSize, hashed);
+  assert_int_equal(ftell(compressed), destSize);
+
+  rewind(compressed);
+  assert_int_equal(CompressionUtil::decompressWithZstd(compressed, decompressed), Z_OK);
+  assert_true(read_tmpfile(decompressed) == data);
+
+  fclose(source);
+  fclose(compressed);
+  fclose(decompressed);
+}
+
+void test_zstd_empty(void **unused)
+{
+  zstd_round_trip(0, 1);
+}
+
+void test_zstd_threads(void **unused)
+{
+  zstd_round_trip(20 * 1024 * 1024, 4);
+}
+
+void test_zstd_truncated(void **unused)
+{
+  std::string data(100000, 'x');
+  FILE *source = write_tmpfile(data);
+  FILE *compressed = tmpfile();
+  long destSize = 0;
+  assert_int_equal(CompressionUtil::compressWithZstd(source, compressed, destSize, 3, 1,
+                                                     nullptr), Z_OK);
+
+  std::string frame = read_tmpfile(compressed);
+  FILE *truncated = write_tmpfile(frame.substr(0, frame.size() - 4));
+  FILE *decompressed = tmpfile();
+  assert_int_equal(CompressionUtil::decompressWithZstd(truncated, decompressed), Z_DATA_ERROR);
+
+  fclose(source);
+  fclose(compressed);
+  fclose(truncated);
+  fclose(decompressed);
+}
+
+/**
+ * A gzip file of several members, as compressed on several threads, is
+ * decompressed whole.
+ */
+void test_gzip_members(void **unused)
+{
+  std::string first(70000, 'a');
+  std::string second(50000, 'b');
+  std::string members;
+  std::string member;
+  assert_int_equal(CompressionUtil::compressWithGzip(first.data(), first.size(), member), Z_OK);
+  members += member;
+  assert_int_equal(CompressionUtil::compressWithGzip(second.data(), second.size(), member), Z_OK);
+  members += member;
+
+  FILE *source = write_tmpfile(members);
+  FILE *decompressed = tmpfile();
+  assert_int_equal(CompressionUtil::decompressWithGzip(source, decompressed), Z_OK);
+  assert_true(read_tmpfile(decompressed) == first + second);
+
+  fclose(source);
+  fclose(decompressed);
+}
+
+/**
+ * Writes data in small pieces through a stream decompressing it.
+ */
+static int decompress_stream(const std::string &data, bool zstd, std::string &result)
+{
+  std::stringbuf output;
+  DecompressStreamBuf decompressBuf(&output, zstd);
+  std::ostream stream(&decompressBuf);
+  for (size_t i = 0; i < data.size(); i += 1000)
+  {
+    stream.write(data.data() + i, std::min((size_t)1000, data.size() - i));
+  }
+  int ret = decompressBuf.finish();
+  result = output.str();
+  return ret;
+}
+
+/**
+ * Downloads to a stream are decompressed as they are written.
+ */
+void test_decompress_stream_buf(void **unused)
+{
+  std::string first(70000, 'a');
+  std::string second(50000, 'b');
+  std::string members;
+  std::string member;
+  assert_int_equal(CompressionUtil::compressWithGzip(first.data(), first.size(), member), Z_OK);
+  members += member;
+  assert_int_equal(CompressionUtil::compressWithGzip(second.data(), second.size(), member), Z_OK);
+  members += member;
+
+  std::string result;
+  assert_int_equal(decompress_stream(members, false, result), Z_OK);
+  assert_true(result == first + second);
+  assert_int_equal(decompress_stream(members.substr(0, members.size() - 4), false, result),
+                   Z_DATA_ERROR);
+
+  if (CompressionUtil::isZstdSupported())
+  {
+    FILE *source = write_tmpfile(first);
+    FILE *compressed = tmpfile();
+    long destSize = 0;
+    assert_int_equal(CompressionUtil::compressWithZstd(source, compressed, destSize, 3, 1,
+                                                       nullptr), Z_OK);
+    assert_int_equal(decompress_stream(read_tmpfile(compressed), true, result), Z_OK);
+    assert_true(result == first);
+    fclose(source);
+    fclose(compressed);
+  }
+}
+
+/**
+ * Reads the data compressed by a stream, in small pieces.
+ */
+static std::string compress_stream(const std::string &data, bool zstd, int level)
+{
+  std::stringbuf input(data);
+  CompressStreamBuf compressBuf(&input, zstd, level);
+  std::istream stream(&compressBuf);
+  std::string compressed;
+  char buffer[1000];
+  while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+  {
+    compressed.append(buffer, (size_t)stream.gcount());
+  }
+  assert_int_equal(compressBuf.getError(), Z_OK);
+  return compressed;
+}
+
+/**
+ * Uploads of streams are compressed as they are read, the same each time.
+ */
+void test_compress_stream_buf(void **unused)
+{
+  std::string data;
+  for (int i = 0; i < 100000; i++)
+  {
+    data += std::to_string(i) + ",row\n";
+  }
+
+  std::string result;
+  std::string compressed = compress_stream(data, false, 6);
+  assert_true(compressed.size() < data.size() / 2);
+  assert_true(compress_stream(data, false, 6) == compressed);
+  assert_int_equal(decompress_stream(compressed, false, result), Z_OK);
+  assert_true(result == data);
+
+  // empty data is still a whole gzip member
+  assert_int_equal(decompress_stream(compress_stream("", false, -1), false, result), Z_OK);
+  assert_true(result.empty());
+
+  if (CompressionUtil::isZstdSupported())
+  {
+    compressed = compress_stream(data, true, 3);
+    assert_int_equal(decompress_stream(compressed, true, result), Z_OK);
+    assert_true(result == data);
+  }
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_zstd_empty),
+    cmocka_unit_test(test_zstd_threads),
+    cmocka_unit_test(test_zstd_truncated),
+    cmocka_unit_test(test_gzip_members),
+    cmocka_unit_test(test_decompress_stream_buf),
+    cmocka_unit_test(test_compress_stream_buf),
+  };
+  int ret = cmocka_run_group_tests(tests, NULL, NULL);
+  return ret;
+}
@@ -23,7 +23,7 @@ extern "C" {
 
 // Standard Login
 #define MOCK_URL_STANDARD_LOGIN "https://standard.snowflakecomputing.com:443/session/v1/login-request"
-#define MOCK_BODY_STANDARD_LOGIN "{\n\t\"data\":\t{\n\t\t\"CLIENT_APP_ID\":\t\"C API\",\n\t\t\"CLIENT_APP_VERSION\":\t\"0.0.0\",\n\t\t\"ACCOUNT_NAME\":\t\"standard\",\n\t\t\"LOGIN_NAME\":\t\"standarduser\",\n\t\t\"PASSWORD\":\t\"secret-password\",\n\t\t\"CLIENT_ENVIRONMENT\":\t{\n\t\t\t\"APPLICATION\":\t\"C API\",\n\t\t\t\"OS\":\t\"Linux\",\n\t\t\t\"OS_VERSION\":\t\"0\"\n\t\t},\n\t\t\"SESSION_PARAMETERS\":\t{\n\t\t\t\"AUTOCOMMIT\":\t\"TRUE\",\n\t\t\t\"TIMEZONE\":\t\"UTC\"\n\t\t}\n\t}\n}"
+#define MOCK_BODY_STANDARD_LOGIN "{\"data\":{\"CLIENT_APP_ID\":\"C API\",\"CLIENT_APP_VERSION\":\"0.0.0\",\"ACCOUNT_NAME\":\"standard\",\"LOGIN_NAME\":\"standarduser\",\"PASSWORD\":\"secret-password\",\"CLIENT_ENVIRONMENT\":{\"APPLICATION\":\"C API\",\"OS\":\"Linux\",\"OS_VERSION\":\"0\"},\"SESSION_PARAMETERS\":{\"AUTOCOMMIT\":\"TRUE\",\"TIMEZONE\":\"UTC\"}}}"
 #define MOCK_RESPONSE_STANDARD_LOGIN "{\n \
                   \"code\": null,\n \
                   \"data\":\n \
@@ -90,7 +90,7 @@ extern "C" {
 
 // Standard query sending
 #define MOCK_URL_STANDARD_QUERY "https://standard.snowflakecomputing.com:443/queries/v1/query-request"
-#define MOCK_BODY_STANDARD_QUERY "{\n\t\"sqlText\":\t\"select 1;\",\n\t\"asyncExec\":\tfalse,\n\t\"sequenceId\":\t1,\n\t\"querySubmissionTime\":\t0\n}"
+#define MOCK_BODY_STANDARD_QUERY "{\"sqlText\":\"select 1;\",\"asyncExec\":false,\"sequenceId\":1,\"querySubmissionTime\":0,\"describeOnly\":false}"
 #define MOCK_RESPONSE_STANDARD_QUERY "{\n \
                   \"data\":\n \
                     {\n \
@@ -177,7 +177,7 @@ extern "C" {
 
 // Service name login
 #define MOCK_URL_SERVICE_NAME_LOGIN "https://servicename.snowflakecomputing.com:443/session/v1/login-request"
-#define MOCK_BODY_SERVICE_NAME_LOGIN "{\n\t\"data\":\t{\n\t\t\"CLIENT_APP_ID\":\t\"C API\",\n\t\t\"CLIENT_APP_VERSION\":\t\"0.0.0\",\n\t\t\"ACCOUNT_NAME\":\t\"servicename\",\n\t\t\"LOGIN_NAME\":\t\"servicenameuser\",\n\t\t\"PASSWORD\":\t\"secret-password\",\n\t\t\"CLIENT_ENVIRONMENT\":\t{\n\t\t\t\"APPLICATION\":\t\"C API\",\n\t\t\t\"OS\":\t\"Linux\",\n\t\t\t\"OS_VERSION\":\t\"0\"\n\t\t},\n\t\t\"SESSION_PARAMETERS\":\t{\n\t\t\t\"AUTOCOMMIT\":\t\"TRUE\",\n\t\t\t\"TIMEZONE\":\t\"UTC\"\n\t\t}\n\t}\n}"
+#define MOCK_BODY_SERVICE_NAME_LOGIN "{\"data\":{\"CLIENT_APP_ID\":\"C API\",\"CLIENT_APP_VERSION\":\"0.0.0\",\"ACCOUNT_NAME\":\"servicename\",\"LOGIN_NAME\":\"servicenameuser\",\"PASSWORD\":\"secret-password\",\"CLIENT_ENVIRONMENT\":{\"APPLICATION\":\"C API\",\"OS\":\"Linux\",\"OS_VERSION\":\"0\"},\"SESSION_PARAMETERS\":{\"AUTOCOMMIT\":\"TRUE\",\"TIMEZONE\":\"UTC\"}}}"
 #define MOCK_RESPONSE_SERVICE_NAME_LOGIN "{\n \
                   \"code\": null,\n \
                   \"data\":\n \